@@ -390,10 +390,17 @@ public class LoomVideo
     }
 
 
+    ///the activity videos are played in, also used by LoomVideoTexture
+    static Activity getContext()
+    {
+        return _context;
+    }
+
+
     // ________________________________________________
     // Native
     // ________________________________________________
-    private static void deferNativeCallback(int type, String data)
+    static void deferNativeCallback(int type, String data)
     {
         final int fType = type;
         final String fData = data;
@@ -0,0 +1,203 @@
+package co.theengine.loomplayer;
+
+import android.net.Uri;
+import android.app.Activity;
+import android.graphics.SurfaceTexture;
+import android.media.MediaPlayer;
+import android.media.MediaPlayer.OnCompletionListener;
+import android.media.MediaPlayer.OnErrorListener;
+import android.media.MediaPlayer.OnPreparedListener;
+import android.util.Log;
+import android.util.SparseArray;
+import android.view.Surface;
+
+
+/**
+ * Plays a video into an external OES texture owned by the renderer.
+ *
+ * The decoder writes its frames into a SurfaceTexture made from the GL
+ * texture name handed to open, so the renderer samples them without any
+ * copy. All of the static methods are called from native code on the GL
+ * thread, updateTexImage has to run on the thread owning the context.
+ */
+public class LoomVideoTexture implements SurfaceTexture.OnFrameAvailableListener, OnCompletionListener, OnErrorListener, OnPreparedListener
+{
+    private static final String                         TAG = "LoomVideoTexture";
+    private static final SparseArray<LoomVideoTexture>  _videos = new SparseArray<LoomVideoTexture>();
+    private static int                                  _nextId = 0;
+
+    private SurfaceTexture      _surfaceTexture;
+    private Surface             _surface;
+    private MediaPlayer         _player;
+    private String              _file;
+    private volatile boolean    _frameAvailable = false;
+    private boolean             _prepared = false;
+    private boolean             _paused = false;
+    private float[]             _transform = new float[16];
+
+
+    ///starts playing the raw resource into the texture, returns an id or -1
+    public static int open(String file, int texName, boolean loop)
+    {
+        Activity context = LoomVideo.getContext();
+        if(context == null)
+        {
+            Log.e(TAG, "Unable to play " + file + " before the activity was created");
+            return -1;
+        }
+
+        LoomVideoTexture video = new LoomVideoTexture();
+        video._file = file;
+        video._surfaceTexture = new SurfaceTexture(texName);
+        video._surfaceTexture.setOnFrameAvailableListener(video);
+        video._surface = new Surface(video._surfaceTexture);
+
+        try
+        {
+            Uri videoUri = Uri.parse("android.resource://" + context.getPackageName() + "/raw/" + file);
+
+            video._player = new MediaPlayer();
+            video._player.setDataSource(context, videoUri);
+            video._player.setSurface(video._surface);
+            video._player.setLooping(loop);
+            video._player.setOnCompletionListener(video);
+            video._player.setOnErrorListener(video);
+            video._player.setOnPreparedListener(video);
+            video._player.prepareAsync();
+        }
+        catch(Exception e)
+        {
+            Log.e(TAG, "Unable to play " + file + ": " + e.getMessage());
+            video.release();
+            return -1;
+        }
+
+        int id = _nextId++;
+        _videos.put(id, video);
+        return id;
+    }
+
+
+    ///latches the newest frame into the texture, fills out with its 4x4 texture
+    ///transform followed by the video width and height, returns true if a new
+    ///frame was latched
+    public static boolean update(int id, float[] out)
+    {
+        LoomVideoTexture video = _videos.get(id);
+        if(video == null || !video._frameAvailable)
+        {
+            return false;
+        }
+
+        video._frameAvailable = false;
+        video._surfaceTexture.updateTexImage();
+        video._surfaceTexture.getTransformMatrix(video._transform);
+
+        System.arraycopy(video._transform, 0, out, 0, 16);
+        out[16] = video._player.getVideoWidth();
+        out[17] = video._player.getVideoHeight();
+        return true;
+    }
+
+
+    public static void pause(int id)
+    {
+        LoomVideoTexture video = _videos.get(id);
+        if(video == null)
+        {
+            return;
+        }
+
+        video._paused = true;
+        if(video._prepared && video._player.isPlaying())
+        {
+            video._player.pause();
+        }
+    }
+
+
+    public static void resume(int id)
+    {
+        LoomVideoTexture video = _videos.get(id);
+        if(video == null)
+        {
+            return;
+        }
+
+        video._paused = false;
+        if(video._prepared)
+        {
+            video._player.start();
+        }
+    }
+
+
+    public static void close(int id)
+    {
+        LoomVideoTexture video = _videos.get(id);
+        if(video == null)
+        {
+            return;
+        }
+
+        _videos.remove(id);
+        video.release();
+    }
+
+
+    private void release()
+    {
+        if(_player != null)
+        {
+            _player.release();
+            _player = null;
+        }
+        if(_surface != null)
+        {
+            _surface.release();
+            _surface = null;
+        }
+        if(_surfaceTexture != null)
+        {
+            _surfaceTexture.release();
+            _surfaceTexture = null;
+        }
+    }
+
+
+    @Override
+    public void onFrameAvailable(SurfaceTexture surfaceTexture)
+    {
+        ///called on an arbitrary thread, the frame is latched by update on the GL thread
+        _frameAvailable = true;
+    }
+
+
+    @Override
+    public void onPrepared(MediaPlayer mp)
+    {
+        Log.d(TAG, "Video Prepared: " + _file);
+        _prepared = true;
+        if(!_paused)
+        {
+            mp.start();
+        }
+    }
+
+
+    @Override
+    public void onCompletion(MediaPlayer mp)
+    {
+        ///looping players don't complete
+        LoomVideo.deferNativeCallback(1, _file);
+    }
+
+
+    @Override
+    public boolean onError(MediaPlayer mp, int what, int extra)
+    {
+        Log.e(TAG, "Video Failed: " + _file + " " + what + " " + extra);
+        LoomVideo.deferNativeCallback(0, _file);
+        return true;
+    }
+}
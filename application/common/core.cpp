@@ -25,6 +25,7 @@
 #include "loom/common/config/applicationConfig.h"
 #include "loom/graphics/gfxGraphics.h"
 #include "loom/common/core/log.h"
+#include "loom/common/core/telemetry.h"
 #include "loom/common/platform/platform.h"
 #include "loom/common/platform/platformMobile.h"
 
@@ -171,6 +172,7 @@ void loop()
         else if(event.type == SDL_FINGERDOWN)
         {
             if (!stage->fingerEnabled) continue;
+            stage->flushTouchMoved((int)event.tfinger.fingerId);
             stage->_TouchBeganDelegate.pushArgument((int)event.tfinger.fingerId);
             stage->_TouchBeganDelegate.pushArgument(event.tfinger.x*stage->stageWidth);
             stage->_TouchBeganDelegate.pushArgument(event.tfinger.y*stage->stageHeight);
@@ -179,6 +181,7 @@ void loop()
         else if(event.type == SDL_FINGERUP)
         {
             if (!stage->fingerEnabled) continue;
+            stage->flushTouchMoved((int)event.tfinger.fingerId);
             stage->_TouchEndedDelegate.pushArgument((int)event.tfinger.fingerId);
             stage->_TouchEndedDelegate.pushArgument(event.tfinger.x*stage->stageWidth);
             stage->_TouchEndedDelegate.pushArgument(event.tfinger.y*stage->stageHeight);
@@ -187,15 +190,12 @@ void loop()
         else if(event.type == SDL_FINGERMOTION)
         {
             if (!stage->fingerEnabled) continue;
-            stage->_TouchMovedDelegate.pushArgument((int)event.tfinger.fingerId);
-            stage->_TouchMovedDelegate.pushArgument(event.tfinger.x*stage->stageWidth);
-            stage->_TouchMovedDelegate.pushArgument(event.tfinger.y*stage->stageHeight);
-            stage->_TouchMovedDelegate.pushArgument(SDL_BUTTON_LEFT);
-            stage->_TouchMovedDelegate.invoke();
+            stage->queueTouchMoved((int)event.tfinger.fingerId, event.tfinger.x*stage->stageWidth, event.tfinger.y*stage->stageHeight, SDL_BUTTON_LEFT, event.tfinger.timestamp);
         }
         else if(event.type == SDL_MOUSEBUTTONDOWN)
         {
             if (!stage->mouseEnabled) continue;
+            stage->flushTouchMoved((int)event.button.which);
             stage->_TouchBeganDelegate.pushArgument((int)event.button.which);
             stage->_TouchBeganDelegate.pushArgument(event.button.x);
             stage->_TouchBeganDelegate.pushArgument(event.button.y);
@@ -204,6 +204,7 @@ void loop()
         else if(event.type == SDL_MOUSEBUTTONUP)
         {
             if (!stage->mouseEnabled) continue;
+            stage->flushTouchMoved((int)event.button.which);
             stage->_TouchEndedDelegate.pushArgument((int)event.button.which);
             stage->_TouchEndedDelegate.pushArgument(event.button.x);
             stage->_TouchEndedDelegate.pushArgument(event.button.y);
@@ -212,11 +213,7 @@ void loop()
         else if(event.type == SDL_MOUSEMOTION)
         {
             if (!stage->mouseEnabled) continue;
-            stage->_TouchMovedDelegate.pushArgument((int)event.motion.which);
-            stage->_TouchMovedDelegate.pushArgument(event.motion.x);
-            stage->_TouchMovedDelegate.pushArgument(event.motion.y);
-            stage->_TouchMovedDelegate.pushArgument((int)event.motion.state);
-            stage->_TouchMovedDelegate.invoke();
+            stage->queueTouchMoved((int)event.motion.which, (float)event.motion.x, (float)event.motion.y, (int)event.motion.state, event.motion.timestamp);
         }
         else if(event.type == SDL_MOUSEWHEEL)
         {
@@ -298,6 +295,9 @@ void loop()
         }
     }
 
+    // Moves are coalesced per pointer, one each goes out for the frame
+    if (stage) stage->flushTouchMoves();
+
     /* Tick and render Loom. */
     loom_tick();
 }
@@ -361,18 +361,22 @@ static int sdlPriorityEvents(void* userdata, SDL_Event* event)
     return true;
 }
 
-enum  optionIndex { UNKNOWN, HELP, FROM_RUBY };
+enum  optionIndex { UNKNOWN, HELP, FROM_RUBY, HEADLESS, FRAMES, FRAME_LOG };
 const option::Descriptor usage[] =
 {
     { UNKNOWN,   0,"" , ""         , option::Arg::None, "USAGE: LoomPlayer [options] [loom-file-or-project-dir] [app-arguments]\n\n"
                                                   "Options:" },
     { HELP,      0, "", "help",      option::Arg::None, "  --help  \tPrint usage and exit" },
     { FROM_RUBY, 0, "", "from-ruby", option::Arg::None, "  --from-ruby  \tDefined when running from the Ruby agent" },
+    { HEADLESS,  0, "", "headless",  option::Arg::None, "  --headless  \tRender offscreen without showing the window, as fast as possible, for benchmarking" },
+    { FRAMES,    0, "", "frames",    option::Arg::Optional, "  --frames=<count>  \tExit after count frames, 600 by default when headless" },
+    { FRAME_LOG, 0, "", "frame-log", option::Arg::Optional, "  --frame-log=<file>  \tWrite the telemetry of every frame to file as JSON lines, frames.json by default when headless" },
     { UNKNOWN,   0, "" , ""        , option::Arg::None, "\nExamples:\n"
                                                "  LoomPlayer  \tLaunches project in the working directory\n"
                                                "  LoomPlayer .  \tSame as above\n"
                                                "  LoomPlayer path/to/project/dir/  \tLaunches project located in path/to/project/dir/\n"
                                                "  LoomPlayer path/to/assembly/Main.loom  \tLaunches the specified .loom assembly\n"
+                                               "  LoomPlayer --headless --frames=1000 --frame-log=out.json bin/Main.loom  \tBenchmarks 1000 frames\n"
     },
     { 0,0,0,0,0,0 }
 };
@@ -441,6 +445,20 @@ main(int argc, char *argv[])
     for (option::Option* opt = options[UNKNOWN]; opt; opt = opt->next())
         platform_debugOut("Unknown option: %s", opt->name);
 
+    // Headless runs render into a framebuffer of their own, the window
+    // stays hidden, nothing waits on vsync and every frame gets logged
+    bool headless = options[HEADLESS] != NULL;
+
+    int frameLimit = headless ? 600 : 0;
+    if (options[FRAMES])
+    {
+        frameLimit = options[FRAMES].arg ? atoi(options[FRAMES].arg) : 0;
+        if (frameLimit <= 0) usageError("Invalid frame count: %s", options[FRAMES].arg ? options[FRAMES].arg : "");
+    }
+
+    const char *frameLog = headless ? "frames.json" : NULL;
+    if (options[FRAME_LOG]) frameLog = options[FRAME_LOG].arg ? options[FRAME_LOG].arg : "frames.json";
+
     int coreOptions = 0;
 
     utString assemblyPath = ".";
@@ -509,6 +527,9 @@ main(int argc, char *argv[])
     lmLogDebug(coreLogGroup, "SDL linked version : %d.%d.%d", linked.major, linked.minor, linked.patch);
 
 
+    // Startup jobs begun by loom_appInit overlap with this
+    Telemetry::beginStartupPhase("window");
+
     SDL_Init(
         SDL_INIT_TIMER |
         SDL_INIT_VIDEO |
@@ -571,6 +592,8 @@ main(int argc, char *argv[])
         displayMode == "fullscreenWindow" ? SDL_WINDOW_FULLSCREEN_DESKTOP :
         0;
 
+    if (headless) windowFlags = SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN;
+
     // Set up SDL window.
     if ((gSDLWindow = SDL_CreateWindow(
         "Loom",
@@ -591,27 +614,54 @@ main(int argc, char *argv[])
         exit(2);
     }
 
-    ret = SDL_GL_SetSwapInterval(-1);
-    if (ret != 0) {
-        lmLogDebug(coreLogGroup, "Late swap tearing not supported, using vsync");
-        SDL_GL_SetSwapInterval(1);
+    if (headless)
+    {
+        SDL_GL_SetSwapInterval(0);
+    }
+    else
+    {
+        ret = SDL_GL_SetSwapInterval(-1);
+        if (ret != 0) {
+            lmLogDebug(coreLogGroup, "Late swap tearing not supported, using vsync");
+            SDL_GL_SetSwapInterval(1);
+        }
     }
 
     SDL_StopTextInput();
 
+    Telemetry::endStartupPhase("window");
+
     // Initialize Loom!
     loom_appSetup();
     supplyEmbeddedAssets();
 
+    if (headless)
+    {
+        int width, height;
+        SDL_GL_GetDrawableSize(gSDLWindow, &width, &height);
+        GFX::Graphics::createOffscreenFramebuffer(width, height);
+
+        Loom2D::Stage::headless = true;
+        LoomApplication::framePacer.setUnlocked(true);
+    }
+
+    if (frameLog && !Telemetry::startRecording(frameLog)) usageError("Unable to write the frame log: %s", frameLog);
+
     /* Main render loop */
     gLoomExecutionDone = 0;
 
 #ifdef __EMSCRIPTEN__
     emscripten_set_main_loop(loop, 0, 1);
 #else
-    while (!gLoomExecutionDone) loop();
+    for (int frame = 1; !gLoomExecutionDone; frame++)
+    {
+        loop();
+        if (frameLimit > 0 && frame >= frameLimit) gLoomExecutionDone = 1;
+    }
 #endif
 
+    Telemetry::stopRecording();
+
     loom_appShutdown();
 
     exit(0);
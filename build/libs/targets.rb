@@ -186,6 +186,7 @@ class LoomTarget < Target
       "-DLUA_GC_PROFILE_ENABLED=#{CFG[:ENABLE_LUA_GC_PROFILE]} "\
       "-DLOOM_BUILD_NUMCORES=#{$HOST.num_cores} "\
       "-DLOOM_IS_DEBUG=#{is_debug} "\
+      "-DLOOM_BUILD_FLOAT_SCALAR=#{CFG[:FLOAT_SCALAR]} "\
       "-DLOOM_BUILD_ADMOB=#{CFG[:BUILD_ADMOB]} "\
       "-DLOOM_BUILD_FACEBOOK=#{CFG[:BUILD_FACEBOOK]} "\
       "-DLUAJIT_LIB=\"#{@luajit.binPath(toolchain)}\" "\
@@ -0,0 +1,207 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "zlib.h"
+
+#include "loom/common/core/log.h"
+#include "loom/common/core/allocator.h"
+#include "loom/common/platform/platformIO.h"
+#include "loom/common/assets/assetArchive.h"
+
+lmDefineLogGroup(gAssetArchiveLogGroup, "asset.archive", 1, LoomLogInfo);
+
+extern "C"
+{
+extern loom_allocator_t *gAssetAllocator;
+}
+
+struct loom_assetArchive
+{
+    void                           *bits;
+    long                           size;
+
+    const loom_assetArchiveEntry_t *entries;
+    unsigned int                   entryCount;
+    const char                     *names;
+};
+
+
+// Compares an entry name with a name being looked up, '\' matching '/'.
+static bool loom_assetArchive_nameEquals(const char *entryName, const char *name)
+{
+    for (name = loom_assetArchive_skipPrefix(name); *entryName && *name; entryName++, name++)
+    {
+        if (*entryName != (*name == '\\' ? '/' : *name))
+        {
+            return false;
+        }
+    }
+
+    return *entryName == *name;
+}
+
+
+loom_assetArchive_t *loom_assetArchive_open(const char *path)
+{
+    void *bits;
+    long size;
+
+    if (!platform_mapFile(path, &bits, &size))
+    {
+        return NULL;
+    }
+
+    const loom_assetArchiveHeader_t *header = (const loom_assetArchiveHeader_t *)bits;
+
+    if ((size < (long)sizeof(loom_assetArchiveHeader_t)) ||
+        (header->magic != LOOM_ASSET_ARCHIVE_MAGIC) ||
+        (header->version != LOOM_ASSET_ARCHIVE_VERSION) ||
+        (header->indexOffset > (unsigned long)size) ||
+        (header->namesOffset > (unsigned long)size) ||
+        (header->namesOffset < header->indexOffset) ||
+        ((header->namesOffset - header->indexOffset) / sizeof(loom_assetArchiveEntry_t) < header->entryCount))
+    {
+        lmLogError(gAssetArchiveLogGroup, "'%s' is not a valid asset archive", path);
+        platform_unmapFile(bits);
+        return NULL;
+    }
+
+    loom_assetArchive_t *archive = (loom_assetArchive_t *)lmAlloc(gAssetAllocator, sizeof(loom_assetArchive_t));
+
+    archive->bits       = bits;
+    archive->size       = size;
+    archive->entries    = (const loom_assetArchiveEntry_t *)((const char *)bits + header->indexOffset);
+    archive->entryCount = header->entryCount;
+    archive->names      = (const char *)bits + header->namesOffset;
+
+    lmLogInfo(gAssetArchiveLogGroup, "Mounted '%s', %d entries", path, archive->entryCount);
+
+    return archive;
+}
+
+
+void loom_assetArchive_close(loom_assetArchive_t *archive)
+{
+    if (!archive)
+    {
+        return;
+    }
+
+    platform_unmapFile(archive->bits);
+    lmFree(gAssetAllocator, archive);
+}
+
+
+static const loom_assetArchiveEntry_t *loom_assetArchive_find(loom_assetArchive_t *archive, const char *name)
+{
+    unsigned int hash = loom_assetArchive_hashName(name);
+
+    // Find the first entry with the hash.
+    unsigned int low  = 0;
+    unsigned int high = archive->entryCount;
+
+    while (low < high)
+    {
+        unsigned int mid = low + (high - low) / 2;
+
+        if (archive->entries[mid].nameHash < hash)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    // Then check the names of all entries sharing it.
+    for ( ; low < archive->entryCount && archive->entries[low].nameHash == hash; low++)
+    {
+        const loom_assetArchiveEntry_t *entry = &archive->entries[low];
+
+        if (loom_assetArchive_nameEquals(archive->names + entry->nameOffset, name))
+        {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+
+int loom_assetArchive_map(loom_assetArchive_t *archive, const char *name, void **outPointer, long *outSize, int *outTerminated)
+{
+    const loom_assetArchiveEntry_t *entry = loom_assetArchive_find(archive, name);
+
+    if (!entry)
+    {
+        return 0;
+    }
+
+    if ((entry->offset > (unsigned long)archive->size) || (entry->size > (unsigned long)archive->size - entry->offset))
+    {
+        lmLogError(gAssetArchiveLogGroup, "Entry '%s' lies outside of its archive", name);
+        return 0;
+    }
+
+    const unsigned char *data = (const unsigned char *)archive->bits + entry->offset;
+
+    if (!(entry->flags & LOOM_ASSET_ARCHIVE_COMPRESSED))
+    {
+        // Serve it straight out of the mapped archive, the NUL may only be
+        // relied on if it lies within the archive.
+        *outPointer    = (void *)data;
+        *outSize       = entry->size;
+        *outTerminated = (entry->flags & LOOM_ASSET_ARCHIVE_TERMINATED) &&
+                         (entry->size < (unsigned long)archive->size - entry->offset);
+        return 1;
+    }
+
+    // One byte over for the NUL, which also gives empty entries a buffer of
+    // their own.
+    unsigned char *inflated = (unsigned char *)lmAlloc(gAssetAllocator, entry->originalSize + 1);
+    uLongf        length    = entry->originalSize;
+
+    if ((uncompress(inflated, &length, data, entry->size) != Z_OK) || (length != entry->originalSize))
+    {
+        lmLogError(gAssetArchiveLogGroup, "Failed to inflate '%s'", name);
+        lmFree(gAssetAllocator, inflated);
+        return 0;
+    }
+
+    inflated[length] = 0;
+
+    *outPointer    = inflated;
+    *outSize       = (long)length;
+    *outTerminated = 1;
+    return 1;
+}
+
+
+void loom_assetArchive_unmap(loom_assetArchive_t *archive, void *ptr)
+{
+    // Slices of the archive stay mapped until it is closed.
+    if ((ptr >= archive->bits) && (ptr < (void *)((char *)archive->bits + archive->size)))
+    {
+        return;
+    }
+
+    lmFree(gAssetAllocator, ptr);
+}
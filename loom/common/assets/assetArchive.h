@@ -0,0 +1,125 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _ASSETS_ASSETARCHIVE_H_
+#define _ASSETS_ASSETARCHIVE_H_
+
+#include <stddef.h>
+
+/************************************************************************
+* PACKED ASSET ARCHIVES
+*
+* An archive (.lpak, built by tools/assetPack) holds many asset files in a
+* single file, so a mounted archive costs one platform_mapFile instead of
+* one per asset. This matters most on Android, where every open goes
+* through the APK.
+*
+* Layout, all fields little endian 32 bit:
+*
+*   header    magic 'LPAK', version, entry count, index offset, names offset
+*   data      entry data, each entry starting on a LOOM_ASSET_ARCHIVE_ALIGNMENT
+*             boundary
+*   index     entries sorted by name hash
+*   names     NUL terminated entry names, '/' separated
+*
+* Stored entries are served as slices of the mapped archive without any
+* copy. Compressed entries (zlib) are inflated into a buffer of their own.
+* assetPack follows every entry with at least one NUL byte, so text can be
+* used in place too.
+*
+************************************************************************/
+
+#define LOOM_ASSET_ARCHIVE_MAGIC         0x4B41504C // 'LPAK'
+#define LOOM_ASSET_ARCHIVE_VERSION       1
+#define LOOM_ASSET_ARCHIVE_ALIGNMENT     16
+
+// Entry flags.
+#define LOOM_ASSET_ARCHIVE_COMPRESSED    1
+#define LOOM_ASSET_ARCHIVE_TERMINATED    2 // a NUL follows the data
+
+// Archive mounted by loom_asset_initialize when present.
+#define LOOM_ASSET_ARCHIVE_DEFAULT       "assets.lpak"
+
+typedef struct loom_assetArchiveHeader
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int entryCount;
+    unsigned int indexOffset;
+    unsigned int namesOffset;
+} loom_assetArchiveHeader_t;
+
+typedef struct loom_assetArchiveEntry
+{
+    unsigned int nameHash;     // loom_assetArchive_hashName of the name
+    unsigned int nameOffset;   // from the start of the names
+    unsigned int offset;       // from the start of the archive
+    unsigned int size;         // bytes in the archive
+    unsigned int originalSize; // bytes once inflated, size if stored
+    unsigned int flags;
+} loom_assetArchiveEntry_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct loom_assetArchive loom_assetArchive_t;
+
+// Skips the "./" prefixes a name may start with.
+static inline const char *loom_assetArchive_skipPrefix(const char *name)
+{
+    while (name[0] == '.' && (name[1] == '/' || name[1] == '\\'))
+    {
+        name += 2;
+    }
+
+    return name;
+}
+
+// Hash the index is sorted by; FNV-1a over the name with '\' read as '/'
+// and any leading "./" skipped, so lookups needn't normalize first.
+static inline unsigned int loom_assetArchive_hashName(const char *name)
+{
+    unsigned int hash = 2166136261u;
+
+    for (name = loom_assetArchive_skipPrefix(name); *name; name++)
+    {
+        hash ^= (unsigned char)(*name == '\\' ? '/' : *name);
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+// Maps the archive at path and validates its index, NULL if it can't be
+// opened or isn't an archive.
+loom_assetArchive_t *loom_assetArchive_open(const char *path);
+void loom_assetArchive_close(loom_assetArchive_t *archive);
+
+// If the archive holds name, returns 1 and sets outPointer and outSize to
+// its data, which is read only, and outTerminated to 1 if a NUL follows it.
+// Always matched by loom_assetArchive_unmap. Safe to call from any thread.
+int loom_assetArchive_map(loom_assetArchive_t *archive, const char *name, void **outPointer, long *outSize, int *outTerminated);
+void loom_assetArchive_unmap(loom_assetArchive_t *archive, void *ptr);
+
+#ifdef __cplusplus
+};
+#endif
+#endif
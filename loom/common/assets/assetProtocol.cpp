@@ -20,6 +20,7 @@
 
 
 #include <string.h>
+#include "zlib.h"
 #include "loom/common/assets/assetProtocol.h"
 #include "loom/common/core/allocator.h"
 #include "loom/common/core/log.h"
@@ -184,9 +185,10 @@ bool AssetProtocolHandler::readFrame()
 
     buffer.setBuffer(header, bytesRead);
 
-    // See if we have enough of a frame to read the frame length.
+    // See if we have enough of a frame to read the frame length and
+    // checkpoint.
     int frameLength = 0;
-    if (bytesRead < 4)
+    if (bytesRead < 8)
     {
         return false;
     }
@@ -220,12 +222,12 @@ bool AssetProtocolHandler::readFrame()
 }
 
 
-void AssetProtocolHandler::process()
+bool AssetProtocolHandler::process()
 {
     // See if we got a frame.
     if (!readFrame())
     {
-        return;
+        return false;
     }
 
     // Awesome, so parse it.
@@ -254,6 +256,8 @@ void AssetProtocolHandler::process()
     {
         lmLogError(assetProtocolLogGroup, "Unknown fourcc %x! Skipping ahead %d bytes to next frame.", fourcc, bytesLength);
     }
+
+    return true;
 }
 
 
@@ -376,6 +380,161 @@ void AssetProtocolHandler::sendFile(const char *path, void *fileBits, int fileBi
 }
 
 
+void AssetProtocolHandler::sendDeltaHello()
+{
+    char          tmpBuff[1024];
+    NetworkBuffer sendBuffer;
+
+    sendBuffer.setBuffer(tmpBuff, 1024);
+
+    // Construct it - frame + type.
+    sendBuffer.writeInt(4 * 3);
+    sendBuffer.writeCheckpoint(0xDEADBEEF);
+    sendBuffer.writeInt(LOOM_FOURCC('X', 'F', 'R', '2'));
+
+    // Send it.
+    loom_net_writeTCPSocket(socket, tmpBuff, sendBuffer.getCurrentPosition());
+}
+
+
+void AssetProtocolHandler::sendFileManifest(int id, const char *path, int length, unsigned int crc, int pendingFiles)
+{
+    //    4 - frame length
+    //    4 - message type
+    //    4 - transfer id
+    //    4 - pending file count
+    //    4 - path length
+    //    P - path + NULL
+    //    4 - content length
+    //    4 - content crc32
+    //    4 - chunk size
+    int pathLength  = (int)strlen(path) + 1;
+    int frameLength = 10 * 4 + pathLength;
+
+    char          *msgBuffer = (char *)lmAlloc(NULL, frameLength);
+    NetworkBuffer sendBuffer;
+
+    sendBuffer.setBuffer(msgBuffer, frameLength);
+
+    sendBuffer.writeInt(frameLength);
+    sendBuffer.writeCheckpoint(0xDEADBEEF);
+    sendBuffer.writeInt(LOOM_FOURCC('F', 'M', 'A', 'N'));
+    sendBuffer.writeInt(id);
+    sendBuffer.writeInt(pendingFiles);
+    sendBuffer.writeString(path, pathLength);
+    sendBuffer.writeInt(length);
+    sendBuffer.writeInt((int)crc);
+    sendBuffer.writeInt(ASSET_PROTOCOL_CHUNK_SIZE);
+    sendBuffer.writeCheckpoint(0xDEADBEE4);
+
+    // Send it.
+    loom_net_writeTCPSocket(socket, msgBuffer, sendBuffer.getCurrentPosition());
+
+    lmFree(NULL, msgBuffer);
+}
+
+
+void AssetProtocolHandler::sendFileHashes(int id, int chunkCount, const unsigned int *crcs)
+{
+    //    4 - frame length
+    //    4 - message type
+    //    4 - transfer id
+    //    4 - chunk count
+    //  4*N - crc32 of each chunk
+    int frameLength = 6 * 4 + 4 * chunkCount;
+
+    char          *msgBuffer = (char *)lmAlloc(NULL, frameLength);
+    NetworkBuffer sendBuffer;
+
+    sendBuffer.setBuffer(msgBuffer, frameLength);
+
+    sendBuffer.writeInt(frameLength);
+    sendBuffer.writeCheckpoint(0xDEADBEEF);
+    sendBuffer.writeInt(LOOM_FOURCC('F', 'H', 'A', 'S'));
+    sendBuffer.writeInt(id);
+    sendBuffer.writeInt(chunkCount);
+    for (int i = 0; i < chunkCount; i++)
+    {
+        sendBuffer.writeInt((int)crcs[i]);
+    }
+    sendBuffer.writeCheckpoint(0xDEADBEE5);
+
+    // Send it.
+    loom_net_writeTCPSocket(socket, msgBuffer, sendBuffer.getCurrentPosition());
+
+    lmFree(NULL, msgBuffer);
+}
+
+
+void AssetProtocolHandler::sendFileChunk(int id, int chunkIndex, const void *bits, int length)
+{
+    //    4 - frame length
+    //    4 - message type
+    //    4 - transfer id
+    //    4 - chunk index
+    //    4 - flags
+    //    4 - chunk length once decompressed
+    //    4 - data length
+    //    N - data
+    uLongf        compressedLength = compressBound(length);
+    int           frameLength      = 9 * 4 + (int)compressedLength;
+    unsigned char *msgBuffer       = (unsigned char *)lmAlloc(NULL, frameLength);
+
+    // Compress it straight into the frame, falling back to the raw bits if
+    // that doesn't save anything; chunks of png or ogg rarely shrink.
+    unsigned char *data = msgBuffer + 8 * 4;
+    int           flags = ASSET_PROTOCOL_CHUNK_COMPRESSED;
+
+    if ((compress2(data, &compressedLength, (const Bytef *)bits, length, Z_BEST_SPEED) != Z_OK) ||
+        (compressedLength >= (uLongf)length))
+    {
+        memcpy(data, bits, length);
+        compressedLength = length;
+        flags            = 0;
+    }
+
+    frameLength = 9 * 4 + (int)compressedLength;
+
+    NetworkBuffer sendBuffer;
+    sendBuffer.setBuffer(msgBuffer, frameLength);
+
+    sendBuffer.writeInt(frameLength);
+    sendBuffer.writeCheckpoint(0xDEADBEEF);
+    sendBuffer.writeInt(LOOM_FOURCC('F', 'D', 'A', 'T'));
+    sendBuffer.writeInt(id);
+    sendBuffer.writeInt(chunkIndex);
+    sendBuffer.writeInt(flags);
+    sendBuffer.writeInt(length);
+    sendBuffer.writeInt((int)compressedLength); // data is already in place
+    sendBuffer.setPosition(sendBuffer.getCurrentPosition() + (int)compressedLength);
+    sendBuffer.writeCheckpoint(0xDEADBEE6);
+
+    // Send it.
+    loom_net_writeTCPSocket(socket, msgBuffer, sendBuffer.getCurrentPosition());
+
+    lmFree(NULL, msgBuffer);
+}
+
+
+void AssetProtocolHandler::sendFileEnd(int id, int chunksSent)
+{
+    char          tmpBuff[1024];
+    NetworkBuffer sendBuffer;
+
+    sendBuffer.setBuffer(tmpBuff, 1024);
+
+    sendBuffer.writeInt(6 * 4);
+    sendBuffer.writeCheckpoint(0xDEADBEEF);
+    sendBuffer.writeInt(LOOM_FOURCC('F', 'E', 'N', 'D'));
+    sendBuffer.writeInt(id);
+    sendBuffer.writeInt(chunksSent);
+    sendBuffer.writeCheckpoint(0xDEADBEE7);
+
+    // Send it.
+    loom_net_writeTCPSocket(socket, tmpBuff, sendBuffer.getCurrentPosition());
+}
+
+
 void AssetProtocolHandler::sendLog(const char *log)
 {
     int len = (int)strlen(log);
@@ -25,6 +25,13 @@
 #include "loom/common/platform/platformNetwork.h"
 #include "loom/common/utils/utString.h"
 
+// Delta transfers split files into chunks of this size; only the chunks
+// which differ from the game's copy are sent.
+#define ASSET_PROTOCOL_CHUNK_SIZE    (16 * 1024)
+
+// Flags of a file chunk.
+#define ASSET_PROTOCOL_CHUNK_COMPRESSED    1
+
 // Helper class to handle reading/writing asset protocol data.
 class NetworkBuffer
 {
@@ -61,6 +68,11 @@ public:
     {
         return curByte;
     }
+
+    void setPosition(int position)
+    {
+        curByte = position;
+    }
 };
 
 class AssetProtocolHandler;
@@ -109,8 +121,8 @@ public:
         return _id;
     }
 
-    // Look for network frames to process.
-    void process();
+    // Look for a network frame to process, returns true if one was.
+    bool process();
 
     // Get a string describing this connection.
     utString description();
@@ -122,6 +134,18 @@ public:
     void sendPing();
     void sendPong();
     void sendFile(const char *filename, void *fileBits, int fileBitsLength, int pendingFiles);
+
+    // Pipelined delta transfers, used with games which announced them with
+    // sendDeltaHello. The agent sends a manifest, the game replies with the
+    // hashes of the chunks of the copy it has, and the agent sends only the
+    // chunks that differ, compressed, followed by an end marker. Many
+    // transfers may be in flight at once, told apart by id.
+    void sendDeltaHello();
+    void sendFileManifest(int id, const char *path, int length, unsigned int crc, int pendingFiles);
+    void sendFileHashes(int id, int chunkCount, const unsigned int *crcs);
+    void sendFileChunk(int id, int chunkIndex, const void *bits, int length);
+    void sendFileEnd(int id, int chunksSent);
+
     void sendLog(const char *log);
     void sendCommand(const char *cmd);
     
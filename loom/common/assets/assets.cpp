@@ -27,6 +27,7 @@
 #include "loom/common/core/allocator.h"
 #include "loom/common/core/string.h"
 #include "loom/common/core/stringTable.h"
+#include "loom/common/core/performance.h"
 #include "loom/common/platform/platformThread.h"
 #include "loom/common/platform/platformTime.h"
 #include "loom/common/platform/platformIO.h"
@@ -43,8 +44,10 @@
 #include "loom/common/assets/assetsSound.h"
 #include "loom/common/assets/assetsScript.h"
 #include "loom/common/assets/assetProtocol.h"
+#include "loom/common/assets/assetArchive.h"
 
 #include <jansson.h>
+#include "zlib.h"
 
 #include "loom/common/config/applicationConfig.h"
 
@@ -59,6 +62,25 @@ void loom_asset_notifyPendingCountChange();
 static const int PROGRESS_INIT_TIME = 200;
 static const int PROGRESS_UPDATE_TIME = 500;
 
+// Upper bound on the threads mapping and deserializing queued assets.
+#define ASSET_MAX_LOAD_THREADS    4
+
+// Number of separately locked slices the asset table is split into.
+#define ASSET_HASH_SHARDS         16
+
+// Jobs handed out per load thread ahead of time, enough to keep them busy
+// between pumps while leaving the rest of the queue to priority order.
+#define ASSET_JOBS_PER_LOAD_THREAD    4
+
+// Milliseconds per pump spent handling frames from the asset agent.
+#define ASSET_SERVICE_BUDGET_MS       8
+
+// Default for loom_asset_setLoadBudget.
+#define ASSET_DEFAULT_LOAD_BUDGET     (32 * 1024 * 1024)
+
+// Default for loom_asset_setNotifyBudget.
+#define ASSET_DEFAULT_NOTIFY_BUDGET_MS    8
+
 extern "C" 
 {
   loom_allocator_t *gAssetAllocator = NULL;
@@ -71,6 +93,48 @@ struct loom_asset_subscription_t
     void                    *payload;
 };
 
+// A mapping kept by a mapped deserializer (see loom_assetMapping_t), released
+// once what was deserialized from it is cleaned up.
+struct loom_assetKeptMapping_t
+{
+   loom_assetKeptMapping_t()
+   {
+      archive = NULL;
+      bits = NULL;
+      detached = NULL;
+   }
+
+   bool isKept() const
+   {
+      return bits != NULL || detached != NULL;
+   }
+
+   // An archive entry if archive is set, otherwise a copy we own.
+   loom_assetArchive_t *archive;
+   void *bits;
+
+   // A file mapping, from platform_detachMapping.
+   void *detached;
+};
+
+// Cleans up deserialized bits, then lets go of the mapping they came from.
+static void loom_asset_freeBits(void *bits, LoomAssetCleanupCallback dtor, loom_assetKeptMapping_t& mapping)
+{
+   if(dtor)
+      dtor(bits);
+   else if(!mapping.isKept())
+      lmFree(gAssetAllocator, bits);
+
+   if(mapping.archive)
+      loom_assetArchive_unmap(mapping.archive, mapping.bits);
+   else if(mapping.detached)
+      platform_releaseMapping(mapping.detached);
+   else if(mapping.bits)
+      lmFree(gAssetAllocator, mapping.bits);
+
+   mapping = loom_assetKeptMapping_t();
+}
+
 // The actual binary data behind an asset; refcounted to let old copies linger
 // until they are unlocked.
 struct loom_assetBlob_t
@@ -104,10 +168,7 @@ struct loom_assetBlob_t
       
       if(refCount == 0)
       {
-         if(dtor)
-            dtor(bits);
-         else
-            lmFree(gAssetAllocator, bits);
+         loom_asset_freeBits(bits, dtor, mapping);
 
          refCount = 0xBAADF00D;
          length = -1;
@@ -124,6 +185,9 @@ struct loom_assetBlob_t
    size_t length;
    void *bits;
    LoomAssetCleanupCallback dtor;
+
+   // Set if bits are served out of a mapping.
+   loom_assetKeptMapping_t mapping;
 };
 
 // An individual asset; tracks all the state related to an asset, if it's loaded
@@ -136,6 +200,13 @@ struct loom_asset_t
       type = 0;
       blob = NULL;
       isSupplied = 0;
+      notifyQueued = 0;
+      lock = loom_mutex_create();
+   }
+
+   ~loom_asset_t()
+   {
+      loom_mutex_destroy(lock);
    }
 
    enum {
@@ -150,8 +221,8 @@ struct loom_asset_t
       Failed,
    } state;
 
-   // Not currently used; but allows an asset to wait until all its dependencies
-   // are deserialized.
+   // Assets that are preloaded along with this one and have to be loaded
+   // before it is instated, see loom_asset_addDependency.
    utArray<loom_asset_t*> dependencies;
 
    // All the callbacks to call when an asset changes state (is loaded, unloaded, 
@@ -172,8 +243,18 @@ struct loom_asset_t
    // flushed as there is no backing copy on disk/elsewhere.
    unsigned int isSupplied;
 
-   // Instate new bits/type to the asset.
-   void instate(int _type, void *bits, LoomAssetCleanupCallback dtor)
+   // Set while the asset waits in gAssetNotifyQueue, so however often it
+   // changes before the pump gets to it its subscribers are told once.
+   // Main thread only.
+   unsigned int notifyQueued;
+
+   // Guards the state, blob, type and subscribers of this asset, so threads
+   // working on different assets don't contend.
+   MutexHandle lock;
+
+   // Instate new bits/type to the asset. Called with lock held, the caller
+   // notifies the subscribers once it has let go of it.
+   void instate(int _type, void *bits, LoomAssetCleanupCallback dtor, const loom_assetKeptMapping_t& mapping)
    {
       // Swap in a new blob.
       if(blob)
@@ -183,29 +264,109 @@ struct loom_asset_t
 
       blob->bits = bits;
       blob->dtor = dtor;
+      blob->mapping = mapping;
 
       // Update the type.
       type = _type;
 
       // We're by definition loaded at this point.
       state = loom_asset_t::Loaded;
+   }
+};
 
-      // Fire subscribers.
-      loom_asset_notifySubscribers(name.c_str());
+// A queued asset on its way through the load threads; the file is mapped
+// and deserialized off the main thread, then instated on it.
+struct loom_assetLoadJob_t
+{
+   loom_assetLoadJob_t()
+   {
+      asset = NULL;
+      type = 0;
+      size = 0;
+      bits = NULL;
+      dtor = NULL;
+      pushed = NULL;
+      pushedSize = 0;
    }
+
+   loom_asset_t *asset;
+   utString path;
+   int type;
+
+   // Contents pushed by the asset agent, owned by the job and deserialized
+   // instead of the file when set.
+   void *pushed;
+   long pushedSize;
+
+   // Filled in by the load thread, bits is NULL if the load failed.
+   long size;
+   void *bits;
+   LoomAssetCleanupCallback dtor;
+   loom_assetKeptMapping_t mapping;
 };
 
 lmDefineLogGroup(gAssetLogGroup, "asset", 1, LoomLogInfo);
 
+// One slice of the asset table. Assets are only removed at shutdown, so a
+// shard is locked just for the lookup and the asset's own lock takes over.
+struct loom_assetShard_t
+{
+   MutexHandle lock;
+   utHashTable<utHashedString, loom_asset_t *> assets;
+};
+
+// An asset waiting in the load queue.
+struct loom_assetQueueEntry_t
+{
+   loom_asset_t *asset;
+   int priority;
+};
+
 // General asset manager state.
-static MutexHandle gAssetLock = NULL;
-static utHashTable<utHashedString, loom_asset_t *> gAssetHash;
-static utArray<loom_asset_t *> gAssetLoadQueue;
+static loom_assetShard_t gAssetShards[ASSET_HASH_SHARDS];
+static MutexHandle gAssetQueueLock = NULL;
+
+// Sorted by priority, most urgent first and in request order otherwise.
+static utArray<loom_assetQueueEntry_t> gAssetLoadQueue;
 static utHashTable<utIntHashKey, LoomAssetDeserializeCallback> gAssetDeserializerMap;
+static utHashTable<utIntHashKey, LoomAssetMappedDeserializeCallback> gAssetMappedDeserializerMap;
 static utArray<LoomAssetRecognizerCallback> gRecognizerList;
 static LoomAssetCommandCallback             gCommandCallback = NULL;
 static int gShuttingDown = 0;
 
+// Load thread state. Jobs and their results are guarded by gAssetJobLock,
+// the load threads take no other lock.
+static MutexHandle gAssetJobLock = NULL;
+static utList<loom_assetLoadJob_t> gAssetJobQueue;
+static utList<loom_assetLoadJob_t> gAssetCompleteQueue;
+static ThreadHandle gAssetLoadThreads[ASSET_MAX_LOAD_THREADS];
+static bool gAssetLoadThreadActive[ASSET_MAX_LOAD_THREADS];
+static int gAssetLoadThreadCount = 0;
+static bool gAssetLoadThreadsRunning = false;
+
+// Jobs handed out and not yet finished by a load thread, and the bytes
+// read by jobs whose results haven't been taken by the pump.
+static int gAssetJobsOutstanding = 0;
+static int gAssetBytesInFlight = 0;
+static int gAssetLoadBudget = ASSET_DEFAULT_LOAD_BUDGET;
+
+// Finished jobs whose assets wait for their dependencies, main thread only.
+static utArray<loom_assetLoadJob_t> gAssetWaitingJobs;
+
+// Changed assets whose subscribers haven't been told yet, oldest first and
+// each at most once. The pump works through them for up to
+// gAssetNotifyBudget milliseconds. Main thread only.
+static utList<loom_asset_t *> gAssetNotifyQueue;
+static int gAssetNotifyBudget = ASSET_DEFAULT_NOTIFY_BUDGET_MS;
+
+// Mounted archives, searched before loose files. Guarded by gAssetJobLock;
+// archives stay mounted until shutdown, so a copy of the list stays valid.
+static utArray<loom_assetArchive_t *> gAssetArchives;
+
+// Jobs handed to the load threads and not yet instated, guarded by
+// gAssetQueueLock.
+static int gAssetLoadsInFlight = 0;
+
 // Asset server connection state.
 static MutexHandle          gAssetServerSocketLock    = NULL;
 static AssetProtocolHandler *gAssetProtocolHandler    = NULL;
@@ -216,6 +377,19 @@ static loom_socketId_t gAssetServerSocket             = NULL;
 static int             gAssetConnectionOpen           = 0;
 static int             gPendingFiles = 0;
 
+// Last contents received from the asset agent by path, delta transfers of a
+// file only send what changed since. Only touched from the pump.
+static utHashTable<utHashedString, utArray<unsigned char> *> gAssetAgentFiles;
+
+static void loom_asset_clearAgentFiles()
+{
+    for (UTsize i = 0; i < gAssetAgentFiles.size(); i++)
+    {
+        lmDelete(gAssetAllocator, gAssetAgentFiles.at(i));
+    }
+    gAssetAgentFiles.clear();
+}
+
 // App time starts at zero, so we need to start this negative to try right away.
 static int gAssetServerLastConnectTryTime = -gAssetServerConnectTryInterval;
 
@@ -227,27 +401,54 @@ static int loom_asset_isOnTrackToLoad(loom_asset_t *asset)
 
 static loom_asset_t *loom_asset_getAssetByName(const char *name, int create)
 {
-    loom_mutex_lock(gAssetLock);
-    static char normalized[4096];
-    strncpy(normalized, name, sizeof(normalized));
+    char normalized[4096];
+    strncpy(normalized, name, sizeof(normalized) - 1);
+    normalized[sizeof(normalized) - 1] = 0;
     platform_normalizePath(normalized);
-    utHashedString key        = normalized;
-    loom_mutex_unlock(gAssetLock);
-    loom_asset_t   **assetPtr = gAssetHash.get(key);
-    loom_asset_t   *asset     = assetPtr ? *assetPtr : NULL;
+    utHashedString key = normalized;
+
+    loom_assetShard_t& shard = gAssetShards[key.hash() % ASSET_HASH_SHARDS];
+
+    loom_mutex_lock(shard.lock);
+
+    loom_asset_t **assetPtr = shard.assets.get(key);
+    loom_asset_t *asset     = assetPtr ? *assetPtr : NULL;
 
     if ((asset == NULL) && create)
     {
         // Create one.
         asset       = lmNew(gAssetAllocator) loom_asset_t;
         asset->name = name;
-        gAssetHash.insert(key, asset);
+        shard.assets.insert(key, asset);
     }
 
+    loom_mutex_unlock(shard.lock);
+
     return asset;
 }
 
 
+// Collects the names of all known assets, for the operations that walk them.
+static void loom_asset_getAllNames(utArray<utString>& names)
+{
+    for (int i = 0; i < ASSET_HASH_SHARDS; i++)
+    {
+        loom_assetShard_t& shard = gAssetShards[i];
+
+        loom_mutex_lock(shard.lock);
+
+        utHashTableIterator<utHashTable<utHashedString, loom_asset_t *> > assetIterator(shard.assets);
+        while (assetIterator.hasMoreElements())
+        {
+            names.push_back(assetIterator.peekNextKey().str());
+            assetIterator.next();
+        }
+
+        loom_mutex_unlock(shard.lock);
+    }
+}
+
+
 // Recognize text file types by their extension.
 static int loom_asset_textRecognizer(const char *extension)
 {
@@ -308,15 +509,22 @@ static int loom_asset_textRecognizer(const char *extension)
 
 
 // "Text" file types are just loaded directly as binary safe strings.
-void *loom_asset_textDeserializer(void *ptr, size_t size, LoomAssetCleanupCallback *dtor)
+void *loom_asset_textDeserializer(loom_assetMapping_t *mapping, LoomAssetCleanupCallback *dtor)
 {
+    // Already null terminated, so serve it in place.
+    if (mapping->terminated)
+    {
+        mapping->keep = 1;
+        return mapping->bits;
+    }
+
     // Blast the bits into the asset.
-    void *data = lmAlloc(gAssetAllocator, size + 1);
+    void *data = lmAlloc(gAssetAllocator, mapping->size + 1);
 
-    memcpy(data, ptr, size);
+    memcpy(data, mapping->bits, mapping->size);
 
     // Null terminate so we don't overrun strings.
-    *(((unsigned char *)data) + size) = 0;
+    *(((unsigned char *)data) + mapping->size) = 0;
 
     return data;
 }
@@ -337,10 +545,12 @@ static void loom_asset_binaryDtor(void *bytes)
     lmDelete(NULL, (utByteArray*)bytes);
 }
 
-static void *loom_asset_binaryDeserializer(void *ptr, size_t size, LoomAssetCleanupCallback *dtor)
+// The bytes point into the mapping; they are copied if the array is grown.
+static void *loom_asset_binaryDeserializer(loom_assetMapping_t *mapping, LoomAssetCleanupCallback *dtor)
 {
     utByteArray *bytes = lmNew(NULL) utByteArray();
-    bytes->allocateAndCopy(ptr, (int)size);
+    bytes->attach(mapping->bits, (UTsize)mapping->size);
+    mapping->keep = 1;
     *dtor = loom_asset_binaryDtor;
     return bytes;
 }
@@ -386,9 +596,17 @@ int loom_asset_queryPendingTransfers()
 
 void loom_asset_initialize(const char *rootUri)
 {
-    // Set up the lock for the mutex.
-    lmAssert(gAssetLock == NULL, "Double initialization!");
-    gAssetLock = loom_mutex_create();
+    // Set up the locks.
+    lmAssert(gAssetQueueLock == NULL, "Double initialization!");
+    gAssetQueueLock = loom_mutex_create();
+
+    for (int i = 0; i < ASSET_HASH_SHARDS; i++)
+    {
+        gAssetShards[i].lock = loom_mutex_create();
+    }
+
+    gAssetJobLock = loom_mutex_create();
+    gAssetLoadThreadsRunning = true;
 
     // Note the CWD.
     char tmpBuff[1024];
@@ -396,19 +614,22 @@ void loom_asset_initialize(const char *rootUri)
     lmLogDebug(gAssetLogGroup, "Current working directory ='%s'", tmpBuff);
 
     // And the allocator.
-    //gAssetAllocator = loom_allocator_initializeTrackerProxyAllocator(loom_allocator_getGlobalHeap());
-    gAssetAllocator = (loom_allocator_getGlobalHeap());
+    gAssetAllocator = loom_allocator_getTaggedAllocator("asset");
 
     // Clear, it might have been filled up before (for unit tests)
     gAssetLoadQueue.clear();
-    gAssetHash.clear();
+    gAssetLoadsInFlight = 0;
+    for (int i = 0; i < ASSET_HASH_SHARDS; i++)
+    {
+        gAssetShards[i].assets.clear();
+    }
 
     // Asset server connection state.
     gAssetServerSocketLock = loom_mutex_create();
 
     // And set up some default asset types.
-    loom_asset_registerType(LATText, loom_asset_textDeserializer, loom_asset_textRecognizer);
-    loom_asset_registerType(LATBinary, loom_asset_binaryDeserializer, loom_asset_binaryRecognizer);
+    loom_asset_registerMappedType(LATText, loom_asset_textDeserializer, loom_asset_textRecognizer);
+    loom_asset_registerMappedType(LATBinary, loom_asset_binaryDeserializer, loom_asset_binaryRecognizer);
 
     loom_asset_registerImageAsset();
     loom_asset_registerSoundAsset();
@@ -416,6 +637,30 @@ void loom_asset_initialize(const char *rootUri)
 
     // Listen to log and send it if we have a connection.
     loom_log_addListener(loom_asset_logListener, NULL);
+
+    // Serve out of the default archive if the app ships one.
+    if (platform_mapFileExists(LOOM_ASSET_ARCHIVE_DEFAULT))
+    {
+        loom_asset_mountArchive(LOOM_ASSET_ARCHIVE_DEFAULT);
+    }
+}
+
+
+int loom_asset_mountArchive(const char *path)
+{
+    loom_assetArchive_t *archive = loom_assetArchive_open(path);
+
+    if (!archive)
+    {
+        lmLogError(gAssetLogGroup, "Unable to mount asset archive '%s'", path);
+        return 0;
+    }
+
+    loom_mutex_lock(gAssetJobLock);
+    gAssetArchives.push_back(archive);
+    loom_mutex_unlock(gAssetJobLock);
+
+    return 1;
 }
 
 
@@ -435,18 +680,25 @@ void loom_asset_waitForConnection(int msToWait)
     gAssetServerConnectTryInterval = 3000;
 }
 
+static void loom_asset_stopLoadThreads();
+static void loom_asset_submitPushedFile(loom_asset_t *asset, int type, void *bits, int length);
+static void loom_asset_queueNotify(loom_asset_t *asset);
+static void loom_asset_deliverNotifications();
+
 // Clears the asset name cache that is built up
 // through loom_asset_lock and others
 static void loom_asset_clear()
 {
-    utHashTableIterator<utHashTable<utHashedString, loom_asset_t *> > assetIterator(gAssetHash);
-    while (assetIterator.hasMoreElements())
+    for (int i = 0; i < ASSET_HASH_SHARDS; i++)
     {
-        utHashedString key = assetIterator.peekNextKey();
-        lmDelete(NULL, assetIterator.peekNextValue());
-        assetIterator.next();
+        utHashTableIterator<utHashTable<utHashedString, loom_asset_t *> > assetIterator(gAssetShards[i].assets);
+        while (assetIterator.hasMoreElements())
+        {
+            lmDelete(NULL, assetIterator.peekNextValue());
+            assetIterator.next();
+        }
+        gAssetShards[i].assets.clear();
     }
-    gAssetHash.clear();
 }
 
 void loom_asset_shutdown()
@@ -460,16 +712,35 @@ void loom_asset_shutdown()
     }
     loom_mutex_unlock(gAssetServerSocketLock);
 
+    loom_asset_stopLoadThreads();
+
     loom_asset_flushAll();
+
+    for (UTsize i = 0; i < gAssetArchives.size(); i++)
+    {
+        loom_assetArchive_close(gAssetArchives[i]);
+    }
+    gAssetArchives.clear();
     loom_asset_clear();
+    loom_asset_clearAgentFiles();
 
     // Clear out our queues and maps.
     gAssetDeserializerMap.clear();
+    gAssetMappedDeserializerMap.clear();
     gRecognizerList.clear();
 
-    lmAssert(gAssetLock != NULL, "Shutdown without being initialized!");
-    loom_mutex_destroy(gAssetLock);
-    gAssetLock = NULL;
+    lmAssert(gAssetQueueLock != NULL, "Shutdown without being initialized!");
+    loom_mutex_destroy(gAssetQueueLock);
+    gAssetQueueLock = NULL;
+
+    for (int i = 0; i < ASSET_HASH_SHARDS; i++)
+    {
+        loom_mutex_destroy(gAssetShards[i].lock);
+        gAssetShards[i].lock = NULL;
+    }
+
+    loom_mutex_destroy(gAssetJobLock);
+    gAssetJobLock = NULL;
 }
 
 
@@ -521,18 +792,30 @@ static int loom_asset_recognizeAssetTypeFromPath(utString& path)
 
 
 // Helper to deserialize an asset, routing to the right function by type.
-static void *loom_asset_deserializeAsset(const utString &path, int type, int size, void *ptr, LoomAssetCleanupCallback *dtor)
+// mapping->keep is set if the result points into the mapping.
+static void *loom_asset_deserializeAsset(const utString &path, int type, loom_assetMapping_t *mapping, LoomAssetCleanupCallback *dtor)
 {
-    lmAssert(gAssetDeserializerMap.find(type) != UT_NPOS, "Can't deserialize asset, no deserializer was set for type %x!", type);
-    LoomAssetDeserializeCallback ladc = *gAssetDeserializerMap.get(type);
+    void *assetBits = NULL;
+
+    mapping->keep = 0;
 
-    if (ladc == NULL)
+    if (gAssetMappedDeserializerMap.find(type) != UT_NPOS)
     {
-        lmLogError(gAssetLogGroup, "Failed deserialize asset '%s', deserializer was not found for type '%x'!", path.c_str(), type);
-        return NULL;
+        assetBits = (*gAssetMappedDeserializerMap.get(type))(mapping, dtor);
     }
+    else
+    {
+        lmAssert(gAssetDeserializerMap.find(type) != UT_NPOS, "Can't deserialize asset, no deserializer was set for type %x!", type);
+        LoomAssetDeserializeCallback ladc = *gAssetDeserializerMap.get(type);
+
+        if (ladc == NULL)
+        {
+            lmLogError(gAssetLogGroup, "Failed deserialize asset '%s', deserializer was not found for type '%x'!", path.c_str(), type);
+            return NULL;
+        }
 
-   void *assetBits = ladc(ptr, size, dtor);
+        assetBits = ladc(mapping->bits, mapping->size, dtor);
+    }
 
     if (assetBits == NULL)
     {
@@ -544,6 +827,44 @@ static void *loom_asset_deserializeAsset(const utString &path, int type, int siz
 }
 
 
+// Deserializes a buffer that stays with the caller. Mapped types are handed
+// a copy instead, which mapping takes over if they keep it.
+static void *loom_asset_deserializeBuffer(const utString &path, int type, void *ptr, size_t size, LoomAssetCleanupCallback *dtor, loom_assetKeptMapping_t& mapping)
+{
+    loom_assetMapping_t buffer;
+
+    buffer.bits       = ptr;
+    buffer.size       = size;
+    buffer.terminated = 0;
+    buffer.keep       = 0;
+
+    void *copy = NULL;
+
+    if (gAssetMappedDeserializerMap.find(type) != UT_NPOS)
+    {
+        copy = lmAlloc(gAssetAllocator, size + 1);
+        memcpy(copy, ptr, size);
+        ((char *)copy)[size] = 0;
+
+        buffer.bits       = copy;
+        buffer.terminated = 1;
+    }
+
+    void *assetBits = loom_asset_deserializeAsset(path, type, &buffer, dtor);
+
+    if (copy && assetBits && buffer.keep)
+    {
+        mapping.bits = copy;
+    }
+    else if (copy)
+    {
+        lmFree(gAssetAllocator, copy);
+    }
+
+    return assetBits;
+}
+
+
 // Listener to allow the message protocol to receive and dispatch comands to
 // script (or whatever callback you want).
 class AssetProtocolCommandListener : public AssetProtocolMessageListener
@@ -581,6 +902,92 @@ void loom_asset_setCommandCallback(LoomAssetCommandCallback callback)
 }
 
 
+// Maps the file behind an asset, looking in the archives first, the last one
+// mounted wins. archive is set to the one it was found in, if any.
+static bool loom_asset_mapFile(const char *path, void **ptr, long *size, int *terminated, loom_assetArchive_t **archive)
+{
+   loom_mutex_lock(gAssetJobLock);
+   utArray<loom_assetArchive_t *> archives = gAssetArchives;
+   loom_mutex_unlock(gAssetJobLock);
+
+   for(UTsize i = archives.size(); i > 0; i--)
+   {
+      if(loom_assetArchive_map(archives[i - 1], path, ptr, size, terminated))
+      {
+         *archive = archives[i - 1];
+         return true;
+      }
+   }
+
+   // Otherwise open the file.
+   *archive = NULL;
+
+   if(!platform_mapFile(path, ptr, size))
+      return false;
+
+   *terminated = platform_isMapFileTerminated(*ptr);
+   return true;
+}
+
+
+static void loom_asset_unmapFile(loom_assetArchive_t *archive, void *ptr)
+{
+   if(archive)
+      loom_assetArchive_unmap(archive, ptr);
+   else
+      platform_unmapFile(ptr);
+}
+
+
+struct loom_assetOpenFile_t
+{
+   loom_assetArchive_t *archive;
+   void                *bits;
+};
+
+
+void *loom_asset_openFile(const char *name, const void **outBits, size_t *outSize)
+{
+   loom_assetOpenFile_t file;
+   long                 size       = 0;
+   int                  terminated = 0;
+
+   if(!loom_asset_mapFile(name, &file.bits, &size, &terminated, &file.archive))
+      return NULL;
+
+   loom_assetOpenFile_t *handle = lmNew(gAssetAllocator) loom_assetOpenFile_t(file);
+
+   *outBits = file.bits;
+   *outSize = (size_t)size;
+   return handle;
+}
+
+
+void loom_asset_closeFile(void *handle)
+{
+   loom_assetOpenFile_t *file = (loom_assetOpenFile_t *)handle;
+
+   if(!file)
+      return;
+
+   loom_asset_unmapFile(file->archive, file->bits);
+   lmDelete(gAssetAllocator, file);
+}
+
+
+// A delta transfer from the asset agent in progress, see
+// AssetProtocolHandler::sendFileManifest.
+struct loom_assetIncomingTransfer_t
+{
+    int                    id;
+    utString               path;
+    unsigned int           crc;
+    int                    chunkSize;
+    int                    chunksReceived;
+    int                    bytesReceived;
+    utArray<unsigned char> *bits;
+};
+
 // Helper to allow us to receive files from the asset agent.
 class AssetProtocolFileMessageListener : public AssetProtocolMessageListener
 {
@@ -592,10 +999,15 @@ protected:
     int        pendingFileLength;
     const char *pendingFile;
 
+    // Delta transfers in flight, and how many more files the agent has
+    // queued after them.
+    utArray<loom_assetIncomingTransfer_t *> transfers;
+    int agentPendingFiles;
+
 public:
 
     AssetProtocolFileMessageListener()
-        : pendingFile(NULL)
+        : pendingFile(NULL), agentPendingFiles(0)
     {
         pendingFileTimer = loom_startTimer();
         wipePendingData();
@@ -604,6 +1016,96 @@ public:
     ~AssetProtocolFileMessageListener()
     {
         loom_destroyTimer(pendingFileTimer);
+
+        for (UTsize i = 0; i < transfers.size(); i++)
+        {
+            deleteTransfer(transfers[i]);
+        }
+    }
+
+    void deleteTransfer(loom_assetIncomingTransfer_t *transfer)
+    {
+        lmSafeDelete(gAssetAllocator, transfer->bits);
+        lmDelete(gAssetAllocator, transfer);
+    }
+
+    loom_assetIncomingTransfer_t *findTransfer(int id)
+    {
+        for (UTsize i = 0; i < transfers.size(); i++)
+        {
+            if (transfers[i]->id == id)
+            {
+                return transfers[i];
+            }
+        }
+
+        lmLogError(gAssetLogGroup, "Got data for unknown transfer %d, ignoring it.", id);
+        return NULL;
+    }
+
+    void updatePendingFiles()
+    {
+        gPendingFiles = (int)transfers.size() + agentPendingFiles;
+        loom_asset_notifyPendingCountChange();
+    }
+
+    // Fills a new transfer with the copy of its file we have, either the last
+    // one received or the one we'd load, and hashes its chunks for the agent
+    // to compare against.
+    void readTransferBase(loom_assetIncomingTransfer_t *transfer, utArray<unsigned int>& crcs)
+    {
+        const unsigned char *base = NULL;
+        long baseLength = 0;
+
+        void *ptr = NULL;
+        int terminated;
+        loom_assetArchive_t *archive = NULL;
+
+        utArray<unsigned char> **received = gAssetAgentFiles.get(transfer->path);
+
+        if (received)
+        {
+            base       = (*received)->ptr();
+            baseLength = (long)(*received)->size();
+        }
+        else if (loom_asset_mapFile(transfer->path.c_str(), &ptr, &baseLength, &terminated, &archive))
+        {
+            base = (const unsigned char *)ptr;
+        }
+
+        for (long offset = 0; offset < baseLength; offset += transfer->chunkSize)
+        {
+            long chunkLength = baseLength - offset < transfer->chunkSize ? baseLength - offset : transfer->chunkSize;
+            crcs.push_back((unsigned int)crc32(0, base + offset, (uInt)chunkLength));
+        }
+
+        // Unchanged chunks are left as they are.
+        long sharedLength = baseLength < (long)transfer->bits->size() ? baseLength : (long)transfer->bits->size();
+        if (sharedLength > 0)
+        {
+            memcpy(transfer->bits->ptr(), base, sharedLength);
+        }
+
+        if (ptr)
+        {
+            loom_asset_unmapFile(archive, ptr);
+        }
+    }
+
+    void instateFile(const utString& path, void *bits, int length)
+    {
+        utString     typePath  = path;
+        loom_asset_t *asset    = loom_asset_getAssetByName(path.c_str(), 1);
+        int          assetType = loom_asset_recognizeAssetTypeFromPath(typePath);
+        if (assetType == 0)
+        {
+            lmLogDebug(gAssetLogGroup, "Couldn't infer file type for '%s', ignoring.", path.c_str());
+            return;
+        }
+
+        // Deserialized on the load threads, a sync can push hundreds of
+        // files at once.
+        loom_asset_submitPushedFile(asset, assetType, bits, length);
     }
 
     void wipePendingData()
@@ -704,19 +1206,8 @@ public:
                    loom_asset_notifyPendingCountChange();
 
                    // Instate the new asset data.
-                   loom_asset_t *asset    = loom_asset_getAssetByName(pendingFilePath.c_str(), 1);
-                   int          assetType = loom_asset_recognizeAssetTypeFromPath(pendingFilePath);
-                   if (assetType == 0)
-                   {
-                       lmLogDebug(gAssetLogGroup, "Couldn't infer file type for '%s', ignoring.", pendingFilePath.c_str());
-                       wipePendingData();
-                       return true;
-                   }
-
                    lmLogInfo(gAssetLogGroup, "Updated '%s', %s", pendingFilePath.c_str(), humanFileSize(pendingFileLength).c_str());
-                   LoomAssetCleanupCallback dtor = NULL;
-                   void *assetBits = loom_asset_deserializeAsset(pendingFilePath.c_str(), assetType, pendingFileLength, (void *)pendingFile, &dtor);
-                   asset->instate(assetType, assetBits, dtor);
+                   instateFile(pendingFilePath, (void *)pendingFile, pendingFileLength);
 
                    // And wipe the pending date.
                    wipePendingData();
@@ -724,45 +1215,190 @@ public:
          }
 
          return true;
-      }
 
-    return false;
-    }
-};
+        case LOOM_FOURCC('F', 'M', 'A', 'N'):
+           {
+               int id = buffer.readInt();
 
-// Service our connection to the asset agent.
-static void loom_asset_serviceServer()
-{
-    loom_mutex_lock(gAssetServerSocketLock);
+               // This file and the ones queued after it.
+               agentPendingFiles = buffer.readInt() - 1;
 
-    // Try to connect to the asset server if we aren't already, and it is set.
-    if ((gAssetServerSocket == NULL) &&
-        ((ASSET_STREAM_HOST != NULL) && (strlen(ASSET_STREAM_HOST) > 0)) &&
-        ((platform_getMilliseconds() - gAssetServerLastConnectTryTime) > gAssetServerConnectTryInterval))
-    {
-        lmLogDebug(gAssetLogGroup, "Attempting to stream assets from %s:%d", ASSET_STREAM_HOST, ASSET_STREAM_PORT);
-        gAssetServerLastConnectTryTime = platform_getMilliseconds();
-        gAssetServerSocket             = loom_net_openTCPSocket(ASSET_STREAM_HOST, ASSET_STREAM_PORT, 0);
-        gAssetConnectionOpen           = false;
-        loom_asset_notifyPendingCountChange();
+               char *path;
+               int  pathLength;
+               buffer.readString(&path, &pathLength);
 
-        loom_mutex_unlock(gAssetServerSocketLock);
-        return;
-    }
+               int          length    = buffer.readInt();
+               unsigned int crc       = (unsigned int)buffer.readInt();
+               int          chunkSize = buffer.readInt();
 
-    if ((gAssetServerSocket != NULL) && (gAssetConnectionOpen == false))
-    {
-        // We are waiting on the connection, see if it's writable... If not, return.
-        if (loom_net_isSocketWritable(gAssetServerSocket) == 0)
-        {
-            loom_mutex_unlock(gAssetServerSocketLock);
-            return;
-        }
+               buffer.readCheckpoint(0xDEADBEE4);
 
-        if (loom_net_isSocketDead(gAssetServerSocket) == 1)
-        {
-            // Might be DOA, ie, connect failed.
-            lmLogError(gAssetLogGroup, "Failed to connect to asset server %s:%d", ASSET_STREAM_HOST, ASSET_STREAM_PORT);
+               lmAssert(chunkSize > 0 && length >= 0, "Bad manifest for '%s'!", path);
+
+               loom_assetIncomingTransfer_t *transfer = lmNew(gAssetAllocator) loom_assetIncomingTransfer_t();
+               transfer->id             = id;
+               transfer->path           = path;
+               transfer->crc            = crc;
+               transfer->chunkSize      = chunkSize;
+               transfer->chunksReceived = 0;
+               transfer->bytesReceived  = 0;
+               transfer->bits           = lmNew(gAssetAllocator) utArray<unsigned char>();
+               transfer->bits->resize(length);
+
+               lmFree(NULL, path);
+
+               // Tell the agent what we have; it replies with the chunks
+               // that differ. Other manifests may arrive in the meantime.
+               utArray<unsigned int> crcs;
+               readTransferBase(transfer, crcs);
+               handler->sendFileHashes(id, (int)crcs.size(), crcs.ptr());
+
+               transfers.push_back(transfer);
+               updatePendingFiles();
+               return true;
+           }
+
+        case LOOM_FOURCC('F', 'D', 'A', 'T'):
+           {
+               int id          = buffer.readInt();
+               int chunkIndex  = buffer.readInt();
+               int flags       = buffer.readInt();
+               int chunkLength = buffer.readInt();
+               int dataLength  = buffer.readInt();
+
+               // Read the data in place.
+               const unsigned char *data = (const unsigned char *)buffer.buffer + buffer.getCurrentPosition();
+               buffer.setPosition(buffer.getCurrentPosition() + dataLength);
+
+               buffer.readCheckpoint(0xDEADBEE6);
+
+               loom_assetIncomingTransfer_t *transfer = findTransfer(id);
+               if (!transfer)
+               {
+                   return true;
+               }
+
+               long offset = (long)chunkIndex * transfer->chunkSize;
+               if ((chunkIndex < 0) || (chunkLength > transfer->chunkSize) || (offset + chunkLength > (long)transfer->bits->size()))
+               {
+                   lmLogError(gAssetLogGroup, "Chunk %d of '%s' lies outside of the file, ignoring it.", chunkIndex, transfer->path.c_str());
+                   return true;
+               }
+
+               unsigned char *chunk = transfer->bits->ptr() + offset;
+
+               if (flags & ASSET_PROTOCOL_CHUNK_COMPRESSED)
+               {
+                   uLongf inflatedLength = chunkLength;
+                   if ((uncompress(chunk, &inflatedLength, data, dataLength) != Z_OK) || (inflatedLength != (uLongf)chunkLength))
+                   {
+                       lmLogError(gAssetLogGroup, "Failed to inflate chunk %d of '%s'.", chunkIndex, transfer->path.c_str());
+                       return true;
+                   }
+               }
+               else
+               {
+                   memcpy(chunk, data, dataLength < chunkLength ? dataLength : chunkLength);
+               }
+
+               transfer->chunksReceived++;
+               transfer->bytesReceived += dataLength;
+               return true;
+           }
+
+        case LOOM_FOURCC('F', 'E', 'N', 'D'):
+           {
+               int id         = buffer.readInt();
+               int chunksSent = buffer.readInt();
+
+               buffer.readCheckpoint(0xDEADBEE7);
+
+               loom_assetIncomingTransfer_t *transfer = findTransfer(id);
+               if (!transfer)
+               {
+                   return true;
+               }
+
+               transfers.erase(transfers.find(transfer), true);
+               updatePendingFiles();
+
+               utArray<unsigned char> *bits = transfer->bits;
+               unsigned int crc = (unsigned int)crc32(0, bits->ptr(), (uInt)bits->size());
+
+               if ((chunksSent != transfer->chunksReceived) || (crc != transfer->crc))
+               {
+                   // Don't base anything else on it either.
+                   lmLogError(gAssetLogGroup, "Update of '%s' arrived damaged, ignoring it. Save it again to retry.", transfer->path.c_str());
+
+                   utArray<unsigned char> **received = gAssetAgentFiles.get(transfer->path);
+                   if (received)
+                   {
+                       lmDelete(gAssetAllocator, *received);
+                       gAssetAgentFiles.erase(transfer->path);
+                   }
+
+                   deleteTransfer(transfer);
+                   return true;
+               }
+
+               lmLogInfo(gAssetLogGroup, "Updated '%s', %s (%s sent)", transfer->path.c_str(), humanFileSize((int)bits->size()).c_str(), humanFileSize(transfer->bytesReceived).c_str());
+               instateFile(transfer->path, bits->ptr(), (int)bits->size());
+
+               // Keep it for the next transfer of the file to be based on.
+               utArray<unsigned char> **received = gAssetAgentFiles.get(transfer->path);
+               if (received)
+               {
+                   lmDelete(gAssetAllocator, *received);
+                   *received = bits;
+               }
+               else
+               {
+                   gAssetAgentFiles.insert(transfer->path, bits);
+               }
+
+               transfer->bits = NULL;
+               deleteTransfer(transfer);
+               return true;
+           }
+      }
+
+    return false;
+    }
+};
+
+// Service our connection to the asset agent.
+static void loom_asset_serviceServer()
+{
+    loom_mutex_lock(gAssetServerSocketLock);
+
+    // Try to connect to the asset server if we aren't already, and it is set.
+    if ((gAssetServerSocket == NULL) &&
+        ((ASSET_STREAM_HOST != NULL) && (strlen(ASSET_STREAM_HOST) > 0)) &&
+        ((platform_getMilliseconds() - gAssetServerLastConnectTryTime) > gAssetServerConnectTryInterval))
+    {
+        lmLogDebug(gAssetLogGroup, "Attempting to stream assets from %s:%d", ASSET_STREAM_HOST, ASSET_STREAM_PORT);
+        gAssetServerLastConnectTryTime = platform_getMilliseconds();
+        gAssetServerSocket             = loom_net_openTCPSocket(ASSET_STREAM_HOST, ASSET_STREAM_PORT, 0);
+        gAssetConnectionOpen           = false;
+        loom_asset_notifyPendingCountChange();
+
+        loom_mutex_unlock(gAssetServerSocketLock);
+        return;
+    }
+
+    if ((gAssetServerSocket != NULL) && (gAssetConnectionOpen == false))
+    {
+        // We are waiting on the connection, see if it's writable... If not, return.
+        if (loom_net_isSocketWritable(gAssetServerSocket) == 0)
+        {
+            loom_mutex_unlock(gAssetServerSocketLock);
+            return;
+        }
+
+        if (loom_net_isSocketDead(gAssetServerSocket) == 1)
+        {
+            // Might be DOA, ie, connect failed.
+            lmLogError(gAssetLogGroup, "Failed to connect to asset server %s:%d", ASSET_STREAM_HOST, ASSET_STREAM_PORT);
 
             loom_net_closeTCPSocket(gAssetServerSocket);
 
@@ -790,6 +1426,9 @@ static void loom_asset_serviceServer()
             gAssetProtocolHandler->registerListener(lmNew(NULL) AssetProtocolCommandListener());
         }
 
+        // Ask for delta transfers, older agents just log it as unknown.
+        gAssetProtocolHandler->sendDeltaHello();
+
         loom_mutex_unlock(gAssetServerSocketLock);
         return;
     }
@@ -821,13 +1460,391 @@ static void loom_asset_serviceServer()
         gAssetServerLastPingTime = platform_getMilliseconds();
     }
 
-    // Service the asset server connection.
-    gAssetProtocolHandler->process();
+    // Service the asset server connection, handling the frames that have
+    // come in up to a time budget rather than one per pump.
+    int serviceStartTime = platform_getMilliseconds();
+    while (gAssetProtocolHandler->process() &&
+           (platform_getMilliseconds() - serviceStartTime < ASSET_SERVICE_BUDGET_MS))
+    {
+    }
 
     loom_mutex_unlock(gAssetServerSocketLock);
 }
 
 
+// Maps and deserializes the file of a job, runs on the load threads.
+static void loom_asset_loadJob(loom_assetLoadJob_t& job)
+{
+   LOOM_TRACE_SCOPE(assetLoad, job.path.c_str());
+
+   if(job.pushed)
+   {
+      job.size = job.pushedSize;
+      job.bits = loom_asset_deserializeBuffer(job.path, job.type, job.pushed, job.pushedSize, &job.dtor, job.mapping);
+
+      lmFree(gAssetAllocator, job.pushed);
+      job.pushed = NULL;
+      return;
+   }
+
+   void *ptr;
+   int terminated;
+   loom_assetArchive_t *archive;
+
+   if(!loom_asset_mapFile(job.path.c_str(), &ptr, &job.size, &terminated, &archive))
+   {
+      lmLogError(gAssetLogGroup, "Could not open file '%s'.", job.path.c_str());
+      return;
+   }
+
+   // Deserialize it.
+   loom_assetMapping_t mapping;
+   mapping.bits = ptr;
+   mapping.size = job.size;
+   mapping.terminated = terminated;
+   mapping.keep = 0;
+
+   job.bits = loom_asset_deserializeAsset(job.path, job.type, &mapping, &job.dtor);
+
+   // Keep the file mapped if the asset is served out of it.
+   if(job.bits && mapping.keep)
+   {
+      if(archive)
+      {
+         job.mapping.archive = archive;
+         job.mapping.bits = ptr;
+      }
+      else
+      {
+         job.mapping.detached = platform_detachMapping(ptr);
+      }
+      return;
+   }
+
+   // Close the file.
+   loom_asset_unmapFile(archive, ptr);
+}
+
+
+static int __stdcall loom_asset_loadThreadBody(void *param)
+{
+   int slot = (int)(size_t)param;
+
+   LoomTrace::setThreadName("Asset Loading");
+
+   // Run jobs until the queue is drained, ensureLoadThreads starts us again
+   // when more come in.
+   while(true)
+   {
+      loom_mutex_lock(gAssetJobLock);
+
+      if(!gAssetLoadThreadsRunning || gAssetJobQueue.empty())
+      {
+         gAssetLoadThreadActive[slot] = false;
+         loom_mutex_unlock(gAssetJobLock);
+         break;
+      }
+
+      loom_assetLoadJob_t job = gAssetJobQueue.front();
+      gAssetJobQueue.pop_front();
+      loom_mutex_unlock(gAssetJobLock);
+
+      loom_asset_loadJob(job);
+
+      // Hand it back to the main thread to be instated by the pump.
+      loom_mutex_lock(gAssetJobLock);
+      gAssetCompleteQueue.push_back(job);
+      gAssetJobsOutstanding--;
+      gAssetBytesInFlight += job.size;
+      loom_mutex_unlock(gAssetJobLock);
+   }
+
+   return 0;
+}
+
+
+// Called with gAssetJobLock held.
+static int loom_asset_getLoadThreadCount()
+{
+   if(gAssetLoadThreadCount == 0)
+   {
+      gAssetLoadThreadCount = platform_getLogicalThreadCount() - 1;
+      if(gAssetLoadThreadCount < 1)
+         gAssetLoadThreadCount = 1;
+      if(gAssetLoadThreadCount > ASSET_MAX_LOAD_THREADS)
+         gAssetLoadThreadCount = ASSET_MAX_LOAD_THREADS;
+      lmLogDebug(gAssetLogGroup, "Loading assets on up to %d threads", gAssetLoadThreadCount);
+   }
+
+   return gAssetLoadThreadCount;
+}
+
+
+static void loom_asset_ensureLoadThreads()
+{
+   loom_mutex_lock(gAssetJobLock);
+
+   loom_asset_getLoadThreadCount();
+
+   // Start as many threads as there are jobs, running ones pick them up too.
+   int active = 0;
+   for(int i = 0; i < gAssetLoadThreadCount; i++)
+   {
+      if(gAssetLoadThreadActive[i])
+         active++;
+   }
+
+   int wanted = (int)gAssetJobQueue.size();
+   for(int i = 0; i < gAssetLoadThreadCount && active < wanted; i++)
+   {
+      if(gAssetLoadThreadActive[i])
+         continue;
+
+      // A previous thread in this slot ran out of jobs and is exiting.
+      if(gAssetLoadThreads[i] != NULL)
+         loom_thread_join(gAssetLoadThreads[i]);
+
+      gAssetLoadThreadActive[i] = true;
+      gAssetLoadThreads[i] = loom_thread_startWithHint(loom_asset_loadThreadBody, (void *)(size_t)i, LOOM_THREAD_BACKGROUND);
+      active++;
+   }
+
+   loom_mutex_unlock(gAssetJobLock);
+}
+
+
+static void loom_asset_discardJob(loom_assetLoadJob_t& job)
+{
+   if(job.pushed)
+   {
+      lmFree(gAssetAllocator, job.pushed);
+      job.pushed = NULL;
+   }
+
+   if(!job.bits)
+      return;
+
+   loom_asset_freeBits(job.bits, job.dtor, job.mapping);
+
+   job.bits = NULL;
+}
+
+
+// Hands a file pushed by the asset agent to the load threads, it's
+// instated by the pump like a load. A push still waiting for a load thread
+// has its contents replaced, so a file saved repeatedly is deserialized
+// once.
+static void loom_asset_submitPushedFile(loom_asset_t *asset, int type, void *bits, int length)
+{
+   void *copy = lmAlloc(gAssetAllocator, length);
+   memcpy(copy, bits, length);
+
+   loom_mutex_lock(asset->lock);
+
+   // Loaded assets keep serving their current bits until the new ones are
+   // instated.
+   if(asset->state != loom_asset_t::Loaded)
+      asset->state = loom_asset_t::Deserializing;
+
+   loom_mutex_unlock(asset->lock);
+
+   loom_mutex_lock(gAssetQueueLock);
+   loom_mutex_lock(gAssetJobLock);
+
+   for(utList<loom_assetLoadJob_t>::Pointer link = gAssetJobQueue.begin(); link; link = link->getNext())
+   {
+      loom_assetLoadJob_t& queued = link->getLink();
+      if(queued.asset != asset || !queued.pushed)
+         continue;
+
+      lmFree(gAssetAllocator, queued.pushed);
+      queued.pushed = copy;
+      queued.pushedSize = length;
+      queued.type = type;
+
+      loom_mutex_unlock(gAssetJobLock);
+      loom_mutex_unlock(gAssetQueueLock);
+      return;
+   }
+
+   loom_assetLoadJob_t job;
+   job.asset = asset;
+   job.path = asset->name;
+   job.type = type;
+   job.pushed = copy;
+   job.pushedSize = length;
+
+   gAssetJobQueue.push_back(job);
+   gAssetJobsOutstanding++;
+   gAssetLoadsInFlight++;
+
+   loom_mutex_unlock(gAssetJobLock);
+   loom_mutex_unlock(gAssetQueueLock);
+
+   loom_asset_ensureLoadThreads();
+}
+
+
+static void loom_asset_stopLoadThreads()
+{
+   loom_mutex_lock(gAssetJobLock);
+   gAssetLoadThreadsRunning = false;
+   loom_mutex_unlock(gAssetJobLock);
+
+   // Let the running jobs finish, their threads exit right after.
+   for(int i = 0; i < ASSET_MAX_LOAD_THREADS; i++)
+   {
+      if(gAssetLoadThreads[i] == NULL)
+         continue;
+
+      loom_thread_join(gAssetLoadThreads[i]);
+      gAssetLoadThreads[i] = NULL;
+      gAssetLoadThreadActive[i] = false;
+   }
+
+   // Nobody is waiting on what's left anymore.
+   while(!gAssetJobQueue.empty())
+   {
+      loom_asset_discardJob(gAssetJobQueue.front());
+      gAssetJobQueue.pop_front();
+   }
+
+   while(!gAssetCompleteQueue.empty())
+   {
+      loom_asset_discardJob(gAssetCompleteQueue.front());
+      gAssetCompleteQueue.pop_front();
+   }
+
+   for(UTsize i = 0; i < gAssetWaitingJobs.size(); i++)
+   {
+      loom_asset_discardJob(gAssetWaitingJobs[i]);
+   }
+   gAssetWaitingJobs.clear();
+
+   // Nor on their notifications.
+   while(!gAssetNotifyQueue.empty())
+   {
+      gAssetNotifyQueue.front()->notifyQueued = 0;
+      gAssetNotifyQueue.pop_front();
+   }
+
+   gAssetLoadsInFlight = 0;
+   gAssetJobsOutstanding = 0;
+   gAssetBytesInFlight = 0;
+}
+
+
+// Whether any dependency of asset is still on its way.
+static bool loom_asset_dependenciesPending(loom_asset_t *asset)
+{
+   loom_mutex_lock(asset->lock);
+   utArray<loom_asset_t *> dependencies = asset->dependencies;
+   loom_mutex_unlock(asset->lock);
+
+   for(UTsize i = 0; i < dependencies.size(); i++)
+   {
+      loom_asset_t *dependency = dependencies[i];
+
+      loom_mutex_lock(dependency->lock);
+      bool pending = dependency->state > loom_asset_t::Unloaded && dependency->state < loom_asset_t::Loaded;
+      loom_mutex_unlock(dependency->lock);
+
+      if(pending)
+         return true;
+   }
+
+   return false;
+}
+
+
+// Instates the result of a finished job, on the main thread. Returns false
+// if the asset has to wait for its dependencies, the job is retried later.
+static bool loom_asset_completeJob(loom_assetLoadJob_t& job)
+{
+   loom_asset_t *asset = job.asset;
+
+   bool waiting = job.bits && loom_asset_dependenciesPending(asset);
+
+   loom_mutex_lock(asset->lock);
+
+   // Flushed or canceled while it was loading, so nobody wants these bits.
+   if(asset->state == loom_asset_t::Unloaded)
+   {
+      loom_mutex_unlock(asset->lock);
+      loom_asset_discardJob(job);
+      return true;
+   }
+
+   if(!job.bits)
+   {
+     // Note it as failed.
+     asset->state = loom_asset_t::Failed;
+     loom_mutex_unlock(asset->lock);
+     return true;
+   }
+
+   if(waiting)
+   {
+      if(asset->state != loom_asset_t::Loaded)
+         asset->state = loom_asset_t::WaitingForDependencies;
+      loom_mutex_unlock(asset->lock);
+      return false;
+   }
+
+   // Instate the asset.
+   asset->instate(job.type, job.bits, job.dtor, job.mapping);
+   asset->blob->length = job.size;
+
+   loom_mutex_unlock(asset->lock);
+
+   // Subscribers are told once the pump gets to it.
+   loom_asset_queueNotify(asset);
+
+   return true;
+}
+
+
+// Queues asset at priority, or raises the priority it is already queued
+// at. Called with gAssetQueueLock held.
+static void loom_asset_enqueue(loom_asset_t *asset, int priority)
+{
+   for(UTsize i = 0; i < gAssetLoadQueue.size(); i++)
+   {
+      if(gAssetLoadQueue[i].asset != asset)
+         continue;
+
+      if(gAssetLoadQueue[i].priority >= priority)
+         return;
+
+      gAssetLoadQueue.erase(i, true);
+      break;
+   }
+
+   // Behind everything at least as urgent.
+   loom_assetQueueEntry_t entry;
+   entry.asset = asset;
+   entry.priority = priority;
+   gAssetLoadQueue.push_back(entry);
+
+   for(UTsize i = gAssetLoadQueue.size() - 1; i > 0 && gAssetLoadQueue[i - 1].priority < priority; i--)
+   {
+      gAssetLoadQueue[i] = gAssetLoadQueue[i - 1];
+      gAssetLoadQueue[i - 1] = entry;
+   }
+}
+
+
+// Whether the loader may start a load that isn't urgent. Called with
+// gAssetJobLock held.
+static bool loom_asset_hasLoadCapacity()
+{
+   if(gAssetJobsOutstanding >= loom_asset_getLoadThreadCount() * ASSET_JOBS_PER_LOAD_THREAD)
+      return false;
+
+   return gAssetLoadBudget <= 0 || gAssetBytesInFlight < gAssetLoadBudget;
+}
+
+
 void loom_asset_pump()
 {
    // Currently we only want to do this on the main thread so piggy back on the
@@ -835,99 +1852,332 @@ void loom_asset_pump()
    if(platform_getCurrentThreadId() != LS::NativeDelegate::smMainThreadID && LS::NativeDelegate::smMainThreadID != 0xBAADF00D)
       return;
 
-   loom_mutex_lock(gAssetLock);
-
    // Talk to the asset server.
    loom_asset_serviceServer();
 
-   // For now just blast all the data from each file into the asset.
-   while(gAssetLoadQueue.size())
+   // Take the queued assets, most urgent first, while the loader has room
+   // for them; urgent ones always go. They count as in flight until
+   // instated. The queue lock is never held while taking an asset lock,
+   // preload takes them the other way around.
+   utArray<loom_assetQueueEntry_t> queued;
+
+   loom_mutex_lock(gAssetQueueLock);
+   loom_mutex_lock(gAssetJobLock);
+
+   UTsize taken = 0;
+   while(taken < gAssetLoadQueue.size())
    {
-      loom_asset_t *asset = gAssetLoadQueue.front();
+      if(gAssetLoadQueue[taken].priority < LAPUrgent && !loom_asset_hasLoadCapacity())
+         break;
 
-      // Figure out the type from the path.
-      utString path = asset->name;
-      int type = loom_asset_recognizeAssetTypeFromPath(path);
-      
-      if(type == 0)
-      {
-         lmLog(gAssetLogGroup, "Could not infer type of resource '%s', skipping it...", path.c_str());
-         asset->state = loom_asset_t::Unloaded;
-         gAssetLoadQueue.erase((UTsize)0, true);
-         continue;
-      }
+      queued.push_back(gAssetLoadQueue[taken]);
+      gAssetJobsOutstanding++;
+      taken++;
+   }
 
-      // Open the file.
-      void *ptr;
-      long size;
-      if(!platform_mapFile(asset->name.c_str(), &ptr, &size))
+   loom_mutex_unlock(gAssetJobLock);
+
+   if(taken == gAssetLoadQueue.size())
+   {
+      gAssetLoadQueue.clear();
+   }
+   else if(taken > 0)
+   {
+      utArray<loom_assetQueueEntry_t> rest;
+      for(UTsize i = taken; i < gAssetLoadQueue.size(); i++)
+         rest.push_back(gAssetLoadQueue[i]);
+      gAssetLoadQueue = rest;
+   }
+
+   gAssetLoadsInFlight += (int)queued.size();
+   loom_mutex_unlock(gAssetQueueLock);
+
+   // Hand them over to the load threads.
+   if(queued.size())
+   {
+      for(UTsize i = 0; i < queued.size(); i++)
       {
-         lmAssert(false, "Could not open file '%s'.", asset->name.c_str());
+         loom_asset_t *asset = queued[i].asset;
+
+         // Figure out the type from the path.
+         loom_assetLoadJob_t job;
+         job.asset = asset;
+         job.path = asset->name;
+         job.type = loom_asset_recognizeAssetTypeFromPath(job.path);
+
+         loom_mutex_lock(asset->lock);
+
+         // Canceled since it was taken from the queue.
+         bool canceled = asset->state == loom_asset_t::Unloaded;
+
+         if(job.type == 0 && !canceled)
+         {
+            lmLog(gAssetLogGroup, "Could not infer type of resource '%s', skipping it...", job.path.c_str());
+            asset->state = loom_asset_t::Unloaded;
+         }
+
+         if(job.type == 0 || canceled)
+         {
+            loom_mutex_unlock(asset->lock);
+
+            loom_mutex_lock(gAssetQueueLock);
+            gAssetLoadsInFlight--;
+            loom_mutex_unlock(gAssetQueueLock);
+
+            loom_mutex_lock(gAssetJobLock);
+            gAssetJobsOutstanding--;
+            loom_mutex_unlock(gAssetJobLock);
+            continue;
+         }
+
+         // Reloaded assets keep serving their current bits until the new
+         // ones are instated.
+         if(asset->state != loom_asset_t::Loaded)
+            asset->state = loom_asset_t::Deserializing;
+
+         loom_mutex_unlock(asset->lock);
+
+         // Urgent loads jump the jobs already handed out.
+         loom_mutex_lock(gAssetJobLock);
+         if(queued[i].priority >= LAPUrgent)
+            gAssetJobQueue.push_front(job);
+         else
+            gAssetJobQueue.push_back(job);
+         loom_mutex_unlock(gAssetJobLock);
       }
 
-      // Deserialize it.
-      LoomAssetCleanupCallback dtor = NULL;
-      void *assetBits = loom_asset_deserializeAsset(path, type, size, ptr, &dtor);
+      loom_asset_ensureLoadThreads();
+   }
 
-      // Close the file.
-      platform_unmapFile(ptr);
+   // Instate whatever the load threads have finished.
+   int finished = 0;
 
-      if(!assetBits)
+   while(true)
+   {
+      loom_mutex_lock(gAssetJobLock);
+
+      if(gAssetCompleteQueue.empty())
       {
-        // Note it as failed.
-        asset->state = loom_asset_t::Failed;
+         loom_mutex_unlock(gAssetJobLock);
+         break;
       }
+
+      loom_assetLoadJob_t job = gAssetCompleteQueue.front();
+      gAssetCompleteQueue.pop_front();
+      gAssetBytesInFlight -= job.size;
+      loom_mutex_unlock(gAssetJobLock);
+
+      if(loom_asset_completeJob(job))
+         finished++;
       else
+         gAssetWaitingJobs.push_back(job);
+   }
+
+   // Retry the assets waiting for dependencies, each one instated may
+   // release others.
+   for(UTsize i = 0; i < gAssetWaitingJobs.size(); )
+   {
+      if(!loom_asset_completeJob(gAssetWaitingJobs[i]))
       {
-        // Instate the asset.
-        asset->instate(type, assetBits, dtor);
-        asset->blob->length = size;
+         i++;
+         continue;
       }
 
-      // Done! Update queue.
-      gAssetLoadQueue.erase((UTsize)0, true);
+      gAssetWaitingJobs.erase(i, true);
+      finished++;
+      i = 0;
+   }
+
+   if(finished)
+   {
+      loom_mutex_lock(gAssetQueueLock);
+      gAssetLoadsInFlight -= finished;
+      loom_mutex_unlock(gAssetQueueLock);
    }
 
-   loom_mutex_unlock(gAssetLock);
+   // Everything instated above, and whatever the budget left over from
+   // previous pumps, is told in one go.
+   loom_asset_deliverNotifications();
 }
 
 
 void loom_asset_preload(const char *name)
 {
-    loom_mutex_lock(gAssetLock);
+    loom_asset_preloadWithPriority(name, LAPNormal);
+}
+
 
+void loom_asset_preloadWithPriority(const char *name, int priority)
+{
     // Look 'er up.
     loom_asset_t *asset = loom_asset_getAssetByName(name, 1);
 
-    // If it's not pending load, then stick it in the queue.
-    if (loom_asset_isOnTrackToLoad(asset))
+    loom_mutex_lock(asset->lock);
+
+    loom_mutex_lock(gAssetQueueLock);
+
+    // If it's not pending load, then stick it in the queue. Otherwise it may
+    // still be waiting there, at a lower priority.
+    if (!loom_asset_isOnTrackToLoad(asset))
+    {
+        asset->state = loom_asset_t::QueuedForDownload;
+        loom_asset_enqueue(asset, priority);
+    }
+    else if (asset->state == loom_asset_t::QueuedForDownload)
+    {
+        loom_asset_enqueue(asset, priority);
+    }
+
+    loom_mutex_unlock(gAssetQueueLock);
+
+    utArray<loom_asset_t *> dependencies = asset->dependencies;
+
+    loom_mutex_unlock(asset->lock);
+
+    // Bring the dependencies along, they can't be circular.
+    for (UTsize i = 0; i < dependencies.size(); i++)
+    {
+        loom_asset_preloadWithPriority(dependencies[i]->name.c_str(), priority);
+    }
+}
+
+
+void loom_asset_cancel(const char *name)
+{
+    loom_asset_t *asset = loom_asset_getAssetByName(name, 0);
+
+    if (!asset)
     {
-        loom_mutex_unlock(gAssetLock);
         return;
     }
 
-    asset->state = loom_asset_t::QueuedForDownload;
-    gAssetLoadQueue.push_back(asset);
+    loom_mutex_lock(asset->lock);
+
+    if (!loom_asset_isOnTrackToLoad(asset) || (asset->state == loom_asset_t::Loaded))
+    {
+        loom_mutex_unlock(asset->lock);
+        return;
+    }
+
+    lmLogDebug(gAssetLogGroup, "Canceling '%s'", name);
+
+    // A job already running is discarded once it completes.
+    asset->state = loom_asset_t::Unloaded;
+
+    // Take it out of the queues it hasn't left yet.
+    loom_mutex_lock(gAssetQueueLock);
+
+    for (UTsize i = 0; i < gAssetLoadQueue.size(); i++)
+    {
+        if (gAssetLoadQueue[i].asset == asset)
+        {
+            gAssetLoadQueue.erase(i, true);
+            break;
+        }
+    }
+
+    loom_mutex_lock(gAssetJobLock);
+
+    utList<loom_assetLoadJob_t>::Pointer link = gAssetJobQueue.begin();
+    while (link)
+    {
+        utList<loom_assetLoadJob_t>::Pointer next = link->getNext();
+
+        if (link->getLink().asset == asset)
+        {
+            loom_asset_discardJob(link->getLink());
+            gAssetJobQueue.erase(link);
+            gAssetJobsOutstanding--;
+            gAssetLoadsInFlight--;
+        }
+
+        link = next;
+    }
+
+    loom_mutex_unlock(gAssetJobLock);
+    loom_mutex_unlock(gAssetQueueLock);
+
+    loom_mutex_unlock(asset->lock);
+}
+
+
+// Whether to depends on from, directly or through other dependencies.
+static bool loom_asset_dependsOn(loom_asset_t *from, loom_asset_t *to)
+{
+    if (from == to)
+    {
+        return true;
+    }
+
+    loom_mutex_lock(from->lock);
+    utArray<loom_asset_t *> dependencies = from->dependencies;
+    loom_mutex_unlock(from->lock);
+
+    for (UTsize i = 0; i < dependencies.size(); i++)
+    {
+        if (loom_asset_dependsOn(dependencies[i], to))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+int loom_asset_addDependency(const char *name, const char *dependency)
+{
+    loom_asset_t *asset = loom_asset_getAssetByName(name, 1);
+    loom_asset_t *needed = loom_asset_getAssetByName(dependency, 1);
+
+    if (loom_asset_dependsOn(needed, asset))
+    {
+        lmLogError(gAssetLogGroup, "'%s' can't depend on '%s', which already depends on it", name, dependency);
+        return 0;
+    }
+
+    loom_mutex_lock(asset->lock);
+
+    if (asset->dependencies.find(needed) == UT_NPOS)
+    {
+        asset->dependencies.push_back(needed);
+    }
+
+    bool onTrack = loom_asset_isOnTrackToLoad(asset) && asset->state != loom_asset_t::Loaded;
+
+    loom_mutex_unlock(asset->lock);
 
-    loom_mutex_unlock(gAssetLock);
+    // Already on its way, so the dependency has to follow.
+    if (onTrack)
+    {
+        loom_asset_preload(dependency);
+    }
+
+    return 1;
+}
+
+
+void loom_asset_setLoadBudget(int bytesInFlight)
+{
+    loom_mutex_lock(gAssetJobLock);
+    gAssetLoadBudget = bytesInFlight;
+    loom_mutex_unlock(gAssetJobLock);
 }
 
 int loom_asset_pending(const char *name)
 {
-    loom_mutex_lock(gAssetLock);
-    
     // Look 'er up.
     loom_asset_t *asset = loom_asset_getAssetByName(name, 0);
-    
-    // If it's not pending load, then stick it in the queue.
-    int result;
-    if(asset && loom_asset_isOnTrackToLoad(asset))
-        result = 1;
-    else
-        result = 0;
-    
-    loom_mutex_unlock(gAssetLock);
-    
+
+    if (!asset)
+    {
+        return 0;
+    }
+
+    loom_mutex_lock(asset->lock);
+    int result = loom_asset_isOnTrackToLoad(asset);
+    loom_mutex_unlock(asset->lock);
+
     return result;
 }
 
@@ -939,14 +2189,19 @@ void loom_asset_flush(const char *name)
       && LS::NativeDelegate::smMainThreadID != 0xBAADF00D)
       return;
 
-   loom_mutex_lock(gAssetLock);
-
     // Delete it + unload it.
     loom_asset_t *asset = loom_asset_getAssetByName(name, 0);
 
-   if(!asset || asset->isSupplied)
+   if(!asset)
    {
-      loom_mutex_unlock(gAssetLock);
+      return;
+   }
+
+   loom_mutex_lock(asset->lock);
+
+   if(asset->isSupplied)
+   {
+      loom_mutex_unlock(asset->lock);
       return;
    }
     
@@ -960,49 +2215,59 @@ void loom_asset_flush(const char *name)
 
     asset->state = loom_asset_t::Unloaded;
 
+    loom_mutex_unlock(asset->lock);
+
     // Fire subscribers.
     if(!gShuttingDown)
         loom_asset_notifySubscribers(asset->name.c_str());
-
-    loom_mutex_unlock(gAssetLock);
 }
 
 
 void loom_asset_flushAll()
 {
-    // Call flush on everything in the hash.
-    utHashTableIterator<utHashTable<utHashedString, loom_asset_t *> > assetIterator(gAssetHash);
-    while (assetIterator.hasMoreElements())
+    // Call flush on everything in the table.
+    utArray<utString> names;
+    loom_asset_getAllNames(names);
+
+    for (UTsize i = 0; i < names.size(); i++)
     {
-        utHashedString key = assetIterator.peekNextKey();
-        loom_asset_flush(key.str().c_str());
-        assetIterator.next();
+        loom_asset_flush(names[i].c_str());
     }
 }
 
 
 int loom_asset_queryPendingLoads()
 {
-    return gAssetLoadQueue.size() > 0 ? 1 : 0;
+    loom_mutex_lock(gAssetQueueLock);
+    int result = (gAssetLoadQueue.size() > 0 || gAssetLoadsInFlight > 0) ? 1 : 0;
+    loom_mutex_unlock(gAssetQueueLock);
+
+    // Not done until the subscribers know.
+    if (!gAssetNotifyQueue.empty())
+    {
+        result = 1;
+    }
+
+    return result;
 }
 
 
 float loom_asset_checkLoadedPercentage(const char *name)
 {
-    loom_mutex_lock(gAssetLock);
-
     // Look it up.
     loom_asset_t *asset = loom_asset_getAssetByName(name, 0);
 
-    loom_mutex_unlock(gAssetLock);
-
     if (!asset)
     {
         return 0.f;
     }
 
+    loom_mutex_lock(asset->lock);
+    bool loaded = asset->state == loom_asset_t::Loaded;
+    loom_mutex_unlock(asset->lock);
+
     // If loaded, return 1, else 0. (For now.)
-    return asset->state == loom_asset_t::Loaded ? 1.f : 0.2f;
+    return loaded ? 1.f : 0.2f;
 }
 
 void loom_asset_unlock( const char *name )
@@ -1012,8 +2277,6 @@ void loom_asset_unlock( const char *name )
    //loom_allocator_getTrackerProxyStats(gAssetAllocator, &allocBytes, &allocCount);
    //lmLogError(gAssetLogGroup, "Seeing %d bytes of allocator and %d allocations", allocBytes, allocCount);
 
-   loom_mutex_lock(gAssetLock);
-
    // TODO: This needs to be against the blob we locked NOT the asset's
    //       current state.
 
@@ -1024,6 +2287,8 @@ void loom_asset_unlock( const char *name )
    lmAssert(asset, "Could not find asset '%s' to unlock!", name);
    //lmAssert(asset->blob, "Asset was not locked!");
 
+   loom_mutex_lock(asset->lock);
+
    if(asset->state == loom_asset_t::Loaded)
    {
       // Dec count.
@@ -1039,24 +2304,24 @@ void loom_asset_unlock( const char *name )
       lmLogWarn(gAssetLogGroup, "Couldn't unlock '%s' as it was not loaded.", name);
    }
 
-   loom_mutex_unlock(gAssetLock);
+   loom_mutex_unlock(asset->lock);
 }
 
 void *loom_asset_lock(const char *name, unsigned int type, int block)
 {
     const char *namePtr = stringtable_insert(name);
 
-    loom_mutex_lock(gAssetLock);
-
     // Look it up.
     loom_asset_t *asset = loom_asset_getAssetByName(namePtr, 1);
     lmAssert(asset != NULL, "Didn't get asset even though we should have!");
 
+    loom_mutex_lock(asset->lock);
+
     // If not loaded, and we aren't ready to block, return NULL.
     if ((block == 0) && (asset->state != loom_asset_t::Loaded))
     {
         lmLogDebug(gAssetLogGroup, "Unable to lock without blocking, not loaded yet: '%s'", namePtr);
-        loom_mutex_unlock(gAssetLock);
+        loom_mutex_unlock(asset->lock);
         return NULL;
     }
 
@@ -1065,22 +2330,31 @@ void *loom_asset_lock(const char *name, unsigned int type, int block)
     // Otherwise, let's force it to load now.
     if (!preloaded)
     {
+        // The pump instates the asset under its lock, so let go meanwhile.
+        loom_mutex_unlock(asset->lock);
+
         lmLogDebug(gAssetLogGroup, "Loading '%s'", namePtr);
 
-        loom_asset_preload(namePtr);
+        loom_asset_preloadWithPriority(namePtr, LAPUrgent);
+
+        lmAssert(loom_asset_pending(namePtr), "Preloaded but wasn't on track to load!");
 
-        lmAssert(loom_asset_isOnTrackToLoad(asset), "Preloaded but wasn't on track to load!");
+        lmLogDebug(gAssetLogGroup, "Pumping load of '%s'", namePtr);
 
-        while (loom_asset_checkLoadedPercentage(namePtr) != 1.f && loom_asset_isOnTrackToLoad(asset))
+        while (loom_asset_checkLoadedPercentage(namePtr) != 1.f && loom_asset_pending(namePtr))
         {
-            lmLogDebug(gAssetLogGroup, "Pumping load of '%s'", namePtr);
             loom_asset_pump();
+
+            // Give the load threads a chance to finish it.
+            loom_thread_yield();
         }
 
+        loom_mutex_lock(asset->lock);
+
         if (asset->state != loom_asset_t::Loaded)
         {
             lmLogError(gAssetLogGroup, "Failed to load asset '%s'!", name);
-            loom_mutex_unlock(gAssetLock);
+            loom_mutex_unlock(asset->lock);
             return NULL;
         }
     }
@@ -1089,14 +2363,15 @@ void *loom_asset_lock(const char *name, unsigned int type, int block)
     if (asset->type != type)
     {
         lmLogError(gAssetLogGroup, "Tried to lock asset '%s' with wrong type, assetType=%x, requestedType=%x", name, asset->type, type);
-        loom_mutex_unlock(gAssetLock);
+        loom_mutex_unlock(asset->lock);
         return NULL;
     }
 
     // Inc count.
-    asset->blob->incRef();
+    loom_assetBlob_t *blob = asset->blob;
+    blob->incRef();
 
-    loom_mutex_unlock(gAssetLock);
+    loom_mutex_unlock(asset->lock);
 
     if (preloaded)
     {
@@ -1104,76 +2379,133 @@ void *loom_asset_lock(const char *name, unsigned int type, int block)
     }
     else
     {
-        lmLogInfo(gAssetLogGroup, "Loaded '%s', %s", namePtr, humanFileSize(asset->blob->length).c_str());
+        lmLogInfo(gAssetLogGroup, "Loaded '%s', %s", namePtr, humanFileSize(blob->length).c_str());
     }
 
-    // Return ptr.
-    return asset->blob->bits;
+    // Return ptr, the blob stays alive until we're unlocked.
+    return blob->bits;
 }
 
 int loom_asset_subscribe(const char *name, LoomAssetChangeCallback cb, void *payload, int doFirstCall)
 {
-    loom_mutex_lock(gAssetLock);
-
     loom_asset_t *asset = loom_asset_getAssetByName(name, 1);
 
     if (!asset)
     {
-        loom_mutex_unlock(gAssetLock);
         return 0;
     }
 
+    loom_mutex_lock(asset->lock);
+
     // Add to list of subscribers.
     loom_asset_subscription_t subscription;
     subscription.callback = cb;
     subscription.payload  = payload;
     asset->subscribers.push_back(subscription);
 
+    bool loaded = asset->state == loom_asset_t::Loaded;
+
+    loom_mutex_unlock(asset->lock);
+
     // If it is loaded and we want it, do the first call.
-    if (doFirstCall && (asset->state == loom_asset_t::Loaded))
+    if (doFirstCall && loaded)
     {
         cb(payload, name);
     }
 
-    loom_mutex_unlock(gAssetLock);
     return 1;
 }
 
 
-void loom_asset_notifySubscribers(const char *name)
+static void loom_asset_fireSubscribers(loom_asset_t *asset)
 {
-    loom_mutex_lock(gAssetLock);
+    // Told now, a queued notification has nothing left to say.
+    asset->notifyQueued = 0;
+
+    // Call a copy of the subscribers without holding the asset lock, they
+    // are free to lock other assets or (un)subscribe.
+    loom_mutex_lock(asset->lock);
+    utArray<loom_asset_subscription_t> subscribers = asset->subscribers;
+    loom_mutex_unlock(asset->lock);
 
+    for (UTsize i = 0; i < subscribers.size(); i++)
+    {
+        loom_asset_subscription_t& s = subscribers[i];
+        s.callback(s.payload, asset->name.c_str());
+    }
+}
+
+
+void loom_asset_notifySubscribers(const char *name)
+{
     loom_asset_t *asset = loom_asset_getAssetByName(name, 0);
 
     if (!asset)
     {
-        loom_mutex_unlock(gAssetLock);
         return;
     }
 
-    for (UTsize i = 0; i < asset->subscribers.size(); i++)
+    loom_asset_fireSubscribers(asset);
+}
+
+
+static void loom_asset_queueNotify(loom_asset_t *asset)
+{
+    if (asset->notifyQueued)
     {
-        loom_asset_subscription_t& s = asset->subscribers[i];
-        s.callback(s.payload, name);
+        return;
     }
 
-    loom_mutex_unlock(gAssetLock);
+    asset->notifyQueued = 1;
+    gAssetNotifyQueue.push_back(asset);
 }
 
 
-int loom_asset_unsubscribe(const char *name, LoomAssetChangeCallback cb, void *payload)
+// Tells the subscribers of queued assets until the budget runs out, at
+// least one per pump so the queue always drains. Subscribers may pump
+// themselves, so each asset is taken off before it's handled.
+static void loom_asset_deliverNotifications()
+{
+    int startTime = platform_getMilliseconds();
+
+    while (!gAssetNotifyQueue.empty())
+    {
+        loom_asset_t *asset = gAssetNotifyQueue.front();
+        gAssetNotifyQueue.pop_front();
+
+        // Told directly since it was queued.
+        if (!asset->notifyQueued)
+        {
+            continue;
+        }
+
+        loom_asset_fireSubscribers(asset);
+
+        if ((gAssetNotifyBudget > 0) && (platform_getMilliseconds() - startTime >= gAssetNotifyBudget))
+        {
+            break;
+        }
+    }
+}
+
+
+void loom_asset_setNotifyBudget(int milliseconds)
 {
-    loom_mutex_lock(gAssetLock);
+    gAssetNotifyBudget = milliseconds;
+}
 
+
+int loom_asset_unsubscribe(const char *name, LoomAssetChangeCallback cb, void *payload)
+{
     loom_asset_t *asset = loom_asset_getAssetByName(name, 0);
 
     if (!asset)
     {
-        loom_mutex_unlock(gAssetLock);
         return 0;
     }
 
+    loom_mutex_lock(asset->lock);
+
     // Remove from list of subscribers.
     for (UTsize i = 0; i < asset->subscribers.size(); i++)
     {
@@ -1189,56 +2521,73 @@ int loom_asset_unsubscribe(const char *name, LoomAssetChangeCallback cb, void *p
         }
 
         asset->subscribers.erase(i, true);
-        loom_mutex_unlock(gAssetLock);
+        loom_mutex_unlock(asset->lock);
         return 1;
     }
 
-    loom_mutex_unlock(gAssetLock);
+    loom_mutex_unlock(asset->lock);
     return 0;
 }
 
 
 void loom_asset_registerType(unsigned int type, LoomAssetDeserializeCallback deserializer, LoomAssetRecognizerCallback recognizer)
 {
-    lmAssert(gAssetDeserializerMap.find(type) == UT_NPOS, "Asset type already registered!");
+    lmAssert(gAssetDeserializerMap.find(type) == UT_NPOS && gAssetMappedDeserializerMap.find(type) == UT_NPOS, "Asset type already registered!");
 
     gAssetDeserializerMap.insert(type, deserializer);
     gRecognizerList.push_back(recognizer);
 }
 
 
-void loom_asset_reload(const char *name)
+void loom_asset_registerMappedType(unsigned int type, LoomAssetMappedDeserializeCallback deserializer, LoomAssetRecognizerCallback recognizer)
 {
-    loom_mutex_lock(gAssetLock);
+    lmAssert(gAssetDeserializerMap.find(type) == UT_NPOS && gAssetMappedDeserializerMap.find(type) == UT_NPOS, "Asset type already registered!");
 
+    gAssetMappedDeserializerMap.insert(type, deserializer);
+    gRecognizerList.push_back(recognizer);
+}
+
+
+void loom_asset_reload(const char *name)
+{
     loom_asset_t *asset = loom_asset_getAssetByName(name, 1);
 
+    loom_mutex_lock(asset->lock);
+
+    // Loaded assets keep their bits until the new ones are instated.
+    if (!loom_asset_isOnTrackToLoad(asset))
+    {
+        asset->state = loom_asset_t::QueuedForDownload;
+    }
+
     // Put it in the queue, this will trigger a new blob to be loaded.
-    gAssetLoadQueue.push_back(asset);
+    loom_mutex_lock(gAssetQueueLock);
+    loom_asset_enqueue(asset, LAPNormal);
+    loom_mutex_unlock(gAssetQueueLock);
 
-    loom_mutex_unlock(gAssetLock);
+    loom_mutex_unlock(asset->lock);
 }
 
 
 void loom_asset_reloadAll()
 {
-    // Call reload on everything in the hash.
-    utHashTableIterator<utHashTable<utHashedString, loom_asset_t *> > assetIterator(gAssetHash);
-    while (assetIterator.hasMoreElements())
+    // Call reload on everything in the table.
+    utArray<utString> names;
+    loom_asset_getAllNames(names);
+
+    for (UTsize i = 0; i < names.size(); i++)
     {
-        utHashedString key = assetIterator.peekNextKey();
-        loom_asset_reload(key.str().c_str());
-        assetIterator.next();
+        loom_asset_reload(names[i].c_str());
     }
 }
 
 void loom_asset_supply(const char *name, void *bits, int length)
 {
-    loom_mutex_lock(gAssetLock);
-
     // Prep the asset.
     loom_asset_t *asset = loom_asset_getAssetByName(name, 1);
 
+    loom_mutex_lock(asset->lock);
+
     // Make sure it's pristine.
     lmAssert(asset->state == loom_asset_t::Unloaded, "Can't supply an asset that's already queued or in process of loading. Supply assets before you make any asset requests!");
 
@@ -1250,19 +2599,24 @@ void loom_asset_supply(const char *name, void *bits, int length)
     {
         lmLog(gAssetLogGroup, "Could not infer type of supplied resource '%s', skipping it...", name);
         asset->state = loom_asset_t::Unloaded;
+        loom_mutex_unlock(asset->lock);
         return;
     }
 
     // Deserialize it.
     LoomAssetCleanupCallback dtor = NULL;
-    void *assetBits = loom_asset_deserializeAsset(name, type, length, bits, &dtor);
+    loom_assetKeptMapping_t mapping;
+    void *assetBits = loom_asset_deserializeBuffer(nameAsUt, type, bits, length, &dtor, mapping);
 
     // Instate the asset.
     // TODO: We can save some memory by pointing directly and not making a copy.
-    asset->instate(type, assetBits, dtor);
+    asset->instate(type, assetBits, dtor, mapping);
 
     // Note it's supplied so we don't flush it.
     asset->isSupplied = 1;
 
-    loom_mutex_unlock(gAssetLock);
+    loom_mutex_unlock(asset->lock);
+
+    // Fire subscribers.
+    loom_asset_notifySubscribers(name);
 }
@@ -64,6 +64,27 @@ extern "C" {
 *       loom_asset_unlock(name);
 *    }
 *
+* Preloaded files are read and deserialized on background threads, and
+* instated by loom_asset_pump() on the main thread, which is also where
+* subscribers are called.
+*
+* PRIORITIES AND DEPENDENCIES
+*
+* Preloads are loaded most urgent first. Background preloads, such as the
+* next screen's assets, only go out while the loader has spare capacity
+* (see loom_asset_setLoadBudget), urgent ones always go straight away:
+*
+*    loom_asset_preloadWithPriority("level2.jpg", LAPBackground);
+*
+* An asset can declare the assets it needs, for instance a scene manifest
+* listing its textures and sounds. Preloading it preloads them at the same
+* priority, and it is only instated once they have loaded:
+*
+*    loom_asset_addDependency("level2.json", "level2.jpg");
+*
+* Use loom_asset_cancel("level2.jpg") to drop a preload that isn't needed
+* anymore.
+*
 * WAITING ON ASSETS
 *
 * If you want to wait until all pending assets are loaded, you can ask the
@@ -84,6 +105,12 @@ extern "C" {
 * loom_asset_reload("foo.jpg") or loom_asset_reloadAll() to force assets to be
 * reloaded from their source files.
 *
+* Files pushed by the asset agent are deserialized on the load threads like
+* any other load. Subscribers of loaded and pushed assets are told by the
+* pump, once per asset however often it changed in between, and only for as
+* long per pump as loom_asset_setNotifyBudget allows. The rest are told on
+* the following pumps, so a sync of hundreds of files doesn't stall a frame.
+*
 * CUSTOM ASSET TYPES
 *
 * assetImage.c is a good example for adding your own asset types. Simply call
@@ -91,6 +118,11 @@ extern "C" {
 * callback to deserialize the asset, and a function that can tell what fourcc
 * corresponds to a given extension, and the asset manager will handle your asset!
 *
+* Types whose loaded form can point into the file, such as text or already
+* decoded data, can be registered with loom_asset_registerMappedType()
+* instead. Their deserializer may keep the mapped file rather than copying
+* it, see loom_assetMapping_t.
+*
 ************************************************************************/
 
 // Assorted built-in asset types, for convenience.
@@ -116,6 +148,27 @@ typedef void *(*LoomAssetDeserializeCallback)(void *buffer, size_t bufferLen, Lo
 typedef int (*LoomAssetRecognizerCallback)(const char *extension);
 void loom_asset_registerType(unsigned int type, LoomAssetDeserializeCallback deserializer, LoomAssetRecognizerCallback recognizer);
 
+// The file data handed to a LoomAssetMappedDeserializeCallback.
+typedef struct loom_assetMapping
+{
+    void   *bits;
+    size_t size;
+
+    // Set if bits[size] is a readable NUL, so text can be used in place.
+    int    terminated;
+
+    // Set by the deserializer if what it returns points into bits. The data
+    // then stays mapped until the asset's cleanup callback has run, rather
+    // than being unmapped right after deserializing. A kept asset without a
+    // cleanup callback is taken to be bits itself, and isn't freed.
+    int    keep;
+} loom_assetMapping_t;
+
+// Like loom_asset_registerType, but the deserializer may serve the asset
+// straight out of the mapped file instead of copying it.
+typedef void *(*LoomAssetMappedDeserializeCallback)(loom_assetMapping_t *mapping, LoomAssetCleanupCallback *dtor);
+void loom_asset_registerMappedType(unsigned int type, LoomAssetMappedDeserializeCallback deserializer, LoomAssetRecognizerCallback recognizer);
+
 // This is called when the asset agent sends us commands.
 typedef void (*LoomAssetCommandCallback)(const char *command);
 void loom_asset_setCommandCallback(LoomAssetCommandCallback callback);
@@ -123,7 +176,35 @@ void loom_asset_setCommandCallback(LoomAssetCommandCallback callback);
 // Send an arbitrary custom buffer through the asset protocol
 void loom_asset_custom(void *buffer, int length);
 
+// Load priorities, from least to most urgent.
+enum LoomAssetPriority
+{
+    LAPBackground = 0,
+    LAPNormal     = 1,
+    LAPUrgent     = 2
+};
+
+// Serve assets out of the packed archive at path (see assetArchive.h),
+// ahead of loose files. Returns 1 if it was mounted.
+int loom_asset_mountArchive(const char *path);
+
 void loom_asset_preload(const char *name);
+void loom_asset_preloadWithPriority(const char *name, int priority);
+
+// Drop a pending preload of name; its dependencies are left alone.
+void loom_asset_cancel(const char *name);
+
+// name needs dependency loaded before it is instated. Returns 0 if that
+// would make the dependencies circular.
+int loom_asset_addDependency(const char *name, const char *dependency);
+
+// Bytes read by loads that aren't instated yet beyond which only urgent
+// loads are started, 0 for no limit.
+void loom_asset_setLoadBudget(int bytesInFlight);
+
+// Milliseconds per pump spent calling subscribers of changed assets, at
+// least one asset is always handled. 0 for no limit.
+void loom_asset_setNotifyBudget(int milliseconds);
 
 void loom_asset_flush(const char *name);
 void loom_asset_flushAll();
@@ -145,12 +226,19 @@ int loom_asset_pending(const char *name); // 1 if the asset is loading.
 // Supply an asset's raw bits. Useful for embedding assets in your binary.
 void loom_asset_supply(const char *name, void *bits, int length);
 
+// Map the file behind an asset without loading it, for data which is read a
+// piece at a time such as streamed music. Looks in the mounted archives
+// first, like a load. Returns a handle for loom_asset_closeFile, NULL if the
+// file isn't found. The bits are read only and valid until closed.
+void *loom_asset_openFile(const char *name, const void **outBits, size_t *outSize);
+void loom_asset_closeFile(void *handle);
+
 typedef void (*LoomAssetChangeCallback)(void *payload, const char *name);
 int loom_asset_subscribe(const char *name, LoomAssetChangeCallback cb, void *payload, int doFirstUpdate);
 void loom_asset_notifySubscribers(const char *name);
 int loom_asset_unsubscribe(const char *name, LoomAssetChangeCallback cb, void *payload);
 
-void *loom_asset_textDeserializer(void *ptr, size_t size, LoomAssetCleanupCallback *dtor);
+void *loom_asset_textDeserializer(loom_assetMapping_t *mapping, LoomAssetCleanupCallback *dtor);
 
 #ifdef __cplusplus
 };
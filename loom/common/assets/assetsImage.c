@@ -34,9 +34,19 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_PREMULTIPLY_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define IMAGE_PREMULTIPLY_NEON 1
+#include <arm_neon.h>
+#endif
+
 extern loom_allocator_t *gAssetAllocator;
 static loom_logGroup_t gImageAssetGroup = { "asset.img", 1 };
 
+static int gPremultiplyImages = 0;
+
 int exifinfo_parse_orientation(const unsigned char *buf, unsigned len);
 
 void loom_asset_registerImageAsset()
@@ -79,30 +89,430 @@ int loom_asset_identifyImage(const char *extension)
     {
         return LATImage;
     }
+    if (!stricmp(extension, "ktx"))
+    {
+        return LATImage;
+    }
+    if (!stricmp(extension, "pvr"))
+    {
+        return LATImage;
+    }
+    if (!stricmp(extension, "dds"))
+    {
+        return LATImage;
+    }
+    return 0;
+}
+
+size_t loom_asset_imageCompressedSize(int format, int width, int height)
+{
+    // Block dimensions of the ASTC formats, in GL enum order
+    static const int astcBlocks[][2] = {
+        { 4, 4 }, { 5, 4 }, { 5, 5 }, { 6, 5 }, { 6, 6 }, { 8, 5 }, { 8, 6 },
+        { 8, 8 }, { 10, 5 }, { 10, 6 }, { 10, 8 }, { 10, 10 }, { 12, 10 }, { 12, 12 }
+    };
+
+    switch (format)
+    {
+        case IMAGE_COMPRESSED_DXT1:
+        case IMAGE_COMPRESSED_ETC1:
+        case IMAGE_COMPRESSED_ETC2_RGB:
+        case IMAGE_COMPRESSED_ETC2_RGB_A1:
+            return (size_t)((width + 3) / 4) * ((height + 3) / 4) * 8;
+
+        case IMAGE_COMPRESSED_DXT3:
+        case IMAGE_COMPRESSED_DXT5:
+        case IMAGE_COMPRESSED_ETC2_RGBA:
+            return (size_t)((width + 3) / 4) * ((height + 3) / 4) * 16;
+
+        case IMAGE_COMPRESSED_PVRTC_RGB_4BPP:
+        case IMAGE_COMPRESSED_PVRTC_RGBA_4BPP:
+            return (size_t)(width > 8 ? width : 8) * (height > 8 ? height : 8) / 2;
+
+        case IMAGE_COMPRESSED_PVRTC_RGB_2BPP:
+        case IMAGE_COMPRESSED_PVRTC_RGBA_2BPP:
+            return (size_t)(width > 16 ? width : 16) * (height > 8 ? height : 8) / 4;
+    }
+
+    if (format >= IMAGE_COMPRESSED_ASTC_4x4 && format <= IMAGE_COMPRESSED_ASTC_12x12)
+    {
+        const int *block = astcBlocks[format - IMAGE_COMPRESSED_ASTC_4x4];
+        return (size_t)((width + block[0] - 1) / block[0]) * ((height + block[1] - 1) / block[1]) * 16;
+    }
+
     return 0;
 }
 
+static unsigned int image_readU32(const unsigned char *p)
+{
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+// Copies the levels found by one of the container parsers below into the
+// image, levelOffset holds where each of them starts in the buffer
+static int image_storeCompressedLevels(loom_asset_image_t *img, const unsigned char *buffer, const size_t *levelOffset)
+{
+    size_t total = 0;
+    unsigned char *bits;
+    int i;
+
+    for (i = 0; i < img->levelCount; i++)
+        total += img->levelSize[i];
+
+    bits = (unsigned char*)lmAlloc(gAssetAllocator, total);
+    if (!bits)
+        return 0;
+
+    img->bits = bits;
+    for (i = 0; i < img->levelCount; i++)
+    {
+        memcpy(bits, buffer + levelOffset[i], img->levelSize[i]);
+        bits += img->levelSize[i];
+    }
+
+    return 1;
+}
+
+// Fills in the levels of formats that are stored back to back without sizes
+static int image_computeCompressedLevels(loom_asset_image_t *img, size_t dataOffset, size_t bufferLen, size_t *levelOffset)
+{
+    int i;
+    int width = img->width;
+    int height = img->height;
+
+    for (i = 0; i < img->levelCount; i++)
+    {
+        levelOffset[i] = dataOffset;
+        img->levelSize[i] = loom_asset_imageCompressedSize(img->compressedFormat, width, height);
+        dataOffset += img->levelSize[i];
+
+        if (img->levelSize[i] == 0 || dataOffset > bufferLen)
+            return 0;
+
+        width = width > 1 ? width >> 1 : 1;
+        height = height > 1 ? height >> 1 : 1;
+    }
+
+    return 1;
+}
+
+static int image_parseKTX(loom_asset_image_t *img, const unsigned char *buffer, size_t bufferLen)
+{
+    size_t offset;
+    size_t levelOffset[IMAGE_MAX_LEVELS];
+    int i;
+
+    if (bufferLen < 64)
+        return 0;
+
+    if (image_readU32(buffer + 12) != 0x04030201)
+    {
+        lmLogError(gImageAssetGroup, "Big endian KTX files are not supported");
+        return 0;
+    }
+
+    // Only compressed 2D textures, glType and glFormat are 0 for those
+    if (image_readU32(buffer + 16) != 0 || image_readU32(buffer + 24) != 0)
+    {
+        lmLogError(gImageAssetGroup, "Uncompressed KTX files are not supported");
+        return 0;
+    }
+
+    if (image_readU32(buffer + 44) > 1 || image_readU32(buffer + 48) > 0 || image_readU32(buffer + 52) != 1)
+    {
+        lmLogError(gImageAssetGroup, "KTX 3D, array and cubemap textures are not supported");
+        return 0;
+    }
+
+    img->compressedFormat = (int)image_readU32(buffer + 28);
+    img->width = (int)image_readU32(buffer + 36);
+    img->height = (int)image_readU32(buffer + 40);
+    img->levelCount = (int)image_readU32(buffer + 56);
+    if (img->levelCount == 0)
+        img->levelCount = 1;
+    if (img->levelCount > IMAGE_MAX_LEVELS)
+        return 0;
+
+    offset = 64 + image_readU32(buffer + 60);
+    for (i = 0; i < img->levelCount; i++)
+    {
+        if (offset + 4 > bufferLen)
+            return 0;
+
+        img->levelSize[i] = image_readU32(buffer + offset);
+        levelOffset[i] = offset + 4;
+
+        // Levels are padded to four bytes
+        offset += 4 + ((img->levelSize[i] + 3) & ~(size_t)3);
+        if (levelOffset[i] + img->levelSize[i] > bufferLen)
+            return 0;
+    }
+
+    return image_storeCompressedLevels(img, buffer, levelOffset);
+}
+
+static int image_parsePVR(loom_asset_image_t *img, const unsigned char *buffer, size_t bufferLen)
+{
+    size_t levelOffset[IMAGE_MAX_LEVELS];
+    unsigned int format;
+
+    if (bufferLen < 52)
+        return 0;
+
+    // The upper half of the pixel format is only set for uncompressed formats
+    if (image_readU32(buffer + 12) != 0)
+    {
+        lmLogError(gImageAssetGroup, "Uncompressed PVR files are not supported");
+        return 0;
+    }
+
+    if (image_readU32(buffer + 32) != 1 || image_readU32(buffer + 36) != 1 || image_readU32(buffer + 40) != 1)
+    {
+        lmLogError(gImageAssetGroup, "PVR 3D, array and cubemap textures are not supported");
+        return 0;
+    }
+
+    format = image_readU32(buffer + 8);
+    switch (format)
+    {
+        case 0: img->compressedFormat = IMAGE_COMPRESSED_PVRTC_RGB_2BPP; break;
+        case 1: img->compressedFormat = IMAGE_COMPRESSED_PVRTC_RGBA_2BPP; break;
+        case 2: img->compressedFormat = IMAGE_COMPRESSED_PVRTC_RGB_4BPP; break;
+        case 3: img->compressedFormat = IMAGE_COMPRESSED_PVRTC_RGBA_4BPP; break;
+        case 6: img->compressedFormat = IMAGE_COMPRESSED_ETC1; break;
+        case 7: img->compressedFormat = IMAGE_COMPRESSED_DXT1; break;
+        case 9: img->compressedFormat = IMAGE_COMPRESSED_DXT3; break;
+        case 11: img->compressedFormat = IMAGE_COMPRESSED_DXT5; break;
+        case 22: img->compressedFormat = IMAGE_COMPRESSED_ETC2_RGB; break;
+        case 23: img->compressedFormat = IMAGE_COMPRESSED_ETC2_RGBA; break;
+        case 24: img->compressedFormat = IMAGE_COMPRESSED_ETC2_RGB_A1; break;
+        default:
+            // ASTC 4x4 to 12x12 are numbered in the same order as in GL
+            if (format >= 27 && format <= 40)
+            {
+                img->compressedFormat = IMAGE_COMPRESSED_ASTC_4x4 + (format - 27);
+                break;
+            }
+            lmLogError(gImageAssetGroup, "Unsupported PVR pixel format %d", format);
+            return 0;
+    }
+
+    img->height = (int)image_readU32(buffer + 24);
+    img->width = (int)image_readU32(buffer + 28);
+    img->levelCount = (int)image_readU32(buffer + 44);
+    if (img->levelCount == 0)
+        img->levelCount = 1;
+    if (img->levelCount > IMAGE_MAX_LEVELS)
+        return 0;
+
+    if (!image_computeCompressedLevels(img, 52 + image_readU32(buffer + 48), bufferLen, levelOffset))
+        return 0;
+
+    return image_storeCompressedLevels(img, buffer, levelOffset);
+}
+
+static int image_parseDDS(loom_asset_image_t *img, const unsigned char *buffer, size_t bufferLen)
+{
+    size_t levelOffset[IMAGE_MAX_LEVELS];
+
+    if (bufferLen < 128 || image_readU32(buffer + 4) != 124)
+        return 0;
+
+    if (!memcmp(buffer + 84, "DXT1", 4))
+        img->compressedFormat = IMAGE_COMPRESSED_DXT1;
+    else if (!memcmp(buffer + 84, "DXT3", 4))
+        img->compressedFormat = IMAGE_COMPRESSED_DXT3;
+    else if (!memcmp(buffer + 84, "DXT5", 4))
+        img->compressedFormat = IMAGE_COMPRESSED_DXT5;
+    else
+    {
+        lmLogError(gImageAssetGroup, "Unsupported DDS pixel format, only DXT1, DXT3 and DXT5 can be loaded");
+        return 0;
+    }
+
+    img->height = (int)image_readU32(buffer + 12);
+    img->width = (int)image_readU32(buffer + 16);
+
+    // The mipmap count is only valid with DDSD_MIPMAPCOUNT set
+    img->levelCount = (image_readU32(buffer + 8) & 0x20000) ? (int)image_readU32(buffer + 28) : 1;
+    if (img->levelCount == 0)
+        img->levelCount = 1;
+    if (img->levelCount > IMAGE_MAX_LEVELS)
+        return 0;
+
+    if (!image_computeCompressedLevels(img, 128, bufferLen, levelOffset))
+        return 0;
+
+    return image_storeCompressedLevels(img, buffer, levelOffset);
+}
+
+// Returns 1 if the buffer is a compressed texture container, the image is
+// filled in if it could be parsed
+static int image_loadCompressed(loom_asset_image_t *img, const unsigned char *buffer, size_t bufferLen, int *loaded)
+{
+    static const unsigned char ktxIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+    if (bufferLen >= 12 && !memcmp(buffer, ktxIdentifier, 12))
+        *loaded = image_parseKTX(img, buffer, bufferLen);
+    else if (bufferLen >= 4 && image_readU32(buffer) == 0x03525650)
+        *loaded = image_parsePVR(img, buffer, bufferLen);
+    else if (bufferLen >= 4 && !memcmp(buffer, "DDS ", 4))
+        *loaded = image_parseDDS(img, buffer, bufferLen);
+    else
+        return 0;
+
+    return 1;
+}
+
 void loom_asset_imageDtor(void *bits)
 {
     loom_asset_image_t *img = (loom_asset_image_t*)bits;
-    stbi_image_free(img->bits);
+    if (img->compressedFormat != IMAGE_COMPRESSED_NONE)
+        lmFree(gAssetAllocator, img->bits);
+    else
+        stbi_image_free(img->bits);
     lmFree(gAssetAllocator, bits);
 }
 
 void *loom_asset_imageDeserializer( void *buffer, size_t bufferLen, LoomAssetCleanupCallback *dtor )
+{
+   loom_asset_image_t *img = (loom_asset_image_t*)loom_asset_imageDeserializeScaled(buffer, bufferLen, 0, dtor);
+
+   // Done here so it happens on the threads decoding the image
+   if (img && gPremultiplyImages && img->compressedFormat == IMAGE_COMPRESSED_NONE)
+   {
+      loom_asset_imagePremultiply(img->bits, (size_t)img->width * img->height);
+      img->premultiplied = 1;
+   }
+
+   return img;
+}
+
+void loom_asset_imageSetPremultiply(int enabled)
+{
+   gPremultiplyImages = enabled;
+}
+
+int loom_asset_imageGetPremultiply()
+{
+   return gPremultiplyImages;
+}
+
+// x * a / 255, rounded
+static unsigned char premultiplyChannel(unsigned int x, unsigned int a)
+{
+   unsigned int t = x * a + 128;
+   return (unsigned char)((t + (t >> 8)) >> 8);
+}
+
+void loom_asset_imagePremultiply(void *rgba, size_t pixels)
+{
+   unsigned char *p = (unsigned char *)rgba;
+   size_t i = 0;
+
+#if IMAGE_PREMULTIPLY_SSE2
+   {
+      // Alpha is multiplied by 255, which leaves it as it is
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i colorMask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+      const __m128i alphaOne = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+      const __m128i half = _mm_set1_epi16(128);
+      for (; i + 4 <= pixels; i += 4)
+      {
+         __m128i px = _mm_loadu_si128((const __m128i *)(p + i * 4));
+         __m128i lo = _mm_unpacklo_epi8(px, zero);
+         __m128i hi = _mm_unpackhi_epi8(px, zero);
+         __m128i alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+         __m128i ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+         alo = _mm_or_si128(_mm_and_si128(alo, colorMask), alphaOne);
+         ahi = _mm_or_si128(_mm_and_si128(ahi, colorMask), alphaOne);
+         lo = _mm_add_epi16(_mm_mullo_epi16(lo, alo), half);
+         hi = _mm_add_epi16(_mm_mullo_epi16(hi, ahi), half);
+         lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+         hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+         _mm_storeu_si128((__m128i *)(p + i * 4), _mm_packus_epi16(lo, hi));
+      }
+   }
+#elif IMAGE_PREMULTIPLY_NEON
+   for (; i + 8 <= pixels; i += 8)
+   {
+      uint8x8x4_t px = vld4_u8(p + i * 4);
+      int c;
+      for (c = 0; c < 3; c++)
+      {
+         uint16x8_t t = vmull_u8(px.val[c], px.val[3]);
+         px.val[c] = vrshrn_n_u16(vrsraq_n_u16(t, t, 8), 8);
+      }
+      vst4_u8(p + i * 4, px);
+   }
+#endif
+
+   for (; i < pixels; i++)
+   {
+      unsigned char *px = p + i * 4;
+      unsigned int a = px[3];
+      px[0] = premultiplyChannel(px[0], a);
+      px[1] = premultiplyChannel(px[1], a);
+      px[2] = premultiplyChannel(px[2], a);
+   }
+}
+
+void loom_asset_imageUnpremultiply(void *rgba, size_t pixels)
+{
+   unsigned char *p = (unsigned char *)rgba;
+   size_t i;
+   int c;
+
+   for (i = 0; i < pixels; i++)
+   {
+      unsigned char *px = p + i * 4;
+      unsigned int a = px[3];
+      if (a == 0 || a == 255)
+         continue;
+
+      for (c = 0; c < 3; c++)
+      {
+         unsigned int x = (px[c] * 255 + a / 2) / a;
+         px[c] = (unsigned char)(x > 255 ? 255 : x);
+      }
+   }
+}
+
+void *loom_asset_imageDeserializeScaled( void *buffer, size_t bufferLen, int scaleShift, LoomAssetCleanupCallback *dtor )
 {
    loom_asset_image_t *img;
+   int compressedLoaded = 0;
 
    lmAssert(buffer != NULL, "buffer should not be null");
 
    img = (loom_asset_image_t*)lmAlloc(gAssetAllocator, sizeof(loom_asset_image_t));
+   memset(img, 0, sizeof(loom_asset_image_t));
+
+   *dtor = loom_asset_imageDtor;
+
+   // Compressed containers are kept as they are for uploading straight to the GPU
+   if (image_loadCompressed(img, (const unsigned char *)buffer, bufferLen, &compressedLoaded))
+   {
+      if (!compressedLoaded || !img->bits)
+      {
+         lmLogError(gImageAssetGroup, "Compressed image load failed, the file is truncated or of an unsupported kind");
+         lmFree(gAssetAllocator, img);
+         return 0;
+      }
+
+      lmLogDebug(gImageAssetGroup, "Compressed image 0x%x, %dx%d with %d levels", img->compressedFormat, img->width, img->height, img->levelCount);
+      return img;
+   }
 
     // parse any orientation info from exif format
    img->orientation = exifinfo_parse_orientation(buffer, (unsigned int)bufferLen);
 
-   img->bits = stbi_load_from_memory((const stbi_uc *)buffer, (int)bufferLen, &img->width, &img->height, &img->bpp, 4);
-   
-   *dtor = loom_asset_imageDtor;
+   if (scaleShift > 0)
+      img->bits = stbi_jpeg_load_from_memory_scaled((const stbi_uc *)buffer, (int)bufferLen, &img->width, &img->height, &img->bpp, 4, scaleShift);
+   if (!img->bits)
+      img->bits = stbi_load_from_memory((const stbi_uc *)buffer, (int)bufferLen, &img->width, &img->height, &img->bpp, 4);
+   img->levelCount = 1;
+   img->levelSize[0] = (size_t)img->width * img->height * 4;
    
    if(!img->bits)
    {
@@ -35,6 +35,25 @@ extern "C" {
 #define IMAGE_ORIENTATION_UPPER_RIGHT 6
 #define IMAGE_ORIENTATION_LOWER_LEFT 8
 
+// GPU compressed formats loaded from KTX, PVR and DDS containers, the
+// values match the GL internal formats they are uploaded as
+#define IMAGE_COMPRESSED_NONE                 0
+#define IMAGE_COMPRESSED_DXT1                 0x83F1
+#define IMAGE_COMPRESSED_DXT3                 0x83F2
+#define IMAGE_COMPRESSED_DXT5                 0x83F3
+#define IMAGE_COMPRESSED_PVRTC_RGB_4BPP       0x8C00
+#define IMAGE_COMPRESSED_PVRTC_RGB_2BPP       0x8C01
+#define IMAGE_COMPRESSED_PVRTC_RGBA_4BPP      0x8C02
+#define IMAGE_COMPRESSED_PVRTC_RGBA_2BPP      0x8C03
+#define IMAGE_COMPRESSED_ETC1                 0x8D64
+#define IMAGE_COMPRESSED_ETC2_RGB             0x9274
+#define IMAGE_COMPRESSED_ETC2_RGB_A1          0x9276
+#define IMAGE_COMPRESSED_ETC2_RGBA            0x9278
+#define IMAGE_COMPRESSED_ASTC_4x4             0x93B0
+#define IMAGE_COMPRESSED_ASTC_12x12           0x93BD
+
+#define IMAGE_MAX_LEVELS 16
+
 typedef struct loom_asset_image
 {
     int  width, height, bpp;
@@ -44,12 +63,38 @@ typedef struct loom_asset_image
 
     void *bits;
 
+    // IMAGE_COMPRESSED_NONE for 32bpp RGBA bits, otherwise bits holds
+    // levelCount mipmap levels of this format back to back
+    int compressedFormat;
+    int levelCount;
+    size_t levelSize[IMAGE_MAX_LEVELS];
+
+    // Set when the color channels of uncompressed bits were multiplied by alpha
+    int premultiplied;
+
 } loom_asset_image_t;
 
 void loom_asset_registerImageAsset();
 int loom_asset_identifyImage(const char *path);
 void *loom_asset_imageDeserializer(void *buffer, size_t bufferLen, LoomAssetCleanupCallback *dtor);
 
+// Like loom_asset_imageDeserializer, but decodes JPEGs at 1 / 2^scaleShift
+// of their size, scaleShift up to 3, without decoding the full image first
+void *loom_asset_imageDeserializeScaled(void *buffer, size_t bufferLen, int scaleShift, LoomAssetCleanupCallback *dtor);
+
+// Size in bytes of a width x height level of a compressed format, 0 if the format is unknown
+size_t loom_asset_imageCompressedSize(int format, int width, int height);
+
+// When enabled, the uncompressed images loom_asset_imageDeserializer
+// decodes from then on have their color multiplied by their alpha
+void loom_asset_imageSetPremultiply(int enabled);
+int loom_asset_imageGetPremultiply();
+
+// Multiplies the color of pixels RGBA pixels by their alpha, and divides
+// it back out, which loses the precision alpha took away
+void loom_asset_imagePremultiply(void *rgba, size_t pixels);
+void loom_asset_imageUnpremultiply(void *rgba, size_t pixels);
+
 #ifdef __cplusplus
 };
 #endif
@@ -35,7 +35,7 @@ static loom_logGroup_t gScriptAssetGroup = { "scriptAsset", 1 };
 
 void loom_asset_registerScriptAsset()
 {
-   loom_asset_registerType(LATScript, loom_asset_scriptDeserializer, loom_asset_identifyScript);
+   loom_asset_registerMappedType(LATScript, loom_asset_scriptDeserializer, loom_asset_identifyScript);
 }
 
 
@@ -48,11 +48,18 @@ int loom_asset_identifyScript(const char *extension)
     return 0;
 }
 
-void *loom_asset_scriptDeserializer( void *buffer, size_t bufferLen, LoomAssetCleanupCallback *dtor )
+static void loom_asset_scriptDtor(void *bits)
+{
+   lmFree(gAssetAllocator, bits);
+}
+
+// Assemblies are only read, so they are served straight out of the mapping.
+void *loom_asset_scriptDeserializer( loom_assetMapping_t *mapping, LoomAssetCleanupCallback *dtor )
 {
    loom_asset_script_t *script = (loom_asset_script_t *) lmAlloc(gAssetAllocator, sizeof(loom_asset_script_t));
-   script->bits = (void*) lmAlloc(gAssetAllocator, bufferLen);
-   memcpy(script->bits, buffer, bufferLen);
-   script->length = bufferLen;
+   script->bits = mapping->bits;
+   script->length = mapping->size;
+   mapping->keep = 1;
+   *dtor = loom_asset_scriptDtor;
    return script;
 }
@@ -30,12 +30,13 @@
 #include "minimp3.h"
 #include "wavloader.h"
 
-extern "C" loom_allocator_t *gAssetAllocator;
+static loom_allocator_t *gSoundAssetAllocator = NULL;
 loom_logGroup_t gSoundAssetGroup = { "asset.sound", 1 };
 
 void loom_asset_registerSoundAsset()
 {
-   loom_asset_registerType(LATSound, loom_asset_soundDeserializer, loom_asset_identifySound);
+   gSoundAssetAllocator = loom_allocator_getTaggedAllocator("asset.sound");
+   loom_asset_registerMappedType(LATSound, loom_asset_soundDeserializer, loom_asset_identifySound);
 }
 
 
@@ -63,112 +64,24 @@ void loom_asset_soundDtor(void *bits)
     if (sound != NULL)
     {
         if (sound->buffer != NULL)
-            lmFree(gAssetAllocator, sound->buffer);
-        lmFree(gAssetAllocator, bits);
+            lmFree(gSoundAssetAllocator, sound->buffer);
+        lmFree(gSoundAssetAllocator, bits);
     }
 }
 
-void *loom_asset_soundDeserializer( void *buffer, size_t bufferLen, LoomAssetCleanupCallback *dtor )
+void *loom_asset_soundDeserializer(loom_assetMapping_t *mapping, LoomAssetCleanupCallback *dtor)
 {
-    loom_asset_sound_t *sound = (loom_asset_sound_t*)lmAlloc(gAssetAllocator, sizeof(loom_asset_sound_t));
+    loom_asset_sound_t *sound = (loom_asset_sound_t*)lmAlloc(gSoundAssetAllocator, sizeof(loom_asset_sound_t));
     memset(sound, 0, sizeof(loom_asset_sound_t));
-    unsigned char *charBuff = (unsigned char *)buffer;
+    unsigned char *charBuff = (unsigned char *)mapping->bits;
+    size_t bufferLen = mapping->size;
 
     // Look for magic header in buffer.
-    if(charBuff[0] == 0x4f 
-        && charBuff[1] == 0x67
-        && charBuff[2] == 0x67
-        && charBuff[3] == 0x53)
-    {
-        // It's an Ogg, assume vorbis and throw it to stb_vorbis.
-        int channels = 0;
-        short *outputBuffer = NULL;
-        int sampleCount = stb_vorbis_decode_memory(charBuff, (int)bufferLen, &channels, &outputBuffer);
-        if(sampleCount < 0)
-        {
-            lmLogError(gSoundAssetGroup, "Failed to decode Ogg Vorbis");
-            loom_asset_soundDtor(&sound);
-            return NULL;
-        }
-
-        sound->channels = channels;
-        sound->bytesPerSample = 2;
-        sound->sampleCount = sampleCount;
-        sound->bufferSize = sampleCount * channels * 2;
-        sound->sampleRate = 44100; // TODO: This should be variable
-
-        // We can skip this if we get clever about allocations in stbv.
-        sound->buffer = lmAlloc(gAssetAllocator, sound->bufferSize);
-        memcpy(sound->buffer, outputBuffer, sound->bufferSize);
-
-        free(outputBuffer);
-    }
-    else if((charBuff[0] == 0x49 // ID3
-        &&   charBuff[1] == 0x44
-        &&   charBuff[2] == 0x33)
-        ||  (charBuff[0] == 0xff // Missing ID3 Tag
-        &&   charBuff[1] == 0xfb))
-    {
-        // It's an MP3, y'all!
-        short *outBuffer = (short*)lmAlloc(gAssetAllocator, MP3_MAX_SAMPLES_PER_FRAME * 2);
-        mp3_info_t mp3Info;
-
-        // Decode once to get total size.
-        size_t totalBytes = 0;
-        size_t bytesRead = 0, bytesLeft = bufferLen;
-
-        mp3_decoder_t decmp3 = mp3_create();
-        for(;;)
-        {
-            int bytesDecoded = mp3_decode(decmp3, charBuff + bytesRead, (int)bytesLeft, outBuffer, &mp3Info);
-            bytesRead += bytesDecoded;
-            bytesLeft -= bytesDecoded;
-            totalBytes += mp3Info.audio_bytes;
-            if(bytesDecoded > 0)
-                continue;
-
-            // Clean up.
-            mp3_done(decmp3);
-            break;
-        }
-
-        // Great, set up the sound asset.
-        // TODO: Warn about non 44.1khz mp3s.
-        sound->channels = mp3Info.channels;
-        sound->bytesPerSample = 2;
-        sound->sampleCount = (int)totalBytes / sound->bytesPerSample;
-        sound->bufferSize = sound->channels * sound->bytesPerSample * sound->sampleCount;
-        sound->sampleRate = 44100; // TODO: This should be variable
-        sound->buffer = lmAlloc(gAssetAllocator, sound->bufferSize);
-
-        // Decode again to get real samples.        
-        decmp3 = mp3_create();
-        bytesRead = 0; bytesLeft = bufferLen;
-        int curBufferOffset = 0;
-        for(;;)
-        {
-            int bytesDecoded = mp3_decode(decmp3, charBuff + bytesRead, (int)bytesLeft, outBuffer, &mp3Info);
-            bytesRead += bytesDecoded;
-            bytesLeft -= bytesDecoded;
-
-            memcpy(((unsigned char*)sound->buffer) + curBufferOffset, outBuffer, mp3Info.audio_bytes);
-            curBufferOffset += mp3Info.audio_bytes;
-
-            if(bytesDecoded > 0)
-                continue;
-
-            // Clean up.
-            mp3_done(decmp3);
-            break;
-        }
-
-        // Awesome, all set!
-        lmFree(gAssetAllocator, outBuffer);
-    }
-    else if(charBuff[0] == 0x52 // 'RIFF'
-         && charBuff[1] == 0x49
-         && charBuff[2] == 0x46
-         && charBuff[3] == 0x46)
+    if(bufferLen >= 4
+        && charBuff[0] == 0x52 // 'RIFF'
+        && charBuff[1] == 0x49
+        && charBuff[2] == 0x46
+        && charBuff[3] == 0x46)
     {
         // We've got a wav file
         wav_info wav;
@@ -192,7 +105,7 @@ void *loom_asset_soundDeserializer( void *buffer, size_t bufferLen, LoomAssetCle
         sound->sampleCount = sound->bufferSize / sound->bytesPerSample;
         sound->sampleRate = wav.samplesPerSecond;
         
-        sound->buffer = lmAlloc(gAssetAllocator, sound->bufferSize);
+        sound->buffer = lmAlloc(gSoundAssetAllocator, sound->bufferSize);
         bool dataCopySuccess = load_wav(charBuff, bufferLen, (uint8_t*)sound->buffer, NULL);
         if (!dataCopySuccess)
         {
@@ -200,22 +113,301 @@ void *loom_asset_soundDeserializer( void *buffer, size_t bufferLen, LoomAssetCle
             loom_asset_soundDtor(sound);
             return 0;
         }
+
+        lmLogDebug(gSoundAssetGroup, "Sound allocation: %d bytes", sound->bufferSize);
     }
     else
     {
-        lmLogError(gSoundAssetGroup, "Failed to identify sound buffer by magic number!");
-        loom_asset_soundDtor(sound);
-        return 0;
-    }
+        // Ogg Vorbis and MP3 stay compressed in the mapped file, they are
+        // decoded when played. Opening a stream checks the data and reads
+        // the format.
+        loom_asset_soundStream_t *stream = loom_asset_soundStream_open(charBuff, bufferLen);
+        if (!stream)
+        {
+            loom_asset_soundDtor(sound);
+            return 0;
+        }
 
-   *dtor = loom_asset_soundDtor;
-   if(!sound->buffer)
-   {
-      lmLogError(gSoundAssetGroup, "Sound load failed due to this cryptic reason: %s", "(unknown)");
-      lmFree(gAssetAllocator, sound);
-      return 0;
-   }
+        sound->channels = stream->channels;
+        sound->bytesPerSample = stream->bytesPerSample;
+        sound->sampleRate = stream->sampleRate;
+        sound->encoded = charBuff;
+        sound->encodedSize = (int)bufferLen;
 
-    lmLogDebug(gSoundAssetGroup, "Sound allocation: %d bytes", sound->bufferSize);
+        loom_asset_soundStream_close(stream);
+
+        mapping->keep = 1;
+    }
+
+    *dtor = loom_asset_soundDtor;
     return sound;
 }
+
+void *loom_asset_soundDecode(loom_asset_sound_t *sound, int *outSize)
+{
+    if (!sound->encoded)
+    {
+        *outSize = sound->bufferSize;
+        return sound->buffer;
+    }
+
+    loom_asset_soundStream_t *stream = loom_asset_soundStream_open(sound->encoded, sound->encodedSize);
+    if (!stream)
+    {
+        *outSize = 0;
+        return NULL;
+    }
+
+    // Decode it in a single pass, growing the buffer as it fills. Typical
+    // bitrates inflate about ten times.
+    int capacity = sound->encodedSize * 8 + MP3_MAX_SAMPLES_PER_FRAME * 2;
+    int size = 0;
+    unsigned char *pcm = (unsigned char *)lmAlloc(gSoundAssetAllocator, capacity);
+
+    for (;;)
+    {
+        if (capacity - size < MP3_MAX_SAMPLES_PER_FRAME * 2)
+        {
+            capacity *= 2;
+            pcm = (unsigned char *)lmRealloc(gSoundAssetAllocator, pcm, capacity);
+        }
+
+        int bytesDecoded = loom_asset_soundStream_read(stream, pcm + size, capacity - size);
+        if (bytesDecoded == 0)
+        {
+            break;
+        }
+
+        size += bytesDecoded;
+    }
+
+    loom_asset_soundStream_close(stream);
+
+    if (!size)
+    {
+        lmLogError(gSoundAssetGroup, "Sound decoded to nothing");
+        lmFree(gSoundAssetAllocator, pcm);
+        *outSize = 0;
+        return NULL;
+    }
+
+    *outSize = size;
+    return pcm;
+}
+
+void loom_asset_soundReleaseDecoded(loom_asset_sound_t *sound, void *pcm)
+{
+    if (pcm && pcm != sound->buffer)
+    {
+        lmFree(gSoundAssetAllocator, pcm);
+    }
+}
+
+enum
+{
+    SoundStreamVorbis,
+    SoundStreamMP3,
+    SoundStreamWav
+};
+
+// Decodes the next MP3 frame into pending, false at the end of the data.
+static bool loom_asset_soundStream_decodeFrame(loom_asset_soundStream_t *stream)
+{
+    mp3_info_t mp3Info;
+
+    while (stream->position < stream->dataSize)
+    {
+        int bytesDecoded = mp3_decode((mp3_decoder_t)stream->decoder, (void *)(stream->data + stream->position),
+                                      (int)(stream->dataSize - stream->position), (short *)stream->pending, &mp3Info);
+        if (bytesDecoded <= 0)
+        {
+            break;
+        }
+
+        stream->position += bytesDecoded;
+
+        if (mp3Info.audio_bytes > 0)
+        {
+            stream->channels      = mp3Info.channels;
+            stream->sampleRate    = mp3Info.sample_rate;
+            stream->pendingSize   = mp3Info.audio_bytes;
+            stream->pendingOffset = 0;
+            return true;
+        }
+    }
+
+    stream->position = stream->dataSize;
+    return false;
+}
+
+loom_asset_soundStream_t *loom_asset_soundStream_open(const void *data, size_t dataSize)
+{
+    const unsigned char *charBuff = (const unsigned char *)data;
+
+    if (dataSize < 4)
+    {
+        lmLogError(gSoundAssetGroup, "Failed to identify sound stream by magic number!");
+        return NULL;
+    }
+
+    loom_asset_soundStream_t *stream = (loom_asset_soundStream_t *)lmAlloc(gSoundAssetAllocator, sizeof(loom_asset_soundStream_t));
+    memset(stream, 0, sizeof(loom_asset_soundStream_t));
+
+    stream->data           = charBuff;
+    stream->dataSize       = dataSize;
+    stream->bytesPerSample = 2;
+
+    // Same magic numbers as loom_asset_soundDeserializer.
+    if (charBuff[0] == 0x4f && charBuff[1] == 0x67 && charBuff[2] == 0x67 && charBuff[3] == 0x53)
+    {
+        int error = 0;
+        stb_vorbis *vorbis = stb_vorbis_open_memory((unsigned char *)charBuff, (int)dataSize, &error, NULL);
+        if (!vorbis)
+        {
+            lmLogError(gSoundAssetGroup, "Failed to open Ogg Vorbis stream (%d)", error);
+            loom_asset_soundStream_close(stream);
+            return NULL;
+        }
+
+        stb_vorbis_info info = stb_vorbis_get_info(vorbis);
+
+        stream->format     = SoundStreamVorbis;
+        stream->decoder    = vorbis;
+        stream->channels   = info.channels;
+        stream->sampleRate = info.sample_rate;
+    }
+    else if ((charBuff[0] == 0x49 && charBuff[1] == 0x44 && charBuff[2] == 0x33) ||
+             (charBuff[0] == 0xff && charBuff[1] == 0xfb))
+    {
+        stream->format  = SoundStreamMP3;
+        stream->decoder = mp3_create();
+        stream->pending = (unsigned char *)lmAlloc(gSoundAssetAllocator, MP3_MAX_SAMPLES_PER_FRAME * 2);
+
+        // Decode the first frame up front for the format.
+        if (!loom_asset_soundStream_decodeFrame(stream))
+        {
+            lmLogError(gSoundAssetGroup, "Failed to decode MP3 stream");
+            loom_asset_soundStream_close(stream);
+            return NULL;
+        }
+    }
+    else if (charBuff[0] == 0x52 && charBuff[1] == 0x49 && charBuff[2] == 0x46 && charBuff[3] == 0x46)
+    {
+        // Wav is PCM already, so it is simply copied out as it is read.
+        wav_info wav;
+        if (!load_wav(charBuff, (int32_t)dataSize, NULL, &wav) || (wav.sampleSize != 8 && wav.sampleSize != 16))
+        {
+            lmLogError(gSoundAssetGroup, "Unsupported wav format. Currently only 8-bit or 16-bit PCM are supported");
+            loom_asset_soundStream_close(stream);
+            return NULL;
+        }
+
+        stream->format         = SoundStreamWav;
+        stream->channels       = wav.numChannels;
+        stream->bytesPerSample = wav.sampleSize / 8;
+        stream->sampleRate     = wav.samplesPerSecond;
+        stream->pendingSize    = wav.sampleDataSize;
+        stream->pending        = (unsigned char *)lmAlloc(gSoundAssetAllocator, stream->pendingSize);
+
+        if (!load_wav(charBuff, (int32_t)dataSize, stream->pending, NULL))
+        {
+            lmLogError(gSoundAssetGroup, "Failed to copy wav data");
+            loom_asset_soundStream_close(stream);
+            return NULL;
+        }
+    }
+    else
+    {
+        lmLogError(gSoundAssetGroup, "Failed to identify sound stream by magic number!");
+        loom_asset_soundStream_close(stream);
+        return NULL;
+    }
+
+    return stream;
+}
+
+int loom_asset_soundStream_read(loom_asset_soundStream_t *stream, void *buffer, int bufferSize)
+{
+    unsigned char *out = (unsigned char *)buffer;
+
+    // Only ever hand out whole sample frames.
+    int frameSize = stream->channels * stream->bytesPerSample;
+    bufferSize -= bufferSize % frameSize;
+
+    int written = 0;
+    while (written < bufferSize)
+    {
+        if (stream->pendingOffset < stream->pendingSize)
+        {
+            int length = stream->pendingSize - stream->pendingOffset;
+            if (length > bufferSize - written)
+            {
+                length = bufferSize - written;
+            }
+
+            memcpy(out + written, stream->pending + stream->pendingOffset, length);
+            stream->pendingOffset += length;
+            written += length;
+            continue;
+        }
+
+        if (stream->format == SoundStreamVorbis)
+        {
+            int samples = stb_vorbis_get_samples_short_interleaved((stb_vorbis *)stream->decoder, stream->channels,
+                                                                   (short *)(out + written), (bufferSize - written) / 2);
+            if (samples <= 0)
+            {
+                break;
+            }
+
+            written += samples * frameSize;
+        }
+        else if ((stream->format != SoundStreamMP3) || !loom_asset_soundStream_decodeFrame(stream))
+        {
+            break;
+        }
+    }
+
+    return written;
+}
+
+void loom_asset_soundStream_rewind(loom_asset_soundStream_t *stream)
+{
+    if (stream->format == SoundStreamVorbis)
+    {
+        stb_vorbis_seek_start((stb_vorbis *)stream->decoder);
+    }
+    else if (stream->format == SoundStreamMP3)
+    {
+        mp3_done((mp3_decoder_t)stream->decoder);
+        stream->decoder     = mp3_create();
+        stream->position    = 0;
+        stream->pendingSize = 0;
+    }
+
+    stream->pendingOffset = 0;
+}
+
+void loom_asset_soundStream_close(loom_asset_soundStream_t *stream)
+{
+    if (!stream)
+    {
+        return;
+    }
+
+    if (stream->decoder && (stream->format == SoundStreamVorbis))
+    {
+        stb_vorbis_close((stb_vorbis *)stream->decoder);
+    }
+    else if (stream->decoder && (stream->format == SoundStreamMP3))
+    {
+        mp3_done((mp3_decoder_t)stream->decoder);
+    }
+
+    if (stream->pending)
+    {
+        lmFree(gSoundAssetAllocator, stream->pending);
+    }
+
+    lmFree(gSoundAssetAllocator, stream);
+}
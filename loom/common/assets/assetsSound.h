@@ -26,8 +26,13 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
+
 #define LATSound    LOOM_FOURCC('S', 'N', 'D', 1)
 
+// Wav is held as PCM in buffer. Ogg Vorbis and MP3 are kept compressed,
+// encoded points at the file data and buffer is NULL, sampleCount and
+// bufferSize are 0 until decoded with loom_asset_soundDecode.
 typedef struct loom_asset_sound
 {
     int channels;
@@ -36,11 +41,52 @@ typedef struct loom_asset_sound
     int bufferSize;
     int sampleRate;
     void *buffer;
+
+    const void *encoded;
+    int encodedSize;
 } loom_asset_sound_t;
 
 void loom_asset_registerSoundAsset();
 int loom_asset_identifySound(const char *path);
-void *loom_asset_soundDeserializer(void *buffer, size_t bufferLen, LoomAssetCleanupCallback *dtor);
+void *loom_asset_soundDeserializer(loom_assetMapping_t *mapping, LoomAssetCleanupCallback *dtor);
+
+// Returns the PCM of a sound and sets outSize to its length, decoding it
+// into a buffer of its own if it is kept compressed. NULL if it fails to
+// decode. Always matched by loom_asset_soundReleaseDecoded.
+void *loom_asset_soundDecode(loom_asset_sound_t *sound, int *outSize);
+void loom_asset_soundReleaseDecoded(loom_asset_sound_t *sound, void *pcm);
+
+// Decodes a sound a piece at a time rather than all at once, for music which
+// would take tens of megabytes as PCM. The encoded data is read in place and
+// must outlive the stream. Output is 16 bit for Ogg and MP3, and as stored
+// for wav.
+typedef struct loom_asset_soundStream
+{
+    int channels;
+    int bytesPerSample;
+    int sampleRate;
+
+    // Decoder state.
+    int                 format;
+    void                *decoder;
+    const unsigned char *data;
+    size_t              dataSize;
+    size_t              position;
+
+    // Decoded audio not yet read; an MP3 frame, or all of a wav.
+    unsigned char       *pending;
+    int                 pendingSize;
+    int                 pendingOffset;
+} loom_asset_soundStream_t;
+
+// NULL if the data isn't a sound we can decode.
+loom_asset_soundStream_t *loom_asset_soundStream_open(const void *data, size_t dataSize);
+
+// Decodes up to bufferSize bytes into buffer, returning how many were
+// written. Less than bufferSize only at the end of the sound.
+int loom_asset_soundStream_read(loom_asset_soundStream_t *stream, void *buffer, int bufferSize);
+void loom_asset_soundStream_rewind(loom_asset_soundStream_t *stream);
+void loom_asset_soundStream_close(loom_asset_soundStream_t *stream);
 
 #ifdef __cplusplus
 };
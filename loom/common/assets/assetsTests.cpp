@@ -19,8 +19,10 @@
  */
 
 
+#include <string.h>
 #include "seatest.h"
 #include "loom/common/platform/platformTime.h"
+#include "loom/common/platform/platformThread.h"
 #include "loom/common/assets/assets.h"
 #include "loom/common/assets/assetsImage.h"
 
@@ -30,8 +32,10 @@ SEATEST_FIXTURE(assets)
 {
     SEATEST_FIXTURE_ENTRY(asset_simpleText);
     SEATEST_FIXTURE_ENTRY(asset_simpleImage);
+    SEATEST_FIXTURE_ENTRY(asset_compressedImage);
     SEATEST_FIXTURE_ENTRY(asset_subscribers);
     SEATEST_FIXTURE_ENTRY(asset_liveUpdate);
+    SEATEST_FIXTURE_ENTRY(asset_coalescedNotify);
 }
 
 static int pumpTillLoaded(int timeoutMs)
@@ -113,6 +117,47 @@ SEATEST_TEST(asset_simpleImage)
     loom_asset_shutdown();
 }
 
+SEATEST_TEST(asset_compressedImage)
+{
+    loom_asset_initialize(".");
+
+    // An 8x8 DXT1 DDS with two mipmap levels
+    unsigned char dds[128 + 32 + 8];
+    memset(dds, 0, sizeof(dds));
+    memcpy(dds, "DDS ", 4);
+    dds[4] = 124;
+    dds[10] = 0x02;     // DDSD_MIPMAPCOUNT
+    dds[12] = 8;
+    dds[16] = 8;
+    dds[28] = 2;
+    memcpy(dds + 84, "DXT1", 4);
+    dds[128] = 0xAB;
+    dds[128 + 32] = 0xCD;
+
+    LoomAssetCleanupCallback dtor = NULL;
+    loom_asset_image_t *imageAsset = (loom_asset_image_t *)loom_asset_imageDeserializer(dds, sizeof(dds), &dtor);
+
+    assert_true(imageAsset != NULL);
+    if (imageAsset)
+    {
+        assert_int_equal(IMAGE_COMPRESSED_DXT1, imageAsset->compressedFormat);
+        assert_int_equal(8, imageAsset->width);
+        assert_int_equal(8, imageAsset->height);
+        assert_int_equal(2, imageAsset->levelCount);
+        assert_int_equal(32, (int)imageAsset->levelSize[0]);
+        assert_int_equal(8, (int)imageAsset->levelSize[1]);
+        assert_int_equal(0xAB, ((unsigned char *)imageAsset->bits)[0]);
+        assert_int_equal(0xCD, ((unsigned char *)imageAsset->bits)[32]);
+        dtor(imageAsset);
+    }
+
+    // Truncated levels are rejected
+    imageAsset = (loom_asset_image_t *)loom_asset_imageDeserializer(dds, sizeof(dds) - 1, &dtor);
+    assert_true(imageAsset == NULL);
+
+    loom_asset_shutdown();
+}
+
 static int testFireCount = 0;
 static void assetSubscriptionTestCallback(void *payload, const char *name)
 {
@@ -170,3 +215,47 @@ SEATEST_TEST(asset_liveUpdate)
     // the implicit flushAll doesn't fire anymore while shutting down.
     assert_int_equal(2, testFireCount);
 }
+
+static void assetSlowSubscriptionTestCallback(void *payload, const char *name)
+{
+    testFireCount++;
+    loom_thread_sleep(5);
+}
+
+SEATEST_TEST(asset_coalescedNotify)
+{
+    testFireCount = 0;
+
+    loom_asset_initialize(".");
+    loom_asset_subscribe("test.txt", assetSubscriptionTestCallback, NULL, 0);
+
+    loom_asset_lock("test.txt", LATText, 1);
+    loom_asset_unlock("test.txt");
+    assert_int_equal(1, testFireCount);
+
+    // Changed several times before the pump gets to it, told once.
+    loom_asset_reload("test.txt");
+    loom_asset_reload("test.txt");
+    loom_asset_reloadAll();
+    assert_true(pumpTillLoaded(5000));
+    assert_int_equal(2, testFireCount);
+
+    loom_asset_shutdown();
+
+    // With subscribers taking longer than the budget, notifications spill
+    // over into later pumps but loads aren't done until they're delivered.
+    testFireCount = 0;
+
+    loom_asset_initialize(".");
+    loom_asset_setNotifyBudget(1);
+    loom_asset_subscribe("test.txt", assetSlowSubscriptionTestCallback, NULL, 0);
+    loom_asset_subscribe("test.jpg", assetSlowSubscriptionTestCallback, NULL, 0);
+
+    loom_asset_preload("test.txt");
+    loom_asset_preload("test.jpg");
+    assert_true(pumpTillLoaded(5000));
+    assert_int_equal(2, testFireCount);
+
+    loom_asset_setNotifyBudget(8);
+    loom_asset_shutdown();
+}
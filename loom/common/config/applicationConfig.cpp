@@ -54,6 +54,7 @@ bool     LoomApplicationConfig::_displayMinimized = false;
 bool     LoomApplicationConfig::_displayResizable = true;
 bool     LoomApplicationConfig::_displayBorderless = false;
 utString LoomApplicationConfig::_displayMode = "windowed";
+int      LoomApplicationConfig::_httpCacheSize = 32;
 
 
 // little helpers that do conversion
@@ -242,6 +243,7 @@ static void parseLogBlock(json_t *logBlock, utString name)
     json_object_foreach(logBlock, key, value)
     {
         if (strcmp(key, "enabled") == 0 || strcmp(key, "level") == 0) continue;
+        if (name == "" && (strcmp(key, "async") == 0 || strcmp(key, "binary") == 0)) continue;
 
         parseLogBlock(value, name == "" ? key : name + "." + key);
     }
@@ -271,6 +273,16 @@ void LoomApplicationConfig::parseApplicationConfig(const utString& jsonString)
     if (json_t *logBlock = json_object_get(json, "log"))
     {
         parseLogBlock(logBlock, "");
+
+        // Hand log output to a thread of its own.
+        bool logAsync = false;
+        _jsonReadBool(logBlock, "async", logAsync);
+        loom_log_setAsync(logAsync);
+
+        // Record messages unformatted until they're viewed.
+        bool logBinary = false;
+        _jsonReadBool(logBlock, "binary", logBinary);
+        loom_log_setBinary(logBinary);
     }
 
     _jsonReadBool(json, "_wants51Audio", _wants51Audio);
@@ -296,5 +308,10 @@ void LoomApplicationConfig::parseApplicationConfig(const utString& jsonString)
         _jsonReadStr(displayBlock, "mode", _displayMode);
     }
 
+    if (json_t *httpBlock = json_object_get(json, "http"))
+    {
+        _jsonReadInt(httpBlock, "cacheSize", _httpCacheSize);
+    }
+
     json_delete(json);
 }
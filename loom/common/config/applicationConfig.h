@@ -58,6 +58,8 @@ class LoomApplicationConfig
     static bool     _displayBorderless;
     static utString _displayMode;
 
+    static int      _httpCacheSize;
+
 public:
     static const int POSITION_INVALID;
     static const int POSITION_UNDEFINED;
@@ -158,5 +160,8 @@ public:
     static bool displayResizable() { return _displayResizable; }
     static bool displayBorderless() { return _displayBorderless; }
     static const utString& displayMode() { return _displayMode; }
+
+    /// Megabytes of disk for caching HTTP responses, 0 if disabled.
+    static int httpCacheSize() { return _httpCacheSize; }
 };
 #endif
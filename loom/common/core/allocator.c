@@ -98,6 +98,12 @@ lmDefineLogGroup(gAllocatorLogGroup, "allocator", 1, LoomLogInfo);
 #define LOOM_ALLOCATOR_DEBUG_UNINITIALIZED 0xAD
 #define LOOM_ALLOCATOR_DEBUG_FREED 0xDA
 
+// Serve the global heap's small blocks out of per thread caches, see the
+// thread cache allocator.
+#ifndef LOOM_ALLOCATOR_THREADCACHE
+#define LOOM_ALLOCATOR_THREADCACHE 0
+#endif
+
 
 
 
@@ -115,8 +121,11 @@ void loom_allocator_startup()
     loom_allocator_initializeHeapAllocator(&gSystemAllocator);
     gSystemAllocator.name = "Global System";
     gGlobalHeap = &gSystemAllocator;
+#if LOOM_ALLOCATOR_THREADCACHE
+    gGlobalHeap = loom_allocator_initializeThreadCacheAllocator(&gSystemAllocator);
+#endif
 #if LOOM_ALLOCATOR_DEBUG
-    gGlobalHeap = loom_allocator_initializeDebugAllocator(&gSystemAllocator);
+    gGlobalHeap = loom_allocator_initializeDebugAllocator(gGlobalHeap);
 #endif
 }
 
@@ -629,6 +638,1153 @@ loom_allocator_t *loom_allocator_initializeTrackerProxyAllocator(loom_allocator_
 
 
 
+// ----------- TAGGED ALLOCATORS ---------------------------------------------
+
+// One shared allocator per subsystem tag, passing everything through to
+// the global heap while keeping live, peak and running totals. Each block
+// carries its size in a LOOM_ALLOCATOR_ALIGNMENT header.
+#define LOOM_ALLOCATOR_MAXTAGS      32
+#define LOOM_ALLOCATOR_MAXTAGLEN    32
+
+typedef struct loom_taggedAllocator
+{
+    loom_allocator_t allocator;
+    char             tag[LOOM_ALLOCATOR_MAXTAGLEN];
+    MutexHandle      lock;
+
+    size_t           liveBytes;
+    size_t           peakBytes;
+    size_t           liveCount;
+    size_t           totalBytes;
+    size_t           totalCount;
+} loom_taggedAllocator_t;
+
+typedef struct loom_taggedAllocatorHeader
+{
+    size_t size;
+} loom_taggedAllocatorHeader_t;
+
+static MutexHandle gTaggedAllocatorLock;
+static loom_taggedAllocator_t *gTaggedAllocators[LOOM_ALLOCATOR_MAXTAGS];
+static volatile atomic_int_t  gTaggedAllocatorCount;
+
+static void loom_taggedAlloc_noteAlloc(loom_taggedAllocator_t *state, size_t size)
+{
+    state->liveBytes += size;
+    state->liveCount++;
+    state->totalBytes += size;
+    state->totalCount++;
+
+    if (state->liveBytes > state->peakBytes)
+    {
+        state->peakBytes = state->liveBytes;
+    }
+}
+
+
+static void *loom_taggedAlloc_alloc(loom_allocator_t *thiz, size_t size, const char *file, int line)
+{
+    loom_taggedAllocator_t       *state = (loom_taggedAllocator_t *)thiz->userdata;
+    loom_taggedAllocatorHeader_t *header;
+
+    header = lmAlloc_inner(thiz->parent, size + LOOM_ALLOCATOR_ALIGNMENT, file, line);
+    if (!header)
+    {
+        return NULL;
+    }
+
+    header->size = size;
+
+    loom_mutex_lock(state->lock);
+    loom_taggedAlloc_noteAlloc(state, size);
+    loom_mutex_unlock(state->lock);
+
+    return loom_arenaProxyAlloc_arenaPointerToUserPointer(header);
+}
+
+
+static void loom_taggedAlloc_free(loom_allocator_t *thiz, void *ptr, const char *file, int line)
+{
+    loom_taggedAllocator_t       *state = (loom_taggedAllocator_t *)thiz->userdata;
+    loom_taggedAllocatorHeader_t *header;
+
+    if (!ptr)
+    {
+        return;
+    }
+
+    header = (loom_taggedAllocatorHeader_t *)loom_arenaProxyAlloc_userPointerToArenaPointer(ptr);
+
+    loom_mutex_lock(state->lock);
+    lmAssert(state->liveCount > 0, "loom_taggedAlloc_free - freeing more than was allocated from '%s', allocator mismatch?", state->tag);
+    state->liveBytes -= header->size;
+    state->liveCount--;
+    loom_mutex_unlock(state->lock);
+
+    lmFree_inner(thiz->parent, header, file, line);
+}
+
+
+static void *loom_taggedAlloc_realloc(loom_allocator_t *thiz, void *ptr, size_t newSize, const char *file, int line)
+{
+    loom_taggedAllocator_t       *state = (loom_taggedAllocator_t *)thiz->userdata;
+    loom_taggedAllocatorHeader_t *header;
+    size_t oldSize;
+
+    if (!ptr)
+    {
+        return loom_taggedAlloc_alloc(thiz, newSize, file, line);
+    }
+
+    if (newSize == 0)
+    {
+        loom_taggedAlloc_free(thiz, ptr, file, line);
+        return NULL;
+    }
+
+    header  = (loom_taggedAllocatorHeader_t *)loom_arenaProxyAlloc_userPointerToArenaPointer(ptr);
+    oldSize = header->size;
+
+    // Not every parent can resize, the debug and tracker proxies can't.
+    if (thiz->parent->reallocCall)
+    {
+        header = lmRealloc_inner(thiz->parent, header, newSize + LOOM_ALLOCATOR_ALIGNMENT, file, line);
+        if (!header)
+        {
+            return NULL;
+        }
+    }
+    else
+    {
+        loom_taggedAllocatorHeader_t *resized = lmAlloc_inner(thiz->parent, newSize + LOOM_ALLOCATOR_ALIGNMENT, file, line);
+        if (!resized)
+        {
+            return NULL;
+        }
+
+        memcpy(loom_arenaProxyAlloc_arenaPointerToUserPointer(resized), ptr, oldSize < newSize ? oldSize : newSize);
+        lmFree_inner(thiz->parent, header, file, line);
+        header = resized;
+    }
+
+    header->size = newSize;
+
+    // A resize counts as freeing the old block and allocating the new one.
+    loom_mutex_lock(state->lock);
+    state->liveBytes -= oldSize;
+    state->liveCount--;
+    loom_taggedAlloc_noteAlloc(state, newSize);
+    loom_mutex_unlock(state->lock);
+
+    return loom_arenaProxyAlloc_arenaPointerToUserPointer(header);
+}
+
+
+loom_allocator_t *loom_allocator_getTaggedAllocator(const char *tag)
+{
+    loom_allocator_t       *parent = loom_allocator_getGlobalHeap();
+    loom_taggedAllocator_t *state  = NULL;
+    int i, count;
+
+    lmAssert(sizeof(loom_taggedAllocatorHeader_t) <= LOOM_ALLOCATOR_ALIGNMENT, "Tagged allocator header is too big, update LOOM_ALLOCATOR_ALIGNMENT?");
+
+    if (gTaggedAllocatorLock == NULL)
+    {
+        MutexHandle lock = loom_mutex_create();
+
+        if (atomic_compareAndExchangePointer((void *volatile *)&gTaggedAllocatorLock, NULL, lock) != NULL)
+        {
+            loom_mutex_destroy(lock);
+        }
+    }
+
+    loom_mutex_lock(gTaggedAllocatorLock);
+
+    count = atomic_load32(&gTaggedAllocatorCount);
+    for (i = 0; i < count; i++)
+    {
+        if (!strncmp(gTaggedAllocators[i]->tag, tag, LOOM_ALLOCATOR_MAXTAGLEN - 1))
+        {
+            loom_mutex_unlock(gTaggedAllocatorLock);
+            return &gTaggedAllocators[i]->allocator;
+        }
+    }
+
+    if (count == LOOM_ALLOCATOR_MAXTAGS)
+    {
+        loom_mutex_unlock(gTaggedAllocatorLock);
+        lmLogError(gAllocatorLogGroup, "Out of allocator tags, '%s' is served untracked by the global heap", tag);
+        return parent;
+    }
+
+    state = lmAlloc(parent, sizeof(loom_taggedAllocator_t));
+    memset(state, 0, sizeof(loom_taggedAllocator_t));
+    strncpy(state->tag, tag, LOOM_ALLOCATOR_MAXTAGLEN - 1);
+    state->lock = loom_mutex_create();
+
+    state->allocator.name        = state->tag;
+    state->allocator.parent      = parent;
+    state->allocator.userdata    = state;
+    state->allocator.allocCall   = loom_taggedAlloc_alloc;
+    state->allocator.freeCall    = loom_taggedAlloc_free;
+    state->allocator.reallocCall = loom_taggedAlloc_realloc;
+
+    // Publish it only once it is complete, stats readers don't lock.
+    gTaggedAllocators[count] = state;
+    atomic_store32(&gTaggedAllocatorCount, count + 1);
+
+    loom_mutex_unlock(gTaggedAllocatorLock);
+
+    return &state->allocator;
+}
+
+
+int loom_allocator_getTagCount()
+{
+    return atomic_load32(&gTaggedAllocatorCount);
+}
+
+
+int loom_allocator_getTagStats(int index, loom_allocatorTagStats_t *stats)
+{
+    loom_taggedAllocator_t *state;
+
+    if ((index < 0) || (index >= loom_allocator_getTagCount()))
+    {
+        return 0;
+    }
+
+    state = gTaggedAllocators[index];
+
+    loom_mutex_lock(state->lock);
+    stats->tag        = state->tag;
+    stats->liveBytes  = state->liveBytes;
+    stats->peakBytes  = state->peakBytes;
+    stats->liveCount  = state->liveCount;
+    stats->totalBytes = state->totalBytes;
+    stats->totalCount = state->totalCount;
+    loom_mutex_unlock(state->lock);
+
+    return 1;
+}
+
+
+// ----------- EXTERNAL MEMORY ---------------------------------------------
+
+static MutexHandle gExternalLock;
+static long long   gExternalBytes;
+
+void loom_allocator_reportExternal(long long deltaBytes)
+{
+    if (gExternalLock == NULL)
+    {
+        MutexHandle lock = loom_mutex_create();
+
+        if (atomic_compareAndExchangePointer((void *volatile *)&gExternalLock, NULL, lock) != NULL)
+        {
+            loom_mutex_destroy(lock);
+        }
+    }
+
+    loom_mutex_lock(gExternalLock);
+    gExternalBytes += deltaBytes;
+    lmAssert(gExternalBytes >= 0, "External memory released more than was reported");
+    loom_mutex_unlock(gExternalLock);
+}
+
+
+long long loom_allocator_getExternalBytes()
+{
+    long long bytes;
+
+    if (gExternalLock == NULL)
+    {
+        return 0;
+    }
+
+    loom_mutex_lock(gExternalLock);
+    bytes = gExternalBytes;
+    loom_mutex_unlock(gExternalLock);
+
+    return bytes;
+}
+
+
+// ----------- FRAME ALLOCATOR ---------------------------------------------
+
+// Two linear buffers, allocations bump through the current one and are
+// only released wholesale, when the buffer comes around again. Each block
+// carries its size in a LOOM_ALLOCATOR_ALIGNMENT header for realloc.
+// Blocks that don't fit go to the parent with a second header linking them
+// into the overflow list of the buffer, which is freed along with it.
+typedef struct loom_frameAllocatorHeader
+{
+    size_t size;
+} loom_frameAllocatorHeader_t;
+
+typedef struct loom_frameAllocatorOverflow
+{
+    struct loom_frameAllocatorOverflow *next;
+} loom_frameAllocatorOverflow_t;
+
+typedef struct loom_frameAllocator
+{
+    unsigned char                 *buffers[2];
+    loom_frameAllocatorOverflow_t *overflow[2];
+    size_t                        bufferSize;
+    int                           current;
+    size_t                        offset;
+    size_t                        overflowBytes;
+
+    // Of the last frame that ended.
+    size_t                        lastUsedBytes;
+    size_t                        lastOverflowBytes;
+} loom_frameAllocator_t;
+
+static void *loom_frameAlloc_alloc(loom_allocator_t *thiz, size_t size, const char *file, int line)
+{
+    loom_frameAllocator_t       *state = (loom_frameAllocator_t *)thiz->userdata;
+    loom_frameAllocatorHeader_t *header;
+
+    size_t blockSize = (size + 2 * LOOM_ALLOCATOR_ALIGNMENT - 1) & ~(size_t)(LOOM_ALLOCATOR_ALIGNMENT - 1);
+
+    if (blockSize <= state->bufferSize - state->offset)
+    {
+        header         = (loom_frameAllocatorHeader_t *)(state->buffers[state->current] + state->offset);
+        state->offset += blockSize;
+    }
+    else
+    {
+        loom_frameAllocatorOverflow_t *overflow = lmAlloc_inner(thiz->parent, blockSize + LOOM_ALLOCATOR_ALIGNMENT, file, line);
+        if (!overflow)
+        {
+            return NULL;
+        }
+
+        overflow->next                  = state->overflow[state->current];
+        state->overflow[state->current] = overflow;
+        state->overflowBytes           += blockSize;
+
+        header = (loom_frameAllocatorHeader_t *)loom_arenaProxyAlloc_arenaPointerToUserPointer(overflow);
+    }
+
+    header->size = size;
+
+    return loom_arenaProxyAlloc_arenaPointerToUserPointer(header);
+}
+
+
+static void loom_frameAlloc_free(loom_allocator_t *thiz, void *ptr, const char *file, int line)
+{
+    // Blocks live until their buffer is reset.
+}
+
+
+static void *loom_frameAlloc_realloc(loom_allocator_t *thiz, void *ptr, size_t newSize, const char *file, int line)
+{
+    loom_frameAllocatorHeader_t *header;
+    void *resized;
+
+    if (!ptr)
+    {
+        return loom_frameAlloc_alloc(thiz, newSize, file, line);
+    }
+
+    header = (loom_frameAllocatorHeader_t *)loom_arenaProxyAlloc_userPointerToArenaPointer(ptr);
+
+    if (newSize <= header->size)
+    {
+        return ptr;
+    }
+
+    resized = loom_frameAlloc_alloc(thiz, newSize, file, line);
+    if (resized)
+    {
+        memcpy(resized, ptr, header->size);
+    }
+
+    return resized;
+}
+
+
+static void loom_frameAlloc_freeOverflow(loom_allocator_t *thiz, int buffer)
+{
+    loom_frameAllocator_t         *state    = (loom_frameAllocator_t *)thiz->userdata;
+    loom_frameAllocatorOverflow_t *overflow = state->overflow[buffer];
+
+    while (overflow)
+    {
+        loom_frameAllocatorOverflow_t *next = overflow->next;
+        lmFree(thiz->parent, overflow);
+        overflow = next;
+    }
+
+    state->overflow[buffer] = NULL;
+}
+
+
+static void loom_frameAlloc_destroy(loom_allocator_t *thiz)
+{
+    loom_frameAllocator_t *state = (loom_frameAllocator_t *)thiz->userdata;
+
+    loom_frameAlloc_freeOverflow(thiz, 0);
+    loom_frameAlloc_freeOverflow(thiz, 1);
+
+    lmFree(thiz->parent, state->buffers[0]);
+    lmFree(thiz->parent, state->buffers[1]);
+    lmFree(thiz->parent, state);
+}
+
+
+void loom_allocator_advanceFrame(loom_allocator_t *thiz)
+{
+    loom_frameAllocator_t *state = (loom_frameAllocator_t *)thiz->userdata;
+
+    state->lastUsedBytes     = state->offset;
+    state->lastOverflowBytes = state->overflowBytes;
+
+    // The other buffer held the frame before the one that just ended.
+    state->current ^= 1;
+    loom_frameAlloc_freeOverflow(thiz, state->current);
+    state->offset        = 0;
+    state->overflowBytes = 0;
+}
+
+
+void loom_allocator_getFrameAllocatorStats(loom_allocator_t *thiz, size_t *usedBytes, size_t *overflowBytes)
+{
+    loom_frameAllocator_t *state = (loom_frameAllocator_t *)thiz->userdata;
+
+    if (usedBytes)
+    {
+        *usedBytes = state->lastUsedBytes;
+    }
+    if (overflowBytes)
+    {
+        *overflowBytes = state->lastOverflowBytes;
+    }
+}
+
+
+loom_allocator_t *loom_allocator_initializeFrameAllocator(loom_allocator_t *parent, size_t bufferSize)
+{
+    loom_allocator_t      *a;
+    loom_frameAllocator_t *state = lmAlloc(parent, sizeof(loom_frameAllocator_t));
+
+    lmAssert(sizeof(loom_frameAllocatorHeader_t) <= LOOM_ALLOCATOR_ALIGNMENT, "Frame allocator header is too big, update LOOM_ALLOCATOR_ALIGNMENT?");
+
+    memset(state, 0, sizeof(loom_frameAllocator_t));
+    state->bufferSize = bufferSize & ~(size_t)(LOOM_ALLOCATOR_ALIGNMENT - 1);
+    state->buffers[0] = lmAlloc(parent, state->bufferSize);
+    state->buffers[1] = lmAlloc(parent, state->bufferSize);
+
+    a = lmAlloc(parent, sizeof(loom_allocator_t));
+    memset(a, 0, sizeof(loom_allocator_t));
+    a->name        = "Frame";
+    a->parent      = parent;
+    a->userdata    = state;
+    a->allocCall   = loom_frameAlloc_alloc;
+    a->freeCall    = loom_frameAlloc_free;
+    a->reallocCall = loom_frameAlloc_realloc;
+    a->destroyCall = loom_frameAlloc_destroy;
+    return a;
+}
+
+
+// ----------- SIZE CLASS ALLOCATOR ---------------------------------------------
+
+// Blocks up to LOOM_SIZECLASS_MAX bytes are rounded up to a multiple of
+// LOOM_SIZECLASS_STEP and carved out of slabs of LOOM_SIZECLASS_SLABSIZE
+// bytes, one free list per size class.
+#define LOOM_SIZECLASS_STEP        16
+#define LOOM_SIZECLASS_MAX         128
+#define LOOM_SIZECLASS_COUNT       (LOOM_SIZECLASS_MAX / LOOM_SIZECLASS_STEP)
+#define LOOM_SIZECLASS_SLABSIZE    (16 * 1024)
+
+typedef struct loom_sizeClassSlab
+{
+    struct loom_sizeClassSlab *next;
+} loom_sizeClassSlab_t;
+
+struct loom_sizeClassAllocator
+{
+    loom_allocator_t     *parent;
+    void                 *freeLists[LOOM_SIZECLASS_COUNT];
+    loom_sizeClassSlab_t *slabs;
+    size_t               allocatedBytes, allocatedCount, reservedBytes;
+};
+
+static int loom_sizeClassAlloc_classOf(size_t size)
+{
+    return (int)((size + LOOM_SIZECLASS_STEP - 1) / LOOM_SIZECLASS_STEP) - 1;
+}
+
+
+static void *loom_sizeClassAlloc_alloc(loom_sizeClassAllocator_t *thiz, size_t size)
+{
+    int           sizeClass;
+    size_t        blockSize, blockCount, i;
+    unsigned char *walk;
+    void          *block;
+
+    thiz->allocatedBytes += size;
+    thiz->allocatedCount++;
+
+    if (size > LOOM_SIZECLASS_MAX)
+    {
+        return lmAlloc(thiz->parent, size);
+    }
+
+    sizeClass = loom_sizeClassAlloc_classOf(size);
+    block     = thiz->freeLists[sizeClass];
+
+    if (block == NULL)
+    {
+        // Thread a new slab into the free list, the slab header takes one
+        // step so the blocks stay aligned.
+        loom_sizeClassSlab_t *slab = lmAlloc(thiz->parent, LOOM_SIZECLASS_SLABSIZE);
+        if (slab == NULL)
+        {
+            return NULL;
+        }
+
+        slab->next          = thiz->slabs;
+        thiz->slabs         = slab;
+        thiz->reservedBytes += LOOM_SIZECLASS_SLABSIZE;
+
+        blockSize  = (size_t)(sizeClass + 1) * LOOM_SIZECLASS_STEP;
+        blockCount = (LOOM_SIZECLASS_SLABSIZE - LOOM_SIZECLASS_STEP) / blockSize;
+        walk       = (unsigned char *)slab + LOOM_SIZECLASS_STEP;
+
+        block = walk;
+        for (i = 0; i < blockCount - 1; i++, walk += blockSize)
+        {
+            *(void **)walk = walk + blockSize;
+        }
+        *(void **)walk = NULL;
+    }
+
+    thiz->freeLists[sizeClass] = *(void **)block;
+    return block;
+}
+
+
+static void loom_sizeClassAlloc_free(loom_sizeClassAllocator_t *thiz, void *ptr, size_t size)
+{
+    int sizeClass;
+
+    lmAssert(thiz->allocatedCount > 0, "loom_sizeClassAlloc_free - trying to free more allocations than we allocated! Allocator mismatch?");
+
+    thiz->allocatedBytes -= size;
+    thiz->allocatedCount--;
+
+    if (size > LOOM_SIZECLASS_MAX)
+    {
+        lmFree(thiz->parent, ptr);
+        return;
+    }
+
+    sizeClass = loom_sizeClassAlloc_classOf(size);
+    *(void **)ptr = thiz->freeLists[sizeClass];
+    thiz->freeLists[sizeClass] = ptr;
+}
+
+
+loom_sizeClassAllocator_t *loom_allocator_createSizeClassAllocator(loom_allocator_t *parent)
+{
+    loom_sizeClassAllocator_t *thiz = lmAlloc(parent, sizeof(loom_sizeClassAllocator_t));
+
+    memset(thiz, 0, sizeof(loom_sizeClassAllocator_t));
+    thiz->parent = parent;
+
+    // Sanity check the slab header size.
+    lmAssert(sizeof(loom_sizeClassSlab_t) <= LOOM_SIZECLASS_STEP, "Size class slab header is too big, update LOOM_SIZECLASS_STEP?");
+    return thiz;
+}
+
+
+void *loom_allocator_sizeClassRealloc(loom_sizeClassAllocator_t *thiz, void *ptr, size_t oldSize, size_t newSize)
+{
+    void *tmp;
+
+    if (ptr == NULL)
+    {
+        return newSize ? loom_sizeClassAlloc_alloc(thiz, newSize) : NULL;
+    }
+
+    if (newSize == 0)
+    {
+        loom_sizeClassAlloc_free(thiz, ptr, oldSize);
+        return NULL;
+    }
+
+    // Big blocks stay with the parent, which can often grow them in place.
+    if ((oldSize > LOOM_SIZECLASS_MAX) && (newSize > LOOM_SIZECLASS_MAX) &&
+        (thiz->parent ? thiz->parent : loom_allocator_getGlobalHeap())->reallocCall)
+    {
+        tmp = lmRealloc(thiz->parent, ptr, newSize);
+        if (tmp)
+        {
+            thiz->allocatedBytes += newSize - oldSize;
+        }
+        return tmp;
+    }
+
+    // Same size class, the block already fits.
+    if ((oldSize <= LOOM_SIZECLASS_MAX) && (newSize <= LOOM_SIZECLASS_MAX) &&
+        (loom_sizeClassAlloc_classOf(oldSize) == loom_sizeClassAlloc_classOf(newSize)))
+    {
+        thiz->allocatedBytes += newSize - oldSize;
+        return ptr;
+    }
+
+    tmp = loom_sizeClassAlloc_alloc(thiz, newSize);
+    if (tmp == NULL)
+    {
+        // Keep the old block around like realloc() does.
+        thiz->allocatedBytes -= newSize;
+        thiz->allocatedCount--;
+        return NULL;
+    }
+
+    memcpy(tmp, ptr, oldSize < newSize ? oldSize : newSize);
+    loom_sizeClassAlloc_free(thiz, ptr, oldSize);
+    return tmp;
+}
+
+
+void loom_allocator_getSizeClassStats(loom_sizeClassAllocator_t *thiz, size_t *allocatedBytes, size_t *allocatedCount, size_t *reservedBytes)
+{
+    if (allocatedBytes)
+    {
+        *allocatedBytes = thiz->allocatedBytes;
+    }
+    if (allocatedCount)
+    {
+        *allocatedCount = thiz->allocatedCount;
+    }
+    if (reservedBytes)
+    {
+        *reservedBytes = thiz->reservedBytes;
+    }
+}
+
+
+void loom_allocator_destroySizeClassAllocator(loom_sizeClassAllocator_t *thiz)
+{
+    loom_sizeClassSlab_t *walk = thiz->slabs, *walkTmp = NULL;
+
+    // Slabs are only given back here, all of their blocks go with them.
+    while (walk)
+    {
+        walkTmp = walk;
+        walk    = walk->next;
+        lmFree(thiz->parent, walkTmp);
+    }
+
+    lmFree(thiz->parent, thiz);
+}
+
+
+// ----------- THREAD CACHE ALLOCATOR ---------------------------------------------
+
+// Blocks up to LOOM_THREADCACHE_MAX bytes come out of per thread caches
+// without any locking, one free list per size class. A thread caching more
+// than two magazines (LOOM_THREADCACHE_MAGAZINE blocks) of a class hands one
+// back to the depot shared by all threads, and a thread out of blocks takes
+// one from it, so blocks freed by another thread than the one that allocated
+// them keep circulating. The depot carves new magazines out of slabs taken
+// from the parent, which are only released on destroy.
+//
+// Every block is preceded by a LOOM_ALLOCATOR_ALIGNMENT header holding its
+// size class; bigger blocks are passed on to the parent, header included.
+#define LOOM_THREADCACHE_STEP        16
+#define LOOM_THREADCACHE_MAX         256
+#define LOOM_THREADCACHE_COUNT       (LOOM_THREADCACHE_MAX / LOOM_THREADCACHE_STEP)
+#define LOOM_THREADCACHE_MAGAZINE    32
+#define LOOM_THREADCACHE_SLABSIZE    (64 * 1024)
+#define LOOM_THREADCACHE_THREADS     64
+#define LOOM_THREADCACHE_LARGE       -1
+
+typedef struct loom_threadCacheHeader
+{
+    size_t size; // of big blocks only
+    int    sizeClass;
+} loom_threadCacheHeader_t;
+
+typedef struct loom_threadCacheList
+{
+    void *head;
+    int  count;
+} loom_threadCacheList_t;
+
+// A thread's cache, claimed by the first allocation made on the thread.
+typedef struct loom_threadCacheThread
+{
+    volatile int           state; // 0 free, 1 being claimed, 2 claimed
+    volatile int           thread;
+    loom_threadCacheList_t lists[LOOM_THREADCACHE_COUNT];
+} loom_threadCacheThread_t;
+
+// Full magazines are linked through the second word of their first block.
+// Threads without a cache of their own share the loose list.
+typedef struct loom_threadCacheDepot
+{
+    MutexHandle            lock;
+    void                   *magazines;
+    loom_threadCacheList_t loose;
+    void                   *slabs;
+    unsigned char          *carve;
+    size_t                 carveLeft;
+} loom_threadCacheDepot_t;
+
+typedef struct loom_threadCacheAllocator
+{
+    loom_threadCacheDepot_t  depots[LOOM_THREADCACHE_COUNT];
+    loom_threadCacheThread_t threads[LOOM_THREADCACHE_THREADS];
+    volatile int             slabCount;
+} loom_threadCacheAllocator_t;
+
+static int loom_threadCacheAlloc_classOf(size_t size)
+{
+    return size ? (int)((size + LOOM_THREADCACHE_STEP - 1) / LOOM_THREADCACHE_STEP) - 1 : 0;
+}
+
+
+static loom_threadCacheHeader_t *loom_threadCacheAlloc_header(void *ptr)
+{
+    return (loom_threadCacheHeader_t *)((unsigned char *)ptr - LOOM_ALLOCATOR_ALIGNMENT);
+}
+
+
+// Returns the calling thread's cache, or NULL once every one is taken.
+static loom_threadCacheThread_t *loom_threadCacheAlloc_getThread(loom_threadCacheAllocator_t *state)
+{
+    int          thread = platform_getCurrentThreadId();
+    unsigned int start  = ((unsigned int)thread * 2654435761u) >> 16;
+    int          i;
+
+    for (i = 0; i < LOOM_THREADCACHE_THREADS; i++)
+    {
+        loom_threadCacheThread_t *cache = &state->threads[(start + i) % LOOM_THREADCACHE_THREADS];
+
+        if ((cache->state == 2) && (cache->thread == thread))
+        {
+            return cache;
+        }
+
+        // Caches are only given up by loom_allocator_flushThreadCache, so
+        // one the thread claimed earlier can't lie beyond a free one.
+        if ((cache->state == 0) && (atomic_compareAndExchange(&cache->state, 0, 1) == 0))
+        {
+            cache->thread = thread;
+            atomic_store32(&cache->state, 2);
+            return cache;
+        }
+    }
+
+    return NULL;
+}
+
+
+// Takes a full magazine from the depot, carving a new one if there is none.
+static void *loom_threadCacheAlloc_takeMagazine(loom_allocator_t *thiz, int sizeClass)
+{
+    loom_threadCacheAllocator_t *state = (loom_threadCacheAllocator_t *)thiz->userdata;
+    loom_threadCacheDepot_t     *depot = &state->depots[sizeClass];
+    size_t                      stride = LOOM_ALLOCATOR_ALIGNMENT + (size_t)(sizeClass + 1) * LOOM_THREADCACHE_STEP;
+    void                        *magazine;
+    int                         i;
+
+    loom_mutex_lock(depot->lock);
+
+    magazine = depot->magazines;
+
+    if (magazine)
+    {
+        depot->magazines = ((void **)magazine)[1];
+        loom_mutex_unlock(depot->lock);
+        return magazine;
+    }
+
+    if (depot->carveLeft < stride * LOOM_THREADCACHE_MAGAZINE)
+    {
+        // The slab is linked through its first word, which the alignment
+        // keeps clear of the blocks.
+        void **slab = lmAlloc(thiz->parent, LOOM_THREADCACHE_SLABSIZE);
+
+        if (slab == NULL)
+        {
+            loom_mutex_unlock(depot->lock);
+            return NULL;
+        }
+
+        *slab            = depot->slabs;
+        depot->slabs     = slab;
+        depot->carve     = (unsigned char *)slab + LOOM_ALLOCATOR_ALIGNMENT;
+        depot->carveLeft = LOOM_THREADCACHE_SLABSIZE - LOOM_ALLOCATOR_ALIGNMENT;
+
+        atomic_increment(&state->slabCount);
+    }
+
+    // Thread the blocks together, back to front.
+    magazine = NULL;
+    for (i = 0; i < LOOM_THREADCACHE_MAGAZINE; i++)
+    {
+        void *block = depot->carve + LOOM_ALLOCATOR_ALIGNMENT;
+
+        loom_threadCacheAlloc_header(block)->sizeClass = sizeClass;
+        *(void **)block = magazine;
+        magazine        = block;
+
+        depot->carve     += stride;
+        depot->carveLeft -= stride;
+    }
+
+    loom_mutex_unlock(depot->lock);
+
+    return magazine;
+}
+
+
+static void loom_threadCacheAlloc_giveMagazine(loom_threadCacheAllocator_t *state, int sizeClass, void *magazine)
+{
+    loom_threadCacheDepot_t *depot = &state->depots[sizeClass];
+
+    loom_mutex_lock(depot->lock);
+    ((void **)magazine)[1] = depot->magazines;
+    depot->magazines       = magazine;
+    loom_mutex_unlock(depot->lock);
+}
+
+
+static void *loom_threadCacheAlloc_lastOf(void *magazine)
+{
+    int i;
+
+    for (i = 1; i < LOOM_THREADCACHE_MAGAZINE; i++)
+    {
+        magazine = *(void **)magazine;
+    }
+
+    return magazine;
+}
+
+
+// Detaches a magazine's worth of blocks off the front of a list.
+static void *loom_threadCacheAlloc_splitMagazine(loom_threadCacheList_t *list)
+{
+    void *magazine = list->head;
+    void *last     = loom_threadCacheAlloc_lastOf(magazine);
+
+    list->head     = *(void **)last;
+    list->count   -= LOOM_THREADCACHE_MAGAZINE;
+    *(void **)last = NULL;
+
+    return magazine;
+}
+
+
+static void *loom_threadCacheAlloc_alloc(loom_allocator_t *thiz, size_t size, const char *file, int line)
+{
+    loom_threadCacheAllocator_t *state = (loom_threadCacheAllocator_t *)thiz->userdata;
+    loom_threadCacheThread_t    *cache;
+    loom_threadCacheList_t      *list;
+    void                        *block;
+    int                         sizeClass;
+
+    if (size > LOOM_THREADCACHE_MAX)
+    {
+        loom_threadCacheHeader_t *header = lmAlloc(thiz->parent, size + LOOM_ALLOCATOR_ALIGNMENT);
+        if (header == NULL)
+        {
+            return NULL;
+        }
+
+        header->size      = size;
+        header->sizeClass = LOOM_THREADCACHE_LARGE;
+        return (unsigned char *)header + LOOM_ALLOCATOR_ALIGNMENT;
+    }
+
+    sizeClass = loom_threadCacheAlloc_classOf(size);
+    cache     = loom_threadCacheAlloc_getThread(state);
+
+    if (cache == NULL)
+    {
+        // Out of caches, go through the depot's loose list.
+        loom_threadCacheDepot_t *depot = &state->depots[sizeClass];
+
+        loom_mutex_lock(depot->lock);
+
+        if (depot->loose.head == NULL)
+        {
+            loom_mutex_unlock(depot->lock);
+
+            block = loom_threadCacheAlloc_takeMagazine(thiz, sizeClass);
+            if (block == NULL)
+            {
+                return NULL;
+            }
+
+            // Another thread may have refilled it meanwhile, so splice.
+            loom_mutex_lock(depot->lock);
+            *(void **)loom_threadCacheAlloc_lastOf(block) = depot->loose.head;
+            depot->loose.head   = block;
+            depot->loose.count += LOOM_THREADCACHE_MAGAZINE;
+        }
+
+        block             = depot->loose.head;
+        depot->loose.head = *(void **)block;
+        depot->loose.count--;
+
+        loom_mutex_unlock(depot->lock);
+        return block;
+    }
+
+    list = &cache->lists[sizeClass];
+
+    if (list->head == NULL)
+    {
+        list->head = loom_threadCacheAlloc_takeMagazine(thiz, sizeClass);
+        if (list->head == NULL)
+        {
+            return NULL;
+        }
+
+        list->count = LOOM_THREADCACHE_MAGAZINE;
+    }
+
+    block      = list->head;
+    list->head = *(void **)block;
+    list->count--;
+
+    return block;
+}
+
+
+static void loom_threadCacheAlloc_free(loom_allocator_t *thiz, void *ptr, const char *file, int line)
+{
+    loom_threadCacheAllocator_t *state = (loom_threadCacheAllocator_t *)thiz->userdata;
+    loom_threadCacheThread_t    *cache;
+    loom_threadCacheList_t      *list;
+    int                         sizeClass;
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    sizeClass = loom_threadCacheAlloc_header(ptr)->sizeClass;
+
+    if (sizeClass == LOOM_THREADCACHE_LARGE)
+    {
+        lmFree(thiz->parent, loom_threadCacheAlloc_header(ptr));
+        return;
+    }
+
+    lmAssert(sizeClass >= 0 && sizeClass < LOOM_THREADCACHE_COUNT, "loom_threadCacheAlloc_free - bad block header! Allocator mismatch?");
+
+    cache = loom_threadCacheAlloc_getThread(state);
+
+    if (cache == NULL)
+    {
+        loom_threadCacheDepot_t *depot = &state->depots[sizeClass];
+
+        loom_mutex_lock(depot->lock);
+
+        *(void **)ptr     = depot->loose.head;
+        depot->loose.head = ptr;
+        depot->loose.count++;
+
+        if (depot->loose.count >= 2 * LOOM_THREADCACHE_MAGAZINE)
+        {
+            void *magazine = loom_threadCacheAlloc_splitMagazine(&depot->loose);
+
+            ((void **)magazine)[1] = depot->magazines;
+            depot->magazines       = magazine;
+        }
+
+        loom_mutex_unlock(depot->lock);
+        return;
+    }
+
+    list = &cache->lists[sizeClass];
+
+    *(void **)ptr = list->head;
+    list->head    = ptr;
+    list->count++;
+
+    if (list->count >= 2 * LOOM_THREADCACHE_MAGAZINE)
+    {
+        loom_threadCacheAlloc_giveMagazine(state, sizeClass, loom_threadCacheAlloc_splitMagazine(list));
+    }
+}
+
+
+static void *loom_threadCacheAlloc_realloc(loom_allocator_t *thiz, void *ptr, size_t size, const char *file, int line)
+{
+    loom_threadCacheHeader_t *header = loom_threadCacheAlloc_header(ptr);
+    size_t                   capacity;
+    void                     *tmp;
+
+    if (header->sizeClass == LOOM_THREADCACHE_LARGE)
+    {
+        capacity = header->size;
+
+        // Big blocks stay with the parent, which can often grow them in place.
+        if ((size > LOOM_THREADCACHE_MAX) && (thiz->parent ? thiz->parent : loom_allocator_getGlobalHeap())->reallocCall)
+        {
+            header = lmRealloc(thiz->parent, header, size + LOOM_ALLOCATOR_ALIGNMENT);
+            if (header == NULL)
+            {
+                return NULL;
+            }
+
+            header->size = size;
+            return (unsigned char *)header + LOOM_ALLOCATOR_ALIGNMENT;
+        }
+    }
+    else
+    {
+        // The block already fits.
+        capacity = (size_t)(header->sizeClass + 1) * LOOM_THREADCACHE_STEP;
+        if (size <= capacity)
+        {
+            return ptr;
+        }
+    }
+
+    tmp = loom_threadCacheAlloc_alloc(thiz, size, file, line);
+    if (tmp == NULL)
+    {
+        return NULL;
+    }
+
+    memcpy(tmp, ptr, capacity < size ? capacity : size);
+    loom_threadCacheAlloc_free(thiz, ptr, file, line);
+    return tmp;
+}
+
+
+static void loom_threadCacheAlloc_destroy(loom_allocator_t *thiz)
+{
+    loom_threadCacheAllocator_t *state = (loom_threadCacheAllocator_t *)thiz->userdata;
+    int                         i;
+
+    // Slabs are only given back here, all of their blocks go with them.
+    for (i = 0; i < LOOM_THREADCACHE_COUNT; i++)
+    {
+        void *walk = state->depots[i].slabs, *walkTmp = NULL;
+
+        while (walk)
+        {
+            walkTmp = walk;
+            walk    = *(void **)walk;
+            lmFree(thiz->parent, walkTmp);
+        }
+
+        loom_mutex_destroy(state->depots[i].lock);
+    }
+
+    lmFree(thiz->parent, state);
+}
+
+
+void loom_allocator_flushThreadCache(loom_allocator_t *thiz)
+{
+    loom_threadCacheAllocator_t *state = (loom_threadCacheAllocator_t *)thiz->userdata;
+    loom_threadCacheThread_t    *cache = loom_threadCacheAlloc_getThread(state);
+    int                         i;
+
+    if (cache == NULL)
+    {
+        return;
+    }
+
+    // Move everything over to the loose lists, where full magazines are
+    // split off as usual.
+    for (i = 0; i < LOOM_THREADCACHE_COUNT; i++)
+    {
+        loom_threadCacheDepot_t *depot = &state->depots[i];
+        loom_threadCacheList_t  *list  = &cache->lists[i];
+
+        if (list->head == NULL)
+        {
+            continue;
+        }
+
+        loom_mutex_lock(depot->lock);
+
+        while (list->head)
+        {
+            void *block = list->head;
+
+            list->head         = *(void **)block;
+            *(void **)block    = depot->loose.head;
+            depot->loose.head  = block;
+            depot->loose.count++;
+
+            if (depot->loose.count >= 2 * LOOM_THREADCACHE_MAGAZINE)
+            {
+                void *magazine = loom_threadCacheAlloc_splitMagazine(&depot->loose);
+
+                ((void **)magazine)[1] = depot->magazines;
+                depot->magazines       = magazine;
+            }
+        }
+
+        list->count = 0;
+
+        loom_mutex_unlock(depot->lock);
+    }
+
+    // And let another thread have the cache.
+    cache->thread = 0;
+    atomic_store32(&cache->state, 0);
+}
+
+
+size_t loom_allocator_getThreadCacheReservedBytes(loom_allocator_t *thiz)
+{
+    loom_threadCacheAllocator_t *state = (loom_threadCacheAllocator_t *)thiz->userdata;
+
+    return (size_t)atomic_load32(&state->slabCount) * LOOM_THREADCACHE_SLABSIZE;
+}
+
+
+loom_allocator_t *loom_allocator_initializeThreadCacheAllocator(loom_allocator_t *parent)
+{
+    loom_allocator_t *a;
+    int              i;
+
+    // Set up the state structure.
+    loom_threadCacheAllocator_t *state = lmAlloc(parent, sizeof(loom_threadCacheAllocator_t));
+
+    memset(state, 0, sizeof(loom_threadCacheAllocator_t));
+
+    for (i = 0; i < LOOM_THREADCACHE_COUNT; i++)
+    {
+        state->depots[i].lock = loom_mutex_create();
+    }
+
+    // Sanity check the header size, and that blocks can hold the links.
+    lmAssert(sizeof(loom_threadCacheHeader_t) <= LOOM_ALLOCATOR_ALIGNMENT, "Thread cache header is too big, update LOOM_ALLOCATOR_ALIGNMENT?");
+    lmAssert(2 * sizeof(void *) <= LOOM_THREADCACHE_STEP, "Thread cache blocks are too small, update LOOM_THREADCACHE_STEP?");
+
+    // Set up the allocator structure.
+    a = lmAlloc(parent, sizeof(loom_allocator_t));
+    memset(a, 0, sizeof(loom_allocator_t));
+    a->name        = "Thread Cache";
+    a->parent      = parent;
+    a->userdata    = state;
+    a->allocCall   = loom_threadCacheAlloc_alloc;
+    a->freeCall    = loom_threadCacheAlloc_free;
+    a->reallocCall = loom_threadCacheAlloc_realloc;
+    a->destroyCall = loom_threadCacheAlloc_destroy;
+    return a;
+}
+
+
 // ----------- DEBUG ALLOCATOR ---------------------------------------------
 
 
@@ -144,6 +144,75 @@ loom_allocator_t *loom_allocator_initializeArenaProxyAllocator(loom_allocator_t
 loom_allocator_t *loom_allocator_initializeTrackerProxyAllocator(loom_allocator_t *parent);
 void loom_allocator_getTrackerProxyStats(loom_allocator_t *thiz, size_t *allocatedBytes, size_t *allocatedCount);
 
+// The size class allocator serves blocks of up to 128 bytes from slabs
+// split into per size free lists and passes bigger ones on to its parent.
+// It needs the old size of a block back to free or resize it, as Lua's
+// allocator callback gets, and is not thread safe, so use one per thread
+// or Lua state. Realloc follows lua_Alloc semantics: a NULL ptr allocates
+// and a newSize of 0 frees. Stats are the live requested bytes and blocks,
+// and the bytes held in slabs, which are only released on destroy.
+typedef struct loom_sizeClassAllocator loom_sizeClassAllocator_t;
+loom_sizeClassAllocator_t *loom_allocator_createSizeClassAllocator(loom_allocator_t *parent);
+void *loom_allocator_sizeClassRealloc(loom_sizeClassAllocator_t *thiz, void *ptr, size_t oldSize, size_t newSize);
+void loom_allocator_getSizeClassStats(loom_sizeClassAllocator_t *thiz, size_t *allocatedBytes, size_t *allocatedCount, size_t *reservedBytes);
+void loom_allocator_destroySizeClassAllocator(loom_sizeClassAllocator_t *thiz);
+
+// The thread cache allocator serves blocks of up to 256 bytes from per
+// thread caches of per size free lists, without locking, and passes bigger
+// ones on to its parent. Caches exchange blocks in batches through a shared
+// depot, which takes slabs from the parent and only releases them on
+// destroy. It is thread safe, and can back the global heap by building with
+// LOOM_ALLOCATOR_THREADCACHE=1. Up to 64 threads get a cache of their own,
+// a thread about to exit should hand its cache back with
+// loom_allocator_flushThreadCache.
+loom_allocator_t *loom_allocator_initializeThreadCacheAllocator(loom_allocator_t *parent);
+void loom_allocator_flushThreadCache(loom_allocator_t *thiz);
+size_t loom_allocator_getThreadCacheReservedBytes(loom_allocator_t *thiz);
+
+// Tagged allocators attribute heap use to a subsystem ("asset", "gfx.texture",
+// "script.lua", ...). There is one per tag, created on first use and shared
+// by every caller asking for the same tag; it passes allocations through to
+// the global heap, adding a LOOM_ALLOCATOR_ALIGNMENT header to each, and is
+// never destroyed. Only assign one to a subsystem allocator before anything
+// is allocated through it, blocks must be freed by the allocator they came
+// from. Stats are live and peak bytes, live blocks and running totals of
+// bytes and blocks allocated, the latter giving the allocation rate.
+typedef struct loom_allocatorTagStats
+{
+    const char *tag;
+    size_t     liveBytes;
+    size_t     peakBytes;
+    size_t     liveCount;
+    size_t     totalBytes;
+    size_t     totalCount;
+} loom_allocatorTagStats_t;
+
+loom_allocator_t *loom_allocator_getTaggedAllocator(const char *tag);
+int loom_allocator_getTagCount();
+int loom_allocator_getTagStats(int index, loom_allocatorTagStats_t *stats);
+
+// External memory is native memory held on behalf of garbage collected
+// script objects, e.g. the bytes of a ByteArray or the vertices of a
+// QuadBatch, which the script heap doesn't see. Holders report the change
+// in bytes as they grow and shrink, from any thread, and release all of it
+// when they go away; the GC paces collection by the script heap and the
+// external memory together.
+void loom_allocator_reportExternal(long long deltaBytes);
+long long loom_allocator_getExternalBytes();
+
+// The frame allocator is a double buffered linear allocator for
+// temporaries that don't outlive the next frame. Allocations bump through
+// the current buffer of bufferSize bytes and freeing them does nothing;
+// loom_allocator_advanceFrame switches buffers and resets the one used the
+// frame before, so a block stays valid until the end of the frame after
+// the one it was allocated in. Blocks that don't fit are taken from the
+// parent and freed on the same schedule. It is not thread safe, use it on
+// the thread advancing it. Stats are the bytes used in the buffer and
+// taken from the parent during the last frame that ended.
+loom_allocator_t *loom_allocator_initializeFrameAllocator(loom_allocator_t *parent, size_t bufferSize);
+void loom_allocator_advanceFrame(loom_allocator_t *thiz);
+void loom_allocator_getFrameAllocatorStats(loom_allocator_t *thiz, size_t *usedBytes, size_t *overflowBytes);
+
 // Destroy an allocator. Depending on the allocator's implementation this
 // may also free all of its allocations (like in the arena proxy).
 void loom_allocator_destroy(loom_allocator_t *a);
@@ -0,0 +1,137 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/common/core/benchmark.h"
+#include "loom/common/core/allocator.h"
+
+// Mixed sizes, most small as script and asset bookkeeping are
+static const size_t ALLOCBENCH_SIZES[] = { 16, 24, 32, 48, 64, 96, 128, 256 };
+
+#define ALLOCBENCH_BLOCKS    256
+
+BENCHMARK_FIXTURE(allocatorSystem)
+{
+    BENCHMARK_FIXTURE_ENTRY(allocator_heap);
+    BENCHMARK_FIXTURE_ENTRY(allocator_fixedPool);
+    BENCHMARK_FIXTURE_ENTRY(allocator_sizeClass);
+    BENCHMARK_FIXTURE_ENTRY(allocator_threadCache);
+    BENCHMARK_FIXTURE_ENTRY(allocator_frame);
+}
+
+// Allocates a batch of blocks, then frees them all, per iteration
+static void allocatorBatch(loom_allocator_t *allocator, int iterations, bool fixedSize)
+{
+    void *blocks[ALLOCBENCH_BLOCKS];
+
+    for (int i = 0; i < iterations; i++)
+    {
+        for (int j = 0; j < ALLOCBENCH_BLOCKS; j++)
+        {
+            blocks[j] = lmAlloc(allocator, fixedSize ? 64 : ALLOCBENCH_SIZES[j & 7]);
+        }
+
+        loom_benchmark_doNotOptimize(blocks[ALLOCBENCH_BLOCKS - 1]);
+
+        for (int j = 0; j < ALLOCBENCH_BLOCKS; j++)
+        {
+            lmFree(allocator, blocks[j]);
+        }
+    }
+}
+
+BENCHMARK(allocator_heap)
+{
+    allocatorBatch(loom_allocator_getGlobalHeap(), iterations, false);
+}
+
+BENCHMARK(allocator_fixedPool)
+{
+    loom_benchmark_pauseTiming();
+    loom_allocator_t *pool = loom_allocator_initializeFixedPoolAllocator(NULL, 64, ALLOCBENCH_BLOCKS);
+    loom_benchmark_resumeTiming();
+
+    allocatorBatch(pool, iterations, true);
+
+    loom_benchmark_pauseTiming();
+    loom_allocator_destroy(pool);
+    loom_benchmark_resumeTiming();
+}
+
+BENCHMARK(allocator_sizeClass)
+{
+    loom_benchmark_pauseTiming();
+    loom_sizeClassAllocator_t *sizeClass = loom_allocator_createSizeClassAllocator(NULL);
+    loom_benchmark_resumeTiming();
+
+    void *blocks[ALLOCBENCH_BLOCKS];
+
+    for (int i = 0; i < iterations; i++)
+    {
+        for (int j = 0; j < ALLOCBENCH_BLOCKS; j++)
+        {
+            blocks[j] = loom_allocator_sizeClassRealloc(sizeClass, NULL, 0, ALLOCBENCH_SIZES[j & 7]);
+        }
+
+        loom_benchmark_doNotOptimize(blocks[ALLOCBENCH_BLOCKS - 1]);
+
+        for (int j = 0; j < ALLOCBENCH_BLOCKS; j++)
+        {
+            loom_allocator_sizeClassRealloc(sizeClass, blocks[j], ALLOCBENCH_SIZES[j & 7], 0);
+        }
+    }
+
+    loom_benchmark_pauseTiming();
+    loom_allocator_destroySizeClassAllocator(sizeClass);
+    loom_benchmark_resumeTiming();
+}
+
+BENCHMARK(allocator_threadCache)
+{
+    loom_benchmark_pauseTiming();
+    loom_allocator_t *cache = loom_allocator_initializeThreadCacheAllocator(NULL);
+    loom_benchmark_resumeTiming();
+
+    allocatorBatch(cache, iterations, false);
+
+    loom_benchmark_pauseTiming();
+    loom_allocator_destroy(cache);
+    loom_benchmark_resumeTiming();
+}
+
+BENCHMARK(allocator_frame)
+{
+    loom_benchmark_pauseTiming();
+    loom_allocator_t *frame = loom_allocator_initializeFrameAllocator(NULL, 256 * 1024);
+    loom_benchmark_resumeTiming();
+
+    for (int i = 0; i < iterations; i++)
+    {
+        for (int j = 0; j < ALLOCBENCH_BLOCKS; j++)
+        {
+            loom_benchmark_doNotOptimize(lmAlloc(frame, ALLOCBENCH_SIZES[j & 7]));
+        }
+
+        loom_allocator_advanceFrame(frame);
+    }
+
+    loom_benchmark_pauseTiming();
+    loom_allocator_destroy(frame);
+    loom_benchmark_resumeTiming();
+}
@@ -21,6 +21,8 @@
 
 #include "loom/common/core/allocator.h"
 #include "loom/common/core/allocatorJEMalloc.h"
+#include "loom/common/platform/platformThread.h"
+#include "loom/common/platform/platformTime.h"
 #include "seatest.h"
 
 SEATEST_FIXTURE(allocatorSystem)
@@ -32,6 +34,11 @@ SEATEST_FIXTURE(allocatorSystem)
     SEATEST_FIXTURE_ENTRY(allocator_cppNewDeleteComplex);
     SEATEST_FIXTURE_ENTRY(allocator_jemalloc);
     SEATEST_FIXTURE_ENTRY(allocator_arena);
+    SEATEST_FIXTURE_ENTRY(allocator_sizeClass);
+    SEATEST_FIXTURE_ENTRY(allocator_tagged);
+    SEATEST_FIXTURE_ENTRY(allocator_frame);
+    SEATEST_FIXTURE_ENTRY(allocator_threadCache);
+    SEATEST_FIXTURE_ENTRY(allocator_threadCacheBenchmark);
 }
 
 SEATEST_TEST(allocator_basic)
@@ -247,3 +254,341 @@ SEATEST_TEST(allocator_arena)
 
     loom_allocator_destroy(tracker);
 }
+
+SEATEST_TEST(allocator_sizeClass)
+{
+    void *allocs[1000];
+
+    loom_allocator_t *tracker = loom_allocator_initializeTrackerProxyAllocator(loom_allocator_getGlobalHeap());
+    size_t           count, bytes, reserved;
+
+    loom_sizeClassAllocator_t *sizeClass = loom_allocator_createSizeClassAllocator(tracker);
+
+    // Small blocks of every class, and some passed through to the parent.
+    for (int i = 0; i < 1000; i++)
+    {
+        size_t size = 1 + (i % 200);
+        allocs[i] = loom_allocator_sizeClassRealloc(sizeClass, NULL, 0, size);
+        assert_true(allocs[i] != NULL);
+        memset(allocs[i], i & 0xFF, size);
+    }
+
+    loom_allocator_getSizeClassStats(sizeClass, &bytes, &count, &reserved);
+    assert_int_equal((int)count, 1000);
+    assert_true(reserved > 0);
+
+    // Grow across classes and into the parent, contents have to carry over.
+    for (int i = 0; i < 1000; i++)
+    {
+        size_t size = 1 + (i % 200);
+        allocs[i] = loom_allocator_sizeClassRealloc(sizeClass, allocs[i], size, size + 100);
+        assert_true(allocs[i] != NULL);
+        for (size_t j = 0; j < size; j++)
+        {
+            assert_true(((unsigned char *)allocs[i])[j] == (i & 0xFF));
+        }
+    }
+
+    for (int i = 0; i < 1000; i++)
+    {
+        loom_allocator_sizeClassRealloc(sizeClass, allocs[i], 1 + (i % 200) + 100, 0);
+    }
+
+    loom_allocator_getSizeClassStats(sizeClass, &bytes, &count, NULL);
+    assert_int_equal((int)count, 0);
+    assert_int_equal((int)bytes, 0);
+
+    // Only the slabs are left with the parent, and go on destroy.
+    loom_allocator_destroySizeClassAllocator(sizeClass);
+
+    loom_allocator_getTrackerProxyStats(tracker, &bytes, &count);
+    assert_int_equal((int)count, 0);
+    assert_int_equal((int)bytes, 0);
+
+    loom_allocator_destroy(tracker);
+}
+
+
+static int findAllocatorTag(const char *tag, loom_allocatorTagStats_t *stats)
+{
+    for (int i = 0; i < loom_allocator_getTagCount(); i++)
+    {
+        if (loom_allocator_getTagStats(i, stats) && !strcmp(stats->tag, tag))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+SEATEST_TEST(allocator_tagged)
+{
+    loom_allocatorTagStats_t stats;
+
+    loom_allocator_t *tagged = loom_allocator_getTaggedAllocator("test.tagged");
+
+    // One allocator per tag.
+    assert_true(tagged == loom_allocator_getTaggedAllocator("test.tagged"));
+    assert_true(tagged != loom_allocator_getTaggedAllocator("test.other"));
+
+    void *a = lmAlloc(tagged, 100);
+    void *b = lmAlloc(tagged, 300);
+    memset(a, 0xAB, 100);
+
+    assert_true(findAllocatorTag("test.tagged", &stats));
+    assert_int_equal((int)stats.liveBytes, 400);
+    assert_int_equal((int)stats.liveCount, 2);
+    assert_int_equal((int)stats.peakBytes, 400);
+
+    // A resize is accounted as a free and an allocation.
+    a = lmRealloc(tagged, a, 1000);
+    for (int i = 0; i < 100; i++)
+    {
+        assert_true(((unsigned char *)a)[i] == 0xAB);
+    }
+
+    findAllocatorTag("test.tagged", &stats);
+    assert_int_equal((int)stats.liveBytes, 1300);
+    assert_int_equal((int)stats.liveCount, 2);
+    assert_int_equal((int)stats.totalCount, 3);
+
+    lmFree(tagged, b);
+    lmFree(tagged, a);
+
+    // The peak outlives the blocks.
+    findAllocatorTag("test.tagged", &stats);
+    assert_int_equal((int)stats.liveBytes, 0);
+    assert_int_equal((int)stats.liveCount, 0);
+    assert_int_equal((int)stats.peakBytes, 1300);
+    assert_int_equal((int)stats.totalBytes, 1400);
+
+    // Other tags are left alone.
+    assert_true(findAllocatorTag("test.other", &stats));
+    assert_int_equal((int)stats.totalCount, 0);
+}
+
+
+SEATEST_TEST(allocator_frame)
+{
+    loom_allocator_t *tracker = loom_allocator_initializeTrackerProxyAllocator(loom_allocator_getGlobalHeap());
+    size_t           count, bytes, baseCount, used, overflow;
+
+    loom_allocator_t *frame = loom_allocator_initializeFrameAllocator(tracker, 4096);
+    loom_allocator_getTrackerProxyStats(tracker, NULL, &baseCount);
+
+    // 16 byte aligned blocks out of the buffer, freeing them does nothing.
+    unsigned char *a = (unsigned char *)lmAlloc(frame, 100);
+    unsigned char *b = (unsigned char *)lmAlloc(frame, 1);
+    assert_true(((size_t)a & 15) == 0);
+    assert_true(((size_t)b & 15) == 0);
+    memset(a, 0x5A, 100);
+    lmFree(frame, b);
+
+    // Growing copies the contents.
+    a = (unsigned char *)lmRealloc(frame, a, 200);
+    for (int i = 0; i < 100; i++)
+    {
+        assert_true(a[i] == 0x5A);
+    }
+
+    // Too big for the buffer, taken from the parent.
+    void *big = lmAlloc(frame, 8192);
+    memset(big, 0, 8192);
+    loom_allocator_getTrackerProxyStats(tracker, NULL, &count);
+    assert_int_equal((int)count, (int)baseCount + 1);
+
+    loom_allocator_advanceFrame(frame);
+    loom_allocator_getFrameAllocatorStats(frame, &used, &overflow);
+    assert_true(used > 300 && used < 4096);
+    assert_true(overflow >= 8192);
+
+    // The overflow is kept through the next frame, and freed after it.
+    loom_allocator_getTrackerProxyStats(tracker, NULL, &count);
+    assert_int_equal((int)count, (int)baseCount + 1);
+
+    loom_allocator_advanceFrame(frame);
+    loom_allocator_getTrackerProxyStats(tracker, NULL, &count);
+    assert_int_equal((int)count, (int)baseCount);
+    loom_allocator_getFrameAllocatorStats(frame, &used, &overflow);
+    assert_int_equal((int)used, 0);
+    assert_int_equal((int)overflow, 0);
+
+    loom_allocator_destroy(frame);
+    loom_allocator_getTrackerProxyStats(tracker, &bytes, &count);
+    assert_int_equal((int)count, 0);
+    assert_int_equal((int)bytes, 0);
+
+    loom_allocator_destroy(tracker);
+}
+
+
+// Allocates and frees blocks of 1 to 300 bytes, half of them freed by the
+// next thread over so blocks change threads.
+#define THREADCACHE_TEST_THREADS    4
+#define THREADCACHE_TEST_BLOCKS     4096
+#define THREADCACHE_TEST_ROUNDS     64
+
+static loom_allocator_t *gThreadCacheTestAllocator;
+static void             *gThreadCacheTestBlocks[THREADCACHE_TEST_THREADS][THREADCACHE_TEST_BLOCKS];
+static volatile int     gThreadCacheTestErrors;
+static volatile int     gThreadCacheTestArrived[THREADCACHE_TEST_ROUNDS * 2];
+
+static int __stdcall threadCacheTestFunc(void *param)
+{
+    int  index   = (int)(size_t)param;
+    void **own   = gThreadCacheTestBlocks[index];
+    void **other = gThreadCacheTestBlocks[(index + 1) % THREADCACHE_TEST_THREADS];
+
+    for (int round = 0; round < THREADCACHE_TEST_ROUNDS; round++)
+    {
+        for (int i = 0; i < THREADCACHE_TEST_BLOCKS; i++)
+        {
+            size_t size = 1 + (i * 7 + round) % 300;
+            own[i] = lmAlloc(gThreadCacheTestAllocator, size);
+            memset(own[i], index, size);
+        }
+
+        for (int i = 0; i < THREADCACHE_TEST_BLOCKS; i += 2)
+        {
+            if (*(unsigned char *)own[i] != index)
+            {
+                atomic_increment(&gThreadCacheTestErrors);
+            }
+            lmFree(gThreadCacheTestAllocator, own[i]);
+        }
+
+        // Wait for the others, then free the odd blocks of the next thread.
+        atomic_increment(&gThreadCacheTestArrived[round * 2]);
+        while (atomic_load32(&gThreadCacheTestArrived[round * 2]) < THREADCACHE_TEST_THREADS)
+        {
+            loom_thread_yield();
+        }
+
+        for (int i = 1; i < THREADCACHE_TEST_BLOCKS; i += 2)
+        {
+            if (*(unsigned char *)other[i] != (index + 1) % THREADCACHE_TEST_THREADS)
+            {
+                atomic_increment(&gThreadCacheTestErrors);
+            }
+            lmFree(gThreadCacheTestAllocator, other[i]);
+        }
+
+        atomic_increment(&gThreadCacheTestArrived[round * 2 + 1]);
+        while (atomic_load32(&gThreadCacheTestArrived[round * 2 + 1]) < THREADCACHE_TEST_THREADS)
+        {
+            loom_thread_yield();
+        }
+    }
+
+    loom_allocator_flushThreadCache(gThreadCacheTestAllocator);
+    return 0;
+}
+
+SEATEST_TEST(allocator_threadCache)
+{
+    ThreadHandle     threads[THREADCACHE_TEST_THREADS];
+    loom_allocator_t *tracker = loom_allocator_initializeTrackerProxyAllocator(loom_allocator_getGlobalHeap());
+    size_t           count, bytes;
+
+    gThreadCacheTestAllocator = loom_allocator_initializeThreadCacheAllocator(tracker);
+    gThreadCacheTestErrors    = 0;
+
+    // Realloc keeps contents across classes and into the parent.
+    unsigned char *data = (unsigned char *)lmAlloc(gThreadCacheTestAllocator, 10);
+    memset(data, 42, 10);
+    data = (unsigned char *)lmRealloc(gThreadCacheTestAllocator, data, 100);
+    data = (unsigned char *)lmRealloc(gThreadCacheTestAllocator, data, 1000);
+    data = (unsigned char *)lmRealloc(gThreadCacheTestAllocator, data, 2000);
+    for (int i = 0; i < 10; i++)
+    {
+        assert_int_equal(data[i], 42);
+    }
+    lmFree(gThreadCacheTestAllocator, data);
+
+    for (int i = 0; i < THREADCACHE_TEST_THREADS; i++)
+    {
+        threads[i] = loom_thread_start(threadCacheTestFunc, (void *)(size_t)i);
+    }
+
+    for (int i = 0; i < THREADCACHE_TEST_THREADS; i++)
+    {
+        loom_thread_join(threads[i]);
+    }
+
+    assert_int_equal(gThreadCacheTestErrors, 0);
+
+    // Only the slabs are left with the parent, and go on destroy.
+    loom_allocator_getTrackerProxyStats(tracker, &bytes, &count);
+    assert_true(bytes >= loom_allocator_getThreadCacheReservedBytes(gThreadCacheTestAllocator));
+
+    loom_allocator_destroy(gThreadCacheTestAllocator);
+
+    loom_allocator_getTrackerProxyStats(tracker, &bytes, &count);
+    assert_int_equal((int)count, 0);
+    assert_int_equal((int)bytes, 0);
+
+    loom_allocator_destroy(tracker);
+}
+
+#define THREADCACHE_BENCH_BLOCKS    1024
+#define THREADCACHE_BENCH_ROUNDS    1000
+
+static void *benchMallocAlloc(loom_allocator_t *thiz, size_t size, const char *file, int line)
+{
+    return malloc(size);
+}
+
+static void benchMallocFree(loom_allocator_t *thiz, void *ptr, const char *file, int line)
+{
+    free(ptr);
+}
+
+// Churns small blocks through an allocator, returns the nanoseconds taken.
+static double threadCacheBenchmark(loom_allocator_t *allocator)
+{
+    static void            *blocks[THREADCACHE_BENCH_BLOCKS];
+    loom_precision_timer_t timer = loom_startTimer();
+
+    for (int round = 0; round < THREADCACHE_BENCH_ROUNDS; round++)
+    {
+        for (int i = 0; i < THREADCACHE_BENCH_BLOCKS; i++)
+        {
+            blocks[i] = allocator->allocCall(allocator, 8 + (i * 13 + round) % 120, __FILE__, __LINE__);
+        }
+
+        for (int i = 0; i < THREADCACHE_BENCH_BLOCKS; i++)
+        {
+            allocator->freeCall(allocator, blocks[i], __FILE__, __LINE__);
+        }
+    }
+
+    double time = loom_readTimerNano(timer);
+    loom_destroyTimer(timer);
+    return time;
+}
+
+SEATEST_TEST(allocator_threadCacheBenchmark)
+{
+    // Called straight through the allocators, bypassing the global heap's
+    // debug proxy in debug builds.
+    loom_allocator_t system;
+    memset(&system, 0, sizeof(system));
+    system.allocCall = benchMallocAlloc;
+    system.freeCall  = benchMallocFree;
+
+    loom_allocator_t *je          = loom_allocator_initializeJemallocAllocator(loom_allocator_getGlobalHeap());
+    loom_allocator_t *threadCache = loom_allocator_initializeThreadCacheAllocator(je);
+
+    double systemTime      = threadCacheBenchmark(&system);
+    double jeTime          = threadCacheBenchmark(je);
+    double threadCacheTime = threadCacheBenchmark(threadCache);
+
+    double perOperation = 1.0 / (2.0 * THREADCACHE_BENCH_BLOCKS * THREADCACHE_BENCH_ROUNDS);
+    lmLogInfo(gAllocatorLogGroup, "Small block alloc+free, ns per call: malloc %.1f, jemalloc %.1f, thread cache %.1f",
+              systemTime * perOperation, jeTime * perOperation, threadCacheTime * perOperation);
+
+    loom_allocator_destroy(threadCache);
+    loom_allocator_destroy(je);
+}
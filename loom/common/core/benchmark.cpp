@@ -0,0 +1,396 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/common/core/benchmark.h"
+#include "loom/common/core/allocator.h"
+#include "loom/common/platform/platformTime.h"
+#include "loom/common/utils/utString.h"
+#include "loom/common/utils/utTypes.h"
+
+#include "jansson.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Runs are grown at most this far, a body doing nothing is not worth more
+#define BENCHMARK_MAX_ITERATIONS    (1 << 30)
+
+struct BenchmarkResult
+{
+    utString name;
+    bool     skipped;
+    int      iterations;
+    double   median;
+    double   mean;
+    double   deviation;
+    double   min;
+    double   max;
+};
+
+static loom_benchmarkOptions gOptions;
+
+static utArray<BenchmarkResult> gResults;
+
+static json_t *gBaseline = NULL;
+
+static unsigned long long gStart;
+static unsigned long long gElapsed;
+static bool gTiming;
+
+static const char *gSkipReason;
+
+static volatile const void *gSink;
+
+void loom_benchmark_defaultOptions(loom_benchmarkOptions *options)
+{
+    options->filter       = NULL;
+    options->samples      = 15;
+    options->sampleTime   = 0.02;
+    options->warmupTime   = 0.1;
+    options->outputPath   = NULL;
+    options->baselinePath = NULL;
+    options->tolerance    = 0.1;
+}
+
+
+void loom_benchmark_pauseTiming()
+{
+    if (gTiming)
+    {
+        gElapsed += platform_getNanoseconds() - gStart;
+        gTiming   = false;
+    }
+}
+
+
+void loom_benchmark_resumeTiming()
+{
+    if (!gTiming)
+    {
+        gStart  = platform_getNanoseconds();
+        gTiming = true;
+    }
+}
+
+
+void loom_benchmark_skip(const char *reason)
+{
+    gSkipReason = reason;
+}
+
+
+void loom_benchmark_doNotOptimize(const void *p)
+{
+    gSink = p;
+}
+
+
+// Nanoseconds the timed parts of iterations runs of func took
+static unsigned long long benchmarkTime(loom_benchmarkFunc func, int iterations)
+{
+    gElapsed = 0;
+    gTiming  = false;
+
+    loom_benchmark_resumeTiming();
+    func(iterations);
+    loom_benchmark_pauseTiming();
+
+    return gElapsed;
+}
+
+
+// Human readable time for ns nanoseconds
+static utString benchmarkFormatTime(double ns)
+{
+    if (ns < 1000.0)
+    {
+        return utStringFormat("%.2f ns", ns);
+    }
+
+    if (ns < 1000000.0)
+    {
+        return utStringFormat("%.2f us", ns / 1000.0);
+    }
+
+    if (ns < 1000000000.0)
+    {
+        return utStringFormat("%.2f ms", ns / 1000000.0);
+    }
+
+    return utStringFormat("%.2f s", ns / 1000000000.0);
+}
+
+
+static int compareDoubles(const void *a, const void *b)
+{
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+
+    return da < db ? -1 : (da > db ? 1 : 0);
+}
+
+
+void loom_benchmark_begin(const loom_benchmarkOptions *options)
+{
+    gOptions = *options;
+
+    if (gOptions.samples < 1)
+    {
+        gOptions.samples = 1;
+    }
+
+    gResults.clear();
+
+    if (gOptions.baselinePath)
+    {
+        json_error_t error;
+        gBaseline = json_load_file(gOptions.baselinePath, 0, &error);
+
+        if (!gBaseline)
+        {
+            printf("Unable to load the baseline %s: %s\n", gOptions.baselinePath, error.text);
+        }
+    }
+}
+
+
+void loom_benchmark_run(const char *name, loom_benchmarkFunc func)
+{
+    if (gOptions.filter && !strstr(name, gOptions.filter))
+    {
+        return;
+    }
+
+    BenchmarkResult result;
+    result.name       = name;
+    result.skipped    = false;
+    result.iterations = 0;
+    result.median     = result.mean = result.deviation = result.min = result.max = 0;
+
+    gSkipReason = NULL;
+
+    // Calibrate, growing by 10 while runs are far too short
+    const double sampleTime = gOptions.sampleTime * 1e9;
+
+    int iterations = 1;
+    unsigned long long elapsed = 0;
+
+    for ( ; ; )
+    {
+        elapsed = benchmarkTime(func, iterations);
+
+        if (gSkipReason || (elapsed >= sampleTime) || (iterations >= BENCHMARK_MAX_ITERATIONS / 10))
+        {
+            break;
+        }
+
+        iterations *= elapsed < sampleTime / 100 ? 10 : 2;
+    }
+
+    if (gSkipReason)
+    {
+        result.skipped = true;
+        gResults.push_back(result);
+        printf("%-44s skipped, %s\n", name, gSkipReason);
+        return;
+    }
+
+    // Scale the last run to the sample time
+    if (elapsed > 0)
+    {
+        double scaled = iterations * sampleTime / (double)elapsed;
+        iterations = scaled < 1 ? 1 : (scaled > BENCHMARK_MAX_ITERATIONS ? BENCHMARK_MAX_ITERATIONS : (int)scaled);
+    }
+
+    // Warm up caches, branch predictors and clocks
+    unsigned long long warmupEnd = platform_getNanoseconds() + (unsigned long long)(gOptions.warmupTime * 1e9);
+
+    do
+    {
+        benchmarkTime(func, iterations);
+    }
+    while (platform_getNanoseconds() < warmupEnd);
+
+    double *samples = (double *)lmAlloc(NULL, sizeof(double) * gOptions.samples);
+
+    for (int i = 0; i < gOptions.samples; i++)
+    {
+        samples[i] = benchmarkTime(func, iterations) / (double)iterations;
+    }
+
+    qsort(samples, gOptions.samples, sizeof(double), compareDoubles);
+
+    int n = gOptions.samples;
+
+    result.iterations = iterations;
+    result.min        = samples[0];
+    result.max        = samples[n - 1];
+    result.median     = (n & 1) ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+
+    double sum = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        sum += samples[i];
+    }
+
+    result.mean = sum / n;
+
+    double variance = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        variance += (samples[i] - result.mean) * (samples[i] - result.mean);
+    }
+
+    result.deviation = n > 1 ? sqrt(variance / (n - 1)) : 0;
+
+    lmFree(NULL, samples);
+
+    gResults.push_back(result);
+
+    printf("%-44s %12s +- %5.1f%%  [%s .. %s]  %d x %d\n", name,
+           benchmarkFormatTime(result.median).c_str(),
+           result.mean > 0 ? 100.0 * result.deviation / result.mean : 0.0,
+           benchmarkFormatTime(result.min).c_str(),
+           benchmarkFormatTime(result.max).c_str(),
+           n, iterations);
+}
+
+
+// Median of the benchmark called name in the baseline, 0 if it isn't there
+static double benchmarkBaselineMedian(const char *name)
+{
+    json_t *benchmarks = json_object_get(gBaseline, "benchmarks");
+
+    for (size_t i = 0; i < json_array_size(benchmarks); i++)
+    {
+        json_t *entry = json_array_get(benchmarks, i);
+
+        const char *entryName = json_string_value(json_object_get(entry, "name"));
+
+        if (entryName && !strcmp(entryName, name))
+        {
+            return json_number_value(json_object_get(entry, "median"));
+        }
+    }
+
+    return 0;
+}
+
+
+int loom_benchmark_end()
+{
+    int regressions = 0;
+
+    if (gBaseline)
+    {
+        printf("\nAgainst %s, changes over %.0f%%:\n", gOptions.baselinePath, gOptions.tolerance * 100);
+
+        int improvements = 0;
+
+        for (UTsize i = 0; i < gResults.size(); i++)
+        {
+            const BenchmarkResult& result = gResults[i];
+
+            double baseline = benchmarkBaselineMedian(result.name.c_str());
+
+            if (result.skipped || (baseline <= 0))
+            {
+                continue;
+            }
+
+            double change = result.median / baseline - 1;
+
+            if (fabs(change) <= gOptions.tolerance)
+            {
+                continue;
+            }
+
+            // A change within the spread of the samples is noise
+            if (fabs(result.median - baseline) <= result.deviation * 2)
+            {
+                continue;
+            }
+
+            printf("%-44s %12s -> %12s  %+.1f%% %s\n", result.name.c_str(),
+                   benchmarkFormatTime(baseline).c_str(),
+                   benchmarkFormatTime(result.median).c_str(),
+                   change * 100, change > 0 ? "REGRESSED" : "improved");
+
+            if (change > 0)
+            {
+                regressions++;
+            }
+            else
+            {
+                improvements++;
+            }
+        }
+
+        printf("%d regressed, %d improved\n", regressions, improvements);
+
+        json_decref(gBaseline);
+        gBaseline = NULL;
+    }
+
+    if (gOptions.outputPath)
+    {
+        json_t *benchmarks = json_array();
+
+        for (UTsize i = 0; i < gResults.size(); i++)
+        {
+            const BenchmarkResult& result = gResults[i];
+
+            if (result.skipped)
+            {
+                continue;
+            }
+
+            json_t *entry = json_object();
+            json_object_set_new(entry, "name", json_string(result.name.c_str()));
+            json_object_set_new(entry, "iterations", json_integer(result.iterations));
+            json_object_set_new(entry, "samples", json_integer(gOptions.samples));
+            json_object_set_new(entry, "median", json_real(result.median));
+            json_object_set_new(entry, "mean", json_real(result.mean));
+            json_object_set_new(entry, "deviation", json_real(result.deviation));
+            json_object_set_new(entry, "min", json_real(result.min));
+            json_object_set_new(entry, "max", json_real(result.max));
+            json_array_append_new(benchmarks, entry);
+        }
+
+        json_t *root = json_object();
+        json_object_set_new(root, "unit", json_string("ns"));
+        json_object_set_new(root, "benchmarks", benchmarks);
+
+        if (json_dump_file(root, gOptions.outputPath, JSON_INDENT(2)) != 0)
+        {
+            printf("Unable to write the results to %s\n", gOptions.outputPath);
+        }
+
+        json_decref(root);
+    }
+
+    gResults.clear();
+
+    return regressions;
+}
@@ -0,0 +1,97 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _CORE_BENCHMARK_H_
+#define _CORE_BENCHMARK_H_
+
+/**
+ * Native micro-benchmarks, run by the nativebenchmark tool and laid out
+ * like the seatest unit tests: BENCHMARK bodies are listed in fixtures,
+ * fixtures in the allBenchmarks suite.
+ *
+ * A body is handed a number of iterations and does its work that many
+ * times. Every benchmark is calibrated first, growing the iterations until
+ * a run takes sampleTime, then warmed up, then timed over a number of
+ * samples. The median, mean, deviation and range of the time per
+ * iteration are reported, optionally written as JSON, and compared with
+ * the medians of a baseline written by an earlier run.
+ */
+
+typedef void (*loom_benchmarkFunc)(int iterations);
+
+typedef struct loom_benchmarkOptions
+{
+    const char *filter;         // only benchmarks with this in their name run
+    int        samples;         // timed runs of each benchmark
+    double     sampleTime;      // seconds a timed run is calibrated to take
+    double     warmupTime;      // seconds of untimed runs before the samples
+    const char *outputPath;     // the results are written here as JSON
+    const char *baselinePath;   // results to compare against
+    double     tolerance;       // relative change of a median that counts
+} loom_benchmarkOptions;
+
+void loom_benchmark_defaultOptions(loom_benchmarkOptions *options);
+
+void loom_benchmark_begin(const loom_benchmarkOptions *options);
+
+void loom_benchmark_run(const char *name, loom_benchmarkFunc func);
+
+/**
+ * Prints the summary and writes the results, returns the number of
+ * benchmarks that regressed against the baseline.
+ */
+int loom_benchmark_end();
+
+/**
+ * Excludes setup inside a body from the time.
+ */
+void loom_benchmark_pauseTiming();
+void loom_benchmark_resumeTiming();
+
+/**
+ * Called from a body that can't run here, ie, without a GL context. The
+ * benchmark is reported as skipped.
+ */
+void loom_benchmark_skip(const char *reason);
+
+/**
+ * Keeps the compiler from optimizing away the computation of a result
+ * nothing else reads.
+ */
+void loom_benchmark_doNotOptimize(const void *p);
+
+#define BENCHMARK(name) \
+    void benchmark_impl_ ## name(int iterations)
+
+#define BENCHMARK_FIXTURE(fixtureName) \
+    void benchmark_fixture_ ## fixtureName()
+
+#define BENCHMARK_FIXTURE_ENTRY(name) \
+    void benchmark_impl_ ## name(int iterations); \
+    loom_benchmark_run(#name, benchmark_impl_ ## name)
+
+#define BENCHMARK_SUITE(suiteName) \
+    void benchmark_suite_ ## suiteName()
+
+#define BENCHMARK_SUITE_ENTRY(fixtureName) \
+    extern void benchmark_fixture_ ## fixtureName(); \
+    benchmark_fixture_ ## fixtureName()
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <math.h>
+
+#include "loom/common/core/framePacer.h"
+#include "loom/common/platform/platformThread.h"
+#include "loom/common/platform/platformTime.h"
+
+// Assumed until the display reports its rate.
+static const double DEFAULT_PERIOD = 1e9 / 60;
+
+// Intervals this close to one refresh count towards the learned period,
+// which is kept this close to the nominal one.
+static const double PERIOD_TOLERANCE = 0.12;
+
+// How fast the learned period follows the measured one.
+static const double PERIOD_SMOOTHING = 0.05;
+
+// How fast the paced time follows the actual present time.
+static const double PHASE_SMOOTHING = 0.02;
+
+FramePacer::FramePacer()
+{
+    nominalPeriod = DEFAULT_PERIOD;
+    period = DEFAULT_PERIOD;
+    unlocked = false;
+    reset();
+}
+
+void FramePacer::setUnlocked(bool value)
+{
+    unlocked = value;
+    reset();
+}
+
+void FramePacer::setRefreshRate(int hz)
+{
+    double nominal = hz > 0 ? 1e9 / hz : DEFAULT_PERIOD;
+
+    if (nominal == nominalPeriod) return;
+
+    nominalPeriod = nominal;
+    period = nominal;
+}
+
+void FramePacer::reset()
+{
+    lastPresent = 0;
+    frameTime = 0;
+    frameDelta = period;
+    frameRefreshes = 1;
+    started = false;
+}
+
+void FramePacer::framePresented(unsigned long long now)
+{
+    double present = (double)now;
+
+    if (!started)
+    {
+        started = true;
+        lastPresent = present;
+        frameTime = present;
+        frameDelta = period;
+        frameRefreshes = 1;
+        return;
+    }
+
+    double interval = present - lastPresent;
+    lastPresent = present;
+
+    if (unlocked)
+    {
+        frameDelta = present - frameTime;
+        frameTime = present;
+        frameRefreshes = 1;
+        return;
+    }
+
+    // Learn the actual period, displays are rarely exactly their nominal rate
+    if (fabs(interval - period) < period * PERIOD_TOLERANCE)
+    {
+        period += (interval - period) * PERIOD_SMOOTHING;
+
+        double low = nominalPeriod * (1 - PERIOD_TOLERANCE);
+        double high = nominalPeriod * (1 + PERIOD_TOLERANCE);
+        if (period < low) period = low;
+        if (period > high) period = high;
+    }
+
+    // Whole refreshes since the last paced frame time, which stays within
+    // half a refresh of the actual present time, so frames that fall
+    // between refreshes still add up to the time that actually passed
+    int refreshes = (int)floor((present - frameTime) / period + 0.5);
+    if (refreshes < 1) refreshes = 1;
+
+    double paced = frameTime + refreshes * period;
+
+    // Pull the phase gently towards the actual present time, so an error in
+    // the learned period can't walk it onto a refresh boundary where noise
+    // flips frames between refresh counts
+    paced += (present - paced) * PHASE_SMOOTHING;
+
+    frameDelta = paced - frameTime;
+    frameTime = paced;
+    frameRefreshes = refreshes;
+}
+
+unsigned long long FramePacer::getTimeToNextVSync(unsigned long long now) const
+{
+    if (!started || unlocked) return 0;
+
+    double remaining = lastPresent + period - (double)now;
+
+    return remaining > 0 ? (unsigned long long)remaining : 0;
+}
+
+void FramePacer::waitForNextVSync() const
+{
+    unsigned long long remaining = getTimeToNextVSync(platform_getNanoseconds());
+
+    // Sleep is only good to about a millisecond, so sleep short and yield
+    // out the rest
+    if (remaining > 2000000)
+    {
+        loom_thread_sleep((int)(remaining / 1000000) - 1);
+    }
+
+    while (getTimeToNextVSync(platform_getNanoseconds()) > 0)
+    {
+        loom_thread_yield();
+    }
+}
@@ -0,0 +1,106 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _CORE_FRAMEPACER_H_
+#define _CORE_FRAMEPACER_H_
+
+/**
+ * Paces frames against the display refresh.
+ *
+ * Frames are timestamped as they are presented and the refresh period is
+ * learned from the intervals that land near one refresh. The frame time
+ * handed to gameplay then advances in whole refresh periods, so that a
+ * frame on screen for one refresh always moves things by exactly one
+ * refresh worth of time. Timer noise around the swap would otherwise read
+ * as uneven motion, judder, at a perfectly steady frame rate.
+ *
+ * Where nothing blocks on vsync, frames skipped unchanged or a swap that
+ * returns right away, waitForNextVSync sleeps to the next refresh instead.
+ */
+class FramePacer
+{
+public:
+
+    FramePacer();
+
+    /**
+     * The nominal refresh rate of the display in Hz, 0 when unknown. The
+     * learned period is kept near it.
+     */
+    void setRefreshRate(int hz);
+
+    /**
+     * Marks a frame presented at now, platform_getNanoseconds time, and
+     * advances the paced frame time.
+     */
+    void framePresented(unsigned long long now);
+
+    /**
+     * Frames that aren't shown on a display, rendered offscreen as fast as
+     * they can be, aren't paced: the frame time follows the present times
+     * as they are and nothing waits for a refresh.
+     */
+    void setUnlocked(bool unlocked);
+    bool getUnlocked() const { return unlocked; }
+
+    /**
+     * Starts over, the next frame is timed afresh, after a pause for one.
+     */
+    void reset();
+
+    /**
+     * Nanoseconds from now to the refresh after the last presented frame,
+     * 0 when that's already passed.
+     */
+    unsigned long long getTimeToNextVSync(unsigned long long now) const;
+
+    /**
+     * Sleeps until the refresh after the last presented frame.
+     */
+    void waitForNextVSync() const;
+
+    // Paced time of the last frame and the time since the one before,
+    // in milliseconds.
+    double getFrameTime() const { return frameTime / 1e6; }
+    double getFrameDelta() const { return frameDelta / 1e6; }
+
+    // How many refreshes the last frame was on screen for.
+    int getFrameRefreshes() const { return frameRefreshes; }
+
+    // The learned refresh period in milliseconds, and as a rate in Hz.
+    double getRefreshPeriod() const { return period / 1e6; }
+    double getRefreshRate() const { return 1e9 / period; }
+
+private:
+
+    double nominalPeriod;
+
+    // In nanoseconds
+    double period;
+    double lastPresent;
+    double frameTime;
+    double frameDelta;
+
+    int frameRefreshes;
+    bool started;
+    bool unlocked;
+};
+
+#endif
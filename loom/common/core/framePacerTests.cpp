@@ -0,0 +1,120 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/common/core/framePacer.h"
+#include "seatest.h"
+
+SEATEST_FIXTURE(framePacer)
+{
+    SEATEST_FIXTURE_ENTRY(framePacer_jitter);
+    SEATEST_FIXTURE_ENTRY(framePacer_dropped);
+    SEATEST_FIXTURE_ENTRY(framePacer_uneven);
+    SEATEST_FIXTURE_ENTRY(framePacer_unlocked);
+}
+
+static const unsigned long long REFRESH = 16666667;
+
+SEATEST_TEST(framePacer_jitter)
+{
+    FramePacer pacer;
+    pacer.setRefreshRate(60);
+
+    // Presents on every refresh, give or take a millisecond of timer noise
+    static const int noise[] = { 0, 900000, -800000, 400000, -1000000, 700000, 0, -300000 };
+    for (int i = 0; i < 64; i++)
+    {
+        pacer.framePresented(1000000000ULL + i * REFRESH + noise[i % 8]);
+
+        if (i > 0)
+        {
+            assert_int_equal(1, pacer.getFrameRefreshes());
+            assert_double_equal(16.667, pacer.getFrameDelta(), 0.1);
+        }
+    }
+
+    assert_double_equal(60, pacer.getRefreshRate(), 0.5);
+}
+
+
+SEATEST_TEST(framePacer_dropped)
+{
+    FramePacer pacer;
+    pacer.setRefreshRate(60);
+
+    unsigned long long t = 1000000000ULL;
+    pacer.framePresented(t);
+
+    // A frame that missed a refresh moves time on by exactly two
+    t += 2 * REFRESH + 500000;
+    pacer.framePresented(t);
+    assert_int_equal(2, pacer.getFrameRefreshes());
+    assert_double_equal(33.333, pacer.getFrameDelta(), 0.1);
+
+    assert_true(pacer.getTimeToNextVSync(t) > REFRESH - 1000);
+    assert_true(pacer.getTimeToNextVSync(t + REFRESH) == 0);
+}
+
+
+SEATEST_TEST(framePacer_uneven)
+{
+    FramePacer pacer;
+    pacer.setRefreshRate(60);
+
+    // Frames between one and two refreshes long are paced to whole
+    // refreshes that add up to the time that passed
+    unsigned long long t = 1000000000ULL;
+    pacer.framePresented(t);
+
+    double total = 0;
+    for (int i = 0; i < 100; i++)
+    {
+        t += 24000000;
+        pacer.framePresented(t);
+
+        assert_true(pacer.getFrameRefreshes() == 1 || pacer.getFrameRefreshes() == 2);
+        total += pacer.getFrameDelta();
+    }
+
+    assert_double_equal(2400, total, 10);
+
+    // As is a long stall
+    t += 1000000000ULL;
+    pacer.framePresented(t);
+    assert_double_equal(1000, pacer.getFrameDelta(), 9);
+}
+
+
+SEATEST_TEST(framePacer_unlocked)
+{
+    FramePacer pacer;
+    pacer.setRefreshRate(60);
+    pacer.setUnlocked(true);
+
+    // Frames far shorter than a refresh move time on by what they took
+    unsigned long long t = 1000000000ULL;
+    pacer.framePresented(t);
+
+    t += 2000000;
+    pacer.framePresented(t);
+    assert_int_equal(1, pacer.getFrameRefreshes());
+    assert_double_equal(2, pacer.getFrameDelta(), 0.001);
+
+    assert_true(pacer.getTimeToNextVSync(t) == 0);
+}
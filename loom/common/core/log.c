@@ -20,6 +20,7 @@
 
 #include <stdio.h>
 #include "loom/common/platform/platform.h"
+#include "loom/common/platform/platformThread.h"
 #include "loom/common/core/log.h"
 #include "loom/common/core/assert.h"
 #include "loom/common/core/allocator.h"
@@ -62,6 +63,84 @@ static int              gLoomLogInvalidationToken = 1;
 static loom_allocator_t *gLoggerAllocator         = NULL;
 static loom_logLevel_t globalLevel                = LoomLogInfo;
 
+// Guards the listener list while messages are dispatched, recursive so
+// listeners may log themselves.
+static MutexHandle  gListenerMutex     = NULL;
+static volatile int gDispatchingThread = 0;
+
+// Messages are formatted into a stack buffer of this size, only longer
+// ones are allocated.
+#define LOOM_LOG_STACKBUFFER    1024
+
+/*
+ * Async logging, see loom_log_setAsync. Messages are queued in a byte ring
+ * as a loom_log_record_t followed by the NUL terminated message, and handed
+ * to the listeners by the log thread. Messages which don't fit in the ring
+ * are dropped and counted.
+ */
+#define LOOM_LOG_QUEUESIZE      (256 * 1024)
+#define LOOM_LOG_MAXQUEUED      (LOOM_LOG_QUEUESIZE / 4)
+
+typedef struct loom_log_record
+{
+    loom_logGroup_t *group;
+    loom_logLevel_t level;
+    int             length; // including the NUL
+} loom_log_record_t;
+
+static volatile int    gLogAsync       = 0;
+static ThreadHandle    gLogThread      = NULL;
+static SemaphoreHandle gLogSemaphore;
+static MutexHandle     gQueueMutex     = NULL;
+static unsigned char   *gQueue         = NULL;
+static int             gQueueHead      = 0;
+static int             gQueueTail      = 0;
+static int             gQueueUsed      = 0;
+static volatile int    gQueueWritten   = 0;
+static volatile int    gQueueDelivered = 0;
+static volatile int    gLogDropped     = 0;
+
+/*
+ * Binary logging, see loom_log_setBinary. Writers claim records in the ring
+ * by counting up gBinaryHead; a record's sequence is its index + 1 once
+ * written and 0 while it is, so a viewer can tell records being rewritten.
+ */
+typedef enum loom_log_argKind
+{
+    LoomLogArgNone,
+    LoomLogArgInt,
+    LoomLogArgLong,
+    LoomLogArgLongLong,
+    LoomLogArgSize,
+    LoomLogArgDouble,
+    LoomLogArgLongDouble,
+    LoomLogArgPointer,
+    LoomLogArgString
+} loom_log_argKind_t;
+
+typedef union loom_log_binaryArg
+{
+    long long  i;       // also the offset of %s arguments in strings
+    double     d;
+    const void *p;
+} loom_log_binaryArg_t;
+
+typedef struct loom_log_binaryRecord
+{
+    volatile int         sequence;
+    loom_logGroup_t      *group;
+    loom_logLevel_t      level;
+    const char           *format;
+    loom_log_binaryArg_t args[LOOM_LOG_BINARY_MAXARGS];
+    char                 strings[LOOM_LOG_BINARY_STRINGBYTES];
+} loom_log_binaryRecord_t;
+
+static volatile int            gLogBinary      = 0;
+static loom_log_binaryRecord_t *gBinaryRecords = NULL;
+static volatile int            gBinaryHead     = 0;
+static unsigned int            gBinaryViewed   = 0;
+static MutexHandle             gBinaryMutex    = NULL;
+
 static void platformDebugListener(void *payload, loom_logGroup_t *group, loom_logLevel_t level, const char *msg)
 {
     // TODO: Don't need to reprint the msg. platform_debugOut has printf semantics
@@ -80,6 +159,11 @@ void loom_log_initialize()
     // Get our allocator.
     gLoggerAllocator = loom_allocator_getGlobalHeap();
 
+    if (gListenerMutex == NULL)
+    {
+        gListenerMutex = loom_mutex_create();
+    }
+
     // And make sure we'll log SOMETHING.
     if (listenerHead == NULL)
     {
@@ -107,9 +191,19 @@ void loom_log_addListener(loom_logListener_t listener, void *payload)
     entry->callback = listener;
     entry->payload  = payload;
 
+    if (gListenerMutex)
+    {
+        loom_mutex_lock(gListenerMutex);
+    }
+
     // Link it on the list.
     entry->next  = listenerHead;
     listenerHead = entry;
+
+    if (gListenerMutex)
+    {
+        loom_mutex_unlock(gListenerMutex);
+    }
 }
 
 
@@ -119,6 +213,11 @@ void loom_log_removeListener(loom_logListener_t listener, void *payload)
     loom_log_listenerEntry_t **entry = &listenerHead;
     loom_log_listenerEntry_t *cur    = NULL;
 
+    if (gListenerMutex)
+    {
+        loom_mutex_lock(gListenerMutex);
+    }
+
     do
     {
         cur = *entry;
@@ -137,9 +236,19 @@ void loom_log_removeListener(loom_logListener_t listener, void *payload)
         // Got it! Unlink and free.
         *entry = cur->next;
         lmFree(NULL, cur);
+
+        if (gListenerMutex)
+        {
+            loom_mutex_unlock(gListenerMutex);
+        }
         return;
     } while ((entry = &((*entry)->next)));
 
+    if (gListenerMutex)
+    {
+        loom_mutex_unlock(gListenerMutex);
+    }
+
     lmAssert(0, "Could not find listener to remove.");
 }
 
@@ -167,12 +276,559 @@ char* loom_log_getArgs(va_list args, const char **format) {
     return buff;
 }
 
+static void loom_log_dispatch(loom_logGroup_t *group, loom_logLevel_t level, const char *msg)
+{
+    loom_log_listenerEntry_t *listener;
+    int previousThread;
+
+    if (gListenerMutex)
+    {
+        loom_mutex_lock(gListenerMutex);
+    }
+
+    previousThread     = gDispatchingThread;
+    gDispatchingThread = platform_getCurrentThreadId();
+
+    // Walk the listeners and output.
+    for (listener = listenerHead; listener; listener = listener->next)
+    {
+        listener->callback(listener->payload, group, level, msg);
+    }
+
+    gDispatchingThread = previousThread;
+
+    if (gListenerMutex)
+    {
+        loom_mutex_unlock(gListenerMutex);
+    }
+}
+
+
+// Copies in and out of the ring, wrapping as needed. Queue lock held.
+static void loom_log_queueWrite(const void *data, int length)
+{
+    int first = LOOM_LOG_QUEUESIZE - gQueueHead;
+
+    if (first > length)
+    {
+        first = length;
+    }
+
+    memcpy(gQueue + gQueueHead, data, first);
+    memcpy(gQueue, (const unsigned char *)data + first, length - first);
+
+    gQueueHead  = (gQueueHead + length) % LOOM_LOG_QUEUESIZE;
+    gQueueUsed += length;
+}
+
+
+static void loom_log_queueRead(void *data, int length)
+{
+    int first = LOOM_LOG_QUEUESIZE - gQueueTail;
+
+    if (first > length)
+    {
+        first = length;
+    }
+
+    memcpy(data, gQueue + gQueueTail, first);
+    memcpy((unsigned char *)data + first, gQueue, length - first);
+
+    gQueueTail  = (gQueueTail + length) % LOOM_LOG_QUEUESIZE;
+    gQueueUsed -= length;
+}
+
+
+static int loom_log_enqueue(loom_logGroup_t *group, loom_logLevel_t level, const char *msg, int length)
+{
+    loom_log_record_t record;
+
+    record.group  = group;
+    record.level  = level;
+    record.length = length + 1;
+
+    loom_mutex_lock(gQueueMutex);
+
+    if (gQueueUsed + (int)sizeof(record) + record.length > LOOM_LOG_QUEUESIZE)
+    {
+        loom_mutex_unlock(gQueueMutex);
+        atomic_increment(&gLogDropped);
+        return 0;
+    }
+
+    loom_log_queueWrite(&record, sizeof(record));
+    loom_log_queueWrite(msg, record.length);
+
+    atomic_increment(&gQueueWritten);
+
+    loom_mutex_unlock(gQueueMutex);
+
+    loom_semaphore_post(gLogSemaphore);
+    return 1;
+}
+
+
+static int __stdcall loom_log_threadFunc(void *param)
+{
+    char              *buffer  = (char *)lmAlloc(gLoggerAllocator, LOOM_LOG_MAXQUEUED);
+    int               reported = 0;
+    loom_log_record_t record;
+
+    loom_thread_setDebugName("Loom Log");
+
+    for ( ; ; )
+    {
+        loom_semaphore_wait(gLogSemaphore);
+
+        loom_mutex_lock(gQueueMutex);
+
+        if (gQueueUsed == 0)
+        {
+            // Only loom_log_setAsync posts without a message, to stop us.
+            loom_mutex_unlock(gQueueMutex);
+            break;
+        }
+
+        loom_log_queueRead(&record, sizeof(record));
+        loom_log_queueRead(buffer, record.length);
+
+        loom_mutex_unlock(gQueueMutex);
+
+        loom_log_dispatch(record.group, record.level, buffer);
+
+        atomic_increment(&gQueueDelivered);
+
+        if (atomic_load32(&gLogDropped) != reported)
+        {
+            reported = atomic_load32(&gLogDropped);
+            snprintf(buffer, LOOM_LOG_MAXQUEUED, "%10s  Dropped log messages, %d in total, the log queue was full", gLogLogGroup.name, reported);
+            loom_log_dispatch(&gLogLogGroup, LoomLogWarn, buffer);
+        }
+    }
+
+    lmFree(gLoggerAllocator, buffer);
+    return 0;
+}
+
+
+static int loom_log_isDispatchingThread()
+{
+    return gDispatchingThread != 0 && gDispatchingThread == platform_getCurrentThreadId();
+}
+
+
+void loom_log_flush()
+{
+    int written;
+
+    // The log thread, or a listener, can't wait on itself.
+    if (!gLogAsync || loom_log_isDispatchingThread())
+    {
+        return;
+    }
+
+    written = atomic_load32(&gQueueWritten);
+
+    while (atomic_load32(&gQueueDelivered) - written < 0)
+    {
+        loom_thread_yield();
+    }
+}
+
+
+void loom_log_setAsync(int enabled)
+{
+    enabled = enabled ? 1 : 0;
+
+    if (enabled == gLogAsync)
+    {
+        return;
+    }
+
+    if (enabled)
+    {
+        if (gListenerMutex == NULL)
+        {
+            gListenerMutex = loom_mutex_create();
+        }
+
+        if (gQueue == NULL)
+        {
+            gQueue        = (unsigned char *)lmAlloc(gLoggerAllocator, LOOM_LOG_QUEUESIZE);
+            gQueueMutex   = loom_mutex_create();
+            gLogSemaphore = loom_semaphore_create();
+        }
+
+        gLogThread = loom_thread_startWithHint(loom_log_threadFunc, NULL, LOOM_THREAD_BACKGROUND);
+        atomic_store32(&gLogAsync, 1);
+        return;
+    }
+
+    // Deliver what is queued, then stop the thread.
+    loom_log_flush();
+    atomic_store32(&gLogAsync, 0);
+
+    loom_semaphore_post(gLogSemaphore);
+    loom_thread_join(gLogThread);
+    gLogThread = NULL;
+}
+
+
+int loom_log_getDroppedCount()
+{
+    return atomic_load32(&gLogDropped);
+}
+
+
+// Parses the conversion spec starting at the '%', returns where it ends or
+// NULL if binary logging doesn't support it.
+static const char *loom_log_parseSpec(const char *spec, loom_log_argKind_t *kind)
+{
+    int longs = 0;
+
+    spec++;
+
+    if (*spec == '%')
+    {
+        *kind = LoomLogArgNone;
+        return spec + 1;
+    }
+
+    // Flags, width and precision; '*' would take arguments of its own.
+    while (*spec && strchr("-+ #0123456789.", *spec))
+    {
+        spec++;
+    }
+
+    // Length.
+    *kind = LoomLogArgInt;
+
+    for ( ; *spec && strchr("hlLzjtq", *spec); spec++)
+    {
+        switch (*spec)
+        {
+        case 'l':
+            longs++;
+            *kind = longs > 1 ? LoomLogArgLongLong : LoomLogArgLong;
+            break;
+
+        case 'q':
+        case 'j':
+            *kind = LoomLogArgLongLong;
+            break;
+
+        case 'z':
+        case 't':
+            *kind = LoomLogArgSize;
+            break;
+
+        case 'L':
+            *kind = LoomLogArgLongDouble;
+            break;
+        }
+    }
+
+    switch (*spec)
+    {
+    case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+        if (*kind == LoomLogArgLongDouble)
+        {
+            *kind = LoomLogArgLongLong;
+        }
+        break;
+
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        if (*kind != LoomLogArgLongDouble)
+        {
+            *kind = LoomLogArgDouble;
+        }
+        break;
+
+    case 'p':
+        *kind = LoomLogArgPointer;
+        break;
+
+    case 's':
+        *kind = LoomLogArgString;
+        break;
+
+    default:
+        return NULL;
+    }
+
+    return spec + 1;
+}
+
+
+// Returns 0, without recording, if the format isn't supported.
+static int loom_log_recordBinary(loom_logGroup_t *group, loom_logLevel_t level, const char *format, va_list args)
+{
+    loom_log_binaryArg_t    values[LOOM_LOG_BINARY_MAXARGS];
+    char                    strings[LOOM_LOG_BINARY_STRINGBYTES];
+    int                     count = 0;
+    int                     used  = 0;
+    const char              *c    = format;
+    loom_log_argKind_t      kind;
+    unsigned int            index;
+    loom_log_binaryRecord_t *record;
+
+    // Take the arguments first, only claim a record once they're known.
+    while (*c)
+    {
+        if (*c != '%')
+        {
+            c++;
+            continue;
+        }
+
+        c = loom_log_parseSpec(c, &kind);
+
+        if (!c || ((kind != LoomLogArgNone) && (count == LOOM_LOG_BINARY_MAXARGS)))
+        {
+            return 0;
+        }
+
+        switch (kind)
+        {
+        case LoomLogArgNone:
+            break;
+
+        case LoomLogArgInt:
+            values[count++].i = va_arg(args, int);
+            break;
+
+        case LoomLogArgLong:
+            values[count++].i = va_arg(args, long);
+            break;
+
+        case LoomLogArgLongLong:
+            values[count++].i = va_arg(args, long long);
+            break;
+
+        case LoomLogArgSize:
+            values[count++].i = (long long)va_arg(args, size_t);
+            break;
+
+        case LoomLogArgDouble:
+            values[count++].d = va_arg(args, double);
+            break;
+
+        case LoomLogArgLongDouble:
+            values[count++].d = (double)va_arg(args, long double);
+            break;
+
+        case LoomLogArgPointer:
+            values[count++].p = va_arg(args, void *);
+            break;
+
+        case LoomLogArgString:
+        {
+            const char *str = va_arg(args, const char *);
+            int        length;
+
+            if (used == LOOM_LOG_BINARY_STRINGBYTES)
+            {
+                // Out of room, it'll show up empty.
+                values[count++].i = -1;
+                break;
+            }
+
+            str    = str ? str : "(null)";
+            length = (int)strlen(str);
+
+            if (length > LOOM_LOG_BINARY_STRINGBYTES - used - 1)
+            {
+                length = LOOM_LOG_BINARY_STRINGBYTES - used - 1;
+            }
+
+            memcpy(strings + used, str, length);
+            strings[used + length] = 0;
+
+            values[count++].i = used;
+            used += length + 1;
+            break;
+        }
+        }
+    }
+
+    index  = (unsigned int)atomic_increment(&gBinaryHead) - 1;
+    record = &gBinaryRecords[index & (LOOM_LOG_BINARY_RECORDS - 1)];
+
+    atomic_store32(&record->sequence, 0);
+
+    record->group  = group;
+    record->level  = level;
+    record->format = format;
+    memcpy(record->args, values, count * sizeof(loom_log_binaryArg_t));
+    memcpy(record->strings, strings, used);
+
+    atomic_store32(&record->sequence, (int)(index + 1));
+    return 1;
+}
+
+
+static void loom_log_formatBinary(const loom_log_binaryRecord_t *record, char *buffer, int size)
+{
+    const char           *c   = record->format;
+    int                  arg  = 0;
+    int                  used = 0;
+    const char           *spec;
+    char                 specBuffer[32];
+    int                  written;
+    loom_log_argKind_t   kind;
+    loom_log_binaryArg_t value;
+
+    while (*c && (used < size - 1))
+    {
+        if (*c != '%')
+        {
+            buffer[used++] = *c++;
+            continue;
+        }
+
+        // Supported, it was checked when recorded.
+        spec = c;
+        c    = loom_log_parseSpec(c, &kind);
+
+        if (kind == LoomLogArgNone)
+        {
+            buffer[used++] = '%';
+            continue;
+        }
+
+        written = (int)(c - spec) < (int)sizeof(specBuffer) - 1 ? (int)(c - spec) : (int)sizeof(specBuffer) - 1;
+        memcpy(specBuffer, spec, written);
+        specBuffer[written] = 0;
+
+        value = record->args[arg++];
+
+        switch (kind)
+        {
+        case LoomLogArgInt:
+            written = snprintf(buffer + used, size - used, specBuffer, (int)value.i);
+            break;
+
+        case LoomLogArgLong:
+            written = snprintf(buffer + used, size - used, specBuffer, (long)value.i);
+            break;
+
+        case LoomLogArgLongLong:
+            written = snprintf(buffer + used, size - used, specBuffer, value.i);
+            break;
+
+        case LoomLogArgSize:
+            written = snprintf(buffer + used, size - used, specBuffer, (size_t)value.i);
+            break;
+
+        case LoomLogArgDouble:
+            written = snprintf(buffer + used, size - used, specBuffer, value.d);
+            break;
+
+        case LoomLogArgLongDouble:
+            written = snprintf(buffer + used, size - used, specBuffer, (long double)value.d);
+            break;
+
+        case LoomLogArgPointer:
+            written = snprintf(buffer + used, size - used, specBuffer, value.p);
+            break;
+
+        default:
+            written = snprintf(buffer + used, size - used, specBuffer, value.i < 0 ? "" : record->strings + value.i);
+            break;
+        }
+
+        if (written > 0)
+        {
+            used = used + written < size - 1 ? used + written : size - 1;
+        }
+    }
+
+    buffer[used] = 0;
+}
+
+
+void loom_log_flushBinary()
+{
+    char                    buffer[LOOM_LOG_STACKBUFFER];
+    loom_log_binaryRecord_t record;
+    unsigned int            head;
+    unsigned int            i;
+
+    if (!gBinaryRecords)
+    {
+        return;
+    }
+
+    loom_mutex_lock(gBinaryMutex);
+
+    head = (unsigned int)atomic_load32(&gBinaryHead);
+
+    // Older records have been overwritten.
+    if (head - gBinaryViewed > LOOM_LOG_BINARY_RECORDS)
+    {
+        gBinaryViewed = head - LOOM_LOG_BINARY_RECORDS;
+    }
+
+    for (i = gBinaryViewed; i != head; i++)
+    {
+        loom_log_binaryRecord_t *slot = &gBinaryRecords[i & (LOOM_LOG_BINARY_RECORDS - 1)];
+
+        if (atomic_load32(&slot->sequence) != (int)(i + 1))
+        {
+            continue;
+        }
+
+        memcpy(&record, (const void *)slot, sizeof(record));
+
+        // Skip it if it was rewritten while we copied it.
+        if (atomic_load32(&slot->sequence) != (int)(i + 1))
+        {
+            continue;
+        }
+
+        loom_log_formatBinary(&record, buffer, sizeof(buffer));
+        loom_log_dispatch(record.group, record.level, buffer);
+    }
+
+    gBinaryViewed = head;
+
+    loom_mutex_unlock(gBinaryMutex);
+}
+
+
+void loom_log_setBinary(int enabled)
+{
+    enabled = enabled ? 1 : 0;
+
+    if (enabled == gLogBinary)
+    {
+        return;
+    }
+
+    if (enabled && !gBinaryRecords)
+    {
+        gBinaryRecords = (loom_log_binaryRecord_t *)lmAlloc(gLoggerAllocator, sizeof(loom_log_binaryRecord_t) * LOOM_LOG_BINARY_RECORDS);
+        memset(gBinaryRecords, 0, sizeof(loom_log_binaryRecord_t) * LOOM_LOG_BINARY_RECORDS);
+        gBinaryMutex = loom_mutex_create();
+    }
+
+    atomic_store32(&gLogBinary, enabled);
+
+    // Show what was recorded.
+    if (!enabled)
+    {
+        loom_log_flushBinary();
+    }
+}
+
+
 void loom_log(loom_logGroup_t *group, loom_logLevel_t level, const char *format, ...)
 {
-    loom_log_listenerEntry_t *listener = listenerHead;
-    char* buff;
+    char    stackBuffer[LOOM_LOG_STACKBUFFER];
+    char    *buff = stackBuffer;
+    int     length;
     va_list args;
-    
+
     // sometimes we're not using the lmLog macros, so enforce good behavior.
     if (!group->enabled)
     {
@@ -181,17 +837,59 @@ void loom_log(loom_logGroup_t *group, loom_logLevel_t level, const char *format,
 
     if (level < group->filterLevel) return;
 
-    lmLogArgs(args, buff, format);
+    if (gLogBinary)
+    {
+        if (level < LoomLogError)
+        {
+            int recorded;
 
-    // Walk the listeners and output.
-    while (listener)
+            va_start(args, format);
+            recorded = loom_log_recordBinary(group, level, format, args);
+            va_end(args);
+
+            if (recorded)
+            {
+                return;
+            }
+        }
+        else
+        {
+            // Lead up to the error.
+            loom_log_flushBinary();
+        }
+    }
+
+    va_start(args, format);
+    length = vsnprintf(stackBuffer, sizeof(stackBuffer), format, args);
+    va_end(args);
+
+    // Too long for the stack.
+    if ((length < 0) || (length >= (int)sizeof(stackBuffer)))
     {
-        listener->callback(listener->payload, group, level, buff);
-        listener = listener->next;
+        lmLogArgs(args, buff, format);
+        length = (int)strlen(buff);
     }
 
-    lmFree(NULL, buff);
+    if (!gLogAsync || loom_log_isDispatchingThread())
+    {
+        loom_log_dispatch(group, level, buff);
+    }
+    else if ((level >= LoomLogError) || (length >= LOOM_LOG_MAXQUEUED))
+    {
+        // Errors are delivered before we return, in case we're about to go
+        // down; so are messages too long for the queue. Both in order.
+        loom_log_flush();
+        loom_log_dispatch(group, level, buff);
+    }
+    else
+    {
+        loom_log_enqueue(group, level, buff, length);
+    }
 
+    if (buff != stackBuffer)
+    {
+        lmFree(NULL, buff);
+    }
 }
 
 
@@ -59,7 +59,21 @@ extern "C" {
 #define lmDeclareLogGroup(varName)                                  extern loom_logGroup_t varName;
 #define lmDefineLogGroup(varName, groupName, enabled, filterLevel)  loom_logGroup_t varName = { groupName, enabled, filterLevel, 0 };
 
-#define lmLogLevel(level, group, format, ...)                       if (loom_log_willGroupLog(&group)) { \
+/*
+ * Messages below LOOM_LOG_COMPILEDLEVEL are compiled out, along with their
+ * arguments. By default that is debug output in release builds, builds may
+ * set it with -DLOOM_LOG_LEVEL=<level> when running cmake. Messages below
+ * the level of their group don't evaluate their arguments either.
+ */
+#ifndef LOOM_LOG_COMPILEDLEVEL
+#ifdef LOOM_DEBUG
+#define LOOM_LOG_COMPILEDLEVEL    LoomLogDebug
+#else
+#define LOOM_LOG_COMPILEDLEVEL    LoomLogInfo
+#endif
+#endif
+
+#define lmLogLevel(level, group, format, ...)                       if ((level) >= LOOM_LOG_COMPILEDLEVEL && loom_log_willGroupLog(&group) && (level) >= group.filterLevel) { \
                                                                     loom_log(&group, level, "%10s  " format, group.name, ##__VA_ARGS__); }
 #define lmLogDebug(group, format, ...)                              lmLogLevel(LoomLogDebug, group, format, ##__VA_ARGS__);
 #define lmLogInfo(group, format, ...)                               lmLogLevel(LoomLogInfo, group, format, ##__VA_ARGS__);
@@ -121,6 +135,42 @@ loom_logLevel_t loom_log_getGlobalLevel();
 
 void loom_log(loom_logGroup_t *group, loom_logLevel_t level, const char *format, ...);
 
+/**
+ * When async, loom_log formats the message on the calling thread and queues
+ * it, listeners are then called from a log thread. Errors and messages too
+ * long for the queue are still delivered before loom_log returns. When the
+ * queue is full messages are dropped, loom_log_getDroppedCount tells how
+ * many, and the log thread reports it.
+ *
+ * Disabling async delivers whatever is queued first. Configured with
+ * "async" in the log block of loom.config.
+ */
+void loom_log_setAsync(int enabled);
+
+// Blocks until every message queued so far has been delivered.
+void loom_log_flush();
+int loom_log_getDroppedCount();
+
+/**
+ * In binary mode, messages below errors aren't formatted at all. loom_log
+ * records the format string pointer and the raw arguments in a ring of the
+ * latest LOOM_LOG_BINARY_RECORDS messages, cheap enough for tracing at high
+ * frequency in release builds. They are formatted and delivered only when
+ * viewed, that is by loom_log_flushBinary, before any error is delivered,
+ * and when binary mode is turned off.
+ *
+ * The format must be a string literal, or at least outlive the ring. %s
+ * arguments are copied, up to a total of LOOM_LOG_BINARY_STRINGBYTES per
+ * message and truncated past that. Configured with "binary" in the log
+ * block of loom.config.
+ */
+#define LOOM_LOG_BINARY_RECORDS        2048
+#define LOOM_LOG_BINARY_MAXARGS        8
+#define LOOM_LOG_BINARY_STRINGBYTES    64
+
+void loom_log_setBinary(int enabled);
+void loom_log_flushBinary();
+
 // TODO: Make sure this inlines.
 int loom_log_willGroupLog(loom_logGroup_t *group);
 void loom_log_addRule(const char *prefix, int enabled, int filterLevel);
@@ -24,6 +24,7 @@
 SEATEST_FIXTURE(logging)
 {
     SEATEST_FIXTURE_ENTRY(logging_basic);
+    SEATEST_FIXTURE_ENTRY(logging_async);
 }
 
 static int logCount;
@@ -55,3 +56,24 @@ SEATEST_TEST(logging_basic)
 
     loom_log_removeListener(test_listener, NULL);
 }
+
+
+SEATEST_TEST(logging_async)
+{
+    loom_log_addListener(test_listener, NULL);
+    loom_log_setAsync(1);
+
+    logCount = 0;
+
+    for (int i = 0; i < 100; i++)
+    {
+        lmLog(testGroup, "Testing that async log output is observed. (%d)", i);
+    }
+
+    // Everything queued is delivered once flushed, save what was dropped.
+    loom_log_flush();
+    assert_int_equal(logCount + loom_log_getDroppedCount(), 100);
+
+    loom_log_setAsync(0);
+    loom_log_removeListener(test_listener, NULL);
+}
@@ -134,7 +134,34 @@ extern "C" {
     LUA_GC_PROFILE(step)
 }
 
+volatile atomic_int_t LoomProfiler::sThreadStates[LoomProfiler::MaxThreads];
+LoomProfiler *LoomProfiler::sThreadProfilers[LoomProfiler::MaxThreads];
+
 LoomProfiler::LoomProfiler()
+{
+   initialize();
+
+   mEnabled = LOOM_PROFILE_AT_ENGINE_START_INTERNAL;   
+
+   mNextEnable = LOOM_PROFILE_AT_ENGINE_START_INTERNAL;
+
+   gLoomProfiler = this;
+}
+
+
+LoomProfiler::LoomProfiler(LoomProfiler *main)
+{
+   initialize();
+
+   mMain = main;
+   mLock = loom_mutex_create();
+
+   mEnabled = main->mNextEnable;
+   mNextEnable = main->mNextEnable;
+}
+
+
+void LoomProfiler::initialize()
 {
    mMaxStackDepth = MaxStackDepth;
    mCurrentHash = 0;
@@ -163,14 +190,14 @@ LoomProfiler::LoomProfiler()
 
    mProfileList = NULL;
 
-   mEnabled = LOOM_PROFILE_AT_ENGINE_START_INTERNAL;   
-
-   mNextEnable = LOOM_PROFILE_AT_ENGINE_START_INTERNAL;
-
    mStackDepth = 0;
-   gLoomProfiler = this;
    mDumpToConsole   = false;
 
+   mThread = platform_getCurrentThreadId();
+   mMain = NULL;
+   mLock = NULL;
+   mPendingReset = 0;
+
    mTimer = loom_startTimer();
 }
 
@@ -179,12 +206,44 @@ LoomProfiler::~LoomProfiler()
 {
    reset();
    lmSafeDelete(gProfilerAllocator, mRootLoomProfilerEntry);
-   gLoomProfiler = NULL;
+   if (!mMain)
+      gLoomProfiler = NULL;
 
    loom_destroyTimer(mTimer);
 }
 
 
+LoomProfiler *LoomProfiler::forCurrentThread()
+{
+   int thread = platform_getCurrentThreadId();
+
+   if (thread == mThread)
+      return this;
+
+   for (int i = 0; i < MaxThreads; i++)
+   {
+      int state = atomic_load32(&sThreadStates[i]);
+
+      if (state == 2)
+      {
+         if (sThreadProfilers[i]->mThread == thread)
+            return sThreadProfilers[i];
+         continue;
+      }
+
+      // Slots are claimed in order, the first free one means this thread has none yet
+      if (state == 0 && atomic_compareAndExchange(&sThreadStates[i], 0, 1) == 0)
+      {
+         sThreadProfilers[i] = lmNew(gProfilerAllocator) LoomProfiler(this);
+         atomic_store32(&sThreadStates[i], 2);
+         return sThreadProfilers[i];
+      }
+   }
+
+   return NULL;
+}
+
+
 void LoomProfiler::dumpToConsole()
 {
     mDumpToConsole = true;
@@ -200,11 +259,11 @@ void LoomProfiler::reset()
       dump();
    }
 
-   while(mProfileList)
-   {
-      lmSafeDelete(gProfilerAllocator, mProfileList);
-      mProfileList = NULL;
-   }
+   resetEntries();
+
+   if (mMain)
+      return;
+
    for(LoomProfilerRoot *walk = LoomProfilerRoot::sRootList; walk; walk = walk->mNextRoot)
    {
       walk->mFirstLoomProfilerEntry = 0;
@@ -214,6 +273,23 @@ void LoomProfiler::reset()
       walk->mMinTime = INFINITY;
       walk->mTotalInvokeCount = 0;
    }
+
+   // Worker threads may be in the middle of a block, they reset once out of it
+   for (int i = 0; i < MaxThreads; i++)
+   {
+      if (atomic_load32(&sThreadStates[i]) == 2)
+         atomic_store32(&sThreadProfilers[i]->mPendingReset, 1);
+   }
+}
+
+
+void LoomProfiler::resetEntries()
+{
+   while(mProfileList)
+   {
+      lmSafeDelete(gProfilerAllocator, mProfileList);
+      mProfileList = NULL;
+   }
    mCurrentLoomProfilerEntry = mRootLoomProfilerEntry;
    mCurrentLoomProfilerEntry->mNextForRoot = 0;
    mCurrentLoomProfilerEntry->mFirstChild = 0;
@@ -243,6 +319,7 @@ LoomProfilerRoot::LoomProfilerRoot(const char *name)
 
     mName                   = name;
     mNameHash               = (int)(long long)stringtable_insert(name); // Poor man's hash
+    mTelemetryId            = Telemetry::registerTickTimer(name);
     mNextRoot               = sRootList;
     sRootList               = this;
     mTotalTime              = 0;
@@ -292,7 +369,18 @@ void LoomProfiler::validate()
 
 void LoomProfiler::hashPush(LoomProfilerRoot *root)
 {
-   Telemetry::beginTickTimer(root->mName);
+   if (platform_getCurrentThreadId() != mThread)
+   {
+      LoomProfiler *profiler = forCurrentThread();
+      if (profiler)
+         profiler->hashPush(root);
+      return;
+   }
+
+   Telemetry::beginTickTimer(root->mTelemetryId);
+
+   if (LoomTrace::isEnabled())
+      LoomTrace::begin(root->mName);
 
    mStackDepth++;
    lmAssert(mStackDepth <= (S32) mMaxStackDepth,
@@ -300,6 +388,21 @@ void LoomProfiler::hashPush(LoomProfilerRoot *root)
    if(!mEnabled)
       return;
 
+   if (mLock)
+   {
+      loom_mutex_lock(mLock);
+      pushEntry(root);
+      loom_mutex_unlock(mLock);
+   }
+   else
+   {
+      pushEntry(root);
+   }
+}
+
+
+void LoomProfiler::pushEntry(LoomProfilerRoot *root)
+{
    LoomProfilerEntry *nextProfiler = NULL;
    if(!root->mEnabled || mCurrentLoomProfilerEntry->mRoot == root)
    {
@@ -331,8 +434,14 @@ void LoomProfiler::hashPush(LoomProfilerRoot *root)
             nextProfiler->mChildHash[i] = 0;
 
          nextProfiler->mRoot = root;
-         nextProfiler->mNextForRoot = root->mFirstLoomProfilerEntry;
-         root->mFirstLoomProfilerEntry = nextProfiler;
+
+         // roots are shared, only the main thread links its entries to them
+         nextProfiler->mNextForRoot = NULL;
+         if (!mMain)
+         {
+            nextProfiler->mNextForRoot = root->mFirstLoomProfilerEntry;
+            root->mFirstLoomProfilerEntry = nextProfiler;
+         }
 
          nextProfiler->mNextLoomProfilerEntry = mProfileList;
          mProfileList = nextProfiler;
@@ -355,7 +464,9 @@ void LoomProfiler::hashPush(LoomProfilerRoot *root)
       }
    }
 
-   root->mTotalInvokeCount++;
+   // worker thread totals are added to the roots when dumped
+   if (!mMain)
+      root->mTotalInvokeCount++;
    nextProfiler->mInvokeCount++;
    
    nextProfiler->mStartTime = loom_readTimerNano(mTimer);
@@ -373,57 +484,101 @@ void LoomProfiler::enable(bool enabled)
 
 void LoomProfiler::hashPop(LoomProfilerRoot *expected)
 {
-    Telemetry::endTickTimer(expected->mName);
+    if (platform_getCurrentThreadId() != mThread)
+    {
+        LoomProfiler *profiler = forCurrentThread();
+        if (profiler)
+            profiler->hashPop(expected);
+        return;
+    }
+
+    Telemetry::endTickTimer(expected->mTelemetryId);
+
+    if (LoomTrace::isEnabled())
+    {
+        LoomTrace::end(expected->mName);
+    }
 
     mStackDepth--;
 
     lmAssert(mStackDepth >= 0, "Stack underflow in profiler.  You may have mismatched PROFILE_START and PROFILE_ENDs");
     if (mEnabled)
     {
-        if (mCurrentLoomProfilerEntry->mSubDepth)
+        if (mLock)
         {
-            mCurrentLoomProfilerEntry->mSubDepth--;
-            return;
+            loom_mutex_lock(mLock);
+            popEntry(expected);
+            loom_mutex_unlock(mLock);
         }
-
-        if (expected)
+        else
         {
-            lmAssert(expected == mCurrentLoomProfilerEntry->mRoot, "LoomProfiler::hashPop - didn't get expected ProfilerRoot!");
+            popEntry(expected);
         }
+    }
 
-        F64 fElapsed = loom_readTimerNano(mTimer) - mCurrentLoomProfilerEntry->mStartTime;
-
-        lmAssert(fElapsed >= 0, "Elapsed time should be positive - is %f", fElapsed);
+    if (mStackDepth == 0)
+    {
+        // worker threads follow the main thread
+        bool nextEnable = mMain ? mMain->mNextEnable : mNextEnable;
 
-        mCurrentLoomProfilerEntry->mTotalTime        += fElapsed;
-        mCurrentLoomProfilerEntry->mParent->mSubTime += fElapsed; // mark it in the parent as well...
-        mCurrentLoomProfilerEntry->mRoot->mTotalTime += fElapsed;
-        mCurrentLoomProfilerEntry->mMaxTime = fElapsed > mCurrentLoomProfilerEntry->mMaxTime ? fElapsed : mCurrentLoomProfilerEntry->mMaxTime;
-        mCurrentLoomProfilerEntry->mMinTime = fElapsed < mCurrentLoomProfilerEntry->mMinTime ? fElapsed : mCurrentLoomProfilerEntry->mMinTime;
-        mCurrentLoomProfilerEntry->mRoot->mMaxTime = fElapsed > mCurrentLoomProfilerEntry->mRoot->mMaxTime ? fElapsed : mCurrentLoomProfilerEntry->mRoot->mMaxTime;
-        mCurrentLoomProfilerEntry->mRoot->mMinTime = fElapsed < mCurrentLoomProfilerEntry->mRoot->mMinTime ? fElapsed : mCurrentLoomProfilerEntry->mRoot->mMinTime;
-        if (mCurrentLoomProfilerEntry->mParent->mRoot)
+        if (mMain && atomic_load32(&mPendingReset))
         {
-            mCurrentLoomProfilerEntry->mParent->mRoot->mSubTime += fElapsed; // mark it in the parent as well...
+            loom_mutex_lock(mLock);
+            resetEntries();
+            loom_mutex_unlock(mLock);
+            atomic_store32(&mPendingReset, 0);
         }
-        mCurrentLoomProfilerEntry = mCurrentLoomProfilerEntry->mParent;
-    }
 
-    if (mStackDepth == 0)
-    {
         // apply the next enable...
         if (mDumpToConsole)
         {
             dump();
             mCurrentLoomProfilerEntry->mStartTime = loom_readTimerNano(mTimer);
         }
-        if (!mEnabled && mNextEnable)
+        if (!mEnabled && nextEnable)
         {
             mCurrentLoomProfilerEntry->mStartTime = loom_readTimerNano(mTimer);
         }
 
-        mEnabled = mNextEnable;
+        mEnabled = nextEnable;
+    }
+}
+
+
+void LoomProfiler::popEntry(LoomProfilerRoot *expected)
+{
+    if (mCurrentLoomProfilerEntry->mSubDepth)
+    {
+        mCurrentLoomProfilerEntry->mSubDepth--;
+        return;
+    }
+
+    if (expected)
+    {
+        lmAssert(expected == mCurrentLoomProfilerEntry->mRoot, "LoomProfiler::hashPop - didn't get expected ProfilerRoot!");
+    }
+
+    F64 fElapsed = loom_readTimerNano(mTimer) - mCurrentLoomProfilerEntry->mStartTime;
+
+    lmAssert(fElapsed >= 0, "Elapsed time should be positive - is %f", fElapsed);
+
+    mCurrentLoomProfilerEntry->mTotalTime        += fElapsed;
+    mCurrentLoomProfilerEntry->mParent->mSubTime += fElapsed; // mark it in the parent as well...
+    mCurrentLoomProfilerEntry->mMaxTime = fElapsed > mCurrentLoomProfilerEntry->mMaxTime ? fElapsed : mCurrentLoomProfilerEntry->mMaxTime;
+    mCurrentLoomProfilerEntry->mMinTime = fElapsed < mCurrentLoomProfilerEntry->mMinTime ? fElapsed : mCurrentLoomProfilerEntry->mMinTime;
+
+    // worker thread totals are added to the roots when dumped
+    if (!mMain)
+    {
+        mCurrentLoomProfilerEntry->mRoot->mTotalTime += fElapsed;
+        mCurrentLoomProfilerEntry->mRoot->mMaxTime = fElapsed > mCurrentLoomProfilerEntry->mRoot->mMaxTime ? fElapsed : mCurrentLoomProfilerEntry->mRoot->mMaxTime;
+        mCurrentLoomProfilerEntry->mRoot->mMinTime = fElapsed < mCurrentLoomProfilerEntry->mRoot->mMinTime ? fElapsed : mCurrentLoomProfilerEntry->mRoot->mMinTime;
+        if (mCurrentLoomProfilerEntry->mParent->mRoot)
+        {
+            mCurrentLoomProfilerEntry->mParent->mRoot->mSubTime += fElapsed; // mark it in the parent as well...
+        }
     }
+    mCurrentLoomProfilerEntry = mCurrentLoomProfilerEntry->mParent;
 }
 
 void LoomProfiler::hashZeroCheck()
@@ -530,6 +685,30 @@ void LoomProfiler::dump()
 
     // may have some profiled calls... gotta turn em off.
 
+    // merge the totals of the worker threads into the roots
+    for (int i = 0; i < MaxThreads; i++)
+    {
+        if (atomic_load32(&sThreadStates[i]) != 2)
+        {
+            continue;
+        }
+
+        LoomProfiler *worker = sThreadProfilers[i];
+
+        loom_mutex_lock(worker->mLock);
+        for (LoomProfilerEntry *entry = worker->mProfileList; entry; entry = entry->mNextLoomProfilerEntry)
+        {
+            LoomProfilerRoot *root = entry->mRoot;
+
+            root->mTotalInvokeCount += entry->mInvokeCount;
+            root->mTotalTime        += entry->mTotalTime;
+            root->mSubTime          += entry->mSubTime;
+            root->mMaxTime           = entry->mMaxTime > root->mMaxTime ? entry->mMaxTime : root->mMaxTime;
+            root->mMinTime           = entry->mMinTime < root->mMinTime ? entry->mMinTime : root->mMinTime;
+        }
+        loom_mutex_unlock(worker->mLock);
+    }
+
     utArray<LoomProfilerRoot *> rootVector;
     F64 totalTime = 0.0;
     for (LoomProfilerRoot *walk = LoomProfilerRoot::sRootList; walk; walk = walk->mNextRoot)
@@ -595,8 +774,510 @@ void LoomProfiler::dump()
     LoomProfilerEntryDumpRecurse(mCurrentLoomProfilerEntry, depthBuffer, 0, totalTime, threshold);
     lmLogInfo(gProfilerLogGroup, "Suppressed %i items with < %.1f%% of measured time.", suppressedEntries, threshold);
 
+    for (int i = 0; i < MaxThreads; i++)
+    {
+        if (atomic_load32(&sThreadStates[i]) != 2)
+        {
+            continue;
+        }
+
+        LoomProfiler *worker = sThreadProfilers[i];
+
+        loom_mutex_lock(worker->mLock);
+        if (worker->mRootLoomProfilerEntry->mFirstChild)
+        {
+            lmLogInfo(gProfilerLogGroup, "");
+            lmLogInfo(gProfilerLogGroup, "Thread %d, ordered by stack trace total time -", worker->mThread);
+            lmLogInfo(gProfilerLogGroup, "  %% Time %% NSTime  AvgTime  MaxTime  MinTime Invoke # Name");
+
+            worker->mRootLoomProfilerEntry->mTotalTime = loom_readTimerNano(worker->mTimer);
+
+            depthBuffer[0]    = 0;
+            suppressedEntries = 0;
+            LoomProfilerEntryDumpRecurse(worker->mRootLoomProfilerEntry, depthBuffer, 0, totalTime, threshold);
+            lmLogInfo(gProfilerLogGroup, "Suppressed %i items with < %.1f%% of measured time.", suppressedEntries, threshold);
+        }
+        loom_mutex_unlock(worker->mLock);
+    }
+
     mEnabled = enableSave;
     mStackDepth--;
 
     mDumpToConsole = false;
 }
+
+
+//-----------------------------------------------------------------------------
+
+#include "loom/common/platform/platformThread.h"
+
+struct LoomTraceEvent
+{
+    const char *name;
+    char       detail[128];
+    char       phase;
+    int        thread;
+    double     time;
+};
+
+struct LoomTraceThread
+{
+    int  thread;
+    char name[64];
+    int  depth; // while writing, to drop ends whose begins fell out of the ring
+};
+
+bool LoomTrace::enabled = false;
+
+static utArray<LoomTraceEvent>  gTraceEvents;
+static utArray<LoomTraceThread> gTraceThreads;
+static MutexHandle              gTraceMutex    = loom_mutex_create();
+static loom_precision_timer_t   gTraceTimer    = NULL;
+static UTsize                   gTraceCapacity = 0; // 0 keeps every event
+static UTsize                   gTraceNext     = 0; // oldest event once the ring is full
+
+void LoomTrace::enable(bool enable, unsigned int capacity)
+{
+    loom_mutex_lock(gTraceMutex);
+
+    if (enable && !gTraceTimer)
+    {
+        gTraceTimer = loom_startTimer();
+    }
+
+    if (enable && (capacity != gTraceCapacity))
+    {
+        gTraceEvents.clear();
+        gTraceNext     = 0;
+        gTraceCapacity = capacity;
+
+        if (capacity)
+        {
+            gTraceEvents.reserve(capacity);
+        }
+    }
+
+    enabled = enable;
+
+    loom_mutex_unlock(gTraceMutex);
+}
+
+
+void LoomTrace::clear()
+{
+    loom_mutex_lock(gTraceMutex);
+    gTraceEvents.clear(true);
+    gTraceNext = 0;
+    loom_mutex_unlock(gTraceMutex);
+}
+
+
+static LoomTraceThread *findTraceThread(int thread)
+{
+    for (UTsize i = 0; i < gTraceThreads.size(); i++)
+    {
+        if (gTraceThreads[i].thread == thread)
+        {
+            return &gTraceThreads[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+void LoomTrace::setThreadName(const char *name)
+{
+    int thread = platform_getCurrentThreadId();
+
+    loom_mutex_lock(gTraceMutex);
+
+    LoomTraceThread *entry = findTraceThread(thread);
+
+    if (!entry)
+    {
+        LoomTraceThread added;
+        added.thread = thread;
+        added.depth  = 0;
+        gTraceThreads.push_back(added);
+        entry = &gTraceThreads.back();
+    }
+
+    strncpy(entry->name, name, sizeof(entry->name) - 1);
+    entry->name[sizeof(entry->name) - 1] = 0;
+
+    loom_mutex_unlock(gTraceMutex);
+}
+
+
+static void recordTraceEvent(char phase, const char *name, const char *detail)
+{
+    LoomTraceEvent event;
+
+    event.name   = name;
+    event.phase  = phase;
+    event.thread = platform_getCurrentThreadId();
+
+    event.detail[0] = 0;
+    if (detail)
+    {
+        strncpy(event.detail, detail, sizeof(event.detail) - 1);
+        event.detail[sizeof(event.detail) - 1] = 0;
+    }
+
+    loom_mutex_lock(gTraceMutex);
+    // trace events are in microseconds
+    event.time = loom_readTimerNano(gTraceTimer) / 1000.0;
+    if (!gTraceCapacity || (gTraceEvents.size() < gTraceCapacity))
+    {
+        gTraceEvents.push_back(event);
+    }
+    else
+    {
+        // full, overwrite the oldest
+        gTraceEvents[gTraceNext] = event;
+        gTraceNext = (gTraceNext + 1) % gTraceCapacity;
+    }
+    loom_mutex_unlock(gTraceMutex);
+}
+
+
+void LoomTrace::begin(const char *name, const char *detail)
+{
+    recordTraceEvent('B', name, detail);
+}
+
+
+void LoomTrace::end(const char *name)
+{
+    recordTraceEvent('E', name, NULL);
+}
+
+
+// Walks the recorded events oldest first, skipping ends whose begin was
+// overwritten in the ring, returns NULL when done. Also registers the
+// threads seen, call with gTraceMutex held.
+static const LoomTraceEvent *nextTraceEvent(UTsize& index)
+{
+    while (index < gTraceEvents.size())
+    {
+        const LoomTraceEvent& event = gTraceEvents[(gTraceNext + index++) % gTraceEvents.size()];
+
+        LoomTraceThread *thread = findTraceThread(event.thread);
+
+        if (!thread)
+        {
+            LoomTraceThread added;
+            added.thread  = event.thread;
+            added.name[0] = 0;
+            added.depth   = 0;
+            gTraceThreads.push_back(added);
+            thread = &gTraceThreads.back();
+        }
+
+        if (event.phase == 'B')
+        {
+            thread->depth++;
+        }
+        else if (thread->depth > 0)
+        {
+            thread->depth--;
+        }
+        else
+        {
+            continue;
+        }
+
+        return &event;
+    }
+
+    return NULL;
+}
+
+
+static void resetTraceThreads()
+{
+    for (UTsize i = 0; i < gTraceThreads.size(); i++)
+    {
+        gTraceThreads[i].depth = 0;
+    }
+}
+
+
+static void writeTraceString(FILE *file, const char *value)
+{
+    fputc('"', file);
+
+    for ( ; *value; value++)
+    {
+        if ((*value == '"') || (*value == '\\'))
+        {
+            fputc('\\', file);
+        }
+
+        if ((unsigned char)*value >= 0x20)
+        {
+            fputc(*value, file);
+        }
+    }
+
+    fputc('"', file);
+}
+
+
+static void writeTraceJSON(FILE *file)
+{
+    fprintf(file, "{\"traceEvents\":[\n");
+
+    UTsize                index = 0;
+    const LoomTraceEvent *event;
+    bool                  first = true;
+
+    while ((event = nextTraceEvent(index)) != NULL)
+    {
+        fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+        writeTraceString(file, event->name);
+        fprintf(file, ",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d", event->phase, event->time, event->thread);
+
+        if (event->detail[0])
+        {
+            fprintf(file, ",\"args\":{\"detail\":");
+            writeTraceString(file, event->detail);
+            fprintf(file, "}");
+        }
+
+        fprintf(file, "}");
+        first = false;
+    }
+
+    // thread names as metadata events
+    for (UTsize i = 0; i < gTraceThreads.size(); i++)
+    {
+        if (!gTraceThreads[i].name[0])
+        {
+            continue;
+        }
+
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n", gTraceThreads[i].thread);
+        writeTraceString(file, gTraceThreads[i].name);
+        fprintf(file, "}}");
+        first = false;
+    }
+
+    fprintf(file, "\n]}\n");
+}
+
+
+// Minimal protobuf encoding of the Perfetto trace format, just the fields
+// of TracePacket, TrackDescriptor and TrackEvent needed for thread slices.
+enum
+{
+    PerfettoTracePacket           = 1,  // Trace.packet
+
+    PerfettoPacketTimestamp       = 8,  // TracePacket.timestamp
+    PerfettoPacketSequenceId      = 10, // TracePacket.trusted_packet_sequence_id
+    PerfettoPacketTrackEvent      = 11, // TracePacket.track_event
+    PerfettoPacketSequenceFlags   = 13, // TracePacket.sequence_flags
+    PerfettoPacketTrackDescriptor = 60, // TracePacket.track_descriptor
+
+    PerfettoTrackUuid             = 1,  // TrackDescriptor.uuid
+    PerfettoTrackProcess          = 3,  // TrackDescriptor.process
+    PerfettoTrackThread           = 4,  // TrackDescriptor.thread
+
+    PerfettoProcessPid            = 1,  // ProcessDescriptor.pid
+    PerfettoProcessName           = 6,  // ProcessDescriptor.process_name
+
+    PerfettoThreadPid             = 1,  // ThreadDescriptor.pid
+    PerfettoThreadTid             = 2,  // ThreadDescriptor.tid
+    PerfettoThreadName            = 5,  // ThreadDescriptor.thread_name
+
+    PerfettoEventAnnotation       = 4,  // TrackEvent.debug_annotations
+    PerfettoEventType             = 9,  // TrackEvent.type
+    PerfettoEventTrackUuid        = 11, // TrackEvent.track_uuid
+    PerfettoEventName             = 23, // TrackEvent.name
+
+    PerfettoAnnotationString      = 6,  // DebugAnnotation.string_value
+    PerfettoAnnotationName        = 10, // DebugAnnotation.name
+
+    PerfettoSliceBegin            = 1,  // TrackEvent.Type.TYPE_SLICE_BEGIN
+    PerfettoSliceEnd              = 2,  // TrackEvent.Type.TYPE_SLICE_END
+
+    PerfettoIncrementalCleared    = 1,  // SEQ_INCREMENTAL_STATE_CLEARED
+};
+
+typedef utArray<unsigned char> LoomTraceProto;
+
+static void protoVarint(LoomTraceProto& proto, unsigned long long value)
+{
+    while (value >= 0x80)
+    {
+        proto.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+
+    proto.push_back((unsigned char)value);
+}
+
+
+static void protoUInt(LoomTraceProto& proto, int field, unsigned long long value)
+{
+    protoVarint(proto, (field << 3) | 0);
+    protoVarint(proto, value);
+}
+
+
+static void protoBytes(LoomTraceProto& proto, int field, const void *bytes, size_t length)
+{
+    protoVarint(proto, (field << 3) | 2);
+    protoVarint(proto, length);
+
+    for (size_t i = 0; i < length; i++)
+    {
+        proto.push_back(((const unsigned char *)bytes)[i]);
+    }
+}
+
+
+static void protoString(LoomTraceProto& proto, int field, const char *value)
+{
+    protoBytes(proto, field, value, strlen(value));
+}
+
+
+static void protoMessage(LoomTraceProto& proto, int field, const LoomTraceProto& message)
+{
+    protoBytes(proto, field, message.size() ? message.ptr() : NULL, message.size());
+}
+
+
+static void writeTracePacket(FILE *file, const LoomTraceProto& packet)
+{
+    LoomTraceProto framed;
+
+    protoMessage(framed, PerfettoTracePacket, packet);
+    fwrite(framed.ptr(), 1, framed.size(), file);
+}
+
+
+// Track of a thread, 1 is the process track.
+static unsigned long long traceThreadUuid(int thread)
+{
+    return (unsigned long long)(unsigned int)thread + 2;
+}
+
+
+static void writeTracePerfetto(FILE *file)
+{
+    LoomTraceProto packet, descriptor, inner;
+
+    // Walk once to find the threads with events.
+    UTsize index = 0;
+    while (nextTraceEvent(index))
+    {
+    }
+    resetTraceThreads();
+
+    inner.clear();
+    protoUInt(inner, PerfettoProcessPid, 1);
+    protoString(inner, PerfettoProcessName, "Loom");
+    descriptor.clear();
+    protoUInt(descriptor, PerfettoTrackUuid, 1);
+    protoMessage(descriptor, PerfettoTrackProcess, inner);
+    packet.clear();
+    protoUInt(packet, PerfettoPacketSequenceId, 1);
+    protoUInt(packet, PerfettoPacketSequenceFlags, PerfettoIncrementalCleared);
+    protoMessage(packet, PerfettoPacketTrackDescriptor, descriptor);
+    writeTracePacket(file, packet);
+
+    for (UTsize i = 0; i < gTraceThreads.size(); i++)
+    {
+        const LoomTraceThread& thread = gTraceThreads[i];
+
+        inner.clear();
+        protoUInt(inner, PerfettoThreadPid, 1);
+        protoUInt(inner, PerfettoThreadTid, (unsigned long long)(long long)thread.thread);
+        if (thread.name[0])
+        {
+            protoString(inner, PerfettoThreadName, thread.name);
+        }
+        descriptor.clear();
+        protoUInt(descriptor, PerfettoTrackUuid, traceThreadUuid(thread.thread));
+        protoMessage(descriptor, PerfettoTrackThread, inner);
+        packet.clear();
+        protoUInt(packet, PerfettoPacketSequenceId, 1);
+        protoMessage(packet, PerfettoPacketTrackDescriptor, descriptor);
+        writeTracePacket(file, packet);
+    }
+
+    index = 0;
+    const LoomTraceEvent *event;
+
+    while ((event = nextTraceEvent(index)) != NULL)
+    {
+        LoomTraceProto trackEvent;
+
+        protoUInt(trackEvent, PerfettoEventType, event->phase == 'B' ? PerfettoSliceBegin : PerfettoSliceEnd);
+        protoUInt(trackEvent, PerfettoEventTrackUuid, traceThreadUuid(event->thread));
+
+        if (event->phase == 'B')
+        {
+            protoString(trackEvent, PerfettoEventName, event->name);
+        }
+
+        if (event->detail[0])
+        {
+            inner.clear();
+            protoString(inner, PerfettoAnnotationName, "detail");
+            protoString(inner, PerfettoAnnotationString, event->detail);
+            protoMessage(trackEvent, PerfettoEventAnnotation, inner);
+        }
+
+        packet.clear();
+        // timestamps are in nanoseconds
+        protoUInt(packet, PerfettoPacketTimestamp, (unsigned long long)(event->time * 1000.0));
+        protoUInt(packet, PerfettoPacketSequenceId, 1);
+        protoMessage(packet, PerfettoPacketTrackEvent, trackEvent);
+        writeTracePacket(file, packet);
+    }
+}
+
+
+static bool traceHasExtension(const char *path, const char *extension)
+{
+    size_t pathLength      = strlen(path);
+    size_t extensionLength = strlen(extension);
+
+    return pathLength >= extensionLength && !strcmp(path + pathLength - extensionLength, extension);
+}
+
+
+bool LoomTrace::write(const char *path)
+{
+    bool perfetto = traceHasExtension(path, ".pftrace") || traceHasExtension(path, ".perfetto-trace");
+
+    FILE *file = fopen(path, perfetto ? "wb" : "w");
+
+    if (!file)
+    {
+        return false;
+    }
+
+    loom_mutex_lock(gTraceMutex);
+
+    resetTraceThreads();
+
+    if (perfetto)
+    {
+        writeTracePerfetto(file);
+    }
+    else
+    {
+        writeTraceJSON(file);
+    }
+
+    loom_mutex_unlock(gTraceMutex);
+
+    fclose(file);
+
+    return true;
+}
@@ -21,8 +21,11 @@
 #ifndef _CORE_PERFORMANCE_H_
 #define _CORE_PERFORMANCE_H_
 
+#include <stddef.h>
+
 #include "loom/common/platform/platform.h"
 #include "loom/common/platform/platformTime.h"
+#include "loom/common/platform/platformThread.h"
 
 #ifndef LOOM_TELEMETRY
 #ifndef NPERFORMANCE
@@ -129,11 +132,20 @@ typedef double         F64;
 
 
 
+/**
+ * Every thread gets a profiler of its own, so blocks on worker threads get
+ * a tree of their own instead of corrupting the main thread's. gLoomProfiler
+ * is the main thread's and hands blocks on other threads over to theirs,
+ * which follow its enabled state and are reset and dumped along with it.
+ * The dump merges the per block totals of all threads and lists the tree of
+ * every thread.
+ */
 class LoomProfiler
 {
     enum
     {
         MaxStackDepth = 256,
+        MaxThreads    = 16,
     };
     U32 mCurrentHash;
 
@@ -147,6 +159,33 @@ class LoomProfiler
     bool mNextEnable;
     U32  mMaxStackDepth;
     bool mDumpToConsole;
+
+    /// Thread recorded by this profiler
+    int mThread;
+
+    /// Main thread profiler for worker thread ones, NULL for itself
+    LoomProfiler *mMain;
+
+    /// Guards the tree of a worker thread profiler while it's dumped
+    MutexHandle mLock;
+
+    /// Set by the main thread, the worker resets once it's out of all blocks
+    volatile atomic_int_t mPendingReset;
+
+    /// Worker thread profilers, a slot is claimed (1) and set up (2) by its thread
+    static volatile atomic_int_t sThreadStates[MaxThreads];
+    static LoomProfiler *sThreadProfilers[MaxThreads];
+
+    LoomProfiler(LoomProfiler *main);
+    void initialize();
+
+    /// Returns the profiler of the calling thread, NULL if there are too many threads
+    LoomProfiler *forCurrentThread();
+
+    void pushEntry(LoomProfilerRoot *root);
+    void popEntry(LoomProfilerRoot *expected);
+    void resetEntries();
+
     void dump();
     void validate();
 
@@ -180,6 +219,7 @@ struct LoomProfilerRoot
 {
     const char              *mName;
     U32                     mNameHash;
+    int                     mTelemetryId; ///< registered Telemetry timer ID
     LoomProfilerEntry       *mFirstLoomProfilerEntry;
     LoomProfilerRoot        *mNextRoot;
     F64                     mTotalTime;
@@ -247,6 +287,65 @@ public:
 #define LOOM_PROFILE_SCOPE(name)                          \
     static LoomProfilerRoot pdata ## name ## obj(# name); \
     LoomScopedProfiler scopedProfiler ## name ## obj(&pdata ## name ## obj);
+
+/**
+ * Records spans in the Chrome trace event format, for chrome://tracing or
+ * Perfetto. While enabled, every profiler block (LOOM_PROFILE_START/END and
+ * LOOM_PROFILE_SCOPE, including the LUA_GC_PROFILE callbacks) is recorded
+ * along with LOOM_TRACE_SCOPE blocks.
+ *
+ * Unlike the profiler LOOM_TRACE_SCOPE may be used on any thread, and takes a
+ * detail string, such as the module or file being worked on, shown with the
+ * span.
+ *
+ * With a capacity the events are kept in a ring, so a long running app can
+ * be left recording and only the last capacity events are written.
+ */
+class LoomTrace
+{
+    static bool enabled;
+
+public:
+
+    /// capacity of 0 keeps every event, otherwise only the most recent ones
+    static void enable(bool enable, unsigned int capacity = 0);
+
+    static inline bool isEnabled() { return enabled; }
+
+    /// Drops the events recorded so far
+    static void clear();
+
+    /// Names the calling thread in written traces, name is copied
+    static void setThreadName(const char *name);
+
+    /// name must stay valid until the trace is written, detail is copied
+    static void begin(const char *name, const char *detail = NULL);
+    static void end(const char *name);
+
+    /// Writes the spans recorded so far, as Perfetto protobuf if path ends
+    /// in .pftrace or .perfetto-trace and as JSON otherwise, false if path
+    /// can't be written
+    static bool write(const char *path);
+};
+
+class LoomTraceScope {
+public:
+    const char *_name;
+    bool       _traced;
+    LoomTraceScope(const char *name, const char *detail)
+        : _name(name), _traced(LoomTrace::isEnabled())
+    {
+        if (_traced) { LoomTrace::begin(_name, detail); }
+    }
+
+    ~LoomTraceScope()
+    {
+        if (_traced) { LoomTrace::end(_name); }
+    }
+};
+
+#define LOOM_TRACE_SCOPE(name, detail) \
+    LoomTraceScope traceScope ## name ## obj(# name, detail);
 };
 
 #if LUA_GC_PROFILE_ENABLED
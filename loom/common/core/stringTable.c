@@ -18,6 +18,7 @@
  * ===========================================================================
  */
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
@@ -27,59 +28,174 @@
 #include "loom/common/platform/platformThread.h"
 #include "loom/common/platform/platform.h"
 
+/*
+ * Lookups of strings that are already interned, by far the most common
+ * case, take no lock. The table is open addressed; a slot goes from empty
+ * to its entry exactly once, and entries never move or die, so a reader
+ * sees either the entry or an empty slot and falls back to the locked
+ * insert. Growing builds a new slot array and publishes it, the old arrays
+ * are kept since readers may still be probing them.
+ *
+ * Entries are carved out of arena blocks, one allocation per block rather
+ * than two per string.
+ */
+
 typedef struct stringTableEntry
 {
-    const char              *string;
-    struct stringTableEntry *next;
+    unsigned int hash;
+    char         string[1];
 } stringTableEntry_t;
 
-#define csmTableSize    4027 // Biggest prime smaller than 4k.
-static stringTableEntry_t *gTable[csmTableSize];
-static MutexHandle        gTableMutex = NULL;
+typedef struct stringTableSlots
+{
+    unsigned int                 mask; // slot count - 1, a power of two
+    unsigned int                 count;
+    struct stringTableSlots      *previous;
+    stringTableEntry_t *volatile slots[1];
+} stringTableSlots_t;
+
+#define csmInitialSlots    4096
+#define csmArenaBlockSize    (64 * 1024)
+
+static stringTableSlots_t *volatile gTable      = NULL;
+static MutexHandle                  gTableMutex = NULL;
+
+// Insert arena, guarded by gTableMutex.
+static char   *gArenaCurrent  = NULL;
+static size_t gArenaAvailable = 0;
+
+
+static stringTableSlots_t *allocSlots(unsigned int count)
+{
+    size_t             size   = sizeof(stringTableSlots_t) + (count - 1) * sizeof(stringTableEntry_t *);
+    stringTableSlots_t *table = (stringTableSlots_t *)lmAlloc(NULL, size);
+
+    memset(table, 0, size);
+    table->mask = count - 1;
+
+    return table;
+}
+
 
 void stringtable_initialize()
 {
-    // Clear out the hash table.
-    memset(gTable, 0, sizeof(stringTableEntry_t *) * csmTableSize);
+    // Both the engine and the script runtime initialize it.
+    if (gTableMutex)
+    {
+        return;
+    }
+
     gTableMutex = loom_mutex_create();
+    gTable      = allocSlots(csmInitialSlots);
 }
 
 
-static unsigned long hash(const char *str)
+static unsigned int hash(const char *str)
 {
-    // Courtesy of http://www.cse.yorku.ca/~oz/hash.html
-    unsigned long hash_result = 5381;
-    int           c;
+    // FNV-1a
+    unsigned int hash_result = 2166136261u;
 
-    while ((c = *str++))
+    for ( ; *str; str++)
     {
-        hash_result = ((hash_result << 5) + hash_result) + c; /* hash * 33 + c */
+        hash_result ^= (unsigned char)*str;
+        hash_result *= 16777619u;
     }
     return hash_result;
 }
 
 
-static stringTableEntry_t *allocEntry(const char *str)
+static StringTableEntry lookup(stringTableSlots_t *table, const char *str, unsigned int hash_result)
 {
-    size_t len;
-    stringTableEntry_t *entry = (stringTableEntry_t *)lmAlloc(NULL, sizeof(stringTableEntry_t));
+    unsigned int i;
+
+    for (i = hash_result & table->mask; ; i = (i + 1) & table->mask)
+    {
+        stringTableEntry_t *entry = table->slots[i];
+
+        if (!entry)
+        {
+            return NULL;
+        }
+
+        if ((entry->hash == hash_result) && (strcmp(entry->string, str) == 0))
+        {
+            return entry->string;
+        }
+    }
+}
+
+
+static stringTableEntry_t *allocEntry(const char *str, unsigned int hash_result)
+{
+    size_t             len  = strlen(str);
+    size_t             size = (offsetof(stringTableEntry_t, string) + len + 1 + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    stringTableEntry_t *entry;
+
+    if (size > csmArenaBlockSize / 4)
+    {
+        // Long strings get an allocation of their own.
+        entry = (stringTableEntry_t *)lmAlloc(NULL, size);
+    }
+    else
+    {
+        if (size > gArenaAvailable)
+        {
+            gArenaCurrent   = (char *)lmAlloc(NULL, csmArenaBlockSize);
+            gArenaAvailable = csmArenaBlockSize;
+        }
+
+        entry            = (stringTableEntry_t *)gArenaCurrent;
+        gArenaCurrent   += size;
+        gArenaAvailable -= size;
+    }
 
-    entry->next = NULL;
-    len = strlen(str);
-    entry->string = (const char*)lmAlloc(NULL, len + 1);
-    memcpy((char*)entry->string, str, len);
-    ((char*)entry->string)[len] = '\0';
+    entry->hash = hash_result;
+    memcpy(entry->string, str, len + 1);
 
     return entry;
 }
 
 
+// Publishes entry in a free slot, the entry must be complete by then.
+static void place(stringTableSlots_t *table, stringTableEntry_t *entry)
+{
+    unsigned int i;
+
+    for (i = entry->hash & table->mask; table->slots[i]; i = (i + 1) & table->mask)
+    {
+    }
+
+    // Also a full barrier, readers can't see the slot before the entry.
+    atomic_compareAndExchangePointer((void *volatile *)&table->slots[i], NULL, entry);
+    table->count++;
+}
+
+
+static stringTableSlots_t *grow(stringTableSlots_t *table)
+{
+    stringTableSlots_t *grown = allocSlots((table->mask + 1) * 2);
+    unsigned int       i;
+
+    for (i = 0; i <= table->mask; i++)
+    {
+        if (table->slots[i])
+        {
+            place(grown, table->slots[i]);
+        }
+    }
+
+    grown->previous = table;
+    atomic_compareAndExchangePointer((void *volatile *)&gTable, table, grown);
+
+    return grown;
+}
+
+
 StringTableEntry stringtable_insert(const char *str)
 {
-    unsigned long      hash_result;
-    stringTableEntry_t *walk  = NULL;
-    StringTableEntry   result = NULL;
-    int                bucket;
+    unsigned int       hash_result;
+    stringTableSlots_t *table;
+    StringTableEntry   result;
 
     // A NULL would cause a crash eventually
     if (str == NULL)
@@ -88,54 +204,35 @@ StringTableEntry stringtable_insert(const char *str)
     // Hash the string.
     hash_result = hash(str);
 
-    // Determine the hash table bucket.
-    bucket = hash_result % csmTableSize;
-
-    // TODO: Make this a readwrite lock, since most of the time we are just
-    // traversing the stringtable to find existing data, not inserting.
-    loom_mutex_lock(gTableMutex);
-
-    // Walk the chain, if any.
-    walk = gTable[bucket];
-
-    // Empty bucket, easy case!
-    if (!walk)
+    // Lock free for strings that are already there.
+    table  = gTable;
+    result = lookup(table, str, hash_result);
+    if (result)
     {
-        gTable[bucket] = allocEntry(str);
-        assert(gTable[bucket]->string);
-        result = gTable[bucket]->string;
-        loom_mutex_unlock(gTableMutex);
-
         return result;
     }
 
-    while (walk)
-    {
-        // Is it a match?
-        if (strcmp(walk->string, str) == 0)
-        {
-            assert(walk->string);
-            result = (StringTableEntry)walk->string;
-            loom_mutex_unlock(gTableMutex);
+    loom_mutex_lock(gTableMutex);
 
-            return result;
-        }
+    // It may have been inserted, or the table grown, meanwhile.
+    table  = gTable;
+    result = lookup(table, str, hash_result);
 
-        // Another one to check?
-        if (walk->next != NULL)
+    if (!result)
+    {
+        // Keep at least half the slots free, so probes stay short.
+        if ((table->count + 1) * 2 > table->mask + 1)
         {
-            walk = walk->next;
-            continue;
+            table = grow(table);
         }
 
-        break;
+        stringTableEntry_t *entry = allocEntry(str, hash_result);
+        place(table, entry);
+        result = entry->string;
     }
 
-    // No match. Chain 'er on.
-    walk->next = allocEntry(str);
-    assert(walk->next->string);
-    result = walk->next->string;
     loom_mutex_unlock(gTableMutex);
 
+    assert(result);
     return result;
 }
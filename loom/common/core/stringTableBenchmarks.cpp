@@ -0,0 +1,76 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/common/core/benchmark.h"
+#include "loom/common/core/stringTable.h"
+
+#include <stdio.h>
+
+#define STRINGTABLEBENCH_STRINGS    4096
+
+static char gStringTableNames[STRINGTABLEBENCH_STRINGS][48];
+
+BENCHMARK_FIXTURE(stringTable)
+{
+    stringtable_initialize();
+
+    for (int i = 0; i < STRINGTABLEBENCH_STRINGS; i++)
+    {
+        sprintf(gStringTableNames[i], "loom2d.display.Sprite.member%d", i);
+        stringtable_insert(gStringTableNames[i]);
+    }
+
+    BENCHMARK_FIXTURE_ENTRY(stringTable_insertExisting);
+    BENCHMARK_FIXTURE_ENTRY(stringTable_insertNew);
+}
+
+// The common case, interning a string that already is
+BENCHMARK(stringTable_insertExisting)
+{
+    for (int i = 0; i < iterations; i++)
+    {
+        loom_benchmark_doNotOptimize(stringtable_insert(gStringTableNames[i & (STRINGTABLEBENCH_STRINGS - 1)]));
+    }
+}
+
+// Entries are never freed, so every run adds unique ones, named in
+// untimed batches
+BENCHMARK(stringTable_insertNew)
+{
+    static unsigned int counter = 0;
+    static char names[256][48];
+
+    for (int i = 0; i < iterations; i += 256)
+    {
+        int count = iterations - i < 256 ? iterations - i : 256;
+
+        loom_benchmark_pauseTiming();
+        for (int j = 0; j < count; j++)
+        {
+            sprintf(names[j], "benchmark.unique%u", counter++);
+        }
+        loom_benchmark_resumeTiming();
+
+        for (int j = 0; j < count; j++)
+        {
+            loom_benchmark_doNotOptimize(stringtable_insert(names[j]));
+        }
+    }
+}
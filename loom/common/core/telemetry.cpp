@@ -1,25 +1,48 @@
 #include "loom/common/core/telemetry.h"
 
 #include "loom/common/assets/assets.h"
+#include "loom/common/config/applicationConfig.h"
+#include "loom/common/core/allocator.h"
 #include "loom/common/core/log.h"
 #include "loom/common/core/performance.h"
 #include "loom/common/utils/fourcc.h"
 
+#include <math.h>
+#include <stdio.h>
+
 lmDefineLogGroup(gTelemetryLogGroup, "lt", true, LoomLogInfo)
 
 bool Telemetry::enabled = false;
 bool Telemetry::pendingEnabled = false;
 
 utByteArray Telemetry::sendBuffer;
+TelemetryStreamWriter Telemetry::streamWriter;
 
 int Telemetry::tickId = 0;
 
 TableValues<TickMetricValue> Telemetry::tickValues;
 
 loom_precision_timer_t Telemetry::tickTimer = loom_startTimer();
-utArray<utString> Telemetry::tickTimerStack;
+double Telemetry::tickStart = 0;
+
+utArray<utString> Telemetry::timerNames;
+utFlatHashTable<utHashedString, TickMetricID> Telemetry::timerIds;
+MutexHandle Telemetry::timerLock = loom_mutex_create();
+
+volatile atomic_int_t Telemetry::timerSlotStates[TELEMETRY_TIMER_THREADS];
+int Telemetry::timerSlotThreads[TELEMETRY_TIMER_THREADS];
+TickTimerRing *Telemetry::timerRings[TELEMETRY_TIMER_THREADS];
+utArray<Telemetry::StackedRange> Telemetry::tickTimerStacks[TELEMETRY_TIMER_THREADS];
+
 TableValues<TickMetricRange> Telemetry::tickRanges;
 
+utArray<size_t> Telemetry::tagAllocCounts;
+
+FILE *Telemetry::recordFile = NULL;
+
+utArray<Telemetry::StartupPhase> Telemetry::startupPhases;
+bool Telemetry::startupReported = false;
+
 // Initialize specialized constants for every type used
 // TickMetricValue
 template<> const TableType TableValues<TickMetricValue>::type = 1;
@@ -32,6 +55,7 @@ template<> const int TableValues<TickMetricRange>::packedItemSize = 4 + 4 * 4 +
 void Telemetry::enable()
 {
     pendingEnabled = true;
+    streamWriter.reset();
 }
 
 void Telemetry::disable()
@@ -44,131 +68,452 @@ void Telemetry::beginTick()
     if (enabled != pendingEnabled) {
         enabled = pendingEnabled;
         lmLog(gTelemetryLogGroup, "Telemetry %s", enabled ? "enabled" : "disabled");
+        if (enabled) reportIdentity();
     }
     if (!enabled) return;
 
     tickValues.reset();
     tickRanges.reset();
-    tickTimerStack.clear();
 
-    loom_resetTimer(tickTimer);
+    // Records left over from between the ticks would end up with
+    // times before the tick start, skip them
+    for (int i = 0; i < TELEMETRY_TIMER_THREADS; i++)
+    {
+        tickTimerStacks[i].clear();
+        if (atomic_load32(&timerSlotStates[i]) != 2) continue;
+        TickTimerRing *ring = timerRings[i];
+        atomic_store32(&ring->readIndex, atomic_load32(&ring->writeIndex));
+    }
+
+    tickStart = loom_readTimerNano(tickTimer);
 
     // Add the tick id as a default tick value
     setTickValue("tick.id", tickId);
+
+    if (!startupReported) reportStartupPhases();
 }
 
 void Telemetry::endTick()
 {
     if (!enabled) return;
 
-    lmAssert(tickTimerStack.size() == 0, "Tick timer end call missing");
+    double tickEnd = loom_readTimerNano(tickTimer);
 
-    // Customized asset protocol message (3 ints + tables)
-    int sendSize = (int)(3 * 4 + tickValues.size + tickRanges.size);
-    sendBuffer.resize(sendSize);
-    sendBuffer.setPosition(0);
-    sendBuffer.writeInt(sendSize);
+    int dropped = 0;
+    int ownSlot = -1;
+    int threadId = platform_getCurrentThreadId();
+
+    // Names are only appended to, but the array may move while another thread registers one
+    loom_mutex_lock(timerLock);
+    for (int i = 0; i < TELEMETRY_TIMER_THREADS; i++)
+    {
+        if (atomic_load32(&timerSlotStates[i]) != 2) continue;
+        if (timerSlotThreads[i] == threadId) ownSlot = i;
+        aggregateTimerRecords(i, tickEnd);
+
+        // Take the count of this tick, the owner may be adding to it meanwhile
+        volatile atomic_int_t *ringDropped = &timerRings[i]->dropped;
+        int count;
+        do {
+            count = atomic_load32(ringDropped);
+        } while (atomic_compareAndExchange(ringDropped, count, 0) != count);
+        dropped += count;
+    }
+    loom_mutex_unlock(timerLock);
+
+    lmAssert(ownSlot == -1 || tickTimerStacks[ownSlot].size() == 0, "Tick timer end call missing");
+
+    if (dropped > 0) setTickValue("telemetry.timer.dropped", dropped);
+
+    // Frame time in nanoseconds, like the timer ranges
+    setTickValue("tick.time", tickEnd - tickStart);
+
+    setAllocatorTagValues();
+
+    // Customized asset protocol message (3 ints + streamed tick)
+    sendBuffer.resize(0);
+    sendBuffer.writeInt(0);
     sendBuffer.writeInt(0xDEADBEEF);
-    sendBuffer.writeInt(LOOM_FOURCC('T', 'E', 'L', 'E'));
+    sendBuffer.writeInt(LOOM_FOURCC('T', 'E', 'L', 'B'));
 
-    tickValues.write(&sendBuffer);
-    tickRanges.write(&sendBuffer);
+    streamWriter.write(&sendBuffer, tickValues, tickRanges);
+
+    int sendSize = (int)sendBuffer.getPosition();
+    sendBuffer.setPosition(0);
+    sendBuffer.writeInt(sendSize);
 
     // Send the tick over the asset protocol
-    loom_asset_custom(sendBuffer.getDataPtr(), sendBuffer.getSize());
+    loom_asset_custom(sendBuffer.getDataPtr(), sendSize);
+
+    if (recordFile) recordTick(tickEnd - tickStart);
 
     tickId++;
 }
 
-void Telemetry::beginTickTimer(const char *name)
+bool Telemetry::startRecording(const char *path)
 {
-    if (!enabled) return;
+    stopRecording();
+
+    recordFile = fopen(path, "w");
+    if (!recordFile)
+    {
+        lmLogError(gTelemetryLogGroup, "Unable to open %s for recording", path);
+        return false;
+    }
+
+    lmLog(gTelemetryLogGroup, "Recording ticks to %s", path);
+    enable();
+
+    return true;
+}
+
+void Telemetry::stopRecording()
+{
+    if (!recordFile) return;
+
+    fclose(recordFile);
+    recordFile = NULL;
+}
+
+void Telemetry::recordTick(double tickTime)
+{
+    JSON tick;
+    tick.initObject();
+    tick.setInteger("tick", tickId);
+    tick.setNumber("time", tickTime / 1e6);
+
+    JSON ranges;
+    ranges.initObject();
+    for (UTsize i = 0; i < tickRanges.table.size(); i++)
+    {
+        const TickMetricRange &range = tickRanges.table.at(i);
+        ranges.setNumber(tickRanges.table.keyAt(i).str().c_str(), (range.b - range.a) / 1e6);
+    }
+    tick.setObject("ranges", &ranges);
+
+    JSON values;
+    tickValues.writeJSONObject(&values);
+    tick.setObject("values", &values);
+
+    const char *line = tick.serialize();
+    if (!line) return;
+
+    fputs(line, recordFile);
+    fputc('\n', recordFile);
+
+    lmFree(NULL, (void*)line);
+}
+
+void Telemetry::beginStartupPhase(const char *name)
+{
+    StartupPhase phase;
+    phase.name = name;
+    phase.begin = loom_readTimerNano(tickTimer) / 1e6;
+    phase.end = -1;
+
+    loom_mutex_lock(timerLock);
+    startupPhases.push_back(phase);
+    loom_mutex_unlock(timerLock);
+}
+
+void Telemetry::endStartupPhase(const char *name)
+{
+    double end = loom_readTimerNano(tickTimer) / 1e6;
 
+    loom_mutex_lock(timerLock);
+    for (UTsize i = startupPhases.size(); i > 0; i--)
+    {
+        StartupPhase &phase = startupPhases[i - 1];
+        if (phase.end >= 0 || phase.name != name) continue;
+
+        phase.end = end;
+        lmLogDebug(gTelemetryLogGroup, "Startup %s took %.2fms", name, phase.end - phase.begin);
+        break;
+    }
+    loom_mutex_unlock(timerLock);
+}
+
+void Telemetry::reportStartupPhases()
+{
+    char valueName[128];
+
+    loom_mutex_lock(timerLock);
+    for (UTsize i = 0; i < startupPhases.size(); i++)
+    {
+        const StartupPhase &phase = startupPhases[i];
+        if (phase.end < 0) continue;
+
+        snprintf(valueName, sizeof(valueName), "startup.%s.begin", phase.name.c_str());
+        setTickValue(valueName, phase.begin);
+        snprintf(valueName, sizeof(valueName), "startup.%s.end", phase.name.c_str());
+        setTickValue(valueName, phase.end);
+    }
+    loom_mutex_unlock(timerLock);
+
+    startupReported = true;
+}
+
+void Telemetry::reportIdentity()
+{
+#if LOOM_PLATFORM == LOOM_PLATFORM_WIN32
+    const char *platform = "windows";
+#elif LOOM_PLATFORM == LOOM_PLATFORM_OSX
+    const char *platform = "osx";
+#elif LOOM_PLATFORM == LOOM_PLATFORM_IOS
+    const char *platform = "ios";
+#elif LOOM_PLATFORM == LOOM_PLATFORM_ANDROID
+    const char *platform = "android";
+#else
+    const char *platform = "linux";
+#endif
+
+    JSON identity;
+    identity.initObject();
+    identity.setString("app", LoomApplicationConfig::applicationId().c_str());
+    identity.setString("build", LoomApplicationConfig::version().c_str());
+    identity.setString("platform", platform);
+    identity.setInteger("bits", LOOM_PLATFORM_64BIT ? 64 : 32);
+
+    const char *json = identity.serialize();
+    if (!json) return;
+
+    // Customized asset protocol message (3 ints + null terminated JSON)
+    utByteArray buffer;
+    buffer.writeInt(0);
+    buffer.writeInt(0xDEADBEEF);
+    buffer.writeInt(LOOM_FOURCC('T', 'E', 'L', 'I'));
+    buffer.writeUTFBytes(json);
+    buffer.writeByte(0);
+
+    lmFree(NULL, (void*)json);
+
+    int sendSize = (int)buffer.getPosition();
+    buffer.setPosition(0);
+    buffer.writeInt(sendSize);
+
+    loom_asset_custom(buffer.getDataPtr(), sendSize);
+}
+
+TickMetricID Telemetry::registerTickTimer(const char *name)
+{
     utHashedString key = utHashedString(name);
 
-    TickMetricRange *stored = tickRanges.table.get(key);
+    loom_mutex_lock(timerLock);
 
-    const int uniqueLen = 128;
-    static char uniqueName[uniqueLen];
-    int dup = 0;
+    TickMetricID *stored = timerIds.get(key);
+    TickMetricID id;
 
-    // A range with the specified name already exists,
-    // mark this one as a duplicate and append the sequential duplicate number at the end
     if (stored != NULL)
     {
-        stored->duplicates++;
-        stored->duplicatesOnStack++;
-        snprintf(uniqueName, uniqueLen - 1, "%s #%d", name, stored->duplicates+1);
-        uniqueName[uniqueLen - 1] = 0;
+        id = *stored;
+    }
+    else
+    {
+        id = (TickMetricID)timerNames.size();
+        timerNames.push_back(utString(name));
+        timerIds.insert(key, id);
+    }
+
+    loom_mutex_unlock(timerLock);
 
-        key = utHashedString(uniqueName);
+    return id;
+}
+
+TickTimerRing *Telemetry::getTimerRing()
+{
+    int threadId = platform_getCurrentThreadId();
+
+    for (int i = 0; i < TELEMETRY_TIMER_THREADS; i++)
+    {
+        int state = atomic_load32(&timerSlotStates[i]);
+
+        if (state == 2)
+        {
+            if (timerSlotThreads[i] == threadId) return timerRings[i];
+            continue;
+        }
+
+        // Slots are claimed in order, so the first free one
+        // means this thread doesn't have one yet
+        if (state == 0 && atomic_compareAndExchange(&timerSlotStates[i], 0, 1) == 0)
+        {
+            TickTimerRing *ring = (TickTimerRing *)lmAlloc(NULL, sizeof(TickTimerRing));
+            ring->writeIndex = 0;
+            ring->readIndex = 0;
+            ring->dropped = 0;
+
+            timerRings[i] = ring;
+            timerSlotThreads[i] = threadId;
+            atomic_store32(&timerSlotStates[i], 2);
+            return ring;
+        }
     }
 
-    utString parentName = tickTimerStack.size() > 0 ? tickTimerStack.back() : NULL;
-    TickMetricRange *parent = tickRanges.table.get(utHashedString(parentName));
+    return NULL;
+}
+
+void Telemetry::writeTimerRecord(TickMetricID id, int begin)
+{
+    double time = loom_readTimerNano(tickTimer);
+
+    TickTimerRing *ring = getTimerRing();
+    if (ring == NULL) return;
 
-    // Init values of the new metric based on its parent and siblings
-    TickMetricRange metric;
-    metric.id = tickRanges.sequence++;
-    lmAssert(metric.id >= 0, "Invalid id");
-    metric.parent = parent ? parent->id : -1;
-    metric.level = parent ? parent->level + 1 : 0;
-    metric.children = 0;
-    metric.sibling = parent ? parent->children : 0;
-    metric.duplicates = 0;
-    metric.duplicatesOnStack = 0;
-    if (parent) parent->children++;
+    // Only this thread writes, so the write index can be read directly
+    int write = ring->writeIndex;
+    int read = atomic_load32(&ring->readIndex);
 
-    // Insert it into the table
-    bool inserted = tickRanges.table.insert(key, metric);
-    lmAssert(inserted, "Tick timer insertion error");
+    if ((unsigned int)(write - read) >= TELEMETRY_TIMER_RECORDS)
+    {
+        atomic_increment(&ring->dropped);
+        return;
+    }
 
-    // String written size is short length + data
-    int strSize = (int)(2 + strlen(key.str().c_str()));
-    tickRanges.size += strSize + TableValues<TickMetricRange>::packedItemSize;
-    
-    // This should be fairly quick as the last inserted value should be cached
-    stored = tickRanges.table.get(key);
-    tickTimerStack.push_back(key.str());
+    TickTimerRecord *record = &ring->records[write & (TELEMETRY_TIMER_RECORDS - 1)];
+    record->id = id;
+    record->begin = begin;
+    record->time = time;
 
-    double tickNano = loom_readTimerNano(tickTimer);
-    
-    // Set the start time at the very end
-    // TODO measure overhead of the code above and include that in the metrics
-    stored->a = tickNano;
+    // Publish the record to the tick end
+    atomic_store32(&ring->writeIndex, write + 1);
+}
+
+void Telemetry::aggregateTimerRecords(int slot, double tickEnd)
+{
+    TickTimerRing *ring = timerRings[slot];
+    utArray<StackedRange> &stack = tickTimerStacks[slot];
+
+    int read = ring->readIndex;
+    int write = atomic_load32(&ring->writeIndex);
+
+    for (; read != write; read++)
+    {
+        const TickTimerRecord &record = ring->records[read & (TELEMETRY_TIMER_RECORDS - 1)];
+        double time = record.time - tickStart;
+
+        if (!record.begin)
+        {
+            // Ends of ranges began before the tick have nothing to close
+            if (stack.size() == 0) continue;
+
+            StackedRange &top = stack.back();
+            lmAssert(top.id == record.id, "Tick timer %s end call mismatched with %s", timerNames[record.id].c_str(), timerNames[top.id].c_str());
+
+            TickMetricRange *stacked = tickRanges.table.get(top.key);
+            lmAssert(stacked != NULL, "Tick timer %s begin call missing", timerNames[record.id].c_str());
+            stacked->b = time;
+
+            stack.pop_back();
+            continue;
+        }
+
+        const char *name = timerNames[record.id].c_str();
+        utHashedString key = utHashedString(name);
+
+        TickMetricRange *stored = tickRanges.table.get(key);
+
+        const int uniqueLen = 128;
+        char uniqueName[uniqueLen];
+
+        // A range with the specified name already exists,
+        // mark this one as a duplicate and append the sequential duplicate number at the end
+        if (stored != NULL)
+        {
+            stored->duplicates++;
+            snprintf(uniqueName, uniqueLen - 1, "%s #%d", name, stored->duplicates+1);
+            uniqueName[uniqueLen - 1] = 0;
+
+            key = utHashedString(uniqueName);
+        }
+
+        TickMetricRange *parent = stack.size() > 0 ? tickRanges.table.get(stack.back().key) : NULL;
+
+        // Init values of the new metric based on its parent and siblings
+        TickMetricRange metric;
+        metric.id = tickRanges.sequence++;
+        lmAssert(metric.id >= 0, "Invalid id");
+        metric.parent = parent ? parent->id : -1;
+        metric.level = parent ? parent->level + 1 : 0;
+        metric.children = 0;
+        metric.sibling = parent ? parent->children : 0;
+        metric.duplicates = 0;
+        metric.duplicatesOnStack = 0;
+        metric.a = time;
+        // Closed at the tick end if the end call hasn't been recorded by then
+        metric.b = tickEnd - tickStart;
+        if (parent) parent->children++;
+
+        // Insert it into the table
+        bool inserted = tickRanges.table.insert(key, metric);
+        lmAssert(inserted, "Tick timer insertion error");
+
+        // String written size is short length + data
+        int strSize = (int)(2 + strlen(key.str().c_str()));
+        tickRanges.size += strSize + TableValues<TickMetricRange>::packedItemSize;
+
+        StackedRange stacked;
+        stacked.id = record.id;
+        stacked.key = key;
+        stack.push_back(stacked);
+    }
+
+    atomic_store32(&ring->readIndex, read);
+
+    // Ranges still open on other threads are reported up to the tick end,
+    // their ends will turn up after the stack is gone and get skipped
+    if (timerSlotThreads[slot] != platform_getCurrentThreadId()) stack.clear();
+}
+
+void Telemetry::beginTickTimer(TickMetricID id)
+{
+    if (!enabled) return;
+
+    writeTimerRecord(id, 1);
+}
+
+void Telemetry::endTickTimer(TickMetricID id)
+{
+    if (!enabled) return;
+
+    writeTimerRecord(id, 0);
+}
+
+void Telemetry::beginTickTimer(const char *name)
+{
+    if (!enabled) return;
+
+    writeTimerRecord(registerTickTimer(name), 1);
 }
 
 void Telemetry::endTickTimer(const char *name)
 {
     if (!enabled) return;
 
-    double tickNano = loom_readTimerNano(tickTimer);
+    writeTimerRecord(registerTickTimer(name), 0);
+}
 
-    utHashedString key = utHashedString(name);
+void Telemetry::setAllocatorTagValues()
+{
+    int tagCount = loom_allocator_getTagCount();
+    char name[128];
 
-    lmAssert(tickTimerStack.size() > 0, "Tick timer %s begin call missing (stack empty)");
+    for (int i = 0; i < tagCount; i++)
+    {
+        loom_allocatorTagStats_t stats;
+        if (!loom_allocator_getTagStats(i, &stats)) continue;
 
-    TickMetricRange *stored = tickRanges.table.get(key);
-    utString stackedName = tickTimerStack.back();
-    TickMetricRange *stacked = tickRanges.table.get(utHashedString(stackedName));
+        // Tags are only ever added, so a tag keeps its index
+        if ((int)tagAllocCounts.size() <= i) tagAllocCounts.push_back(stats.totalCount);
 
-    lmAssert(stored->id >= 0 && stacked->id >= 0, "Invalid id");
-    lmAssert(stored != NULL && stacked != NULL, "Tick timer %s begin call missing");
-    
-    // If the stack and stored ids don't match
-    // it means the stack metric was a modified duplicate
-    // with a different unique name, so we can decrement the
-    // number of duplicates on stack of the originally named stored metric
-    if (stored->id != stacked->id) {
-        stored->duplicatesOnStack--;
-        lmAssert(stored->duplicatesOnStack >= 0, "Tick metric mismatched begin/end calls");
-    }
+        snprintf(name, sizeof(name), "memory.%s.live", stats.tag);
+        setTickValue(name, (double)stats.liveBytes);
+        snprintf(name, sizeof(name), "memory.%s.peak", stats.tag);
+        setTickValue(name, (double)stats.peakBytes);
+        snprintf(name, sizeof(name), "memory.%s.allocs", stats.tag);
+        setTickValue(name, (double)(stats.totalCount - tagAllocCounts[i]));
 
-    tickTimerStack.pop_back();
-    
-    // Set the end time of the tick on the stack taken from the enter time of the function
-    // TODO measure overhead as with begin
-    stacked->b = tickNano;
+        tagAllocCounts[i] = stats.totalCount;
+    }
 }
 
 TickMetricValue* Telemetry::setTickValue(const char *name, double value)
@@ -201,3 +546,221 @@ TickMetricValue* Telemetry::setTickValue(const char *name, double value)
 
     return stored;
 }
+
+
+void TelemetryStream::writeVarUInt(utByteArray *buffer, unsigned long long value)
+{
+    while (value >= 0x80)
+    {
+        buffer->writeUnsignedByte((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    buffer->writeUnsignedByte((unsigned char)value);
+}
+
+void TelemetryStream::writeVarInt(utByteArray *buffer, long long value)
+{
+    writeVarUInt(buffer, ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63));
+}
+
+unsigned long long TelemetryStream::readVarUInt(utByteArray *buffer, bool &ok)
+{
+    unsigned long long value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (buffer->bytesAvailable() == 0) break;
+        unsigned char b = buffer->readUnsignedByte();
+        value |= (unsigned long long)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return value;
+    }
+    ok = false;
+    return 0;
+}
+
+long long TelemetryStream::readVarInt(utByteArray *buffer, bool &ok)
+{
+    unsigned long long value = readVarUInt(buffer, ok);
+    return (long long)(value >> 1) ^ -(long long)(value & 1);
+}
+
+// Values representable as a 64 bit integer without loss get delta encoded
+static bool telemetryIsIntegral(double value)
+{
+    return value >= -9007199254740992.0 && value <= 9007199254740992.0 && value == floor(value);
+}
+
+static long long telemetryNanos(double value)
+{
+    return (long long)floor(value + 0.5);
+}
+
+void TelemetryStreamWriter::reset()
+{
+    nameIds.clear();
+    names.clear();
+    previous.clear();
+    pendingReset = true;
+}
+
+int TelemetryStreamWriter::resolveName(const utHashedString &name)
+{
+    int *stored = nameIds.get(name);
+    if (stored != NULL) return *stored;
+
+    int id = (int)names.size();
+    nameIds.insert(name, id);
+    names.push_back(name);
+    previous.push_back(0);
+    return id;
+}
+
+void TelemetryStreamWriter::write(utByteArray *buffer, TableValues<TickMetricValue> &values, TableValues<TickMetricRange> &ranges)
+{
+    // Resolve the names first, so the new ones can go out ahead of their use
+    UTsize firstNew = names.size();
+    for (UTsize i = 0; i < values.table.size(); i++) resolveName(values.table.keyAt(i));
+    for (UTsize i = 0; i < ranges.table.size(); i++) resolveName(ranges.table.keyAt(i));
+
+    buffer->writeUnsignedByte(pendingReset ? TELEMETRY_STREAM_RESET : 0);
+    pendingReset = false;
+
+    TelemetryStream::writeVarUInt(buffer, names.size() - firstNew);
+    for (UTsize i = firstNew; i < names.size(); i++)
+    {
+        const utString &name = names[i].str();
+        TelemetryStream::writeVarUInt(buffer, name.length());
+        buffer->writeUTFBytes(name.c_str());
+    }
+
+    TelemetryStream::writeVarUInt(buffer, values.table.size());
+    for (UTsize i = 0; i < values.table.size(); i++)
+    {
+        int id = *nameIds.get(values.table.keyAt(i));
+        double value = values.table.at(i).value;
+
+        if (telemetryIsIntegral(value))
+        {
+            long long integral = (long long)value;
+            TelemetryStream::writeVarUInt(buffer, (unsigned long long)id << 1);
+            TelemetryStream::writeVarInt(buffer, integral - previous[id]);
+            previous[id] = integral;
+        }
+        else
+        {
+            TelemetryStream::writeVarUInt(buffer, ((unsigned long long)id << 1) | 1);
+            buffer->writeDouble(value);
+        }
+    }
+
+    long long lastStart = 0;
+    TelemetryStream::writeVarUInt(buffer, ranges.table.size());
+    for (UTsize i = 0; i < ranges.table.size(); i++)
+    {
+        const TickMetricRange &range = ranges.table.at(i);
+        lmAssert(range.id == (TickMetricID)i, "Tick ranges expected in id order");
+
+        long long start = telemetryNanos(range.a);
+
+        TelemetryStream::writeVarUInt(buffer, *nameIds.get(ranges.table.keyAt(i)));
+        TelemetryStream::writeVarUInt(buffer, range.parent < 0 ? 0 : range.id - range.parent);
+        TelemetryStream::writeVarInt(buffer, start - lastStart);
+        TelemetryStream::writeVarInt(buffer, telemetryNanos(range.b) - start);
+
+        lastStart = start;
+    }
+}
+
+bool TelemetryStreamReader::read(utByteArray *buffer, TableValues<TickMetricValue> &values, TableValues<TickMetricRange> &ranges)
+{
+    values.reset();
+    ranges.reset();
+
+    if (buffer->bytesAvailable() == 0) return false;
+
+    unsigned char flags = buffer->readUnsignedByte();
+    if (flags & TELEMETRY_STREAM_RESET)
+    {
+        names.clear();
+        previous.clear();
+        synced = true;
+    }
+
+    if (!synced) return false;
+
+    // Any inconsistency below desyncs the reader until the next reset
+    synced = false;
+    bool ok = true;
+
+    unsigned long long count = TelemetryStream::readVarUInt(buffer, ok);
+    for (unsigned long long i = 0; ok && i < count; i++)
+    {
+        unsigned long long length = TelemetryStream::readVarUInt(buffer, ok);
+        if (!ok || length > buffer->bytesAvailable()) return false;
+        utString name;
+        name.assign(buffer->readUTFBytesView((unsigned int)length), (int)length);
+        names.push_back(UT_MOVE(name));
+        previous.push_back(0);
+    }
+
+    count = TelemetryStream::readVarUInt(buffer, ok);
+    for (unsigned long long i = 0; ok && i < count; i++)
+    {
+        unsigned long long tag = TelemetryStream::readVarUInt(buffer, ok);
+        UTsize id = (UTsize)(tag >> 1);
+        if (!ok || id >= names.size()) return false;
+
+        TickMetricValue metric;
+        metric.id = values.sequence++;
+
+        if (tag & 1)
+        {
+            if (buffer->bytesAvailable() < 8) return false;
+            metric.value = buffer->readDouble();
+        }
+        else
+        {
+            previous[id] += TelemetryStream::readVarInt(buffer, ok);
+            metric.value = (double)previous[id];
+        }
+
+        if (!values.table.insert(utHashedString(names[id]), metric)) return false;
+        values.size += 2 + names[id].length() + TableValues<TickMetricValue>::packedItemSize;
+    }
+
+    long long lastStart = 0;
+    count = TelemetryStream::readVarUInt(buffer, ok);
+    for (unsigned long long i = 0; ok && i < count; i++)
+    {
+        UTsize id = (UTsize)TelemetryStream::readVarUInt(buffer, ok);
+        unsigned long long parentDelta = TelemetryStream::readVarUInt(buffer, ok);
+        long long start = lastStart + TelemetryStream::readVarInt(buffer, ok);
+        long long end = start + TelemetryStream::readVarInt(buffer, ok);
+        if (!ok || id >= names.size() || parentDelta > i) return false;
+
+        TickMetricRange metric;
+        metric.id = ranges.sequence++;
+        metric.parent = parentDelta == 0 ? -1 : (TickMetricID)(i - parentDelta);
+        metric.level = 0;
+        metric.children = 0;
+        metric.sibling = 0;
+        metric.a = (double)start;
+        metric.b = (double)end;
+        metric.duplicates = 0;
+        metric.duplicatesOnStack = 0;
+
+        if (metric.parent >= 0)
+        {
+            TickMetricRange &parent = ranges.table.at(metric.parent);
+            metric.level = parent.level + 1;
+            metric.sibling = parent.children++;
+        }
+
+        if (!ranges.table.insert(utHashedString(names[id]), metric)) return false;
+        ranges.size += 2 + names[id].length() + TableValues<TickMetricRange>::packedItemSize;
+
+        lastStart = start;
+    }
+
+    synced = ok;
+    return ok;
+}
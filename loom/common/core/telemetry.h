@@ -2,11 +2,14 @@
 #define _ASSETS_TELEMETRY_H_
 
 #include "loom/common/platform/platformTime.h"
+#include "loom/common/platform/platformThread.h"
 #include "loom/common/assets/assetProtocol.h"
 #include "loom/common/utils/utTypes.h"
 #include "loom/common/utils/utByteArray.h"
 #include "loom/common/utils/json.h"
 
+#include <stdio.h>
+
 // Type alias for metric IDs
 typedef int TickMetricID;
 
@@ -126,6 +129,31 @@ struct TickMetricRange : TickMetricBase
     }
 };
 
+// Fixed size record of a timer range beginning or ending, written by
+// Telemetry::beginTickTimer / endTickTimer and aggregated at the tick end
+struct TickTimerRecord
+{
+    TickMetricID id;
+    int begin;
+    double time;
+};
+
+// Number of threads that can record timer ranges, further threads are ignored
+#define TELEMETRY_TIMER_THREADS    16
+
+// Records buffered per thread between tick ends (power of two),
+// records beyond it are dropped until the next tick
+#define TELEMETRY_TIMER_RECORDS    4096
+
+// Single producer, single consumer ring of timer records owned by one thread
+struct TickTimerRing
+{
+    volatile atomic_int_t writeIndex;
+    volatile atomic_int_t readIndex;
+    volatile atomic_int_t dropped;
+    TickTimerRecord records[TELEMETRY_TIMER_RECORDS];
+};
+
 // Type alias for the table type ID
 typedef unsigned char TableType;
 
@@ -141,7 +169,7 @@ struct TableValues
     int sequence;
 
     // The hash table holding the key-value pairs
-    utHashTable<utHashedString, TableValue> table;
+    utFlatHashTable<utHashedString, TableValue> table;
 
     // Size of the table in bytes
     size_t size;
@@ -249,7 +277,10 @@ struct TableValues
         unsigned int startPos = buffer->getPosition() - HEADER_SIZE;
         while (buffer->getPosition() - startPos < size)
         {
-            const char* name = buffer->readUTF();
+            unsigned int length;
+            const char* bytes = buffer->readUTFView(length);
+            utString name;
+            name.assign(bytes, length);
             TableValue value;
             value.read(buffer);
             bool inserted = table.insert(utHashedString(name), value);
@@ -262,6 +293,76 @@ struct TableValues
 
 };
 
+// Flags of a streamed tick
+#define TELEMETRY_STREAM_RESET    1
+
+// Compact binary encoding of consecutive ticks, sent as TELB messages
+//
+// Metric names are sent once in a dictionary shared by values and ranges and
+// referenced by their index after that. Integral values are sent as varint
+// deltas of the previous value of the same name, others as raw doubles.
+// Range ids, levels, children and siblings are implied by their order and
+// parent, times are sent as varint nanosecond deltas.
+//
+// Tick layout (varints are LEB128, signed ones zigzag encoded):
+//   flags byte, TELEMETRY_STREAM_RESET on the first tick of a stream
+//   new name count, then every new name as its length and bytes
+//   value count, then per value (name << 1 | 1 if raw double) and the
+//     signed delta or the double
+//   range count, then per range its name, id - parent id (0 for roots),
+//     signed start delta from the previous range and signed duration
+struct TelemetryStream
+{
+    static void writeVarUInt(utByteArray *buffer, unsigned long long value);
+    static void writeVarInt(utByteArray *buffer, long long value);
+
+    // Both set ok to false when the buffer runs out
+    static unsigned long long readVarUInt(utByteArray *buffer, bool &ok);
+    static long long readVarInt(utByteArray *buffer, bool &ok);
+};
+
+// Encodes ticks into a stream, keeping the dictionary and previous values
+class TelemetryStreamWriter
+{
+    utFlatHashTable<utHashedString, int> nameIds;
+    utArray<utHashedString> names;
+    utArray<long long> previous;
+    bool pendingReset;
+
+    int resolveName(const utHashedString &name);
+
+public:
+    TelemetryStreamWriter() : pendingReset(true) {}
+
+    // Start a new stream, the next tick carries the whole dictionary again
+    void reset();
+
+    // Append the tick to the buffer at its current position
+    void write(utByteArray *buffer, TableValues<TickMetricValue> &values, TableValues<TickMetricRange> &ranges);
+};
+
+// Decodes ticks encoded by TelemetryStreamWriter
+class TelemetryStreamReader
+{
+    utArray<utString> names;
+    utArray<long long> previous;
+    bool synced;
+
+public:
+    TelemetryStreamReader() : synced(false) {}
+
+    // Returns true if a stream reset has been read and the ticks since decoded fine
+    inline bool isSynced()
+    {
+        return synced;
+    }
+
+    // Read a tick into the provided tables, returns false if the tick can't
+    // be decoded, e.g. the stream started before the reader did, in which
+    // case the reader stays out of sync until the next reset
+    bool read(utByteArray *buffer, TableValues<TickMetricValue> &values, TableValues<TickMetricRange> &ranges);
+};
+
 // App level Telemetry API for setting values / metrics and configuring the behavior
 class Telemetry
 {
@@ -275,27 +376,92 @@ protected:
     // Temporary buffer used while sending the tick
     static utByteArray sendBuffer;
 
+    // Encoder of the sent ticks
+    static TelemetryStreamWriter streamWriter;
+
     // Stored values of the current tick
     static TableValues<TickMetricValue> tickValues;
 
 
-    // Timer used for timing tick ranges
+    // Timer used for timing tick ranges, never reset so it can be read from any thread
     static loom_precision_timer_t tickTimer;
-    
-    // Timer names began, but not ended yet
-    // Essentially a timer stack
-    static utArray<utString> tickTimerStack;
-    
+
+    // Timer time the current tick began at
+    static double tickStart;
+
+    // Timer names indexed by their registered ID and the reverse lookup,
+    // both guarded by timerLock
+    static utArray<utString> timerNames;
+    static utFlatHashTable<utHashedString, TickMetricID> timerIds;
+    static MutexHandle timerLock;
+
+    // Per thread record rings, a slot is claimed by a thread on its first
+    // record (0 free, 1 claiming, 2 ready) and kept for good
+    static volatile atomic_int_t timerSlotStates[TELEMETRY_TIMER_THREADS];
+    static int timerSlotThreads[TELEMETRY_TIMER_THREADS];
+    static TickTimerRing *timerRings[TELEMETRY_TIMER_THREADS];
+
+    // Ranges began, but not ended yet, per thread slot
+    // Essentially a timer stack for every thread
+    struct StackedRange
+    {
+        TickMetricID id;
+        utHashedString key;
+    };
+    static utArray<StackedRange> tickTimerStacks[TELEMETRY_TIMER_THREADS];
+
     // Stored ranges of the current tick
     static TableValues<TickMetricRange> tickRanges;
 
+    // Returns the ring of the calling thread, claiming one if needed, NULL if all are taken
+    static TickTimerRing *getTimerRing();
+
+    // Write a record to the ring of the calling thread
+    static void writeTimerRecord(TickMetricID id, int begin);
+
+    // Turn the records of a thread slot into ranges
+    static void aggregateTimerRecords(int slot, double tickEnd);
+
     // Current tick ID
     static int tickId;
 
+    // Allocations per allocator tag at the end of the previous tick
+    static utArray<size_t> tagAllocCounts;
+
+    // Report the stats of every allocator tag as tick values
+    static void setAllocatorTagValues();
+
+    // File every tick is appended to while recording, NULL otherwise
+    static FILE *recordFile;
+
+    // Append the tick taking tickTime nanoseconds to the record file
+    static void recordTick(double tickTime);
+
+    // Phases of the application startup in timer milliseconds, guarded by
+    // timerLock, an end below zero means the phase is still running
+    struct StartupPhase
+    {
+        utString name;
+        double begin;
+        double end;
+    };
+    static utArray<StartupPhase> startupPhases;
+
+    // Set once the startup phases were sent as tick values
+    static bool startupReported;
+
+    // Set the startup phases as values of the current tick
+    static void reportStartupPhases();
+
+    // Send the application id, build version and platform as a TELI message,
+    // so the listener can keep the ticks of different builds and devices apart
+    static void reportIdentity();
+
 public:
 
     // Enable telemetry functionality
     // This will take effect when the next tick begins
+    // and restarts the stream, so a new listener gets the whole dictionary
     static void enable();
 
     // Disable telemetry functionality
@@ -316,12 +482,43 @@ public:
     // Call at the end of the tick
     static void endTick();
 
+    // Resolve a timer name to an ID once, e.g. into a static, so that
+    // beginning and ending the range doesn't have to touch the name again
+    // Registering the same name again returns the same ID, safe from any thread
+    static TickMetricID registerTickTimer(const char *name);
+
+    // Begin a timer range using a registered ID
+    // Safe to call from any thread, ranges of other threads than the one
+    // calling endTick are reported as roots
+    static void beginTickTimer(TickMetricID id);
+
+    // End the timer range previously began with the specified ID
+    static void endTickTimer(TickMetricID id);
+
     // Begin a timer range using the specified name
+    // Slower than the ID variant as the name is looked up on every call
     static void beginTickTimer(const char *name);
 
     // End the timer range previously began with the specified name
     static void endTickTimer(const char *name);
 
+    // Write every tick to a file until stopRecording, a line of JSON each
+    // with its id, its time and the durations of its ranges in milliseconds
+    // and its values. Enables telemetry, returns false if the file can't be opened
+    static bool startRecording(const char *path);
+
+    // Close the record file, telemetry stays enabled
+    static void stopRecording();
+
+    // Begin a phase of the application startup, safe to call from any thread
+    // and before telemetry is enabled. The phases are reported once, on the
+    // first enabled tick, as startup.<name>.begin and startup.<name>.end
+    // values in milliseconds since the process started
+    static void beginStartupPhase(const char *name);
+
+    // End the startup phase previously began with the specified name
+    static void endStartupPhase(const char *name);
+
     // Set an arbitrary floating point value associated with the current tick and name
     // Previously set values of the same name get overwritten
     // To avoid name conflicts it is suggested to use namespaced names (e.g. gc.cycle.update.count)
@@ -329,4 +526,45 @@ public:
 
 };
 
+// Times the rest of the enclosing scope as a tick range
+class TelemetryScopedTimer
+{
+    TickMetricID id;
+
+public:
+    TelemetryScopedTimer(TickMetricID _id) : id(_id)
+    {
+        Telemetry::beginTickTimer(id);
+    }
+
+    ~TelemetryScopedTimer()
+    {
+        Telemetry::endTickTimer(id);
+    }
+};
+
+// Times the rest of the enclosing scope as a startup phase
+class TelemetryStartupPhase
+{
+    const char *name;
+
+public:
+    TelemetryStartupPhase(const char *_name) : name(_name)
+    {
+        Telemetry::beginStartupPhase(name);
+    }
+
+    ~TelemetryStartupPhase()
+    {
+        Telemetry::endStartupPhase(name);
+    }
+};
+
+#define LOOM_STARTUP_PHASE(name)                                                             \
+    TelemetryStartupPhase telemetryStartup ## name(# name);
+
+#define LOOM_TELEMETRY_SCOPE(name)                                                           \
+    static TickMetricID telemetryId ## name = Telemetry::registerTickTimer(# name);    \
+    TelemetryScopedTimer telemetryScope ## name(telemetryId ## name);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,175 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/common/core/touchCoalescer.h"
+
+#include <string.h>
+
+TouchCoalescer::TouchCoalescer()
+{
+    for (int i = 0; i < MAX_POINTERS; i++)
+    {
+        pointers[i].used = false;
+        pointers[i].pending = false;
+        pointers[i].pendingLength = 0;
+        pointers[i].historyLength = 0;
+    }
+
+    nextOrder = 0;
+    dispatchCallback = NULL;
+    dispatchUserData = NULL;
+}
+
+void TouchCoalescer::setDispatchCallback(DispatchCallback callback, void *userData)
+{
+    dispatchCallback = callback;
+    dispatchUserData = userData;
+}
+
+TouchCoalescer::Pointer *TouchCoalescer::find(int id) const
+{
+    for (int i = 0; i < MAX_POINTERS; i++)
+    {
+        if (pointers[i].used && pointers[i].id == id) return const_cast<Pointer*>(&pointers[i]);
+    }
+
+    return NULL;
+}
+
+TouchCoalescer::Pointer *TouchCoalescer::acquire(int id)
+{
+    Pointer *pointer = find(id);
+    if (pointer) return pointer;
+
+    // Pointers come and go with fingers, an idle one is taken over, the
+    // one idle the longest so the latest histories stay around
+    Pointer *oldest = NULL;
+    for (int i = 0; i < MAX_POINTERS; i++)
+    {
+        Pointer &candidate = pointers[i];
+        if (!candidate.used)
+        {
+            oldest = &candidate;
+            break;
+        }
+        if (!candidate.pending && (!oldest || candidate.order < oldest->order)) oldest = &candidate;
+    }
+
+    if (!oldest) return NULL;
+
+    oldest->id = id;
+    oldest->used = true;
+    oldest->pending = false;
+    oldest->pendingLength = 0;
+    oldest->historyLength = 0;
+
+    return oldest;
+}
+
+void TouchCoalescer::moved(int id, float x, float y, int buttons, double time)
+{
+    Pointer *pointer = acquire(id);
+
+    if (!pointer)
+    {
+        // Every pointer is busy, this one goes out as it is
+        Move move = { id, x, y, buttons, 1 };
+        if (dispatchCallback) dispatchCallback(dispatchUserData, move);
+        return;
+    }
+
+    // A press or release in between is a different move
+    if (pointer->pending && pointer->buttons != buttons) dispatch(*pointer);
+
+    if (!pointer->pending)
+    {
+        pointer->pending = true;
+        pointer->samples = 0;
+        pointer->pendingLength = 0;
+        pointer->order = nextOrder++;
+    }
+
+    if (pointer->pendingLength == MAX_SAMPLES)
+    {
+        memmove(pointer->pendingHistory, pointer->pendingHistory + 1, (MAX_SAMPLES - 1) * sizeof(Sample));
+        pointer->pendingLength--;
+    }
+
+    Sample &sample = pointer->pendingHistory[pointer->pendingLength++];
+    sample.x = x;
+    sample.y = y;
+    sample.time = time;
+
+    pointer->buttons = buttons;
+    pointer->samples++;
+}
+
+void TouchCoalescer::dispatch(Pointer &pointer)
+{
+    pointer.pending = false;
+
+    // The history moves over before dispatching, so it can be read
+    // from the callback
+    memcpy(pointer.history, pointer.pendingHistory, pointer.pendingLength * sizeof(Sample));
+    pointer.historyLength = pointer.pendingLength;
+    pointer.pendingLength = 0;
+
+    const Sample &last = pointer.history[pointer.historyLength - 1];
+    Move move = { pointer.id, last.x, last.y, pointer.buttons, pointer.samples };
+
+    if (dispatchCallback) dispatchCallback(dispatchUserData, move);
+}
+
+void TouchCoalescer::flush(int id)
+{
+    Pointer *pointer = find(id);
+    if (pointer && pointer->pending) dispatch(*pointer);
+}
+
+void TouchCoalescer::flushAll()
+{
+    // Dispatching may call back in with moves, so the next pointer in
+    // order is looked up every time rather than sorted up front
+    for (;;)
+    {
+        Pointer *first = NULL;
+        for (int i = 0; i < MAX_POINTERS; i++)
+        {
+            Pointer &pointer = pointers[i];
+            if (pointer.used && pointer.pending && (!first || pointer.order < first->order)) first = &pointer;
+        }
+
+        if (!first) return;
+
+        dispatch(*first);
+    }
+}
+
+int TouchCoalescer::getHistoryLength(int id) const
+{
+    Pointer *pointer = find(id);
+    return pointer ? pointer->historyLength : 0;
+}
+
+const TouchCoalescer::Sample *TouchCoalescer::getHistory(int id) const
+{
+    Pointer *pointer = find(id);
+    return pointer && pointer->historyLength > 0 ? pointer->history : NULL;
+}
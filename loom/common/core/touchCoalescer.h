@@ -0,0 +1,116 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _CORE_TOUCHCOALESCER_H_
+#define _CORE_TOUCHCOALESCER_H_
+
+/**
+ * Coalesces pointer moves per pointer per frame.
+ *
+ * Touch screens sampling at 120-240Hz and high rate mice report several
+ * moves of a pointer between two frames, and dispatching each through the
+ * display list costs a hit test and a TouchEvent to script. Moves are
+ * recorded here as they arrive and one move per pointer, to where it
+ * ended up, is dispatched when the frame's events have been polled, or
+ * before anything else happens to the pointer, so the order of a pointer's
+ * begin, moves and end is kept.
+ *
+ * The samples merged into the last dispatched move of a pointer remain
+ * available as its history, for gestures that care about the path taken
+ * or the velocity.
+ */
+class TouchCoalescer
+{
+public:
+
+    // A move as it's dispatched, samples is the number merged into it
+    struct Move
+    {
+        int id;
+        float x;
+        float y;
+        int buttons;
+        int samples;
+    };
+
+    struct Sample
+    {
+        float x;
+        float y;
+        double time;
+    };
+
+    typedef void (*DispatchCallback)(void *userData, const Move &move);
+
+    TouchCoalescer();
+
+    void setDispatchCallback(DispatchCallback callback, void *userData);
+
+    /**
+     * Records a move of a pointer at time, in milliseconds. Merged with
+     * the pending move of the pointer, unless the buttons held changed in
+     * between, in which case that one is dispatched first.
+     */
+    void moved(int id, float x, float y, int buttons, double time);
+
+    // Dispatches the pending move of a pointer, if it has one
+    void flush(int id);
+
+    // Dispatches the pending moves of all pointers, in the order they started moving
+    void flushAll();
+
+    // Samples merged into the last dispatched move of a pointer, oldest first
+    int getHistoryLength(int id) const;
+    const Sample *getHistory(int id) const;
+
+private:
+
+    // Most pointers tracked at once, moves of further ones aren't coalesced
+    static const int MAX_POINTERS = 16;
+
+    // Samples kept per move, older ones are dropped from the history
+    static const int MAX_SAMPLES = 64;
+
+    struct Pointer
+    {
+        int id;
+        bool used;
+        bool pending;
+        int buttons;
+        int samples;
+        unsigned int order;
+        int pendingLength;
+        int historyLength;
+        Sample pendingHistory[MAX_SAMPLES];
+        Sample history[MAX_SAMPLES];
+    };
+
+    Pointer pointers[MAX_POINTERS];
+    unsigned int nextOrder;
+
+    DispatchCallback dispatchCallback;
+    void *dispatchUserData;
+
+    Pointer *find(int id) const;
+    Pointer *acquire(int id);
+    void dispatch(Pointer &pointer);
+};
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/common/core/touchCoalescer.h"
+#include "seatest.h"
+
+SEATEST_FIXTURE(touchCoalescer)
+{
+    SEATEST_FIXTURE_ENTRY(touchCoalescer_merge);
+    SEATEST_FIXTURE_ENTRY(touchCoalescer_order);
+    SEATEST_FIXTURE_ENTRY(touchCoalescer_buttons);
+}
+
+static TouchCoalescer::Move gDispatched[16];
+static int gDispatchedCount;
+
+static void touchCoalescerRecord(void *userData, const TouchCoalescer::Move &move)
+{
+    if (gDispatchedCount < 16) gDispatched[gDispatchedCount] = move;
+    gDispatchedCount++;
+}
+
+SEATEST_TEST(touchCoalescer_merge)
+{
+    TouchCoalescer coalescer;
+    coalescer.setDispatchCallback(touchCoalescerRecord, NULL);
+    gDispatchedCount = 0;
+
+    // Four samples of a 240Hz screen in one frame become one move
+    for (int i = 0; i < 4; i++)
+    {
+        coalescer.moved(3, 10.0f + i, 20.0f, 1, 1000.0 + i * 4.0);
+    }
+
+    assert_int_equal(0, gDispatchedCount);
+
+    coalescer.flushAll();
+
+    assert_int_equal(1, gDispatchedCount);
+    assert_int_equal(3, gDispatched[0].id);
+    assert_float_equal(13.0f, gDispatched[0].x, 0.001f);
+    assert_int_equal(4, gDispatched[0].samples);
+
+    // The path stays around as history
+    assert_int_equal(4, coalescer.getHistoryLength(3));
+    const TouchCoalescer::Sample *history = coalescer.getHistory(3);
+    assert_float_equal(10.0f, history[0].x, 0.001f);
+    assert_double_equal(1012.0, history[3].time, 0.001);
+
+    // Nothing pending, nothing dispatched
+    coalescer.flushAll();
+    coalescer.flush(3);
+    assert_int_equal(1, gDispatchedCount);
+}
+
+SEATEST_TEST(touchCoalescer_order)
+{
+    TouchCoalescer coalescer;
+    coalescer.setDispatchCallback(touchCoalescerRecord, NULL);
+    gDispatchedCount = 0;
+
+    coalescer.moved(1, 0, 0, 1, 0);
+    coalescer.moved(2, 0, 0, 1, 0);
+    coalescer.moved(1, 5, 5, 1, 1);
+
+    // Flushing a pointer, as before it ends, leaves the others pending
+    coalescer.flush(2);
+    assert_int_equal(1, gDispatchedCount);
+    assert_int_equal(2, gDispatched[0].id);
+
+    coalescer.moved(2, 1, 1, 1, 2);
+    coalescer.flushAll();
+
+    assert_int_equal(3, gDispatchedCount);
+    assert_int_equal(1, gDispatched[1].id);
+    assert_int_equal(2, gDispatched[2].id);
+    assert_int_equal(1, coalescer.getHistoryLength(2));
+}
+
+SEATEST_TEST(touchCoalescer_buttons)
+{
+    TouchCoalescer coalescer;
+    coalescer.setDispatchCallback(touchCoalescerRecord, NULL);
+    gDispatchedCount = 0;
+
+    // Hovering and dragging moves aren't merged
+    coalescer.moved(0, 1, 1, 0, 0);
+    coalescer.moved(0, 2, 2, 0, 1);
+    coalescer.moved(0, 3, 3, 1, 2);
+    coalescer.flushAll();
+
+    assert_int_equal(2, gDispatchedCount);
+    assert_int_equal(0, gDispatched[0].buttons);
+    assert_int_equal(2, gDispatched[0].samples);
+    assert_int_equal(1, gDispatched[1].buttons);
+    assert_float_equal(3.0f, gDispatched[1].x, 0.001f);
+}
@@ -0,0 +1,358 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _PLATFORM_PLATFORMATOMIC_H_
+#define _PLATFORM_PLATFORMATOMIC_H_
+
+#include "loom/common/platform/platformThread.h"
+
+#if LOOM_COMPILER == LOOM_COMPILER_MSVC
+#include <intrin.h>
+#endif
+
+/**************************************************************************
+ * Loom Atomics With Memory Ordering
+ *
+ * 32 bit, 64 bit and pointer sized atomics taking the ordering they need,
+ * as in C11, so lock free code pays for no stronger barriers than it asks
+ * for. They're inline, unlike the atomic_ primitives of platformThread.h,
+ * which all behave as sequentially consistent.
+ *
+ * Compare exchanges return whether they exchanged and, if not, set
+ * *expected to the value found. The fetch ones return the value before.
+ * Pointers are compare exchanged with atomic_compareAndExchangePointer.
+ *
+ * On MSVC every read-modify-write is a full barrier, as x86 has no other.
+ * GCC and clang older than the __atomic builtins get full barriers too.
+ *************************************************************************/
+
+// The values match GCC's __ATOMIC_ ones so they can be passed as they are.
+typedef enum
+{
+    LOOM_ORDER_RELAXED = 0,
+    LOOM_ORDER_ACQUIRE = 2,
+    LOOM_ORDER_RELEASE = 3,
+    LOOM_ORDER_ACQ_REL = 4,
+    LOOM_ORDER_SEQ_CST = 5
+} loom_memoryOrder;
+
+// 64 bit atomics need natural alignment, which 32 bit ABIs don't give
+// long long in structs.
+#if LOOM_COMPILER == LOOM_COMPILER_MSVC
+typedef __declspec(align(8)) long long   atomic_int64_t;
+#define LOOM_ATOMIC_INLINE    static __forceinline
+#else
+typedef long long atomic_int64_t __attribute__((aligned(8)));
+#define LOOM_ATOMIC_INLINE    static __inline__ __attribute__((always_inline))
+#endif
+
+#if LOOM_COMPILER != LOOM_COMPILER_MSVC && defined(__ATOMIC_SEQ_CST)
+
+// A failed compare exchange only loads, so it can't have release order.
+#define LOOM_ATOMIC_FAILURE_ORDER(order) \
+    ((order) == LOOM_ORDER_ACQ_REL ? __ATOMIC_ACQUIRE : (order) == LOOM_ORDER_RELEASE ? __ATOMIC_RELAXED : (order))
+
+LOOM_ATOMIC_INLINE void atomic_fence(loom_memoryOrder order)
+{
+    __atomic_thread_fence(order);
+}
+
+
+LOOM_ATOMIC_INLINE int atomic_load32Ordered(volatile atomic_int_t *value, loom_memoryOrder order)
+{
+    return __atomic_load_n(value, order);
+}
+
+
+LOOM_ATOMIC_INLINE void atomic_store32Ordered(volatile atomic_int_t *value, int newValue, loom_memoryOrder order)
+{
+    __atomic_store_n(value, newValue, order);
+}
+
+
+LOOM_ATOMIC_INLINE int atomic_exchange32(volatile atomic_int_t *value, int newValue, loom_memoryOrder order)
+{
+    return __atomic_exchange_n(value, newValue, order);
+}
+
+
+LOOM_ATOMIC_INLINE int atomic_fetchAdd32(volatile atomic_int_t *value, int delta, loom_memoryOrder order)
+{
+    return __atomic_fetch_add(value, delta, order);
+}
+
+
+LOOM_ATOMIC_INLINE int atomic_compareExchange32(volatile atomic_int_t *value, int *expected, int newValue, loom_memoryOrder order)
+{
+    return __atomic_compare_exchange_n(value, expected, newValue, 0, order,
+                                       LOOM_ATOMIC_FAILURE_ORDER(order));
+}
+
+
+LOOM_ATOMIC_INLINE long long atomic_load64(volatile atomic_int64_t *value, loom_memoryOrder order)
+{
+    return __atomic_load_n(value, order);
+}
+
+
+LOOM_ATOMIC_INLINE void atomic_store64(volatile atomic_int64_t *value, long long newValue, loom_memoryOrder order)
+{
+    __atomic_store_n(value, newValue, order);
+}
+
+
+LOOM_ATOMIC_INLINE long long atomic_exchange64(volatile atomic_int64_t *value, long long newValue, loom_memoryOrder order)
+{
+    return __atomic_exchange_n(value, newValue, order);
+}
+
+
+LOOM_ATOMIC_INLINE long long atomic_fetchAdd64(volatile atomic_int64_t *value, long long delta, loom_memoryOrder order)
+{
+    return __atomic_fetch_add(value, delta, order);
+}
+
+
+LOOM_ATOMIC_INLINE int atomic_compareExchange64(volatile atomic_int64_t *value, long long *expected, long long newValue, loom_memoryOrder order)
+{
+    return __atomic_compare_exchange_n(value, expected, newValue, 0, order,
+                                       LOOM_ATOMIC_FAILURE_ORDER(order));
+}
+
+
+LOOM_ATOMIC_INLINE void *atomic_loadPointer(void *volatile *value, loom_memoryOrder order)
+{
+    return __atomic_load_n(value, order);
+}
+
+
+LOOM_ATOMIC_INLINE void atomic_storePointer(void *volatile *value, void *newValue, loom_memoryOrder order)
+{
+    __atomic_store_n(value, newValue, order);
+}
+
+
+LOOM_ATOMIC_INLINE void *atomic_exchangePointer(void *volatile *value, void *newValue, loom_memoryOrder order)
+{
+    return __atomic_exchange_n(value, newValue, order);
+}
+
+#else
+
+// MSVC, where interlocked operations are full barriers and volatile
+// accesses are acquire loads and release stores, and old GCC, where every
+// access gets a full barrier as it may not be on x86.
+#if LOOM_COMPILER == LOOM_COMPILER_MSVC
+#define LOOM_ATOMIC_COMPILER_BARRIER()    _ReadWriteBarrier()
+#define LOOM_ATOMIC_FULL_BARRIER()        _mm_mfence()
+#define LOOM_ATOMIC_CAS32(v, e, n)        _InterlockedCompareExchange((volatile long *)(v), (long)(n), (long)(e))
+#define LOOM_ATOMIC_CAS64(v, e, n)        _InterlockedCompareExchange64((volatile __int64 *)(v), (n), (e))
+#else
+#define LOOM_ATOMIC_COMPILER_BARRIER()    __sync_synchronize()
+#define LOOM_ATOMIC_FULL_BARRIER()        __sync_synchronize()
+#define LOOM_ATOMIC_CAS32(v, e, n)        __sync_val_compare_and_swap((v), (e), (n))
+#define LOOM_ATOMIC_CAS64(v, e, n)        __sync_val_compare_and_swap((v), (e), (n))
+#endif
+
+LOOM_ATOMIC_INLINE void atomic_fence(loom_memoryOrder order)
+{
+    if (order == LOOM_ORDER_SEQ_CST)
+    {
+        LOOM_ATOMIC_FULL_BARRIER();
+    }
+    else
+    {
+        LOOM_ATOMIC_COMPILER_BARRIER();
+    }
+}
+
+
+LOOM_ATOMIC_INLINE int atomic_load32Ordered(volatile atomic_int_t *value, loom_memoryOrder order)
+{
+    int result;
+
+    if (order == LOOM_ORDER_SEQ_CST)
+    {
+        LOOM_ATOMIC_FULL_BARRIER();
+    }
+    result = *value;
+    LOOM_ATOMIC_COMPILER_BARRIER();
+    return result;
+}
+
+
+LOOM_ATOMIC_INLINE int atomic_compareExchange32(volatile atomic_int_t *value, int *expected, int newValue, loom_memoryOrder order)
+{
+    int previous = LOOM_ATOMIC_CAS32(value, *expected, newValue);
+
+    if (previous == *expected)
+    {
+        return 1;
+    }
+
+    *expected = previous;
+    return 0;
+}
+
+
+LOOM_ATOMIC_INLINE int atomic_exchange32(volatile atomic_int_t *value, int newValue, loom_memoryOrder order)
+{
+    int previous = *value;
+
+    while (!atomic_compareExchange32(value, &previous, newValue, order))
+    {
+    }
+
+    return previous;
+}
+
+
+LOOM_ATOMIC_INLINE void atomic_store32Ordered(volatile atomic_int_t *value, int newValue, loom_memoryOrder order)
+{
+    if (order == LOOM_ORDER_SEQ_CST)
+    {
+        atomic_exchange32(value, newValue, order);
+        return;
+    }
+
+    LOOM_ATOMIC_COMPILER_BARRIER();
+    *value = newValue;
+}
+
+
+LOOM_ATOMIC_INLINE int atomic_fetchAdd32(volatile atomic_int_t *value, int delta, loom_memoryOrder order)
+{
+    int previous = *value;
+
+    while (!atomic_compareExchange32(value, &previous, previous + delta, order))
+    {
+    }
+
+    return previous;
+}
+
+
+LOOM_ATOMIC_INLINE int atomic_compareExchange64(volatile atomic_int64_t *value, long long *expected, long long newValue, loom_memoryOrder order)
+{
+    long long previous = LOOM_ATOMIC_CAS64(value, *expected, newValue);
+
+    if (previous == *expected)
+    {
+        return 1;
+    }
+
+    *expected = previous;
+    return 0;
+}
+
+
+// A plain 64 bit load may tear on 32 bit targets, a compare exchange
+// that changes nothing doesn't.
+LOOM_ATOMIC_INLINE long long atomic_load64(volatile atomic_int64_t *value, loom_memoryOrder order)
+{
+    return LOOM_ATOMIC_CAS64(value, 0, 0);
+}
+
+
+LOOM_ATOMIC_INLINE long long atomic_exchange64(volatile atomic_int64_t *value, long long newValue, loom_memoryOrder order)
+{
+    long long previous = atomic_load64(value, LOOM_ORDER_RELAXED);
+
+    while (!atomic_compareExchange64(value, &previous, newValue, order))
+    {
+    }
+
+    return previous;
+}
+
+
+LOOM_ATOMIC_INLINE void atomic_store64(volatile atomic_int64_t *value, long long newValue, loom_memoryOrder order)
+{
+    atomic_exchange64(value, newValue, order);
+}
+
+
+LOOM_ATOMIC_INLINE long long atomic_fetchAdd64(volatile atomic_int64_t *value, long long delta, loom_memoryOrder order)
+{
+    long long previous = atomic_load64(value, LOOM_ORDER_RELAXED);
+
+    while (!atomic_compareExchange64(value, &previous, previous + delta, order))
+    {
+    }
+
+    return previous;
+}
+
+
+LOOM_ATOMIC_INLINE void *atomic_loadPointer(void *volatile *value, loom_memoryOrder order)
+{
+    void *result;
+
+    if (order == LOOM_ORDER_SEQ_CST)
+    {
+        LOOM_ATOMIC_FULL_BARRIER();
+    }
+    result = *value;
+    LOOM_ATOMIC_COMPILER_BARRIER();
+    return result;
+}
+
+
+LOOM_ATOMIC_INLINE void *atomic_exchangePointer(void *volatile *value, void *newValue, loom_memoryOrder order)
+{
+    void *expected = *value;
+    void *previous;
+
+    while ((previous = atomic_compareAndExchangePointer(value, expected, newValue)) != expected)
+    {
+        expected = previous;
+    }
+
+    return previous;
+}
+
+
+LOOM_ATOMIC_INLINE void atomic_storePointer(void *volatile *value, void *newValue, loom_memoryOrder order)
+{
+    if (order == LOOM_ORDER_SEQ_CST)
+    {
+        atomic_exchangePointer(value, newValue, order);
+        return;
+    }
+
+    LOOM_ATOMIC_COMPILER_BARRIER();
+    *value = newValue;
+}
+
+#endif
+
+// Tells the CPU the thread is spinning, for a spin wait loop.
+LOOM_ATOMIC_INLINE void atomic_pause()
+{
+#if LOOM_COMPILER == LOOM_COMPILER_MSVC
+    _mm_pause();
+#elif defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__ ("pause");
+#elif defined(__aarch64__) || (defined(__ARM_ARCH) && __ARM_ARCH >= 7)
+    __asm__ __volatile__ ("yield");
+#endif
+}
+
+#endif
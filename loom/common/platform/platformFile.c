@@ -21,6 +21,8 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "platformFile.h"
 #include "platformDisplay.h"
 #include "loom/common/platform/platform.h"
@@ -72,6 +74,54 @@ int platform_writeFile(const char *path, void *data, int size)
 }
 
 
+int platform_appendFile(const char *path, void *data, int size)
+{
+    FILE *file;
+    int  result;
+
+    file = fopen(path, "ab");
+
+    if (!file)
+    {
+        return -1;
+    }
+
+    result = (int)fwrite(data, 1, size, file);
+
+    fclose(file);
+
+    if (result == size)
+    {
+        return 0;
+    }
+
+    return -1;
+}
+
+
+int platform_statFile(const char *path, long long *size, long long *modified)
+{
+    struct stat info;
+
+    if (stat(path, &info) || !(info.st_mode & S_IFREG))
+    {
+        return -1;
+    }
+
+    if (size)
+    {
+        *size = (long long)info.st_size;
+    }
+
+    if (modified)
+    {
+        *modified = (long long)info.st_mtime;
+    }
+
+    return 0;
+}
+
+
 int platform_removeFile(const char *path)
 {
     FILE *file;
@@ -94,6 +144,14 @@ int platform_moveFile(const char *source, const char *dest)
     return rename(source, dest);
 }
 
+#if LOOM_PLATFORM != LOOM_PLATFORM_WIN32
+int platform_replaceFile(const char *source, const char *dest)
+{
+    // rename replaces dest atomically on POSIX
+    return rename(source, dest);
+}
+#endif
+
 
 #if LOOM_PLATFORM == LOOM_PLATFORM_WIN32
 
@@ -232,6 +290,12 @@ int platform_removeDir(const char *path)
 }
 
 
+int platform_replaceFile(const char *source, const char *dest)
+{
+    return MoveFileExA(source, dest, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) ? 0 : -1;
+}
+
+
 #elif LOOM_PLATFORM_IS_APPLE
 #include <mach-o/dyld.h> // _NSGetExecutablePath
 #include <unistd.h>
@@ -89,6 +89,26 @@ int platform_makeDir(const char *path);
 
 int platform_writeFile(const char *path, void *data, int size);
 
+/*!
+ * Append to a file at the given path, creating it if needed
+ *
+ * @param path the full path to the file to append to
+ * @param data a pointer to the raw data to write
+ * @param size the number of bytes to write
+ * @return 0 on success and other value on failure
+ */
+int platform_appendFile(const char *path, void *data, int size);
+
+/*!
+ * Get the size and modification time of a file
+ *
+ * @param path the full path to the file
+ * @param size receives the size in bytes, may be NULL
+ * @param modified receives the modification time in seconds since the epoch, may be NULL
+ * @return 0 on success and other value if it's not a file
+ */
+int platform_statFile(const char *path, long long *size, long long *modified);
+
 /*!
 * Removes a file at the given path
 *
@@ -106,6 +126,16 @@ int platform_removeFile(const char *path);
 */
 int platform_moveFile(const char *source, const char *dest);
 
+/*!
+* Moves a file from source over dest in one step, readers see either the
+* old dest or the new one, never a partly written file
+*
+* @param source the full path of the file to move
+* @param dest the full destination path of the file, replaced if it exists
+* @return 0 on success and other value on failure
+*/
+int platform_replaceFile(const char *source, const char *dest);
+
 /*!
  * Checks if a directory exists at the given path
  *
@@ -0,0 +1,302 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/common/platform/platformFileAsync.h"
+#include "loom/common/platform/platformFile.h"
+#include "loom/common/platform/platformIO.h"
+#include "loom/common/platform/platformJobs.h"
+#include "loom/common/core/allocator.h"
+#include "loom/common/core/assert.h"
+
+struct loom_fileAsyncTask
+{
+    int                    id;
+    utString               path;
+    loom_fileAsyncCallback callback;
+    void                   *payload;
+    loom_fileAsyncResult   result;
+
+    // The next operation on the same path, started once this one is done.
+    loom_fileAsyncTask     *next;
+};
+
+// Guards gRunning and the next links, which workers follow.
+static MutexHandle gFileAsyncLock = NULL;
+
+// Started and not done on a worker yet, to chain operations on a path.
+static utArray<loom_fileAsyncTask *> gFileAsyncRunning;
+
+// Not called back yet, only touched on the main thread.
+static utArray<loom_fileAsyncTask *> gFileAsyncTasks;
+
+static JobCounter gFileAsyncCounter;
+static int        gFileAsyncNextId = 1;
+
+static void fileAsync_perform(loom_fileAsyncTask *task)
+{
+    loom_fileAsyncResult& result = task->result;
+    const char           *path   = task->path.c_str();
+
+    switch (result.op)
+    {
+    case LOOM_FILE_ASYNC_READ:
+    {
+        void *bits;
+        long size;
+
+        result.success = platform_mapFile(path, &bits, &size) != 0;
+        if (result.success)
+        {
+            result.data = lmNew(NULL) utByteArray();
+            result.data->allocateAndCopy(bits, (int)size);
+            result.size = size;
+            platform_unmapFile(bits);
+        }
+        break;
+    }
+
+    case LOOM_FILE_ASYNC_WRITE:
+    case LOOM_FILE_ASYNC_APPEND:
+    {
+        void *bits = result.data->getDataPtr();
+        int  size  = (int)result.data->getSize();
+
+        result.success = (result.op == LOOM_FILE_ASYNC_WRITE ? platform_writeFile(path, bits, size) : platform_appendFile(path, bits, size)) == 0;
+        result.size    = result.success ? size : 0;
+
+        // Written data isn't handed back, let it go now.
+        lmDelete(NULL, result.data);
+        result.data = NULL;
+        break;
+    }
+
+    case LOOM_FILE_ASYNC_REPLACE:
+    {
+        utString temp = task->path + ".tmp";
+        void     *bits = result.data->getDataPtr();
+        int      size  = (int)result.data->getSize();
+
+        result.success = platform_writeFile(temp.c_str(), bits, size) == 0 &&
+                         platform_replaceFile(temp.c_str(), path) == 0;
+        result.size = result.success ? size : 0;
+
+        if (!result.success)
+        {
+            platform_removeFile(temp.c_str());
+        }
+
+        lmDelete(NULL, result.data);
+        result.data = NULL;
+        break;
+    }
+
+    case LOOM_FILE_ASYNC_STAT:
+        result.success = platform_statFile(path, &result.size, &result.modified) == 0;
+        break;
+
+    case LOOM_FILE_ASYNC_REMOVE:
+        result.success = platform_removeFile(path) == 0;
+        break;
+    }
+}
+
+
+static void fileAsync_complete(void *param)
+{
+    loom_fileAsyncTask *task = (loom_fileAsyncTask *)param;
+
+    gFileAsyncTasks.erase(task, true);
+
+    if (task->callback != NULL)
+    {
+        task->callback(task->payload, &task->result);
+    }
+
+    lmDelete(NULL, task->result.data);
+    lmDelete(NULL, task);
+}
+
+
+static void fileAsync_run(void *param)
+{
+    loom_fileAsyncTask *task = (loom_fileAsyncTask *)param;
+
+    fileAsync_perform(task);
+
+    loom_mutex_lock(gFileAsyncLock);
+    gFileAsyncRunning.erase(task, true);
+    loom_fileAsyncTask *next = task->next;
+    loom_mutex_unlock(gFileAsyncLock);
+
+    // Called back ahead of the next, main thread jobs run in order. Both
+    // are queued before this job finishes, so the counter doesn't reach
+    // zero in between.
+    loom_job_runOnMainThread(fileAsync_complete, task, &gFileAsyncCounter);
+
+    if (next != NULL)
+    {
+        loom_job_submit(fileAsync_run, next, &gFileAsyncCounter, NULL, LOOM_JOB_BACKGROUND);
+    }
+}
+
+
+static int fileAsync_start(loom_fileAsyncOp op, const char *path, utByteArray *data, loom_fileAsyncCallback callback, void *payload)
+{
+    lmAssert(path != NULL, "No path for an asynchronous file operation");
+
+    loom_fileAsyncTask *task = lmNew(NULL) loom_fileAsyncTask();
+
+    task->id       = gFileAsyncNextId++;
+    task->path     = path;
+    task->callback = callback;
+    task->payload  = payload;
+    task->next     = NULL;
+
+    memset(&task->result, 0, sizeof(task->result));
+    task->result.op   = op;
+    task->result.path = task->path.c_str();
+    task->result.data = data;
+
+    int id = task->id;
+    gFileAsyncTasks.push_back(task);
+
+    if (loom_jobs_getWorkerCount() == 0)
+    {
+        fileAsync_perform(task);
+        fileAsync_complete(task);
+        return id;
+    }
+
+    if (gFileAsyncLock == NULL)
+    {
+        gFileAsyncLock = loom_mutex_create();
+    }
+
+    // Wait behind the last operation on the same path, if any.
+    bool start = true;
+
+    loom_mutex_lock(gFileAsyncLock);
+    for (UTsize i = 0; i < gFileAsyncRunning.size(); i++)
+    {
+        loom_fileAsyncTask *running = gFileAsyncRunning[i];
+
+        if ((running->next == NULL) && (running->path == task->path))
+        {
+            running->next = task;
+            start         = false;
+            break;
+        }
+    }
+    gFileAsyncRunning.push_back(task);
+    loom_mutex_unlock(gFileAsyncLock);
+
+    if (start)
+    {
+        loom_job_submit(fileAsync_run, task, &gFileAsyncCounter, NULL, LOOM_JOB_BACKGROUND);
+    }
+
+    return id;
+}
+
+
+int platform_fileReadAsync(const char *path, loom_fileAsyncCallback callback, void *payload)
+{
+    return fileAsync_start(LOOM_FILE_ASYNC_READ, path, NULL, callback, payload);
+}
+
+
+int platform_fileWriteAsync(const char *path, const void *data, int size, bool append, loom_fileAsyncCallback callback, void *payload)
+{
+    utByteArray *copy = lmNew(NULL) utByteArray();
+
+    if (size > 0)
+    {
+        copy->allocateAndCopy((void *)data, size);
+    }
+
+    return fileAsync_start(append ? LOOM_FILE_ASYNC_APPEND : LOOM_FILE_ASYNC_WRITE, path, copy, callback, payload);
+}
+
+
+int platform_fileReplaceAsync(const char *path, const void *data, int size, loom_fileAsyncCallback callback, void *payload)
+{
+    utByteArray *copy = lmNew(NULL) utByteArray();
+
+    if (size > 0)
+    {
+        copy->allocateAndCopy((void *)data, size);
+    }
+
+    return fileAsync_start(LOOM_FILE_ASYNC_REPLACE, path, copy, callback, payload);
+}
+
+
+int platform_fileStatAsync(const char *path, loom_fileAsyncCallback callback, void *payload)
+{
+    return fileAsync_start(LOOM_FILE_ASYNC_STAT, path, NULL, callback, payload);
+}
+
+
+int platform_fileRemoveAsync(const char *path, loom_fileAsyncCallback callback, void *payload)
+{
+    return fileAsync_start(LOOM_FILE_ASYNC_REMOVE, path, NULL, callback, payload);
+}
+
+
+void platform_fileAsyncCancel(int id)
+{
+    for (UTsize i = 0; i < gFileAsyncTasks.size(); i++)
+    {
+        if (gFileAsyncTasks[i]->id == id)
+        {
+            gFileAsyncTasks[i]->callback = NULL;
+            return;
+        }
+    }
+}
+
+
+bool platform_fileAsyncPending(const char *path)
+{
+    if (path == NULL)
+    {
+        return gFileAsyncTasks.size() > 0;
+    }
+
+    for (UTsize i = 0; i < gFileAsyncTasks.size(); i++)
+    {
+        if (gFileAsyncTasks[i]->path == path)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void platform_fileAsyncWait(const char *path)
+{
+    // Waiting runs the main thread jobs, so callbacks are called meanwhile.
+    if (platform_fileAsyncPending(path))
+    {
+        loom_jobs_wait(&gFileAsyncCounter);
+    }
+}
@@ -0,0 +1,97 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _PLATFORM_PLATFORMFILEASYNC_H_
+#define _PLATFORM_PLATFORMFILEASYNC_H_
+
+#include "loom/common/utils/utByteArray.h"
+
+/**
+ * Asynchronous file operations.
+ *
+ * Each operation runs as a background job on the worker pool and its
+ * callback is called on the main thread once it's done, from
+ * loom_jobs_pumpMainThread. Operations on the same path run one after
+ * another in the order they were started, so a write followed by a read
+ * reads what was written. Without workers, as in tools, they run and call
+ * back right away.
+ */
+
+typedef enum
+{
+    LOOM_FILE_ASYNC_READ,
+    LOOM_FILE_ASYNC_WRITE,
+    LOOM_FILE_ASYNC_APPEND,
+    LOOM_FILE_ASYNC_REPLACE,
+    LOOM_FILE_ASYNC_STAT,
+    LOOM_FILE_ASYNC_REMOVE
+} loom_fileAsyncOp;
+
+typedef struct
+{
+    loom_fileAsyncOp op;
+    const char       *path;
+    bool             success;
+
+    // What was read. Valid during the callback, which can keep it by
+    // setting this to NULL.
+    utByteArray      *data;
+
+    // Bytes read, written or in the file, and for STAT the modification
+    // time in seconds since the epoch.
+    long long        size;
+    long long        modified;
+} loom_fileAsyncResult;
+
+typedef void (*loom_fileAsyncCallback)(void *payload, loom_fileAsyncResult *result);
+
+/**
+ * Start an operation, callback may be NULL. Data to write is copied. All
+ * return an id for platform_fileAsyncCancel.
+ */
+int platform_fileReadAsync(const char *path, loom_fileAsyncCallback callback, void *payload);
+int platform_fileWriteAsync(const char *path, const void *data, int size, bool append, loom_fileAsyncCallback callback, void *payload);
+
+/**
+ * Writes to path.tmp and moves it over path once complete, so a crash part
+ * way leaves the old file intact. Reported as LOOM_FILE_ASYNC_REPLACE.
+ */
+int platform_fileReplaceAsync(const char *path, const void *data, int size, loom_fileAsyncCallback callback, void *payload);
+int platform_fileStatAsync(const char *path, loom_fileAsyncCallback callback, void *payload);
+int platform_fileRemoveAsync(const char *path, loom_fileAsyncCallback callback, void *payload);
+
+/**
+ * Stops the callback of an operation from being called. The operation
+ * itself still happens, writes aren't half done.
+ */
+void platform_fileAsyncCancel(int id);
+
+/**
+ * Whether operations on path, or any path if NULL, haven't finished.
+ */
+bool platform_fileAsyncPending(const char *path);
+
+/**
+ * Waits for the operations on path, or all if NULL, to finish and calls
+ * their callbacks. Call it from the main thread.
+ */
+void platform_fileAsyncWait(const char *path);
+
+#endif
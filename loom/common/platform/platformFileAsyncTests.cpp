@@ -0,0 +1,123 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <string.h>
+#include "seatest.h"
+#include "loom/common/platform/platformFileAsync.h"
+#include "loom/common/platform/platformJobs.h"
+
+SEATEST_FIXTURE(platformFileAsync)
+{
+    SEATEST_FIXTURE_ENTRY(platformFileAsync_ordered);
+    SEATEST_FIXTURE_ENTRY(platformFileAsync_cancel);
+}
+
+static const char *FILE_ASYNC_TEST_PATH = "fileasync_test.bin";
+
+static int       gFileAsyncCalls;
+static bool      gFileAsyncResults[10];
+static long long gFileAsyncSizes[10];
+static char      gFileAsyncRead[64];
+
+static void recordResult(void *payload, loom_fileAsyncResult *result)
+{
+    int index = (int)(size_t)payload;
+
+    // Called back in the order started, which is also the order run.
+    if (gFileAsyncCalls++ != index)
+    {
+        gFileAsyncResults[index] = false;
+        return;
+    }
+
+    gFileAsyncResults[index] = result->success;
+    gFileAsyncSizes[index]   = result->size;
+
+    if ((result->op == LOOM_FILE_ASYNC_READ) && result->success && (result->size < (long long)sizeof(gFileAsyncRead)))
+    {
+        memcpy(gFileAsyncRead, result->data->getDataPtr(), (size_t)result->size);
+        gFileAsyncRead[result->size] = 0;
+    }
+}
+
+
+static void runOrdered()
+{
+    gFileAsyncCalls = 0;
+    memset(gFileAsyncResults, 0, sizeof(gFileAsyncResults));
+    memset(gFileAsyncRead, 0, sizeof(gFileAsyncRead));
+
+    platform_fileWriteAsync(FILE_ASYNC_TEST_PATH, "hello", 5, false, recordResult, (void *)0);
+    platform_fileWriteAsync(FILE_ASYNC_TEST_PATH, " world", 6, true, recordResult, (void *)1);
+    platform_fileStatAsync(FILE_ASYNC_TEST_PATH, recordResult, (void *)2);
+    platform_fileReadAsync(FILE_ASYNC_TEST_PATH, recordResult, (void *)3);
+    platform_fileReplaceAsync(FILE_ASYNC_TEST_PATH, "replaced", 8, recordResult, (void *)4);
+    platform_fileStatAsync(FILE_ASYNC_TEST_PATH, recordResult, (void *)5);
+    platform_fileRemoveAsync(FILE_ASYNC_TEST_PATH, recordResult, (void *)6);
+    platform_fileStatAsync(FILE_ASYNC_TEST_PATH, recordResult, (void *)7);
+
+    platform_fileAsyncWait(FILE_ASYNC_TEST_PATH);
+    assert_false(platform_fileAsyncPending(NULL));
+
+    assert_int_equal(8, gFileAsyncCalls);
+    for (int i = 0; i < 7; i++)
+    {
+        assert_true(gFileAsyncResults[i]);
+    }
+    assert_true(gFileAsyncSizes[2] == 11);
+    assert_string_equal("hello world", gFileAsyncRead);
+    assert_true(gFileAsyncSizes[5] == 8);
+    assert_false(gFileAsyncResults[7]);
+}
+
+
+SEATEST_TEST(platformFileAsync_ordered)
+{
+    // Without workers everything runs right away, and with them in order
+    // per path on the pool.
+    bool ownWorkers = loom_jobs_getWorkerCount() == 0;
+
+    if (ownWorkers)
+    {
+        runOrdered();
+        loom_jobs_initialize(4);
+    }
+
+    runOrdered();
+
+    if (ownWorkers)
+    {
+        loom_jobs_shutdown();
+    }
+}
+
+
+SEATEST_TEST(platformFileAsync_cancel)
+{
+    gFileAsyncCalls = 0;
+
+    int id = platform_fileWriteAsync(FILE_ASYNC_TEST_PATH, "x", 1, false, recordResult, (void *)0);
+    platform_fileAsyncCancel(id);
+    platform_fileRemoveAsync(FILE_ASYNC_TEST_PATH, NULL, NULL);
+    platform_fileAsyncWait(NULL);
+
+    // Without workers it already called back before it could be cancelled.
+    assert_int_equal(loom_jobs_getWorkerCount() == 0 ? 1 : 0, gFileAsyncCalls);
+}
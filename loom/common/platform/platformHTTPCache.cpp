@@ -0,0 +1,657 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "jansson.h"
+#include "loom/common/core/log.h"
+#include "loom/common/platform/platformFile.h"
+#include "loom/common/platform/platformFileAsync.h"
+#include "loom/common/platform/platformIO.h"
+#include "loom/common/platform/platformTime.h"
+#include "loom/common/platform/platformHTTPCache.h"
+#include "loom/common/utils/utFastHash.h"
+
+lmDefineLogGroup(gHTTPCacheLogGroup, "http.cache", 1, LoomLogInfo);
+
+// Bump when the index layout changes, older indexes are then discarded.
+#define LOOM_HTTP_CACHE_VERSION    1
+
+// Longest a response without explicit freshness is trusted for.
+#define LOOM_HTTP_CACHE_HEURISTIC_MAX    (24 * 60 * 60)
+
+// Changes are written out at most this often, and on shutdown, so an app
+// that gets killed loses little.
+#define LOOM_HTTP_CACHE_SAVE_MS          5000
+
+struct loom_HTTPCacheEntry
+{
+    utString  url;
+    utString  etag;
+    utString  lastModified;
+    long long expires;  // seconds since the epoch
+    long long lastUsed; // gSequence at the last use
+    long long size;
+};
+
+static utString  gDirectory;
+static long long gMaxSize;
+static long long gSize;
+static long long gSequence;
+static bool      gDirty;
+static int       gLastSave;
+
+static utHashTable<utHashedString, loom_HTTPCacheEntry *> gEntries;
+static loom_HTTPCacheStats gStats;
+
+
+// Matches a header name case insensitively, returning its value.
+static bool loom_HTTPCacheMatchHeader(const char *line, size_t length, const char *name, utString& value)
+{
+    size_t nameLength = strlen(name);
+
+    if ((length <= nameLength) || (line[nameLength] != ':'))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < nameLength; i++)
+    {
+        if (tolower((unsigned char)line[i]) != name[i])
+        {
+            return false;
+        }
+    }
+
+    const char *start = line + nameLength + 1;
+    const char *end   = line + length;
+
+    while ((start < end) && isspace((unsigned char)*start))
+    {
+        start++;
+    }
+
+    while ((end > start) && isspace((unsigned char)end[-1]))
+    {
+        end--;
+    }
+
+    value.fromBytes(start, (int)(end - start));
+    return true;
+}
+
+
+bool loom_HTTPCacheHeaders::parse(const char *line, size_t length)
+{
+    return loom_HTTPCacheMatchHeader(line, length, "etag", etag) ||
+           loom_HTTPCacheMatchHeader(line, length, "last-modified", lastModified) ||
+           loom_HTTPCacheMatchHeader(line, length, "cache-control", cacheControl) ||
+           loom_HTTPCacheMatchHeader(line, length, "expires", expires) ||
+           loom_HTTPCacheMatchHeader(line, length, "date", date) ||
+           loom_HTTPCacheMatchHeader(line, length, "age", age) ||
+           loom_HTTPCacheMatchHeader(line, length, "vary", vary);
+}
+
+
+long long platform_HTTPParseDate(const char *date)
+{
+    static const char *months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+    // Skip the day of the week.
+    const char *comma = strchr(date, ',');
+    if (!comma)
+    {
+        return -1;
+    }
+
+    int  day, year, hour, minute, second;
+    char month[4];
+
+    if (sscanf(comma + 1, " %d %3s %d %d:%d:%d", &day, month, &year, &hour, &minute, &second) != 6)
+    {
+        return -1;
+    }
+
+    const char *found = strstr(months, month);
+    if (!found || (strlen(month) != 3) || ((found - months) % 3))
+    {
+        return -1;
+    }
+
+    int m = (int)(found - months) / 3 + 1;
+
+    // Days since the epoch of the civil date, after Howard Hinnant's
+    // days_from_civil.
+    int       y   = m <= 2 ? year - 1 : year;
+    int       era = (y >= 0 ? y : y - 399) / 400;
+    int       yoe = y - era * 400;
+    int       doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int       doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    long long days = (long long)era * 146097 + doe - 719468;
+
+    return days * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+
+static utString loom_HTTPCachePath(const char *url)
+{
+    utString path = gDirectory;
+
+    path += platform_getFolderDelimiter();
+    path += utFastHash::hash64String(url, strlen(url));
+    return path;
+}
+
+
+static utString loom_HTTPCacheIndexPath()
+{
+    utString path = gDirectory;
+
+    path += platform_getFolderDelimiter();
+    path += "index.json";
+    return path;
+}
+
+
+// When the response expires, going by its headers. lastModified stands in
+// for a missing Last-Modified header.
+static long long loom_HTTPCacheExpires(const loom_HTTPCacheHeaders& headers, const utString& lastModified,
+                                       long long now, bool *noStore)
+{
+    bool      noCache = false;
+    long long maxAge  = -1;
+
+    *noStore = false;
+
+    // Cache-Control directives are case insensitive and comma separated.
+    utArray<char> control;
+    control.resize((UTsize)headers.cacheControl.length() + 1);
+    for (UTsize i = 0; i < control.size(); i++)
+    {
+        control[i] = (char)tolower((unsigned char)headers.cacheControl.c_str()[i]);
+    }
+
+    const char *directives = control.ptr();
+
+    if (strstr(directives, "no-store"))
+    {
+        *noStore = true;
+    }
+
+    if (strstr(directives, "no-cache"))
+    {
+        noCache = true;
+    }
+
+    if (const char *found = strstr(directives, "max-age="))
+    {
+        maxAge = atoll(found + 8);
+    }
+
+    if (noCache)
+    {
+        return now;
+    }
+
+    if (maxAge >= 0)
+    {
+        long long age = atoll(headers.age.c_str());
+        return now + maxAge - (age > 0 ? age : 0);
+    }
+
+    // Expires and Last-Modified are by the server's clock.
+    long long serverNow = headers.date.length() ? platform_HTTPParseDate(headers.date.c_str()) : -1;
+    if (serverNow < 0)
+    {
+        serverNow = now;
+    }
+
+    if (headers.expires.length())
+    {
+        // An invalid date, typically "0", means already expired.
+        long long expires = platform_HTTPParseDate(headers.expires.c_str());
+        return expires < 0 ? now : now + (expires - serverNow);
+    }
+
+    // Trust an old enough resource for a tenth of its age, as browsers do.
+    const utString& modified = headers.lastModified.length() ? headers.lastModified : lastModified;
+    long long lastModifiedTime = modified.length() ? platform_HTTPParseDate(modified.c_str()) : -1;
+    if ((lastModifiedTime >= 0) && (serverNow > lastModifiedTime))
+    {
+        long long heuristic = (serverNow - lastModifiedTime) / 10;
+        return now + (heuristic < LOOM_HTTP_CACHE_HEURISTIC_MAX ? heuristic : LOOM_HTTP_CACHE_HEURISTIC_MAX);
+    }
+
+    return now;
+}
+
+
+static void loom_HTTPCacheRemove(loom_HTTPCacheEntry *entry)
+{
+    platform_fileRemoveAsync(loom_HTTPCachePath(entry->url.c_str()).c_str(), NULL, NULL);
+
+    gSize -= entry->size;
+    gEntries.erase(entry->url);
+    lmDelete(NULL, entry);
+
+    gDirty = true;
+}
+
+
+static bool loom_HTTPCacheReadBody(loom_HTTPCacheEntry *entry, utArray<unsigned char>& body)
+{
+    void     *bits;
+    long     size;
+    utString path = loom_HTTPCachePath(entry->url.c_str());
+
+    // The body may still be on its way to disk.
+    platform_fileAsyncWait(path.c_str());
+
+    if (!platform_mapFile(path.c_str(), &bits, &size))
+    {
+        return false;
+    }
+
+    bool valid = size == entry->size;
+
+    if (valid)
+    {
+        body.resize((UTsize)size);
+        if (size)
+        {
+            memcpy(body.ptr(), bits, size);
+        }
+    }
+
+    platform_unmapFile(bits);
+    return valid;
+}
+
+
+static void loom_HTTPCacheEvict()
+{
+    while ((gSize > gMaxSize) && gEntries.size())
+    {
+        UTsize oldest = 0;
+
+        for (UTsize i = 1; i < gEntries.size(); i++)
+        {
+            if (gEntries.at(i)->lastUsed < gEntries.at(oldest)->lastUsed)
+            {
+                oldest = i;
+            }
+        }
+
+        loom_HTTPCacheRemove(gEntries.at(oldest));
+        gStats.evictions++;
+    }
+}
+
+
+static void loom_HTTPCacheLoadIndex()
+{
+    json_error_t error;
+    json_t       *index = json_load_file(loom_HTTPCacheIndexPath().c_str(), 0, &error);
+
+    if (!index)
+    {
+        return;
+    }
+
+    json_t *entries = json_object_get(index, "entries");
+
+    if ((json_integer_value(json_object_get(index, "version")) != LOOM_HTTP_CACHE_VERSION) || !json_is_array(entries))
+    {
+        lmLogInfo(gHTTPCacheLogGroup, "Discarding an outdated cache index");
+        json_decref(index);
+        return;
+    }
+
+    gSequence = json_integer_value(json_object_get(index, "sequence"));
+
+    for (size_t i = 0; i < json_array_size(entries); i++)
+    {
+        json_t     *jentry = json_array_get(entries, i);
+        const char *url    = json_string_value(json_object_get(jentry, "url"));
+
+        if (!url || gEntries.get(url))
+        {
+            continue;
+        }
+
+        const char *etag         = json_string_value(json_object_get(jentry, "etag"));
+        const char *lastModified = json_string_value(json_object_get(jentry, "lastModified"));
+
+        loom_HTTPCacheEntry *entry = lmNew(NULL) loom_HTTPCacheEntry;
+        entry->url          = url;
+        entry->etag         = etag ? etag : "";
+        entry->lastModified = lastModified ? lastModified : "";
+        entry->expires      = json_integer_value(json_object_get(jentry, "expires"));
+        entry->lastUsed     = json_integer_value(json_object_get(jentry, "lastUsed"));
+        entry->size         = json_integer_value(json_object_get(jentry, "size"));
+
+        gEntries.insert(entry->url, entry);
+        gSize += entry->size;
+    }
+
+    json_decref(index);
+}
+
+
+static int loom_HTTPCacheDumpChunk(const char *buffer, size_t size, void *data)
+{
+    utArray<unsigned char> *dumped = (utArray<unsigned char> *)data;
+    UTsize                 start   = dumped->size();
+
+    dumped->resize(start + (UTsize)size);
+    memcpy(dumped->ptr() + start, buffer, size);
+    return 0;
+}
+
+
+static void loom_HTTPCacheIndexWritten(void *payload, loom_fileAsyncResult *result)
+{
+    if (!result->success)
+    {
+        lmLogWarn(gHTTPCacheLogGroup, "Failed to write the cache index to %s", gDirectory.c_str());
+    }
+}
+
+
+static void loom_HTTPCacheBodyWritten(void *payload, loom_fileAsyncResult *result)
+{
+    // The entry stays, reading it back finds the size wrong and drops it.
+    if (!result->success)
+    {
+        lmLogWarn(gHTTPCacheLogGroup, "Failed to cache %s", result->path);
+    }
+}
+
+
+static void loom_HTTPCacheSaveIndex()
+{
+    json_t *entries = json_array();
+
+    for (UTsize i = 0; i < gEntries.size(); i++)
+    {
+        loom_HTTPCacheEntry *entry  = gEntries.at(i);
+        json_t              *jentry = json_object();
+
+        json_object_set_new(jentry, "url", json_string(entry->url.c_str()));
+        json_object_set_new(jentry, "etag", json_string(entry->etag.c_str()));
+        json_object_set_new(jentry, "lastModified", json_string(entry->lastModified.c_str()));
+        json_object_set_new(jentry, "expires", json_integer(entry->expires));
+        json_object_set_new(jentry, "lastUsed", json_integer(entry->lastUsed));
+        json_object_set_new(jentry, "size", json_integer(entry->size));
+        json_array_append_new(entries, jentry);
+    }
+
+    json_t *index = json_object();
+    json_object_set_new(index, "version", json_integer(LOOM_HTTP_CACHE_VERSION));
+    json_object_set_new(index, "sequence", json_integer(gSequence));
+    json_object_set_new(index, "entries", entries);
+
+    utArray<unsigned char> dumped;
+    json_dump_callback(index, loom_HTTPCacheDumpChunk, &dumped, JSON_COMPACT);
+    json_decref(index);
+
+    platform_fileWriteAsync(loom_HTTPCacheIndexPath().c_str(), dumped.ptr(), (int)dumped.size(), false, loom_HTTPCacheIndexWritten, NULL);
+
+    gDirty    = false;
+    gLastSave = platform_getMilliseconds();
+}
+
+
+static void loom_HTTPCacheSaveIndexSoon()
+{
+    if (gDirty && (platform_getMilliseconds() - gLastSave > LOOM_HTTP_CACHE_SAVE_MS))
+    {
+        loom_HTTPCacheSaveIndex();
+    }
+}
+
+
+void platform_HTTPCacheInit(const char *directory, long long maxSize)
+{
+    memset(&gStats, 0, sizeof(gStats));
+
+    if (!directory || (maxSize <= 0))
+    {
+        return;
+    }
+
+    if (platform_dirExists(directory) && platform_makeDir(directory))
+    {
+        lmLogWarn(gHTTPCacheLogGroup, "Unable to create %s, responses won't be cached", directory);
+        return;
+    }
+
+    gDirectory = directory;
+    gMaxSize   = maxSize;
+    gSize      = 0;
+    gSequence  = 0;
+    gDirty     = false;
+    gLastSave  = platform_getMilliseconds();
+
+    loom_HTTPCacheLoadIndex();
+
+    // The limit may have shrunk since the last run.
+    loom_HTTPCacheEvict();
+
+    lmLogInfo(gHTTPCacheLogGroup, "Opened %s, %d responses, %lld bytes", directory, (int)gEntries.size(), gSize);
+}
+
+
+void platform_HTTPCacheShutdown()
+{
+    if (!platform_HTTPCacheEnabled())
+    {
+        return;
+    }
+
+    if (gDirty)
+    {
+        loom_HTTPCacheSaveIndex();
+    }
+
+    // Let the writes in flight land before the workers stop.
+    platform_fileAsyncWait(NULL);
+
+    lmLogInfo(gHTTPCacheLogGroup, "%d hits, %d revalidations, %d misses, %d stores, %d evictions",
+              gStats.hits, gStats.revalidations, gStats.misses, gStats.stores, gStats.evictions);
+
+    for (UTsize i = 0; i < gEntries.size(); i++)
+    {
+        lmDelete(NULL, gEntries.at(i));
+    }
+
+    gEntries.clear();
+    gMaxSize = 0;
+    gSize    = 0;
+}
+
+
+bool platform_HTTPCacheEnabled()
+{
+    return gMaxSize > 0;
+}
+
+
+long long platform_HTTPCacheMaxEntrySize()
+{
+    // So one response can't flush the rest.
+    return gMaxSize / 8;
+}
+
+
+loom_HTTPCacheState platform_HTTPCacheLookup(const char *url, utArray<unsigned char>& body,
+                                             utString& etag, utString& lastModified)
+{
+    loom_HTTPCacheEntry **found = platform_HTTPCacheEnabled() ? gEntries.get(url) : NULL;
+
+    if (!found)
+    {
+        gStats.misses++;
+        return LOOM_HTTP_CACHE_MISS;
+    }
+
+    loom_HTTPCacheEntry *entry = *found;
+
+    if ((long long)time(NULL) < entry->expires)
+    {
+        if (loom_HTTPCacheReadBody(entry, body))
+        {
+            entry->lastUsed = ++gSequence;
+            gDirty          = true;
+            gStats.hits++;
+            return LOOM_HTTP_CACHE_FRESH;
+        }
+    }
+    else if (entry->etag.length() || entry->lastModified.length())
+    {
+        etag         = entry->etag;
+        lastModified = entry->lastModified;
+        return LOOM_HTTP_CACHE_STALE;
+    }
+
+    loom_HTTPCacheRemove(entry);
+    gStats.misses++;
+    return LOOM_HTTP_CACHE_MISS;
+}
+
+
+void platform_HTTPCacheStore(const char *url, const loom_HTTPCacheHeaders& headers,
+                             const unsigned char *body, size_t size)
+{
+    if (!platform_HTTPCacheEnabled())
+    {
+        return;
+    }
+
+    loom_HTTPCacheEntry **found = gEntries.get(url);
+
+    if (found)
+    {
+        // A stale entry that changed.
+        gStats.misses++;
+        loom_HTTPCacheRemove(*found);
+    }
+
+    long long now = (long long)time(NULL);
+    bool      noStore;
+    long long expires = loom_HTTPCacheExpires(headers, headers.lastModified, now, &noStore);
+
+    // Responses that would only ever be requested again aren't worth it.
+    if (noStore || (headers.vary == "*") || ((long long)size > platform_HTTPCacheMaxEntrySize()) ||
+        ((expires <= now) && !headers.etag.length() && !headers.lastModified.length()))
+    {
+        return;
+    }
+
+    // Written in the background, reads of it wait for that.
+    platform_fileWriteAsync(loom_HTTPCachePath(url).c_str(), body, (int)size, false, loom_HTTPCacheBodyWritten, NULL);
+
+    loom_HTTPCacheEntry *entry = lmNew(NULL) loom_HTTPCacheEntry;
+    entry->url          = url;
+    entry->etag         = headers.etag;
+    entry->lastModified = headers.lastModified;
+    entry->expires      = expires;
+    entry->lastUsed     = ++gSequence;
+    entry->size         = (long long)size;
+
+    gEntries.insert(entry->url, entry);
+    gSize += entry->size;
+    gDirty = true;
+    gStats.stores++;
+
+    loom_HTTPCacheEvict();
+    loom_HTTPCacheSaveIndexSoon();
+}
+
+
+bool platform_HTTPCacheRevalidated(const char *url, const loom_HTTPCacheHeaders& headers,
+                                   utArray<unsigned char>& body)
+{
+    loom_HTTPCacheEntry **found = platform_HTTPCacheEnabled() ? gEntries.get(url) : NULL;
+
+    if (!found)
+    {
+        return false;
+    }
+
+    loom_HTTPCacheEntry *entry = *found;
+
+    if (!loom_HTTPCacheReadBody(entry, body))
+    {
+        loom_HTTPCacheRemove(entry);
+        return false;
+    }
+
+    gStats.revalidations++;
+
+    // A 304 carries the headers the response would have had.
+    if (headers.etag.length())
+    {
+        entry->etag = headers.etag;
+    }
+
+    if (headers.lastModified.length())
+    {
+        entry->lastModified = headers.lastModified;
+    }
+
+    bool noStore;
+    entry->expires  = loom_HTTPCacheExpires(headers, entry->lastModified, (long long)time(NULL), &noStore);
+    entry->lastUsed = ++gSequence;
+    gDirty          = true;
+
+    if (noStore)
+    {
+        loom_HTTPCacheRemove(entry);
+    }
+
+    loom_HTTPCacheSaveIndexSoon();
+    return true;
+}
+
+
+void platform_HTTPCacheClear()
+{
+    while (gEntries.size())
+    {
+        loom_HTTPCacheRemove(gEntries.at(gEntries.size() - 1));
+    }
+
+    if (platform_HTTPCacheEnabled())
+    {
+        loom_HTTPCacheSaveIndex();
+    }
+}
+
+
+void platform_HTTPCacheGetStats(loom_HTTPCacheStats *stats)
+{
+    *stats            = gStats;
+    stats->entryCount = (int)gEntries.size();
+    stats->size       = gSize;
+}
@@ -0,0 +1,137 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _PLATFORM_PLATFORMHTTPCACHE_H_
+#define _PLATFORM_PLATFORMHTTPCACHE_H_
+
+#include "loom/common/utils/utTypes.h"
+#include "loom/common/utils/utString.h"
+
+/**
+ * Disk cache for HTTP GET responses, kept by the HTTP backends across
+ * sessions.
+ *
+ * Responses are stored as their servers' Cache-Control, Expires, ETag and
+ * Last-Modified headers allow. A fresh response is served without any
+ * request. A stale one that can be validated is requested again with
+ * If-None-Match / If-Modified-Since, so an unchanged resource costs a 304
+ * instead of its body. Once the cache outgrows its size the least recently
+ * used responses are evicted.
+ *
+ * The cache is a private cache. It ignores Vary, short of not storing
+ * "Vary: *" responses, as the requests of one app rarely differ in their
+ * headers. Only call it from the main thread.
+ */
+
+typedef enum
+{
+    LOOM_HTTP_CACHE_MISS,  // not cached, request it
+    LOOM_HTTP_CACHE_FRESH, // serve the cached body
+    LOOM_HTTP_CACHE_STALE  // request it with the validators
+} loom_HTTPCacheState;
+
+/**
+ * The response headers the cache is driven by, as received.
+ */
+struct loom_HTTPCacheHeaders
+{
+    utString etag;
+    utString lastModified;
+    utString cacheControl;
+    utString expires;
+    utString date;
+    utString age;
+    utString vary;
+
+    void clear()
+    {
+        etag = lastModified = cacheControl = expires = date = age = vary = "";
+    }
+
+    // Records the header if it's one of the above, returns whether it was.
+    bool parse(const char *line, size_t length);
+};
+
+typedef struct
+{
+    int       hits;          // served fresh without a request
+    int       revalidations; // stale, and the server answered 304
+    int       misses;        // not cached, or changed
+    int       stores;
+    int       evictions;
+    int       entryCount;
+    long long size;          // bytes of cached bodies
+} loom_HTTPCacheStats;
+
+/**
+ * Opens the cache in directory, creating it if needed. maxSize bounds the
+ * bytes of cached bodies; 0 leaves the cache disabled.
+ */
+void platform_HTTPCacheInit(const char *directory, long long maxSize);
+
+/**
+ * Writes out the index and closes the cache.
+ */
+void platform_HTTPCacheShutdown();
+
+bool platform_HTTPCacheEnabled();
+
+/**
+ * The largest response body worth caching.
+ */
+long long platform_HTTPCacheMaxEntrySize();
+
+/**
+ * Looks url up. When FRESH, body is set to the cached response; when STALE,
+ * etag and lastModified are set to the validators to send, either may be
+ * empty.
+ */
+loom_HTTPCacheState platform_HTTPCacheLookup(const char *url, utArray<unsigned char>& body,
+                                             utString& etag, utString& lastModified);
+
+/**
+ * Offers a 200 response to url to the cache, which stores it if its
+ * headers allow.
+ */
+void platform_HTTPCacheStore(const char *url, const loom_HTTPCacheHeaders& headers,
+                             const unsigned char *body, size_t size);
+
+/**
+ * Handles a 304 answer to a STALE lookup: refreshes the entry from the
+ * headers and sets body to the cached response. Returns false if the entry
+ * went missing since.
+ */
+bool platform_HTTPCacheRevalidated(const char *url, const loom_HTTPCacheHeaders& headers,
+                                   utArray<unsigned char>& body);
+
+/**
+ * Drops every cached response.
+ */
+void platform_HTTPCacheClear();
+
+void platform_HTTPCacheGetStats(loom_HTTPCacheStats *stats);
+
+/**
+ * Parses an HTTP date, "Sun, 06 Nov 1994 08:49:37 GMT", to seconds since
+ * the epoch. Returns -1 if it isn't one.
+ */
+long long platform_HTTPParseDate(const char *date);
+
+#endif
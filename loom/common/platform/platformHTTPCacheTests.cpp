@@ -0,0 +1,158 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <string.h>
+#include "seatest.h"
+#include "loom/common/platform/platformFile.h"
+#include "loom/common/platform/platformHTTPCache.h"
+
+SEATEST_FIXTURE(platformHTTPCache)
+{
+    SEATEST_FIXTURE_ENTRY(platformHTTPCache_parse);
+    SEATEST_FIXTURE_ENTRY(platformHTTPCache_freshness);
+    SEATEST_FIXTURE_ENTRY(platformHTTPCache_eviction);
+}
+
+static const char *HTTP_CACHE_TEST_DIR   = "httpcache_test";
+static const char *HTTP_CACHE_TEST_INDEX = "httpcache_test/index.json";
+
+static loom_HTTPCacheHeaders makeHeaders(const char *cacheControl, const char *etag)
+{
+    loom_HTTPCacheHeaders headers;
+
+    headers.clear();
+    headers.cacheControl = cacheControl;
+    headers.etag         = etag;
+    return headers;
+}
+
+SEATEST_TEST(platformHTTPCache_parse)
+{
+    assert_true(platform_HTTPParseDate("Sun, 06 Nov 1994 08:49:37 GMT") == 784111777);
+    assert_true(platform_HTTPParseDate("Thu, 01 Jan 1970 00:00:00 GMT") == 0);
+    assert_true(platform_HTTPParseDate("Tue, 29 Feb 2000 12:00:00 GMT") == 951825600);
+    assert_true(platform_HTTPParseDate("0") == -1);
+    assert_true(platform_HTTPParseDate("Sun, 06 Foo 1994 08:49:37 GMT") == -1);
+
+    loom_HTTPCacheHeaders headers;
+    headers.clear();
+
+    const char *etag = "ETag:  \"abc\"\r\n";
+    assert_true(headers.parse(etag, strlen(etag)));
+    assert_string_equal("\"abc\"", headers.etag.c_str());
+
+    const char *control = "cache-CONTROL: max-age=60\r\n";
+    assert_true(headers.parse(control, strlen(control)));
+    assert_string_equal("max-age=60", headers.cacheControl.c_str());
+
+    const char *other = "Content-Type: text/plain\r\n";
+    assert_false(headers.parse(other, strlen(other)));
+}
+
+SEATEST_TEST(platformHTTPCache_freshness)
+{
+    platform_HTTPCacheInit(HTTP_CACHE_TEST_DIR, 1024 * 1024);
+    platform_HTTPCacheClear();
+
+    utArray<unsigned char> body;
+    utString               etag, lastModified;
+    const unsigned char    data[] = "cached body";
+
+    assert_int_equal(LOOM_HTTP_CACHE_MISS, platform_HTTPCacheLookup("http://a/fresh", body, etag, lastModified));
+
+    // Fresh responses are served as they are.
+    platform_HTTPCacheStore("http://a/fresh", makeHeaders("public, max-age=60", ""), data, sizeof(data));
+    assert_int_equal(LOOM_HTTP_CACHE_FRESH, platform_HTTPCacheLookup("http://a/fresh", body, etag, lastModified));
+    assert_int_equal(sizeof(data), body.size());
+    assert_true(!memcmp(data, body.ptr(), sizeof(data)));
+
+    // Ones to revalidate hand out their validators, and their body once
+    // the server confirms it.
+    platform_HTTPCacheStore("http://a/stale", makeHeaders("no-cache", "\"v1\""), data, sizeof(data));
+    assert_int_equal(LOOM_HTTP_CACHE_STALE, platform_HTTPCacheLookup("http://a/stale", body, etag, lastModified));
+    assert_string_equal("\"v1\"", etag.c_str());
+
+    body.clear();
+    assert_true(platform_HTTPCacheRevalidated("http://a/stale", makeHeaders("no-cache", ""), body));
+    assert_int_equal(sizeof(data), body.size());
+
+    // Responses that can't be reused aren't kept.
+    platform_HTTPCacheStore("http://a/nostore", makeHeaders("no-store", "\"v1\""), data, sizeof(data));
+    platform_HTTPCacheStore("http://a/novalidator", makeHeaders("max-age=0", ""), data, sizeof(data));
+    assert_int_equal(LOOM_HTTP_CACHE_MISS, platform_HTTPCacheLookup("http://a/nostore", body, etag, lastModified));
+    assert_int_equal(LOOM_HTTP_CACHE_MISS, platform_HTTPCacheLookup("http://a/novalidator", body, etag, lastModified));
+
+    loom_HTTPCacheStats stats;
+    platform_HTTPCacheGetStats(&stats);
+    assert_int_equal(1, stats.hits);
+    assert_int_equal(1, stats.revalidations);
+    assert_int_equal(3, stats.misses);
+    assert_int_equal(2, stats.entryCount);
+
+    platform_HTTPCacheClear();
+    platform_HTTPCacheShutdown();
+    platform_removeFile(HTTP_CACHE_TEST_INDEX);
+    platform_removeDir(HTTP_CACHE_TEST_DIR);
+}
+
+SEATEST_TEST(platformHTTPCache_eviction)
+{
+    // Room for 8 entries of 1 KB, none may be larger than an eighth.
+    platform_HTTPCacheInit(HTTP_CACHE_TEST_DIR, 8 * 1024);
+    platform_HTTPCacheClear();
+
+    unsigned char data[1024];
+    memset(data, 7, sizeof(data));
+
+    utArray<unsigned char> body;
+    utString               etag, lastModified;
+    char                   url[64];
+
+    for (int i = 0; i < 8; i++)
+    {
+        sprintf(url, "http://a/%d", i);
+        platform_HTTPCacheStore(url, makeHeaders("max-age=60", ""), data, sizeof(data));
+
+        // Keep the first one in use.
+        platform_HTTPCacheLookup("http://a/0", body, etag, lastModified);
+    }
+
+    platform_HTTPCacheStore("http://a/9", makeHeaders("max-age=60", ""), data, sizeof(data));
+    assert_int_equal(LOOM_HTTP_CACHE_FRESH, platform_HTTPCacheLookup("http://a/0", body, etag, lastModified));
+    assert_int_equal(LOOM_HTTP_CACHE_FRESH, platform_HTTPCacheLookup("http://a/9", body, etag, lastModified));
+    assert_int_equal(LOOM_HTTP_CACHE_MISS, platform_HTTPCacheLookup("http://a/1", body, etag, lastModified));
+
+    loom_HTTPCacheStats stats;
+    platform_HTTPCacheGetStats(&stats);
+    assert_int_equal(8, stats.entryCount);
+    assert_int_equal(1, stats.evictions);
+    assert_true(stats.size <= 8 * 1024);
+
+    // Too large to be worth it.
+    unsigned char large[2048];
+    memset(large, 1, sizeof(large));
+    platform_HTTPCacheStore("http://a/large", makeHeaders("max-age=60", ""), large, sizeof(large));
+    assert_int_equal(LOOM_HTTP_CACHE_MISS, platform_HTTPCacheLookup("http://a/large", body, etag, lastModified));
+
+    platform_HTTPCacheClear();
+    platform_HTTPCacheShutdown();
+    platform_removeFile(HTTP_CACHE_TEST_INDEX);
+    platform_removeDir(HTTP_CACHE_TEST_DIR);
+}
@@ -33,55 +33,100 @@
 #include "loom/common/core/assert.h"
 #include "loom/common/core/log.h"
 #include "loom/common/platform/platformFile.h"
+#include "loom/common/platform/platformHTTPCache.h"
+#include "loom/common/platform/platformThread.h"
 #include "loom/common/utils/utBase64.h"
 
 lmDefineLogGroup(gHTTPCurlLogGroup, "http", 1, LoomLogInfo);
 
-static CURLM *gMultiHandle;
-static CURL *curlHandles[MAX_CONCURRENT_HTTP_REQUESTS];
-static int   gHandleCount;
-static bool  gHTTPInitialized;
-
 /**
- * Represents a chunk in memory reserved for writing bytes from curls write_data callback
+ * Requests are transferred by a thread of their own, which sleeps in
+ * curl_multi_wait rather than being polled once a frame, so responses keep
+ * arriving while the main thread is busy. Everything touching curl happens
+ * on that thread; platform_HTTPUpdate only hands the results to the
+ * callbacks on the main thread.
+ *
+ * Finished easy handles are kept for reuse and all of them share one DNS
+ * and TLS session cache, while the multi handle keeps connections alive
+ * between requests and multiplexes requests to a host over one HTTP/2
+ * connection where libcurl was built with HTTP/2.
+ *
+ * GET requests go through the disk cache of platformHTTPCache.h: fresh
+ * responses are served without reaching the HTTP thread at all, stale ones
+ * are requested conditionally.
  */
-typedef struct
-{
-    char   *memory;
-    size_t size;
-} loom_HTTPChunk;
+
+// How long the thread waits on transfers before picking up new requests.
+#define LOOM_HTTP_WAIT_MS       10
+
+// Easy handles kept for reuse.
+#define LOOM_HTTP_IDLE_HANDLES  8
 
 /**
- * Represents a user data payload
+ * A request, from platform_HTTPSend until platform_HTTPComplete.
  */
 typedef struct
 {
-    // the chunk of data returned by the http call
-    loom_HTTPChunk    *chunk;
+    int               index;
 
-    // the callback to call when a http callback has finished/failed
+    // Set up by platform_HTTPSend, read only afterwards.
+    utString          url;
+    utString          method;
+    utString          cacheFile;
+    utArray<char>     body;
+    utArray<utString> headers;
+    bool              followRedirects;
+    bool              stream;
     loom_HTTPCallback callback;
-
-    // the payload to be passed to the callback
     void              *payload;
+    loom_HTTPCacheState cacheState;
 
-    // the headers slist
-    curl_slist        *headers;
-
-    utString          cacheFile;
-    void              *body;
-    int               bodyLength;
+    // Only touched by the HTTP thread.
+    CURL              *handle;
+    curl_slist        *headerList;
     size_t            position;
-    utString          url;
-    utString          method;
-} loom_HTTPUserData;
-
-static void loom_HTTPCleanupUserData(loom_HTTPUserData *data)
+    bool              checkedStatus;
+    loom_HTTPCacheHeaders responseHeaders; // read by the main thread once done
+
+    // Shared, guarded by gHTTPMutex.
+    utArray<unsigned char> received; // not handed to the callback yet
+    bool              streaming;     // received goes out in LOOM_HTTP_CHUNKs
+    bool              done;
+    CURLcode          result;
+    long              httpCode;
+    bool              released;
+
+    // Only touched by the main thread.
+    bool              delivered;
+    bool              cacheable;     // a GET the HTTP cache may store
+    utArray<unsigned char> cached;   // the whole body, when caching a stream
+} loom_HTTPRequest;
+
+static bool gHTTPInitialized;
+
+// Main thread state.
+static utArray<loom_HTTPRequest *> gRequests; // by index, NULL when free
+static utArray<int>                gFreeIndices;
+
+// Handed between the threads, guarded by gHTTPMutex.
+static MutexHandle                 gHTTPMutex;
+static SemaphoreHandle             gHTTPWake;
+static ThreadHandle                gHTTPThread;
+static utArray<loom_HTTPRequest *> gAddQueue;
+static utArray<loom_HTTPRequest *> gReleaseQueue;
+static volatile bool               gHTTPQuit;
+
+// HTTP thread state.
+static CURLM                       *gMultiHandle;
+static CURLSH                      *gShareHandle;
+static utArray<CURL *>             gIdleHandles;
+static utArray<loom_HTTPRequest *> gTransfers;
+static bool                        gHTTP2;
+
+static void loom_HTTPDeleteRequest(loom_HTTPRequest *request)
 {
-    lmSafeFree(NULL, data->chunk->memory);
-    curl_slist_free_all(data->headers);
-    lmSafeDelete(NULL, data->chunk);
-    lmDelete(NULL, data);
+    curl_slist_free_all(request->headerList);
+    lmDelete(NULL, request);
 }
 
 
@@ -90,39 +135,70 @@ static void loom_HTTPCleanupUserData(loom_HTTPUserData *data)
  */
 static size_t write_data(void *buffer, size_t size, size_t nmemb, void *userp)
 {
-    size_t            actualSize = size * nmemb;
-    loom_HTTPUserData *userData  = (loom_HTTPUserData *)userp;
-    loom_HTTPChunk    *chunk     = userData->chunk;
+    size_t           actualSize = size * nmemb;
+    loom_HTTPRequest *request   = (loom_HTTPRequest *)userp;
 
-    // reallocate memory for our chunk. +1 for our null terminator.
-    chunk->memory = (char *)lmRealloc(NULL, chunk->memory, chunk->size + actualSize + 1);
-    if (chunk->memory == NULL) // OOM?
+    // Error responses are delivered whole, so only start streaming once the
+    // status is known to be good.
+    bool streaming = false;
+    if (request->stream && !request->checkedStatus)
     {
-        // TODO: Log OOM error in loom
-        // let curl throw the error for us.
-        return 0;
+        long httpCode = 0;
+        curl_easy_getinfo(request->handle, CURLINFO_RESPONSE_CODE, &httpCode);
+        streaming              = httpCode < 400;
+        request->checkedStatus = true;
     }
 
-    // copy starting from the last null terminator
-    memcpy(&(chunk->memory[chunk->size]), buffer, actualSize);
-    chunk->size += actualSize;
-    chunk->memory[chunk->size] = 0;
+    loom_mutex_lock(gHTTPMutex);
+
+    if (streaming)
+    {
+        request->streaming = true;
+    }
+
+    UTsize offset = request->received.size();
+    request->received.resize(offset + (UTsize)actualSize);
+    memcpy(request->received.ptr() + offset, buffer, actualSize);
+
+    loom_mutex_unlock(gHTTPMutex);
 
     return actualSize;
 }
 
+/**
+ * Collect the response headers the HTTP cache needs
+ */
+static size_t header_data(char *buffer, size_t size, size_t nmemb, void *userp)
+{
+    size_t           length  = size * nmemb;
+    loom_HTTPRequest *request = (loom_HTTPRequest *)userp;
+
+    // Each response, a redirect's or the final one, starts with its status
+    // line.
+    if ((length >= 5) && !strncmp(buffer, "HTTP/", 5))
+    {
+        request->responseHeaders.clear();
+    }
+    else
+    {
+        request->responseHeaders.parse(buffer, length);
+    }
+
+    return length;
+}
+
 /**
 * Read data being uploaded with curl
 */
 static size_t read_data(char* buffer, size_t size, size_t nmemb, void *userp)
 {
     size_t chunkSize = size*nmemb;
-    loom_HTTPUserData *userData = (loom_HTTPUserData*)userp;
-    size_t left = userData->bodyLength - userData->position;
+    loom_HTTPRequest *request = (loom_HTTPRequest*)userp;
+    size_t left = request->body.size() - request->position;
     if (left <= 0) return 0;
     if (chunkSize > left) chunkSize = left;
-    memcpy(buffer, ((char*)userData->body) + userData->position, chunkSize);
-    userData->position += chunkSize;
+    memcpy(buffer, request->body.ptr() + request->position, chunkSize);
+    request->position += chunkSize;
     return chunkSize;
 }
 
@@ -159,85 +235,396 @@ static void *calloc_callback(size_t nmemb, size_t size)
    return res;
 }
 
+// Sets up a pooled easy handle for the request and starts it.
+static void loom_HTTPStartTransfer(loom_HTTPRequest *request)
+{
+    CURL *curlHandle;
+
+    if (gIdleHandles.size())
+    {
+        curlHandle = gIdleHandles.back();
+        gIdleHandles.pop_back();
+    }
+    else
+    {
+        curlHandle = curl_easy_init();
+    }
+
+    request->handle = curlHandle;
+
+    // iterate over the headers and register them
+    for (UTsize i = 0; i < request->headers.size(); i++)
+    {
+        request->headerList = curl_slist_append(request->headerList, request->headers[i].c_str());
+    }
+
+    // url to call
+    curl_easy_setopt(curlHandle, CURLOPT_URL, request->url.c_str());
+    // our writedata callback
+    curl_easy_setopt(curlHandle, CURLOPT_WRITEFUNCTION, write_data);
+    // our writedata callback payload
+    curl_easy_setopt(curlHandle, CURLOPT_WRITEDATA, request);
+    // general payload
+    curl_easy_setopt(curlHandle, CURLOPT_PRIVATE, request);
+    // custom headers
+    curl_easy_setopt(curlHandle, CURLOPT_HTTPHEADER, request->headerList);
+    // response headers, for the cache
+    if (request->cacheable)
+    {
+        curl_easy_setopt(curlHandle, CURLOPT_HEADERFUNCTION, header_data);
+        curl_easy_setopt(curlHandle, CURLOPT_HEADERDATA, request);
+    }
+    // signals can't be used off the main thread
+    curl_easy_setopt(curlHandle, CURLOPT_NOSIGNAL, 1L);
+    // DNS and TLS sessions shared by all requests
+    curl_easy_setopt(curlHandle, CURLOPT_SHARE, gShareHandle);
+    curl_easy_setopt(curlHandle, CURLOPT_TCP_KEEPALIVE, 1L);
+
+    // Ask for HTTP/2 over TLS, letting requests to the same host wait for a
+    // connection to multiplex over rather than opening their own.
+    if (gHTTP2 && !strncmp(request->url.c_str(), "https:", 6))
+    {
+        curl_easy_setopt(curlHandle, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2_0);
+#if LIBCURL_VERSION_NUM >= 0x072B00
+        curl_easy_setopt(curlHandle, CURLOPT_PIPEWAIT, 1L);
+#endif
+    }
+
+    // Configure redirect behavior.
+    curl_easy_setopt(curlHandle, CURLOPT_FOLLOWLOCATION, request->followRedirects ? 1L : 0L);
+
+    if (request->method == "POST")
+    {
+        curl_easy_setopt(curlHandle, CURLOPT_POST, 1L);
+        curl_easy_setopt(curlHandle, CURLOPT_POSTFIELDSIZE, (long)request->body.size());
+        curl_easy_setopt(curlHandle, CURLOPT_POSTFIELDS, request->body.ptr());
+    }
+    else if (request->method == "PUT")
+    {
+        request->position = 0;
+        curl_easy_setopt(curlHandle, CURLOPT_READFUNCTION, read_data);
+        curl_easy_setopt(curlHandle, CURLOPT_READDATA, request);
+        curl_easy_setopt(curlHandle, CURLOPT_UPLOAD, 1L);
+        curl_easy_setopt(curlHandle, CURLOPT_INFILESIZE, (long)request->body.size());
+    }
+
+    // add to the multi interface
+    curl_multi_add_handle(gMultiHandle, curlHandle);
+    gTransfers.push_back(request);
+}
+
+
+// Takes the request's easy handle off the multi handle, keeping it for
+// reuse where there is room.
+static void loom_HTTPStopTransfer(loom_HTTPRequest *request)
+{
+    if (!request->handle)
+    {
+        return;
+    }
+
+    curl_multi_remove_handle(gMultiHandle, request->handle);
+
+    if (gIdleHandles.size() < LOOM_HTTP_IDLE_HANDLES)
+    {
+        // Keeps the connection and the caches, drops the options.
+        curl_easy_reset(request->handle);
+        gIdleHandles.push_back(request->handle);
+    }
+    else
+    {
+        curl_easy_cleanup(request->handle);
+    }
+
+    request->handle = NULL;
+    gTransfers.erase(request);
+}
+
+
+// Starts queued requests and drops released ones.
+static void loom_HTTPTakeQueues()
+{
+    utArray<loom_HTTPRequest *> added;
+    utArray<loom_HTTPRequest *> released;
+
+    loom_mutex_lock(gHTTPMutex);
+    added    = gAddQueue;
+    released = gReleaseQueue;
+    gAddQueue.clear();
+    gReleaseQueue.clear();
+    loom_mutex_unlock(gHTTPMutex);
+
+    for (UTsize i = 0; i < added.size(); i++)
+    {
+        // Released requests are only ever queued for release after being
+        // queued to start, so checking the flag is enough.
+        loom_mutex_lock(gHTTPMutex);
+        bool isReleased = added[i]->released;
+        loom_mutex_unlock(gHTTPMutex);
+
+        if (!isReleased)
+        {
+            loom_HTTPStartTransfer(added[i]);
+        }
+    }
+
+    for (UTsize i = 0; i < released.size(); i++)
+    {
+        loom_HTTPStopTransfer(released[i]);
+        loom_HTTPDeleteRequest(released[i]);
+    }
+}
+
+
+static int __stdcall loom_HTTPThread(void *param)
+{
+    loom_thread_setDebugName("HTTP");
+
+    while (!gHTTPQuit)
+    {
+        loom_HTTPTakeQueues();
+
+        if (!gTransfers.size())
+        {
+            // Nothing in flight, sleep until a request comes in.
+            loom_semaphore_wait(gHTTPWake);
+            continue;
+        }
+
+        int running = 0;
+        curl_multi_perform(gMultiHandle, &running);
+
+        // loop over all of our infos and finish the transfers that are done
+        int     messageCount = 0;
+        CURLMsg *message     = curl_multi_info_read(gMultiHandle, &messageCount);
+        while (message != NULL)
+        {
+            if (message->msg == CURLMSG_DONE)
+            {
+                loom_HTTPRequest *request = NULL;
+                curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &request);
+
+                long httpCode = 0;
+                curl_easy_getinfo(message->easy_handle, CURLINFO_RESPONSE_CODE, &httpCode);
+
+                loom_mutex_lock(gHTTPMutex);
+                request->done     = true;
+                request->result   = message->data.result;
+                request->httpCode = httpCode;
+                loom_mutex_unlock(gHTTPMutex);
+
+                // message doesn't survive past curl_multi_remove_handle
+                loom_HTTPStopTransfer(request);
+            }
+
+            // go to the next message
+            message = curl_multi_info_read(gMultiHandle, &messageCount);
+        }
+
+        if (gTransfers.size())
+        {
+            int numfds = 0;
+            curl_multi_wait(gMultiHandle, NULL, 0, LOOM_HTTP_WAIT_MS, &numfds);
+        }
+    }
+
+    loom_HTTPTakeQueues();
+
+    // Requests the main thread still holds keep their memory, but lose
+    // their handles.
+    while (gTransfers.size())
+    {
+        loom_HTTPStopTransfer(gTransfers.back());
+    }
+
+    for (UTsize i = 0; i < gIdleHandles.size(); i++)
+    {
+        curl_easy_cleanup(gIdleHandles[i]);
+    }
+
+    gIdleHandles.clear();
+
+    return 0;
+}
+
+
 void platform_HTTPInit()
 {
     curl_global_init_mem(CURL_GLOBAL_DEFAULT,
        malloc_callback, free_callback, realloc_callback, 
        strdup_callback, calloc_callback);
-    gMultiHandle     = curl_multi_init();
-    gHandleCount     = 0;
+
+    gMultiHandle = curl_multi_init();
+#ifdef CURLPIPE_MULTIPLEX
+    curl_multi_setopt(gMultiHandle, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+
+    // Only ever used from the HTTP thread, so it needs no locking.
+    gShareHandle = curl_share_init();
+    curl_share_setopt(gShareHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(gShareHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+    gHTTP2 = (curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_HTTP2) != 0;
+
+    gHTTPMutex       = loom_mutex_create();
+    gHTTPWake        = loom_semaphore_create();
+    gHTTPQuit        = false;
+    gHTTPThread      = loom_thread_startWithHint(loom_HTTPThread, NULL, LOOM_THREAD_BACKGROUND);
     gHTTPInitialized = true;
-    memset(curlHandles, 0, sizeof(CURL *) * MAX_CONCURRENT_HTTP_REQUESTS);
 }
 
 
 void platform_HTTPCleanup()
 {
+    if (!gHTTPInitialized)
+    {
+        return;
+    }
+
+    gHTTPQuit = true;
+    loom_semaphore_post(gHTTPWake);
+    loom_thread_join(gHTTPThread);
+
+    for (UTsize i = 0; i < gRequests.size(); i++)
+    {
+        if (gRequests[i])
+        {
+            loom_HTTPDeleteRequest(gRequests[i]);
+        }
+    }
+
+    gRequests.clear();
+    gFreeIndices.clear();
+
     curl_multi_cleanup(gMultiHandle);
+    curl_share_cleanup(gShareHandle);
     curl_global_cleanup();
+
+    loom_semaphore_destroy(gHTTPWake);
+    loom_mutex_destroy(gHTTPMutex);
+
+    gHTTPInitialized = false;
 }
 
 
-void platform_HTTPUpdate()
+// Calls back with a copy of data, the callback doesn't own it.
+static void loom_HTTPDeliver(loom_HTTPRequest *request, loom_HTTPCallbackType type, const utArray<unsigned char>& data)
 {
-    assert(gHTTPInitialized);
+    utByteArray *result = lmNew(NULL) utByteArray();
 
-    CURLMcode ret = curl_multi_perform(gMultiHandle, &gHandleCount);
+    if (data.size())
+    {
+        result->allocateAndCopy((void *)data.ptr(), (int)data.size());
+    }
 
+    request->callback(request->payload, type, result);
+
+    lmDelete(NULL, result);
+}
+
+
+void platform_HTTPUpdate()
+{
+    assert(gHTTPInitialized);
 
-    // loop over all of our infos and cleanup handles that are done
-    int     messageCount = 0;
-    CURLMsg *message     = curl_multi_info_read(gMultiHandle, &messageCount);
-    while (message != NULL)
+    // Callbacks may send new requests or complete any of them, so look each
+    // one up afresh.
+    for (UTsize i = 0; i < gRequests.size(); i++)
     {
-        if (message->msg == CURLMSG_DONE)
+        loom_HTTPRequest *request = gRequests[i];
+
+        if (!request || request->delivered)
         {
-            // copy the handle because message won't survive
-            // past multi_remove_handle. Silly CURL. -JMS
-            CURL *handle = message->easy_handle;
+            continue;
+        }
 
-            // get our userData payload
-            loom_HTTPUserData *userData = NULL;
-            curl_easy_getinfo(handle, CURLINFO_PRIVATE, &userData);
+        utArray<unsigned char> received;
+
+        loom_mutex_lock(gHTTPMutex);
+        bool     done      = request->done;
+        bool     streaming = request->streaming;
+        CURLcode result    = request->result;
+        long     httpCode  = request->httpCode;
+        if (streaming || done)
+        {
+            received = request->received;
+            request->received.clear();
+        }
+        loom_mutex_unlock(gHTTPMutex);
 
-            // Make sure no error was thrown
-            if (message->data.result == CURLE_OK)
+        if (streaming && (request->cacheFile.length() || request->cacheable))
+        {
+            UTsize offset = request->cached.size();
+            request->cached.resize(offset + received.size());
+            if (received.size())
             {
-                long http_code = 0;
-                curl_easy_getinfo (handle, CURLINFO_RESPONSE_CODE, &http_code);
+                memcpy(request->cached.ptr() + offset, received.ptr(), received.size());
+            }
 
-                // Will we cache to a file?
-                if (http_code < 400 && userData->cacheFile.length())
+            // Don't hold on to a stream too large for the HTTP cache.
+            if (request->cacheable && ((long long)request->cached.size() > platform_HTTPCacheMaxEntrySize()))
+            {
+                request->cacheable = false;
+                if (!request->cacheFile.length())
                 {
-                    platform_writeFile(userData->cacheFile.c_str(), userData->chunk->memory, (int)userData->chunk->size);
+                    request->cached.clear();
                 }
+            }
+        }
 
-                utByteArray *result = lmNew(NULL) utByteArray();
-                // TODO: Don't copy?
-                result->allocateAndCopy(userData->chunk->memory, (int)userData->chunk->size);
+        if (streaming && received.size())
+        {
+            loom_HTTPDeliver(request, LOOM_HTTP_CHUNK, received);
+            received.clear();
 
-                // notify the callback if we are successful
-                if (http_code < 400)
-                    userData->callback(userData->payload, LOOM_HTTP_SUCCESS, result);
-                else
-                    userData->callback(userData->payload, LOOM_HTTP_ERROR, result);
+            // The callback may have completed it.
+            if (gRequests[i] != request)
+            {
+                continue;
+            }
+        }
 
-                lmDelete(NULL, result);
+        if (!done)
+        {
+            continue;
+        }
+
+        request->delivered = true;
+
+        // Make sure no error was thrown
+        if (result == CURLE_OK)
+        {
+            // Not modified, answer with what the HTTP cache holds.
+            if ((httpCode == 304) && (request->cacheState == LOOM_HTTP_CACHE_STALE) &&
+                platform_HTTPCacheRevalidated(request->url.c_str(), request->responseHeaders, received))
+            {
+                httpCode = 200;
+            }
+            else if ((httpCode == 200) && request->cacheable && (request->cacheState != LOOM_HTTP_CACHE_FRESH))
+            {
+                const utArray<unsigned char>& body = streaming ? request->cached : received;
+                platform_HTTPCacheStore(request->url.c_str(), request->responseHeaders, body.ptr(), body.size());
             }
-            else
+
+            // Will we cache to a file?
+            if (httpCode < 400 && request->cacheFile.length())
             {
-                // send a failure to the callback
-                utByteArray *result = lmNew(NULL) utByteArray();
-                result->writeString(curl_easy_strerror(message->data.result));
-                userData->callback(userData->payload, LOOM_HTTP_ERROR, result);
+                const utArray<unsigned char>& body = streaming ? request->cached : received;
+                platform_writeFile(request->cacheFile.c_str(), (void *)body.ptr(), (int)body.size());
             }
 
-            // clean up any userdata.
-            loom_HTTPCleanupUserData(userData);
+            // notify the callback if we are successful
+            loom_HTTPDeliver(request, httpCode < 400 ? LOOM_HTTP_SUCCESS : LOOM_HTTP_ERROR, received);
         }
+        else
+        {
+            // send a failure to the callback
+            const char *error = curl_easy_strerror(result);
 
-        // go to the next message
-        message = curl_multi_info_read(gMultiHandle, &messageCount);
+            received.resize((UTsize)strlen(error));
+            memcpy(received.ptr(), error, received.size());
+            loom_HTTPDeliver(request, LOOM_HTTP_ERROR, received);
+        }
     }
 }
 
@@ -251,121 +638,136 @@ bool platform_HTTPIsConnected()
 
 int platform_HTTPSend(const char *url, const char *method, loom_HTTPCallback callback, void *payload,
                        const char *body, int bodyLength, utHashTable<utHashedString, utString>& headers,
-                       const char *responseCacheFile, bool followRedirects)
+                       const char *responseCacheFile, bool followRedirects, bool streamResponse)
 {
     assert(gHTTPInitialized);
 
-    //get an empty slot for our handle to use
-    int index = 0;
-    while ((curlHandles[index] != NULL) && (index < MAX_CONCURRENT_HTTP_REQUESTS)) {index++;}
-    if(index == MAX_CONCURRENT_HTTP_REQUESTS)
+    if (!method || (strcmp(method, "GET") && strcmp(method, "POST") && strcmp(method, "PUT"))) // call error
     {
+        utByteArray *result = lmNew(NULL) utByteArray();
+        result->writeString("Error: Unknown HTTP Method.");
+        callback(payload, LOOM_HTTP_ERROR, result);
+        lmDelete(NULL, result);
         return -1;
     }
 
-    // initialize our curl handle
-    CURL *curlHandle = curl_easy_init();
-
-    curl_slist *headersList = NULL;
-
-    // alloc our struct, this needs to be alloc'd in the heap
-    // because it should persist past the initial request
-    loom_HTTPUserData *userData = lmNew(NULL) loom_HTTPUserData;
-
-    // do not keep pointers to the strings passed in
-    userData->cacheFile  = responseCacheFile ? responseCacheFile : "";
-    userData->body       = (void *)body;
-    userData->bodyLength = bodyLength;
-    userData->url        = url ? url : "";
-    userData->method     = method ? method : "";
-    userData->callback   = callback;
-    userData->payload    = payload;
+    loom_HTTPRequest *request = lmNew(NULL) loom_HTTPRequest;
+
+    // do not keep pointers to anything passed in, the request outlives them
+    request->url             = url ? url : "";
+    request->method          = method;
+    request->cacheFile       = responseCacheFile ? responseCacheFile : "";
+    request->followRedirects = followRedirects;
+    request->stream          = streamResponse;
+    request->callback        = callback;
+    request->payload         = payload;
+    request->handle          = NULL;
+    request->headerList      = NULL;
+    request->position        = 0;
+    request->checkedStatus   = false;
+    request->streaming       = false;
+    request->done            = false;
+    request->result          = CURLE_OK;
+    request->httpCode        = 0;
+    request->released        = false;
+    request->delivered       = false;
+    request->cacheable       = platform_HTTPCacheEnabled() && !strcmp(method, "GET");
+    request->cacheState      = LOOM_HTTP_CACHE_MISS;
+
+    if (body && (bodyLength > 0))
+    {
+        request->body.resize(bodyLength);
+        memcpy(request->body.ptr(), body, bodyLength);
+    }
 
-    // iterate over the utHashTable and register our headers
+    // iterate over the utHashTable and collect our headers
     utHashTableIterator<utHashTable<utHashedString, utString> > headersIterator(headers);
     while (headersIterator.hasMoreElements())
     {
-        utHashedString key    = headersIterator.peekNextKey();
-        utString       value  = headersIterator.peekNextValue();
-        utString       header = key.str() + ":" + value;
+        utString header = headersIterator.peekNextKey().str();
+        header += ":";
+        header += headersIterator.peekNextValue();
 
-        headersList = curl_slist_append(headersList, header.c_str());
+        request->headers.push_back(header);
 
         headersIterator.next();
     }
 
-    // initialize our chunk data, it will eventually be resized.
-    userData->chunk = lmNew(NULL) loom_HTTPChunk;
-    userData->chunk->memory = (char*)lmAlloc(NULL, 1); // Must use malloc as Curl wants to realloc.
-    userData->chunk->memory[0] = 0;
-    userData->chunk->size      = 0;
-
-    // headers
-    userData->headers = headersList;
-
-    // url to call
-    curl_easy_setopt(curlHandle, CURLOPT_URL, userData->url.c_str());
-    // our writedata callback
-    curl_easy_setopt(curlHandle, CURLOPT_WRITEFUNCTION, write_data);
-    // our writedata callback payload
-    curl_easy_setopt(curlHandle, CURLOPT_WRITEDATA, userData);
-    // general payload
-    curl_easy_setopt(curlHandle, CURLOPT_PRIVATE, userData);
-    // custom headers
-    curl_easy_setopt(curlHandle, CURLOPT_HTTPHEADER, userData->headers);
+    if (request->cacheable)
+    {
+        utString etag, lastModified;
+        request->cacheState = platform_HTTPCacheLookup(request->url.c_str(), request->received, etag, lastModified);
 
-    // Configure redirect behavior.
-    curl_easy_setopt(curlHandle, CURLOPT_FOLLOWLOCATION, followRedirects ? 1 : 0);
+        if (request->cacheState == LOOM_HTTP_CACHE_FRESH)
+        {
+            // Answered on the next update, without a transfer.
+            request->done     = true;
+            request->httpCode = 200;
+        }
+        else if (request->cacheState == LOOM_HTTP_CACHE_STALE)
+        {
+            // Unless the caller validates on its own.
+            if (etag.length() && !headers.get("If-None-Match"))
+            {
+                request->headers.push_back(utString("If-None-Match:") + etag);
+            }
 
-    if (strcmp(method, "GET") == 0)
-    {
-        // do nothing, GET is the default
+            if (lastModified.length() && !headers.get("If-Modified-Since"))
+            {
+                request->headers.push_back(utString("If-Modified-Since:") + lastModified);
+            }
+        }
     }
-    else if (strcmp(method, "POST") == 0)
+
+    // take a free index, or a new one
+    if (gFreeIndices.size())
     {
-        curl_easy_setopt(curlHandle, CURLOPT_POST, 1);
-        curl_easy_setopt(curlHandle, CURLOPT_POSTFIELDSIZE, userData->bodyLength);
-        curl_easy_setopt(curlHandle, CURLOPT_COPYPOSTFIELDS, (const char *)userData->body);
+        request->index = gFreeIndices.back();
+        gFreeIndices.pop_back();
+        gRequests[request->index] = request;
     }
-    else if (strcmp(method, "PUT") == 0)
+    else
     {
-        userData->position = 0;
-        curl_easy_setopt(curlHandle, CURLOPT_READFUNCTION, read_data);
-        curl_easy_setopt(curlHandle, CURLOPT_READDATA, userData);
-        curl_easy_setopt(curlHandle, CURLOPT_UPLOAD, 1);
-        curl_easy_setopt(curlHandle, CURLOPT_INFILESIZE, userData->bodyLength);
+        request->index = (int)gRequests.size();
+        gRequests.push_back(request);
     }
-    else // call error
+
+    if (!request->done)
     {
-        utByteArray *result = lmNew(NULL) utByteArray();
-        result->writeString("Error: Unknown HTTP Method.");
-        callback(payload, LOOM_HTTP_ERROR, result);
-        return -1;
-    }
+        loom_mutex_lock(gHTTPMutex);
+        gAddQueue.push_back(request);
+        loom_mutex_unlock(gHTTPMutex);
 
-    // add to the multi interface
-    curl_multi_add_handle(gMultiHandle, curlHandle);
-    curlHandles[index] = curlHandle;
+        loom_semaphore_post(gHTTPWake);
+    }
 
-    return index;
+    return request->index;
 }
 
 bool platform_HTTPCancel(int index)
 {
-    return ((index == -1) || (curlHandles[index] == NULL)) ? false : true;
+    return (index >= 0) && (index < (int)gRequests.size()) && gRequests[index] && !gRequests[index]->delivered;
 }
 
 void platform_HTTPComplete(int index)
 {
     if(index != -1)
     {
-        lmAssert(index >= 0 && index < MAX_CONCURRENT_HTTP_REQUESTS, "Index out of bounds: %d", index);
-        curl_multi_remove_handle(gMultiHandle, curlHandles[index]);
-        curl_easy_cleanup(curlHandles[index]);
-        curlHandles[index] = NULL;
+        lmAssert(index >= 0 && index < (int)gRequests.size() && gRequests[index], "Index out of bounds: %d", index);
+
+        // The HTTP thread stops the transfer, if still running, and frees it.
+        loom_HTTPRequest *request = gRequests[index];
+        gRequests[index] = NULL;
+        gFreeIndices.push_back(index);
+
+        loom_mutex_lock(gHTTPMutex);
+        request->released = true;
+        gReleaseQueue.push_back(request);
+        loom_mutex_unlock(gHTTPMutex);
+
+        loom_semaphore_post(gHTTPWake);
     }
 }
 
 #endif
 #endif //LOOMSCRIPT_STANDALONE
-
@@ -45,11 +45,12 @@ extern "C" {
 /**
  *  Enum representing the type of event the callback is called for. LOOM_HTTP_SUCCESS
  *  is called in the case that the http send was successful. LOOM_HTTP_ERROR reports an
- *  unsuccessful http operation.
+ *  unsuccessful http operation. LOOM_HTTP_CHUNK passes on part of a streamed response
+ *  body, see `platform_HTTPSend`.
  */
 typedef enum
 {
-    LOOM_HTTP_SUCCESS, LOOM_HTTP_ERROR
+    LOOM_HTTP_SUCCESS, LOOM_HTTP_ERROR, LOOM_HTTP_CHUNK
 } loom_HTTPCallbackType;
 
 /**
@@ -63,10 +64,13 @@ typedef void (*loom_HTTPCallback)(void *payload, loom_HTTPCallbackType type, utB
  *  function when it is called as a user payload.
  *
  *  @param bodyLength The length in bytes of the body; use strlen if passing a string.
+ *  @param streamResponse Pass a successful response's body on in LOOM_HTTP_CHUNK
+ *         callbacks as it arrives; the final callback then carries whatever
+ *         is left. Backends that can't stream deliver it all at the end.
  */
 int platform_HTTPSend(const char *url, const char *method, loom_HTTPCallback callback, void *payload,
                        const char *body, int bodyLength, utHashTable<utHashedString, utString>& headers,
-                       const char *responseCacheFile, bool followRedirects);
+                       const char *responseCacheFile, bool followRedirects, bool streamResponse);
 
 /**
  *  Cancels an in progress HTTP request that was started via platform_HTTPSend().
@@ -72,8 +72,9 @@ void Java_co_theengine_loomplayer_LoomHTTP_onFailure(JNIEnv *env, jobject thiz,
 
 int platform_HTTPSend(const char *url, const char *method, loom_HTTPCallback callback, void *payload,
                        const char *body, int bodyLength, utHashTable<utHashedString, utString>& headers,
-                       const char *responseCacheFile, bool followRedirects)
+                       const char *responseCacheFile, bool followRedirects, bool streamResponse)
 {
+    // Responses are delivered whole, streamResponse isn't supported here.
     LOOM_PROFILE_START(httpSendHeader);
 
     loomJniMethodInfo jniAddHeader;
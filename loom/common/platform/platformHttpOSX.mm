@@ -139,8 +139,9 @@ static LMURLConnectionDelegate *connections[MAX_CONCURRENT_HTTP_REQUESTS];
  */
 int platform_HTTPSend(const char *url, const char* method, loom_HTTPCallback callback, void *payload, 
     const char *body, int bodyLength, utHashTable<utHashedString, utString> &headers, 
-    const char *responseCacheFile, bool followRedirects)
+    const char *responseCacheFile, bool followRedirects, bool streamResponse)
 {
+    // Responses are delivered whole, streamResponse isn't supported here.
     int index = 0;
     while ((connections[index] != NULL) && (index < MAX_CONCURRENT_HTTP_REQUESTS)) {index++;}
     if(index == MAX_CONCURRENT_HTTP_REQUESTS)
@@ -76,10 +76,14 @@ struct loom_filemapping
     void                       *mapping;
     void                       *payload;
     loom_filemapping_cleaner_t dtor;
+
+    // Set if a NUL follows the mapped bytes.
+    int                        terminated;
 }
 gFileMappings[LOOM_MAX_FILEMAPPINGS];
 
 static loom_allocator_t *fileMappingAllocator = NULL;
+static MutexHandle      fileMappingLock       = NULL;
 static loom_logGroup_t  ioLogGroup            = { "io", 1 };
 
 static void ensureStartedUp()
@@ -90,6 +94,7 @@ static void ensureStartedUp()
     }
 
     fileMappingAllocator = loom_allocator_initializeTrackerProxyAllocator(NULL);
+    fileMappingLock      = loom_mutex_create();
 }
 
 
@@ -116,12 +121,14 @@ static void dumpMappings()
 }
 
 
-static void registerMapping(const char *path, void *ptr, loom_filemapping_cleaner_t cleaner, void *payload)
+static void registerMapping(const char *path, void *ptr, loom_filemapping_cleaner_t cleaner, void *payload, int terminated)
 {
     int i;
 
     lmAssert(ptr, "Cannot map file with no ptr!");
 
+    loom_mutex_lock(fileMappingLock);
+
     for (i = 0; i < LOOM_MAX_FILEMAPPINGS; i++)
     {
         if (gFileMappings[i].mapping != NULL)
@@ -129,15 +136,19 @@ static void registerMapping(const char *path, void *ptr, loom_filemapping_cleane
             continue;
         }
 
-        gFileMappings[i].path    = stringtable_insert(path);
-        gFileMappings[i].mapping = ptr;
-        gFileMappings[i].dtor    = cleaner;
-        gFileMappings[i].payload = payload;
+        gFileMappings[i].path       = stringtable_insert(path);
+        gFileMappings[i].mapping    = ptr;
+        gFileMappings[i].dtor       = cleaner;
+        gFileMappings[i].payload    = payload;
+        gFileMappings[i].terminated = terminated;
+        loom_mutex_unlock(fileMappingLock);
         return;
     }
 
     dumpMappings();
 
+    loom_mutex_unlock(fileMappingLock);
+
     lmAssert(0, "Ran out of file mappings!");
 }
 
@@ -344,9 +355,11 @@ int platform_mapFile(const char *path, void **outPointer, long *outSize)
         size = ftell(f);
 #endif
 
-        // Get some memory and set return values!
-        *outPointer = lmAlloc(fileMappingAllocator, size);
+        // Get some memory and set return values! One byte over for a NUL,
+        // so text can be used in place.
+        *outPointer = lmAlloc(fileMappingAllocator, size + 1);
         *outSize    = size;
+        ((char *)*outPointer)[size] = 0;
 
         // Read it in and close file.
 #if LOOM_PLATFORM == LOOM_PLATFORM_WIN32
@@ -365,12 +378,12 @@ int platform_mapFile(const char *path, void **outPointer, long *outSize)
         lmLogDebug(ioLogGroup, "Mapped via fopen (%x, len=%d): '%s'", *outPointer, *outSize, path);
 
         fseek(f, 0, SEEK_SET);
-        lmAssert(fread(*outPointer, 1, size, f), "Unable to read file: '%s'", path);
+        lmAssert(!size || fread(*outPointer, 1, size, f), "Unable to read file: '%s'", path);
         fclose(f);
 #endif
 
         // Register the mapping.
-        registerMapping(path, *outPointer, mappingCleaner_free, fileMappingAllocator);
+        registerMapping(path, *outPointer, mappingCleaner_free, fileMappingAllocator, 1);
 
         // Great, all done!
         return 1;
@@ -416,7 +429,7 @@ int platform_mapFile(const char *path, void **outPointer, long *outSize)
         *outSize    = AAsset_getLength(asset);
         *outPointer = (void *)AAsset_getBuffer(asset);
 
-        registerMapping(path, *outPointer, androidCleaner_free, asset);
+        registerMapping(path, *outPointer, androidCleaner_free, asset, 0);
 
         lmLogDebug(ioLogGroup, "Mapped via AAsset (%x, len=%d): '%s'", *outPointer, *outSize, path);
 
@@ -435,6 +448,8 @@ void platform_unmapFile(void *ptr)
 
     ensureStartedUp();
 
+    loom_mutex_lock(fileMappingLock);
+
     // Find it in the mapping list.
     for (i = 0; i < LOOM_MAX_FILEMAPPINGS; i++)
     {
@@ -448,12 +463,90 @@ void platform_unmapFile(void *ptr)
             gFileMappings[i].dtor(&gFileMappings[i]);
         }
         gFileMappings[i].mapping = NULL;
+        loom_mutex_unlock(fileMappingLock);
         return;
     }
 
     dumpMappings();
 
+    loom_mutex_unlock(fileMappingLock);
+
+    lmAssert(0, "Could not find file mapping for %x!", ptr);
+}
+
+
+int platform_isMapFileTerminated(void *ptr)
+{
+    int i;
+    int terminated = 0;
+
+    ensureStartedUp();
+
+    loom_mutex_lock(fileMappingLock);
+
+    for (i = 0; i < LOOM_MAX_FILEMAPPINGS; i++)
+    {
+        if (gFileMappings[i].mapping == ptr)
+        {
+            terminated = gFileMappings[i].terminated;
+            break;
+        }
+    }
+
+    loom_mutex_unlock(fileMappingLock);
+
+    return terminated;
+}
+
+
+void *platform_detachMapping(void *ptr)
+{
+    int i;
+    loom_filemapping_t *detached;
+
+    ensureStartedUp();
+
+    loom_mutex_lock(fileMappingLock);
+
+    for (i = 0; i < LOOM_MAX_FILEMAPPINGS; i++)
+    {
+        if (gFileMappings[i].mapping != ptr)
+        {
+            continue;
+        }
+
+        // Move it out of the table, freeing the slot for other mappings.
+        detached  = lmAlloc(fileMappingAllocator, sizeof(loom_filemapping_t));
+        *detached = gFileMappings[i];
+        gFileMappings[i].mapping = NULL;
+        loom_mutex_unlock(fileMappingLock);
+        return detached;
+    }
+
+    dumpMappings();
+
+    loom_mutex_unlock(fileMappingLock);
+
     lmAssert(0, "Could not find file mapping for %x!", ptr);
+    return NULL;
+}
+
+
+void platform_releaseMapping(void *handle)
+{
+    loom_filemapping_t *detached = (loom_filemapping_t *)handle;
+
+    if (!detached)
+    {
+        return;
+    }
+
+    if (detached->dtor)
+    {
+        detached->dtor(detached);
+    }
+
+    lmFree(fileMappingAllocator, detached);
 }
 
 
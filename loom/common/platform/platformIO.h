@@ -34,6 +34,17 @@ int platform_mapFile(const char *path, void **outPointer, long *outSize);
 // to platform_mapFile.
 void platform_unmapFile(void *ptr);
 
+// Returns 1 if the block of a mapping is followed by a NUL byte, as it is
+// where files are read into memory, so text can be used without a copy.
+int platform_isMapFileTerminated(void *ptr);
+
+// Only a few mappings may be open at once. To keep one for longer, for
+// instance while an asset is served straight out of it, detach it: this
+// frees its slot and returns a handle which platform_releaseMapping
+// unmaps it by, in place of platform_unmapFile.
+void *platform_detachMapping(void *ptr);
+void platform_releaseMapping(void *handle);
+
 // If file can be opened, returns 1, otherwise returns 0
 int platform_mapFileExists(const char *path);
 
@@ -0,0 +1,532 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <string.h>
+
+#include "loom/common/platform/platformJobs.h"
+#include "loom/common/core/allocator.h"
+#include "loom/common/core/assert.h"
+#include "loom/common/core/log.h"
+#include "loom/common/utils/utTypes.h"
+
+lmDefineLogGroup(gJobsLogGroup, "jobs", 1, LoomLogInfo);
+
+#define LOOM_JOBS_DEQUE_CAPACITY    64
+
+struct loom_Job
+{
+    JobFunction func;
+    void        *param;
+    JobCounter  *counter;
+    JobCounter  *after;
+    int         flags;
+};
+
+// Ring buffer of jobs, its owner pushes and pops at the tail and thieves
+// take from the head. head and tail only grow and are masked on access.
+struct loom_JobDeque
+{
+    MutexHandle           lock;
+    loom_Job              *jobs;
+    int                   capacity;
+    int                   head;
+    int                   tail;
+
+    // Written under lock, read without it to skip empty deques.
+    volatile atomic_int_t count;
+};
+
+// Deque 0 is shared by every thread that isn't a worker, 1 to
+// gWorkerCount belong to the workers.
+static loom_JobDeque gDeques[LOOM_JOBS_MAX_WORKERS + 1];
+static loom_JobDeque gBackgroundJobs;
+static ThreadHandle  gWorkers[LOOM_JOBS_MAX_WORKERS + 1];
+static volatile int  gWorkerThreadIds[LOOM_JOBS_MAX_WORKERS + 1];
+static int           gWorkerCount  = 0;
+static int           gMainThreadId = 0;
+
+static volatile atomic_int_t gRunning  = 0;
+static volatile atomic_int_t gSleeping = 0;
+static SemaphoreHandle       gWake;
+
+// Jobs waiting for their after counter, counters only reach zero under
+// gWaitingLock so a waiting job can't miss its release.
+static MutexHandle       gWaitingLock;
+static utArray<loom_Job> gWaitingJobs;
+
+static MutexHandle       gMainLock;
+static utArray<loom_Job> gMainJobs;
+
+
+// Adds delta and returns the new value. atomic_increment and
+// atomic_decrement return different values on Android, compare and
+// exchange returns the previous one everywhere.
+static int loom_jobs_add(volatile atomic_int_t *value, int delta)
+{
+    int previous;
+
+    do
+    {
+        previous = *value;
+    } while (atomic_compareAndExchange(value, previous, previous + delta) != previous);
+
+    return previous + delta;
+}
+
+
+// Reads value with a full barrier before it, which atomic_load32 doesn't
+// promise on every compiler.
+static int loom_jobs_readFenced(volatile atomic_int_t *value)
+{
+    return atomic_compareAndExchange(value, 0, 0);
+}
+
+
+static void loom_jobs_dequeInit(loom_JobDeque *deque)
+{
+    deque->lock     = loom_mutex_create();
+    deque->capacity = LOOM_JOBS_DEQUE_CAPACITY;
+    deque->jobs     = (loom_Job *)lmAlloc(NULL, sizeof(loom_Job) * deque->capacity);
+    deque->head     = 0;
+    deque->tail     = 0;
+    deque->count    = 0;
+}
+
+
+static void loom_jobs_dequeDestroy(loom_JobDeque *deque)
+{
+    loom_mutex_destroy(deque->lock);
+    lmFree(NULL, deque->jobs);
+    deque->jobs = NULL;
+}
+
+
+static void loom_jobs_dequePush(loom_JobDeque *deque, const loom_Job& job)
+{
+    loom_mutex_lock(deque->lock);
+
+    if (deque->tail - deque->head == deque->capacity)
+    {
+        loom_Job *jobs = (loom_Job *)lmAlloc(NULL, sizeof(loom_Job) * deque->capacity * 2);
+
+        for (int i = deque->head; i != deque->tail; i++)
+        {
+            jobs[i - deque->head] = deque->jobs[i & (deque->capacity - 1)];
+        }
+
+        lmFree(NULL, deque->jobs);
+        deque->jobs      = jobs;
+        deque->tail     -= deque->head;
+        deque->head      = 0;
+        deque->capacity *= 2;
+    }
+
+    deque->jobs[deque->tail++ & (deque->capacity - 1)] = job;
+    deque->count = deque->tail - deque->head;
+
+    loom_mutex_unlock(deque->lock);
+}
+
+
+static bool loom_jobs_dequePop(loom_JobDeque *deque, bool steal, loom_Job& job)
+{
+    if (deque->count == 0)
+    {
+        return false;
+    }
+
+    loom_mutex_lock(deque->lock);
+
+    bool found = deque->tail != deque->head;
+
+    if (found)
+    {
+        job = steal ? deque->jobs[deque->head++ & (deque->capacity - 1)]
+              : deque->jobs[--deque->tail & (deque->capacity - 1)];
+        deque->count = deque->tail - deque->head;
+    }
+
+    loom_mutex_unlock(deque->lock);
+
+    return found;
+}
+
+
+static bool loom_jobs_hasWork()
+{
+    for (int i = 0; i <= gWorkerCount; i++)
+    {
+        if (atomic_load32(&gDeques[i].count))
+        {
+            return true;
+        }
+    }
+
+    return atomic_load32(&gBackgroundJobs.count) != 0;
+}
+
+
+static void loom_jobs_enqueue(const loom_Job& job)
+{
+    if (job.flags & LOOM_JOB_MAIN_THREAD)
+    {
+        loom_mutex_lock(gMainLock);
+        gMainJobs.push_back(job);
+        loom_mutex_unlock(gMainLock);
+        return;
+    }
+
+    loom_jobs_dequePush(job.flags & LOOM_JOB_BACKGROUND ? &gBackgroundJobs : &gDeques[loom_jobs_getThreadIndex()], job);
+
+    // Workers count themselves sleeping before they check for work, so
+    // either they see this job or this sees them.
+    if (loom_jobs_readFenced(&gSleeping) > 0)
+    {
+        loom_semaphore_post(gWake);
+    }
+}
+
+
+static void loom_jobs_finish(const loom_Job& job)
+{
+    if (!job.counter)
+    {
+        return;
+    }
+
+    utArray<loom_Job> released;
+
+    loom_mutex_lock(gWaitingLock);
+
+    if (loom_jobs_add(&job.counter->pending, -1) == 0)
+    {
+        for (UTsize i = 0; i < gWaitingJobs.size(); )
+        {
+            if (gWaitingJobs[i].after == job.counter)
+            {
+                released.push_back(gWaitingJobs[i]);
+                gWaitingJobs.erase(i, true);
+            }
+            else
+            {
+                i++;
+            }
+        }
+    }
+
+    loom_mutex_unlock(gWaitingLock);
+
+    for (UTsize i = 0; i < released.size(); i++)
+    {
+        loom_jobs_enqueue(released[i]);
+    }
+}
+
+
+static void loom_jobs_execute(const loom_Job& job)
+{
+    job.func(job.param);
+    loom_jobs_finish(job);
+}
+
+
+// Runs a job of index's deque, or stolen from another, or a background one
+// if allowed. Returns whether there was one.
+static bool loom_jobs_runOne(int index, bool background)
+{
+    loom_Job job;
+
+    if (loom_jobs_dequePop(&gDeques[index], false, job))
+    {
+        loom_jobs_execute(job);
+        return true;
+    }
+
+    for (int i = 1; i <= gWorkerCount; i++)
+    {
+        if (loom_jobs_dequePop(&gDeques[(index + i) % (gWorkerCount + 1)], true, job))
+        {
+            loom_jobs_execute(job);
+            return true;
+        }
+    }
+
+    if (background && loom_jobs_dequePop(&gBackgroundJobs, true, job))
+    {
+        loom_jobs_execute(job);
+        return true;
+    }
+
+    return false;
+}
+
+
+static bool loom_jobs_runMainThreadJobs()
+{
+    loom_mutex_lock(gMainLock);
+
+    if (gMainJobs.size() == 0)
+    {
+        loom_mutex_unlock(gMainLock);
+        return false;
+    }
+
+    // Jobs may queue more, those run next time.
+    utArray<loom_Job> jobs;
+    for (UTsize i = 0; i < gMainJobs.size(); i++)
+    {
+        jobs.push_back(gMainJobs[i]);
+    }
+    gMainJobs.clear();
+
+    loom_mutex_unlock(gMainLock);
+
+    for (UTsize i = 0; i < jobs.size(); i++)
+    {
+        loom_jobs_execute(jobs[i]);
+    }
+
+    return true;
+}
+
+
+static int __stdcall loom_jobs_workerMain(void *param)
+{
+    int index = (int)(size_t)param;
+
+    loom_thread_setDebugName("LoomJobs");
+    gWorkerThreadIds[index] = platform_getCurrentThreadId();
+
+    while (atomic_load32(&gRunning))
+    {
+        if (loom_jobs_runOne(index, true))
+        {
+            continue;
+        }
+
+        atomic_increment(&gSleeping);
+
+        if (loom_jobs_hasWork() || !atomic_load32(&gRunning))
+        {
+            atomic_decrement(&gSleeping);
+            continue;
+        }
+
+        loom_semaphore_wait(gWake);
+        atomic_decrement(&gSleeping);
+    }
+
+    return 0;
+}
+
+
+void loom_jobs_initialize(int workerCount)
+{
+    lmAssert(gWorkerCount == 0, "Job system initialized twice");
+
+    if (workerCount < 0)
+    {
+        workerCount = platform_getLogicalThreadCount() - 1;
+    }
+
+    if (workerCount < 1)
+    {
+        workerCount = 1;
+    }
+
+    if (workerCount > LOOM_JOBS_MAX_WORKERS)
+    {
+        workerCount = LOOM_JOBS_MAX_WORKERS;
+    }
+
+    gMainThreadId = platform_getCurrentThreadId();
+    gWaitingLock  = loom_mutex_create();
+    gMainLock     = loom_mutex_create();
+    gWake         = loom_semaphore_create();
+
+    loom_jobs_dequeInit(&gBackgroundJobs);
+    for (int i = 0; i <= workerCount; i++)
+    {
+        loom_jobs_dequeInit(&gDeques[i]);
+        gWorkerThreadIds[i] = 0;
+    }
+
+    gWorkerCount = workerCount;
+    atomic_store32(&gRunning, 1);
+
+    for (int i = 1; i <= workerCount; i++)
+    {
+        gWorkers[i] = loom_thread_startWithHint(loom_jobs_workerMain, (void *)(size_t)i, LOOM_THREAD_THROUGHPUT);
+    }
+
+    lmLogInfo(gJobsLogGroup, "Started %d job workers", workerCount);
+}
+
+
+void loom_jobs_shutdown()
+{
+    if (gWorkerCount == 0)
+    {
+        return;
+    }
+
+    atomic_store32(&gRunning, 0);
+
+    for (int i = 1; i <= gWorkerCount; i++)
+    {
+        loom_semaphore_post(gWake);
+    }
+
+    for (int i = 1; i <= gWorkerCount; i++)
+    {
+        loom_thread_join(gWorkers[i]);
+        gWorkerThreadIds[i] = 0;
+    }
+
+    while (loom_jobs_runOne(0, true) || loom_jobs_runMainThreadJobs())
+    {
+    }
+
+    if (gWaitingJobs.size())
+    {
+        lmLogWarn(gJobsLogGroup, "Dropping %d jobs whose dependencies never finished", (int)gWaitingJobs.size());
+        gWaitingJobs.clear();
+    }
+
+    for (int i = 0; i <= gWorkerCount; i++)
+    {
+        loom_jobs_dequeDestroy(&gDeques[i]);
+    }
+    loom_jobs_dequeDestroy(&gBackgroundJobs);
+
+    loom_semaphore_destroy(gWake);
+    loom_mutex_destroy(gMainLock);
+    loom_mutex_destroy(gWaitingLock);
+
+    gWorkerCount = 0;
+}
+
+
+int loom_jobs_getWorkerCount()
+{
+    return gWorkerCount;
+}
+
+
+int loom_jobs_getThreadIndex()
+{
+    int id = platform_getCurrentThreadId();
+
+    for (int i = 1; i <= gWorkerCount; i++)
+    {
+        if (gWorkerThreadIds[i] == id)
+        {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
+
+void loom_job_submit(JobFunction func, void *param, JobCounter *counter, JobCounter *after, int flags)
+{
+    lmAssert(gWorkerCount > 0, "Job submitted before loom_jobs_initialize");
+
+    loom_Job job;
+
+    job.func    = func;
+    job.param   = param;
+    job.counter = counter;
+    job.after   = after;
+    job.flags   = flags;
+
+    if (counter)
+    {
+        loom_jobs_add(&counter->pending, 1);
+    }
+
+    if (after)
+    {
+        loom_mutex_lock(gWaitingLock);
+
+        if (loom_jobs_readFenced(&after->pending) > 0)
+        {
+            gWaitingJobs.push_back(job);
+            loom_mutex_unlock(gWaitingLock);
+            return;
+        }
+
+        loom_mutex_unlock(gWaitingLock);
+    }
+
+    loom_jobs_enqueue(job);
+}
+
+
+void loom_job_run(JobFunction func, void *param, JobCounter *counter)
+{
+    loom_job_submit(func, param, counter, NULL, 0);
+}
+
+
+void loom_job_runOnMainThread(JobFunction func, void *param, JobCounter *counter)
+{
+    loom_job_submit(func, param, counter, NULL, LOOM_JOB_MAIN_THREAD);
+}
+
+
+int loom_jobs_isDone(JobCounter *counter)
+{
+    return atomic_load32(&counter->pending) == 0;
+}
+
+
+void loom_jobs_wait(JobCounter *counter)
+{
+    int  index      = loom_jobs_getThreadIndex();
+    bool mainThread = platform_getCurrentThreadId() == gMainThreadId;
+
+    while (atomic_load32(&counter->pending) > 0)
+    {
+        if (mainThread && loom_jobs_runMainThreadJobs())
+        {
+            continue;
+        }
+
+        if (loom_jobs_runOne(index, false))
+        {
+            continue;
+        }
+
+        loom_thread_yield();
+    }
+}
+
+
+void loom_jobs_pumpMainThread()
+{
+    if (gWorkerCount == 0)
+    {
+        return;
+    }
+
+    loom_jobs_runMainThreadJobs();
+}
@@ -0,0 +1,109 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _PLATFORM_PLATFORMJOBS_H_
+#define _PLATFORM_PLATFORMJOBS_H_
+
+#include "loom/common/platform/platformThread.h"
+
+/**************************************************************************
+ * Loom Job System
+ *
+ * One pool of worker threads, sized to the logical cores, shared by the
+ * engine's parallel work instead of every subsystem starting its own.
+ *
+ * Each worker has its own deque of jobs. It runs the newest job of its
+ * own, and when out of them steals the oldest of another worker's. Jobs
+ * submitted from other threads are shared by every worker the same way.
+ *
+ * Finished jobs are counted down on a JobCounter, which can be waited on
+ * or made the dependency of further jobs. A thread waiting on a counter
+ * runs jobs itself meanwhile.
+ *
+ * Background jobs are for long or blocking work, such as decoding an
+ * image. They run only on workers, and only when there is nothing else to
+ * run, so waiting threads never pick one up and stall.
+ *
+ * Main thread jobs run in loom_jobs_pumpMainThread, once per tick, for work
+ * that has to be on the main thread, like creating a texture from decoded
+ * bits.
+ *************************************************************************/
+
+#define LOOM_JOBS_MAX_WORKERS    16
+
+enum
+{
+    LOOM_JOB_BACKGROUND  = 1 << 0,
+    LOOM_JOB_MAIN_THREAD = 1 << 1
+};
+
+typedef void (*JobFunction)(void *param);
+
+// Counts the unfinished jobs submitted with it. Zero initialize it, and
+// don't submit more to it while jobs depend on it.
+typedef struct
+{
+    volatile atomic_int_t pending;
+} JobCounter;
+
+/**
+ * Starts workerCount workers, or one less than the logical threads if it's
+ * negative, at least one. Call from the main thread before submitting.
+ */
+void loom_jobs_initialize(int workerCount);
+
+/**
+ * Runs the jobs still queued and stops the workers. Jobs still waiting for
+ * their dependencies are dropped.
+ */
+void loom_jobs_shutdown();
+
+int loom_jobs_getWorkerCount();
+
+/**
+ * 1 to the worker count on a worker, 0 on any other thread, to index state
+ * kept per thread.
+ */
+int loom_jobs_getThreadIndex();
+
+/**
+ * Queues func(param). counter, if any, is counted up now and down once the
+ * job finished. The job runs once after has counted down to zero, if given.
+ * flags are the LOOM_JOB_ ones.
+ */
+void loom_job_submit(JobFunction func, void *param, JobCounter *counter, JobCounter *after, int flags);
+
+void loom_job_run(JobFunction func, void *param, JobCounter *counter);
+void loom_job_runOnMainThread(JobFunction func, void *param, JobCounter *counter);
+
+int loom_jobs_isDone(JobCounter *counter);
+
+/**
+ * Runs jobs until counter has counted down to zero. On the main thread this
+ * includes main thread jobs.
+ */
+void loom_jobs_wait(JobCounter *counter);
+
+/**
+ * Runs the main thread jobs queued so far, call it from the main thread.
+ */
+void loom_jobs_pumpMainThread();
+
+#endif
@@ -0,0 +1,199 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <string.h>
+#include "seatest.h"
+#include "loom/common/platform/platformJobs.h"
+
+SEATEST_FIXTURE(platformJobs)
+{
+    SEATEST_FIXTURE_ENTRY(platformJobs_runAndWait);
+    SEATEST_FIXTURE_ENTRY(platformJobs_nested);
+    SEATEST_FIXTURE_ENTRY(platformJobs_dependencies);
+    SEATEST_FIXTURE_ENTRY(platformJobs_mainThread);
+}
+
+static const int JOB_COUNT = 2000;
+
+static volatile atomic_int_t gJobTestCount = 0;
+static volatile atomic_int_t gJobTestStage = 0;
+static int                   gJobTestSawStage[JOB_COUNT];
+static int                   gJobTestThreadIds[JOB_COUNT];
+static JobCounter            gJobTestCounter;
+
+// Tests use the engine's workers when it's running, else their own.
+static bool gJobTestOwnWorkers = false;
+
+static void startJobs(int workerCount)
+{
+    gJobTestOwnWorkers = loom_jobs_getWorkerCount() == 0;
+    if (gJobTestOwnWorkers)
+    {
+        loom_jobs_initialize(workerCount);
+    }
+}
+
+
+static void stopJobs()
+{
+    if (gJobTestOwnWorkers)
+    {
+        loom_jobs_shutdown();
+    }
+}
+
+
+static void countJob(void *param)
+{
+    atomic_increment(&gJobTestCount);
+}
+
+
+static void spawnJob(void *param)
+{
+    // Children count towards their parent's counter, which can't reach
+    // zero before they were submitted.
+    for (int i = 0; i < 10; i++)
+    {
+        loom_job_run(countJob, NULL, &gJobTestCounter);
+    }
+}
+
+
+static void stageJob(void *param)
+{
+    gJobTestSawStage[(size_t)param] = atomic_load32(&gJobTestStage);
+}
+
+
+static void firstStageJob(void *param)
+{
+    loom_thread_sleep(1);
+    atomic_increment(&gJobTestStage);
+}
+
+
+static void mainThreadJob(void *param)
+{
+    gJobTestThreadIds[(size_t)param] = platform_getCurrentThreadId();
+}
+
+
+static void postToMainThreadJob(void *param)
+{
+    loom_job_runOnMainThread(mainThreadJob, param, &gJobTestCounter);
+}
+
+
+SEATEST_TEST(platformJobs_runAndWait)
+{
+    startJobs(4);
+    assert_true(loom_jobs_getWorkerCount() > 0);
+    assert_int_equal(0, loom_jobs_getThreadIndex());
+
+    memset(&gJobTestCounter, 0, sizeof(gJobTestCounter));
+    gJobTestCount = 0;
+
+    for (int i = 0; i < JOB_COUNT; i++)
+    {
+        loom_job_submit(countJob, NULL, &gJobTestCounter, NULL, i % 4 == 0 ? LOOM_JOB_BACKGROUND : 0);
+    }
+
+    loom_jobs_wait(&gJobTestCounter);
+    assert_true(loom_jobs_isDone(&gJobTestCounter));
+    assert_int_equal(JOB_COUNT, atomic_load32(&gJobTestCount));
+
+    stopJobs();
+}
+
+
+SEATEST_TEST(platformJobs_nested)
+{
+    startJobs(4);
+
+    memset(&gJobTestCounter, 0, sizeof(gJobTestCounter));
+    gJobTestCount = 0;
+
+    for (int i = 0; i < JOB_COUNT / 10; i++)
+    {
+        loom_job_run(spawnJob, NULL, &gJobTestCounter);
+    }
+
+    loom_jobs_wait(&gJobTestCounter);
+    assert_int_equal(JOB_COUNT, atomic_load32(&gJobTestCount));
+
+    stopJobs();
+}
+
+
+SEATEST_TEST(platformJobs_dependencies)
+{
+    startJobs(4);
+
+    JobCounter first;
+    memset(&first, 0, sizeof(first));
+    memset(&gJobTestCounter, 0, sizeof(gJobTestCounter));
+    gJobTestStage = 0;
+
+    for (int i = 0; i < 8; i++)
+    {
+        loom_job_run(firstStageJob, NULL, &first);
+    }
+
+    for (int i = 0; i < 64; i++)
+    {
+        gJobTestSawStage[i] = -1;
+        loom_job_submit(stageJob, (void *)(size_t)i, &gJobTestCounter, &first, 0);
+    }
+
+    loom_jobs_wait(&gJobTestCounter);
+    assert_true(loom_jobs_isDone(&first));
+
+    for (int i = 0; i < 64; i++)
+    {
+        assert_int_equal(8, gJobTestSawStage[i]);
+    }
+
+    stopJobs();
+}
+
+
+SEATEST_TEST(platformJobs_mainThread)
+{
+    startJobs(2);
+
+    memset(&gJobTestCounter, 0, sizeof(gJobTestCounter));
+
+    for (int i = 0; i < 16; i++)
+    {
+        gJobTestThreadIds[i] = 0;
+        loom_job_run(postToMainThreadJob, (void *)(size_t)i, &gJobTestCounter);
+    }
+
+    // Waiting on the main thread runs the main thread jobs as well.
+    loom_jobs_wait(&gJobTestCounter);
+
+    for (int i = 0; i < 16; i++)
+    {
+        assert_int_equal(platform_getCurrentThreadId(), gJobTestThreadIds[i]);
+    }
+
+    stopJobs();
+}
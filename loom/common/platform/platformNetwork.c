@@ -23,6 +23,7 @@
 #include "loom/common/platform/platformNetwork.h"
 #include "loom/common/core/log.h"
 #include "loom/common/core/assert.h"
+#include "loom/common/core/allocator.h"
 
 #include <stdio.h>
 
@@ -45,9 +46,22 @@
 typedef int   SOCKET;
 #endif
 
+#if LOOM_PLATFORM_IS_APPLE == 1 || LOOM_PLATFORM == LOOM_PLATFORM_ANDROID || LOOM_PLATFORM == LOOM_PLATFORM_LINUX
+#include <poll.h>
+#define WSAPoll        poll
+typedef struct pollfd   WSAPOLLFD;
+#endif
+
 #if LOOM_PLATFORM == LOOM_PLATFORM_ANDROID || LOOM_PLATFORM == LOOM_PLATFORM_LINUX
 #include "netinet/in.h"
 #include <sys/ioctl.h>
+#include <sys/epoll.h>
+#define LOOM_NET_EPOLL    1
+#endif
+
+#if LOOM_PLATFORM_IS_APPLE == 1
+#include <sys/event.h>
+#define LOOM_NET_KQUEUE    1
 #endif
 
 #if LOOM_PLATFORM == LOOM_PLATFORM_LINUX
@@ -98,8 +112,12 @@ int loom_net_initialize()
 }
 
 
+static void loom_net_releaseWatches();
+
 void loom_net_shutdown()
 {
+    loom_net_releaseWatches();
+
 #if LOOM_PLATFORM == LOOM_PLATFORM_WIN32
     WSACleanup();
 #endif
@@ -238,30 +256,43 @@ void loom_net_getSocketPeerName(loom_socketId_t s, int *hostIp, int *hostPort)
 }
 
 
-int loom_net_isSocketWritable(loom_socketId_t s)
+int loom_net_waitSocket(loom_socketId_t s, int events, int timeoutMs)
 {
-    int    readsocks;
-    fd_set waitSockets;
+    WSAPOLLFD pollSocket;
+    int       ready = 0;
 
-    struct timeval timeout;
+    pollSocket.fd      = (SOCKET)(size_t)s;
+    pollSocket.events  = ((events & LOOM_NET_READABLE) ? POLLIN : 0) | ((events & LOOM_NET_WRITABLE) ? POLLOUT : 0);
+    pollSocket.revents = 0;
 
-    timeout.tv_sec  = 0;
-    timeout.tv_usec = 1;
+    // Unlike select() this works for any descriptor, however high.
+    if (WSAPoll(&pollSocket, 1, timeoutMs) <= 0)
+    {
+        return 0;
+    }
 
-    // Set up sets for select().
-    FD_ZERO(&waitSockets);
-    FD_SET((int)(size_t)s, &waitSockets);
+    if (pollSocket.revents & POLLIN)
+    {
+        ready |= LOOM_NET_READABLE;
+    }
 
-    // Run the select with a very short wait period.
-    readsocks = select(FD_SETSIZE, NULL, &waitSockets, NULL, &timeout);
-    if (readsocks > 0)
+    if (pollSocket.revents & POLLOUT)
     {
-        // Cool, something happened, so we are by process of elimination writable.
-        return 1;
+        ready |= LOOM_NET_WRITABLE;
+    }
+
+    if (pollSocket.revents & (POLLHUP | POLLERR | POLLNVAL))
+    {
+        ready |= LOOM_NET_HANGUP;
     }
 
-    // Nothing happened, so return 0.
-    return 0;
+    return ready;
+}
+
+
+int loom_net_isSocketWritable(loom_socketId_t s)
+{
+    return (loom_net_waitSocket(s, LOOM_NET_WRITABLE, 0) & LOOM_NET_WRITABLE) != 0;
 }
 
 
@@ -401,9 +432,8 @@ void loom_net_readTCPSocket(loom_socketId_t s, void *buffer, int *bytesToRead, i
 #endif
             if (waiting)
             {
-                // TODO figure out a better way to do this?
-                //lmLogDebug(netLogGroup, "Waiting for receive buffer %d / %d", *bytesToRead - bytesLeft, *bytesToRead);
-                loom_thread_sleep(5);
+                // Returns as soon as more arrived rather than sleeping it out.
+                loom_net_waitSocket(s, LOOM_NET_READABLE, 5);
                 continue;
             }
             else
@@ -465,14 +495,392 @@ int loom_net_writeTCPSocket(loom_socketId_t s, void *buffer, int bytesToWrite)
             break;
         }
 
-        loom_thread_sleep(5);
+        loom_net_waitSocket(s, LOOM_NET_WRITABLE, 5);
     }
 
     return -1;
 }
 
 
+static int loom_net_wouldBlock()
+{
+#if LOOM_PLATFORM == LOOM_PLATFORM_WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+#endif
+}
+
+
+int loom_net_sendSomeTCPSocket(loom_socketId_t s, const void *buffer, int length)
+{
+    int result = send((SOCKET)(size_t)s, buffer, length, MSG_NOSIGNAL);
+
+    if (result >= 0)
+    {
+        return result;
+    }
+
+    return loom_net_wouldBlock() ? 0 : -1;
+}
+
+
+int loom_net_recvSomeTCPSocket(loom_socketId_t s, void *buffer, int length)
+{
+    int result = recv((SOCKET)(size_t)s, buffer, length, 0);
+
+    // Nothing read from a readable socket means it closed.
+    if (result > 0)
+    {
+        return result;
+    }
+
+    if (result == 0)
+    {
+        return length == 0 ? 0 : -1;
+    }
+
+    return loom_net_wouldBlock() ? 0 : -1;
+}
+
+
 void loom_net_closeTCPSocket(loom_socketId_t s)
 {
     closesocket((SOCKET)(size_t)s);
 }
+
+
+/**************************************************************************
+ * Socket watching
+ *
+ * Watches are kept in a list, and freed only once no poll is dispatching
+ * as callbacks may unwatch sockets whose events are still to come.
+ *************************************************************************/
+
+typedef struct loom_net_watch
+{
+    loom_socketId_t        socket;
+    int                    events;
+    loom_net_readyCallback callback;
+    void                   *payload;
+    int                    removed;
+    struct loom_net_watch  *next;
+} loom_net_watch;
+
+static loom_net_watch *gWatches     = NULL;
+static int            gWatchCount   = 0;
+static int            gPollDepth    = 0;
+static int            gWatchRemoved = 0;
+
+#if LOOM_NET_EPOLL || LOOM_NET_KQUEUE
+static int gPollQueue = -1;
+
+#define LOOM_NET_POLL_BATCH    64
+#else
+static WSAPOLLFD      *gPollSockets       = NULL;
+static loom_net_watch **gPollWatches      = NULL;
+static int            gPollSocketCapacity = 0;
+#endif
+
+static loom_net_watch *loom_net_findWatch(loom_socketId_t s)
+{
+    loom_net_watch *w;
+
+    for (w = gWatches; w != NULL; w = w->next)
+    {
+        if ((w->socket == s) && !w->removed)
+        {
+            return w;
+        }
+    }
+
+    return NULL;
+}
+
+
+static void loom_net_freeRemovedWatches()
+{
+    loom_net_watch **link = &gWatches;
+
+    if (!gWatchRemoved || (gPollDepth > 0))
+    {
+        return;
+    }
+
+    while (*link != NULL)
+    {
+        loom_net_watch *w = *link;
+
+        if (w->removed)
+        {
+            *link = w->next;
+            lmFree(NULL, w);
+        }
+        else
+        {
+            link = &w->next;
+        }
+    }
+
+    gWatchRemoved = 0;
+}
+
+
+// Tells the OS what w waits for now, previously was.
+static int loom_net_updateWatch(loom_net_watch *w, int previous)
+{
+#if LOOM_NET_EPOLL
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events   = ((w->events & LOOM_NET_READABLE) ? EPOLLIN : 0) | ((w->events & LOOM_NET_WRITABLE) ? EPOLLOUT : 0);
+    ev.data.ptr = w;
+
+    if (w->removed)
+    {
+        // Older kernels want an event even to delete.
+        return epoll_ctl(gPollQueue, EPOLL_CTL_DEL, (int)(size_t)w->socket, &ev) == 0;
+    }
+
+    return epoll_ctl(gPollQueue, previous < 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, (int)(size_t)w->socket, &ev) == 0;
+
+#elif LOOM_NET_KQUEUE
+    struct kevent changes[2];
+    int           changeCount = 0;
+    int           now         = w->removed ? 0 : w->events;
+    int           before      = previous < 0 ? 0 : previous;
+
+    if ((now ^ before) & LOOM_NET_READABLE)
+    {
+        EV_SET(&changes[changeCount++], (int)(size_t)w->socket, EVFILT_READ, (now & LOOM_NET_READABLE) ? EV_ADD : EV_DELETE, 0, 0, w);
+    }
+
+    if ((now ^ before) & LOOM_NET_WRITABLE)
+    {
+        EV_SET(&changes[changeCount++], (int)(size_t)w->socket, EVFILT_WRITE, (now & LOOM_NET_WRITABLE) ? EV_ADD : EV_DELETE, 0, 0, w);
+    }
+
+    return (changeCount == 0) || (kevent(gPollQueue, changes, changeCount, NULL, 0, NULL) == 0);
+
+#else
+    // The poll set is built from the list each time.
+    return 1;
+#endif
+}
+
+
+int loom_net_watchSocket(loom_socketId_t s, int events, loom_net_readyCallback callback, void *payload)
+{
+    loom_net_watch *w = loom_net_findWatch(s);
+    int            previous;
+
+    lmAssert(callback != NULL, "Watching a socket needs a callback");
+
+#if LOOM_NET_EPOLL || LOOM_NET_KQUEUE
+    if (gPollQueue == -1)
+    {
+#if LOOM_NET_EPOLL
+        gPollQueue = epoll_create(LOOM_NET_POLL_BATCH);
+#else
+        gPollQueue = kqueue();
+#endif
+        if (gPollQueue == -1)
+        {
+            lmLogError(netLogGroup, "Could not create the socket poll queue (%d)", errno);
+            return 0;
+        }
+    }
+#endif
+
+    if (w == NULL)
+    {
+        w = (loom_net_watch *)lmAlloc(NULL, sizeof(loom_net_watch));
+        memset(w, 0, sizeof(loom_net_watch));
+        w->socket = s;
+        w->next   = gWatches;
+        gWatches  = w;
+        gWatchCount++;
+        previous = -1;
+    }
+    else
+    {
+        previous = w->events;
+    }
+
+    w->events   = events & (LOOM_NET_READABLE | LOOM_NET_WRITABLE);
+    w->callback = callback;
+    w->payload  = payload;
+
+    if (!loom_net_updateWatch(w, previous))
+    {
+        lmLogError(netLogGroup, "Could not watch socket %x (%d)", s, errno);
+        loom_net_unwatchSocket(s);
+        return 0;
+    }
+
+    return 1;
+}
+
+
+void loom_net_unwatchSocket(loom_socketId_t s)
+{
+    loom_net_watch *w = loom_net_findWatch(s);
+
+    if (w == NULL)
+    {
+        return;
+    }
+
+    w->removed = 1;
+    loom_net_updateWatch(w, w->events);
+
+    gWatchCount--;
+    gWatchRemoved = 1;
+    loom_net_freeRemovedWatches();
+}
+
+
+static void loom_net_dispatchWatch(loom_net_watch *w, int ready)
+{
+    // Unwatched by an earlier callback of this poll.
+    if (w->removed)
+    {
+        return;
+    }
+
+    ready &= w->events | LOOM_NET_HANGUP;
+    if (ready)
+    {
+        w->callback(w->socket, ready, w->payload);
+    }
+}
+
+
+int loom_net_pollSockets(int timeoutMs)
+{
+    int readyCount, i;
+
+    if (gWatchCount == 0)
+    {
+        return 0;
+    }
+
+    gPollDepth++;
+
+#if LOOM_NET_EPOLL
+    {
+        struct epoll_event ready[LOOM_NET_POLL_BATCH];
+
+        readyCount = epoll_wait(gPollQueue, ready, LOOM_NET_POLL_BATCH, timeoutMs);
+
+        for (i = 0; i < readyCount; i++)
+        {
+            int events = ((ready[i].events & EPOLLIN) ? LOOM_NET_READABLE : 0) |
+                         ((ready[i].events & EPOLLOUT) ? LOOM_NET_WRITABLE : 0) |
+                         ((ready[i].events & (EPOLLHUP | EPOLLERR)) ? LOOM_NET_HANGUP : 0);
+
+            loom_net_dispatchWatch((loom_net_watch *)ready[i].data.ptr, events);
+        }
+    }
+
+#elif LOOM_NET_KQUEUE
+    {
+        struct kevent   ready[LOOM_NET_POLL_BATCH];
+        struct timespec timeout;
+
+        timeout.tv_sec  = timeoutMs / 1000;
+        timeout.tv_nsec = (timeoutMs % 1000) * 1000000;
+
+        readyCount = kevent(gPollQueue, NULL, 0, ready, LOOM_NET_POLL_BATCH, timeoutMs < 0 ? NULL : &timeout);
+
+        // Reading and writing come as separate events.
+        for (i = 0; i < readyCount; i++)
+        {
+            int events = (ready[i].filter == EVFILT_READ ? LOOM_NET_READABLE : LOOM_NET_WRITABLE) |
+                         ((ready[i].flags & (EV_EOF | EV_ERROR)) ? LOOM_NET_HANGUP : 0);
+
+            loom_net_dispatchWatch((loom_net_watch *)ready[i].udata, events);
+        }
+    }
+
+#else
+    {
+        loom_net_watch *w;
+        int            count = 0;
+
+        if (gPollSocketCapacity < gWatchCount)
+        {
+            gPollSocketCapacity = gWatchCount * 2;
+            gPollSockets        = (WSAPOLLFD *)lmRealloc(NULL, gPollSockets, gPollSocketCapacity * sizeof(WSAPOLLFD));
+            gPollWatches        = (loom_net_watch **)lmRealloc(NULL, gPollWatches, gPollSocketCapacity * sizeof(loom_net_watch *));
+        }
+
+        for (w = gWatches; w != NULL; w = w->next)
+        {
+            if (w->removed)
+            {
+                continue;
+            }
+
+            gPollSockets[count].fd      = (SOCKET)(size_t)w->socket;
+            gPollSockets[count].events  = ((w->events & LOOM_NET_READABLE) ? POLLRDNORM : 0) | ((w->events & LOOM_NET_WRITABLE) ? POLLWRNORM : 0);
+            gPollSockets[count].revents = 0;
+            gPollWatches[count]         = w;
+            count++;
+        }
+
+        readyCount = WSAPoll(gPollSockets, count, timeoutMs);
+
+        for (i = 0; i < count && readyCount > 0; i++)
+        {
+            short revents = gPollSockets[i].revents;
+            int   events  = ((revents & POLLRDNORM) ? LOOM_NET_READABLE : 0) |
+                            ((revents & POLLWRNORM) ? LOOM_NET_WRITABLE : 0) |
+                            ((revents & (POLLHUP | POLLERR | POLLNVAL)) ? LOOM_NET_HANGUP : 0);
+
+            if (events)
+            {
+                loom_net_dispatchWatch(gPollWatches[i], events);
+            }
+        }
+    }
+#endif
+
+    gPollDepth--;
+    loom_net_freeRemovedWatches();
+
+    return readyCount > 0 ? readyCount : 0;
+}
+
+
+static void loom_net_releaseWatches()
+{
+    loom_net_watch *w;
+
+    for (w = gWatches; w != NULL; w = w->next)
+    {
+        w->removed = 1;
+    }
+
+    gWatchCount   = 0;
+    gWatchRemoved = 1;
+    loom_net_freeRemovedWatches();
+
+#if LOOM_NET_EPOLL || LOOM_NET_KQUEUE
+    if (gPollQueue != -1)
+    {
+        close(gPollQueue);
+        gPollQueue = -1;
+    }
+#else
+    if (gPollSockets != NULL)
+    {
+        lmFree(NULL, gPollSockets);
+        lmFree(NULL, gPollWatches);
+    }
+
+    gPollSockets        = NULL;
+    gPollWatches        = NULL;
+    gPollSocketCapacity = 0;
+#endif
+}
@@ -40,12 +40,43 @@ void loom_net_enableSocketKeepalive(loom_socketId_t s);
 void loom_net_readTCPSocket(loom_socketId_t s, void *buffer, int *bytesToRead, int peek);
 int loom_net_writeTCPSocket(loom_socketId_t s, void *buffer, int bytesToWrite);
 
+// Send or receive what they can right away on a nonblocking socket. Return
+// the bytes moved, 0 when it would block, -1 once closed or failed.
+int loom_net_sendSomeTCPSocket(loom_socketId_t s, const void *buffer, int length);
+int loom_net_recvSomeTCPSocket(loom_socketId_t s, void *buffer, int length);
+
 void loom_net_getSocketPeerName(loom_socketId_t s, int *hostIp, int *hostPort);
 int loom_net_isSocketWritable(loom_socketId_t s);
 int loom_net_isSocketDead(loom_socketId_t s);
 
 void loom_net_closeTCPSocket(loom_socketId_t s);
 
+// Readiness of sockets, for watching many of them at once instead of
+// polling each. Uses epoll on Linux and Android, kqueue on Apple platforms
+// and WSAPoll on Windows.
+enum
+{
+    LOOM_NET_READABLE = 1 << 0,
+    LOOM_NET_WRITABLE = 1 << 1,
+    LOOM_NET_HANGUP   = 1 << 2  // always reported, closed or errored
+};
+
+typedef void (*loom_net_readyCallback)(loom_socketId_t s, int events, void *payload);
+
+// Calls callback from loom_net_pollSockets as long as s is ready for any of
+// events. Watching it again replaces the events and callback. Unwatch a
+// socket before closing it. Returns 0 on failure.
+int loom_net_watchSocket(loom_socketId_t s, int events, loom_net_readyCallback callback, void *payload);
+void loom_net_unwatchSocket(loom_socketId_t s);
+
+// Waits up to timeoutMs for watched sockets to be ready and calls them
+// back, returning how many were. The engine calls it every tick on the
+// main thread without waiting. Callbacks may watch and unwatch sockets.
+int loom_net_pollSockets(int timeoutMs);
+
+// Waits up to timeoutMs for s alone, returns the events it's ready for.
+int loom_net_waitSocket(loom_socketId_t s, int events, int timeoutMs);
+
 #ifdef __cplusplus
 };
 #endif
@@ -26,6 +26,7 @@ SEATEST_FIXTURE(platformNetwork)
 {
     SEATEST_FIXTURE_ENTRY(platformNetwork_googlePing);
     SEATEST_FIXTURE_ENTRY(platformNetwork_socketListen);
+    SEATEST_FIXTURE_ENTRY(platformNetwork_watchSockets);
 }
 
 SEATEST_TEST(platformNetwork_googlePing)
@@ -85,3 +86,74 @@ SEATEST_TEST(platformNetwork_socketListen)
 
     loom_net_shutdown();
 }
+
+static int gWatchEvents[2];
+
+static void watchCallback(loom_socketId_t s, int events, void *payload)
+{
+    gWatchEvents[(size_t)payload] |= events;
+}
+
+
+static void unwatchingCallback(loom_socketId_t s, int events, void *payload)
+{
+    gWatchEvents[(size_t)payload] |= events;
+
+    // Unwatching from a callback, others of the same poll still come.
+    loom_net_unwatchSocket(s);
+}
+
+
+// Polls until index saw some of events, or about a second passed.
+static int pollForEvents(int index, int events)
+{
+    for (int i = 0; i < 100 && !(gWatchEvents[index] & events); i++)
+    {
+        loom_net_pollSockets(10);
+    }
+
+    return gWatchEvents[index] & events;
+}
+
+
+SEATEST_TEST(platformNetwork_watchSockets)
+{
+    loom_net_initialize();
+
+    gWatchEvents[0] = gWatchEvents[1] = 0;
+
+    loom_socketId_t serverSocket = loom_net_listenTCPSocket(12341);
+    assert_true(loom_net_watchSocket(serverSocket, LOOM_NET_READABLE, watchCallback, (void *)0));
+
+    // Nothing happened yet.
+    assert_int_equal(0, loom_net_pollSockets(0));
+
+    // A connection waiting makes the listening socket readable.
+    loom_socketId_t connectSocket = loom_net_openTCPSocket("localhost", 12341, 1);
+    assert_true(pollForEvents(0, LOOM_NET_READABLE) != 0);
+
+    loom_socketId_t acceptedSocket = loom_net_acceptTCPSocket(serverSocket);
+    loom_net_unwatchSocket(serverSocket);
+
+    assert_true(loom_net_watchSocket(acceptedSocket, LOOM_NET_READABLE | LOOM_NET_WRITABLE, unwatchingCallback, (void *)1));
+    assert_true(pollForEvents(1, LOOM_NET_WRITABLE) != 0);
+
+    // It unwatched itself.
+    gWatchEvents[1] = 0;
+    char message[] = "ping";
+    loom_net_writeTCPSocket(connectSocket, message, sizeof(message));
+    assert_int_equal(0, pollForEvents(1, LOOM_NET_READABLE));
+
+    // Watching again reports the data waiting.
+    assert_true(loom_net_watchSocket(acceptedSocket, LOOM_NET_READABLE, watchCallback, (void *)1));
+    assert_true(pollForEvents(1, LOOM_NET_READABLE) != 0);
+    assert_true((gWatchEvents[1] & LOOM_NET_WRITABLE) == 0);
+    assert_true(loom_net_waitSocket(acceptedSocket, LOOM_NET_READABLE, 0) & LOOM_NET_READABLE);
+
+    loom_net_unwatchSocket(acceptedSocket);
+    loom_net_closeTCPSocket(serverSocket);
+    loom_net_closeTCPSocket(connectSocket);
+    loom_net_closeTCPSocket(acceptedSocket);
+
+    loom_net_shutdown();
+}
@@ -21,6 +21,7 @@
 #define _GNU_SOURCE
 
 #include "loom/common/platform/platformThread.h"
+#include "loom/common/platform/platformAtomic.h"
 #include "loom/common/platform/platform.h"
 #include "loom/common/core/assert.h"
 #include "loom/common/core/allocator.h"
@@ -238,6 +239,17 @@ int atomic_compareAndExchange(volatile int *value, int expected, int newVal)
 }
 
 
+void *atomic_compareAndExchangePointer(void *volatile *value, void *expected, void *newVal)
+{
+#if LOOM_COMPILER == LOOM_COMPILER_MSVC
+    return InterlockedCompareExchangePointer(value, newVal, expected);
+
+#else
+    return __sync_val_compare_and_swap(value, expected, newVal);
+#endif
+}
+
+
 int atomic_increment(volatile int *value)
 {
     assert(value);
@@ -246,7 +258,7 @@ int atomic_increment(volatile int *value)
     return _InterlockedIncrement(value);
 
 #else
-    return __sync_sub_and_fetch(value, 1);
+    return __sync_add_and_fetch(value, 1);
 #endif
 }
 
@@ -306,6 +318,41 @@ void atomic_store32(volatile int *variable, int newValue)
 }
 
 
+// Parked threads wait on the condition of their address' bucket, there
+// being no futex before Windows 8. Zeroed SRW locks and conditions are
+// initialized ones.
+#define LOOM_PARKING_BUCKETS    64
+
+static struct
+{
+    SRWLOCK            lock;
+    CONDITION_VARIABLE wake;
+} gParkingLot[LOOM_PARKING_BUCKETS];
+
+void loom_thread_park(volatile atomic_int_t *address, int expected)
+{
+    int bucket = (int)(((size_t)address >> 4) % LOOM_PARKING_BUCKETS);
+
+    AcquireSRWLockExclusive(&gParkingLot[bucket].lock);
+    if (*address == expected)
+    {
+        SleepConditionVariableSRW(&gParkingLot[bucket].wake, &gParkingLot[bucket].lock, INFINITE, 0);
+    }
+    ReleaseSRWLockExclusive(&gParkingLot[bucket].lock);
+}
+
+
+void loom_thread_unpark(volatile atomic_int_t *address, int all)
+{
+    int bucket = (int)(((size_t)address >> 4) % LOOM_PARKING_BUCKETS);
+
+    // Other addresses share the bucket, so wake them all to recheck.
+    AcquireSRWLockExclusive(&gParkingLot[bucket].lock);
+    WakeAllConditionVariable(&gParkingLot[bucket].wake);
+    ReleaseSRWLockExclusive(&gParkingLot[bucket].lock);
+}
+
+
 //
 // Usage: SetThreadName (-1, "MainThread");
 // From: http://msdn.microsoft.com/en-us/library/xcb2z8hs%28v=VS.71%29.aspx
@@ -342,6 +389,33 @@ void loom_thread_setDebugName(const char *name)
 }
 
 
+// Windows picks efficiency cores by priority itself, so only that is set.
+void loom_thread_setHint(loom_threadHint hint)
+{
+    int priority;
+
+    switch (hint)
+    {
+    case LOOM_THREAD_LATENCY_CRITICAL:
+        priority = THREAD_PRIORITY_HIGHEST;
+        break;
+
+    case LOOM_THREAD_THROUGHPUT:
+        priority = THREAD_PRIORITY_NORMAL;
+        break;
+
+    case LOOM_THREAD_BACKGROUND:
+        priority = THREAD_PRIORITY_BELOW_NORMAL;
+        break;
+
+    default:
+        return;
+    }
+
+    SetThreadPriority(GetCurrentThread(), priority);
+}
+
+
 #elif LOOM_PLATFORM_IS_APPLE
 
 #include <assert.h>
@@ -363,6 +437,7 @@ void loom_thread_setDebugName(const char *name)
 #include <sys/sem.h>
 #include <sys/file.h>
 #include <pthread.h>
+#include <pthread/qos.h>
 #include <errno.h>
 
 #include <sched.h>
@@ -384,6 +459,58 @@ int loom_process_ensureOnlyOneInstance()
 }
 
 
+// Parked threads wait on the condition of their address' bucket, as
+// there's no public futex.
+#define LOOM_PARKING_BUCKETS    64
+
+static struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;
+} gParkingLot[LOOM_PARKING_BUCKETS];
+
+static pthread_once_t gParkingLotOnce = PTHREAD_ONCE_INIT;
+
+static void loom_thread_initParkingLot()
+{
+    int i;
+
+    for (i = 0; i < LOOM_PARKING_BUCKETS; i++)
+    {
+        pthread_mutex_init(&gParkingLot[i].lock, NULL);
+        pthread_cond_init(&gParkingLot[i].wake, NULL);
+    }
+}
+
+
+void loom_thread_park(volatile atomic_int_t *address, int expected)
+{
+    int bucket = (int)(((size_t)address >> 4) % LOOM_PARKING_BUCKETS);
+
+    pthread_once(&gParkingLotOnce, loom_thread_initParkingLot);
+
+    pthread_mutex_lock(&gParkingLot[bucket].lock);
+    if (*address == expected)
+    {
+        pthread_cond_wait(&gParkingLot[bucket].wake, &gParkingLot[bucket].lock);
+    }
+    pthread_mutex_unlock(&gParkingLot[bucket].lock);
+}
+
+
+void loom_thread_unpark(volatile atomic_int_t *address, int all)
+{
+    int bucket = (int)(((size_t)address >> 4) % LOOM_PARKING_BUCKETS);
+
+    pthread_once(&gParkingLotOnce, loom_thread_initParkingLot);
+
+    // Other addresses share the bucket, so wake them all to recheck.
+    pthread_mutex_lock(&gParkingLot[bucket].lock);
+    pthread_cond_broadcast(&gParkingLot[bucket].wake);
+    pthread_mutex_unlock(&gParkingLot[bucket].lock);
+}
+
+
 int platform_getLogicalThreadCount()
 {
     int    mib[4], numCPU;
@@ -551,6 +678,12 @@ int atomic_compareAndExchange(volatile int *value, int expected, int newVal)
 }
 
 
+void *atomic_compareAndExchangePointer(void *volatile *value, void *expected, void *newVal)
+{
+    return __sync_val_compare_and_swap(value, expected, newVal);
+}
+
+
 int atomic_increment(volatile int *value)
 {
     return OSAtomicAdd32(1, value);
@@ -601,6 +734,34 @@ void loom_thread_setDebugName(const char *name)
 }
 
 
+// The quality of service class decides both priority and which cores the
+// thread runs on.
+void loom_thread_setHint(loom_threadHint hint)
+{
+    qos_class_t qos;
+
+    switch (hint)
+    {
+    case LOOM_THREAD_LATENCY_CRITICAL:
+        qos = QOS_CLASS_USER_INTERACTIVE;
+        break;
+
+    case LOOM_THREAD_THROUGHPUT:
+        qos = QOS_CLASS_USER_INITIATED;
+        break;
+
+    case LOOM_THREAD_BACKGROUND:
+        qos = QOS_CLASS_UTILITY;
+        break;
+
+    default:
+        return;
+    }
+
+    pthread_set_qos_class_self_np(qos, 0);
+}
+
+
 #elif LOOM_PLATFORM == LOOM_PLATFORM_ANDROID || LOOM_PLATFORM == LOOM_PLATFORM_LINUX
 
 #include <assert.h>
@@ -620,6 +781,28 @@ void loom_thread_setDebugName(const char *name)
 #include <sys/atomics.h>
 #endif
 
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+
+#ifndef FUTEX_WAIT_PRIVATE
+#define FUTEX_WAIT_PRIVATE    FUTEX_WAIT
+#define FUTEX_WAKE_PRIVATE    FUTEX_WAKE
+#endif
+
+void loom_thread_park(volatile atomic_int_t *address, int expected)
+{
+    syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+
+void loom_thread_unpark(volatile atomic_int_t *address, int all)
+{
+    syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, all ? INT_MAX : 1, NULL, NULL, 0);
+}
+
+
 #if LOOM_PLATFORM == LOOM_PLATFORM_LINUX
 
 #include "sys/file.h"
@@ -650,12 +833,12 @@ int loom_process_ensureOnlyOneInstance()
 
 int platform_getLogicalThreadCount()
 {
-    // FIXME:  On my Droid2, get a value of 1 on the sysconf call below
-    // Loom currently refuses to run on 1 thread it appears (at least under Android)
-    return 2;
-
     // Cribbed from: http://stackoverflow.com/questions/7962155
-    //return sysconf(_SC_NPROCESSORS_CONF);
+    long count = sysconf(_SC_NPROCESSORS_CONF);
+
+    // Some devices, like the Droid2, report 1 and Loom refuses to run on a
+    // single thread (at least under Android).
+    return count < 2 ? 2 : (int)count;
 }
 
 
@@ -846,10 +1029,18 @@ int atomic_compareAndExchange(volatile int *value, int expected, int newVal)
 }
 
 
+void *atomic_compareAndExchangePointer(void *volatile *value, void *expected, void *newVal)
+{
+    // The GCC builtin is available on both, unlike the bionic int helpers
+    // it returns the previous value.
+    return __sync_val_compare_and_swap(value, expected, newVal);
+}
+
+
 int atomic_increment(volatile int *value)
 {
 #if LOOM_PLATFORM == LOOM_PLATFORM_LINUX
-    return __sync_fetch_and_add(value, 1);
+    return __sync_add_and_fetch(value, 1);
 
 #else
     // NOTE: Android's implementation of these functions is atypical in that it returns the
@@ -864,7 +1055,7 @@ int atomic_increment(volatile int *value)
 int atomic_decrement(volatile int *value)
 {
 #if LOOM_PLATFORM == LOOM_PLATFORM_LINUX
-    return __sync_fetch_and_sub(value, 1);
+    return __sync_sub_and_fetch(value, 1);
 
 #else
     // NOTE: Android's implementation of these functions is atypical in that it returns the
@@ -897,6 +1088,129 @@ void loom_thread_setDebugName(const char *name)
 }
 
 
+// Cores sorted by their maximum frequency, found once. When they all run
+// as fast there's no affinity to set.
+static pthread_once_t gCoreClassesOnce = PTHREAD_ONCE_INIT;
+static cpu_set_t      gBigCores;
+static cpu_set_t      gLittleCores;
+static cpu_set_t      gAllCores;
+static int            gCoresDiffer = 0;
+
+static long loom_thread_readCoreMaxFrequency(int cpu)
+{
+    char path[128];
+    long frequency = 0;
+    FILE *file;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", cpu);
+    file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return 0;
+    }
+
+    if (fscanf(file, "%ld", &frequency) != 1)
+    {
+        frequency = 0;
+    }
+
+    fclose(file);
+    return frequency;
+}
+
+
+static void loom_thread_findCoreClasses()
+{
+    long frequencies[CPU_SETSIZE];
+    long fastest = 0, slowest = 0;
+    int  cpuCount = (int)sysconf(_SC_NPROCESSORS_CONF);
+    int  i;
+
+    if (cpuCount > CPU_SETSIZE)
+    {
+        cpuCount = CPU_SETSIZE;
+    }
+
+    CPU_ZERO(&gBigCores);
+    CPU_ZERO(&gLittleCores);
+    CPU_ZERO(&gAllCores);
+
+    for (i = 0; i < cpuCount; i++)
+    {
+        frequencies[i] = loom_thread_readCoreMaxFrequency(i);
+        if (frequencies[i] == 0)
+        {
+            // Unknown, treat them all alike.
+            return;
+        }
+
+        if ((fastest == 0) || (frequencies[i] > fastest))
+        {
+            fastest = frequencies[i];
+        }
+
+        if ((slowest == 0) || (frequencies[i] < slowest))
+        {
+            slowest = frequencies[i];
+        }
+    }
+
+    if (fastest == slowest)
+    {
+        return;
+    }
+
+    for (i = 0; i < cpuCount; i++)
+    {
+        CPU_SET(i, &gAllCores);
+        CPU_SET(i, frequencies[i] == fastest ? &gBigCores : &gLittleCores);
+    }
+
+    gCoresDiffer = 1;
+}
+
+
+void loom_thread_setHint(loom_threadHint hint)
+{
+    int       nice;
+    cpu_set_t *cores;
+
+    // Android's THREAD_PRIORITY_URGENT_DISPLAY and _BACKGROUND.
+    switch (hint)
+    {
+    case LOOM_THREAD_LATENCY_CRITICAL:
+        nice  = -8;
+        cores = &gBigCores;
+        break;
+
+    case LOOM_THREAD_THROUGHPUT:
+        nice  = 0;
+        cores = &gAllCores;
+        break;
+
+    case LOOM_THREAD_BACKGROUND:
+        nice  = 10;
+        cores = &gLittleCores;
+        break;
+
+    default:
+        return;
+    }
+
+    // Linux threads have a nice value each, set by their id. Raising it
+    // fails without the privilege on desktops, which is fine.
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), nice);
+
+    // Affinity is inherited, so threads started from a latency critical one
+    // need it widened again.
+    pthread_once(&gCoreClassesOnce, loom_thread_findCoreClasses);
+    if (gCoresDiffer)
+    {
+        sched_setaffinity(0, sizeof(cpu_set_t), cores);
+    }
+}
+
+
 #else
 
 // Dummy implementation to keep unsupported platforms semi-happy.
@@ -987,6 +1301,13 @@ int atomic_compareAndExchange(volatile int *value, int expected, int newVal)
 }
 
 
+void *atomic_compareAndExchangePointer(void *volatile *value, void *expected, void *newVal)
+{
+    *value = newVal;
+    return expected;
+}
+
+
 int atomic_increment(volatile int *value)
 {
     return *value = *value + 1;
@@ -1010,6 +1331,16 @@ void loom_thread_yield()
 }
 
 
+void loom_thread_park(volatile atomic_int_t *address, int expected)
+{
+}
+
+
+void loom_thread_unpark(volatile atomic_int_t *address, int all)
+{
+}
+
+
 int atomic_load32(volatile int *variable)
 {
     return *variable;
@@ -1027,7 +1358,229 @@ void loom_thread_setDebugName(ThreadHandle th, const char *name)
 }
 
 
+void loom_thread_setHint(loom_threadHint hint)
+{
+}
+
+
 int loom_mutex_trylock_real(const char *file, int line, MutexHandle m)
 {
 }
 #endif
+
+/**************************************************************************
+ * Threads started with a hint apply it to themselves before running.
+ *************************************************************************/
+
+typedef struct
+{
+    ThreadFunction  func;
+    void            *param;
+    loom_threadHint hint;
+} loom_hintedThreadStart;
+
+static int __stdcall loom_thread_hintedMain(void *param)
+{
+    loom_hintedThreadStart start = *(loom_hintedThreadStart *)param;
+
+    lmFree(NULL, param);
+
+    loom_thread_setHint(start.hint);
+    return start.func(start.param);
+}
+
+
+ThreadHandle loom_thread_startWithHint(ThreadFunction func, void *param, loom_threadHint hint)
+{
+    loom_hintedThreadStart *start;
+
+    if (hint == LOOM_THREAD_DEFAULT)
+    {
+        return loom_thread_start(func, param);
+    }
+
+    start        = (loom_hintedThreadStart *)lmAlloc(NULL, sizeof(loom_hintedThreadStart));
+    start->func  = func;
+    start->param = param;
+    start->hint  = hint;
+
+    return loom_thread_start(loom_thread_hintedMain, start);
+}
+
+
+/**************************************************************************
+ * Light mutex and read/write lock, the same on every platform on top of
+ * the ordered atomics and loom_thread_park.
+ *************************************************************************/
+
+// Attempts to take a contended lock before parking, about a microsecond.
+#define LOOM_LOCK_SPINS    100
+
+// LightMutex states, LOCKED_PARKED when threads may be parked on it.
+#define LIGHTMUTEX_UNLOCKED        0
+#define LIGHTMUTEX_LOCKED          1
+#define LIGHTMUTEX_LOCKED_PARKED   2
+
+int loom_lightMutex_trylock(LightMutex *m)
+{
+    int expected = LIGHTMUTEX_UNLOCKED;
+
+    return atomic_compareExchange32(&m->state, &expected, LIGHTMUTEX_LOCKED, LOOM_ORDER_ACQUIRE);
+}
+
+
+void loom_lightMutex_lock(LightMutex *m)
+{
+    int i;
+    int state;
+
+    if (loom_lightMutex_trylock(m))
+    {
+        return;
+    }
+
+    for (i = 0; i < LOOM_LOCK_SPINS; i++)
+    {
+        atomic_pause();
+
+        if ((atomic_load32Ordered(&m->state, LOOM_ORDER_RELAXED) == LIGHTMUTEX_UNLOCKED) && loom_lightMutex_trylock(m))
+        {
+            return;
+        }
+    }
+
+    // Taken by whoever sets it from unlocked, leaving it marked as parked
+    // on as there may be others.
+    while ((state = atomic_exchange32(&m->state, LIGHTMUTEX_LOCKED_PARKED, LOOM_ORDER_ACQUIRE)) != LIGHTMUTEX_UNLOCKED)
+    {
+        loom_thread_park(&m->state, LIGHTMUTEX_LOCKED_PARKED);
+    }
+}
+
+
+void loom_lightMutex_unlock(LightMutex *m)
+{
+    if (atomic_exchange32(&m->state, LIGHTMUTEX_UNLOCKED, LOOM_ORDER_RELEASE) == LIGHTMUTEX_LOCKED_PARKED)
+    {
+        loom_thread_unpark(&m->state, 0);
+    }
+}
+
+
+// Parks on the state of l while it's still seen, waking from the next
+// unlock. parked is counted first so an unlock after that sees it, or
+// the state it changed doesn't match any more and park returns.
+static void loom_rwlock_park(RWLock *l, int seen)
+{
+    atomic_fetchAdd32(&l->parked, 1, LOOM_ORDER_SEQ_CST);
+
+    if (atomic_load32Ordered(&l->state, LOOM_ORDER_SEQ_CST) == seen)
+    {
+        loom_thread_park(&l->state, seen);
+    }
+
+    atomic_fetchAdd32(&l->parked, -1, LOOM_ORDER_RELAXED);
+}
+
+
+static void loom_rwlock_unparkAll(RWLock *l)
+{
+    if (atomic_load32Ordered(&l->parked, LOOM_ORDER_SEQ_CST) > 0)
+    {
+        loom_thread_unpark(&l->state, 1);
+    }
+}
+
+
+int loom_rwlock_trylockRead(RWLock *l)
+{
+    int state = atomic_load32Ordered(&l->state, LOOM_ORDER_RELAXED);
+
+    while ((state >= 0) && (atomic_load32Ordered(&l->writersWaiting, LOOM_ORDER_RELAXED) == 0))
+    {
+        if (atomic_compareExchange32(&l->state, &state, state + 1, LOOM_ORDER_ACQUIRE))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+void loom_rwlock_lockRead(RWLock *l)
+{
+    int spins;
+
+    for (spins = 0; ; spins++)
+    {
+        int state;
+
+        if (loom_rwlock_trylockRead(l))
+        {
+            return;
+        }
+
+        if (spins < LOOM_LOCK_SPINS)
+        {
+            atomic_pause();
+            continue;
+        }
+
+        // Held by a writer, or readers that a waiting writer is after.
+        state = atomic_load32Ordered(&l->state, LOOM_ORDER_RELAXED);
+        if ((state < 0) || atomic_load32Ordered(&l->writersWaiting, LOOM_ORDER_RELAXED))
+        {
+            loom_rwlock_park(l, state);
+        }
+    }
+}
+
+
+void loom_rwlock_unlockRead(RWLock *l)
+{
+    atomic_fetchAdd32(&l->state, -1, LOOM_ORDER_SEQ_CST);
+    loom_rwlock_unparkAll(l);
+}
+
+
+int loom_rwlock_trylockWrite(RWLock *l)
+{
+    int expected = 0;
+
+    return atomic_compareExchange32(&l->state, &expected, -1, LOOM_ORDER_ACQUIRE);
+}
+
+
+void loom_rwlock_lockWrite(RWLock *l)
+{
+    int spins;
+
+    atomic_fetchAdd32(&l->writersWaiting, 1, LOOM_ORDER_RELAXED);
+
+    for (spins = 0; !loom_rwlock_trylockWrite(l); spins++)
+    {
+        int state;
+
+        if (spins < LOOM_LOCK_SPINS)
+        {
+            atomic_pause();
+            continue;
+        }
+
+        state = atomic_load32Ordered(&l->state, LOOM_ORDER_RELAXED);
+        if (state != 0)
+        {
+            loom_rwlock_park(l, state);
+        }
+    }
+
+    atomic_fetchAdd32(&l->writersWaiting, -1, LOOM_ORDER_RELAXED);
+}
+
+
+void loom_rwlock_unlockWrite(RWLock *l)
+{
+    atomic_store32Ordered(&l->state, 0, LOOM_ORDER_SEQ_CST);
+    loom_rwlock_unparkAll(l);
+}
@@ -34,6 +34,14 @@ extern "C" {
 #define __stdcall
 #endif
 
+// Gives every thread its own copy of a static or global. Only for plain
+// data without constructors or destructors.
+#if LOOM_COMPILER == LOOM_COMPILER_MSVC
+#define LOOM_THREAD_LOCAL    __declspec(thread)
+#else
+#define LOOM_THREAD_LOCAL    __thread
+#endif
+
 /**************************************************************************
  * Loom Threading Primitives
  *
@@ -66,6 +74,24 @@ typedef int (__stdcall * ThreadFunction)(void *param); // TODO: Sort out __stdca
 
 ThreadHandle loom_thread_start(ThreadFunction func, void *param);
 
+// What a thread is for, so the OS can schedule it accordingly. Where the
+// cores differ in performance (big.LITTLE) latency critical threads are
+// kept to the fast ones and background ones to the slow ones.
+typedef enum
+{
+    LOOM_THREAD_DEFAULT,          // as the thread starting it
+    LOOM_THREAD_LATENCY_CRITICAL, // audio and rendering, raised priority
+    LOOM_THREAD_THROUGHPUT,       // job workers, any core
+    LOOM_THREAD_BACKGROUND        // I/O and housekeeping, lowered priority
+} loom_threadHint;
+
+// Starts the thread with its priority and affinity set for hint.
+ThreadHandle loom_thread_startWithHint(ThreadFunction func, void *param, loom_threadHint hint);
+
+// Sets the priority and affinity of the calling thread, best effort as
+// raising priority may not be allowed.
+void loom_thread_setHint(loom_threadHint hint);
+
 // Set the name of the thread as it will be seen in the debugger.
 void loom_thread_setDebugName(const char *name);
 int loom_thread_getIdFromHandle(ThreadHandle th);
@@ -88,14 +114,53 @@ void loom_semaphore_destroy_real(const char *file, int line, SemaphoreHandle s);
 #define loom_semaphore_wait(s)       loom_semaphore_wait_real(__FILE__, __LINE__, s)
 #define loom_semaphore_destroy(s)    loom_semaphore_destroy_real(__FILE__, __LINE__, s)
 
-// Some atomic primitives:
+// Some atomic primitives, sequentially consistent. Ones taking a memory
+// order, 64 bit and pointer ones are in platformAtomic.h.
 typedef int   atomic_int_t;
 int atomic_compareAndExchange(volatile atomic_int_t *value, int expected, int newVal);
+// Pointer sized compare and exchange, returns the value before the call so
+// the exchange happened if it equals expected.
+void *atomic_compareAndExchangePointer(void *volatile *value, void *expected, void *newVal);
 int atomic_increment(volatile atomic_int_t *value);
 int atomic_decrement(volatile atomic_int_t *value);
 int atomic_load32(volatile atomic_int_t *variable);
 void atomic_store32(volatile atomic_int_t *variable, int newValue);
 
+// Parks the calling thread while *address holds expected, until
+// loom_thread_unpark is called on address. May return spuriously, so
+// check again what the thread waits for. unpark wakes one parked thread,
+// or all of them.
+void loom_thread_park(volatile atomic_int_t *address, int expected);
+void loom_thread_unpark(volatile atomic_int_t *address, int all);
+
+// A lock without an OS object, for short critical sections. It spins a
+// while before it parks, and costs one atomic operation uncontended. Zero
+// it to initialize, there's nothing to destroy. Not recursive.
+typedef struct
+{
+    volatile atomic_int_t state;
+} LightMutex;
+
+void loom_lightMutex_lock(LightMutex *m);
+int loom_lightMutex_trylock(LightMutex *m);
+void loom_lightMutex_unlock(LightMutex *m);
+
+// A read/write lock along the same lines. Waiting writers keep new readers
+// out so they aren't starved. Not recursive.
+typedef struct
+{
+    volatile atomic_int_t state; // readers holding it, -1 when a writer does
+    volatile atomic_int_t writersWaiting;
+    volatile atomic_int_t parked;
+} RWLock;
+
+void loom_rwlock_lockRead(RWLock *l);
+int loom_rwlock_trylockRead(RWLock *l);
+void loom_rwlock_unlockRead(RWLock *l);
+void loom_rwlock_lockWrite(RWLock *l);
+int loom_rwlock_trylockWrite(RWLock *l);
+void loom_rwlock_unlockWrite(RWLock *l);
+
 // Sleeping and yielding.
 void loom_thread_sleep(long ms);
 void loom_thread_yield();
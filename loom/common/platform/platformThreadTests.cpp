@@ -19,8 +19,10 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include "seatest.h"
 #include "loom/common/platform/platformThread.h"
+#include "loom/common/platform/platformAtomic.h"
 #include "loom/common/core/assert.h"
 
 SEATEST_FIXTURE(platformThread)
@@ -29,6 +31,10 @@ SEATEST_FIXTURE(platformThread)
     SEATEST_FIXTURE_ENTRY(platformThread_mutexCountTest);
     SEATEST_FIXTURE_ENTRY(platformThread_semaphoreChain);
     SEATEST_FIXTURE_ENTRY(platformThread_compareExchangeTest);
+    SEATEST_FIXTURE_ENTRY(platformThread_lightMutexCountTest);
+    SEATEST_FIXTURE_ENTRY(platformThread_rwlockTest);
+    SEATEST_FIXTURE_ENTRY(platformThread_atomic64Test);
+    SEATEST_FIXTURE_ENTRY(platformThread_hintTest);
 }
 
 static MutexHandle  gTestCountMutex      = NULL;
@@ -348,3 +354,202 @@ SEATEST_TEST(platformThread_semaphoreChain)
     // If it finishes we are golden.
     assert_true(true);
 }
+
+
+static LightMutex gTestLightMutex;
+
+static int __stdcall threadCountUpLightMutexFunc(void *param)
+{
+    for (int i = 0; i < INCREMENT_LIMIT; i++)
+    {
+        loom_lightMutex_lock(&gTestLightMutex);
+        gTestCount++;
+        loom_lightMutex_unlock(&gTestLightMutex);
+    }
+
+    return 0;
+}
+
+
+SEATEST_TEST(platformThread_lightMutexCountTest)
+{
+    const int    threadCount = THREAD_COUNT;
+    ThreadHandle thread[threadCount];
+
+    gTestLightMutex.state = 0;
+    gTestCount            = 0;
+
+    for (int i = 0; i < threadCount; i++)
+    {
+        thread[i] = loom_thread_start(threadCountUpLightMutexFunc, NULL);
+    }
+
+    for (int i = 0; i < threadCount; i++)
+    {
+        loom_thread_join(thread[i]);
+    }
+
+    assert_int_equal(threadCount * INCREMENT_LIMIT, gTestCount);
+
+    // Can't be taken twice.
+    assert_true(loom_lightMutex_trylock(&gTestLightMutex));
+    assert_false(loom_lightMutex_trylock(&gTestLightMutex));
+    loom_lightMutex_unlock(&gTestLightMutex);
+
+    gTestCount = 0;
+}
+
+
+static RWLock                gTestRWLock;
+static volatile atomic_int_t gTestReaders = 0;
+static volatile atomic_int_t gTestWriters = 0;
+static volatile atomic_int_t gTestRWErrors = 0;
+
+static int __stdcall threadReadWriteFunc(void *param)
+{
+    for (int i = 0; i < INCREMENT_LIMIT; i++)
+    {
+        // Every eighth access writes.
+        if ((i + (int)(size_t)param) % 8 == 0)
+        {
+            loom_rwlock_lockWrite(&gTestRWLock);
+
+            if ((atomic_fetchAdd32(&gTestWriters, 1, LOOM_ORDER_SEQ_CST) != 0) || (atomic_load32Ordered(&gTestReaders, LOOM_ORDER_SEQ_CST) != 0))
+            {
+                atomic_fetchAdd32(&gTestRWErrors, 1, LOOM_ORDER_SEQ_CST);
+            }
+
+            gTestCount++;
+            atomic_fetchAdd32(&gTestWriters, -1, LOOM_ORDER_SEQ_CST);
+
+            loom_rwlock_unlockWrite(&gTestRWLock);
+        }
+        else
+        {
+            loom_rwlock_lockRead(&gTestRWLock);
+
+            atomic_fetchAdd32(&gTestReaders, 1, LOOM_ORDER_SEQ_CST);
+            if (atomic_load32Ordered(&gTestWriters, LOOM_ORDER_SEQ_CST) != 0)
+            {
+                atomic_fetchAdd32(&gTestRWErrors, 1, LOOM_ORDER_SEQ_CST);
+            }
+            atomic_fetchAdd32(&gTestReaders, -1, LOOM_ORDER_SEQ_CST);
+
+            loom_rwlock_unlockRead(&gTestRWLock);
+        }
+    }
+
+    return 0;
+}
+
+
+SEATEST_TEST(platformThread_rwlockTest)
+{
+    const int    threadCount = 8;
+    ThreadHandle thread[threadCount];
+
+    memset(&gTestRWLock, 0, sizeof(gTestRWLock));
+    gTestCount    = 0;
+    gTestRWErrors = 0;
+
+    for (int i = 0; i < threadCount; i++)
+    {
+        thread[i] = loom_thread_start(threadReadWriteFunc, (void *)(size_t)i);
+    }
+
+    for (int i = 0; i < threadCount; i++)
+    {
+        loom_thread_join(thread[i]);
+    }
+
+    // Writers never overlapped each other or any reader.
+    assert_int_equal(0, gTestRWErrors);
+    assert_int_equal(threadCount * INCREMENT_LIMIT / 8, gTestCount);
+    assert_int_equal(0, gTestRWLock.state);
+
+    gTestCount = 0;
+}
+
+
+static volatile atomic_int64_t gTestCount64 = 0;
+static void *volatile          gTestPointer = NULL;
+
+static int __stdcall threadCount64Func(void *param)
+{
+    for (int i = 0; i < INCREMENT_LIMIT; i++)
+    {
+        if (i & 1)
+        {
+            atomic_fetchAdd64(&gTestCount64, 0x100000000LL, LOOM_ORDER_RELAXED);
+        }
+        else
+        {
+            long long expected = atomic_load64(&gTestCount64, LOOM_ORDER_RELAXED);
+            while (!atomic_compareExchange64(&gTestCount64, &expected, expected + 0x100000000LL, LOOM_ORDER_ACQ_REL))
+            {
+            }
+        }
+    }
+
+    atomic_exchangePointer(&gTestPointer, param, LOOM_ORDER_ACQ_REL);
+    return 0;
+}
+
+
+SEATEST_TEST(platformThread_atomic64Test)
+{
+    const int    threadCount = THREAD_COUNT;
+    ThreadHandle thread[threadCount];
+
+    atomic_store64(&gTestCount64, 0, LOOM_ORDER_SEQ_CST);
+    atomic_storePointer(&gTestPointer, NULL, LOOM_ORDER_SEQ_CST);
+
+    for (int i = 0; i < threadCount; i++)
+    {
+        thread[i] = loom_thread_start(threadCount64Func, (void *)&thread[i]);
+    }
+
+    for (int i = 0; i < threadCount; i++)
+    {
+        loom_thread_join(thread[i]);
+    }
+
+    // The counts are all above 32 bits.
+    assert_true(atomic_load64(&gTestCount64, LOOM_ORDER_SEQ_CST) == (long long)threadCount * INCREMENT_LIMIT * 0x100000000LL);
+
+    // The pointer is the last thread's.
+    void *last = atomic_loadPointer(&gTestPointer, LOOM_ORDER_ACQUIRE);
+    assert_true(last >= (void *)&thread[0] && last <= (void *)&thread[threadCount - 1]);
+
+    assert_true(atomic_compareAndExchangePointer(&gTestPointer, last, NULL) == last);
+    assert_true(atomic_loadPointer(&gTestPointer, LOOM_ORDER_RELAXED) == NULL);
+}
+
+
+static int __stdcall threadHintFunc(void *param)
+{
+    // Fine to set again from within.
+    loom_thread_setHint(LOOM_THREAD_THROUGHPUT);
+    atomic_increment((volatile atomic_int_t *)param);
+    return 0;
+}
+
+
+SEATEST_TEST(platformThread_hintTest)
+{
+    volatile atomic_int_t ran = 0;
+    ThreadHandle          thread[4];
+
+    // Whether or not the OS allows them, every hint starts the thread.
+    for (int i = 0; i < 4; i++)
+    {
+        thread[i] = loom_thread_startWithHint(threadHintFunc, (void *)&ran, (loom_threadHint)i);
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        loom_thread_join(thread[i]);
+    }
+
+    assert_int_equal(4, atomic_load32(&ran));
+}
@@ -52,6 +52,18 @@ int platform_getMilliseconds()
 }
 
 
+unsigned long long platform_getNanoseconds()
+{
+    uint64_t t = mach_absolute_time() - gEpochStart;
+
+    // Split to keep the multiply from overflowing on long runs.
+    uint64_t high = (t / gTimebaseInfo.denom) * gTimebaseInfo.numer;
+    uint64_t low  = ((t % gTimebaseInfo.denom) * gTimebaseInfo.numer) / gTimebaseInfo.denom;
+
+    return high + low;
+}
+
+
 typedef struct loom_mach_precisionTimer_t
 {
     mach_timebase_info_data_t info;
@@ -105,6 +117,8 @@ void loom_destroyTimer(loom_precision_timer_t timer)
 #include <windows.h>
 
 static DWORD gEpochStart;
+static LARGE_INTEGER gCounterStart;
+static LARGE_INTEGER gCounterFrequency;
 
 void platform_timeInitialize()
 {
@@ -113,6 +127,9 @@ void platform_timeInitialize()
     assert(r == TIMERR_NOERROR);
 
     gEpochStart = timeGetTime();
+
+    QueryPerformanceFrequency(&gCounterFrequency);
+    QueryPerformanceCounter(&gCounterStart);
 }
 
 
@@ -124,6 +141,21 @@ int platform_getMilliseconds()
     return (int)(timeGetTime() - gEpochStart);
 }
 
+
+unsigned long long platform_getNanoseconds()
+{
+    LARGE_INTEGER now;
+    unsigned long long ticks, frequency;
+
+    QueryPerformanceCounter(&now);
+
+    ticks     = (unsigned long long)(now.QuadPart - gCounterStart.QuadPart);
+    frequency = (unsigned long long)gCounterFrequency.QuadPart;
+
+    // Split to keep the multiply from overflowing on long runs.
+    return (ticks / frequency) * 1000000000ULL + ((ticks % frequency) * 1000000000ULL) / frequency;
+}
+
 typedef struct loom_win32_precisionTimer_t
 {
     LARGE_INTEGER mPerfCountCurrent;
@@ -185,15 +217,11 @@ struct timespec dawn;
 
 typedef struct timespec   loom_linux_precisionTimer_t; // Don't bother creating our own timer struct -- for now, just use timespec
 
-// Select a platform appropriate clock. CLOCK_MONOTONIC is reported
-// to give best results on Android, 
+// CLOCK_MONOTONIC is reported to give best results on Android,
 // see http://gamasutra.com/view/feature/171774/getting_high_precision_timing_on_.php?print=1
-// for a full discussion.
-#if LOOM_PLATFORM == LOOM_PLATFORM_ANDROID
+// for a full discussion. Elsewhere it's also the clock that doesn't jump
+// when the wall clock is set, which frame timing can't have.
 #define WHICH_CLOCK CLOCK_MONOTONIC
-#else
-#define WHICH_CLOCK CLOCK_REALTIME 
-#endif
 
 void platform_timeInitialize()
 {
@@ -212,6 +240,16 @@ int platform_getMilliseconds()
 }
 
 
+unsigned long long platform_getNanoseconds()
+{
+    struct timespec now;
+
+    clock_gettime(WHICH_CLOCK, &now);
+
+    return (unsigned long long)(now.tv_sec - dawn.tv_sec) * 1000000000ULL + now.tv_nsec - dawn.tv_nsec;
+}
+
+
 loom_precision_timer_t loom_startTimer()
 {
     loom_linux_precisionTimer_t *t = lmAlloc(NULL, sizeof(loom_linux_precisionTimer_t));
@@ -30,6 +30,10 @@ void platform_timeInitialize();
 // Get a timestamp in milliseconds.
 int platform_getMilliseconds();
 
+// Get a monotonic timestamp in nanoseconds since platform_timeInitialize,
+// at the best resolution the platform clock offers.
+unsigned long long platform_getNanoseconds();
+
 typedef void * loom_precision_timer_t;
 loom_precision_timer_t loom_startTimer();
 void loom_resetTimer(loom_precision_timer_t timer);
@@ -37,4 +37,32 @@ void platform_videoPlayFullscreen(const char *video, int scaleMode, int controlM
 {
 }
 
+
+int platform_videoTextureSupported()
+{
+    return 0;
+}
+
+int platform_videoTextureOpen(const char *video, unsigned int glTexture, int loop)
+{
+    return -1;
+}
+
+int platform_videoTextureUpdate(int handle, LoomVideoFrame *frame)
+{
+    return 0;
+}
+
+void platform_videoTexturePause(int handle)
+{
+}
+
+void platform_videoTextureResume(int handle)
+{
+}
+
+void platform_videoTextureClose(int handle)
+{
+}
+
 #endif
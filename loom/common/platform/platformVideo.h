@@ -74,4 +74,40 @@ void platform_videoInitialize(VideoEventCallback eventCallback);
 ///Plays the specified video file fullscreen
 void platform_videoPlayFullscreen(const char *video, int scaleMode, int controlMode, unsigned int bgColor);
 
+
+///A decoded frame of a video played into a texture
+struct LoomVideoFrame
+{
+    ///GL texture name and target to sample the frame from, the name is 0 if the
+    ///frame is in the texture name handed to platform_videoTextureOpen
+    unsigned int handle;
+    unsigned int target;
+
+    ///size of the video in pixels, 0 until the first frame was decoded
+    int width;
+    int height;
+
+    ///offset and scale of the frame within the texture coordinates, in Loom's top down convention
+    float region[4];
+};
+
+///Returns non-zero if the platform can play videos into textures
+int platform_videoTextureSupported();
+
+///Starts playing the video into a texture sampled by the renderer rather than a native view.
+///On Android glTexture is a texture name made by the caller that the decoder writes into as
+///GL_TEXTURE_EXTERNAL_OES, on iOS the frames come with texture names of their own and it's ignored.
+///Returns a handle for the calls below or -1 on failure.
+int platform_videoTextureOpen(const char *video, unsigned int glTexture, int loop);
+
+///Latches the newest decoded frame, returns non-zero if there was a new one and fills frame in.
+///Has to be called on the thread owning the GL context.
+int platform_videoTextureUpdate(int handle, LoomVideoFrame *frame);
+
+void platform_videoTexturePause(int handle);
+void platform_videoTextureResume(int handle);
+
+///Stops the video and releases the textures the platform made for it
+void platform_videoTextureClose(int handle);
+
 #endif
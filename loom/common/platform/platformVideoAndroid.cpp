@@ -74,6 +74,41 @@ void Java_co_theengine_loomplayer_LoomVideo_nativeCallback(JNIEnv *env, jobject
 
 
 static loomJniMethodInfo gPlayVideoFullscreen;
+static loomJniMethodInfo gVideoTextureOpen;
+static loomJniMethodInfo gVideoTextureUpdate;
+static loomJniMethodInfo gVideoTexturePause;
+static loomJniMethodInfo gVideoTextureResume;
+static loomJniMethodInfo gVideoTextureClose;
+
+///texture transform and video size filled in by LoomVideoTexture.update
+static jfloatArray gVideoTextureUpdateResult = NULL;
+
+
+///strips out the raw filename only to use on Android, delete[] the result
+static char *getRawVideoName(const char *video)
+{
+    int index = 0;
+    int firstChar = 0;
+    int lastChar = strlen(video) - 1;
+    while(video[index] != '\0')
+    {
+        ///track extention start if found
+        if(video[index] == '.')
+        {
+            lastChar = index - 1;
+        }
+        else if((video[index] == '/') || (video[index] == '\\'))
+        {
+            firstChar = index + 1;
+        }
+        index++;
+    }
+    int len = (lastChar - firstChar) + 1;
+    char *newVideoName = new char[len + 1];
+    memcpy(newVideoName, &video[firstChar], len * sizeof(char));
+    newVideoName[len] = '\0';
+    return newVideoName;
+}
 
 
 int platform_videoSupported()
@@ -93,6 +128,26 @@ void platform_videoInitialize(VideoEventCallback eventCallback)
                                  "co/theengine/loomplayer/LoomVideo",
                                  "playFullscreen",
                                  "(Ljava/lang/String;III)V");
+    LoomJni::getStaticMethodInfo(gVideoTextureOpen,
+                                 "co/theengine/loomplayer/LoomVideoTexture",
+                                 "open",
+                                 "(Ljava/lang/String;IZ)I");
+    LoomJni::getStaticMethodInfo(gVideoTextureUpdate,
+                                 "co/theengine/loomplayer/LoomVideoTexture",
+                                 "update",
+                                 "(I[F)Z");
+    LoomJni::getStaticMethodInfo(gVideoTexturePause,
+                                 "co/theengine/loomplayer/LoomVideoTexture",
+                                 "pause",
+                                 "(I)V");
+    LoomJni::getStaticMethodInfo(gVideoTextureResume,
+                                 "co/theengine/loomplayer/LoomVideoTexture",
+                                 "resume",
+                                 "(I)V");
+    LoomJni::getStaticMethodInfo(gVideoTextureClose,
+                                 "co/theengine/loomplayer/LoomVideoTexture",
+                                 "close",
+                                 "(I)V");
 }
 
 
@@ -107,27 +162,7 @@ void platform_videoPlayFullscreen(const char *video, int scaleMode, int controlM
     }
 
 
-    ///strip out the raw filename only to use on Android
-    int index = 0;
-    int firstChar = 0;
-    int lastChar = strlen(video) - 1;
-    while(video[index] != '\0')
-    {
-        ///track extention start if found
-        if(video[index] == '.')
-        {
-            lastChar = index - 1;
-        }
-        else if((video[index] == '/') || (video[index] == '\\'))
-        {
-            firstChar = index + 1;
-        }
-        index++;
-    }
-    int len = (lastChar - firstChar) + 1;
-    char *newVideoName = new char[len + 1];
-    memcpy(newVideoName, &video[firstChar], len * sizeof(char));
-    newVideoName[len] = '\0';
+    char *newVideoName = getRawVideoName(video);
 
     ///call java method to play the video
     lmLogDebug(gAndroidVideoLogGroup, "videoPlayFullscreen: '%s' became '%s'", video, newVideoName);
@@ -136,4 +171,85 @@ void platform_videoPlayFullscreen(const char *video, int scaleMode, int controlM
     gPlayVideoFullscreen.getEnv()->DeleteLocalRef(jVideo);
     delete []newVideoName;
 }
+
+
+int platform_videoTextureSupported()
+{
+    return true;
+}
+
+
+int platform_videoTextureOpen(const char *video, unsigned int glTexture, int loop)
+{
+    if(strstr(video, ROOT_FOLDER) != video)
+    {
+        lmLogError(gAndroidVideoLogGroup, "Unable to play Video %s that does not reside in '%s'", video, ROOT_FOLDER);
+        return -1;
+    }
+
+    char *newVideoName = getRawVideoName(video);
+
+    lmLogDebug(gAndroidVideoLogGroup, "videoTextureOpen: '%s' became '%s' on texture %u", video, newVideoName, glTexture);
+    JNIEnv *env = gVideoTextureOpen.getEnv();
+    jstring jVideo = env->NewStringUTF(newVideoName);
+    int handle = env->CallStaticIntMethod(gVideoTextureOpen.classID, gVideoTextureOpen.methodID, jVideo, (jint)glTexture, (jboolean)(loop != 0));
+    env->DeleteLocalRef(jVideo);
+    delete []newVideoName;
+
+    return handle;
+}
+
+
+int platform_videoTextureUpdate(int handle, LoomVideoFrame *frame)
+{
+    JNIEnv *env = gVideoTextureUpdate.getEnv();
+
+    if (gVideoTextureUpdateResult == NULL)
+    {
+        jfloatArray result = env->NewFloatArray(18);
+        gVideoTextureUpdateResult = (jfloatArray)env->NewGlobalRef(result);
+        env->DeleteLocalRef(result);
+    }
+
+    if (!env->CallStaticBooleanMethod(gVideoTextureUpdate.classID, gVideoTextureUpdate.methodID, handle, gVideoTextureUpdateResult))
+    {
+        return 0;
+    }
+
+    float m[18];
+    env->GetFloatArrayRegion(gVideoTextureUpdateResult, 0, 18, m);
+
+    ///the frame stays in the texture name made by the caller, the column major
+    ///transform maps bottom up coordinates so v is flipped into it, rotation
+    ///is left out as decoders only crop and flip
+    frame->handle = 0;
+    frame->target = 0x8D65; // GL_TEXTURE_EXTERNAL_OES
+    frame->width = (int)m[16];
+    frame->height = (int)m[17];
+    frame->region[0] = m[12];
+    frame->region[1] = m[5] + m[13];
+    frame->region[2] = m[0];
+    frame->region[3] = -m[5];
+
+    return 1;
+}
+
+
+void platform_videoTexturePause(int handle)
+{
+    gVideoTexturePause.getEnv()->CallStaticVoidMethod(gVideoTexturePause.classID, gVideoTexturePause.methodID, handle);
+}
+
+
+void platform_videoTextureResume(int handle)
+{
+    gVideoTextureResume.getEnv()->CallStaticVoidMethod(gVideoTextureResume.classID, gVideoTextureResume.methodID, handle);
+}
+
+
+void platform_videoTextureClose(int handle)
+{
+    gVideoTextureClose.getEnv()->CallStaticVoidMethod(gVideoTextureClose.classID, gVideoTextureClose.methodID, handle);
+}
+
 #endif
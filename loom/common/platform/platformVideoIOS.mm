@@ -21,6 +21,11 @@ limitations under the License.
 #import <Foundation/Foundation.h>
 #import <UIKit/UIKit.h>
 #import <MediaPlayer/MediaPlayer.h>
+#import <AVFoundation/AVFoundation.h>
+#import <CoreVideo/CVOpenGLESTextureCache.h>
+#import <OpenGLES/EAGL.h>
+#import <OpenGLES/ES2/gl.h>
+#import <OpenGLES/ES2/glext.h>
 #import <Foundation/NSSet.h>
 
 #include "loom/common/platform/platform.h"
@@ -193,6 +198,79 @@ static UIViewController* getParentViewController()
 
 @end
 
+//plays a video for platform_videoTextureOpen, frames are pulled by platform_videoTextureUpdate
+@interface VideoTexturePlayer : NSObject
+
+@property (nonatomic, retain) AVPlayer*                 player;
+@property (nonatomic, retain) AVPlayerItemVideoOutput*  output;
+@property (nonatomic, retain) NSString*                 path;
+@property (nonatomic, assign) BOOL                      loop;
+
+@end
+
+@implementation VideoTexturePlayer
+
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    [self.player pause];
+
+    self.player = nil;
+    self.output = nil;
+    self.path   = nil;
+
+    [super dealloc];
+}
+
+- (void)itemFinished:(NSNotification*)notification
+{
+    if (self.loop)
+    {
+        [self.player seekToTime:kCMTimeZero];
+        [self.player play];
+        return;
+    }
+
+    gEventCallback("complete", [self.path UTF8String]);
+}
+
+- (void)itemFailed:(NSNotification*)notification
+{
+    gEventCallback("fail", [self.path UTF8String]);
+}
+
+@end
+
+
+#define VIDEOTEXTURE_MAX    16
+
+struct VideoTextureSlot
+{
+    VideoTexturePlayer  *player;
+
+    //the texture of the frame shown and the one before, which draws
+    //still queued up may read so it's released a frame later
+    CVOpenGLESTextureRef textures[2];
+};
+
+static VideoTextureSlot gVideoTextures[VIDEOTEXTURE_MAX];
+static CVOpenGLESTextureCacheRef gVideoTextureCache = NULL;
+
+static void releaseVideoTextureSlot(VideoTextureSlot& slot)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (slot.textures[i])
+        {
+            CFRelease(slot.textures[i]);
+            slot.textures[i] = NULL;
+        }
+    }
+
+    [slot.player release];
+    slot.player = nil;
+}
+
 
 int platform_videoSupported()
 {
@@ -220,3 +298,159 @@ void platform_videoPlayFullscreen(const char *video, int scaleMode, int controlM
     [getParentViewController() presentViewController:[MoviePlayerViewController controller:videoUrl] animated:NO completion:nil];
 
 }
+
+
+int platform_videoTextureSupported()
+{
+    return true;
+}
+
+int platform_videoTextureOpen(const char *video, unsigned int glTexture, int loop)
+{
+    int handle = -1;
+    for (int i = 0; i < VIDEOTEXTURE_MAX; i++)
+    {
+        if (gVideoTextures[i].player == nil)
+        {
+            handle = i;
+            break;
+        }
+    }
+
+    if (handle == -1)
+    {
+        NSLog(@"Unable to play %s into a texture, %d videos are playing already", video, VIDEOTEXTURE_MAX);
+        return -1;
+    }
+
+    NSString* resourcePath = [[NSBundle mainBundle] resourcePath];
+    resourcePath = [resourcePath stringByAppendingString:@"/"];
+    resourcePath = [resourcePath stringByAppendingString:[NSString stringWithUTF8String:video]];
+
+    if (![[NSFileManager defaultManager] fileExistsAtPath:resourcePath])
+    {
+        NSLog(@"Unable to find video %@", resourcePath);
+        return -1;
+    }
+
+    //BGRA frames map directly onto a GL texture through the texture cache
+    NSDictionary *attributes = @{ (NSString *)kCVPixelBufferPixelFormatTypeKey : @(kCVPixelFormatType_32BGRA),
+                                  (NSString *)kCVPixelBufferOpenGLESCompatibilityKey : @YES };
+
+    AVPlayerItem *item = [AVPlayerItem playerItemWithURL:[NSURL fileURLWithPath:resourcePath]];
+
+    VideoTexturePlayer *player = [[VideoTexturePlayer alloc] init];
+    player.path   = [NSString stringWithUTF8String:video];
+    player.loop   = loop ? YES : NO;
+    player.output = [[[AVPlayerItemVideoOutput alloc] initWithPixelBufferAttributes:attributes] autorelease];
+    [item addOutput:player.output];
+    player.player = [AVPlayer playerWithPlayerItem:item];
+    player.player.actionAtItemEnd = AVPlayerActionAtItemEndNone;
+
+    [[NSNotificationCenter defaultCenter] addObserver:player
+                                          selector:@selector(itemFinished:)
+                                          name:AVPlayerItemDidPlayToEndTimeNotification
+                                          object:item];
+    [[NSNotificationCenter defaultCenter] addObserver:player
+                                          selector:@selector(itemFailed:)
+                                          name:AVPlayerItemFailedToPlayToEndTimeNotification
+                                          object:item];
+
+    [player.player play];
+
+    gVideoTextures[handle].player = player;
+    return handle;
+}
+
+int platform_videoTextureUpdate(int handle, LoomVideoFrame *frame)
+{
+    if (handle < 0 || handle >= VIDEOTEXTURE_MAX || gVideoTextures[handle].player == nil)
+    {
+        return 0;
+    }
+
+    VideoTextureSlot& slot = gVideoTextures[handle];
+    AVPlayerItemVideoOutput *output = slot.player.output;
+
+    CMTime itemTime = [output itemTimeForHostTime:CACurrentMediaTime()];
+    if (![output hasNewPixelBufferForItemTime:itemTime])
+    {
+        return 0;
+    }
+
+    CVPixelBufferRef buffer = [output copyPixelBufferForItemTime:itemTime itemTimeForDisplay:NULL];
+    if (buffer == NULL)
+    {
+        return 0;
+    }
+
+    if (gVideoTextureCache == NULL)
+    {
+        CVReturn err = CVOpenGLESTextureCacheCreate(kCFAllocatorDefault, NULL, [EAGLContext currentContext], NULL, &gVideoTextureCache);
+        if (err != kCVReturnSuccess)
+        {
+            NSLog(@"Unable to create the video texture cache: %d", err);
+            CVPixelBufferRelease(buffer);
+            return 0;
+        }
+    }
+
+    int width  = (int)CVPixelBufferGetWidth(buffer);
+    int height = (int)CVPixelBufferGetHeight(buffer);
+
+    CVOpenGLESTextureRef texture = NULL;
+    CVReturn err = CVOpenGLESTextureCacheCreateTextureFromImage(kCFAllocatorDefault, gVideoTextureCache, buffer, NULL,
+                                                                GL_TEXTURE_2D, GL_RGBA, width, height,
+                                                                GL_BGRA_EXT, GL_UNSIGNED_BYTE, 0, &texture);
+    CVPixelBufferRelease(buffer);
+
+    if (err != kCVReturnSuccess)
+    {
+        NSLog(@"Unable to map a video frame to a texture: %d", err);
+        return 0;
+    }
+
+    if (slot.textures[1])
+    {
+        CFRelease(slot.textures[1]);
+    }
+    slot.textures[1] = slot.textures[0];
+    slot.textures[0] = texture;
+
+    CVOpenGLESTextureCacheFlush(gVideoTextureCache, 0);
+
+    frame->handle = CVOpenGLESTextureGetName(texture);
+    frame->target = CVOpenGLESTextureGetTarget(texture);
+    frame->width  = width;
+    frame->height = height;
+    frame->region[0] = 0.0f;
+    frame->region[1] = 0.0f;
+    frame->region[2] = 1.0f;
+    frame->region[3] = 1.0f;
+
+    return 1;
+}
+
+void platform_videoTexturePause(int handle)
+{
+    if (handle >= 0 && handle < VIDEOTEXTURE_MAX && gVideoTextures[handle].player != nil)
+    {
+        [gVideoTextures[handle].player.player pause];
+    }
+}
+
+void platform_videoTextureResume(int handle)
+{
+    if (handle >= 0 && handle < VIDEOTEXTURE_MAX && gVideoTextures[handle].player != nil)
+    {
+        [gVideoTextures[handle].player.player play];
+    }
+}
+
+void platform_videoTextureClose(int handle)
+{
+    if (handle >= 0 && handle < VIDEOTEXTURE_MAX)
+    {
+        releaseVideoTextureSlot(gVideoTextures[handle]);
+    }
+}
@@ -0,0 +1,1197 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#include "loom/common/platform/platform.h"
+#include "loom/common/platform/platformWebSocket.h"
+#include "loom/common/platform/platformNetwork.h"
+#include "loom/common/platform/platformThread.h"
+#include "loom/common/platform/platformTime.h"
+#include "loom/common/core/allocator.h"
+#include "loom/common/core/assert.h"
+#include "loom/common/core/log.h"
+#include "loom/common/utils/utBase64.h"
+#include "loom/common/utils/utRandom.h"
+
+#if !defined(LOOMSCRIPT_STANDALONE) && (LOOM_PLATFORM == LOOM_PLATFORM_WIN32 || LOOM_PLATFORM == LOOM_PLATFORM_LINUX)
+#define LOOM_WEBSOCKET_CURL    1
+#include "curl/curl.h"
+#endif
+
+lmDefineLogGroup(gWebSocketLogGroup, "websocket", 1, LoomLogInfo);
+
+// How long connecting, the handshake and the closing handshake may take.
+#define WEBSOCKET_CONNECT_TIMEOUT_MS    10000
+#define WEBSOCKET_CLOSE_TIMEOUT_MS      5000
+
+// How long the thread sleeps on the socket before checking for new
+// messages to send or being destroyed.
+#define WEBSOCKET_WAIT_MS               20
+
+#define WEBSOCKET_MAX_HEADER_SIZE       16384
+#define WEBSOCKET_MAX_MESSAGE_SIZE      (64 * 1024 * 1024)
+#define WEBSOCKET_RECEIVE_SIZE          16384
+
+enum
+{
+    WEBSOCKET_OP_CONTINUATION = 0x0,
+    WEBSOCKET_OP_TEXT         = 0x1,
+    WEBSOCKET_OP_BINARY       = 0x2,
+    WEBSOCKET_OP_CLOSE        = 0x8,
+    WEBSOCKET_OP_PING         = 0x9,
+    WEBSOCKET_OP_PONG         = 0xA
+};
+
+enum
+{
+    WEBSOCKET_CONNECTING,
+    WEBSOCKET_OPEN,
+    WEBSOCKET_CLOSING,  // our close frame is queued, waiting for the server's
+    WEBSOCKET_CLOSED
+};
+
+struct loom_webSocketEventRecord
+{
+    loom_webSocketEvent event;
+    utByteArray         *data;
+    int                 code;
+};
+
+struct loom_webSocket
+{
+    // Set before the thread starts.
+    utString               host;
+    utString               path;
+    utString               protocols;
+    unsigned short         port;
+    bool                   secure;
+    loom_webSocketCallback callback;
+    void                   *payload;
+
+    ThreadHandle           thread;
+    volatile atomic_int_t  quit;
+    bool                   destroyed;
+
+    // Guards everything below, and the transport once open.
+    MutexHandle            lock;
+    int                    state;
+    int                    closeStarted;
+    utArray<unsigned char> outgoing;
+    UTsize                 outgoingSent;
+    utArray<loom_webSocketEventRecord> events;
+    utRandomNumberGenerator random;
+
+    // Only touched by the thread.
+    utArray<unsigned char> incoming;
+    utArray<unsigned char> message;
+    int                    messageOpcode;
+    int                    closeCode;
+    utString               closeReason;
+
+    loom_socketId_t        socket;
+#if LOOM_WEBSOCKET_CURL
+    CURL                   *curl;
+#endif
+
+    loom_webSocket() : port(0), secure(false), callback(NULL), payload(NULL), thread(NULL), quit(0), destroyed(false),
+        lock(NULL), state(WEBSOCKET_CONNECTING), closeStarted(0), outgoingSent(0), random(0),
+        messageOpcode(0), closeCode(1006), socket(NULL)
+    {
+#if LOOM_WEBSOCKET_CURL
+        curl = NULL;
+#endif
+    }
+};
+
+// Every open connection, for platform_webSocketUpdate.
+static utArray<loom_webSocket *> gWebSockets;
+
+// Destroyed from a callback while dispatching, freed once done.
+static utArray<loom_webSocket *> gWebSocketsDestroyed;
+static bool                      gWebSocketDispatching = false;
+
+/**************************************************************************
+ * SHA-1, only for checking the handshake's Sec-WebSocket-Accept.
+ *************************************************************************/
+
+static unsigned int sha1_rotate(unsigned int value, int bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+
+
+static void sha1_block(unsigned int state[5], const unsigned char *block)
+{
+    unsigned int w[80];
+    unsigned int a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+    for (int i = 0; i < 16; i++)
+    {
+        w[i] = (block[i * 4] << 24) | (block[i * 4 + 1] << 16) | (block[i * 4 + 2] << 8) | block[i * 4 + 3];
+    }
+
+    for (int i = 16; i < 80; i++)
+    {
+        w[i] = sha1_rotate(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    for (int i = 0; i < 80; i++)
+    {
+        unsigned int f, k;
+
+        if (i < 20)
+        {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        }
+        else if (i < 40)
+        {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        }
+        else if (i < 60)
+        {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        }
+        else
+        {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+
+        unsigned int t = sha1_rotate(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = sha1_rotate(b, 30);
+        b = a;
+        a = t;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+
+static void sha1(const unsigned char *data, size_t length, unsigned char digest[20])
+{
+    unsigned int  state[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    unsigned char tail[128];
+    size_t        full = length & ~(size_t)63;
+
+    for (size_t i = 0; i < full; i += 64)
+    {
+        sha1_block(state, data + i);
+    }
+
+    // The rest, a 1 bit, zeros and the length in bits.
+    size_t rest      = length - full;
+    size_t tailBytes = rest < 56 ? 64 : 128;
+
+    memset(tail, 0, sizeof(tail));
+    memcpy(tail, data + full, rest);
+    tail[rest] = 0x80;
+
+    unsigned long long bits = (unsigned long long)length * 8;
+    for (int i = 0; i < 8; i++)
+    {
+        tail[tailBytes - 1 - i] = (unsigned char)(bits >> (i * 8));
+    }
+
+    for (size_t i = 0; i < tailBytes; i += 64)
+    {
+        sha1_block(state, tail + i);
+    }
+
+    for (int i = 0; i < 20; i++)
+    {
+        digest[i] = (unsigned char)(state[i / 4] >> (24 - (i % 4) * 8));
+    }
+}
+
+
+void platform_webSocketAcceptKey(const char *key, utString& accept)
+{
+    static const char *guid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+    utString      keyed = utString(key) + guid;
+    unsigned char digest[20];
+    char          encoded[32];
+
+    sha1((const unsigned char *)keyed.c_str(), keyed.length(), digest);
+
+    UTsize encodedLength = utBase64::encodedLength(sizeof(digest));
+    utBase64::encode(digest, sizeof(digest), encoded);
+    encoded[encodedLength] = 0;
+
+    accept = encoded;
+}
+
+
+/**************************************************************************
+ * Transport, a curl connection where curl provides TLS, else a socket.
+ *************************************************************************/
+
+static bool webSocket_transportOpen(loom_webSocket *ws, utString& error)
+{
+#if LOOM_WEBSOCKET_CURL
+    char url[512];
+
+    // CONNECT_ONLY stops after connecting, and the TLS handshake for https.
+    snprintf(url, sizeof(url), "%s://%s:%d/", ws->secure ? "https" : "http", ws->host.c_str(), ws->port);
+
+    ws->curl = curl_easy_init();
+    curl_easy_setopt(ws->curl, CURLOPT_URL, url);
+    curl_easy_setopt(ws->curl, CURLOPT_CONNECT_ONLY, 1L);
+    curl_easy_setopt(ws->curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(ws->curl, CURLOPT_CONNECTTIMEOUT_MS, (long)WEBSOCKET_CONNECT_TIMEOUT_MS);
+
+    CURLcode result = curl_easy_perform(ws->curl);
+    if (result != CURLE_OK)
+    {
+        error = curl_easy_strerror(result);
+        return false;
+    }
+
+    curl_socket_t socket = CURL_SOCKET_BAD;
+#if LIBCURL_VERSION_NUM >= 0x072d00
+    CURLcode info = curl_easy_getinfo(ws->curl, CURLINFO_ACTIVESOCKET, &socket);
+#else
+    // The vendored 7.43 headers predate CURLINFO_ACTIVESOCKET, which is
+    // needed where a long can't hold a socket, e.g. 64-bit Windows
+    long lastSocket = -1;
+    CURLcode info = curl_easy_getinfo(ws->curl, CURLINFO_LASTSOCKET, &lastSocket);
+    if (lastSocket != -1)
+    {
+        socket = (curl_socket_t)lastSocket;
+    }
+#endif
+    if ((info != CURLE_OK) || (socket == CURL_SOCKET_BAD))
+    {
+        error = "no socket";
+        return false;
+    }
+
+    ws->socket = (loom_socketId_t)(size_t)socket;
+    return true;
+
+#else
+    if (ws->secure)
+    {
+        error = "wss:// needs TLS, which isn't available on this platform";
+        return false;
+    }
+
+    ws->socket = loom_net_openTCPSocket(ws->host.c_str(), ws->port, 0);
+    if (ws->socket == NULL)
+    {
+        error = "could not connect";
+        return false;
+    }
+
+    if (!(loom_net_waitSocket(ws->socket, LOOM_NET_WRITABLE, WEBSOCKET_CONNECT_TIMEOUT_MS) & LOOM_NET_WRITABLE) ||
+        loom_net_isSocketDead(ws->socket))
+    {
+        error = "could not connect";
+        return false;
+    }
+
+    return true;
+#endif
+}
+
+
+// Both return the bytes moved, 0 if it would block, -1 once closed.
+static int webSocket_transportSend(loom_webSocket *ws, const unsigned char *data, int length)
+{
+#if LOOM_WEBSOCKET_CURL
+    size_t   sent   = 0;
+    CURLcode result = curl_easy_send(ws->curl, data, length, &sent);
+
+    if (result == CURLE_AGAIN)
+    {
+        return 0;
+    }
+
+    return result == CURLE_OK ? (int)sent : -1;
+
+#else
+    return loom_net_sendSomeTCPSocket(ws->socket, data, length);
+#endif
+}
+
+
+static int webSocket_transportRecv(loom_webSocket *ws, unsigned char *data, int length)
+{
+#if LOOM_WEBSOCKET_CURL
+    size_t   received = 0;
+    CURLcode result   = curl_easy_recv(ws->curl, data, length, &received);
+
+    if (result == CURLE_AGAIN)
+    {
+        return 0;
+    }
+
+    // Nothing received without an error means it closed.
+    return (result == CURLE_OK) && (received > 0) ? (int)received : -1;
+
+#else
+    return loom_net_recvSomeTCPSocket(ws->socket, data, length);
+#endif
+}
+
+
+static void webSocket_transportClose(loom_webSocket *ws)
+{
+#if LOOM_WEBSOCKET_CURL
+    if (ws->curl != NULL)
+    {
+        curl_easy_cleanup(ws->curl);
+        ws->curl = NULL;
+    }
+
+#else
+    if (ws->socket != NULL)
+    {
+        loom_net_closeTCPSocket(ws->socket);
+    }
+#endif
+
+    ws->socket = NULL;
+}
+
+
+// Sends all of data, waiting while it would block, before the deadline.
+static bool webSocket_sendAll(loom_webSocket *ws, const unsigned char *data, int length, int deadline)
+{
+    while (length > 0)
+    {
+        int sent = webSocket_transportSend(ws, data, length);
+
+        if (sent < 0)
+        {
+            return false;
+        }
+
+        data   += sent;
+        length -= sent;
+
+        if ((sent == 0) && !(loom_net_waitSocket(ws->socket, LOOM_NET_WRITABLE, WEBSOCKET_WAIT_MS) & LOOM_NET_WRITABLE))
+        {
+            if ((platform_getMilliseconds() - deadline > 0) || atomic_load32(&ws->quit))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+/**************************************************************************
+ * Connection thread
+ *************************************************************************/
+
+static void webSocket_consume(utArray<unsigned char>& bytes, UTsize count)
+{
+    UTsize rest = bytes.size() - count;
+
+    if (rest > 0)
+    {
+        memmove(bytes.ptr(), bytes.ptr() + count, rest);
+    }
+
+    bytes.resize(rest);
+}
+
+
+static void webSocket_queueEvent(loom_webSocket *ws, loom_webSocketEvent event, const void *data, UTsize length, int code)
+{
+    loom_webSocketEventRecord record;
+
+    record.event = event;
+    record.code  = code;
+    record.data  = NULL;
+
+    if (event != LOOM_WEBSOCKET_OPEN)
+    {
+        record.data = lmNew(NULL) utByteArray();
+
+        // Room for a NUL, so text can be handed on as a C string.
+        record.data->reserve(length + 1);
+        record.data->resize(length + 1);
+        if (length > 0)
+        {
+            memcpy(record.data->getDataPtr(), data, length);
+        }
+
+        ((char *)record.data->getDataPtr())[length] = 0;
+        record.data->resize(length);
+    }
+
+    loom_mutex_lock(ws->lock);
+    ws->events.push_back(record);
+    loom_mutex_unlock(ws->lock);
+}
+
+
+static void webSocket_queueError(loom_webSocket *ws, const char *error)
+{
+    lmLogWarn(gWebSocketLogGroup, "%s:%d: %s", ws->host.c_str(), ws->port, error);
+    webSocket_queueEvent(ws, LOOM_WEBSOCKET_ERROR, error, (UTsize)strlen(error), 1006);
+}
+
+
+// Appends a masked frame to the outgoing bytes, called with the lock held.
+static void webSocket_queueFrame(loom_webSocket *ws, int opcode, const unsigned char *data, UTsize length)
+{
+    unsigned char header[14];
+    int           headerLength = 2;
+
+    header[0] = (unsigned char)(0x80 | opcode);
+
+    if (length < 126)
+    {
+        header[1] = (unsigned char)(0x80 | length);
+    }
+    else if (length < 65536)
+    {
+        header[1] = 0x80 | 126;
+        header[2] = (unsigned char)(length >> 8);
+        header[3] = (unsigned char)length;
+        headerLength = 4;
+    }
+    else
+    {
+        unsigned long long length64 = length;
+
+        header[1] = 0x80 | 127;
+        for (int i = 0; i < 8; i++)
+        {
+            header[2 + i] = (unsigned char)(length64 >> (56 - i * 8));
+        }
+        headerLength = 10;
+    }
+
+    // Clients mask everything they send with a fresh key.
+    UTuint32 key = ws->random.rand32();
+    memcpy(header + headerLength, &key, 4);
+    headerLength += 4;
+
+    UTsize start = ws->outgoing.size();
+    ws->outgoing.resize(start + headerLength + length);
+
+    unsigned char *out = ws->outgoing.ptr() + start;
+    memcpy(out, header, headerLength);
+    out += headerLength;
+
+    const unsigned char *mask = header + headerLength - 4;
+    for (UTsize i = 0; i < length; i++)
+    {
+        out[i] = data[i] ^ mask[i & 3];
+    }
+}
+
+
+static void webSocket_queueCloseFrame(loom_webSocket *ws, int code, const char *reason)
+{
+    unsigned char payload[125];
+    UTsize        reasonLength = reason != NULL ? (UTsize)strlen(reason) : 0;
+
+    // Control frames carry at most 125 bytes.
+    if (reasonLength > sizeof(payload) - 2)
+    {
+        reasonLength = sizeof(payload) - 2;
+    }
+
+    payload[0] = (unsigned char)(code >> 8);
+    payload[1] = (unsigned char)code;
+    if (reasonLength > 0)
+    {
+        memcpy(payload + 2, reason, reasonLength);
+    }
+
+    webSocket_queueFrame(ws, WEBSOCKET_OP_CLOSE, payload, 2 + reasonLength);
+}
+
+
+// Sends what it can of the outgoing bytes, called with the lock held.
+// Returns false once the connection failed.
+static bool webSocket_flush(loom_webSocket *ws)
+{
+    while (ws->outgoingSent < ws->outgoing.size())
+    {
+        int sent = webSocket_transportSend(ws, ws->outgoing.ptr() + ws->outgoingSent, ws->outgoing.size() - ws->outgoingSent);
+
+        if (sent < 0)
+        {
+            return false;
+        }
+
+        if (sent == 0)
+        {
+            return true;
+        }
+
+        ws->outgoingSent += sent;
+    }
+
+    ws->outgoing.clear();
+    ws->outgoingSent = 0;
+    return true;
+}
+
+
+static bool webSocket_handshake(loom_webSocket *ws, utString& error)
+{
+    unsigned char nonce[16];
+    char          key[32];
+    char          request[2048];
+
+    for (int i = 0; i < 16; i += 4)
+    {
+        UTuint32 value = ws->random.rand32();
+        memcpy(nonce + i, &value, 4);
+    }
+
+    UTsize keyLength = utBase64::encodedLength(sizeof(nonce));
+    utBase64::encode(nonce, sizeof(nonce), key);
+    key[keyLength] = 0;
+
+    bool defaultPort = ws->port == (ws->secure ? 443 : 80);
+    char portString[16];
+    snprintf(portString, sizeof(portString), ":%d", ws->port);
+
+    int requestLength = snprintf(request, sizeof(request),
+                                 "GET %s HTTP/1.1\r\n"
+                                 "Host: %s%s\r\n"
+                                 "Upgrade: websocket\r\n"
+                                 "Connection: Upgrade\r\n"
+                                 "Sec-WebSocket-Key: %s\r\n"
+                                 "Sec-WebSocket-Version: 13\r\n"
+                                 "%s%s%s"
+                                 "\r\n",
+                                 ws->path.c_str(), ws->host.c_str(), defaultPort ? "" : portString, key,
+                                 ws->protocols.length() ? "Sec-WebSocket-Protocol: " : "", ws->protocols.c_str(),
+                                 ws->protocols.length() ? "\r\n" : "");
+
+    if ((requestLength <= 0) || (requestLength >= (int)sizeof(request)))
+    {
+        error = "url too long";
+        return false;
+    }
+
+    int deadline = platform_getMilliseconds() + WEBSOCKET_CONNECT_TIMEOUT_MS;
+
+    if (!webSocket_sendAll(ws, (const unsigned char *)request, requestLength, deadline))
+    {
+        error = "could not send the handshake";
+        return false;
+    }
+
+    // Read up to the end of the response headers, anything after them is
+    // already the first frames.
+    int headerEnd = -1;
+    while (headerEnd < 0)
+    {
+        UTsize size = ws->incoming.size();
+
+        if (size >= WEBSOCKET_MAX_HEADER_SIZE)
+        {
+            error = "handshake response too large";
+            return false;
+        }
+
+        ws->incoming.resize(size + 1024);
+        int received = webSocket_transportRecv(ws, ws->incoming.ptr() + size, 1024);
+        ws->incoming.resize(size + (received > 0 ? received : 0));
+
+        if (received < 0)
+        {
+            error = "connection closed during the handshake";
+            return false;
+        }
+
+        if (received == 0)
+        {
+            if ((platform_getMilliseconds() - deadline > 0) || atomic_load32(&ws->quit))
+            {
+                error = "handshake timed out";
+                return false;
+            }
+
+            loom_net_waitSocket(ws->socket, LOOM_NET_READABLE, WEBSOCKET_WAIT_MS);
+            continue;
+        }
+
+        for (UTsize i = size >= 3 ? size - 3 : 0; i + 3 < ws->incoming.size(); i++)
+        {
+            if (!memcmp(ws->incoming.ptr() + i, "\r\n\r\n", 4))
+            {
+                headerEnd = (int)i + 4;
+                break;
+            }
+        }
+    }
+
+    // Header names are case insensitive, so look for them lowercased.
+    utString headers;
+    headers.assign((const char *)ws->incoming.ptr(), headerEnd);
+    for (UTsize i = 0; i < headers.length(); i++)
+    {
+        ((char *)headers.c_str())[i] = (char)tolower((unsigned char)headers[i]);
+    }
+
+    if (strncmp(headers.c_str(), "http/1.1 101", 12))
+    {
+        const char *lineEnd = strstr(headers.c_str(), "\r\n");
+        error.assign((const char *)ws->incoming.ptr(), (int)(lineEnd - headers.c_str()));
+        return false;
+    }
+
+    utString expected;
+    platform_webSocketAcceptKey(key, expected);
+
+    const char *accept = strstr(headers.c_str(), "\r\nsec-websocket-accept:");
+    if (accept == NULL)
+    {
+        error = "no Sec-WebSocket-Accept in the handshake";
+        return false;
+    }
+
+    // The value itself is case sensitive, so take it from the original.
+    const char *value = (const char *)ws->incoming.ptr() + (accept - headers.c_str()) + 23;
+    while (*value == ' ' || *value == '\t')
+    {
+        value++;
+    }
+
+    if (strncmp(value, expected.c_str(), expected.length()))
+    {
+        error = "wrong Sec-WebSocket-Accept in the handshake";
+        return false;
+    }
+
+    webSocket_consume(ws->incoming, headerEnd);
+    return true;
+}
+
+
+static void webSocket_handleFrame(loom_webSocket *ws, int fin, int opcode, const unsigned char *payload, UTsize length)
+{
+    switch (opcode)
+    {
+    case WEBSOCKET_OP_TEXT:
+    case WEBSOCKET_OP_BINARY:
+    case WEBSOCKET_OP_CONTINUATION:
+        if (opcode != WEBSOCKET_OP_CONTINUATION)
+        {
+            ws->messageOpcode = opcode;
+            ws->message.clear();
+        }
+
+        if (fin && (opcode != WEBSOCKET_OP_CONTINUATION))
+        {
+            // Unfragmented, straight from the receive buffer.
+            webSocket_queueEvent(ws, opcode == WEBSOCKET_OP_TEXT ? LOOM_WEBSOCKET_TEXT : LOOM_WEBSOCKET_BINARY, payload, length, 0);
+            break;
+        }
+
+        if (length > 0)
+        {
+            UTsize start = ws->message.size();
+            ws->message.resize(start + length);
+            memcpy(ws->message.ptr() + start, payload, length);
+        }
+
+        if (fin)
+        {
+            webSocket_queueEvent(ws, ws->messageOpcode == WEBSOCKET_OP_TEXT ? LOOM_WEBSOCKET_TEXT : LOOM_WEBSOCKET_BINARY, ws->message.ptr(), ws->message.size(), 0);
+            ws->message.clear();
+        }
+        break;
+
+    case WEBSOCKET_OP_PING:
+        loom_mutex_lock(ws->lock);
+        if (ws->state == WEBSOCKET_OPEN)
+        {
+            webSocket_queueFrame(ws, WEBSOCKET_OP_PONG, payload, length);
+        }
+        loom_mutex_unlock(ws->lock);
+        break;
+
+    case WEBSOCKET_OP_CLOSE:
+        ws->closeCode = length >= 2 ? (payload[0] << 8) | payload[1] : 1005;
+        if (length > 2)
+        {
+            ws->closeReason.assign((const char *)payload + 2, (int)(length - 2));
+        }
+
+        // Answer a close the server started, then it's done either way.
+        loom_mutex_lock(ws->lock);
+        if (ws->state == WEBSOCKET_OPEN)
+        {
+            webSocket_queueFrame(ws, WEBSOCKET_OP_CLOSE, payload, length >= 2 ? 2 : 0);
+        }
+        ws->state = WEBSOCKET_CLOSED;
+        loom_mutex_unlock(ws->lock);
+        break;
+
+    default:
+        break;
+    }
+}
+
+
+// Handles the whole frames received, returns false on a protocol error.
+static bool webSocket_parseFrames(loom_webSocket *ws)
+{
+    UTsize offset = 0;
+
+    for ( ; ; )
+    {
+        UTsize               available = ws->incoming.size() - offset;
+        const unsigned char *frame     = ws->incoming.ptr() + offset;
+
+        if (available < 2)
+        {
+            break;
+        }
+
+        int                fin          = frame[0] & 0x80;
+        int                opcode       = frame[0] & 0x0F;
+        int                masked       = frame[1] & 0x80;
+        unsigned long long length       = frame[1] & 0x7F;
+        UTsize             headerLength = 2;
+
+        if (length == 126)
+        {
+            if (available < 4)
+            {
+                break;
+            }
+
+            length       = (frame[2] << 8) | frame[3];
+            headerLength = 4;
+        }
+        else if (length == 127)
+        {
+            if (available < 10)
+            {
+                break;
+            }
+
+            length = 0;
+            for (int i = 0; i < 8; i++)
+            {
+                length = (length << 8) | frame[2 + i];
+            }
+            headerLength = 10;
+        }
+
+        if (length + ws->message.size() > WEBSOCKET_MAX_MESSAGE_SIZE)
+        {
+            return false;
+        }
+
+        // Servers don't mask, but accept it if one does.
+        if (masked)
+        {
+            headerLength += 4;
+        }
+
+        if (available < headerLength + length)
+        {
+            break;
+        }
+
+        unsigned char *payload = ws->incoming.ptr() + offset + headerLength;
+        if (masked)
+        {
+            const unsigned char *mask = payload - 4;
+            for (UTsize i = 0; i < length; i++)
+            {
+                payload[i] ^= mask[i & 3];
+            }
+        }
+
+        webSocket_handleFrame(ws, fin, opcode, payload, (UTsize)length);
+        offset += headerLength + (UTsize)length;
+    }
+
+    if (offset > 0)
+    {
+        webSocket_consume(ws->incoming, offset);
+    }
+
+    return true;
+}
+
+
+static int __stdcall webSocket_threadMain(void *param)
+{
+    loom_webSocket *ws = (loom_webSocket *)param;
+    utString       error;
+
+    loom_thread_setDebugName("WebSocket");
+
+    if (!webSocket_transportOpen(ws, error) || !webSocket_handshake(ws, error))
+    {
+        webSocket_queueError(ws, error.c_str());
+        webSocket_transportClose(ws);
+        webSocket_queueEvent(ws, LOOM_WEBSOCKET_CLOSED, "", 0, 1006);
+        return 0;
+    }
+
+    loom_mutex_lock(ws->lock);
+    ws->state = ws->closeStarted ? WEBSOCKET_CLOSING : WEBSOCKET_OPEN;
+    loom_mutex_unlock(ws->lock);
+
+    webSocket_queueEvent(ws, LOOM_WEBSOCKET_OPEN, NULL, 0, 0);
+
+    bool failed = false;
+
+    while (!atomic_load32(&ws->quit))
+    {
+        // Take in what arrived.
+        for ( ; ; )
+        {
+            UTsize size = ws->incoming.size();
+            ws->incoming.resize(size + WEBSOCKET_RECEIVE_SIZE);
+
+            loom_mutex_lock(ws->lock);
+            int received = webSocket_transportRecv(ws, ws->incoming.ptr() + size, WEBSOCKET_RECEIVE_SIZE);
+            loom_mutex_unlock(ws->lock);
+
+            ws->incoming.resize(size + (received > 0 ? received : 0));
+
+            if (received < 0)
+            {
+                failed = true;
+            }
+
+            if (received <= 0)
+            {
+                break;
+            }
+        }
+
+        if (!webSocket_parseFrames(ws))
+        {
+            webSocket_queueError(ws, "message too large");
+            ws->closeCode = 1009;
+            failed        = true;
+        }
+
+        loom_mutex_lock(ws->lock);
+
+        if (!webSocket_flush(ws))
+        {
+            failed = true;
+        }
+
+        bool pending  = ws->outgoing.size() > 0;
+        bool finished = failed || ((ws->state == WEBSOCKET_CLOSED) && !pending) ||
+                        ((ws->state == WEBSOCKET_CLOSING) && (platform_getMilliseconds() - ws->closeStarted > WEBSOCKET_CLOSE_TIMEOUT_MS));
+
+        loom_mutex_unlock(ws->lock);
+
+        if (finished)
+        {
+            break;
+        }
+
+        loom_net_waitSocket(ws->socket, LOOM_NET_READABLE | (pending ? LOOM_NET_WRITABLE : 0), WEBSOCKET_WAIT_MS);
+    }
+
+    loom_mutex_lock(ws->lock);
+    if (failed && (ws->state != WEBSOCKET_CLOSED))
+    {
+        ws->closeCode = ws->closeCode == 1009 ? 1009 : 1006;
+    }
+    ws->state = WEBSOCKET_CLOSED;
+    webSocket_transportClose(ws);
+    loom_mutex_unlock(ws->lock);
+
+    webSocket_queueEvent(ws, LOOM_WEBSOCKET_CLOSED, ws->closeReason.c_str(), (UTsize)ws->closeReason.length(), ws->closeCode);
+    return 0;
+}
+
+
+/**************************************************************************
+ * Main thread API
+ *************************************************************************/
+
+static bool webSocket_parseUrl(loom_webSocket *ws, const char *url)
+{
+    const char *rest;
+
+    if (!strncmp(url, "ws://", 5))
+    {
+        ws->secure = false;
+        ws->port   = 80;
+        rest       = url + 5;
+    }
+    else if (!strncmp(url, "wss://", 6))
+    {
+        ws->secure = true;
+        ws->port   = 443;
+        rest       = url + 6;
+    }
+    else
+    {
+        return false;
+    }
+
+    const char *hostEnd = rest;
+    while (*hostEnd && (*hostEnd != ':') && (*hostEnd != '/') && (*hostEnd != '?'))
+    {
+        hostEnd++;
+    }
+
+    if (hostEnd == rest)
+    {
+        return false;
+    }
+
+    ws->host.assign(rest, (int)(hostEnd - rest));
+
+    const char *pathStart = hostEnd;
+    if (*hostEnd == ':')
+    {
+        int port = atoi(hostEnd + 1);
+        if ((port <= 0) || (port > 65535))
+        {
+            return false;
+        }
+
+        ws->port = (unsigned short)port;
+
+        pathStart = hostEnd + 1;
+        while (*pathStart && (*pathStart != '/') && (*pathStart != '?'))
+        {
+            pathStart++;
+        }
+    }
+
+    if (*pathStart == '/')
+    {
+        ws->path = pathStart;
+    }
+    else
+    {
+        ws->path = utString("/") + pathStart;
+    }
+
+    return true;
+}
+
+
+loom_webSocket *platform_webSocketOpen(const char *url, const char *protocols, loom_webSocketCallback callback, void *payload)
+{
+    loom_webSocket *ws = lmNew(NULL) loom_webSocket();
+
+    if ((url == NULL) || !webSocket_parseUrl(ws, url))
+    {
+        lmLogError(gWebSocketLogGroup, "Can't connect to '%s', not a ws:// or wss:// url", url ? url : "");
+        lmDelete(NULL, ws);
+        return NULL;
+    }
+
+    ws->protocols = protocols != NULL ? protocols : "";
+    ws->callback  = callback;
+    ws->payload   = payload;
+    ws->lock      = loom_mutex_create();
+    ws->random.setSeed((UTuint32)platform_getMilliseconds() ^ (UTuint32)(size_t)ws);
+
+    gWebSockets.push_back(ws);
+
+    ws->thread = loom_thread_startWithHint(webSocket_threadMain, ws, LOOM_THREAD_BACKGROUND);
+    return ws;
+}
+
+
+bool platform_webSocketSend(loom_webSocket *ws, const void *data, int length, bool binary)
+{
+    bool queued = false;
+
+    loom_mutex_lock(ws->lock);
+
+    if ((ws->state == WEBSOCKET_CONNECTING) || (ws->state == WEBSOCKET_OPEN))
+    {
+        webSocket_queueFrame(ws, binary ? WEBSOCKET_OP_BINARY : WEBSOCKET_OP_TEXT, (const unsigned char *)data, length);
+
+        // Send right away if possible, the thread sends the rest.
+        if (ws->state == WEBSOCKET_OPEN)
+        {
+            webSocket_flush(ws);
+        }
+
+        queued = true;
+    }
+
+    loom_mutex_unlock(ws->lock);
+
+    return queued;
+}
+
+
+void platform_webSocketClose(loom_webSocket *ws, int code, const char *reason)
+{
+    loom_mutex_lock(ws->lock);
+
+    if ((ws->state == WEBSOCKET_CONNECTING) || (ws->state == WEBSOCKET_OPEN))
+    {
+        ws->closeCode = code;
+        if (reason != NULL)
+        {
+            ws->closeReason = reason;
+        }
+
+        webSocket_queueCloseFrame(ws, code, reason);
+        ws->closeStarted = platform_getMilliseconds();
+        if (ws->closeStarted == 0)
+        {
+            ws->closeStarted = 1;
+        }
+
+        if (ws->state == WEBSOCKET_OPEN)
+        {
+            ws->state = WEBSOCKET_CLOSING;
+            webSocket_flush(ws);
+        }
+    }
+
+    loom_mutex_unlock(ws->lock);
+}
+
+
+bool platform_webSocketIsOpen(loom_webSocket *ws)
+{
+    loom_mutex_lock(ws->lock);
+    bool open = ws->state == WEBSOCKET_OPEN;
+    loom_mutex_unlock(ws->lock);
+
+    return open;
+}
+
+
+static void webSocket_free(loom_webSocket *ws)
+{
+    for (UTsize i = 0; i < ws->events.size(); i++)
+    {
+        lmDelete(NULL, ws->events[i].data);
+    }
+
+    loom_mutex_destroy(ws->lock);
+    lmDelete(NULL, ws);
+}
+
+
+void platform_webSocketDestroy(loom_webSocket *ws)
+{
+    if ((ws == NULL) || ws->destroyed)
+    {
+        return;
+    }
+
+    ws->destroyed = true;
+
+    atomic_store32(&ws->quit, 1);
+    loom_thread_join(ws->thread);
+
+    gWebSockets.erase(ws, true);
+
+    // It may still be among the ones being dispatched.
+    if (gWebSocketDispatching)
+    {
+        gWebSocketsDestroyed.push_back(ws);
+    }
+    else
+    {
+        webSocket_free(ws);
+    }
+}
+
+
+void platform_webSocketUpdate()
+{
+    if (gWebSockets.size() == 0)
+    {
+        return;
+    }
+
+    // Callbacks may open and destroy connections, so go over a copy.
+    utArray<loom_webSocket *> sockets;
+    for (UTsize i = 0; i < gWebSockets.size(); i++)
+    {
+        sockets.push_back(gWebSockets[i]);
+    }
+
+    gWebSocketDispatching = true;
+
+    utArray<loom_webSocketEventRecord> events;
+
+    for (UTsize i = 0; i < sockets.size(); i++)
+    {
+        loom_webSocket *ws = sockets[i];
+
+        if (ws->destroyed)
+        {
+            continue;
+        }
+
+        loom_mutex_lock(ws->lock);
+        for (UTsize j = 0; j < ws->events.size(); j++)
+        {
+            events.push_back(ws->events[j]);
+        }
+        ws->events.clear();
+        loom_mutex_unlock(ws->lock);
+
+        for (UTsize j = 0; j < events.size(); j++)
+        {
+            if (!ws->destroyed)
+            {
+                ws->callback(ws->payload, events[j].event, events[j].data, events[j].code);
+            }
+
+            lmDelete(NULL, events[j].data);
+        }
+
+        events.clear();
+    }
+
+    gWebSocketDispatching = false;
+
+    for (UTsize i = 0; i < gWebSocketsDestroyed.size(); i++)
+    {
+        webSocket_free(gWebSocketsDestroyed[i]);
+    }
+
+    gWebSocketsDestroyed.clear();
+}
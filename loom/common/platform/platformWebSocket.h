@@ -0,0 +1,91 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _PLATFORM_PLATFORMWEBSOCKET_H_
+#define _PLATFORM_PLATFORMWEBSOCKET_H_
+
+#include "loom/common/utils/utString.h"
+#include "loom/common/utils/utByteArray.h"
+
+/**
+ * A WebSocket client, RFC 6455.
+ *
+ * Every connection does its I/O on a thread of its own, framing and
+ * unmasking included, and queues whole messages. platform_webSocketUpdate
+ * hands them to the callback on the main thread once a tick.
+ *
+ * wss:// goes through libcurl's TLS where Loom builds with it, on Windows
+ * and Linux. Elsewhere only ws:// connects.
+ */
+
+typedef enum
+{
+    LOOM_WEBSOCKET_OPEN,    // the handshake is done
+    LOOM_WEBSOCKET_TEXT,    // a text message, data is NUL terminated
+    LOOM_WEBSOCKET_BINARY,  // a binary message
+    LOOM_WEBSOCKET_CLOSED,  // closed with code, data holds the reason
+    LOOM_WEBSOCKET_ERROR    // failed, data holds why, CLOSED follows
+} loom_webSocketEvent;
+
+/**
+ * data is valid for the duration of the call, NULL for OPEN. code is the
+ * close code for CLOSED, 1006 when the connection was lost.
+ */
+typedef void (*loom_webSocketCallback)(void *payload, loom_webSocketEvent event, utByteArray *data, int code);
+
+struct loom_webSocket;
+
+/**
+ * Starts connecting to a ws:// or wss:// url. protocols, if not NULL or
+ * empty, is sent as Sec-WebSocket-Protocol. Returns NULL if the url can't
+ * be used, otherwise failing to connect is reported through callback.
+ */
+loom_webSocket *platform_webSocketOpen(const char *url, const char *protocols, loom_webSocketCallback callback, void *payload);
+
+/**
+ * Queues a message, sent as soon as the connection is open. Returns false
+ * once it's closing or closed.
+ */
+bool platform_webSocketSend(loom_webSocket *ws, const void *data, int length, bool binary);
+
+/**
+ * Starts the closing handshake, CLOSED is reported once it's done.
+ */
+void platform_webSocketClose(loom_webSocket *ws, int code, const char *reason);
+
+bool platform_webSocketIsOpen(loom_webSocket *ws);
+
+/**
+ * Drops the connection without a closing handshake and frees ws. The
+ * callback isn't called again.
+ */
+void platform_webSocketDestroy(loom_webSocket *ws);
+
+/**
+ * Delivers the queued events, call it from the main thread.
+ */
+void platform_webSocketUpdate();
+
+/**
+ * The Sec-WebSocket-Accept a server answers key with.
+ */
+void platform_webSocketAcceptKey(const char *key, utString& accept);
+
+#endif
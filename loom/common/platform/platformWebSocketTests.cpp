@@ -0,0 +1,607 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "seatest.h"
+#include "loom/common/platform/platformWebSocket.h"
+#include "loom/common/platform/platformNetwork.h"
+#include "loom/common/platform/platformThread.h"
+#include "loom/common/platform/platformTime.h"
+#include "loom/common/utils/utByteArray.h"
+
+SEATEST_FIXTURE(platformWebSocket)
+{
+    SEATEST_FIXTURE_ENTRY(platformWebSocket_acceptKey);
+    SEATEST_FIXTURE_ENTRY(platformWebSocket_badUrl);
+    SEATEST_FIXTURE_ENTRY(platformWebSocket_serverFrames);
+    SEATEST_FIXTURE_ENTRY(platformWebSocket_clientFrames);
+    SEATEST_FIXTURE_ENTRY(platformWebSocket_clientClose);
+    SEATEST_FIXTURE_ENTRY(platformWebSocket_serverClose);
+}
+
+static void ignoreEvent(void *payload, loom_webSocketEvent event, utByteArray *data, int code)
+{
+}
+
+
+SEATEST_TEST(platformWebSocket_acceptKey)
+{
+    // The example handshake from RFC 6455.
+    utString accept;
+    platform_webSocketAcceptKey("dGhlIHNhbXBsZSBub25jZQ==", accept);
+    assert_string_equal("s3pPLMBiTxaQ9kYGzzhZRbK+xOo=", accept.c_str());
+}
+
+
+SEATEST_TEST(platformWebSocket_badUrl)
+{
+    assert_true(platform_webSocketOpen("http://localhost/", NULL, ignoreEvent, NULL) == NULL);
+    assert_true(platform_webSocketOpen("ws://", NULL, ignoreEvent, NULL) == NULL);
+    assert_true(platform_webSocketOpen("ws://localhost:0/", NULL, ignoreEvent, NULL) == NULL);
+}
+
+
+/**************************************************************************
+ * Loopback server
+ *
+ * The tests play the server on their own thread, speaking raw frames to
+ * a real connection, and pump platform_webSocketUpdate for the events.
+ *************************************************************************/
+
+#define TEST_WEBSOCKET_PORT       12342
+#define TEST_WEBSOCKET_TIMEOUT_MS 5000
+
+struct TestWebSocketEvent
+{
+    loom_webSocketEvent    event;
+    utArray<unsigned char> data; // with a NUL after, to compare text
+    UTsize                 length;
+    int                    code;
+};
+
+static utArray<TestWebSocketEvent> gTestEvents;
+
+static void recordEvent(void *payload, loom_webSocketEvent event, utByteArray *data, int code)
+{
+    TestWebSocketEvent record;
+
+    record.event  = event;
+    record.code   = code;
+    record.length = data != NULL ? data->getSize() : 0;
+    record.data.resize(record.length + 1);
+    if (record.length > 0)
+    {
+        memcpy(record.data.ptr(), data->getDataPtr(), record.length);
+    }
+    record.data[record.length] = 0;
+
+    gTestEvents.push_back(record);
+}
+
+
+// Dispatches events until there are count of them, or it times out.
+static bool waitForEvents(UTsize count)
+{
+    int deadline = platform_getMilliseconds() + TEST_WEBSOCKET_TIMEOUT_MS;
+
+    while (gTestEvents.size() < count)
+    {
+        if (platform_getMilliseconds() - deadline > 0)
+        {
+            return false;
+        }
+
+        platform_webSocketUpdate();
+        loom_thread_sleep(1);
+    }
+
+    return true;
+}
+
+
+// Reads exactly length bytes, the accepted socket may be nonblocking.
+static bool serverRead(loom_socketId_t s, void *data, int length)
+{
+    int deadline = platform_getMilliseconds() + TEST_WEBSOCKET_TIMEOUT_MS;
+
+    while (length > 0)
+    {
+        int received = loom_net_recvSomeTCPSocket(s, data, length);
+
+        if (received < 0)
+        {
+            return false;
+        }
+
+        data    = (char *)data + received;
+        length -= received;
+
+        if ((received == 0) && !(loom_net_waitSocket(s, LOOM_NET_READABLE, 20) & LOOM_NET_READABLE))
+        {
+            if (platform_getMilliseconds() - deadline > 0)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+static bool serverWrite(loom_socketId_t s, const void *data, int length)
+{
+    int deadline = platform_getMilliseconds() + TEST_WEBSOCKET_TIMEOUT_MS;
+
+    while (length > 0)
+    {
+        int sent = loom_net_sendSomeTCPSocket(s, data, length);
+
+        if (sent < 0)
+        {
+            return false;
+        }
+
+        data    = (const char *)data + sent;
+        length -= sent;
+
+        if ((sent == 0) && !(loom_net_waitSocket(s, LOOM_NET_WRITABLE, 20) & LOOM_NET_WRITABLE))
+        {
+            if (platform_getMilliseconds() - deadline > 0)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+// Writes a frame the way a server would, masked only if asked to.
+static bool serverWriteFrame(loom_socketId_t s, bool fin, int opcode, const void *data, UTsize length, bool masked)
+{
+    utArray<unsigned char> frame;
+    unsigned char          header[14];
+    int                    headerLength = 2;
+
+    header[0] = (unsigned char)((fin ? 0x80 : 0) | opcode);
+
+    if (length < 126)
+    {
+        header[1] = (unsigned char)length;
+    }
+    else if (length < 65536)
+    {
+        header[1] = 126;
+        header[2] = (unsigned char)(length >> 8);
+        header[3] = (unsigned char)length;
+        headerLength = 4;
+    }
+    else
+    {
+        unsigned long long length64 = length;
+
+        header[1] = 127;
+        for (int i = 0; i < 8; i++)
+        {
+            header[2 + i] = (unsigned char)(length64 >> (56 - i * 8));
+        }
+        headerLength = 10;
+    }
+
+    static const unsigned char mask[4] = { 0x37, 0xfa, 0x21, 0x3d };
+    if (masked)
+    {
+        header[1] |= 0x80;
+        memcpy(header + headerLength, mask, 4);
+        headerLength += 4;
+    }
+
+    frame.resize(headerLength + length);
+    memcpy(frame.ptr(), header, headerLength);
+    for (UTsize i = 0; i < length; i++)
+    {
+        unsigned char byte = ((const unsigned char *)data)[i];
+        frame[headerLength + i] = masked ? byte ^ mask[i & 3] : byte;
+    }
+
+    return serverWrite(s, frame.ptr(), (int)frame.size());
+}
+
+
+struct TestWebSocketFrame
+{
+    int                    fin;
+    int                    opcode;
+    int                    masked;
+    int                    lengthBytes; // 0, 2 or 8 bytes of extended length
+    utArray<unsigned char> payload;
+};
+
+// Reads a frame from the client and unmasks it.
+static bool serverReadFrame(loom_socketId_t s, TestWebSocketFrame& frame)
+{
+    unsigned char header[2];
+
+    if (!serverRead(s, header, 2))
+    {
+        return false;
+    }
+
+    frame.fin         = (header[0] & 0x80) != 0;
+    frame.opcode      = header[0] & 0x0F;
+    frame.masked      = (header[1] & 0x80) != 0;
+    frame.lengthBytes = 0;
+
+    unsigned long long length = header[1] & 0x7F;
+    if ((length == 126) || (length == 127))
+    {
+        unsigned char extended[8];
+
+        frame.lengthBytes = length == 126 ? 2 : 8;
+        if (!serverRead(s, extended, frame.lengthBytes))
+        {
+            return false;
+        }
+
+        length = 0;
+        for (int i = 0; i < frame.lengthBytes; i++)
+        {
+            length = (length << 8) | extended[i];
+        }
+    }
+
+    unsigned char mask[4] = { 0, 0, 0, 0 };
+    if (frame.masked && !serverRead(s, mask, 4))
+    {
+        return false;
+    }
+
+    frame.payload.resize((UTsize)length);
+    if ((length > 0) && !serverRead(s, frame.payload.ptr(), (int)length))
+    {
+        return false;
+    }
+
+    for (UTsize i = 0; i < frame.payload.size(); i++)
+    {
+        frame.payload[i] ^= mask[i & 3];
+    }
+
+    return true;
+}
+
+
+// Accepts the client and answers its upgrade request.
+static loom_socketId_t serverAccept(loom_socketId_t listenSocket)
+{
+    loom_socketId_t s        = NULL;
+    int             deadline = platform_getMilliseconds() + TEST_WEBSOCKET_TIMEOUT_MS;
+
+    while ((s == NULL) || (s == (loom_socketId_t)(size_t)-1))
+    {
+        if (platform_getMilliseconds() - deadline > 0)
+        {
+            return NULL;
+        }
+
+        loom_net_waitSocket(listenSocket, LOOM_NET_READABLE, 20);
+        s = loom_net_acceptTCPSocket(listenSocket);
+    }
+
+    char request[4096];
+    int  length = 0;
+    while (length < 4 || memcmp(request + length - 4, "\r\n\r\n", 4))
+    {
+        if ((length == (int)sizeof(request) - 1) || !serverRead(s, request + length, 1))
+        {
+            loom_net_closeTCPSocket(s);
+            return NULL;
+        }
+
+        length++;
+    }
+    request[length] = 0;
+
+    const char *key = strstr(request, "Sec-WebSocket-Key: ");
+    if (key == NULL)
+    {
+        loom_net_closeTCPSocket(s);
+        return NULL;
+    }
+
+    key += 19;
+    utString nonce;
+    nonce.assign(key, (int)(strstr(key, "\r\n") - key));
+
+    utString accept;
+    platform_webSocketAcceptKey(nonce.c_str(), accept);
+
+    char response[512];
+    int  responseLength = snprintf(response, sizeof(response),
+                                   "HTTP/1.1 101 Switching Protocols\r\n"
+                                   "Upgrade: websocket\r\n"
+                                   "Connection: Upgrade\r\n"
+                                   "Sec-WebSocket-Accept: %s\r\n"
+                                   "\r\n", accept.c_str());
+
+    if (!serverWrite(s, response, responseLength))
+    {
+        loom_net_closeTCPSocket(s);
+        return NULL;
+    }
+
+    return s;
+}
+
+
+// Connects a client to the loopback server, and waits for it to open.
+static loom_webSocket *openLoopback(loom_socketId_t listenSocket, loom_socketId_t& server)
+{
+    char url[64];
+    snprintf(url, sizeof(url), "ws://127.0.0.1:%d/loopback", TEST_WEBSOCKET_PORT);
+
+    gTestEvents.clear();
+
+    loom_webSocket *ws = platform_webSocketOpen(url, NULL, recordEvent, NULL);
+    server = ws != NULL ? serverAccept(listenSocket) : NULL;
+
+    if ((server == NULL) || !waitForEvents(1) || (gTestEvents[0].event != LOOM_WEBSOCKET_OPEN))
+    {
+        platform_webSocketDestroy(ws);
+        return NULL;
+    }
+
+    return ws;
+}
+
+
+static void fillPattern(utArray<unsigned char>& bytes, UTsize length)
+{
+    bytes.resize(length);
+    for (UTsize i = 0; i < length; i++)
+    {
+        bytes[i] = (unsigned char)(i * 7 + (i >> 8));
+    }
+}
+
+
+SEATEST_TEST(platformWebSocket_serverFrames)
+{
+    loom_net_initialize();
+
+    loom_socketId_t listenSocket = loom_net_listenTCPSocket(TEST_WEBSOCKET_PORT);
+    loom_socketId_t server       = NULL;
+    loom_webSocket  *ws          = openLoopback(listenSocket, server);
+
+    assert_true(ws != NULL);
+    if (ws == NULL)
+    {
+        loom_net_closeTCPSocket(listenSocket);
+        loom_net_shutdown();
+        return;
+    }
+
+    utArray<unsigned char> medium;
+    utArray<unsigned char> large;
+    fillPattern(medium, 300);
+    fillPattern(large, 70000);
+
+    // Unmasked as servers send them, and masked which is tolerated.
+    assert_true(serverWriteFrame(server, true, 0x1, "plain", 5, false));
+    assert_true(serverWriteFrame(server, true, 0x1, "masked", 6, true));
+
+    // Lengths that need the 16 and 64 bit forms.
+    assert_true(serverWriteFrame(server, true, 0x2, medium.ptr(), medium.size(), false));
+    assert_true(serverWriteFrame(server, true, 0x2, large.ptr(), large.size(), false));
+
+    // A fragmented message with control frames between the fragments.
+    assert_true(serverWriteFrame(server, false, 0x1, "frag", 4, false));
+    assert_true(serverWriteFrame(server, true, 0x9, "ping", 4, false));
+    assert_true(serverWriteFrame(server, false, 0x0, "men", 3, true));
+    assert_true(serverWriteFrame(server, true, 0xA, "pong", 4, false));
+    assert_true(serverWriteFrame(server, true, 0x0, "ted", 3, false));
+
+    assert_true(waitForEvents(6));
+    assert_int_equal(6, gTestEvents.size());
+
+    if (gTestEvents.size() == 6)
+    {
+        assert_int_equal(LOOM_WEBSOCKET_TEXT, gTestEvents[1].event);
+        assert_string_equal("plain", (const char *)gTestEvents[1].data.ptr());
+
+        assert_int_equal(LOOM_WEBSOCKET_TEXT, gTestEvents[2].event);
+        assert_string_equal("masked", (const char *)gTestEvents[2].data.ptr());
+
+        assert_int_equal(LOOM_WEBSOCKET_BINARY, gTestEvents[3].event);
+        assert_int_equal(medium.size(), gTestEvents[3].length);
+        assert_true(!memcmp(medium.ptr(), gTestEvents[3].data.ptr(), medium.size()));
+
+        assert_int_equal(LOOM_WEBSOCKET_BINARY, gTestEvents[4].event);
+        assert_int_equal(large.size(), gTestEvents[4].length);
+        assert_true(!memcmp(large.ptr(), gTestEvents[4].data.ptr(), large.size()));
+
+        assert_int_equal(LOOM_WEBSOCKET_TEXT, gTestEvents[5].event);
+        assert_string_equal("fragmented", (const char *)gTestEvents[5].data.ptr());
+    }
+
+    // The ping was answered mid message, with its payload.
+    TestWebSocketFrame frame;
+    assert_true(serverReadFrame(server, frame));
+    assert_true(frame.fin);
+    assert_true(frame.masked);
+    assert_int_equal(0xA, frame.opcode);
+    assert_int_equal(4, frame.payload.size());
+    assert_true(frame.payload.size() == 4 && !memcmp(frame.payload.ptr(), "ping", 4));
+
+    platform_webSocketDestroy(ws);
+    loom_net_closeTCPSocket(server);
+    loom_net_closeTCPSocket(listenSocket);
+
+    loom_net_shutdown();
+}
+
+
+SEATEST_TEST(platformWebSocket_clientFrames)
+{
+    loom_net_initialize();
+
+    loom_socketId_t listenSocket = loom_net_listenTCPSocket(TEST_WEBSOCKET_PORT);
+    loom_socketId_t server       = NULL;
+    loom_webSocket  *ws          = openLoopback(listenSocket, server);
+
+    assert_true(ws != NULL);
+    if (ws == NULL)
+    {
+        loom_net_closeTCPSocket(listenSocket);
+        loom_net_shutdown();
+        return;
+    }
+
+    utArray<unsigned char> medium;
+    utArray<unsigned char> large;
+    fillPattern(medium, 300);
+    fillPattern(large, 70000);
+
+    assert_true(platform_webSocketSend(ws, "hello", 5, false));
+    assert_true(platform_webSocketSend(ws, medium.ptr(), (int)medium.size(), true));
+    assert_true(platform_webSocketSend(ws, large.ptr(), (int)large.size(), true));
+
+    // Everything a client sends is masked.
+    TestWebSocketFrame frame;
+    assert_true(serverReadFrame(server, frame));
+    assert_true(frame.fin && frame.masked);
+    assert_int_equal(0x1, frame.opcode);
+    assert_int_equal(0, frame.lengthBytes);
+    assert_true(frame.payload.size() == 5 && !memcmp(frame.payload.ptr(), "hello", 5));
+
+    assert_true(serverReadFrame(server, frame));
+    assert_true(frame.fin && frame.masked);
+    assert_int_equal(0x2, frame.opcode);
+    assert_int_equal(2, frame.lengthBytes);
+    assert_true(frame.payload.size() == medium.size() && !memcmp(frame.payload.ptr(), medium.ptr(), medium.size()));
+
+    assert_true(serverReadFrame(server, frame));
+    assert_true(frame.fin && frame.masked);
+    assert_int_equal(0x2, frame.opcode);
+    assert_int_equal(8, frame.lengthBytes);
+    assert_true(frame.payload.size() == large.size() && !memcmp(frame.payload.ptr(), large.ptr(), large.size()));
+
+    platform_webSocketDestroy(ws);
+    loom_net_closeTCPSocket(server);
+    loom_net_closeTCPSocket(listenSocket);
+
+    loom_net_shutdown();
+}
+
+
+SEATEST_TEST(platformWebSocket_clientClose)
+{
+    loom_net_initialize();
+
+    loom_socketId_t listenSocket = loom_net_listenTCPSocket(TEST_WEBSOCKET_PORT);
+    loom_socketId_t server       = NULL;
+    loom_webSocket  *ws          = openLoopback(listenSocket, server);
+
+    assert_true(ws != NULL);
+    if (ws == NULL)
+    {
+        loom_net_closeTCPSocket(listenSocket);
+        loom_net_shutdown();
+        return;
+    }
+
+    platform_webSocketClose(ws, 1000, "bye");
+    assert_true(!platform_webSocketIsOpen(ws));
+
+    // The close frame carries the code and the reason.
+    TestWebSocketFrame frame;
+    assert_true(serverReadFrame(server, frame));
+    assert_true(frame.fin && frame.masked);
+    assert_int_equal(0x8, frame.opcode);
+    assert_true(frame.payload.size() == 5 && !memcmp(frame.payload.ptr(), "\x03\xe8" "bye", 5));
+
+    // Nothing goes out once closing.
+    assert_true(!platform_webSocketSend(ws, "late", 4, false));
+
+    // The server answers, which finishes it.
+    assert_true(serverWriteFrame(server, true, 0x8, "\x03\xe8", 2, false));
+
+    assert_true(waitForEvents(2));
+    if (gTestEvents.size() == 2)
+    {
+        assert_int_equal(LOOM_WEBSOCKET_CLOSED, gTestEvents[1].event);
+        assert_int_equal(1000, gTestEvents[1].code);
+        assert_string_equal("bye", (const char *)gTestEvents[1].data.ptr());
+    }
+
+    platform_webSocketDestroy(ws);
+    loom_net_closeTCPSocket(server);
+    loom_net_closeTCPSocket(listenSocket);
+
+    loom_net_shutdown();
+}
+
+
+SEATEST_TEST(platformWebSocket_serverClose)
+{
+    loom_net_initialize();
+
+    loom_socketId_t listenSocket = loom_net_listenTCPSocket(TEST_WEBSOCKET_PORT);
+    loom_socketId_t server       = NULL;
+    loom_webSocket  *ws          = openLoopback(listenSocket, server);
+
+    assert_true(ws != NULL);
+    if (ws == NULL)
+    {
+        loom_net_closeTCPSocket(listenSocket);
+        loom_net_shutdown();
+        return;
+    }
+
+    assert_true(serverWriteFrame(server, true, 0x8, "\x03\xe9" "away", 6, false));
+
+    // The client echoes the code, then reports the server's close.
+    TestWebSocketFrame frame;
+    assert_true(serverReadFrame(server, frame));
+    assert_true(frame.fin && frame.masked);
+    assert_int_equal(0x8, frame.opcode);
+    assert_true(frame.payload.size() == 2 && !memcmp(frame.payload.ptr(), "\x03\xe9", 2));
+
+    assert_true(waitForEvents(2));
+    if (gTestEvents.size() == 2)
+    {
+        assert_int_equal(LOOM_WEBSOCKET_CLOSED, gTestEvents[1].event);
+        assert_int_equal(1001, gTestEvents[1].code);
+        assert_string_equal("away", (const char *)gTestEvents[1].data.ptr());
+    }
+
+    assert_true(!platform_webSocketIsOpen(ws));
+
+    platform_webSocketDestroy(ws);
+    loom_net_closeTCPSocket(server);
+    loom_net_closeTCPSocket(listenSocket);
+
+    loom_net_shutdown();
+}
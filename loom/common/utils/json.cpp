@@ -20,6 +20,7 @@
 
 #include "loom/common/utils/json.h"
 #include "loom/common/core/allocator.h"
+#include "loom/common/utils/utByteArray.h"
 
 static void *jsonAlloc(size_t size)
 {
@@ -84,6 +85,36 @@ bool JSON::loadString(const char *json)
 
     _json = json_loads(json, JSON_DISABLE_EOF_CHECK, &_error);
 
+    setLoadError();
+
+    if (_json) _root = true;
+
+    return _json == NULL ? false : true;
+}
+
+bool JSON::loadBytes(utByteArray *bytes)
+{
+    clear();
+
+    if (!bytes)
+    {
+        _errorMsg = "JSON Error: null ByteArray";
+        return false;
+    }
+
+    const char *data = (const char *)bytes->getDataPtr() + bytes->getPosition();
+
+    _json = json_loadb(data, bytes->bytesAvailable(), JSON_DISABLE_EOF_CHECK, &_error);
+
+    setLoadError();
+
+    if (_json) _root = true;
+
+    return _json == NULL ? false : true;
+}
+
+void JSON::setLoadError()
+{
     if (!_json)
     {
         char message[1024];
@@ -98,10 +129,6 @@ bool JSON::loadString(const char *json)
     {
         _errorMsg = "";
     }
-
-    if (_json) _root = true;
-
-    return _json == NULL ? false : true;
 }
 
 const char *JSON::serialize()
@@ -24,6 +24,8 @@
 #include "jansson.h"
 #include "loom/common/utils/utString.h"
 
+class utByteArray;
+
 class JSON {
     // The native _json object
     json_t *_json;
@@ -33,6 +35,8 @@ class JSON {
     utString     _errorMsg;
     bool         _root;
 
+    void setLoadError();
+
 public:
 
     JSON();
@@ -42,6 +46,9 @@ public:
     bool initObject();
     bool initArray();
     bool loadString(const char *json);
+    // Parses the bytes from the current position on, without copying them
+    // into a String first.
+    bool loadBytes(utByteArray *bytes);
     const char *serialize();
     const char *getError();
     int getJSONType();
@@ -0,0 +1,504 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "loom/common/utils/jsonReader.h"
+
+JSONReader::JSONReader(const char *json, UTsize length) :
+    m_json(json), m_length(length), m_pos(0), m_state(STATE_VALUE),
+    m_string(NULL), m_stringLength(0), m_number(0),
+    m_error(NULL), m_errorOffset(0)
+{
+}
+
+
+JSONReaderToken JSONReader::fail(const char *error)
+{
+    if (!m_error)
+    {
+        m_error       = error;
+        m_errorOffset = m_pos;
+    }
+
+    return JSON_READER_ERROR;
+}
+
+
+void JSONReader::skipWhitespace()
+{
+    while (m_pos < m_length)
+    {
+        char c = m_json[m_pos];
+        if ((c != ' ') && (c != '\t') && (c != '\n') && (c != '\r'))
+        {
+            break;
+        }
+        m_pos++;
+    }
+}
+
+
+JSONReaderToken JSONReader::next()
+{
+    if (m_error)
+    {
+        return JSON_READER_ERROR;
+    }
+
+    skipWhitespace();
+
+    char c = m_pos < m_length ? m_json[m_pos] : 0;
+
+    switch (m_state)
+    {
+    case STATE_DONE:
+        return m_pos < m_length ? fail("unexpected data after the document") : JSON_READER_END;
+
+    case STATE_COMMA_OR_END:
+        if ((c == '}') || (c == ']'))
+        {
+            return endContainer(c);
+        }
+        if (c != ',')
+        {
+            return fail("expected ',' or the end of the container");
+        }
+        m_pos++;
+        skipWhitespace();
+        return m_stack.back() == '{' ? readKey() : readValue();
+
+    case STATE_KEY_OR_END:
+        return c == '}' ? endContainer(c) : readKey();
+
+    case STATE_KEY:
+        return readKey();
+
+    case STATE_VALUE_OR_END:
+        return c == ']' ? endContainer(c) : readValue();
+
+    case STATE_VALUE:
+    default:
+        return readValue();
+    }
+}
+
+
+JSONReaderToken JSONReader::endContainer(char close)
+{
+    char open = m_stack.back();
+
+    if (close != (open == '{' ? '}' : ']'))
+    {
+        return fail("mismatched end of container");
+    }
+
+    m_pos++;
+    m_stack.pop_back();
+
+    return afterValue(close == '}' ? JSON_READER_OBJECT_END : JSON_READER_ARRAY_END);
+}
+
+
+JSONReaderToken JSONReader::afterValue(JSONReaderToken token)
+{
+    m_state = m_stack.size() ? STATE_COMMA_OR_END : STATE_DONE;
+    return token;
+}
+
+
+JSONReaderToken JSONReader::readKey()
+{
+    if ((m_pos >= m_length) || (m_json[m_pos] != '"'))
+    {
+        return fail("expected a key");
+    }
+
+    if (!readString())
+    {
+        return JSON_READER_ERROR;
+    }
+
+    skipWhitespace();
+
+    if ((m_pos >= m_length) || (m_json[m_pos] != ':'))
+    {
+        return fail("expected ':'");
+    }
+
+    m_pos++;
+    m_state = STATE_VALUE;
+    return JSON_READER_KEY;
+}
+
+
+JSONReaderToken JSONReader::readValue()
+{
+    if (m_pos >= m_length)
+    {
+        return fail("unexpected end of data");
+    }
+
+    switch (m_json[m_pos])
+    {
+    case '{':
+    case '[':
+        if (m_stack.size() >= MAX_DEPTH)
+        {
+            return fail("nested too deeply");
+        }
+        m_stack.push_back(m_json[m_pos]);
+        m_state = m_json[m_pos] == '{' ? STATE_KEY_OR_END : STATE_VALUE_OR_END;
+        return m_json[m_pos++] == '{' ? JSON_READER_OBJECT_BEGIN : JSON_READER_ARRAY_BEGIN;
+
+    case '"':
+        return readString() ? afterValue(JSON_READER_STRING) : JSON_READER_ERROR;
+
+    case 't':
+        return readLiteral("true") ? afterValue(JSON_READER_TRUE) : JSON_READER_ERROR;
+
+    case 'f':
+        return readLiteral("false") ? afterValue(JSON_READER_FALSE) : JSON_READER_ERROR;
+
+    case 'n':
+        return readLiteral("null") ? afterValue(JSON_READER_NULL) : JSON_READER_ERROR;
+
+    default:
+        return readNumber() ? afterValue(JSON_READER_NUMBER) : JSON_READER_ERROR;
+    }
+}
+
+
+bool JSONReader::readLiteral(const char *literal)
+{
+    UTsize length = (UTsize)strlen(literal);
+
+    if ((m_length - m_pos < length) || strncmp(m_json + m_pos, literal, length))
+    {
+        fail("invalid literal");
+        return false;
+    }
+
+    m_pos += length;
+    return true;
+}
+
+
+static int hexValue(char c)
+{
+    if ((c >= '0') && (c <= '9')) return c - '0';
+    if ((c >= 'a') && (c <= 'f')) return c - 'a' + 10;
+    if ((c >= 'A') && (c <= 'F')) return c - 'A' + 10;
+    return -1;
+}
+
+
+static void appendUTF8(utArray<char>& out, unsigned int codepoint)
+{
+    if (codepoint < 0x80)
+    {
+        out.push_back((char)codepoint);
+    }
+    else if (codepoint < 0x800)
+    {
+        out.push_back((char)(0xC0 | (codepoint >> 6)));
+        out.push_back((char)(0x80 | (codepoint & 0x3F)));
+    }
+    else if (codepoint < 0x10000)
+    {
+        out.push_back((char)(0xE0 | (codepoint >> 12)));
+        out.push_back((char)(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (codepoint & 0x3F)));
+    }
+    else
+    {
+        out.push_back((char)(0xF0 | (codepoint >> 18)));
+        out.push_back((char)(0x80 | ((codepoint >> 12) & 0x3F)));
+        out.push_back((char)(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (codepoint & 0x3F)));
+    }
+}
+
+
+bool JSONReader::readString()
+{
+    // Skip the opening quote.
+    UTsize start = ++m_pos;
+
+    // Strings without escapes, nearly all of them, are returned in place.
+    while (m_pos < m_length)
+    {
+        unsigned char c = (unsigned char)m_json[m_pos];
+
+        if (c == '"')
+        {
+            m_string       = m_json + start;
+            m_stringLength = m_pos - start;
+            m_pos++;
+            return true;
+        }
+
+        if (c == '\\')
+        {
+            break;
+        }
+
+        if (c < 0x20)
+        {
+            fail("control character in string");
+            return false;
+        }
+
+        m_pos++;
+    }
+
+    m_unescaped.clear(true);
+    for (UTsize i = start; i < m_pos; i++)
+    {
+        m_unescaped.push_back(m_json[i]);
+    }
+
+    while (m_pos < m_length)
+    {
+        unsigned char c = (unsigned char)m_json[m_pos++];
+
+        if (c == '"')
+        {
+            m_string       = m_unescaped.ptr();
+            m_stringLength = m_unescaped.size();
+            return true;
+        }
+
+        if (c < 0x20)
+        {
+            fail("control character in string");
+            return false;
+        }
+
+        if (c != '\\')
+        {
+            m_unescaped.push_back((char)c);
+            continue;
+        }
+
+        if (m_pos >= m_length)
+        {
+            break;
+        }
+
+        switch (m_json[m_pos++])
+        {
+        case '"': m_unescaped.push_back('"'); break;
+        case '\\': m_unescaped.push_back('\\'); break;
+        case '/': m_unescaped.push_back('/'); break;
+        case 'b': m_unescaped.push_back('\b'); break;
+        case 'f': m_unescaped.push_back('\f'); break;
+        case 'n': m_unescaped.push_back('\n'); break;
+        case 'r': m_unescaped.push_back('\r'); break;
+        case 't': m_unescaped.push_back('\t'); break;
+
+        case 'u':
+        {
+            unsigned int codepoint = 0;
+
+            for (int pair = 0; ; pair++)
+            {
+                unsigned int unit = 0;
+
+                if (m_length - m_pos < 4)
+                {
+                    fail("truncated \\u escape");
+                    return false;
+                }
+
+                for (int i = 0; i < 4; i++)
+                {
+                    int digit = hexValue(m_json[m_pos++]);
+                    if (digit < 0)
+                    {
+                        fail("invalid \\u escape");
+                        return false;
+                    }
+                    unit = (unit << 4) | digit;
+                }
+
+                if (pair == 0)
+                {
+                    codepoint = unit;
+
+                    // A high surrogate has to be followed by a low one.
+                    if ((unit >= 0xD800) && (unit <= 0xDBFF) &&
+                        (m_length - m_pos >= 6) && (m_json[m_pos] == '\\') && (m_json[m_pos + 1] == 'u'))
+                    {
+                        m_pos += 2;
+                        continue;
+                    }
+                }
+                else if ((unit >= 0xDC00) && (unit <= 0xDFFF))
+                {
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (unit - 0xDC00);
+                }
+                else
+                {
+                    fail("invalid surrogate pair");
+                    return false;
+                }
+
+                break;
+            }
+
+            appendUTF8(m_unescaped, codepoint);
+            break;
+        }
+
+        default:
+            fail("invalid escape");
+            return false;
+        }
+    }
+
+    fail("unterminated string");
+    return false;
+}
+
+
+bool JSONReader::readNumber()
+{
+    UTsize start = m_pos;
+
+    if ((m_pos < m_length) && (m_json[m_pos] == '-'))
+    {
+        m_pos++;
+    }
+
+    // Integer part, no leading zeros.
+    if ((m_pos < m_length) && (m_json[m_pos] == '0'))
+    {
+        m_pos++;
+    }
+    else if ((m_pos < m_length) && (m_json[m_pos] >= '1') && (m_json[m_pos] <= '9'))
+    {
+        while ((m_pos < m_length) && (m_json[m_pos] >= '0') && (m_json[m_pos] <= '9')) m_pos++;
+    }
+    else
+    {
+        fail("invalid value");
+        return false;
+    }
+
+    if ((m_pos < m_length) && (m_json[m_pos] == '.'))
+    {
+        UTsize digits = ++m_pos;
+        while ((m_pos < m_length) && (m_json[m_pos] >= '0') && (m_json[m_pos] <= '9')) m_pos++;
+        if (m_pos == digits)
+        {
+            fail("invalid number");
+            return false;
+        }
+    }
+
+    if ((m_pos < m_length) && ((m_json[m_pos] == 'e') || (m_json[m_pos] == 'E')))
+    {
+        m_pos++;
+        if ((m_pos < m_length) && ((m_json[m_pos] == '+') || (m_json[m_pos] == '-'))) m_pos++;
+
+        UTsize digits = m_pos;
+        while ((m_pos < m_length) && (m_json[m_pos] >= '0') && (m_json[m_pos] <= '9')) m_pos++;
+        if (m_pos == digits)
+        {
+            fail("invalid number");
+            return false;
+        }
+    }
+
+    // strtod needs it terminated, which the input may not be.
+    char   buffer[64];
+    UTsize length = m_pos - start;
+
+    if (length < sizeof(buffer))
+    {
+        memcpy(buffer, m_json + start, length);
+        buffer[length] = 0;
+        m_number       = strtod(buffer, NULL);
+    }
+    else
+    {
+        m_unescaped.clear(true);
+        m_unescaped.resize(length + 1);
+        memcpy(m_unescaped.ptr(), m_json + start, length);
+        m_unescaped[length] = 0;
+        m_number = strtod(m_unescaped.ptr(), NULL);
+    }
+
+    return true;
+}
+
+
+bool JSONReader::keyEquals(const char *key) const
+{
+    UTsize length = (UTsize)strlen(key);
+
+    return (length == m_stringLength) && !memcmp(m_string, key, length);
+}
+
+
+bool JSONReader::skip()
+{
+    if (m_error)
+    {
+        return false;
+    }
+
+    // After a key, the value is yet to be read.
+    int depth = getDepth();
+
+    if (m_state == STATE_VALUE && depth > 0 && m_stack.back() == '{')
+    {
+        JSONReaderToken token = next();
+        if (token == JSON_READER_ERROR)
+        {
+            return false;
+        }
+        if ((token != JSON_READER_OBJECT_BEGIN) && (token != JSON_READER_ARRAY_BEGIN))
+        {
+            return true;
+        }
+    }
+    else if ((m_state != STATE_KEY_OR_END) && (m_state != STATE_VALUE_OR_END))
+    {
+        // Last token wasn't the start of a container.
+        return true;
+    }
+    else
+    {
+        depth--;
+    }
+
+    while (getDepth() > depth)
+    {
+        if (next() == JSON_READER_ERROR)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,128 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _UTILS_JSONREADER_H_
+#define _UTILS_JSONREADER_H_
+
+#include "loom/common/utils/utTypes.h"
+
+/*
+ * Pull parser for JSON held in memory, for payloads too large to build a
+ * jansson DOM (and then script objects) from. next() steps through the
+ * document one token at a time, so callers can decode straight into their
+ * own structures:
+ *
+ *   JSONReader reader(bytes, length);
+ *   if (reader.next() != JSON_READER_OBJECT_BEGIN) return false;
+ *   while (reader.next() == JSON_READER_KEY)
+ *   {
+ *       if (reader.keyEquals("width") && reader.next() == JSON_READER_NUMBER) width = (int)reader.getNumber();
+ *       else if (!reader.skip()) return false;
+ *   }
+ *   return reader.getError() == NULL;
+ *
+ * Nothing is allocated but the nesting stack and, for strings with escape
+ * sequences, a buffer to unescape them into; other strings are returned in
+ * place. The input needn't be NUL terminated and has to outlive the reader.
+ */
+
+enum JSONReaderToken
+{
+    JSON_READER_ERROR,
+    JSON_READER_END,          // end of the document
+    JSON_READER_OBJECT_BEGIN,
+    JSON_READER_OBJECT_END,
+    JSON_READER_ARRAY_BEGIN,
+    JSON_READER_ARRAY_END,
+    JSON_READER_KEY,          // getString, then the value follows
+    JSON_READER_STRING,       // getString
+    JSON_READER_NUMBER,       // getNumber
+    JSON_READER_TRUE,
+    JSON_READER_FALSE,
+    JSON_READER_NULL
+};
+
+class JSONReader
+{
+public:
+    // Deeper documents are rejected, so recursive decoders stay bounded.
+    static const int MAX_DEPTH = 256;
+
+    JSONReader(const char *json, UTsize length);
+
+    JSONReaderToken next();
+
+    // Skips the value whose first token was just read, that is the rest of
+    // an object or array; nothing for other values. After a key, skips its
+    // value. Returns false on a parse error.
+    bool skip();
+
+    // The KEY or STRING just read, unescaped, length bytes long. Only valid
+    // until the next call to next(), and not NUL terminated.
+    const char *getString(UTsize& length) const { length = m_stringLength; return m_string; }
+    bool keyEquals(const char *key) const;
+
+    double getNumber() const { return m_number; }
+
+    // Containers currently open.
+    int getDepth() const { return (int)m_stack.size(); }
+
+    // NULL unless next() returned JSON_READER_ERROR.
+    const char *getError() const { return m_error; }
+    UTsize getErrorOffset() const { return m_errorOffset; }
+
+protected:
+    enum State
+    {
+        STATE_VALUE,
+        STATE_VALUE_OR_END, // after [
+        STATE_KEY_OR_END,   // after {
+        STATE_KEY,          // after , in an object
+        STATE_COMMA_OR_END, // after a value in a container
+        STATE_DONE          // after the root value
+    };
+
+    JSONReaderToken fail(const char *error);
+    JSONReaderToken readValue();
+    JSONReaderToken readKey();
+    JSONReaderToken endContainer(char close);
+    JSONReaderToken afterValue(JSONReaderToken token);
+    bool readString();
+    bool readNumber();
+    bool readLiteral(const char *literal);
+    void skipWhitespace();
+
+    const char    *m_json;
+    UTsize        m_length;
+    UTsize        m_pos;
+
+    State         m_state;
+    utArray<char> m_stack;   // '{' or '[' per open container
+
+    const char    *m_string;
+    UTsize        m_stringLength;
+    utArray<char> m_unescaped;
+    double        m_number;
+
+    const char    *m_error;
+    UTsize        m_errorOffset;
+};
+
+#endif
@@ -0,0 +1,177 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <string.h>
+
+#include "loom/common/utils/jsonReader.h"
+#include "seatest.h"
+
+SEATEST_FIXTURE(jsonReader)
+{
+    SEATEST_FIXTURE_ENTRY(jsonReader_tokens);
+    SEATEST_FIXTURE_ENTRY(jsonReader_strings);
+    SEATEST_FIXTURE_ENTRY(jsonReader_skip);
+    SEATEST_FIXTURE_ENTRY(jsonReader_errors);
+}
+
+static bool stringEquals(JSONReader& reader, const char *expected)
+{
+    UTsize     length;
+    const char *string = reader.getString(length);
+
+    return (length == strlen(expected)) && !memcmp(string, expected, length);
+}
+
+SEATEST_TEST(jsonReader_tokens)
+{
+    // Not NUL terminated, the reader has to stop at the length.
+    const char json[] = " { \"a\" : [ 1, -2.5e2, true, false, null, {} ], \"b\": \"c\" }xx";
+
+    JSONReader reader(json, sizeof(json) - 3);
+
+    assert_int_equal(JSON_READER_OBJECT_BEGIN, reader.next());
+    assert_int_equal(JSON_READER_KEY, reader.next());
+    assert_true(reader.keyEquals("a"));
+    assert_int_equal(JSON_READER_ARRAY_BEGIN, reader.next());
+    assert_int_equal(2, reader.getDepth());
+    assert_int_equal(JSON_READER_NUMBER, reader.next());
+    assert_double_equal(1.0, reader.getNumber(), 0.0);
+    assert_int_equal(JSON_READER_NUMBER, reader.next());
+    assert_double_equal(-250.0, reader.getNumber(), 0.0);
+    assert_int_equal(JSON_READER_TRUE, reader.next());
+    assert_int_equal(JSON_READER_FALSE, reader.next());
+    assert_int_equal(JSON_READER_NULL, reader.next());
+    assert_int_equal(JSON_READER_OBJECT_BEGIN, reader.next());
+    assert_int_equal(JSON_READER_OBJECT_END, reader.next());
+    assert_int_equal(JSON_READER_ARRAY_END, reader.next());
+    assert_int_equal(JSON_READER_KEY, reader.next());
+    assert_true(reader.keyEquals("b"));
+    assert_int_equal(JSON_READER_STRING, reader.next());
+    assert_true(stringEquals(reader, "c"));
+    assert_int_equal(JSON_READER_OBJECT_END, reader.next());
+    assert_int_equal(JSON_READER_END, reader.next());
+    assert_true(reader.getError() == NULL);
+
+    // Scalars are documents too.
+    JSONReader scalar("42", 2);
+    assert_int_equal(JSON_READER_NUMBER, scalar.next());
+    assert_int_equal(JSON_READER_END, scalar.next());
+}
+
+SEATEST_TEST(jsonReader_strings)
+{
+    const char json[] = "[\"plain\", \"a\\\"b\\\\c\\n\", \"\\u00e9\\u20ac\", \"\\ud83d\\ude00\", \"\"]";
+
+    JSONReader reader(json, sizeof(json) - 1);
+
+    assert_int_equal(JSON_READER_ARRAY_BEGIN, reader.next());
+
+    // Strings without escapes point into the input.
+    assert_int_equal(JSON_READER_STRING, reader.next());
+    UTsize length;
+    assert_true(reader.getString(length) == json + 2);
+    assert_true(stringEquals(reader, "plain"));
+
+    assert_int_equal(JSON_READER_STRING, reader.next());
+    assert_true(stringEquals(reader, "a\"b\\c\n"));
+    assert_int_equal(JSON_READER_STRING, reader.next());
+    assert_true(stringEquals(reader, "\xC3\xA9\xE2\x82\xAC"));
+    assert_int_equal(JSON_READER_STRING, reader.next());
+    assert_true(stringEquals(reader, "\xF0\x9F\x98\x80"));
+    assert_int_equal(JSON_READER_STRING, reader.next());
+    assert_true(stringEquals(reader, ""));
+
+    assert_int_equal(JSON_READER_ARRAY_END, reader.next());
+    assert_int_equal(JSON_READER_END, reader.next());
+}
+
+SEATEST_TEST(jsonReader_skip)
+{
+    const char json[] = "{\"skipped\": {\"x\": [1, [2, {\"y\": 3}]]}, \"scalar\": 1, \"kept\": 7}";
+
+    JSONReader reader(json, sizeof(json) - 1);
+
+    assert_int_equal(JSON_READER_OBJECT_BEGIN, reader.next());
+
+    int kept = 0;
+    while (reader.next() == JSON_READER_KEY)
+    {
+        if (reader.keyEquals("kept") && (reader.next() == JSON_READER_NUMBER))
+        {
+            kept = (int)reader.getNumber();
+        }
+        else
+        {
+            assert_true(reader.skip());
+        }
+    }
+
+    assert_int_equal(7, kept);
+    assert_int_equal(0, reader.getDepth());
+    assert_int_equal(JSON_READER_END, reader.next());
+
+    // Skipping a container whose begin token was just read.
+    JSONReader array("[[1, 2], 3]", 11);
+    assert_int_equal(JSON_READER_ARRAY_BEGIN, array.next());
+    assert_int_equal(JSON_READER_ARRAY_BEGIN, array.next());
+    assert_true(array.skip());
+    assert_int_equal(JSON_READER_NUMBER, array.next());
+    assert_double_equal(3.0, array.getNumber(), 0.0);
+}
+
+static bool fails(const char *json)
+{
+    JSONReader reader(json, (UTsize)strlen(json));
+
+    JSONReaderToken token;
+    while ((token = reader.next()) != JSON_READER_END)
+    {
+        if (token == JSON_READER_ERROR)
+        {
+            return reader.getError() != NULL;
+        }
+    }
+
+    return false;
+}
+
+SEATEST_TEST(jsonReader_errors)
+{
+    assert_true(fails(""));
+    assert_true(fails("[1, 2"));
+    assert_true(fails("[1, 2}"));
+    assert_true(fails("{\"a\" 1}"));
+    assert_true(fails("{1: 2}"));
+    assert_true(fails("[1,]"));
+    assert_true(fails("[01]"));
+    assert_true(fails("[1.]"));
+    assert_true(fails("[tru]"));
+    assert_true(fails("\"unterminated"));
+    assert_true(fails("\"\\x\""));
+    assert_true(fails("\"\\ud83dx\\ude00\"") == false);
+    assert_true(fails("\"\\ud83d\\u0041\""));
+    assert_true(fails("1 2"));
+
+    // Nesting is bounded.
+    char deep[JSONReader::MAX_DEPTH + 2];
+    memset(deep, '[', sizeof(deep) - 1);
+    deep[sizeof(deep) - 1] = 0;
+    assert_true(fails(deep));
+}
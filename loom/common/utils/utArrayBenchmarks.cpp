@@ -0,0 +1,137 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/common/core/benchmark.h"
+#include "loom/common/utils/utTypes.h"
+
+#define ARRAYBENCH_ITEMS    4096
+
+struct ArrayBenchItem
+{
+    float x, y;
+    int   id;
+};
+
+BENCHMARK_FIXTURE(utArray)
+{
+    BENCHMARK_FIXTURE_ENTRY(utArray_pushBack);
+    BENCHMARK_FIXTURE_ENTRY(utArray_pushBackReserved);
+    BENCHMARK_FIXTURE_ENTRY(utArray_iterate);
+    BENCHMARK_FIXTURE_ENTRY(utArray_find);
+    BENCHMARK_FIXTURE_ENTRY(utArray_eraseUnordered);
+}
+
+// One iteration grows a fresh array to ARRAYBENCH_ITEMS
+BENCHMARK(utArray_pushBack)
+{
+    for (int i = 0; i < iterations; i++)
+    {
+        utArray<ArrayBenchItem> items;
+
+        for (int j = 0; j < ARRAYBENCH_ITEMS; j++)
+        {
+            ArrayBenchItem item = { (float)j, (float)j, j };
+            items.push_back(item);
+        }
+
+        loom_benchmark_doNotOptimize(items.ptr());
+    }
+}
+
+BENCHMARK(utArray_pushBackReserved)
+{
+    for (int i = 0; i < iterations; i++)
+    {
+        utArray<ArrayBenchItem> items;
+        items.reserve(ARRAYBENCH_ITEMS);
+
+        for (int j = 0; j < ARRAYBENCH_ITEMS; j++)
+        {
+            ArrayBenchItem item = { (float)j, (float)j, j };
+            items.push_back(item);
+        }
+
+        loom_benchmark_doNotOptimize(items.ptr());
+    }
+}
+
+// One iteration reads every item through the indexing operator
+BENCHMARK(utArray_iterate)
+{
+    loom_benchmark_pauseTiming();
+    utArray<ArrayBenchItem> items;
+    items.resize(ARRAYBENCH_ITEMS);
+    loom_benchmark_resumeTiming();
+
+    float sum = 0;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        for (UTsize j = 0; j < items.size(); j++)
+        {
+            sum += items[j].x;
+        }
+    }
+
+    loom_benchmark_doNotOptimize(&sum);
+}
+
+// One iteration is a linear search through 256 ints
+BENCHMARK(utArray_find)
+{
+    loom_benchmark_pauseTiming();
+    utArray<int> values;
+
+    for (int j = 0; j < 256; j++)
+    {
+        values.push_back(j * 3);
+    }
+    loom_benchmark_resumeTiming();
+
+    UTsize found = 0;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        found += values.find((i * 3) & 255);
+    }
+
+    loom_benchmark_doNotOptimize(&found);
+}
+
+// One iteration empties a filled array from the front, swapping the last
+// item in
+BENCHMARK(utArray_eraseUnordered)
+{
+    utArray<int> values;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        loom_benchmark_pauseTiming();
+        values.resize(ARRAYBENCH_ITEMS, 1);
+        loom_benchmark_resumeTiming();
+
+        while (values.size())
+        {
+            values.erase((UTsize)0);
+        }
+    }
+
+    loom_benchmark_doNotOptimize(values.ptr());
+}
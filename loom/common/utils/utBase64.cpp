@@ -1,4 +1,13 @@
 #include "utBase64.h"
+#include "loom/common/utils/utCPU.h"
+
+#if UT_CPU_X86 && UT_CPU_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#if UT_CPU_NEON
+#include <arm_neon.h>
+#endif
 
 // snippets from http://base64.sourceforge.net/b64.c
 
@@ -47,101 +56,307 @@ static void decodeblock(unsigned char in[4], unsigned char out[3])
 }
 
 
-utBase64 utBase64::decode64(const utString& code64)
+// The SIMD paths below handle whole blocks of input, leaving the tail to
+// encodeblock/decodeblock. They follow Wojciech Mula's and Daniel Lemire's
+// vectorized base64: http://0x80.pl/notesen/2016-01-12-sse-base64-encoding.html
+
+#if UT_CPU_X86 && UT_CPU_X86_SIMD
+
+// Encodes 12 bytes to 16 characters a step, while 16 bytes may be read.
+UT_TARGET("ssse3")
+static UTsize encodeSSSE3(const unsigned char *data, UTsize size, char *out)
 {
-    utBase64 base64;
+    const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m128i shift   = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                          '/' - 63, 'A', 0, 0);
 
-    base64.bc64 = code64;
+    UTsize i = 0;
+
+    for ( ; size - i >= 16; i += 12, out += 16)
+    {
+        __m128i in = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + i)), shuffle);
+
+        // Spread the 4 sextets of every 3 bytes over 4 bytes.
+        __m128i hi      = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+        __m128i lo      = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+        __m128i sextets = _mm_or_si128(hi, lo);
+
+        // Map each sextet to the offset to its character by its range.
+        __m128i range = _mm_subs_epu8(sextets, _mm_set1_epi8(51));
+        range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), sextets), _mm_set1_epi8(13)));
+
+        _mm_storeu_si128((__m128i *)out, _mm_add_epi8(sextets, _mm_shuffle_epi8(shift, range)));
+    }
+
+    return i;
+}
 
-    unsigned char in[4], out[3], v;
-    int           i, len;
 
-    UTsize c       = 0;
-    size_t counter = code64.size() + 1;
+// Decodes 16 characters to 12 bytes a step, for as long as they are all in
+// the alphabet.
+UT_TARGET("ssse3")
+static UTsize decodeSSSE3(const char *code, UTsize length, unsigned char *out)
+{
+    const __m128i lutLo   = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                          0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lutHi   = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                          0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask2F  = _mm_set1_epi8(0x2F);
+    const __m128i pack    = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
 
-    while (counter)
+    UTsize i = 0;
+
+    for ( ; length - i >= 16; i += 16, out += 12)
     {
-        for (len = 0, i = 0; i < 4 && counter; i++)
+        __m128i in       = _mm_loadu_si128((const __m128i *)(code + i));
+        __m128i hiNibble = _mm_and_si128(_mm_srli_epi32(in, 4), mask2F);
+        __m128i loNibble = _mm_and_si128(in, mask2F);
+
+        __m128i invalid = _mm_and_si128(_mm_shuffle_epi8(lutLo, loNibble), _mm_shuffle_epi8(lutHi, hiNibble));
+        if (_mm_movemask_epi8(_mm_cmpgt_epi8(invalid, _mm_setzero_si128())))
         {
-            v = 0;
-            while (counter && v == 0)
-            {
-                v = (unsigned char)code64[c++];
-                counter--;
-                v = (unsigned char)((v < 43 || v > 122) ? 0 : cd64[v - 43]);
-                if (v)
-                {
-                    v = (unsigned char)((v == '$') ? 0 : v - 61);
-                }
-            }
-            if (counter)
-            {
-                len++;
-                if (v)
-                {
-                    in[i] = (unsigned char)(v - 1);
-                }
-            }
-            else
-            {
-                in[i] = 0;
-            }
+            break;
         }
-        if (len)
+
+        __m128i roll    = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(_mm_cmpeq_epi8(in, mask2F), hiNibble));
+        __m128i sextets = _mm_add_epi8(in, roll);
+
+        // Pack 4 sextets into 3 bytes, then drop the gaps.
+        __m128i merged = _mm_maddubs_epi16(sextets, _mm_set1_epi32(0x01400140));
+        __m128i bytes  = _mm_shuffle_epi8(_mm_madd_epi16(merged, _mm_set1_epi32(0x00011000)), pack);
+
+        _mm_storel_epi64((__m128i *)out, bytes);
+        int tail = _mm_cvtsi128_si32(_mm_srli_si128(bytes, 8));
+        memcpy(out + 8, &tail, 4);
+    }
+
+    return i;
+}
+#endif
+
+#if UT_CPU_NEON
+
+// Encodes 48 bytes to 64 characters a step.
+static UTsize encodeNEON(const unsigned char *data, UTsize size, char *out)
+{
+    UTsize i = 0;
+
+    for ( ; size - i >= 48; i += 48, out += 64)
+    {
+        uint8x16x3_t in = vld3q_u8(data + i);
+        uint8x16x4_t sextets;
+
+        sextets.val[0] = vshrq_n_u8(in.val[0], 2);
+        sextets.val[1] = vorrq_u8(vandq_u8(vshlq_n_u8(in.val[0], 4), vdupq_n_u8(0x30)), vshrq_n_u8(in.val[1], 4));
+        sextets.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(in.val[1], 2), vshrq_n_u8(in.val[2], 6)), vdupq_n_u8(0x3F));
+        sextets.val[3] = vandq_u8(in.val[2], vdupq_n_u8(0x3F));
+
+        for (int j = 0; j < 4; j++)
         {
-            decodeblock(in, out);
-            for (i = 0; i < len - 1; i++)
-            {
-                base64.bc.push_back(out[i]);
-            }
+            uint8x16_t s      = sextets.val[j];
+            uint8x16_t offset = vdupq_n_u8('A');
+            offset         = vbslq_u8(vcgeq_u8(s, vdupq_n_u8(26)), vdupq_n_u8('a' - 26), offset);
+            offset         = vbslq_u8(vcgeq_u8(s, vdupq_n_u8(52)), vdupq_n_u8((unsigned char)('0' - 52)), offset);
+            offset         = vbslq_u8(vceqq_u8(s, vdupq_n_u8(62)), vdupq_n_u8((unsigned char)('+' - 62)), offset);
+            offset         = vbslq_u8(vceqq_u8(s, vdupq_n_u8(63)), vdupq_n_u8((unsigned char)('/' - 63)), offset);
+            sextets.val[j] = vaddq_u8(s, offset);
         }
+
+        vst4q_u8((unsigned char *)out, sextets);
     }
 
-    return base64;
+    return i;
 }
 
 
-utBase64 utBase64::encode64(const utArray<unsigned char>& bc)
+// Maps characters to sextets, 0xFF for those outside the alphabet.
+static inline uint8x16_t decodeNEONSextets(uint8x16_t c)
 {
-    utBase64 base64;
+    uint8x16_t upper = vsubq_u8(c, vdupq_n_u8('A'));
+    uint8x16_t lower = vsubq_u8(c, vdupq_n_u8('a' - 26));
+    uint8x16_t digit = vaddq_u8(c, vdupq_n_u8(52 - '0'));
 
-    base64.bc = bc;
+    uint8x16_t s = vdupq_n_u8(0xFF);
+    s = vbslq_u8(vcltq_u8(upper, vdupq_n_u8(26)), upper, s);
+    s = vbslq_u8(vcltq_u8(vsubq_u8(c, vdupq_n_u8('a')), vdupq_n_u8(26)), lower, s);
+    s = vbslq_u8(vcltq_u8(vsubq_u8(c, vdupq_n_u8('0')), vdupq_n_u8(10)), digit, s);
+    s = vbslq_u8(vceqq_u8(c, vdupq_n_u8('+')), vdupq_n_u8(62), s);
+    s = vbslq_u8(vceqq_u8(c, vdupq_n_u8('/')), vdupq_n_u8(63), s);
+    return s;
+}
 
-    unsigned char in[3], out[4];
-    int           i, len;
 
-    UTsize        counter = bc.size();
-    int           c       = 0;
-    utArray<char> buffer;
+// Decodes 64 characters to 48 bytes a step, for as long as they are all in
+// the alphabet.
+static UTsize decodeNEON(const char *code, UTsize length, unsigned char *out)
+{
+    UTsize i = 0;
+
+    for ( ; length - i >= 64; i += 64, out += 48)
+    {
+        uint8x16x4_t in = vld4q_u8((const unsigned char *)code + i);
+
+        uint8x16_t s0 = decodeNEONSextets(in.val[0]);
+        uint8x16_t s1 = decodeNEONSextets(in.val[1]);
+        uint8x16_t s2 = decodeNEONSextets(in.val[2]);
+        uint8x16_t s3 = decodeNEONSextets(in.val[3]);
+
+        uint8x16_t invalid = vorrq_u8(vorrq_u8(s0, s1), vorrq_u8(s2, s3));
+        invalid = vtstq_u8(invalid, vdupq_n_u8(0x80));
+        uint8x8_t folded = vorr_u8(vget_low_u8(invalid), vget_high_u8(invalid));
+        if (vget_lane_u64(vreinterpret_u64_u8(folded), 0))
+        {
+            break;
+        }
+
+        uint8x16x3_t bytes;
+        bytes.val[0] = vorrq_u8(vshlq_n_u8(s0, 2), vshrq_n_u8(s1, 4));
+        bytes.val[1] = vorrq_u8(vshlq_n_u8(s1, 4), vshrq_n_u8(s2, 2));
+        bytes.val[2] = vorrq_u8(vshlq_n_u8(s2, 6), s3);
+
+        vst3q_u8(out, bytes);
+    }
+
+    return i;
+}
+#endif
+
+
+UTsize utBase64::encodedLength(UTsize size)
+{
+    return (size + 2) / 3 * 4;
+}
+
+
+UTsize utBase64::decodedMaxLength(UTsize length)
+{
+    return length / 4 * 3 + 2;
+}
+
+
+void utBase64::encode(const unsigned char *data, UTsize size, char *out)
+{
+    UTsize i = 0;
+
+#if UT_CPU_X86 && UT_CPU_X86_SIMD
+    if (utCPUHas(UT_CPU_SSSE3))
+    {
+        i = encodeSSSE3(data, size, out);
+    }
+#elif UT_CPU_NEON
+    i = encodeNEON(data, size, out);
+#endif
 
-    while (counter)
+    out += i / 3 * 4;
+
+    unsigned char in[3];
+
+    for ( ; i < size; i += 3, out += 4)
     {
-        len = 0;
-        for (i = 0; i < 3; i++)
+        int len = size - i < 3 ? (int)(size - i) : 3;
+
+        in[0] = data[i];
+        in[1] = len > 1 ? data[i + 1] : 0;
+        in[2] = len > 2 ? data[i + 2] : 0;
+
+        encodeblock(in, (unsigned char *)out, len);
+    }
+}
+
+
+UTsize utBase64::decode(const char *code, UTsize length, unsigned char *out)
+{
+    unsigned char *start = out;
+    unsigned char in[4];
+    int           count = 0;
+
+    for (UTsize i = 0; i < length; )
+    {
+        // Whole blocks in the alphabet go the fast way, between groups.
+        if (count == 0)
         {
-            if (counter)
+            UTsize done = 0;
+
+#if UT_CPU_X86 && UT_CPU_X86_SIMD
+            if (utCPUHas(UT_CPU_SSSE3))
             {
-                in[i] = (unsigned char)bc[c++];
-                len++;
-                counter--;
+                done = decodeSSSE3(code + i, length - i, out);
             }
-            else
+#elif UT_CPU_NEON
+            done = decodeNEON(code + i, length - i, out);
+#endif
+
+            if (done)
             {
-                in[i] = 0;
+                i   += done;
+                out += done / 4 * 3;
+                continue;
             }
         }
-        if (len)
+
+        // Characters outside the alphabet, such as padding and line breaks,
+        // are skipped.
+        unsigned char v = (unsigned char)code[i++];
+        v = (unsigned char)((v < 43 || v > 122) ? 0 : cd64[v - 43]);
+        if (!v || (v == '$'))
         {
-            encodeblock(in, out, len);
-            for (i = 0; i < 4; i++)
-            {
-                assert(out[i]);
-                buffer.push_back(out[i]);
-            }
+            continue;
         }
+
+        in[count++] = (unsigned char)(v - 62);
+
+        if (count == 4)
+        {
+            decodeblock(in, out);
+            out  += 3;
+            count = 0;
+        }
+    }
+
+    // A partial group of n sextets holds n - 1 bytes.
+    if (count > 1)
+    {
+        for (int i = count; i < 4; i++)
+        {
+            in[i] = 0;
+        }
+
+        unsigned char last[3];
+        decodeblock(in, last);
+        memcpy(out, last, count - 1);
+        out += count - 1;
     }
 
-    buffer.push_back('\0');
+    return (UTsize)(out - start);
+}
+
+
+utBase64 utBase64::decode64(const utString& code64)
+{
+    utBase64 base64;
+
+    base64.bc64 = code64;
+
+    base64.bc.resize(decodedMaxLength(code64.size()));
+    base64.bc.resize(decode(code64.c_str(), code64.size(), base64.bc.ptr()));
+
+    return base64;
+}
+
+
+utBase64 utBase64::encode64(const utArray<unsigned char>& bc)
+{
+    utBase64 base64;
+
+    base64.bc = bc;
+
+    utArray<char> buffer;
+    buffer.resize(encodedLength(bc.size()) + 1);
+
+    encode(bc.ptr(), bc.size(), buffer.ptr());
+    buffer[buffer.size() - 1] = '\0';
 
     base64.bc64 = buffer.ptr();
 
@@ -40,8 +40,14 @@ public:
         return *this;
     }
 
+    // data set with setData is only encoded once the base64 is asked for
     const utString& getBase64()
     {
+        if (!bc64.size() && bc.size())
+        {
+            bc64 = encode64(bc).bc64;
+        }
+
         return bc64;
     }
 
@@ -50,6 +56,16 @@ public:
         return bc;
     }
 
+    void setData(const unsigned char *data, UTsize size)
+    {
+        bc64 = "";
+        bc.resize(size);
+        if (size)
+        {
+            memcpy(bc.ptr(), data, size);
+        }
+    }
+
     void clear()
     {
         bc64 = "";
@@ -59,5 +75,14 @@ public:
     static utBase64 decode64(const utString& code64);
 
     static utBase64 encode64(const utArray<unsigned char>& bc);
+
+    // The raw forms the above are built on, SIMD accelerated where the CPU
+    // allows. encode writes encodedLength(size) characters, no NUL. decode
+    // skips characters outside the alphabet, writes at most
+    // decodedMaxLength(length) bytes and returns how many it wrote.
+    static UTsize encodedLength(UTsize size);
+    static UTsize decodedMaxLength(UTsize length);
+    static void encode(const unsigned char *data, UTsize size, char *out);
+    static UTsize decode(const char *code, UTsize length, unsigned char *out);
 };
 #endif
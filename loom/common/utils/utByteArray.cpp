@@ -33,6 +33,7 @@ void utByteArray::clear()
 {
     _position = 0;
     _data.resize(0);
+    updateExternalMemory();
 }
 
 
@@ -54,6 +55,7 @@ bool utByteArray::tryReadToArray(const utString& path, utByteArray& bytes, bool
     }
 
     bytes._data.resize(sz);
+    bytes.updateExternalMemory();
 
     fstream.read(bytes._data.ptr(), addNullTerminator ? sz - 1 : sz);
 
@@ -67,7 +69,7 @@ bool utByteArray::tryReadToArray(const utString& path, utByteArray& bytes, bool
     return true;
 }
 
-void utByteArray::compress()
+void utByteArray::compress(int level)
 {
     _position = 0;
 
@@ -79,13 +81,14 @@ void utByteArray::compress()
     uLong destSize = compressBound(size);
     dest.resize(destSize);
 
-    ret = ::compress((Bytef *) dest.getDataPtr(), &destSize, (Bytef *) getDataPtr(), size);
+    ret = ::compress2((Bytef *) dest.getDataPtr(), &destSize, (Bytef *) getDataPtr(), size, level);
 
     if (ret != Z_OK) {
         return;
     }
 
-    _data = dest._data;
+    // take over the compressed buffer rather than copying it
+    transferFrom(dest);
     resize(destSize);
     _position = destSize;
 }
@@ -144,7 +147,7 @@ void utByteArray::uncompress(int uncompressedSize, int initialSize)
     sz = sz - stream.avail_out;
     inflateEnd(&stream);
  
-    _data = dest._data;
+    transferFrom(dest);
     resize(sz);
     _position = 0;
 }
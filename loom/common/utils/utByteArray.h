@@ -25,6 +25,7 @@
 #include "utTypes.h"
 #include "utString.h"
 #include "loom/common/core/assert.h"
+#include "loom/common/core/allocator.h"
 
 class utByteArray {
 protected:
@@ -32,6 +33,23 @@ protected:
     utArray<unsigned char> _data;
     UTsize _position;
 
+    // Backs the strings readString etc. return, one per array so readers
+    // on different threads don't share it
+    utString _stringValue;
+
+    // Bytes reported as external memory, see setReportsExternalMemory
+    UTsize _externalBytes;
+    bool _reportsExternal;
+
+    // Reports the change in size since the last report, if reporting
+    void updateExternalMemory()
+    {
+        if (!_reportsExternal || _externalBytes == _data.size()) return;
+
+        loom_allocator_reportExternal((long long)_data.size() - (long long)_externalBytes);
+        _externalBytes = _data.size();
+    }
+
     void memcpyUnaligned(void *destination, const void *source, size_t num)
     {
         // TODO smarter
@@ -72,6 +90,7 @@ protected:
         if (_data.size() < _position + sizeof(T))
         {
             _data.resize(_position + sizeof(T));
+            updateExternalMemory();
         }
 
         value = convertHostToLEndian(value);
@@ -84,6 +103,40 @@ protected:
         _position += sizeof(T);
     }
 
+    template<typename T>
+    void readValues(T *values, unsigned int count)
+    {
+        if (!count) return;
+
+        lmAssert(_position <= _data.size() && count <= (_data.size() - _position) / sizeof(T), "ByteArray out of data on read of %u values", count);
+
+        memcpy(values, &_data[_position], count * sizeof(T));
+        convertLEndianToHostArray(values, count);
+
+        _position += count * sizeof(T);
+    }
+
+    template<typename T>
+    void writeValues(const T *values, unsigned int count)
+    {
+        if (!count) return;
+
+        if (_data.size() < _position + count * sizeof(T))
+        {
+            _data.resize(_position + count * sizeof(T));
+            updateExternalMemory();
+        }
+
+        T *ptr = (T *)&_data[_position];
+        memcpy(ptr, values, count * sizeof(T));
+
+        // Converted in the buffer, which may be unaligned; the bulk swaps
+        // only use unaligned loads and stores.
+        convertHostToLEndianArray(ptr, count);
+
+        _position += count * sizeof(T);
+    }
+
     static int copyBytesInternal(utByteArray *dstByteArray, utByteArray *srcByteArray, int offset = 0, int length = 0, bool dstOffset = true)
     {
         if (!srcByteArray || !dstByteArray)
@@ -123,6 +176,7 @@ protected:
         {
             int off = (int)(dst - dstByteArray->_data.ptr());
             dstByteArray->_data.resize((UTsize)(dst - dstByteArray->_data.ptr() + length));
+            dstByteArray->updateExternalMemory();
             // We have a different backing array now, point pointer to the new one.
             dst = dstByteArray->_data.ptr() + off;
         }
@@ -141,6 +195,46 @@ public:
     utByteArray()
     {
         _position = 0;
+        _externalBytes = 0;
+        _reportsExternal = false;
+    }
+
+    // Copies don't report, the copied array keeps its own report
+    utByteArray(const utByteArray& other)
+        : _data(other._data), _position(other._position), _externalBytes(0), _reportsExternal(false)
+    {
+    }
+
+    utByteArray& operator=(const utByteArray& other)
+    {
+        _data = other._data;
+        _position = other._position;
+        updateExternalMemory();
+        return *this;
+    }
+
+    ~utByteArray()
+    {
+        setReportsExternalMemory(false);
+    }
+
+    /*
+     * Report the size of the array as external memory while it's held by a
+     * garbage collected script object, so the collector can take it into
+     * account, see loom_allocator_reportExternal
+     */
+    void setReportsExternalMemory(bool reports)
+    {
+        if (reports)
+        {
+            _reportsExternal = true;
+            updateExternalMemory();
+            return;
+        }
+
+        if (_reportsExternal && _externalBytes) loom_allocator_reportExternal(-(long long)_externalBytes);
+        _externalBytes = 0;
+        _reportsExternal = false;
     }
 
     void clear();
@@ -251,6 +345,21 @@ public:
         writeValue<unsigned int>(value);
     }
 
+    /*
+     * Bulk reads and writes of count values, converted from/to little
+     * endian all at once
+     */
+    void readShorts(short *values, unsigned int count) { readValues<short>(values, count); }
+    void writeShorts(const short *values, unsigned int count) { writeValues<short>(values, count); }
+    void readInts(int *values, unsigned int count) { readValues<int>(values, count); }
+    void writeInts(const int *values, unsigned int count) { writeValues<int>(values, count); }
+    void readUnsignedInts(unsigned int *values, unsigned int count) { readValues<unsigned int>(values, count); }
+    void writeUnsignedInts(const unsigned int *values, unsigned int count) { writeValues<unsigned int>(values, count); }
+    void readFloats(float *values, unsigned int count) { readValues<float>(values, count); }
+    void writeFloats(const float *values, unsigned int count) { writeValues<float>(values, count); }
+    void readDoubles(double *values, unsigned int count) { readValues<double>(values, count); }
+    void writeDoubles(const double *values, unsigned int count) { writeValues<double>(values, count); }
+
     void writeString(const char *value)
     {
         if (!value)
@@ -272,6 +381,7 @@ public:
         if ((int)_data.size() < _position + length)
         {
             _data.resize(_position + length);
+            updateExternalMemory();
         }
 
         char *ptr = (char *)&_data[_position];
@@ -283,49 +393,70 @@ public:
     // note that the string returned is only valid between reads
     const char *readString()
     {
-        static utString svalue;
-
-        int length = readValue<int>();
+        unsigned int length;
+        const char   *bytes = readStringView(length);
 
-        if (!length)
-        {
-            return "";
-        }
+        _stringValue.fromBytes(bytes, length);
+        return _stringValue.c_str();
+    }
 
-        lmAssert(_position + length <= _data.size(), "Insufficient data available for length of %d (use readStringBytes if you don't have a 32-bit integer length header)", length);
+    /*
+     * Like readString, but without copying: returns the string's bytes
+     * within the array and sets length. They are not NULL terminated and
+     * only valid until the array is written to or resized
+     */
+    const char *readStringView(unsigned int& length)
+    {
+        int header = readValue<int>();
 
-        svalue.fromBytes(&_data[_position], length);
-        
-        _position += length;
+        lmAssert(header >= 0 && _position + header <= _data.size(), "Insufficient data available for length of %d (use readUTFBytes if you don't have a 32-bit integer length header)", header);
 
-        return svalue.c_str();
+        length = (unsigned int)header;
+        return readUTFBytesView(length);
     }
 
 
     // TODO: String isn't Unicode ready yet
     const char *readUTF()
     {
-        unsigned short length = readValue<unsigned short>();
+        unsigned int length;
+        const char   *bytes = readUTFView(length);
 
-        if (!length)
-        {
-            return "";
-        }
+        _stringValue.fromBytes(bytes, length);
+        return _stringValue.c_str();
+    }
+
+    // See readStringView
+    const char *readUTFView(unsigned int& length)
+    {
+        length = readValue<unsigned short>();
 
         lmAssert(_position + length <= _data.size(), "Insufficient data available for length of %d (use readUTFBytes if you don't have a 16-bit unsigned integer length header)", length);
 
-        return readUTFBytes(length);
+        return readUTFBytesView(length);
     }
 
     const char *readUTFBytes(unsigned int length)
     {
-        static utString svalue;
-        
-        svalue.fromBytes(&_data[_position], length);
+        _stringValue.fromBytes(readUTFBytesView(length), length);
+        return _stringValue.c_str();
+    }
+
+    // See readStringView
+    const char *readUTFBytesView(unsigned int length)
+    {
+        if (!length)
+        {
+            return "";
+        }
+
+        lmAssert(_position + length <= _data.size(), "Insufficient data available for length of %d", length);
+
+        const char *bytes = (const char *)&_data[_position];
 
         _position += length;
 
-        return svalue.c_str();
+        return bytes;
     }
 
     void writeUTF(const char *value)
@@ -358,6 +489,7 @@ public:
         if ((UTsize)_data.size() < _position + length)
         {
             _data.resize(_position + length);
+            updateExternalMemory();
         }
 
         char *ptr = (char *)&_data[_position];
@@ -383,19 +515,21 @@ public:
      */
     const char *toString()
     {
-        static utString svalue;
-
         if (_data.ptr() != NULL)
         {
-            svalue  = (const char *)_data.ptr();
-            svalue += "\0"; // ensure null terminated
+            // Up to the first NULL, if any.
+            const char *bytes = (const char *)_data.ptr();
+            UTsize     length = 0;
+            while (length < _data.size() && bytes[length]) length++;
+
+            _stringValue.fromBytes(bytes, (int)length);
         }
         else
         {
-            svalue = "";
+            _stringValue = "";
         }
 
-        return svalue.c_str();
+        return _stringValue.c_str();
     }
 
     /*
@@ -407,12 +541,26 @@ public:
         _data.resize(size);
         memcpy(_data.ptr(), src, size);
         _position = 0;
+        updateExternalMemory();
     }
 
     void attach(void *memory, UTsize size)
     {
         _position = 0;
         _data.attach(memory, size);
+        updateExternalMemory();
+    }
+
+    /*
+     * Takes the data of other without copying it where the compiler has
+     * move support, other is left empty and both positions reset to 0
+     */
+    void transferFrom(utByteArray& other)
+    {
+        _data     = UT_MOVE(other._data);
+        _position = 0;
+        other.clear();
+        updateExternalMemory();
     }
 
     /*
@@ -448,7 +596,8 @@ public:
     void resize(UTsize size)
     {
         _position = _position > size ? size : _position;
-        return _data.resize(size);
+        _data.resize(size);
+        updateExternalMemory();
     }
 
     /*
@@ -467,8 +616,9 @@ public:
     /*
      * Compress the ByteArray data with the zlib compression algorithm.
      * The ByteArray gets resized to the compressed size of the data.
+     * level goes from 1 (fastest) to 9 (smallest), -1 is the zlib default.
      */
-    void compress();
+    void compress(int level = -1);
 
     /*
      * Uncompress zlib or gzip compressed data. uncompressedSize is equivalent to
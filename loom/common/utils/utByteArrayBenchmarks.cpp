@@ -0,0 +1,145 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/common/core/benchmark.h"
+#include "loom/common/utils/utByteArray.h"
+
+#define BYTEARRAYBENCH_RECORDS    1024
+
+BENCHMARK_FIXTURE(utByteArray)
+{
+    BENCHMARK_FIXTURE_ENTRY(utByteArray_writeRecords);
+    BENCHMARK_FIXTURE_ENTRY(utByteArray_readRecords);
+    BENCHMARK_FIXTURE_ENTRY(utByteArray_writeFloats);
+    BENCHMARK_FIXTURE_ENTRY(utByteArray_compress);
+    BENCHMARK_FIXTURE_ENTRY(utByteArray_uncompress);
+}
+
+// A record as a save file or network message would have it
+static void writeRecords(utByteArray& bytes)
+{
+    for (int j = 0; j < BYTEARRAYBENCH_RECORDS; j++)
+    {
+        bytes.writeInt(j);
+        bytes.writeFloat(j * 0.5f);
+        bytes.writeDouble(j * 0.25);
+        bytes.writeBoolean((j & 1) != 0);
+        bytes.writeUTF("loom2d.display.Sprite");
+    }
+}
+
+// One iteration serializes BYTEARRAYBENCH_RECORDS records
+BENCHMARK(utByteArray_writeRecords)
+{
+    utByteArray bytes;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        bytes.setPosition(0);
+        writeRecords(bytes);
+    }
+
+    loom_benchmark_doNotOptimize(bytes.getDataPtr());
+}
+
+BENCHMARK(utByteArray_readRecords)
+{
+    loom_benchmark_pauseTiming();
+    utByteArray bytes;
+    writeRecords(bytes);
+    loom_benchmark_resumeTiming();
+
+    double sum = 0;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        bytes.setPosition(0);
+
+        for (int j = 0; j < BYTEARRAYBENCH_RECORDS; j++)
+        {
+            sum += bytes.readInt();
+            sum += bytes.readFloat();
+            sum += bytes.readDouble();
+            sum += bytes.readBoolean();
+            sum += bytes.readUTF()[0];
+        }
+    }
+
+    loom_benchmark_doNotOptimize(&sum);
+}
+
+// One iteration writes a vertex buffer's worth of floats in bulk
+BENCHMARK(utByteArray_writeFloats)
+{
+    static float values[4096];
+
+    for (int j = 0; j < 4096; j++)
+    {
+        values[j] = j * 0.5f;
+    }
+
+    utByteArray bytes;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        bytes.setPosition(0);
+        bytes.writeFloats(values, 4096);
+    }
+
+    loom_benchmark_doNotOptimize(bytes.getDataPtr());
+}
+
+// One iteration compresses the serialized records
+BENCHMARK(utByteArray_compress)
+{
+    for (int i = 0; i < iterations; i++)
+    {
+        loom_benchmark_pauseTiming();
+        utByteArray bytes;
+        writeRecords(bytes);
+        loom_benchmark_resumeTiming();
+
+        bytes.compress();
+
+        loom_benchmark_doNotOptimize(bytes.getDataPtr());
+    }
+}
+
+BENCHMARK(utByteArray_uncompress)
+{
+    loom_benchmark_pauseTiming();
+    utByteArray compressed;
+    writeRecords(compressed);
+    UTsize size = compressed.getSize();
+    compressed.compress();
+    loom_benchmark_resumeTiming();
+
+    for (int i = 0; i < iterations; i++)
+    {
+        loom_benchmark_pauseTiming();
+        utByteArray bytes;
+        bytes.writeBytes(&compressed);
+        loom_benchmark_resumeTiming();
+
+        bytes.uncompress(size);
+
+        loom_benchmark_doNotOptimize(bytes.getDataPtr());
+    }
+}
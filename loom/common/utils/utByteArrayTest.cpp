@@ -0,0 +1,143 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+
+#include "loom/common/utils/utByteArray.h"
+#include "seatest.h"
+
+SEATEST_FIXTURE(utByteArray)
+{
+    SEATEST_FIXTURE_ENTRY(utByteArray_stringViews);
+    SEATEST_FIXTURE_ENTRY(utByteArray_bulkValues);
+    SEATEST_FIXTURE_ENTRY(utByteArray_endianSwap);
+    SEATEST_FIXTURE_ENTRY(utByteArray_externalMemory);
+}
+
+SEATEST_TEST(utByteArray_stringViews)
+{
+    utByteArray bytes;
+
+    bytes.writeString("string");
+    bytes.writeUTF("utf");
+    bytes.writeString("");
+    bytes.setPosition(0);
+
+    unsigned int length;
+    const char   *view = bytes.readStringView(length);
+    assert_int_equal(6, length);
+    assert_true(!strncmp(view, "string", length));
+    assert_true(view == (const char *)bytes.getDataPtr() + sizeof(int));
+
+    view = bytes.readUTFView(length);
+    assert_int_equal(3, length);
+    assert_true(!strncmp(view, "utf", length));
+
+    view = bytes.readStringView(length);
+    assert_int_equal(0, length);
+    assert_int_equal(0, bytes.bytesAvailable());
+
+    // The copying readers still NULL terminate.
+    bytes.setPosition(0);
+    assert_string_equal("string", bytes.readString());
+    assert_string_equal("utf", bytes.readUTF());
+}
+
+SEATEST_TEST(utByteArray_bulkValues)
+{
+    utByteArray bytes;
+
+    int   ints[11];
+    float floats[7];
+    for (int i = 0; i < 11; i++) ints[i] = i * 0x01020304 - 5;
+    for (int i = 0; i < 7; i++) floats[i] = i * 0.25f;
+
+    // Unaligned on purpose.
+    bytes.writeByte(1);
+    bytes.writeInts(ints, 11);
+    bytes.writeFloats(floats, 7);
+    bytes.setPosition(1);
+
+    // Bulk writes match one value at a time.
+    for (int i = 0; i < 11; i++) assert_int_equal(ints[i], bytes.readInt());
+    for (int i = 0; i < 7; i++) assert_float_equal(floats[i], bytes.readFloat(), 0.0f);
+
+    int   readInts[11];
+    float readFloats[7];
+    bytes.setPosition(1);
+    bytes.readInts(readInts, 11);
+    bytes.readFloats(readFloats, 7);
+    assert_true(!memcmp(ints, readInts, sizeof(ints)));
+    assert_true(!memcmp(floats, readFloats, sizeof(floats)));
+    assert_int_equal(0, bytes.bytesAvailable());
+}
+
+SEATEST_TEST(utByteArray_endianSwap)
+{
+    unsigned short     shorts[11];
+    unsigned int       uints[11];
+    unsigned long long longs[11];
+
+    for (unsigned int i = 0; i < 11; i++)
+    {
+        shorts[i] = (unsigned short)(0x0102 * (i + 1));
+        uints[i]  = 0x01020304u * (i + 1);
+        longs[i]  = 0x0102030405060708ull * (i + 1);
+    }
+
+    endianSwapArray(shorts, 11);
+    endianSwapArray(uints, 11);
+    endianSwapArray(longs, 11);
+
+    for (unsigned int i = 0; i < 11; i++)
+    {
+        assert_true(shorts[i] == endianSwap((unsigned short)(0x0102 * (i + 1))));
+        assert_true(uints[i] == endianSwap(0x01020304u * (i + 1)));
+        assert_true(longs[i] == endianSwap(0x0102030405060708ull * (i + 1)));
+    }
+}
+
+SEATEST_TEST(utByteArray_externalMemory)
+{
+    long long base = loom_allocator_getExternalBytes();
+
+    {
+        utByteArray bytes;
+        bytes.writeInt(1);
+        assert_true(loom_allocator_getExternalBytes() == base);
+
+        bytes.setReportsExternalMemory(true);
+        assert_true(loom_allocator_getExternalBytes() == base + 4);
+
+        unsigned int values[16] = { 0 };
+        bytes.writeUnsignedInts(values, 16);
+        assert_true(loom_allocator_getExternalBytes() == base + 68);
+
+        // Copies don't report
+        utByteArray copy(bytes);
+        copy.resize(1000);
+        assert_true(loom_allocator_getExternalBytes() == base + 68);
+
+        bytes.resize(10);
+        assert_true(loom_allocator_getExternalBytes() == base + 10);
+    }
+
+    assert_true(loom_allocator_getExternalBytes() == base);
+}
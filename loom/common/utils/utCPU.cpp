@@ -0,0 +1,87 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/common/utils/utCPU.h"
+
+#if UT_CPU_X86 && (UT_COMPILER == UT_COMPILER_MSVC)
+#include <intrin.h>
+#elif UT_CPU_X86
+#include <cpuid.h>
+#endif
+
+static int queryFeatures()
+{
+    int features = 0;
+
+#if UT_CPU_X86
+    unsigned int regs[4] = { 0, 0, 0, 0 }; // eax, ebx, ecx, edx
+
+#if UT_COMPILER == UT_COMPILER_MSVC
+    __cpuid((int *)regs, 0);
+    unsigned int maxLeaf = regs[0];
+
+    __cpuid((int *)regs, 1);
+#else
+    unsigned int maxLeaf = __get_cpuid_max(0, NULL);
+
+    __cpuid(1, regs[0], regs[1], regs[2], regs[3]);
+#endif
+
+    if (regs[2] & (1 << 9))
+    {
+        features |= UT_CPU_SSSE3;
+    }
+
+    if (regs[2] & (1 << 19))
+    {
+        features |= UT_CPU_SSE41;
+    }
+
+    if (maxLeaf >= 7)
+    {
+#if UT_COMPILER == UT_COMPILER_MSVC
+        __cpuidex((int *)regs, 7, 0);
+#else
+        __cpuid_count(7, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+
+        if (regs[1] & (1 << 29))
+        {
+            features |= UT_CPU_SHA;
+        }
+    }
+#endif
+
+    return features;
+}
+
+
+int utCPUFeatures()
+{
+    // Racing threads store the same value.
+    static volatile int features = -1;
+
+    if (features < 0)
+    {
+        features = queryFeatures();
+    }
+
+    return features;
+}
@@ -0,0 +1,84 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _UTILS_UTCPU_H_
+#define _UTILS_UTCPU_H_
+
+#include "loom/common/utils/utCommon.h"
+
+/*
+ * Instruction set extensions for the SIMD paths in utSHA2, utBase64 etc.
+ *
+ * On x86 the paths for extensions beyond the build's baseline are compiled
+ * with UT_TARGET and picked at runtime with utCPUHas, so one binary runs
+ * everywhere. On ARM the extensions are used when the build targets them,
+ * NEON being part of every arm64 and armv7 Android and iOS build.
+ */
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+# define UT_CPU_X86    1
+#else
+# define UT_CPU_X86    0
+#endif
+
+// Compiles a function for extensions beyond the build's baseline, MSVC
+// needs nothing to use their intrinsics. GCC gained the SHA extensions in
+// 4.9 and clang in 3.4.
+#if UT_CPU_X86 && (UT_COMPILER == UT_COMPILER_MSVC)
+# define UT_TARGET(x)
+# define UT_CPU_X86_SIMD    (_MSC_VER >= 1900)
+#elif UT_CPU_X86 && (defined(__clang__) || (__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))
+# define UT_TARGET(x)       __attribute__((target(x)))
+# define UT_CPU_X86_SIMD    1
+#else
+# define UT_TARGET(x)
+# define UT_CPU_X86_SIMD    0
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# define UT_CPU_NEON    1
+#else
+# define UT_CPU_NEON    0
+#endif
+
+// ARMv8 SHA-2 instructions, there being no portable way to query them at
+// runtime on Android.
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2))
+# define UT_CPU_ARM_SHA2    1
+#else
+# define UT_CPU_ARM_SHA2    0
+#endif
+
+enum utCPUFeature
+{
+    UT_CPU_SSSE3 = 1 << 0,
+    UT_CPU_SSE41 = 1 << 1,
+    UT_CPU_SHA   = 1 << 2
+};
+
+// utCPUFeatures supported by the running CPU, queried once, 0 off x86.
+int utCPUFeatures();
+
+inline bool utCPUHas(int features)
+{
+    return (utCPUFeatures() & features) == features;
+}
+
+#endif
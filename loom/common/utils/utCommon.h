@@ -25,7 +25,14 @@
 #ifndef _utCommon_h_
 #define _utCommon_h_
 
+// Loom2D transform math, double precision unless built with
+// LOOM_FLOAT_SCALAR (FLOAT_SCALAR in the Rakefile), which halves the
+// size of the scene graph and saves converting to float for rendering
+#ifdef LOOM_FLOAT_SCALAR
+typedef float lmscalar;
+#else
 typedef double lmscalar;
+#endif
 
 #include "utEndian.h"
 #include <assert.h>
@@ -109,6 +116,17 @@ UT_ASSERTCOMP(sizeof(void *) == 4, VOID_IS_4);
 #  define UT_INLINE    inline
 #endif
 
+// Move semantics and emplacement need rvalue references and variadic
+// templates, older compilers copy instead.
+#if (__cplusplus >= 201103L) || (defined(_MSC_VER) && _MSC_VER >= 1800)
+# include <utility>
+# define UT_HAS_MOVE    1
+# define UT_MOVE(x)     std::move(x)
+#else
+# define UT_HAS_MOVE    0
+# define UT_MOVE(x)     (x)
+#endif
+
 #if (defined (_WIN32) && (_MSC_VER) && _MSC_VER >= 1400)
 #define UT_ATTRIBUTE_ALIGNED_CLASS16(a)    __declspec(align(16)) a
 #define UT_ATTRIBUTE_ALIGN16    __declspec(align(16))
@@ -0,0 +1,196 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <string.h>
+
+#include "zlib.h"
+
+#include "loom/common/core/allocator.h"
+#include "loom/common/utils/utCompressionStream.h"
+
+// Output is made room for in steps of at least this many bytes
+#define OUTPUT_CHUNK    16384
+
+utCompressionStream::utCompressionStream() :
+    stream(NULL), deflating(false), finished(false), totalIn(0), totalOut(0)
+{
+}
+
+
+utCompressionStream::~utCompressionStream()
+{
+    end();
+}
+
+
+bool utCompressionStream::beginDeflate(int level)
+{
+    return begin(true, level);
+}
+
+
+bool utCompressionStream::beginInflate()
+{
+    return begin(false, 0);
+}
+
+
+bool utCompressionStream::begin(bool compressing, int level)
+{
+    end();
+
+    stream = lmNew(NULL) z_stream;
+    memset(stream, 0, sizeof(z_stream));
+
+    int ret = compressing ? deflateInit(stream, level) : inflateInit2(stream, 15 + 32); // zlib + gzip autodetection
+    if (ret != Z_OK)
+    {
+        lmDelete(NULL, stream);
+        stream = NULL;
+        return false;
+    }
+
+    deflating = compressing;
+    finished  = false;
+    totalIn   = 0;
+    totalOut  = 0;
+
+    return true;
+}
+
+
+void utCompressionStream::end()
+{
+    if (!stream)
+    {
+        return;
+    }
+
+    if (deflating)
+    {
+        deflateEnd(stream);
+    }
+    else
+    {
+        inflateEnd(stream);
+    }
+
+    lmDelete(NULL, stream);
+    stream = NULL;
+}
+
+
+bool utCompressionStream::write(const void *input, UTsize size, utByteArray& output)
+{
+    if (!stream)
+    {
+        return false;
+    }
+
+    return run(input, size, false, output);
+}
+
+
+bool utCompressionStream::finish(utByteArray& output)
+{
+    if (!stream)
+    {
+        return false;
+    }
+
+    bool success = run(NULL, 0, true, output) && (deflating || finished);
+
+    end();
+
+    return success;
+}
+
+
+bool utCompressionStream::run(const void *input, UTsize size, bool flush, utByteArray& output)
+{
+    // past the end of the compressed data, the rest is ignored
+    if (finished)
+    {
+        return true;
+    }
+
+    stream->next_in  = (Bytef *)input;
+    stream->avail_in = (uInt)size;
+
+    utArray<unsigned char> *data = output.getInternalArray();
+
+    for ( ; ; )
+    {
+        // space reserved up front is used first, so output of a known size
+        // is never copied; after that grown geometrically as output can
+        // arrive in many small steps
+        UTsize used = output.getSize();
+        UTsize room = data->capacity() - used;
+
+        if (!room)
+        {
+            room = stream->avail_in > OUTPUT_CHUNK ? stream->avail_in : OUTPUT_CHUNK;
+
+            UTsize capacity = data->capacity() * 2;
+            data->reserve(capacity > used + room ? capacity : used + room);
+        }
+
+        output.resize(used + room);
+
+        stream->next_out  = (Bytef *)output.getDataPtr() + used;
+        stream->avail_out = (uInt)room;
+
+        int ret;
+        if (deflating)
+        {
+            ret = deflate(stream, flush ? Z_FINISH : Z_NO_FLUSH);
+        }
+        else
+        {
+            ret = inflate(stream, Z_NO_FLUSH);
+        }
+
+        UTsize produced = room - stream->avail_out;
+        output.resize(used + produced);
+        totalOut += produced;
+
+        if (ret == Z_STREAM_END)
+        {
+            finished = !deflating;
+            break;
+        }
+
+        // Z_BUF_ERROR only means no progress was possible, which is fine
+        // once the input ran out with room to spare
+        if ((ret != Z_OK) && (ret != Z_BUF_ERROR))
+        {
+            return false;
+        }
+
+        if ((stream->avail_in == 0) && (stream->avail_out != 0) && !(flush && deflating))
+        {
+            break;
+        }
+    }
+
+    totalIn += size - stream->avail_in;
+
+    return true;
+}
@@ -0,0 +1,84 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _UTILS_UTCOMPRESSIONSTREAM_H_
+#define _UTILS_UTCOMPRESSIONSTREAM_H_
+
+#include "loom/common/utils/utByteArray.h"
+
+struct z_stream_s;
+
+/*
+ * Incremental zlib compression, for data that arrives or is produced in
+ * chunks, like a download or a save file being serialized, so neither the
+ * whole input nor the whole output has to be held at once:
+ *
+ *   utCompressionStream stream;
+ *   stream.beginDeflate();
+ *   while (more) stream.write(chunk, chunkSize, compressed);
+ *   stream.finish(compressed);
+ *
+ * Output is appended to the end of the given ByteArray, whose position is
+ * left as it is. Space reserved in it is filled before it's grown, so
+ * reserving the uncompressed size when it's known avoids any copies.
+ * Inflating takes zlib or gzip data, like utByteArray::uncompress.
+ */
+class utCompressionStream
+{
+public:
+    utCompressionStream();
+    ~utCompressionStream();
+
+    // level goes from 1 (fastest) to 9 (smallest), -1 is the zlib default.
+    bool beginDeflate(int level = -1);
+    bool beginInflate();
+
+    // Runs size bytes of input through the stream. False on corrupt input
+    // or when not begun.
+    bool write(const void *input, UTsize size, utByteArray& output);
+
+    // Flushes what's left and ends the stream. Inflating, false unless the
+    // compressed data was complete.
+    bool finish(utByteArray& output);
+
+    // Ends the stream, dropping anything not written out yet.
+    void end();
+
+    bool isActive() const { return stream != NULL; }
+
+    // Inflating, whether the end of the compressed data was reached.
+    bool isFinished() const { return finished; }
+
+    // Bytes taken in and given out since begun.
+    double getTotalIn() const { return totalIn; }
+    double getTotalOut() const { return totalOut; }
+
+private:
+    bool begin(bool compressing, int level);
+    bool run(const void *input, UTsize size, bool flush, utByteArray& output);
+
+    struct z_stream_s *stream;
+    bool              deflating;
+    bool              finished;
+    double            totalIn;
+    double            totalOut;
+};
+
+#endif
@@ -0,0 +1,150 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <string.h>
+
+#include "loom/common/utils/utCompressionStream.h"
+#include "seatest.h"
+
+SEATEST_FIXTURE(utCompressionStream)
+{
+    SEATEST_FIXTURE_ENTRY(utCompressionStream_chunks);
+    SEATEST_FIXTURE_ENTRY(utCompressionStream_byteArray);
+    SEATEST_FIXTURE_ENTRY(utCompressionStream_errors);
+}
+
+static void fill(utByteArray& bytes, UTsize size)
+{
+    bytes.resize(size);
+
+    unsigned char *data = (unsigned char *)bytes.getDataPtr();
+    for (UTsize i = 0; i < size; i++)
+    {
+        data[i] = (unsigned char)((i * 7) ^ (i >> 5));
+    }
+}
+
+static bool sameBytes(utByteArray& a, utByteArray& b)
+{
+    return (a.getSize() == b.getSize()) && !memcmp(a.getDataPtr(), b.getDataPtr(), a.getSize());
+}
+
+SEATEST_TEST(utCompressionStream_chunks)
+{
+    utByteArray original;
+    fill(original, 100000);
+
+    // Compressed in uneven chunks, the output lands after what's there.
+    utByteArray compressed;
+    compressed.writeInt(42);
+
+    utCompressionStream deflater;
+    assert_true(deflater.beginDeflate(9));
+
+    const unsigned char *input = (const unsigned char *)original.getDataPtr();
+    for (UTsize offset = 0; offset < original.getSize(); offset += 777)
+    {
+        UTsize size = original.getSize() - offset < 777 ? original.getSize() - offset : 777;
+        assert_true(deflater.write(input + offset, size, compressed));
+    }
+
+    assert_true(deflater.finish(compressed));
+    assert_false(deflater.isActive());
+    assert_true(deflater.getTotalIn() == 100000);
+    assert_true(deflater.getTotalOut() == compressed.getSize() - 4);
+    assert_int_equal(4, compressed.getPosition());
+
+    // Uncompressed a byte at a time.
+    utByteArray         uncompressed;
+    utCompressionStream inflater;
+    assert_true(inflater.beginInflate());
+
+    const unsigned char *packed = (const unsigned char *)compressed.getDataPtr() + 4;
+    for (UTsize i = 0; i < compressed.getSize() - 4; i++)
+    {
+        assert_true(inflater.write(packed + i, 1, uncompressed));
+    }
+
+    assert_true(inflater.isFinished());
+    assert_true(inflater.finish(uncompressed));
+    assert_true(sameBytes(original, uncompressed));
+}
+
+SEATEST_TEST(utCompressionStream_byteArray)
+{
+    utByteArray original;
+    fill(original, 50000);
+
+    utByteArray bytes;
+    bytes.writeBytes(&original);
+    bytes.compress();
+    assert_true(bytes.getSize() < original.getSize());
+
+    // Readable by a stream.
+    utByteArray         streamed;
+    utCompressionStream inflater;
+    inflater.beginInflate();
+    assert_true(inflater.write(bytes.getDataPtr(), bytes.getSize(), streamed));
+    assert_true(inflater.finish(streamed));
+    assert_true(sameBytes(original, streamed));
+
+    // Reserved up front, nothing is reallocated.
+    utByteArray exact;
+    exact.reserve(50000);
+    inflater.beginInflate();
+    assert_true(inflater.write(bytes.getDataPtr(), bytes.getSize(), exact));
+    assert_true(inflater.finish(exact));
+    assert_true(sameBytes(original, exact));
+    assert_int_equal(50000, exact.getInternalArray()->capacity());
+
+    // Exact size known up front.
+    bytes.uncompress(50000);
+    assert_true(sameBytes(original, bytes));
+    assert_int_equal(0, bytes.getPosition());
+
+    // Size guessed too small.
+    bytes.compress();
+    bytes.uncompress(0, 1000);
+    assert_true(sameBytes(original, bytes));
+}
+
+SEATEST_TEST(utCompressionStream_errors)
+{
+    utByteArray output;
+
+    utCompressionStream stream;
+    assert_false(stream.write("x", 1, output));
+    assert_false(stream.finish(output));
+
+    // Not zlib data.
+    stream.beginInflate();
+    assert_false(stream.write("not compressed at all", 21, output));
+    stream.end();
+
+    // Truncated.
+    utByteArray original;
+    fill(original, 10000);
+    original.compress();
+
+    stream.beginInflate();
+    assert_true(stream.write(original.getDataPtr(), original.getSize() / 2, output));
+    assert_false(stream.isFinished());
+    assert_false(stream.finish(output));
+}
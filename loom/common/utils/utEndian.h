@@ -163,5 +163,125 @@ DECLARE_TEMPLATIZED_ENDIAN_CONV(unsigned long long)
 DECLARE_TEMPLATIZED_ENDIAN_CONV(long long)
 DECLARE_TEMPLATIZED_ENDIAN_CONV(float)
 DECLARE_TEMPLATIZED_ENDIAN_CONV(double)
+
+
+//------------------------------------------------------------------------------
+// Bulk endian conversions, in place over count values
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UT_ENDIAN_SSE2    1
+#include <emmintrin.h>
+#else
+#define UT_ENDIAN_SSE2    0
+#endif
+
+#if UT_ENDIAN_SSE2
+// Swaps the bytes of each 16 bit lane.
+inline __m128i endianSwap16x8(__m128i v)
+{
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+
+// Swaps the bytes of each 32 bit lane, by swapping its 16 bit halves first.
+inline __m128i endianSwap32x4(__m128i v)
+{
+    v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+    return endianSwap16x8(v);
+}
+#endif
+
+
+inline void endianSwapArray(unsigned short *values, unsigned int count)
+{
+    unsigned int i = 0;
+
+#if UT_ENDIAN_SSE2
+    for ( ; i + 8 <= count; i += 8)
+    {
+        __m128i *p = (__m128i *)(values + i);
+        _mm_storeu_si128(p, endianSwap16x8(_mm_loadu_si128(p)));
+    }
+#endif
+
+    for ( ; i < count; i++)
+    {
+        values[i] = endianSwap(values[i]);
+    }
+}
+
+
+inline void endianSwapArray(unsigned int *values, unsigned int count)
+{
+    unsigned int i = 0;
+
+#if UT_ENDIAN_SSE2
+    for ( ; i + 4 <= count; i += 4)
+    {
+        __m128i *p = (__m128i *)(values + i);
+        _mm_storeu_si128(p, endianSwap32x4(_mm_loadu_si128(p)));
+    }
+#endif
+
+    for ( ; i < count; i++)
+    {
+        values[i] = endianSwap(values[i]);
+    }
+}
+
+
+inline void endianSwapArray(unsigned long long *values, unsigned int count)
+{
+    unsigned int i = 0;
+
+#if UT_ENDIAN_SSE2
+    for ( ; i + 2 <= count; i += 2)
+    {
+        // Swap within the 32 bit halves, then exchange the halves.
+        __m128i *p = (__m128i *)(values + i);
+        _mm_storeu_si128(p, _mm_shuffle_epi32(endianSwap32x4(_mm_loadu_si128(p)), _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+#endif
+
+    for ( ; i < count; i++)
+    {
+        values[i] = endianSwap(values[i]);
+    }
+}
+
+
+// Any other value type by its size, so float arrays swap as ints etc.
+template<typename T>
+inline void endianSwapArray(T *values, unsigned int count)
+{
+    switch (sizeof(T))
+    {
+    case 2: endianSwapArray((unsigned short *)values, count); break;
+    case 4: endianSwapArray((unsigned int *)values, count); break;
+    case 8: endianSwapArray((unsigned long long *)values, count); break;
+    default: break;
+    }
+}
+
+
+#if UT_ENDIAN == UT_ENDIAN_LITTLE
+template<typename T>
+inline void convertHostToLEndianArray(T *, unsigned int) {}
+template<typename T>
+inline void convertLEndianToHostArray(T *, unsigned int) {}
+template<typename T>
+inline void convertHostToBEndianArray(T *values, unsigned int count) { endianSwapArray(values, count); }
+template<typename T>
+inline void convertBEndianToHostArray(T *values, unsigned int count) { endianSwapArray(values, count); }
+#else
+template<typename T>
+inline void convertHostToLEndianArray(T *values, unsigned int count) { endianSwapArray(values, count); }
+template<typename T>
+inline void convertLEndianToHostArray(T *values, unsigned int count) { endianSwapArray(values, count); }
+template<typename T>
+inline void convertHostToBEndianArray(T *, unsigned int) {}
+template<typename T>
+inline void convertBEndianToHostArray(T *, unsigned int) {}
+#endif
 #endif //__cplusplus
 #endif
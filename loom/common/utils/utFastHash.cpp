@@ -0,0 +1,286 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "loom/common/utils/utFastHash.h"
+
+// Values are read little endian, as the algorithms specify.
+static inline unsigned int read32(const unsigned char *p)
+{
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+
+static inline unsigned long long read64(const unsigned char *p)
+{
+    return (unsigned long long)read32(p) | ((unsigned long long)read32(p + 4) << 32);
+}
+
+
+static inline unsigned int rotl32(unsigned int x, int r)
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+
+static inline unsigned long long rotl64(unsigned long long x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+
+static const unsigned int PRIME32_1 = 0x9E3779B1U;
+static const unsigned int PRIME32_2 = 0x85EBCA77U;
+static const unsigned int PRIME32_3 = 0xC2B2AE3DU;
+static const unsigned int PRIME32_4 = 0x27D4EB2FU;
+static const unsigned int PRIME32_5 = 0x165667B1U;
+
+static const unsigned long long PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const unsigned long long PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const unsigned long long PRIME64_3 = 0x165667B19E3779F9ULL;
+static const unsigned long long PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const unsigned long long PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline unsigned int round32(unsigned int acc, unsigned int input)
+{
+    return rotl32(acc + input * PRIME32_2, 13) * PRIME32_1;
+}
+
+
+static inline unsigned long long round64(unsigned long long acc, unsigned long long input)
+{
+    return rotl64(acc + input * PRIME64_2, 31) * PRIME64_1;
+}
+
+
+static inline unsigned long long mergeRound64(unsigned long long acc, unsigned long long value)
+{
+    return (acc ^ round64(0, value)) * PRIME64_1 + PRIME64_4;
+}
+
+
+unsigned int utFastHash::hash32(const void *data, size_t length, unsigned int seed)
+{
+    const unsigned char *p   = (const unsigned char *)data;
+    const unsigned char *end = p + length;
+    unsigned int        h;
+
+    if (length >= 16)
+    {
+        unsigned int v1 = seed + PRIME32_1 + PRIME32_2;
+        unsigned int v2 = seed + PRIME32_2;
+        unsigned int v3 = seed;
+        unsigned int v4 = seed - PRIME32_1;
+
+        for ( ; p + 16 <= end; p += 16)
+        {
+            v1 = round32(v1, read32(p));
+            v2 = round32(v2, read32(p + 4));
+            v3 = round32(v3, read32(p + 8));
+            v4 = round32(v4, read32(p + 12));
+        }
+
+        h = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+    }
+    else
+    {
+        h = seed + PRIME32_5;
+    }
+
+    h += (unsigned int)length;
+
+    for ( ; p + 4 <= end; p += 4)
+    {
+        h = rotl32(h + read32(p) * PRIME32_3, 17) * PRIME32_4;
+    }
+
+    for ( ; p < end; p++)
+    {
+        h = rotl32(h + *p * PRIME32_5, 11) * PRIME32_1;
+    }
+
+    h ^= h >> 15;
+    h *= PRIME32_2;
+    h ^= h >> 13;
+    h *= PRIME32_3;
+    h ^= h >> 16;
+
+    return h;
+}
+
+
+// The tail and avalanche of XXH64, after the 32 byte stripes.
+static unsigned long long finalize64(unsigned long long h, const unsigned char *p, size_t length)
+{
+    const unsigned char *end = p + length;
+
+    for ( ; p + 8 <= end; p += 8)
+    {
+        h ^= round64(0, read64(p));
+        h  = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+    }
+
+    if (p + 4 <= end)
+    {
+        h ^= (unsigned long long)read32(p) * PRIME64_1;
+        h  = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+
+    for ( ; p < end; p++)
+    {
+        h ^= *p * PRIME64_5;
+        h  = rotl64(h, 11) * PRIME64_1;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+
+    return h;
+}
+
+
+static unsigned long long merge64(const unsigned long long *acc)
+{
+    unsigned long long h = rotl64(acc[0], 1) + rotl64(acc[1], 7) + rotl64(acc[2], 12) + rotl64(acc[3], 18);
+
+    for (int i = 0; i < 4; i++)
+    {
+        h = mergeRound64(h, acc[i]);
+    }
+
+    return h;
+}
+
+
+unsigned long long utFastHash::hash64(const void *data, size_t length, unsigned long long seed)
+{
+    const unsigned char *p   = (const unsigned char *)data;
+    const unsigned char *end = p + length;
+    unsigned long long  h;
+
+    if (length >= 32)
+    {
+        unsigned long long acc[4] = { seed + PRIME64_1 + PRIME64_2, seed + PRIME64_2, seed, seed - PRIME64_1 };
+
+        for ( ; p + 32 <= end; p += 32)
+        {
+            acc[0] = round64(acc[0], read64(p));
+            acc[1] = round64(acc[1], read64(p + 8));
+            acc[2] = round64(acc[2], read64(p + 16));
+            acc[3] = round64(acc[3], read64(p + 24));
+        }
+
+        h = merge64(acc);
+    }
+    else
+    {
+        h = seed + PRIME64_5;
+    }
+
+    h += (unsigned long long)length;
+
+    return finalize64(h, p, (size_t)(end - p));
+}
+
+
+utString utFastHash::hash64String(const void *data, size_t length, unsigned long long seed)
+{
+    unsigned long long h = hash64(data, length, seed);
+    char               buffer[17];
+
+    snprintf(buffer, sizeof(buffer), "%08x%08x", (unsigned int)(h >> 32), (unsigned int)h);
+
+    return utString(buffer);
+}
+
+
+void utFastHash64::reset(unsigned long long seed)
+{
+    m_seed     = seed;
+    m_total    = 0;
+    m_buffered = 0;
+
+    m_acc[0] = seed + PRIME64_1 + PRIME64_2;
+    m_acc[1] = seed + PRIME64_2;
+    m_acc[2] = seed;
+    m_acc[3] = seed - PRIME64_1;
+}
+
+
+void utFastHash64::update(const void *data, size_t length)
+{
+    const unsigned char *p   = (const unsigned char *)data;
+    const unsigned char *end = p + length;
+
+    m_total += length;
+
+    // Top up a partial stripe first.
+    if (m_buffered)
+    {
+        size_t fill = 32 - m_buffered;
+
+        if (length < fill)
+        {
+            memcpy(m_buffer + m_buffered, p, length);
+            m_buffered += (unsigned int)length;
+            return;
+        }
+
+        memcpy(m_buffer + m_buffered, p, fill);
+        p += fill;
+
+        for (int i = 0; i < 4; i++)
+        {
+            m_acc[i] = round64(m_acc[i], read64(m_buffer + i * 8));
+        }
+
+        m_buffered = 0;
+    }
+
+    for ( ; p + 32 <= end; p += 32)
+    {
+        m_acc[0] = round64(m_acc[0], read64(p));
+        m_acc[1] = round64(m_acc[1], read64(p + 8));
+        m_acc[2] = round64(m_acc[2], read64(p + 16));
+        m_acc[3] = round64(m_acc[3], read64(p + 24));
+    }
+
+    if (p < end)
+    {
+        memcpy(m_buffer, p, (size_t)(end - p));
+        m_buffered = (unsigned int)(end - p);
+    }
+}
+
+
+unsigned long long utFastHash64::digest() const
+{
+    unsigned long long h = m_total >= 32 ? merge64(m_acc) : m_seed + PRIME64_5;
+
+    h += m_total;
+
+    return finalize64(h, m_buffer, m_buffered);
+}
@@ -0,0 +1,67 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _UTILS_UTFASTHASH_H_
+#define _UTILS_UTFASTHASH_H_
+
+#include <stddef.h>
+
+#include "loom/common/utils/utString.h"
+
+/*
+ * Non cryptographic hashes for cache keys and deduplication, the xxHash
+ * algorithms (XXH32 and XXH64), so results match other xxHash
+ * implementations. Several times faster than MD5 or SHA-2, but not for
+ * anything that has to resist deliberate collisions.
+ *
+ * XXH64 is the faster of the two on 64 bit CPUs, XXH32 on 32 bit ones.
+ */
+class utFastHash
+{
+public:
+    static unsigned int hash32(const void *data, size_t length, unsigned int seed = 0);
+    static unsigned long long hash64(const void *data, size_t length, unsigned long long seed = 0);
+
+    // hash64 as 16 lowercase hex digits.
+    static utString hash64String(const void *data, size_t length, unsigned long long seed = 0);
+};
+
+/*
+ * XXH64 over data arriving in pieces, such as a download or a file read in
+ * chunks; the result matches hash64 over all of it.
+ */
+class utFastHash64
+{
+public:
+    utFastHash64(unsigned long long seed = 0) { reset(seed); }
+
+    void reset(unsigned long long seed = 0);
+    void update(const void *data, size_t length);
+    unsigned long long digest() const;
+
+protected:
+    unsigned long long m_acc[4];
+    unsigned long long m_seed;
+    unsigned long long m_total;
+    unsigned char      m_buffer[32];
+    unsigned int       m_buffered;
+};
+
+#endif
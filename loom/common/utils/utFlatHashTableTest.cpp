@@ -0,0 +1,184 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#include "loom/common/core/log.h"
+#include "loom/common/platform/platformTime.h"
+#include "loom/common/utils/utTypes.h"
+#include "loom/common/utils/utString.h"
+#include "seatest.h"
+
+lmDefineLogGroup(gFlatHashTestLogGroup, "utFlatHashTable", 1, LoomLogInfo);
+
+SEATEST_FIXTURE(utFlatHashTable)
+{
+    SEATEST_FIXTURE_ENTRY(utFlatHashTable_basic);
+    SEATEST_FIXTURE_ENTRY(utFlatHashTable_matchesHashTable);
+    SEATEST_FIXTURE_ENTRY(utFlatHashTable_benchmark);
+}
+
+SEATEST_TEST(utFlatHashTable_basic)
+{
+    utFlatHashTable<utHashedString, int> table;
+
+    assert_true(table.get("missing") == NULL);
+
+    assert_true(table.insert("one", 1));
+    assert_true(table.insert("two", 2));
+    assert_false(table.insert("one", 3));
+    table.set("three", 3);
+    table.set("one", 11);
+
+    assert_int_equal(table.size(), 3);
+    assert_int_equal(*table.get("one"), 11);
+    assert_int_equal(*table.get("two"), 2);
+    assert_int_equal(*table.get("three"), 3);
+
+    // Entries stay in insertion order, removal moves the last one up.
+    assert_true(table.keyAt(0).str() == "one");
+    table.remove("one");
+    assert_int_equal(table.size(), 2);
+    assert_true(table.get("one") == NULL);
+    assert_true(table.keyAt(0).str() == "three");
+    assert_int_equal(table.at(table.find("two")), 2);
+
+    utFlatHashTable<utHashedString, int> copy(table);
+    table.clear();
+    assert_true(table.empty());
+    assert_int_equal(*copy.get("three"), 3);
+
+    int sum = 0;
+    utHashTableIterator< utFlatHashTable<utHashedString, int> > it = copy.iterator();
+    while (it.hasMoreElements())
+    {
+        sum += it.peekNextValue();
+        it.next();
+    }
+    assert_int_equal(sum, 5);
+}
+
+// Random inserts and removes, growing and shrinking across many rehashes,
+// have to leave both tables with the same contents in the same order.
+SEATEST_TEST(utFlatHashTable_matchesHashTable)
+{
+    utHashTable<utIntHashKey, int>     reference;
+    utFlatHashTable<utIntHashKey, int> flat;
+
+    unsigned int seed = 12345;
+
+    for (int i = 0; i < 200000; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        int key = (seed >> 8) % 5000;
+
+        // Mostly inserting early on, mostly removing later.
+        if ((int)((seed >> 4) % 200000) > i)
+        {
+            assert_true(reference.insert(key, i) == flat.insert(key, i));
+        }
+        else
+        {
+            reference.remove(key);
+            flat.remove(key);
+        }
+    }
+
+    assert_int_equal(reference.size(), flat.size());
+
+    for (UTsize i = 0; i < reference.size(); i++)
+    {
+        assert_int_equal(reference.keyAt(i).key(), flat.keyAt(i).key());
+        assert_int_equal(reference.at(i), flat.at(i));
+    }
+
+    for (int key = 0; key < 5000; key++)
+    {
+        int *a = reference.get(key);
+        int *b = flat.get(key);
+        assert_true((a == NULL) == (b == NULL));
+        if (a && b)
+        {
+            assert_int_equal(*a, *b);
+        }
+    }
+}
+
+#define FLATHASH_BENCH_KEYS      4096
+#define FLATHASH_BENCH_ROUNDS    64
+
+template<typename Table, typename Key>
+static void flatHashBenchmark(const Key *keys, double *insertTime, double *lookupTime)
+{
+    loom_precision_timer_t timer = loom_startTimer();
+    Table                  tables[FLATHASH_BENCH_ROUNDS / 8];
+
+    for (int round = 0; round < FLATHASH_BENCH_ROUNDS / 8; round++)
+    {
+        for (int i = 0; i < FLATHASH_BENCH_KEYS; i++)
+        {
+            tables[round].insert(keys[i], i);
+        }
+    }
+
+    *insertTime = loom_readTimerNano(timer) / (FLATHASH_BENCH_KEYS * (FLATHASH_BENCH_ROUNDS / 8));
+
+    // Alternate between present keys and missing ones
+    int found = 0;
+    loom_resetTimer(timer);
+
+    for (int round = 0; round < FLATHASH_BENCH_ROUNDS; round++)
+    {
+        for (int i = 0; i < FLATHASH_BENCH_KEYS; i++)
+        {
+            found += tables[0].getByHash(keys[(i * 7) % FLATHASH_BENCH_KEYS].hash() + (i & 1)) != NULL;
+        }
+    }
+
+    *lookupTime = loom_readTimerNano(timer) / (FLATHASH_BENCH_KEYS * FLATHASH_BENCH_ROUNDS);
+    loom_destroyTimer(timer);
+
+    assert_true(found > 0);
+}
+
+SEATEST_TEST(utFlatHashTable_benchmark)
+{
+    static utIntHashKey     intKeys[FLATHASH_BENCH_KEYS];
+    static utFastStringHash stringKeys[FLATHASH_BENCH_KEYS];
+    char name[64];
+
+    for (int i = 0; i < FLATHASH_BENCH_KEYS; i++)
+    {
+        intKeys[i] = utIntHashKey(i * 16);
+        sprintf(name, "assets/textures/sprite%d.png", i);
+        stringKeys[i] = utFastStringHash(name);
+    }
+
+    double chainedInsert, chainedLookup, flatInsert, flatLookup;
+
+    flatHashBenchmark<utHashTable<utIntHashKey, int> >(intKeys, &chainedInsert, &chainedLookup);
+    flatHashBenchmark<utFlatHashTable<utIntHashKey, int> >(intKeys, &flatInsert, &flatLookup);
+    lmLogInfo(gFlatHashTestLogGroup, "Int keys, ns per insert: utHashTable %.1f, utFlatHashTable %.1f; per lookup: %.1f, %.1f",
+              chainedInsert, flatInsert, chainedLookup, flatLookup);
+
+    flatHashBenchmark<utHashTable<utFastStringHash, int> >(stringKeys, &chainedInsert, &chainedLookup);
+    flatHashBenchmark<utFlatHashTable<utFastStringHash, int> >(stringKeys, &flatInsert, &flatLookup);
+    lmLogInfo(gFlatHashTestLogGroup, "String keys, ns per insert: utHashTable %.1f, utFlatHashTable %.1f; per lookup: %.1f, %.1f",
+              chainedInsert, flatInsert, chainedLookup, flatLookup);
+}
@@ -0,0 +1,149 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/common/core/benchmark.h"
+#include "loom/common/utils/utTypes.h"
+#include "loom/common/utils/utString.h"
+
+#include <stdio.h>
+
+#define HASHBENCH_KEYS    4096
+
+static utIntHashKey   gHashIntKeys[HASHBENCH_KEYS];
+static utHashedString gHashStringKeys[HASHBENCH_KEYS];
+
+BENCHMARK_FIXTURE(utHashTable)
+{
+    char name[64];
+
+    for (int i = 0; i < HASHBENCH_KEYS; i++)
+    {
+        gHashIntKeys[i] = utIntHashKey(i * 16);
+        sprintf(name, "assets/textures/sprite%d.png", i);
+        gHashStringKeys[i] = utHashedString(name);
+    }
+
+    BENCHMARK_FIXTURE_ENTRY(utHashTable_insertInt);
+    BENCHMARK_FIXTURE_ENTRY(utHashTable_lookupInt);
+    BENCHMARK_FIXTURE_ENTRY(utHashTable_insertString);
+    BENCHMARK_FIXTURE_ENTRY(utHashTable_lookupString);
+    BENCHMARK_FIXTURE_ENTRY(utHashTable_remove);
+    BENCHMARK_FIXTURE_ENTRY(utFlatHashTable_insertInt);
+    BENCHMARK_FIXTURE_ENTRY(utFlatHashTable_lookupInt);
+    BENCHMARK_FIXTURE_ENTRY(utFlatHashTable_lookupString);
+}
+
+// One iteration fills a fresh table with every key
+template<typename Table, typename Key>
+static void hashInsert(const Key *keys, int iterations)
+{
+    for (int i = 0; i < iterations; i++)
+    {
+        Table table;
+
+        for (int j = 0; j < HASHBENCH_KEYS; j++)
+        {
+            table.insert(keys[j], j);
+        }
+
+        loom_benchmark_doNotOptimize(&table);
+    }
+}
+
+// One iteration looks up a key, present and missing ones alternating
+template<typename Table, typename Key>
+static void hashLookup(const Key *keys, int iterations)
+{
+    loom_benchmark_pauseTiming();
+    Table table;
+
+    for (int j = 0; j < HASHBENCH_KEYS; j += 2)
+    {
+        table.insert(keys[j], j);
+    }
+    loom_benchmark_resumeTiming();
+
+    int found = 0;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        found += table.get(keys[(i * 7) & (HASHBENCH_KEYS - 1)]) != NULL;
+    }
+
+    loom_benchmark_doNotOptimize(&found);
+}
+
+BENCHMARK(utHashTable_insertInt)
+{
+    hashInsert<utHashTable<utIntHashKey, int> >(gHashIntKeys, iterations);
+}
+
+BENCHMARK(utHashTable_lookupInt)
+{
+    hashLookup<utHashTable<utIntHashKey, int> >(gHashIntKeys, iterations);
+}
+
+BENCHMARK(utHashTable_insertString)
+{
+    hashInsert<utHashTable<utHashedString, int> >(gHashStringKeys, iterations);
+}
+
+BENCHMARK(utHashTable_lookupString)
+{
+    hashLookup<utHashTable<utHashedString, int> >(gHashStringKeys, iterations);
+}
+
+// One iteration fills a table, untimed, and removes every key
+BENCHMARK(utHashTable_remove)
+{
+    for (int i = 0; i < iterations; i++)
+    {
+        loom_benchmark_pauseTiming();
+        utHashTable<utIntHashKey, int> table;
+
+        for (int j = 0; j < HASHBENCH_KEYS; j++)
+        {
+            table.insert(gHashIntKeys[j], j);
+        }
+        loom_benchmark_resumeTiming();
+
+        for (int j = 0; j < HASHBENCH_KEYS; j++)
+        {
+            table.remove(gHashIntKeys[(j * 7) & (HASHBENCH_KEYS - 1)]);
+        }
+
+        loom_benchmark_doNotOptimize(&table);
+    }
+}
+
+BENCHMARK(utFlatHashTable_insertInt)
+{
+    hashInsert<utFlatHashTable<utIntHashKey, int> >(gHashIntKeys, iterations);
+}
+
+BENCHMARK(utFlatHashTable_lookupInt)
+{
+    hashLookup<utFlatHashTable<utIntHashKey, int> >(gHashIntKeys, iterations);
+}
+
+BENCHMARK(utFlatHashTable_lookupString)
+{
+    hashLookup<utFlatHashTable<utHashedString, int> >(gHashStringKeys, iterations);
+}
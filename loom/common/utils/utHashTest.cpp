@@ -0,0 +1,233 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#include <string.h>
+
+#include "loom/common/core/log.h"
+#include "loom/common/platform/platformTime.h"
+#include "loom/common/utils/utTypes.h"
+#include "loom/common/utils/utString.h"
+#include "loom/common/utils/utSHA2.h"
+#include "loom/common/utils/utBase64.h"
+#include "loom/common/utils/utFastHash.h"
+#include "loom/common/utils/md5.h"
+#include "seatest.h"
+
+lmDefineLogGroup(gHashTestLogGroup, "utHash", 1, LoomLogInfo);
+
+SEATEST_FIXTURE(utHash)
+{
+    SEATEST_FIXTURE_ENTRY(utHash_sha256);
+    SEATEST_FIXTURE_ENTRY(utHash_fastHash);
+    SEATEST_FIXTURE_ENTRY(utHash_base64);
+    SEATEST_FIXTURE_ENTRY(utHash_benchmark);
+}
+
+static utString sha256(const char *data, int length)
+{
+    utString out;
+
+    utSHA2::generateSHA256(data, length, out);
+    return out;
+}
+
+SEATEST_TEST(utHash_sha256)
+{
+    static const char *twoBlocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+
+    utArray<char> million;
+    million.resize(1000000);
+    memset(million.ptr(), 'a', million.size());
+
+    // Check both the hardware and the portable path, where there is one.
+    for (int hardware = 0; hardware < 2; hardware++)
+    {
+        utSHA2::setHardwareSHA256Enabled(hardware != 0);
+
+        assert_string_equal("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", sha256("abc", 3).c_str());
+        assert_string_equal("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1", sha256(twoBlocks, (int)strlen(twoBlocks)).c_str());
+        assert_string_equal("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0", sha256(million.ptr(), (int)million.size()).c_str());
+    }
+
+    utSHA2::setHardwareSHA256Enabled(true);
+}
+
+SEATEST_TEST(utHash_fastHash)
+{
+    assert_ulong_equal(0x02CC5D05UL, utFastHash::hash32("", 0));
+    assert_ulong_equal(0x32D153FFUL, utFastHash::hash32("abc", 3));
+    assert_true(utFastHash::hash64("", 0) == 0xEF46DB3751D8E999ULL);
+    assert_true(utFastHash::hash64("abc", 3) == 0x44BC2CF5AD770999ULL);
+    assert_string_equal("44bc2cf5ad770999", utFastHash::hash64String("abc", 3).c_str());
+
+    // Streaming in uneven pieces matches hashing in one go.
+    unsigned char data[1000];
+    for (int i = 0; i < 1000; i++)
+    {
+        data[i] = (unsigned char)(i * 7 + 3);
+    }
+
+    for (size_t step = 1; step < 80; step += 13)
+    {
+        utFastHash64 stream(42);
+
+        for (size_t i = 0; i < sizeof(data); i += step)
+        {
+            stream.update(data + i, i + step > sizeof(data) ? sizeof(data) - i : step);
+        }
+
+        assert_true(stream.digest() == utFastHash::hash64(data, sizeof(data), 42));
+    }
+
+    assert_false(utFastHash::hash64(data, sizeof(data)) == utFastHash::hash64(data, sizeof(data) - 1));
+}
+
+SEATEST_TEST(utHash_base64)
+{
+    utArray<unsigned char> bytes;
+
+    assert_string_equal("", utBase64::encode64(bytes).getBase64().c_str());
+
+    static const char *text = "Many hands make light work.";
+    bytes.resize((UTsize)strlen(text));
+    memcpy(bytes.ptr(), text, bytes.size());
+    assert_string_equal("TWFueSBoYW5kcyBtYWtlIGxpZ2h0IHdvcmsu", utBase64::encode64(bytes).getBase64().c_str());
+
+    // Padding, line breaks and other characters outside the alphabet are
+    // skipped.
+    utBase64 decoded = utBase64::decode64("TWFueSBoYW5k\ncyBtYWtlIGxp\r\nZ2h0IHdvcmsu");
+    assert_int_equal(bytes.size(), decoded.getData().size());
+    assert_true(!memcmp(bytes.ptr(), decoded.getData().ptr(), bytes.size()));
+    assert_int_equal(1, utBase64::decode64("QQ==").getData().size());
+    assert_int_equal(2, utBase64::decode64("QUI=").getData().size());
+
+    // Round trip every length across the SIMD block sizes, the tails go
+    // through the portable code.
+    for (UTsize length = 0; length < 200; length++)
+    {
+        bytes.resize(length);
+        for (UTsize i = 0; i < length; i++)
+        {
+            bytes[i] = (unsigned char)(i * 31 + length);
+        }
+
+        utString encoded = utBase64::encode64(bytes).getBase64();
+        assert_int_equal(utBase64::encodedLength(length), encoded.size());
+
+        utBase64                      decodedBase64 = utBase64::decode64(encoded);
+        const utArray<unsigned char>& back          = decodedBase64.getData();
+        assert_int_equal(length, back.size());
+        assert_true(!length || !memcmp(bytes.ptr(), back.ptr(), length));
+
+        // Wrapped MIME style, so blocks are interrupted.
+        utString wrapped;
+        for (UTsize i = 0; i < encoded.size(); i += 76)
+        {
+            wrapped += encoded.substr(i, 76);
+            wrapped += "\r\n";
+        }
+
+        utBase64                      unwrappedBase64 = utBase64::decode64(wrapped);
+        const utArray<unsigned char>& unwrapped       = unwrappedBase64.getData();
+        assert_int_equal(length, unwrapped.size());
+        assert_true(!length || !memcmp(bytes.ptr(), unwrapped.ptr(), length));
+    }
+}
+
+#define HASH_BENCH_BYTES    (4 * 1024 * 1024)
+
+static double megabytesPerSecond(loom_precision_timer_t timer, int rounds)
+{
+    double seconds = loom_readTimerNano(timer) / 1e9;
+
+    loom_destroyTimer(timer);
+    return seconds > 0 ? (double)HASH_BENCH_BYTES * rounds / (1024 * 1024) / seconds : 0;
+}
+
+SEATEST_TEST(utHash_benchmark)
+{
+    const int rounds = 4;
+
+    utArray<unsigned char> data;
+    data.resize(HASH_BENCH_BYTES);
+    for (UTsize i = 0; i < data.size(); i++)
+    {
+        data[i] = (unsigned char)(i * 2654435761u >> 24);
+    }
+
+    utString out;
+    loom_precision_timer_t timer;
+
+    double sha[2];
+    for (int hardware = 0; hardware < 2; hardware++)
+    {
+        utSHA2::setHardwareSHA256Enabled(hardware != 0);
+        timer = loom_startTimer();
+        for (int i = 0; i < rounds; i++)
+        {
+            utSHA2::generateSHA256((const char *)data.ptr(), (int)data.size(), out);
+        }
+        sha[hardware] = megabytesPerSecond(timer, rounds);
+    }
+    utSHA2::setHardwareSHA256Enabled(true);
+
+    timer = loom_startTimer();
+    for (int i = 0; i < rounds; i++)
+    {
+        MDFive md5;
+        md5.update((const char *)data.ptr(), (MDFive::size_type)data.size());
+        md5.finalize();
+    }
+    double md5Rate = megabytesPerSecond(timer, rounds);
+
+    unsigned long long hash = 0;
+    timer = loom_startTimer();
+    for (int i = 0; i < rounds; i++)
+    {
+        hash ^= utFastHash::hash64(data.ptr(), data.size(), i);
+    }
+    double fastRate = megabytesPerSecond(timer, rounds);
+
+    utArray<char> encoded;
+    encoded.resize(utBase64::encodedLength(data.size()));
+    timer = loom_startTimer();
+    for (int i = 0; i < rounds; i++)
+    {
+        utBase64::encode(data.ptr(), data.size(), encoded.ptr());
+    }
+    double encodeRate = megabytesPerSecond(timer, rounds);
+
+    utArray<unsigned char> decoded;
+    decoded.resize(utBase64::decodedMaxLength(encoded.size()));
+    UTsize decodedSize = 0;
+    timer = loom_startTimer();
+    for (int i = 0; i < rounds; i++)
+    {
+        decodedSize = utBase64::decode(encoded.ptr(), encoded.size(), decoded.ptr());
+    }
+    double decodeRate = megabytesPerSecond(timer, rounds);
+
+    assert_int_equal(data.size(), decodedSize);
+
+    lmLogInfo(gHashTestLogGroup, "MB/s: SHA-256 %.0f (%s %.0f), MD5 %.0f, XXH64 %.0f, base64 encode %.0f, decode %.0f (%llx)",
+              sha[0], utSHA2::hasHardwareSHA256() ? "hardware" : "no hardware, again", sha[1],
+              md5Rate, fastRate, encodeRate, decodeRate, hash);
+}
@@ -0,0 +1,401 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "loom/common/utils/utMessagePack.h"
+
+void utMessagePackWriter::writeBigEndian(unsigned char type, unsigned long long value, int size)
+{
+    unsigned char buffer[9];
+
+    buffer[0] = type;
+    for (int i = 0; i < size; i++)
+    {
+        buffer[size - i] = (unsigned char)(value >> (i * 8));
+    }
+
+    writeRaw(buffer, size + 1);
+}
+
+
+void utMessagePackWriter::writeNil()
+{
+    unsigned char type = 0xC0;
+    writeRaw(&type, 1);
+}
+
+
+void utMessagePackWriter::writeBoolean(bool value)
+{
+    unsigned char type = value ? 0xC3 : 0xC2;
+    writeRaw(&type, 1);
+}
+
+
+void utMessagePackWriter::writeNumber(double value)
+{
+    // Integral and within int64.
+    if ((value == floor(value)) && (value >= -9223372036854775808.0) && (value < 9223372036854775808.0))
+    {
+        writeInteger((long long)value);
+    }
+    else
+    {
+        writeDouble(value);
+    }
+}
+
+
+void utMessagePackWriter::writeInteger(long long value)
+{
+    if (value >= 0)
+    {
+        if (value < 0x80)
+        {
+            // positive fixint
+            unsigned char type = (unsigned char)value;
+            writeRaw(&type, 1);
+        }
+        else if (value <= 0xFF)
+        {
+            writeBigEndian(0xCC, value, 1);
+        }
+        else if (value <= 0xFFFF)
+        {
+            writeBigEndian(0xCD, value, 2);
+        }
+        else if (value <= 0xFFFFFFFFLL)
+        {
+            writeBigEndian(0xCE, value, 4);
+        }
+        else
+        {
+            writeBigEndian(0xCF, value, 8);
+        }
+    }
+    else if (value >= -32)
+    {
+        // negative fixint
+        unsigned char type = (unsigned char)(signed char)value;
+        writeRaw(&type, 1);
+    }
+    else if (value >= -128)
+    {
+        writeBigEndian(0xD0, (unsigned long long)value, 1);
+    }
+    else if (value >= -32768)
+    {
+        writeBigEndian(0xD1, (unsigned long long)value, 2);
+    }
+    else if (value >= -2147483647LL - 1)
+    {
+        writeBigEndian(0xD2, (unsigned long long)value, 4);
+    }
+    else
+    {
+        writeBigEndian(0xD3, (unsigned long long)value, 8);
+    }
+}
+
+
+void utMessagePackWriter::writeDouble(double value)
+{
+    unsigned long long bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    writeBigEndian(0xCB, bits, 8);
+}
+
+
+void utMessagePackWriter::writeHeader(unsigned char base, UTsize length)
+{
+    // base is the 8 bit form, the 16 and 32 bit ones follow it.
+    if (length <= 0xFF)
+    {
+        writeBigEndian(base, length, 1);
+    }
+    else if (length <= 0xFFFF)
+    {
+        writeBigEndian(base + 1, length, 2);
+    }
+    else
+    {
+        writeBigEndian(base + 2, length, 4);
+    }
+}
+
+
+void utMessagePackWriter::writeString(const char *value, UTsize length)
+{
+    // fixstr holds up to 31 bytes.
+    if (length < 32)
+    {
+        unsigned char type = (unsigned char)(0xA0 | length);
+        writeRaw(&type, 1);
+    }
+    else
+    {
+        writeHeader(0xD9, length);
+    }
+
+    writeRaw(value, length);
+}
+
+
+void utMessagePackWriter::writeBinary(const void *value, UTsize length)
+{
+    writeHeader(0xC4, length);
+    writeRaw(value, length);
+}
+
+
+void utMessagePackWriter::writeArrayHeader(UTsize count)
+{
+    // Arrays and maps have no 8 bit form.
+    if (count < 16)
+    {
+        unsigned char type = (unsigned char)(0x90 | count);
+        writeRaw(&type, 1);
+    }
+    else if (count <= 0xFFFF)
+    {
+        writeBigEndian(0xDC, count, 2);
+    }
+    else
+    {
+        writeBigEndian(0xDD, count, 4);
+    }
+}
+
+
+void utMessagePackWriter::writeMapHeader(UTsize count)
+{
+    if (count < 16)
+    {
+        unsigned char type = (unsigned char)(0x80 | count);
+        writeRaw(&type, 1);
+    }
+    else if (count <= 0xFFFF)
+    {
+        writeBigEndian(0xDE, count, 2);
+    }
+    else
+    {
+        writeBigEndian(0xDF, count, 4);
+    }
+}
+
+
+bool utMessagePackReader::readBigEndian(int size, unsigned long long& value)
+{
+    if (m_length - m_pos < (UTsize)size)
+    {
+        return false;
+    }
+
+    value = 0;
+    for (int i = 0; i < size; i++)
+    {
+        value = (value << 8) | m_data[m_pos++];
+    }
+
+    return true;
+}
+
+
+utMessagePackType utMessagePackReader::readData(utMessagePackType type, UTsize length)
+{
+    if (m_length - m_pos < length)
+    {
+        return MP_ERROR;
+    }
+
+    m_string = (const char *)m_data + m_pos;
+    m_count  = length;
+    m_pos   += length;
+
+    return type;
+}
+
+
+utMessagePackType utMessagePackReader::next()
+{
+    if (m_pos >= m_length)
+    {
+        return MP_END;
+    }
+
+    unsigned char      type = m_data[m_pos++];
+    unsigned long long value;
+
+    // Fixed size forms first.
+    if (type < 0x80)
+    {
+        m_integer = type;
+        m_number  = (double)m_integer;
+        return MP_INTEGER;
+    }
+
+    if (type >= 0xE0)
+    {
+        m_integer = (signed char)type;
+        m_number  = (double)m_integer;
+        return MP_INTEGER;
+    }
+
+    if (type < 0x90)
+    {
+        m_count = type & 0x0F;
+        return MP_MAP;
+    }
+
+    if (type < 0xA0)
+    {
+        m_count = type & 0x0F;
+        return MP_ARRAY;
+    }
+
+    if (type < 0xC0)
+    {
+        return readData(MP_STRING, type & 0x1F);
+    }
+
+    switch (type)
+    {
+    case 0xC0:
+        return MP_NIL;
+
+    case 0xC2:
+    case 0xC3:
+        m_integer = type & 1;
+        return MP_BOOLEAN;
+
+    // bin 8, 16, 32 and str 8, 16, 32
+    case 0xC4: case 0xC5: case 0xC6:
+        if (!readBigEndian(1 << (type - 0xC4), value)) return MP_ERROR;
+        return readData(MP_BINARY, (UTsize)value);
+
+    case 0xD9: case 0xDA: case 0xDB:
+        if (!readBigEndian(1 << (type - 0xD9), value)) return MP_ERROR;
+        return readData(MP_STRING, (UTsize)value);
+
+    // ext 8, 16, 32, the length precedes the type
+    case 0xC7: case 0xC8: case 0xC9:
+        if (!readBigEndian(1 << (type - 0xC7), value) || (m_pos >= m_length)) return MP_ERROR;
+        m_extensionType = (signed char)m_data[m_pos++];
+        return readData(MP_EXTENSION, (UTsize)value);
+
+    // fixext 1, 2, 4, 8, 16
+    case 0xD4: case 0xD5: case 0xD6: case 0xD7: case 0xD8:
+        if (m_pos >= m_length) return MP_ERROR;
+        m_extensionType = (signed char)m_data[m_pos++];
+        return readData(MP_EXTENSION, 1 << (type - 0xD4));
+
+    case 0xCA:
+    {
+        if (!readBigEndian(4, value)) return MP_ERROR;
+        unsigned int bits = (unsigned int)value;
+        float        f;
+        memcpy(&f, &bits, sizeof(f));
+        m_number = f;
+        return MP_FLOAT;
+    }
+
+    case 0xCB:
+        if (!readBigEndian(8, value)) return MP_ERROR;
+        memcpy(&m_number, &value, sizeof(m_number));
+        return MP_FLOAT;
+
+    // uint 8, 16, 32, 64
+    case 0xCC: case 0xCD: case 0xCE: case 0xCF:
+        if (!readBigEndian(1 << (type - 0xCC), value)) return MP_ERROR;
+        m_integer = (long long)value;
+        m_number  = (double)value;
+        return MP_INTEGER;
+
+    // int 8, 16, 32, 64, sign extended from their size
+    case 0xD0: case 0xD1: case 0xD2: case 0xD3:
+    {
+        int size = 1 << (type - 0xD0);
+        if (!readBigEndian(size, value)) return MP_ERROR;
+        int shift = 64 - size * 8;
+        m_integer = shift ? ((long long)(value << shift)) >> shift : (long long)value;
+        m_number  = (double)m_integer;
+        return MP_INTEGER;
+    }
+
+    case 0xDC: case 0xDD:
+        if (!readBigEndian(type == 0xDC ? 2 : 4, value)) return MP_ERROR;
+        m_count = (UTsize)value;
+        return MP_ARRAY;
+
+    case 0xDE: case 0xDF:
+        if (!readBigEndian(type == 0xDE ? 2 : 4, value)) return MP_ERROR;
+        m_count = (UTsize)value;
+        return MP_MAP;
+
+    default:
+        // 0xC1 is never used
+        return MP_ERROR;
+    }
+}
+
+
+bool utMessagePackReader::skip(utMessagePackType type)
+{
+    if ((type != MP_ARRAY) && (type != MP_MAP))
+    {
+        return type != MP_ERROR;
+    }
+
+    // Values left to skip, containers adding theirs as they're found. A
+    // count beyond the remaining data can't be valid, which also keeps the
+    // total from overflowing.
+    unsigned long long remaining = type == MP_MAP ? (unsigned long long)m_count * 2 : m_count;
+
+    while (remaining)
+    {
+        if (remaining > m_length - m_pos)
+        {
+            return false;
+        }
+
+        utMessagePackType element = next();
+        remaining--;
+
+        if ((element == MP_ERROR) || (element == MP_END))
+        {
+            return false;
+        }
+
+        if (element == MP_ARRAY)
+        {
+            remaining += m_count;
+        }
+        else if (element == MP_MAP)
+        {
+            remaining += (unsigned long long)m_count * 2;
+        }
+    }
+
+    return true;
+}
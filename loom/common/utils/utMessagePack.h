@@ -0,0 +1,137 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _UTILS_UTMESSAGEPACK_H_
+#define _UTILS_UTMESSAGEPACK_H_
+
+#include "loom/common/utils/utTypes.h"
+#include "loom/common/utils/utByteArray.h"
+
+/*
+ * MessagePack (http://msgpack.org) encoding, a compact binary counterpart
+ * to JSON. Values written by utMessagePackWriter can be read by any
+ * MessagePack implementation, and utMessagePackReader reads everything
+ * they write, extension types included, though those are left to the
+ * caller to interpret.
+ *
+ * Containers are written as a header with the element count followed by
+ * the elements, key and value alternating for maps:
+ *
+ *   utMessagePackWriter writer(bytes);
+ *   writer.writeMapHeader(1);
+ *   writer.writeString("x", 1);
+ *   writer.writeNumber(4);
+ *
+ * MessagePack is big endian, regardless of the byte array's byte order.
+ */
+
+class utMessagePackWriter
+{
+public:
+    // Appends at the array's position.
+    utMessagePackWriter(utByteArray& bytes) : m_bytes(bytes) {}
+
+    void writeNil();
+    void writeBoolean(bool value);
+
+    // The smallest integer encoding for integral values, otherwise a float64.
+    void writeNumber(double value);
+    void writeInteger(long long value);
+    void writeDouble(double value);
+
+    void writeString(const char *value, UTsize length);
+    void writeBinary(const void *value, UTsize length);
+
+    void writeArrayHeader(UTsize count);
+    void writeMapHeader(UTsize count);
+
+protected:
+    void writeHeader(unsigned char base, UTsize length);
+    void writeRaw(const void *data, UTsize length)
+    {
+        m_bytes.writeUTFInternal((const char *)data, length);
+    }
+
+    void writeBigEndian(unsigned char type, unsigned long long value, int size);
+
+    utByteArray& m_bytes;
+};
+
+enum utMessagePackType
+{
+    MP_ERROR,       // truncated or invalid data
+    MP_END,         // no data left
+    MP_NIL,
+    MP_BOOLEAN,     // getBoolean
+    MP_INTEGER,     // getInteger, or getNumber
+    MP_FLOAT,       // getNumber
+    MP_STRING,      // getData
+    MP_BINARY,      // getData
+    MP_EXTENSION,   // getData, getExtensionType
+    MP_ARRAY,       // getCount elements follow
+    MP_MAP          // getCount key value pairs follow
+};
+
+class utMessagePackReader
+{
+public:
+    // Reads length bytes from data, which has to outlive the reader.
+    utMessagePackReader(const void *data, UTsize length) :
+        m_data((const unsigned char *)data), m_length(length), m_pos(0),
+        m_integer(0), m_number(0), m_string(NULL), m_count(0), m_extensionType(0)
+    {
+    }
+
+    // Reads the next value, for containers only their header.
+    utMessagePackType next();
+
+    // Skips the elements of the container whose header was just read,
+    // nothing for other values. Returns false on invalid data.
+    bool skip(utMessagePackType type);
+
+    bool getBoolean() const { return m_integer != 0; }
+    long long getInteger() const { return m_integer; }
+    double getNumber() const { return m_number; }
+
+    // Strings, binary and extension data point into the input.
+    const char *getData(UTsize& length) const { length = m_count; return m_string; }
+    signed char getExtensionType() const { return m_extensionType; }
+
+    UTsize getCount() const { return m_count; }
+
+    // Bytes read so far.
+    UTsize getOffset() const { return m_pos; }
+
+protected:
+    bool readBigEndian(int size, unsigned long long& value);
+    utMessagePackType readData(utMessagePackType type, UTsize length);
+
+    const unsigned char *m_data;
+    UTsize              m_length;
+    UTsize              m_pos;
+
+    long long           m_integer;
+    double              m_number;
+    const char          *m_string;
+    UTsize              m_count;
+    signed char         m_extensionType;
+};
+
+#endif
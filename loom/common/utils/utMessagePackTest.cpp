@@ -0,0 +1,174 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <string.h>
+
+#include "loom/common/utils/utMessagePack.h"
+#include "seatest.h"
+
+SEATEST_FIXTURE(utMessagePack)
+{
+    SEATEST_FIXTURE_ENTRY(utMessagePack_encoding);
+    SEATEST_FIXTURE_ENTRY(utMessagePack_roundTrip);
+    SEATEST_FIXTURE_ENTRY(utMessagePack_skip);
+    SEATEST_FIXTURE_ENTRY(utMessagePack_truncated);
+}
+
+static bool bytesEqual(utByteArray& bytes, const unsigned char *expected, UTsize length)
+{
+    return (bytes.getSize() == length) && !memcmp(bytes.getDataPtr(), expected, length);
+}
+
+SEATEST_TEST(utMessagePack_encoding)
+{
+    // The smallest form is picked, in MessagePack's byte order.
+    utByteArray         bytes;
+    utMessagePackWriter writer(bytes);
+
+    writer.writeNumber(1);
+    writer.writeNumber(-1);
+    writer.writeNumber(200);
+    writer.writeNumber(-200);
+    writer.writeNumber(70000);
+    writer.writeNumber(0.5);
+    writer.writeMapHeader(1);
+    writer.writeString("a", 1);
+    writer.writeArrayHeader(2);
+    writer.writeNil();
+    writer.writeBoolean(true);
+
+    static const unsigned char expected[] =
+    {
+        0x01,
+        0xFF,
+        0xCC, 0xC8,
+        0xD1, 0xFF, 0x38,
+        0xCE, 0x00, 0x01, 0x11, 0x70,
+        0xCB, 0x3F, 0xE0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x81,
+        0xA1, 'a',
+        0x92,
+        0xC0,
+        0xC3
+    };
+
+    assert_true(bytesEqual(bytes, expected, sizeof(expected)));
+}
+
+SEATEST_TEST(utMessagePack_roundTrip)
+{
+    utByteArray         bytes;
+    utMessagePackWriter writer(bytes);
+
+    static const long long integers[] =
+    {
+        0, 127, 128, 255, 256, 65535, 65536, 4294967295LL, 4294967296LL,
+        -32, -33, -128, -129, -32768, -32769, -2147483647LL - 1, -2147483649LL
+    };
+
+    const int integerCount = sizeof(integers) / sizeof(integers[0]);
+
+    for (int i = 0; i < integerCount; i++)
+    {
+        writer.writeInteger(integers[i]);
+    }
+
+    char longString[300];
+    memset(longString, 'x', sizeof(longString));
+
+    writer.writeDouble(-1.25);
+    writer.writeString(longString, 31);
+    writer.writeString(longString, 32);
+    writer.writeString(longString, sizeof(longString));
+    writer.writeBinary(longString, 3);
+    writer.writeArrayHeader(70000);
+
+    utMessagePackReader reader(bytes.getDataPtr(), bytes.getSize());
+
+    for (int i = 0; i < integerCount; i++)
+    {
+        assert_int_equal(MP_INTEGER, reader.next());
+        assert_true(reader.getInteger() == integers[i]);
+        assert_true(reader.getNumber() == (double)integers[i]);
+    }
+
+    UTsize length;
+
+    assert_int_equal(MP_FLOAT, reader.next());
+    assert_double_equal(-1.25, reader.getNumber(), 0.0);
+    assert_int_equal(MP_STRING, reader.next());
+    assert_int_equal(31, (int)reader.getCount());
+    assert_int_equal(MP_STRING, reader.next());
+    assert_int_equal(32, (int)reader.getCount());
+    assert_int_equal(MP_STRING, reader.next());
+    assert_true(!memcmp(reader.getData(length), longString, sizeof(longString)));
+    assert_int_equal(sizeof(longString), (int)length);
+    assert_int_equal(MP_BINARY, reader.next());
+    assert_int_equal(3, (int)reader.getCount());
+    assert_int_equal(MP_ARRAY, reader.next());
+    assert_int_equal(70000, (int)reader.getCount());
+    assert_int_equal(MP_END, reader.next());
+    assert_int_equal(bytes.getSize(), (int)reader.getOffset());
+}
+
+SEATEST_TEST(utMessagePack_skip)
+{
+    utByteArray         bytes;
+    utMessagePackWriter writer(bytes);
+
+    // {"a": [1, {"b": "c"}], "d": 2}, then 3
+    writer.writeMapHeader(2);
+    writer.writeString("a", 1);
+    writer.writeArrayHeader(2);
+    writer.writeInteger(1);
+    writer.writeMapHeader(1);
+    writer.writeString("b", 1);
+    writer.writeString("c", 1);
+    writer.writeString("d", 1);
+    writer.writeInteger(2);
+    writer.writeInteger(3);
+
+    utMessagePackReader reader(bytes.getDataPtr(), bytes.getSize());
+
+    assert_true(reader.skip(reader.next()));
+    assert_int_equal(MP_INTEGER, reader.next());
+    assert_int_equal(3, (int)reader.getInteger());
+    assert_int_equal(MP_END, reader.next());
+}
+
+SEATEST_TEST(utMessagePack_truncated)
+{
+    static const unsigned char shortString[] = { 0xA5, 'a', 'b' };
+    static const unsigned char shortInteger[] = { 0xCD, 0x01 };
+    static const unsigned char hugeArray[] = { 0xDD, 0xFF, 0xFF, 0xFF, 0xFF, 0x01 };
+    static const unsigned char unused[] = { 0xC1 };
+
+    utMessagePackReader stringReader(shortString, sizeof(shortString));
+    assert_int_equal(MP_ERROR, stringReader.next());
+
+    utMessagePackReader integerReader(shortInteger, sizeof(shortInteger));
+    assert_int_equal(MP_ERROR, integerReader.next());
+
+    utMessagePackReader arrayReader(hugeArray, sizeof(hugeArray));
+    assert_false(arrayReader.skip(arrayReader.next()));
+
+    utMessagePackReader unusedReader(unused, sizeof(unused));
+    assert_int_equal(MP_ERROR, unusedReader.next());
+}
@@ -35,6 +35,16 @@
 #include <string.h> /* memcpy()/memset() or bcopy()/bzero() */
 #include <assert.h> /* assert() */
 
+#include "loom/common/utils/utCPU.h"
+
+#if UT_CPU_X86 && UT_CPU_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#if UT_CPU_ARM_SHA2
+#include <arm_neon.h>
+#endif
+
 /*
  * Import u_intXX_t size_t type definitions from system headers.  You
  * may need to change this, or define these things yourself in this
@@ -183,6 +193,9 @@ char *SHA512_Data(const u_int8_t *, size_t, char[SHA512_DIGEST_STRING_LENGTH]);
 
 static char shaBuf[16384];
 
+static bool sha256HardwareEnabled = true;
+static bool SHA256_HasHardware();
+
 void utSHA2::generateSHA256(const char *input, int length, utString& out)
 {
     SHA256_CTX ctx256;
@@ -197,6 +210,18 @@ void utSHA2::generateSHA256(const char *input, int length, utString& out)
 }
 
 
+bool utSHA2::hasHardwareSHA256()
+{
+    return SHA256_HasHardware();
+}
+
+
+void utSHA2::setHardwareSHA256Enabled(bool enabled)
+{
+    sha256HardwareEnabled = enabled;
+}
+
+
 void utSHA2::generateSHA384(const char *input, int length, utString& out)
 {
     SHA384_CTX ctx384;
@@ -695,6 +720,141 @@ void SHA256_Transform(SHA256_CTX *context, const sha2_word32 *data)
 }
 #endif /* SHA2_UNROLL_TRANSFORM */
 
+/*** SHA-256 hardware paths *******************************************/
+
+/*
+ * The x86 SHA extensions and ARMv8 SHA-2 instructions do the rounds and the
+ * message schedule of a whole block in a handful of instructions. Both run
+ * over several blocks at once, keeping the state in registers in between.
+ */
+
+#if UT_CPU_X86 && UT_CPU_X86_SIMD
+
+UT_TARGET("sha,sse4.1,ssse3")
+static void SHA256_TransformSHANI(sha2_word32 *state, const sha2_byte *data, size_t blocks)
+{
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    /* The instructions take the state as ABEF and CDGH */
+    __m128i tmp    = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    while (blocks--)
+    {
+        __m128i abefSave = state0;
+        __m128i cdghSave = state1;
+        __m128i w[4];
+
+        for (int i = 0; i < 16; i++)
+        {
+            /* Four rounds per step, each on its four message words */
+            if (i < 4)
+            {
+                w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + i * 16)), byteSwap);
+            }
+            else
+            {
+                __m128i next = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+                next     = _mm_add_epi32(next, _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+                w[i & 3] = _mm_sha256msg2_epu32(next, w[(i + 3) & 3]);
+            }
+
+            __m128i msg = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i *)&K256[i * 4]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+        }
+
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+        data  += SHA256_BLOCK_LENGTH;
+    }
+
+    /* Back to ABCD and EFGH */
+    tmp    = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+
+    _mm_storeu_si128((__m128i *)&state[0], state0);
+    _mm_storeu_si128((__m128i *)&state[4], state1);
+}
+#endif
+
+#if UT_CPU_ARM_SHA2
+
+static void SHA256_TransformARM(sha2_word32 *state, const sha2_byte *data, size_t blocks)
+{
+    uint32x4_t state0 = vld1q_u32(&state[0]);
+    uint32x4_t state1 = vld1q_u32(&state[4]);
+
+    while (blocks--)
+    {
+        uint32x4_t abcdSave = state0;
+        uint32x4_t efghSave = state1;
+        uint32x4_t w[4];
+
+        for (int i = 0; i < 16; i++)
+        {
+            if (i < 4)
+            {
+                w[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + i * 16)));
+            }
+            else
+            {
+                w[i & 3] = vsha256su1q_u32(vsha256su0q_u32(w[i & 3], w[(i + 1) & 3]), w[(i + 2) & 3], w[(i + 3) & 3]);
+            }
+
+            uint32x4_t msg  = vaddq_u32(w[i & 3], vld1q_u32(&K256[i * 4]));
+            uint32x4_t abcd = state0;
+            state0 = vsha256hq_u32(state0, state1, msg);
+            state1 = vsha256h2q_u32(state1, abcd, msg);
+        }
+
+        state0 = vaddq_u32(state0, abcdSave);
+        state1 = vaddq_u32(state1, efghSave);
+        data  += SHA256_BLOCK_LENGTH;
+    }
+
+    vst1q_u32(&state[0], state0);
+    vst1q_u32(&state[4], state1);
+}
+#endif
+
+static bool SHA256_HasHardware()
+{
+#if UT_CPU_ARM_SHA2
+    return sha256HardwareEnabled;
+#elif UT_CPU_X86 && UT_CPU_X86_SIMD
+    return sha256HardwareEnabled && utCPUHas(UT_CPU_SHA | UT_CPU_SSE41 | UT_CPU_SSSE3);
+#else
+    return false;
+#endif
+}
+
+static void SHA256_TransformBlocks(SHA256_CTX *context, const sha2_byte *data, size_t blocks)
+{
+#if UT_CPU_ARM_SHA2
+    if (SHA256_HasHardware())
+    {
+        SHA256_TransformARM(context->state, data, blocks);
+        return;
+    }
+#elif UT_CPU_X86 && UT_CPU_X86_SIMD
+    if (SHA256_HasHardware())
+    {
+        SHA256_TransformSHANI(context->state, data, blocks);
+        return;
+    }
+#endif
+
+    for ( ; blocks; blocks--, data += SHA256_BLOCK_LENGTH)
+    {
+        SHA256_Transform(context, (const sha2_word32 *)data);
+    }
+}
+
 void SHA256_Update(SHA256_CTX *context, const sha2_byte *data, size_t len)
 {
     unsigned int freespace, usedspace;
@@ -721,7 +881,7 @@ void SHA256_Update(SHA256_CTX *context, const sha2_byte *data, size_t len)
             context->bitcount += freespace << 3;
             len  -= freespace;
             data += freespace;
-            SHA256_Transform(context, (sha2_word32 *)context->buffer);
+            SHA256_TransformBlocks(context, context->buffer, 1);
         }
         else
         {
@@ -733,13 +893,14 @@ void SHA256_Update(SHA256_CTX *context, const sha2_byte *data, size_t len)
             return;
         }
     }
-    while (len >= SHA256_BLOCK_LENGTH)
+    if (len >= SHA256_BLOCK_LENGTH)
     {
         /* Process as many complete blocks as we can */
-        SHA256_Transform(context, (sha2_word32 *)data);
-        context->bitcount += SHA256_BLOCK_LENGTH << 3;
-        len  -= SHA256_BLOCK_LENGTH;
-        data += SHA256_BLOCK_LENGTH;
+        size_t blocks = len / SHA256_BLOCK_LENGTH;
+        SHA256_TransformBlocks(context, data, blocks);
+        context->bitcount += (sha2_word64)blocks * SHA256_BLOCK_LENGTH << 3;
+        len  -= blocks * SHA256_BLOCK_LENGTH;
+        data += blocks * SHA256_BLOCK_LENGTH;
     }
     if (len > 0)
     {
@@ -787,7 +948,7 @@ void SHA256_Final(sha2_byte digest[], SHA256_CTX *context)
                                  SHA256_BLOCK_LENGTH - usedspace);
                 }
                 /* Do second-to-last transform: */
-                SHA256_Transform(context, (sha2_word32 *)context->buffer);
+                SHA256_TransformBlocks(context, context->buffer, 1);
 
                 /* And set-up for the last transform: */
                 MEMSET_BZERO(context->buffer, SHA256_SHORT_BLOCK_LENGTH);
@@ -806,7 +967,7 @@ void SHA256_Final(sha2_byte digest[], SHA256_CTX *context)
             context->bitcount;
 
         /* Final transform: */
-        SHA256_Transform(context, (sha2_word32 *)context->buffer);
+        SHA256_TransformBlocks(context, context->buffer, 1);
 
 #if BYTE_ORDER == LITTLE_ENDIAN
         {
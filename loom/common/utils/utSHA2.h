@@ -29,5 +29,13 @@ public:
     static void generateSHA256(const char *input, int length, utString& out);
     static void generateSHA384(const char *input, int length, utString& out);
     static void generateSHA512(const char *input, int length, utString& out);
+
+    // Whether SHA-256 runs on the CPU's SHA instructions, the x86 SHA
+    // extensions or ARMv8's.
+    static bool hasHardwareSHA256();
+
+    // Falls back to the portable code when disabled, for tests and
+    // benchmarks comparing the two.
+    static void setHardwareSHA256Enabled(bool enabled);
 };
 #endif
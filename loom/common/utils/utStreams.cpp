@@ -23,6 +23,7 @@
  * -------------------------------------------------------------------------------
  */
 #include "utStreams.h"
+#include "loom/common/platform/platformIO.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -184,6 +185,9 @@ void utFileStream::open(const char *p, utStream::StreamMode mode)
 
     m_file   = p;
     m_handle = utFileWrapper::open(m_file.c_str(), mode);
+    m_pos    = 0;
+    m_size   = 0;
+    m_mode   = mode;
     if (m_handle)
     {
         if (!(mode & SM_WRITE))
@@ -203,6 +207,8 @@ void utFileStream::close(void)
     }
 
     m_file.clear();
+    m_pos  = 0;
+    m_size = 0;
 }
 
 
@@ -293,15 +299,19 @@ void utFileStream::seek(const UTsize pos, int dir) const
         return;
     }
 
-    int ret = utFileWrapper::seek(m_handle, pos, dir);
+    // The wrapper returns 0 on success, not the new position.
+    if (utFileWrapper::seek(m_handle, pos, dir) != 0)
+    {
+        return;
+    }
 
     if (dir == SEEK_SET)
     {
-        m_pos = utClamp<UTsize>(ret, 0, m_size);
+        m_pos = utClamp<UTsize>(pos, 0, m_size);
     }
     else if (dir == SEEK_CUR)
     {
-        m_pos = utClamp<UTsize>(m_pos + ret, 0, m_size);
+        m_pos = utClamp<UTsize>(m_pos + pos, 0, m_size);
     }
 }
 
@@ -338,6 +348,228 @@ bool utFileStream::tryReadToArray(const utString& path, utArray<unsigned char>&
 }
 
 
+utBufferedStream::utBufferedStream(utStream& stream, UTsize bufferSize) :
+    m_stream(stream), m_buffer(0), m_capacity(bufferSize > 0 ? bufferSize : 1),
+    m_readPos(0), m_readSize(0), m_writeSize(0)
+{
+    m_buffer = new char[m_capacity];
+}
+
+
+utBufferedStream::~utBufferedStream()
+{
+    flushWrites();
+    dropReadAhead();
+    delete []m_buffer;
+}
+
+
+void utBufferedStream::flush(void)
+{
+    flushWrites();
+    m_stream.flush();
+}
+
+
+void utBufferedStream::flushWrites(void) const
+{
+    if (m_writeSize)
+    {
+        m_stream.write(m_buffer, m_writeSize);
+        m_writeSize = 0;
+    }
+}
+
+
+void utBufferedStream::dropReadAhead(void) const
+{
+    if (m_readPos < m_readSize)
+    {
+        m_stream.seek(m_stream.position() - (m_readSize - m_readPos), SEEK_SET);
+    }
+
+    m_readPos = m_readSize = 0;
+}
+
+
+UTsize utBufferedStream::read(void *dest, UTsize nr) const
+{
+    if (!dest || !m_stream.isOpen())
+    {
+        return -1;
+    }
+
+    flushWrites();
+
+    char   *cp  = (char *)dest;
+    UTsize done = 0;
+
+    while (done < nr)
+    {
+        if (m_readPos < m_readSize)
+        {
+            UTsize n = utMin(nr - done, m_readSize - m_readPos);
+            memcpy(cp + done, m_buffer + m_readPos, n);
+            m_readPos += n;
+            done      += n;
+            continue;
+        }
+
+        UTsize br;
+
+        if (nr - done >= m_capacity)
+        {
+            br = m_stream.read(cp + done, nr - done);
+            if ((br == 0) || (br == (UTsize)-1))
+            {
+                break;
+            }
+            done += br;
+            continue;
+        }
+
+        m_readPos = m_readSize = 0;
+        br        = m_stream.read(m_buffer, m_capacity);
+        if ((br == 0) || (br == (UTsize)-1))
+        {
+            break;
+        }
+        m_readSize = br;
+    }
+
+    return done;
+}
+
+
+UTsize utBufferedStream::write(const void *src, UTsize nr)
+{
+    if (!src || !m_stream.isOpen())
+    {
+        return -1;
+    }
+
+    dropReadAhead();
+
+    if (m_writeSize + nr > m_capacity)
+    {
+        flushWrites();
+    }
+
+    if (nr >= m_capacity)
+    {
+        return m_stream.write(src, nr);
+    }
+
+    memcpy(m_buffer + m_writeSize, src, nr);
+    m_writeSize += nr;
+    return nr;
+}
+
+
+void utBufferedStream::seek(const UTsize pos, int dir) const
+{
+    UTsize target = dir == SEEK_CUR ? position() + pos : pos;
+
+    flushWrites();
+    dropReadAhead();
+
+    m_stream.seek(target, dir == SEEK_CUR ? SEEK_SET : dir);
+}
+
+
+utMappedFileStream::utMappedFileStream() :
+    m_data(0), m_mapping(0), m_pos(0), m_size(0)
+{
+}
+
+
+utMappedFileStream::~utMappedFileStream()
+{
+    close();
+}
+
+
+void utMappedFileStream::open(const char *path, utStream::StreamMode mode)
+{
+    close();
+
+    void *bits;
+    long size;
+
+    if ((mode != utStream::SM_READ) || !platform_mapFile(path, &bits, &size))
+    {
+        return;
+    }
+
+    // Detached, so a long lived stream doesn't hold one of the few
+    // mapping slots.
+    m_mapping = platform_detachMapping(bits);
+    if (!m_mapping)
+    {
+        platform_unmapFile(bits);
+        return;
+    }
+
+    m_data = (const char *)bits;
+    m_size = (UTsize)size;
+}
+
+
+void utMappedFileStream::close(void)
+{
+    if (m_mapping)
+    {
+        platform_releaseMapping(m_mapping);
+    }
+
+    m_data    = 0;
+    m_mapping = 0;
+    m_pos     = 0;
+    m_size    = 0;
+}
+
+
+UTsize utMappedFileStream::read(void *dest, UTsize nr) const
+{
+    if (!dest || !m_mapping)
+    {
+        return -1;
+    }
+
+    if (m_pos >= m_size)
+    {
+        return 0;
+    }
+
+    // clamp
+    if ((m_size - m_pos) < nr)
+    {
+        nr = m_size - m_pos;
+    }
+
+    memcpy(dest, m_data + m_pos, nr);
+    m_pos += nr;
+    return nr;
+}
+
+
+void utMappedFileStream::seek(const UTsize pos, int dir) const
+{
+    if (dir == SEEK_SET)
+    {
+        m_pos = utClamp<UTsize>(pos, 0, m_size);
+    }
+    else if (dir == SEEK_CUR)
+    {
+        m_pos = utClamp<UTsize>(m_pos + pos, 0, m_size);
+    }
+    else if (dir == SEEK_END)
+    {
+        m_pos = m_size;
+    }
+}
+
+
 utMemoryStream::utMemoryStream(int mode)
     :   m_buffer(0), m_pos(0), m_size(0), m_capacity(0), m_mode(mode)
 {
@@ -659,7 +891,7 @@ int utFileWrapper::seek(utFileHandle fh, UTsize pos, int way)
         {
             return -1;
         }
-        return (int)np;
+        return 0;
     }
 #else
     if (fh)
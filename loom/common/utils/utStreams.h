@@ -118,6 +118,93 @@ protected:
 
 
 
+// Buffers the reads and writes of another stream, so many small ones turn
+// into few large ones on it. Writes reach the stream on flush, when the
+// buffer fills and when the buffered stream is destroyed; reads or writes
+// larger than the buffer go straight through. The stream must outlive it.
+class utBufferedStream : public utStream
+{
+public:
+    enum { DEFAULT_BUFFER_SIZE = 64 * 1024 };
+
+    utBufferedStream(utStream& stream, UTsize bufferSize = DEFAULT_BUFFER_SIZE);
+    ~utBufferedStream();
+
+    void flush(void);
+
+    bool isOpen(void) const { return m_stream.isOpen(); }
+    bool eof(void)    const { return m_readPos >= m_readSize && !m_writeSize && m_stream.eof(); }
+
+    UTsize read(void *dest, UTsize nr) const;
+    UTsize write(const void *src, UTsize nr);
+
+    UTsize position(void) const { return m_stream.position() - (m_readSize - m_readPos) + m_writeSize; }
+    void seek(const UTsize pos, int dir) const;
+
+    UTsize size(void) const { return m_stream.size() + m_writeSize; }
+
+protected:
+
+    void flushWrites(void) const;
+
+    // Moves the stream back to where reading got to, dropping what was
+    // read ahead.
+    void dropReadAhead(void) const;
+
+    utStream&      m_stream;
+    char           *m_buffer;
+    UTsize         m_capacity;
+    mutable UTsize m_readPos, m_readSize;
+    mutable UTsize m_writeSize;
+
+private:
+    utBufferedStream(const utBufferedStream&);
+    utBufferedStream& operator=(const utBufferedStream&);
+};
+
+
+
+// Read only stream over a file mapped with platform_mapFile, so reads are
+// copies out of memory without any file calls, and ptr() gives the whole
+// file without even those.
+class utMappedFileStream : public utStream
+{
+public:
+    utMappedFileStream();
+    ~utMappedFileStream();
+
+    // Only utStream::SM_READ is supported.
+    void open(const char *path, utStream::StreamMode mode = utStream::SM_READ);
+    void close(void);
+
+    bool isOpen(void) const { return m_mapping != 0; }
+    bool eof(void)    const { return !m_mapping || m_pos >= m_size; }
+
+    UTsize read(void *dest, UTsize nr) const;
+    UTsize write(const void *src, UTsize nr) { return -1; }
+
+    UTsize position(void) const { return m_pos; }
+    void seek(const UTsize pos, int dir) const;
+
+    UTsize size(void) const { return m_size; }
+
+    // The mapped file, valid until the stream is closed.
+    const void *ptr(void) const { return m_data; }
+
+protected:
+
+    const char     *m_data;
+    void           *m_mapping;
+    mutable UTsize m_pos;
+    UTsize         m_size;
+
+private:
+    utMappedFileStream(const utMappedFileStream&);
+    utMappedFileStream& operator=(const utMappedFileStream&);
+};
+
+
+
 class utMemoryStream : public utStream
 {
 public:
@@ -0,0 +1,110 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+
+#include <stdio.h>
+
+#include "loom/common/platform/platformFile.h"
+#include "loom/common/utils/utStreams.h"
+#include "seatest.h"
+
+// In the working directory, which the tests may write to
+static const char *streamTestPath(void)
+{
+    return "utStreamsTest.bin";
+}
+
+SEATEST_FIXTURE(utStreams)
+{
+    SEATEST_FIXTURE_ENTRY(utStreams_buffered);
+    SEATEST_FIXTURE_ENTRY(utStreams_mapped);
+}
+
+SEATEST_TEST(utStreams_buffered)
+{
+    utFileStream file;
+    file.open(streamTestPath(), utStream::SM_WRITE);
+    assert_true(file.isOpen());
+
+    {
+        // Small writes, then one larger than the buffer.
+        utBufferedStream stream(file, 64);
+        for (int i = 0; i < 100; i++) stream.write(&i, sizeof(i));
+        assert_int_equal(100 * sizeof(int), stream.position());
+
+        int big[40];
+        for (int i = 0; i < 40; i++) big[i] = 100 + i;
+        stream.write(big, sizeof(big));
+    }
+
+    file.close();
+
+    file.open(streamTestPath(), utStream::SM_READ);
+    assert_int_equal(140 * sizeof(int), file.size());
+
+    utBufferedStream stream(file, 64);
+    for (int i = 0; i < 140; i++)
+    {
+        int value = -1;
+        assert_int_equal(sizeof(int), stream.read(&value, sizeof(value)));
+        assert_int_equal(i, value);
+    }
+
+    char extra;
+    assert_int_equal(0, stream.read(&extra, 1));
+    assert_true(stream.eof());
+
+    // Seeking drops what was read ahead.
+    stream.seek(10 * sizeof(int), SEEK_SET);
+    int values[3];
+    stream.read(values, sizeof(values));
+    assert_int_equal(10, values[0]);
+    assert_int_equal(12, values[2]);
+    assert_int_equal(13 * sizeof(int), stream.position());
+}
+
+SEATEST_TEST(utStreams_mapped)
+{
+    utFileStream file;
+    file.open(streamTestPath(), utStream::SM_WRITE);
+    file.write("mapped stream", 13);
+    file.close();
+
+    utMappedFileStream stream;
+    stream.open(streamTestPath());
+    assert_true(stream.isOpen());
+    assert_int_equal(13, stream.size());
+    assert_true(!memcmp(stream.ptr(), "mapped stream", 13));
+
+    char buffer[8] = { 0 };
+    stream.seek(7, SEEK_SET);
+    assert_int_equal(6, stream.read(buffer, 7));
+    assert_string_equal("stream", buffer);
+    assert_true(stream.eof());
+
+    stream.close();
+    assert_false(stream.isOpen());
+
+    stream.open("this/file/does/not/exist");
+    assert_false(stream.isOpen());
+
+    platform_removeFile(streamTestPath());
+}
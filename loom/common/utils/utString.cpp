@@ -32,7 +32,6 @@
 #include "loom/common/core/allocator.h"
 
 const utString::size_type utString::npos = static_cast<size_t>(-1);
-const char *EMPTY_STRING = "";
 
 /*
  * Like new, we want to guarantee that we NEVER
@@ -50,51 +49,125 @@ static char* malloc_never_null(const size_t b) {
 }
 
 
-static char *strdup_never_null(const char *s)
+utString::utString() :
+    p(NULL)
 {
-    const size_t bufferSize = (s == NULL ? 0 : strlen(s)) + 1;
-    if (bufferSize <= 1) {
-        return (char*) EMPTY_STRING;
-    }
+    buffer[0] = 0;
+}
 
-    char *p  = malloc_never_null(bufferSize);
+utString::~utString() {
+    clear();
+}
 
-    memcpy(p, s, bufferSize);
-    p[bufferSize-1] = 0;
-    return p;
+
+utString::utString(const utString& s) :
+    p(NULL)
+{
+    set(s.c_str(), s.size());
 }
 
 
-utString::utString() :
+utString::utString(const char *s) :
     p(NULL)
 {
-    clear();
+    set(s ? s : "", s ? strlen(s) : 0);
 }
 
-utString::~utString() {
-    clear();
+
+#if UT_HAS_MOVE
+utString::utString(utString&& s) :
+    p(s.p)
+{
+    if (!p)
+    {
+        memcpy(buffer, s.buffer, INLINE_SIZE);
+    }
+    s.p         = NULL;
+    s.buffer[0] = 0;
 }
 
 
-utString::utString(const utString& s) :
-    p(strdup_never_null(s.p))
+utString& utString::operator=(utString&& s)
 {
+    if (this != &s)
+    {
+        clear();
+        p = s.p;
+        if (!p)
+        {
+            memcpy(buffer, s.buffer, INLINE_SIZE);
+        }
+        s.p         = NULL;
+        s.buffer[0] = 0;
+    }
+
+    return *this;
 }
+#endif
 
 
-utString::utString(const char *s) :
-    p(strdup_never_null(s))
+void utString::set(const char *s, size_type length)
 {
+    char *old = p;
+
+    if (length < INLINE_SIZE)
+    {
+        memmove(buffer, s, length);
+        buffer[length] = 0;
+        p = NULL;
+    }
+    else
+    {
+        p = malloc_never_null(length + 1);
+        memcpy(p, s, length);
+        p[length] = 0;
+    }
+
+    // Only now, as s may have pointed into it.
+    if (old)
+    {
+        lmFree(NULL, old);
+    }
+}
+
+
+void utString::append(const char *s, size_type length)
+{
+    const size_type lenp = size();
+
+    if (!p && (lenp + length < INLINE_SIZE))
+    {
+        memmove(buffer + lenp, s, length);
+        buffer[lenp + length] = 0;
+    }
+    else if (!p)
+    {
+        char *grown = malloc_never_null(lenp + length + 1);
+        memcpy(grown, buffer, lenp);
+        memcpy(grown + lenp, s, length);
+        grown[lenp + length] = 0;
+        p = grown;
+    }
+    else
+    {
+        // s may point into p, which realloc can move
+        size_type offset = (s >= p && s <= p + lenp) ? (size_type)(s - p) : npos;
+        p = static_cast<char*>(lmRealloc(NULL, p, lenp + length + 1));
+        memmove(p + lenp, offset != npos ? p + offset : s, length);
+        p[lenp + length] = 0;
+    }
 }
 
 
 void utString::replace(char from, char to)
 {
-    for (UTsize i = 0; i < strlen(p); i++)
+    char *data = p ? p : buffer;
+
+    for ( ; *data; data++)
     {
-        if (p[i] == from)
+        if (*data == from)
         {
-            p[i] = to;
+            *data = to;
         }
     }
 }
@@ -102,14 +175,8 @@ void utString::replace(char from, char to)
 
 void utString::fromBytes(const void *bytes, int len)
 {
-    // Free old value if any.
-    clear();
-
-    // Copy the bytes into p.
-    p = (char*)lmAlloc(NULL, len+1);
-    memcpy(p, bytes, len);
-
-    p[len] = 0; // Make sure we are NULL terminated.
+    // Copies the bytes and NULL terminates them.
+    set(static_cast<const char*>(bytes), len);
 }
 
 void utString::assign(const char* bytes, int len)
@@ -120,12 +187,10 @@ void utString::assign(const char* bytes, int len)
 
 utString& utString::operator=(const char *s)
 {
-    if (p != s)
+    if (c_str() != s)
     {
         // this should work with overlapping memory
-        char *copy = strdup_never_null(s);
-        clear();
-        p = copy;
+        set(s ? s : "", s ? strlen(s) : 0);
     }
 
     return *this;
@@ -134,22 +199,27 @@ utString& utString::operator=(const char *s)
 
 utString& utString::operator=(const utString& s)
 {
-    return operator=(s.p);
+    if (this != &s)
+    {
+        set(s.c_str(), s.size());
+    }
+
+    return *this;
 }
 
 
 utString& utString::operator+=(const utString& s)
 {
-    if (p == EMPTY_STRING)
-    {
-        operator=(s);
-    }
-    else
+    append(s.c_str(), s.size());
+    return *this;
+}
+
+
+utString& utString::operator+=(const char *s)
+{
+    if (s)
     {
-        const size_type lenp = strlen(p);
-        const size_type lens = strlen(s.p) + 1;
-        p = static_cast<char*>(lmRealloc(NULL, p, lenp + lens)); // could return NULL
-        memmove(p + lenp, s.p, lens); // p and s.p MAY overlap
+        append(s, strlen(s));
     }
     return *this;
 }
@@ -157,32 +227,33 @@ utString& utString::operator+=(const utString& s)
 
 bool utString::operator==(const char *s) const
 {
-    return !strcmp(p, s);
+    return !strcmp(c_str(), s);
 }
 
 
 bool utString::operator==(const utString& s) const
 {
-    return !strcmp(p, s.p);
+    return !strcmp(c_str(), s.c_str());
 }
 
 
 bool utString::operator!=(const char *s) const
 {
-    return strcmp(p, s) != 0;
+    return strcmp(c_str(), s) != 0;
 }
 
 
 bool utString::operator!=(const utString& s) const
 {
-    return strcmp(p, s.p) != 0;
+    return strcmp(c_str(), s.c_str()) != 0;
 }
 
 void utString::clear() {
-    if (p != EMPTY_STRING) {
-        lmSafeFree(NULL, p);
-        p = (char*) EMPTY_STRING;
+    if (p) {
+        lmFree(NULL, p);
+        p = NULL;
     }
+    buffer[0] = 0;
 }
 
 
@@ -192,19 +263,29 @@ utString operator+(const utString& lhs, const utString& rhs)
 }
 
 
+#if UT_HAS_MOVE
+utString operator+(utString&& lhs, const utString& rhs)
+{
+    lhs += rhs;
+    return UT_MOVE(lhs);
+}
+#endif
+
+
 utString::size_type utString::size() const
 {
-    return strlen(p);
+    return strlen(c_str());
 }
 
 
 utString::size_type utString::find(char c, size_type start)
 {
-    size_type len = strlen(p);
+    const char *data = c_str();
+    size_type  len   = strlen(data);
 
     for (size_type i = start; i < len; i++)
     {
-        if (p[i] == c)
+        if (data[i] == c)
         {
             return i;
         }
@@ -218,7 +299,7 @@ bool utString::startsWith(const char *prefix) const
     if (empty() || !prefix || *prefix == '\0') return false;
     size_t len = length();
     size_t lenPrefix = strlen(prefix);
-    return strncmp(p, prefix, utMin(len, lenPrefix)) == 0;
+    return strncmp(c_str(), prefix, utMin(len, lenPrefix)) == 0;
 }
 
 bool utString::endsWith(const char *suffix) const
@@ -227,19 +308,19 @@ bool utString::endsWith(const char *suffix) const
     size_t len = length();
     size_t lenSuffix = strlen(suffix);
     if (lenSuffix >  len) return false;
-    return strncmp(p + len - lenSuffix, suffix, lenSuffix) == 0;
+    return strncmp(c_str() + len - lenSuffix, suffix, lenSuffix) == 0;
 }
 
 
 utString::size_type utString::length() const
 {
-    return strlen(p);
+    return strlen(c_str());
 }
 
 
 bool utString::empty() const
 {
-    return *p == '\0';
+    return *c_str() == '\0';
 }
 
 
@@ -247,27 +328,21 @@ utString utString::substr(const size_type start,
                           size_type       len_orig) const
 {
     utString  s;
-    size_type len = strlen(p);
-
-    if (len_orig == npos)
-    {
-        len_orig = len - start;
-    }
+    size_type len = strlen(c_str());
 
     if (start > len)
     {
         abort();
     }
 
+    len -= start;
+
     if (len > len_orig)
     {
         len = len_orig;
     }
 
-    s.clear();
-    s.p = malloc_never_null(len + 1);
-    memcpy(s.p, p + start, len);
-    s.p[len] = '\0';
+    s.set(c_str() + start, len);
 
     return s;
 }
@@ -276,19 +351,19 @@ utString utString::substr(const size_type start,
 // unchecked access
 char utString::operator[](const size_type n) const
 {
-    return p[n];
+    return c_str()[n];
 }
 
 
 // checked access
 char utString::at(const size_type n) const
 {
-    if (n > strlen(p))
+    if (n > strlen(c_str()))
     {
         abort();
     }
 
-    return p[n];
+    return c_str()[n];
 }
 
 
@@ -306,13 +381,15 @@ utString& utString::erase(size_type pos, size_type len)
     size_type bytesToMove = maxLength - len;
 
     // erase by overwriting
-    memmove(p + pos, p + pos + len, bytesToMove);
-
-    size_type newSize = pos + bytesToMove + 1;
+    char *data = p ? p : buffer;
+    memmove(data + pos, data + pos + len, bytesToMove);
+    data[pos + bytesToMove] = 0;
 
-    // remove unused space
-    p = static_cast<char*>(lmRealloc(NULL, p, newSize));
-    p[newSize-1] = 0;
+    // remove unused space, moving back inline when it fits
+    if (p && len)
+    {
+        set(p, pos + bytesToMove);
+    }
 
     return *this;
 }
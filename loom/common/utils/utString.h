@@ -49,12 +49,17 @@
 //* utString based on "mystring"
 //* Copyright (C) Christian Stigen Larsen, 2007
 //* Placed in the Public Domain by the author.
+//
+// Strings shorter than INLINE_SIZE are kept in the string itself, so short
+// names don't allocate. The inline buffer is addressed through c_str() and
+// never by a pointer into the object, so strings may still be memmoved.
 class utString {
-    char *p;
 public:
     typedef size_t   size_type;
     static const size_type npos;
 
+    enum { INLINE_SIZE = 24 };
+
     utString();
     virtual ~utString();
     utString(const utString&);
@@ -62,6 +67,13 @@ public:
     utString& operator=(const char *);
     utString& operator=(const utString&);
     utString& operator+=(const utString&);
+    utString& operator+=(const char *);
+
+#if UT_HAS_MOVE
+    utString(utString&&);
+    utString& operator=(utString&&);
+    friend utString operator+(utString&& lhs, const utString& rhs);
+#endif
 
     friend utString operator+(const utString& lhs, const utString& rhs);
     bool operator==(const char *) const;
@@ -75,7 +87,7 @@ public:
 
     inline const char *c_str() const
     {
-        return p;
+        return p ? p : buffer;
     }
 
     inline const char *data() const
@@ -98,6 +110,15 @@ public:
 
     // inplace replace
     void replace(char from, char to);
+
+private:
+    char *p;                   // heap copy, NULL while held in buffer
+    char buffer[INLINE_SIZE];
+
+    // Replaces the contents with length bytes at s, which may lie within
+    // this string.
+    void set(const char *s, size_type length);
+    void append(const char *s, size_type length);
 };
 
 //typedef std::string utString;
@@ -250,6 +271,14 @@ public:
     utHashedString(const utString& k) : m_key(k), m_hash(UT_NPOS) { hash(); }
     utHashedString(const utHashedString& k) : m_key(k.m_key), m_hash(k.m_hash) {}
 
+    utHashedString& operator=(const utHashedString& k) { m_key = k.m_key; m_hash = k.m_hash; return *this; }
+
+#if UT_HAS_MOVE
+    utHashedString(utString&& k) : m_key(UT_MOVE(k)), m_hash(UT_NPOS) { hash(); }
+    utHashedString(utHashedString&& k) : m_key(UT_MOVE(k.m_key)), m_hash(k.m_hash) {}
+    utHashedString& operator=(utHashedString&& k) { m_key = UT_MOVE(k.m_key); m_hash = k.m_hash; return *this; }
+#endif
+
     UT_INLINE const utString& str(void) const { return m_key; }
 
     UThash hash(void) const
@@ -257,20 +286,25 @@ public:
         // use cached hash
         if (m_hash != UT_NPOS) { return m_hash; }
 
-        const char *str = m_key.c_str();
+        m_hash = hash(m_key.c_str());
+        return m_hash;
+    }
 
+    // the hash a utHashedString of str has, without copying str
+    static UThash hash(const char *str)
+    {
         // magic numbers from http://www.isthe.com/chongo/tech/comp/fnv/
         static const unsigned int InitialFNV  = 2166136261u;
         static const unsigned int FNVMultiple = 16777619u;
 
         // Fowler / Noll / Vo (FNV) Hash
-        m_hash = (UThash)InitialFNV;
+        UThash h = (UThash)InitialFNV;
         for (int i = 0; str[i]; i++)
         {
-            m_hash = m_hash ^ (str[i]);               // xor  the low 8 bits
-            m_hash = m_hash * FNVMultiple;            // multiply by the magic number
+            h = h ^ (str[i]);                         // xor  the low 8 bits
+            h = h * FNVMultiple;                      // multiply by the magic number
         }
-        return m_hash;
+        return h;
     }
 
     UT_INLINE bool operator==(const utHashedString& v) const { return hash() == v.hash(); }
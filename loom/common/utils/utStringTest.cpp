@@ -0,0 +1,144 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+
+#include "loom/common/utils/utTypes.h"
+#include "loom/common/utils/utString.h"
+#include "seatest.h"
+
+SEATEST_FIXTURE(utString)
+{
+    SEATEST_FIXTURE_ENTRY(utString_inline);
+    SEATEST_FIXTURE_ENTRY(utString_append);
+    SEATEST_FIXTURE_ENTRY(utString_move);
+    SEATEST_FIXTURE_ENTRY(utString_inlineArray);
+}
+
+SEATEST_TEST(utString_inline)
+{
+    const char *longName = "a name well past the inline buffer";
+
+    utString empty;
+    assert_true(empty.empty());
+    assert_string_equal("", empty.c_str());
+
+    // Short strings live inside the object.
+    utString shortName("short");
+    assert_true(shortName.c_str() >= (const char *)&shortName &&
+                shortName.c_str() < (const char *)&shortName + sizeof(utString));
+
+    utString name(longName);
+    assert_string_equal(longName, name.c_str());
+    assert_false(name.c_str() >= (const char *)&name &&
+                 name.c_str() < (const char *)&name + sizeof(utString));
+
+    // Shrinking below the buffer moves back inline.
+    name.erase(5, name.size());
+    assert_string_equal("a nam", name.c_str());
+    assert_true(name.c_str() >= (const char *)&name &&
+                name.c_str() < (const char *)&name + sizeof(utString));
+
+    name = longName;
+    assert_string_equal("name", name.substr(2, 4).c_str());
+    assert_string_equal("buffer", name.substr(name.size() - 6).c_str());
+
+    name = name.c_str() + 2;
+    assert_string_equal(longName + 2, name.c_str());
+
+    name.fromBytes("bytes", 3);
+    assert_string_equal("byt", name.c_str());
+}
+
+SEATEST_TEST(utString_append)
+{
+    utString s("abc");
+
+    s += "def";
+    assert_string_equal("abcdef", s.c_str());
+
+    // Growing past the buffer, then appending to itself on the heap.
+    s += "ghijklmnopqrstuvwxyz";
+    s += s;
+    assert_string_equal("abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz", s.c_str());
+
+    utString key("Content-Type");
+    utString header = key + ":" + utString("text/plain");
+    assert_string_equal("Content-Type:text/plain", header.c_str());
+}
+
+SEATEST_TEST(utString_move)
+{
+#if UT_HAS_MOVE
+    utString   heap("a name well past the inline buffer");
+    const char *bits = heap.c_str();
+
+    utString moved(UT_MOVE(heap));
+    assert_true(moved.c_str() == bits);
+    assert_true(heap.empty());
+
+    utString shortName("short");
+    moved = UT_MOVE(shortName);
+    assert_string_equal("short", moved.c_str());
+    assert_true(shortName.empty());
+
+    utArray<utString> a;
+    a.push_back(utString("one"));
+    a.emplace_back("two");
+    for (int i = 0; i < 100; i++) a.emplace_back("a name well past the inline buffer");
+    assert_int_equal(102, a.size());
+    assert_string_equal("two", a[1].c_str());
+
+    utArray<utString> b(UT_MOVE(a));
+    assert_int_equal(0, a.size());
+    assert_int_equal(102, b.size());
+    assert_string_equal("one", b[0].c_str());
+#endif
+}
+
+SEATEST_TEST(utString_inlineArray)
+{
+    utInlineArray<utString, 4> a;
+
+    a.push_back("one");
+    a.push_back("two");
+    assert_true(a.isInline());
+
+    utInlineArray<utString, 4> copied(a);
+    assert_true(copied.isInline());
+    assert_string_equal("two", copied[1].c_str());
+
+    for (int i = 0; i < 10; i++) a.push_back("more");
+    assert_false(a.isInline());
+    assert_int_equal(12, a.size());
+    assert_string_equal("one", a[0].c_str());
+
+    // Clearing returns to the inline storage.
+    a.clear();
+    assert_true(a.isInline());
+    assert_int_equal(0, a.size());
+    a.push_back("again");
+    assert_string_equal("again", a[0].c_str());
+
+    a.clear();
+    copied.clear();
+    assert_int_equal(0, copied.size());
+    assert_true(copied.isInline());
+}
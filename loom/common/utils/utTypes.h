@@ -638,6 +638,14 @@ public:
         copy(m_data, o.m_data, m_size);
     }
 
+#if UT_HAS_MOVE
+    utArray(utArray<T>&& o)
+        : m_size(0), m_capacity(0), m_data(0), m_cache(0), m_attached(false)
+    {
+        *this = UT_MOVE(o);
+    }
+#endif
+
     ~utArray() { clear(); }
 
     void clear(bool useCache = false)
@@ -707,7 +715,7 @@ public:
 
         // Shift everything down.
         for (int i = m_size; i > 0; i--)
-            m_data[i] = m_data[i - 1];
+            m_data[i] = UT_MOVE(m_data[i - 1]);
 
         m_data[0] = v;
         m_size++;
@@ -724,6 +732,34 @@ public:
         m_size++;
     }
 
+#if UT_HAS_MOVE
+    UT_INLINE void push_back(T&& v)
+    {
+        if (m_size == m_capacity)
+        {
+            reserve(m_size == 0 ? 8 : m_size * 2);
+        }
+
+        m_data[m_size] = UT_MOVE(v);
+        m_size++;
+    }
+
+    // Constructs the new last element in place from args.
+    template<typename ... Args>
+    UT_INLINE T& emplace_back(Args&& ... args)
+    {
+        if (m_size == m_capacity)
+        {
+            reserve(m_size == 0 ? 8 : m_size * 2);
+        }
+
+        // Slots past the size are default constructed, replace it.
+        loom_destructInPlace<T>(&m_data[m_size]);
+        new (&m_data[m_size]) T(std::forward<Args>(args) ...);
+        return m_data[m_size++];
+    }
+#endif
+
     UT_INLINE void pop_back(void)
     {
         m_size--;
@@ -810,12 +846,16 @@ public:
         if (m_capacity < nr)
         {
             T *p = loom_newArray<T>(NULL, nr);
-            detach();
             if (m_data != 0)
             {
-                copy(p, m_data, m_size);
-                loom_deleteArray(NULL, m_data);
+                // Attached memory is moved out of, but not ours to free.
+                for (UTsize i = 0; i < m_size; i++) { p[i] = UT_MOVE(m_data[i]); }
+                if (!m_attached)
+                {
+                    loom_deleteArray(NULL, m_data);
+                }
             }
+            m_attached = false;
             m_data     = p;
             m_capacity = nr;
         }
@@ -884,6 +924,35 @@ public:
         return *this;
     }
 
+#if UT_HAS_MOVE
+    // Takes over the storage of rhs, unless it is attached memory, which
+    // isn't rhs' to give away.
+    utArray<T>& operator=(utArray<T>&& rhs)
+    {
+        if (this != &rhs)
+        {
+            if (rhs.m_attached)
+            {
+                *this = static_cast<const utArray<T>&>(rhs);
+                return *this;
+            }
+
+            clear();
+            m_size     = rhs.m_size;
+            m_capacity = rhs.m_capacity;
+            m_data     = rhs.m_data;
+            m_cache    = rhs.m_cache;
+
+            rhs.m_size     = 0;
+            rhs.m_capacity = 0;
+            rhs.m_data     = 0;
+            rhs.m_cache    = 0;
+        }
+
+        return *this;
+    }
+#endif
+
     UT_INLINE void copy(Pointer dst, ConstPointer src, UTsize size)
     {
         UT_ASSERT(size <= m_size);
@@ -892,12 +961,22 @@ public:
 
 protected:
 
+    // Uses storage, holding capacity constructed elements, until the array
+    // outgrows it. It is not freed, see utInlineArray.
+    void useStorage(Pointer storage, UTsize capacity)
+    {
+        clear();
+        m_data     = storage;
+        m_capacity = capacity;
+        m_attached = true;
+    }
+
     void swap(UTsize a, UTsize b)
     {
-        ValueType t = m_data[a];
+        ValueType t = UT_MOVE(m_data[a]);
 
-        m_data[a] = m_data[b];
-        m_data[b] = t;
+        m_data[a] = UT_MOVE(m_data[b]);
+        m_data[b] = UT_MOVE(t);
     }
 
     UTsize  m_size;
@@ -907,6 +986,65 @@ protected:
     bool    m_attached;
 };
 
+// utArray holding up to N elements within itself, only allocating once it
+// grows past them. For small lists built on hot paths.
+template<typename T, UTsize N>
+class utInlineArray : public utArray<T>
+{
+public:
+    utInlineArray() { this->useStorage(m_inline, N); }
+
+    utInlineArray(const utArray<T>& o)
+    {
+        this->useStorage(m_inline, N);
+        *this = o;
+    }
+
+    utInlineArray(const utInlineArray<T, N>& o)
+    {
+        this->useStorage(m_inline, N);
+        *this = o;
+    }
+
+    void clear(bool useCache = false)
+    {
+        if (this->m_data == m_inline)
+        {
+            for (UTsize i = 0; i < this->m_size; i++) { m_inline[i] = T(); }
+            this->m_size = 0;
+            return;
+        }
+
+        utArray<T>::clear(useCache);
+        if (!this->m_data)
+        {
+            this->useStorage(m_inline, N);
+        }
+    }
+
+    utInlineArray<T, N>& operator=(const utArray<T>& rhs)
+    {
+        if (this != &rhs)
+        {
+            clear();
+            this->resize(rhs.size());
+            this->copy(this->m_data, rhs.ptr(), rhs.size());
+        }
+
+        return *this;
+    }
+
+    utInlineArray<T, N>& operator=(const utInlineArray<T, N>& rhs)
+    {
+        return *this = static_cast<const utArray<T>&>(rhs);
+    }
+
+    UT_INLINE bool isInline(void) const { return this->m_data == m_inline; }
+
+private:
+    T m_inline[N];
+};
+
 template<typename T>
 class utStackIterator
 {
@@ -1394,18 +1532,22 @@ public:
 
     // Find and cache key
     Value *get(const Key& key)
+    {
+        return getByHash(key.hash());
+    }
+
+    // Keys compare by hash, so a precomputed hash can be looked up without
+    // building a Key
+    Value *getByHash(UThash hr)
     {
         if (!m_bptr || (m_size == 0))
         {
             return (Value *)0;
         }
 
-
-        UThash hr = key.hash();
-
         if (m_lastKey != hr)
         {
-            UTsize i = find(key);
+            UTsize i = findByHash(hr);
             if (i == UT_NPOS) { return (Value *)0; }
 
 
@@ -1422,14 +1564,17 @@ public:
     const Value *operator [](const Key& key) const { return get(key); }
 
     UTsize find(const Key& key) const
+    {
+        return findByHash(key.hash());
+    }
+
+    UTsize findByHash(UThash hk) const
     {
         if ((m_capacity == 0) || (m_capacity == UT_NPOS) || (m_size == 0))
         {
             return UT_NPOS;
         }
 
-        UTsize hk = key.hash();
-
         // Short cut.
         if ((m_lastPos != UT_NPOS) && (m_lastKey == hk))
         {
@@ -1442,7 +1587,7 @@ public:
         UT_ASSERT(m_bptr && m_iptr && m_nptr);
 
         UTsize fh = m_iptr[hr];
-        while (fh != UT_NPOS && (key != m_bptr[fh].first))
+        while (fh != UT_NPOS && (m_bptr[fh].first != hk))
         {
             fh = m_nptr[fh];
         }
@@ -1756,6 +1901,524 @@ private:
 
 
 
+// Control bytes of utFlatHashTable buckets, full buckets hold the low 7 bits
+// of the mixed hash.
+#define _UT_FLATHASH_EMPTY      0x80
+#define _UT_FLATHASH_DELETED    0xFE
+#define _UT_FLATHASH_GROUP      16
+
+// Initial bucket count, a power of two of at least two groups
+#define _UT_FLATHASH_INIT       32
+
+// Buckets are filled up to 7/8 before growing
+#define _UT_FLATHASH_LIMIT(buckets)    ((buckets) - (buckets) / 8)
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define _UT_FLATHASH_SSE2       1
+#include <emmintrin.h>
+#else
+#define _UT_FLATHASH_SSE2       0
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Bitmask of the bytes in the group equal to value, bit i for byte i.
+UT_INLINE unsigned int utFlatHashMatch(const unsigned char *group, unsigned char value)
+{
+#if _UT_FLATHASH_SSE2
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)value)));
+#else
+    unsigned int mask = 0;
+    for (int i = 0; i < _UT_FLATHASH_GROUP; i++)
+    {
+        mask |= (unsigned int)(group[i] == value) << i;
+    }
+    return mask;
+#endif
+}
+
+// Bitmask of the empty or deleted bytes in the group.
+UT_INLINE unsigned int utFlatHashMatchFree(const unsigned char *group)
+{
+#if _UT_FLATHASH_SSE2
+    return (unsigned int)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+    unsigned int mask = 0;
+    for (int i = 0; i < _UT_FLATHASH_GROUP; i++)
+    {
+        mask |= (unsigned int)(group[i] >> 7) << i;
+    }
+    return mask;
+#endif
+}
+
+UT_INLINE unsigned int utFlatHashLowestBit(unsigned int mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned int)index;
+#else
+    return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+
+// Key hashes are scrambled by a Fibonacci multiply, the group is taken
+// from the top bits and the control byte from the middle ones, which are
+// well distributed whatever the key adaptor does.
+UT_INLINE UThash utFlatHashMix(UThash h)
+{
+    return h * 0x9E3779B1;
+}
+
+UT_INLINE unsigned char utFlatHashControl(UThash h)
+{
+    return (unsigned char)((h >> 7) & 0x7F);
+}
+
+
+/*
+ * Open addressing alternative to utHashTable, with the same interface and
+ * key adaptors. Entries are stored densely in insertion order, and removal
+ * moves the last entry into the hole, exactly as in utHashTable, so index
+ * based access (at, keyAt) and iteration carry over. Lookups go through a
+ * table of buckets holding the entry index, with a control byte per bucket
+ * that keeps 7 bits of the hash. Buckets are probed a group of 16 control
+ * bytes at a time, compared with one SSE2 instruction where available, so
+ * a lookup typically touches one cache line of control bytes and the entry
+ * itself instead of chasing a chain through three arrays.
+ *
+ * As in utHashTable, keys are considered equal when their hashes are.
+ */
+template<typename Key, typename Value>
+class utFlatHashTable
+{
+public:
+    typedef utHashEntry<Key, Value>                                   Entry;
+    typedef const utHashEntry<Key, Value>                             ConstEntry;
+
+    typedef Entry *                                                   EntryArray;
+
+    typedef Key                                                       KeyType;
+    typedef Value                                                     ValueType;
+
+    typedef const Key                                                 ConstKeyType;
+    typedef const Value                                               ConstValueType;
+
+    typedef Value&                                                    ReferenceValueType;
+    typedef const Value&                                              ConstReferenceValueType;
+
+    typedef Key&                                                      ReferenceKeyType;
+    typedef const Key&                                                ConstReferenceKeyType;
+
+    typedef EntryArray                                                Pointer;
+    typedef const Entry *                                             ConstPointer;
+
+    typedef utHashTableIterator<utFlatHashTable<Key, Value> >         Iterator;
+    typedef const utHashTableIterator<utFlatHashTable<Key, Value> >   ConstIterator;
+
+public:
+
+    utFlatHashTable()
+        : m_size(0), m_capacity(0), m_buckets(0), m_tombstones(0), m_cache(0), m_shift(0),
+          m_ctrl(0), m_slots(0), m_bptr(0)
+    {
+    }
+
+    utFlatHashTable(const utFlatHashTable& rhs)
+        : m_size(0), m_capacity(0), m_buckets(0), m_tombstones(0), m_cache(0), m_shift(0),
+          m_ctrl(0), m_slots(0), m_bptr(0)
+    {
+        doCopy(rhs);
+    }
+
+    ~utFlatHashTable() { clear(); }
+
+    utFlatHashTable<Key, Value>& operator =(const utFlatHashTable<Key, Value>& rhs)
+    {
+        if (this != &rhs)
+        {
+            doCopy(rhs);
+        }
+        return *this;
+    }
+
+    void clear(bool useCache = false)
+    {
+        if (useCache && (++m_cache <= _UT_CACHE_LIMIT))
+        {
+            m_size       = 0;
+            m_tombstones = 0;
+            if (m_ctrl)
+            {
+                memset(m_ctrl, _UT_FLATHASH_EMPTY, m_buckets);
+            }
+            return;
+        }
+
+        m_size = m_capacity = m_buckets = m_tombstones = 0;
+        m_cache = 0;
+
+        loom_deleteArray(NULL, m_bptr);
+        lmFree(NULL, m_ctrl);
+        lmFree(NULL, m_slots);
+        m_bptr  = 0;
+        m_ctrl  = 0;
+        m_slots = 0;
+    }
+
+    Value& at(UTsize i)                    { UT_ASSERT(m_bptr && i < m_size); return m_bptr[i].second; }
+    Value& operator [](UTsize i)           { UT_ASSERT(m_bptr && i < m_size); return m_bptr[i].second; }
+    const Value& at(UTsize i) const { UT_ASSERT(m_bptr && i < m_size); return m_bptr[i].second; }
+    const Value& operator [](UTsize i) const { UT_ASSERT(m_bptr && i < m_size); return m_bptr[i].second; }
+    Key& keyAt(UTsize i)                 { UT_ASSERT(m_bptr && i < m_size); return m_bptr[i].first; }
+    const Key& keyAt(UTsize i) const { UT_ASSERT(m_bptr && i < m_size); return m_bptr[i].first; }
+
+    Value *get(const Key& key)
+    {
+        return getByHash(key.hash());
+    }
+
+    const Value *get(const Key& key) const
+    {
+        UTsize i = findByHash(key.hash());
+        return i == UT_NPOS ? (const Value *)0 : &m_bptr[i].second;
+    }
+
+    Value *getByHash(UThash hk)
+    {
+        UTsize i = findByHash(hk);
+        return i == UT_NPOS ? (Value *)0 : &m_bptr[i].second;
+    }
+
+    Value *operator [](const Key& key)       { return get(key); }
+    const Value *operator [](const Key& key) const { return get(key); }
+
+    UTsize find(const Key& key) const
+    {
+        return findByHash(key.hash());
+    }
+
+    UTsize findByHash(UThash hk) const
+    {
+        UTsize bucket = findBucket(hk);
+        return bucket == UT_NPOS ? UT_NPOS : m_slots[bucket];
+    }
+
+    void erase(const Key& key) { remove(key); }
+
+    void remove(const Key& key)
+    {
+        UThash hk     = key.hash();
+        UTsize bucket = findBucket(hk);
+
+        if (bucket == UT_NPOS)
+        {
+            return;
+        }
+
+        UTsize index = m_slots[bucket];
+        releaseBucket(bucket);
+
+        // Fill the hole with the last entry, pointing its bucket at it.
+        UTsize last = m_size - 1;
+        if (index != last)
+        {
+            UTsize lastBucket = findBucketOf(m_bptr[last].first.hash(), last);
+            UT_ASSERT(lastBucket != UT_NPOS);
+            m_slots[lastBucket] = index;
+            m_bptr[index]       = m_bptr[last];
+        }
+
+        --m_size;
+    }
+
+    // If the key is missing, insert the key-value pair, otherwise replace the existing value
+    void set(const Key& key, const Value& val)
+    {
+        bool inserted = insert(key, val);
+        if (!inserted)
+        {
+            *get(key) = val;
+        }
+    }
+
+    bool insert(const Key& key, const Value& val)
+    {
+        UThash hk     = key.hash();
+        UThash h      = utFlatHashMix(hk);
+        UTsize bucket = UT_NPOS;
+
+        if (m_buckets && !probeInsert(hk, h, &bucket))
+        {
+            return false;
+        }
+
+        if (m_size + m_tombstones >= m_capacity)
+        {
+            // Mostly tombstones, rehash in place
+            rehash(m_size < m_capacity / 2 && m_buckets ? m_buckets : (m_buckets ? m_buckets * 2 : _UT_FLATHASH_INIT));
+            bucket = findFreeBucket(h);
+        }
+
+        if (m_ctrl[bucket] == _UT_FLATHASH_DELETED)
+        {
+            --m_tombstones;
+        }
+
+        m_ctrl[bucket]  = utFlatHashControl(h);
+        m_slots[bucket] = m_size;
+        m_bptr[m_size]  = Entry(key, val);
+
+        ++m_size;
+        return true;
+    }
+
+    UT_INLINE Pointer ptr(void)             { return m_bptr; }
+    UT_INLINE ConstPointer ptr(void) const { return m_bptr; }
+    UT_INLINE bool valid(void) const { return m_bptr != 0; }
+
+    UT_INLINE UTsize size(void) const { return m_size; }
+    UT_INLINE UTsize capacity(void) const { return m_capacity; }
+    UT_INLINE bool empty(void) const { return m_size == 0; }
+
+    Iterator iterator(void)       { return m_bptr && m_size > 0 ? Iterator(m_bptr, m_size) : Iterator(); }
+    ConstIterator iterator(void) const { return m_bptr && m_size > 0 ? ConstIterator(m_bptr, m_size) : ConstIterator(); }
+
+    // Makes room for nr entries without growing
+    void reserve(UTsize nr)
+    {
+        if ((m_capacity < nr) && (nr != UT_NPOS))
+        {
+            UTsize buckets = m_buckets ? m_buckets : _UT_FLATHASH_INIT;
+            while (_UT_FLATHASH_LIMIT(buckets) < nr)
+            {
+                buckets *= 2;
+            }
+            rehash(buckets);
+        }
+    }
+
+private:
+
+    // Probes groups of buckets, each step one group further than the last,
+    // which visits every group once for a power of two group count.
+    UTsize findBucket(UThash hk) const
+    {
+        if (m_size == 0)
+        {
+            return UT_NPOS;
+        }
+
+        return findMixedBucket(hk, utFlatHashMix(hk));
+    }
+
+    UTsize findMixedBucket(UThash hk, UThash h) const
+    {
+        UTsize mask     = m_buckets / _UT_FLATHASH_GROUP - 1;
+        UTsize group    = h >> m_shift;
+        unsigned char c = utFlatHashControl(h);
+
+        for (UTsize step = 1; ; step++)
+        {
+            const unsigned char *ctrl = m_ctrl + group * _UT_FLATHASH_GROUP;
+
+            for (unsigned int match = utFlatHashMatch(ctrl, c); match; match &= match - 1)
+            {
+                UTsize bucket = group * _UT_FLATHASH_GROUP + utFlatHashLowestBit(match);
+                if (m_bptr[m_slots[bucket]].first == hk)
+                {
+                    return bucket;
+                }
+            }
+
+            if (utFlatHashMatch(ctrl, _UT_FLATHASH_EMPTY) || (step > mask))
+            {
+                return UT_NPOS;
+            }
+
+            group = (group + step) & mask;
+        }
+    }
+
+    // Looks for the key and the first free bucket on its probe sequence in
+    // one pass, returns false if the key is present.
+    bool probeInsert(UThash hk, UThash h, UTsize *freeBucket) const
+    {
+        UTsize mask     = m_buckets / _UT_FLATHASH_GROUP - 1;
+        UTsize group    = h >> m_shift;
+        unsigned char c = utFlatHashControl(h);
+
+        for (UTsize step = 1; ; step++)
+        {
+            const unsigned char *ctrl = m_ctrl + group * _UT_FLATHASH_GROUP;
+
+            if (m_size)
+            {
+                for (unsigned int match = utFlatHashMatch(ctrl, c); match; match &= match - 1)
+                {
+                    if (m_bptr[m_slots[group * _UT_FLATHASH_GROUP + utFlatHashLowestBit(match)]].first == hk)
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            unsigned int free = utFlatHashMatchFree(ctrl);
+            if (free && (*freeBucket == UT_NPOS))
+            {
+                *freeBucket = group * _UT_FLATHASH_GROUP + utFlatHashLowestBit(free);
+            }
+
+            if (utFlatHashMatch(ctrl, _UT_FLATHASH_EMPTY) || (step > mask))
+            {
+                return true;
+            }
+
+            group = (group + step) & mask;
+        }
+    }
+
+    // Bucket holding the entry at index, which has hash hk
+    UTsize findBucketOf(UThash hk, UTsize index) const
+    {
+        UThash h        = utFlatHashMix(hk);
+        UTsize mask     = m_buckets / _UT_FLATHASH_GROUP - 1;
+        UTsize group    = h >> m_shift;
+        unsigned char c = utFlatHashControl(h);
+
+        for (UTsize step = 1; step <= mask + 1; step++)
+        {
+            const unsigned char *ctrl = m_ctrl + group * _UT_FLATHASH_GROUP;
+
+            for (unsigned int match = utFlatHashMatch(ctrl, c); match; match &= match - 1)
+            {
+                UTsize bucket = group * _UT_FLATHASH_GROUP + utFlatHashLowestBit(match);
+                if (m_slots[bucket] == index)
+                {
+                    return bucket;
+                }
+            }
+
+            group = (group + step) & mask;
+        }
+
+        return UT_NPOS;
+    }
+
+    UTsize findFreeBucket(UThash h) const
+    {
+        UTsize mask  = m_buckets / _UT_FLATHASH_GROUP - 1;
+        UTsize group = h >> m_shift;
+
+        for (UTsize step = 1; ; step++)
+        {
+            unsigned int free = utFlatHashMatchFree(m_ctrl + group * _UT_FLATHASH_GROUP);
+            if (free)
+            {
+                return group * _UT_FLATHASH_GROUP + utFlatHashLowestBit(free);
+            }
+
+            group = (group + step) & mask;
+        }
+    }
+
+    // A probe only continues past a group without empty buckets, so a
+    // bucket in a group which has one can go straight back to empty.
+    void releaseBucket(UTsize bucket)
+    {
+        const unsigned char *ctrl = m_ctrl + (bucket & ~(UTsize)(_UT_FLATHASH_GROUP - 1));
+
+        if (utFlatHashMatch(ctrl, _UT_FLATHASH_EMPTY))
+        {
+            m_ctrl[bucket] = _UT_FLATHASH_EMPTY;
+        }
+        else
+        {
+            m_ctrl[bucket] = _UT_FLATHASH_DELETED;
+            ++m_tombstones;
+        }
+    }
+
+    void rehash(UTsize buckets)
+    {
+        UT_ASSERT(buckets >= 2 * _UT_FLATHASH_GROUP && !(buckets & (buckets - 1)));
+
+        UTsize capacity = _UT_FLATHASH_LIMIT(buckets);
+
+        if (capacity != m_capacity)
+        {
+            Entry *entries = loom_newArray<Entry>(NULL, capacity);
+            for (UTsize i = 0; i < m_size; i++)
+            {
+                entries[i] = m_bptr[i];
+            }
+            loom_deleteArray(NULL, m_bptr);
+            m_bptr = entries;
+        }
+
+        if (buckets != m_buckets)
+        {
+            lmFree(NULL, m_ctrl);
+            lmFree(NULL, m_slots);
+            m_ctrl  = (unsigned char *)lmAlloc(NULL, buckets);
+            m_slots = (UTsize *)lmAlloc(NULL, buckets * sizeof(UTsize));
+        }
+
+        m_buckets    = buckets;
+        m_capacity   = capacity;
+        m_tombstones = 0;
+
+        // Shift taking the group from the top bits of a mixed hash
+        m_shift = 32;
+        for (UTsize groups = buckets / _UT_FLATHASH_GROUP; groups > 1; groups >>= 1)
+        {
+            m_shift--;
+        }
+
+        memset(m_ctrl, _UT_FLATHASH_EMPTY, m_buckets);
+
+        for (UTsize i = 0; i < m_size; i++)
+        {
+            UThash h      = utFlatHashMix(m_bptr[i].first.hash());
+            UTsize bucket = findFreeBucket(h);
+
+            m_ctrl[bucket]  = utFlatHashControl(h);
+            m_slots[bucket] = i;
+        }
+    }
+
+    void doCopy(const utFlatHashTable<Key, Value>& rhs)
+    {
+        clear();
+
+        if (rhs.empty())
+        {
+            return;
+        }
+
+        reserve(rhs.m_size);
+        for (UTsize i = 0; i < rhs.m_size; i++)
+        {
+            insert(rhs.m_bptr[i].first, rhs.m_bptr[i].second);
+        }
+    }
+
+    UTsize        m_size, m_capacity;
+    UTsize        m_buckets, m_tombstones;
+    UTsize        m_cache;
+    UTsize        m_shift;
+
+    unsigned char *m_ctrl;
+    UTsize        *m_slots;
+    EntryArray    m_bptr;
+};
+
+
+
 UT_INLINE UThash utHash(int v)
 {
     utIntHashKey hk(v);
@@ -0,0 +1,640 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "loom/common/xml/xmlReader.h"
+
+static bool isWhitespace(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+
+static bool isNameEnd(char c)
+{
+    return isWhitespace(c) || (c == '/') || (c == '>') || (c == '=');
+}
+
+
+static bool spanEquals(const char *chars, UTsize length, const char *string)
+{
+    return (strlen(string) == length) && !memcmp(chars, string, length);
+}
+
+
+XMLReader::XMLReader(const char *xml, UTsize length) :
+    m_xml(xml), m_length(length), m_pos(0), m_token(XML_READER_END),
+    m_pendingEnd(false), m_rootDone(false), m_name(NULL), m_nameLength(0),
+    m_textIsCData(false), m_error(NULL), m_errorOffset(0)
+{
+    m_text.chars  = NULL;
+    m_text.length = 0;
+
+    // skip a UTF-8 byte order mark
+    if ((m_length >= 3) && !memcmp(m_xml, "\xEF\xBB\xBF", 3))
+    {
+        m_pos = 3;
+    }
+}
+
+
+XMLReaderToken XMLReader::fail(const char *error)
+{
+    if (!m_error)
+    {
+        m_error       = error;
+        m_errorOffset = m_pos;
+    }
+
+    m_token = XML_READER_ERROR;
+    return XML_READER_ERROR;
+}
+
+
+void XMLReader::skipWhitespace()
+{
+    while ((m_pos < m_length) && isWhitespace(m_xml[m_pos]))
+    {
+        m_pos++;
+    }
+}
+
+
+bool XMLReader::startsWith(const char *prefix) const
+{
+    UTsize length = strlen(prefix);
+
+    return (m_length - m_pos >= length) && !memcmp(m_xml + m_pos, prefix, length);
+}
+
+
+bool XMLReader::skipPast(const char *terminator)
+{
+    UTsize length = strlen(terminator);
+
+    while (m_length - m_pos >= length)
+    {
+        if (!memcmp(m_xml + m_pos, terminator, length))
+        {
+            m_pos += length;
+            return true;
+        }
+        m_pos++;
+    }
+
+    m_pos = m_length;
+    return false;
+}
+
+
+bool XMLReader::skipDeclaration()
+{
+    // <!DOCTYPE ...> may hold an internal subset in brackets, which in turn
+    // holds '>' characters
+    int brackets = 0;
+
+    while (m_pos < m_length)
+    {
+        char c = m_xml[m_pos++];
+
+        if (c == '[')
+        {
+            brackets++;
+        }
+        else if ((c == ']') && brackets)
+        {
+            brackets--;
+        }
+        else if ((c == '>') && !brackets)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+bool XMLReader::readName(Span& name)
+{
+    UTsize start = m_pos;
+
+    while ((m_pos < m_length) && !isNameEnd(m_xml[m_pos]))
+    {
+        m_pos++;
+    }
+
+    name.chars  = m_xml + start;
+    name.length = m_pos - start;
+
+    return name.length != 0;
+}
+
+
+XMLReaderToken XMLReader::next()
+{
+    if (m_error)
+    {
+        return XML_READER_ERROR;
+    }
+
+    m_attributes.clear(true);
+
+    if (m_pendingEnd)
+    {
+        // the end of <a/>, the name is still that of the begin
+        m_pendingEnd = false;
+        m_stack.pop_back();
+        m_rootDone = !m_stack.size();
+        m_token    = XML_READER_ELEMENT_END;
+        return m_token;
+    }
+
+    while (m_pos < m_length)
+    {
+        if (m_xml[m_pos] != '<')
+        {
+            XMLReaderToken token = readText();
+            if (token != XML_READER_END)
+            {
+                return token;
+            }
+            continue;
+        }
+
+        if (startsWith("<?"))
+        {
+            if (!skipPast("?>"))
+            {
+                return fail("unterminated processing instruction");
+            }
+        }
+        else if (startsWith("<!--"))
+        {
+            if (!skipPast("-->"))
+            {
+                return fail("unterminated comment");
+            }
+        }
+        else if (startsWith("<![CDATA["))
+        {
+            if (!m_stack.size())
+            {
+                return fail("CDATA outside of the root element");
+            }
+
+            m_pos += 9;
+            m_text.chars = m_xml + m_pos;
+
+            if (!skipPast("]]>"))
+            {
+                return fail("unterminated CDATA section");
+            }
+
+            m_text.length = (m_xml + m_pos - 3) - m_text.chars;
+            m_textIsCData = true;
+            m_token       = XML_READER_TEXT;
+            return m_token;
+        }
+        else if (startsWith("<!"))
+        {
+            if (!skipDeclaration())
+            {
+                return fail("unterminated declaration");
+            }
+        }
+        else if (startsWith("</"))
+        {
+            return readElementEnd();
+        }
+        else
+        {
+            return readElementBegin();
+        }
+    }
+
+    if (m_stack.size())
+    {
+        return fail("unclosed element");
+    }
+
+    if (!m_rootDone)
+    {
+        return fail("no root element");
+    }
+
+    m_token = XML_READER_END;
+    return m_token;
+}
+
+
+XMLReaderToken XMLReader::readText()
+{
+    UTsize start = m_pos;
+    bool   blank = true;
+
+    while ((m_pos < m_length) && (m_xml[m_pos] != '<'))
+    {
+        if (!isWhitespace(m_xml[m_pos]))
+        {
+            blank = false;
+        }
+        m_pos++;
+    }
+
+    if (blank)
+    {
+        return XML_READER_END;
+    }
+
+    if (!m_stack.size())
+    {
+        m_pos = start;
+        return fail("text outside of the root element");
+    }
+
+    m_text.chars  = m_xml + start;
+    m_text.length = m_pos - start;
+    m_textIsCData = false;
+    m_token       = XML_READER_TEXT;
+    return m_token;
+}
+
+
+XMLReaderToken XMLReader::readElementBegin()
+{
+    if (m_rootDone)
+    {
+        return fail("more than one root element");
+    }
+
+    if (m_stack.size() >= MAX_DEPTH)
+    {
+        return fail("elements nested too deeply");
+    }
+
+    m_pos++;
+
+    Span name;
+    if (!readName(name))
+    {
+        return fail("expected an element name");
+    }
+
+    for ( ; ; )
+    {
+        skipWhitespace();
+
+        if (m_pos >= m_length)
+        {
+            return fail("unterminated element");
+        }
+
+        char c = m_xml[m_pos];
+
+        if (c == '>')
+        {
+            m_pos++;
+            break;
+        }
+
+        if (c == '/')
+        {
+            if ((m_pos + 1 >= m_length) || (m_xml[m_pos + 1] != '>'))
+            {
+                return fail("expected '>' after '/'");
+            }
+            m_pos       += 2;
+            m_pendingEnd = true;
+            break;
+        }
+
+        Attribute attribute;
+        if (!readName(attribute.name))
+        {
+            return fail("expected an attribute name");
+        }
+
+        skipWhitespace();
+        if ((m_pos >= m_length) || (m_xml[m_pos] != '='))
+        {
+            return fail("expected '=' after the attribute name");
+        }
+        m_pos++;
+
+        skipWhitespace();
+        char quote = m_pos < m_length ? m_xml[m_pos] : 0;
+        if ((quote != '"') && (quote != '\''))
+        {
+            return fail("expected a quoted attribute value");
+        }
+        m_pos++;
+
+        attribute.value.chars = m_xml + m_pos;
+        while ((m_pos < m_length) && (m_xml[m_pos] != quote))
+        {
+            m_pos++;
+        }
+
+        if (m_pos >= m_length)
+        {
+            return fail("unterminated attribute value");
+        }
+
+        attribute.value.length = (m_xml + m_pos) - attribute.value.chars;
+        m_pos++;
+
+        m_attributes.push_back(attribute);
+    }
+
+    m_stack.push_back(name);
+
+    m_name       = name.chars;
+    m_nameLength = name.length;
+    m_token      = XML_READER_ELEMENT_BEGIN;
+    return m_token;
+}
+
+
+XMLReaderToken XMLReader::readElementEnd()
+{
+    m_pos += 2;
+
+    Span name;
+    if (!readName(name))
+    {
+        return fail("expected an element name");
+    }
+
+    skipWhitespace();
+    if ((m_pos >= m_length) || (m_xml[m_pos] != '>'))
+    {
+        return fail("expected '>' after the element name");
+    }
+    m_pos++;
+
+    if (!m_stack.size())
+    {
+        return fail("end of an element that wasn't begun");
+    }
+
+    const Span& open = m_stack.back();
+    if ((open.length != name.length) || memcmp(open.chars, name.chars, name.length))
+    {
+        return fail("mismatched end of element");
+    }
+
+    m_stack.pop_back();
+    m_rootDone = !m_stack.size();
+
+    m_name       = name.chars;
+    m_nameLength = name.length;
+    m_token      = XML_READER_ELEMENT_END;
+    return m_token;
+}
+
+
+bool XMLReader::skip()
+{
+    if (m_token != XML_READER_ELEMENT_BEGIN)
+    {
+        return m_token != XML_READER_ERROR;
+    }
+
+    int depth = getDepth() - 1;
+
+    for ( ; ; )
+    {
+        XMLReaderToken token = next();
+
+        if ((token == XML_READER_ERROR) || (token == XML_READER_END))
+        {
+            return false;
+        }
+
+        if ((token == XML_READER_ELEMENT_END) && (getDepth() == depth))
+        {
+            return true;
+        }
+    }
+}
+
+
+bool XMLReader::nameEquals(const char *name) const
+{
+    return m_name && spanEquals(m_name, m_nameLength, name);
+}
+
+
+const char *XMLReader::getText(UTsize& length)
+{
+    if (m_token != XML_READER_TEXT)
+    {
+        length = 0;
+        return NULL;
+    }
+
+    if (m_textIsCData)
+    {
+        length = m_text.length;
+        return m_text.chars;
+    }
+
+    return decode(m_text, length);
+}
+
+
+const char *XMLReader::getAttributeName(UTsize index, UTsize& length) const
+{
+    if (index >= m_attributes.size())
+    {
+        length = 0;
+        return NULL;
+    }
+
+    length = m_attributes[index].name.length;
+    return m_attributes[index].name.chars;
+}
+
+
+const char *XMLReader::getAttributeValue(UTsize index, UTsize& length)
+{
+    if (index >= m_attributes.size())
+    {
+        length = 0;
+        return NULL;
+    }
+
+    return decode(m_attributes[index].value, length);
+}
+
+
+const char *XMLReader::findAttribute(const char *name, UTsize& length)
+{
+    for (UTsize i = 0; i < m_attributes.size(); i++)
+    {
+        const Span& attributeName = m_attributes[i].name;
+        if (spanEquals(attributeName.chars, attributeName.length, name))
+        {
+            return decode(m_attributes[i].value, length);
+        }
+    }
+
+    length = 0;
+    return NULL;
+}
+
+
+static void appendUTF8(utArray<char>& out, unsigned long codepoint)
+{
+    if (codepoint < 0x80)
+    {
+        out.push_back((char)codepoint);
+    }
+    else if (codepoint < 0x800)
+    {
+        out.push_back((char)(0xC0 | (codepoint >> 6)));
+        out.push_back((char)(0x80 | (codepoint & 0x3F)));
+    }
+    else if (codepoint < 0x10000)
+    {
+        out.push_back((char)(0xE0 | (codepoint >> 12)));
+        out.push_back((char)(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (codepoint & 0x3F)));
+    }
+    else
+    {
+        out.push_back((char)(0xF0 | (codepoint >> 18)));
+        out.push_back((char)(0x80 | ((codepoint >> 12) & 0x3F)));
+        out.push_back((char)(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (codepoint & 0x3F)));
+    }
+}
+
+
+const char *XMLReader::decode(const Span& span, UTsize& length)
+{
+    if (!memchr(span.chars, '&', span.length))
+    {
+        length = span.length;
+        return span.chars;
+    }
+
+    m_decoded.clear(true);
+
+    for (UTsize i = 0; i < span.length; i++)
+    {
+        char c = span.chars[i];
+
+        const char *semicolon = c == '&' ? (const char *)memchr(span.chars + i, ';', span.length - i) : NULL;
+        if (!semicolon)
+        {
+            m_decoded.push_back(c);
+            continue;
+        }
+
+        const char *entity      = span.chars + i + 1;
+        UTsize     entityLength = semicolon - entity;
+
+        if (spanEquals(entity, entityLength, "lt"))
+        {
+            m_decoded.push_back('<');
+        }
+        else if (spanEquals(entity, entityLength, "gt"))
+        {
+            m_decoded.push_back('>');
+        }
+        else if (spanEquals(entity, entityLength, "amp"))
+        {
+            m_decoded.push_back('&');
+        }
+        else if (spanEquals(entity, entityLength, "quot"))
+        {
+            m_decoded.push_back('"');
+        }
+        else if (spanEquals(entity, entityLength, "apos"))
+        {
+            m_decoded.push_back('\'');
+        }
+        else if ((entityLength > 1) && (entity[0] == '#'))
+        {
+            bool          hex       = (entity[1] == 'x') || (entity[1] == 'X');
+            unsigned long codepoint = 0;
+            UTsize        digits    = 0;
+
+            for (UTsize j = hex ? 2 : 1; j < entityLength; j++, digits++)
+            {
+                char d = entity[j];
+                int  value;
+
+                if ((d >= '0') && (d <= '9'))
+                {
+                    value = d - '0';
+                }
+                else if (hex && (d >= 'a') && (d <= 'f'))
+                {
+                    value = d - 'a' + 10;
+                }
+                else if (hex && (d >= 'A') && (d <= 'F'))
+                {
+                    value = d - 'A' + 10;
+                }
+                else
+                {
+                    digits = 0;
+                    break;
+                }
+
+                codepoint = codepoint * (hex ? 16 : 10) + value;
+                if (codepoint > 0x10FFFF)
+                {
+                    digits = 0;
+                    break;
+                }
+            }
+
+            if (!digits)
+            {
+                // not a character reference after all, keep it as is
+                m_decoded.push_back(c);
+                continue;
+            }
+
+            appendUTF8(m_decoded, codepoint);
+        }
+        else
+        {
+            // unknown entities are kept as they are
+            m_decoded.push_back(c);
+            continue;
+        }
+
+        i = semicolon - span.chars;
+    }
+
+    length = m_decoded.size();
+
+    // terminated so numbers can be read straight out of it
+    m_decoded.push_back(0);
+
+    return m_decoded.ptr();
+}
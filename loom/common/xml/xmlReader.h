@@ -0,0 +1,141 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _XML_XMLREADER_H_
+#define _XML_XMLREADER_H_
+
+#include "loom/common/utils/utTypes.h"
+
+/*
+ * Pull parser for XML held in memory, for documents like large TMX maps
+ * where building a tinyxml2 DOM (and wrapping every node for script) costs
+ * more than the data is worth. next() steps through the document one
+ * element or text run at a time:
+ *
+ *   XMLReader      reader(bytes, length);
+ *   XMLReaderToken token;
+ *   while ((token = reader.next()) > XML_READER_END)
+ *   {
+ *       if ((token == XML_READER_ELEMENT_BEGIN) && reader.nameEquals("tile"))
+ *       {
+ *           const char *gid = reader.findAttribute("gid", gidLength);
+ *           tiles.push_back(gid ? atoi(gid) : 0);
+ *       }
+ *   }
+ *   return token == XML_READER_END;
+ *
+ * The input is read in place: names, attributes and text are returned as
+ * spans of it, only those with entity references are decoded into a
+ * buffer. Declarations, comments and DOCTYPEs are skipped, so is text
+ * that is only whitespace. The input needn't be NUL terminated and has to
+ * outlive the reader.
+ */
+
+enum XMLReaderToken
+{
+    XML_READER_ERROR,
+    XML_READER_END,           // end of the document
+    XML_READER_ELEMENT_BEGIN, // getName, attributes; <a/> is followed by its end
+    XML_READER_ELEMENT_END,   // getName
+    XML_READER_TEXT           // getText, CDATA sections included
+};
+
+class XMLReader
+{
+public:
+    // Deeper documents are rejected, so recursive decoders stay bounded.
+    static const int MAX_DEPTH = 256;
+
+    XMLReader(const char *xml, UTsize length);
+
+    XMLReaderToken next();
+
+    // After an ELEMENT_BEGIN skips the rest of the element, up to and
+    // including its end; nothing otherwise. Returns false on a parse error.
+    bool skip();
+
+    // Name of the element just begun or ended, not NUL terminated.
+    const char *getName(UTsize& length) const { length = m_nameLength; return m_name; }
+    bool nameEquals(const char *name) const;
+
+    // The TEXT just read with entities decoded. Only valid until the next
+    // call to next() or a text or attribute getter, and not NUL terminated.
+    const char *getText(UTsize& length);
+
+    // Attributes of the element just begun, in document order. Values are
+    // decoded and only valid like getText; NULL for an index out of range
+    // or a missing name.
+    UTsize getAttributeCount() const { return m_attributes.size(); }
+    const char *getAttributeName(UTsize index, UTsize& length) const;
+    const char *getAttributeValue(UTsize index, UTsize& length);
+    const char *findAttribute(const char *name, UTsize& length);
+
+    // Elements currently open, counting one just begun.
+    int getDepth() const { return (int)m_stack.size(); }
+
+    // NULL unless next() returned XML_READER_ERROR.
+    const char *getError() const { return m_error; }
+    UTsize getErrorOffset() const { return m_errorOffset; }
+
+protected:
+    struct Span
+    {
+        const char *chars;
+        UTsize     length;
+    };
+
+    struct Attribute
+    {
+        Span name;
+        Span value;
+    };
+
+    XMLReaderToken fail(const char *error);
+    XMLReaderToken readElementBegin();
+    XMLReaderToken readElementEnd();
+    XMLReaderToken readText();
+    bool skipPast(const char *terminator);
+    bool skipDeclaration();
+    bool readName(Span& name);
+    bool startsWith(const char *prefix) const;
+    void skipWhitespace();
+    const char *decode(const Span& span, UTsize& length);
+
+    const char         *m_xml;
+    UTsize             m_length;
+    UTsize             m_pos;
+
+    XMLReaderToken     m_token;
+    bool               m_pendingEnd; // the element just begun was <a/>
+    bool               m_rootDone;
+    utArray<Span>      m_stack;      // names of the open elements
+
+    const char         *m_name;
+    UTsize             m_nameLength;
+    Span               m_text;
+    bool               m_textIsCData;
+    utArray<Attribute> m_attributes;
+    utArray<char>      m_decoded;
+
+    const char         *m_error;
+    UTsize             m_errorOffset;
+};
+
+#endif
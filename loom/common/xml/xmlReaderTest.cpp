@@ -0,0 +1,197 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <string.h>
+
+#include "loom/common/xml/xmlReader.h"
+#include "seatest.h"
+
+SEATEST_FIXTURE(xmlReader)
+{
+    SEATEST_FIXTURE_ENTRY(xmlReader_tokens);
+    SEATEST_FIXTURE_ENTRY(xmlReader_text);
+    SEATEST_FIXTURE_ENTRY(xmlReader_skip);
+    SEATEST_FIXTURE_ENTRY(xmlReader_errors);
+}
+
+static bool spanIs(const char *chars, UTsize length, const char *expected)
+{
+    return chars && (length == strlen(expected)) && !memcmp(chars, expected, length);
+}
+
+static bool attributeIs(XMLReader& reader, const char *name, const char *expected)
+{
+    UTsize     length;
+    const char *value = reader.findAttribute(name, length);
+
+    return spanIs(value, length, expected);
+}
+
+static bool textIs(XMLReader& reader, const char *expected)
+{
+    UTsize     length;
+    const char *text = reader.getText(length);
+
+    return spanIs(text, length, expected);
+}
+
+SEATEST_TEST(xmlReader_tokens)
+{
+    // Not NUL terminated, the reader has to stop at the length.
+    const char xml[] = "<?xml version=\"1.0\"?>\n<!-- map -->\n<map width='10' height=\"5\">\n"
+                       "  <layer name=\"ground\"/>\n  <layer name=\"sky\"></layer>\n</map>xx";
+
+    XMLReader reader(xml, sizeof(xml) - 3);
+    UTsize    length;
+
+    assert_int_equal(XML_READER_ELEMENT_BEGIN, reader.next());
+    assert_true(reader.nameEquals("map"));
+    assert_int_equal(1, reader.getDepth());
+    assert_int_equal(2, (int)reader.getAttributeCount());
+    const char *name  = reader.getAttributeName(0, length);
+    assert_true(spanIs(name, length, "width"));
+    const char *value = reader.getAttributeValue(0, length);
+    assert_true(spanIs(value, length, "10"));
+    assert_true(attributeIs(reader, "height", "5"));
+    assert_true(reader.findAttribute("depth", length) == NULL);
+
+    // Values without entities point into the input.
+    assert_true(reader.findAttribute("width", length) == strstr(xml, "10"));
+
+    // <layer/> begins and ends.
+    assert_int_equal(XML_READER_ELEMENT_BEGIN, reader.next());
+    assert_true(reader.nameEquals("layer"));
+    assert_true(attributeIs(reader, "name", "ground"));
+    assert_int_equal(2, reader.getDepth());
+    assert_int_equal(XML_READER_ELEMENT_END, reader.next());
+    assert_true(reader.nameEquals("layer"));
+    assert_int_equal(0, (int)reader.getAttributeCount());
+    assert_int_equal(1, reader.getDepth());
+
+    assert_int_equal(XML_READER_ELEMENT_BEGIN, reader.next());
+    assert_true(attributeIs(reader, "name", "sky"));
+    assert_int_equal(XML_READER_ELEMENT_END, reader.next());
+    assert_int_equal(XML_READER_ELEMENT_END, reader.next());
+    assert_true(reader.nameEquals("map"));
+    assert_int_equal(0, reader.getDepth());
+
+    assert_int_equal(XML_READER_END, reader.next());
+    assert_true(reader.getError() == NULL);
+}
+
+SEATEST_TEST(xmlReader_text)
+{
+    const char xml[] = "<doc a=\"1 &lt; 2 &amp;&amp; &#x41;&#66;\">plain<b>x &gt; y &unknown; &#;</b>"
+                       "<![CDATA[<raw> &amp;]]>\xC3\xA9&#xe9;&#x1F600;</doc>";
+
+    XMLReader reader(xml, sizeof(xml) - 1);
+    UTsize    length;
+
+    assert_int_equal(XML_READER_ELEMENT_BEGIN, reader.next());
+    assert_true(attributeIs(reader, "a", "1 < 2 && AB"));
+
+    assert_int_equal(XML_READER_TEXT, reader.next());
+    assert_true(reader.getText(length) == strstr(xml, "plain"));
+    assert_true(textIs(reader, "plain"));
+
+    assert_int_equal(XML_READER_ELEMENT_BEGIN, reader.next());
+    assert_int_equal(XML_READER_TEXT, reader.next());
+    assert_true(textIs(reader, "x > y &unknown; &#;"));
+    assert_int_equal(XML_READER_ELEMENT_END, reader.next());
+
+    // CDATA is not decoded.
+    assert_int_equal(XML_READER_TEXT, reader.next());
+    assert_true(textIs(reader, "<raw> &amp;"));
+
+    assert_int_equal(XML_READER_TEXT, reader.next());
+    assert_true(textIs(reader, "\xC3\xA9\xC3\xA9\xF0\x9F\x98\x80"));
+
+    assert_int_equal(XML_READER_ELEMENT_END, reader.next());
+    assert_int_equal(XML_READER_END, reader.next());
+}
+
+SEATEST_TEST(xmlReader_skip)
+{
+    const char xml[] = "<root><skipped><a><b/>text</a></skipped><kept value=\"7\"/></root>";
+
+    XMLReader reader(xml, sizeof(xml) - 1);
+    UTsize    length;
+
+    assert_int_equal(XML_READER_ELEMENT_BEGIN, reader.next());
+
+    const char     *kept = NULL;
+    XMLReaderToken token;
+    while ((token = reader.next()) == XML_READER_ELEMENT_BEGIN)
+    {
+        if (reader.nameEquals("kept"))
+        {
+            kept = reader.findAttribute("value", length);
+        }
+
+        assert_true(reader.skip());
+    }
+
+    assert_true(spanIs(kept, length, "7"));
+    assert_int_equal(XML_READER_ELEMENT_END, token);
+    assert_int_equal(0, reader.getDepth());
+    assert_int_equal(XML_READER_END, reader.next());
+}
+
+static bool fails(const char *xml)
+{
+    XMLReader reader(xml, (UTsize)strlen(xml));
+
+    XMLReaderToken token;
+    while ((token = reader.next()) != XML_READER_END)
+    {
+        if (token == XML_READER_ERROR)
+        {
+            return reader.getError() != NULL;
+        }
+    }
+
+    return false;
+}
+
+SEATEST_TEST(xmlReader_errors)
+{
+    assert_true(fails(""));
+    assert_true(fails("  <!-- nothing -->  "));
+    assert_true(fails("<a>"));
+    assert_true(fails("<a></b>"));
+    assert_true(fails("<a></a><b/>"));
+    assert_true(fails("text<a/>"));
+    assert_true(fails("<a b></a>"));
+    assert_true(fails("<a b=c></a>"));
+    assert_true(fails("<a b=\"c></a>"));
+    assert_true(fails("<a><!-- open</a>"));
+    assert_true(fails("<a/ >"));
+    assert_true(fails("</a>"));
+    assert_true(fails("<!DOCTYPE a [<!ENTITY x \"<y>\">]><a/>") == false);
+
+    // Nesting is bounded.
+    char deep[3 * (XMLReader::MAX_DEPTH + 1) + 1];
+    for (int i = 0; i <= XMLReader::MAX_DEPTH; i++)
+    {
+        memcpy(deep + 3 * i, "<a>", 3);
+    }
+    deep[sizeof(deep) - 1] = 0;
+    assert_true(fails(deep));
+}
@@ -0,0 +1,33 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/common/core/benchmark.h"
+
+// Define all the benchmarks to run, see tools/nativebenchmark.
+BENCHMARK_SUITE(allBenchmarks)
+{
+    BENCHMARK_SUITE_ENTRY(allocatorSystem);
+    BENCHMARK_SUITE_ENTRY(stringTable);
+    BENCHMARK_SUITE_ENTRY(utHashTable);
+    BENCHMARK_SUITE_ENTRY(utArray);
+    BENCHMARK_SUITE_ENTRY(utByteArray);
+    BENCHMARK_SUITE_ENTRY(quadRenderer);
+    BENCHMARK_SUITE_ENTRY(bitmapData);
+}
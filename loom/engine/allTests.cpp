@@ -36,4 +36,22 @@ SEATEST_SUITE(allTests)
     SEATEST_SUITE_ENTRY(logging);
     SEATEST_SUITE_ENTRY(assets);
     SEATEST_SUITE_ENTRY(lmAutoPtr);
+    SEATEST_SUITE_ENTRY(utFlatHashTable);
+    SEATEST_SUITE_ENTRY(utString);
+    SEATEST_SUITE_ENTRY(utByteArray);
+    SEATEST_SUITE_ENTRY(utCompressionStream);
+    SEATEST_SUITE_ENTRY(utStreams);
+    SEATEST_SUITE_ENTRY(jsonReader);
+    SEATEST_SUITE_ENTRY(xmlReader);
+    SEATEST_SUITE_ENTRY(utMessagePack);
+    SEATEST_SUITE_ENTRY(utHash);
+    SEATEST_SUITE_ENTRY(platformHTTPCache);
+    SEATEST_SUITE_ENTRY(platformJobs);
+    SEATEST_SUITE_ENTRY(platformWebSocket);
+    SEATEST_SUITE_ENTRY(framePacer);
+    SEATEST_SUITE_ENTRY(touchCoalescer);
+    SEATEST_SUITE_ENTRY(platformFileAsync);
+    SEATEST_SUITE_ENTRY(bitmapData);
+    SEATEST_SUITE_ENTRY(imageResize);
+    SEATEST_SUITE_ENTRY(l2dMatrix);
 }
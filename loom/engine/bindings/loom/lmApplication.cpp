@@ -25,6 +25,7 @@
 using namespace LS;
 
 #include "loom/common/core/log.h"
+#include "loom/common/core/telemetry.h"
 #include "loom/common/assets/assetsScript.h"
 #include "loom/common/platform/platformNetwork.h"
 #include "loom/common/platform/platformWebView.h"
@@ -37,6 +38,10 @@ using namespace LS;
 
 #include "loom/common/platform/platform.h"
 #include "loom/common/platform/platformHttp.h"
+#include "loom/common/platform/platformHTTPCache.h"
+#include "loom/common/platform/platformJobs.h"
+#include "loom/common/platform/platformFile.h"
+#include "loom/common/platform/platformFileAsync.h"
 #include "loom/common/platform/platformAdMob.h"
 
 #include "loom/common/config/applicationConfig.h"
@@ -48,6 +53,7 @@ using namespace LS;
 
 #include "loom/engine/bindings/sdl/lmSDL.h"
 #include "loom/engine/bindings/loom/lmGameController.h"
+#include "loom/engine/bindings/loom/lmUserDefault.h"
 
 LSLuaState     *LoomApplication::rootVM = NULL;
 utByteArray    *LoomApplication::initBytes = NULL;
@@ -59,8 +65,10 @@ NativeDelegate LoomApplication::ticks;
 NativeDelegate LoomApplication::assetCommandDelegate;
 NativeDelegate LoomApplication::applicationActivated;
 NativeDelegate LoomApplication::applicationDeactivated;
+FramePacer     LoomApplication::framePacer;
 
 static bool initialAssetSystemLoaded = false;
+static JobCounter startupJobs;
 static int lastCameraRequestTimestamp = 0;
 
 // Ignore the camera requests for a 100ms after it's been triggered
@@ -78,14 +86,22 @@ extern atomic_int_t gLoomPaused;
 
 void loom_appInit(void)
 {
+    Telemetry::beginStartupPhase("startup");
     LoomApplication::initMainAssembly();
+    LoomApplication::beginStartupTasks();
 }
 
 
 void loom_appSetup(void)
 {
     LoomApplication::initializeCoreServices();
-    GFX::Graphics::initialize();
+
+    {
+        LOOM_STARTUP_PHASE(graphics);
+        GFX::Graphics::initialize();
+    }
+
+    Telemetry::endStartupPhase("startup");
 }
 
 void loom_appPause(void)
@@ -126,6 +142,9 @@ void loom_appResume(void)
     if (ticking != 1) return;
     GFX::Graphics::resume();
 
+    // Time the first frame back afresh instead of as one long frame
+    LoomApplication::framePacer.reset();
+
     platform_webViewResumeAll();
 
     lmLogInfo(applicationLogGroup, "Resumed");
@@ -139,6 +158,10 @@ void loom_appShutdown(void)
 #ifdef WIN32
     LS::Process::cleanupConsole();
 #endif
+
+    // Deliver any queued or recorded log output.
+    loom_log_setBinary(0);
+    loom_log_setAsync(0);
 }
 
 extern void loomsound_reset();
@@ -179,6 +202,24 @@ void handleAssert()
 }
 }
 
+static void startupSoundJob(void *param)
+{
+    LOOM_STARTUP_PHASE(sound);
+    loomsound_init();
+}
+
+static void startupHTTPCacheJob(void *param)
+{
+    LOOM_STARTUP_PHASE(httpCache);
+
+    // Only the curl backend consults the cache, the mobile and OS X ones
+    // have the system's.
+    utString httpCachePath = platform_getSettingsPath(LoomApplicationConfig::applicationId().c_str());
+    httpCachePath += platform_getFolderDelimiter();
+    httpCachePath += "httpcache";
+    platform_HTTPCacheInit(httpCachePath.c_str(), (long long)LoomApplicationConfig::httpCacheSize() * 1024 * 1024);
+}
+
 int LoomApplication::initializeTypes()
 {
     void installPackageSystem();
@@ -207,6 +248,8 @@ static void dispatchCommand(const char *cmd);
 
 void LoomApplication::initMainAssembly()
 {
+    LOOM_STARTUP_PHASE(assemblyHeader);
+
     lmAssert(!rootVM, "VM already running");
     rootVM = lmNew(NULL) LSLuaState();
 
@@ -222,14 +265,50 @@ void LoomApplication::initMainAssembly()
     Loom2D::Stage::initFromConfig();
 }
 
+/*
+ * Starts the startup work that needs neither the main thread, the GL context
+ * nor the script VM on the job system, so it overlaps with the platform layer
+ * creating the window and context and with reading the main assembly body.
+ * execMainAssembly waits for it before running any script. The config has
+ * been read from the assembly header by now.
+ */
+void LoomApplication::beginStartupTasks()
+{
+    // The main thread renders, threads started without a hint inherit this.
+    loom_thread_setHint(LOOM_THREAD_LATENCY_CRITICAL);
+
+    lmLogDebug(applicationLogGroup, "   o jobs");
+    loom_jobs_initialize(-1);
+
+    lmLogDebug(applicationLogGroup, "   o sound");
+    loom_job_submit(startupSoundJob, NULL, &startupJobs, NULL, LOOM_JOB_BACKGROUND);
+
+#if LOOM_PLATFORM == LOOM_PLATFORM_WIN32 || LOOM_PLATFORM == LOOM_PLATFORM_LINUX
+    lmLogDebug(applicationLogGroup, "   o http cache");
+    loom_job_submit(startupHTTPCacheJob, NULL, &startupJobs, NULL, LOOM_JOB_BACKGROUND);
+#endif
+}
+
 void LoomApplication::execMainAssembly()
 {
-    rootVM->open();
+    Assembly *mainAssembly;
+
+    {
+        LOOM_STARTUP_PHASE(assemblyBody);
+
+        rootVM->open();
+
+        // Read the rest of the assembly - the body
+        mainAssembly = rootVM->readExecutableAssemblyBinaryBody();
+        rootVM->closeExecutableAssembly(bootAssembly, initBytes);
+        initBytes = NULL;
+    }
 
-    // Read the rest of the assembly - the body
-    Assembly *mainAssembly = rootVM->readExecutableAssemblyBinaryBody();
-    rootVM->closeExecutableAssembly(bootAssembly, initBytes);
-    initBytes = NULL;
+    // Scripts may play sounds and make requests right away
+    {
+        LOOM_STARTUP_PHASE(startupJobs);
+        loom_jobs_wait(&startupJobs);
+    }
     
     lmLogDebug(applicationLogGroup, "   o executing %s", bootAssembly.c_str());
 
@@ -405,6 +484,8 @@ void LoomApplication::ensureInitialAssetSystem()
 
 int LoomApplication::initializeCoreServices()
 {
+    LOOM_STARTUP_PHASE(coreServices);
+
     // Mark the main thread for NativeDelegates.
     NativeDelegate::markMainThread();
 
@@ -433,10 +514,6 @@ int LoomApplication::initializeCoreServices()
     lmLogDebug(applicationLogGroup, "   o http");
     platform_HTTPInit();
 
-
-    lmLogDebug(applicationLogGroup, "   o sound");
-    loomsound_init();
-
     LoomGameController::init();
 
     // Initialize script hooks.
@@ -463,9 +540,16 @@ void LoomApplication::shutdown()
     LoomGameController::shutdown();
 
     platform_HTTPCleanup();
+    platform_HTTPCacheShutdown();
+
+    // Let the file writes in flight land before the workers go.
+    UserDefault::sharedUserDefault()->flush();
+    platform_fileAsyncWait(NULL);
 
     // Shut down application subsystems.
     loom_asset_shutdown();
+
+    loom_jobs_shutdown();
 } 
 
 
@@ -603,6 +687,9 @@ int registerLoomApplication(lua_State *L)
        .addStaticProperty("ticks", &LoomApplication::getTicksDelegate)
 
        .addStaticProperty("event", &LoomApplication::getEventDelegate)
+       .addStaticProperty("frameTime", &LoomApplication::getFrameTime)
+       .addStaticProperty("frameDelta", &LoomApplication::getFrameDelta)
+       .addStaticProperty("refreshRate", &LoomApplication::getRefreshRate)
        .addStaticMethod("fireGenericEvent", &LoomApplication::fireGenericEvent)
 
        .addStaticProperty("loomConfigJSON", &LoomApplicationConfig::getApplicationConfigJSON)
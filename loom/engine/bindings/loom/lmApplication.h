@@ -29,6 +29,7 @@
 #include "loom/common/platform/platformDisplay.h"
 #include "loom/common/platform/platformTime.h"
 #include "loom/common/platform/platformIO.h"
+#include "loom/common/core/framePacer.h"
 #include "loom/script/loomscript.h"
 #include "loom/script/native/lsNativeDelegate.h"
 
@@ -65,6 +66,10 @@ public:
     static NativeDelegate applicationActivated;
     static NativeDelegate event;
 
+    // Paces frame timing to the display refresh, fed by the stage as it
+    // presents
+    static FramePacer framePacer;
+
     static const NativeDelegate *getAssetCommandDelegate()
     {
         return &assetCommandDelegate;
@@ -90,6 +95,21 @@ public:
         return &event;
     }
 
+    static double getFrameTime()
+    {
+        return framePacer.getFrameTime();
+    }
+
+    static double getFrameDelta()
+    {
+        return framePacer.getFrameDelta();
+    }
+
+    static double getRefreshRate()
+    {
+        return framePacer.getRefreshRate();
+    }
+
     static void fireGenericEvent(const char *type, const char *payload);
     static void listenForGenericEvents(LoomGenericEventCallback cb, void *userData);
 
@@ -114,6 +134,7 @@ public:
     static int initialize();
     static void shutdown();
     static void initMainAssembly();
+    static void beginStartupTasks();
     static void execMainAssembly();
     static void reloadMainAssembly();
     static void _reloadMainAssembly();
@@ -20,11 +20,16 @@
 
 #include "loom/common/platform/platformTime.h"
 #include "loom/common/platform/platformHttp.h"
+#include "loom/common/platform/platformNetwork.h"
+#include "loom/common/platform/platformWebSocket.h"
 #include "loom/common/platform/platformThread.h"
+#include "loom/common/platform/platformJobs.h"
 #include "loom/common/core/performance.h"
 #include "loom/common/assets/assets.h"
 #include "loom/script/native/lsNativeDelegate.h"
+#include "loom/script/runtime/lsWorker.h"
 #include "lmApplication.h"
+#include "lmUserDefault.h"
 #include "loom/common/config/applicationConfig.h"
 #include "loom/engine/loom2d/l2dStage.h"
 #include "loom/graphics/gfxTexture.h"
@@ -35,6 +40,8 @@ lmDefineLogGroup(gTickLogGroup, "tick", true, LoomLogInfo)
 extern "C"
 {
 
+void loomsound_tick();
+
 atomic_int_t gLoomTicking = 1;
 atomic_int_t gLoomPaused = 0;
 
@@ -46,6 +53,9 @@ void loom_tick()
         // Signal that the app has really stopped execution
         if (atomic_load32(&gLoomPaused) == 0)
         {
+            // The process may not come back from here.
+            UserDefault::sharedUserDefault()->flush();
+
             atomic_store32(&gLoomPaused, 1);
         }
 
@@ -71,6 +81,7 @@ void loom_tick()
     // may change so we remark every frame.
     NativeDelegate::markMainThread();
     if (vm) NativeDelegate::executeDeferredCalls(vm->VM());
+    if (vm) Worker::dispatchMessages();
 
     performance_tick();
 
@@ -92,13 +103,23 @@ void loom_tick()
                 vm->invokeStaticMethod("system.debugger.DebuggerClient", "update");
             }
 
+            lualoom_updatecoroutines(vm->VM());
+
             LoomApplication::ticks.invoke();
         }
     }
     
     loom_asset_pump();
+
+    loomsound_tick();
     
     platform_HTTPUpdate();
+    platform_webSocketUpdate();
+    UserDefault::update();
+
+    loom_net_pollSockets(0);
+
+    loom_jobs_pumpMainThread();
     
     GFX::Texture::tick();
     
@@ -59,6 +59,8 @@
 #include "loom/common/core/log.h"
 #include "loom/script/loomscript.h"
 #include "loom/script/native/lsNativeDelegate.h"
+#include "loom/engine/loom2d/l2dBodySync.h"
+#include "loom/engine/loom2d/l2dPhysicsStepper.h"
 #include "loom/vendor/box2d/Box2D.h"
 #include <map>
 
@@ -287,6 +289,359 @@ void b2ShapeCache::addShapesWithFile(const std::string &plist, b2Vec2 vertexScal
 
 #endif
 
+/**
+ * Records what the contact listener hears during World::Step, so script
+ * goes over it in one pass after the step instead of being called into
+ * from the middle of the solver.
+ *
+ * Records point at fixtures, they are valid until the next step or until
+ * a fixture of theirs is destroyed.
+ */
+class ContactBuffer : public b2ContactListener
+{
+public:
+
+    enum RecordType
+    {
+        BEGIN   = 0,
+        END     = 1,
+        IMPULSE = 2
+    };
+
+    // PostSolve is called for every touching contact every step, only
+    // recorded when asked for and at or above the threshold
+    bool    recordImpulses;
+    float32 impulseThreshold;
+
+    ContactBuffer()
+    {
+        recordImpulses   = false;
+        impulseThreshold = 0.0f;
+    }
+
+    // Steps the world with this listening, the world's own listener is
+    // put back afterwards
+    void step(b2World *world, float32 timeStep, int velocityIterations, int positionIterations)
+    {
+        records.clear();
+
+        if (!world)
+        {
+            return;
+        }
+
+        b2ContactListener *previous = world->GetContactManager().m_contactListener;
+        world->SetContactListener(this);
+        world->Step(timeStep, velocityIterations, positionIterations);
+        world->SetContactListener(previous);
+    }
+
+    void clear()
+    {
+        records.clear();
+    }
+
+    int getNumRecords() const
+    {
+        return (int)records.size();
+    }
+
+    int getType(int index)
+    {
+        return isValid(index) ? records[index].type : -1;
+    }
+
+    b2Fixture *getFixtureA(int index)
+    {
+        return isValid(index) ? records[index].fixtureA : NULL;
+    }
+
+    b2Fixture *getFixtureB(int index)
+    {
+        return isValid(index) ? records[index].fixtureB : NULL;
+    }
+
+    b2Body *getBodyA(int index)
+    {
+        return isValid(index) ? records[index].fixtureA->GetBody() : NULL;
+    }
+
+    b2Body *getBodyB(int index)
+    {
+        return isValid(index) ? records[index].fixtureB->GetBody() : NULL;
+    }
+
+    // World normal from A to B, zero for END records
+    b2Vec2 getNormal(int index)
+    {
+        return isValid(index) ? records[index].normal : b2Vec2_zero;
+    }
+
+    // Largest of the normal impulses of the contact points, IMPULSE only
+    float32 getNormalImpulse(int index)
+    {
+        return isValid(index) ? records[index].normalImpulse : 0.0f;
+    }
+
+    float32 getTangentImpulse(int index)
+    {
+        return isValid(index) ? records[index].tangentImpulse : 0.0f;
+    }
+
+    void BeginContact(b2Contact *contact)
+    {
+        addRecord(BEGIN, contact);
+    }
+
+    void EndContact(b2Contact *contact)
+    {
+        Record& record = addRecord(END, contact);
+
+        record.normal = b2Vec2_zero;
+    }
+
+    void PostSolve(b2Contact *contact, const b2ContactImpulse *impulse)
+    {
+        if (!recordImpulses)
+        {
+            return;
+        }
+
+        float32 normalImpulse  = 0.0f;
+        float32 tangentImpulse = 0.0f;
+        for (int32 i = 0; i < impulse->count; i++)
+        {
+            normalImpulse = b2Max(normalImpulse, impulse->normalImpulses[i]);
+            if (b2Abs(impulse->tangentImpulses[i]) > b2Abs(tangentImpulse))
+            {
+                tangentImpulse = impulse->tangentImpulses[i];
+            }
+        }
+
+        if (normalImpulse < impulseThreshold)
+        {
+            return;
+        }
+
+        Record& record = addRecord(IMPULSE, contact);
+        record.normalImpulse  = normalImpulse;
+        record.tangentImpulse = tangentImpulse;
+    }
+
+private:
+
+    struct Record
+    {
+        int       type;
+        b2Fixture *fixtureA;
+        b2Fixture *fixtureB;
+        b2Vec2    normal;
+        float32   normalImpulse;
+        float32   tangentImpulse;
+    };
+
+    inline bool isValid(int index)
+    {
+        return index >= 0 && index < (int)records.size();
+    }
+
+    Record& addRecord(int type, b2Contact *contact)
+    {
+        b2WorldManifold manifold;
+
+        contact->GetWorldManifold(&manifold);
+
+        Record record;
+        record.type           = type;
+        record.fixtureA       = contact->GetFixtureA();
+        record.fixtureB       = contact->GetFixtureB();
+        record.normal         = manifold.normal;
+        record.normalImpulse  = 0.0f;
+        record.tangentImpulse = 0.0f;
+        records.push_back(record);
+
+        return records.back();
+    }
+
+    utArray<Record> records;
+};
+
+/**
+ * Runs AABB, point and ray queries against a world and keeps all of the
+ * hits, script reads them afterwards instead of taking a callback per
+ * fixture.
+ */
+class QueryBuffer : public b2QueryCallback, public b2RayCastCallback
+{
+public:
+
+    // Stops a query after this many hits, 0 for no limit
+    int maxHits;
+
+    QueryBuffer()
+    {
+        maxHits = 0;
+        testPoint = false;
+        closest   = false;
+    }
+
+    // Fixtures whose AABB overlaps lower to upper
+    int queryAABB(b2World *world, const b2Vec2& lower, const b2Vec2& upper)
+    {
+        return runQuery(world, lower, upper, false);
+    }
+
+    // Fixtures containing point
+    int queryPoint(b2World *world, const b2Vec2& point)
+    {
+        queryPointValue = point;
+
+        b2Vec2 epsilon(b2_linearSlop, b2_linearSlop);
+        return runQuery(world, point - epsilon, point + epsilon, true);
+    }
+
+    // Fixtures along the ray from point1 to point2, nearest first, or
+    // only the nearest one when closestOnly
+    int rayCast(b2World *world, const b2Vec2& point1, const b2Vec2& point2, bool closestOnly)
+    {
+        hits.clear();
+
+        if (!world || point1 == point2)
+        {
+            return 0;
+        }
+
+        closest = closestOnly;
+        world->RayCast(this, point1, point2);
+
+        // Box2D reports in no particular order.
+        hits.sort(isFarther);
+
+        return (int)hits.size();
+    }
+
+    void clear()
+    {
+        hits.clear();
+    }
+
+    int getNumHits() const
+    {
+        return (int)hits.size();
+    }
+
+    b2Fixture *getFixture(int index)
+    {
+        return isValid(index) ? hits[index].fixture : NULL;
+    }
+
+    b2Body *getBody(int index)
+    {
+        return isValid(index) ? hits[index].fixture->GetBody() : NULL;
+    }
+
+    // Where the ray hit, rays only
+    b2Vec2 getPoint(int index)
+    {
+        return isValid(index) ? hits[index].point : b2Vec2_zero;
+    }
+
+    b2Vec2 getNormal(int index)
+    {
+        return isValid(index) ? hits[index].normal : b2Vec2_zero;
+    }
+
+    float32 getFraction(int index)
+    {
+        return isValid(index) ? hits[index].fraction : 0.0f;
+    }
+
+    bool ReportFixture(b2Fixture *fixture)
+    {
+        if (testPoint && !fixture->TestPoint(queryPointValue))
+        {
+            return true;
+        }
+
+        addHit(fixture, b2Vec2_zero, b2Vec2_zero, 0.0f);
+
+        return maxHits <= 0 || (int)hits.size() < maxHits;
+    }
+
+    float32 ReportFixture(b2Fixture *fixture, const b2Vec2& point, const b2Vec2& normal, float32 fraction)
+    {
+        if (closest)
+        {
+            // Clip the ray to this hit, only nearer ones are reported
+            // from here on.
+            hits.clear();
+            addHit(fixture, point, normal, fraction);
+            return fraction;
+        }
+
+        addHit(fixture, point, normal, fraction);
+
+        return maxHits <= 0 || (int)hits.size() < maxHits ? 1.0f : 0.0f;
+    }
+
+private:
+
+    struct Hit
+    {
+        b2Fixture *fixture;
+        b2Vec2    point;
+        b2Vec2    normal;
+        float32   fraction;
+    };
+
+    bool   testPoint;
+    bool   closest;
+    b2Vec2 queryPointValue;
+
+    utArray<Hit> hits;
+
+    inline bool isValid(int index)
+    {
+        return index >= 0 && index < (int)hits.size();
+    }
+
+    int runQuery(b2World *world, const b2Vec2& lower, const b2Vec2& upper, bool point)
+    {
+        hits.clear();
+
+        if (!world)
+        {
+            return 0;
+        }
+
+        b2AABB aabb;
+        aabb.lowerBound = b2Min(lower, upper);
+        aabb.upperBound = b2Max(lower, upper);
+
+        testPoint = point;
+        world->QueryAABB(this, aabb);
+        testPoint = false;
+
+        return (int)hits.size();
+    }
+
+    void addHit(b2Fixture *fixture, const b2Vec2& point, const b2Vec2& normal, float32 fraction)
+    {
+        Hit hit;
+        hit.fixture  = fixture;
+        hit.point    = point;
+        hit.normal   = normal;
+        hit.fraction = fraction;
+        hits.push_back(hit);
+    }
+
+    // utArray::sort swaps neighbours this is true for
+    static bool isFarther(const Hit& a, const Hit& b)
+    {
+        return a.fraction > b.fraction;
+    }
+};
+
 static int registerLoomBox2D(lua_State *L)
 {
     beginPackage(L, "loom.box2d")
@@ -579,6 +934,93 @@ static int registerLoomBox2D(lua_State *L)
             .addMethod("dump", &b2World::Dump)
 
         .endClass()
+
+        .beginClass<ContactBuffer>("ContactBuffer")
+
+            .addConstructor<void (*)(void)>()
+
+            .addVar("recordImpulses", &ContactBuffer::recordImpulses)
+            .addVar("impulseThreshold", &ContactBuffer::impulseThreshold)
+
+            .addMethod("step", &ContactBuffer::step)
+            .addMethod("clear", &ContactBuffer::clear)
+            .addMethod("getType", &ContactBuffer::getType)
+            .addMethod("getFixtureA", &ContactBuffer::getFixtureA)
+            .addMethod("getFixtureB", &ContactBuffer::getFixtureB)
+            .addMethod("getBodyA", &ContactBuffer::getBodyA)
+            .addMethod("getBodyB", &ContactBuffer::getBodyB)
+            .addMethod("getNormal", &ContactBuffer::getNormal)
+            .addMethod("getNormalImpulse", &ContactBuffer::getNormalImpulse)
+            .addMethod("getTangentImpulse", &ContactBuffer::getTangentImpulse)
+
+            .addProperty("numRecords", &ContactBuffer::getNumRecords)
+
+        .endClass()
+
+        .beginClass<QueryBuffer>("QueryBuffer")
+
+            .addConstructor<void (*)(void)>()
+
+            .addVar("maxHits", &QueryBuffer::maxHits)
+
+            .addMethod("queryAABB", &QueryBuffer::queryAABB)
+            .addMethod("queryPoint", &QueryBuffer::queryPoint)
+            .addMethod("rayCast", &QueryBuffer::rayCast)
+            .addMethod("clear", &QueryBuffer::clear)
+            .addMethod("getFixture", &QueryBuffer::getFixture)
+            .addMethod("getBody", &QueryBuffer::getBody)
+            .addMethod("getPoint", &QueryBuffer::getPoint)
+            .addMethod("getNormal", &QueryBuffer::getNormal)
+            .addMethod("getFraction", &QueryBuffer::getFraction)
+
+            .addProperty("numHits", &QueryBuffer::getNumHits)
+
+        .endClass()
+
+        .beginClass<Loom2D::BodySync>("BodySync")
+
+            .addConstructor<void (*)(void)>()
+
+            .addVar("pixelsPerMeter", &Loom2D::BodySync::pixelsPerMeter)
+
+            .addMethod("link", &Loom2D::BodySync::link)
+            .addMethod("unlink", &Loom2D::BodySync::unlink)
+            .addMethod("unlinkTarget", &Loom2D::BodySync::unlinkTarget)
+            .addMethod("isLinked", &Loom2D::BodySync::isLinked)
+            .addMethod("purge", &Loom2D::BodySync::purge)
+            .addMethod("sync", &Loom2D::BodySync::sync)
+            .addMethod("savePrevious", &Loom2D::BodySync::savePrevious)
+            .addMethod("syncInterpolated", &Loom2D::BodySync::syncInterpolated)
+            .addMethod("step", &Loom2D::BodySync::step)
+
+            .addProperty("numLinks", &Loom2D::BodySync::getNumLinks)
+
+        .endClass()
+
+        .beginClass<Loom2D::PhysicsStepper>("PhysicsStepper")
+
+            .addConstructor<void (*)(void)>()
+
+            .addVarAccessor("onStep", &Loom2D::PhysicsStepper::getStepDelegate)
+
+            .addVar("timeStep", &Loom2D::PhysicsStepper::timeStep)
+            .addVar("maxSteps", &Loom2D::PhysicsStepper::maxSteps)
+            .addVar("velocityIterations", &Loom2D::PhysicsStepper::velocityIterations)
+            .addVar("positionIterations", &Loom2D::PhysicsStepper::positionIterations)
+            .addVar("interpolate", &Loom2D::PhysicsStepper::interpolate)
+
+            .addProperty("alpha", &Loom2D::PhysicsStepper::getAlpha)
+            .addProperty("numSteps", &Loom2D::PhysicsStepper::getNumSteps)
+            .addProperty("droppedTime", &Loom2D::PhysicsStepper::getDroppedTime)
+
+            .addMethod("getWorld", &Loom2D::PhysicsStepper::getWorld)
+            .addMethod("setWorld", &Loom2D::PhysicsStepper::setWorld)
+            .addMethod("getSync", &Loom2D::PhysicsStepper::getSync)
+            .addMethod("setSync", &Loom2D::PhysicsStepper::setSync)
+            .addMethod("reset", &Loom2D::PhysicsStepper::reset)
+            .addMethod("_advanceTime", &Loom2D::PhysicsStepper::advanceTime)
+
+        .endClass()
     
 /*        .beginClass<b2ShapeCache>("ShapeCache")
 
@@ -613,5 +1055,9 @@ void installLoomBox2D()
     LOOM_DECLARE_MANAGEDNATIVETYPE(b2Body, registerLoomBox2D);
     LOOM_DECLARE_MANAGEDNATIVETYPE(b2Joint, registerLoomBox2D);
     LOOM_DECLARE_MANAGEDNATIVETYPE(b2World, registerLoomBox2D);
+    LOOM_DECLARE_MANAGEDNATIVETYPE(ContactBuffer, registerLoomBox2D);
+    LOOM_DECLARE_MANAGEDNATIVETYPE(QueryBuffer, registerLoomBox2D);
+    LOOM_DECLARE_MANAGEDNATIVETYPE(Loom2D::BodySync, registerLoomBox2D);
+    LOOM_DECLARE_MANAGEDNATIVETYPE(Loom2D::PhysicsStepper, registerLoomBox2D);
     //LOOM_DECLARE_MANAGEDNATIVETYPE(b2ShapeCache, registerLoomBox2D);
 }
@@ -22,6 +22,7 @@
 #include "loom/script/native/lsNativeDelegate.h"
 #include "loom/script/runtime/lsProfiler.h"
 #include "loom/common/platform/platformHttp.h"
+#include "loom/common/platform/platformHTTPCache.h"
 #include "loom/common/utils/utByteArray.h"
 
 using namespace LS;
@@ -44,6 +45,7 @@ public:
     utByteArray *bodyBytes;
 
     bool        followRedirects;
+    bool        streamResponse;
 
     utHashTable<utHashedString, utString> header;
 
@@ -51,11 +53,13 @@ public:
 
     LOOM_DELEGATE(OnSuccess);
     LOOM_DELEGATE(OnFailure);
+    LOOM_DELEGATE(OnChunk);
 
     HTTPRequest(const char *urlString, const char *contentType) : method("GET"), body(""), responseCacheFile(""), bodyBytes(NULL)
     {
         url = urlString;
         followRedirects          = true;
+        streamResponse           = false;
         id = -1;
 
         requestPending = false;
@@ -119,14 +123,14 @@ public:
                 // Send with body as byte array.
                 id = platform_HTTPSend((const char *)url.c_str(), (const char *)method.c_str(), &HTTPRequest::respond, (void *)this,
                                   (const char *)bodyBytes->getInternalArray()->ptr(), bodyBytes->getSize(), header,
-                                  (const char *)responseCacheFile.c_str(), followRedirects);
+                                  (const char *)responseCacheFile.c_str(), followRedirects, streamResponse);
             }
             else
             {
                 // Send with body as string.
                 id = platform_HTTPSend((const char *)url.c_str(), (const char *)method.c_str(), &HTTPRequest::respond, (void *)this,
                                   (const char *)body.c_str(), (int)body.length(), header,
-                                  (const char *)responseCacheFile.c_str(), followRedirects);
+                                  (const char *)responseCacheFile.c_str(), followRedirects, streamResponse);
             }
 
             // The request has been sent!
@@ -167,6 +171,39 @@ public:
         return platform_HTTPIsConnected();
     }
 
+    static int getCacheHits()
+    {
+        loom_HTTPCacheStats stats;
+        platform_HTTPCacheGetStats(&stats);
+        return stats.hits + stats.revalidations;
+    }
+
+    static int getCacheMisses()
+    {
+        loom_HTTPCacheStats stats;
+        platform_HTTPCacheGetStats(&stats);
+        return stats.misses;
+    }
+
+    static int getCacheRevalidations()
+    {
+        loom_HTTPCacheStats stats;
+        platform_HTTPCacheGetStats(&stats);
+        return stats.revalidations;
+    }
+
+    static double getCacheSize()
+    {
+        loom_HTTPCacheStats stats;
+        platform_HTTPCacheGetStats(&stats);
+        return (double)stats.size;
+    }
+
+    static void clearCache()
+    {
+        platform_HTTPCacheClear();
+    }
+
     /**
      * Calls the native delegate, this should be used internally only
      */
@@ -190,6 +227,11 @@ public:
             request->complete();
             break;
 
+        case LOOM_HTTP_CHUNK:
+            request->_OnChunkDelegate.pushArgument(data);
+            request->_OnChunkDelegate.invoke();
+            break;
+
         default:
             break;
         }
@@ -208,14 +250,21 @@ static int registerLoomHTTPRequest(lua_State *L)
        .addMethod("cancel", &HTTPRequest::cancel)
        .addMethod("isPending", &HTTPRequest::isPending)
        .addStaticMethod("isConnected", &HTTPRequest::isConnected)
+       .addStaticMethod("clearCache", &HTTPRequest::clearCache)
+       .addStaticProperty("cacheHits", &HTTPRequest::getCacheHits)
+       .addStaticProperty("cacheMisses", &HTTPRequest::getCacheMisses)
+       .addStaticProperty("cacheRevalidations", &HTTPRequest::getCacheRevalidations)
+       .addStaticProperty("cacheSize", &HTTPRequest::getCacheSize)
        .addVar("method", &HTTPRequest::method)
        .addVar("body", &HTTPRequest::body)
        .addVar("bodyBytes", &HTTPRequest::bodyBytes)
        .addVar("url", &HTTPRequest::url)
        .addVar("cacheFileName", &HTTPRequest::responseCacheFile)
        .addVar("followRedirects", &HTTPRequest::followRedirects)
+       .addVar("streamResponse", &HTTPRequest::streamResponse)
        .addVarAccessor("onSuccess", &HTTPRequest::getOnSuccessDelegate)
        .addVarAccessor("onFailure", &HTTPRequest::getOnFailureDelegate)
+       .addVarAccessor("onChunk", &HTTPRequest::getOnChunkDelegate)
        .endClass()
 
        .endPackage();
@@ -25,8 +25,14 @@
 #include "loom/script/runtime/lsProfiler.h"
 
 #include "loom/graphics/gfxMath.h"
+#include "loom/graphics/gfxTexture.h"
 #include "loom/engine/loom2d/l2dDisplayObject.h"
 #include "loom/engine/loom2d/l2dMatrix.h"
+#include "loom/engine/loom2d/l2dQuadBatch.h"
+#include "loom/common/platform/platformFile.h"
+#include "loom/common/platform/platformFileAsync.h"
+#include "loom/common/platform/platformHttp.h"
+#include "loom/common/utils/utSHA2.h"
 
 
 using namespace LS;
@@ -262,6 +268,630 @@ char ModestMaps::_rowBinaryString[33];
 char ModestMaps::_colBinaryString[33];
 
 
+/// Loads map tiles natively: requests them over HTTP, most important
+/// first and a bounded number at a time, has them decoded by the async
+/// texture loader, optionally keeps them on disk, and evicts the least
+/// recently used ones beyond maxTiles.
+///
+/// Tiles are told apart by key, as made by ModestMaps.tileKey. Visible
+/// tiles are never evicted and are what fillQuadBatch draws.
+class TileLoader
+{
+public:
+
+    enum State
+    {
+        QUEUED,
+        FETCHING,
+        DECODING,
+        LOADED
+    };
+
+    // Called with the key and texture id of every tile that loaded, and
+    // the key of every tile that failed
+    LOOM_DELEGATE(TileLoaded);
+    LOOM_DELEGATE(TileFailed);
+
+    // Disk reads and HTTP requests in flight at once
+    int maxOpenRequests;
+
+    // Loaded tiles kept before the least recently used ones are evicted
+    int maxTiles;
+
+    // Keep downloaded tiles in TileCache in the writable path and load
+    // them from there first
+    bool cacheOnDisk;
+
+    TileLoader()
+    {
+        maxOpenRequests = 8;
+        maxTiles        = 256;
+        cacheOnDisk     = false;
+        centerColumn    = 0;
+        centerRow       = 0;
+        centerZoom      = 0;
+        openRequests    = 0;
+        numLoaded       = 0;
+        useCounter      = 0;
+    }
+
+    ~TileLoader()
+    {
+        purge();
+    }
+
+    // Queues the tile unless it's known already, marking it used. Returns
+    // true if it is loaded.
+    bool request(const char *key, const char *url, int col, int row, int zoom)
+    {
+        Tile *tile = findTile(key);
+
+        if (!tile)
+        {
+            tile = lmNew(NULL) Tile();
+            tile->loader  = this;
+            tile->key     = key;
+            tile->url     = url;
+            tile->col     = col;
+            tile->row     = row;
+            tile->zoom    = zoom;
+            tile->state   = QUEUED;
+            tile->visible = false;
+            tile->httpId  = -1;
+            tile->fileId  = -1;
+            tile->texture = -1;
+            tiles.push_back(tile);
+            lookup.insert(tile->key.c_str(), tile);
+        }
+
+        tile->lastUsed = useCounter;
+
+        return tile->state == LOADED;
+    }
+
+    // Drops the tile, loaded or not
+    void cancel(const char *key)
+    {
+        Tile *tile = findTile(key);
+
+        if (tile)
+        {
+            removeTile(tile);
+        }
+    }
+
+    // The texture of a loaded tile, marking it used, or -1
+    int getTexture(const char *key)
+    {
+        Tile *tile = findTile(key);
+
+        if (!tile || tile->state != LOADED)
+        {
+            return -1;
+        }
+
+        tile->lastUsed = useCounter;
+        return tile->texture;
+    }
+
+    void setVisible(const char *key, bool visible)
+    {
+        Tile *tile = findTile(key);
+
+        if (tile)
+        {
+            tile->visible  = visible;
+            tile->lastUsed = useCounter;
+        }
+    }
+
+    void clearVisible()
+    {
+        for (UTsize i = 0; i < tiles.size(); i++)
+        {
+            tiles[i]->visible = false;
+        }
+    }
+
+    // The tile queued tiles nearest to load first, in the columns and
+    // rows of the zoom level
+    void setCenter(lmscalar col, lmscalar row, int zoom)
+    {
+        centerColumn = col;
+        centerRow    = row;
+        centerZoom   = zoom;
+    }
+
+    // Starts loading queued tiles up to maxOpenRequests, completes the
+    // decoded ones and evicts beyond maxTiles
+    void update()
+    {
+        LOOM_PROFILE_SCOPE(mmTileLoaderUpdate);
+
+        useCounter++;
+
+        pollDecoding();
+
+        while (openRequests < maxOpenRequests)
+        {
+            Tile *tile = nextQueued();
+
+            if (!tile)
+            {
+                break;
+            }
+
+            fetch(tile);
+        }
+
+        evict();
+        collectPages();
+    }
+
+    // Resets the batch to draw from the page, as returned by getPage, and
+    // adds a quad for every visible loaded tile of the zoom level on it,
+    // at col * tileSize, row * tileSize in the batch. Returns the quads.
+    int fillQuadBatch(QuadBatch *batch, int page, int zoom, lmscalar tileSize)
+    {
+        if (!batch)
+        {
+            return 0;
+        }
+
+        batch->numQuads = 0;
+        batch->setNativeTextureID(page);
+
+        int added = 0;
+
+        for (UTsize i = 0; i < tiles.size(); i++)
+        {
+            Tile *tile = tiles[i];
+
+            if (!tile->visible || tile->state != LOADED || tile->zoom != zoom)
+            {
+                continue;
+            }
+
+            GFX::TextureID tilePage;
+            float          region[4];
+
+            if (!getTileRegion(tile, tilePage, region) || tilePage != page)
+            {
+                continue;
+            }
+
+            if (batch->numQuads >= batch->maxQuads)
+            {
+                batch->reserve(lmMax(batch->numQuads + 1, batch->maxQuads * 2));
+            }
+
+            GFX::VertexPosColorTex *v = &batch->quadData[batch->numQuads * 4];
+
+            float x0 = (float)(tile->col * tileSize);
+            float y0 = (float)(tile->row * tileSize);
+            float x1 = (float)(x0 + tileSize);
+            float y1 = (float)(y0 + tileSize);
+            float u0 = region[0];
+            float v0 = region[1];
+            float u1 = region[0] + region[2];
+            float v1 = region[1] + region[3];
+
+            setVertex(v[0], x0, y0, u0, v0);
+            setVertex(v[1], x1, y0, u1, v0);
+            setVertex(v[2], x0, y1, u0, v1);
+            setVertex(v[3], x1, y1, u1, v1);
+
+            batch->numQuads++;
+            added++;
+        }
+
+        batch->invalidateStaticBatches();
+
+        return added;
+    }
+
+    // Textures the visible loaded tiles are drawn from as of the last
+    // update, a QuadBatch is needed for each
+    int getNumPages() const
+    {
+        return (int)pages.size();
+    }
+
+    int getPage(int index)
+    {
+        return index >= 0 && index < (int)pages.size() ? pages[index] : -1;
+    }
+
+    // Drops all tiles
+    void purge()
+    {
+        while (tiles.size())
+        {
+            removeTile(tiles.back());
+        }
+
+        pages.clear();
+    }
+
+    int getNumTiles() const
+    {
+        return (int)tiles.size();
+    }
+
+    int getNumLoaded() const
+    {
+        return numLoaded;
+    }
+
+    int getNumOpenRequests() const
+    {
+        return openRequests;
+    }
+
+private:
+
+    struct Tile
+    {
+        TileLoader *loader;
+        utString   key;
+        utString   url;
+        int        col;
+        int        row;
+        int        zoom;
+        int        state;
+        bool       visible;
+        int        httpId;
+        int        fileId;
+        int        texture;
+        uint32_t   lastUsed;
+    };
+
+    utArray<Tile *> tiles;
+    utHashTable<utHashedString, Tile *> lookup;
+
+    // Atlas pages or textures of the visible tiles
+    utArray<int> pages;
+
+    lmscalar centerColumn;
+    lmscalar centerRow;
+    int      centerZoom;
+
+    int      openRequests;
+    int      numLoaded;
+    uint32_t useCounter;
+
+    utHashTable<utHashedString, utString> noHeaders;
+
+    Tile *findTile(const char *key)
+    {
+        Tile **tile = lookup.get(key);
+        return tile ? *tile : NULL;
+    }
+
+    // Queued tile nearest to the center, like TilePainter's priority
+    Tile *nextQueued()
+    {
+        Tile     *best    = NULL;
+        lmscalar bestPriority = 0;
+
+        for (UTsize i = 0; i < tiles.size(); i++)
+        {
+            Tile *tile = tiles[i];
+
+            if (tile->state != QUEUED)
+            {
+                continue;
+            }
+
+            // The center in the columns and rows of the tile's zoom
+            lmscalar scale    = (lmscalar)pow(2.0, tile->zoom - centerZoom);
+            lmscalar dc       = (tile->col + (lmscalar)0.5) - centerColumn * scale;
+            lmscalar dr       = (tile->row + (lmscalar)0.5) - centerRow * scale;
+            lmscalar priority = (tile->zoom + 1) / (1 + dc * dc + dr * dr);
+
+            if (!best || priority > bestPriority)
+            {
+                best         = tile;
+                bestPriority = priority;
+            }
+        }
+
+        return best;
+    }
+
+    void fetch(Tile *tile)
+    {
+        tile->state = FETCHING;
+        openRequests++;
+
+        if (cacheOnDisk)
+        {
+            utString path;
+            getCachePath(tile, path);
+            tile->fileId = platform_fileReadAsync(path.c_str(), fileRead, tile);
+        }
+        else
+        {
+            sendRequest(tile);
+        }
+    }
+
+    void sendRequest(Tile *tile)
+    {
+        tile->httpId = platform_HTTPSend(tile->url.c_str(), "GET", httpResponse, tile, "", 0, noHeaders, "", true, false);
+
+        if (tile->httpId == -1)
+        {
+            failTile(tile);
+        }
+    }
+
+    static void fileRead(void *payload, loom_fileAsyncResult *result)
+    {
+        Tile *tile = (Tile *)payload;
+        tile->fileId = -1;
+
+        if (result->success && result->data && result->data->getSize())
+        {
+            tile->loader->decode(tile, result->data);
+        }
+        else
+        {
+            tile->loader->sendRequest(tile);
+        }
+    }
+
+    static void httpResponse(void *payload, loom_HTTPCallbackType type, utByteArray *data)
+    {
+        Tile       *tile   = (Tile *)payload;
+        TileLoader *loader = tile->loader;
+
+        if (type == LOOM_HTTP_CHUNK)
+        {
+            return;
+        }
+
+        platform_HTTPComplete(tile->httpId);
+        tile->httpId = -1;
+
+        if (type != LOOM_HTTP_SUCCESS || !data->getSize())
+        {
+            loader->failTile(tile);
+            return;
+        }
+
+        if (loader->cacheOnDisk)
+        {
+            utString path;
+            loader->getCachePath(tile, path);
+            platform_fileReplaceAsync(path.c_str(), data->getDataPtr(), data->getSize(), NULL, NULL);
+        }
+
+        loader->decode(tile, data);
+    }
+
+    void decode(Tile *tile, utByteArray *data)
+    {
+        openRequests--;
+
+        GFX::TextureInfo *info = GFX::Texture::initFromBytesAsync(data, NULL, false);
+
+        if (!info)
+        {
+            tile->state = QUEUED;
+            failTile(tile);
+            return;
+        }
+
+        tile->state   = DECODING;
+        tile->texture = info->id;
+    }
+
+    void pollDecoding()
+    {
+        // Delegates may add or drop tiles, call them once done looking.
+        utArray<utString> loaded;
+        utArray<utString> failed;
+
+        for (UTsize i = 0; i < tiles.size(); i++)
+        {
+            Tile *tile = tiles[i];
+
+            if (tile->state != DECODING)
+            {
+                continue;
+            }
+
+            GFX::TextureInfo *info = GFX::Texture::getTextureInfo(tile->texture);
+
+            if (info && info->asyncPending)
+            {
+                continue;
+            }
+
+            if (!info || info->width <= 0)
+            {
+                failed.push_back(tile->key);
+                continue;
+            }
+
+            tile->state = LOADED;
+            numLoaded++;
+            loaded.push_back(tile->key);
+        }
+
+        for (UTsize i = 0; i < failed.size(); i++)
+        {
+            Tile *tile = findTile(failed[i].c_str());
+
+            if (tile && tile->state == DECODING)
+            {
+                failTile(tile);
+            }
+        }
+
+        for (UTsize i = 0; i < loaded.size(); i++)
+        {
+            Tile *tile = findTile(loaded[i].c_str());
+
+            // Dropped by an earlier delegate
+            if (!tile || tile->state != LOADED)
+            {
+                continue;
+            }
+
+            _TileLoadedDelegate.pushArgument(tile->key.c_str());
+            _TileLoadedDelegate.pushArgument(tile->texture);
+            _TileLoadedDelegate.invoke();
+        }
+    }
+
+    // Reports and drops the tile
+    void failTile(Tile *tile)
+    {
+        utString key = tile->key;
+
+        removeTile(tile);
+
+        _TileFailedDelegate.pushArgument(key.c_str());
+        _TileFailedDelegate.invoke();
+    }
+
+    void removeTile(Tile *tile)
+    {
+        if (tile->state == FETCHING)
+        {
+            openRequests--;
+        }
+
+        if (tile->httpId != -1)
+        {
+            platform_HTTPComplete(tile->httpId);
+        }
+
+        if (tile->fileId != -1)
+        {
+            platform_fileAsyncCancel(tile->fileId);
+        }
+
+        if (tile->texture != -1)
+        {
+            GFX::Texture::dispose(tile->texture);
+        }
+
+        if (tile->state == LOADED)
+        {
+            numLoaded--;
+        }
+
+        lookup.remove(tile->key.c_str());
+        tiles.erase(tile);
+        lmDelete(NULL, tile);
+    }
+
+    static bool isUsedLater(Tile * const& a, Tile * const& b)
+    {
+        return a->lastUsed > b->lastUsed;
+    }
+
+    void evict()
+    {
+        if (numLoaded <= maxTiles)
+        {
+            return;
+        }
+
+        utArray<Tile *> candidates;
+
+        for (UTsize i = 0; i < tiles.size(); i++)
+        {
+            if (tiles[i]->state == LOADED && !tiles[i]->visible)
+            {
+                candidates.push_back(tiles[i]);
+            }
+        }
+
+        // Least recently used first, utArray::sort swaps neighbours this
+        // is true for
+        candidates.sort(isUsedLater);
+
+        for (UTsize i = 0; i < candidates.size() && numLoaded > maxTiles; i++)
+        {
+            removeTile(candidates[i]);
+        }
+    }
+
+    void collectPages()
+    {
+        pages.clear();
+
+        for (UTsize i = 0; i < tiles.size(); i++)
+        {
+            Tile *tile = tiles[i];
+
+            if (!tile->visible || tile->state != LOADED)
+            {
+                continue;
+            }
+
+            GFX::TextureID page;
+            float          region[4];
+
+            if (getTileRegion(tile, page, region) && pages.find(page) == UT_NPOS)
+            {
+                pages.push_back(page);
+            }
+        }
+    }
+
+    static bool getTileRegion(Tile *tile, GFX::TextureID& page, float *region)
+    {
+        if (GFX::Texture::getAtlasRegion(tile->texture, page, region))
+        {
+            return true;
+        }
+
+        page      = tile->texture;
+        region[0] = region[1] = 0;
+        region[2] = region[3] = 1;
+        return true;
+    }
+
+    static inline void setVertex(GFX::VertexPosColorTex& v, float x, float y, float u, float tv)
+    {
+        v.x    = x;
+        v.y    = y;
+        v.z    = 0;
+        v.abgr = 0xFFFFFFFF;
+        v.u    = u;
+        v.v    = tv;
+    }
+
+    void getCachePath(Tile *tile, utString& path)
+    {
+        static utString directory;
+
+        if (directory.empty())
+        {
+            directory  = platform_getWritablePath();
+            directory += "/TileCache";
+        }
+
+        if (platform_dirExists(directory.c_str()) != 0)
+        {
+            platform_makeDir(directory.c_str());
+        }
+
+        utString hash;
+        utSHA2::generateSHA256(tile->url.c_str(), (int)tile->url.length(), hash);
+
+        path  = directory;
+        path += "/";
+        path += hash;
+    }
+};
+
+
 
 
 static int registerLoomModestMaps(lua_State *L)
@@ -298,6 +928,35 @@ static int registerLoomModestMaps(lua_State *L)
 
         .endClass()
 
+        .beginClass<TileLoader>("TileLoader")
+
+            .addConstructor<void (*)(void)>()
+
+            .addVarAccessor("onTileLoaded", &TileLoader::getTileLoadedDelegate)
+            .addVarAccessor("onTileFailed", &TileLoader::getTileFailedDelegate)
+
+            .addVar("maxOpenRequests", &TileLoader::maxOpenRequests)
+            .addVar("maxTiles", &TileLoader::maxTiles)
+            .addVar("cacheOnDisk", &TileLoader::cacheOnDisk)
+
+            .addProperty("numTiles", &TileLoader::getNumTiles)
+            .addProperty("numLoaded", &TileLoader::getNumLoaded)
+            .addProperty("numOpenRequests", &TileLoader::getNumOpenRequests)
+            .addProperty("numPages", &TileLoader::getNumPages)
+
+            .addMethod("request", &TileLoader::request)
+            .addMethod("cancel", &TileLoader::cancel)
+            .addMethod("getTexture", &TileLoader::getTexture)
+            .addMethod("setVisible", &TileLoader::setVisible)
+            .addMethod("clearVisible", &TileLoader::clearVisible)
+            .addMethod("setCenter", &TileLoader::setCenter)
+            .addMethod("getPage", &TileLoader::getPage)
+            .addMethod("fillQuadBatch", &TileLoader::fillQuadBatch)
+            .addMethod("purge", &TileLoader::purge)
+            .addMethod("_update", &TileLoader::update)
+
+        .endClass()
+
     .endPackage();
 
     return 0;
@@ -307,4 +966,5 @@ static int registerLoomModestMaps(lua_State *L)
 void installLoomModestMaps()
 {
     LOOM_DECLARE_NATIVETYPE(ModestMaps, registerLoomModestMaps);
+    LOOM_DECLARE_MANAGEDNATIVETYPE(TileLoader, registerLoomModestMaps);
 }
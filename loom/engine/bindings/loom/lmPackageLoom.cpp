@@ -26,6 +26,7 @@ void installLoomPropertyManager();
 void installLoomWebView();
 void installLoomAdMobAd();
 void installLoomHTTPRequest();
+void installLoomWebSocket();
 void installLoomNativeStore();
 void installLoomVideo();
 void installLoomMobile();
@@ -48,6 +49,7 @@ void installPackageLoom()
     installLoomWebView();
     installLoomAdMobAd();
     installLoomHTTPRequest();
+    installLoomWebSocket();
     installLoomAssets();
     installLoomBox2D();
     installLoomPropertyManager();
@@ -20,6 +20,7 @@
 
 #include "loom/script/loomscript.h"
 #include "loom/script/runtime/lsRuntime.h"
+#include "loom/script/runtime/lsLuaState.h"
 #include "loom/common/core/log.h"
 #include "loom/script/native/lsNativeDelegate.h"
 #include "loom/vendor/sqlite3/sqlite3.h"
@@ -28,16 +29,48 @@
 #include "loom/common/utils/utString.h"
 #include "loom/common/utils/json.h"
 #include "loom/common/platform/platformThread.h"
+#include "loom/common/platform/platformJobs.h"
 #include "loom/common/platform/platformFile.h"
 #include "loom/common/config/applicationConfig.h"
 
+#include <math.h>
+
 lmDefineLogGroup(gSQLiteGroup, "sqlite", 1, LoomLogInfo);
 
 using namespace LS;
 
-//forward declaration of Statement
+//forward declarations of Connection and Statement
+class Connection;
 class Statement;
 
+//A value bound to or read from an asynchronous query, text and blobs live in the query's data
+struct AsyncValue
+{
+    int type;
+    double number;
+    UTsize offset;
+    UTsize length;
+};
+
+//A query run on a connection's database thread, and its results
+struct AsyncQuery
+{
+    Connection *connection;
+    int id;
+    utString query;
+    int maxRows;
+
+    utArray<AsyncValue> params;
+
+    int result;
+    int numRows;
+    utArray<utString> columnNames;
+    utArray<AsyncValue> values;
+    utArray<unsigned char> data;
+
+    AsyncQuery *next;
+};
+
 //SQLite Connection binding for Loomscript
 class Connection
 {
@@ -45,10 +78,65 @@ protected:
     utString databaseName;
     utString databaseFullPath;
 
+    int openFlags;
+
+    // Finalized statements kept for prepare() to hand out again, least
+    // recently used first.
+    utArray<sqlite3_stmt *> statementCache;
+
+    // Asynchronous queries run in order on a thread of their own with a
+    // connection of their own, asyncHandle, touched by that thread only.
+    ThreadHandle asyncThread;
+    MutexHandle asyncMutex;
+    SemaphoreHandle asyncSignal;
+    AsyncQuery *asyncHead;
+    AsyncQuery *asyncTail;
+    bool asyncStopping;
+    int asyncNextId;
+    sqlite3 *asyncHandle;
+    utArray<sqlite3_stmt *> asyncStatementCache;
+
+    // The connections whose completions may still be delivered.
+    static utArray<Connection *> asyncConnections;
+
+    int execute(const char *sql, const char *caller);
+    int bindValue(lua_State *L, sqlite3_stmt *handle, int column, int idx);
+
+    bool startAsync();
+    void stopAsync();
+    void runAsync(AsyncQuery *q);
+    static int __stdcall asyncThreadBody(void *param);
+    static void asyncQueryDone(void *param);
+
 public:
     LOOM_STATICDELEGATE(OnImportComplete);
+    LOOM_DELEGATE(OnQueryComplete);
 
     sqlite3 *dbHandle;
+    int statementCacheSize;
+
+    Connection()
+    {
+        dbHandle = NULL;
+        openFlags = 0;
+        statementCacheSize = 16;
+
+        asyncThread = NULL;
+        asyncMutex = NULL;
+        asyncSignal = NULL;
+        asyncHead = asyncTail = NULL;
+        asyncStopping = false;
+        asyncNextId = 1;
+        asyncHandle = NULL;
+    }
+
+    ~Connection()
+    {
+        stopAsync();
+
+        //completions already posted are dropped
+        asyncConnections.erase(this, true);
+    }
 
     static bool backgroundImportInProgress;
     static MutexHandle backgroundImportMutex;
@@ -64,6 +152,16 @@ public:
     Statement *prepare(const char *query);
     const char* getDBName() { return databaseName.c_str(); }
 
+    sqlite3_stmt *prepareHandle(const char *query);
+    int releaseHandle(sqlite3_stmt *handle);
+    void clearStatementCache();
+    int insertRows(lua_State *L);
+    int queryAsync(lua_State *L);
+
+    static sqlite3_stmt *takeCachedHandle(utArray<sqlite3_stmt *>& cache, const char *query);
+    static int cacheHandle(utArray<sqlite3_stmt *>& cache, int cacheSize, sqlite3_stmt *handle);
+    static void clearCachedHandles(utArray<sqlite3_stmt *>& cache);
+
 
 
     int getErrorCode()
@@ -96,31 +194,19 @@ public:
 
     int beginTransaction()
     {
-        char* errorMessage;
-        int result = sqlite3_exec(dbHandle, "BEGIN TRANSACTION", NULL, NULL, &errorMessage);
-        if(result != SQLITE_OK)
-        {
-            lmLogError(gSQLiteGroup, "Error with beginTransaction for the SQLite database: %s with message: %s", getDBName(), errorMessage);
-        }
-        sqlite3_free(errorMessage);        
-        return result;
+        return execute("BEGIN TRANSACTION", "beginTransaction");
     }
 
     int endTransaction()
     {
-        char* errorMessage;
-        int result = sqlite3_exec(dbHandle, "END TRANSACTION", NULL, NULL, &errorMessage);
-        if(result != SQLITE_OK)
-        {
-            lmLogError(gSQLiteGroup, "Error with endTransaction for the SQLite database: %s with message: %s", getDBName(), errorMessage);
-        }
-        sqlite3_free(errorMessage);        
-        return result;
+        return execute("END TRANSACTION", "endTransaction");
     }    
 
     int close()
     {
-        //close the database
+        //let the queued asynchronous queries finish, finalize the statements kept for reuse, then close the database
+        stopAsync();
+        clearStatementCache();
         int result = sqlite3_close_v2(dbHandle);
         if(result != SQLITE_OK)
         {
@@ -244,6 +330,8 @@ public:
         return result;
     }
 
+    int stepAll(lua_State *L);
+
     int step()
     {
         int result = sqlite3_step(statementHandle); 
@@ -270,7 +358,7 @@ public:
 
         //start up the stepAsync thread
         asyncStepInProgress = true;
-        loom_thread_start(Statement::stepAsyncBody, (void *)this);    
+        loom_thread_startWithHint(Statement::stepAsyncBody, (void *)this, LOOM_THREAD_BACKGROUND);    
         return true;
     }
 
@@ -313,6 +401,7 @@ public:
 
         //valid blob so allocate byte array for it
         utByteArray *bytes = new utByteArray();
+        bytes->setReportsExternalMemory(true);
         bytes->allocateAndCopy(blob, size);     
 
         return bytes;   
@@ -330,7 +419,14 @@ public:
 
     int finalize()
     {
-        int result = sqlite3_finalize(statementHandle); 
+        if(statementHandle == NULL)
+        {
+            return SQLITE_OK;
+        }
+
+        //the connection keeps the compiled statement around for the next prepare of the same query
+        int result = parentDB->releaseHandle(statementHandle); 
+        statementHandle = NULL;
         if(result != SQLITE_OK)
         {
             lmLogError(gSQLiteGroup, "Error calling finalize for database: %s with Result Code: %i", parentDB->getDBName(), result);
@@ -355,6 +451,94 @@ int Statement::stepAsyncProgress(void *param)
     return 0;  
 }
 
+int Statement::stepAll(lua_State *L)
+{
+    int maxRows = lua_isnumber(L, 2) ? (int)lua_tonumber(L, 2) : 0;
+
+    LSLuaState *ls = LSLuaState::getLuaState(L);
+    Type *dictionaryType = ls->getType("system.Dictionary");
+    Type *byteArrayType = ls->getType("system.ByteArray");
+
+    int numColumns = sqlite3_column_count(statementHandle);
+    luaL_checkstack(L, numColumns + 8, "Too many columns for stepAll");
+
+    lsr_createinstance(L, ls->vectorType);
+    int vectorIdx = lua_gettop(L);
+    lua_rawgeti(L, vectorIdx, LSINDEXVECTOR);
+    int rowsIdx = lua_gettop(L);
+
+    //the column names are pushed once and shared by every row
+    int namesIdx = rowsIdx + 1;
+    for(int i=0;i<numColumns;i++)
+    {
+        lua_pushstring(L, sqlite3_column_name(statementHandle, i));
+    }
+
+    int numRows = 0;
+    int result = SQLITE_ROW;
+    while((maxRows <= 0) || (numRows < maxRows))
+    {
+        result = sqlite3_step(statementHandle);
+        if(result != SQLITE_ROW)
+        {
+            break;
+        }
+
+        lsr_createinstance(L, dictionaryType);
+        lua_rawgeti(L, -1, LSINDEXDICTPAIRS);
+        int pairsIdx = lua_gettop(L);
+
+        for(int i=0;i<numColumns;i++)
+        {
+            switch(sqlite3_column_type(statementHandle, i))
+            {
+                case SQLITE_INTEGER:
+                    lua_pushnumber(L, (lua_Number)sqlite3_column_int64(statementHandle, i));
+                    break;
+                case SQLITE_FLOAT:
+                    lua_pushnumber(L, sqlite3_column_double(statementHandle, i));
+                    break;
+                case SQLITE_TEXT:
+                    lua_pushlstring(L, (const char *)sqlite3_column_text(statementHandle, i), sqlite3_column_bytes(statementHandle, i));
+                    break;
+                case SQLITE_BLOB:
+                {
+                    const void *blob = sqlite3_column_blob(statementHandle, i);
+                    int size = sqlite3_column_bytes(statementHandle, i);
+
+                    lsr_createinstance(L, byteArrayType);
+                    utByteArray *bytes = (utByteArray *)lualoom_getnativepointer(L, -1, false, "system.ByteArray");
+                    if(size > 0)
+                    {
+                        bytes->allocateAndCopy((void *)blob, size);
+                    }
+                    break;
+                }
+                default:
+                    //NULL columns are left out of the row
+                    continue;
+            }
+
+            lua_pushvalue(L, namesIdx + i);
+            lua_insert(L, -2);
+            lua_rawset(L, pairsIdx);
+        }
+
+        lua_pop(L, 1);
+        lua_rawseti(L, rowsIdx, numRows++);
+    }
+
+    if((result != SQLITE_ROW) && (result != SQLITE_DONE))
+    {
+        lmLogError(gSQLiteGroup, "Error calling stepAll for database: %s with message: %s", parentDB->getDBName(), parentDB->getErrorMessage());
+    }
+
+    lua_settop(L, vectorIdx);
+    lsr_vector_set_length(L, vectorIdx, numRows);
+
+    return 1;
+}
+
 int __stdcall Statement::stepAsyncBody(void *param)
 {
     int result;
@@ -384,6 +568,7 @@ int __stdcall Statement::stepAsyncBody(void *param)
 
 //---Connection--- external variable and function definitions
 NativeDelegate Connection::_OnImportCompleteDelegate;
+utArray<Connection *> Connection::asyncConnections;
 bool Connection::backgroundImportInProgress = false;
 MutexHandle Connection::backgroundImportMutex = loom_mutex_create();;
 const char *Connection::backgroundImportDatabase = NULL;
@@ -391,17 +576,212 @@ const char *Connection::backgroundImportData = NULL;
 
 Statement *Connection::prepare(const char *query)
 {
-    int res;
     Statement *s;
 
     //prepare the database with the query provided
     s = new Statement(this);
-    res = sqlite3_prepare_v2(dbHandle, query, -1, &s->statementHandle, NULL);
+    s->statementHandle = prepareHandle(query);
+    return s;
+}
+
+sqlite3_stmt *Connection::prepareHandle(const char *query)
+{
+    //reuse a finalized statement of the same query if there is one
+    sqlite3_stmt *handle = takeCachedHandle(statementCache, query);
+    if(handle != NULL)
+    {
+        return handle;
+    }
+
+    int res = sqlite3_prepare_v2(dbHandle, query, -1, &handle, NULL);
     if(res != SQLITE_OK)
     {
         lmLogError(gSQLiteGroup, "Error preparing the SQLite database: %s with message: %s", getDBName(), getErrorMessage());
     }
-    return s;
+    return handle;
+}
+
+int Connection::releaseHandle(sqlite3_stmt *handle)
+{
+    return cacheHandle(statementCache, statementCacheSize, handle);
+}
+
+void Connection::clearStatementCache()
+{
+    clearCachedHandles(statementCache);
+}
+
+sqlite3_stmt *Connection::takeCachedHandle(utArray<sqlite3_stmt *>& cache, const char *query)
+{
+    for(int i=(int)cache.size()-1;i>=0;i--)
+    {
+        if(strcmp(sqlite3_sql(cache[i]), query) == 0)
+        {
+            sqlite3_stmt *handle = cache[i];
+            cache.erase((UTsize)i, true);
+            return handle;
+        }
+    }
+    return NULL;
+}
+
+int Connection::cacheHandle(utArray<sqlite3_stmt *>& cache, int cacheSize, sqlite3_stmt *handle)
+{
+    if(cacheSize <= 0)
+    {
+        return sqlite3_finalize(handle);
+    }
+
+    //reset reports the same error finalize would
+    int result = sqlite3_reset(handle);
+    sqlite3_clear_bindings(handle);
+    cache.push_back(handle);
+
+    while((int)cache.size() > cacheSize)
+    {
+        sqlite3_finalize(cache[0]);
+        cache.erase((UTsize)0, true);
+    }
+
+    return result;
+}
+
+void Connection::clearCachedHandles(utArray<sqlite3_stmt *>& cache)
+{
+    for(UTsize i=0;i<cache.size();i++)
+    {
+        sqlite3_finalize(cache[i]);
+    }
+    cache.clear();
+}
+
+int Connection::execute(const char *sql, const char *caller)
+{
+    char* errorMessage;
+    int result = sqlite3_exec(dbHandle, sql, NULL, NULL, &errorMessage);
+    if(result != SQLITE_OK)
+    {
+        lmLogError(gSQLiteGroup, "Error with %s for the SQLite database: %s with message: %s", caller, getDBName(), errorMessage);
+    }
+    sqlite3_free(errorMessage);        
+    return result;
+}
+
+int Connection::bindValue(lua_State *L, sqlite3_stmt *handle, int column, int idx)
+{
+    switch(lua_type(L, idx))
+    {
+        case LUA_TNIL:
+            return sqlite3_bind_null(handle, column);
+        case LUA_TBOOLEAN:
+            return sqlite3_bind_int(handle, column, lua_toboolean(L, idx) ? 1 : 0);
+        case LUA_TNUMBER:
+        {
+            //whole numbers go in as integers so they keep comparing equal to INTEGER columns
+            lua_Number value = lua_tonumber(L, idx);
+            if((value == floor(value)) && (value >= -9007199254740992.0) && (value <= 9007199254740992.0))
+            {
+                return sqlite3_bind_int64(handle, column, (sqlite3_int64)value);
+            }
+            return sqlite3_bind_double(handle, column, value);
+        }
+        case LUA_TSTRING:
+        {
+            size_t length;
+            const char *value = lua_tolstring(L, idx, &length);
+            return sqlite3_bind_text(handle, column, value, (int)length, SQLITE_TRANSIENT);
+        }
+        case LUA_TTABLE:
+            if(lsr_gettype(L, idx) == LSLuaState::getLuaState(L)->getType("system.ByteArray"))
+            {
+                utByteArray *bytes = (utByteArray *)lualoom_getnativepointer(L, idx, false, "system.ByteArray");
+                return sqlite3_bind_blob(handle, column, bytes->getDataPtr(), (int)bytes->getSize(), SQLITE_TRANSIENT);
+            }
+            break;
+    }
+
+    lmLogError(gSQLiteGroup, "Unsupported value in column %i for insertRows in database: %s", column, getDBName());
+    return SQLITE_MISUSE;
+}
+
+int Connection::insertRows(lua_State *L)
+{
+    const char *query = lua_tostring(L, 2);
+    if((query == NULL) || !lua_istable(L, 3))
+    {
+        lua_pushnumber(L, SQLITE_MISUSE);
+        return 1;
+    }
+
+    sqlite3_stmt *handle = prepareHandle(query);
+    if(handle == NULL)
+    {
+        lua_pushnumber(L, getErrorCode());
+        return 1;
+    }
+
+    //group the rows into one transaction unless the caller already has one open
+    bool ownTransaction = sqlite3_get_autocommit(dbHandle) != 0;
+    int result = ownTransaction ? execute("BEGIN TRANSACTION", "insertRows") : SQLITE_OK;
+
+    int numRows = lsr_vector_get_length(L, 3);
+    lua_rawgeti(L, 3, LSINDEXVECTOR);
+    int rowsIdx = lua_gettop(L);
+
+    for(int i=0;(i<numRows) && (result == SQLITE_OK);i++)
+    {
+        lua_rawgeti(L, rowsIdx, i);
+        int rowIdx = lua_gettop(L);
+
+        if(!lua_istable(L, rowIdx))
+        {
+            lmLogError(gSQLiteGroup, "Row %i passed to insertRows for database: %s is not a Vector", i, getDBName());
+            result = SQLITE_MISUSE;
+            break;
+        }
+
+        int numColumns = lsr_vector_get_length(L, rowIdx);
+        lua_rawgeti(L, rowIdx, LSINDEXVECTOR);
+        for(int j=0;(j<numColumns) && (result == SQLITE_OK);j++)
+        {
+            lua_rawgeti(L, rowIdx + 1, j);
+            result = bindValue(L, handle, j + 1, -1);
+            lua_pop(L, 1);
+        }
+        lua_settop(L, rowsIdx);
+
+        if(result == SQLITE_OK)
+        {
+            result = sqlite3_step(handle);
+            if(result == SQLITE_DONE)
+            {
+                result = SQLITE_OK;
+            }
+            else
+            {
+                lmLogError(gSQLiteGroup, "Error inserting row %i with insertRows for database: %s with message: %s", i, getDBName(), getErrorMessage());
+            }
+        }
+        sqlite3_reset(handle);
+    }
+
+    lua_settop(L, 3);
+    releaseHandle(handle);
+
+    if(ownTransaction)
+    {
+        if(result == SQLITE_OK)
+        {
+            result = execute("COMMIT TRANSACTION", "insertRows");
+        }
+        else
+        {
+            execute("ROLLBACK TRANSACTION", "insertRows");
+        }
+    }
+
+    lua_pushnumber(L, result);
+    return 1;
 }
 
 Connection *Connection::open(const char *database, int flags)
@@ -419,6 +799,7 @@ Connection *Connection::open(const char *database, int flags)
     //create the connection
     c = new Connection();
     c->databaseName = utString(database);
+    c->openFlags = flags;
 
     //if we find a path separator in the database name, we assume that it contains a valid path already
     if(strchr(database, '/') || strchr(database, '\\'))
@@ -464,7 +845,7 @@ bool Connection::backgroundImport(const char *database, const char *data)
 
     //start up the backgroundImport thread
     Connection::backgroundImportInProgress = true;
-    loom_thread_start(Connection::backgroundImportBody, NULL);    
+    loom_thread_startWithHint(Connection::backgroundImportBody, NULL, LOOM_THREAD_BACKGROUND);    
     return true;
 }
 
@@ -646,6 +1027,404 @@ int __stdcall Connection::backgroundImportBody(void *param)
 }
 
 
+//---Connection--- asynchronous queries
+bool Connection::startAsync()
+{
+    if(asyncThread != NULL)
+    {
+        return true;
+    }
+
+    //a second connection, so the main thread isn't held up by the database thread's work;
+    //write-ahead logging lets the two read and write at the same time
+    int res = sqlite3_open_v2(databaseFullPath.c_str(), &asyncHandle, openFlags, 0);
+    if(res != SQLITE_OK)
+    {
+        lmLogError(gSQLiteGroup, "Error opening the SQLite database file: %s for asynchronous queries with message: %s", databaseFullPath.c_str(), sqlite3_errmsg(asyncHandle));
+        sqlite3_close_v2(asyncHandle);
+        asyncHandle = NULL;
+        return false;
+    }
+
+    if((openFlags & SQLITE_OPEN_READWRITE) && (sqlite3_exec(asyncHandle, "PRAGMA journal_mode=WAL", NULL, NULL, NULL) != SQLITE_OK))
+    {
+        lmLogWarn(gSQLiteGroup, "Unable to enable write-ahead logging for database: %s", getDBName());
+    }
+
+    //either connection waits out the other's writes instead of failing with SQLITE_BUSY
+    sqlite3_busy_timeout(asyncHandle, 5000);
+    sqlite3_busy_timeout(dbHandle, 5000);
+
+    asyncMutex = loom_mutex_create();
+    asyncSignal = loom_semaphore_create();
+    asyncStopping = false;
+    if(asyncConnections.find(this) == UT_NPOS)
+    {
+        asyncConnections.push_back(this);
+    }
+
+    asyncThread = loom_thread_startWithHint(Connection::asyncThreadBody, (void *)this, LOOM_THREAD_BACKGROUND);
+    return true;
+}
+
+void Connection::stopAsync()
+{
+    if(asyncThread == NULL)
+    {
+        return;
+    }
+
+    //the thread runs what is still queued before it stops, this wakes it once more than there are queries
+    loom_mutex_lock(asyncMutex);
+    asyncStopping = true;
+    loom_mutex_unlock(asyncMutex);
+    loom_semaphore_post(asyncSignal);
+
+    loom_thread_join(asyncThread);
+    asyncThread = NULL;
+
+    clearCachedHandles(asyncStatementCache);
+    sqlite3_close_v2(asyncHandle);
+    asyncHandle = NULL;
+
+    loom_semaphore_destroy(asyncSignal);
+    loom_mutex_destroy(asyncMutex);
+    asyncSignal = NULL;
+    asyncMutex = NULL;
+}
+
+int __stdcall Connection::asyncThreadBody(void *param)
+{
+    Connection *c = (Connection *)param;
+
+    loom_thread_setDebugName("SQLite");
+
+    for(;;)
+    {
+        loom_semaphore_wait(c->asyncSignal);
+
+        loom_mutex_lock(c->asyncMutex);
+        AsyncQuery *q = c->asyncHead;
+        if(q != NULL)
+        {
+            c->asyncHead = q->next;
+            if(c->asyncHead == NULL)
+            {
+                c->asyncTail = NULL;
+            }
+        }
+        bool stopping = c->asyncStopping;
+        loom_mutex_unlock(c->asyncMutex);
+
+        if(q == NULL)
+        {
+            if(stopping)
+            {
+                break;
+            }
+            continue;
+        }
+
+        c->runAsync(q);
+        loom_job_runOnMainThread(Connection::asyncQueryDone, (void *)q, NULL);
+    }
+
+    return 0;
+}
+
+void Connection::runAsync(AsyncQuery *q)
+{
+    sqlite3_stmt *handle = takeCachedHandle(asyncStatementCache, q->query.c_str());
+    if(handle == NULL)
+    {
+        q->result = sqlite3_prepare_v2(asyncHandle, q->query.c_str(), -1, &handle, NULL);
+        if(q->result != SQLITE_OK)
+        {
+            lmLogError(gSQLiteGroup, "Error preparing the asynchronous query for database: %s with message: %s", getDBName(), sqlite3_errmsg(asyncHandle));
+            return;
+        }
+    }
+
+    q->result = SQLITE_OK;
+    for(UTsize i=0;(i<q->params.size()) && (q->result == SQLITE_OK);i++)
+    {
+        const AsyncValue& v = q->params[i];
+        int column = (int)i + 1;
+        switch(v.type)
+        {
+            case SQLITE_INTEGER:
+                q->result = sqlite3_bind_int64(handle, column, (sqlite3_int64)v.number);
+                break;
+            case SQLITE_FLOAT:
+                q->result = sqlite3_bind_double(handle, column, v.number);
+                break;
+            case SQLITE_TEXT:
+                q->result = sqlite3_bind_text(handle, column, (const char *)q->data.ptr() + v.offset, (int)v.length, SQLITE_TRANSIENT);
+                break;
+            case SQLITE_BLOB:
+                q->result = sqlite3_bind_blob(handle, column, q->data.ptr() + v.offset, (int)v.length, SQLITE_TRANSIENT);
+                break;
+            default:
+                q->result = sqlite3_bind_null(handle, column);
+                break;
+        }
+    }
+
+    //the parameters aren't needed past here, the rows take their place
+    q->params.clear();
+    q->data.clear();
+
+    int numColumns = sqlite3_column_count(handle);
+    for(int i=0;i<numColumns;i++)
+    {
+        q->columnNames.push_back(sqlite3_column_name(handle, i));
+    }
+
+    while((q->result == SQLITE_OK) && ((q->maxRows <= 0) || (q->numRows < q->maxRows)))
+    {
+        int res = sqlite3_step(handle);
+        if(res == SQLITE_DONE)
+        {
+            break;
+        }
+        if(res != SQLITE_ROW)
+        {
+            q->result = res;
+            break;
+        }
+
+        for(int i=0;i<numColumns;i++)
+        {
+            AsyncValue v;
+            v.type = sqlite3_column_type(handle, i);
+            v.number = 0;
+            v.offset = q->data.size();
+            v.length = 0;
+
+            if((v.type == SQLITE_INTEGER) || (v.type == SQLITE_FLOAT))
+            {
+                v.number = sqlite3_column_double(handle, i);
+                if(v.type == SQLITE_INTEGER)
+                {
+                    v.number = (double)sqlite3_column_int64(handle, i);
+                }
+            }
+            else if((v.type == SQLITE_TEXT) || (v.type == SQLITE_BLOB))
+            {
+                const unsigned char *bytes = v.type == SQLITE_TEXT ? sqlite3_column_text(handle, i) : (const unsigned char *)sqlite3_column_blob(handle, i);
+                v.length = (UTsize)sqlite3_column_bytes(handle, i);
+                for(UTsize j=0;j<v.length;j++)
+                {
+                    q->data.push_back(bytes[j]);
+                }
+            }
+
+            q->values.push_back(v);
+        }
+
+        q->numRows++;
+    }
+
+    if(q->result != SQLITE_OK)
+    {
+        lmLogError(gSQLiteGroup, "Error running the asynchronous query for database: %s with message: %s", getDBName(), sqlite3_errmsg(asyncHandle));
+    }
+
+    cacheHandle(asyncStatementCache, statementCacheSize, handle);
+}
+
+void Connection::asyncQueryDone(void *param)
+{
+    AsyncQuery *q = (AsyncQuery *)param;
+    Connection *c = q->connection;
+
+    if(asyncConnections.find(c) == UT_NPOS)
+    {
+        delete q;
+        return;
+    }
+
+    NativeDelegate& delegate = c->_OnQueryCompleteDelegate;
+
+    delegate.pushArgument(q->id);
+    delegate.pushArgument(q->result);
+
+    if(delegate.getCount() > 0)
+    {
+        lua_State *L = delegate.getVM();
+        LSLuaState *ls = LSLuaState::getLuaState(L);
+        Type *dictionaryType = ls->getType("system.Dictionary");
+        Type *byteArrayType = ls->getType("system.ByteArray");
+        int numColumns = (int)q->columnNames.size();
+
+        luaL_checkstack(L, numColumns + 8, "Too many columns for queryAsync");
+
+        lsr_createinstance(L, ls->vectorType);
+        int vectorIdx = lua_gettop(L);
+        lua_rawgeti(L, vectorIdx, LSINDEXVECTOR);
+        int rowsIdx = lua_gettop(L);
+
+        for(int i=0;i<numColumns;i++)
+        {
+            lua_pushstring(L, q->columnNames[i].c_str());
+        }
+
+        for(int row=0;row<q->numRows;row++)
+        {
+            lsr_createinstance(L, dictionaryType);
+            lua_rawgeti(L, -1, LSINDEXDICTPAIRS);
+            int pairsIdx = lua_gettop(L);
+
+            for(int i=0;i<numColumns;i++)
+            {
+                const AsyncValue& v = q->values[row * numColumns + i];
+                switch(v.type)
+                {
+                    case SQLITE_INTEGER:
+                    case SQLITE_FLOAT:
+                        lua_pushnumber(L, v.number);
+                        break;
+                    case SQLITE_TEXT:
+                        lua_pushlstring(L, (const char *)q->data.ptr() + v.offset, v.length);
+                        break;
+                    case SQLITE_BLOB:
+                    {
+                        lsr_createinstance(L, byteArrayType);
+                        utByteArray *bytes = (utByteArray *)lualoom_getnativepointer(L, -1, false, "system.ByteArray");
+                        if(v.length > 0)
+                        {
+                            bytes->allocateAndCopy(q->data.ptr() + v.offset, (int)v.length);
+                        }
+                        break;
+                    }
+                    default:
+                        //NULL columns are left out of the row
+                        continue;
+                }
+
+                lua_pushvalue(L, rowsIdx + 1 + i);
+                lua_insert(L, -2);
+                lua_rawset(L, pairsIdx);
+            }
+
+            lua_pop(L, 1);
+            lua_rawseti(L, rowsIdx, row);
+        }
+
+        lua_settop(L, vectorIdx);
+        lsr_vector_set_length(L, vectorIdx, q->numRows);
+        delegate.incArgCount();
+    }
+
+    delegate.invoke();
+    delete q;
+}
+
+int Connection::queryAsync(lua_State *L)
+{
+    const char *query = lua_tostring(L, 2);
+    if(query == NULL)
+    {
+        lua_pushnumber(L, 0);
+        return 1;
+    }
+
+    if(!startAsync())
+    {
+        lua_pushnumber(L, 0);
+        return 1;
+    }
+
+    AsyncQuery *q = new AsyncQuery();
+    q->connection = this;
+    q->id = asyncNextId++;
+    q->query = query;
+    q->maxRows = lua_isnumber(L, 4) ? (int)lua_tonumber(L, 4) : 0;
+    q->result = SQLITE_OK;
+    q->numRows = 0;
+    q->next = NULL;
+
+    //copy the parameters now, the script is free to change them once this returns
+    if(lua_istable(L, 3))
+    {
+        int numParams = lsr_vector_get_length(L, 3);
+        lua_rawgeti(L, 3, LSINDEXVECTOR);
+        int paramsIdx = lua_gettop(L);
+
+        for(int i=0;i<numParams;i++)
+        {
+            lua_rawgeti(L, paramsIdx, i);
+
+            AsyncValue v;
+            v.type = SQLITE_NULL;
+            v.number = 0;
+            v.offset = q->data.size();
+            v.length = 0;
+
+            const unsigned char *bytes = NULL;
+            switch(lua_type(L, -1))
+            {
+                case LUA_TBOOLEAN:
+                    v.type = SQLITE_INTEGER;
+                    v.number = lua_toboolean(L, -1) ? 1 : 0;
+                    break;
+                case LUA_TNUMBER:
+                    v.number = lua_tonumber(L, -1);
+                    v.type = ((v.number == floor(v.number)) && (v.number >= -9007199254740992.0) && (v.number <= 9007199254740992.0)) ? SQLITE_INTEGER : SQLITE_FLOAT;
+                    break;
+                case LUA_TSTRING:
+                {
+                    size_t length;
+                    bytes = (const unsigned char *)lua_tolstring(L, -1, &length);
+                    v.type = SQLITE_TEXT;
+                    v.length = (UTsize)length;
+                    break;
+                }
+                case LUA_TTABLE:
+                    if(lsr_gettype(L, -1) == LSLuaState::getLuaState(L)->getType("system.ByteArray"))
+                    {
+                        utByteArray *byteArray = (utByteArray *)lualoom_getnativepointer(L, -1, false, "system.ByteArray");
+                        bytes = (const unsigned char *)byteArray->getDataPtr();
+                        v.type = SQLITE_BLOB;
+                        v.length = (UTsize)byteArray->getSize();
+                    }
+                    else
+                    {
+                        lmLogError(gSQLiteGroup, "Unsupported value for parameter %i of queryAsync in database: %s, binding null", i + 1, getDBName());
+                    }
+                    break;
+            }
+
+            for(UTsize j=0;j<v.length;j++)
+            {
+                q->data.push_back(bytes[j]);
+            }
+
+            q->params.push_back(v);
+            lua_pop(L, 1);
+        }
+
+        lua_settop(L, 4);
+    }
+
+    loom_mutex_lock(asyncMutex);
+    if(asyncTail != NULL)
+    {
+        asyncTail->next = q;
+    }
+    else
+    {
+        asyncHead = q;
+    }
+    asyncTail = q;
+    loom_mutex_unlock(asyncMutex);
+    loom_semaphore_post(asyncSignal);
+
+    lua_pushnumber(L, q->id);
+    return 1;
+}
+
+
 //Loomscript binding registations for Connection and Statement
 static int registerLoomSQLiteConnection(lua_State *L)
 {
@@ -664,6 +1443,10 @@ static int registerLoomSQLiteConnection(lua_State *L)
         .addMethod("beginTransaction", &Connection::beginTransaction)
         .addMethod("endTransaction", &Connection::endTransaction)
         .addMethod("prepare", &Connection::prepare)
+        .addLuaFunction("insertRows", &Connection::insertRows)
+        .addLuaFunction("queryAsync", &Connection::queryAsync)
+        .addVarAccessor("onQueryComplete", &Connection::getOnQueryCompleteDelegate)
+        .addVar("statementCacheSize", &Connection::statementCacheSize)
         .addMethod("close", &Connection::close)
 
       .endClass()
@@ -690,6 +1473,7 @@ static int registerLoomSQLiteStatement(lua_State *L)
         .addMethod("bindBytes", &Statement::bindBytes)
         .addMethod("step", &Statement::step)
         .addMethod("stepAsync", &Statement::stepAsync)
+        .addLuaFunction("stepAll", &Statement::stepAll)
         .addMethod("columnName", &Statement::columnName)
         .addMethod("columnType", &Statement::columnType)
         .addMethod("columnInt", &Statement::columnInt)
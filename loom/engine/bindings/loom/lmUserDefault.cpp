@@ -23,7 +23,9 @@
 #include "loom/common/core/log.h"
 #include "loom/common/core/allocator.h"
 #include "loom/common/platform/platformFile.h"
+#include "loom/common/platform/platformFileAsync.h"
 #include "loom/common/platform/platformIO.h"
+#include "loom/common/platform/platformTime.h"
 #include "loom/common/config/applicationConfig.h"
 #include "loom/common/utils/json.h"
 
@@ -32,25 +34,48 @@ lmDefineLogGroup(gUserDefaultGroup, "userdef", 1, LoomLogInfo);
 UserDefault UserDefault::shared;
 
 #if !LOOM_PLATFORM_IS_APPLE
-class ScopedJSON
+// Changes are written out this long after the first one since the last
+// write, so a burst of sets costs one write.
+#define USERDEFAULT_SAVE_DELAY_MS 1000
+
+// The defaults are read once and kept in memory. Changes are written out
+// on the worker pool, one write in flight at a time, to a temporary file
+// moved over the old one.
+class UserDefaultStore
 {
-    utString dir;
-    utString filepath;
+    static utString dir;
+    static utString filepath;
+    static JSON *json;
+    static bool dirty;
+    static bool saving;
+    static int dirtySince;
 
-public:
-    JSON json;
+    static void load();
+    static void save();
+    static void saved(void *payload, loom_fileAsyncResult *result);
 
-    ScopedJSON();
-    ~ScopedJSON();
+public:
 
-    void load();
-    void save();
-    static void purge();
+    static JSON& get();
+    static void changed();
+    static void update();
+    static void flush();
+    static bool purge();
 
     template<class T>
-    T getValue(const char *k, T def, T value);
+    static T getValue(const char *k, T def, T value)
+    {
+        return get().getObjectJSONType(k) == JSON_NULL ? def : value;
+    }
 };
 
+utString UserDefaultStore::dir;
+utString UserDefaultStore::filepath;
+JSON *UserDefaultStore::json = NULL;
+bool UserDefaultStore::dirty = false;
+bool UserDefaultStore::saving = false;
+int UserDefaultStore::dirtySince = 0;
+
 static const char* getSharedDir()
 {
     return platform_getSettingsPath(LoomApplicationConfig::applicationId().c_str());
@@ -63,71 +88,87 @@ static const char* getSharedFileName()
 
 bool UserDefault::getBoolForKey(const char *k, bool v)
 {
-    ScopedJSON s; return s.getValue(k, v, s.json.getBoolean(k));
+    return UserDefaultStore::getValue(k, v, UserDefaultStore::get().getBoolean(k));
 };
 
 int UserDefault::getIntegerForKey(const char *k, int v)
 {
-    ScopedJSON s; return s.getValue(k, v, s.json.getInteger(k));
+    return UserDefaultStore::getValue(k, v, UserDefaultStore::get().getInteger(k));
 };
 float UserDefault::getFloatForKey(const char *k, float v)
 {
-    ScopedJSON s; return s.getValue(k, v, static_cast<float>(s.json.getFloat(k)));
+    return UserDefaultStore::getValue(k, v, static_cast<float>(UserDefaultStore::get().getFloat(k)));
 };
 
 utString UserDefault::getStringForKey(const char *k, const char* v)
 {
-    ScopedJSON s; return utString(s.getValue(k, v, s.json.getString(k)));
+    return utString(UserDefaultStore::getValue(k, v, UserDefaultStore::get().getString(k)));
 };
 
 double UserDefault::getDoubleForKey(const char *k, double v)
 {
-    ScopedJSON s; return s.getValue(k, v, s.json.getNumber(k));
+    return UserDefaultStore::getValue(k, v, UserDefaultStore::get().getNumber(k));
 };
 
 void UserDefault::setBoolForKey(const char *k, bool v)
 {
-    ScopedJSON s; s.json.setBoolean(k, v);
+    UserDefaultStore::get().setBoolean(k, v);
+    UserDefaultStore::changed();
 };
 
 void UserDefault::setIntegerForKey(const char *k, int v)
 {
-    ScopedJSON s; s.json.setInteger(k, v);
+    UserDefaultStore::get().setInteger(k, v);
+    UserDefaultStore::changed();
 };
 
 void UserDefault::setFloatForKey(const char *k, float v)
 {
-    ScopedJSON s; s.json.setFloat(k, v);
+    UserDefaultStore::get().setFloat(k, v);
+    UserDefaultStore::changed();
 };
 
 void UserDefault::setStringForKey(const char *k, const char * v)
 {
-    ScopedJSON s; s.json.setString(k, v);
+    UserDefaultStore::get().setString(k, v);
+    UserDefaultStore::changed();
 };
 
 void UserDefault::setDoubleForKey(const char *k, double v)
 {
-    ScopedJSON s; s.json.setNumber(k, v);
+    UserDefaultStore::get().setNumber(k, v);
+    UserDefaultStore::changed();
 };
 
 bool UserDefault::purge()
 {
-    return platform_removeFile((utString(getSharedDir()) + utString(getSharedFileName())).c_str()) == 0;
+    return UserDefaultStore::purge();
 };
 
-ScopedJSON::ScopedJSON()
+void UserDefault::flush()
+{
+    UserDefaultStore::flush();
+}
+
+void UserDefault::update()
 {
-    dir = getSharedDir();
-    filepath = dir + getSharedFileName();
-    load();
+    UserDefaultStore::update();
 }
 
-ScopedJSON::~ScopedJSON()
+JSON& UserDefaultStore::get()
 {
-    save();
+    if (!json)
+    {
+        dir = getSharedDir();
+        filepath = dir + getSharedFileName();
+        json = lmNew(NULL) JSON();
+        load();
+    }
+
+    return *json;
 }
 
-void ScopedJSON::load()
+void UserDefaultStore::load()
 {
     void *data;
     long size;
@@ -144,34 +185,79 @@ void ScopedJSON::load()
         text[size] = 0;
 
         // Load JSON
-        json.loadString(text);
+        json->loadString(text);
         lmFree(NULL, text);
 
-        lmAssert(json.isObject(), "Loaded JSON not an object");
+        lmAssert(json->isObject(), "Loaded JSON not an object");
     }
     else
     {
         platform_makeDir(dir.c_str());
-        json.initObject();
+        json->initObject();
     }
 }
 
-void ScopedJSON::save()
+void UserDefaultStore::changed()
+{
+    if (!dirty)
+        dirtySince = platform_getMilliseconds();
+
+    dirty = true;
+}
+
+void UserDefaultStore::update()
 {
-    const char *serialized = json.serialize();
+    if (dirty && !saving && platform_getMilliseconds() - dirtySince >= USERDEFAULT_SAVE_DELAY_MS)
+        save();
+}
+
+void UserDefaultStore::flush()
+{
+    if (!json)
+        return;
+
+    // Changes made during the write in flight go out after it.
+    if (dirty && saving)
+        platform_fileAsyncWait(filepath.c_str());
+
+    if (dirty)
+        save();
+
+    platform_fileAsyncWait(filepath.c_str());
+}
+
+void UserDefaultStore::save()
+{
+    const char *serialized = json->serialize();
     lmAssert(serialized, "Unable to serialize JSON");
 
-    int ret = platform_writeFile(filepath.c_str(), (void*)serialized, strlen(serialized));
+    dirty = false;
+    saving = true;
 
-    if (ret != 0) lmLogWarn(gUserDefaultGroup, "Unable to write to %s", filepath.c_str());
+    // The write has its own copy, and without workers it's done on return.
+    platform_fileReplaceAsync(filepath.c_str(), serialized, (int)strlen(serialized), saved, NULL);
 
     lmFree(NULL, (void*)serialized);
 }
 
-template<class T>
-T ScopedJSON::getValue(const char *k, T def, T value)
+void UserDefaultStore::saved(void *payload, loom_fileAsyncResult *result)
 {
-    return json.getObjectJSONType(k) == JSON_NULL ? def : value;
+    saving = false;
+
+    if (!result->success) lmLogWarn(gUserDefaultGroup, "Unable to write to %s", result->path);
+}
+
+bool UserDefaultStore::purge()
+{
+    get();
+
+    // Nothing written after this may bring the old values back.
+    platform_fileAsyncWait(filepath.c_str());
+
+    json->initObject();
+    dirty = false;
+
+    return platform_removeFile(filepath.c_str()) == 0;
 }
 
 #endif
@@ -196,6 +282,7 @@ static int registerLoomUserDefault(lua_State *L)
         .addMethod("setDoubleForKey", &UserDefault::setDoubleForKey)
 
         .addMethod("purge", &UserDefault::purge)
+        .addMethod("flush", &UserDefault::flush)
 
         .addStaticMethod("sharedUserDefault", &UserDefault::sharedUserDefault)
         .addStaticMethod("purgeSharedUserDefault", &UserDefault::purgeSharedUserDefault)
@@ -38,6 +38,12 @@ public:
     void setDoubleForKey(const char *k, double v);
     
     bool purge();
+
+    // Writes out the changes not written yet, and waits for them to be.
+    void flush();
+
+    // Writes out changes once they settled, called once a tick.
+    static void update();
     
     static bool purgeSharedUserDefault()
     {
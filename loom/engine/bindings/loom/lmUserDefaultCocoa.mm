@@ -67,7 +67,6 @@ void UserDefault::setBoolForKey(const char *k, bool v)
      setBool:v
      forKey:[NSString stringWithUTF8String:k]
      ];
-    [[NSUserDefaults standardUserDefaults] synchronize];
 };
 
 void UserDefault::setIntegerForKey(const char *k, int v)
@@ -76,7 +75,6 @@ void UserDefault::setIntegerForKey(const char *k, int v)
      setInteger:v
      forKey:[NSString stringWithUTF8String:k]
      ];
-    [[NSUserDefaults standardUserDefaults] synchronize];
 };
 
 void UserDefault::setFloatForKey(const char *k, float v)
@@ -85,7 +83,6 @@ void UserDefault::setFloatForKey(const char *k, float v)
      setFloat:v
      forKey:[NSString stringWithUTF8String:k]
      ];
-    [[NSUserDefaults standardUserDefaults] synchronize];
 };
 
 void UserDefault::setStringForKey(const char *k, const char * v)
@@ -94,7 +91,6 @@ void UserDefault::setStringForKey(const char *k, const char * v)
      setObject:[NSString stringWithUTF8String:v]
      forKey:[NSString stringWithUTF8String:k]
      ];
-    [[NSUserDefaults standardUserDefaults] synchronize];
 };
 
 void UserDefault::setDoubleForKey(const char *k, double v)
@@ -103,9 +99,18 @@ void UserDefault::setDoubleForKey(const char *k, double v)
      setDouble:v
      forKey:[NSString stringWithUTF8String:k]
      ];
-    [[NSUserDefaults standardUserDefaults] synchronize];
 };
 
+// NSUserDefaults writes changes out in the background by itself.
+void UserDefault::flush()
+{
+    [[NSUserDefaults standardUserDefaults] synchronize];
+}
+
+void UserDefault::update()
+{
+}
+
 bool UserDefault::purge()
 {
     NSString *appDomain = [[NSBundle mainBundle] bundleIdentifier];
@@ -0,0 +1,180 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/script/loomscript.h"
+#include "loom/script/native/lsNativeDelegate.h"
+#include "loom/common/platform/platformWebSocket.h"
+#include "loom/common/utils/utByteArray.h"
+
+using namespace LS;
+
+
+lmDefineLogGroup(gWebSocketScriptLogGroup, "websocket.script", 1, LoomLogInfo);
+
+class WebSocket {
+private:
+
+    loom_webSocket *socket;
+
+public:
+
+    utString url;
+    utString protocols;
+
+    LOOM_DELEGATE(OnOpen);
+    LOOM_DELEGATE(OnMessage);
+    LOOM_DELEGATE(OnBinaryMessage);
+    LOOM_DELEGATE(OnClose);
+    LOOM_DELEGATE(OnError);
+
+    WebSocket(const char *urlString, const char *protocolsString) : socket(NULL)
+    {
+        url       = urlString ? urlString : "";
+        protocols = protocolsString ? protocolsString : "";
+    }
+
+    ~WebSocket()
+    {
+        if (socket != NULL)
+        {
+            lmLogWarn(gWebSocketScriptLogGroup, "WebSocket to \"%s\" garbage collected while connected. Keep a reference to it until onClose.", url.c_str());
+            platform_webSocketDestroy(socket);
+        }
+    }
+
+    bool connect()
+    {
+        if (socket != NULL)
+        {
+            platform_webSocketDestroy(socket);
+        }
+
+        socket = platform_webSocketOpen(url.c_str(), protocols.c_str(), &WebSocket::respond, this);
+        return socket != NULL;
+    }
+
+    bool send(const char *message)
+    {
+        if ((socket == NULL) || (message == NULL))
+        {
+            return false;
+        }
+
+        return platform_webSocketSend(socket, message, (int)strlen(message), false);
+    }
+
+    bool sendBytes(utByteArray *bytes)
+    {
+        if ((socket == NULL) || (bytes == NULL))
+        {
+            return false;
+        }
+
+        return platform_webSocketSend(socket, bytes->getDataPtr(), bytes->getSize(), true);
+    }
+
+    void close(int code, const char *reason)
+    {
+        if (socket != NULL)
+        {
+            platform_webSocketClose(socket, code, reason);
+        }
+    }
+
+    bool isOpen()
+    {
+        return socket != NULL && platform_webSocketIsOpen(socket);
+    }
+
+    /**
+     * Calls the native delegates, this should be used internally only
+     */
+    static void respond(void *payload, loom_webSocketEvent event, utByteArray *data, int code)
+    {
+        WebSocket *ws = (WebSocket *)payload;
+
+        switch (event)
+        {
+        case LOOM_WEBSOCKET_OPEN:
+            ws->_OnOpenDelegate.invoke();
+            break;
+
+        case LOOM_WEBSOCKET_TEXT:
+            ws->_OnMessageDelegate.pushArgument((const char *)data->getDataPtr());
+            ws->_OnMessageDelegate.invoke();
+            break;
+
+        case LOOM_WEBSOCKET_BINARY:
+            ws->_OnBinaryMessageDelegate.pushArgument(data);
+            ws->_OnBinaryMessageDelegate.invoke();
+            break;
+
+        case LOOM_WEBSOCKET_ERROR:
+            ws->_OnErrorDelegate.pushArgument((const char *)data->getDataPtr());
+            ws->_OnErrorDelegate.invoke();
+            break;
+
+        case LOOM_WEBSOCKET_CLOSED:
+            // Nothing more comes, so let go of the connection before
+            // the delegate possibly connects again.
+            platform_webSocketDestroy(ws->socket);
+            ws->socket = NULL;
+
+            ws->_OnCloseDelegate.pushArgument(code);
+            ws->_OnCloseDelegate.pushArgument((const char *)data->getDataPtr());
+            ws->_OnCloseDelegate.invoke();
+            break;
+
+        default:
+            break;
+        }
+    }
+};
+
+static int registerLoomWebSocket(lua_State *L)
+{
+    beginPackage(L, "loom")
+
+       .beginClass<WebSocket>("WebSocket")
+       .addConstructor<void (*)(const char *, const char *)>()
+       .addMethod("connect", &WebSocket::connect)
+       .addMethod("send", &WebSocket::send)
+       .addMethod("sendBytes", &WebSocket::sendBytes)
+       .addMethod("close", &WebSocket::close)
+       .addMethod("isOpen", &WebSocket::isOpen)
+       .addVar("url", &WebSocket::url)
+       .addVar("protocols", &WebSocket::protocols)
+       .addVarAccessor("onOpen", &WebSocket::getOnOpenDelegate)
+       .addVarAccessor("onMessage", &WebSocket::getOnMessageDelegate)
+       .addVarAccessor("onBinaryMessage", &WebSocket::getOnBinaryMessageDelegate)
+       .addVarAccessor("onClose", &WebSocket::getOnCloseDelegate)
+       .addVarAccessor("onError", &WebSocket::getOnErrorDelegate)
+       .endClass()
+
+       .endPackage();
+
+    return 0;
+}
+
+
+void installLoomWebSocket()
+{
+    LOOM_DECLARE_NATIVETYPE(WebSocket, registerLoomWebSocket);
+}
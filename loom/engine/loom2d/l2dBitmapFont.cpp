@@ -0,0 +1,594 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/engine/loom2d/l2dBitmapFont.h"
+
+#include "loom/common/core/log.h"
+#include "loom/script/native/lsNativeInterface.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+lmDefineLogGroup(gBitmapFontLogGroup, "bitmapfont", 1, LoomLogInfo);
+
+namespace Loom2D
+{
+static const int CHAR_SPACE           = 32;
+static const int CHAR_TAB             = 9;
+static const int CHAR_NEWLINE         = 10;
+static const int CHAR_CARRIAGE_RETURN = 13;
+
+// Reads the next key=value token of a line, values can be quoted
+static bool nextAttribute(const char *&p, const char *end,
+                          const char *&key, int &keyLength,
+                          const char *&value, int &valueLength)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+    {
+        p++;
+    }
+
+    if (p >= end)
+    {
+        return false;
+    }
+
+    key = p;
+
+    while (p < end && *p != '=' && *p != ' ' && *p != '\t')
+    {
+        p++;
+    }
+
+    keyLength = (int)(p - key);
+
+    if (p >= end || *p != '=')
+    {
+        // a token without a value, like the tag itself
+        value       = p;
+        valueLength = 0;
+        return true;
+    }
+
+    p++;
+
+    if (p < end && *p == '"')
+    {
+        value = ++p;
+
+        while (p < end && *p != '"')
+        {
+            p++;
+        }
+
+        valueLength = (int)(p - value);
+
+        if (p < end)
+        {
+            p++;
+        }
+    }
+    else
+    {
+        value = p;
+
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\r')
+        {
+            p++;
+        }
+
+        valueLength = (int)(p - value);
+    }
+
+    return true;
+}
+
+// Keys compare case insensitively, name is lower case
+static inline bool keyIs(const char *key, int keyLength, const char *name)
+{
+    for (int i = 0; i < keyLength; i++)
+    {
+        if (!name[i] || tolower((unsigned char)key[i]) != name[i])
+        {
+            return false;
+        }
+    }
+
+    return name[keyLength] == 0;
+}
+
+static inline lmscalar valueNumber(const char *value, int valueLength)
+{
+    char buffer[64];
+    int  length = valueLength < 63 ? valueLength : 63;
+
+    memcpy(buffer, value, length);
+    buffer[length] = 0;
+
+    return (lmscalar)strtod(buffer, NULL);
+}
+
+void BitmapFontLayout::parseLine(const char *line, int length)
+{
+    const char *p   = line;
+    const char *end = line + length;
+    const char *key, *value;
+    int        keyLength, valueLength;
+
+    if (!nextAttribute(p, end, key, keyLength, value, valueLength))
+    {
+        return;
+    }
+
+    if (keyIs(key, keyLength, "info") || keyIs(key, keyLength, "common"))
+    {
+        while (nextAttribute(p, end, key, keyLength, value, valueLength))
+        {
+            if (keyIs(key, keyLength, "size"))
+            {
+                size = valueNumber(value, valueLength);
+            }
+            else if (keyIs(key, keyLength, "lineheight"))
+            {
+                lineHeight = valueNumber(value, valueLength);
+            }
+            else if (keyIs(key, keyLength, "base"))
+            {
+                baseline = valueNumber(value, valueLength);
+            }
+        }
+    }
+    else if (keyIs(key, keyLength, "char"))
+    {
+        Glyph glyph;
+        memset(&glyph, 0, sizeof(glyph));
+
+        while (nextAttribute(p, end, key, keyLength, value, valueLength))
+        {
+            lmscalar number = valueNumber(value, valueLength);
+
+            if (keyIs(key, keyLength, "id"))
+            {
+                glyph.id = (int)number;
+            }
+            else if (keyIs(key, keyLength, "x"))
+            {
+                glyph.x = number;
+            }
+            else if (keyIs(key, keyLength, "y"))
+            {
+                glyph.y = number;
+            }
+            else if (keyIs(key, keyLength, "width"))
+            {
+                glyph.width = number;
+            }
+            else if (keyIs(key, keyLength, "height"))
+            {
+                glyph.height = number;
+            }
+            else if (keyIs(key, keyLength, "xoffset"))
+            {
+                glyph.xOffset = number;
+            }
+            else if (keyIs(key, keyLength, "yoffset"))
+            {
+                glyph.yOffset = number;
+            }
+            else if (keyIs(key, keyLength, "xadvance"))
+            {
+                glyph.xAdvance = number;
+            }
+        }
+
+        int *index = glyphLookup.get(glyph.id);
+
+        if (index)
+        {
+            glyphs[*index] = glyph;
+        }
+        else
+        {
+            glyphLookup.insert(glyph.id, (int)glyphs.size());
+            glyphs.push_back(glyph);
+        }
+    }
+    else if (keyIs(key, keyLength, "kerning"))
+    {
+        int      first  = -1;
+        int      second = -1;
+        lmscalar amount = 0;
+
+        while (nextAttribute(p, end, key, keyLength, value, valueLength))
+        {
+            if (keyIs(key, keyLength, "first"))
+            {
+                first = (int)valueNumber(value, valueLength);
+            }
+            else if (keyIs(key, keyLength, "second"))
+            {
+                second = (int)valueNumber(value, valueLength);
+            }
+            else if (keyIs(key, keyLength, "amount"))
+            {
+                amount = valueNumber(value, valueLength);
+            }
+        }
+
+        if (first >= 0 && second >= 0)
+        {
+            int pair = (first << 16) | (second & 0xFFFF);
+
+            lmscalar *existing = kernings.get(pair);
+
+            if (existing)
+            {
+                *existing = amount;
+            }
+            else
+            {
+                kernings.insert(pair, amount);
+            }
+        }
+    }
+}
+
+bool BitmapFontLayout::parse(const char *source)
+{
+    glyphs.clear();
+    glyphLookup.clear();
+    kernings.clear();
+
+    if (!source)
+    {
+        return false;
+    }
+
+    const char *line = source;
+
+    while (*line)
+    {
+        const char *lineEnd = strchr(line, '\n');
+        int        length   = lineEnd ? (int)(lineEnd - line) : (int)strlen(line);
+
+        parseLine(line, length);
+
+        line += length;
+
+        if (*line)
+        {
+            line++;
+        }
+    }
+
+    if (size <= 0)
+    {
+        lmLogWarn(gBitmapFontLogGroup, "Invalid font size %f", (double)size);
+        size = size == 0 ? 16 : -size;
+    }
+
+    return glyphs.size() > 0;
+}
+
+int BitmapFontLayout::arrange(lmscalar width, lmscalar height, const char *text, lmscalar fontSize,
+                              const char *hAlign, const char *vAlign, bool autoScale, bool kerning)
+{
+    locations.clear(true);
+    lineStarts.clear(true);
+    lineChars.clear(true);
+
+    if (!text || !*text)
+    {
+        return 0;
+    }
+
+    // Enforce sanity of font size.
+    if (fontSize < 0)
+    {
+        fontSize *= -size;
+    }
+
+    int      numChars        = (int)strlen(text);
+    bool     finished        = false;
+    lmscalar containerWidth  = 0;
+    lmscalar containerHeight = 0;
+    lmscalar currentX        = 0;
+    lmscalar currentY        = 0;
+    int      sanity          = 60;
+
+    while (!finished)
+    {
+        scale           = fontSize / size;
+        containerWidth  = width / scale;
+        containerHeight = height / scale;
+
+        lineStarts.clear(true);
+        lineChars.clear(true);
+
+        if (lineHeight * scale <= containerHeight || !autoScale)
+        {
+            int lastWhiteSpace = -1;
+            int lastCharID     = -1;
+            currentX = 0;
+            currentY = 0;
+            currentLine.clear(true);
+
+            for (int i = 0; i < numChars; i++)
+            {
+                bool lineFull = false;
+                int  charID   = (unsigned char)text[i];
+
+                // Latin UTF8 characters only, C2 means the next byte is
+                // the char as is, C3 needs an additional bit set
+                if ((i < numChars - 1) && (charID == 0xC2 || charID == 0xC3))
+                {
+                    int newChar = (unsigned char)text[++i];
+                    charID = (charID == 0xC3) ? (newChar | 0x40) : newChar;
+                }
+
+                const Glyph *glyph = getGlyph(charID);
+
+                if (charID == CHAR_NEWLINE || charID == CHAR_CARRIAGE_RETURN)
+                {
+                    lineFull = true;
+                }
+                else if (!glyph)
+                {
+                    lmLogWarn(gBitmapFontLogGroup, "Missing character: %d", charID);
+                }
+                else
+                {
+                    if (charID == CHAR_SPACE || charID == CHAR_TAB)
+                    {
+                        lastWhiteSpace = i;
+                    }
+
+                    if (kerning)
+                    {
+                        currentX += getKerning(lastCharID, charID);
+                    }
+
+                    CharLocation location;
+                    location.glyph = (int)(glyph - glyphs.ptr());
+                    location.x     = currentX + glyph->xOffset;
+                    location.y     = currentY + glyph->yOffset;
+                    currentLine.push_back(location);
+
+                    currentX  += glyph->xAdvance;
+                    lastCharID = charID;
+
+                    if (location.x + glyph->width > containerWidth)
+                    {
+                        // remove characters and add them again to next line
+                        int numCharsToRemove = lastWhiteSpace == -1 ? 1 : i - lastWhiteSpace;
+                        int removeIndex      = (int)currentLine.size() - numCharsToRemove;
+
+                        currentLine.resize(removeIndex > 0 ? removeIndex : 0);
+
+                        if (currentLine.size() == 0)
+                        {
+                            break;
+                        }
+
+                        i       -= numCharsToRemove;
+                        lineFull = true;
+                    }
+                }
+
+                if (i == numChars - 1)
+                {
+                    commitLine();
+                    finished = true;
+                }
+                else if (lineFull)
+                {
+                    // Autosize text always goes on one line for now.
+                    if (autoScale)
+                    {
+                        break;
+                    }
+
+                    if (lastWhiteSpace == i && currentLine.size())
+                    {
+                        currentLine.pop_back();
+                    }
+
+                    commitLine();
+
+                    currentX       = 0;
+                    currentY      += lineHeight;
+                    lastWhiteSpace = -1;
+                    lastCharID     = -1;
+                }
+            }
+        }
+
+        if (sanity-- < 0)
+        {
+            lmLogWarn(gBitmapFontLogGroup, "Failed to lay out text %s after many tries.", text);
+            break;
+        }
+
+        if (autoScale && !finished)
+        {
+            fontSize -= 1;
+            lineStarts.clear(true);
+            lineChars.clear(true);
+        }
+        else
+        {
+            finished = true;
+        }
+    }
+
+    int      numLines = (int)lineStarts.size();
+    lmscalar bottom   = currentY + lineHeight;
+    lmscalar yOffset  = 0;
+
+    if (vAlign && !strcmp(vAlign, "bottom"))
+    {
+        yOffset = containerHeight - bottom;
+    }
+    else if (vAlign && !strcmp(vAlign, "center"))
+    {
+        yOffset = (containerHeight - bottom) / 2;
+    }
+
+    for (int lineID = 0; lineID < numLines; lineID++)
+    {
+        int first = lineStarts[lineID];
+        int last  = lineID + 1 < numLines ? lineStarts[lineID + 1] : (int)lineChars.size();
+
+        if (first == last)
+        {
+            continue;
+        }
+
+        const CharLocation& lastLocation = lineChars[last - 1];
+        const Glyph&        lastGlyph    = glyphs[lastLocation.glyph];
+        lmscalar            right        = lastLocation.x - lastGlyph.xOffset + lastGlyph.xAdvance;
+        lmscalar            xOffset      = 0;
+
+        if (hAlign && !strcmp(hAlign, "right"))
+        {
+            xOffset = containerWidth - right;
+        }
+        else if (hAlign && !strcmp(hAlign, "center"))
+        {
+            xOffset = (containerWidth - right) / 2;
+        }
+
+        for (int c = first; c < last; c++)
+        {
+            CharLocation location = lineChars[c];
+            const Glyph& glyph    = glyphs[location.glyph];
+
+            if (glyph.width <= 0 || glyph.height <= 0)
+            {
+                continue;
+            }
+
+            location.x = scale * (location.x + xOffset);
+            location.y = scale * (location.y + yOffset);
+            locations.push_back(location);
+        }
+    }
+
+    return (int)locations.size();
+}
+
+int BitmapFontLayout::fillQuadBatch(lua_State *L)
+{
+    QuadBatch *batch = (QuadBatch *)lualoom_getnativepointer(L, 2);
+
+    int count = arrange((lmscalar)lua_tonumber(L, 3), (lmscalar)lua_tonumber(L, 4),
+                        lua_tostring(L, 5), (lmscalar)lua_tonumber(L, 6),
+                        lua_tostring(L, 8), lua_tostring(L, 9),
+                        lua_toboolean(L, 10) != 0, lua_toboolean(L, 11) != 0);
+
+    if (!count)
+    {
+        lua_pushinteger(L, 0);
+        return 1;
+    }
+
+    // 0xRRGGBB to the vertices' ABGR
+    uint32_t rgb  = (uint32_t)lua_tonumber(L, 7);
+    uint32_t abgr = 0xFF000000 | ((rgb & 0xFF) << 16) | (rgb & 0xFF00) | ((rgb >> 16) & 0xFF);
+
+    if (batch->numQuads + count > batch->maxQuads)
+    {
+        batch->reserve(lmMax(batch->numQuads + count, batch->maxQuads * 2));
+    }
+
+    batch->setNativeTextureID(textureID);
+
+    GFX::VertexPosColorTex *v = &batch->quadData[batch->numQuads * 4];
+
+    for (int i = 0; i < count; i++, v += 4)
+    {
+        const CharLocation& location = locations[i];
+        const Glyph&        glyph    = glyphs[location.glyph];
+
+        float x0 = (float)location.x;
+        float y0 = (float)location.y;
+        float x1 = (float)(location.x + glyph.width * scale);
+        float y1 = (float)(location.y + glyph.height * scale);
+        float u0 = (float)(glyph.x / textureWidth);
+        float v0 = (float)(glyph.y / textureHeight);
+        float u1 = (float)((glyph.x + glyph.width) / textureWidth);
+        float v1 = (float)((glyph.y + glyph.height) / textureHeight);
+
+        v[0].x = x0; v[0].y = y0; v[0].u = u0; v[0].v = v0;
+        v[1].x = x1; v[1].y = y0; v[1].u = u1; v[1].v = v0;
+        v[2].x = x0; v[2].y = y1; v[2].u = u0; v[2].v = v1;
+        v[3].x = x1; v[3].y = y1; v[3].u = u1; v[3].v = v1;
+
+        for (int j = 0; j < 4; j++)
+        {
+            v[j].z    = 0;
+            v[j].abgr = abgr;
+        }
+    }
+
+    batch->numQuads += count;
+
+    lua_pushinteger(L, count);
+    return 1;
+}
+
+void BitmapFontLayout::measure(const char *text, lmscalar maxWidth, lmscalar maxHeight, lmscalar fontSize)
+{
+    measuredWidth = measuredHeight = 0;
+
+    int count = arrange(maxWidth, maxHeight, text, fontSize, "left", "top", false, true);
+
+    if (!count)
+    {
+        return;
+    }
+
+    lmscalar maxX = 0;
+    lmscalar maxY = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        const CharLocation& location = locations[i];
+        const Glyph&        glyph    = glyphs[location.glyph];
+
+        lmscalar right  = location.x + glyph.width * scale;
+        lmscalar bottom = location.y + glyph.height * scale;
+
+        if (right > maxX)
+        {
+            maxX = right;
+        }
+
+        if (bottom > maxY)
+        {
+            maxY = bottom;
+        }
+    }
+
+    measuredWidth  = maxX + 1;
+    measuredHeight = maxY + 1;
+}
+}
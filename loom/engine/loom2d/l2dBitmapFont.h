@@ -0,0 +1,191 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#pragma once
+
+#include "loom/common/utils/utTypes.h"
+#include "loom/common/utils/utString.h"
+#include "loom/engine/loom2d/l2dQuadBatch.h"
+
+namespace Loom2D
+{
+
+// Native side of BitmapFont's text layout. Holds the glyphs and kerning
+// pairs of a font in the text BMFont format and arranges text with them
+// like Starling's BitmapFont did in script, writing the glyph quads of a
+// text straight into a QuadBatch.
+class BitmapFontLayout
+{
+public:
+
+    struct Glyph
+    {
+        int      id;
+        lmscalar x, y, width, height;
+        lmscalar xOffset, yOffset, xAdvance;
+    };
+
+    struct CharLocation
+    {
+        int      glyph;
+        lmscalar x, y;
+    };
+
+protected:
+
+    utArray<Glyph> glyphs;
+
+    // char id -> index in glyphs
+    utFlatHashTable<utIntHashKey, int> glyphLookup;
+
+    // first << 16 | second -> kerning amount
+    utFlatHashTable<utIntHashKey, lmscalar> kernings;
+
+    // placed chars of the last arrange, empty glyphs left out
+    utArray<CharLocation> locations;
+
+    // chars of the line being laid out
+    utArray<CharLocation> currentLine;
+
+    // the laid out lines, each starting at its index in lineChars
+    utArray<int> lineStarts;
+    utArray<CharLocation> lineChars;
+
+    lmscalar scale;
+
+    lmscalar measuredWidth;
+    lmscalar measuredHeight;
+
+    int      textureID;
+    lmscalar textureWidth;
+    lmscalar textureHeight;
+
+    const Glyph *getGlyph(int charID) const
+    {
+        const int *index = glyphLookup.get(charID);
+        return index ? &glyphs[*index] : NULL;
+    }
+
+    lmscalar getKerning(int first, int second) const
+    {
+        if (first < 0 || !kernings.size())
+        {
+            return 0;
+        }
+
+        const lmscalar *amount = kernings.get((first << 16) | (second & 0xFFFF));
+        return amount ? *amount : 0;
+    }
+
+    void parseLine(const char *line, int length);
+
+    // moves currentLine to the laid out lines
+    void commitLine()
+    {
+        lineStarts.push_back((int)lineChars.size());
+
+        for (UTsize i = 0; i < currentLine.size(); i++)
+        {
+            lineChars.push_back(currentLine[i]);
+        }
+
+        currentLine.clear(true);
+    }
+
+public:
+
+    lmscalar size;
+    lmscalar lineHeight;
+    lmscalar baseline;
+
+    BitmapFontLayout()
+    {
+        scale          = 1;
+        measuredWidth  = measuredHeight = 0;
+        textureID      = -1;
+        textureWidth   = textureHeight = 1;
+        size           = 14;
+        lineHeight     = 14;
+        baseline       = 14;
+    }
+
+    // Reads the glyphs, kerning pairs and metrics of a font from the
+    // contents of a .fnt file
+    bool parse(const char *source);
+
+    // The texture the glyphs are in, for their texture coordinates
+    void setTexture(int nativeID, lmscalar width, lmscalar height)
+    {
+        textureID     = nativeID;
+        textureWidth  = width > 0 ? width : 1;
+        textureHeight = height > 0 ? height : 1;
+    }
+
+    bool hasChar(int charID) const
+    {
+        return getGlyph(charID) != NULL;
+    }
+
+    // Arranges the text inside a rectangle, returns the number of chars
+    // placed, which are read with getCharID, getCharX and getCharY
+    int arrange(lmscalar width, lmscalar height, const char *text, lmscalar fontSize,
+                const char *hAlign, const char *vAlign, bool autoScale, bool kerning);
+
+    int getCharID(int index) const
+    {
+        return glyphs[locations[index].glyph].id;
+    }
+
+    lmscalar getCharX(int index) const
+    {
+        return locations[index].x;
+    }
+
+    lmscalar getCharY(int index) const
+    {
+        return locations[index].y;
+    }
+
+    // the scale of the chars of the last arrange
+    lmscalar getScale() const
+    {
+        return scale;
+    }
+
+    // fillQuadBatch(batch, width, height, text, fontSize, color, hAlign,
+    // vAlign, autoScale, kerning), arranges the text and appends a quad
+    // per char to the batch. Returns the number of quads added.
+    int fillQuadBatch(lua_State *L);
+
+    // Measures the text laid out left and top aligned without scaling,
+    // the result is in measuredWidth and measuredHeight
+    void measure(const char *text, lmscalar maxWidth, lmscalar maxHeight, lmscalar fontSize);
+
+    lmscalar getMeasuredWidth() const
+    {
+        return measuredWidth;
+    }
+
+    lmscalar getMeasuredHeight() const
+    {
+        return measuredHeight;
+    }
+};
+}
@@ -33,4 +33,16 @@ unsigned int BlendMode::_blendFunctions[BlendMode::NUM_BLEND_FUNCTIONS][2] =
     { GL_ZERO, GL_ONE_MINUS_SRC_ALPHA},             //ERASE
     { GL_ONE_MINUS_DST_ALPHA, GL_DST_ALPHA}         //BELOW
 };
+
+unsigned int BlendMode::_premultipliedBlendFunctions[BlendMode::NUM_BLEND_FUNCTIONS][2] =
+{
+    { GL_ONE, GL_ONE_MINUS_SRC_ALPHA},              //AUTO (same as NORMAL)
+    { GL_ONE, GL_ZERO},                             //NONE
+    { GL_ONE, GL_ONE_MINUS_SRC_ALPHA},              //NORMAL
+    { GL_ONE, GL_ONE},                              //ADD
+    { GL_DST_COLOR, GL_ONE_MINUS_SRC_ALPHA},        //MULTIPLY
+    { GL_ONE, GL_ONE_MINUS_SRC_COLOR},              //SCREEN
+    { GL_ZERO, GL_ONE_MINUS_SRC_ALPHA},             //ERASE
+    { GL_ONE_MINUS_DST_ALPHA, GL_DST_ALPHA}         //BELOW
+};
 }
@@ -71,13 +71,20 @@ public:
         if(mode >= NUM_BLEND_FUNCTIONS)
             mode = NUM_BLEND_FUNCTIONS - 1;
 
-        srcBlend = _blendFunctions[mode][0];
-        dstBlend = _blendFunctions[mode][1];
+        // Premultiplied textures need their own factors, see
+        // Graphics::setPremultipliedAlpha
+        unsigned int (*functions)[2] = GFX::Graphics::getPremultipliedAlpha() ? _premultipliedBlendFunctions : _blendFunctions;
+
+        srcBlend = functions[mode][0];
+        dstBlend = functions[mode][1];
     }
 
 private:
     //Array associating the full Blend Functions to the Blend Mode enumeration
     static unsigned int _blendFunctions[NUM_BLEND_FUNCTIONS][2];
+
+    //The same for textures and vertex colors with premultiplied alpha
+    static unsigned int _premultipliedBlendFunctions[NUM_BLEND_FUNCTIONS][2];
 };
 }
 
@@ -0,0 +1,220 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/engine/loom2d/l2dBodySync.h"
+#include "loom/engine/loom2d/l2dPhysicsStepper.h"
+
+namespace Loom2D
+{
+utArray<BodySync *> BodySync::sSyncs;
+BodySync::BodyListener BodySync::sBodyListener;
+
+BodySync::BodySync()
+{
+    pixelsPerMeter = 30;
+    sSyncs.push_back(this);
+}
+
+
+BodySync::~BodySync()
+{
+    purge();
+    sSyncs.erase(this, true);
+    PhysicsStepper::removeSync(this);
+}
+
+
+void BodySync::link(b2Body *body, DisplayObject *target)
+{
+    if (!body || !target)
+    {
+        return;
+    }
+
+    unlink(body);
+
+    // Destroying a body has to drop its link, the listener is the only
+    // way to hear of it.
+    watchWorld(body->GetWorld());
+
+    Link link;
+    link.body             = body;
+    link.target           = target;
+    link.previousPosition = body->GetPosition();
+    link.previousAngle    = body->GetAngle();
+    links.push_back(link);
+
+    target->bodyLinkCount++;
+
+    syncLink(link);
+}
+
+
+bool BodySync::unlink(b2Body *body)
+{
+    for (UTsize i = 0; i < links.size(); i++)
+    {
+        if (links[i].body == body)
+        {
+            removeLink(i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void BodySync::unlinkTarget(DisplayObject *target)
+{
+    if (!target || !target->bodyLinkCount)
+    {
+        return;
+    }
+
+    for (UTsize i = links.size(); i > 0; i--)
+    {
+        if (links[i - 1].target == target)
+        {
+            removeLink(i - 1);
+        }
+    }
+}
+
+
+bool BodySync::isLinked(b2Body *body)
+{
+    for (UTsize i = 0; i < links.size(); i++)
+    {
+        if (links[i].body == body)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void BodySync::purge()
+{
+    for (UTsize i = 0; i < links.size(); i++)
+    {
+        links[i].target->bodyLinkCount--;
+    }
+
+    links.clear();
+}
+
+
+void BodySync::sync()
+{
+    for (UTsize i = 0; i < links.size(); i++)
+    {
+        syncLink(links[i]);
+    }
+}
+
+
+void BodySync::savePrevious()
+{
+    for (UTsize i = 0; i < links.size(); i++)
+    {
+        Link& link = links[i];
+        link.previousPosition = link.body->GetPosition();
+        link.previousAngle    = link.body->GetAngle();
+    }
+}
+
+
+void BodySync::syncInterpolated(lmscalar alpha)
+{
+    lmscalar beta = 1 - alpha;
+
+    for (UTsize i = 0; i < links.size(); i++)
+    {
+        const Link&   link     = links[i];
+        const b2Vec2& position = link.body->GetPosition();
+
+        // Box2D doesn't wrap angles, they lerp as they are.
+        link.target->setX((position.x * alpha + link.previousPosition.x * beta) * pixelsPerMeter);
+        link.target->setY((position.y * alpha + link.previousPosition.y * beta) * pixelsPerMeter);
+        link.target->setRotation(link.body->GetAngle() * alpha + link.previousAngle * beta);
+    }
+}
+
+
+void BodySync::step(b2World *world, float32 timeStep, int velocityIterations, int positionIterations)
+{
+    if (world)
+    {
+        world->Step(timeStep, velocityIterations, positionIterations);
+    }
+
+    sync();
+}
+
+
+void BodySync::syncLink(const Link& link)
+{
+    const b2Vec2& position = link.body->GetPosition();
+
+    link.target->setX(position.x * pixelsPerMeter);
+    link.target->setY(position.y * pixelsPerMeter);
+    link.target->setRotation(link.body->GetAngle());
+}
+
+
+void BodySync::removeLink(UTsize index)
+{
+    links[index].target->bodyLinkCount--;
+    links.erase(index, true);
+}
+
+
+void BodySync::removeTarget(DisplayObject *target)
+{
+    for (UTsize i = 0; i < sSyncs.size() && target->bodyLinkCount; i++)
+    {
+        sSyncs[i]->unlinkTarget(target);
+    }
+}
+
+
+void BodySync::watchWorld(b2World *world)
+{
+    world->SetDestructionListener(&sBodyListener);
+}
+
+
+void BodySync::BodyListener::SayGoodbye(b2Body *body)
+{
+    for (UTsize i = 0; i < sSyncs.size(); i++)
+    {
+        sSyncs[i]->unlink(body);
+    }
+}
+
+
+void BodySync::BodyListener::SayGoodbye(b2World *world)
+{
+    PhysicsStepper::removeWorld(world);
+}
+}
@@ -0,0 +1,118 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#pragma once
+
+#include "loom/common/utils/utTypes.h"
+#include "loom/engine/loom2d/l2dDisplayObject.h"
+#include "loom/vendor/box2d/Box2D.h"
+
+namespace Loom2D
+{
+
+// Native side of the BodySync script class, moves DisplayObjects to the
+// position and angle of the Box2D bodies they are linked to, all of them
+// in one pass instead of a few script calls per body.
+class BodySync
+{
+public:
+
+    // Pixels in a meter of the physics world
+    lmscalar pixelsPerMeter;
+
+    BodySync();
+    ~BodySync();
+
+    // Links the target to the body, replacing the body's link if it has
+    // one, and moves it into place
+    void link(b2Body *body, DisplayObject *target);
+
+    // Drops the link of the body, returns false if it has none
+    bool unlink(b2Body *body);
+
+    // Drops the links of the target
+    void unlinkTarget(DisplayObject *target);
+
+    bool isLinked(b2Body *body);
+
+    // Drops all links
+    void purge();
+
+    // Moves every linked target into place
+    void sync();
+
+    // Remembers where every linked body is, call it before stepping to
+    // interpolate from there
+    void savePrevious();
+
+    // Moves every linked target between where its body was at the last
+    // savePrevious, at alpha 0, and where it is now, at alpha 1
+    void syncInterpolated(lmscalar alpha);
+
+    // Steps the world, then syncs
+    void step(b2World *world, float32 timeStep, int velocityIterations, int positionIterations);
+
+    inline int getNumLinks() const
+    {
+        return (int)links.size();
+    }
+
+    // Drops the links of a target that is about to be deleted from every
+    // BodySync
+    static void removeTarget(DisplayObject *target);
+
+    // Hears of the bodies of the world and of the world itself being
+    // destroyed, so links and steppers don't keep them
+    static void watchWorld(b2World *world);
+
+private:
+
+    struct Link
+    {
+        b2Body        *body;
+        DisplayObject *target;
+        // Transform at the last savePrevious
+        b2Vec2        previousPosition;
+        float32       previousAngle;
+    };
+
+    // Told about bodies being destroyed, set on the worlds of linked
+    // bodies
+    class BodyListener : public b2DestructionListener
+    {
+    public:
+        void SayGoodbye(b2Joint *joint) {}
+        void SayGoodbye(b2Fixture *fixture) {}
+        void SayGoodbye(b2Body *body);
+        void SayGoodbye(b2World *world);
+    };
+
+    void syncLink(const Link& link);
+
+    // Removes the link at the index and releases its target
+    void removeLink(UTsize index);
+
+    utArray<Link> links;
+
+    static BodyListener sBodyListener;
+
+    static utArray<BodySync *> sSyncs;
+};
+}
@@ -23,6 +23,8 @@
 #include "loom/engine/loom2d/l2dDisplayObjectContainer.h"
 #include "loom/engine/loom2d/l2dImage.h"
 #include "loom/engine/loom2d/l2dStage.h"
+#include "loom/engine/loom2d/l2dTweenScheduler.h"
+#include "loom/engine/loom2d/l2dBodySync.h"
 
 using namespace GFX;
 
@@ -31,6 +33,23 @@ namespace Loom2D
 Type       *DisplayObject::typeDisplayObject;
 lua_Number DisplayObject::_transformationMatrixOrdinal;
 bool       DisplayObject::cacheAsBitmapInProgress = false;
+uint32_t   DisplayObject::sDamagePass = 1;
+uint32_t   DisplayObject::sTransformVersion = 1;
+int        DisplayObject::sStaticBatchCount = 0;
+int        DisplayObject::sBitmapCacheCount = 0;
+
+DisplayObject::~DisplayObject()
+{
+    if (cacheAsBitmap && cacheAsBitmapAutoInvalidate) sBitmapCacheCount--;
+    if (tweenCount) TweenScheduler::removeTarget(this);
+    if (bodyLinkCount) BodySync::removeTarget(this);
+    lualoom_managedpointerreleased(this);
+}
+
+EventDispatcher *DisplayObject::getBubbleParent()
+{
+    return parent;
+}
 
 bool DisplayObject::renderCached(lua_State *L)
 {
@@ -43,12 +62,59 @@ bool DisplayObject::renderCached(lua_State *L)
     cached->transformMatrix.concat(&transformMatrix);
     cached->parent = parent;
 
+    // The cached image is not part of the hierarchy, nothing
+    // else depends on its world matrix
+    cached->worldVersion = 0;
+
     lualoom_pushnative<DisplayObject>(L, cached);
     cached->render(L);
     lua_pop(L, 1);
     return true;
 }
 
+void DisplayObject::drawMask(lua_State *L)
+{
+    DisplayObject *drawn = mask;
+    bool local = drawn->parent == NULL;
+
+    // Same as the cached image, placed under this object for the draw
+    Matrix maskTransform;
+    if (local)
+    {
+        drawn->updateLocalTransform();
+        updateLocalTransform();
+
+        maskTransform.copyFrom(&drawn->transformMatrix);
+        drawn->transformMatrix.concat(&transformMatrix);
+        drawn->parent = parent;
+
+        // World matrices cached below the mask while it was detached, or
+        // placed under another object, are stale
+        sTransformVersion++;
+    }
+
+    lualoom_pushnative<DisplayObject>(L, drawn);
+
+    if (drawn->needsValidate())
+    {
+        drawn->validate(L, lua_gettop(L));
+    }
+
+    // Masks on the display list are usually hidden there
+    bool drawnVisible = drawn->visible;
+    drawn->visible = true;
+    drawn->render(L);
+    drawn->visible = drawnVisible;
+    lua_pop(L, 1);
+
+    if (local)
+    {
+        drawn->transformMatrix.copyFrom(&maskTransform);
+        drawn->parent = NULL;
+        sTransformVersion++;
+    }
+}
+
 void DisplayObject::render(lua_State *L) {
     // Disable reentrancy for this function (read: don't cache to texture while caching to a texture)
     if (cacheAsBitmapInProgress) return;
@@ -88,10 +154,17 @@ void DisplayObject::render(lua_State *L) {
         Loom2D::Rectangle *bounds = (Loom2D::Rectangle*) lualoom_getnativepointer(L, -1);
         cacheAsBitmapOffsetX = bounds->x;
         cacheAsBitmapOffsetY = bounds->y;
-        lmscalar fracWidth = bounds->width;
-        lmscalar fracHeight = bounds->height;
+        lmscalar fracWidth = bounds->width * cacheAsBitmapScale;
+        lmscalar fracHeight = bounds->height * cacheAsBitmapScale;
         int texWidth = static_cast<int>(ceil(fracWidth));
         int texHeight = static_cast<int>(ceil(fracHeight));
+        if (texWidth < 1) texWidth = 1;
+        if (texHeight < 1) texHeight = 1;
+
+        // The quad stays at the size of the contents when cached at a
+        // lower resolution
+        float quadWidth = (float)(texWidth / cacheAsBitmapScale);
+        float quadHeight = (float)(texHeight / cacheAsBitmapScale);
         
         // pop bounds Rectangle and the DisplayObject at the top
         lua_pop(L, 1+1);
@@ -109,11 +182,12 @@ void DisplayObject::render(lua_State *L) {
         
         VertexPosColorTex* qv;
 
-        qv = &quad->quadVertices[0];  qv->x =               0;  qv->y =                0;  qv->z = 0; qv->abgr = 0xFFFFFFFF; qv->u = 0; qv->v = 0;
-        qv = &quad->quadVertices[1];  qv->x = (float)texWidth;  qv->y =                0;  qv->z = 0; qv->abgr = 0xFFFFFFFF; qv->u = 1; qv->v = 0;
-        qv = &quad->quadVertices[2];  qv->x =               0;  qv->y = (float)texHeight;  qv->z = 0; qv->abgr = 0xFFFFFFFF; qv->u = 0; qv->v = 1;
-        qv = &quad->quadVertices[3];  qv->x = (float)texWidth;  qv->y = (float)texHeight;  qv->z = 0; qv->abgr = 0xFFFFFFFF; qv->u = 1; qv->v = 1;
+        qv = &quad->quadVertices[0];  qv->x =         0;  qv->y =          0;  qv->z = 0; qv->abgr = 0xFFFFFFFF; qv->u = 0; qv->v = 0;
+        qv = &quad->quadVertices[1];  qv->x = quadWidth;  qv->y =          0;  qv->z = 0; qv->abgr = 0xFFFFFFFF; qv->u = 1; qv->v = 0;
+        qv = &quad->quadVertices[2];  qv->x =         0;  qv->y = quadHeight;  qv->z = 0; qv->abgr = 0xFFFFFFFF; qv->u = 0; qv->v = 1;
+        qv = &quad->quadVertices[3];  qv->x = quadWidth;  qv->y = quadHeight;  qv->z = 0; qv->abgr = 0xFFFFFFFF; qv->u = 1; qv->v = 1;
         quad->setNativeVertexDataInvalid(false);
+        quad->worldVerticesValid = false;
 
         lmAssert(Texture::getRenderTarget() == -1, "Unsupported render target state: %d", Texture::getRenderTarget());
 
@@ -124,6 +198,7 @@ void DisplayObject::render(lua_State *L) {
         // past the left and top edges don't get cut off, ignore other existing transforms
         Matrix trans;
         trans.translate(-cacheAsBitmapOffsetX, -cacheAsBitmapOffsetY);
+        trans.scale(cacheAsBitmapScale, cacheAsBitmapScale);
 
         // Setup for Graphics::render
         lualoom_pushnative<DisplayObject>(L, this);
@@ -146,9 +221,155 @@ void DisplayObject::render(lua_State *L) {
     }
 }
 
+void DisplayObject::updateRenderState()
+{
+    renderState.alpha = parent ? parent->renderState.alpha * alpha : alpha;
+    renderState.clampAlpha();
+    renderState.clipRect  = parent ? parent->renderState.clipRect : Loom2D::Rectangle(0, 0, -1, -1);
+    renderState.blendMode = (blendMode == BlendMode::AUTO && parent) ? parent->renderState.blendMode : blendMode;
+}
+
+bool DisplayObject::collectDamage(lua_State *L, DamageRegion &damage, Rectangle &bounds)
+{
+    // Plain display objects draw nothing themselves
+    noteDamage(damage, false, bounds, 0);
+    return false;
+}
+
+uint32_t DisplayObject::getDamageSignature(const Matrix &mtx)
+{
+    lmscalar state[11] = {
+        mtx.a, mtx.b, mtx.c, mtx.d, mtx.tx, mtx.ty,
+        renderState.alpha,
+        renderState.clipRect.x, renderState.clipRect.y, renderState.clipRect.width, renderState.clipRect.height
+    };
+    int flags[3] = { renderState.blendMode, blendEnabled, cacheAsBitmap | (cacheAsBitmapValid << 1) };
+
+    uint32_t signature = DamageRegion::hash(2166136261u, state, sizeof(state));
+    signature = DamageRegion::hash(signature, flags, sizeof(flags));
+
+    // Moving the mask changes what's drawn as well
+    if (mask)
+    {
+        Matrix *maskMatrix = mask->getWorldMatrix();
+        lmscalar maskState[6] = { maskMatrix->a, maskMatrix->b, maskMatrix->c, maskMatrix->d, maskMatrix->tx, maskMatrix->ty };
+        signature = DamageRegion::hash(signature, maskState, sizeof(maskState));
+    }
+
+    return signature;
+}
+
+void DisplayObject::noteDamage(DamageRegion &damage, bool drawn, const Rectangle &bounds, uint32_t signature, bool compareBounds)
+{
+    bool drawnBefore = damagePass == sDamagePass - 1;
+
+    if (!drawn)
+    {
+        if (drawnBefore) damage.add(damageBounds);
+        return;
+    }
+
+    bool changed = !drawnBefore || signature != damageSignature;
+    if (compareBounds)
+    {
+        changed = changed || bounds.x != damageBounds.x || bounds.y != damageBounds.y ||
+                  bounds.width != damageBounds.width || bounds.height != damageBounds.height;
+    }
+
+    if (changed)
+    {
+        if (drawnBefore) damage.add(damageBounds);
+        damage.add(bounds);
+    }
+
+    damageBounds    = bounds;
+    damageSignature = signature;
+    damagePass      = sDamagePass;
+}
+
+bool DisplayObject::collectCachedDamage(DamageRegion &damage, const Matrix &mtx, Rectangle &bounds)
+{
+    if (!cacheAsBitmap || !cacheAsBitmapValid) return false;
+
+    Quad *quad = static_cast<Quad*>(cachedImage);
+    lmAssert(quad != NULL, "Cached image is invalid");
+
+    Matrix cachedMtx;
+    cachedMtx.translate(cacheAsBitmapOffsetX, cacheAsBitmapOffsetY);
+    cachedMtx.concat(&mtx);
+
+    Rectangle local(0, 0, quad->quadVertices[3].x, quad->quadVertices[3].y);
+    transformBounds(&cachedMtx, &local, &bounds);
+    if (renderState.isClipping()) bounds.clip(renderState.clipRect.x, renderState.clipRect.y, renderState.clipRect.width, renderState.clipRect.height);
+
+    int textureID = quad->getNativeTextureID();
+    noteDamage(damage, true, bounds, DamageRegion::hash(getDamageSignature(mtx), &textureID, sizeof(textureID)));
+    return true;
+}
+
+void DisplayObject::invalidateParentStaticBatches()
+{
+    // Batches and caches of outer containers include those of inner ones
+    for (DisplayObjectContainer *container = parent; container; container = container->parent)
+    {
+        if (container->flatten) container->staticBatchValid = false;
+        if (container->cacheAsBitmap && container->cacheAsBitmapAutoInvalidate) container->cacheAsBitmapValid = false;
+    }
+}
+
+bool DisplayObject::prepareStaticBatch(lua_State *L)
+{
+    validate(L, lua_gettop(L));
+
+    // Only known to draw through the QuadRenderer if a subclass says so
+    return false;
+}
+
 /** Creates a matrix that represents the transformation from the local coordinate system
  *  to another. If you pass a 'resultMatrix', the result will be stored in this matrix
  *  instead of creating a new object. */
+Matrix *DisplayObject::getWorldMatrix()
+{
+    if (worldVersion != sTransformVersion)
+    {
+        updateLocalTransform();
+        worldMatrix.copyFrom(&transformMatrix);
+
+        if (parent)
+        {
+            worldMatrix.concat(parent->getWorldMatrix());
+        }
+
+        worldVersion = sTransformVersion;
+    }
+
+    return &worldMatrix;
+}
+
+// Concatenates the transforms from object up to, but not including,
+// ancestor onto result, handed to Matrix::concatChain a batch at a time
+static void concatTransformsUpTo(DisplayObject *object, DisplayObject *ancestor, Matrix *result)
+{
+    const Matrix *chain[16];
+    int          count = 0;
+
+    while (object != ancestor)
+    {
+        object->updateLocalTransform();
+        chain[count++] = &object->transformMatrix;
+
+        if (count == sizeof(chain) / sizeof(chain[0]))
+        {
+            result->concatChain(chain, count);
+            count = 0;
+        }
+
+        object = object->parent;
+    }
+
+    result->concatChain(chain, count);
+}
+
 void DisplayObject::getTargetTransformationMatrix(DisplayObject *targetSpace, Matrix *resultMatrix)
 {
     if (!resultMatrix)
@@ -174,6 +395,13 @@ void DisplayObject::getTargetTransformationMatrix(DisplayObject *targetSpace, Ma
         return;
     }
 
+    // targetCoordinateSpace 'null' represents the target space of the base object.
+    if (targetSpace == NULL)
+    {
+        resultMatrix->copyFrom(getWorldMatrix());
+        return;
+    }
+
     DisplayObject *base = this;
     while (base->parent)
     {
@@ -182,22 +410,11 @@ void DisplayObject::getTargetTransformationMatrix(DisplayObject *targetSpace, Ma
 
     DisplayObject *currentObject = NULL;
 
-    if ((targetSpace == NULL) || (targetSpace == base))
+    if (targetSpace == base)
     {
-        // targetCoordinateSpace 'null' represents the target space of the base object.
         // -> move up from this to base
 
-        currentObject = this;
-        while (currentObject != targetSpace)
-        {
-            if (currentObject->transformDirty) {
-                currentObject->updateLocalTransform();
-            }
-            resultMatrix->concat(&currentObject->transformMatrix);
-
-            currentObject = currentObject->parent;
-        }
-
+        concatTransformsUpTo(this, targetSpace, resultMatrix);
         return;
     }
     else if (targetSpace->parent == this) // optimization
@@ -240,15 +457,7 @@ void DisplayObject::getTargetTransformationMatrix(DisplayObject *targetSpace, Ma
 
     // 2. move up from this to common parent
 
-    currentObject = this;
-    while (currentObject != commonParent)
-    {
-        if (currentObject->transformDirty) {
-            currentObject->updateLocalTransform();
-        }
-        resultMatrix->concat(&currentObject->transformMatrix);
-        currentObject = currentObject->parent;
-    }
+    concatTransformsUpTo(this, commonParent, resultMatrix);
 
     if (commonParent == targetSpace)
     {
@@ -258,13 +467,7 @@ void DisplayObject::getTargetTransformationMatrix(DisplayObject *targetSpace, Ma
     // 3. now move up from target until we reach the common parent
 
     Matrix helperMatrix;
-    //helperMatrix.identity();
-    currentObject = targetSpace;
-    while (currentObject != commonParent)
-    {
-        helperMatrix.concat(&currentObject->transformMatrix);
-        currentObject = currentObject->parent;
-    }
+    concatTransformsUpTo(targetSpace, commonParent, &helperMatrix);
 
     // 4. now combine the two matrices
 
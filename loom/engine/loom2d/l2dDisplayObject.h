@@ -50,6 +50,56 @@ struct RenderState
     }
 };
 
+// Screen space region covering everything that changed since the last
+// frame, accumulated by the Stage when it only redraws dirty regions
+struct DamageRegion
+{
+    // set if the changes can't be bounded and everything is redrawn
+    bool full;
+    lmscalar minX, minY, maxX, maxY;
+
+    DamageRegion()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        full = false;
+        minX = minY = INFINITY;
+        maxX = maxY = -INFINITY;
+    }
+
+    inline bool isEmpty() const
+    {
+        return !full && (minX >= maxX || minY >= maxY);
+    }
+
+    void add(const Rectangle &rect)
+    {
+        if (rect.width <= 0 || rect.height <= 0)
+        {
+            return;
+        }
+
+        minX = lmMin(minX, rect.x);
+        minY = lmMin(minY, rect.y);
+        maxX = lmMax(maxX, rect.x + rect.width);
+        maxY = lmMax(maxY, rect.y + rect.height);
+    }
+
+    // FNV-1a, used for the signatures of how objects were drawn
+    static uint32_t hash(uint32_t seed, const void *data, size_t size)
+    {
+        const unsigned char *bytes = (const unsigned char *)data;
+        for (size_t i = 0; i < size; i++)
+        {
+            seed = (seed ^ bytes[i]) * 16777619u;
+        }
+        return seed;
+    }
+};
+
 class DisplayObject : public EventDispatcher
 {
     // true if caching is in progress, used for avoiding rendering to texture while rendering to texture 
@@ -127,12 +177,34 @@ public:
     lmscalar cacheAsBitmapOffsetX;
     // Y offset the cached image has to be rendered at
     lmscalar cacheAsBitmapOffsetY;
+    // true if changes below invalidate the cache, see invalidateContent
+    bool cacheAsBitmapAutoInvalidate;
+    // resolution of the cached image relative to the contents
+    lmscalar cacheAsBitmapScale;
 
     // should not set this directly
     DisplayObjectContainer *parent;
 
+    // Limits what's drawn to the quads the mask draws, see drawMask
+    DisplayObject *mask;
+
+    // Number of TweenScheduler tweens animating the object
+    int tweenCount;
+
+    // Number of BodySync links moving the object
+    int bodyLinkCount;
+
     Matrix transformMatrix;
 
+    // Transformation to the root of the hierarchy, cached while
+    // worldVersion matches sTransformVersion
+    Matrix   worldMatrix;
+    uint32_t worldVersion;
+
+    // Changed whenever any transform or parent changes, which makes
+    // all the cached world matrices stale at once
+    static uint32_t sTransformVersion;
+
     bool isEquivalent(lmscalar a, lmscalar b, lmscalar epsilon = 0.0001f)
     {
         return (a - epsilon < b) && (a + epsilon > b);
@@ -140,6 +212,17 @@ public:
 
     RenderState renderState;
 
+    // Screen bounds and signature of how the object was drawn in the
+    // damage pass it was last drawn in, only kept up to date while the
+    // Stage redraws dirty regions
+    Rectangle damageBounds;
+    uint32_t  damageSignature;
+    uint32_t  damagePass;
+
+    // the current damage pass, objects drawn in the previous one can be
+    // compared against what they looked like then
+    static uint32_t sDamagePass;
+
 public:
 
     static Type       *typeDisplayObject;
@@ -167,6 +250,9 @@ public:
         visible            = touchable = true;
         name               = stringtable_insert("");
         parent             = NULL;
+        mask               = NULL;
+        tweenCount         = 0;
+        bodyLinkCount      = 0;
         valid              = false;
         type               = NULL;
         imageOrDerived     = false;
@@ -174,6 +260,11 @@ public:
         cacheAsBitmap      = false;
         cacheAsBitmapValid = false;
         cachedImage        = NULL;
+        cacheAsBitmapAutoInvalidate = true;
+        cacheAsBitmapScale = 1;
+        damageSignature    = 0;
+        damagePass         = 0;
+        worldVersion       = 0;
     }
 
     DisplayObject()
@@ -182,12 +273,60 @@ public:
         type = typeDisplayObject;
     }
 
-    ~DisplayObject()
+    ~DisplayObject();
+
+    virtual void render(lua_State *L);
+
+    // Adds the screen regions this object changed since the last damage
+    // pass to the damage. Returns false if the object draws nothing,
+    // otherwise bounds are set to the screen bounds it draws into.
+    virtual bool collectDamage(lua_State *L, DamageRegion &damage, Rectangle &bounds);
+
+    // Starts a new damage pass, see collectDamage
+    static void beginDamagePass()
     {
-        lualoom_managedpointerreleased(this);
+        sDamagePass++;
     }
 
-    virtual void render(lua_State *L);
+    // Applies the inherited alpha, clipping and blend mode like render does
+    void updateRenderState();
+
+    // Signature of the render state and transform the object is drawn with
+    uint32_t getDamageSignature(const Matrix &mtx);
+
+    // Compares what the object draws now against the last damage pass and
+    // adds both the old and new bounds to the damage if they differ.
+    // Containers only compare the signature, their children report their
+    // own changes.
+    void noteDamage(DamageRegion &damage, bool drawn, const Rectangle &bounds, uint32_t signature, bool compareBounds = true);
+
+    // Damage of an object drawn from its bitmap cache, returns false if
+    // the object isn't drawn from a valid cache
+    bool collectCachedDamage(DamageRegion &damage, const Matrix &mtx, Rectangle &bounds);
+
+    enum NativeBounds
+    {
+        // What the object draws or responds to is only known to script
+        NATIVEBOUNDS_UNKNOWN,
+        // The object draws nothing
+        NATIVEBOUNDS_EMPTY,
+        // The bounds were set
+        NATIVEBOUNDS_KNOWN
+    };
+
+    // Bounds of what the object draws with the transform, computed
+    // natively from its last validated state
+    virtual NativeBounds getNativeBounds(const Matrix &mtx, Rectangle &bounds)
+    {
+        return NATIVEBOUNDS_UNKNOWN;
+    }
+
+    // True if validate has script work to do, objects that don't need
+    // it can be rendered without touching their script instance
+    virtual bool needsValidate() const
+    {
+        return !valid;
+    }
 
     virtual void validate(lua_State *L, int index)
     {
@@ -207,11 +346,74 @@ public:
         return parent;
     }
 
+    EventDispatcher *getBubbleParent();
+
     inline void setParent(DisplayObjectContainer *_parent)
     {
+        invalidateStaticBatches();
         parent = _parent;
+        sTransformVersion++;
+    }
+
+    inline void setMask(DisplayObject *_mask)
+    {
+        if (_mask == mask) return;
+        mask = _mask;
+        invalidateStaticBatches();
+    }
+
+    // Draws the mask into the QuadRenderer stencil mask being written or
+    // erased, a mask off the display list in the space of this object
+    void drawMask(lua_State *L);
+
+    inline void invalidateTransform()
+    {
+        transformDirty = true;
+        sTransformVersion++;
+        invalidateStaticBatches();
     }
 
+    // Number of containers baking their children into a static batch,
+    // changes only have to be reported up the hierarchy while there are any
+    static int sStaticBatchCount;
+
+    // Number of objects with a bitmap cache invalidated automatically,
+    // changes are reported up the hierarchy for them as well
+    static int sBitmapCacheCount;
+
+    // Tells the containers above that bake static batches or cache as
+    // bitmaps that what this object draws changed
+    inline void invalidateStaticBatches()
+    {
+        if (sStaticBatchCount || sBitmapCacheCount) invalidateParentStaticBatches();
+    }
+
+    // Like invalidateStaticBatches for changes to the contents of this
+    // object, which also makes its own bitmap cache stale
+    inline void invalidateContent()
+    {
+        if (cacheAsBitmap && cacheAsBitmapAutoInvalidate) cacheAsBitmapValid = false;
+        invalidateStaticBatches();
+    }
+
+    void invalidateParentStaticBatches();
+
+    // Validates the object on top of the stack and returns true if all
+    // it draws goes through the QuadRenderer, so it can be baked into
+    // the static batch of a container
+    virtual bool prepareStaticBatch(lua_State *L);
+
+    // True if drawing the object runs no script and no render to texture
+    inline bool hasOnlyNativeRender()
+    {
+        return !cacheAsBitmap && !mask && !getOnRenderDelegate()->getCount() && !getCustomRenderDelegate()->getCount();
+    }
+
+    // Returns the transformation from local to root space, computed
+    // from the parent's cached one so each object in the hierarchy is
+    // only visited once per change
+    Matrix *getWorldMatrix();
+
     inline void updateLocalTransform()
     {
         if (!transformDirty)
@@ -298,6 +500,8 @@ public:
         const Matrix *newM = (const Matrix *)lualoom_getnativepointer(L, 2);
 
         transformDirty = false;
+        sTransformVersion++;
+        invalidateStaticBatches();
 
         m->copyFrom(newM);
         transformMatrix.copyFrom(newM);
@@ -348,32 +552,9 @@ public:
         lmAssert(bounds != NULL, "Bounds are null");
         lmAssert(resultRect != NULL, "Result rect is null");
 
-        lmscalar rx, ry;
         lmscalar minx, miny, maxx, maxy;
-
-        transform->transformCoordInternal(bounds->getLeft(), bounds->getTop(), &rx, &ry);
-        minx = rx;
-        maxx = rx;
-        miny = ry;
-        maxy = ry;
-
-        transform->transformCoordInternal(bounds->getLeft(), bounds->getBottom(), &rx, &ry);
-        if (minx > rx) minx = rx;
-        if (maxx < rx) maxx = rx;
-        if (miny > ry) miny = ry;
-        if (maxy < ry) maxy = ry;
-
-        transform->transformCoordInternal(bounds->getRight(), bounds->getTop(), &rx, &ry);
-        if (minx > rx) minx = rx;
-        if (maxx < rx) maxx = rx;
-        if (miny > ry) miny = ry;
-        if (maxy < ry) maxy = ry;
-
-        transform->transformCoordInternal(bounds->getRight(), bounds->getBottom(), &rx, &ry);
-        if (minx > rx) minx = rx;
-        if (maxx < rx) maxx = rx;
-        if (miny > ry) miny = ry;
-        if (maxy < ry) maxy = ry;
+        transform->transformRectBounds(bounds->getLeft(), bounds->getTop(), bounds->getRight(), bounds->getBottom(),
+                                       &minx, &miny, &maxx, &maxy);
 
         resultRect->x = minx;
         resultRect->y = miny;
@@ -391,7 +572,7 @@ public:
 
     inline void setX(lmscalar _x)
     {
-        transformDirty = true;
+        invalidateTransform();
         x = _x;
     }
 
@@ -402,7 +583,7 @@ public:
 
     inline void setY(lmscalar _y)
     {
-        transformDirty = true;
+        invalidateTransform();
         y = _y;
     }
 
@@ -413,7 +594,7 @@ public:
 
     inline void setPivotX(lmscalar _pivotX)
     {
-        transformDirty = true;
+        invalidateTransform();
         pivotX         = _pivotX;
     }
 
@@ -424,7 +605,7 @@ public:
 
     inline void setPivotY(lmscalar _pivotY)
     {
-        transformDirty = true;
+        invalidateTransform();
         pivotY         = _pivotY;
     }
 
@@ -435,7 +616,7 @@ public:
 
     inline void setScaleX(lmscalar _scaleX)
     {
-        transformDirty = true;
+        invalidateTransform();
         scaleX         = _scaleX;
     }
 
@@ -446,13 +627,13 @@ public:
 
     inline void setScaleY(lmscalar _scaleY)
     {
-        transformDirty = true;
+        invalidateTransform();
         scaleY         = _scaleY;
     }
 
     inline void setScale(lmscalar _scale)
     {
-        transformDirty = true;
+        invalidateTransform();
         scaleX         = scaleY = _scale;
     }
 
@@ -468,7 +649,7 @@ public:
 
     inline void setSkewX(lmscalar _skewX)
     {
-        transformDirty = true;
+        invalidateTransform();
         skewX          = _skewX;
     }
 
@@ -479,7 +660,7 @@ public:
 
     inline void setSkewY(lmscalar _skewY)
     {
-        transformDirty = true;
+        invalidateTransform();
         skewY          = _skewY;
     }
 
@@ -490,7 +671,7 @@ public:
 
     inline void setRotation(lmscalar _rotation)
     {
-        transformDirty = true;
+        invalidateTransform();
         rotation       = _rotation;
     }
 
@@ -502,6 +683,7 @@ public:
     inline void setAlpha(lmscalar _alpha)
     {
         alpha = _alpha;
+        invalidateStaticBatches();
     }
 
     inline int getBlendMode() const
@@ -512,6 +694,7 @@ public:
     inline void setBlendMode(int _mode)
     {
         blendMode = _mode;
+        invalidateStaticBatches();
     }
 
     inline bool getBlendEnabled() const
@@ -522,6 +705,7 @@ public:
     inline void setBlendEnabled(bool _enabled)
     {
         blendEnabled = _enabled;
+        invalidateStaticBatches();
     }
 
     inline bool getVisible() const
@@ -532,6 +716,7 @@ public:
     inline void setVisible(bool _visible)
     {
         visible = _visible;
+        invalidateStaticBatches();
     }
 
     inline bool getTouchable() const
@@ -551,8 +736,35 @@ public:
 
     void setCacheAsBitmap(bool _cacheAsBitmap)
     {
-        if (!_cacheAsBitmap && cacheAsBitmap) invalidateBitmapCache();
+        if (_cacheAsBitmap == cacheAsBitmap) return;
+        if (cacheAsBitmap) invalidateBitmapCache();
+        if (cacheAsBitmapAutoInvalidate) sBitmapCacheCount += _cacheAsBitmap ? 1 : -1;
         cacheAsBitmap = _cacheAsBitmap;
+        invalidateStaticBatches();
+    }
+
+    bool getCacheAsBitmapAutoInvalidate() const
+    {
+        return cacheAsBitmapAutoInvalidate;
+    }
+
+    void setCacheAsBitmapAutoInvalidate(bool value)
+    {
+        if (value == cacheAsBitmapAutoInvalidate) return;
+        if (cacheAsBitmap) sBitmapCacheCount += value ? 1 : -1;
+        cacheAsBitmapAutoInvalidate = value;
+    }
+
+    lmscalar getCacheAsBitmapScale() const
+    {
+        return cacheAsBitmapScale;
+    }
+
+    void setCacheAsBitmapScale(lmscalar value)
+    {
+        if (value <= 0 || value == cacheAsBitmapScale) return;
+        cacheAsBitmapScale = value;
+        invalidateBitmapCache();
     }
 
     void invalidateBitmapCache()
@@ -570,6 +782,7 @@ public:
     inline void setValid(bool _valid)
     {
         valid = _valid;
+        if (!valid) invalidateContent();
     }
 
     inline lmscalar getDepth() const
@@ -580,6 +793,7 @@ public:
     inline void setDepth(lmscalar _depth)
     {
         depth = _depth;
+        invalidateStaticBatches();
     }
 
     inline const char *getName() const
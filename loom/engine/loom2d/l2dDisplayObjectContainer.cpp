@@ -33,19 +33,57 @@ namespace Loom2D
 Type       *DisplayObjectContainer::typeDisplayObjectContainer = NULL;
 lua_Number DisplayObjectContainer::childrenOrdinal             = -1;
 
-utArray<DisplayObjectSort> DisplayObjectContainer::sSortBucket;
+utArray<int> DisplayObjectContainer::sQueryResult;
+int          DisplayObjectContainer::sCullTested = 0;
+int          DisplayObjectContainer::sCullCulled = 0;
+
+// Orders by depth, children of equal depth keep their child order
+static inline bool DisplayObjectSortBefore(const DisplayObjectSort *first, const DisplayObjectSort *second)
+{
+    if (first->displayObject->depth == second->displayObject->depth)
+    {
+        return first->index < second->index;
+    }
+
+    return first->displayObject->depth < second->displayObject->depth;
+}
 
 static int DisplayObjectSortFunction(const void *pidx1, const void *pidx2)
 {
     DisplayObjectSort *first  = (DisplayObjectSort *)pidx1;
     DisplayObjectSort *second = (DisplayObjectSort *)pidx2;
 
-    if (first->displayObject->depth == second->displayObject->depth)
+    if (DisplayObjectSortBefore(first, second))
+    {
+        return -1;
+    }
+
+    // qsort may compare an element with itself or an equal one
+    return DisplayObjectSortBefore(second, first) ? 1 : 0;
+}
+
+
+// Script subclasses may override how an object is hit or bounded, its
+// native bounds don't tell which points or areas hit it then
+static bool DisplayObjectHasScriptBounds(DisplayObject *dobj)
+{
+    Type *type = dobj->type;
+
+    if (!type)
     {
-        return 0;
+        return true;
     }
 
-    return first->displayObject->depth > second->displayObject->depth ? 1 : -1;
+    if (type->isNative())
+    {
+        return false;
+    }
+
+    MemberInfo *hitTest   = type->findMember("hitTest");
+    MemberInfo *getBounds = type->findMember("getBounds");
+
+    return (hitTest && !hitTest->getDeclaringType()->isNative()) ||
+           (getBounds && !getBounds->getDeclaringType()->isNative());
 }
 
 
@@ -72,6 +110,38 @@ static inline void renderType(lua_State *L, Type *type, DisplayObject *dobj)
     }
 }
 
+// Erases the stencil mask written for the object
+static void endMask(lua_State *L, DisplayObject *masked)
+{
+    GFX::QuadRenderer::beginMaskErase();
+    masked->drawMask(L);
+    GFX::QuadRenderer::endMaskErase();
+}
+
+// Renders the object limited to its mask. Consecutive objects masked by
+// the same object on the display list share its stencil mask, masked is
+// the object the current one was written for and is erased by the caller
+// after the last one. Masks of objects drawn as part of a mask are ignored.
+static void renderTypeMasked(lua_State *L, DisplayObject *dobj, DisplayObject *&masked)
+{
+    DisplayObject *mask = dobj->visible && !GFX::QuadRenderer::isWritingMask() ? dobj->mask : NULL;
+
+    if (masked && !(mask == masked->mask && mask->parent))
+    {
+        endMask(L, masked);
+        masked = NULL;
+    }
+
+    if (mask && !masked && GFX::QuadRenderer::beginMaskWrite())
+    {
+        dobj->drawMask(L);
+        GFX::QuadRenderer::endMaskWrite();
+        masked = dobj;
+    }
+
+    renderType(L, dobj->type, dobj);
+}
+
 void DisplayObjectContainer::renderChildren(lua_State *L)
 {
     if (!visible)
@@ -98,28 +168,17 @@ void DisplayObjectContainer::renderChildren(lua_State *L)
         GFX::Graphics::setView(_view);
     } */
 
-    renderState.clipRect = parent ? parent->renderState.clipRect : Loom2D::Rectangle(0, 0, -1, -1);
+    renderState.clipRect = parent ? parent->renderState.clipRect : baseClipRect;
     renderState.blendMode = (parent && blendMode == BlendMode::AUTO) ? parent->renderState.blendMode : blendMode;
 
     int docidx = lua_gettop(L);
 
-    lua_rawgeti(L, docidx, (int)childrenOrdinal);
-
-    lua_rawgeti(L, -1, LSINDEXVECTOR);
-    int childrenVectorIdx = lua_gettop(L);
-
-    int numChildren = lsr_vector_get_length(L, -2);
-
-
-    if (_depthSort && ((int)sSortBucket.size() < numChildren))
-    {
-        sSortBucket.resize(numChildren);
-    }
+    if (childrenInvalid) updateChildren(L);
 
     // Is there a cliprect? If so, set it.
     if (clipWidth != -1 && clipHeight != -1)
     {
-        GFX::QuadRenderer::submit();
+        GFX::QuadRenderer::submit(GFX::FLUSH_CLIP);
 
         Matrix    res;
         Rectangle clipBounds = Rectangle((float)clipX, (float)clipY, (float)clipWidth, (float)clipHeight);
@@ -139,10 +198,270 @@ void DisplayObjectContainer::renderChildren(lua_State *L)
     // Checks if current clip rect is the same previous clip rect. If that is not the case objects are submitted for rendering before setting a new clip rect.
     if (renderState.isClipping() && !GFX::Graphics::checkClipRect((int)renderState.clipRect.x, (int)renderState.clipRect.y, (int)renderState.clipRect.width, (int)renderState.clipRect.height))
     {
-        GFX::QuadRenderer::submit();
+        GFX::QuadRenderer::submit(GFX::FLUSH_CLIP);
         GFX::Graphics::setClipRect((int)renderState.clipRect.x, (int)renderState.clipRect.y, (int)renderState.clipRect.width, (int)renderState.clipRect.height);
     }
 
+    // Containers flattened inside of another one are baked into its batch
+    bool capturing = GFX::QuadRenderer::isCapturing();
+
+    if (!flatten || capturing || !renderStaticBatch(L))
+    {
+        // Baked batches include everything, on screen or not
+        renderChildList(L, culling && !capturing);
+    }
+
+    lua_settop(L, docidx);
+
+    // Restore clip state.
+    if (renderState.isClipping() && (!parent || !parent->renderState.isClipping()))
+    {
+        GFX::QuadRenderer::submit(GFX::FLUSH_CLIP);
+        GFX::Graphics::clearClipRect();
+    }
+
+    // restore view
+/*    if (viewRestore != _view)
+    {
+        GFX::Graphics::setView(viewRestore);
+    }*/
+}
+
+void DisplayObjectContainer::renderChildList(lua_State *L, bool cull)
+{
+    int docidx = lua_gettop(L);
+
+    int numChildren = (int)children.size();
+
+    // Only looked up once a child needs its script instance
+    int childrenVectorIdx = 0;
+
+    // Everything drawn lands in the render target, or the clip rect
+    // within it, both in the same space as the world matrices
+    Rectangle view = renderState.isClipping() ? renderState.clipRect :
+        Rectangle(0, 0, (lmscalar)GFX::Graphics::getWidth(), (lmscalar)GFX::Graphics::getHeight());
+
+    // Child the current stencil mask was written for, if any
+    DisplayObject *masked = NULL;
+
+    for (int i = 0; i < numChildren; i++)
+    {
+        DisplayObject *dobj = children[i];
+
+        if (dobj->needsValidate())
+        {
+            if (!childrenVectorIdx)
+            {
+                lua_rawgeti(L, docidx, (int)childrenOrdinal);
+                lua_rawgeti(L, -1, LSINDEXVECTOR);
+                childrenVectorIdx = lua_gettop(L);
+            }
+
+            lua_rawgeti(L, childrenVectorIdx, i);
+            dobj->validate(L, lua_gettop(L));
+
+            // pop instance
+            lua_pop(L, 1);
+        }
+
+        if (!_depthSort && !(cull && isCulled(dobj, view)))
+        {
+            renderTypeMasked(L, dobj, masked);
+        }
+
+        // Script changed the children while validating or rendering,
+        // carry on from the same index in the new list
+        if (childrenInvalid)
+        {
+            lua_settop(L, docidx);
+            childrenVectorIdx = 0;
+
+            updateChildren(L);
+            numChildren = (int)children.size();
+        }
+    }
+
+    if (_depthSort)
+    {
+        sortDepthOrder();
+
+        for (int i = 0; i < numChildren; i++)
+        {
+            DisplayObjectSort *ds = &depthOrder[i];
+
+            if (cull && isCulled(ds->displayObject, view))
+            {
+                continue;
+            }
+
+            renderTypeMasked(L, ds->displayObject, masked);
+        }
+    }
+
+    if (masked)
+    {
+        endMask(L, masked);
+    }
+
+    lua_settop(L, docidx);
+}
+
+bool DisplayObjectContainer::renderStaticBatch(lua_State *L)
+{
+    // Anything changed since the last attempt, try baking again
+    if (!staticBatchValid)
+    {
+        staticBatchFailed = false;
+    }
+
+    if (staticBatchFailed)
+    {
+        return false;
+    }
+
+    // Vertex colors are baked with the alpha and blend mode inherited,
+    // and the buffer is lost with the context
+    if (!staticBatchValid || !staticBatch.isValid() ||
+        staticBatchAlpha != renderState.alpha || staticBatchBlendMode != renderState.blendMode)
+    {
+        if (!bakeStaticBatch(L))
+        {
+            staticBatchFailed = true;
+            staticBatchValid = true;
+            return false;
+        }
+
+        staticBatchValid = true;
+    }
+
+    GFX::QuadRenderer::drawStatic(&staticBatch, *getWorldMatrix());
+    return true;
+}
+
+bool DisplayObjectContainer::bakeStaticBatch(lua_State *L)
+{
+    // Anything drawn without going through the QuadRenderer would land on
+    // screen, and in the wrong place, so the whole subtree is checked first
+    if (!prepareChildren(L))
+    {
+        staticBatch.clear();
+        return false;
+    }
+
+    // Render the children in the space of the container
+    updateLocalTransform();
+
+    DisplayObjectContainer *prevParent = parent;
+    Matrix prevTransformMatrix;
+    prevTransformMatrix.copyFrom(&transformMatrix);
+    Rectangle prevClipRect = renderState.clipRect;
+
+    parent = NULL;
+    transformMatrix.identity();
+    renderState.clipRect = Rectangle(0, 0, -1, -1);
+    sTransformVersion++;
+
+    GFX::QuadRenderer::beginCapture(&staticBatch);
+    renderChildList(L, false);
+    bool captured = GFX::QuadRenderer::endCapture();
+
+    parent = prevParent;
+    transformMatrix.copyFrom(&prevTransformMatrix);
+    renderState.clipRect = prevClipRect;
+    sTransformVersion++;
+
+    staticBatchAlpha = renderState.alpha;
+    staticBatchBlendMode = renderState.blendMode;
+
+    return captured;
+}
+
+bool DisplayObjectContainer::prepareChildren(lua_State *L)
+{
+    int docidx = lua_gettop(L);
+
+    if (childrenInvalid) updateChildren(L);
+
+    lua_rawgeti(L, docidx, (int)childrenOrdinal);
+    lua_rawgeti(L, -1, LSINDEXVECTOR);
+    int childrenVectorIdx = lua_gettop(L);
+
+    bool result = true;
+
+    for (int i = 0; i < (int)children.size(); i++)
+    {
+        DisplayObject *dobj = children[i];
+
+        lua_rawgeti(L, childrenVectorIdx, i);
+        bool prepared = dobj->prepareStaticBatch(L);
+        lua_settop(L, childrenVectorIdx);
+
+        // Invisible children draw nothing, but may be shown any time
+        // without the batch being baked again
+        if ((!prepared && dobj->visible) || childrenInvalid)
+        {
+            result = false;
+            break;
+        }
+    }
+
+    lua_settop(L, docidx);
+    return result;
+}
+
+bool DisplayObjectContainer::prepareStaticBatch(lua_State *L)
+{
+    validate(L, lua_gettop(L));
+
+    return hasOnlyNativeRender() && prepareChildren(L);
+}
+
+bool DisplayObjectContainer::isCulled(DisplayObject *dobj, const Rectangle &view)
+{
+    if (!dobj->visible)
+    {
+        return false;
+    }
+
+    sCullTested++;
+
+    // Render delegates run script that may expect to be called every frame
+    if (dobj->getOnRenderDelegate()->getCount() || dobj->getCustomRenderDelegate()->getCount())
+    {
+        return false;
+    }
+
+    Rectangle bounds;
+    NativeBounds result = dobj->getNativeBounds(*dobj->getWorldMatrix(), bounds);
+
+    if (result == NATIVEBOUNDS_UNKNOWN)
+    {
+        return false;
+    }
+
+    if (result == NATIVEBOUNDS_KNOWN &&
+        bounds.x <= view.x + view.width && bounds.x + bounds.width >= view.x &&
+        bounds.y <= view.y + view.height && bounds.y + bounds.height >= view.y)
+    {
+        return false;
+    }
+
+    sCullCulled++;
+    return true;
+}
+
+void DisplayObjectContainer::updateChildren(lua_State *L)
+{
+    int docidx = lua_gettop(L);
+
+    lua_rawgeti(L, docidx, (int)childrenOrdinal);
+
+    lua_rawgeti(L, -1, LSINDEXVECTOR);
+    int childrenVectorIdx = lua_gettop(L);
+
+    int numChildren = lsr_vector_get_length(L, -2);
+    children.resize(numChildren);
+
     for (int i = 0; i < numChildren; i++)
     {
         lua_rawgeti(L, childrenVectorIdx, i);
@@ -151,54 +470,330 @@ void DisplayObjectContainer::renderChildren(lua_State *L)
 
         lua_rawgeti(L, -1, LSINDEXTYPE);
         dobj->type = (Type *)lua_topointer(L, -1);
-        lua_pop(L, 1);
 
-        dobj->validate(L, lua_gettop(L));
+        children[i] = dobj;
+
+        // pop type and instance
+        lua_pop(L, 2);
+    }
+
+    lua_settop(L, docidx);
 
-        if (!_depthSort)
+    childrenInvalid = false;
+
+    // The indices in the draw order are no longer those of the children
+    depthOrder.clear(true);
+
+    childBoundsValid = false;
+}
+
+void DisplayObjectContainer::updateChildBounds()
+{
+    // Vertex data and vector graphics can change without a transform
+    // change, so bounds are recomputed at least once a frame
+    uint32_t frame = GFX::Graphics::getCurrentFrame();
+    if (childBoundsValid && childBoundsFrame == frame && childBoundsVersion == sTransformVersion)
+    {
+        return;
+    }
+
+    UTsize numChildren = children.size();
+    childBounds.resize(numChildren);
+    childBounded.resize(numChildren);
+
+    for (UTsize i = 0; i < numChildren; i++)
+    {
+        DisplayObject *dobj = children[i];
+
+        // Pending script validation may change what the child draws
+        NativeBounds result = NATIVEBOUNDS_UNKNOWN;
+        if (!dobj->needsValidate() && !DisplayObjectHasScriptBounds(dobj))
         {
-            renderType(L, dobj->type, dobj);
+            dobj->updateLocalTransform();
+            result = dobj->getNativeBounds(dobj->transformMatrix, childBounds[i]);
         }
-        else
+
+        if (result == NATIVEBOUNDS_EMPTY)
         {
-            sSortBucket[i].index         = i;
-            sSortBucket[i].displayObject = dobj;
+            childBounds[i].setTo(0, 0, 0, 0);
         }
 
-        // pop instance
+        // Empty children can still be hit through script
+        childBounded[i] = result == NATIVEBOUNDS_KNOWN;
+    }
+
+    childBoundsValid = true;
+    childBoundsFrame = frame;
+    childBoundsVersion = sTransformVersion;
+    spatialGridValid = false;
+}
+
+int DisplayObjectContainer::getChildrenInRect(lua_State *L)
+{
+    lmscalar x = (lmscalar)lua_tonumber(L, 2);
+    lmscalar y = (lmscalar)lua_tonumber(L, 3);
+    lmscalar width = (lmscalar)lua_tonumber(L, 4);
+    lmscalar height = (lmscalar)lua_tonumber(L, 5);
+    bool touchableOnly = lua_toboolean(L, 6) != 0;
+    int resultIdx = 7;
+
+    if (childrenInvalid)
+    {
+        lua_pushvalue(L, 1);
+        updateChildren(L);
         lua_pop(L, 1);
     }
 
-    if (_depthSort)
+    updateChildBounds();
+
+    int numChildren = (int)children.size();
+
+    if (spatialIndex)
     {
-        qsort(sSortBucket.ptr(), numChildren, sizeof(DisplayObjectSort), DisplayObjectSortFunction);
+        if (!spatialGridValid)
+        {
+            spatialGrid.build(childBounds.ptr(), childBounded.ptr(), numChildren);
+            spatialGridValid = true;
+        }
+
+        spatialGrid.query(x, y, width, height, sQueryResult);
+    }
+    else
+    {
+        sQueryResult.clear(true);
 
         for (int i = 0; i < numChildren; i++)
         {
-            DisplayObjectSort *ds = &sSortBucket[i];
+            const Rectangle &b = childBounds[i];
+            if (!childBounded[i] ||
+                (x <= b.x + b.width && x + width >= b.x && y <= b.y + b.height && y + height >= b.y))
+            {
+                sQueryResult.push_back(i);
+            }
+        }
+    }
 
-            lua_rawgeti(L, childrenVectorIdx, ds->index);
+    lua_rawgeti(L, 1, (int)childrenOrdinal);
+    lua_rawgeti(L, -1, LSINDEXVECTOR);
+    int childrenVectorIdx = lua_gettop(L);
 
-            renderType(L, ds->displayObject->type, ds->displayObject);
+    lua_rawgeti(L, resultIdx, LSINDEXVECTOR);
+    int resultTbl = lua_gettop(L);
 
-            // pop instance
-            lua_pop(L, 1);
+    // Front to back, the order hit testing wants them in
+    int count = 0;
+    for (int i = (int)sQueryResult.size() - 1; i >= 0; i--)
+    {
+        int index = sQueryResult[i];
+        DisplayObject *dobj = children[index];
+
+        if (touchableOnly && (!dobj->visible || !dobj->touchable))
+        {
+            continue;
         }
+
+        lua_pushnumber(L, count++);
+        lua_rawgeti(L, childrenVectorIdx, index);
+        lua_rawset(L, resultTbl);
     }
 
-    lua_settop(L, docidx);
+    lsr_vector_set_length(L, resultIdx, count);
 
-    // Restore clip state.
-    if (renderState.isClipping() && (!parent || !parent->renderState.isClipping()))
+    lua_settop(L, resultIdx);
+    return 1;
+}
+
+DisplayObject::NativeBounds DisplayObjectContainer::getNativeBounds(const Matrix &mtx, Rectangle &bounds)
+{
+    // Children changed since the last render, only script knows them
+    if (childrenInvalid)
     {
-        GFX::QuadRenderer::submit();
-        GFX::Graphics::clearClipRect();
+        return NATIVEBOUNDS_UNKNOWN;
     }
 
-    // restore view
-/*    if (viewRestore != _view)
+    lmscalar minx = INFINITY, maxx = -INFINITY;
+    lmscalar miny = INFINITY, maxy = -INFINITY;
+
+    for (UTsize i = 0; i < children.size(); i++)
     {
-        GFX::Graphics::setView(viewRestore);
-    }*/
+        DisplayObject *dobj = children[i];
+
+        if (!dobj->visible)
+        {
+            continue;
+        }
+
+        if (dobj->needsValidate() || dobj->getOnRenderDelegate()->getCount() ||
+            DisplayObjectHasScriptBounds(dobj))
+        {
+            return NATIVEBOUNDS_UNKNOWN;
+        }
+
+        dobj->updateLocalTransform();
+
+        Matrix childMatrix;
+        childMatrix.copyFrom(&dobj->transformMatrix);
+        childMatrix.concat(&mtx);
+
+        Rectangle childBounds;
+        NativeBounds result = dobj->getNativeBounds(childMatrix, childBounds);
+
+        if (result == NATIVEBOUNDS_UNKNOWN)
+        {
+            return NATIVEBOUNDS_UNKNOWN;
+        }
+
+        if (result == NATIVEBOUNDS_KNOWN)
+        {
+            minx = lmMin(minx, childBounds.x);
+            miny = lmMin(miny, childBounds.y);
+            maxx = lmMax(maxx, childBounds.x + childBounds.width);
+            maxy = lmMax(maxy, childBounds.y + childBounds.height);
+        }
+    }
+
+    if (minx > maxx)
+    {
+        return NATIVEBOUNDS_EMPTY;
+    }
+
+    bounds.setTo(minx, miny, maxx - minx, maxy - miny);
+    return NATIVEBOUNDS_KNOWN;
+}
+
+void DisplayObjectContainer::sortDepthOrder()
+{
+    UTsize numChildren = children.size();
+
+    if (depthOrder.size() != numChildren)
+    {
+        depthOrder.resize(numChildren);
+
+        for (UTsize i = 0; i < numChildren; i++)
+        {
+            depthOrder[i].index         = (int)i;
+            depthOrder[i].displayObject = children[i];
+        }
+
+        qsort(depthOrder.ptr(), numChildren, sizeof(DisplayObjectSort), DisplayObjectSortFunction);
+        return;
+    }
+
+    // Depths mostly stay the same from frame to frame, so the last order
+    // is close to sorted and insertion sort only moves what changed
+    DisplayObjectSort *order = depthOrder.ptr();
+    for (UTsize i = 1; i < numChildren; i++)
+    {
+        if (!DisplayObjectSortBefore(&order[i], &order[i - 1]))
+        {
+            continue;
+        }
+
+        DisplayObjectSort moved = order[i];
+        UTsize j = i;
+        while (j > 0 && DisplayObjectSortBefore(&moved, &order[j - 1]))
+        {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = moved;
+    }
+}
+
+bool DisplayObjectContainer::collectDamage(lua_State *L, DamageRegion &damage, Rectangle &bounds)
+{
+    updateRenderState();
+    if (!parent) renderState.clipRect = baseClipRect;
+
+    if (!visible || renderState.alpha == 0.0f)
+    {
+        noteDamage(damage, false, bounds, 0);
+        return false;
+    }
+
+    updateLocalTransform();
+
+    Matrix mtx;
+    getTargetTransformationMatrix(NULL, &mtx);
+
+    if (collectCachedDamage(damage, mtx, bounds))
+        return true;
+
+    if (clipWidth != -1 && clipHeight != -1)
+    {
+        Rectangle clipBounds = Rectangle((float)clipX, (float)clipY, (float)clipWidth, (float)clipHeight);
+        Rectangle clipResult;
+        transformBounds(&mtx, &clipBounds, &clipResult);
+
+        if (!renderState.isClipping()) {
+            renderState.clipRect = Rectangle(clipResult);
+        }
+        else
+        {
+            renderState.clipRect.clip(clipResult.x, clipResult.y, clipResult.width, clipResult.height);
+        }
+    }
+
+    int docidx = lua_gettop(L);
+
+    lua_rawgeti(L, docidx, (int)childrenOrdinal);
+
+    lua_rawgeti(L, -1, LSINDEXVECTOR);
+    int childrenVectorIdx = lua_gettop(L);
+
+    int numChildren = lsr_vector_get_length(L, -2);
+
+    // The children and their draw order, anything added, removed or
+    // reordered damages the whole container
+    uint32_t signature = DamageRegion::hash(2166136261u, &cacheAsBitmap, sizeof(cacheAsBitmap));
+    lmscalar minx = INFINITY, maxx = -INFINITY;
+    lmscalar miny = INFINITY, maxy = -INFINITY;
+
+    for (int i = 0; i < numChildren; i++)
+    {
+        lua_rawgeti(L, childrenVectorIdx, i);
+
+        DisplayObject *dobj = (DisplayObject *)lualoom_getnativepointer(L, -1);
+
+        lua_rawgeti(L, -1, LSINDEXTYPE);
+        dobj->type = (Type *)lua_topointer(L, -1);
+        lua_pop(L, 1);
+
+        dobj->validate(L, lua_gettop(L));
+
+        signature = DamageRegion::hash(signature, &dobj, sizeof(dobj));
+        if (_depthSort) signature = DamageRegion::hash(signature, &dobj->depth, sizeof(dobj->depth));
+
+        // Script rendering can't be bounded
+        if (dobj->visible && (dobj->getOnRenderDelegate()->getCount() ||
+            ((dobj->type->getBaseType() == DisplayObject::typeDisplayObject) && dobj->getCustomRenderDelegate()->getCount())))
+        {
+            damage.full = true;
+        }
+
+        Rectangle childBounds;
+        if (dobj->visible && dobj->collectDamage(L, damage, childBounds))
+        {
+            minx = lmMin(minx, childBounds.x);
+            miny = lmMin(miny, childBounds.y);
+            maxx = lmMax(maxx, childBounds.x + childBounds.width);
+            maxy = lmMax(maxy, childBounds.y + childBounds.height);
+        }
+        else if (!dobj->visible)
+        {
+            dobj->noteDamage(damage, false, childBounds, 0);
+        }
+
+        // pop instance
+        lua_pop(L, 1);
+    }
+
+    lua_settop(L, docidx);
+
+    bool drawn = minx < maxx && miny < maxy;
+    if (drawn) bounds.setTo(minx, miny, maxx - minx, maxy - miny);
+
+    noteDamage(damage, drawn, bounds, signature, false);
+    return drawn;
 }
 }
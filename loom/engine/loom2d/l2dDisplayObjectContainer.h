@@ -22,6 +22,8 @@
 
 #include "loom/common/utils/utTypes.h"
 #include "loom/engine/loom2d/l2dDisplayObject.h"
+#include "loom/engine/loom2d/l2dSpatialGrid.h"
+#include "loom/graphics/gfxQuadRenderer.h"
 
 namespace Loom2D
 {
@@ -33,10 +35,57 @@ struct DisplayObjectSort
 
 class DisplayObjectContainer : public DisplayObject
 {
-    static utArray<DisplayObjectSort> sSortBucket;
+    // Children in draw order when depth sorting, kept between frames so
+    // static depths only cost a check that the order still holds
+    utArray<DisplayObjectSort> depthOrder;
+
+    void sortDepthOrder();
+
+    // Bounds of the children in the space of the container, as of the
+    // frame and transform version they were computed at
+    utArray<Rectangle> childBounds;
+    utArray<bool>      childBounded;
+    bool               childBoundsValid;
+    uint32_t           childBoundsFrame;
+    uint32_t           childBoundsVersion;
+
+    SpatialGrid spatialGrid;
+    bool        spatialGridValid;
+
+    void updateChildBounds();
+
+    static utArray<int> sQueryResult;
+
+    // True if the child is entirely outside of the view rectangle, which
+    // is in the space of the render target
+    bool isCulled(DisplayObject *dobj, const Rectangle &view);
+
+    // Validates and renders the children of the container on top of the
+    // stack, in depth order if sorting
+    void renderChildList(lua_State *L, bool cull);
+
+    // What the children drew when baked, in the space of the container,
+    // and the state it was baked with
+    GFX::QuadStaticBatch staticBatch;
+    bool                 staticBatchFailed;
+    lmscalar             staticBatchAlpha;
+    int                  staticBatchBlendMode;
+
+    // Draws the children from the static batch, baking it first if stale.
+    // Returns false if they can't be baked and have to be rendered.
+    bool renderStaticBatch(lua_State *L);
+    bool bakeStaticBatch(lua_State *L);
+
+    // Validates the children and returns true if all of them can be baked
+    bool prepareChildren(lua_State *L);
 
 public:
 
+    // Children tested for culling during the current frame and how many
+    // of them were skipped, reported by the stage
+    static int sCullTested;
+    static int sCullCulled;
+
     DisplayObjectContainer()
     {
         type       = typeDisplayObjectContainer;
@@ -44,6 +93,22 @@ public:
         _view      = 0;
         clipX      = clipY = 0;
         clipWidth  = clipHeight = -1;
+        baseClipRect = Rectangle(0, 0, -1, -1);
+        childrenInvalid = true;
+        childBoundsValid = false;
+        spatialIndex = false;
+        spatialGridValid = false;
+        culling = true;
+        flatten = false;
+        staticBatchValid = false;
+        staticBatchFailed = false;
+        staticBatchAlpha = 0;
+        staticBatchBlendMode = 0;
+    }
+
+    ~DisplayObjectContainer()
+    {
+        if (flatten) sStaticBatchCount--;
     }
 
     bool _depthSort;
@@ -56,8 +121,51 @@ public:
     inline void setDepthSort(bool value)
     {
         _depthSort = value;
+        staticBatchValid = false;
+        invalidateStaticBatches();
+    }
+
+    // If set, children whose bounds are known natively and fall entirely
+    // outside the render target or clip rect are not rendered
+    bool culling;
+
+    inline bool getCulling() const
+    {
+        return culling;
+    }
+
+    inline void setCulling(bool value)
+    {
+        culling = value;
+    }
+
+    // If set, what the children draw is baked into a vertex buffer once
+    // and drawn from there with a single transform, until any of the
+    // descendants changes. Subtrees drawing anything the QuadRenderer
+    // can't capture are rendered normally.
+    bool flatten;
+
+    // Cleared whenever a descendant changes, see invalidateStaticBatches
+    bool staticBatchValid;
+
+    inline bool getFlatten() const
+    {
+        return flatten;
+    }
+
+    inline void setFlatten(bool value)
+    {
+        if (value == flatten) return;
+
+        flatten = value;
+        sStaticBatchCount += flatten ? 1 : -1;
+        staticBatchValid = false;
+
+        if (!flatten) staticBatch.clear();
     }
 
+    bool prepareStaticBatch(lua_State *L);
+
     // DisplayObjectContainers may specify a view which their children
     // will render into
     int _view;
@@ -82,11 +190,58 @@ public:
         clipHeight = _clipHeight;
     }
 
+    // Clipping of the children when rendered without a parent, the Stage
+    // sets it to the damaged region when only redrawing dirty regions
+    Rectangle baseClipRect;
+
+    // Native copy of the script side child list, rebuilt on the next
+    // render after script changes the children
+    utArray<DisplayObject *> children;
+    bool childrenInvalid;
+
+    // Called by script whenever mChildren is modified
+    void invalidateChildren()
+    {
+        childrenInvalid = true;
+        staticBatchValid = false;
+        invalidateContent();
+    }
+
+    // Expects the container on top of the stack like renderChildren
+    void updateChildren(lua_State *L);
+
+    // If set, the bounds of the children are kept in a grid so
+    // getChildrenInRect only tests the children near the queried area
+    bool spatialIndex;
+
+    inline bool getSpatialIndex() const
+    {
+        return spatialIndex;
+    }
+
+    inline void setSpatialIndex(bool value)
+    {
+        spatialIndex = value;
+        spatialGridValid = false;
+    }
+
+    // getChildrenInRect(x, y, width, height, touchableOnly, result), fills
+    // the result vector with the children whose bounds overlap the
+    // rectangle in local space, frontmost first. Children whose bounds
+    // aren't known natively, including script subclasses overriding
+    // hitTest or getBounds, are always included
+    int getChildrenInRect(lua_State *L);
+
+    NativeBounds getNativeBounds(const Matrix &mtx, Rectangle &bounds);
+
     static Type       *typeDisplayObjectContainer;
     static lua_Number childrenOrdinal;
 
     void renderChildren(lua_State *L);
 
+    // Expects the container on top of the stack like renderChildren
+    bool collectDamage(lua_State *L, DamageRegion &damage, Rectangle &bounds);
+
     void render(lua_State *L)
     {
         renderContainer<DisplayObjectContainer>(L, this);
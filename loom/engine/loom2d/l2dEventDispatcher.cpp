@@ -0,0 +1,311 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/engine/loom2d/l2dEventDispatcher.h"
+
+#include "loom/script/native/lsNativeInterface.h"
+
+namespace Loom2D
+{
+Type       *EventDispatcher::typeEvent = NULL;
+lua_Number EventDispatcher::typeOrdinal                      = -1;
+lua_Number EventDispatcher::currentTargetOrdinal             = -1;
+lua_Number EventDispatcher::dataOrdinal                      = -1;
+lua_Number EventDispatcher::stopsPropagationOrdinal          = -1;
+lua_Number EventDispatcher::stopsImmediatePropagationOrdinal = -1;
+
+StringTableEntry EventDispatcher::getEventType(lua_State *L, int eventIdx)
+{
+    // events can be dispatched before Loom2DNative.initialize
+    if (!typeEvent)
+    {
+        initialize(L);
+    }
+
+    lua_rawgeti(L, eventIdx, (int)typeOrdinal);
+    const char *type = lua_tostring(L, -1);
+    StringTableEntry entry = stringtable_insert(type ? type : "");
+    lua_pop(L, 1);
+
+    return entry;
+}
+
+int EventDispatcher::addEventListener(lua_State *L)
+{
+    const char *typeName = lua_tostring(L, 2);
+    StringTableEntry type = stringtable_insert(typeName ? typeName : "");
+
+    lmAssert(lua_isfunction(L, 3), "Got unexpected null listener for event type %s.", type);
+
+    lua_rawgeti(L, 1, LSINDEXEVENTLISTENERS);
+
+    if (!lua_istable(L, -1))
+    {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_rawseti(L, 1, LSINDEXEVENTLISTENERS);
+    }
+
+    int functionsIdx = lua_gettop(L);
+
+    ListenerList *list = NULL;
+
+    for (UTsize i = 0; i < listeners.size(); i++)
+    {
+        if (listeners[i].type == type)
+        {
+            list = &listeners[i];
+            break;
+        }
+    }
+
+    if (list)
+    {
+        // check for duplicates
+        for (UTsize i = 0; i < list->slots.size(); i++)
+        {
+            lua_rawgeti(L, functionsIdx, list->slots[i]);
+            bool duplicate = lua_rawequal(L, -1, 3) != 0;
+            lua_pop(L, 1);
+
+            if (duplicate)
+            {
+                lua_settop(L, functionsIdx - 1);
+                return 0;
+            }
+        }
+    }
+    else
+    {
+        listeners.push_back(ListenerList());
+        list = &listeners[listeners.size() - 1];
+        list->type = type;
+    }
+
+    int slot = nextListenerSlot++;
+
+    lua_pushvalue(L, 3);
+    lua_rawseti(L, functionsIdx, slot);
+    list->slots.push_back(slot);
+
+    lua_settop(L, functionsIdx - 1);
+    return 0;
+}
+
+int EventDispatcher::removeEventListener(lua_State *L)
+{
+    const char *typeName = lua_tostring(L, 2);
+    ListenerList *list = findListeners(stringtable_insert(typeName ? typeName : ""));
+
+    if (!list)
+    {
+        return 0;
+    }
+
+    lua_rawgeti(L, 1, LSINDEXEVENTLISTENERS);
+    int functionsIdx = lua_gettop(L);
+
+    for (UTsize i = 0; i < list->slots.size(); i++)
+    {
+        lua_rawgeti(L, functionsIdx, list->slots[i]);
+        bool match = lua_rawequal(L, -1, 3) != 0;
+        lua_pop(L, 1);
+
+        if (match)
+        {
+            lua_pushnil(L);
+            lua_rawseti(L, functionsIdx, list->slots[i]);
+            list->slots.erase(i, true);
+            break;
+        }
+    }
+
+    lua_settop(L, functionsIdx - 1);
+    return 0;
+}
+
+int EventDispatcher::removeEventListeners(lua_State *L)
+{
+    const char *typeName = lua_tostring(L, 2);
+
+    if (!typeName)
+    {
+        listeners.clear();
+        nextListenerSlot = 1;
+
+        lua_pushnil(L);
+        lua_rawseti(L, 1, LSINDEXEVENTLISTENERS);
+        return 0;
+    }
+
+    ListenerList *list = findListeners(stringtable_insert(typeName));
+
+    if (!list)
+    {
+        return 0;
+    }
+
+    lua_rawgeti(L, 1, LSINDEXEVENTLISTENERS);
+    int functionsIdx = lua_gettop(L);
+
+    for (UTsize i = 0; i < list->slots.size(); i++)
+    {
+        lua_pushnil(L);
+        lua_rawseti(L, functionsIdx, list->slots[i]);
+    }
+
+    list->slots.clear();
+
+    lua_settop(L, functionsIdx - 1);
+    return 0;
+}
+
+bool EventDispatcher::invokeListeners(lua_State *L, int instanceIdx, int eventIdx, StringTableEntry type)
+{
+    ListenerList *list = findListeners(type);
+
+    if (!list)
+    {
+        return false;
+    }
+
+    int numListeners = (int)list->slots.size();
+
+    lmAssert(lua_checkstack(L, numListeners + 4), "Unable to grow the stack for %d listeners", numListeners);
+
+    int top = lua_gettop(L);
+
+    // Push the functions first, listeners added or removed while we're
+    // calling them take effect with the next dispatch
+    lua_rawgeti(L, instanceIdx, LSINDEXEVENTLISTENERS);
+    int functionsIdx = lua_gettop(L);
+
+    for (int i = 0; i < numListeners; i++)
+    {
+        lua_rawgeti(L, functionsIdx, list->slots[i]);
+    }
+
+    lua_pushvalue(L, instanceIdx);
+    lua_rawseti(L, eventIdx, (int)currentTargetOrdinal);
+
+    for (int i = 0; i < numListeners; i++)
+    {
+        int listenerIdx = functionsIdx + 1 + i;
+        int numArgs = lualoom_getfunctionparametercount(L, listenerIdx);
+
+        lua_pushvalue(L, listenerIdx);
+
+        if (numArgs == 0)
+        {
+            lua_call(L, 0, 0);
+        }
+        else if (numArgs == 1)
+        {
+            lua_pushvalue(L, eventIdx);
+            lua_call(L, 1, 0);
+        }
+        else
+        {
+            lua_pushvalue(L, eventIdx);
+            lua_rawgeti(L, eventIdx, (int)dataOrdinal);
+            lua_call(L, 2, 0);
+        }
+
+        lua_rawgeti(L, eventIdx, (int)stopsImmediatePropagationOrdinal);
+        bool stopsImmediatePropagation = lua_toboolean(L, -1) != 0;
+        lua_pop(L, 1);
+
+        if (stopsImmediatePropagation)
+        {
+            lua_settop(L, top);
+            return true;
+        }
+    }
+
+    lua_rawgeti(L, eventIdx, (int)stopsPropagationOrdinal);
+    bool stopsPropagation = lua_toboolean(L, -1) != 0;
+
+    lua_settop(L, top);
+    return stopsPropagation;
+}
+
+int EventDispatcher::invokeEvent(lua_State *L)
+{
+    StringTableEntry type = getEventType(L, 2);
+
+    lua_pushboolean(L, invokeListeners(L, 1, 2, type) ? 1 : 0);
+    return 1;
+}
+
+int EventDispatcher::bubbleEvent(lua_State *L)
+{
+    StringTableEntry type = getEventType(L, 2);
+
+    // we determine the bubble chain before starting to invoke the listeners.
+    // that way, changes done by the listeners won't affect the bubble chain.
+    // The instances are kept on the stack so they stay alive meanwhile.
+    int chainStart = lua_gettop(L) + 1;
+
+    for (EventDispatcher *dispatcher = this; dispatcher; dispatcher = dispatcher->getBubbleParent())
+    {
+        if (!dispatcher->findListeners(type))
+        {
+            continue;
+        }
+
+        lmAssert(lua_checkstack(L, 1), "Unable to grow the stack for the bubble chain");
+
+        if (dispatcher == this)
+        {
+            lua_pushvalue(L, 1);
+        }
+        else
+        {
+            lualoom_pushnative<EventDispatcher>(L, dispatcher);
+        }
+    }
+
+    int chainEnd = lua_gettop(L);
+
+    for (int i = chainStart; i <= chainEnd; i++)
+    {
+        // a listener may have deleted one of the parents
+        lua_rawgeti(L, i, LSINDEXDELETEDMANAGED);
+        bool deleted = lua_toboolean(L, -1) != 0;
+        lua_pop(L, 1);
+
+        if (deleted)
+        {
+            continue;
+        }
+
+        EventDispatcher *dispatcher = (EventDispatcher *)lualoom_getnativepointer(L, i);
+
+        if (dispatcher->invokeListeners(L, i, 2, type))
+        {
+            break;
+        }
+    }
+
+    lua_settop(L, chainStart - 1);
+    return 0;
+}
+}
@@ -19,17 +19,110 @@
  */
 
 #include "loom/script/loomscript.h"
+#include "loom/common/core/stringTable.h"
+#include "loom/common/utils/utTypes.h"
 
 #pragma once
 
 namespace Loom2D
 {
+// Native side of the EventDispatcher script class. Listeners are kept in
+// one array per event type, holding slots into a table of listener
+// functions on the script instance, so only calling a listener crosses
+// into script. Events bubble natively along the dispatcher's parents.
 class EventDispatcher
 {
+protected:
+
+    struct ListenerList
+    {
+        StringTableEntry type;
+        utArray<int>     slots;
+    };
+
+    // event types interned with stringtable_insert, so compares are by pointer
+    utArray<ListenerList> listeners;
+
+    // the next free slot in the script instance's listener table
+    int nextListenerSlot;
+
+    ListenerList *findListeners(StringTableEntry type)
+    {
+        for (UTsize i = 0; i < listeners.size(); i++)
+        {
+            if (listeners[i].type == type)
+            {
+                return listeners[i].slots.size() ? &listeners[i] : NULL;
+            }
+        }
+
+        return NULL;
+    }
+
+    // Calls the listeners for the type of the event at eventIdx on the
+    // dispatcher instance at instanceIdx, returns true when they stopped
+    // propagation.
+    bool invokeListeners(lua_State *L, int instanceIdx, int eventIdx, StringTableEntry type);
+
+    static StringTableEntry getEventType(lua_State *L, int eventIdx);
+
 public:
 
+    static Type       *typeEvent;
+    static lua_Number typeOrdinal;
+    static lua_Number currentTargetOrdinal;
+    static lua_Number dataOrdinal;
+    static lua_Number stopsPropagationOrdinal;
+    static lua_Number stopsImmediatePropagationOrdinal;
+
+    EventDispatcher() : nextListenerSlot(1)
+    {
+    }
+
     virtual ~EventDispatcher()
     {
     }
+
+    // The next dispatcher an event bubbles to, DisplayObject returns its parent
+    virtual EventDispatcher *getBubbleParent()
+    {
+        return NULL;
+    }
+
+    // addEventListener(type, listener), ignores duplicates
+    int addEventListener(lua_State *L);
+
+    // removeEventListener(type, listener)
+    int removeEventListener(lua_State *L);
+
+    // removeEventListeners(type), all of them when type is null
+    int removeEventListeners(lua_State *L);
+
+    bool hasEventListener(const char *type)
+    {
+        return findListeners(stringtable_insert(type ? type : "")) != NULL;
+    }
+
+    // invokeEvent(event), calls the listeners on this dispatcher only,
+    // returns whether the event stopped propagation
+    int invokeEvent(lua_State *L);
+
+    // bubbleEvent(event), invokes the event on this dispatcher and its
+    // parents until one stops propagation. The chain is determined before
+    // any listener runs and only holds the dispatchers that had listeners
+    // for the type at that point.
+    int bubbleEvent(lua_State *L);
+
+    static void initialize(lua_State *L)
+    {
+        typeEvent = LSLuaState::getLuaState(L)->getType("loom2d.events.Event");
+        lmAssert(typeEvent, "unable to get loom2d.events.Event type");
+
+        typeOrdinal                      = typeEvent->getMemberOrdinal("mType");
+        currentTargetOrdinal             = typeEvent->getMemberOrdinal("mCurrentTarget");
+        dataOrdinal                      = typeEvent->getMemberOrdinal("mData");
+        stopsPropagationOrdinal          = typeEvent->getMemberOrdinal("mStopsPropagation");
+        stopsImmediatePropagationOrdinal = typeEvent->getMemberOrdinal("mStopsImmediatePropagation");
+    }
 };
 }
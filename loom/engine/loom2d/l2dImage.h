@@ -64,19 +64,20 @@ public:
             valid = true;
         }
 
-        lua_rawgeti(L, index, (int)Image::mVertexDataCacheInvalidOrdinal);
-
-        if (lua_toboolean(L, -1))
+        // the script side cache is only invalidated together with the
+        // native vertex data, unchanged images skip the lookup
+        if (nativeVertexDataInvalid)
         {
-            lualoom_getmember(L, index, "updateVertexData");
-            lua_call(L, 0, 0);
-        }
+            lua_rawgeti(L, index, (int)Image::mVertexDataCacheInvalidOrdinal);
 
-        lua_pop(L, 1);
+            if (lua_toboolean(L, -1))
+            {
+                lualoom_getmember(L, index, "updateVertexData");
+                lua_call(L, 0, 0);
+            }
 
+            lua_pop(L, 1);
 
-        if (nativeVertexDataInvalid)
-        {
             updateNativeVertexData(L, index);
         }
 
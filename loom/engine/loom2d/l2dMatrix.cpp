@@ -20,8 +20,202 @@
 
 #include "loom/engine/loom2d/l2dMatrix.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define L2D_MATRIX_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define L2D_MATRIX_NEON 1
+#include <arm_neon.h>
+#endif
+
 namespace Loom2D
 {
 Type       *Matrix::typeMatrix         = NULL;
 lua_Number Matrix::sHelperPointOrdinal = -1;
+
+#define POINT_AT(base, stride, i)    ((const float *)((const char *)(base) + (size_t)(i) * (stride)))
+#define POINT_OUT(base, stride, i)   ((float *)((char *)(base) + (size_t)(i) * (stride)))
+
+#if L2D_MATRIX_SSE2
+
+// Both points of p = [x0 y0 x1 y1] transformed, with ab = [a b a b],
+// cd = [c d c d] and t = [tx ty tx ty]
+static inline __m128 transformPair(__m128 p, __m128 ab, __m128 cd, __m128 t)
+{
+    __m128 x = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 0, 0));
+    __m128 y = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 1, 1));
+
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ab, x), _mm_mul_ps(cd, y)), t);
+}
+
+static inline __m128 loadPair(const float *p0, const float *p1)
+{
+    return _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)p0), (const __m64 *)p1);
+}
+
+#endif
+
+void Matrix::transformPoints(const float *src, size_t srcStride, float *dst, size_t dstStride, int count) const
+{
+    int i = 0;
+
+#if L2D_MATRIX_SSE2
+    const __m128 ab = _mm_setr_ps((float)a, (float)b, (float)a, (float)b);
+    const __m128 cd = _mm_setr_ps((float)c, (float)d, (float)c, (float)d);
+    const __m128 t  = _mm_setr_ps((float)tx, (float)ty, (float)tx, (float)ty);
+
+    for ( ; i + 2 <= count; i += 2)
+    {
+        __m128 r = transformPair(loadPair(POINT_AT(src, srcStride, i), POINT_AT(src, srcStride, i + 1)), ab, cd, t);
+
+        _mm_storel_pi((__m64 *)POINT_OUT(dst, dstStride, i), r);
+        _mm_storeh_pi((__m64 *)POINT_OUT(dst, dstStride, i + 1), r);
+    }
+#elif L2D_MATRIX_NEON
+    const float32x2_t ab = { (float)a, (float)b };
+    const float32x2_t cd = { (float)c, (float)d };
+    const float32x2_t t  = { (float)tx, (float)ty };
+
+    for ( ; i < count; i++)
+    {
+        float32x2_t p = vld1_f32(POINT_AT(src, srcStride, i));
+        vst1_f32(POINT_OUT(dst, dstStride, i), vmla_lane_f32(vmla_lane_f32(t, ab, p, 0), cd, p, 1));
+    }
+#endif
+
+    const float fa = (float)a, fb = (float)b, fc = (float)c, fd = (float)d;
+    const float ftx = (float)tx, fty = (float)ty;
+
+    for ( ; i < count; i++)
+    {
+        const float *p = POINT_AT(src, srcStride, i);
+        float       x  = p[0];
+        float       y  = p[1];
+        float       *q = POINT_OUT(dst, dstStride, i);
+
+        q[0] = fa * x + fc * y + ftx;
+        q[1] = fb * x + fd * y + fty;
+    }
+}
+
+void Matrix::transformPointsBounds(const float *points, size_t stride, int count,
+                                   lmscalar *minX, lmscalar *minY, lmscalar *maxX, lmscalar *maxY) const
+{
+    lmAssert(count > 0, "No points to bound");
+
+#if L2D_MATRIX_SSE2
+    const __m128 ab = _mm_setr_ps((float)a, (float)b, (float)a, (float)b);
+    const __m128 cd = _mm_setr_ps((float)c, (float)d, (float)c, (float)d);
+    const __m128 t  = _mm_setr_ps((float)tx, (float)ty, (float)tx, (float)ty);
+
+    // An odd point out is paired with itself, lanes hold [x y x y]
+    const float *last = POINT_AT(points, stride, count - 1);
+    __m128      lo    = transformPair(loadPair(points, count > 1 ? POINT_AT(points, stride, 1) : last), ab, cd, t);
+    __m128      hi    = lo;
+
+    int i = 2;
+    for ( ; i + 2 <= count; i += 2)
+    {
+        __m128 r = transformPair(loadPair(POINT_AT(points, stride, i), POINT_AT(points, stride, i + 1)), ab, cd, t);
+        lo = _mm_min_ps(lo, r);
+        hi = _mm_max_ps(hi, r);
+    }
+
+    if (i < count)
+    {
+        __m128 r = transformPair(loadPair(last, last), ab, cd, t);
+        lo = _mm_min_ps(lo, r);
+        hi = _mm_max_ps(hi, r);
+    }
+
+    lo = _mm_min_ps(lo, _mm_movehl_ps(lo, lo));
+    hi = _mm_max_ps(hi, _mm_movehl_ps(hi, hi));
+
+    float bounds[4];
+    _mm_storel_pi((__m64 *)&bounds[0], lo);
+    _mm_storel_pi((__m64 *)&bounds[2], hi);
+#elif L2D_MATRIX_NEON
+    const float32x2_t ab = { (float)a, (float)b };
+    const float32x2_t cd = { (float)c, (float)d };
+    const float32x2_t t  = { (float)tx, (float)ty };
+
+    float32x2_t p  = vld1_f32(points);
+    float32x2_t lo = vmla_lane_f32(vmla_lane_f32(t, ab, p, 0), cd, p, 1);
+    float32x2_t hi = lo;
+
+    for (int i = 1; i < count; i++)
+    {
+        p = vld1_f32(POINT_AT(points, stride, i));
+
+        float32x2_t r = vmla_lane_f32(vmla_lane_f32(t, ab, p, 0), cd, p, 1);
+        lo = vmin_f32(lo, r);
+        hi = vmax_f32(hi, r);
+    }
+
+    float bounds[4];
+    vst1_f32(&bounds[0], lo);
+    vst1_f32(&bounds[2], hi);
+#else
+    const float fa = (float)a, fb = (float)b, fc = (float)c, fd = (float)d;
+    const float ftx = (float)tx, fty = (float)ty;
+
+    float bounds[4] = { INFINITY, INFINITY, -INFINITY, -INFINITY };
+    for (int i = 0; i < count; i++)
+    {
+        const float *p = POINT_AT(points, stride, i);
+        float       x  = fa * p[0] + fc * p[1] + ftx;
+        float       y  = fb * p[0] + fd * p[1] + fty;
+
+        bounds[0] = x < bounds[0] ? x : bounds[0];
+        bounds[1] = y < bounds[1] ? y : bounds[1];
+        bounds[2] = x > bounds[2] ? x : bounds[2];
+        bounds[3] = y > bounds[3] ? y : bounds[3];
+    }
+#endif
+
+    *minX = bounds[0];
+    *minY = bounds[1];
+    *maxX = bounds[2];
+    *maxY = bounds[3];
+}
+
+void Matrix::concatChain(const Matrix *const *chain, int count)
+{
+#if L2D_MATRIX_SSE2
+    // Each column pair in one double register, so this is at least as
+    // exact as concat() whichever lmscalar is
+    __m128d ab = _mm_setr_pd(a, b);
+    __m128d cd = _mm_setr_pd(c, d);
+    __m128d t  = _mm_setr_pd(tx, ty);
+
+    for (int i = 0; i < count; i++)
+    {
+        const Matrix *m = chain[i];
+
+        __m128d mab = _mm_setr_pd(m->a, m->b);
+        __m128d mcd = _mm_setr_pd(m->c, m->d);
+
+        ab = _mm_add_pd(_mm_mul_pd(mab, _mm_unpacklo_pd(ab, ab)), _mm_mul_pd(mcd, _mm_unpackhi_pd(ab, ab)));
+        cd = _mm_add_pd(_mm_mul_pd(mab, _mm_unpacklo_pd(cd, cd)), _mm_mul_pd(mcd, _mm_unpackhi_pd(cd, cd)));
+        t  = _mm_add_pd(_mm_add_pd(_mm_mul_pd(mab, _mm_unpacklo_pd(t, t)), _mm_mul_pd(mcd, _mm_unpackhi_pd(t, t))),
+                        _mm_setr_pd(m->tx, m->ty));
+    }
+
+    double values[6];
+    _mm_storeu_pd(&values[0], ab);
+    _mm_storeu_pd(&values[2], cd);
+    _mm_storeu_pd(&values[4], t);
+
+    setTo((lmscalar)values[0], (lmscalar)values[1], (lmscalar)values[2],
+          (lmscalar)values[3], (lmscalar)values[4], (lmscalar)values[5]);
+#else
+    for (int i = 0; i < count; i++)
+    {
+        concat(chain[i]);
+    }
+#endif
+}
+
+#undef POINT_AT
+#undef POINT_OUT
 }
@@ -36,6 +36,10 @@ private:
 
 public:
 
+    // The 2x2 part comes first and is contiguous, with LOOM_FLOAT_SCALAR
+    // it fills one 16 byte vector register. The class isn't declared
+    // 16 byte aligned as script Matrices live in Lua userdata, which is
+    // only 8 byte aligned.
     lmscalar a;
     lmscalar b;
     lmscalar c;
@@ -287,6 +291,37 @@ public:
         *ry = b*x + d*y + ty;
     }
 
+    // Axis aligned bounds of the rectangle (left, top) - (right, bottom)
+    // transformed, from the extremes of each term rather than of the
+    // four transformed corners
+    inline void transformRectBounds(lmscalar left, lmscalar top, lmscalar right, lmscalar bottom,
+                                    lmscalar *minX, lmscalar *minY, lmscalar *maxX, lmscalar *maxY) const
+    {
+        lmscalar al = a * left, ar = a * right, ct = c * top, cb = c * bottom;
+        lmscalar bl = b * left, br = b * right, dt = d * top, db = d * bottom;
+
+        *minX = tx + (al < ar ? al : ar) + (ct < cb ? ct : cb);
+        *maxX = tx + (al < ar ? ar : al) + (ct < cb ? cb : ct);
+        *minY = ty + (bl < br ? bl : br) + (dt < db ? dt : db);
+        *maxY = ty + (bl < br ? br : bl) + (dt < db ? db : dt);
+    }
+
+    // Batched kernels over count float x, y pairs laid out stride bytes
+    // apart, like the positions of GFX::VertexPosColorTex. They work in
+    // single precision, two points at a time with SSE2 or NEON.
+
+    // Writes the transformed points to dst, which may be src.
+    void transformPoints(const float *src, size_t srcStride, float *dst, size_t dstStride, int count) const;
+
+    // Bounds of the transformed points without writing them anywhere,
+    // count must be above 0.
+    void transformPointsBounds(const float *points, size_t stride, int count,
+                               lmscalar *minX, lmscalar *minY, lmscalar *maxX, lmscalar *maxY) const;
+
+    // Same as concat() with each of the count matrices in order, with
+    // the running product kept in registers between them.
+    void concatChain(const Matrix *const *chain, int count);
+
     int deltaTransformCoord(lua_State *L)
     {
         lmscalar x = (lmscalar)lua_tonumber(L, 2);
@@ -0,0 +1,217 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "loom/engine/loom2d/l2dMatrix.h"
+#include "seatest.h"
+
+using namespace Loom2D;
+
+SEATEST_FIXTURE(l2dMatrix)
+{
+    SEATEST_FIXTURE_ENTRY(l2dMatrix_concatChain);
+    SEATEST_FIXTURE_ENTRY(l2dMatrix_transformPoints);
+    SEATEST_FIXTURE_ENTRY(l2dMatrix_transformPointsInPlace);
+    SEATEST_FIXTURE_ENTRY(l2dMatrix_transformPointsBounds);
+}
+
+// Rotated, skewed, mirrored and scaled, all with translation
+static const Matrix matrices[] = {
+    Matrix(1, 0, 0, 1, 0, 0),
+    Matrix(0.8660254, 0.5, -0.5, 0.8660254, 12.5, -7.25),
+    Matrix(1, 0.25, -0.4, 1, 3, 4),
+    Matrix(-1.5, 0, 0, 2.25, 640, 480),
+    Matrix(0.3, -1.2, 0.7, 0.45, -33.125, 0.5),
+    Matrix(2, 0.125, 0.375, -0.5, 1e3, -2e3)
+};
+
+static const int numMatrices = sizeof(matrices) / sizeof(matrices[0]);
+
+// The vector paths may fuse or reorder in single precision where the
+// scalar ones don't, and with LOOM_FLOAT_SCALAR concat() rounds every
+// step to float, so compare relative to the magnitude
+static bool closeTo(double expected, double actual)
+{
+    double scale = fabs(expected) > 1 ? fabs(expected) : 1;
+    return fabs(expected - actual) <= scale * 1e-5;
+}
+
+// Laid out like GFX::VertexPosColorTex, the position then 12 other bytes
+struct MatrixTestVertex
+{
+    float        x, y;
+    unsigned int color;
+    float        u, v;
+};
+
+static void fillVertices(MatrixTestVertex *vertices, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        vertices[i].x     = (float)(i * 37 % 101) - 50.5f;
+        vertices[i].y     = (float)(i * 53 % 89) * 0.75f - 20.0f;
+        vertices[i].color = 0xdeadbeef + i;
+        vertices[i].u     = (float)i;
+        vertices[i].v     = -(float)i;
+    }
+}
+
+SEATEST_TEST(l2dMatrix_concatChain)
+{
+    const Matrix *chain[numMatrices];
+
+    for (int i = 0; i < numMatrices; i++)
+    {
+        chain[i] = &matrices[(i + 1) % numMatrices];
+    }
+
+    // Every length, from each starting matrix
+    for (int start = 0; start < numMatrices; start++)
+    {
+        for (int count = 0; count <= numMatrices; count++)
+        {
+            Matrix expected = matrices[start];
+            Matrix actual   = matrices[start];
+
+            for (int i = 0; i < count; i++)
+            {
+                expected.concat(chain[i]);
+            }
+
+            actual.concatChain(chain, count);
+
+            assert_true(closeTo(expected.a, actual.a));
+            assert_true(closeTo(expected.b, actual.b));
+            assert_true(closeTo(expected.c, actual.c));
+            assert_true(closeTo(expected.d, actual.d));
+            assert_true(closeTo(expected.tx, actual.tx));
+            assert_true(closeTo(expected.ty, actual.ty));
+        }
+    }
+}
+
+SEATEST_TEST(l2dMatrix_transformPoints)
+{
+    MatrixTestVertex src[9], dst[9];
+    float            packed[18];
+
+    fillVertices(src, 9);
+
+    for (int m = 0; m < numMatrices; m++)
+    {
+        const Matrix& matrix = matrices[m];
+
+        // Odd counts leave a point after the pairs
+        for (int count = 0; count <= 9; count++)
+        {
+            memset(dst, 0xcd, sizeof(dst));
+            matrix.transformPoints(&src[0].x, sizeof(MatrixTestVertex), &dst[0].x, sizeof(MatrixTestVertex), count);
+            matrix.transformPoints(&src[0].x, sizeof(MatrixTestVertex), packed, sizeof(float) * 2, count);
+
+            for (int i = 0; i < 9; i++)
+            {
+                if (i >= count)
+                {
+                    // Nothing past the last point is written
+                    MatrixTestVertex untouched;
+                    memset(&untouched, 0xcd, sizeof(untouched));
+                    assert_true(!memcmp(&dst[i], &untouched, sizeof(untouched)));
+                    continue;
+                }
+
+                double x = (double)matrix.a * src[i].x + (double)matrix.c * src[i].y + matrix.tx;
+                double y = (double)matrix.b * src[i].x + (double)matrix.d * src[i].y + matrix.ty;
+
+                assert_true(closeTo(x, dst[i].x));
+                assert_true(closeTo(y, dst[i].y));
+                assert_true(closeTo(x, packed[i * 2]));
+                assert_true(closeTo(y, packed[i * 2 + 1]));
+
+                // Only the position of each vertex is written
+                assert_true(dst[i].color == 0xcdcdcdcd);
+            }
+        }
+    }
+}
+
+SEATEST_TEST(l2dMatrix_transformPointsInPlace)
+{
+    MatrixTestVertex original[9], vertices[9];
+
+    fillVertices(original, 9);
+
+    for (int m = 0; m < numMatrices; m++)
+    {
+        const Matrix& matrix = matrices[m];
+
+        memcpy(vertices, original, sizeof(vertices));
+        matrix.transformPoints(&vertices[0].x, sizeof(MatrixTestVertex), &vertices[0].x, sizeof(MatrixTestVertex), 9);
+
+        for (int i = 0; i < 9; i++)
+        {
+            double x = (double)matrix.a * original[i].x + (double)matrix.c * original[i].y + matrix.tx;
+            double y = (double)matrix.b * original[i].x + (double)matrix.d * original[i].y + matrix.ty;
+
+            assert_true(closeTo(x, vertices[i].x));
+            assert_true(closeTo(y, vertices[i].y));
+            assert_true(vertices[i].color == original[i].color);
+            assert_true(vertices[i].u == original[i].u && vertices[i].v == original[i].v);
+        }
+    }
+}
+
+SEATEST_TEST(l2dMatrix_transformPointsBounds)
+{
+    MatrixTestVertex vertices[9];
+
+    fillVertices(vertices, 9);
+
+    for (int m = 0; m < numMatrices; m++)
+    {
+        const Matrix& matrix = matrices[m];
+
+        for (int count = 1; count <= 9; count++)
+        {
+            double expectedMinX = INFINITY, expectedMinY = INFINITY;
+            double expectedMaxX = -INFINITY, expectedMaxY = -INFINITY;
+
+            for (int i = 0; i < count; i++)
+            {
+                double x = (double)matrix.a * vertices[i].x + (double)matrix.c * vertices[i].y + matrix.tx;
+                double y = (double)matrix.b * vertices[i].x + (double)matrix.d * vertices[i].y + matrix.ty;
+
+                expectedMinX = x < expectedMinX ? x : expectedMinX;
+                expectedMinY = y < expectedMinY ? y : expectedMinY;
+                expectedMaxX = x > expectedMaxX ? x : expectedMaxX;
+                expectedMaxY = y > expectedMaxY ? y : expectedMaxY;
+            }
+
+            lmscalar minX, minY, maxX, maxY;
+            matrix.transformPointsBounds(&vertices[0].x, sizeof(MatrixTestVertex), count, &minX, &minY, &maxX, &maxY);
+
+            assert_true(closeTo(expectedMinX, minX));
+            assert_true(closeTo(expectedMinY, minY));
+            assert_true(closeTo(expectedMaxX, maxX));
+            assert_true(closeTo(expectedMaxY, maxY));
+        }
+    }
+}
@@ -0,0 +1,622 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/engine/loom2d/l2dParticleSystem.h"
+#include "loom/engine/loom2d/l2dBlendMode.h"
+#include "loom/common/xml/tinyxml2.h"
+#include "loom/graphics/gfxGraphics.h"
+
+#include <string.h>
+
+namespace Loom2D
+{
+Type *ParticleSystem::typeParticleSystem = NULL;
+
+#define PARTICLESYSTEM_DEFAULT_MAX    100
+
+// Particles closer to where they were emitted than this get no radial
+// or tangential acceleration, the direction would be degenerate
+#define PARTICLESYSTEM_MIN_DISTANCE   0.01f
+
+// Particles are at least this big, like Starling's
+#define PARTICLESYSTEM_MIN_SIZE       0.1f
+
+static const lmscalar sDegreesToRadians = (lmscalar)(3.14159265358979323846 / 180.0);
+
+ParticleSystem::ParticleSystem()
+: random(12345)
+{
+    type = typeParticleSystem;
+
+    emitterType = EMITTER_GRAVITY;
+    emitterX = emitterY = 0;
+    emitterXVariance = emitterYVariance = 0;
+    lifespan = 1;
+    lifespanVariance = 0;
+    startSize = 20;
+    startSizeVariance = 0;
+    endSize = 20;
+    endSizeVariance = 0;
+    emitAngle = emitAngleVariance = 0;
+    startRotation = startRotationVariance = 0;
+    endRotation = endRotationVariance = 0;
+    speed = speedVariance = 0;
+    gravityX = gravityY = 0;
+    radialAcceleration = radialAccelerationVariance = 0;
+    tangentialAcceleration = tangentialAccelerationVariance = 0;
+    maxRadius = maxRadiusVariance = 0;
+    minRadius = minRadiusVariance = 0;
+    rotatePerSecond = rotatePerSecondVariance = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        startColor[i] = endColor[i] = 1;
+        startColorVariance[i] = endColorVariance[i] = 0;
+    }
+
+    duration = -1;
+
+    BlendMode::BlendFunction(BlendMode::NORMAL, blendSrc, blendDst);
+
+    nativeTextureID = -1;
+    shader = GFX::ShaderProgram::getDefaultShader();
+
+    textureU0 = textureV0 = 0;
+    textureU1 = textureV1 = 1;
+    textureAspect = 1;
+    premultipliedAlpha = false;
+
+    particleData = NULL;
+    numParticles = 0;
+    maxParticles = 0;
+    emissionTime = 0;
+    frameTime = 0;
+    simulationStep = 0;
+
+    setMaxParticles(PARTICLESYSTEM_DEFAULT_MAX);
+    emissionRate = maxParticles / lifespan;
+}
+
+ParticleSystem::~ParticleSystem()
+{
+    if (particleData)
+    {
+        lmFree(NULL, particleData);
+    }
+}
+
+void ParticleSystem::setMaxParticles(int value)
+{
+    if (value < 0) value = 0;
+    if (value == maxParticles) return;
+
+    float *newData = value ? (float *)lmAlloc(NULL, sizeof(float) * FIELD_COUNT * value) : NULL;
+
+    int keep = numParticles < value ? numParticles : value;
+    if (particleData)
+    {
+        for (int f = 0; f < FIELD_COUNT; f++)
+        {
+            memcpy(newData + f * value, field(f), sizeof(float) * keep);
+        }
+
+        lmFree(NULL, particleData);
+    }
+
+    particleData = newData;
+    maxParticles = value;
+    numParticles = keep;
+}
+
+static tinyxml2::XMLElement *findConfigElement(tinyxml2::XMLElement *root, const char *name)
+{
+    // Particle Designer isn't consistent about the case of some names,
+    // e.g. FinishParticleSizeVariance
+    for (tinyxml2::XMLElement *e = root->FirstChildElement(); e; e = e->NextSiblingElement())
+    {
+        if (!strcasecmp(e->Name(), name)) return e;
+    }
+
+    return NULL;
+}
+
+static lmscalar getConfigValue(tinyxml2::XMLElement *root, const char *name, lmscalar defaultValue, const char *attribute = "value")
+{
+    tinyxml2::XMLElement *e = findConfigElement(root, name);
+    float value;
+    if (!e || e->QueryFloatAttribute(attribute, &value) != tinyxml2::XML_NO_ERROR) return defaultValue;
+    return (lmscalar)value;
+}
+
+static void getConfigColor(tinyxml2::XMLElement *root, const char *name, lmscalar *color)
+{
+    static const char *channels[4] = { "red", "green", "blue", "alpha" };
+    for (int i = 0; i < 4; i++)
+    {
+        color[i] = getConfigValue(root, name, color[i], channels[i]);
+    }
+}
+
+bool ParticleSystem::loadConfig(const char *xml)
+{
+    tinyxml2::XMLDocument doc;
+    if (!xml || doc.Parse(xml) != tinyxml2::XML_NO_ERROR || !doc.RootElement())
+    {
+        return false;
+    }
+
+    tinyxml2::XMLElement *root = doc.RootElement();
+
+    emitterXVariance = getConfigValue(root, "sourcePositionVariance", 0, "x");
+    emitterYVariance = getConfigValue(root, "sourcePositionVariance", 0, "y");
+    gravityX = getConfigValue(root, "gravity", 0, "x");
+    gravityY = getConfigValue(root, "gravity", 0, "y");
+    emitterType = (int)getConfigValue(root, "emitterType", 0);
+    lifespan = lmMax((lmscalar)0.01, getConfigValue(root, "particleLifeSpan", 1));
+    lifespanVariance = getConfigValue(root, "particleLifespanVariance", 0);
+    startSize = getConfigValue(root, "startParticleSize", 20);
+    startSizeVariance = getConfigValue(root, "startParticleSizeVariance", 0);
+    endSize = getConfigValue(root, "finishParticleSize", 20);
+    endSizeVariance = getConfigValue(root, "finishParticleSizeVariance", 0);
+    emitAngle = getConfigValue(root, "angle", 0) * sDegreesToRadians;
+    emitAngleVariance = getConfigValue(root, "angleVariance", 0) * sDegreesToRadians;
+    startRotation = getConfigValue(root, "rotationStart", 0) * sDegreesToRadians;
+    startRotationVariance = getConfigValue(root, "rotationStartVariance", 0) * sDegreesToRadians;
+    endRotation = getConfigValue(root, "rotationEnd", 0) * sDegreesToRadians;
+    endRotationVariance = getConfigValue(root, "rotationEndVariance", 0) * sDegreesToRadians;
+    speed = getConfigValue(root, "speed", 0);
+    speedVariance = getConfigValue(root, "speedVariance", 0);
+    radialAcceleration = getConfigValue(root, "radialAcceleration", 0);
+    radialAccelerationVariance = getConfigValue(root, "radialAccelVariance", 0);
+    tangentialAcceleration = getConfigValue(root, "tangentialAcceleration", 0);
+    tangentialAccelerationVariance = getConfigValue(root, "tangentialAccelVariance", 0);
+    maxRadius = getConfigValue(root, "maxRadius", 0);
+    maxRadiusVariance = getConfigValue(root, "maxRadiusVariance", 0);
+    minRadius = getConfigValue(root, "minRadius", 0);
+    minRadiusVariance = getConfigValue(root, "minRadiusVariance", 0);
+    rotatePerSecond = getConfigValue(root, "rotatePerSecond", 0) * sDegreesToRadians;
+    rotatePerSecondVariance = getConfigValue(root, "rotatePerSecondVariance", 0) * sDegreesToRadians;
+    getConfigColor(root, "startColor", startColor);
+    getConfigColor(root, "startColorVariance", startColorVariance);
+    getConfigColor(root, "finishColor", endColor);
+    getConfigColor(root, "finishColorVariance", endColorVariance);
+    blendSrc = (uint32_t)getConfigValue(root, "blendFuncSource", (lmscalar)blendSrc);
+    blendDst = (uint32_t)getConfigValue(root, "blendFuncDestination", (lmscalar)blendDst);
+
+    // Particle Designer uses 0 or less for emitters that never stop
+    duration = getConfigValue(root, "duration", -1);
+    if (duration <= 0) duration = -1;
+
+    setMaxParticles((int)getConfigValue(root, "maxParticles", PARTICLESYSTEM_DEFAULT_MAX));
+    emissionRate = maxParticles / lifespan;
+
+    return true;
+}
+
+void ParticleSystem::setTextureRegion(float u0, float v0, float u1, float v1, lmscalar width, lmscalar height)
+{
+    textureU0 = u0;
+    textureV0 = v0;
+    textureU1 = u1;
+    textureV1 = v1;
+    textureAspect = width > 0 ? height / width : 1;
+}
+
+void ParticleSystem::start(lmscalar _duration)
+{
+    if (emissionRate <= 0) return;
+
+    if (_duration < 0) _duration = duration;
+
+    // Negative durations emit until stopped
+    emissionTime = _duration < 0 ? INFINITY : _duration;
+}
+
+void ParticleSystem::stop(bool _clear)
+{
+    emissionTime = 0;
+    frameTime = 0;
+
+    if (_clear) clear();
+}
+
+void ParticleSystem::clear()
+{
+    numParticles = 0;
+    simulationStep++;
+}
+
+void ParticleSystem::initParticle(int index)
+{
+    lmscalar life = lifespan + lifespanVariance * randomVariance();
+
+    field(FIELD_CURRENT_TIME)[index] = 0;
+    field(FIELD_TOTAL_TIME)[index] = (float)life;
+
+    // Dies right away in removeDeadParticles
+    if (life <= 0) return;
+
+    field(FIELD_X)[index] = (float)(emitterX + emitterXVariance * randomVariance());
+    field(FIELD_Y)[index] = (float)(emitterY + emitterYVariance * randomVariance());
+    field(FIELD_START_X)[index] = (float)emitterX;
+    field(FIELD_START_Y)[index] = (float)emitterY;
+
+    lmscalar angle = emitAngle + emitAngleVariance * randomVariance();
+    lmscalar velocity = speed + speedVariance * randomVariance();
+    field(FIELD_VELOCITY_X)[index] = (float)(velocity * cos(angle));
+    field(FIELD_VELOCITY_Y)[index] = (float)(velocity * sin(angle));
+
+    lmscalar startRadius = maxRadius + maxRadiusVariance * randomVariance();
+    lmscalar endRadius = minRadius + minRadiusVariance * randomVariance();
+    field(FIELD_EMIT_RADIUS)[index] = (float)startRadius;
+    field(FIELD_EMIT_RADIUS_DELTA)[index] = (float)((endRadius - startRadius) / life);
+    field(FIELD_EMIT_ROTATION)[index] = (float)(emitAngle + emitAngleVariance * randomVariance());
+    field(FIELD_EMIT_ROTATION_DELTA)[index] = (float)(rotatePerSecond + rotatePerSecondVariance * randomVariance());
+
+    field(FIELD_RADIAL_ACCELERATION)[index] = (float)(radialAcceleration + radialAccelerationVariance * randomVariance());
+    field(FIELD_TANGENTIAL_ACCELERATION)[index] = (float)(tangentialAcceleration + tangentialAccelerationVariance * randomVariance());
+
+    lmscalar size0 = lmMax((lmscalar)PARTICLESYSTEM_MIN_SIZE, startSize + startSizeVariance * randomVariance());
+    lmscalar size1 = lmMax((lmscalar)PARTICLESYSTEM_MIN_SIZE, endSize + endSizeVariance * randomVariance());
+    field(FIELD_SIZE)[index] = (float)size0;
+    field(FIELD_SIZE_DELTA)[index] = (float)((size1 - size0) / life);
+
+    lmscalar rotation0 = startRotation + startRotationVariance * randomVariance();
+    lmscalar rotation1 = endRotation + endRotationVariance * randomVariance();
+    field(FIELD_ROTATION)[index] = (float)rotation0;
+    field(FIELD_ROTATION_DELTA)[index] = (float)((rotation1 - rotation0) / life);
+
+    for (int c = 0; c < 4; c++)
+    {
+        lmscalar color0 = startColor[c] + startColorVariance[c] * randomVariance();
+        lmscalar color1 = endColor[c] + endColorVariance[c] * randomVariance();
+        field(FIELD_RED + c)[index] = (float)color0;
+        field(FIELD_RED_DELTA + c)[index] = (float)((color1 - color0) / life);
+    }
+}
+
+void ParticleSystem::advanceParticles(int first, int count, float passedTime)
+{
+    float *time = field(FIELD_CURRENT_TIME) + first;
+    float *x = field(FIELD_X) + first;
+    float *y = field(FIELD_Y) + first;
+
+    // Each loop only touches a few arrays so the compiler can vectorize it
+    for (int i = 0; i < count; i++)
+    {
+        time[i] += passedTime;
+    }
+
+    if (emitterType == EMITTER_RADIAL)
+    {
+        float *radius = field(FIELD_EMIT_RADIUS) + first;
+        float *radiusDelta = field(FIELD_EMIT_RADIUS_DELTA) + first;
+        float *rotation = field(FIELD_EMIT_ROTATION) + first;
+        float *rotationDelta = field(FIELD_EMIT_ROTATION_DELTA) + first;
+        float ex = (float)emitterX;
+        float ey = (float)emitterY;
+
+        for (int i = 0; i < count; i++)
+        {
+            rotation[i] += rotationDelta[i] * passedTime;
+            radius[i] += radiusDelta[i] * passedTime;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            x[i] = ex - cosf(rotation[i]) * radius[i];
+            y[i] = ey - sinf(rotation[i]) * radius[i];
+        }
+    }
+    else
+    {
+        float *startX = field(FIELD_START_X) + first;
+        float *startY = field(FIELD_START_Y) + first;
+        float *vx = field(FIELD_VELOCITY_X) + first;
+        float *vy = field(FIELD_VELOCITY_Y) + first;
+        float *radial = field(FIELD_RADIAL_ACCELERATION) + first;
+        float *tangential = field(FIELD_TANGENTIAL_ACCELERATION) + first;
+        float gx = (float)gravityX;
+        float gy = (float)gravityY;
+
+        for (int i = 0; i < count; i++)
+        {
+            float dx = x[i] - startX[i];
+            float dy = y[i] - startY[i];
+            float distance = sqrtf(dx * dx + dy * dy);
+            if (distance < PARTICLESYSTEM_MIN_DISTANCE) distance = PARTICLESYSTEM_MIN_DISTANCE;
+
+            float radX = dx / distance;
+            float radY = dy / distance;
+
+            // Tangential acceleration is perpendicular to the radial one
+            float ax = gx + radX * radial[i] - radY * tangential[i];
+            float ay = gy + radY * radial[i] + radX * tangential[i];
+
+            vx[i] += ax * passedTime;
+            vy[i] += ay * passedTime;
+            x[i] += vx[i] * passedTime;
+            y[i] += vy[i] * passedTime;
+        }
+    }
+
+    static const int deltaFields[][2] = {
+        { FIELD_SIZE, FIELD_SIZE_DELTA },
+        { FIELD_ROTATION, FIELD_ROTATION_DELTA },
+        { FIELD_RED, FIELD_RED_DELTA },
+        { FIELD_GREEN, FIELD_GREEN_DELTA },
+        { FIELD_BLUE, FIELD_BLUE_DELTA },
+        { FIELD_ALPHA, FIELD_ALPHA_DELTA }
+    };
+
+    for (size_t f = 0; f < sizeof(deltaFields) / sizeof(deltaFields[0]); f++)
+    {
+        float *value = field(deltaFields[f][0]) + first;
+        float *delta = field(deltaFields[f][1]) + first;
+
+        for (int i = 0; i < count; i++)
+        {
+            value[i] += delta[i] * passedTime;
+        }
+    }
+}
+
+void ParticleSystem::removeDeadParticles()
+{
+    float *time = field(FIELD_CURRENT_TIME);
+    float *total = field(FIELD_TOTAL_TIME);
+    float *radius = field(FIELD_EMIT_RADIUS);
+    bool radial = emitterType == EMITTER_RADIAL;
+    float radiusMin = (float)minRadius;
+
+    int i = 0;
+    while (i < numParticles)
+    {
+        // Radial particles also die once they reach the minimum radius
+        bool dead = time[i] >= total[i] || (radial && radius[i] < radiusMin);
+        if (!dead)
+        {
+            i++;
+            continue;
+        }
+
+        // Move the last particle into its place
+        numParticles--;
+        if (i != numParticles)
+        {
+            for (int f = 0; f < FIELD_COUNT; f++)
+            {
+                float *values = field(f);
+                values[i] = values[numParticles];
+            }
+        }
+    }
+}
+
+bool ParticleSystem::advanceTime(lmscalar passedTime)
+{
+    if (passedTime <= 0) return false;
+
+    bool hadParticles = numParticles > 0;
+    if (hadParticles || emissionTime > 0) simulationStep++;
+
+    advanceParticles(0, numParticles, (float)passedTime);
+
+    if (emissionTime > 0 && emissionRate > 0)
+    {
+        lmscalar timeBetweenParticles = 1 / emissionRate;
+        frameTime += passedTime;
+
+        while (frameTime > 0)
+        {
+            if (numParticles < maxParticles)
+            {
+                // Emitted part way through the step, advance it by the rest
+                initParticle(numParticles);
+                advanceParticles(numParticles, 1, (float)frameTime);
+                numParticles++;
+            }
+
+            frameTime -= timeBetweenParticles;
+        }
+
+        if (emissionTime != INFINITY)
+        {
+            emissionTime = lmMax((lmscalar)0, emissionTime - passedTime);
+        }
+    }
+
+    removeDeadParticles();
+
+    return emissionTime == 0 && hadParticles && numParticles == 0;
+}
+
+void ParticleSystem::render(lua_State *L)
+{
+    if (nativeTextureID == -1 || numParticles == 0)
+    {
+        return;
+    }
+
+    GFX::TextureInfo *tinfo = GFX::Texture::getTextureInfo(nativeTextureID);
+    if (!tinfo)
+    {
+        return;
+    }
+
+    updateRenderState();
+    if (renderState.alpha == 0.0f)
+    {
+        return;
+    }
+
+    if (renderState.isClipping()) GFX::Graphics::setClipRect((int)renderState.clipRect.x, (int)renderState.clipRect.y, (int)renderState.clipRect.width, (int)renderState.clipRect.height);
+
+    updateLocalTransform();
+
+    Matrix mtx;
+    getTargetTransformationMatrix(NULL, &mtx);
+
+    GFX::VertexPosColorTex *v = GFX::QuadRenderer::getQuadVertexMemory(4 * numParticles, nativeTextureID, blendEnabled, blendSrc, blendDst, shader);
+    if (!v)
+    {
+        return;
+    }
+
+    const float *px = field(FIELD_X);
+    const float *py = field(FIELD_Y);
+    const float *size = field(FIELD_SIZE);
+    const float *rotation = field(FIELD_ROTATION);
+    const float *red = field(FIELD_RED);
+    const float *green = field(FIELD_GREEN);
+    const float *blue = field(FIELD_BLUE);
+    const float *alpha = field(FIELD_ALPHA);
+
+    float ma = (float)mtx.a, mb = (float)mtx.b, mc = (float)mtx.c, md = (float)mtx.d;
+    float mtx_tx = (float)mtx.tx, mtx_ty = (float)mtx.ty;
+    float parentAlpha = (float)renderState.alpha;
+    float aspect = (float)textureAspect;
+
+    static const float cornerX[4] = { -0.5f, 0.5f, -0.5f, 0.5f };
+    static const float cornerY[4] = { -0.5f, -0.5f, 0.5f, 0.5f };
+    const float u[4] = { textureU0, textureU1, textureU0, textureU1 };
+    const float vv[4] = { textureV0, textureV0, textureV1, textureV1 };
+
+    for (int i = 0; i < numParticles; i++)
+    {
+        float a = alpha[i] * parentAlpha;
+        a = a < 0 ? 0 : (a > 1 ? 1 : a);
+        float r = red[i] < 0 ? 0 : (red[i] > 1 ? 1 : red[i]);
+        float g = green[i] < 0 ? 0 : (green[i] > 1 ? 1 : green[i]);
+        float b = blue[i] < 0 ? 0 : (blue[i] > 1 ? 1 : blue[i]);
+
+        if (premultipliedAlpha)
+        {
+            r *= a;
+            g *= a;
+            b *= a;
+        }
+
+        uint32_t abgr = ((uint32_t)(a * 255.0f) << 24) | ((uint32_t)(b * 255.0f) << 16) |
+                        ((uint32_t)(g * 255.0f) << 8) | (uint32_t)(r * 255.0f);
+
+        float w = size[i];
+        float h = size[i] * aspect;
+        float cosR = 1, sinR = 0;
+        if (rotation[i] != 0)
+        {
+            cosR = cosf(rotation[i]);
+            sinR = sinf(rotation[i]);
+        }
+
+        for (int c = 0; c < 4; c++, v++)
+        {
+            float lx = cornerX[c] * w;
+            float ly = cornerY[c] * h;
+            float x = px[i] + lx * cosR - ly * sinR;
+            float y = py[i] + lx * sinR + ly * cosR;
+
+            v->x = ma * x + mc * y + mtx_tx;
+            v->y = mb * x + md * y + mtx_ty;
+            v->z = 0;
+            v->abgr = abgr;
+            v->u = u[c];
+            v->v = vv[c];
+        }
+    }
+}
+
+void ParticleSystem::getLocalBounds(Rectangle &bounds)
+{
+    const float *px = field(FIELD_X);
+    const float *py = field(FIELD_Y);
+    const float *size = field(FIELD_SIZE);
+
+    // Half the diagonal covers the particle at any rotation
+    float extentScale = 0.5f * sqrtf(1.0f + (float)(textureAspect * textureAspect));
+
+    float minx = INFINITY, maxx = -INFINITY;
+    float miny = INFINITY, maxy = -INFINITY;
+
+    for (int i = 0; i < numParticles; i++)
+    {
+        float extent = size[i] * extentScale;
+        minx = lmMin(minx, px[i] - extent);
+        maxx = lmMax(maxx, px[i] + extent);
+        miny = lmMin(miny, py[i] - extent);
+        maxy = lmMax(maxy, py[i] + extent);
+    }
+
+    bounds.setTo(minx, miny, maxx - minx, maxy - miny);
+}
+
+bool ParticleSystem::collectDamage(lua_State *L, DamageRegion &damage, Rectangle &bounds)
+{
+    GFX::TextureInfo *tinfo = nativeTextureID == -1 ? NULL : GFX::Texture::getTextureInfo(nativeTextureID);
+
+    updateRenderState();
+    if (!tinfo || renderState.alpha == 0.0f || numParticles == 0)
+    {
+        noteDamage(damage, false, bounds, 0);
+        return false;
+    }
+
+    updateLocalTransform();
+
+    Matrix mtx;
+    getTargetTransformationMatrix(NULL, &mtx);
+
+    Rectangle local;
+    getLocalBounds(local);
+    transformBounds(&mtx, &local, &bounds);
+
+    if (renderState.isClipping())
+    {
+        bounds.clip(renderState.clipRect.x, renderState.clipRect.y, renderState.clipRect.width, renderState.clipRect.height);
+    }
+
+    // Hashing every particle wouldn't be cheaper than redrawing them,
+    // any simulation step counts as a change
+    uint32_t signature = getDamageSignature(mtx);
+    signature = DamageRegion::hash(signature, &simulationStep, sizeof(simulationStep));
+    signature = DamageRegion::hash(signature, &nativeTextureID, sizeof(nativeTextureID));
+    signature = DamageRegion::hash(signature, &tinfo->contentVersion, sizeof(tinfo->contentVersion));
+    signature = DamageRegion::hash(signature, &shader, sizeof(shader));
+
+    noteDamage(damage, true, bounds, signature);
+    return true;
+}
+
+DisplayObject::NativeBounds ParticleSystem::getNativeBounds(const Matrix &mtx, Rectangle &bounds)
+{
+    if (numParticles == 0 || nativeTextureID == -1)
+    {
+        return NATIVEBOUNDS_EMPTY;
+    }
+
+    Rectangle local;
+    getLocalBounds(local);
+
+    Matrix transform;
+    transform.copyFrom(&mtx);
+    transformBounds(&transform, &local, &bounds);
+    return NATIVEBOUNDS_KNOWN;
+}
+}
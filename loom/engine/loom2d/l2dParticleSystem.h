@@ -0,0 +1,273 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#pragma once
+
+#include "loom/common/utils/utRandom.h"
+#include "loom/engine/loom2d/l2dDisplayObject.h"
+#include "loom/engine/loom2d/l2dDisplayObjectContainer.h"
+#include "loom/graphics/gfxQuadRenderer.h"
+#include "loom/graphics/gfxShader.h"
+
+namespace Loom2D
+{
+
+// Native side of the ParticleSystem script class, simulates and draws
+// particles configured like the Particle Designer emitters of Starling's
+// PDParticleSystem. Particle state is kept in one array per attribute so
+// the update loops run over contiguous memory.
+class ParticleSystem : public DisplayObject
+{
+public:
+
+    enum EmitterType
+    {
+        EMITTER_GRAVITY = 0,
+        EMITTER_RADIAL  = 1
+    };
+
+    // Per particle attributes, each stored in an array of maxParticles
+    enum Field
+    {
+        FIELD_X,
+        FIELD_Y,
+        FIELD_START_X,
+        FIELD_START_Y,
+        FIELD_VELOCITY_X,
+        FIELD_VELOCITY_Y,
+        FIELD_RADIAL_ACCELERATION,
+        FIELD_TANGENTIAL_ACCELERATION,
+        FIELD_EMIT_RADIUS,
+        FIELD_EMIT_RADIUS_DELTA,
+        FIELD_EMIT_ROTATION,
+        FIELD_EMIT_ROTATION_DELTA,
+        FIELD_ROTATION,
+        FIELD_ROTATION_DELTA,
+        FIELD_SIZE,
+        FIELD_SIZE_DELTA,
+        FIELD_RED,
+        FIELD_GREEN,
+        FIELD_BLUE,
+        FIELD_ALPHA,
+        FIELD_RED_DELTA,
+        FIELD_GREEN_DELTA,
+        FIELD_BLUE_DELTA,
+        FIELD_ALPHA_DELTA,
+        FIELD_CURRENT_TIME,
+        FIELD_TOTAL_TIME,
+        FIELD_COUNT
+    };
+
+    static Type *typeParticleSystem;
+
+    static void initialize(lua_State *L)
+    {
+        typeParticleSystem = LSLuaState::getLuaState(L)->getType("loom2d.display.ParticleSystem");
+        lmAssert(typeParticleSystem, "unable to get loom2d.display.ParticleSystem type");
+    }
+
+    // Emitter configuration, angles are in radians
+
+    int      emitterType;
+    lmscalar emitterX, emitterY;
+    lmscalar emitterXVariance, emitterYVariance;
+    lmscalar lifespan, lifespanVariance;
+    lmscalar startSize, startSizeVariance;
+    lmscalar endSize, endSizeVariance;
+    lmscalar emitAngle, emitAngleVariance;
+    lmscalar startRotation, startRotationVariance;
+    lmscalar endRotation, endRotationVariance;
+
+    // gravity emitters
+    lmscalar speed, speedVariance;
+    lmscalar gravityX, gravityY;
+    lmscalar radialAcceleration, radialAccelerationVariance;
+    lmscalar tangentialAcceleration, tangentialAccelerationVariance;
+
+    // radial emitters
+    lmscalar maxRadius, maxRadiusVariance;
+    lmscalar minRadius, minRadiusVariance;
+    lmscalar rotatePerSecond, rotatePerSecondVariance;
+
+    // red, green, blue, alpha in [0, 1]
+    lmscalar startColor[4], startColorVariance[4];
+    lmscalar endColor[4], endColorVariance[4];
+
+    // Particles emitted per second
+    lmscalar emissionRate;
+
+    // Emitter duration in seconds, negative emits until stopped
+    lmscalar duration;
+
+    uint32_t blendSrc, blendDst;
+
+    int nativeTextureID;
+    GFX::ShaderProgram *shader;
+
+    // Region of the texture drawn and the particle aspect ratio from it
+    float    textureU0, textureV0, textureU1, textureV1;
+    lmscalar textureAspect;
+    bool     premultipliedAlpha;
+
+    ParticleSystem();
+    ~ParticleSystem();
+
+    // Reads a Particle Designer .pex configuration, returns false if the
+    // XML couldn't be parsed
+    bool loadConfig(const char *xml);
+
+    // Starts emitting for the duration in seconds, negative uses the
+    // configured duration
+    void start(lmscalar duration);
+
+    // Stops emitting, clearing existing particles if requested
+    void stop(bool clear);
+
+    // Removes all particles
+    void clear();
+
+    // Advances the simulation, returns true once the emitter has stopped
+    // and the last particle died during this step
+    bool advanceTime(lmscalar passedTime);
+
+    void render(lua_State *L);
+
+    bool collectDamage(lua_State *L, DamageRegion &damage, Rectangle &bounds);
+
+    NativeBounds getNativeBounds(const Matrix &mtx, Rectangle &bounds);
+
+    bool prepareStaticBatch(lua_State *L)
+    {
+        // Particles change every frame, baking them is never worth it
+        validate(L, lua_gettop(L));
+        return false;
+    }
+
+    void setTextureRegion(float u0, float v0, float u1, float v1, lmscalar width, lmscalar height);
+
+    inline int getNumParticles() const
+    {
+        return numParticles;
+    }
+
+    inline int getMaxParticles() const
+    {
+        return maxParticles;
+    }
+
+    // Resizes the particle storage, particles past the new capacity die
+    void setMaxParticles(int value);
+
+    inline bool getIsEmitting() const
+    {
+        return emissionTime > 0;
+    }
+
+    inline int getNativeTextureID() const
+    {
+        return nativeTextureID;
+    }
+
+    inline void setNativeTextureID(int value)
+    {
+        nativeTextureID = value;
+    }
+
+    inline bool getPremultipliedAlpha() const
+    {
+        return premultipliedAlpha;
+    }
+
+    inline void setPremultipliedAlpha(bool value)
+    {
+        premultipliedAlpha = value;
+    }
+
+    void setShader(GFX::ShaderProgram *sh)
+    {
+        shader = sh;
+    }
+
+    GFX::ShaderProgram *getShader() const
+    {
+        return shader;
+    }
+
+    inline lmscalar getEmitterX() const { return emitterX; }
+    inline void setEmitterX(lmscalar value) { emitterX = value; }
+    inline lmscalar getEmitterY() const { return emitterY; }
+    inline void setEmitterY(lmscalar value) { emitterY = value; }
+    inline lmscalar getEmissionRate() const { return emissionRate; }
+    inline void setEmissionRate(lmscalar value) { emissionRate = value; }
+    inline lmscalar getGravityX() const { return gravityX; }
+    inline void setGravityX(lmscalar value) { gravityX = value; }
+    inline lmscalar getGravityY() const { return gravityY; }
+    inline void setGravityY(lmscalar value) { gravityY = value; }
+    inline lmscalar getLifespan() const { return lifespan; }
+    inline void setLifespan(lmscalar value) { lifespan = value; }
+    inline lmscalar getSpeed() const { return speed; }
+    inline void setSpeed(lmscalar value) { speed = value; }
+    inline lmscalar getEmitAngle() const { return emitAngle; }
+    inline void setEmitAngle(lmscalar value) { emitAngle = value; }
+    inline lmscalar getStartSize() const { return startSize; }
+    inline void setStartSize(lmscalar value) { startSize = value; }
+    inline lmscalar getEndSize() const { return endSize; }
+    inline void setEndSize(lmscalar value) { endSize = value; }
+
+private:
+
+    inline float *field(int f)
+    {
+        return particleData + f * maxParticles;
+    }
+
+    inline lmscalar randomVariance()
+    {
+        return (lmscalar)random.randRange(-1.0f, 1.0f);
+    }
+
+    // Initializes the particle at the index from the configuration
+    void initParticle(int index);
+
+    // Moves the particles in [first, first + count) ahead in time
+    void advanceParticles(int first, int count, float passedTime);
+
+    // Removes particles that outlived their lifespan
+    void removeDeadParticles();
+
+    // Bounds of all particles in local coordinates
+    void getLocalBounds(Rectangle &bounds);
+
+    // maxParticles floats for each Field
+    float *particleData;
+
+    int numParticles;
+    int maxParticles;
+
+    // Time left to emit and time since the last particle was emitted
+    lmscalar emissionTime;
+    lmscalar frameTime;
+
+    // Changes whenever the particles do, for damage tracking
+    uint32_t simulationStep;
+
+    utRandomNumberGenerator random;
+};
+}
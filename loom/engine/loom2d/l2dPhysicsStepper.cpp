@@ -0,0 +1,141 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/engine/loom2d/l2dPhysicsStepper.h"
+#include <math.h>
+
+namespace Loom2D
+{
+utArray<PhysicsStepper *> PhysicsStepper::sSteppers;
+
+PhysicsStepper::PhysicsStepper()
+{
+    timeStep           = (lmscalar)(1.0 / 60.0);
+    maxSteps           = 5;
+    velocityIterations = 8;
+    positionIterations = 3;
+    interpolate        = true;
+    world       = NULL;
+    sync        = NULL;
+    accumulator = 0;
+    droppedTime = 0;
+    numSteps    = 0;
+    sSteppers.push_back(this);
+}
+
+
+PhysicsStepper::~PhysicsStepper()
+{
+    sSteppers.erase(this, true);
+}
+
+
+void PhysicsStepper::setWorld(b2World *value)
+{
+    if (value)
+    {
+        BodySync::watchWorld(value);
+    }
+
+    world = value;
+    reset();
+}
+
+
+void PhysicsStepper::advanceTime(lmscalar time)
+{
+    numSteps = 0;
+
+    if (!world || timeStep <= 0)
+    {
+        return;
+    }
+
+    accumulator += time;
+
+    // The delegate may detach the world, check it every step.
+    while (world && accumulator >= timeStep && numSteps < maxSteps)
+    {
+        if (sync && interpolate)
+        {
+            sync->savePrevious();
+        }
+
+        world->Step((float32)timeStep, velocityIterations, positionIterations);
+
+        accumulator -= timeStep;
+        numSteps++;
+
+        _StepDelegate.invoke();
+    }
+
+    if (accumulator >= timeStep)
+    {
+        lmscalar left = fmod(accumulator, timeStep);
+        droppedTime += accumulator - left;
+        accumulator  = left;
+    }
+
+    if (!sync)
+    {
+        return;
+    }
+
+    if (interpolate)
+    {
+        sync->syncInterpolated(getAlpha());
+    }
+    else
+    {
+        sync->sync();
+    }
+}
+
+
+void PhysicsStepper::reset()
+{
+    accumulator = 0;
+    numSteps    = 0;
+}
+
+
+void PhysicsStepper::removeWorld(b2World *world)
+{
+    for (UTsize i = 0; i < sSteppers.size(); i++)
+    {
+        if (sSteppers[i]->world == world)
+        {
+            sSteppers[i]->world = NULL;
+        }
+    }
+}
+
+
+void PhysicsStepper::removeSync(BodySync *sync)
+{
+    for (UTsize i = 0; i < sSteppers.size(); i++)
+    {
+        if (sSteppers[i]->sync == sync)
+        {
+            sSteppers[i]->sync = NULL;
+        }
+    }
+}
+}
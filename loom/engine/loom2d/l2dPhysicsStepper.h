@@ -0,0 +1,115 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#pragma once
+
+#include "loom/common/utils/utTypes.h"
+#include "loom/script/native/lsNativeDelegate.h"
+#include "loom/engine/loom2d/l2dBodySync.h"
+
+namespace Loom2D
+{
+
+// Native side of the PhysicsStepper script class, steps a Box2D world at a
+// fixed rate from the variable frame time it is advanced by and has a
+// BodySync interpolate between the last two steps.
+class PhysicsStepper
+{
+public:
+
+    // Called after every step
+    LOOM_DELEGATE(Step);
+
+    // Seconds simulated by every step
+    lmscalar timeStep;
+
+    // Most steps taken in one advanceTime, time beyond them is dropped so a
+    // long frame slows the simulation down instead of making the next
+    // frames longer still
+    int maxSteps;
+
+    int velocityIterations;
+    int positionIterations;
+
+    // Have the BodySync interpolate instead of showing the last step
+    bool interpolate;
+
+    PhysicsStepper();
+    ~PhysicsStepper();
+
+    inline b2World *getWorld() const
+    {
+        return world;
+    }
+
+    void setWorld(b2World *value);
+
+    inline BodySync *getSync() const
+    {
+        return sync;
+    }
+
+    inline void setSync(BodySync *value)
+    {
+        sync = value;
+    }
+
+    // Takes the fixed steps that fit into the time and the time left over
+    // from before, then syncs
+    void advanceTime(lmscalar time);
+
+    // Drops the time left over
+    void reset();
+
+    // Fraction of a step left over, the interpolation alpha
+    inline lmscalar getAlpha() const
+    {
+        return timeStep > 0 ? accumulator / timeStep : 0;
+    }
+
+    // Steps taken by the last advanceTime
+    inline int getNumSteps() const
+    {
+        return numSteps;
+    }
+
+    // Total time dropped because of maxSteps
+    inline lmscalar getDroppedTime() const
+    {
+        return droppedTime;
+    }
+
+    // Detach a world or a sync that is about to be deleted from every
+    // stepper
+    static void removeWorld(b2World *world);
+    static void removeSync(BodySync *sync);
+
+private:
+
+    b2World  *world;
+    BodySync *sync;
+
+    lmscalar accumulator;
+    lmscalar droppedTime;
+    int      numSteps;
+
+    static utArray<PhysicsStepper *> sSteppers;
+};
+}
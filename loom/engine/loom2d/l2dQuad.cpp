@@ -39,6 +39,7 @@ void Quad::updateNativeVertexData(lua_State *L, int index)
     if (nativeVertexDataInvalid)
     {
         nativeVertexDataInvalid = false;
+        worldVerticesValid = false;
 
         const char *vmember = imageOrDerived ? "mVertexDataCache" : "mVertexData";
 
@@ -129,31 +130,99 @@ void Quad::render(lua_State *L)
     if (renderState.isClipping()) GFX::Graphics::setClipRect((int)renderState.clipRect.x, (int)renderState.clipRect.y, (int)renderState.clipRect.width, (int)renderState.clipRect.height);
 
     GFX::VertexPosColorTex *v = GFX::QuadRenderer::getQuadVertexMemory(4, nativeTextureID, blendEnabled, blendSrc, blendDst, shader);
-    GFX::VertexPosColorTex *src = quadVertices;
 
     if (!v)
     {
         return;
     }
-    for (int i = 0; i < 4; i++)
+
+    // Static quads draw the same vertices every frame, only transform
+    // them again when the world matrix or alpha moved
+    const Matrix &last = worldVerticesMatrix;
+    if (!worldVerticesValid || renderState.alpha != worldVerticesAlpha ||
+        mtx.a != last.a || mtx.b != last.b || mtx.c != last.c || mtx.d != last.d ||
+        mtx.tx != last.tx || mtx.ty != last.ty)
     {
-        *v = *src;
-        src++;
+        transformVertices(mtx, renderState.alpha, quadVertices, worldVertices, 4);
+        worldVerticesMatrix.copyFrom(&mtx);
+        worldVerticesAlpha = renderState.alpha;
+        worldVerticesValid = true;
+    }
 
-        lmscalar _x = mtx.a * v->x + mtx.c * v->y + mtx.tx;
-        lmscalar _y = mtx.b * v->x + mtx.d * v->y + mtx.ty;
+    memcpy(v, worldVertices, sizeof(worldVertices));
+}
+
+void Quad::transformVertices(const Matrix &mtx, lmscalar alpha, const GFX::VertexPosColorTex *src, GFX::VertexPosColorTex *dst, int count)
+{
+    memcpy(dst, src, sizeof(GFX::VertexPosColorTex) * count);
 
-        v->x = (float) _x;
-        v->y = (float) _y;
+    mtx.transformPoints(&src[0].x, sizeof(GFX::VertexPosColorTex), &dst[0].x, sizeof(GFX::VertexPosColorTex), count);
 
-        // modulate vertex alpha by our DisplayObject alpha setting
-        if (renderState.alpha != 1.0f)
+    // modulate vertex alpha by our DisplayObject alpha setting
+    if (alpha != 1.0f)
+    {
+        const float fa = (float)alpha;
+        for (int i = 0; i < count; i++)
         {
-            lmscalar va = ((float)(v->abgr >> 24)) * renderState.alpha;
-            v->abgr = ((uint32_t)va << 24) | (v->abgr & 0x00FFFFFF);
+            uint32_t va = (uint32_t)((float)(dst[i].abgr >> 24) * fa);
+            dst[i].abgr = (va << 24) | (dst[i].abgr & 0x00FFFFFF);
         }
+    }
+}
+
+bool Quad::collectDamage(lua_State *L, DamageRegion &damage, Rectangle &bounds)
+{
+    GFX::TextureInfo *tinfo = nativeTextureID == -1 ? NULL : GFX::Texture::getTextureInfo(nativeTextureID);
+
+    updateRenderState();
+    if (!tinfo || renderState.alpha == 0.0f)
+    {
+        noteDamage(damage, false, bounds, 0);
+        return false;
+    }
+
+    updateLocalTransform();
+
+    Matrix mtx;
+    getTargetTransformationMatrix(NULL, &mtx);
+
+    getVertexBounds(mtx, quadVertices, 4, renderState, bounds);
+
+    uint32_t signature = getDamageSignature(mtx);
+    signature = DamageRegion::hash(signature, quadVertices, sizeof(quadVertices));
+    signature = DamageRegion::hash(signature, &nativeTextureID, sizeof(nativeTextureID));
+    signature = DamageRegion::hash(signature, &tinfo->contentVersion, sizeof(tinfo->contentVersion));
+    signature = DamageRegion::hash(signature, &shader, sizeof(shader));
+
+    noteDamage(damage, true, bounds, signature);
+    return true;
+}
+
+DisplayObject::NativeBounds Quad::getNativeBounds(const Matrix &mtx, Rectangle &bounds)
+{
+    RenderState unclipped;
+    unclipped.clipRect = Rectangle(0, 0, -1, -1);
+
+    getVertexBounds(mtx, quadVertices, 4, unclipped, bounds);
+    return NATIVEBOUNDS_KNOWN;
+}
 
-        v++;
+void Quad::getVertexBounds(const Matrix &mtx, const GFX::VertexPosColorTex *vertices, int count, const RenderState &state, Rectangle &bounds)
+{
+    if (count == 0)
+    {
+        bounds.setTo(0, 0, 0, 0);
+        return;
+    }
+
+    lmscalar minx, miny, maxx, maxy;
+    mtx.transformPointsBounds(&vertices[0].x, sizeof(GFX::VertexPosColorTex), count, &minx, &miny, &maxx, &maxy);
+
+    bounds.setTo(minx, miny, maxx - minx, maxy - miny);
+
+    if (state.clipRect.width != -1.f)
+    {
+        bounds.clip(state.clipRect.x, state.clipRect.y, state.clipRect.width, state.clipRect.height);
     }
 }
 }
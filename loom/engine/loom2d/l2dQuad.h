@@ -38,12 +38,21 @@ public:
     bool nativeVertexDataInvalid;
     bool tinted;
 
+    // quadVertices transformed by worldVerticesMatrix with
+    // worldVerticesAlpha applied, reused while neither changed
+    GFX::VertexPosColorTex worldVertices[4];
+    Matrix   worldVerticesMatrix;
+    lmscalar worldVerticesAlpha;
+    bool     worldVerticesValid;
+
     int nativeTextureID;
 
     Quad()
     {
         type = typeQuad;
         tinted = false;
+        worldVerticesAlpha = 1;
+        worldVerticesValid = false;
         shader = GFX::ShaderProgram::getDefaultShader();
     }
 
@@ -55,6 +64,7 @@ public:
     void setNativeTextureID(int value)
     {
         nativeTextureID = value;
+        invalidateContent();
     }
 
     inline bool getNativeVertexDataInvalid() const
@@ -65,11 +75,23 @@ public:
     inline void setNativeVertexDataInvalid(bool value)
     {
         nativeVertexDataInvalid = value;
+        if (value)
+        {
+            worldVerticesValid = false;
+            invalidateContent();
+        }
     }
 
     void setShader(GFX::ShaderProgram* sh)
     {
         shader = sh;
+        invalidateStaticBatches();
+    }
+
+    bool prepareStaticBatch(lua_State *L)
+    {
+        validate(L, lua_gettop(L));
+        return hasOnlyNativeRender();
     }
 
     GFX::ShaderProgram* getShader() const
@@ -77,6 +99,13 @@ public:
         return shader;
     }
 
+    // Image checks its script side vertex cache in validate, it's only
+    // invalidated together with the native vertex data
+    virtual bool needsValidate() const
+    {
+        return !valid || nativeVertexDataInvalid;
+    }
+
     virtual void validate(lua_State *L, int index)
     {
         int top = lua_gettop(L);
@@ -112,5 +141,16 @@ public:
     }
 
     void render(lua_State *L);
+
+    bool collectDamage(lua_State *L, DamageRegion &damage, Rectangle &bounds);
+
+    NativeBounds getNativeBounds(const Matrix &mtx, Rectangle &bounds);
+
+    // Copies the vertices to dst transformed by the matrix and with the
+    // alpha modulated in
+    static void transformVertices(const Matrix &mtx, lmscalar alpha, const GFX::VertexPosColorTex *src, GFX::VertexPosColorTex *dst, int count);
+
+    // Screen bounds of vertices drawn with the transform, clipped to the render state
+    static void getVertexBounds(const Matrix &mtx, const GFX::VertexPosColorTex *vertices, int count, const RenderState &state, Rectangle &bounds);
 };
 }
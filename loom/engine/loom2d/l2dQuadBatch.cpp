@@ -21,6 +21,8 @@
 #include "l2dQuadBatch.h"
 #include "loom/engine/loom2d/l2dBlendMode.h"
 #include "loom/graphics/gfxGraphics.h"
+#include "loom/common/utils/utByteArray.h"
+#include "loom/common/utils/utEndian.h"
 
 namespace Loom2D
 {
@@ -68,8 +70,7 @@ void QuadBatch::render(lua_State *L)
     getTargetTransformationMatrix(NULL, &mtx);
     
     // quick render and early out of the entire function if the transform is identity and there is no alpha modulation by the render state
-    bool isIdentity = mtx.isIdentity();
-    if((renderState.alpha == 1.0f) && isIdentity)
+    if((renderState.alpha == 1.0f) && mtx.isIdentity())
     {
         GFX::QuadRenderer::batch(quadData, 4 * numQuads, nativeTextureID, blendEnabled, blendSrc, blendDst, shader);
         return;
@@ -80,34 +81,171 @@ void QuadBatch::render(lua_State *L)
     {
         return;
     }
-    GFX::VertexPosColorTex *src = quadData;
-
 
     // transform all quads in the batch and submit them to the QuadBatcher
-    for (int i = 0; i < numQuads * 4; i++)
+    Quad::transformVertices(mtx, renderState.alpha, quadData, v, 4 * numQuads);
+}
+
+bool QuadBatch::collectDamage(lua_State *L, DamageRegion &damage, Rectangle &bounds)
+{
+    GFX::TextureInfo *tinfo = nativeTextureID == -1 ? NULL : GFX::Texture::getTextureInfo(nativeTextureID);
+
+    updateRenderState();
+    if (!tinfo || renderState.alpha == 0.0f || numQuads == 0)
     {
-        *v = *src;
+        noteDamage(damage, false, bounds, 0);
+        return false;
+    }
 
-        // only do matrix transform if the matrix is not identity
-        if(!isIdentity)
-        {
-            lmscalar _x = mtx.a * v->x + mtx.c * v->y + mtx.tx;
-            lmscalar _y = mtx.b * v->x + mtx.d * v->y + mtx.ty;
+    updateLocalTransform();
 
-            v->x = (float) _x;
-            v->y = (float) _y;
-        }
+    Matrix mtx;
+    getTargetTransformationMatrix(NULL, &mtx);
+
+    Quad::getVertexBounds(mtx, quadData, numQuads * 4, renderState, bounds);
+
+    uint32_t signature = getDamageSignature(mtx);
+    signature = DamageRegion::hash(signature, quadData, sizeof(GFX::VertexPosColorTex) * 4 * numQuads);
+    signature = DamageRegion::hash(signature, &nativeTextureID, sizeof(nativeTextureID));
+    signature = DamageRegion::hash(signature, &tinfo->contentVersion, sizeof(tinfo->contentVersion));
+    signature = DamageRegion::hash(signature, &shader, sizeof(shader));
+
+    noteDamage(damage, true, bounds, signature);
+    return true;
+}
+
+DisplayObject::NativeBounds QuadBatch::getNativeBounds(const Matrix &mtx, Rectangle &bounds)
+{
+    if (numQuads == 0)
+    {
+        return NATIVEBOUNDS_EMPTY;
+    }
+
+    RenderState unclipped;
+    unclipped.clipRect = Rectangle(0, 0, -1, -1);
+
+    Quad::getVertexBounds(mtx, quadData, numQuads * 4, unclipped, bounds);
+    return NATIVEBOUNDS_KNOWN;
+}
+
+void QuadBatch::reserve(int quads)
+{
+    if (quads <= maxQuads)
+    {
+        return;
+    }
+
+    GFX::VertexPosColorTex *newData = (GFX::VertexPosColorTex *)lmAlloc(NULL, sizeof(GFX::VertexPosColorTex) * 4 * quads);
+
+    if (quadData)
+    {
+        memcpy(newData, quadData, numQuads * sizeof(GFX::VertexPosColorTex) * 4);
+        lmFree(NULL, quadData);
+    }
+
+    // Batches are held by script, let the GC see their vertices
+    loom_allocator_reportExternal((long long)sizeof(GFX::VertexPosColorTex) * 4 * (quads - maxQuads));
 
-        // modulate vertex alpha by our DisplayObject alpha setting
-        if (renderState.alpha != 1.0f)
+    quadData = newData;
+    maxQuads = quads;
+}
+
+// Packed records carry 0xAARRGGBB like the script side, vertices want ABGR
+static inline uint32_t recordColorToABGR(uint32_t argb)
+{
+    return (argb & 0xFF00FF00) | ((argb >> 16) & 0xFF) | ((argb & 0xFF) << 16);
+}
+
+int QuadBatch::addQuadNumbers(lua_State *L)
+{
+    int offset = (int)lua_tointeger(L, 3);
+    int count = (int)lua_tointeger(L, 4);
+
+    lua_rawgeti(L, 2, LSINDEXVECTOR);
+    int vectorIdx = lua_gettop(L);
+
+    int length = lsr_vector_get_length(L, 2);
+    int available = offset >= 0 && offset < length ? (length - offset) / (QUADBATCH_RECORD_VALUES * 4) : 0;
+    if (count < 0) count = available;
+    lmAssert(count <= available, "QuadBatch.addQuadNumbers given fewer values than quads");
+
+    // Grow geometrically so repeated bulk adds don't reallocate each time
+    if (numQuads + count > maxQuads)
+    {
+        reserve(lmMax(numQuads + count, maxQuads * 2));
+    }
+
+    GFX::VertexPosColorTex *dst = &quadData[numQuads * 4];
+    int index = offset;
+
+    for (int i = 0; i < count * 4; i++, dst++)
+    {
+        lua_rawgeti(L, vectorIdx, index++);
+        lua_rawgeti(L, vectorIdx, index++);
+        lua_rawgeti(L, vectorIdx, index++);
+        lua_rawgeti(L, vectorIdx, index++);
+        lua_rawgeti(L, vectorIdx, index++);
+
+        dst->x = (float)lua_tonumber(L, -5);
+        dst->y = (float)lua_tonumber(L, -4);
+        dst->z = 0;
+        dst->u = (float)lua_tonumber(L, -3);
+        dst->v = (float)lua_tonumber(L, -2);
+        dst->abgr = recordColorToABGR((uint32_t)lua_tonumber(L, -1));
+
+        lua_pop(L, 5);
+    }
+
+    lua_settop(L, vectorIdx - 1);
+
+    numQuads += count;
+    invalidateStaticBatches();
+
+    return 0;
+}
+
+int QuadBatch::addQuadBytes(lua_State *L)
+{
+    utByteArray *bytes = (utByteArray *)lualoom_getnativepointer(L, 2, true, "system.ByteArray");
+    int count = (int)lua_tointeger(L, 3);
+
+    int available = (int)(bytes->bytesAvailable() / QUADBATCH_RECORD_BYTES);
+    if (count < 0) count = available;
+    lmAssert(count <= available, "QuadBatch.addQuadBytes given fewer bytes than quads");
+
+    if (numQuads + count > maxQuads)
+    {
+        reserve(lmMax(numQuads + count, maxQuads * 2));
+    }
+
+    const unsigned char *src = (const unsigned char *)bytes->getDataPtr() + bytes->getPosition();
+    GFX::VertexPosColorTex *dst = &quadData[numQuads * 4];
+
+    for (int i = 0; i < count * 4; i++, dst++)
+    {
+        // records aren't necessarily aligned within the ByteArray
+        uint32_t record[QUADBATCH_RECORD_VALUES];
+        memcpy(record, src, sizeof(record));
+        src += sizeof(record);
+
+        for (int j = 0; j < QUADBATCH_RECORD_VALUES; j++)
         {
-            //TODO: LOOM-1624
-            lmscalar va = ((lmscalar)(v->abgr >> 24)) * renderState.alpha;
-            v->abgr = ((uint32_t)va << 24) | (v->abgr & 0x00FFFFFF);
+            record[j] = convertLEndianToHost((unsigned int)record[j]);
         }
 
-        v++;
-        src++;
+        memcpy(&dst->x, &record[0], sizeof(float));
+        memcpy(&dst->y, &record[1], sizeof(float));
+        dst->z = 0;
+        memcpy(&dst->u, &record[2], sizeof(float));
+        memcpy(&dst->v, &record[3], sizeof(float));
+        dst->abgr = recordColorToABGR(record[4]);
     }
+
+    bytes->setPosition(bytes->getPosition() + count * QUADBATCH_RECORD_BYTES);
+
+    numQuads += count;
+    invalidateStaticBatches();
+
+    return 0;
 }
 }
@@ -32,6 +32,11 @@ namespace Loom2D
 {
 #define DEFAULT_QUADS    32
 
+// Values per vertex in the packed quad records of addQuadNumbers and
+// addQuadBytes: x, y, u, v and a 0xAARRGGBB color
+#define QUADBATCH_RECORD_VALUES    5
+#define QUADBATCH_RECORD_BYTES     (QUADBATCH_RECORD_VALUES * 4 * 4)
+
 // Native side of the QuadBatch script class
 class QuadBatch : public DisplayObject
 {
@@ -64,6 +69,10 @@ public:
     // renders the QuadBatch
     void render(lua_State *L);
 
+    bool collectDamage(lua_State *L, DamageRegion &damage, Rectangle &bounds);
+
+    NativeBounds getNativeBounds(const Matrix &mtx, Rectangle &bounds);
+
     // retrieves the number of quads currently rendered by the batch
     inline int getNumQuads() const
     {
@@ -85,6 +94,7 @@ public:
         if (quadData)
         {
             lmFree(NULL, quadData);
+            loom_allocator_reportExternal(-(long long)sizeof(GFX::VertexPosColorTex) * 4 * maxQuads);
         }
     }
 
@@ -97,11 +107,19 @@ public:
     void setNativeTextureID(int value)
     {
         nativeTextureID = value;
+        invalidateStaticBatches();
     }
 
     void setShader(GFX::ShaderProgram* sh)
     {
         shader = sh;
+        invalidateStaticBatches();
+    }
+
+    bool prepareStaticBatch(lua_State *L)
+    {
+        validate(L, lua_gettop(L));
+        return hasOnlyNativeRender();
     }
 
     GFX::ShaderProgram* getShader() const
@@ -113,6 +131,7 @@ public:
     int reset(lua_State *L)
     {
         numQuads = 0;
+        invalidateStaticBatches();
         return 0;
     }
 
@@ -134,47 +153,16 @@ public:
         Matrix mtx;
         getTargetTransformationMatrix(targetSpace, &mtx);
 
-        lmscalar minx = 1000000;
-        lmscalar maxx = -1000000;
-
-        lmscalar miny = 1000000;
-        lmscalar maxy = -1000000;
-
-
-        // calculate bounding rect
-        for (int i = 0; i < numQuads; i++)
+        if (numQuads == 0)
         {
-            GFX::VertexPosColorTex *v = &quadData[i * 4];
-
-            for (int j = 0; j < 4; j++)
-            {
-                lmscalar x = mtx.a * v->x + mtx.c * v->y + mtx.tx;
-                lmscalar y = mtx.b * v->x + mtx.d * v->y + mtx.ty;
-
-                if (x < minx)
-                {
-                    minx = x;
-                }
-
-                if (x > maxx)
-                {
-                    maxx = x;
-                }
-
-                if (y < miny)
-                {
-                    miny = y;
-                }
-
-                if (y > maxy)
-                {
-                    maxy = y;
-                }
-
-                v++;
-            }
+            resultRect->setTo(0, 0, 0, 0);
+            return 0;
         }
 
+        // calculate bounding rect
+        lmscalar minx, miny, maxx, maxy;
+        mtx.transformPointsBounds(&quadData[0].x, sizeof(GFX::VertexPosColorTex), numQuads * 4, &minx, &miny, &maxx, &maxy);
+
         resultRect->x      = minx;
         resultRect->y      = miny;
         resultRect->width  = maxx - minx;
@@ -183,6 +171,10 @@ public:
         return 0;
     }
 
+    // makes room for at least the given number of quads without
+    // reallocating as they are added
+    void reserve(int quads);
+
     // adds a quad to the QuadBatch
     int _addQuad(lua_State *L)
     {
@@ -195,16 +187,7 @@ public:
         // check whether we need to allocate more quad storage
         if (numQuads == maxQuads)
         {
-            maxQuads = (maxQuads == 0) ? DEFAULT_QUADS : maxQuads * 2;
-            GFX::VertexPosColorTex *newData = (GFX::VertexPosColorTex *)lmAlloc(NULL, sizeof(GFX::VertexPosColorTex) * 4 * maxQuads);
-
-            if (quadData)
-            {
-                memcpy(newData, quadData, numQuads * sizeof(GFX::VertexPosColorTex) * 4);
-                lmFree(NULL, quadData);
-            }
-
-            quadData = newData;
+            reserve((maxQuads == 0) ? DEFAULT_QUADS : maxQuads * 2);
         }
 
         // ... and add the (transformed) quad data to the batch
@@ -214,6 +197,16 @@ public:
         return 0;
     }
 
+    // adds quads from packed records in a Vector.<Number>, arguments are
+    // the vector, the index of the first value and the number of quads
+    // with -1 taking every record left in the vector
+    int addQuadNumbers(lua_State *L);
+
+    // adds quads from packed records in a ByteArray starting at its
+    // position, arguments are the ByteArray and the number of quads with
+    // -1 taking every record left. Values are little endian 32 bit floats
+    // with an unsigned int color, the position is moved past the records.
+    int addQuadBytes(lua_State *L);
 
     // adds a quad to the QuadBatch
     int _updateQuad(lua_State *L)
@@ -239,6 +232,7 @@ public:
     void _setQuadData(int quadID, Quad *quad, Matrix *mtx)
     {
         nativeTextureID = quad->nativeTextureID;
+        invalidateStaticBatches();
 
         GFX::VertexPosColorTex *dst = &quadData[quadID * 4];
         GFX::VertexPosColorTex *src = quad->quadVertices;
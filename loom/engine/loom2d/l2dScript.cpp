@@ -32,6 +32,12 @@
 #include "loom/engine/loom2d/l2dQuad.h"
 #include "loom/engine/loom2d/l2dImage.h"
 #include "loom/engine/loom2d/l2dQuadBatch.h"
+#include "loom/engine/loom2d/l2dParticleSystem.h"
+#include "loom/engine/loom2d/l2dTileLayer.h"
+#include "loom/engine/loom2d/l2dSpriteClip.h"
+#include "loom/engine/loom2d/l2dTweenScheduler.h"
+#include "loom/engine/loom2d/l2dBitmapFont.h"
+#include "loom/engine/loom2d/l2dVirtualLayoutCache.h"
 
 #include "loom/graphics/gfxShader.h"
 
@@ -52,12 +58,17 @@ public:
         Rectangle::initialize(L);
         Matrix::initialize(L);
 
+        EventDispatcher::initialize(L);
+
         DisplayObject::initialize(L);
         DisplayObjectContainer::initialize(L);
         Sprite::initialize(L);
         Quad::initialize(L);
         Image::initialize(L);
         QuadBatch::initialize(L);
+        ParticleSystem::initialize(L);
+        TileLayer::initialize(L);
+        SpriteClip::initialize(L);
 
         sInitialized = true;
     }
@@ -96,12 +107,12 @@ static int registerLoom2D(lua_State *L)
 
        .addStaticConstructor(StaticMatrixConstructor)
 
-       .addProperty("a", &Matrix::get_a, &Matrix::set_a)
-       .addProperty("b", &Matrix::get_b, &Matrix::set_b)
-       .addProperty("c", &Matrix::get_c, &Matrix::set_c)
-       .addProperty("d", &Matrix::get_d, &Matrix::set_d)
-       .addProperty("tx", &Matrix::get_tx, &Matrix::set_tx)
-       .addProperty("ty", &Matrix::get_ty, &Matrix::set_ty)
+       .addPropertyVar("a", &Matrix::a)
+       .addPropertyVar("b", &Matrix::b)
+       .addPropertyVar("c", &Matrix::c)
+       .addPropertyVar("d", &Matrix::d)
+       .addPropertyVar("tx", &Matrix::tx)
+       .addPropertyVar("ty", &Matrix::ty)
 
        .addMethod("toString", &Matrix::toString)
 
@@ -126,10 +137,10 @@ static int registerLoom2D(lua_State *L)
 
        .addStaticConstructor(StaticRectangleConstructor)
 
-       .addProperty("x", &Rectangle::getX, &Rectangle::setX)
-       .addProperty("y", &Rectangle::getY, &Rectangle::setY)
-       .addProperty("width", &Rectangle::getWidth, &Rectangle::setWidth)
-       .addProperty("height", &Rectangle::getHeight, &Rectangle::setHeight)
+       .addPropertyVar("x", &Rectangle::x)
+       .addPropertyVar("y", &Rectangle::y)
+       .addPropertyVar("width", &Rectangle::width)
+       .addPropertyVar("height", &Rectangle::height)
 
     // TODO: these could use the fast path
        .addMethod("__pget_minX", &Rectangle::getMinX)
@@ -164,6 +175,12 @@ static int registerLoom2D(lua_State *L)
 
        .beginClass<EventDispatcher>("EventDispatcher")
        .addConstructor<void (*)(void)>()
+       .addLuaFunction("addEventListener", &EventDispatcher::addEventListener)
+       .addLuaFunction("removeEventListener", &EventDispatcher::removeEventListener)
+       .addLuaFunction("removeEventListeners", &EventDispatcher::removeEventListeners)
+       .addMethod("hasEventListener", &EventDispatcher::hasEventListener)
+       .addLuaFunction("invokeEvent", &EventDispatcher::invokeEvent)
+       .addLuaFunction("bubbleEvent", &EventDispatcher::bubbleEvent)
        .endClass()
 
        .endPackage();
@@ -176,32 +193,35 @@ static int registerLoom2D(lua_State *L)
        .addConstructor<void (*)(void)>()
 
     // fast path properties
-       .addProperty("x", &DisplayObject::getX, &DisplayObject::setX)
-       .addProperty("y", &DisplayObject::getY, &DisplayObject::setY)
-       .addProperty("scaleX", &DisplayObject::getScaleX, &DisplayObject::setScaleX)
-       .addProperty("scaleY", &DisplayObject::getScaleY, &DisplayObject::setScaleY)
-       .addProperty("pivotX", &DisplayObject::getPivotX, &DisplayObject::setPivotX)
-       .addProperty("pivotY", &DisplayObject::getPivotY, &DisplayObject::setPivotY)
-       .addProperty("skewX", &DisplayObject::getSkewX, &DisplayObject::setSkewX)
-       .addProperty("skewY", &DisplayObject::getSkewY, &DisplayObject::setSkewY)
-       .addProperty("rotation", &DisplayObject::getRotation, &DisplayObject::setRotation)
-       .addProperty("alpha", &DisplayObject::getAlpha, &DisplayObject::setAlpha)
-       .addProperty("blendMode", &DisplayObject::getBlendMode, &DisplayObject::setBlendMode)
-       .addProperty("blendEnabled", &DisplayObject::getBlendEnabled, &DisplayObject::setBlendEnabled)
+       .addProperty("x", &DisplayObject::x, &DisplayObject::setX)
+       .addProperty("y", &DisplayObject::y, &DisplayObject::setY)
+       .addProperty("scaleX", &DisplayObject::scaleX, &DisplayObject::setScaleX)
+       .addProperty("scaleY", &DisplayObject::scaleY, &DisplayObject::setScaleY)
+       .addProperty("pivotX", &DisplayObject::pivotX, &DisplayObject::setPivotX)
+       .addProperty("pivotY", &DisplayObject::pivotY, &DisplayObject::setPivotY)
+       .addProperty("skewX", &DisplayObject::skewX, &DisplayObject::setSkewX)
+       .addProperty("skewY", &DisplayObject::skewY, &DisplayObject::setSkewY)
+       .addProperty("rotation", &DisplayObject::rotation, &DisplayObject::setRotation)
+       .addProperty("alpha", &DisplayObject::alpha, &DisplayObject::setAlpha)
+       .addProperty("blendMode", &DisplayObject::blendMode, &DisplayObject::setBlendMode)
+       .addProperty("blendEnabled", &DisplayObject::blendEnabled, &DisplayObject::setBlendEnabled)
 
        .addProperty("name", &DisplayObject::getName, &DisplayObject::setName)
 
-       .addProperty("visible", &DisplayObject::getVisible, &DisplayObject::setVisible)
-       .addProperty("touchable", &DisplayObject::getTouchable, &DisplayObject::setTouchable)
+       .addProperty("visible", &DisplayObject::visible, &DisplayObject::setVisible)
+       .addPropertyVar("touchable", &DisplayObject::touchable)
 
        .addProperty("cacheAsBitmap", &DisplayObject::getCacheAsBitmap, &DisplayObject::setCacheAsBitmap)
        .addMethod("invalidateBitmapCache", &DisplayObject::invalidateBitmapCache)
+       .addProperty("cacheAsBitmapAutoInvalidate", &DisplayObject::getCacheAsBitmapAutoInvalidate, &DisplayObject::setCacheAsBitmapAutoInvalidate)
+       .addProperty("cacheAsBitmapScale", &DisplayObject::getCacheAsBitmapScale, &DisplayObject::setCacheAsBitmapScale)
 
-       .addProperty("depth", &DisplayObject::getDepth, &DisplayObject::setDepth)
+       .addProperty("depth", &DisplayObject::depth, &DisplayObject::setDepth)
 
-       .addProperty("valid", &DisplayObject::getValid, &DisplayObject::setValid)
+       .addProperty("valid", &DisplayObject::valid, &DisplayObject::setValid)
 
        .addMethod("__pset__parent", &DisplayObject::setParent)
+       .addMethod("__pset__mask", &DisplayObject::setMask)
 
        .addLuaFunction("__pget_transformationMatrix", &DisplayObject::getTransformationMatrix)
        .addLuaFunction("__pset_transformationMatrix", &DisplayObject::setTransformationMatrix)
@@ -222,6 +242,11 @@ static int registerLoom2D(lua_State *L)
        .addProperty("depthSort", &DisplayObjectContainer::getDepthSort, &DisplayObjectContainer::setDepthSort)
        //.addProperty("view", &DisplayObjectContainer::getView, &DisplayObjectContainer::setView)
        .addMethod("setClipRect", &DisplayObjectContainer::setClipRect)
+       .addMethod("invalidateChildren", &DisplayObjectContainer::invalidateChildren)
+       .addProperty("culling", &DisplayObjectContainer::getCulling, &DisplayObjectContainer::setCulling)
+       .addProperty("flatten", &DisplayObjectContainer::getFlatten, &DisplayObjectContainer::setFlatten)
+       .addProperty("spatialIndex", &DisplayObjectContainer::getSpatialIndex, &DisplayObjectContainer::setSpatialIndex)
+       .addLuaFunction("getChildrenInRect", &DisplayObjectContainer::getChildrenInRect)
        .endClass()
 
     // Stage
@@ -230,6 +255,11 @@ static int registerLoom2D(lua_State *L)
 
        .addMethod("render", &Stage::render)
        .addMethod("firePendingResizeEvent", &Stage::firePendingResizeEvent)
+       .addMethod("invalidate", &Stage::invalidate)
+       .addMethod("getTouchHistoryLength", &Stage::getTouchHistoryLength)
+       .addMethod("getTouchHistoryX", &Stage::getTouchHistoryX)
+       .addMethod("getTouchHistoryY", &Stage::getTouchHistoryY)
+       .addMethod("getTouchHistoryTime", &Stage::getTouchHistoryTime)
 
        .addMethod("__pget_nativeStageWidth", &Stage::getWidth)
        .addMethod("__pget_nativeStageHeight", &Stage::getHeight)
@@ -241,6 +271,13 @@ static int registerLoom2D(lua_State *L)
 
        .addProperty("vectorQuality", &Stage::getVectorQuality, &Stage::setVectorQuality)
        .addProperty("tessellationQuality", &Stage::getTessellationQuality, &Stage::setTessellationQuality)
+       .addProperty("adaptiveVectorQuality", &Stage::getAdaptiveVectorQuality, &Stage::setAdaptiveVectorQuality)
+       .addProperty("vectorQualityBudget", &Stage::getVectorQualityBudget, &Stage::setVectorQualityBudget)
+       .addProperty("vectorQualityLevel", &Stage::getVectorQualityLevel)
+       .addProperty("batchVectorFills", &Stage::getBatchVectorFills, &Stage::setBatchVectorFills)
+       .addProperty("parallelVectorTessellation", &Stage::getParallelVectorTessellation, &Stage::setParallelVectorTessellation)
+       .addProperty("dirtyRegions", &Stage::getDirtyRegions, &Stage::setDirtyRegions)
+       .addProperty("skipUnchangedFrames", &Stage::getSkipUnchangedFrames, &Stage::setSkipUnchangedFrames)
 
        .addVarAccessor("onTouchBegan", &Stage::getTouchBeganDelegate)
        .addVarAccessor("onTouchMoved", &Stage::getTouchMovedDelegate)
@@ -277,6 +314,7 @@ static int registerLoom2D(lua_State *L)
        .addProperty("align", &GFX::VectorTextFormat::getAlign, &GFX::VectorTextFormat::setAlign)
        .addProperty("letterSpacing", &GFX::VectorTextFormat::getLetterSpacing, &GFX::VectorTextFormat::setLetterSpacing)
        .addProperty("lineHeight", &GFX::VectorTextFormat::getLineHeight, &GFX::VectorTextFormat::setLineHeight)
+       .addProperty("distanceField", &GFX::VectorTextFormat::getDistanceField, &GFX::VectorTextFormat::setDistanceField)
        .endClass()
 
     // SVG
@@ -284,6 +322,7 @@ static int registerLoom2D(lua_State *L)
        .addConstructor<void(*)(void)>()
        .addProperty("width", &GFX::VectorSVG::getWidth)
        .addProperty("height", &GFX::VectorSVG::getHeight)
+       .addProperty("rasterize", &GFX::VectorSVG::getRasterize, &GFX::VectorSVG::setRasterize)
        .addMethod("loadFile", &GFX::VectorSVG::loadFile)
        .addMethod("loadString", &GFX::VectorSVG::loadString)
        .endClass()
@@ -348,8 +387,140 @@ static int registerLoom2D(lua_State *L)
        .addLuaFunction("_updateQuad", &QuadBatch::_updateQuad)
        .addLuaFunction("_getBounds", &QuadBatch::_getBounds)
        .addLuaFunction("reset", &QuadBatch::reset)
+       .addMethod("reserve", &QuadBatch::reserve)
+       .addLuaFunction("_addQuadNumbers", &QuadBatch::addQuadNumbers)
+       .addLuaFunction("_addQuadBytes", &QuadBatch::addQuadBytes)
+       .endClass()
+
+    // ParticleSystem
+       .deriveClass<ParticleSystem, DisplayObject>("ParticleSystem")
+       .addConstructor<void (*)(void)>()
+       .addVarAccessor("shader", &ParticleSystem::getShader, &ParticleSystem::setShader)
+       .addProperty("nativeTextureID", &ParticleSystem::getNativeTextureID, &ParticleSystem::setNativeTextureID)
+       .addProperty("premultipliedAlpha", &ParticleSystem::getPremultipliedAlpha, &ParticleSystem::setPremultipliedAlpha)
+       .addProperty("numParticles", &ParticleSystem::getNumParticles)
+       .addProperty("maxParticles", &ParticleSystem::getMaxParticles, &ParticleSystem::setMaxParticles)
+       .addProperty("isEmitting", &ParticleSystem::getIsEmitting)
+       .addProperty("emitterX", &ParticleSystem::getEmitterX, &ParticleSystem::setEmitterX)
+       .addProperty("emitterY", &ParticleSystem::getEmitterY, &ParticleSystem::setEmitterY)
+       .addProperty("emissionRate", &ParticleSystem::getEmissionRate, &ParticleSystem::setEmissionRate)
+       .addProperty("gravityX", &ParticleSystem::getGravityX, &ParticleSystem::setGravityX)
+       .addProperty("gravityY", &ParticleSystem::getGravityY, &ParticleSystem::setGravityY)
+       .addProperty("lifespan", &ParticleSystem::getLifespan, &ParticleSystem::setLifespan)
+       .addProperty("speed", &ParticleSystem::getSpeed, &ParticleSystem::setSpeed)
+       .addProperty("emitAngle", &ParticleSystem::getEmitAngle, &ParticleSystem::setEmitAngle)
+       .addProperty("startSize", &ParticleSystem::getStartSize, &ParticleSystem::setStartSize)
+       .addProperty("endSize", &ParticleSystem::getEndSize, &ParticleSystem::setEndSize)
+       .addMethod("loadConfig", &ParticleSystem::loadConfig)
+       .addMethod("setTextureRegion", &ParticleSystem::setTextureRegion)
+       .addMethod("start", &ParticleSystem::start)
+       .addMethod("stop", &ParticleSystem::stop)
+       .addMethod("clear", &ParticleSystem::clear)
+       .addMethod("_advanceTime", &ParticleSystem::advanceTime)
+       .endClass()
+
+    // TileLayer
+       .deriveClass<TileLayer, DisplayObject>("TileLayer")
+       .addConstructor<void (*)(void)>()
+       .addVarAccessor("shader", &TileLayer::getShader, &TileLayer::setShader)
+       .addProperty("isometric", &TileLayer::getIsometric, &TileLayer::setIsometric)
+       .addProperty("layerWidth", &TileLayer::getLayerWidth)
+       .addProperty("layerHeight", &TileLayer::getLayerHeight)
+       .addProperty("numChunks", &TileLayer::getNumChunks)
+       .addProperty("numChunksDrawn", &TileLayer::getNumChunksDrawn)
+       .addMethod("setSize", &TileLayer::setSize)
+       .addMethod("_addTileset", &TileLayer::addTileset)
+       .addMethod("clearTilesets", &TileLayer::clearTilesets)
+       .addMethod("setTile", &TileLayer::setTile)
+       .addMethod("getTile", &TileLayer::getTile)
+       .addLuaFunction("setTiles", &TileLayer::setTiles)
+       .addLuaFunction("_getBounds", &TileLayer::_getBounds)
+       .endClass()
+
+    // SpriteClip
+       .deriveClass<SpriteClip, DisplayObject>("SpriteClip")
+       .addConstructor<void (*)(void)>()
+       .addVarAccessor("shader", &SpriteClip::getShader, &SpriteClip::setShader)
+       .addVarAccessor("onComplete", &SpriteClip::getCompleteDelegate)
+       .addProperty("nativeTextureID", &SpriteClip::getNativeTextureID, &SpriteClip::setNativeTextureID)
+       .addProperty("numFrames", &SpriteClip::getNumFrames)
+       .addProperty("totalTime", &SpriteClip::getTotalTime)
+       .addProperty("currentFrame", &SpriteClip::getCurrentFrame, &SpriteClip::setCurrentFrame)
+       .addProperty("currentTime", &SpriteClip::getCurrentTime)
+       .addProperty("loop", &SpriteClip::getLoop, &SpriteClip::setLoop)
+       .addProperty("isPlaying", &SpriteClip::getIsPlaying)
+       .addProperty("isComplete", &SpriteClip::getIsComplete)
+       .addMethod("_addFrame", &SpriteClip::addFrame)
+       .addMethod("clearFrames", &SpriteClip::clearFrames)
+       .addMethod("getFrameDuration", &SpriteClip::getFrameDuration)
+       .addMethod("setFrameDuration", &SpriteClip::setFrameDuration)
+       .addMethod("setFps", &SpriteClip::setFps)
+       .addMethod("play", &SpriteClip::play)
+       .addMethod("pause", &SpriteClip::pause)
+       .addMethod("stop", &SpriteClip::stop)
+       .addStaticMethod("advanceAll", &SpriteClip::advanceAll)
+       .addStaticProperty("numClips", &SpriteClip::getNumClips)
+       .endClass()
+
+
+       .endPackage();
+
+    beginPackage(L, "loom2d.animation")
+
+       .beginClass<TweenScheduler>("TweenScheduler")
+       .addConstructor<void (*)(void)>()
+       .addVarAccessor("onComplete", &TweenScheduler::getCompleteDelegate)
+       .addProperty("numTweens", &TweenScheduler::getNumTweens)
+       .addMethod("tween", &TweenScheduler::tween)
+       .addMethod("setRepeat", &TweenScheduler::setRepeat)
+       .addMethod("cancel", &TweenScheduler::cancel)
+       .addMethod("cancelTweens", &TweenScheduler::cancelTweens)
+       .addMethod("containsTweens", &TweenScheduler::containsTweens)
+       .addMethod("purge", &TweenScheduler::purge)
+       .addMethod("_advanceTime", &TweenScheduler::advanceTime)
+       .endClass()
+
+       .endPackage();
+
+    beginPackage(L, "loom2d.text")
+
+       .beginClass<BitmapFontLayout>("BitmapFontLayout")
+       .addConstructor<void (*)(void)>()
+       .addVar("size", &BitmapFontLayout::size)
+       .addVar("lineHeight", &BitmapFontLayout::lineHeight)
+       .addVar("baseline", &BitmapFontLayout::baseline)
+       .addProperty("scale", &BitmapFontLayout::getScale)
+       .addProperty("measuredWidth", &BitmapFontLayout::getMeasuredWidth)
+       .addProperty("measuredHeight", &BitmapFontLayout::getMeasuredHeight)
+       .addMethod("parse", &BitmapFontLayout::parse)
+       .addMethod("setTexture", &BitmapFontLayout::setTexture)
+       .addMethod("hasChar", &BitmapFontLayout::hasChar)
+       .addMethod("arrange", &BitmapFontLayout::arrange)
+       .addMethod("getCharID", &BitmapFontLayout::getCharID)
+       .addMethod("getCharX", &BitmapFontLayout::getCharX)
+       .addMethod("getCharY", &BitmapFontLayout::getCharY)
+       .addMethod("measure", &BitmapFontLayout::measure)
+       .addLuaFunction("fillQuadBatch", &BitmapFontLayout::fillQuadBatch)
        .endClass()
 
+       .endPackage();
+
+    beginPackage(L, "loom2d.utils")
+
+       .beginClass<VirtualLayoutCache>("VirtualLayoutCache")
+       .addConstructor<void (*)(void)>()
+       .addProperty("typicalSize", &VirtualLayoutCache::getTypicalSize, &VirtualLayoutCache::setTypicalSize)
+       .addProperty("gap", &VirtualLayoutCache::getGap, &VirtualLayoutCache::setGap)
+       .addProperty("length", &VirtualLayoutCache::getLength, &VirtualLayoutCache::setLength)
+       .addMethod("reset", &VirtualLayoutCache::reset)
+       .addMethod("isKnown", &VirtualLayoutCache::isKnown)
+       .addMethod("getSize", &VirtualLayoutCache::getSize)
+       .addMethod("setSize", &VirtualLayoutCache::setSize)
+       .addMethod("insert", &VirtualLayoutCache::insert)
+       .addMethod("remove", &VirtualLayoutCache::remove)
+       .addMethod("getPosition", &VirtualLayoutCache::getPosition)
+       .addMethod("getIndexAt", &VirtualLayoutCache::getIndexAt)
+       .endClass()
 
        .endPackage();
 
@@ -378,4 +549,9 @@ void installLoom2D()
     LOOM_DECLARE_MANAGEDNATIVETYPE(Loom2D::Image, Loom2D::registerLoom2D);
     LOOM_DECLARE_MANAGEDNATIVETYPE(Loom2D::Quad, Loom2D::registerLoom2D);
     LOOM_DECLARE_MANAGEDNATIVETYPE(Loom2D::QuadBatch, Loom2D::registerLoom2D);
+    LOOM_DECLARE_MANAGEDNATIVETYPE(Loom2D::ParticleSystem, Loom2D::registerLoom2D);
+    LOOM_DECLARE_MANAGEDNATIVETYPE(Loom2D::TileLayer, Loom2D::registerLoom2D);
+    LOOM_DECLARE_MANAGEDNATIVETYPE(Loom2D::TweenScheduler, Loom2D::registerLoom2D);
+    LOOM_DECLARE_MANAGEDNATIVETYPE(Loom2D::BitmapFontLayout, Loom2D::registerLoom2D);
+    LOOM_DECLARE_MANAGEDNATIVETYPE(Loom2D::VirtualLayoutCache, Loom2D::registerLoom2D);
 }
@@ -28,6 +28,8 @@ Type *Shape::typeShape = NULL;
 
 void Shape::render(lua_State *L)
 {
+	graphics->resetChangeReported();
+
 	renderState.alpha = parent ? parent->renderState.alpha * alpha : alpha;
 	renderState.clampAlpha();
 	if (renderState.alpha == 0.0f)
@@ -57,4 +59,64 @@ void Shape::render(lua_State *L)
 	}
 }
 
+bool Shape::collectDamage(lua_State *L, DamageRegion &damage, Rectangle &bounds)
+{
+	updateRenderState();
+	if (renderState.alpha == 0.0f)
+	{
+		noteDamage(damage, false, bounds, 0);
+		return false;
+	}
+
+	updateLocalTransform();
+
+	Matrix mtx;
+	getTargetTransformationMatrix(NULL, &mtx);
+
+	if (collectCachedDamage(damage, mtx, bounds))
+		return true;
+
+	if (graphics->boundL >= graphics->boundR || graphics->boundT >= graphics->boundB)
+	{
+		noteDamage(damage, false, bounds, 0);
+		return false;
+	}
+
+	if (graphics->strokeUnscaled)
+	{
+		return NATIVEBOUNDS_UNKNOWN;
+	}
+
+	lmscalar e = graphics->strokeExtent;
+	Rectangle local(graphics->boundL - e, graphics->boundT - e, graphics->boundR - graphics->boundL + 2 * e, graphics->boundB - graphics->boundT + 2 * e);
+	transformBounds(&mtx, &local, &bounds);
+
+	// Antialiasing reaches a pixel past the shape
+	bounds.setTo(bounds.x - 1, bounds.y - 1, bounds.width + 2, bounds.height + 2);
+
+	int clip[4] = { graphics->clipX, graphics->clipY, graphics->clipWidth, graphics->clipHeight };
+	uint32_t signature = getDamageSignature(mtx);
+	signature = DamageRegion::hash(signature, &graphics->version, sizeof(graphics->version));
+	signature = DamageRegion::hash(signature, clip, sizeof(clip));
+
+	if (renderState.isClipping()) bounds.clip(renderState.clipRect.x, renderState.clipRect.y, renderState.clipRect.width, renderState.clipRect.height);
+
+	noteDamage(damage, true, bounds, signature);
+	return true;
+}
+
+DisplayObject::NativeBounds Shape::getNativeBounds(const Matrix &mtx, Rectangle &bounds)
+{
+	if (graphics->boundL >= graphics->boundR || graphics->boundT >= graphics->boundB)
+	{
+		return NATIVEBOUNDS_EMPTY;
+	}
+
+	Rectangle local(graphics->boundL, graphics->boundT, graphics->boundR - graphics->boundL, graphics->boundB - graphics->boundT);
+	Matrix transform;
+	transform.copyFrom(&mtx);
+	transformBounds(&transform, &local, &bounds);
+	return NATIVEBOUNDS_KNOWN;
+}
+
 }
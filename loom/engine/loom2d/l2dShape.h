@@ -53,6 +53,10 @@ public:
 
     void render(lua_State *L);
 
+    bool collectDamage(lua_State *L, DamageRegion &damage, Rectangle &bounds);
+
+    NativeBounds getNativeBounds(const Matrix &mtx, Rectangle &bounds);
+
     static void initialize(lua_State *L)
     {
 		typeShape = LSLuaState::getLuaState(L)->getType("loom2d.display.Shape");
@@ -0,0 +1,205 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/engine/loom2d/l2dSpatialGrid.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+namespace Loom2D
+{
+
+// Cells along each side are capped, items on a grid this fine are
+// small enough for the cells to hold only a few of them each
+#define SPATIALGRID_MAX_SIDE 128
+
+static int SpatialGridCompare(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+static inline bool SpatialGridOverlaps(const Rectangle &r, lmscalar x, lmscalar y, lmscalar width, lmscalar height)
+{
+    return x <= r.x + r.width && x + width >= r.x &&
+           y <= r.y + r.height && y + height >= r.y;
+}
+
+SpatialGrid::SpatialGrid()
+: originX(0)
+, originY(0)
+, cellWidth(1)
+, cellHeight(1)
+, columns(0)
+, rows(0)
+, queryCount(0)
+{
+}
+
+void SpatialGrid::getCell(lmscalar x, lmscalar y, int &column, int &row) const
+{
+    column = (int)floor((x - originX) / cellWidth);
+    row = (int)floor((y - originY) / cellHeight);
+
+    if (column < 0) column = 0;
+    if (column >= columns) column = columns - 1;
+    if (row < 0) row = 0;
+    if (row >= rows) row = rows - 1;
+}
+
+void SpatialGrid::build(const Rectangle *bounds, const bool *bounded, int count)
+{
+    unbounded.clear(true);
+    itemBounds.resize(count);
+    itemQuery.resize(count);
+
+    lmscalar minX = INFINITY, minY = INFINITY;
+    lmscalar maxX = -INFINITY, maxY = -INFINITY;
+    int boundedCount = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        itemQuery[i] = 0;
+        itemBounds[i] = bounds[i];
+
+        if (!bounded[i])
+        {
+            unbounded.push_back(i);
+            continue;
+        }
+
+        minX = lmMin(minX, bounds[i].x);
+        minY = lmMin(minY, bounds[i].y);
+        maxX = lmMax(maxX, bounds[i].x + bounds[i].width);
+        maxY = lmMax(maxY, bounds[i].y + bounds[i].height);
+        boundedCount++;
+    }
+
+    queryCount = 0;
+
+    if (boundedCount == 0)
+    {
+        columns = rows = 0;
+        cellStart.clear(true);
+        cellItems.clear(true);
+        return;
+    }
+
+    // About one item per cell for evenly spread items
+    int side = (int)ceil(sqrt((double)boundedCount));
+    if (side > SPATIALGRID_MAX_SIDE) side = SPATIALGRID_MAX_SIDE;
+
+    columns = rows = side;
+    originX = minX;
+    originY = minY;
+    cellWidth = maxX > minX ? (maxX - minX) / columns : 1;
+    cellHeight = maxY > minY ? (maxY - minY) / rows : 1;
+
+    int cellCount = columns * rows;
+    cellStart.resize(cellCount + 1);
+    for (int i = 0; i <= cellCount; i++)
+        cellStart[i] = 0;
+
+    // Count the items in each cell, then place them after the prefix sums
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            if (!bounded[i])
+                continue;
+
+            int c0, r0, c1, r1;
+            getCell(bounds[i].x, bounds[i].y, c0, r0);
+            getCell(bounds[i].x + bounds[i].width, bounds[i].y + bounds[i].height, c1, r1);
+
+            for (int r = r0; r <= r1; r++)
+            {
+                for (int c = c0; c <= c1; c++)
+                {
+                    int cell = r * columns + c;
+                    if (pass == 0)
+                        cellStart[cell + 1]++;
+                    else
+                        cellItems[cellStart[cell]++] = i;
+                }
+            }
+        }
+
+        if (pass == 0)
+        {
+            for (int i = 0; i < cellCount; i++)
+                cellStart[i + 1] += cellStart[i];
+
+            cellItems.resize(cellStart[cellCount]);
+        }
+        else
+        {
+            // Placing advanced every start to the next cell's start
+            for (int i = cellCount; i > 0; i--)
+                cellStart[i] = cellStart[i - 1];
+            cellStart[0] = 0;
+        }
+    }
+}
+
+void SpatialGrid::query(lmscalar x, lmscalar y, lmscalar width, lmscalar height, utArray<int> &result)
+{
+    result.clear(true);
+
+    for (UTsize i = 0; i < unbounded.size(); i++)
+        result.push_back(unbounded[i]);
+
+    if (columns > 0)
+    {
+        // Stamps from the previous queries are all below the new one
+        if (++queryCount == 0)
+        {
+            for (UTsize i = 0; i < itemQuery.size(); i++)
+                itemQuery[i] = 0;
+            queryCount = 1;
+        }
+
+        int c0, r0, c1, r1;
+        getCell(x, y, c0, r0);
+        getCell(x + width, y + height, c1, r1);
+
+        for (int r = r0; r <= r1; r++)
+        {
+            for (int c = c0; c <= c1; c++)
+            {
+                int cell = r * columns + c;
+                for (int j = cellStart[cell]; j < cellStart[cell + 1]; j++)
+                {
+                    int item = cellItems[j];
+                    if (itemQuery[item] == queryCount)
+                        continue;
+
+                    itemQuery[item] = queryCount;
+
+                    if (SpatialGridOverlaps(itemBounds[item], x, y, width, height))
+                        result.push_back(item);
+                }
+            }
+        }
+    }
+
+    qsort(result.ptr(), result.size(), sizeof(int), SpatialGridCompare);
+}
+
+}
@@ -0,0 +1,71 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include "loom/common/utils/utTypes.h"
+#include "loom/engine/loom2d/l2dRectangle.h"
+
+namespace Loom2D
+{
+
+/*
+ * Uniform grid over a set of item bounds, used to find the items near a
+ * point or rectangle without testing all of them. Items are identified
+ * by their index in the bounds passed to build. Items without bounds,
+ * whose extent isn't known, are returned by every query.
+ */
+class SpatialGrid
+{
+public:
+
+    SpatialGrid();
+
+    // Rebuilds the grid, bounded[i] tells if bounds[i] is known
+    void build(const Rectangle *bounds, const bool *bounded, int count);
+
+    // Sets result to the items overlapping the rectangle in ascending
+    // order, a zero sized rectangle queries a point
+    void query(lmscalar x, lmscalar y, lmscalar width, lmscalar height, utArray<int> &result);
+
+private:
+
+    void getCell(lmscalar x, lmscalar y, int &column, int &row) const;
+
+    lmscalar originX, originY;
+    lmscalar cellWidth, cellHeight;
+    int columns, rows;
+
+    // Items of cell i are cellItems[cellStart[i]] to cellItems[cellStart[i + 1] - 1]
+    utArray<int> cellStart;
+    utArray<int> cellItems;
+    utArray<int> unbounded;
+
+    utArray<Rectangle> itemBounds;
+
+    // Items spanning several cells are only reported once per query
+    utArray<uint32_t> itemQuery;
+    uint32_t queryCount;
+};
+
+}
@@ -0,0 +1,335 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/engine/loom2d/l2dSpriteClip.h"
+#include "loom/engine/loom2d/l2dQuad.h"
+#include "loom/engine/loom2d/l2dBlendMode.h"
+#include "loom/graphics/gfxGraphics.h"
+
+#include <math.h>
+
+namespace Loom2D
+{
+Type *SpriteClip::typeSpriteClip = NULL;
+utArray<SpriteClip *> SpriteClip::sClips;
+utArray<SpriteClip *> SpriteClip::sCompleted;
+
+// Shortest frame, keeps advance from spinning on zero durations
+#define SPRITECLIP_MIN_DURATION    0.0001f
+
+SpriteClip::SpriteClip()
+{
+    type = typeSpriteClip;
+
+    currentFrame = 0;
+    currentTime = 0;
+    loop = true;
+    playing = true;
+    complete = false;
+
+    nativeTextureID = -1;
+    shader = GFX::ShaderProgram::getDefaultShader();
+
+    memset(quadVertices, 0, sizeof(quadVertices));
+
+    sClips.push_back(this);
+}
+
+SpriteClip::~SpriteClip()
+{
+    sClips.erase(this);
+
+    // Deleted by a Complete listener, the rest still get called
+    for (UTsize i = 0; i < sCompleted.size(); i++)
+    {
+        if (sCompleted[i] == this)
+            sCompleted[i] = NULL;
+    }
+}
+
+void SpriteClip::addFrame(float left, float top, float right, float bottom, float u0, float v0, float u1, float v1, lmscalar duration)
+{
+    Frame frame;
+    frame.left = left;
+    frame.top = top;
+    frame.right = right;
+    frame.bottom = bottom;
+    frame.u0 = u0;
+    frame.v0 = v0;
+    frame.u1 = u1;
+    frame.v1 = v1;
+    frame.duration = lmMax(duration, (lmscalar)SPRITECLIP_MIN_DURATION);
+    frames.push_back(frame);
+
+    if (frames.size() == 1)
+        updateVertices();
+}
+
+void SpriteClip::clearFrames()
+{
+    frames.clear(true);
+    currentFrame = 0;
+    currentTime = 0;
+    complete = false;
+    updateVertices();
+}
+
+lmscalar SpriteClip::getFrameDuration(int frame) const
+{
+    if (frame < 0 || frame >= (int)frames.size())
+        return 0;
+
+    return frames[frame].duration;
+}
+
+void SpriteClip::setFrameDuration(int frame, lmscalar duration)
+{
+    if (frame < 0 || frame >= (int)frames.size())
+        return;
+
+    frames[frame].duration = lmMax(duration, (lmscalar)SPRITECLIP_MIN_DURATION);
+}
+
+lmscalar SpriteClip::getTotalTime() const
+{
+    lmscalar total = 0;
+    for (UTsize i = 0; i < frames.size(); i++)
+        total += frames[i].duration;
+
+    return total;
+}
+
+void SpriteClip::setFps(lmscalar fps)
+{
+    if (fps <= 0)
+        return;
+
+    lmscalar duration = 1 / fps;
+    for (UTsize i = 0; i < frames.size(); i++)
+    {
+        if (i == (UTsize)currentFrame)
+            currentTime *= duration / frames[i].duration;
+
+        frames[i].duration = lmMax(duration, (lmscalar)SPRITECLIP_MIN_DURATION);
+    }
+}
+
+void SpriteClip::setCurrentFrame(int frame)
+{
+    if (frame < 0 || frame >= (int)frames.size())
+        return;
+
+    currentFrame = frame;
+    currentTime = 0;
+    complete = false;
+    updateVertices();
+}
+
+void SpriteClip::stop()
+{
+    playing = false;
+    setCurrentFrame(0);
+}
+
+bool SpriteClip::advance(lmscalar time)
+{
+    int frameCount = (int)frames.size();
+    int previousFrame = currentFrame;
+    bool finished = false;
+
+    currentTime += time;
+
+    // Long steps of looping clips skip the whole loops first
+    if (loop)
+    {
+        lmscalar total = getTotalTime();
+        if (currentTime >= total)
+        {
+            currentTime = fmod(currentTime, total);
+            finished = true;
+        }
+    }
+
+    while (currentTime >= frames[currentFrame].duration)
+    {
+        currentTime -= frames[currentFrame].duration;
+
+        if (currentFrame < frameCount - 1)
+        {
+            currentFrame++;
+            continue;
+        }
+
+        finished = true;
+
+        if (!loop)
+        {
+            // Rest on the last frame
+            currentTime = frames[currentFrame].duration;
+            playing = false;
+            complete = true;
+            break;
+        }
+
+        currentFrame = 0;
+    }
+
+    if (currentFrame != previousFrame)
+        updateVertices();
+
+    return finished;
+}
+
+void SpriteClip::advanceAll(lmscalar time)
+{
+    if (time <= 0)
+        return;
+
+    sCompleted.clear(false);
+
+    for (UTsize i = 0; i < sClips.size(); i++)
+    {
+        SpriteClip *clip = sClips[i];
+        if (!clip->playing || clip->frames.size() == 0)
+            continue;
+
+        if (clip->advance(time) && clip->_CompleteDelegate.getCount())
+            sCompleted.push_back(clip);
+    }
+
+    // Listeners can add, remove or delete clips, every clip is advanced
+    for (UTsize i = 0; i < sCompleted.size(); i++)
+    {
+        if (sCompleted[i])
+            sCompleted[i]->_CompleteDelegate.invoke();
+    }
+
+    sCompleted.clear(false);
+}
+
+void SpriteClip::updateVertices()
+{
+    if (frames.size() == 0)
+    {
+        memset(quadVertices, 0, sizeof(quadVertices));
+        invalidateContent();
+        return;
+    }
+
+    const Frame &frame = frames[currentFrame];
+
+    const float x[4] = { frame.left, frame.right, frame.left, frame.right };
+    const float y[4] = { frame.top, frame.top, frame.bottom, frame.bottom };
+    const float u[4] = { frame.u0, frame.u1, frame.u0, frame.u1 };
+    const float v[4] = { frame.v0, frame.v0, frame.v1, frame.v1 };
+
+    for (int i = 0; i < 4; i++)
+    {
+        quadVertices[i].x = x[i];
+        quadVertices[i].y = y[i];
+        quadVertices[i].z = 0;
+        quadVertices[i].abgr = 0xFFFFFFFF;
+        quadVertices[i].u = u[i];
+        quadVertices[i].v = v[i];
+    }
+
+    invalidateContent();
+}
+
+void SpriteClip::render(lua_State *L)
+{
+    if (nativeTextureID == -1 || frames.size() == 0)
+    {
+        return;
+    }
+
+    GFX::TextureInfo *tinfo = GFX::Texture::getTextureInfo(nativeTextureID);
+    if (!tinfo)
+    {
+        return;
+    }
+
+    updateRenderState();
+    if (renderState.alpha == 0.0f)
+    {
+        return;
+    }
+
+    if (renderState.isClipping()) GFX::Graphics::setClipRect((int)renderState.clipRect.x, (int)renderState.clipRect.y, (int)renderState.clipRect.width, (int)renderState.clipRect.height);
+
+    updateLocalTransform();
+
+    Matrix mtx;
+    getTargetTransformationMatrix(NULL, &mtx);
+
+    unsigned int blendSrc, blendDst;
+    BlendMode::BlendFunction(renderState.blendMode, blendSrc, blendDst);
+
+    GFX::VertexPosColorTex *v = GFX::QuadRenderer::getQuadVertexMemory(4, nativeTextureID, blendEnabled, blendSrc, blendDst, shader);
+    if (!v)
+    {
+        return;
+    }
+
+    Quad::transformVertices(mtx, renderState.alpha, quadVertices, v, 4);
+}
+
+bool SpriteClip::collectDamage(lua_State *L, DamageRegion &damage, Rectangle &bounds)
+{
+    GFX::TextureInfo *tinfo = nativeTextureID == -1 ? NULL : GFX::Texture::getTextureInfo(nativeTextureID);
+
+    updateRenderState();
+    if (!tinfo || renderState.alpha == 0.0f || frames.size() == 0)
+    {
+        noteDamage(damage, false, bounds, 0);
+        return false;
+    }
+
+    updateLocalTransform();
+
+    Matrix mtx;
+    getTargetTransformationMatrix(NULL, &mtx);
+
+    Quad::getVertexBounds(mtx, quadVertices, 4, renderState, bounds);
+
+    uint32_t signature = getDamageSignature(mtx);
+    signature = DamageRegion::hash(signature, quadVertices, sizeof(quadVertices));
+    signature = DamageRegion::hash(signature, &nativeTextureID, sizeof(nativeTextureID));
+    signature = DamageRegion::hash(signature, &tinfo->contentVersion, sizeof(tinfo->contentVersion));
+    signature = DamageRegion::hash(signature, &shader, sizeof(shader));
+
+    noteDamage(damage, true, bounds, signature);
+    return true;
+}
+
+DisplayObject::NativeBounds SpriteClip::getNativeBounds(const Matrix &mtx, Rectangle &bounds)
+{
+    if (frames.size() == 0 || nativeTextureID == -1)
+    {
+        return NATIVEBOUNDS_EMPTY;
+    }
+
+    RenderState unclipped;
+    unclipped.clipRect = Rectangle(0, 0, -1, -1);
+
+    Quad::getVertexBounds(mtx, quadVertices, 4, unclipped, bounds);
+    return NATIVEBOUNDS_KNOWN;
+}
+}
@@ -0,0 +1,204 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#pragma once
+
+#include "loom/common/utils/utTypes.h"
+#include "loom/script/native/lsNativeDelegate.h"
+#include "loom/engine/loom2d/l2dDisplayObject.h"
+#include "loom/engine/loom2d/l2dDisplayObjectContainer.h"
+#include "loom/graphics/gfxQuadRenderer.h"
+#include "loom/graphics/gfxShader.h"
+
+namespace Loom2D
+{
+
+// Native side of the SpriteClip script class, a frame animation drawn
+// from the regions of one texture. Every clip is kept in one array and
+// advanced by advanceAll, which only touches a clip's vertices when its
+// frame changes, so playing clips cost no script work per frame.
+class SpriteClip : public DisplayObject
+{
+public:
+
+    static Type *typeSpriteClip;
+
+    static void initialize(lua_State *L)
+    {
+        typeSpriteClip = LSLuaState::getLuaState(L)->getType("loom2d.display.SpriteClip");
+        lmAssert(typeSpriteClip, "unable to get loom2d.display.SpriteClip type");
+    }
+
+    // Called whenever the last frame was shown for its duration, once
+    // per loop for looping clips
+    LOOM_DELEGATE(Complete);
+
+    SpriteClip();
+    ~SpriteClip();
+
+    // Appends a frame drawn over the local rectangle from the texture
+    // region, shown for duration seconds
+    void addFrame(float left, float top, float right, float bottom, float u0, float v0, float u1, float v1, lmscalar duration);
+
+    // Removes all frames and rewinds
+    void clearFrames();
+
+    inline int getNumFrames() const
+    {
+        return (int)frames.size();
+    }
+
+    lmscalar getFrameDuration(int frame) const;
+    void setFrameDuration(int frame, lmscalar duration);
+
+    // Sum of the frame durations
+    lmscalar getTotalTime() const;
+
+    // Scales every frame duration so the clip plays at the rate
+    void setFps(lmscalar fps);
+
+    inline int getCurrentFrame() const
+    {
+        return currentFrame;
+    }
+
+    // Shows the frame from its start
+    void setCurrentFrame(int frame);
+
+    // Seconds into the current frame
+    inline lmscalar getCurrentTime() const
+    {
+        return currentTime;
+    }
+
+    inline bool getLoop() const
+    {
+        return loop;
+    }
+
+    inline void setLoop(bool value)
+    {
+        loop = value;
+    }
+
+    inline bool getIsPlaying() const
+    {
+        return playing;
+    }
+
+    inline void play()
+    {
+        playing = true;
+    }
+
+    inline void pause()
+    {
+        playing = false;
+    }
+
+    // Pauses and rewinds to the first frame
+    void stop();
+
+    // True once a clip that doesn't loop showed its last frame
+    inline bool getIsComplete() const
+    {
+        return complete;
+    }
+
+    inline int getNativeTextureID() const
+    {
+        return nativeTextureID;
+    }
+
+    inline void setNativeTextureID(int value)
+    {
+        nativeTextureID = value;
+        invalidateContent();
+    }
+
+    void setShader(GFX::ShaderProgram *sh)
+    {
+        shader = sh;
+        invalidateContent();
+    }
+
+    GFX::ShaderProgram *getShader() const
+    {
+        return shader;
+    }
+
+    void render(lua_State *L);
+
+    bool collectDamage(lua_State *L, DamageRegion &damage, Rectangle &bounds);
+
+    NativeBounds getNativeBounds(const Matrix &mtx, Rectangle &bounds);
+
+    bool prepareStaticBatch(lua_State *L)
+    {
+        // Baking a clip would rebuild the batch on every frame change
+        validate(L, lua_gettop(L));
+        return false;
+    }
+
+    // Advances every playing clip, then calls the Complete delegates of
+    // the ones that finished
+    static void advanceAll(lmscalar time);
+
+    inline static int getNumClips()
+    {
+        return (int)sClips.size();
+    }
+
+private:
+
+    struct Frame
+    {
+        float    left, top, right, bottom;
+        float    u0, v0, u1, v1;
+        lmscalar duration;
+    };
+
+    // Moves the clip ahead in time, returns true if it finished a loop
+    // or reached its end
+    bool advance(lmscalar time);
+
+    // Writes the vertices of the current frame
+    void updateVertices();
+
+    utArray<Frame> frames;
+
+    int      currentFrame;
+    lmscalar currentTime;
+    bool     loop;
+    bool     playing;
+    bool     complete;
+
+    int nativeTextureID;
+    GFX::ShaderProgram *shader;
+
+    // The current frame in local coordinates
+    GFX::VertexPosColorTex quadVertices[4];
+
+    static utArray<SpriteClip *> sClips;
+
+    // Clips to call the Complete delegate of after advanceAll
+    static utArray<SpriteClip *> sCompleted;
+};
+}
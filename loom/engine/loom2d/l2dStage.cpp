@@ -22,8 +22,13 @@
 #include "loom/engine/loom2d/l2dStage.h"
 #include "loom/engine/bindings/loom/lmApplication.h"
 #include "loom/graphics/gfxGraphics.h"
+#include "loom/graphics/gfxQuadRenderer.h"
+#include "loom/graphics/gfxVectorGraphics.h"
 #include "loom/common/config/applicationConfig.h"
 #include "loom/common/core/log.h"
+#include "loom/common/core/telemetry.h"
+#include "loom/common/platform/platformThread.h"
+#include "loom/common/platform/platformTime.h"
 #include "loom/script/runtime/lsProfiler.h"
 
 extern SDL_Window *gSDLWindow;
@@ -35,6 +40,7 @@ Stage *Stage::smMainStage = NULL;
 NativeDelegate Stage::_RenderStageDelegate;
 bool Stage::sizeDirty = false;
 bool Stage::visDirty = true;
+bool Stage::headless = false;
 
 Stage::Stage()
 {
@@ -46,8 +52,15 @@ Stage::Stage()
     mouseEnabled = true;
 #endif
     pendingResize = true;
+    dirtyRegions = false;
+    dirtyRegionTexture = TEXTUREINVALID;
+    skipUnchangedFrames = false;
+    renderInvalidated = true;
+    damageStageWidth = damageStageHeight = 0;
+    damageFillColor = 0;
     smMainStage = this;
     sdlWindow = gSDLWindow;
+    touchMoves.setDispatchCallback(dispatchTouchMove, this);
     updateFromConfig();
     SDL_GL_GetDrawableSize(sdlWindow, &stageWidth, &stageHeight);
     noteNativeSize(stageWidth, stageHeight);
@@ -55,6 +68,7 @@ Stage::Stage()
 
 Stage::~Stage()
 {
+    setDirtyRegions(false);
     smMainStage = NULL;
 }
 
@@ -125,8 +139,40 @@ void Stage::firePendingResizeEvent()
     }        
 }
 
+void Stage::dispatchTouchMove(void *stage, const TouchCoalescer::Move &move)
+{
+    NativeDelegate &moved = static_cast<Stage*>(stage)->_TouchMovedDelegate;
+    moved.pushArgument(move.id);
+    moved.pushArgument(move.x);
+    moved.pushArgument(move.y);
+    moved.pushArgument(move.buttons);
+    moved.invoke();
+}
+
+lmscalar Stage::getTouchHistoryX(int id, int index) const
+{
+    const TouchCoalescer::Sample *history = touchMoves.getHistory(id);
+    if (!history || index < 0 || index >= touchMoves.getHistoryLength(id)) return 0;
+    return history[index].x;
+}
+
+lmscalar Stage::getTouchHistoryY(int id, int index) const
+{
+    const TouchCoalescer::Sample *history = touchMoves.getHistory(id);
+    if (!history || index < 0 || index >= touchMoves.getHistoryLength(id)) return 0;
+    return history[index].y;
+}
+
+lmscalar Stage::getTouchHistoryTime(int id, int index) const
+{
+    const TouchCoalescer::Sample *history = touchMoves.getHistory(id);
+    if (!history || index < 0 || index >= touchMoves.getHistoryLength(id)) return 0;
+    return (lmscalar)history[index].time;
+}
+
 void Stage::show()
 {
+    if (headless) return;
     SDL_ShowWindow(sdlWindow);
 }
 
@@ -135,16 +181,167 @@ void Stage::hide()
     SDL_HideWindow(sdlWindow);
 }
 
+void Stage::setDirtyRegions(bool value)
+{
+    dirtyRegions = value;
+
+    if (!dirtyRegions && dirtyRegionTexture != TEXTUREINVALID)
+    {
+        GFX::Texture::dispose(dirtyRegionTexture);
+        dirtyRegionTexture = TEXTUREINVALID;
+    }
+}
+
+void Stage::collectStageDamage(lua_State *L)
+{
+    LOOM_PROFILE_SCOPE(stageCollectDamage);
+
+    damage.clear();
+
+    if (renderInvalidated || stageWidth != damageStageWidth || stageHeight != damageStageHeight ||
+        GFX::Graphics::getFillColor() != damageFillColor)
+    {
+        damage.full = true;
+    }
+
+    renderInvalidated = false;
+    damageStageWidth = stageWidth;
+    damageStageHeight = stageHeight;
+    damageFillColor = GFX::Graphics::getFillColor();
+
+    // Always collect so the objects remember how they were drawn
+    DisplayObject::beginDamagePass();
+    baseClipRect = Loom2D::Rectangle(0, 0, -1, -1);
+    Loom2D::Rectangle bounds;
+    collectDamage(L, damage, bounds);
+}
+
+GFX::TextureInfo *Stage::beginDirtyRegions()
+{
+    // The preserved texture starts over when the stage is resized or the
+    // context is lost, everything is redrawn into it then
+    GFX::TextureInfo *target = dirtyRegionTexture == TEXTUREINVALID ? NULL : GFX::Texture::getTextureInfo(dirtyRegionTexture);
+    if (!target || target->width != stageWidth || target->height != stageHeight)
+    {
+        if (target) GFX::Texture::dispose(dirtyRegionTexture);
+
+        target = GFX::Texture::initEmptyTexture(stageWidth, stageHeight);
+        dirtyRegionTexture = target ? target->id : TEXTUREINVALID;
+        if (!target) return NULL;
+
+        damage.full = true;
+    }
+
+    // Filtering and antialiasing reach a pixel past the bounds
+    int x = 0, y = 0, width = 0, height = 0;
+    if (damage.full)
+    {
+        width = stageWidth;
+        height = stageHeight;
+    }
+    else if (!damage.isEmpty())
+    {
+        x = (int)floor(damage.minX) - 1;
+        y = (int)floor(damage.minY) - 1;
+        int right = (int)ceil(damage.maxX) + 1;
+        int bottom = (int)ceil(damage.maxY) + 1;
+
+        if (x < 0) x = 0;
+        if (y < 0) y = 0;
+        if (right > stageWidth) right = stageWidth;
+        if (bottom > stageHeight) bottom = stageHeight;
+
+        width = right - x;
+        height = bottom - y;
+    }
+
+    Telemetry::setTickValue("gfx.stage.damage", width > 0 && height > 0 ? width * height : 0);
+
+    GFX::Graphics::setBackFramebuffer(target->framebuffer);
+    GFX::Graphics::context()->glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+
+    if (width <= 0 || height <= 0)
+    {
+        // Nothing changed, the texture is shown as it is
+        damage.clear();
+        GFX::Graphics::setFlags(GFX::Graphics::getFlags() | GFX::Graphics::FLAG_NOCLEAR);
+        return target;
+    }
+
+    // Only the damaged region is cleared and drawn into
+    damage.minX = (lmscalar)x;
+    damage.minY = (lmscalar)y;
+    damage.maxX = (lmscalar)(x + width);
+    damage.maxY = (lmscalar)(y + height);
+    GFX::Graphics::setClipRect(x, y, width, height);
+    baseClipRect = Loom2D::Rectangle((lmscalar)x, (lmscalar)y, (lmscalar)width, (lmscalar)height);
+
+    return target;
+}
+
+void Stage::presentDirtyRegions(GFX::TextureInfo *target)
+{
+    LOOM_PROFILE_SCOPE(stagePresentDirtyRegions);
+
+    GFX::QuadRenderer::submit();
+    GFX::Graphics::clearClipRect();
+    baseClipRect = Loom2D::Rectangle(0, 0, -1, -1);
+
+    GFX::Graphics::setBackFramebuffer(mainBackFramebuffer);
+    GFX::Graphics::context()->glBindFramebuffer(GL_FRAMEBUFFER, mainBackFramebuffer);
+
+    // The texture was drawn upright, so its first row is the bottom of the stage
+    GFX::VertexPosColorTex *v = GFX::QuadRenderer::getQuadVertexMemory(4, target->id, false, GL_ONE, GL_ZERO, GFX::ShaderProgram::getDefaultShader());
+    if (!v) return;
+
+    float width = (float)stageWidth;
+    float height = (float)stageHeight;
+    v->x =     0; v->y =      0; v->z = 0; v->abgr = 0xFFFFFFFF; v->u = 0; v->v = 1; v++;
+    v->x = width; v->y =      0; v->z = 0; v->abgr = 0xFFFFFFFF; v->u = 1; v->v = 1; v++;
+    v->x =     0; v->y = height; v->z = 0; v->abgr = 0xFFFFFFFF; v->u = 0; v->v = 0; v++;
+    v->x = width; v->y = height; v->z = 0; v->abgr = 0xFFFFFFFF; v->u = 1; v->v = 0;
+}
+
+void Stage::waitForNextFrame()
+{
+#ifndef __EMSCRIPTEN__
+    // Without a swap there's no vsync to wait on, so sleep out the rest
+    // of the display refresh instead of spinning
+    LoomApplication::framePacer.waitForNextVSync();
+#endif
+}
+
 void Stage::render(lua_State *L)
 {
     LOOM_PROFILE_START(stageRenderBegin);
     GFX::Graphics::setNativeSize(getWidth(), getHeight());
-    GFX::Graphics::beginFrame();
-    
+
+#ifndef __EMSCRIPTEN__
+    // Follows the window to whichever display it's on
+    SDL_DisplayMode mode;
+    if (SDL_GetWindowDisplayMode(sdlWindow, &mode) == 0) LoomApplication::framePacer.setRefreshRate(mode.refresh_rate);
+#endif
+
     updateLocalTransform();
 
     lualoom_pushnative<Stage>(L, this);
 
+    if (dirtyRegions || skipUnchangedFrames) collectStageDamage(L);
+
+    // Nothing changed since the last frame, what's on screen is still current
+    bool skipped = skipUnchangedFrames && damage.isEmpty() && !GFX::Graphics::isScreenshotPending();
+
+    uint32_t flags = GFX::Graphics::getFlags();
+    mainBackFramebuffer = GFX::Graphics::getBackFramebuffer();
+    GFX::TextureInfo *target = !skipped && dirtyRegions ? beginDirtyRegions() : NULL;
+
+    if (!skipped) GFX::Graphics::beginFrame();
+
+    if (!skipped) GFX::VectorRenderer::beginPass();
+
+    // Scripts are done changing graphics for the frame
+    if (!skipped) GFX::VectorGraphics::tessellateChanged();
+
     renderState.alpha          = alpha;
     renderState.clipRect       = Loom2D::Rectangle(0, 0, -1, -1);
     renderState.blendMode      = blendMode;
@@ -152,20 +349,41 @@ void Stage::render(lua_State *L)
 
 
     LOOM_PROFILE_START(stageRenderDisplayList);
-    renderChildren(L);
+    sCullTested = sCullCulled = 0;
+    if (!skipped && (!target || !damage.isEmpty())) renderChildren(L);
+    if (!skipped) GFX::VectorRenderer::endPass();
     LOOM_PROFILE_END(stageRenderDisplayList);
 
     
     LOOM_PROFILE_START(stageRenderEnd);
+    if (target)
+    {
+        presentDirtyRegions(target);
+        GFX::Graphics::setFlags(flags);
+    }
     lua_pop(L, 1);
-    GFX::Graphics::endFrame();
+    if (!skipped) GFX::Graphics::endFrame();
     LOOM_PROFILE_END(stageRenderEnd);
 
+    Telemetry::setTickValue("gfx.stage.skipped", skipped ? 1 : 0);
+    Telemetry::setTickValue("gfx.stage.culled", sCullCulled);
+    Telemetry::setTickValue("gfx.stage.drawn", sCullTested - sCullCulled);
+
     LSLuaState *vm = LoomApplication::getReloadQueued() ? NULL : LoomApplication::getRootVM();
     LOOM_PROFILE_START(garbageCollection);
     if (vm) lualoom_gc_update(vm->VM());
     LOOM_PROFILE_END(garbageCollection);
 
+    if (skipped)
+    {
+        LOOM_PROFILE_START(waitForNextFrame);
+        waitForNextFrame();
+        LOOM_PROFILE_END(waitForNextFrame);
+
+        LoomApplication::framePacer.framePresented(platform_getNanoseconds());
+        return;
+    }
+
 #ifdef LOOM_DEBUG
     LOOM_PROFILE_START(finishRender);
     GFX::Graphics::context()->glFinish();
@@ -174,7 +392,10 @@ void Stage::render(lua_State *L)
 
     LOOM_PROFILE_START(waitForVSync);
     /* Update the screen! */
-    SDL_GL_SwapWindow(sdlWindow);
+    GFX::Graphics::present(sdlWindow);
     LOOM_PROFILE_END(waitForVSync);
+
+    LoomApplication::framePacer.framePresented(platform_getNanoseconds());
+    Telemetry::setTickValue("gfx.stage.refreshes", LoomApplication::framePacer.getFrameRefreshes());
 }
 }
@@ -22,6 +22,7 @@
 
 #include "loom/engine/loom2d/l2dDisplayObjectContainer.h"
 #include "loom/graphics/gfxVectorRenderer.h"
+#include "loom/common/core/touchCoalescer.h"
 #include <SDL.h>
 
 namespace Loom2D
@@ -41,6 +42,9 @@ public:
     static bool sizeDirty;
     static bool visDirty;
 
+    // Set when running headless, the window is never shown
+    static bool headless;
+
     // The SDL window we're working with.
     SDL_Window *sdlWindow;
     int stageWidth;
@@ -51,6 +55,46 @@ public:
 
     bool pendingResize;
 
+    // When enabled the stage is drawn into a texture preserved between
+    // frames and only the regions that changed are redrawn
+    bool dirtyRegions;
+    int dirtyRegionTexture;
+    int mainBackFramebuffer;
+
+    // When enabled frames in which nothing changed aren't rendered or
+    // swapped, invalidate() forces the next frame to render regardless
+    bool skipUnchangedFrames;
+    bool renderInvalidated;
+
+    // What changed since the last frame, and the stage state it was
+    // collected against
+    DamageRegion damage;
+    int damageStageWidth;
+    int damageStageHeight;
+    unsigned int damageFillColor;
+
+    inline bool getDirtyRegions() const
+    {
+        return dirtyRegions;
+    }
+    void setDirtyRegions(bool value);
+
+    inline bool getSkipUnchangedFrames() const
+    {
+        return skipUnchangedFrames;
+    }
+    inline void setSkipUnchangedFrames(bool value)
+    {
+        skipUnchangedFrames = value;
+    }
+
+    // Renders the next frame even if nothing visibly changed, for drawing
+    // the change detection can't see
+    inline void invalidate()
+    {
+        renderInvalidated = true;
+    }
+
     // Rendering interface.
     void invokeRenderStage()
     {
@@ -63,12 +107,51 @@ public:
 
     void render(lua_State *L);
 
+    // Collects what changed on screen since the last frame
+    void collectStageDamage(lua_State *L);
+
+    // Prepares redrawing the damage into the preserved texture, returns
+    // NULL if it couldn't be created
+    GFX::TextureInfo *beginDirtyRegions();
+    void presentDirtyRegions(GFX::TextureInfo *target);
+
+    void waitForNextFrame();
+
     // Interface for window state.
     LOOM_DELEGATE(OrientationChange);
     LOOM_DELEGATE(SizeChange);
 
     void firePendingResizeEvent();
 
+    // Pointer moves are queued as the events are polled and dispatched
+    // through TouchMoved once per pointer, when the pointer is pressed or
+    // released, or once the frame's events are all in
+    TouchCoalescer touchMoves;
+
+    static void dispatchTouchMove(void *stage, const TouchCoalescer::Move &move);
+
+    inline void queueTouchMoved(int id, float x, float y, int buttons, double time)
+    {
+        touchMoves.moved(id, x, y, buttons, time);
+    }
+    inline void flushTouchMoved(int id)
+    {
+        touchMoves.flush(id);
+    }
+    inline void flushTouchMoves()
+    {
+        touchMoves.flushAll();
+    }
+
+    // The moves merged into the last dispatched move of a pointer
+    int getTouchHistoryLength(int id) const
+    {
+        return touchMoves.getHistoryLength(id);
+    }
+    lmscalar getTouchHistoryX(int id, int index) const;
+    lmscalar getTouchHistoryY(int id, int index) const;
+    lmscalar getTouchHistoryTime(int id, int index) const;
+
     void noteNativeSize(int width, int height)
     {
         stageWidth = width;
@@ -127,6 +210,47 @@ public:
         return GFX::VectorRenderer::tessellationQuality;
     }
 
+    inline void setAdaptiveVectorQuality(bool value)
+    {
+        GFX::VectorRenderer::adaptiveQuality = value;
+    }
+    inline bool getAdaptiveVectorQuality() const
+    {
+        return GFX::VectorRenderer::adaptiveQuality;
+    }
+
+    inline void setVectorQualityBudget(float value)
+    {
+        GFX::VectorRenderer::qualityBudget = value;
+    }
+    inline float getVectorQualityBudget() const
+    {
+        return GFX::VectorRenderer::qualityBudget;
+    }
+
+    inline int getVectorQualityLevel() const
+    {
+        return GFX::VectorRenderer::qualityLevel;
+    }
+
+    inline void setBatchVectorFills(bool value)
+    {
+        GFX::VectorRenderer::batchFills = value;
+    }
+    inline bool getBatchVectorFills() const
+    {
+        return GFX::VectorRenderer::batchFills;
+    }
+
+    inline void setParallelVectorTessellation(bool value)
+    {
+        GFX::VectorRenderer::parallelTessellation = value;
+    }
+    inline bool getParallelVectorTessellation() const
+    {
+        return GFX::VectorRenderer::parallelTessellation;
+    }
+
     int getWidth()
     {
         return stageWidth;
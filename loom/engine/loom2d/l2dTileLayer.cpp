@@ -0,0 +1,600 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/engine/loom2d/l2dTileLayer.h"
+#include "loom/engine/loom2d/l2dBlendMode.h"
+#include "loom/engine/loom2d/l2dQuad.h"
+#include "loom/graphics/gfxGraphics.h"
+#include "loom/graphics/gfxTexture.h"
+
+namespace Loom2D
+{
+Type *TileLayer::typeTileLayer = NULL;
+
+// Bounds of a rectangle with the transform, clipped to the render state
+static void getRectBounds(const Matrix &mtx, const Rectangle &rect, const RenderState &state, Rectangle &bounds)
+{
+    GFX::VertexPosColorTex corners[4];
+    for (int i = 0; i < 4; i++)
+    {
+        corners[i].x = (float)(rect.x + (i & 1) * rect.width);
+        corners[i].y = (float)(rect.y + (i >> 1) * rect.height);
+    }
+
+    Quad::getVertexBounds(mtx, corners, 4, state, bounds);
+}
+
+TileLayer::TileLayer()
+{
+    type           = typeTileLayer;
+    layerWidth     = 0;
+    layerHeight    = 0;
+    tileWidth      = 0;
+    tileHeight     = 0;
+    isometric      = false;
+    chunksX        = 0;
+    chunksY        = 0;
+    contentVersion = 0;
+    chunksDrawn    = 0;
+    shader = GFX::ShaderProgram::getDefaultShader();
+}
+
+TileLayer::~TileLayer()
+{
+    clearChunks();
+}
+
+void TileLayer::clearChunks()
+{
+    for (UTsize i = 0; i < chunks.size(); i++)
+    {
+        lmDelete(NULL, chunks[i]);
+    }
+
+    chunks.clear();
+    chunksX = 0;
+    chunksY = 0;
+}
+
+void TileLayer::setSize(int width, int height, lmscalar _tileWidth, lmscalar _tileHeight)
+{
+    clearChunks();
+
+    layerWidth  = lmMax(width, 0);
+    layerHeight = lmMax(height, 0);
+    tileWidth   = _tileWidth;
+    tileHeight  = _tileHeight;
+
+    tiles.resize(layerWidth * layerHeight);
+    for (UTsize i = 0; i < tiles.size(); i++)
+    {
+        tiles[i] = 0;
+    }
+
+    chunksX = (layerWidth + TILELAYER_CHUNK_SIZE - 1) / TILELAYER_CHUNK_SIZE;
+    chunksY = (layerHeight + TILELAYER_CHUNK_SIZE - 1) / TILELAYER_CHUNK_SIZE;
+
+    for (int i = 0; i < chunksX * chunksY; i++)
+    {
+        chunks.push_back(lmNew(NULL) Chunk());
+    }
+
+    contentVersion++;
+    invalidateContent();
+}
+
+void TileLayer::setIsometric(bool value)
+{
+    if (isometric == value) return;
+
+    isometric = value;
+    invalidateAllChunks();
+}
+
+void TileLayer::addTileset(int firstGid, int nativeTextureID, lmscalar textureWidth, lmscalar textureHeight,
+                           lmscalar _tileWidth, lmscalar _tileHeight, lmscalar spacing, lmscalar margin)
+{
+    if (firstGid <= 0 || _tileWidth <= 0 || _tileHeight <= 0 || textureWidth <= 0 || textureHeight <= 0)
+    {
+        return;
+    }
+
+    Tileset tileset;
+    tileset.firstGid        = (uint32_t)firstGid;
+    tileset.nativeTextureID = nativeTextureID;
+    tileset.textureWidth    = textureWidth;
+    tileset.textureHeight   = textureHeight;
+    tileset.tileWidth       = _tileWidth;
+    tileset.tileHeight      = _tileHeight;
+    tileset.spacing         = spacing;
+    tileset.margin          = margin;
+    tileset.columns = lmMax((int)((textureWidth - margin * 2 + spacing) / (_tileWidth + spacing)), 0);
+    tileset.rows    = lmMax((int)((textureHeight - margin * 2 + spacing) / (_tileHeight + spacing)), 0);
+
+    // Kept sorted by firstGid so lookups can take the last one below a gid
+    tilesets.push_back(tileset);
+    UTsize index = tilesets.size() - 1;
+    for (; index > 0 && tilesets[index - 1].firstGid > tileset.firstGid; index--)
+    {
+        tilesets[index] = tilesets[index - 1];
+    }
+    tilesets[index] = tileset;
+
+    invalidateAllChunks();
+}
+
+void TileLayer::clearTilesets()
+{
+    tilesets.clear();
+    invalidateAllChunks();
+}
+
+const TileLayer::Tileset *TileLayer::findTileset(uint32_t gid) const
+{
+    for (int i = (int)tilesets.size() - 1; i >= 0; i--)
+    {
+        if (tilesets[i].firstGid <= gid)
+        {
+            return &tilesets[i];
+        }
+    }
+
+    return NULL;
+}
+
+void TileLayer::setTile(int x, int y, uint32_t gid)
+{
+    if (x < 0 || y < 0 || x >= layerWidth || y >= layerHeight)
+    {
+        return;
+    }
+
+    uint32_t &tile = tiles[y * layerWidth + x];
+    if (tile == gid) return;
+
+    tile = gid;
+    invalidateChunkAt(x, y);
+}
+
+uint32_t TileLayer::getTile(int x, int y) const
+{
+    if (x < 0 || y < 0 || x >= layerWidth || y >= layerHeight)
+    {
+        return 0;
+    }
+
+    return tiles[y * layerWidth + x];
+}
+
+int TileLayer::setTiles(lua_State *L)
+{
+    int length = lsr_vector_get_length(L, 2);
+    int count = lmMin(length, layerWidth * layerHeight);
+
+    lua_rawgeti(L, 2, LSINDEXVECTOR);
+    int vectorIdx = lua_gettop(L);
+
+    for (int i = 0; i < count; i++)
+    {
+        lua_rawgeti(L, vectorIdx, i);
+        tiles[i] = (uint32_t)lua_tonumber(L, -1);
+        lua_pop(L, 1);
+    }
+
+    // Tiles past the end of the vector are left empty
+    for (int i = count; i < layerWidth * layerHeight; i++)
+    {
+        tiles[i] = 0;
+    }
+
+    lua_settop(L, vectorIdx - 1);
+
+    invalidateAllChunks();
+    return 0;
+}
+
+int TileLayer::_getBounds(lua_State *L)
+{
+    DisplayObject *targetSpace = NULL;
+
+    if (!lua_isnil(L, 2))
+    {
+        targetSpace = (DisplayObject *)lualoom_getnativepointer(L, 2);
+    }
+
+    Rectangle *resultRect = (Rectangle *)lualoom_getnativepointer(L, 3);
+
+    Matrix mtx;
+    getTargetTransformationMatrix(targetSpace, &mtx);
+
+    if (getNativeBounds(mtx, *resultRect) == NATIVEBOUNDS_EMPTY)
+    {
+        resultRect->setTo(0, 0, 0, 0);
+    }
+
+    return 0;
+}
+
+void TileLayer::invalidateChunkAt(int x, int y)
+{
+    chunks[(y / TILELAYER_CHUNK_SIZE) * chunksX + x / TILELAYER_CHUNK_SIZE]->dirty = true;
+
+    contentVersion++;
+    invalidateContent();
+}
+
+void TileLayer::invalidateAllChunks()
+{
+    for (UTsize i = 0; i < chunks.size(); i++)
+    {
+        chunks[i]->dirty = true;
+    }
+
+    contentVersion++;
+    invalidateContent();
+}
+
+void TileLayer::validateChunks()
+{
+    for (int cy = 0; cy < chunksY; cy++)
+    {
+        for (int cx = 0; cx < chunksX; cx++)
+        {
+            Chunk *chunk = chunks[cy * chunksX + cx];
+            if (chunk->dirty) buildChunk(cx, cy, chunk);
+        }
+    }
+}
+
+void TileLayer::buildChunk(int chunkX, int chunkY, Chunk *chunk)
+{
+    chunk->dirty = false;
+    chunk->vertices.clear();
+    chunk->runs.clear();
+    chunk->staticBatchValid = false;
+    chunk->staticBatchFailed = false;
+
+    int x0 = chunkX * TILELAYER_CHUNK_SIZE;
+    int y0 = chunkY * TILELAYER_CHUNK_SIZE;
+    int x1 = lmMin(x0 + TILELAYER_CHUNK_SIZE, layerWidth);
+    int y1 = lmMin(y0 + TILELAYER_CHUNK_SIZE, layerHeight);
+
+    lmscalar minx = INFINITY, maxx = -INFINITY;
+    lmscalar miny = INFINITY, maxy = -INFINITY;
+
+    for (int y = y0; y < y1; y++)
+    {
+        for (int x = x0; x < x1; x++)
+        {
+            uint32_t gid = tiles[y * layerWidth + x];
+            uint32_t index = gid & TILELAYER_GID_MASK;
+            if (index == 0) continue;
+
+            const Tileset *tileset = findTileset(index);
+            if (!tileset) continue;
+
+            int local = (int)(index - tileset->firstGid);
+            if (tileset->columns == 0 || local >= tileset->columns * tileset->rows) continue;
+
+            // Texture region of the tile, inset by half a texel so
+            // filtering doesn't bleed in the neighboring tiles
+            lmscalar sx = tileset->margin + (local % tileset->columns) * (tileset->tileWidth + tileset->spacing);
+            lmscalar sy = tileset->margin + (local / tileset->columns) * (tileset->tileHeight + tileset->spacing);
+            float u0 = (float)((sx + 0.5) / tileset->textureWidth);
+            float v0 = (float)((sy + 0.5) / tileset->textureHeight);
+            float u1 = (float)((sx + tileset->tileWidth - 0.5) / tileset->textureWidth);
+            float v1 = (float)((sy + tileset->tileHeight - 0.5) / tileset->textureHeight);
+
+            // Tiles taller than the grid extend upwards like in TMX
+            lmscalar px, py;
+            if (isometric)
+            {
+                px = (x - y) * tileWidth / 2;
+                py = (x + y) * tileHeight / 2;
+            }
+            else
+            {
+                px = x * tileWidth;
+                py = y * tileHeight;
+            }
+            py += tileHeight - tileset->tileHeight;
+
+            bool flipH = (gid & TILELAYER_FLIPPED_HORIZONTALLY) != 0;
+            bool flipV = (gid & TILELAYER_FLIPPED_VERTICALLY) != 0;
+            bool flipD = (gid & TILELAYER_FLIPPED_DIAGONALLY) != 0;
+
+            Run *run = chunk->runs.empty() ? NULL : &chunk->runs.back();
+            if (!run || run->nativeTextureID != tileset->nativeTextureID)
+            {
+                Run next;
+                next.firstVertex = (int)chunk->vertices.size();
+                next.vertexCount = 0;
+                next.nativeTextureID = tileset->nativeTextureID;
+                chunk->runs.push_back(next);
+                run = &chunk->runs.back();
+            }
+
+            // Corners in Quad order: top left, top right, bottom left,
+            // bottom right. TMX flips diagonally first, so a corner takes
+            // its texture coordinate from the corner it lands on with the
+            // horizontal and vertical flips undone, then transposed.
+            for (int corner = 0; corner < 4; corner++)
+            {
+                int cx = corner & 1;
+                int cy = corner >> 1;
+
+                int tx = flipH ? 1 - cx : cx;
+                int ty = flipV ? 1 - cy : cy;
+                if (flipD)
+                {
+                    int t = tx;
+                    tx = ty;
+                    ty = t;
+                }
+
+                GFX::VertexPosColorTex v;
+                v.x = (float)(px + cx * tileset->tileWidth);
+                v.y = (float)(py + cy * tileset->tileHeight);
+                v.z = 0;
+                v.abgr = 0xFFFFFFFF;
+                v.u = tx ? u1 : u0;
+                v.v = ty ? v1 : v0;
+                chunk->vertices.push_back(v);
+
+                minx = lmMin(minx, (lmscalar)v.x);
+                maxx = lmMax(maxx, (lmscalar)v.x);
+                miny = lmMin(miny, (lmscalar)v.y);
+                maxy = lmMax(maxy, (lmscalar)v.y);
+            }
+
+            run->vertexCount += 4;
+        }
+    }
+
+    if (chunk->vertices.empty())
+    {
+        chunk->bounds.setTo(0, 0, 0, 0);
+        chunk->staticBatch.clear();
+    }
+    else
+    {
+        chunk->bounds.setTo(minx, miny, maxx - minx, maxy - miny);
+    }
+}
+
+void TileLayer::batchChunk(Chunk *chunk, Matrix &mtx, lmscalar alpha, uint32_t blendSrc, uint32_t blendDst)
+{
+    bool isIdentity = mtx.isIdentity();
+    uint32_t abgr = ((uint32_t)(alpha * 255) << 24) | 0x00FFFFFF;
+
+    for (UTsize i = 0; i < chunk->runs.size(); i++)
+    {
+        const Run &run = chunk->runs[i];
+
+        GFX::TextureInfo *tinfo = GFX::Texture::getTextureInfo(run.nativeTextureID);
+        if (!tinfo) continue;
+
+        const GFX::VertexPosColorTex *src = &chunk->vertices[run.firstVertex];
+
+        if (isIdentity && alpha == 1.0f)
+        {
+            GFX::QuadRenderer::batch((GFX::VertexPosColorTex *)src, run.vertexCount, run.nativeTextureID, blendEnabled, blendSrc, blendDst, shader);
+            continue;
+        }
+
+        GFX::VertexPosColorTex *v = GFX::QuadRenderer::getQuadVertexMemory(run.vertexCount, run.nativeTextureID, blendEnabled, blendSrc, blendDst, shader);
+        if (!v) continue;
+
+        for (int j = 0; j < run.vertexCount; j++, v++, src++)
+        {
+            v->x = (float)(mtx.a * src->x + mtx.c * src->y + mtx.tx);
+            v->y = (float)(mtx.b * src->x + mtx.d * src->y + mtx.ty);
+            v->z = 0;
+            v->abgr = abgr;
+            v->u = src->u;
+            v->v = src->v;
+        }
+    }
+}
+
+bool TileLayer::drawChunkStatic(Chunk *chunk, const Matrix &mtx, uint32_t blendSrc, uint32_t blendDst)
+{
+    if (chunk->staticBatchFailed)
+    {
+        return false;
+    }
+
+    // Vertex colors are baked with the inherited alpha, and the buffer is
+    // lost with the context
+    if (!chunk->staticBatchValid || !chunk->staticBatch.isValid() ||
+        chunk->staticBatchAlpha != renderState.alpha || chunk->staticBatchBlendMode != renderState.blendMode)
+    {
+        Matrix identity;
+
+        GFX::QuadRenderer::beginCapture(&chunk->staticBatch);
+        batchChunk(chunk, identity, renderState.alpha, blendSrc, blendDst);
+        bool captured = GFX::QuadRenderer::endCapture();
+
+        chunk->staticBatchValid     = true;
+        chunk->staticBatchFailed    = !captured;
+        chunk->staticBatchAlpha     = renderState.alpha;
+        chunk->staticBatchBlendMode = renderState.blendMode;
+
+        if (!captured)
+        {
+            return false;
+        }
+    }
+
+    GFX::QuadRenderer::drawStatic(&chunk->staticBatch, mtx);
+    return true;
+}
+
+void TileLayer::render(lua_State *L)
+{
+    chunksDrawn = 0;
+
+    if (chunks.empty())
+    {
+        return;
+    }
+
+    updateRenderState();
+    if (renderState.alpha == 0.0f)
+    {
+        return;
+    }
+
+    if (renderState.isClipping()) GFX::Graphics::setClipRect((int)renderState.clipRect.x, (int)renderState.clipRect.y, (int)renderState.clipRect.width, (int)renderState.clipRect.height);
+
+    unsigned int blendSrc, blendDst;
+    BlendMode::BlendFunction(renderState.blendMode, blendSrc, blendDst);
+
+    updateLocalTransform();
+
+    Matrix mtx;
+    getTargetTransformationMatrix(NULL, &mtx);
+
+    // A degenerate transform shows nothing of the layer
+    if (mtx.a * mtx.d - mtx.b * mtx.c == 0)
+    {
+        return;
+    }
+
+    // The view brought into layer space, chunks off it are skipped
+    Rectangle view = renderState.isClipping() ? renderState.clipRect :
+        Rectangle(0, 0, (lmscalar)GFX::Graphics::getWidth(), (lmscalar)GFX::Graphics::getHeight());
+
+    Matrix inverse;
+    inverse.invertOther(&mtx);
+
+    RenderState unclipped;
+    unclipped.clipRect = Rectangle(0, 0, -1, -1);
+
+    Rectangle localView;
+    getRectBounds(inverse, view, unclipped, localView);
+
+    // Captures can't be nested, draw everything through the batch then
+    bool useStatic = !GFX::QuadRenderer::isCapturing();
+
+    validateChunks();
+
+    for (UTsize i = 0; i < chunks.size(); i++)
+    {
+        Chunk *chunk = chunks[i];
+
+        if (chunk->vertices.empty()) continue;
+
+        const Rectangle &b = chunk->bounds;
+        if (b.x > localView.x + localView.width || b.x + b.width < localView.x ||
+            b.y > localView.y + localView.height || b.y + b.height < localView.y)
+        {
+            continue;
+        }
+
+        chunksDrawn++;
+
+        if (!useStatic || !drawChunkStatic(chunk, mtx, blendSrc, blendDst))
+        {
+            batchChunk(chunk, mtx, renderState.alpha, blendSrc, blendDst);
+        }
+    }
+}
+
+void TileLayer::getLocalBounds(Rectangle &bounds)
+{
+    validateChunks();
+
+    lmscalar minx = INFINITY, maxx = -INFINITY;
+    lmscalar miny = INFINITY, maxy = -INFINITY;
+
+    for (UTsize i = 0; i < chunks.size(); i++)
+    {
+        const Chunk *chunk = chunks[i];
+        if (chunk->vertices.empty()) continue;
+
+        minx = lmMin(minx, chunk->bounds.x);
+        maxx = lmMax(maxx, chunk->bounds.x + chunk->bounds.width);
+        miny = lmMin(miny, chunk->bounds.y);
+        maxy = lmMax(maxy, chunk->bounds.y + chunk->bounds.height);
+    }
+
+    if (minx > maxx)
+    {
+        bounds.setTo(0, 0, 0, 0);
+        return;
+    }
+
+    bounds.setTo(minx, miny, maxx - minx, maxy - miny);
+}
+
+bool TileLayer::collectDamage(lua_State *L, DamageRegion &damage, Rectangle &bounds)
+{
+    updateRenderState();
+
+    Rectangle local;
+    getLocalBounds(local);
+
+    if (renderState.alpha == 0.0f || local.width == 0 || local.height == 0)
+    {
+        noteDamage(damage, false, bounds, 0);
+        return false;
+    }
+
+    updateLocalTransform();
+
+    Matrix mtx;
+    getTargetTransformationMatrix(NULL, &mtx);
+
+    getRectBounds(mtx, local, renderState, bounds);
+
+    uint32_t signature = getDamageSignature(mtx);
+    signature = DamageRegion::hash(signature, &contentVersion, sizeof(contentVersion));
+    signature = DamageRegion::hash(signature, &shader, sizeof(shader));
+
+    for (UTsize i = 0; i < tilesets.size(); i++)
+    {
+        GFX::TextureInfo *tinfo = GFX::Texture::getTextureInfo(tilesets[i].nativeTextureID);
+        if (!tinfo) continue;
+
+        signature = DamageRegion::hash(signature, &tinfo->contentVersion, sizeof(tinfo->contentVersion));
+    }
+
+    noteDamage(damage, true, bounds, signature);
+    return true;
+}
+
+DisplayObject::NativeBounds TileLayer::getNativeBounds(const Matrix &mtx, Rectangle &bounds)
+{
+    Rectangle local;
+    getLocalBounds(local);
+
+    if (local.width == 0 || local.height == 0)
+    {
+        return NATIVEBOUNDS_EMPTY;
+    }
+
+    RenderState unclipped;
+    unclipped.clipRect = Rectangle(0, 0, -1, -1);
+
+    getRectBounds(mtx, local, unclipped, bounds);
+    return NATIVEBOUNDS_KNOWN;
+}
+}
@@ -0,0 +1,234 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#pragma once
+
+#include "loom/common/utils/utTypes.h"
+#include "loom/engine/loom2d/l2dRectangle.h"
+#include "loom/engine/loom2d/l2dDisplayObject.h"
+#include "loom/graphics/gfxQuadRenderer.h"
+#include "loom/graphics/gfxShader.h"
+
+namespace Loom2D
+{
+// Tiles per side of the square chunks a layer is split into, each chunk
+// is culled and baked into a vertex buffer on its own
+#define TILELAYER_CHUNK_SIZE    16
+
+// Flags TMX stores in the upper bits of a gid
+#define TILELAYER_FLIPPED_HORIZONTALLY    0x80000000u
+#define TILELAYER_FLIPPED_VERTICALLY      0x40000000u
+#define TILELAYER_FLIPPED_DIAGONALLY      0x20000000u
+#define TILELAYER_GID_MASK                0x1FFFFFFFu
+
+// Native side of the TileLayer script class, draws a grid of tile gids
+// from a set of tileset textures. The tiles are kept in one flat array
+// and turned into quads per chunk only when they change; only the chunks
+// overlapping the view are drawn, from their static batch where the
+// textures allow it.
+class TileLayer : public DisplayObject
+{
+public:
+
+    static Type *typeTileLayer;
+
+    static void initialize(lua_State *L)
+    {
+        typeTileLayer = LSLuaState::getLuaState(L)->getType("loom2d.display.TileLayer");
+        lmAssert(typeTileLayer, "unable to get loom2d.display.TileLayer type");
+    }
+
+    TileLayer();
+    ~TileLayer();
+
+    // Resizes the layer to width by height tiles of tileWidth by
+    // tileHeight pixels and clears all tiles
+    void setSize(int width, int height, lmscalar tileWidth, lmscalar tileHeight);
+
+    // Tiles are placed on a diamond grid like TMX isometric maps if set,
+    // otherwise on a regular grid
+    void setIsometric(bool value);
+
+    inline bool getIsometric() const
+    {
+        return isometric;
+    }
+
+    // Adds the tiles with gids from firstGid on, cut from a texture of
+    // textureWidth by textureHeight pixels into tiles of tileWidth by
+    // tileHeight, separated by spacing and inset by margin
+    void addTileset(int firstGid, int nativeTextureID, lmscalar textureWidth, lmscalar textureHeight,
+                    lmscalar tileWidth, lmscalar tileHeight, lmscalar spacing, lmscalar margin);
+
+    // Removes all tilesets
+    void clearTilesets();
+
+    // Sets the gid with TMX flip flags of one tile, 0 leaves it empty
+    void setTile(int x, int y, uint32_t gid);
+    uint32_t getTile(int x, int y) const;
+
+    // Sets all tiles from a Vector.<uint> of gids in rows, arguments are
+    // the vector
+    int setTiles(lua_State *L);
+
+    // Gets the bounds of the tiles in the space of a DisplayObject, or
+    // the root if nil, arguments are the target space and the Rectangle
+    // to store the bounds into
+    int _getBounds(lua_State *L);
+
+    inline int getLayerWidth() const
+    {
+        return layerWidth;
+    }
+
+    inline int getLayerHeight() const
+    {
+        return layerHeight;
+    }
+
+    inline int getNumChunks() const
+    {
+        return (int)chunks.size();
+    }
+
+    // Chunks drawn during the last render
+    inline int getNumChunksDrawn() const
+    {
+        return chunksDrawn;
+    }
+
+    void setShader(GFX::ShaderProgram *sh)
+    {
+        shader = sh;
+        invalidateAllChunks();
+    }
+
+    GFX::ShaderProgram *getShader() const
+    {
+        return shader;
+    }
+
+    // Layers cull and batch their chunks themselves, baking them into a
+    // container would draw the whole layer every frame
+    bool prepareStaticBatch(lua_State *L)
+    {
+        return false;
+    }
+
+    void render(lua_State *L);
+
+    bool collectDamage(lua_State *L, DamageRegion &damage, Rectangle &bounds);
+
+    NativeBounds getNativeBounds(const Matrix &mtx, Rectangle &bounds);
+
+private:
+
+    struct Tileset
+    {
+        uint32_t firstGid;
+        int      nativeTextureID;
+        lmscalar textureWidth;
+        lmscalar textureHeight;
+        lmscalar tileWidth;
+        lmscalar tileHeight;
+        lmscalar spacing;
+        lmscalar margin;
+        int      columns;
+        int      rows;
+    };
+
+    // Consecutive quads of a chunk drawn from the same texture
+    struct Run
+    {
+        int firstVertex;
+        int vertexCount;
+        int nativeTextureID;
+    };
+
+    struct Chunk
+    {
+        // Quads of the tiles in layer space, white with full alpha
+        utArray<GFX::VertexPosColorTex> vertices;
+        utArray<Run> runs;
+        Rectangle bounds;
+
+        // Vertices need to be rebuilt from the tiles
+        bool dirty;
+
+        GFX::QuadStaticBatch staticBatch;
+        bool     staticBatchValid;
+        // Capture failed for the current vertices, like for textures
+        // packed into an atlas, the chunk is drawn dynamically
+        bool     staticBatchFailed;
+        lmscalar staticBatchAlpha;
+        int      staticBatchBlendMode;
+
+        Chunk()
+        {
+            dirty                = true;
+            staticBatchValid     = false;
+            staticBatchFailed    = false;
+            staticBatchAlpha     = 1;
+            staticBatchBlendMode = 0;
+        }
+    };
+
+    const Tileset *findTileset(uint32_t gid) const;
+
+    void clearChunks();
+    void invalidateChunkAt(int x, int y);
+    void invalidateAllChunks();
+
+    // Rebuilds the vertices of the dirty chunks
+    void validateChunks();
+    void buildChunk(int chunkX, int chunkY, Chunk *chunk);
+
+    // Submits the chunk's quads transformed by the matrix to the QuadRenderer
+    void batchChunk(Chunk *chunk, Matrix &mtx, lmscalar alpha, uint32_t blendSrc, uint32_t blendDst);
+
+    // Draws the chunk from its static batch, returns false if it has to be
+    // drawn dynamically instead
+    bool drawChunkStatic(Chunk *chunk, const Matrix &mtx, uint32_t blendSrc, uint32_t blendDst);
+
+    // Bounds of the layer in local space
+    void getLocalBounds(Rectangle &bounds);
+
+    int      layerWidth;
+    int      layerHeight;
+    lmscalar tileWidth;
+    lmscalar tileHeight;
+    bool     isometric;
+
+    utArray<uint32_t> tiles;
+    utArray<Tileset>  tilesets;
+
+    int chunksX;
+    int chunksY;
+    utArray<Chunk *> chunks;
+
+    // Bumped whenever the tiles or tilesets change, part of the damage
+    // signature
+    uint32_t contentVersion;
+
+    int chunksDrawn;
+
+    GFX::ShaderProgram *shader;
+};
+}
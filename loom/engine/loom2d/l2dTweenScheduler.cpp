@@ -0,0 +1,441 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/engine/loom2d/l2dTweenScheduler.h"
+
+#include "loom/script/native/lsNativeInterface.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace Loom2D
+{
+utArray<TweenScheduler *> TweenScheduler::sSchedulers;
+
+// Shortest tween, like Tween's
+#define TWEENSCHEDULER_MIN_TIME    0.0001f
+
+#define TWEENSCHEDULER_TWO_PI      6.28318530718f
+
+// Names of the transitions in Transitions, by Transition
+static const char *sTransitionNames[TweenScheduler::TRANSITION_COUNT] = {
+    "linear",
+    "easeIn",
+    "easeOut",
+    "easeInOut",
+    "easeOutIn",
+    "easeInBack",
+    "easeOutBack",
+    "easeInOutBack",
+    "easeOutInBack",
+    "easeInElastic",
+    "easeOutElastic",
+    "easeInOutElastic",
+    "easeOutInElastic",
+    "easeInBounce",
+    "easeOutBounce",
+    "easeInOutBounce",
+    "easeOutInBounce"
+};
+
+// The easing functions of Transitions
+
+static lmscalar easeIn(lmscalar ratio)
+{
+    return ratio * ratio * ratio;
+}
+
+static lmscalar easeOut(lmscalar ratio)
+{
+    lmscalar invRatio = ratio - 1;
+    return invRatio * invRatio * invRatio + 1;
+}
+
+static lmscalar easeInBack(lmscalar ratio)
+{
+    const lmscalar s = 1.70158f;
+    return ratio * ratio * ((s + 1) * ratio - s);
+}
+
+static lmscalar easeOutBack(lmscalar ratio)
+{
+    const lmscalar s = 1.70158f;
+    lmscalar invRatio = ratio - 1;
+    return invRatio * invRatio * ((s + 1) * invRatio + s) + 1;
+}
+
+static lmscalar easeInElastic(lmscalar ratio)
+{
+    if (ratio == 0 || ratio == 1) return ratio;
+
+    const lmscalar p = 0.3f;
+    const lmscalar s = p / 4;
+    lmscalar invRatio = ratio - 1;
+    return -1 * powf(2, 10 * invRatio) * sinf((invRatio - s) * TWEENSCHEDULER_TWO_PI / p);
+}
+
+static lmscalar easeOutElastic(lmscalar ratio)
+{
+    if (ratio == 0 || ratio == 1) return ratio;
+
+    const lmscalar p = 0.3f;
+    const lmscalar s = p / 4;
+    return powf(2, -10 * ratio) * sinf((ratio - s) * TWEENSCHEDULER_TWO_PI / p) + 1;
+}
+
+static lmscalar easeOutBounce(lmscalar ratio)
+{
+    const lmscalar s = 7.5625f;
+    const lmscalar p = 2.75f;
+
+    if (ratio < 1 / p)
+    {
+        return s * ratio * ratio;
+    }
+    else if (ratio < 2 / p)
+    {
+        ratio -= 1.5f / p;
+        return s * ratio * ratio + 0.75f;
+    }
+    else if (ratio < 2.5f / p)
+    {
+        ratio -= 2.25f / p;
+        return s * ratio * ratio + 0.9375f;
+    }
+
+    ratio -= 2.625f / p;
+    return s * ratio * ratio + 0.984375f;
+}
+
+static lmscalar easeInBounce(lmscalar ratio)
+{
+    return 1 - easeOutBounce(1 - ratio);
+}
+
+typedef lmscalar (*EaseFunction)(lmscalar ratio);
+
+static lmscalar easeCombined(EaseFunction startFunc, EaseFunction endFunc, lmscalar ratio)
+{
+    if (ratio < 0.5f) return 0.5f * startFunc(ratio * 2);
+    else              return 0.5f * endFunc((ratio - 0.5f) * 2) + 0.5f;
+}
+
+lmscalar TweenScheduler::ease(int transition, lmscalar ratio)
+{
+    switch (transition)
+    {
+    case TRANSITION_EASE_IN:             return easeIn(ratio);
+    case TRANSITION_EASE_OUT:            return easeOut(ratio);
+    case TRANSITION_EASE_IN_OUT:         return easeCombined(easeIn, easeOut, ratio);
+    case TRANSITION_EASE_OUT_IN:         return easeCombined(easeOut, easeIn, ratio);
+    case TRANSITION_EASE_IN_BACK:        return easeInBack(ratio);
+    case TRANSITION_EASE_OUT_BACK:       return easeOutBack(ratio);
+    case TRANSITION_EASE_IN_OUT_BACK:    return easeCombined(easeInBack, easeOutBack, ratio);
+    case TRANSITION_EASE_OUT_IN_BACK:    return easeCombined(easeOutBack, easeInBack, ratio);
+    case TRANSITION_EASE_IN_ELASTIC:     return easeInElastic(ratio);
+    case TRANSITION_EASE_OUT_ELASTIC:    return easeOutElastic(ratio);
+    case TRANSITION_EASE_IN_OUT_ELASTIC: return easeCombined(easeInElastic, easeOutElastic, ratio);
+    case TRANSITION_EASE_OUT_IN_ELASTIC: return easeCombined(easeOutElastic, easeInElastic, ratio);
+    case TRANSITION_EASE_IN_BOUNCE:      return easeInBounce(ratio);
+    case TRANSITION_EASE_OUT_BOUNCE:     return easeOutBounce(ratio);
+    case TRANSITION_EASE_IN_OUT_BOUNCE:  return easeCombined(easeInBounce, easeOutBounce, ratio);
+    case TRANSITION_EASE_OUT_IN_BOUNCE:  return easeCombined(easeOutBounce, easeInBounce, ratio);
+    default:                             return ratio;
+    }
+}
+
+lmscalar TweenScheduler::getProperty(DisplayObject *target, int property)
+{
+    switch (property)
+    {
+    case PROPERTY_X:        return target->getX();
+    case PROPERTY_Y:        return target->getY();
+    case PROPERTY_SCALE_X:  return target->getScaleX();
+    case PROPERTY_SCALE_Y:  return target->getScaleY();
+    case PROPERTY_ROTATION: return target->getRotation();
+    case PROPERTY_ALPHA:    return target->getAlpha();
+    case PROPERTY_PIVOT_X:  return target->getPivotX();
+    case PROPERTY_PIVOT_Y:  return target->getPivotY();
+    case PROPERTY_SKEW_X:   return target->getSkewX();
+    case PROPERTY_SKEW_Y:   return target->getSkewY();
+    default:                return 0;
+    }
+}
+
+void TweenScheduler::setProperty(DisplayObject *target, int property, lmscalar value)
+{
+    switch (property)
+    {
+    case PROPERTY_X:        target->setX(value); break;
+    case PROPERTY_Y:        target->setY(value); break;
+    case PROPERTY_SCALE_X:  target->setScaleX(value); break;
+    case PROPERTY_SCALE_Y:  target->setScaleY(value); break;
+    case PROPERTY_ROTATION: target->setRotation(value); break;
+    case PROPERTY_ALPHA:    target->setAlpha(value); break;
+    case PROPERTY_PIVOT_X:  target->setPivotX(value); break;
+    case PROPERTY_PIVOT_Y:  target->setPivotY(value); break;
+    case PROPERTY_SKEW_X:   target->setSkewX(value); break;
+    case PROPERTY_SKEW_Y:   target->setSkewY(value); break;
+    }
+}
+
+TweenScheduler::TweenScheduler()
+{
+    nextId = 0;
+    sSchedulers.push_back(this);
+}
+
+TweenScheduler::~TweenScheduler()
+{
+    purge();
+    sSchedulers.erase(this, true);
+    lualoom_managedpointerreleased(this);
+}
+
+int TweenScheduler::tween(DisplayObject *target, int property, lmscalar endValue, lmscalar time, const char *transition, lmscalar delay)
+{
+    if (!target || property < 0 || property >= PROPERTY_COUNT)
+    {
+        return -1;
+    }
+
+    int transitionIndex = -1;
+    for (int i = 0; i < TRANSITION_COUNT; i++)
+    {
+        if (transition && !strcmp(transition, sTransitionNames[i]))
+        {
+            transitionIndex = i;
+            break;
+        }
+    }
+
+    if (transitionIndex == -1)
+    {
+        return -1;
+    }
+
+    Tween tween;
+    tween.target       = target;
+    tween.id           = nextId++;
+    tween.property     = (uint8_t)property;
+    tween.transition   = (uint8_t)transitionIndex;
+    tween.started      = false;
+    tween.reverse      = false;
+    tween.cycle        = 0;
+    tween.repeatCount  = 1;
+    tween.startValue   = 0;
+    tween.endValue     = endValue;
+    tween.totalTime    = time > TWEENSCHEDULER_MIN_TIME ? time : TWEENSCHEDULER_MIN_TIME;
+    tween.currentTime  = -delay;
+    tween.repeatDelay  = 0;
+    tweens.push_back(tween);
+
+    target->tweenCount++;
+
+    return tween.id;
+}
+
+TweenScheduler::Tween *TweenScheduler::findTween(int id)
+{
+    for (UTsize i = 0; i < tweens.size(); i++)
+    {
+        if (tweens[i].id == id)
+        {
+            return &tweens[i];
+        }
+    }
+
+    return NULL;
+}
+
+bool TweenScheduler::setRepeat(int id, int repeatCount, lmscalar repeatDelay, bool reverse)
+{
+    Tween *tween = findTween(id);
+    if (!tween)
+    {
+        return false;
+    }
+
+    tween->repeatCount = repeatCount < 0 ? 1 : repeatCount;
+    tween->repeatDelay = repeatDelay;
+    tween->reverse     = reverse;
+    return true;
+}
+
+void TweenScheduler::removeTween(UTsize index)
+{
+    tweens[index].target->tweenCount--;
+    tweens.erase(index, true);
+}
+
+bool TweenScheduler::cancel(int id)
+{
+    for (UTsize i = 0; i < tweens.size(); i++)
+    {
+        if (tweens[i].id == id)
+        {
+            removeTween(i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TweenScheduler::cancelTweens(DisplayObject *target)
+{
+    if (!target || !target->tweenCount)
+    {
+        return;
+    }
+
+    UTsize kept = 0;
+    for (UTsize i = 0; i < tweens.size(); i++)
+    {
+        if (tweens[i].target == target)
+        {
+            target->tweenCount--;
+            continue;
+        }
+
+        tweens[kept++] = tweens[i];
+    }
+
+    tweens.resize(kept);
+}
+
+bool TweenScheduler::containsTweens(DisplayObject *target)
+{
+    if (!target || !target->tweenCount)
+    {
+        return false;
+    }
+
+    for (UTsize i = 0; i < tweens.size(); i++)
+    {
+        if (tweens[i].target == target)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TweenScheduler::purge()
+{
+    for (UTsize i = 0; i < tweens.size(); i++)
+    {
+        tweens[i].target->tweenCount--;
+    }
+
+    tweens.clear();
+}
+
+void TweenScheduler::removeTarget(DisplayObject *target)
+{
+    for (UTsize i = 0; i < sSchedulers.size() && target->tweenCount; i++)
+    {
+        sSchedulers[i]->cancelTweens(target);
+    }
+}
+
+bool TweenScheduler::advanceTween(Tween &tween, lmscalar time)
+{
+    // Same steps as Tween.advanceTime, time carried over past the end
+    // of a repetition goes into the next one
+    while (time > 0)
+    {
+        lmscalar previousTime = tween.currentTime;
+        lmscalar restTime = tween.totalTime - tween.currentTime;
+        lmscalar carryOverTime = time > restTime ? time - restTime : 0;
+
+        tween.currentTime = tween.currentTime + time < tween.totalTime ? tween.currentTime + time : tween.totalTime;
+
+        // the delay is not over yet
+        if (tween.currentTime <= 0)
+        {
+            return false;
+        }
+
+        if (!tween.started)
+        {
+            tween.startValue = getProperty(tween.target, tween.property);
+            tween.started = true;
+        }
+
+        lmscalar ratio = tween.currentTime / tween.totalTime;
+        bool reversed = tween.reverse && (tween.cycle % 2 == 1);
+        lmscalar progress = ease(tween.transition, reversed ? 1 - ratio : ratio);
+
+        setProperty(tween.target, tween.property, tween.startValue + progress * (tween.endValue - tween.startValue));
+
+        if (previousTime < tween.totalTime && tween.currentTime >= tween.totalTime)
+        {
+            if (tween.repeatCount == 1)
+            {
+                return true;
+            }
+
+            tween.currentTime = -tween.repeatDelay;
+            tween.cycle++;
+            if (tween.repeatCount > 1) tween.repeatCount--;
+        }
+
+        time = carryOverTime;
+    }
+
+    return false;
+}
+
+void TweenScheduler::advanceTime(lmscalar time)
+{
+    if (time <= 0)
+    {
+        return;
+    }
+
+    completed.clear();
+
+    UTsize kept = 0;
+    for (UTsize i = 0; i < tweens.size(); i++)
+    {
+        Tween &tween = tweens[i];
+
+        if (advanceTween(tween, time))
+        {
+            tween.target->tweenCount--;
+            completed.push_back(tween.id);
+            continue;
+        }
+
+        tweens[kept++] = tween;
+    }
+
+    tweens.resize(kept);
+
+    // Listeners may start or cancel tweens, the array is consistent again
+    for (UTsize i = 0; i < completed.size(); i++)
+    {
+        _CompleteDelegate.pushArgument(completed[i]);
+        _CompleteDelegate.invoke();
+    }
+}
+}
@@ -0,0 +1,161 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#pragma once
+
+#include "loom/common/utils/utTypes.h"
+#include "loom/script/native/lsNativeDelegate.h"
+#include "loom/engine/loom2d/l2dDisplayObject.h"
+
+namespace Loom2D
+{
+
+// Native side of the TweenScheduler script class, runs tweens of the
+// numeric DisplayObject properties like Tween does, but with all of the
+// active tweens in one array and the properties set directly instead of
+// through script.
+class TweenScheduler
+{
+public:
+
+    // Properties that can be tweened, matching the script constants
+    enum Property
+    {
+        PROPERTY_X = 0,
+        PROPERTY_Y,
+        PROPERTY_SCALE_X,
+        PROPERTY_SCALE_Y,
+        PROPERTY_ROTATION,
+        PROPERTY_ALPHA,
+        PROPERTY_PIVOT_X,
+        PROPERTY_PIVOT_Y,
+        PROPERTY_SKEW_X,
+        PROPERTY_SKEW_Y,
+        PROPERTY_COUNT
+    };
+
+    // The transitions of loom2d.animation.Transitions
+    enum Transition
+    {
+        TRANSITION_LINEAR = 0,
+        TRANSITION_EASE_IN,
+        TRANSITION_EASE_OUT,
+        TRANSITION_EASE_IN_OUT,
+        TRANSITION_EASE_OUT_IN,
+        TRANSITION_EASE_IN_BACK,
+        TRANSITION_EASE_OUT_BACK,
+        TRANSITION_EASE_IN_OUT_BACK,
+        TRANSITION_EASE_OUT_IN_BACK,
+        TRANSITION_EASE_IN_ELASTIC,
+        TRANSITION_EASE_OUT_ELASTIC,
+        TRANSITION_EASE_IN_OUT_ELASTIC,
+        TRANSITION_EASE_OUT_IN_ELASTIC,
+        TRANSITION_EASE_IN_BOUNCE,
+        TRANSITION_EASE_OUT_BOUNCE,
+        TRANSITION_EASE_IN_OUT_BOUNCE,
+        TRANSITION_EASE_OUT_IN_BOUNCE,
+        TRANSITION_COUNT
+    };
+
+    // Called with the id of every tween that completed, after the
+    // scheduler advanced
+    LOOM_DELEGATE(Complete);
+
+    TweenScheduler();
+    ~TweenScheduler();
+
+    // Tweens the property of the target to the end value over time seconds
+    // after the delay, starting from the value it has once the delay is
+    // over. Returns the id of the tween, or -1 if the property or the
+    // transition named like in Transitions are unknown.
+    int tween(DisplayObject *target, int property, lmscalar endValue, lmscalar time, const char *transition, lmscalar delay);
+
+    // Repeats the tween the number of times, 0 repeats it until cancelled,
+    // with the delay in between and every second repetition reversed if
+    // requested. Returns false if there's no such tween.
+    bool setRepeat(int id, int repeatCount, lmscalar repeatDelay, bool reverse);
+
+    // Stops the tween where it is, returns false if there's no such tween
+    bool cancel(int id);
+
+    // Stops all of the tweens of the target
+    void cancelTweens(DisplayObject *target);
+
+    bool containsTweens(DisplayObject *target);
+
+    // Stops all tweens
+    void purge();
+
+    // Advances all of the tweens and reports the ones that completed
+    void advanceTime(lmscalar time);
+
+    inline int getNumTweens() const
+    {
+        return (int)tweens.size();
+    }
+
+    // Drops the tweens of a target that is about to be deleted from
+    // every scheduler
+    static void removeTarget(DisplayObject *target);
+
+    // Maps ratio in [0, 1] through the transition
+    static lmscalar ease(int transition, lmscalar ratio);
+
+private:
+
+    struct Tween
+    {
+        DisplayObject *target;
+        int      id;
+        uint8_t  property;
+        uint8_t  transition;
+        bool     started;
+        bool     reverse;
+        int      cycle;
+        int      repeatCount;
+        lmscalar startValue;
+        lmscalar endValue;
+        lmscalar totalTime;
+        // Negative while a delay is running
+        lmscalar currentTime;
+        lmscalar repeatDelay;
+    };
+
+    // Advances the tween, returns true once it completed
+    static bool advanceTween(Tween &tween, lmscalar time);
+
+    static lmscalar getProperty(DisplayObject *target, int property);
+    static void setProperty(DisplayObject *target, int property, lmscalar value);
+
+    // Removes the tween at the index and releases its target
+    void removeTween(UTsize index);
+
+    Tween *findTween(int id);
+
+    utArray<Tween> tweens;
+
+    // Ids of the tweens that completed during advanceTime
+    utArray<int> completed;
+
+    int nextId;
+
+    static utArray<TweenScheduler *> sSchedulers;
+};
+}
@@ -0,0 +1,234 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <math.h>
+
+#include "loom/engine/loom2d/l2dVirtualLayoutCache.h"
+
+namespace Loom2D
+{
+
+void VirtualLayoutCache::rebuild()
+{
+    UTsize count = sizes.size();
+
+    tree.resize(count + 1);
+    tree[0] = 0;
+
+    for (UTsize i = 1; i <= count; i++)
+    {
+        tree[i] = getSpan(i - 1);
+    }
+
+    // push every node into its parent, O(n)
+    for (UTsize i = 1; i <= count; i++)
+    {
+        UTsize parent = i + (i & (~i + 1));
+        if (parent <= count)
+        {
+            tree[parent] += tree[i];
+        }
+    }
+
+    dirty = false;
+}
+
+
+void VirtualLayoutCache::update(UTsize index, lmscalar delta)
+{
+    if (dirty || (delta == 0))
+    {
+        return;
+    }
+
+    UTsize count = sizes.size();
+
+    for (UTsize i = index + 1; i <= count; i += i & (~i + 1))
+    {
+        tree[i] += delta;
+    }
+}
+
+
+lmscalar VirtualLayoutCache::sumBefore(UTsize count)
+{
+    if (dirty)
+    {
+        rebuild();
+    }
+
+    lmscalar sum = 0;
+
+    for (UTsize i = count; i > 0; i -= i & (~i + 1))
+    {
+        sum += tree[i];
+    }
+
+    return sum;
+}
+
+
+void VirtualLayoutCache::setLength(int length)
+{
+    if (length < 0)
+    {
+        length = 0;
+    }
+
+    UTsize oldLength = sizes.size();
+
+    if ((UTsize)length == oldLength)
+    {
+        return;
+    }
+
+    sizes.resize(length);
+
+    for (UTsize i = oldLength; i < (UTsize)length; i++)
+    {
+        sizes[i] = NAN;
+    }
+
+    dirty = true;
+}
+
+
+void VirtualLayoutCache::setSize(int index, lmscalar size)
+{
+    if (index < 0)
+    {
+        return;
+    }
+
+    if (index >= (int)sizes.size())
+    {
+        setLength(index + 1);
+    }
+
+    lmscalar oldSpan = getSpan(index);
+    sizes[index] = size;
+    update(index, getSpan(index) - oldSpan);
+}
+
+
+void VirtualLayoutCache::insert(int index, lmscalar size)
+{
+    if (index < 0)
+    {
+        return;
+    }
+
+    if (index >= (int)sizes.size())
+    {
+        setSize(index, size);
+        return;
+    }
+
+    sizes.push_back(0);
+
+    for (UTsize i = sizes.size() - 1; i > (UTsize)index; i--)
+    {
+        sizes[i] = sizes[i - 1];
+    }
+
+    sizes[index] = size;
+    dirty        = true;
+}
+
+
+void VirtualLayoutCache::remove(int index)
+{
+    if ((index < 0) || (index >= (int)sizes.size()))
+    {
+        return;
+    }
+
+    sizes.erase((UTsize)index, true);
+    dirty = true;
+}
+
+
+lmscalar VirtualLayoutCache::getPosition(int index)
+{
+    if (index <= 0)
+    {
+        return 0;
+    }
+
+    UTsize count = sizes.size();
+
+    if ((UTsize)index <= count)
+    {
+        return sumBefore(index);
+    }
+
+    return sumBefore(count) + (index - count) * (typicalSize + gap);
+}
+
+
+int VirtualLayoutCache::getIndexAt(lmscalar position)
+{
+    if (position < 0)
+    {
+        return 0;
+    }
+
+    if (dirty)
+    {
+        rebuild();
+    }
+
+    UTsize count = sizes.size();
+
+    // descend the tree for the number of items that end at or before the
+    // position, which is the index of the item containing it
+    UTsize   index = 0;
+    lmscalar sum   = 0;
+    UTsize   step  = 1;
+
+    while ((step << 1) <= count)
+    {
+        step <<= 1;
+    }
+
+    for ( ; step > 0; step >>= 1)
+    {
+        UTsize next = index + step;
+        if ((next <= count) && (sum + tree[next] <= position))
+        {
+            index = next;
+            sum  += tree[next];
+        }
+    }
+
+    if (index < count)
+    {
+        return (int)index;
+    }
+
+    lmscalar span = typicalSize + gap;
+    if (span <= 0)
+    {
+        return (int)count;
+    }
+
+    return (int)count + (int)floor((position - sum) / span);
+}
+}
@@ -0,0 +1,147 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#pragma once
+
+#include "loom/common/utils/utTypes.h"
+
+namespace Loom2D
+{
+
+// Item sizes along the axis of a virtualized layout, as the variable item
+// dimension caches of Feathers' VerticalLayout and HorizontalLayout. Items
+// whose size isn't known yet count as typicalSize. Every item is followed
+// by gap, positions are kept in a Fenwick tree so the position of an item
+// and the item at a scroll position are found in O(log n) instead of
+// walking every item before it.
+class VirtualLayoutCache
+{
+protected:
+
+    // NaN for items that haven't been measured
+    utArray<lmscalar> sizes;
+
+    // 1-based Fenwick tree over the item sizes plus gap
+    utArray<lmscalar> tree;
+
+    // set when the tree has to be rebuilt before the next query
+    bool dirty;
+
+    lmscalar typicalSize;
+    lmscalar gap;
+
+    static bool isUnknown(lmscalar size)
+    {
+        return size != size;
+    }
+
+    lmscalar getSpan(UTsize index) const
+    {
+        return (isUnknown(sizes[index]) ? typicalSize : sizes[index]) + gap;
+    }
+
+    void rebuild();
+
+    void update(UTsize index, lmscalar delta);
+
+    lmscalar sumBefore(UTsize count);
+
+public:
+
+    VirtualLayoutCache()
+    {
+        dirty       = false;
+        typicalSize = 0;
+        gap         = 0;
+    }
+
+    lmscalar getTypicalSize() const
+    {
+        return typicalSize;
+    }
+
+    void setTypicalSize(lmscalar value)
+    {
+        if (value != typicalSize)
+        {
+            typicalSize = value;
+            dirty       = true;
+        }
+    }
+
+    lmscalar getGap() const
+    {
+        return gap;
+    }
+
+    void setGap(lmscalar value)
+    {
+        if (value != gap)
+        {
+            gap   = value;
+            dirty = true;
+        }
+    }
+
+    int getLength() const
+    {
+        return (int)sizes.size();
+    }
+
+    // Resizes the cache, added items are unknown
+    void setLength(int length);
+
+    // Forgets every item
+    void reset()
+    {
+        sizes.clear(true);
+        tree.clear(true);
+        dirty = false;
+    }
+
+    bool isKnown(int index) const
+    {
+        return index >= 0 && index < (int)sizes.size() && !isUnknown(sizes[index]);
+    }
+
+    // The size of an item, typicalSize if it isn't known
+    lmscalar getSize(int index) const
+    {
+        return isKnown(index) ? sizes[index] : typicalSize;
+    }
+
+    // Sets the size of an item, growing the cache if needed; NaN marks the
+    // item as unknown
+    void setSize(int index, lmscalar size);
+
+    // Inserts an item before index, size may be NaN for unknown
+    void insert(int index, lmscalar size);
+
+    void remove(int index);
+
+    // The position of an item relative to the first, the sum of the sizes
+    // and gaps of the items before it. Items past the end count as typical.
+    lmscalar getPosition(int index);
+
+    // The item whose span, its size and the gap after it, contains the
+    // position. Positions past the end continue with typical items.
+    int getIndexAt(lmscalar position);
+};
+}
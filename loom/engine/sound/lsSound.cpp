@@ -18,12 +18,17 @@
  * ===========================================================================
  */
 
+#include <float.h>
+
 #include "loom/common/core/log.h"
+#include "loom/common/core/performance.h"
 #include "loom/common/assets/assets.h"
 #include "loom/common/assets/assetsSound.h"
 #include "loom/common/config/applicationConfig.h"
+#include "loom/common/platform/platformThread.h"
 #include "loom/common/utils/utString.h"
 #include "loom/script/loomscript.h"
+#include "loom/script/native/lsNativeDelegate.h"
 #include "loom/vendor/openal-soft/include/AL/al.h"
 #include "loom/vendor/openal-soft/include/AL/alc.h"
 #include "loom/vendor/openal-soft/include/AL/alext.h"
@@ -35,6 +40,21 @@ static ALCcontext *ctx = NULL;
 
 lmDefineLogGroup(gLoomSoundLogGroup, "sound", 1, LoomLogInfo);
 
+// Streamed sounds keep this many buffers of this many bytes queued, about
+// three quarters of a second of 44.1KHz stereo.
+#define LOOM_SOUND_STREAM_BUFFERS        4
+#define LOOM_SOUND_STREAM_BUFFER_SIZE    (32 * 1024)
+#define LOOM_SOUND_STREAM_SLEEP_MS       10
+
+// Most sources the voice pool creates; mobile OpenAL implementations tend to
+// allow 32 at most. Streams have a source of their own on top.
+#define LOOM_SOUND_MAX_VOICES            32
+
+// Bytes of decoded sound kept in OpenAL buffers, see OALBufferManager.
+#define LOOM_SOUND_BUFFER_BUDGET         (16 * 1024 * 1024)
+
+static void loomsound_shutdownSounds();
+
 // Nop for now
 #define CHECK_OPENAL_ERROR() \
     err = alcGetError(dev); if (err != 0) lmLogError(gLoomSoundLogGroup, "OpenAL error %d %s:%d", err, __FILE__, __LINE__); 
@@ -92,6 +112,8 @@ extern "C"
 
     void loomsound_shutdown()
     {
+        loomsound_shutdownSounds();
+
         alcMakeContextCurrent(NULL);
         
         if(ctx)
@@ -107,84 +129,147 @@ extern "C"
 class OALBufferNote
 {
 public:
-    ALuint buffer;
+    utString path;
+    ALuint buffer; // 0 until decoded
+    int bytes;
     int refCounter;
+    int voices; // voices the buffer is bound to
+    unsigned int lastUsed;
 
     OALBufferNote()
     {
         buffer = 0;
+        bytes = 0;
         refCounter = 1;
+        voices = 0;
+        lastUsed = 0;
     }
 };
 
+// Sounds are decoded into their OpenAL buffer when first played, Ogg and MP3
+// are kept compressed until then. Decoded buffers stay resident until they
+// add up to more than the budget, then the least recently played ones which
+// aren't playing are dropped again.
 class OALBufferManager
 {
 
 public:
     
     static utHashTable<utHashedString, OALBufferNote *> buffers;
+    static int residentBytes;
+    static int budget;
+    static unsigned int useSequence;
 
-    static ALuint getBufferForAsset(const char *assetPath)
+    // Notes a Sound's use of the asset, NULL if it fails to load.
+    static OALBufferNote *getNoteForAsset(const char *assetPath)
+    {
+        OALBufferNote **notePtr = buffers.get(assetPath);
+        if(notePtr != NULL)
+        {
+            (*notePtr)->refCounter++;
+            return *notePtr;
+        }
+
+        // Make sure it loads.
+        loom_asset_sound *sound = (loom_asset_sound *)loom_asset_lock(assetPath, LATSound, 1);
+        if(!sound)
+        {
+            lmLogError(gLoomSoundLogGroup, "Failed to load sound asset '%s'!", assetPath);
+            return NULL;
+        }
+
+        loom_asset_unlock(assetPath);
+
+        OALBufferNote *note = lmNew(NULL) OALBufferNote();
+        note->path = assetPath;
+        buffers.insert(assetPath, note);
+
+        // Subscribe for updates.
+        loom_asset_subscribe(assetPath, soundUpdater, note, 0);
+
+        return note;
+    }
+
+    // Returns the buffer of the note, decoding the asset into it if it
+    // isn't resident.
+    static ALuint acquireBuffer(OALBufferNote *note)
     {
         ALCenum err;
 
-        // If we don't have it, create a new one.
-        OALBufferNote **notePtr = buffers.get(assetPath);
-        OALBufferNote *note = NULL;
+        note->lastUsed = ++useSequence;
 
-        if(notePtr == NULL)
+        if(note->buffer)
         {
-            note = lmNew(NULL) OALBufferNote();
+            return note->buffer;
+        }
 
-            // Lock the asset.
-            loom_asset_sound *sound = (loom_asset_sound *)loom_asset_lock(assetPath, LATSound, 1);
+        loom_asset_sound *sound = (loom_asset_sound *)loom_asset_lock(note->path.c_str(), LATSound, 1);
+        if(!sound)
+        {
+            lmLogError(gLoomSoundLogGroup, "Failed to load sound asset '%s'!", note->path.c_str());
+            return 0;
+        }
 
-            if(sound)
-            {
-                // OpenAL buffer alloc.
-                alGenBuffers((ALuint)1, &note->buffer);
-                CHECK_OPENAL_ERROR();
+        int size = 0;
+        void *pcm = loom_asset_soundDecode(sound, &size);
 
-                ALenum sampleFormat;
-                if (sound->channels == 1)
-                {
-                    sampleFormat = sound->bytesPerSample == 1 ? AL_FORMAT_MONO8 : AL_FORMAT_MONO16;
-                }
-                else
-                {
-                    sampleFormat = sound->bytesPerSample == 1 ? AL_FORMAT_STEREO8 : AL_FORMAT_STEREO16;
-                }
-                alBufferData(note->buffer,
-                             sampleFormat,
-                             sound->buffer,
-                             sound->bufferSize,
-                             sound->sampleRate);
-                CHECK_OPENAL_ERROR();
+        if(pcm)
+        {
+            ALenum sampleFormat;
+            if (sound->channels == 1)
+            {
+                sampleFormat = sound->bytesPerSample == 1 ? AL_FORMAT_MONO8 : AL_FORMAT_MONO16;
             }
             else
             {
-                lmLogError(gLoomSoundLogGroup, "Failed to load sound asset '%s'!", assetPath);
+                sampleFormat = sound->bytesPerSample == 1 ? AL_FORMAT_STEREO8 : AL_FORMAT_STEREO16;
             }
 
-            loom_asset_unlock(assetPath);
-
-            // And store back in the hash table.
-            buffers.insert(assetPath, note);
+            // OpenAL buffer alloc.
+            alGenBuffers((ALuint)1, &note->buffer);
+            CHECK_OPENAL_ERROR();
+            alBufferData(note->buffer, sampleFormat, pcm, size, sound->sampleRate);
+            CHECK_OPENAL_ERROR();
 
-            // Subscribe for updates. (Race condition?)
-            loom_asset_subscribe(assetPath, soundUpdater, note, 0);
+            note->bytes = size;
+            residentBytes += size;
         }
         else
         {
-            // Get the value from the hashtable.
-            note = *notePtr;
-            note->refCounter++;
+            lmLogError(gLoomSoundLogGroup, "Failed to decode sound asset '%s'!", note->path.c_str());
         }
 
-        // Return the buffer.
+        loom_asset_soundReleaseDecoded(sound, pcm);
+        loom_asset_unlock(note->path.c_str());
+
+        trim(note);
+
         return note->buffer;
     }
 
+    static void dropBuffer(OALBufferNote *note)
+    {
+        if(!note->buffer)
+        {
+            return;
+        }
+
+        alDeleteBuffers((ALuint)1, (const ALuint*)(&note->buffer));
+        note->buffer = 0;
+
+        residentBytes -= note->bytes;
+        note->bytes = 0;
+    }
+
+    // Drops the least recently played buffers until within budget, except
+    // keep and those bound to a voice.
+    static void trim(OALBufferNote *keep);
+
+    static void setBudget(int bytes)
+    {
+        budget = bytes;
+        trim(NULL);
+    }
 
     static void decBufferForAsset(const char *assetPath)
     {
@@ -201,7 +286,8 @@ public:
         if(note->refCounter == 0)
         {
             ///delete and remove the buffer if it has no more references
-            alDeleteBuffers((ALuint)1, (const ALuint*)(&note->buffer));
+            dropBuffer(note);
+            loom_asset_unsubscribe(assetPath, soundUpdater, note);
             buffers.remove(assetPath);
             lmDelete(NULL, note);
         }
@@ -211,6 +297,95 @@ public:
 };
 
 utHashTable<utHashedString, OALBufferNote *> OALBufferManager::buffers;
+int OALBufferManager::residentBytes = 0;
+int OALBufferManager::budget = LOOM_SOUND_BUFFER_BUDGET;
+unsigned int OALBufferManager::useSequence = 0;
+
+// Decoder and queued buffers of a streamed Sound. Guarded by
+// Sound::smStreamLock, as the streaming thread refills the buffers.
+class SoundStream
+{
+public:
+    void                     *file;
+    loom_asset_soundStream_t *decoder;
+    ALuint                   buffers[LOOM_SOUND_STREAM_BUFFERS];
+    ALenum                   format;
+    unsigned char            *scratch;
+
+    bool looping;
+
+    // Set from play until stopped or the end is reached, pausing keeps it.
+    bool playing;
+
+    SoundStream(void *_file, loom_asset_soundStream_t *_decoder)
+    {
+        file    = _file;
+        decoder = _decoder;
+        scratch = (unsigned char *)lmAlloc(NULL, LOOM_SOUND_STREAM_BUFFER_SIZE);
+        looping = false;
+        playing = false;
+
+        if (decoder->channels == 1)
+        {
+            format = decoder->bytesPerSample == 1 ? AL_FORMAT_MONO8 : AL_FORMAT_MONO16;
+        }
+        else
+        {
+            format = decoder->bytesPerSample == 1 ? AL_FORMAT_STEREO8 : AL_FORMAT_STEREO16;
+        }
+
+        alGenBuffers(LOOM_SOUND_STREAM_BUFFERS, buffers);
+    }
+
+    ~SoundStream()
+    {
+        alDeleteBuffers(LOOM_SOUND_STREAM_BUFFERS, buffers);
+        lmFree(NULL, scratch);
+        loom_asset_soundStream_close(decoder);
+        loom_asset_closeFile(file);
+    }
+
+    // Decodes the next piece into buffer, wrapping around when looping.
+    // False once there is nothing left to play.
+    bool fill(ALuint buffer)
+    {
+        ALCenum err;
+
+        int length = loom_asset_soundStream_read(decoder, scratch, LOOM_SOUND_STREAM_BUFFER_SIZE);
+
+        while (looping && length < LOOM_SOUND_STREAM_BUFFER_SIZE)
+        {
+            loom_asset_soundStream_rewind(decoder);
+
+            int more = loom_asset_soundStream_read(decoder, scratch + length, LOOM_SOUND_STREAM_BUFFER_SIZE - length);
+            if (more == 0)
+            {
+                break;
+            }
+
+            length += more;
+        }
+
+        if (length == 0)
+        {
+            return false;
+        }
+
+        alBufferData(buffer, format, scratch, length, decoder->sampleRate);
+        CHECK_OPENAL_ERROR();
+        return true;
+    }
+};
+
+class Sound;
+
+// A pooled OpenAL source, lent to a Sound while it plays.
+struct SoundVoice
+{
+    ALuint       source;
+    Sound        *owner;
+    unsigned int started; // play order, the oldest is stolen first
+};
 
 class Sound
 {
@@ -218,9 +393,27 @@ class Sound
 
 protected:
     static Sound *smList;
-    const static int csmMaxSounds = 256;
     static int count;
 
+    // Sounds only hold a voice while they play, so any number may be loaded
+    // while the sources in use stay bounded.
+    static SoundVoice smVoices[LOOM_SOUND_MAX_VOICES];
+    static int smVoiceCount;
+    static bool smVoicesExhausted;
+    static unsigned int smPlaySequence;
+
+    // Most voices playing an asset at once, by path.
+    static utHashTable<utHashedString, int> smMaxInstances;
+
+    // Assets preload() is waiting on.
+    static utArray<utString> smPreloads;
+
+    // Streamed sounds, serviced by smStreamThread.
+    static utArray<Sound *> smStreams;
+    static MutexHandle smStreamLock;
+    static ThreadHandle smStreamThread;
+    static atomic_int_t smStreamQuit;
+
 public:
 
     ALuint source;
@@ -228,6 +421,22 @@ public:
     int needsRestart;
     int playCount;
     utString path;
+    SoundStream *stream;
+
+    OALBufferNote *note;
+    SoundVoice *voice;
+    int priority;
+
+    // Source settings, applied whenever a voice is acquired.
+    float position[3];
+    float velocity[3];
+    ALint sourceRelative;
+    float referenceDistance;
+    float maxDistance;
+    float rollOff;
+    float gain;
+    float pitch;
+    bool looping;
 
     static void reset()
     {
@@ -240,97 +449,422 @@ public:
         }
     }
 
+    LOOM_STATICDELEGATE(OnPreloaded);
+
+    // Loads the asset on the load threads, onPreloaded fires from tick()
+    // once it has a buffer.
     static void preload(const char *assetPath)
     {
-        OALBufferManager::getBufferForAsset(assetPath);
+        if(OALBufferManager::buffers.get(assetPath))
+        {
+            OALBufferNote *note = OALBufferManager::getNoteForAsset(assetPath);
+            firePreloaded(assetPath, OALBufferManager::acquireBuffer(note) != 0);
+            return;
+        }
+
+        for(UTsize i = 0; i < smPreloads.size(); i++)
+        {
+            if(smPreloads[i] == assetPath)
+            {
+                return;
+            }
+        }
+
+        loom_asset_preload(assetPath);
+        smPreloads.push_back(assetPath);
+    }
+
+    static void firePreloaded(const char *assetPath, bool success)
+    {
+        _OnPreloadedDelegate.pushArgument(assetPath);
+        _OnPreloadedDelegate.pushArgument(success);
+        _OnPreloadedDelegate.invoke();
     }
 
-    static Sound *load(const char *assetPath)
+    static void tick()
     {
-        ALCenum err;
+        for(UTsize i = 0; i < smPreloads.size(); )
+        {
+            utString assetPath = smPreloads[i];
+
+            // Still loading?
+            bool loaded = loom_asset_checkLoadedPercentage(assetPath.c_str()) == 1.f;
+            if(!loaded && loom_asset_pending(assetPath.c_str()))
+            {
+                i++;
+                continue;
+            }
 
-        // Get the buffer.
-        ALuint buffer = OALBufferManager::getBufferForAsset(assetPath);
-        if(buffer <= 0)
+            smPreloads.erase(i, true);
+
+            // Decode it now, and hold on to the asset like a blocking
+            // preload did.
+            OALBufferNote *note = loaded ? OALBufferManager::getNoteForAsset(assetPath.c_str()) : NULL;
+            bool success = note && OALBufferManager::acquireBuffer(note) != 0;
+            firePreloaded(assetPath.c_str(), success);
+        }
+    }
+
+    static Sound *load(const char *assetPath)
+    {
+        // Note the asset, it is decoded when first played.
+        OALBufferNote *note = OALBufferManager::getNoteForAsset(assetPath);
+        if(!note)
         {
             // Failed, return a dummy sound.
             lmLogError(gLoomSoundLogGroup, "Failed to get buffer for sound '%s', returning dummy Sound...", assetPath);
             return lmNew(NULL) Sound("");
         }
 
-        // We got a live one!
+        // We got a live one! It gets a voice once played.
         Sound *s = lmNew(NULL) Sound(assetPath);
+        s->note = note;
+        s->link();
 
-        // Check the list for dead sources if we exceeded our cap.
-        Sound *walk = smList;
-        if(count > csmMaxSounds)
+        // Return the shiny new sound!
+        return s;
+    }
+
+    static Sound *loadStream(const char *assetPath)
+    {
+        ALCenum err;
+
+        // Map the encoded file, it is decoded a piece at a time as it plays.
+        const void *bits = NULL;
+        size_t size = 0;
+        void *file = loom_asset_openFile(assetPath, &bits, &size);
+        loom_asset_soundStream_t *decoder = file ? loom_asset_soundStream_open(bits, size) : NULL;
+
+        if(!decoder)
+        {
+            lmLogError(gLoomSoundLogGroup, "Failed to open stream for sound '%s', returning dummy Sound...", assetPath);
+            loom_asset_closeFile(file);
+            return lmNew(NULL) Sound("");
+        }
+
+        Sound *s = lmNew(NULL) Sound(assetPath);
+
+        // Streams always get a source of their own, they are never stolen.
+        alGenSources((ALuint)1, &s->source);
+        CHECK_OPENAL_ERROR();
+
+        s->applySource();
+        s->stream = lmNew(NULL) SoundStream(file, decoder);
+        s->link();
+
+        loom_mutex_lock(smStreamLock);
+        smStreams.push_back(s);
+        loom_mutex_unlock(smStreamLock);
+
+        if(!smStreamThread)
+        {
+            smStreamThread = loom_thread_startWithHint(streamThread, NULL, LOOM_THREAD_LATENCY_CRITICAL);
+        }
+
+        return s;
+    }
+
+    static int __stdcall streamThread(void *param)
+    {
+        loom_thread_setDebugName("Sound Streaming");
+        LoomTrace::setThreadName("Sound Streaming");
+
+        while(!atomic_load32(&smStreamQuit))
+        {
+            loom_mutex_lock(smStreamLock);
+            for(UTsize i = 0; i < smStreams.size(); i++)
+            {
+                LOOM_TRACE_SCOPE(soundStream, NULL);
+                smStreams[i]->service();
+            }
+            loom_mutex_unlock(smStreamLock);
+
+            loom_thread_sleep(LOOM_SOUND_STREAM_SLEEP_MS);
+        }
+
+        return 0;
+    }
+
+    static void stopStreaming()
+    {
+        if(!smStreamThread)
+        {
+            return;
+        }
+
+        atomic_store32(&smStreamQuit, 1);
+        loom_thread_join(smStreamThread);
+        smStreamThread = NULL;
+        atomic_store32(&smStreamQuit, 0);
+    }
+
+    static void setMaxInstances(const char *assetPath, int maxInstances)
+    {
+        if(maxInstances < 0)
+        {
+            smMaxInstances.remove(assetPath);
+        }
+        else
         {
-            while(walk)
+            smMaxInstances.insert(assetPath, maxInstances);
+        }
+    }
+
+    static bool isVoiceBusy(SoundVoice *v)
+    {
+        if(!v->owner)
+        {
+            return false;
+        }
+
+        ALint state = 0;
+        alGetSourcei(v->source, AL_SOURCE_STATE, &state);
+        return (state == AL_PLAYING || state == AL_PAUSED);
+    }
+
+    static void releaseVoice(SoundVoice *v)
+    {
+        if(!v->owner)
+        {
+            return;
+        }
+
+        alSourceStop(v->source);
+        alSourcei(v->source, AL_BUFFER, 0);
+
+        if(v->owner->note)
+        {
+            v->owner->note->voices--;
+        }
+
+        v->owner->voice = NULL;
+        v->owner->source = 0;
+        v->owner = NULL;
+    }
+
+    // Finds a voice for s, taking it from whoever had it. NULL if every voice
+    // is playing something of higher priority, or s is at its instance limit
+    // of zero.
+    static SoundVoice *acquireVoice(Sound *s)
+    {
+        // At the asset's instance limit its oldest voice is taken over.
+        int *maxInstances = smMaxInstances.get(s->path);
+        if(maxInstances)
+        {
+            int instances = 0;
+            SoundVoice *oldest = NULL;
+
+            for(int i = 0; i < smVoiceCount; i++)
             {
-                if(walk->isPlaying() == false && walk->source != 0 && walk->hasEverPlayed() == false)
+                SoundVoice *v = &smVoices[i];
+                if(isVoiceBusy(v) && v->owner->path == s->path)
                 {
-                    // Snag the source and reuse it.
-                    lmLogWarn(gLoomSoundLogGroup, 
-                                "Too many active sources, reusing source #%d, which means that Sound Asset %s is no longer valid. Don't load so many sounds at once!", 
-                                walk->source, 
-                                walk->path.c_str());
-                    s->source = walk->source;
-                    walk->source = 0;
-                    break;
+                    instances++;
+                    if(!oldest || v->started < oldest->started)
+                    {
+                        oldest = v;
+                    }
                 }
+            }
 
-                walk = walk->next;
-            }            
+            if(instances >= *maxInstances)
+            {
+                if(oldest)
+                {
+                    releaseVoice(oldest);
+                }
+                return oldest;
+            }
         }
-        else
+
+        // Reuse a voice which finished playing.
+        for(int i = 0; i < smVoiceCount; i++)
         {
-            walk = NULL;
+            if(!isVoiceBusy(&smVoices[i]))
+            {
+                releaseVoice(&smVoices[i]);
+                return &smVoices[i];
+            }
         }
 
-        // If nothing, generate a source.
-        if(!walk)
+        // Grow the pool until the cap, or until the device runs out.
+        if(smVoiceCount < LOOM_SOUND_MAX_VOICES && !smVoicesExhausted)
         {
-            alGenSources((ALuint)1, &s->source);
-            CHECK_OPENAL_ERROR();
+            ALuint newSource = 0;
+            alGetError();
+            alGenSources((ALuint)1, &newSource);
+
+            if(alGetError() == AL_NO_ERROR)
+            {
+                SoundVoice *v = &smVoices[smVoiceCount++];
+                v->source = newSource;
+                v->owner = NULL;
+                v->started = 0;
+                return v;
+            }
+
+            lmLogWarn(gLoomSoundLogGroup, "Out of OpenAL sources, limiting to %d voices", smVoiceCount);
+            smVoicesExhausted = true;
         }
-        
-        // Set up source defaults.
-        alSourcef(s->source, AL_PITCH, 1);
-        CHECK_OPENAL_ERROR();
-        alSourcef(s->source, AL_GAIN, 1);
-        CHECK_OPENAL_ERROR();
-        alSource3f(s->source, AL_POSITION, 0.f, 0.f, 0.f);
-        CHECK_OPENAL_ERROR();
-        alSource3f(s->source, AL_VELOCITY, 0.f, 0.f, 0.f);
-        CHECK_OPENAL_ERROR();
-        alSourcei(s->source, AL_LOOPING, AL_FALSE);
-        CHECK_OPENAL_ERROR();
-        
-        // Bind the buffer.
-        alSourcei(s->source, AL_BUFFER, buffer);
+
+        // Otherwise steal the oldest of the lowest priority.
+        SoundVoice *victim = NULL;
+        for(int i = 0; i < smVoiceCount; i++)
+        {
+            SoundVoice *v = &smVoices[i];
+            if(!victim || v->owner->priority < victim->owner->priority ||
+               (v->owner->priority == victim->owner->priority && v->started < victim->started))
+            {
+                victim = v;
+            }
+        }
+
+        if(!victim || victim->owner->priority > s->priority)
+        {
+            return NULL;
+        }
+
+        releaseVoice(victim);
+        return victim;
+    }
+
+    // Voices which finished playing keep their buffer bound until reused.
+    static void releaseIdleVoices()
+    {
+        for(int i = 0; i < smVoiceCount; i++)
+        {
+            if(!isVoiceBusy(&smVoices[i]))
+            {
+                releaseVoice(&smVoices[i]);
+            }
+        }
+    }
+
+    static void setBufferBudget(int bytes)
+    {
+        OALBufferManager::setBudget(bytes);
+    }
+
+    static void deleteVoices()
+    {
+        for(int i = 0; i < smVoiceCount; i++)
+        {
+            releaseVoice(&smVoices[i]);
+            alDeleteSources(1, &smVoices[i].source);
+        }
+
+        smVoiceCount = 0;
+        smVoicesExhausted = false;
+    }
+
+    void applySource()
+    {
+        ALCenum err;
+
+        alSourcef(source, AL_PITCH, pitch);
+        alSourcef(source, AL_GAIN, gain);
+        alSource3f(source, AL_POSITION, position[0], position[1], position[2]);
+        alSource3f(source, AL_VELOCITY, velocity[0], velocity[1], velocity[2]);
+        alSourcei(source, AL_SOURCE_RELATIVE, sourceRelative);
+        alSourcef(source, AL_REFERENCE_DISTANCE, referenceDistance);
+        alSourcef(source, AL_MAX_DISTANCE, maxDistance);
+        alSourcef(source, AL_ROLLOFF_FACTOR, rollOff);
+
+        // Streams loop by rewinding the decoder instead.
+        alSourcei(source, AL_LOOPING, looping && !stream ? AL_TRUE : AL_FALSE);
         CHECK_OPENAL_ERROR();
+    }
 
+    void link()
+    {
         // Link onto the end of the list.
         if(!smList)
         {
-            smList = s;
+            smList = this;
+            return;
         }
-        else
+
+        Sound *walk = smList;
+        while(walk->next)
         {
-            walk = smList;
-            while(walk)
+            walk = walk->next;
+        }
+        walk->next = this;
+    }
+
+    // Refills the buffers the source is done with, on the streaming thread
+    // with smStreamLock held.
+    void service()
+    {
+        if(!stream->playing)
+        {
+            return;
+        }
+
+        ALint processed = 0;
+        alGetSourcei(source, AL_BUFFERS_PROCESSED, &processed);
+
+        while(processed-- > 0)
+        {
+            ALuint buffer = 0;
+            alSourceUnqueueBuffers(source, 1, &buffer);
+
+            if(stream->fill(buffer))
             {
-                if(walk->next == NULL)
-                {
-                    walk->next = s;
-                    break;
-                }
-                walk = walk->next;
-            }            
+                alSourceQueueBuffers(source, 1, &buffer);
+            }
         }
 
-        // Return the shiny new sound!
-        return s;
+        ALint state = 0;
+        alGetSourcei(source, AL_SOURCE_STATE, &state);
+
+        if(state == AL_PLAYING || state == AL_PAUSED)
+        {
+            return;
+        }
+
+        // Either the decoder fell behind and the source ran dry, so pick up
+        // where it stopped, or the end was reached.
+        ALint queued = 0;
+        alGetSourcei(source, AL_BUFFERS_QUEUED, &queued);
+
+        if(queued > 0)
+        {
+            alSourcePlay(source);
+        }
+        else
+        {
+            stream->playing = false;
+        }
+    }
+
+    // Starts a stream over from the beginning, with smStreamLock held.
+    void restartStream()
+    {
+        ALCenum err;
+
+        alSourceStop(source);
+        alSourcei(source, AL_BUFFER, 0);
+        loom_asset_soundStream_rewind(stream->decoder);
+
+        int queued = 0;
+        while(queued < LOOM_SOUND_STREAM_BUFFERS && stream->fill(stream->buffers[queued]))
+        {
+            queued++;
+        }
+
+        if(queued == 0)
+        {
+            stream->playing = false;
+            return;
+        }
+
+        alSourceQueueBuffers(source, queued, stream->buffers);
+        CHECK_OPENAL_ERROR();
+        alSourcePlay(source);
+        CHECK_OPENAL_ERROR();
+
+        stream->playing = true;
     }
 
     Sound(const char *assetPath)
@@ -339,6 +873,22 @@ public:
         next = NULL;
         needsRestart = 0;
         playCount = 0;
+        stream = NULL;
+        note = NULL;
+        voice = NULL;
+        priority = 0;
+
+        // The OpenAL defaults.
+        position[0] = position[1] = position[2] = 0.f;
+        velocity[0] = velocity[1] = velocity[2] = 0.f;
+        sourceRelative = AL_FALSE;
+        referenceDistance = 1.f;
+        maxDistance = FLT_MAX;
+        rollOff = 1.f;
+        gain = 1.f;
+        pitch = 1.f;
+        looping = false;
+
         if(assetPath != NULL)
         {
             path = assetPath;
@@ -377,18 +927,41 @@ public:
         count--;
         lmAssert(count >= 0, "Unbalanced Sound allocations! Should never delete more than we allocated!");
 
-        if(source != 0)
+        if(stream)
+        {
+            loom_mutex_lock(smStreamLock);
+            smStreams.erase(smStreams.find(this), true);
+            loom_mutex_unlock(smStreamLock);
+
+            // Release the queued buffers before deleting them.
+            alSourceStop(source);
+            alSourcei(source, AL_BUFFER, 0);
             alDeleteSources(1, &source);
+            lmDelete(NULL, stream);
+        }
+        else
+        {
+            if(voice)
+                releaseVoice(voice);
 
-        ///decrement the buffer ref counter
-        OALBufferManager::decBufferForAsset(path.c_str());
+            ///decrement the buffer ref counter
+            OALBufferManager::decBufferForAsset(path.c_str());
+        }
 
         lualoom_managedpointerreleased(this);
     }
 
+    // The setters below keep their value for the next voice, and update the
+    // current one if there is one.
+
     void setPosition(float x, float y, float z)
     {
         ALCenum err;
+        position[0] = x;
+        position[1] = y;
+        position[2] = z;
+        if(!source)
+            return;
         alSource3f(source, AL_POSITION, x, y, z);
         CHECK_OPENAL_ERROR();
     }
@@ -396,6 +969,11 @@ public:
     void setVelocity(float x, float y, float z)
     {
         ALCenum err;
+        velocity[0] = x;
+        velocity[1] = y;
+        velocity[2] = z;
+        if(!source)
+            return;
         alSource3f(source, AL_VELOCITY, x, y, z);
         CHECK_OPENAL_ERROR();
     }
@@ -403,13 +981,21 @@ public:
     void setListenerRelative(bool flag)
     {
         ALCenum err;
-        alSourcei(source, AL_SOURCE_RELATIVE, flag ? AL_FALSE : AL_TRUE);
+        sourceRelative = flag ? AL_FALSE : AL_TRUE;
+        if(!source)
+            return;
+        alSourcei(source, AL_SOURCE_RELATIVE, sourceRelative);
         CHECK_OPENAL_ERROR();
     }
 
     void setFalloffRadius(float innerRadius, float outerRadius, float rollOff = 1.0)
     {
         ALCenum err;
+        this->referenceDistance = innerRadius;
+        this->maxDistance = outerRadius;
+        this->rollOff = rollOff;
+        if(!source)
+            return;
         alSourcef(source, AL_REFERENCE_DISTANCE, innerRadius);
         CHECK_OPENAL_ERROR();
         alSourcef(source, AL_MAX_DISTANCE, outerRadius);
@@ -421,20 +1007,44 @@ public:
     void setGain(float gain)
     {
         ALCenum err;
+        this->gain = gain;
+        if(!source)
+            return;
         alSourcef(source, AL_GAIN, gain);
         CHECK_OPENAL_ERROR();
     }
 
     float getGain()
     {
-        float v = 1.f;
-        alGetSourcefv(source, AL_GAIN, &v);
-        return v;
+        return gain;
+    }
+
+    void setPriority(int priority)
+    {
+        this->priority = priority;
+    }
+
+    int getPriority()
+    {
+        return priority;
     }
 
     void setLooping(bool loop)
     {
         ALCenum err;
+
+        // Streams loop by rewinding the decoder instead.
+        if(stream)
+        {
+            loom_mutex_lock(smStreamLock);
+            stream->looping = loop;
+            loom_mutex_unlock(smStreamLock);
+            return;
+        }
+
+        looping = loop;
+        if(!source)
+            return;
         alSourcei(source, AL_LOOPING, loop ? 1 : 0);
         CHECK_OPENAL_ERROR();
     }
@@ -442,6 +1052,9 @@ public:
     void setPitch(float pitchFactor)
     {
         ALCenum err;
+        pitch = pitchFactor;
+        if(!source)
+            return;
         alSourcef(source, AL_PITCH, pitchFactor);
         CHECK_OPENAL_ERROR();
     }
@@ -449,6 +1062,62 @@ public:
     void play()
     {
         ALCenum err;
+
+        if(stream)
+        {
+            loom_mutex_lock(smStreamLock);
+
+            // Resume where paused, anything else starts over.
+            ALint state = 0;
+            alGetSourcei(source, AL_SOURCE_STATE, &state);
+            if(state == AL_PAUSED && stream->playing)
+            {
+                alSourcePlay(source);
+                CHECK_OPENAL_ERROR();
+            }
+            else
+            {
+                restartStream();
+            }
+
+            loom_mutex_unlock(smStreamLock);
+
+            playCount++;
+            return;
+        }
+
+        if(!note)
+        {
+            return;
+        }
+
+        // Decode it if it isn't resident.
+        ALuint buffer = OALBufferManager::acquireBuffer(note);
+        if(!buffer)
+        {
+            return;
+        }
+
+        // Keep the voice while it is ours, otherwise find one.
+        if(!voice)
+        {
+            voice = acquireVoice(this);
+            if(!voice)
+            {
+                lmLogDebug(gLoomSoundLogGroup, "No voice free for sound %s, not playing it", path.c_str());
+                return;
+            }
+
+            voice->owner = this;
+            source = voice->source;
+            applySource();
+            alSourcei(source, AL_BUFFER, buffer);
+            CHECK_OPENAL_ERROR();
+            note->voices++;
+        }
+
+        voice->started = ++smPlaySequence;
+
         alSourcePlay(source);
         CHECK_OPENAL_ERROR();
 
@@ -458,6 +1127,8 @@ public:
     void pause()
     {
         ALCenum err;
+        if(!source)
+            return;
         alSourcePause(source);
         CHECK_OPENAL_ERROR();
     }
@@ -465,19 +1136,64 @@ public:
     void stop()
     {
         ALCenum err;
-        alSourceStop(source);
-        CHECK_OPENAL_ERROR();
+
+        if(stream)
+        {
+            loom_mutex_lock(smStreamLock);
+            stream->playing = false;
+            alSourceStop(source);
+            CHECK_OPENAL_ERROR();
+            loom_mutex_unlock(smStreamLock);
+            return;
+        }
+
+        // Hand the voice back.
+        if(voice)
+            releaseVoice(voice);
     }
 
     void rewind()
     {
         ALCenum err;
+
+        if(stream)
+        {
+            // Play starts streams over anyway, so only a playing stream
+            // needs to restart.
+            loom_mutex_lock(smStreamLock);
+            if(stream->playing)
+            {
+                restartStream();
+            }
+            else
+            {
+                alSourceStop(source);
+            }
+            loom_mutex_unlock(smStreamLock);
+            return;
+        }
+
+        if(!source)
+            return;
         alSourceRewind(source);
         CHECK_OPENAL_ERROR();
     }
 
     bool isPlaying()
     {
+        // A stream may briefly stop while it catches up, which still counts
+        // as playing.
+        if(stream)
+        {
+            loom_mutex_lock(smStreamLock);
+            bool playing = stream->playing;
+            loom_mutex_unlock(smStreamLock);
+            return playing;
+        }
+
+        if(!source)
+            return false;
+
         ALint state = 0;
         alGetSourcei(source, AL_SOURCE_STATE, &state);
         return (state == AL_PLAYING || state == AL_PAUSED);
@@ -499,81 +1215,104 @@ extern "C" {
     {
         Sound::reset();
     }
+
+    void loomsound_tick()
+    {
+        Sound::tick();
+    }
 }
 
 Sound *Sound::smList = NULL;
 int Sound::count = 0;
+SoundVoice Sound::smVoices[LOOM_SOUND_MAX_VOICES];
+int Sound::smVoiceCount = 0;
+bool Sound::smVoicesExhausted = false;
+unsigned int Sound::smPlaySequence = 0;
+utHashTable<utHashedString, int> Sound::smMaxInstances;
+utArray<utString> Sound::smPreloads;
+NativeDelegate Sound::_OnPreloadedDelegate;
+utArray<Sound *> Sound::smStreams;
+MutexHandle Sound::smStreamLock = loom_mutex_create();
+ThreadHandle Sound::smStreamThread = NULL;
+atomic_int_t Sound::smStreamQuit = 0;
+
+static void loomsound_shutdownSounds()
+{
+    Sound::stopStreaming();
+    Sound::deleteVoices();
+}
 
 void OALBufferManager::soundUpdater(void *payload, const char *name)
 {
-    ALCenum err;
-    
-    // Update the buffer.
-    loom_asset_sound *sound = (loom_asset_sound *)loom_asset_lock(name, LATSound, 1);
-
-    if(!sound)
-    {
-        loom_asset_unlock(name);
-        return;
-    }
-
-    // Walk the sources - stop the active ones and restart.
     OALBufferNote *note = (OALBufferNote*)payload;
 
-    // Stop all the sounds using this buffer.
+    // Hand back the voices playing the old data, noting which to restart.
     Sound *walk = Sound::smList;
     while(walk)
     {
-        // Filter by buffer ID.
-        ALint buffer = 0;
-        alGetSourcei(walk->source, AL_BUFFER, &buffer);
-        if(buffer != note->buffer)
-        {
-            walk->needsRestart = 0;
-            walk = walk->next;
-            continue;
-        }
+        walk->needsRestart = 0;
 
-        ALint state = 0;
-        alGetSourcei(walk->source, AL_SOURCE_STATE, &state);
-        if(state == AL_PLAYING || state == AL_PAUSED)
-        {
-            alSourceStop(walk->source);
-            alSourcei(walk->source, AL_BUFFER, 0);
-            walk->needsRestart = 2; // Updated this scan, needs play.
-        }
-        else
+        if(walk->note == note && walk->voice)
         {
-            alSourcei(walk->source, AL_BUFFER, 0);
-            walk->needsRestart = 1; // Updated this scan, no play needed.
+            walk->needsRestart = walk->isPlaying() ? 1 : 0;
+            Sound::releaseVoice(walk->voice);
         }
 
         walk = walk->next;
     }
 
-    // Update the buffer.
-    alBufferData(note->buffer, sound->channels == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16, 
-        sound->buffer, sound->bufferSize, sound->sampleRate);
-    CHECK_OPENAL_ERROR();
+    // The buffer is decoded again from the new data when next played.
+    dropBuffer(note);
 
-    // Now restart all the sources after assigning the new buffer.
+    // Now restart the sounds which were playing.
     walk = Sound::smList;
     while(walk)
     {
-        if(walk->needsRestart == 0)
+        if(walk->needsRestart)
         {
-            walk = walk->next;
-            continue;
+            walk->play();
         }
 
-        alSourcei(walk->source, AL_BUFFER, note->buffer);
-        if(walk->needsRestart == 2)
-            alSourcePlay(walk->source);
-
         walk = walk->next;
     }
 }
 
+void OALBufferManager::trim(OALBufferNote *keep)
+{
+    if(residentBytes <= budget)
+    {
+        return;
+    }
+
+    Sound::releaseIdleVoices();
+
+    while(residentBytes > budget)
+    {
+        OALBufferNote *oldest = NULL;
+
+        utHashTableIterator<utHashTable<utHashedString, OALBufferNote *> > noteIterator(buffers);
+        while(noteIterator.hasMoreElements())
+        {
+            OALBufferNote *candidate = noteIterator.peekNextValue();
+            noteIterator.next();
+
+            if(candidate->buffer && candidate != keep && candidate->voices == 0 &&
+               (!oldest || candidate->lastUsed < oldest->lastUsed))
+            {
+                oldest = candidate;
+            }
+        }
+
+        if(!oldest)
+        {
+            break;
+        }
+
+        lmLogDebug(gLoomSoundLogGroup, "Dropping decoded sound %s, %d bytes", oldest->path.c_str(), oldest->bytes);
+        dropBuffer(oldest);
+    }
+}
+
 class Listener
 {
 public:
@@ -624,6 +1363,10 @@ static int registerLoomSoundSound(lua_State *L)
 
        .addStaticMethod("load", &Sound::load)
        .addStaticMethod("preload", &Sound::preload)
+       .addStaticMethod("loadStream", &Sound::loadStream)
+       .addStaticMethod("setMaxInstances", &Sound::setMaxInstances)
+       .addStaticMethod("setBufferBudget", &Sound::setBufferBudget)
+       .addStaticProperty("onPreloaded", &Sound::getOnPreloadedDelegate)
 
        .addMethod("setPosition", &Sound::setPosition)
        .addMethod("setVelocity", &Sound::setVelocity)
@@ -635,6 +1378,8 @@ static int registerLoomSoundSound(lua_State *L)
 
        .addMethod("setLooping", &Sound::setLooping)
        .addMethod("setPitch", &Sound::setPitch)
+       .addMethod("setPriority", &Sound::setPriority)
+       .addMethod("getPriority", &Sound::getPriority)
 
        .addMethod("play", &Sound::play)
        .addMethod("pause", &Sound::pause)
@@ -0,0 +1,142 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#include "loom/graphics/gfxAtlasPacker.h"
+
+namespace GFX
+{
+
+AtlasPacker::AtlasPacker()
+: width(0)
+, height(0)
+{
+}
+
+void AtlasPacker::reset(int _width, int _height)
+{
+    width = _width;
+    height = _height;
+
+    skyline.clear();
+
+    Segment floor;
+    floor.x = 0;
+    floor.y = 0;
+    floor.width = width;
+    skyline.push_back(floor);
+}
+
+int AtlasPacker::fit(UTsize index, int rectWidth, int rectHeight) const
+{
+    if (skyline[index].x + rectWidth > width)
+        return -1;
+
+    // The rectangle rests on the highest segment it spans
+    int y = 0;
+    int remaining = rectWidth;
+    for (UTsize i = index; remaining > 0; i++)
+    {
+        if (i >= skyline.size())
+            return -1;
+
+        if (skyline[i].y > y)
+            y = skyline[i].y;
+
+        remaining -= skyline[i].width;
+    }
+
+    if (y + rectHeight > height)
+        return -1;
+
+    return y;
+}
+
+bool AtlasPacker::insert(int rectWidth, int rectHeight, int &x, int &y)
+{
+    if (rectWidth <= 0 || rectHeight <= 0 || rectWidth > width || rectHeight > height)
+        return false;
+
+    int bestY = -1;
+    int bestX = 0;
+    UTsize bestIndex = 0;
+
+    for (UTsize i = 0; i < skyline.size(); i++)
+    {
+        int fitY = fit(i, rectWidth, rectHeight);
+        if (fitY != -1 && (bestY == -1 || fitY < bestY))
+        {
+            bestY = fitY;
+            bestX = skyline[i].x;
+            bestIndex = i;
+        }
+    }
+
+    if (bestY == -1)
+        return false;
+
+    // Raise the skyline under the rectangle into a single segment
+    Segment top;
+    top.x = bestX;
+    top.y = bestY + rectHeight;
+    top.width = rectWidth;
+
+    int right = bestX + rectWidth;
+    while (bestIndex < skyline.size() && skyline[bestIndex].x < right)
+    {
+        Segment &segment = skyline[bestIndex];
+        int segmentRight = segment.x + segment.width;
+        if (segmentRight <= right)
+        {
+            skyline.erase(bestIndex, true);
+        }
+        else
+        {
+            segment.width = segmentRight - right;
+            segment.x = right;
+            break;
+        }
+    }
+
+    skyline.push_back(top);
+    for (UTsize i = skyline.size() - 1; i > bestIndex; i--)
+        skyline[i] = skyline[i - 1];
+    skyline[bestIndex] = top;
+
+    // Merge with neighbours at the same height
+    for (UTsize i = 0; i + 1 < skyline.size();)
+    {
+        if (skyline[i].y == skyline[i + 1].y)
+        {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(i + 1, true);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    x = bestX;
+    y = bestY;
+    return true;
+}
+
+}
@@ -0,0 +1,68 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#pragma once
+
+#include "loom/common/utils/utTypes.h"
+
+namespace GFX
+{
+
+/*
+ * Skyline rectangle packer used to place small textures into shared
+ * atlas pages. Rectangles are placed at the lowest position along the
+ * skyline that fits them, preferring the leftmost one on ties. Space
+ * is only reclaimed when the whole packer is reset.
+ */
+class AtlasPacker
+{
+public:
+
+    AtlasPacker();
+
+    // Clears the packer to an empty area of the given size
+    void reset(int width, int height);
+
+    // Finds room for a width x height rectangle, returns false if it
+    // doesn't fit anywhere
+    bool insert(int width, int height, int &x, int &y);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+private:
+
+    // A horizontal span of the skyline at height y
+    struct Segment
+    {
+        int x, y, width;
+    };
+
+    // Returns the y a rectangle placed at the start of the segment
+    // would end up at, or -1 if it doesn't fit there
+    int fit(UTsize index, int rectWidth, int rectHeight) const;
+
+    utArray<Segment> skyline;
+    int width;
+    int height;
+};
+
+}
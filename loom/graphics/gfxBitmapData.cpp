@@ -26,14 +26,137 @@
 #include "loom/common/assets/assetsImage.h"
 #include "loom/common/core/log.h"
 #include "loom/common/core/string.h"
+#include "loom/common/utils/utEndian.h"
 
 #include "stb_image_write.h"
 #include <math.h>
 #include <string.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GFX_BITMAPDATA_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define GFX_BITMAPDATA_NEON 1
+#include <arm_neon.h>
+#endif
+
 
 const int DATA_BPP = 4;
 
+// Pixels are RGBA in memory, so alpha is the high byte of a little
+// endian word and the low byte of a big endian one
+#if UT_ENDIAN == UT_ENDIAN_BIG
+static const uint32_t ALPHA_MASK = 0x000000FF;
+#else
+static const uint32_t ALPHA_MASK = 0xFF000000;
+#endif
+
+// Returns the number of pixels that differ between a and b
+static size_t countDifferentPixels(const uint32_t* a, const uint32_t* b, size_t count)
+{
+    size_t i = 0;
+    size_t equal = 0;
+
+#if GFX_BITMAPDATA_SSE2
+    // Equal lanes compare to -1, subtracting counts them per lane. Lanes
+    // are flushed well before they could overflow.
+    while (i + 4 <= count)
+    {
+        size_t end = count - i > 0x40000000 ? i + 0x40000000 : count;
+        __m128i acc = _mm_setzero_si128();
+        for (; i + 4 <= end; i += 4)
+        {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+            acc = _mm_sub_epi32(acc, _mm_cmpeq_epi32(va, vb));
+        }
+        uint32_t lanes[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+        equal += (size_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+#elif GFX_BITMAPDATA_NEON
+    while (i + 4 <= count)
+    {
+        size_t end = count - i > 0x40000000 ? i + 0x40000000 : count;
+        uint32x4_t acc = vdupq_n_u32(0);
+        for (; i + 4 <= end; i += 4)
+            acc = vsubq_u32(acc, vceqq_u32(vld1q_u32(a + i), vld1q_u32(b + i)));
+        equal += (size_t)vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        if (a[i] == b[i])
+            equal++;
+    }
+
+    return count - equal;
+}
+
+// Returns the sum of absolute differences of all the bytes of a and b
+static uint64_t sumAbsDifference(const GFX::channel_t* a, const GFX::channel_t* b, size_t bytes)
+{
+    size_t i = 0;
+    uint64_t sum = 0;
+
+#if GFX_BITMAPDATA_SSE2
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 16 <= bytes; i += 16)
+    {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+    }
+    uint64_t halves[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(halves), acc);
+    sum = halves[0] + halves[1];
+#elif GFX_BITMAPDATA_NEON
+    uint64x2_t acc = vdupq_n_u64(0);
+    for (; i + 16 <= bytes; i += 16)
+    {
+        uint8x16_t d = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+        acc = vpadalq_u32(acc, vpaddlq_u16(vpaddlq_u8(d)));
+    }
+    sum = vgetq_lane_u64(acc, 0) + vgetq_lane_u64(acc, 1);
+#endif
+
+    for (; i < bytes; i++)
+        sum += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+
+    return sum;
+}
+
+// Writes the absolute difference of every channel of a and b to out,
+// with alpha set to opaque
+static void absDifference(const GFX::channel_t* a, const GFX::channel_t* b, GFX::channel_t* out, size_t pixels)
+{
+    size_t i = 0;
+    size_t bytes = pixels * DATA_BPP;
+
+#if GFX_BITMAPDATA_SSE2
+    const __m128i alpha = _mm_set1_epi32((int)ALPHA_MASK);
+    for (; i + 16 <= bytes; i += 16)
+    {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_or_si128(d, alpha));
+    }
+#elif GFX_BITMAPDATA_NEON
+    const uint8x16_t alpha = vreinterpretq_u8_u32(vdupq_n_u32(ALPHA_MASK));
+    for (; i + 16 <= bytes; i += 16)
+        vst1q_u8(out + i, vorrq_u8(vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i)), alpha));
+#endif
+
+    for (; i < bytes; i += DATA_BPP)
+    {
+        for (int c = 0; c < DATA_BPP - 1; c++)
+            out[i + c] = a[i + c] > b[i + c] ? a[i + c] - b[i + c] : b[i + c] - a[i + c];
+        out[i + DATA_BPP - 1] = 0xFF;
+    }
+}
+
 namespace GFX
 {
     BitmapData::BitmapData(unsigned int  width, unsigned int  height)
@@ -123,6 +246,16 @@ namespace GFX
     TextureInfo* BitmapData::createTextureInfo() const
     {
         TextureInfo* info = Texture::getAvailableTextureInfo(NULL);
+
+        // Bitmap data is kept straight, textures want it premultiplied
+        if (Graphics::getPremultipliedAlpha()) {
+            utByteArray tmp;
+            tmp.resize(w * h * DATA_BPP);
+            memcpy(tmp.getDataPtr(), data, w * h * DATA_BPP);
+            loom_asset_imagePremultiply(tmp.getDataPtr(), w * h);
+            return Texture::load((uint8_t*)tmp.getDataPtr(), w, h, info->id);
+        }
+
         return Texture::load(data, w, h, info->id);
     }
 
@@ -137,24 +270,31 @@ namespace GFX
             return NULL;
         }
 
-        BitmapData* result = lmNew(NULL) BitmapData(w, h);
-
-        if (result == NULL) {
-            lmLogError(gGFXLogGroup, "Unable to allocate memory for screenshot pixel data buffer");
-            return NULL;
-        }
-
         GFX::GL_Context* ctx = GFX::Graphics::context();
 
         utByteArray tmp;
-        tmp.resize(result->w * result->h * DATA_BPP);
+        tmp.resize(w * h * DATA_BPP);
 
         ctx->glPixelStorei(GL_PACK_ALIGNMENT, 1);
-        ctx->glReadPixels(0, 0, result->w, result->h, GL_RGBA, GL_UNSIGNED_BYTE, tmp.getDataPtr());
+        ctx->glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, tmp.getDataPtr());
+
+        return fromFramebufferRows(tmp.getDataPtr(), w, h);
+    }
 
+    BitmapData* BitmapData::fromFramebufferRows(const void* rows, unsigned int w, unsigned int h)
+    {
+        BitmapData* result = lmNew(NULL) BitmapData(w, h);
+
+        if (result == NULL || result->data == NULL) {
+            lmLogError(gGFXLogGroup, "Unable to allocate memory for screenshot pixel data buffer");
+            lmDelete(NULL, result);
+            return NULL;
+        }
+
+        const channel_t* src = static_cast<const channel_t*>(rows);
         for (int i = result->h - 1; i >= 0; i--)
         {
-            memcpy(result->data + (result->h - 1 - i) * result->w * DATA_BPP, (channel_t*)tmp.getDataPtr() + i * result->w * DATA_BPP, result->w * DATA_BPP);
+            memcpy(result->data + (result->h - 1 - i) * result->w * DATA_BPP, src + i * result->w * DATA_BPP, result->w * DATA_BPP);
         }
 
         return result;
@@ -168,6 +308,11 @@ namespace GFX
         if (img == NULL)
             return NULL;
 
+        if (img->compressedFormat != IMAGE_COMPRESSED_NONE) {
+            lmLogError(gGFXLogGroup, "Unable to create BitmapData from compressed image %s", name);
+            return NULL;
+        }
+
         BitmapData* result = lmNew(NULL) BitmapData(
             (size_t)img->width,
             (size_t)img->height
@@ -180,25 +325,38 @@ namespace GFX
 
         memcpy(result->data, img->bits, img->width * img->height * DATA_BPP);
 
+        if (img->premultiplied)
+            loom_asset_imageUnpremultiply(result->data, img->width * img->height);
+
         return result;
     }
 
     lmscalar BitmapData::compare(const BitmapData* a, const BitmapData* b)
     {
-        lmscalar result = 0;
         if (a->w != b->w || a->h != b->h)
             return (lmscalar)1.0;
 
-        rgba_t* pixelptr_a = reinterpret_cast<rgba_t*>(a->data);
-        rgba_t* pixelptr_b = reinterpret_cast<rgba_t*>(b->data);
+        size_t pixels = (size_t)a->w * a->h;
+        if (pixels == 0)
+            return 0;
 
-        for (size_t i = 0; i < a->w * a->h; i++)
-        {
-            if (pixelptr_a[i] != pixelptr_b[i])
-                result += 1;
-        }
+        size_t different = countDifferentPixels(reinterpret_cast<const uint32_t*>(a->data), reinterpret_cast<const uint32_t*>(b->data), pixels);
+
+        return (lmscalar)different / pixels;
+    }
+
+    lmscalar BitmapData::difference(const BitmapData* a, const BitmapData* b)
+    {
+        if (a->w != b->w || a->h != b->h)
+            return (lmscalar)1.0;
+
+        size_t bytes = (size_t)a->w * a->h * DATA_BPP;
+        if (bytes == 0)
+            return 0;
 
-        return result / (a->w * a->h);
+        uint64_t sum = sumAbsDifference(a->data, b->data, bytes);
+
+        return (lmscalar)((double)sum / ((double)bytes * 255.0));
     }
 
     BitmapData* BitmapData::diff(const BitmapData* a, const BitmapData* b)
@@ -216,18 +374,7 @@ namespace GFX
             return NULL;
         }
 
-        rgba_t* pixelptr_a = reinterpret_cast<rgba_t*>(a->data);
-        rgba_t* pixelptr_b = reinterpret_cast<rgba_t*>(b->data);
-        rgba_t* resultptr = reinterpret_cast<rgba_t*>(result->data);
-
-        for (size_t i = 0; i < a->w * a->h; i++)
-        {
-            Color ap(convertHostToBEndian(pixelptr_a[i]));
-            Color bp(convertHostToBEndian(pixelptr_b[i]));
-            Color rp(fabsf(ap.r - bp.r), fabsf(ap.g - bp.g), fabsf(ap.b - bp.b), 1.0f);
-            rgba_t a = rp.getHex();
-            resultptr[i] = convertBEndianToHost(a);
-        }
+        absDifference(a->data, b->data, result->data, (size_t)a->w * a->h);
 
         return result;
     }
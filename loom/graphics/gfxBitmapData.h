@@ -62,6 +62,8 @@ public:
 
     // Loads data from the current framebuffer
     static const BitmapData* fromFramebuffer();
+    // Loads data from RGBA rows as read by glReadPixels, bottom row first
+    static BitmapData* fromFramebufferRows(const void* rows, unsigned int width, unsigned int height);
     // Loads data from an asset
     static const BitmapData* fromAsset(const char* name);
 
@@ -69,6 +71,10 @@ public:
     // within a given tolerance.
     static lmscalar compare(const BitmapData* a, const BitmapData* b);
 
+    // Returns the mean absolute difference of all channels on interval (0,1), 0 for
+    // identical images. Unlike compare, slight differences count for little.
+    static lmscalar difference(const BitmapData* a, const BitmapData* b);
+
     // Generates a new BitmapData where each pixel has been substracted between a and b
     static BitmapData* diff(const BitmapData* a, const BitmapData* b);
 };
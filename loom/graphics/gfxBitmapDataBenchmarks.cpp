@@ -0,0 +1,165 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <string.h>
+
+#include "loom/common/core/allocator.h"
+#include "loom/common/core/benchmark.h"
+#include "loom/graphics/gfxBitmapData.h"
+
+using namespace GFX;
+
+// A full HD screenshot, as compared by the rendering tests
+#define BITMAPBENCH_WIDTH     1920
+#define BITMAPBENCH_HEIGHT    1080
+
+static BitmapData *gBitmapBenchA = NULL;
+static BitmapData *gBitmapBenchB = NULL;
+
+// Two frames differing in a moving band, as consecutive frames of a scene might
+static void bitmapBench_create()
+{
+    size_t bytes = (size_t)BITMAPBENCH_WIDTH * BITMAPBENCH_HEIGHT * 4;
+    unsigned char *pixels = (unsigned char *)lmAlloc(NULL, bytes);
+
+    for (size_t i = 0; i < bytes; i++)
+    {
+        pixels[i] = (unsigned char)(i * 7 + (i >> 11));
+    }
+
+    gBitmapBenchA = BitmapData::fromFramebufferRows(pixels, BITMAPBENCH_WIDTH, BITMAPBENCH_HEIGHT);
+
+    for (size_t i = bytes / 3; i < bytes / 2; i++)
+    {
+        pixels[i] += (unsigned char)(i & 15);
+    }
+
+    gBitmapBenchB = BitmapData::fromFramebufferRows(pixels, BITMAPBENCH_WIDTH, BITMAPBENCH_HEIGHT);
+
+    lmFree(NULL, pixels);
+}
+
+static void bitmapBench_dispose()
+{
+    lmDelete(NULL, gBitmapBenchA);
+    lmDelete(NULL, gBitmapBenchB);
+    gBitmapBenchA = NULL;
+    gBitmapBenchB = NULL;
+}
+
+BENCHMARK_FIXTURE(bitmapData)
+{
+    bitmapBench_create();
+
+    BENCHMARK_FIXTURE_ENTRY(bitmapData_compare1080p);
+    BENCHMARK_FIXTURE_ENTRY(bitmapData_compare1080pScalar);
+    BENCHMARK_FIXTURE_ENTRY(bitmapData_difference1080p);
+    BENCHMARK_FIXTURE_ENTRY(bitmapData_difference1080pScalar);
+    BENCHMARK_FIXTURE_ENTRY(bitmapData_diff1080p);
+    BENCHMARK_FIXTURE_ENTRY(bitmapData_diff1080pScalar);
+
+    bitmapBench_dispose();
+}
+
+// The Scalar variants are the per pixel loops the vectorized paths replaced,
+// kept here to show the speedup on the machine running the benchmarks
+
+BENCHMARK(bitmapData_compare1080p)
+{
+    for (int i = 0; i < iterations; i++)
+    {
+        lmscalar result = BitmapData::compare(gBitmapBenchA, gBitmapBenchB);
+        loom_benchmark_doNotOptimize(&result);
+    }
+}
+
+BENCHMARK(bitmapData_compare1080pScalar)
+{
+    const unsigned int *a = (const unsigned int *)gBitmapBenchA->getData();
+    const unsigned int *b = (const unsigned int *)gBitmapBenchB->getData();
+
+    for (int i = 0; i < iterations; i++)
+    {
+        size_t different = 0;
+        for (size_t p = 0; p < (size_t)BITMAPBENCH_WIDTH * BITMAPBENCH_HEIGHT; p++)
+        {
+            if (a[p] != b[p]) different++;
+        }
+        loom_benchmark_doNotOptimize(&different);
+    }
+}
+
+BENCHMARK(bitmapData_difference1080p)
+{
+    for (int i = 0; i < iterations; i++)
+    {
+        lmscalar result = BitmapData::difference(gBitmapBenchA, gBitmapBenchB);
+        loom_benchmark_doNotOptimize(&result);
+    }
+}
+
+BENCHMARK(bitmapData_difference1080pScalar)
+{
+    const unsigned char *a = gBitmapBenchA->getData();
+    const unsigned char *b = gBitmapBenchB->getData();
+
+    for (int i = 0; i < iterations; i++)
+    {
+        unsigned long long sum = 0;
+        for (size_t c = 0; c < (size_t)BITMAPBENCH_WIDTH * BITMAPBENCH_HEIGHT * 4; c++)
+        {
+            sum += a[c] > b[c] ? a[c] - b[c] : b[c] - a[c];
+        }
+        loom_benchmark_doNotOptimize(&sum);
+    }
+}
+
+BENCHMARK(bitmapData_diff1080p)
+{
+    for (int i = 0; i < iterations; i++)
+    {
+        BitmapData *result = BitmapData::diff(gBitmapBenchA, gBitmapBenchB);
+        loom_benchmark_doNotOptimize(result->getData());
+        lmDelete(NULL, result);
+    }
+}
+
+BENCHMARK(bitmapData_diff1080pScalar)
+{
+    const unsigned char *a = gBitmapBenchA->getData();
+    const unsigned char *b = gBitmapBenchB->getData();
+
+    size_t bytes = (size_t)BITMAPBENCH_WIDTH * BITMAPBENCH_HEIGHT * 4;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        unsigned char *out = (unsigned char *)lmAlloc(NULL, bytes);
+        for (size_t c = 0; c < bytes; c += 4)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                out[c + k] = a[c + k] > b[c + k] ? a[c + k] - b[c + k] : b[c + k] - a[c + k];
+            }
+            out[c + 3] = 0xFF;
+        }
+        loom_benchmark_doNotOptimize(out);
+        lmFree(NULL, out);
+    }
+}
@@ -0,0 +1,203 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <string.h>
+
+#include "loom/common/core/allocator.h"
+#include "loom/graphics/gfxBitmapData.h"
+#include "seatest.h"
+
+using namespace GFX;
+
+SEATEST_FIXTURE(bitmapData)
+{
+    SEATEST_FIXTURE_ENTRY(bitmapData_compare);
+    SEATEST_FIXTURE_ENTRY(bitmapData_difference);
+    SEATEST_FIXTURE_ENTRY(bitmapData_diff);
+    SEATEST_FIXTURE_ENTRY(bitmapData_mismatched);
+}
+
+// Odd sizes leave every possible tail after the 4 pixel / 16 byte vector steps
+static const unsigned int sizes[][2] = {
+    { 1, 1 }, { 3, 1 }, { 5, 1 }, { 2, 3 }, { 7, 7 }, { 17, 3 }, { 33, 5 }, { 64, 64 }, { 1001, 3 }
+};
+
+static const int numSizes = sizeof(sizes) / sizeof(sizes[0]);
+
+static unsigned int bitmapTestSeed;
+
+static unsigned int bitmapTestRandom()
+{
+    bitmapTestSeed = bitmapTestSeed * 1103515245 + 12345;
+    return bitmapTestSeed >> 8;
+}
+
+// Creates a random image and one that differs from it in about a third of
+// the pixels, in any channel including alpha and by up to the full range
+static void createPair(unsigned int w, unsigned int h, BitmapData **a, BitmapData **b)
+{
+    size_t bytes = (size_t)w * h * 4;
+    unsigned char *pixels = (unsigned char *)lmAlloc(NULL, bytes);
+    unsigned char *changed = (unsigned char *)lmAlloc(NULL, bytes);
+
+    for (size_t i = 0; i < bytes; i++)
+    {
+        pixels[i] = (unsigned char)bitmapTestRandom();
+    }
+
+    memcpy(changed, pixels, bytes);
+
+    for (size_t p = 0; p < bytes / 4; p++)
+    {
+        if (bitmapTestRandom() % 3 != 0)
+        {
+            continue;
+        }
+
+        int channel = bitmapTestRandom() % 4;
+        switch (bitmapTestRandom() % 3)
+        {
+            case 0: changed[p * 4 + channel] ^= 1; break;
+            case 1: changed[p * 4 + channel] = pixels[p * 4 + channel] < 128 ? 255 : 0; break;
+            default: changed[p * 4 + channel] = (unsigned char)bitmapTestRandom(); break;
+        }
+    }
+
+    *a = BitmapData::fromFramebufferRows(pixels, w, h);
+    *b = BitmapData::fromFramebufferRows(changed, w, h);
+
+    lmFree(NULL, pixels);
+    lmFree(NULL, changed);
+}
+
+static unsigned char absDiff(unsigned char a, unsigned char b)
+{
+    return a > b ? a - b : b - a;
+}
+
+// The results of the vectorized paths are checked against plain loops over the pixels
+SEATEST_TEST(bitmapData_compare)
+{
+    bitmapTestSeed = 1;
+
+    for (int s = 0; s < numSizes; s++)
+    {
+        BitmapData *a, *b;
+        createPair(sizes[s][0], sizes[s][1], &a, &b);
+
+        size_t pixels = (size_t)sizes[s][0] * sizes[s][1];
+        const unsigned char *da = a->getData();
+        const unsigned char *db = b->getData();
+
+        size_t different = 0;
+        for (size_t p = 0; p < pixels; p++)
+        {
+            if (memcmp(da + p * 4, db + p * 4, 4)) different++;
+        }
+
+        assert_double_equal((double)different / pixels, BitmapData::compare(a, b), 1e-6);
+        assert_double_equal(0, BitmapData::compare(a, a), 1e-6);
+
+        lmDelete(NULL, a);
+        lmDelete(NULL, b);
+    }
+}
+
+SEATEST_TEST(bitmapData_difference)
+{
+    bitmapTestSeed = 2;
+
+    for (int s = 0; s < numSizes; s++)
+    {
+        BitmapData *a, *b;
+        createPair(sizes[s][0], sizes[s][1], &a, &b);
+
+        size_t bytes = (size_t)sizes[s][0] * sizes[s][1] * 4;
+        const unsigned char *da = a->getData();
+        const unsigned char *db = b->getData();
+
+        unsigned long long sum = 0;
+        for (size_t i = 0; i < bytes; i++)
+        {
+            sum += absDiff(da[i], db[i]);
+        }
+
+        assert_double_equal((double)sum / (bytes * 255.0), BitmapData::difference(a, b), 1e-6);
+        assert_double_equal(0, BitmapData::difference(b, b), 1e-6);
+
+        lmDelete(NULL, a);
+        lmDelete(NULL, b);
+    }
+}
+
+SEATEST_TEST(bitmapData_diff)
+{
+    bitmapTestSeed = 3;
+
+    for (int s = 0; s < numSizes; s++)
+    {
+        BitmapData *a, *b;
+        createPair(sizes[s][0], sizes[s][1], &a, &b);
+
+        BitmapData *result = BitmapData::diff(a, b);
+        assert_true(result != NULL);
+
+        size_t pixels = (size_t)sizes[s][0] * sizes[s][1];
+        const unsigned char *da = a->getData();
+        const unsigned char *db = b->getData();
+        const unsigned char *dr = result->getData();
+
+        // Color channels hold the difference, alpha is opaque
+        bool same = true;
+        for (size_t p = 0; p < pixels; p++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                if (dr[p * 4 + c] != absDiff(da[p * 4 + c], db[p * 4 + c])) same = false;
+            }
+
+            if (dr[p * 4 + 3] != 0xFF) same = false;
+        }
+
+        assert_true(same);
+
+        lmDelete(NULL, result);
+        lmDelete(NULL, a);
+        lmDelete(NULL, b);
+    }
+}
+
+SEATEST_TEST(bitmapData_mismatched)
+{
+    bitmapTestSeed = 4;
+
+    BitmapData *a, *b, *c, *d;
+    createPair(4, 2, &a, &b);
+    createPair(2, 4, &c, &d);
+
+    assert_double_equal(1, BitmapData::compare(a, c), 1e-6);
+    assert_double_equal(1, BitmapData::difference(a, c), 1e-6);
+    assert_true(BitmapData::diff(a, c) == NULL);
+
+    lmDelete(NULL, a);
+    lmDelete(NULL, b);
+    lmDelete(NULL, c);
+    lmDelete(NULL, d);
+}
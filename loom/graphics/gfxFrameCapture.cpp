@@ -0,0 +1,745 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <stdio.h>
+
+#include "loom/common/core/log.h"
+#include "loom/common/core/allocator.h"
+#include "loom/common/utils/fourcc.h"
+#include "loom/graphics/gfxFrameCapture.h"
+#include "loom/graphics/gfxGraphics.h"
+
+#include "nanovg.h"
+
+namespace GFX
+{
+extern NVGcontext *nvg;
+
+lmDefineLogGroup(gGFXFrameCaptureLogGroup, "gfx.capture", 1, LoomLogInfo);
+
+#define FRAMECAPTURE_MAGIC    LOOM_FOURCC('L', 'M', 'F', 'C')
+
+bool FrameCapture::sCapturing = false;
+utString FrameCapture::sRequestPath;
+utByteArray FrameCapture::sCommands;
+utHashTable<utIntHashKey, bool> FrameCapture::sTextures;
+VertexPosColorTex *FrameCapture::sPendingVertices = NULL;
+uint32_t FrameCapture::sPendingVertexCount = 0;
+unsigned int FrameCapture::sPendingOffset = 0;
+
+// The vector renderer callbacks replaced while capturing
+static void (*sRenderViewport)(void* uptr, int width, int height) = NULL;
+static void (*sRenderFlush)(void* uptr) = NULL;
+static void (*sRenderFill)(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, const float* bounds, const NVGpath* paths, int npaths) = NULL;
+static void (*sRenderStroke)(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, float strokeWidth, const NVGpath* paths, int npaths) = NULL;
+static void (*sRenderTriangles)(void* uptr, NVGpaint* paint, NVGscissor* scissor, const NVGvertex* verts, int nverts, float sdf) = NULL;
+
+// Only what is drawn to the screen is recorded
+static inline bool recording()
+{
+    return FrameCapture::isCapturing() && !Graphics::isRenderTargetPushed();
+}
+
+static void writePaint(utByteArray &out, const NVGpaint *paint)
+{
+    out.writeFloats(paint->xform, 6);
+    out.writeFloats(paint->extent, 2);
+    out.writeFloat(paint->radius);
+    out.writeFloat(paint->feather);
+    out.writeFloats(paint->innerColor.rgba, 4);
+    out.writeFloats(paint->outerColor.rgba, 4);
+}
+
+static void readPaint(utByteArray &in, NVGpaint *paint)
+{
+    in.readFloats(paint->xform, 6);
+    in.readFloats(paint->extent, 2);
+    paint->radius = in.readFloat();
+    paint->feather = in.readFloat();
+    in.readFloats(paint->innerColor.rgba, 4);
+    in.readFloats(paint->outerColor.rgba, 4);
+    paint->image = 0;
+}
+
+static void writeScissor(utByteArray &out, const NVGscissor *scissor)
+{
+    out.writeFloats(scissor->xform, 6);
+    out.writeFloats(scissor->extent, 2);
+}
+
+static void readScissor(utByteArray &in, NVGscissor *scissor)
+{
+    in.readFloats(scissor->xform, 6);
+    in.readFloats(scissor->extent, 2);
+}
+
+static void writePaths(utByteArray &out, const NVGpath *paths, int npaths)
+{
+    out.writeInt(npaths);
+    for (int i = 0; i < npaths; i++)
+    {
+        const NVGpath &path = paths[i];
+        out.writeInt(path.first);
+        out.writeInt(path.count);
+        out.writeInt(path.closed);
+        out.writeInt(path.nbevel);
+        out.writeInt(path.winding);
+        out.writeInt(path.convex);
+        out.writeInt(path.nfill);
+        out.writeInt(path.nstroke);
+    }
+
+    for (int i = 0; i < npaths; i++)
+    {
+        if (paths[i].nfill > 0)
+            out.writeFloats(&paths[i].fill->x, paths[i].nfill * 4);
+        if (paths[i].nstroke > 0)
+            out.writeFloats(&paths[i].stroke->x, paths[i].nstroke * 4);
+    }
+}
+
+// Scratch space the paths of a replayed fill or stroke are read into
+static utArray<NVGpath> sReplayPaths;
+static utArray<NVGvertex> sReplayVertices;
+
+static int readPaths(utByteArray &in)
+{
+    int npaths = in.readInt();
+    sReplayPaths.resize(npaths);
+
+    int vertexCount = 0;
+    for (int i = 0; i < npaths; i++)
+    {
+        NVGpath &path = sReplayPaths[i];
+        path.first = in.readInt();
+        path.count = in.readInt();
+        path.closed = (unsigned char)in.readInt();
+        path.nbevel = in.readInt();
+        path.winding = in.readInt();
+        path.convex = in.readInt();
+        path.nfill = in.readInt();
+        path.nstroke = in.readInt();
+        vertexCount += path.nfill + path.nstroke;
+    }
+
+    sReplayVertices.resize(vertexCount);
+    if (vertexCount > 0)
+        in.readFloats(&sReplayVertices[0].x, vertexCount * 4);
+
+    NVGvertex *vertices = sReplayVertices.ptr();
+    for (int i = 0; i < npaths; i++)
+    {
+        NVGpath &path = sReplayPaths[i];
+        path.fill = vertices;
+        vertices += path.nfill;
+        path.stroke = vertices;
+        vertices += path.nstroke;
+    }
+
+    return npaths;
+}
+
+// The vector renderer callbacks installed while capturing, they record
+// the call and pass it on to the renderer
+struct FrameCaptureHooks
+{
+    static void captureViewport(void* uptr, int width, int height)
+    {
+        if (recording())
+        {
+            FrameCapture::sCommands.writeInt(FrameCapture::COMMAND_VECTOR_VIEWPORT);
+            FrameCapture::sCommands.writeInt(width);
+            FrameCapture::sCommands.writeInt(height);
+        }
+
+        sRenderViewport(uptr, width, height);
+    }
+
+    static void captureFlush(void* uptr)
+    {
+        if (recording())
+            FrameCapture::sCommands.writeInt(FrameCapture::COMMAND_VECTOR_FLUSH);
+
+        sRenderFlush(uptr);
+    }
+
+    static void captureFill(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, const float* bounds, const NVGpath* paths, int npaths)
+    {
+        if (recording())
+        {
+            utByteArray &out = FrameCapture::sCommands;
+            out.writeInt(FrameCapture::COMMAND_VECTOR_FILL);
+            writePaint(out, paint);
+            writeScissor(out, scissor);
+            out.writeFloat(fringe);
+            out.writeFloats(bounds, 4);
+            writePaths(out, paths, npaths);
+        }
+
+        sRenderFill(uptr, paint, scissor, fringe, bounds, paths, npaths);
+    }
+
+    static void captureStroke(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, float strokeWidth, const NVGpath* paths, int npaths)
+    {
+        if (recording())
+        {
+            utByteArray &out = FrameCapture::sCommands;
+            out.writeInt(FrameCapture::COMMAND_VECTOR_STROKE);
+            writePaint(out, paint);
+            writeScissor(out, scissor);
+            out.writeFloat(fringe);
+            out.writeFloat(strokeWidth);
+            writePaths(out, paths, npaths);
+        }
+
+        sRenderStroke(uptr, paint, scissor, fringe, strokeWidth, paths, npaths);
+    }
+
+    static void captureTriangles(void* uptr, NVGpaint* paint, NVGscissor* scissor, const NVGvertex* verts, int nverts, float sdf)
+    {
+        if (recording())
+        {
+            utByteArray &out = FrameCapture::sCommands;
+            out.writeInt(FrameCapture::COMMAND_VECTOR_TRIANGLES);
+            writePaint(out, paint);
+            writeScissor(out, scissor);
+            out.writeFloat(sdf);
+            out.writeInt(nverts);
+            if (nverts > 0)
+                out.writeFloats(&verts->x, nverts * 4);
+        }
+
+        sRenderTriangles(uptr, paint, scissor, verts, nverts, sdf);
+    }
+};
+
+void FrameCapture::hookVectorRenderer(bool enabled)
+{
+    if (!nvg)
+        return;
+
+    NVGparams *params = nvgInternalParams(nvg);
+
+    if (enabled)
+    {
+        sRenderViewport = params->renderViewport;
+        sRenderFlush = params->renderFlush;
+        sRenderFill = params->renderFill;
+        sRenderStroke = params->renderStroke;
+        sRenderTriangles = params->renderTriangles;
+
+        params->renderViewport = FrameCaptureHooks::captureViewport;
+        params->renderFlush = FrameCaptureHooks::captureFlush;
+        params->renderFill = FrameCaptureHooks::captureFill;
+        params->renderStroke = FrameCaptureHooks::captureStroke;
+        params->renderTriangles = FrameCaptureHooks::captureTriangles;
+    }
+    else if (params->renderFill == FrameCaptureHooks::captureFill)
+    {
+        params->renderViewport = sRenderViewport;
+        params->renderFlush = sRenderFlush;
+        params->renderFill = sRenderFill;
+        params->renderStroke = sRenderStroke;
+        params->renderTriangles = sRenderTriangles;
+    }
+}
+
+void FrameCapture::request(const char *path)
+{
+    sRequestPath = path ? path : "";
+}
+
+void FrameCapture::beginFrame()
+{
+    if (sCapturing || sRequestPath.size() == 0)
+        return;
+
+    sCommands.clear();
+    sCommands.writeUnsignedInt(FRAMECAPTURE_MAGIC);
+    sCommands.writeInt(FRAMECAPTURE_VERSION);
+    sCommands.writeInt(Graphics::getWidth());
+    sCommands.writeInt(Graphics::getHeight());
+
+    sTextures.clear();
+    sPendingVertices = NULL;
+    sPendingVertexCount = 0;
+
+    sCapturing = true;
+    hookVectorRenderer(true);
+}
+
+void FrameCapture::endFrame()
+{
+    if (!sCapturing)
+        return;
+
+    copyPendingVertices();
+    hookVectorRenderer(false);
+    sCapturing = false;
+
+    sCommands.writeInt(COMMAND_END);
+
+    FILE *file = fopen(sRequestPath.c_str(), "wb");
+    if (!file || fwrite(sCommands.getDataPtr(), 1, sCommands.getSize(), file) != sCommands.getSize())
+    {
+        lmLogError(gGFXFrameCaptureLogGroup, "Unable to write the frame capture to %s", sRequestPath.c_str());
+    }
+    else
+    {
+        lmLogInfo(gGFXFrameCaptureLogGroup, "Captured the frame to %s, %d bytes", sRequestPath.c_str(), (int)sCommands.getSize());
+    }
+
+    if (file)
+        fclose(file);
+
+    sRequestPath = "";
+    sCommands.clear();
+    sTextures.clear();
+}
+
+void FrameCapture::copyPendingVertices()
+{
+    if (!sPendingVertices)
+        return;
+
+    memcpy((uint8_t *)sCommands.getDataPtr() + sPendingOffset, sPendingVertices, sPendingVertexCount * sizeof(VertexPosColorTex));
+
+    sPendingVertices = NULL;
+    sPendingVertexCount = 0;
+}
+
+void FrameCapture::defineTexture(TextureInfo &tinfo)
+{
+    if (sTextures.get(tinfo.id))
+        return;
+
+    sTextures.insert(tinfo.id, true);
+
+    sCommands.writeInt(COMMAND_TEXTURE);
+    sCommands.writeInt(tinfo.id);
+    sCommands.writeInt(tinfo.width);
+    sCommands.writeInt(tinfo.height);
+    sCommands.writeInt(tinfo.smoothing);
+    sCommands.writeInt(tinfo.wrapU);
+    sCommands.writeInt(tinfo.wrapV);
+}
+
+void FrameCapture::recordQuads(VertexPosColorTex *vertices, uint32_t vertexCount, TextureID texture, bool blendEnabled, uint32_t srcBlend, uint32_t dstBlend, ShaderProgram *shader)
+{
+    copyPendingVertices();
+
+    if (!recording())
+        return;
+
+    TextureInfo *tinfo = Texture::getTextureInfo(texture);
+    if (!tinfo)
+        return;
+
+    defineTexture(*tinfo);
+
+    sCommands.writeInt(COMMAND_QUADS);
+    sCommands.writeInt(texture);
+    sCommands.writeInt(blendEnabled ? 1 : 0);
+    sCommands.writeUnsignedInt(srcBlend);
+    sCommands.writeUnsignedInt(dstBlend);
+    sCommands.writeInt(shader == ShaderProgram::getTintlessDefaultShader() ? 1 : 0);
+    sCommands.writeUnsignedInt(vertexCount);
+
+    // Room for the vertices, filled in once the caller wrote them
+    sPendingOffset = sCommands.getPosition();
+    sCommands.resize(sPendingOffset + vertexCount * sizeof(VertexPosColorTex));
+    sCommands.setPosition(sCommands.getSize());
+
+    sPendingVertices = vertices;
+    sPendingVertexCount = vertexCount;
+}
+
+void FrameCapture::recordSubmit(FlushReason reason)
+{
+    copyPendingVertices();
+
+    if (!recording())
+        return;
+
+    sCommands.writeInt(COMMAND_SUBMIT);
+    sCommands.writeInt(reason);
+}
+
+void FrameCapture::recordMask(int depth, MaskMode mode)
+{
+    copyPendingVertices();
+
+    if (!recording())
+        return;
+
+    sCommands.writeInt(COMMAND_MASK);
+    sCommands.writeInt(depth);
+    sCommands.writeInt(mode);
+}
+
+void FrameCapture::recordClip(int x, int y, int width, int height)
+{
+    copyPendingVertices();
+
+    if (!recording())
+        return;
+
+    sCommands.writeInt(COMMAND_CLIP);
+    sCommands.writeInt(x);
+    sCommands.writeInt(y);
+    sCommands.writeInt(width);
+    sCommands.writeInt(height);
+}
+
+void FrameCapture::recordUpload(TextureInfo &tinfo, const uint8_t *data, int width, int height, int xoffset, int yoffset)
+{
+    copyPendingVertices();
+
+    if (!recording())
+        return;
+
+    // Defined before the upload, a new image has its size set by it
+    defineTexture(tinfo);
+
+    sCommands.writeInt(COMMAND_UPLOAD);
+    sCommands.writeInt(tinfo.id);
+    sCommands.writeInt(width);
+    sCommands.writeInt(height);
+    sCommands.writeInt(xoffset);
+    sCommands.writeInt(yoffset);
+    sCommands.writeInt(data ? 1 : 0);
+    if (data)
+        sCommands.writeUTFInternal((const char *)data, width * height * 4);
+}
+
+FrameReplay::FrameReplay() : width(0), height(0)
+{
+}
+
+FrameReplay::~FrameReplay()
+{
+    dispose();
+}
+
+bool FrameReplay::load(const char *path)
+{
+    dispose();
+
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        lmLogError(gGFXFrameCaptureLogGroup, "Unable to open the frame capture %s", path);
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    commands.resize(size > 0 ? (UTsize)size : 0);
+    bool read = size > 16 && fread(commands.getDataPtr(), 1, size, file) == (size_t)size;
+    fclose(file);
+
+    commands.setPosition(0);
+    if (!read || commands.readUnsignedInt() != FRAMECAPTURE_MAGIC || commands.readInt() != FRAMECAPTURE_VERSION)
+    {
+        lmLogError(gGFXFrameCaptureLogGroup, "%s is not a version %d frame capture", path, FRAMECAPTURE_VERSION);
+        commands.clear();
+        return false;
+    }
+
+    width = commands.readInt();
+    height = commands.readInt();
+
+    // Create the textures up front with placeholder pixels of their size
+    utArray<uint32_t> pixels;
+    unsigned int start = commands.getPosition();
+    int command;
+    while ((command = commands.readInt()) != FrameCapture::COMMAND_END)
+    {
+        switch (command)
+        {
+            case FrameCapture::COMMAND_TEXTURE:
+            {
+                int id = commands.readInt();
+                int textureWidth = commands.readInt();
+                int textureHeight = commands.readInt();
+                int smoothing = commands.readInt();
+                int wrapU = commands.readInt();
+                int wrapV = commands.readInt();
+
+                textureWidth = textureWidth > 0 ? textureWidth : 1;
+                textureHeight = textureHeight > 0 ? textureHeight : 1;
+                pixels.resize(textureWidth * textureHeight);
+                for (UTsize i = 0; i < pixels.size(); i++)
+                    pixels[i] = 0xFF808080;
+
+                TextureInfo *tinfo = Texture::load((uint8_t *)pixels.ptr(), (uint16_t)textureWidth, (uint16_t)textureHeight);
+                if (!tinfo)
+                    break;
+
+                tinfo->smoothing = smoothing;
+                tinfo->wrapU = wrapU;
+                tinfo->wrapV = wrapV;
+                textures.insert(id, tinfo->id);
+                created.push_back(tinfo->id);
+                break;
+            }
+
+            case FrameCapture::COMMAND_UPLOAD:
+            {
+                commands.readInt();
+                int uploadWidth = commands.readInt();
+                int uploadHeight = commands.readInt();
+                commands.readInt();
+                commands.readInt();
+                if (commands.readInt())
+                    commands.setPosition(commands.getPosition() + uploadWidth * uploadHeight * 4);
+                break;
+            }
+
+            case FrameCapture::COMMAND_QUADS:
+            {
+                commands.setPosition(commands.getPosition() + 5 * 4);
+                uint32_t vertexCount = commands.readUnsignedInt();
+                commands.setPosition(commands.getPosition() + vertexCount * sizeof(VertexPosColorTex));
+                break;
+            }
+
+            case FrameCapture::COMMAND_SUBMIT:
+                commands.readInt();
+                break;
+
+            case FrameCapture::COMMAND_MASK:
+            case FrameCapture::COMMAND_VECTOR_VIEWPORT:
+                commands.setPosition(commands.getPosition() + 2 * 4);
+                break;
+
+            case FrameCapture::COMMAND_CLIP:
+                commands.setPosition(commands.getPosition() + 4 * 4);
+                break;
+
+            case FrameCapture::COMMAND_VECTOR_FILL:
+            case FrameCapture::COMMAND_VECTOR_STROKE:
+            case FrameCapture::COMMAND_VECTOR_TRIANGLES:
+            {
+                // Paint, scissor and fringe, bounds or stroke width
+                commands.setPosition(commands.getPosition() + (18 + 8 + 1) * 4);
+                if (command == FrameCapture::COMMAND_VECTOR_FILL)
+                    commands.setPosition(commands.getPosition() + 4 * 4);
+                else if (command == FrameCapture::COMMAND_VECTOR_STROKE)
+                    commands.readFloat();
+
+                if (command == FrameCapture::COMMAND_VECTOR_TRIANGLES)
+                    commands.setPosition(commands.getPosition() + commands.readInt() * 4 * 4);
+                else
+                    readPaths(commands);
+                break;
+            }
+
+            case FrameCapture::COMMAND_VECTOR_FLUSH:
+                break;
+
+            default:
+                lmLogError(gGFXFrameCaptureLogGroup, "Unknown command %d in the frame capture %s", command, path);
+                dispose();
+                return false;
+        }
+    }
+
+    commands.setPosition(start);
+    return true;
+}
+
+TextureID FrameReplay::mapTexture(int id)
+{
+    TextureID *mapped = textures.get(id);
+    return mapped ? *mapped : TEXTUREINVALID;
+}
+
+void FrameReplay::play()
+{
+    if (commands.getSize() == 0)
+        return;
+
+    unsigned int start = commands.getPosition();
+
+    NVGparams *params = nvg ? nvgInternalParams(nvg) : NULL;
+    utArray<uint8_t> placeholder;
+
+    Graphics::beginFrame();
+
+    int command;
+    while ((command = commands.readInt()) != FrameCapture::COMMAND_END)
+    {
+        switch (command)
+        {
+            case FrameCapture::COMMAND_TEXTURE:
+                commands.setPosition(commands.getPosition() + 6 * 4);
+                break;
+
+            case FrameCapture::COMMAND_UPLOAD:
+            {
+                TextureInfo *tinfo = Texture::getTextureInfo(mapTexture(commands.readInt()));
+                int uploadWidth = commands.readInt();
+                int uploadHeight = commands.readInt();
+                int xoffset = commands.readInt();
+                int yoffset = commands.readInt();
+
+                uint8_t *data;
+                if (commands.readInt())
+                {
+                    data = (uint8_t *)commands.getDataPtr() + commands.getPosition();
+                    commands.setPosition(commands.getPosition() + uploadWidth * uploadHeight * 4);
+                }
+                else
+                {
+                    placeholder.resize(uploadWidth * uploadHeight * 4);
+                    memset(placeholder.ptr(), 0x80, placeholder.size());
+                    data = placeholder.ptr();
+                }
+
+                if (tinfo)
+                    Texture::upload(*tinfo, data, (uint16_t)uploadWidth, (uint16_t)uploadHeight, xoffset, yoffset);
+                break;
+            }
+
+            case FrameCapture::COMMAND_QUADS:
+            {
+                TextureID texture = mapTexture(commands.readInt());
+                bool blendEnabled = commands.readInt() != 0;
+                uint32_t srcBlend = commands.readUnsignedInt();
+                uint32_t dstBlend = commands.readUnsignedInt();
+                ShaderProgram *shader = commands.readInt() ? ShaderProgram::getTintlessDefaultShader() : ShaderProgram::getDefaultShader();
+                uint32_t vertexCount = commands.readUnsignedInt();
+
+                const uint8_t *source = (const uint8_t *)commands.getDataPtr() + commands.getPosition();
+                commands.setPosition(commands.getPosition() + vertexCount * sizeof(VertexPosColorTex));
+
+                if (texture == TEXTUREINVALID)
+                    break;
+
+                VertexPosColorTex *vertices = QuadRenderer::getQuadVertexMemory(vertexCount, texture, blendEnabled, srcBlend, dstBlend, shader);
+                if (vertices)
+                    memcpy(vertices, source, vertexCount * sizeof(VertexPosColorTex));
+                break;
+            }
+
+            case FrameCapture::COMMAND_SUBMIT:
+                QuadRenderer::submit((FlushReason)commands.readInt());
+                break;
+
+            case FrameCapture::COMMAND_MASK:
+            {
+                int depth = commands.readInt();
+                QuadRenderer::setMaskState(depth, (MaskMode)commands.readInt());
+                break;
+            }
+
+            case FrameCapture::COMMAND_CLIP:
+            {
+                int x = commands.readInt();
+                int y = commands.readInt();
+                int clipWidth = commands.readInt();
+                int clipHeight = commands.readInt();
+                if (clipWidth == -1)
+                    Graphics::clearClipRect();
+                else
+                    Graphics::setClipRect(x, y, clipWidth, clipHeight);
+                break;
+            }
+
+            case FrameCapture::COMMAND_VECTOR_VIEWPORT:
+            {
+                int viewportWidth = commands.readInt();
+                int viewportHeight = commands.readInt();
+                if (params)
+                    params->renderViewport(params->userPtr, viewportWidth, viewportHeight);
+                break;
+            }
+
+            case FrameCapture::COMMAND_VECTOR_FILL:
+            {
+                NVGpaint paint;
+                NVGscissor scissor;
+                float bounds[4];
+                readPaint(commands, &paint);
+                readScissor(commands, &scissor);
+                float fringe = commands.readFloat();
+                commands.readFloats(bounds, 4);
+                int npaths = readPaths(commands);
+                if (params)
+                    params->renderFill(params->userPtr, &paint, &scissor, fringe, bounds, sReplayPaths.ptr(), npaths);
+                break;
+            }
+
+            case FrameCapture::COMMAND_VECTOR_STROKE:
+            {
+                NVGpaint paint;
+                NVGscissor scissor;
+                readPaint(commands, &paint);
+                readScissor(commands, &scissor);
+                float fringe = commands.readFloat();
+                float strokeWidth = commands.readFloat();
+                int npaths = readPaths(commands);
+                if (params)
+                    params->renderStroke(params->userPtr, &paint, &scissor, fringe, strokeWidth, sReplayPaths.ptr(), npaths);
+                break;
+            }
+
+            case FrameCapture::COMMAND_VECTOR_TRIANGLES:
+            {
+                NVGpaint paint;
+                NVGscissor scissor;
+                readPaint(commands, &paint);
+                readScissor(commands, &scissor);
+                float sdf = commands.readFloat();
+                int nverts = commands.readInt();
+                sReplayVertices.resize(nverts);
+                if (nverts > 0)
+                    commands.readFloats(&sReplayVertices[0].x, nverts * 4);
+                if (params)
+                    params->renderTriangles(params->userPtr, &paint, &scissor, sReplayVertices.ptr(), nverts, sdf);
+                break;
+            }
+
+            case FrameCapture::COMMAND_VECTOR_FLUSH:
+                if (params)
+                    params->renderFlush(params->userPtr);
+                break;
+        }
+    }
+
+    Graphics::endFrame();
+
+    commands.setPosition(start);
+}
+
+void FrameReplay::dispose()
+{
+    for (UTsize i = 0; i < created.size(); i++)
+        Texture::dispose(created[i]);
+
+    created.clear();
+    textures.clear();
+    commands.clear();
+    width = height = 0;
+}
+}
@@ -0,0 +1,153 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#pragma once
+
+#include "loom/common/utils/utByteArray.h"
+#include "loom/graphics/gfxQuadRenderer.h"
+
+namespace GFX
+{
+
+// Version of the capture files written, replays refuse any other
+#define FRAMECAPTURE_VERSION    1
+
+/*
+ * Records what a frame hands to the renderers into a file that
+ * FrameReplay draws again without the script VM or the display list:
+ * the quads given to QuadRenderer with their texture, blend and shader,
+ * submits, mask and clip changes, texture uploads and the tessellated
+ * fills, strokes and triangles of the vector renderer.
+ *
+ * Textures are recorded by their size and sampling state, their pixels
+ * only when they are uploaded during the frame. Custom shaders replay
+ * as the default shader, vector paints without their image and quads
+ * drawn from static batches or into render targets aren't recorded, so
+ * a replay matches the draw calls and vertex work of the frame rather
+ * than every pixel of it.
+ */
+class FrameCapture
+{
+public:
+
+    // Captures the next complete frame into the file at path
+    static void request(const char *path);
+
+    static inline bool isCapturing()
+    {
+        return sCapturing;
+    }
+
+    // Called by Graphics around each frame
+    static void beginFrame();
+    static void endFrame();
+
+    // Hooks of the renderers, only called while capturing
+    static void recordQuads(VertexPosColorTex *vertices, uint32_t vertexCount, TextureID texture, bool blendEnabled, uint32_t srcBlend, uint32_t dstBlend, ShaderProgram *shader);
+    static void recordSubmit(FlushReason reason);
+    static void recordMask(int depth, MaskMode mode);
+    static void recordClip(int x, int y, int width, int height);
+    static void recordUpload(TextureInfo &tinfo, const uint8_t *data, int width, int height, int xoffset, int yoffset);
+
+    // Copies the vertices of the last quads recorded, callers fill them
+    // after getQuadVertexMemory returns so this is done at the next hook,
+    // before their memory could move
+    static void copyPendingVertices();
+
+private:
+
+    enum Command
+    {
+        COMMAND_END = 0,
+        COMMAND_TEXTURE,
+        COMMAND_UPLOAD,
+        COMMAND_QUADS,
+        COMMAND_SUBMIT,
+        COMMAND_MASK,
+        COMMAND_CLIP,
+        COMMAND_VECTOR_VIEWPORT,
+        COMMAND_VECTOR_FILL,
+        COMMAND_VECTOR_STROKE,
+        COMMAND_VECTOR_TRIANGLES,
+        COMMAND_VECTOR_FLUSH
+    };
+
+    friend class FrameReplay;
+    friend struct FrameCaptureHooks;
+
+    static bool sCapturing;
+    static utString sRequestPath;
+    static utByteArray sCommands;
+
+    // Textures defined in the capture so far
+    static utHashTable<utIntHashKey, bool> sTextures;
+
+    // Vertices of the last quads recorded and where they go
+    static VertexPosColorTex *sPendingVertices;
+    static uint32_t sPendingVertexCount;
+    static unsigned int sPendingOffset;
+
+    static void defineTexture(TextureInfo &tinfo);
+
+    static void hookVectorRenderer(bool enabled);
+};
+
+/*
+ * Draws a frame written by FrameCapture. The textures are created when
+ * the file is loaded, so play only does the work of the frame itself.
+ */
+class FrameReplay
+{
+public:
+
+    FrameReplay();
+    ~FrameReplay();
+
+    // Returns false if the file is missing or not a capture of this version
+    bool load(const char *path);
+
+    // Draws the frame between Graphics::beginFrame and endFrame
+    void play();
+
+    void dispose();
+
+    int getWidth() const
+    {
+        return width;
+    }
+
+    int getHeight() const
+    {
+        return height;
+    }
+
+private:
+
+    utByteArray commands;
+    int width;
+    int height;
+
+    // Captured texture ids and the ones they were created as
+    utHashTable<utIntHashKey, TextureID> textures;
+    utArray<TextureID> created;
+
+    TextureID mapTexture(int id);
+};
+}
@@ -0,0 +1,5 @@
+// Optional instancing entry points, core in OpenGL ES 3.0 and OpenGL 3.3
+// and otherwise provided by ARB/EXT/ANGLE_instanced_arrays. These may be
+// missing, check Graphics::supportsInstancing() before calling them.
+GFX_PROC_VOID(glDrawElementsInstanced, (GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount), (mode, count, type, indices, instancecount))
+GFX_PROC_VOID(glVertexAttribDivisor, (GLuint index, GLuint divisor), (index, divisor))
@@ -0,0 +1,5 @@
+// Optional buffer mapping entry points, core in OpenGL ES 3.0 and OpenGL 3.0
+// and otherwise provided by ARB/EXT_map_buffer_range. These may be
+// missing, check Graphics::supportsAsyncReadback() before calling them.
+GFX_PROC(void *, glMapBufferRange, (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access), (target, offset, length, access))
+GFX_PROC(GLboolean, glUnmapBuffer, (GLenum target), (target))
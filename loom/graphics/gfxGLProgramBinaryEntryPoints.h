@@ -0,0 +1,5 @@
+// Optional program binary entry points, core in OpenGL ES 3.0 and OpenGL 4.1
+// and otherwise provided by ARB/OES_get_program_binary. These may be
+// missing, check Graphics::supportsProgramBinary() before calling them.
+GFX_PROC_VOID(glGetProgramBinary, (GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary), (program, bufSize, length, binaryFormat, binary))
+GFX_PROC_VOID(glProgramBinary, (GLuint program, GLenum binaryFormat, const void *binary, GLsizei length), (program, binaryFormat, binary, length))
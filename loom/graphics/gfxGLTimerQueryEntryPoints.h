@@ -0,0 +1,9 @@
+// Optional timer query entry points, provided by ARB_timer_query on desktop
+// and EXT_disjoint_timer_query on OpenGL ES. These may be missing, check
+// Graphics::supportsTimerQueries() before calling them.
+GFX_PROC_VOID(glGenQueries, (GLsizei n, GLuint *ids), (n, ids))
+GFX_PROC_VOID(glDeleteQueries, (GLsizei n, const GLuint *ids), (n, ids))
+GFX_PROC_VOID(glQueryCounter, (GLuint id, GLenum target), (id, target))
+GFX_PROC_VOID(glGetQueryiv, (GLenum target, GLenum pname, GLint *params), (target, pname, params))
+GFX_PROC_VOID(glGetQueryObjectuiv, (GLuint id, GLenum pname, GLuint *params), (id, pname, params))
+GFX_PROC_VOID(glGetQueryObjectui64v, (GLuint id, GLenum pname, uint64_t *params), (id, pname, params))
@@ -0,0 +1,228 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#include "loom/common/core/telemetry.h"
+#include "loom/common/utils/utTypes.h"
+#include "loom/graphics/gfxGraphics.h"
+#include "loom/graphics/gfxGPUTimer.h"
+
+// Number of frames that can be waiting on their results, drivers
+// usually finish a frame within two or three
+#define GPUTIMER_FRAMES 4
+
+namespace GFX
+{
+
+static const GLenum GPUTIMER_TIMESTAMP = 0x8E28;
+static const GLenum GPUTIMER_QUERY_RESULT = 0x8866;
+static const GLenum GPUTIMER_QUERY_RESULT_AVAILABLE = 0x8867;
+static const GLenum GPUTIMER_GPU_DISJOINT = 0x8FBB;
+
+static const char *sSectionNames[GPUTimer::SECTION_COUNT] = {
+    "gfx.gpu.quad",
+    "gfx.gpu.vector"
+};
+
+// A section of a frame, between two of its timestamps
+struct GPUTimerRange
+{
+    int section;
+    UTsize start;
+    UTsize end;
+};
+
+// Timestamps of a frame, the first and last one are recorded at its
+// start and end. Query names are kept and reused by later frames
+struct GPUTimerFrame
+{
+    utArray<GLuint> queries;
+    UTsize used;
+    utArray<GPUTimerRange> ranges;
+    bool pending;
+};
+
+static GPUTimerFrame sFrames[GPUTIMER_FRAMES];
+
+// The frame being recorded, once it ends it's the oldest one
+static int sRecordingFrame = 0;
+static bool sRecording = false;
+
+static int sSectionDepth[GPUTimer::SECTION_COUNT];
+static UTsize sSectionStart[GPUTimer::SECTION_COUNT];
+
+static UTsize recordTimestamp(GPUTimerFrame &frame)
+{
+    if (frame.used == frame.queries.size())
+    {
+        GLuint query = 0;
+        Graphics::context()->glGenQueries(1, &query);
+        frame.queries.push_back(query);
+    }
+
+    UTsize index = frame.used++;
+    Graphics::context()->glQueryCounter(frame.queries[index], GPUTIMER_TIMESTAMP);
+    return index;
+}
+
+static uint64_t readTimestamp(GPUTimerFrame &frame, UTsize index)
+{
+    uint64_t time = 0;
+    Graphics::context()->glGetQueryObjectui64v(frame.queries[index], GPUTIMER_QUERY_RESULT, &time);
+    return time;
+}
+
+// Reports the timings of the frame if they are available, returns
+// false if the GPU is not done with it yet
+static bool collectFrame(GPUTimerFrame &frame)
+{
+    // Timestamps complete in order, once the last one
+    // is available all the others are as well
+    GLuint available = 0;
+    Graphics::context()->glGetQueryObjectuiv(frame.queries[frame.used - 1], GPUTIMER_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return false;
+
+    frame.pending = false;
+
+#if LOOM_RENDERER_OPENGLES2
+    // A disjoint event (e.g. a GPU clock change) leaves the results of
+    // all queries since the last check undefined, reading clears it
+    GLint disjoint = 0;
+    Graphics::context()->glGetIntegerv(GPUTIMER_GPU_DISJOINT, &disjoint);
+    if (disjoint)
+    {
+        for (int i = 0; i < GPUTIMER_FRAMES; i++)
+            sFrames[i].pending = false;
+        return true;
+    }
+#endif
+
+    double sectionTimes[GPUTimer::SECTION_COUNT] = { 0, };
+    for (UTsize i = 0; i < frame.ranges.size(); i++)
+    {
+        const GPUTimerRange &range = frame.ranges[i];
+        sectionTimes[range.section] += (double)(readTimestamp(frame, range.end) - readTimestamp(frame, range.start));
+    }
+
+    uint64_t frameTime = readTimestamp(frame, frame.used - 1) - readTimestamp(frame, 0);
+    Telemetry::setTickValue("gfx.gpu.frame", frameTime / 1e6);
+
+    for (int i = 0; i < GPUTimer::SECTION_COUNT; i++)
+        Telemetry::setTickValue(sSectionNames[i], sectionTimes[i] / 1e6);
+
+    return true;
+}
+
+void GPUTimer::beginFrame()
+{
+    sRecording = false;
+
+    if (!Graphics::supportsTimerQueries() || !Telemetry::isEnabled())
+        return;
+
+    // Skip timing this frame rather than wait when
+    // the GPU is still behind on all the earlier ones
+    GPUTimerFrame &frame = sFrames[sRecordingFrame];
+    if (frame.pending)
+        return;
+
+    frame.used = 0;
+    frame.ranges.clear(true);
+
+    for (int i = 0; i < SECTION_COUNT; i++)
+        sSectionDepth[i] = 0;
+
+    recordTimestamp(frame);
+    sRecording = true;
+}
+
+void GPUTimer::endFrame()
+{
+    if (!Graphics::supportsTimerQueries())
+        return;
+
+    if (sRecording)
+    {
+        GPUTimerFrame &frame = sFrames[sRecordingFrame];
+        recordTimestamp(frame);
+        frame.pending = true;
+
+        sRecordingFrame = (sRecordingFrame + 1) % GPUTIMER_FRAMES;
+        sRecording = false;
+    }
+
+    // Oldest first so the newest available frame is the one reported
+    for (int i = 0; i < GPUTIMER_FRAMES; i++)
+    {
+        GPUTimerFrame &frame = sFrames[(sRecordingFrame + i) % GPUTIMER_FRAMES];
+        if (frame.pending && !collectFrame(frame))
+            break;
+    }
+}
+
+void GPUTimer::begin(Section section)
+{
+    if (!sRecording || sSectionDepth[section]++ > 0)
+        return;
+
+    sSectionStart[section] = recordTimestamp(sFrames[sRecordingFrame]);
+}
+
+void GPUTimer::end(Section section)
+{
+    if (!sRecording || sSectionDepth[section] == 0 || --sSectionDepth[section] > 0)
+        return;
+
+    GPUTimerFrame &frame = sFrames[sRecordingFrame];
+
+    GPUTimerRange range;
+    range.section = section;
+    range.start = sSectionStart[section];
+    range.end = recordTimestamp(frame);
+    frame.ranges.push_back(range);
+}
+
+void GPUTimer::reset()
+{
+    for (int i = 0; i < GPUTIMER_FRAMES; i++)
+    {
+        sFrames[i].queries.clear(true);
+        sFrames[i].used = 0;
+        sFrames[i].ranges.clear(true);
+        sFrames[i].pending = false;
+    }
+
+    sRecordingFrame = 0;
+    sRecording = false;
+}
+
+void GPUTimer::shutdown()
+{
+    for (int i = 0; i < GPUTIMER_FRAMES; i++)
+    {
+        if (sFrames[i].queries.size() > 0)
+            Graphics::context()->glDeleteQueries((GLsizei)sFrames[i].queries.size(), sFrames[i].queries.ptr());
+    }
+
+    reset();
+}
+
+}
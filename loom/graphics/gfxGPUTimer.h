@@ -0,0 +1,63 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#pragma once
+
+namespace GFX
+{
+
+/*
+ * Records GPU timestamps around each frame and the renderer flushes in
+ * it, and reports the time the GPU spent on them as telemetry tick
+ * values (gfx.gpu.*, in milliseconds). Results are read back a few
+ * frames later so nothing waits on the GPU, the values reported on a
+ * tick therefore belong to an earlier frame. Does nothing unless
+ * telemetry is enabled and the context supports timer queries.
+ */
+class GPUTimer
+{
+public:
+
+    enum Section
+    {
+        SECTION_QUAD,
+        SECTION_VECTOR,
+        SECTION_COUNT
+    };
+
+    // Marks the start and end of a frame, results of earlier frames
+    // that are available by the end of this one get reported
+    static void beginFrame();
+    static void endFrame();
+
+    // Marks the start and end of a section, sections may nest in
+    // each other but not in themselves
+    static void begin(Section section);
+    static void end(Section section);
+
+    // Forgets all queries without deleting them, for context loss
+    static void reset();
+
+    // Deletes all queries
+    static void shutdown();
+};
+
+}
@@ -20,6 +20,9 @@
 
 #include "loom/common/platform/platform.h"
 #include "loom/common/core/log.h"
+#include "loom/common/core/telemetry.h"
+#include "loom/common/assets/assets.h"
+#include "loom/common/assets/assetsImage.h"
 
 #include "loom/graphics/gfxMath.h"
 
@@ -27,11 +30,13 @@
 
 #include "loom/engine/loom2d/l2dMatrix.h"
 #include "loom/graphics/gfxGraphics.h"
+#include "loom/graphics/gfxFrameCapture.h"
 #include "loom/graphics/gfxTexture.h"
 #include "loom/graphics/gfxQuadRenderer.h"
 #include "loom/graphics/gfxVectorRenderer.h"
 #include "loom/graphics/gfxBitmapData.h"
 #include "loom/graphics/gfxStateManager.h"
+#include "loom/graphics/gfxGPUTimer.h"
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
@@ -51,9 +56,24 @@ bool Graphics::sInitialized = false;
 // start with context loss as flagged so resources are created
 bool Graphics::sContextLost = true;
 
+bool Graphics::sInstancingSupported = false;
+bool Graphics::sProgramBinarySupported = false;
+bool Graphics::sAsyncReadbackSupported = false;
+bool Graphics::sTimerQueriesSupported = false;
+bool Graphics::sGenerateMipmapSupported = false;
+bool Graphics::sThreadedPresent = false;
+bool Graphics::sPresentPending = false;
+bool Graphics::sStatsOverlay = false;
+bool Graphics::sPremultipliedAlpha = false;
+bool Graphics::sPixelBuffersSupported = false;
+
 int Graphics::sBackFramebuffer = -1;
 
+GLuint Graphics::sOffscreenFramebuffer = 0;
+GLuint Graphics::sOffscreenRenderbuffers[2] = { 0, 0 };
+
 uint32_t Graphics::sCurrentFrame = 0;
+loom_allocator_t *Graphics::sFrameAllocator = NULL;
 GraphicsRenderTarget Graphics::sTarget;
 utArray<GraphicsRenderTarget> Graphics::sTargetStack;
 
@@ -68,7 +88,9 @@ float *Graphics::sCurrentModelViewProjection = NULL;
 
 char Graphics::pendingScreenshot[1024] = { 0, };
 bool Graphics::gettingScreenshotData = false;
+bool Graphics::gettingFramebufferData = false;
 LS::NativeDelegate Graphics::_onScreenshotDataDelegate;
+LS::NativeDelegate Graphics::_onFramebufferDataDelegate;
 
 extern SDL_GLContext context;
 GL_Context Graphics::_context;
@@ -119,11 +141,173 @@ if ( ! data->GFX_OPENGL_FUNC(func) ) { \
     return 0;
 }
 
+/**
+ * Look up an optional GL function under its core name or one of the
+ * extension suffixes it is commonly exported with, NULL if not found.
+ */
+static void *LoadOptionalProc(const char *name)
+{
+    static const char *suffixes[] = { "", "ARB", "EXT", "ANGLE", "OES" };
+
+    char fullName[128];
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++)
+    {
+        snprintf(fullName, sizeof(fullName), "%s%s", name, suffixes[i]);
+        void *proc = SDL_GL_GetProcAddress(fullName);
+        if (proc)
+            return proc;
+    }
+
+    return NULL;
+}
+
+#define GFX_PROC(ret,func,params,args) \
+do { \
+void **tmp = (void**)&data->GFX_OPENGL_FUNC(func); \
+*tmp = LoadOptionalProc(#func); \
+if ( ! data->GFX_OPENGL_FUNC(func) ) { \
+    loaded = false; \
+} \
+} while ( 0 );
+#define GFX_PROC_VOID(func, params, args) GFX_PROC(void, func, params, args)
+
+/**
+ * Resolve the optional entry points, returns true if all of them were found.
+ */
+static bool LoadOptionalContext(GL_Context * data)
+{
+    bool loaded = true;
+
+#include "gfxGLInstancingEntryPoints.h"
+
+    return loaded;
+}
+
+/**
+ * Resolve the buffer mapping entry points, returns true if all of them were found.
+ */
+static bool LoadMapBufferContext(GL_Context * data)
+{
+    bool loaded = true;
+
+#include "gfxGLMapBufferEntryPoints.h"
+
+    return loaded;
+}
+
+/**
+ * Resolve the program binary entry points, returns true if all of them were found.
+ */
+static bool LoadProgramBinaryContext(GL_Context * data)
+{
+    bool loaded = true;
+
+#include "gfxGLProgramBinaryEntryPoints.h"
+
+    return loaded;
+}
+
+/**
+ * Resolve the timer query entry points, returns true if all of them were found.
+ */
+static bool LoadTimerQueryContext(GL_Context * data)
+{
+    bool loaded = true;
+
+#include "gfxGLTimerQueryEntryPoints.h"
+
+    return loaded;
+}
+
+#undef GFX_PROC
+#undef GFX_PROC_VOID
+
+/**
+ * Returns the major version of the context, reported as
+ * "OpenGL ES <major>.<minor> ..." or "<major>.<minor> ...".
+ */
+static int GetContextMajorVersion()
+{
+    const char *version = (const char *) Graphics::context()->glGetString(GL_VERSION);
+    if (version == NULL)
+        return 0;
+
+    const char *es = strstr(version, "OpenGL ES");
+    if (es != NULL)
+        version = es + strlen("OpenGL ES");
+
+    while (*version == ' ' || *version == '-' || (*version >= 'A' && *version <= 'Z'))
+        version++;
+
+    return atoi(version);
+}
+
 
 void Graphics::initialize()
 {
     LoadContext(&_context);
 
+#if LOOM_RENDERER_OPENGLES2
+    int instancingVersion = 3;
+#else
+    int instancingVersion = 4;
+#endif
+    sInstancingSupported = LoadOptionalContext(&_context) &&
+                           (GetContextMajorVersion() >= instancingVersion ||
+                            queryExtension("GL_ARB_instanced_arrays") ||
+                            queryExtension("GL_EXT_instanced_arrays") ||
+                            queryExtension("GL_ANGLE_instanced_arrays"));
+    lmLogDebug(gGFXLogGroup, "Instanced rendering %s", sInstancingSupported ? "supported" : "not supported");
+
+    sPixelBuffersSupported = GetContextMajorVersion() >= 3 ||
+                             queryExtension("GL_ARB_pixel_buffer_object") ||
+                             queryExtension("GL_NV_pixel_buffer_object");
+
+    // Program binaries are core from the same versions on as instancing.
+    // Drivers may expose the entry points but no binary formats at all,
+    // nothing could be restored then
+    GLint binaryFormats = 0;
+    if (LoadProgramBinaryContext(&_context) &&
+        (GetContextMajorVersion() >= instancingVersion ||
+         queryExtension("GL_ARB_get_program_binary") ||
+         queryExtension("GL_OES_get_program_binary")))
+    {
+        Graphics::context()->glGetIntegerv(0x87FE /* GL_NUM_PROGRAM_BINARY_FORMATS */, &binaryFormats);
+    }
+    sProgramBinarySupported = binaryFormats > 0;
+    lmLogDebug(gGFXLogGroup, "Program binaries %s", sProgramBinarySupported ? "supported" : "not supported");
+
+    sAsyncReadbackSupported = sPixelBuffersSupported && LoadMapBufferContext(&_context) &&
+                              (GetContextMajorVersion() >= 3 ||
+                               queryExtension("GL_ARB_map_buffer_range") ||
+                               queryExtension("GL_EXT_map_buffer_range"));
+    lmLogDebug(gGFXLogGroup, "Async framebuffer readback %s", sAsyncReadbackSupported ? "supported" : "not supported");
+
+    // Timer queries are only useful with timestamps, some drivers
+    // report zero counter bits for GL_TIMESTAMP when they can't provide them
+    GLint timestampBits = 0;
+#if LOOM_RENDERER_OPENGLES2
+    bool timerQueryExtension = queryExtension("GL_EXT_disjoint_timer_query");
+#else
+    bool timerQueryExtension = GetContextMajorVersion() >= 4 || queryExtension("GL_ARB_timer_query");
+#endif
+    if (LoadTimerQueryContext(&_context) && timerQueryExtension)
+    {
+        Graphics::context()->glGetQueryiv(0x8E28 /* GL_TIMESTAMP */, 0x8864 /* GL_QUERY_COUNTER_BITS */, &timestampBits);
+    }
+    sTimerQueriesSupported = timestampBits > 0;
+    lmLogDebug(gGFXLogGroup, "GPU timer queries %s", sTimerQueriesSupported ? "supported" : "not supported");
+
+    // Core in ES 2, desktop GL has it with framebuffer objects
+#if LOOM_RENDERER_OPENGLES2
+    sGenerateMipmapSupported = true;
+#else
+    sGenerateMipmapSupported = GetContextMajorVersion() >= 3 ||
+                               queryExtension("GL_ARB_framebuffer_object") ||
+                               queryExtension("GL_EXT_framebuffer_object");
+#endif
+    lmLogDebug(gGFXLogGroup, "GPU mipmap generation %s", sGenerateMipmapSupported ? "supported" : "not supported");
+
     //context()->glDebugMessageCallback(gldebughandler, 0);
 
     // initialize the static Texture initialize
@@ -153,9 +337,68 @@ void Graphics::resume()
 
 void Graphics::shutdown()
 {
+    stopPresentThread();
+
+    updateReadbacks(true);
+    GPUTimer::shutdown();
+
     Texture::shutdown();
     QuadRenderer::destroyGraphicsResources();
     VectorRenderer::destroyGraphicsResources();
+
+    if (sOffscreenFramebuffer)
+    {
+        context()->glDeleteFramebuffers(1, &sOffscreenFramebuffer);
+        context()->glDeleteRenderbuffers(2, sOffscreenRenderbuffers);
+        sOffscreenFramebuffer = 0;
+    }
+}
+
+bool Graphics::createOffscreenFramebuffer(int width, int height)
+{
+    lmAssert(sInitialized, "Please make sure to call Graphics::initialize first");
+    lmAssert(sOffscreenFramebuffer == 0, "Offscreen framebuffer already created");
+
+    GL_Context *ctx = context();
+
+    ctx->glGenRenderbuffers(2, sOffscreenRenderbuffers);
+
+    ctx->glBindRenderbuffer(GL_RENDERBUFFER, sOffscreenRenderbuffers[0]);
+#if LOOM_RENDERER_OPENGLES2
+    ctx->glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA4, width, height);
+#else
+    ctx->glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+#endif
+
+    ctx->glBindRenderbuffer(GL_RENDERBUFFER, sOffscreenRenderbuffers[1]);
+#if LOOM_RENDERER_OPENGLES2
+    ctx->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8_OES, width, height);
+#else
+    ctx->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+#endif
+    ctx->glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    ctx->glGenFramebuffers(1, &sOffscreenFramebuffer);
+    ctx->glBindFramebuffer(GL_FRAMEBUFFER, sOffscreenFramebuffer);
+    ctx->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, sOffscreenRenderbuffers[0]);
+    ctx->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, sOffscreenRenderbuffers[1]);
+    ctx->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, sOffscreenRenderbuffers[1]);
+
+    if (ctx->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        lmLogError(gGFXLogGroup, "Offscreen framebuffer incomplete, rendering to the window");
+
+        ctx->glBindFramebuffer(GL_FRAMEBUFFER, sBackFramebuffer);
+        ctx->glDeleteFramebuffers(1, &sOffscreenFramebuffer);
+        ctx->glDeleteRenderbuffers(2, sOffscreenRenderbuffers);
+        sOffscreenFramebuffer = 0;
+        return false;
+    }
+
+    // Everything that returns to the back framebuffer returns here now
+    sBackFramebuffer = sOffscreenFramebuffer;
+
+    return true;
 }
 
 void Graphics::reset(int width, int height, uint32_t flags)
@@ -215,6 +458,18 @@ bool Graphics::queryExtension(const char *extName)
 }
 
 
+// Size of each of the two frame allocator buffers, frames needing more
+// spill over to the heap
+#define GFX_FRAME_ALLOCATOR_SIZE (256 * 1024)
+
+loom_allocator_t *Graphics::getFrameAllocator()
+{
+    if (!sFrameAllocator)
+        sFrameAllocator = loom_allocator_initializeFrameAllocator(loom_allocator_getTaggedAllocator("gfx.frame"), GFX_FRAME_ALLOCATOR_SIZE);
+
+    return sFrameAllocator;
+}
+
 void Graphics::beginFrame()
 {
     if (!sInitialized)
@@ -224,15 +479,26 @@ void Graphics::beginFrame()
 
     sCurrentFrame++;
 
+    GPUTimer::beginFrame();
+
     QuadRenderer::beginFrame();
 
     applyRenderTarget();
+
+    FrameCapture::beginFrame();
 }
 
 void Graphics::pushRenderTarget()
 {
     QuadRenderer::submit();
+    sTarget.maskDepth = QuadRenderer::maskDepth;
+    sTarget.maskMode = QuadRenderer::maskMode;
     sTargetStack.push_back(sTarget);
+
+    // Clipping and masks of the previous target don't apply to the new one
+    if (sTarget.clipWidth != -1)
+        clearClipRect();
+    QuadRenderer::setMaskState(0, MASKMODE_TEST);
 }
 
 void Graphics::popRenderTarget()
@@ -240,6 +506,53 @@ void Graphics::popRenderTarget()
     sTarget = sTargetStack.back();
     sTargetStack.pop_back();
     applyRenderTarget(false);
+
+    if (sTarget.clipWidth != -1)
+        setClipRect(sTarget.clipX, sTarget.clipY, sTarget.clipWidth, sTarget.clipHeight);
+    QuadRenderer::setMaskState(sTarget.maskDepth, (MaskMode)sTarget.maskMode);
+}
+
+static const char *sFlushReasonTicks[FLUSH_REASON_COUNT] = {
+    "gfx.flush.texture",
+    "gfx.flush.shader",
+    "gfx.flush.blend",
+    "gfx.flush.mask",
+    "gfx.flush.clip",
+    "gfx.flush.vector",
+    "gfx.flush.bufferFull",
+    "gfx.flush.other"
+};
+
+static const char *sFlushReasonNames[FLUSH_REASON_COUNT] = {
+    "texture", "shader", "blend", "mask", "clip", "vector", "buffer full", "other"
+};
+
+void Graphics::drawStatsOverlay()
+{
+    const RenderStats &stats = QuadRenderer::lastFrameStats;
+
+    char text[512];
+    int length = snprintf(text, sizeof(text), "draws %d  vertices %d  textures %d  shaders %d  vector %d\nflushes",
+                          stats.drawCalls, stats.vertices, stats.textureBinds, stats.shaderSwitches, stats.vectorCalls);
+    for (int i = 0; i < FLUSH_REASON_COUNT && length < (int)sizeof(text); i++)
+        length += snprintf(text + length, sizeof(text) - length, "  %s %d", sFlushReasonNames[i], stats.flushes[i]);
+
+    utString line(text);
+    VectorTextFormat format(0xFFFFFF, 14);
+
+    VectorRenderer::beginFrame();
+    VectorRenderer::preDraw(1, 0, 0, 1, 0, 0);
+
+    VectorRenderer::clearPath();
+    VectorRenderer::fillColor(0x000000, 0.6f);
+    VectorRenderer::rect(0, 0, (float)sTarget.width, 40);
+    VectorRenderer::renderFill();
+
+    VectorRenderer::textFormat(&format, 1);
+    VectorRenderer::textBox(6, 4, (float)sTarget.width - 12, &line);
+
+    VectorRenderer::postDraw();
+    VectorRenderer::endFrame();
 }
 
 void Graphics::applyRenderTarget(bool initial)
@@ -247,7 +560,8 @@ void Graphics::applyRenderTarget(bool initial)
     Graphics::reset(sTarget.width, sTarget.height, sTarget.flags);
 
     VectorRenderer::setSize(sTarget.width, sTarget.height);
-    Graphics::context()->glViewport(0, 0, sTarget.width, sTarget.height);
+    if (Graphics_CacheViewport(0, 0, sTarget.width, sTarget.height))
+        Graphics::context()->glViewport(0, 0, sTarget.width, sTarget.height);
 
     if (initial && !(sTarget.flags & FLAG_NOCLEAR)) {
         Graphics::context()->glClearColor(sTarget.fillColor.r, sTarget.fillColor.g, sTarget.fillColor.b, sTarget.fillColor.a);
@@ -258,34 +572,297 @@ void Graphics::applyRenderTarget(bool initial)
 void Graphics::endFrame()
 {
     QuadRenderer::endFrame();
+    FrameCapture::endFrame();
+
+    GPUTimer::endFrame();
+
+    unsigned int stateCallsIssued, stateCallsFiltered;
+    Graphics_TakeGLStateCacheCounters(&stateCallsIssued, &stateCallsFiltered);
+    Telemetry::setTickValue("gfx.state.issued", stateCallsIssued);
+    Telemetry::setTickValue("gfx.state.filtered", stateCallsFiltered);
+    Telemetry::setTickValue("gfx.texture.memory", Texture::getMemoryUsage());
+    Telemetry::setTickValue("gfx.quad.batches", QuadRenderer::numFrameSubmit);
+    Telemetry::setTickValue("gfx.quad.draws", QuadRenderer::numFrameDraws);
+
+    const RenderStats &stats = QuadRenderer::lastFrameStats;
+    Telemetry::setTickValue("gfx.stats.vertices", stats.vertices);
+    Telemetry::setTickValue("gfx.stats.textureBinds", stats.textureBinds);
+    Telemetry::setTickValue("gfx.stats.shaderSwitches", stats.shaderSwitches);
+    Telemetry::setTickValue("gfx.stats.vectorCalls", stats.vectorCalls);
+    for (int i = 0; i < FLUSH_REASON_COUNT; i++)
+        Telemetry::setTickValue(sFlushReasonTicks[i], stats.flushes[i]);
+
+    if (sStatsOverlay)
+        drawStatsOverlay();
+
+    int renderTargetHits, renderTargetMisses;
+    Texture::takeRenderTargetPoolCounters(&renderTargetHits, &renderTargetMisses);
+    Telemetry::setTickValue("gfx.rendertarget.hits", renderTargetHits);
+    Telemetry::setTickValue("gfx.rendertarget.misses", renderTargetMisses);
+    Telemetry::setTickValue("gfx.rendertarget.pooled", Texture::getRenderTargetPoolSize());
+
+    if (sFrameAllocator)
+    {
+        size_t frameUsed, frameOverflow;
+        loom_allocator_advanceFrame(sFrameAllocator);
+        loom_allocator_getFrameAllocatorStats(sFrameAllocator, &frameUsed, &frameOverflow);
+        Telemetry::setTickValue("gfx.frame.used", (double)frameUsed);
+        Telemetry::setTickValue("gfx.frame.overflow", (double)frameOverflow);
+    }
 
-    if(pendingScreenshot[0] != 0 || gettingScreenshotData)
+    updateReadbacks(false);
+
+    if(pendingScreenshot[0] != 0 || gettingScreenshotData || gettingFramebufferData)
     {
         SDL_ClearError();
-        SDL_Window* sdlWindow = gSDLWindow;
 
-        const BitmapData* fb = BitmapData::fromFramebuffer();
+        beginReadback();
+
+        pendingScreenshot[0] = 0;
+        gettingScreenshotData = false;
+        gettingFramebufferData = false;
+    }
+}
+
+// Readbacks in flight are mapped this many frames after they were
+// started, by then the GPU is done with the frame and mapping doesn't wait
+#define GFX_READBACK_FRAMES 2
+
+#define GFX_GL_PIXEL_PACK_BUFFER 0x88EB
+#define GFX_GL_STREAM_READ 0x88E1
+#define GFX_GL_MAP_READ_BIT 0x0001
+
+enum
+{
+    READBACK_SAVE   = 1 << 0,
+    READBACK_PNG    = 1 << 1,
+    READBACK_BITMAP = 1 << 2,
+};
+
+struct FramebufferReadback
+{
+    // READBACK_* flags of what was requested for the frame
+    uint32_t requests;
+    utString path;
+
+    int width;
+    int height;
+    uint32_t frame;
+
+    // The pixel pack buffer read into, 0 if read synchronously
+    GLuint buffer;
 
+    BitmapData *bitmap;
+    utByteArray *png;
+};
+
+// Readbacks waiting on the GPU, only touched by the main thread
+static utArray<FramebufferReadback> sReadbacks;
 
-        // If there is a pending screenshot write, do that
-        if (pendingScreenshot[0] != 0) {
-            fb->save(pendingScreenshot);
+// Saving and PNG encoding happen on a worker, sEncodeCount counts the
+// readbacks handed to it and not yet delivered
+static utList<FramebufferReadback> sEncodeQueue;
+static utList<FramebufferReadback> sEncodedQueue;
+static MutexHandle sEncodeMutex = NULL;
+static ThreadHandle sEncodeThread = NULL;
+static bool sEncodeThreadActive = false;
+static int sEncodeCount = 0;
+
+static int __stdcall encodeReadbacks_body(void *param)
+{
+    while (true)
+    {
+        loom_mutex_lock(sEncodeMutex);
+
+        if (sEncodeQueue.empty())
+        {
+            sEncodeThreadActive = false;
+            loom_mutex_unlock(sEncodeMutex);
+            break;
         }
 
-        // If there is a pending data request, do that
-        if (gettingScreenshotData) {
-            utByteArray *retData = stbi_data_png(sTarget.width, sTarget.height, 4 /* RGBA */, fb->getData(), sTarget.width * fb->getBpp());
+        FramebufferReadback readback = sEncodeQueue.front();
+        sEncodeQueue.pop_front();
+        loom_mutex_unlock(sEncodeMutex);
+
+        if (readback.requests & READBACK_SAVE)
+            readback.bitmap->save(readback.path.c_str());
+
+        if (readback.requests & READBACK_PNG)
+            readback.png = stbi_data_png(readback.width, readback.height, 4 /* RGBA */, readback.bitmap->getData(), readback.width * readback.bitmap->getBpp());
+
+        loom_mutex_lock(sEncodeMutex);
+        sEncodedQueue.push_back(readback);
+        loom_mutex_unlock(sEncodeMutex);
+    }
+
+    return 0;
+}
+
+// Hands the read pixels over to the encoder thread, or delivers them
+// right away if only the BitmapData was asked for
+static void encodeReadback(FramebufferReadback &readback)
+{
+    if (!(readback.requests & (READBACK_SAVE | READBACK_PNG)))
+    {
+        loom_mutex_lock(sEncodeMutex);
+        sEncodedQueue.push_back(readback);
+        loom_mutex_unlock(sEncodeMutex);
+        sEncodeCount++;
+        return;
+    }
+
+    loom_mutex_lock(sEncodeMutex);
+    sEncodeQueue.push_back(readback);
+    sEncodeCount++;
 
-            // Send the delegate along
-            _onScreenshotDataDelegate.pushArgument(retData);
+    if (!sEncodeThreadActive)
+    {
+        // A previous worker has let go of the queue and is exiting
+        if (sEncodeThread != NULL)
+            loom_thread_join(sEncodeThread);
+
+        sEncodeThreadActive = true;
+        sEncodeThread = loom_thread_startWithHint(encodeReadbacks_body, NULL, LOOM_THREAD_BACKGROUND);
+    }
+
+    loom_mutex_unlock(sEncodeMutex);
+}
+
+void Graphics::beginReadback()
+{
+    LOOM_PROFILE_SCOPE(gfxBeginReadback);
+
+    if (sEncodeMutex == NULL)
+        sEncodeMutex = loom_mutex_create();
+
+    FramebufferReadback readback;
+    readback.requests = (pendingScreenshot[0] != 0 ? READBACK_SAVE : 0) |
+                        (gettingScreenshotData ? READBACK_PNG : 0) |
+                        (gettingFramebufferData ? READBACK_BITMAP : 0);
+    readback.path = pendingScreenshot;
+    readback.width = sTarget.width;
+    readback.height = sTarget.height;
+    readback.frame = sCurrentFrame;
+    readback.buffer = 0;
+    readback.bitmap = NULL;
+    readback.png = NULL;
+
+    if (readback.width <= 0 || readback.height <= 0)
+    {
+        lmLogError(gGFXLogGroup, "Graphics dimensions invalid %d x %d: %s", readback.width, readback.height, SDL_GetError());
+        return;
+    }
+
+    if (!sAsyncReadbackSupported)
+    {
+        // Without pixel buffers the read waits on the GPU, only the
+        // encoding is taken off the main thread
+        readback.bitmap = const_cast<BitmapData*>(BitmapData::fromFramebuffer());
+        if (readback.bitmap != NULL)
+            encodeReadback(readback);
+        return;
+    }
+
+    GL_Context *ctx = context();
+
+    ctx->glGenBuffers(1, &readback.buffer);
+    ctx->glBindBuffer(GFX_GL_PIXEL_PACK_BUFFER, readback.buffer);
+    ctx->glBufferData(GFX_GL_PIXEL_PACK_BUFFER, readback.width * readback.height * 4, NULL, GFX_GL_STREAM_READ);
+    ctx->glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    ctx->glReadPixels(0, 0, readback.width, readback.height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    ctx->glBindBuffer(GFX_GL_PIXEL_PACK_BUFFER, 0);
+
+    sReadbacks.push_back(readback);
+}
+
+void Graphics::updateReadbacks(bool finish)
+{
+    if (sReadbacks.size() > 0)
+    {
+        LOOM_PROFILE_SCOPE(gfxMapReadback);
+
+        GL_Context *ctx = context();
+
+        for (UTsize i = 0; i < sReadbacks.size(); i++)
+        {
+            FramebufferReadback &readback = sReadbacks[i];
+            if (!finish && sCurrentFrame - readback.frame < GFX_READBACK_FRAMES)
+                continue;
+
+            ctx->glBindBuffer(GFX_GL_PIXEL_PACK_BUFFER, readback.buffer);
+            const void *rows = ctx->glMapBufferRange(GFX_GL_PIXEL_PACK_BUFFER, 0, readback.width * readback.height * 4, GFX_GL_MAP_READ_BIT);
+            if (rows != NULL)
+            {
+                readback.bitmap = BitmapData::fromFramebufferRows(rows, readback.width, readback.height);
+                ctx->glUnmapBuffer(GFX_GL_PIXEL_PACK_BUFFER);
+            }
+            else
+            {
+                lmLogError(gGFXLogGroup, "Unable to map the framebuffer readback");
+            }
+            ctx->glBindBuffer(GFX_GL_PIXEL_PACK_BUFFER, 0);
+            ctx->glDeleteBuffers(1, &readback.buffer);
+
+            if (readback.bitmap != NULL)
+                encodeReadback(readback);
+
+            sReadbacks.erase(i, true);
+            i--;
+        }
+    }
+
+    if (sEncodeCount == 0)
+        return;
+
+    // Block on the encoder when finishing, nothing is dropped
+    if (finish)
+    {
+        if (sEncodeThread != NULL)
+            loom_thread_join(sEncodeThread);
+        sEncodeThread = NULL;
+    }
+
+    while (true)
+    {
+        loom_mutex_lock(sEncodeMutex);
+        if (sEncodedQueue.empty())
+        {
+            loom_mutex_unlock(sEncodeMutex);
+            break;
+        }
+        FramebufferReadback readback = sEncodedQueue.front();
+        sEncodedQueue.pop_front();
+        loom_mutex_unlock(sEncodeMutex);
+
+        sEncodeCount--;
+
+        if (readback.png != NULL)
+        {
+            _onScreenshotDataDelegate.pushArgument(readback.png);
             _onScreenshotDataDelegate.invoke();
         }
 
-        pendingScreenshot[0] = 0;
-        gettingScreenshotData = false;
+        // The BitmapData is owned by script once delivered
+        if ((readback.requests & READBACK_BITMAP) && _onFramebufferDataDelegate.getCount() > 0)
+        {
+            lualoom_pushnative<BitmapData>(_onFramebufferDataDelegate.getVM(), readback.bitmap);
+            _onFramebufferDataDelegate.incArgCount();
+            _onFramebufferDataDelegate.invoke();
+        }
+        else
+        {
+            lmDelete(NULL, readback.bitmap);
+        }
     }
 }
 
+bool Graphics::isScreenshotPending()
+{
+    return pendingScreenshot[0] != 0 || gettingScreenshotData || gettingFramebufferData ||
+           sReadbacks.size() > 0 || sEncodeCount > 0;
+}
+
 int Graphics::render(lua_State *L)
 {
     // Get arguments
@@ -309,6 +886,9 @@ int Graphics::render(lua_State *L)
         object->transformMatrix.copyFrom(matrix);
     }
 
+    // World matrices cached under the old parent and transform are stale
+    Loom2D::DisplayObject::sTransformVersion++;
+
     lmscalar prevAlpha = object->alpha;
     object->alpha = prevAlpha*alpha;
 
@@ -322,11 +902,110 @@ int Graphics::render(lua_State *L)
     // Restore state
     object->parent = prevParent;
     if (matrix != NULL) object->transformMatrix.copyFrom(&prevTransformMatrix);
+    Loom2D::DisplayObject::sTransformVersion++;
     object->alpha = prevAlpha;
 
     return 0;
 }
 
+static ThreadHandle sPresentThread = NULL;
+static SemaphoreHandle sPresentRequest;
+static SemaphoreHandle sPresentDone;
+static SDL_Window *sPresentWindow = NULL;
+static SDL_GLContext sPresentContext = NULL;
+static bool sPresentQuit = false;
+
+static int __stdcall presentThread_body(void *param)
+{
+    loom_thread_setDebugName("LoomPresent");
+
+    while (true)
+    {
+        loom_semaphore_wait(sPresentRequest);
+
+        if (sPresentQuit)
+            break;
+
+        SDL_GL_MakeCurrent(sPresentWindow, sPresentContext);
+        SDL_GL_SwapWindow(sPresentWindow);
+        SDL_GL_MakeCurrent(sPresentWindow, NULL);
+
+        loom_semaphore_post(sPresentDone);
+    }
+
+    return 0;
+}
+
+void Graphics::present(SDL_Window *window)
+{
+#ifndef __EMSCRIPTEN__
+    if (sThreadedPresent)
+    {
+        if (sPresentThread == NULL)
+        {
+            sPresentRequest = loom_semaphore_create();
+            sPresentDone = loom_semaphore_create();
+            sPresentQuit = false;
+            sPresentThread = loom_thread_startWithHint(presentThread_body, NULL, LOOM_THREAD_LATENCY_CRITICAL);
+        }
+
+        // Hand the context over, GL calls on this thread
+        // wait for it to come back through context()
+        sPresentWindow = window;
+        sPresentContext = SDL_GL_GetCurrentContext();
+        SDL_GL_MakeCurrent(window, NULL);
+
+        sPresentPending = true;
+        loom_semaphore_post(sPresentRequest);
+        return;
+    }
+#endif
+
+    SDL_GL_SwapWindow(window);
+}
+
+void Graphics::waitForPresent()
+{
+    LOOM_PROFILE_SCOPE(waitForPresent);
+
+    sPresentPending = false;
+    loom_semaphore_wait(sPresentDone);
+    SDL_GL_MakeCurrent(sPresentWindow, sPresentContext);
+}
+
+void Graphics::setPremultipliedAlpha(bool enabled)
+{
+    sPremultipliedAlpha = enabled;
+
+    // Images are premultiplied as they are decoded on the asset threads
+    loom_asset_imageSetPremultiply(enabled ? 1 : 0);
+}
+
+void Graphics::setThreadedPresent(bool enabled)
+{
+    if (!enabled && sPresentPending)
+        waitForPresent();
+
+    sThreadedPresent = enabled;
+}
+
+void Graphics::stopPresentThread()
+{
+    if (sPresentThread == NULL)
+        return;
+
+    if (sPresentPending)
+        waitForPresent();
+
+    sPresentQuit = true;
+    loom_semaphore_post(sPresentRequest);
+    loom_thread_join(sPresentThread);
+    sPresentThread = NULL;
+
+    loom_semaphore_destroy(sPresentRequest);
+    loom_semaphore_destroy(sPresentDone);
+}
+
 static int _scount = 0;
 void Graphics::handleContextLoss()
 {
@@ -336,6 +1015,12 @@ void Graphics::handleContextLoss()
 
     lmLogDebug(gGFXLogGroup, "Handle context loss: Shutdown %i", _scount++);
 
+    // Pixel buffers of readbacks in flight are gone with the context
+    sReadbacks.clear();
+
+    // So are the timer queries
+    GPUTimer::reset();
+
     // make sure the QuadRenderer resources are freed before we shutdown
     QuadRenderer::destroyGraphicsResources();
     VectorRenderer::destroyGraphicsResources();
@@ -362,6 +1047,11 @@ void Graphics::screenshotData()
     gettingScreenshotData = true;
 }
 
+void Graphics::framebufferData()
+{
+    gettingFramebufferData = true;
+}
+
 
 void Graphics::setDebug(int flags)
 {
@@ -393,6 +1083,9 @@ bool Graphics::checkClipRect(int x, int y, int width, int height)
 
 void Graphics::setClipRect(int x, int y, int width, int height)
 {
+    if (FrameCapture::isCapturing())
+        FrameCapture::recordClip(x, y, width, height);
+
     if (x < 0)
     {
         width += x;
@@ -411,15 +1104,21 @@ void Graphics::setClipRect(int x, int y, int width, int height)
     sTarget.clipWidth = width;
     sTarget.clipHeight = height;
 
-    context()->glEnable(GL_SCISSOR_TEST);
-    context()->glScissor(x, sTarget.height-height-y, width, height);
+    if (Graphics_CacheEnable(GL_SCISSOR_TEST, true))
+        context()->glEnable(GL_SCISSOR_TEST);
+    if (Graphics_CacheScissor(x, sTarget.height-height-y, width, height))
+        context()->glScissor(x, sTarget.height-height-y, width, height);
 }
 
 void Graphics::clearClipRect()
 {
+    if (FrameCapture::isCapturing())
+        FrameCapture::recordClip(0, 0, -1, -1);
+
     sTarget.clipX = sTarget.clipY = 0;
     sTarget.clipWidth = sTarget.clipHeight = -1;
-    context()->glDisable(GL_SCISSOR_TEST);
+    if (Graphics_CacheEnable(GL_SCISSOR_TEST, false))
+        context()->glDisable(GL_SCISSOR_TEST);
 }
 
 }
@@ -51,6 +51,7 @@
 #endif
 
 #include "loom/script/native/lsNativeDelegate.h"
+#include "loom/common/core/allocator.h"
 #include "loom/common/core/assert.h"
 #include "loom/common/core/performance.h"
 #include "loom/common/core/log.h"
@@ -162,6 +163,10 @@ namespace GFX
 #endif
 
 #include "gfxGLES2EntryPoints.h"
+#include "gfxGLInstancingEntryPoints.h"
+#include "gfxGLProgramBinaryEntryPoints.h"
+#include "gfxGLMapBufferEntryPoints.h"
+#include "gfxGLTimerQueryEntryPoints.h"
 #undef GFX_PROC
 #undef GFX_PROC_VOID
     } GL_Context;
@@ -186,7 +191,11 @@ typedef struct GraphicsRenderTarget {
     int clipWidth;
     int clipHeight;
 
-    GraphicsRenderTarget() : width(0), height(0), flags(0), fillColor(0x000000FF), clipX(0), clipY(0), clipWidth(-1), clipHeight(-1) {};
+    // QuadRenderer stencil masks, each target has a stencil buffer of its own
+    int maskDepth;
+    int maskMode;
+
+    GraphicsRenderTarget() : width(0), height(0), flags(0), fillColor(0x000000FF), clipX(0), clipY(0), clipWidth(-1), clipHeight(-1), maskDepth(0), maskMode(0) {};
 
 } GraphicsRenderTarget;
 
@@ -201,11 +210,18 @@ public:
     // Delegate that provides screenshot data (in PNG format) when screenshotData is called
     LOOM_STATICDELEGATE(onScreenshotData);
 
+    // Delegate that provides a BitmapData of the framebuffer when framebufferData is called
+    LOOM_STATICDELEGATE(onFramebufferData);
+
     static const uint32_t FLAG_INVERTED = 1 << 0;
     static const uint32_t FLAG_NOCLEAR  = 1 << 1;
 
     static GL_Context *context()
     {
+        // The present thread owns the context until the swap is done
+        if (sPresentPending)
+            waitForPresent();
+
         return &_context;
     }
 
@@ -222,15 +238,64 @@ public:
     static void reset(int width, int height, uint32_t flags = 0);
 
     static void shutdown();
+
+    // Renders to a framebuffer of its own instead of the window's, for
+    // running without a visible window. Returns false if the driver
+    // can't provide a complete one, frames go to the window then
+    static bool createOffscreenFramebuffer(int width, int height);
     
     static bool queryExtension(const char *extName);
 
+    // True if the optional instancing entry points
+    // (glDrawElementsInstanced, glVertexAttribDivisor) can be used
+    static bool supportsInstancing() { return sInstancingSupported; }
+
+    // True if pixel data can be uploaded through GL_PIXEL_UNPACK_BUFFER
+    static bool supportsPixelBuffers() { return sPixelBuffersSupported; }
+
+    // True if linked programs can be saved and restored through
+    // glGetProgramBinary and glProgramBinary
+    static bool supportsProgramBinary() { return sProgramBinarySupported; }
+
+    // True if the framebuffer can be read into a pixel buffer and mapped
+    // frames later, without waiting for the GPU to finish drawing it
+    static bool supportsAsyncReadback() { return sAsyncReadbackSupported; }
+
+    // True if GPU timestamps can be recorded with glQueryCounter
+    static bool supportsTimerQueries() { return sTimerQueriesSupported; }
+
+    // True if glGenerateMipmap can build mipmap chains on the GPU
+    static bool supportsGenerateMipmap() { return sGenerateMipmapSupported; }
+
     static void beginFrame();
     static void pushRenderTarget();
     static void popRenderTarget();
     static void applyRenderTarget(bool initial = true);
     static void endFrame();
 
+    // True between pushRenderTarget and the matching popRenderTarget
+    static bool isRenderTargetPushed() { return sTargetStack.size() > 0; }
+
+    // Swaps the window, on the present thread with threadedPresent
+    // set, so the next frame can start while the driver is still
+    // flushing and waiting for vsync
+    static void present(SDL_Window *window);
+
+    static bool getThreadedPresent() { return sThreadedPresent; }
+    static void setThreadedPresent(bool enabled);
+
+    // Draws the render stats of each frame over it, the overlay
+    // itself is not counted in them
+    static bool getStatsOverlay() { return sStatsOverlay; }
+    static void setStatsOverlay(bool enabled) { sStatsOverlay = enabled; }
+
+    // Draws with premultiplied alpha: images are premultiplied when
+    // decoded, blend modes use premultiplied factors and quad vertex
+    // colors are premultiplied when flushed. Set it before any texture
+    // is loaded, the ones loaded before aren't converted.
+    static bool getPremultipliedAlpha() { return sPremultipliedAlpha; }
+    static void setPremultipliedAlpha(bool enabled);
+
     static int render(lua_State *L);
     //static void render(void *object, void *matrix, float alpha);
 
@@ -238,6 +303,10 @@ public:
 
     static inline uint32_t getCurrentFrame() { return sCurrentFrame; }
 
+    // Frame allocator for temporaries on the main thread, blocks stay
+    // valid until the end of the next frame and needn't be freed
+    static loom_allocator_t *getFrameAllocator();
+
     static inline void setNativeSize(int width, int height)
     {
         sTarget.width = width;
@@ -264,11 +333,20 @@ public:
     static void setDebug(int flags);
     static void screenshot(const char *path);
     static void screenshotData();
+    static void framebufferData();
+
+    // True from the time a screenshot or framebuffer data is requested
+    // until it's delivered, frames have to keep ending until then
+    static bool isScreenshotPending();
     static void setFillColor(unsigned int color);
     static unsigned int getFillColor();
 
     static int getBackFramebuffer() { return sBackFramebuffer; }
 
+    // Framebuffer render targets return to once done, the Stage points
+    // it at its preserved texture while redrawing dirty regions
+    static void setBackFramebuffer(int framebuffer) { sBackFramebuffer = framebuffer; }
+
     // Returns true if input rectangle is equal to current clip rect
     static bool checkClipRect(int x, int y, int width, int height);
 
@@ -283,11 +361,60 @@ private:
     // Once the Graphics system is initialized, this will be true!
     static bool sInitialized;
 
+    // Per frame temporaries, advanced at endFrame
+    static loom_allocator_t *sFrameAllocator;
+
     // If we're currently in a OpenGL context loss situation (the application has changed orientation, etc), 
     // this will be true.  Once we're recovering the graphics subsystem will need to recreate vertex/index buffers, 
     // texture resources, etc
     static bool sContextLost;    
 
+    // If the GL context provides instanced drawing
+    static bool sInstancingSupported;
+
+    // If the GL context provides pixel unpack buffers
+    static bool sPixelBuffersSupported;
+
+    // If the GL context can save and restore program binaries
+    static bool sProgramBinarySupported;
+
+    // If the GL context can map pixel pack buffers for reading
+    static bool sAsyncReadbackSupported;
+
+    // If the GL context can record GPU timestamps
+    static bool sTimerQueriesSupported;
+    static bool sGenerateMipmapSupported;
+
+    // If the swap is done on the present thread
+    static bool sThreadedPresent;
+
+    // Set while the present thread owns the context
+    static bool sPresentPending;
+
+    static bool sStatsOverlay;
+    static void drawStatsOverlay();
+
+    static bool sPremultipliedAlpha;
+
+    // Framebuffer and its color and depth stencil renderbuffers,
+    // created by createOffscreenFramebuffer
+    static GLuint sOffscreenFramebuffer;
+    static GLuint sOffscreenRenderbuffers[2];
+
+    // Waits for the present thread to finish the swap and takes the
+    // context back
+    static void waitForPresent();
+
+    // Stops the present thread once its swap is done
+    static void stopPresentThread();
+
+    // Reads the framebuffer for the screenshot requests of this frame
+    static void beginReadback();
+
+    // Collects the readbacks that have had time to finish, all of them
+    // if finish is set, and delivers the encoded ones
+    static void updateReadbacks(bool finish);
+
     // The current frame counter
     static uint32_t sCurrentFrame;
     
@@ -312,6 +439,9 @@ private:
     // If set, at the next opportunity we will get screenshot data and return it with the onScreenshotData delegate
     static bool gettingScreenshotData;
 
+    // If set, at the next opportunity we will read the framebuffer and return it with the onFramebufferData delegate
+    static bool gettingFramebufferData;
+
     static GL_Context _context;
 
 };
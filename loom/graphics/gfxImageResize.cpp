@@ -0,0 +1,332 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/graphics/gfxImageResize.h"
+#include "loom/common/core/allocator.h"
+#include "loom/common/core/assert.h"
+#include "loom/script/runtime/lsProfiler.h"
+
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GFX_RESIZE_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define GFX_RESIZE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace GFX
+{
+
+// Weights are fixed point with this many fractional bits, the products of
+// all the taps of a pixel sum up in 32 bits with room to spare
+static const int WEIGHT_BITS = 14;
+static const int WEIGHT_ONE = 1 << WEIGHT_BITS;
+
+static const float PI = 3.14159265358979f;
+
+// Every destination pixel of an axis reads taps source pixels from start
+struct ResizeAxis
+{
+    int taps;
+    int *start;
+    int16_t *weights;   // taps per destination pixel
+};
+
+static float filterSupport(ImageResizeFilter filter)
+{
+    return filter == IMAGE_RESIZE_LANCZOS3 ? 3.0f : 1.0f;
+}
+
+static float filterWeight(ImageResizeFilter filter, float x)
+{
+    x = fabsf(x);
+
+    if (filter == IMAGE_RESIZE_BILINEAR)
+        return x < 1.0f ? 1.0f - x : 0.0f;
+
+    if (x < 1e-5f)
+        return 1.0f;
+    if (x >= 3.0f)
+        return 0.0f;
+
+    float px = PI * x;
+    return 3.0f * sinf(px) * sinf(px / 3.0f) / (px * px);
+}
+
+static void initAxis(ResizeAxis &axis, int srcSize, int dstSize, ImageResizeFilter filter)
+{
+    float scale = (float)dstSize / (float)srcSize;
+    float stretch = scale < 1.0f ? 1.0f / scale : 1.0f;
+    float radius = filterSupport(filter) * stretch;
+
+    axis.taps = (int)ceilf(radius) * 2 + 1;
+    if (axis.taps > srcSize)
+        axis.taps = srcSize;
+
+    axis.start = (int*)lmAlloc(NULL, sizeof(int) * dstSize);
+    axis.weights = (int16_t*)lmAlloc(NULL, sizeof(int16_t) * dstSize * axis.taps);
+
+    float *weights = (float*)lmAlloc(NULL, sizeof(float) * axis.taps);
+
+    for (int i = 0; i < dstSize; i++)
+    {
+        float center = (i + 0.5f) / scale;
+
+        // Keep the taps inside the image, the pixels past the edges get
+        // no weight and the rest is normalized
+        int start = (int)floorf(center - axis.taps * 0.5f + 0.5f);
+        if (start < 0)
+            start = 0;
+        if (start > srcSize - axis.taps)
+            start = srcSize - axis.taps;
+        axis.start[i] = start;
+
+        float total = 0.0f;
+        for (int k = 0; k < axis.taps; k++)
+        {
+            weights[k] = filterWeight(filter, (start + k + 0.5f - center) / stretch);
+            total += weights[k];
+        }
+
+        // Round to fixed point, the error goes to the heaviest tap so
+        // they sum up to exactly one
+        int16_t *fixed = axis.weights + i * axis.taps;
+        int sum = 0, heaviest = 0;
+        for (int k = 0; k < axis.taps; k++)
+        {
+            float w = total != 0.0f ? weights[k] / total : (k == 0 ? 1.0f : 0.0f);
+            fixed[k] = (int16_t)floorf(w * WEIGHT_ONE + 0.5f);
+            sum += fixed[k];
+            if (fixed[k] > fixed[heaviest])
+                heaviest = k;
+        }
+        fixed[heaviest] += (int16_t)(WEIGHT_ONE - sum);
+    }
+
+    lmFree(NULL, weights);
+}
+
+static void freeAxis(ResizeAxis &axis)
+{
+    lmFree(NULL, axis.start);
+    lmFree(NULL, axis.weights);
+}
+
+static inline uint8_t toByte(int sum)
+{
+    sum = (sum + (WEIGHT_ONE >> 1)) >> WEIGHT_BITS;
+    return (uint8_t)(sum < 0 ? 0 : (sum > 255 ? 255 : sum));
+}
+
+// Filters a row of width RGBA pixels into axis-many output pixels in
+// plain C, the reference the vector kernels are checked against
+static void resizeRowScalar(const uint8_t *src, uint8_t *dst, int dstWidth, const ResizeAxis &axis)
+{
+    for (int x = 0; x < dstWidth; x++)
+    {
+        const uint8_t *in = src + axis.start[x] * 4;
+        const int16_t *w = axis.weights + x * axis.taps;
+        int sum[4] = { 0, 0, 0, 0 };
+
+        for (int k = 0; k < axis.taps; k++)
+        {
+            for (int c = 0; c < 4; c++)
+                sum[c] += in[k * 4 + c] * w[k];
+        }
+        for (int c = 0; c < 4; c++)
+            dst[x * 4 + c] = toByte(sum[c]);
+    }
+}
+
+static void resizeRow(const uint8_t *src, uint8_t *dst, int dstWidth, const ResizeAxis &axis)
+{
+#if GFX_RESIZE_SSE2 || GFX_RESIZE_NEON
+    for (int x = 0; x < dstWidth; x++)
+    {
+        const uint8_t *in = src + axis.start[x] * 4;
+        const int16_t *w = axis.weights + x * axis.taps;
+        int k = 0;
+
+#if GFX_RESIZE_SSE2
+        // Two taps per step, channels of both interleaved to multiply
+        // and add against their weights at once
+        const __m128i zero = _mm_setzero_si128();
+        __m128i acc = _mm_setzero_si128();
+        for (; k + 2 <= axis.taps; k += 2)
+        {
+            __m128i a = _mm_cvtsi32_si128(*(const int*)(in + k * 4));
+            __m128i b = _mm_cvtsi32_si128(*(const int*)(in + k * 4 + 4));
+            __m128i ab = _mm_unpacklo_epi8(_mm_unpacklo_epi8(a, b), zero);
+            __m128i weights = _mm_set1_epi32((int)(((uint32_t)(uint16_t)w[k + 1] << 16) | (uint16_t)w[k]));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(ab, weights));
+        }
+        for (; k < axis.taps; k++)
+        {
+            __m128i a = _mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128(*(const int*)(in + k * 4)), zero), zero);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(a, _mm_set1_epi32((uint16_t)w[k])));
+        }
+        acc = _mm_srai_epi32(_mm_add_epi32(acc, _mm_set1_epi32(WEIGHT_ONE >> 1)), WEIGHT_BITS);
+        acc = _mm_packs_epi32(acc, acc);
+        *(int*)(dst + x * 4) = _mm_cvtsi128_si32(_mm_packus_epi16(acc, acc));
+#elif GFX_RESIZE_NEON
+        int32x4_t acc = vdupq_n_s32(0);
+        for (; k < axis.taps; k++)
+        {
+            uint8x8_t pixel = vreinterpret_u8_u32(vld1_dup_u32((const uint32_t*)(in + k * 4)));
+            acc = vmlal_n_s16(acc, vget_low_s16(vreinterpretq_s16_u16(vmovl_u8(pixel))), w[k]);
+        }
+        uint8x8_t out = vqmovn_u16(vcombine_u16(vqrshrun_n_s32(acc, WEIGHT_BITS), vdup_n_u16(0)));
+        vst1_lane_u32((uint32_t*)(dst + x * 4), vreinterpret_u32_u8(out), 0);
+#endif
+    }
+#else
+    resizeRowScalar(src, dst, dstWidth, axis);
+#endif
+}
+
+// Blends bytes first..bytes of taps rows from rows[0..taps) into dst
+static void resizeColumnScalar(const uint8_t **rows, const int16_t *w, int taps, uint8_t *dst, int first, int bytes)
+{
+    for (int i = first; i < bytes; i++)
+    {
+        int sum = 0;
+        for (int k = 0; k < taps; k++)
+            sum += rows[k][i] * w[k];
+        dst[i] = toByte(sum);
+    }
+}
+
+// Blends taps rows of bytes bytes from rows[0..taps) into dst
+static void resizeColumn(const uint8_t **rows, const int16_t *w, int taps, uint8_t *dst, int bytes)
+{
+    int i = 0;
+
+#if GFX_RESIZE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi32(WEIGHT_ONE >> 1);
+    for (; i + 8 <= bytes; i += 8)
+    {
+        __m128i lo = half, hi = half;
+        int k = 0;
+        for (; k + 2 <= taps; k += 2)
+        {
+            __m128i a = _mm_loadl_epi64((const __m128i*)(rows[k] + i));
+            __m128i b = _mm_loadl_epi64((const __m128i*)(rows[k + 1] + i));
+            __m128i ab = _mm_unpacklo_epi8(a, b);
+            __m128i weights = _mm_set1_epi32((int)(((uint32_t)(uint16_t)w[k + 1] << 16) | (uint16_t)w[k]));
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi8(ab, zero), weights));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi8(ab, zero), weights));
+        }
+        if (k < taps)
+        {
+            __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(rows[k] + i)), zero);
+            __m128i weights = _mm_set1_epi32((uint16_t)w[k]);
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, zero), weights));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, zero), weights));
+        }
+        __m128i packed = _mm_packs_epi32(_mm_srai_epi32(lo, WEIGHT_BITS), _mm_srai_epi32(hi, WEIGHT_BITS));
+        _mm_storel_epi64((__m128i*)(dst + i), _mm_packus_epi16(packed, packed));
+    }
+#elif GFX_RESIZE_NEON
+    for (; i + 8 <= bytes; i += 8)
+    {
+        int32x4_t lo = vdupq_n_s32(0), hi = vdupq_n_s32(0);
+        for (int k = 0; k < taps; k++)
+        {
+            int16x8_t v = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(rows[k] + i)));
+            lo = vmlal_n_s16(lo, vget_low_s16(v), w[k]);
+            hi = vmlal_n_s16(hi, vget_high_s16(v), w[k]);
+        }
+        vst1_u8(dst + i, vqmovn_u16(vcombine_u16(vqrshrun_n_s32(lo, WEIGHT_BITS), vqrshrun_n_s32(hi, WEIGHT_BITS))));
+    }
+#endif
+
+    resizeColumnScalar(rows, w, taps, dst, i, bytes);
+}
+
+static void resample(const uint8_t *src, int srcWidth, int srcHeight,
+                     uint8_t *dst, int dstWidth, int dstHeight,
+                     ImageResizeFilter filter, bool vector)
+{
+    lmAssert(srcWidth > 0 && srcHeight > 0 && dstWidth > 0 && dstHeight > 0, "Resizing an empty image");
+
+    ResizeAxis horizontal, vertical;
+    initAxis(horizontal, srcWidth, dstWidth, filter);
+    initAxis(vertical, srcHeight, dstHeight, filter);
+
+    // Only the source rows some destination row reads are filtered
+    int rowBytes = dstWidth * 4;
+    uint8_t *columns = (uint8_t*)lmAlloc(NULL, (size_t)rowBytes * srcHeight);
+    int filtered = 0;
+
+    const uint8_t **rows = (const uint8_t**)lmAlloc(NULL, sizeof(uint8_t*) * vertical.taps);
+
+    for (int y = 0; y < dstHeight; y++)
+    {
+        int start = vertical.start[y];
+        int end = start + vertical.taps;
+
+        if (filtered < start)
+            filtered = start;
+        for (; filtered < end; filtered++)
+        {
+            const uint8_t *in = src + (size_t)filtered * srcWidth * 4;
+            uint8_t *out = columns + (size_t)filtered * rowBytes;
+            if (vector)
+                resizeRow(in, out, dstWidth, horizontal);
+            else
+                resizeRowScalar(in, out, dstWidth, horizontal);
+        }
+
+        for (int k = 0; k < vertical.taps; k++)
+            rows[k] = columns + (size_t)(start + k) * rowBytes;
+
+        const int16_t *w = vertical.weights + y * vertical.taps;
+        if (vector)
+            resizeColumn(rows, w, vertical.taps, dst + (size_t)y * rowBytes, rowBytes);
+        else
+            resizeColumnScalar(rows, w, vertical.taps, dst + (size_t)y * rowBytes, 0, rowBytes);
+    }
+
+    lmFree(NULL, rows);
+    lmFree(NULL, columns);
+    freeAxis(horizontal);
+    freeAxis(vertical);
+}
+
+void resizeImage(const uint8_t *src, int srcWidth, int srcHeight,
+                 uint8_t *dst, int dstWidth, int dstHeight,
+                 ImageResizeFilter filter)
+{
+    LOOM_PROFILE_SCOPE(imageResize);
+
+    resample(src, srcWidth, srcHeight, dst, dstWidth, dstHeight, filter, true);
+}
+
+void resizeImageScalar(const uint8_t *src, int srcWidth, int srcHeight,
+                       uint8_t *dst, int dstWidth, int dstHeight,
+                       ImageResizeFilter filter)
+{
+    resample(src, srcWidth, srcHeight, dst, dstWidth, dstHeight, filter, false);
+}
+
+}
@@ -0,0 +1,53 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+
+namespace GFX
+{
+
+enum ImageResizeFilter
+{
+    IMAGE_RESIZE_BILINEAR,
+    IMAGE_RESIZE_LANCZOS3
+};
+
+/*
+ * Resamples a srcWidth x srcHeight RGBA image into dst, dstWidth x
+ * dstHeight, with tightly packed rows. It's separable, a horizontal pass
+ * into a dstWidth x srcHeight buffer followed by a vertical one, with
+ * 14 bit fixed point weights run through SSE2 or NEON where there is one.
+ * When shrinking, the filter is widened to cover every source pixel.
+ */
+void resizeImage(const uint8_t *src, int srcWidth, int srcHeight,
+                 uint8_t *dst, int dstWidth, int dstHeight,
+                 ImageResizeFilter filter);
+
+/*
+ * The same without SIMD, the reference resizeImage is tested against.
+ */
+void resizeImageScalar(const uint8_t *src, int srcWidth, int srcHeight,
+                       uint8_t *dst, int dstWidth, int dstHeight,
+                       ImageResizeFilter filter);
+
+}
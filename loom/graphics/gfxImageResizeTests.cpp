@@ -0,0 +1,165 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <stdlib.h>
+
+#include "loom/common/core/allocator.h"
+#include "loom/graphics/gfxImageResize.h"
+#include "seatest.h"
+
+using namespace GFX;
+
+SEATEST_FIXTURE(imageResize)
+{
+    SEATEST_FIXTURE_ENTRY(imageResize_matchesScalar);
+    SEATEST_FIXTURE_ENTRY(imageResize_matchesScalarExtremes);
+    SEATEST_FIXTURE_ENTRY(imageResize_solidColor);
+}
+
+// Source and destination sizes: odd widths leave every tail after the 8
+// byte column steps and the 2 tap row steps, 1 pixel edges have a single
+// tap, and both directions are scaled up, down and by odd ratios
+static const int sizes[][4] = {
+    { 1, 1, 1, 1 }, { 1, 1, 7, 5 }, { 7, 5, 1, 1 }, { 1, 9, 3, 9 }, { 9, 1, 9, 3 },
+    { 3, 3, 1, 17 }, { 17, 3, 33, 1 }, { 5, 5, 17, 13 }, { 17, 13, 5, 5 },
+    { 64, 48, 21, 19 }, { 21, 19, 64, 48 }, { 100, 3, 33, 7 }, { 33, 7, 100, 3 },
+    { 127, 63, 128, 64 }, { 128, 64, 127, 63 }, { 256, 16, 3, 2 }
+};
+
+static const int numSizes = sizeof(sizes) / sizeof(sizes[0]);
+
+static const ImageResizeFilter filters[] = { IMAGE_RESIZE_BILINEAR, IMAGE_RESIZE_LANCZOS3 };
+
+static unsigned int resizeTestSeed;
+
+static unsigned int resizeTestRandom()
+{
+    resizeTestSeed = resizeTestSeed * 1103515245 + 12345;
+    return resizeTestSeed >> 8;
+}
+
+// Resizes with resizeImage and the scalar reference, returns the largest
+// difference of any channel between them
+static int resizeDifference(const uint8_t *src, const int *size, ImageResizeFilter filter)
+{
+    size_t bytes = (size_t)size[2] * size[3] * 4;
+    uint8_t *vector = (uint8_t *)lmAlloc(NULL, bytes);
+    uint8_t *scalar = (uint8_t *)lmAlloc(NULL, bytes);
+
+    resizeImage(src, size[0], size[1], vector, size[2], size[3], filter);
+    resizeImageScalar(src, size[0], size[1], scalar, size[2], size[3], filter);
+
+    int largest = 0;
+    for (size_t i = 0; i < bytes; i++)
+    {
+        int difference = abs((int)vector[i] - (int)scalar[i]);
+        if (difference > largest)
+            largest = difference;
+    }
+
+    lmFree(NULL, vector);
+    lmFree(NULL, scalar);
+    return largest;
+}
+
+SEATEST_TEST(imageResize_matchesScalar)
+{
+    resizeTestSeed = 1;
+
+    for (int s = 0; s < numSizes; s++)
+    {
+        size_t bytes = (size_t)sizes[s][0] * sizes[s][1] * 4;
+        uint8_t *src = (uint8_t *)lmAlloc(NULL, bytes);
+
+        for (size_t i = 0; i < bytes; i++)
+            src[i] = (uint8_t)resizeTestRandom();
+
+        for (int f = 0; f < 2; f++)
+            assert_true(resizeDifference(src, sizes[s], filters[f]) <= 1);
+
+        lmFree(NULL, src);
+    }
+}
+
+// Hard edges between 0 and 255 make Lanczos ring past both ends, the
+// kernels have to clamp the same way
+SEATEST_TEST(imageResize_matchesScalarExtremes)
+{
+    for (int s = 0; s < numSizes; s++)
+    {
+        size_t pixels = (size_t)sizes[s][0] * sizes[s][1];
+        uint8_t *src = (uint8_t *)lmAlloc(NULL, pixels * 4);
+
+        for (size_t p = 0; p < pixels; p++)
+        {
+            int x = (int)(p % sizes[s][0]);
+            int y = (int)(p / sizes[s][0]);
+            uint8_t value = ((x + y) & 1) ? 255 : 0;
+
+            src[p * 4 + 0] = value;
+            src[p * 4 + 1] = 255 - value;
+            src[p * 4 + 2] = (x & 2) ? 255 : 0;
+            src[p * 4 + 3] = (y & 2) ? 255 : 0;
+        }
+
+        for (int f = 0; f < 2; f++)
+            assert_true(resizeDifference(src, sizes[s], filters[f]) <= 1);
+
+        lmFree(NULL, src);
+    }
+}
+
+// The weights of every pixel add up to one, so a solid image stays solid
+SEATEST_TEST(imageResize_solidColor)
+{
+    const uint8_t color[4] = { 12, 127, 200, 255 };
+
+    for (int s = 0; s < numSizes; s++)
+    {
+        size_t srcPixels = (size_t)sizes[s][0] * sizes[s][1];
+        size_t dstPixels = (size_t)sizes[s][2] * sizes[s][3];
+        uint8_t *src = (uint8_t *)lmAlloc(NULL, srcPixels * 4);
+        uint8_t *dst = (uint8_t *)lmAlloc(NULL, dstPixels * 4);
+
+        for (size_t p = 0; p < srcPixels; p++)
+        {
+            for (int c = 0; c < 4; c++)
+                src[p * 4 + c] = color[c];
+        }
+
+        for (int f = 0; f < 2; f++)
+        {
+            resizeImage(src, sizes[s][0], sizes[s][1], dst, sizes[s][2], sizes[s][3], filters[f]);
+
+            int largest = 0;
+            for (size_t i = 0; i < dstPixels * 4; i++)
+            {
+                int difference = abs((int)dst[i] - (int)color[i & 3]);
+                if (difference > largest)
+                    largest = difference;
+            }
+
+            assert_true(largest <= 1);
+        }
+
+        lmFree(NULL, src);
+        lmFree(NULL, dst);
+    }
+}
@@ -0,0 +1,177 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/graphics/gfxPixelFormat.h"
+#include "loom/script/runtime/lsProfiler.h"
+
+#include <stddef.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GFX_PIXELFORMAT_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define GFX_PIXELFORMAT_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace GFX
+{
+
+static const uint8_t sBayer[4][4] =
+{
+    {  0,  8,  2, 10 },
+    { 12,  4, 14,  6 },
+    {  3, 11,  1,  9 },
+    { 15,  7, 13,  5 }
+};
+
+// Bits kept of each RGBA channel
+static const int sChannelBits[PIXEL_FORMAT_COUNT][4] =
+{
+    { 8, 8, 8, 8 },
+    { 5, 6, 5, 0 },
+    { 4, 4, 4, 4 }
+};
+
+int pixelFormatBytes(int format)
+{
+    return format == PIXEL_FORMAT_RGBA8888 ? 4 : 2;
+}
+
+// Fills offsets with what's added to the channels of four pixels of row
+// y before they're truncated, a threshold below one step of the channel
+static void ditherRow(int y, int format, bool dither, uint8_t *offsets)
+{
+    for (int x = 0; x < 4; x++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            int bits = sChannelBits[format][c];
+            bool dithered = dither && c < 3 && bits < 8;
+            offsets[x * 4 + c] = dithered ? (uint8_t)(sBayer[y & 3][x] >> (bits - 4)) : 0;
+        }
+    }
+}
+
+static inline uint16_t convertPixel(const uint8_t *p, const uint8_t *offset, int format)
+{
+    int r = p[0] + offset[0], g = p[1] + offset[1], b = p[2] + offset[2], a = p[3];
+    r = r > 255 ? 255 : r;
+    g = g > 255 ? 255 : g;
+    b = b > 255 ? 255 : b;
+
+    if (format == PIXEL_FORMAT_RGB565)
+        return (uint16_t)(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+    return (uint16_t)(((r & 0xF0) << 8) | ((g & 0xF0) << 4) | (b & 0xF0) | (a >> 4));
+}
+
+#if GFX_PIXELFORMAT_SSE2
+// Packs the four RGBA pixels of px into the low halves of their lanes
+static inline __m128i convertPixels4(__m128i px, int format)
+{
+    __m128i out;
+    if (format == PIXEL_FORMAT_RGB565)
+    {
+        out = _mm_slli_epi32(_mm_and_si128(px, _mm_set1_epi32(0xF8)), 8);
+        out = _mm_or_si128(out, _mm_and_si128(_mm_srli_epi32(px, 5), _mm_set1_epi32(0x7E0)));
+        out = _mm_or_si128(out, _mm_and_si128(_mm_srli_epi32(px, 19), _mm_set1_epi32(0x1F)));
+    }
+    else
+    {
+        out = _mm_slli_epi32(_mm_and_si128(px, _mm_set1_epi32(0xF0)), 8);
+        out = _mm_or_si128(out, _mm_and_si128(_mm_srli_epi32(px, 4), _mm_set1_epi32(0xF00)));
+        out = _mm_or_si128(out, _mm_and_si128(_mm_srli_epi32(px, 16), _mm_set1_epi32(0xF0)));
+        out = _mm_or_si128(out, _mm_srli_epi32(px, 28));
+    }
+
+    // Sign extend so the saturating pack leaves the bits as they are
+    return _mm_srai_epi32(_mm_slli_epi32(out, 16), 16);
+}
+#endif
+
+#if GFX_PIXELFORMAT_NEON
+// Packs eight pixels given as their channels, each shifted in below the last
+static inline uint16x8_t convertPixels8(uint8x8_t r, uint8x8_t g, uint8x8_t b, uint8x8_t a, int format)
+{
+    uint16x8_t out = vshll_n_u8(r, 8);
+    if (format == PIXEL_FORMAT_RGB565)
+    {
+        out = vsriq_n_u16(out, vshll_n_u8(g, 8), 5);
+        out = vsriq_n_u16(out, vshll_n_u8(b, 8), 11);
+    }
+    else
+    {
+        out = vsriq_n_u16(out, vshll_n_u8(g, 8), 4);
+        out = vsriq_n_u16(out, vshll_n_u8(b, 8), 8);
+        out = vsriq_n_u16(out, vshll_n_u8(a, 8), 12);
+    }
+    return out;
+}
+#endif
+
+void convertPixels(const uint8_t *src, int width, int height, uint16_t *dst, int format, bool dither)
+{
+    LOOM_PROFILE_SCOPE(pixelConvert);
+
+    uint8_t offsets[16];
+
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t *in = src + (size_t)y * width * 4;
+        uint16_t *out = dst + (size_t)y * width;
+        int x = 0;
+
+        ditherRow(y, format, dither, offsets);
+
+#if GFX_PIXELFORMAT_SSE2
+        // The pattern repeats every four pixels, one register's worth
+        __m128i d = _mm_loadu_si128((const __m128i*)offsets);
+        for (; x + 8 <= width; x += 8)
+        {
+            __m128i a = _mm_adds_epu8(_mm_loadu_si128((const __m128i*)(in + x * 4)), d);
+            __m128i b = _mm_adds_epu8(_mm_loadu_si128((const __m128i*)(in + x * 4 + 16)), d);
+            _mm_storeu_si128((__m128i*)(out + x), _mm_packs_epi32(convertPixels4(a, format), convertPixels4(b, format)));
+        }
+#elif GFX_PIXELFORMAT_NEON
+        uint8_t lanes[4][16];
+        for (int i = 0; i < 16; i++)
+        {
+            for (int c = 0; c < 4; c++)
+                lanes[c][i] = offsets[(i & 3) * 4 + c];
+        }
+        uint8x16_t dr = vld1q_u8(lanes[0]), dg = vld1q_u8(lanes[1]), db = vld1q_u8(lanes[2]);
+        for (; x + 16 <= width; x += 16)
+        {
+            uint8x16x4_t px = vld4q_u8(in + x * 4);
+            uint8x16_t r = vqaddq_u8(px.val[0], dr);
+            uint8x16_t g = vqaddq_u8(px.val[1], dg);
+            uint8x16_t b = vqaddq_u8(px.val[2], db);
+            uint8x16_t a = px.val[3];
+            vst1q_u16(out + x, convertPixels8(vget_low_u8(r), vget_low_u8(g), vget_low_u8(b), vget_low_u8(a), format));
+            vst1q_u16(out + x + 8, convertPixels8(vget_high_u8(r), vget_high_u8(g), vget_high_u8(b), vget_high_u8(a), format));
+        }
+#endif
+
+        for (; x < width; x++)
+            out[x] = convertPixel(in + x * 4, offsets + (x & 3) * 4, format);
+    }
+}
+
+}
@@ -0,0 +1,49 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace GFX
+{
+
+// Formats textures are kept in on the GPU, the reduced ones halve the
+// memory and upload bandwidth of an RGBA8888 texture
+enum PixelFormat
+{
+    PIXEL_FORMAT_RGBA8888 = 0,
+    PIXEL_FORMAT_RGB565,
+    PIXEL_FORMAT_RGBA4444,
+    PIXEL_FORMAT_COUNT
+};
+
+// Bytes per pixel of format
+int pixelFormatBytes(int format);
+
+/*
+ * Converts a width x height RGBA8888 image into the 16 bit pixels of
+ * format, with tightly packed rows, run through SSE2 or NEON where there
+ * is one. Dithering adds a 4x4 ordered (Bayer) pattern before the bits
+ * are dropped so gradients don't band, alpha is never dithered.
+ */
+void convertPixels(const uint8_t *src, int width, int height, uint16_t *dst, int format, bool dither);
+
+}
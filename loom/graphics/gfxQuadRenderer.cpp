@@ -30,10 +30,13 @@
 #include "loom/graphics/gfxMath.h"
 #include "loom/graphics/gfxGraphics.h"
 #include "loom/graphics/gfxQuadRenderer.h"
+#include "loom/graphics/gfxFrameCapture.h"
 #include "loom/graphics/gfxStateManager.h"
+#include "loom/graphics/gfxGPUTimer.h"
 #include "loom/script/runtime/lsProfiler.h"
 
 #include "stdio.h"
+#include <math.h>
 
 namespace GFX
 {
@@ -46,32 +49,651 @@ static GLuint sDstBlend = GL_ONE_MINUS_SRC_ALPHA;
 static bool sBlendEnabled = true;
 
 GLuint QuadRenderer::indexBufferId;
-GLuint QuadRenderer::vertexBufferId;
+GLuint QuadRenderer::cornerBufferId;
+GLuint QuadRenderer::vertexBufferIds[QUADRENDERER_RING_SIZE];
+size_t QuadRenderer::vertexBufferCapacity[QUADRENDERER_RING_SIZE];
+uint32_t QuadRenderer::vertexBufferFrame[QUADRENDERER_RING_SIZE];
+int QuadRenderer::currentVertexBuffer;
+size_t QuadRenderer::vertexBufferOffset;
 VertexPosColorTex* QuadRenderer::batchedVertices;
 size_t QuadRenderer::batchedVertexCount;
+size_t QuadRenderer::batchedVertexCapacity;
 TextureID QuadRenderer::currentTexture;
 
 int QuadRenderer::numFrameSubmit;
+int QuadRenderer::numFrameDraws;
+RenderStats QuadRenderer::frameStats;
+RenderStats QuadRenderer::lastFrameStats;
+uint32_t QuadRenderer::resourceGeneration = 0;
+QuadStaticBatch *QuadRenderer::captureBatch = NULL;
+bool QuadRenderer::captureFailed = false;
+utArray<VertexPosColorTex> QuadRenderer::captureVertices;
+int QuadRenderer::maskDepth = 0;
+MaskMode QuadRenderer::maskMode = MASKMODE_TEST;
 
 static loom_allocator_t *gQuadMemoryAllocator = NULL;
 static bool sTextureStateValid = false;
 static bool sBlendStateValid = false;
 static bool sShaderStateValid = false;
+static bool sMaskStateValid = false;
+static bool sMaskDepthWarned = false;
 
-void QuadRenderer::submit()
+// Textures of the current batch in multi-texture mode, by slot
+struct BatchSlotRange
+{
+    size_t firstVertex;
+    int slot;
+};
+
+static int sMultiTextureUnits = 1;
+static TextureID sBatchTextures[GFX_MAX_BATCH_TEXTURES];
+static int sBatchTextureCount = 0;
+static utArray<BatchSlotRange> sBatchSlotRanges;
+
+// Vertices drawn from an atlas page, with the region their texture
+// coordinates are mapped into on flush
+struct AtlasUVRange
+{
+    size_t firstVertex;
+    size_t vertexCount;
+    float region[4];
+};
+
+static utArray<AtlasUVRange> sAtlasUVRanges;
+
+// Additive vertices drawn with the normal premultiplied blend function,
+// their alpha is cleared on flush so they add without covering
+struct AdditiveRange
+{
+    size_t firstVertex;
+    size_t vertexCount;
+};
+
+static utArray<AdditiveRange> sAdditiveRanges;
+
+// Premultiplies the tint of vertices for premultiplied textures, the
+// default shader multiplies it with the texel as is
+static void premultiplyVertexColors(VertexPosColorTex *v, size_t count)
+{
+    for (size_t i = 0; i < count; i++, v++)
+    {
+        uint32_t a = v->abgr >> 24;
+        if (a == 255)
+            continue;
+
+        uint32_t b = (((v->abgr >> 16) & 0xFF) * a + 127) / 255;
+        uint32_t g = (((v->abgr >> 8) & 0xFF) * a + 127) / 255;
+        uint32_t r = ((v->abgr & 0xFF) * a + 127) / 255;
+        v->abgr = (a << 24) | (b << 16) | (g << 8) | r;
+    }
+}
+
+// Conversion buffer for uploading batches in VERTEXFORMAT_COMPACT
+static VertexPosColorTexCompact *sCompactVertices = NULL;
+static size_t sCompactVertexCapacity = 0;
+
+// Instance records for the instanced path, and whether it's enabled
+static QuadInstance *sInstances = NULL;
+static size_t sInstanceCapacity = 0;
+static bool sInstancedRendering = true;
+
+// How far the last corner of a quad may be from where the other three
+// put it for the quad to still be drawn as an instance
+#define QUADRENDERER_INSTANCE_POS_EPSILON   (1.0f / 64.0f)
+#define QUADRENDERER_INSTANCE_UV_EPSILON    (1.0f / 65536.0f)
+
+// A batch recorded while in deferred mode, vertices live in sDeferredVertices
+struct DeferredQuadBatch
+{
+    uint64_t key;
+    size_t firstVertex;
+    uint32_t vertexCount;
+    TextureID texture;
+    ShaderProgram *shader;
+    bool blendEnabled;
+    uint32_t srcBlend;
+    uint32_t dstBlend;
+};
+
+struct DeferredQuadBounds
+{
+    float minX, minY, maxX, maxY;
+
+    bool overlaps(const DeferredQuadBounds &other) const
+    {
+        return minX < other.maxX && other.minX < maxX &&
+               minY < other.maxY && other.minY < maxY;
+    }
+
+    void merge(const DeferredQuadBounds &other)
+    {
+        minX = minX < other.minX ? minX : other.minX;
+        minY = minY < other.minY ? minY : other.minY;
+        maxX = maxX > other.maxX ? maxX : other.maxX;
+        maxY = maxY > other.maxY ? maxY : other.maxY;
+    }
+};
+
+// Layers are stored in the top 16 bits of the sort key
+#define DEFERRED_MAX_LAYERS 0xFFFF
+
+static bool sDeferredBatching = false;
+static bool sFlushingDeferred = false;
+
+// Set while a shader binds for the batch being drawn, uniforms it sets
+// then apply to that batch
+static bool sBindingShader = false;
+static utArray<DeferredQuadBatch> sDeferredBatches;
+static utArray<DeferredQuadBounds> sDeferredLayerBounds;
+static utArray<uint32_t> sDeferredOrder;
+static VertexPosColorTex *sDeferredVertices = NULL;
+static size_t sDeferredVertexCount = 0;
+static size_t sDeferredVertexCapacity = 0;
+
+// Compresses a GL blend factor into 4 bits for the sort key
+static inline uint64_t blendFactorKey(uint32_t factor)
+{
+    if (factor <= GL_ONE)
+        return factor;
+
+    // GL_SRC_COLOR (0x0300) through GL_SRC_ALPHA_SATURATE (0x0308)
+    uint32_t index = (factor & 0xF) + 2;
+    return index > 0xF ? 0xF : index;
+}
+
+// Sort key layout, most significant first:
+// layer (16) | shader (12) | texture (12) | blend enabled (1) | src (4) | dst (4)
+// Only the low 12 bits of the texture index fit, textures sharing them
+// sort together but are still batched apart.
+static inline uint64_t makeDeferredKey(uint32_t layer, const DeferredQuadBatch &batch)
+{
+    return ((uint64_t)layer << 48) |
+           ((uint64_t)(batch.shader->getProgramId() & 0xFFF) << 36) |
+           ((uint64_t)(batch.texture & 0xFFF) << 24) |
+           ((uint64_t)(batch.blendEnabled ? 1 : 0) << 23) |
+           (blendFactorKey(batch.srcBlend) << 19) |
+           (blendFactorKey(batch.dstBlend) << 15);
+}
+
+// Stable LSD radix sort of sDeferredOrder by batch key, bytes that are
+// the same for every key are skipped
+static void radixSortDeferred()
+{
+    UTsize count = sDeferredBatches.size();
+    const DeferredQuadBatch *batches = sDeferredBatches.ptr();
+
+    uint64_t keyOr = 0, keyAnd = ~(uint64_t)0;
+    for (UTsize i = 0; i < count; i++)
+    {
+        keyOr |= batches[i].key;
+        keyAnd &= batches[i].key;
+    }
+    uint64_t varying = keyOr ^ keyAnd;
+
+    uint32_t *src = sDeferredOrder.ptr();
+    uint32_t *dst = (uint32_t *)lmAlloc(Graphics::getFrameAllocator(), count * sizeof(uint32_t));
+
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        if (((varying >> shift) & 0xFF) == 0)
+            continue;
+
+        UTsize offsets[256];
+        memset(offsets, 0, sizeof(offsets));
+
+        for (UTsize i = 0; i < count; i++)
+            offsets[(batches[src[i]].key >> shift) & 0xFF]++;
+
+        UTsize total = 0;
+        for (int b = 0; b < 256; b++)
+        {
+            UTsize c = offsets[b];
+            offsets[b] = total;
+            total += c;
+        }
+
+        for (UTsize i = 0; i < count; i++)
+            dst[offsets[(batches[src[i]].key >> shift) & 0xFF]++] = src[i];
+
+        uint32_t *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != sDeferredOrder.ptr())
+        memcpy(sDeferredOrder.ptr(), src, count * sizeof(uint32_t));
+}
+
+// Sets up sampling state of the texture on the given texture unit
+static void applyTextureState(int unit, TextureInfo &tinfo)
+{
+    GL_Context* ctx = Graphics::context();
+
+    if (Graphics_CacheActiveTexture(GL_TEXTURE0 + unit))
+        ctx->glActiveTexture(GL_TEXTURE0 + unit);
+    if (Graphics_CacheBindTexture(tinfo.handle))
+    {
+        ctx->glBindTexture(tinfo.target, tinfo.handle);
+        QuadRenderer::frameStats.textureBinds++;
+    }
+
+    if (tinfo.clampOnly) {
+        tinfo.wrapU = TEXTUREINFO_WRAP_CLAMP;
+        tinfo.wrapV = TEXTUREINFO_WRAP_CLAMP;
+    }
+
+    switch (tinfo.wrapU)
+    {
+        case TEXTUREINFO_WRAP_CLAMP:
+            ctx->glTexParameteri(tinfo.target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            break;
+        case TEXTUREINFO_WRAP_MIRROR:
+            ctx->glTexParameteri(tinfo.target, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
+            break;
+        case TEXTUREINFO_WRAP_REPEAT:
+            ctx->glTexParameteri(tinfo.target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            break;
+        default:
+            lmAssert(false, "Unsupported wrapU: %d", tinfo.wrapU);
+    }
+    switch (tinfo.wrapV)
+    {
+        case TEXTUREINFO_WRAP_CLAMP:
+            ctx->glTexParameteri(tinfo.target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            break;
+        case TEXTUREINFO_WRAP_MIRROR:
+            ctx->glTexParameteri(tinfo.target, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+            break;
+        case TEXTUREINFO_WRAP_REPEAT:
+            ctx->glTexParameteri(tinfo.target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            break;
+        default:
+            lmAssert(false, "Unsupported wrapV: %d", tinfo.wrapV);
+    }
+
+    switch (tinfo.smoothing)
+    {
+        case TEXTUREINFO_SMOOTHING_NONE:
+            ctx->glTexParameteri(tinfo.target, GL_TEXTURE_MIN_FILTER, tinfo.mipmaps ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
+            ctx->glTexParameteri(tinfo.target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            break;
+        case TEXTUREINFO_SMOOTHING_BILINEAR:
+            ctx->glTexParameteri(tinfo.target, GL_TEXTURE_MIN_FILTER, tinfo.mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+            ctx->glTexParameteri(tinfo.target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            break;
+        default:
+            lmAssert(false, "Unsupported smoothing: %d", tinfo.smoothing);
+    }
+}
+
+// Sets up the stencil test for the mask nesting depth and mode
+static void applyMaskState(int depth, MaskMode mode)
+{
+    GL_Context *ctx = Graphics::context();
+
+    if (depth == 0)
+    {
+        if (Graphics_CacheEnable(GL_STENCIL_TEST, false))
+            ctx->glDisable(GL_STENCIL_TEST);
+        ctx->glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        return;
+    }
+
+    GLuint bit = 1 << (QUADRENDERER_MASK_FIRST_BIT + depth - 1);
+    GLuint outer = (bit - 1) & ~((1 << QUADRENDERER_MASK_FIRST_BIT) - 1);
+
+    if (Graphics_CacheEnable(GL_STENCIL_TEST, true))
+        ctx->glEnable(GL_STENCIL_TEST);
+
+    switch (mode)
+    {
+    case MASKMODE_WRITE:
+        if (Graphics_CacheStencilFunc(GL_EQUAL, outer | bit, outer))
+            ctx->glStencilFunc(GL_EQUAL, outer | bit, outer);
+        if (Graphics_CacheStencilMask(bit))
+            ctx->glStencilMask(bit);
+        ctx->glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+        ctx->glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        break;
+
+    case MASKMODE_ERASE:
+        if (Graphics_CacheStencilFunc(GL_ALWAYS, 0, 0))
+            ctx->glStencilFunc(GL_ALWAYS, 0, 0);
+        if (Graphics_CacheStencilMask(bit))
+            ctx->glStencilMask(bit);
+        ctx->glStencilOp(GL_KEEP, GL_KEEP, GL_ZERO);
+        ctx->glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        break;
+
+    default:
+        if (Graphics_CacheStencilFunc(GL_EQUAL, outer | bit, outer | bit))
+            ctx->glStencilFunc(GL_EQUAL, outer | bit, outer | bit);
+        if (Graphics_CacheStencilMask(0))
+            ctx->glStencilMask(0);
+        ctx->glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+        ctx->glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        break;
+    }
+}
+
+// Returns the multi-texture variant of a default shader, NULL for
+// any other shader since we can't know how it samples its texture
+static ShaderProgram *getMultiTextureShaderFor(ShaderProgram *shader)
+{
+    // The slot is stored in z, which compact vertices drop
+    if (shader->getVertexFormat() == VERTEXFORMAT_COMPACT)
+        return NULL;
+
+    if (shader == ShaderProgram::getDefaultShader())
+        return ShaderProgram::getMultiTextureShader();
+
+    if (shader == ShaderProgram::getTintlessDefaultShader())
+        return ShaderProgram::getTintlessMultiTextureShader();
+
+    return NULL;
+}
+
+void QuadRenderer::setMultiTextureBatching(bool enabled)
+{
+    submit();
+
+    if (enabled)
+    {
+        MultiTextureShader *shader = static_cast<MultiTextureShader*>(ShaderProgram::getMultiTextureShader());
+        sMultiTextureUnits = shader->getTextureUnits();
+    }
+    else
+    {
+        sMultiTextureUnits = 1;
+    }
+}
+
+bool QuadRenderer::getMultiTextureBatching()
+{
+    return sMultiTextureUnits > 1;
+}
+
+// Returns the instanced variant of a default shader, NULL for any
+// other shader since we can't know what its vertex stage does
+static InstancedQuadShader *getInstancedShaderFor(ShaderProgram *shader)
+{
+    if (shader == ShaderProgram::getDefaultShader())
+        return static_cast<InstancedQuadShader*>(ShaderProgram::getInstancedShader());
+
+    if (shader == ShaderProgram::getTintlessDefaultShader())
+        return static_cast<InstancedQuadShader*>(ShaderProgram::getTintlessInstancedShader());
+
+    return NULL;
+}
+
+// Returns the default shader sampling external textures in place of
+// the shader set, custom shaders can't know to sample them
+static ShaderProgram *getExternalShaderFor(ShaderProgram *shader)
+{
+    if (shader == ShaderProgram::getTintlessDefaultShader())
+        return ShaderProgram::getTintlessExternalShader();
+
+    return ShaderProgram::getExternalShader();
+}
+
+void QuadRenderer::setInstancedRendering(bool enabled)
+{
+    submit();
+
+    sInstancedRendering = enabled;
+}
+
+bool QuadRenderer::getInstancedRendering()
+{
+    return sInstancedRendering && Graphics::supportsInstancing();
+}
+
+int QuadRenderer::getBatchTextureSlot(TextureID texture)
+{
+    // Vertices already in the batch that weren't assigned a slot
+    if (batchedVertexCount > 0 && sBatchTextureCount == 0)
+        return -1;
+
+    for (int i = 0; i < sBatchTextureCount; i++)
+    {
+        if (sBatchTextures[i] == texture)
+            return i;
+    }
+
+    if (sBatchTextureCount >= sMultiTextureUnits)
+        return -1;
+
+    TextureInfo *tinfo = Texture::getTextureInfo(texture);
+    if (!tinfo || tinfo->handle == (GLuint)-1 || !tinfo->visible || tinfo->target != GL_TEXTURE_2D)
+        return -1;
+
+    return sBatchTextureCount;
+}
+
+void QuadRenderer::setDeferredBatching(bool enabled)
+{
+    if (enabled == sDeferredBatching)
+        return;
+
+    // Draw everything queued in the previous mode first
+    submit();
+    sDeferredBatching = enabled;
+}
+
+bool QuadRenderer::getDeferredBatching()
+{
+    return sDeferredBatching;
+}
+
+void QuadRenderer::submit(FlushReason reason)
+{
+    // Whatever needs the barrier would be drawn out of order with the
+    // captured quads
+    if (captureBatch)
+    {
+        captureFailed = true;
+        return;
+    }
+
+    if (FrameCapture::isCapturing())
+        FrameCapture::recordSubmit(reason);
+
+    // Only time submits that draw something, most of them don't
+    bool timed = batchedVertexCount > 0 || sDeferredBatches.size() > 0;
+    if (timed)
+        GPUTimer::begin(GPUTimer::SECTION_QUAD);
+
+    if (sDeferredBatching && !sFlushingDeferred)
+        flushDeferred();
+
+    flushBatch(reason);
+
+    if (timed)
+        GPUTimer::end(GPUTimer::SECTION_QUAD);
+}
+
+void QuadRenderer::submitShader(ShaderProgram *shader)
+{
+    if (sBindingShader)
+        return;
+
+    bool pending = batchedVertexCount > 0 && sCurrentShader != NULL && *sCurrentShader == *shader;
+
+    for (UTsize i = 0; !pending && i < sDeferredBatches.size(); i++)
+        pending = *sDeferredBatches[i].shader == *shader;
+
+    if (pending)
+        submit(FLUSH_SHADER);
+}
+
+VertexPosColorTex *QuadRenderer::recordDeferred(uint32_t vertexCount, TextureID texture, bool blendEnabled, uint32_t srcBlend, uint32_t dstBlend, ShaderProgram *shader)
+{
+    size_t required = sDeferredVertexCount + vertexCount;
+    if (required > sDeferredVertexCapacity)
+    {
+        size_t capacity = sDeferredVertexCapacity ? sDeferredVertexCapacity : QUADRENDERER_INITIAL_QUADS * 4;
+        while (capacity < required)
+            capacity *= 2;
+
+        VertexPosColorTex *newVertices = static_cast<VertexPosColorTex*>(lmRealloc(gQuadMemoryAllocator, sDeferredVertices, capacity * sizeof(VertexPosColorTex)));
+        if (!newVertices)
+        {
+            lmLogError(gGFXQuadRendererLogGroup, "Unable to grow deferred quad memory to %d vertices", (int)capacity);
+            return NULL;
+        }
+
+        sDeferredVertices = newVertices;
+        sDeferredVertexCapacity = capacity;
+    }
+
+    VertexPosColorTex *vertices = &sDeferredVertices[sDeferredVertexCount];
+
+    // Extend the previous batch when the state is the same, this keeps
+    // the queue short for runs of quads from the same atlas
+    if (!sDeferredBatches.empty())
+    {
+        DeferredQuadBatch &last = sDeferredBatches.back();
+        if (last.texture == texture && *last.shader == *shader &&
+            last.blendEnabled == blendEnabled && last.srcBlend == srcBlend && last.dstBlend == dstBlend &&
+            last.firstVertex + last.vertexCount == sDeferredVertexCount)
+        {
+            last.vertexCount += vertexCount;
+            sDeferredVertexCount += vertexCount;
+            return vertices;
+        }
+    }
+
+    DeferredQuadBatch batch;
+    batch.key = 0;
+    batch.firstVertex = sDeferredVertexCount;
+    batch.vertexCount = vertexCount;
+    batch.texture = texture;
+    batch.shader = shader;
+    batch.blendEnabled = blendEnabled;
+    batch.srcBlend = srcBlend;
+    batch.dstBlend = dstBlend;
+    sDeferredBatches.push_back(batch);
+
+    sDeferredVertexCount += vertexCount;
+    return vertices;
+}
+
+void QuadRenderer::flushDeferred()
+{
+    LOOM_PROFILE_SCOPE(quadFlushDeferred);
+
+    UTsize count = sDeferredBatches.size();
+    if (count == 0)
+        return;
+
+    // Assign every batch the lowest layer above all the earlier batches
+    // it overlaps with, batches within a layer never overlap so they
+    // can be drawn in any order.
+    sDeferredLayerBounds.clear(true);
+    sDeferredOrder.resize(count);
+
+    bool layersExhausted = false;
+
+    for (UTsize i = 0; i < count; i++)
+    {
+        DeferredQuadBatch &batch = sDeferredBatches[i];
+
+        const VertexPosColorTex *v = &sDeferredVertices[batch.firstVertex];
+        DeferredQuadBounds bounds = { v->x, v->y, v->x, v->y };
+        for (uint32_t j = 1; j < batch.vertexCount; j++)
+        {
+            v++;
+            if (v->x < bounds.minX) bounds.minX = v->x;
+            if (v->x > bounds.maxX) bounds.maxX = v->x;
+            if (v->y < bounds.minY) bounds.minY = v->y;
+            if (v->y > bounds.maxY) bounds.maxY = v->y;
+        }
+
+        UTsize layer = 0;
+        for (UTsize l = sDeferredLayerBounds.size(); l > 0; l--)
+        {
+            if (sDeferredLayerBounds[l - 1].overlaps(bounds))
+            {
+                layer = l;
+                break;
+            }
+        }
+
+        if (layer == sDeferredLayerBounds.size())
+        {
+            if (layer >= DEFERRED_MAX_LAYERS)
+                layersExhausted = true;
+            sDeferredLayerBounds.push_back(bounds);
+        }
+        else
+        {
+            sDeferredLayerBounds[layer].merge(bounds);
+        }
+
+        batch.key = makeDeferredKey((uint32_t)layer, batch);
+        sDeferredOrder[i] = (uint32_t)i;
+    }
+
+    // Too deep to encode, draw in submission order
+    if (!layersExhausted)
+        radixSortDeferred();
+
+    sFlushingDeferred = true;
+
+    for (UTsize i = 0; i < count; i++)
+    {
+        const DeferredQuadBatch &deferred = sDeferredBatches[sDeferredOrder[i]];
+        batch(&sDeferredVertices[deferred.firstVertex], deferred.vertexCount, deferred.texture, deferred.blendEnabled, deferred.srcBlend, deferred.dstBlend, deferred.shader);
+    }
+
+    sFlushingDeferred = false;
+
+    sDeferredBatches.clear(true);
+    sDeferredVertexCount = 0;
+}
+
+void QuadRenderer::flushBatch(FlushReason reason)
 {
     LOOM_PROFILE_SCOPE(quadSubmit);
 
     if (batchedVertexCount <= 0)
     {
+        sBatchTextureCount = 0;
+        sBatchSlotRanges.clear(true);
         return;
     }
 
     numFrameSubmit++;
+    frameStats.flushes[reason]++;
+
+    if (Graphics::getPremultipliedAlpha())
+    {
+        premultiplyVertexColors(batchedVertices, batchedVertexCount);
+
+        for (UTsize i = 0; i < sAdditiveRanges.size(); i++)
+        {
+            const AdditiveRange &range = sAdditiveRanges[i];
+            VertexPosColorTex *v = &batchedVertices[range.firstVertex];
+            for (size_t j = 0; j < range.vertexCount; j++, v++)
+                v->abgr &= 0x00FFFFFF;
+        }
+    }
+
+    // Map the texture coordinates of packed textures into their page
+    for (UTsize i = 0; i < sAtlasUVRanges.size(); i++)
+    {
+        const AtlasUVRange &range = sAtlasUVRanges[i];
+        VertexPosColorTex *v = &batchedVertices[range.firstVertex];
+        for (size_t j = 0; j < range.vertexCount; j++, v++)
+        {
+            v->u = range.region[0] + v->u * range.region[2];
+            v->v = range.region[1] + v->v * range.region[3];
+        }
+    }
 
     TextureInfo &tinfo = *Texture::getTextureInfo(currentTexture);
 
-    if (tinfo.handle != -1)
+    if (tinfo.handle != (GLuint)-1)
     {
         if (tinfo.visible) {
 
@@ -88,76 +710,98 @@ void QuadRenderer::submit()
                 sShaderStateValid = false;
                 sTextureStateValid = false;
                 sBlendStateValid = false;
+                sMaskStateValid = false;
+                Graphics_ResetGLStateCache();
             }
             
-            ctx->glBindBuffer(GL_ARRAY_BUFFER, vertexBufferId);
+            if (Graphics_CacheBindBuffer(GL_ARRAY_BUFFER, vertexBufferIds[currentVertexBuffer]))
+                ctx->glBindBuffer(GL_ARRAY_BUFFER, vertexBufferIds[currentVertexBuffer]);
             
-            if (!sShaderStateValid)
-            {
-                Loom2D::Matrix mvp;
-                mvp.copyFromMatrix4(Graphics::getMVP());
-                sCurrentShader->setMVP(mvp);
-                sCurrentShader->setTextureId(0);
-                sCurrentShader->bind();
+            bool multiTexture = sBatchTextureCount > 1;
+            ShaderProgram *shader = sCurrentShader;
 
-                sShaderStateValid = true;
-            }
-            
-            if (!sTextureStateValid)
+            // External textures need a sampler of their own
+            bool external = tinfo.target != GL_TEXTURE_2D;
+            if (external)
             {
-                // Set up texture state.
-                ctx->glActiveTexture(GL_TEXTURE0);
-                ctx->glBindTexture(GL_TEXTURE_2D, tinfo.handle);
+                shader = getExternalShaderFor(sCurrentShader);
+                sShaderStateValid = false;
+            }
 
-                if (tinfo.clampOnly) {
-                    tinfo.wrapU = TEXTUREINFO_WRAP_CLAMP;
-                    tinfo.wrapV = TEXTUREINFO_WRAP_CLAMP;
-                }
+            // Draw the batch as instances if all of its quads allow it
+            InstancedQuadShader *instancedShader = NULL;
+            const QuadInstance *instances = NULL;
+            if (!multiTexture && !external && getInstancedRendering())
+            {
+                instancedShader = getInstancedShaderFor(sCurrentShader);
+                if (instancedShader)
+                    instances = buildInstances();
 
-                switch (tinfo.wrapU)
+                if (instances)
                 {
-                    case TEXTUREINFO_WRAP_CLAMP:
-                        ctx->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                        break;
-                    case TEXTUREINFO_WRAP_MIRROR:
-                        ctx->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-                        break;
-                    case TEXTUREINFO_WRAP_REPEAT:
-                        ctx->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-                        break;
-                    default:
-                        lmAssert(false, "Unsupported wrapU: %d", tinfo.wrapU);
+                    shader = instancedShader;
+                    sShaderStateValid = false;
                 }
-                switch (tinfo.wrapV)
+                else
                 {
-                    case TEXTUREINFO_WRAP_CLAMP:
-                        ctx->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-                        break;
-                    case TEXTUREINFO_WRAP_MIRROR:
-                        ctx->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-                        break;
-                    case TEXTUREINFO_WRAP_REPEAT:
-                        ctx->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-                        break;
-                    default:
-                        lmAssert(false, "Unsupported wrapV: %d", tinfo.wrapV);
+                    instancedShader = NULL;
                 }
-                //*/
+            }
 
-                switch (tinfo.smoothing)
+            if (multiTexture)
+            {
+                shader = getMultiTextureShaderFor(sCurrentShader);
+
+                // Store the texture slot of each vertex in its z coordinate
+                UTsize rangeCount = sBatchSlotRanges.size();
+                for (UTsize i = 0; i < rangeCount; i++)
                 {
-                    case TEXTUREINFO_SMOOTHING_NONE:
-                        ctx->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, tinfo.mipmaps ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
-                        ctx->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-                        break;
-                    case TEXTUREINFO_SMOOTHING_BILINEAR:
-                        ctx->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, tinfo.mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
-                        ctx->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                        break;
-                    default:
-                        lmAssert(false, "Unsupported smoothing: %d", tinfo.smoothing);
+                    size_t first = sBatchSlotRanges[i].firstVertex;
+                    size_t last = i + 1 < rangeCount ? sBatchSlotRanges[i + 1].firstVertex : batchedVertexCount;
+                    float slot = (float)sBatchSlotRanges[i].slot;
+
+                    for (size_t v = first; v < last; v++)
+                        batchedVertices[v].z = slot;
                 }
-                
+
+                // Multi-texture draws always set up their own shader and
+                // texture units, the next single texture draw has to as well
+                sShaderStateValid = false;
+                sTextureStateValid = false;
+            }
+
+            if (!sShaderStateValid)
+            {
+                Loom2D::Matrix mvp;
+                mvp.copyFromMatrix4(Graphics::getMVP());
+                shader->setMVP(mvp);
+                shader->setTextureId(0);
+                sBindingShader = true;
+                shader->bind();
+                sBindingShader = false;
+                frameStats.shaderSwitches++;
+
+                // The next regular draw has to bind its own shader again
+                sShaderStateValid = !multiTexture && !instancedShader && !external;
+            }
+            else
+            {
+                // Uniforms set since the shader was bound
+                shader->applyUniforms();
+            }
+
+            if (multiTexture)
+            {
+                for (int i = 0; i < sBatchTextureCount; i++)
+                    applyTextureState(i, *Texture::getTextureInfo(sBatchTextures[i]));
+
+                if (Graphics_CacheActiveTexture(GL_TEXTURE0))
+                    ctx->glActiveTexture(GL_TEXTURE0);
+            }
+            else if (!sTextureStateValid)
+            {
+                applyTextureState(0, tinfo);
+
                 sTextureStateValid = true;
             }
 
@@ -165,73 +809,237 @@ void QuadRenderer::submit()
             {
                 if (sBlendEnabled)
                 {
-                    ctx->glEnable(GL_BLEND);
-                    ctx->glBlendFuncSeparate(sSrcBlend, sDstBlend, sSrcBlend, sDstBlend);
+                    if (Graphics_CacheEnable(GL_BLEND, true))
+                        ctx->glEnable(GL_BLEND);
+                    if (Graphics_CacheBlendFunc(sSrcBlend, sDstBlend, sSrcBlend, sDstBlend))
+                        ctx->glBlendFuncSeparate(sSrcBlend, sDstBlend, sSrcBlend, sDstBlend);
                 }
                 else
                 {
-                    ctx->glDisable(GL_BLEND);
+                    if (Graphics_CacheEnable(GL_BLEND, false))
+                        ctx->glDisable(GL_BLEND);
                 }
 
                 sBlendStateValid = true;
             }
+
+            if (!sMaskStateValid)
+            {
+                applyMaskState(maskDepth, maskMode);
+                sMaskStateValid = true;
+            }
             
-            Graphics::context()->glDisable(GL_CULL_FACE);
+            if (Graphics_CacheEnable(GL_CULL_FACE, false))
+                ctx->glDisable(GL_CULL_FACE);
             
             Graphics_SetCurrentGLState(GFX_OPENGL_STATE_QUAD);
-            
-            // Setting the buffer to null supposedly enables better performance because it enables the driver to do some optimizations.
-            ctx->glBufferData(GL_ARRAY_BUFFER, batchedVertexCount*sizeof(VertexPosColorTex), NULL, GL_STREAM_DRAW);
-            ctx->glBufferData(GL_ARRAY_BUFFER, batchedVertexCount*sizeof(VertexPosColorTex), batchedVertices, GL_STREAM_DRAW);
-
-            // And bind indices and draw.
-            ctx->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferId);
-            ctx->glDrawElements(GL_TRIANGLES,
-                                                (GLsizei)(batchedVertexCount / 4 * 6), GL_UNSIGNED_SHORT,
-                                                NULL);
+
+            // Compact vertices can't hold texture coordinates outside of
+            // [0, 1] or the multi-texture slot, use the full format for those
+            VertexFormat format = (VertexFormat)shader->getVertexFormat();
+            if (format == VERTEXFORMAT_COMPACT &&
+                (multiTexture || tinfo.wrapU != TEXTUREINFO_WRAP_CLAMP || tinfo.wrapV != TEXTUREINFO_WRAP_CLAMP))
+            {
+                format = VERTEXFORMAT_POSCOLORTEX;
+            }
+
+            const void *uploadData = batchedVertices;
+            size_t uploadSize = batchedVertexCount * sizeof(VertexPosColorTex);
+            size_t vertexSize = sizeof(VertexPosColorTex);
+            if (instancedShader)
+            {
+                uploadData = instances;
+                uploadSize = batchedVertexCount / 4 * sizeof(QuadInstance);
+            }
+            else if (format == VERTEXFORMAT_COMPACT)
+            {
+                // Out of memory for the compact copy, upload the full format
+                const VertexPosColorTexCompact *compact = compactBatchedVertices();
+                if (compact != NULL)
+                {
+                    uploadData = compact;
+                    vertexSize = sizeof(VertexPosColorTexCompact);
+                    uploadSize = batchedVertexCount * vertexSize;
+                }
+                else
+                {
+                    format = VERTEXFORMAT_POSCOLORTEX;
+                }
+            }
+
+            // Append the batch after whatever was drawn from this buffer
+            // earlier in the frame, the ranges in use by pending draws are
+            // never touched so the driver does not have to synchronize.
+            reserveVertexBuffer(uploadSize);
+            ctx->glBufferSubData(GL_ARRAY_BUFFER,
+                                 vertexBufferOffset,
+                                 uploadSize,
+                                 uploadData);
+
+            // And bind indices and draw, splitting the batch into as many
+            // draw calls as the 16-bit index buffer requires.
+            if (Graphics_CacheBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferId))
+                ctx->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferId);
+
+            if (instancedShader)
+            {
+                // Every instance uses the first quad of the index buffer,
+                // so instanced batches never have to be split
+                instancedShader->bindInstances(cornerBufferId, vertexBufferIds[currentVertexBuffer], vertexBufferOffset);
+                ctx->glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, NULL, (GLsizei)(batchedVertexCount / 4));
+                numFrameDraws++;
+                frameStats.drawCalls++;
+                instancedShader->unbindInstances();
+            }
+            else
+            {
+                for (size_t drawn = 0; drawn < batchedVertexCount; drawn += MAXBATCHQUADS * 4)
+                {
+                    size_t drawCount = batchedVertexCount - drawn;
+                    if (drawCount > MAXBATCHQUADS * 4)
+                        drawCount = MAXBATCHQUADS * 4;
+
+                    shader->bindAttributes(vertexBufferOffset + drawn * vertexSize, format);
+                    ctx->glDrawElements(GL_TRIANGLES,
+                                        (GLsizei)(drawCount / 4 * 6), GL_UNSIGNED_SHORT,
+                                        NULL);
+                    numFrameDraws++;
+                    frameStats.drawCalls++;
+                    if (drawn > 0)
+                        frameStats.flushes[FLUSH_BUFFERFULL]++;
+                }
+            }
+
+            vertexBufferOffset += uploadSize;
+            frameStats.vertices += (int)batchedVertexCount;
         }
     }
     
     batchedVertexCount = 0;
+    sBatchTextureCount = 0;
+    sBatchSlotRanges.clear(true);
+    sAtlasUVRanges.clear(true);
+    sAdditiveRanges.clear(true);
 }
 
 
-VertexPosColorTex *QuadRenderer::getQuadVertexMemory(uint16_t vertexCount, TextureID texture, bool blendEnabled, uint32_t srcBlend, uint32_t dstBlend, ShaderProgram *shader)
+VertexPosColorTex *QuadRenderer::getQuadVertexMemory(uint32_t vertexCount, TextureID texture, bool blendEnabled, uint32_t srcBlend, uint32_t dstBlend, ShaderProgram *shader)
+{
+    if (!FrameCapture::isCapturing())
+        return allocQuadVertexMemory(vertexCount, texture, blendEnabled, srcBlend, dstBlend, shader);
+
+    // The vertices of the quads recorded before could move while these
+    // are allocated. Replays go through the atlas and deferred batching
+    // again, so the quads are recorded as given.
+    FrameCapture::copyPendingVertices();
+
+    VertexPosColorTex *vertices = allocQuadVertexMemory(vertexCount, texture, blendEnabled, srcBlend, dstBlend, shader);
+    if (vertices && !sFlushingDeferred && !captureBatch)
+        FrameCapture::recordQuads(vertices, vertexCount, texture, blendEnabled, srcBlend, dstBlend, shader);
+
+    return vertices;
+}
+
+VertexPosColorTex *QuadRenderer::allocQuadVertexMemory(uint32_t vertexCount, TextureID texture, bool blendEnabled, uint32_t srcBlend, uint32_t dstBlend, ShaderProgram *shader)
 {
     LOOM_PROFILE_SCOPE(quadGetVertices);
 
-    if (!vertexCount || (texture < 0) || (vertexCount > MAXBATCHQUADS * 4) || shader == NULL)
+    if (!vertexCount || (texture < 0) || shader == NULL)
     {
         return NULL;
     }
 
 #ifdef LOOM_DEBUG
-    loom_mutex_lock(Texture::sTexInfoLock);
     lmAssert(!(vertexCount % 4), "numVertices % 4 != 0");
-    lmAssert(texture == Texture::getTextureInfo(texture)->id, "Texture ID signature mismatch, you might be trying to draw a disposed texture");
-    loom_mutex_unlock(Texture::sTexInfoLock);
+    lmAssert(Texture::getTextureInfo(texture), "Texture ID signature mismatch, you might be trying to draw a disposed texture");
     lmAssert(batchedVertices, "batchedVertices should not be null");
 #endif
 
-    bool doSubmit = false;
+    if (captureBatch)
+        return recordCapture(vertexCount, texture, blendEnabled, srcBlend, dstBlend, shader);
+
+    if (sDeferredBatching && !sFlushingDeferred)
+        return recordDeferred(vertexCount, texture, blendEnabled, srcBlend, dstBlend, shader);
+
+    // With premultiplied alpha, ONE ONE is the same as the normal blend
+    // function for a color with zero alpha, so additive quads are drawn
+    // in the same batches and get their alpha cleared on flush. Only the
+    // default shader takes its alpha from the vertices, custom shaders
+    // and the tintless one keep the blend function they asked for
+    bool additive = false;
+    if (Graphics::getPremultipliedAlpha() && blendEnabled &&
+        srcBlend == GL_ONE && dstBlend == GL_ONE &&
+        shader == ShaderProgram::getDefaultShader())
+    {
+        additive = true;
+        dstBlend = GL_ONE_MINUS_SRC_ALPHA;
+    }
 
-    if (currentTexture != TEXTUREINVALID && currentTexture != texture)
-        doSubmit = true;
+    // Packed textures are drawn from their atlas page
+    TextureID page;
+    float atlasRegion[4];
+    bool atlased = Texture::getAtlasRegion(texture, page, atlasRegion);
+    if (atlased)
+    {
+        TextureInfo *tinfo = Texture::getTextureInfo(texture);
+        if (!tinfo->visible)
+            return NULL;
+
+        // The page is filtered with the smoothing of the texture drawn from it
+        TextureInfo *pageInfo = Texture::getTextureInfo(page);
+        if (pageInfo->smoothing != tinfo->smoothing)
+        {
+            flushBatch(FLUSH_TEXTURE);
+            pageInfo->smoothing = tinfo->smoothing;
+            sTextureStateValid = false;
+        }
+
+        texture = page;
+    }
+
+    // Evicted textures are restored the first time they're drawn again,
+    // which binds them in place of the current texture
+    if (texture != currentTexture && Texture::markUsed(texture))
+        sTextureStateValid = false;
+
+    bool doSubmit = false;
+    FlushReason reason = FLUSH_TEXTURE;
+    bool textureChanged = currentTexture != TEXTUREINVALID && currentTexture != texture;
 
     if (sCurrentShader != NULL && *sCurrentShader != *shader)
+    {
         doSubmit = true;
-
-    if (srcBlend != sSrcBlend ||
-        dstBlend != sDstBlend)
+        reason = FLUSH_SHADER;
+    }
+    else if (srcBlend != sSrcBlend ||
+             dstBlend != sDstBlend)
+    {
         doSubmit = true;
+        reason = FLUSH_BLEND;
+    }
+
+    // Different textures can share a draw call if there's a free slot
+    bool multiTexture = sMultiTextureUnits > 1 && getMultiTextureShaderFor(shader) != NULL;
+    int slot = -1;
+    if (multiTexture && !doSubmit)
+        slot = getBatchTextureSlot(texture);
 
-    if ((batchedVertexCount + vertexCount) > MAXBATCHQUADS * 4)
+    if (textureChanged && slot == -1)
         doSubmit = true;
 
     if (doSubmit)
-        submit();
+        flushBatch(reason);
+
+    if (multiTexture && slot == -1)
+        slot = getBatchTextureSlot(texture);
+
+    if (!reserveBatchedVertices(vertexCount))
+        return NULL;
+
+    if (slot == sBatchTextureCount)
+        sBatchTextures[sBatchTextureCount++] = texture;
 
-    if (currentTexture != TEXTUREINVALID && currentTexture != texture)
+    if (textureChanged)
         sTextureStateValid = false;
 
     if (sCurrentShader != NULL && *sCurrentShader != *shader)
@@ -248,13 +1056,55 @@ VertexPosColorTex *QuadRenderer::getQuadVertexMemory(uint16_t vertexCount, Textu
     currentTexture = texture;
     sCurrentShader = shader;
 
+    if (slot != -1 && (sBatchSlotRanges.empty() || sBatchSlotRanges.back().slot != slot))
+    {
+        BatchSlotRange range;
+        range.firstVertex = batchedVertexCount;
+        range.slot = slot;
+        sBatchSlotRanges.push_back(range);
+    }
+
+    if (atlased)
+    {
+        AtlasUVRange *last = sAtlasUVRanges.empty() ? NULL : &sAtlasUVRanges.back();
+        if (last && last->firstVertex + last->vertexCount == batchedVertexCount &&
+            memcmp(last->region, atlasRegion, sizeof(atlasRegion)) == 0)
+        {
+            last->vertexCount += vertexCount;
+        }
+        else
+        {
+            AtlasUVRange range;
+            range.firstVertex = batchedVertexCount;
+            range.vertexCount = vertexCount;
+            memcpy(range.region, atlasRegion, sizeof(atlasRegion));
+            sAtlasUVRanges.push_back(range);
+        }
+    }
+
+    if (additive)
+    {
+        AdditiveRange *last = sAdditiveRanges.empty() ? NULL : &sAdditiveRanges.back();
+        if (last && last->firstVertex + last->vertexCount == batchedVertexCount)
+        {
+            last->vertexCount += vertexCount;
+        }
+        else
+        {
+            AdditiveRange range;
+            range.firstVertex = batchedVertexCount;
+            range.vertexCount = vertexCount;
+            sAdditiveRanges.push_back(range);
+        }
+    }
+
     VertexPosColorTex *currentVertices = &batchedVertices[batchedVertexCount];
     batchedVertexCount += vertexCount;
     return currentVertices;
 }
 
 
-void QuadRenderer::batch(VertexPosColorTex *vertices, uint16_t vertexCount, TextureID texture, bool blendEnabled, uint32_t srcBlend, uint32_t dstBlend, ShaderProgram *shader)
+void QuadRenderer::batch(VertexPosColorTex *vertices, uint32_t vertexCount, TextureID texture, bool blendEnabled, uint32_t srcBlend, uint32_t dstBlend, ShaderProgram *shader)
 {
     LOOM_PROFILE_SCOPE(quadBatch);
 
@@ -267,6 +1117,306 @@ void QuadRenderer::batch(VertexPosColorTex *vertices, uint16_t vertexCount, Text
 }
 
 
+QuadStaticBatch::QuadStaticBatch()
+: vertexCount(0)
+, bufferId(0)
+, generation(0)
+{
+}
+
+QuadStaticBatch::~QuadStaticBatch()
+{
+    clear();
+}
+
+bool QuadStaticBatch::isValid() const
+{
+    return generation != 0 && generation == QuadRenderer::resourceGeneration;
+}
+
+void QuadStaticBatch::clear()
+{
+    // Buffers of an earlier generation are already gone
+    if (bufferId && generation == QuadRenderer::resourceGeneration)
+    {
+        if (Graphics_CacheBindBuffer(GL_ARRAY_BUFFER, 0))
+            Graphics::context()->glBindBuffer(GL_ARRAY_BUFFER, 0);
+        Graphics::context()->glDeleteBuffers(1, &bufferId);
+    }
+
+    bufferId = 0;
+    vertexCount = 0;
+    generation = 0;
+    ranges.clear(true);
+}
+
+
+void QuadRenderer::beginCapture(QuadStaticBatch *batch)
+{
+    lmAssert(captureBatch == NULL, "Quad captures can't be nested");
+
+    // Draw what came before, the capture doesn't include it
+    submit();
+
+    batch->clear();
+    captureVertices.clear(false);
+    captureFailed = false;
+    captureBatch = batch;
+}
+
+bool QuadRenderer::endCapture()
+{
+    QuadStaticBatch *batch = captureBatch;
+    lmAssert(batch != NULL, "No quad capture in progress");
+
+    captureBatch = NULL;
+
+    if (captureFailed)
+    {
+        batch->ranges.clear(true);
+        captureVertices.clear(true);
+        return false;
+    }
+
+    batch->generation = resourceGeneration;
+
+    // Nothing drawn is a valid capture too
+    if (captureVertices.size() == 0)
+        return true;
+
+    if (Graphics::getPremultipliedAlpha())
+        premultiplyVertexColors(captureVertices.ptr(), captureVertices.size());
+
+    GL_Context *ctx = Graphics::context();
+
+    ctx->glGenBuffers(1, &batch->bufferId);
+    if (Graphics_CacheBindBuffer(GL_ARRAY_BUFFER, batch->bufferId))
+        ctx->glBindBuffer(GL_ARRAY_BUFFER, batch->bufferId);
+    ctx->glBufferData(GL_ARRAY_BUFFER, captureVertices.size() * sizeof(VertexPosColorTex), captureVertices.ptr(), GL_STATIC_DRAW);
+
+    batch->vertexCount = (uint32_t)captureVertices.size();
+
+    captureVertices.clear(true);
+    return true;
+}
+
+void QuadRenderer::failCapture()
+{
+    captureFailed = true;
+}
+
+bool QuadRenderer::isCapturing()
+{
+    return captureBatch != NULL;
+}
+
+VertexPosColorTex *QuadRenderer::recordCapture(uint32_t vertexCount, TextureID texture, bool blendEnabled, uint32_t srcBlend, uint32_t dstBlend, ShaderProgram *shader)
+{
+    // Atlas pages can be repacked after the fact, which the baked
+    // texture coordinates would not follow
+    TextureID page;
+    float atlasRegion[4];
+    if (captureFailed || Texture::getAtlasRegion(texture, page, atlasRegion))
+    {
+        captureFailed = true;
+        return NULL;
+    }
+
+    uint32_t first = (uint32_t)captureVertices.size();
+    utArray<QuadStaticBatch::Range> &ranges = captureBatch->ranges;
+    QuadStaticBatch::Range *last = ranges.empty() ? NULL : &ranges.back();
+
+    if (last && last->texture == texture && last->blendEnabled == blendEnabled &&
+        last->srcBlend == srcBlend && last->dstBlend == dstBlend && *last->shader == *shader)
+    {
+        last->vertexCount += vertexCount;
+    }
+    else
+    {
+        QuadStaticBatch::Range range;
+        range.firstVertex = first;
+        range.vertexCount = vertexCount;
+        range.texture = texture;
+        range.blendEnabled = blendEnabled;
+        range.srcBlend = srcBlend;
+        range.dstBlend = dstBlend;
+        range.shader = shader;
+        ranges.push_back(range);
+    }
+
+    captureVertices.resize(first + vertexCount);
+    return &captureVertices[first];
+}
+
+void QuadRenderer::drawStatic(QuadStaticBatch *batch, const Loom2D::Matrix &transform)
+{
+    LOOM_PROFILE_SCOPE(quadStatic);
+
+    if (!batch->isValid() || batch->vertexCount == 0)
+        return;
+
+    // Keep the order with the batches drawn before
+    submit();
+
+    GPUTimer::begin(GPUTimer::SECTION_QUAD);
+
+    GL_Context *ctx = Graphics::context();
+
+    if (!Graphics_IsGLStateValid(GFX_OPENGL_STATE_QUAD))
+    {
+        sMaskStateValid = false;
+        Graphics_ResetGLStateCache();
+    }
+
+    if (!sMaskStateValid)
+    {
+        applyMaskState(maskDepth, maskMode);
+        sMaskStateValid = true;
+    }
+
+    if (Graphics_CacheEnable(GL_CULL_FACE, false))
+        ctx->glDisable(GL_CULL_FACE);
+
+    Graphics_SetCurrentGLState(GFX_OPENGL_STATE_QUAD);
+
+    if (Graphics_CacheBindBuffer(GL_ARRAY_BUFFER, batch->bufferId))
+        ctx->glBindBuffer(GL_ARRAY_BUFFER, batch->bufferId);
+    if (Graphics_CacheBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferId))
+        ctx->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferId);
+
+    // The vertices are in the space of the transform
+    Loom2D::Matrix mvp;
+    mvp.copyFromMatrix4(Graphics::getMVP());
+    Loom2D::Matrix batchMVP;
+    batchMVP.copyFrom(&transform);
+    batchMVP.concat(&mvp);
+
+    for (UTsize i = 0; i < batch->ranges.size(); i++)
+    {
+        const QuadStaticBatch::Range &range = batch->ranges[i];
+
+        TextureInfo *tinfo = Texture::getTextureInfo(range.texture);
+        if (!tinfo || tinfo->handle == (GLuint)-1 || !tinfo->visible)
+            continue;
+
+        Texture::markUsed(range.texture);
+
+        numFrameSubmit++;
+
+        range.shader->setMVP(batchMVP);
+        range.shader->setTextureId(0);
+        sBindingShader = true;
+        range.shader->bind();
+        sBindingShader = false;
+        frameStats.shaderSwitches++;
+        frameStats.vertices += (int)range.vertexCount;
+
+        applyTextureState(0, *tinfo);
+
+        if (range.blendEnabled)
+        {
+            if (Graphics_CacheEnable(GL_BLEND, true))
+                ctx->glEnable(GL_BLEND);
+            if (Graphics_CacheBlendFunc(range.srcBlend, range.dstBlend, range.srcBlend, range.dstBlend))
+                ctx->glBlendFuncSeparate(range.srcBlend, range.dstBlend, range.srcBlend, range.dstBlend);
+        }
+        else
+        {
+            if (Graphics_CacheEnable(GL_BLEND, false))
+                ctx->glDisable(GL_BLEND);
+        }
+
+        for (uint32_t drawn = 0; drawn < range.vertexCount; drawn += MAXBATCHQUADS * 4)
+        {
+            uint32_t drawCount = range.vertexCount - drawn;
+            if (drawCount > MAXBATCHQUADS * 4)
+                drawCount = MAXBATCHQUADS * 4;
+
+            range.shader->bindAttributes((range.firstVertex + drawn) * sizeof(VertexPosColorTex), VERTEXFORMAT_POSCOLORTEX);
+            ctx->glDrawElements(GL_TRIANGLES, (GLsizei)(drawCount / 4 * 6), GL_UNSIGNED_SHORT, NULL);
+            numFrameDraws++;
+            frameStats.drawCalls++;
+            if (drawn > 0)
+                frameStats.flushes[FLUSH_BUFFERFULL]++;
+        }
+    }
+
+    // The batches drawn next have to set up their own state again
+    sShaderStateValid = false;
+    sTextureStateValid = false;
+    sBlendStateValid = false;
+
+    GPUTimer::end(GPUTimer::SECTION_QUAD);
+}
+
+void QuadRenderer::setMaskState(int depth, MaskMode mode)
+{
+    if (depth == maskDepth && mode == maskMode)
+        return;
+
+    if (FrameCapture::isCapturing())
+        FrameCapture::recordMask(depth, mode);
+
+    // Batches are drawn with the state current when they're flushed,
+    // deferred batches have to be drawn before they could be sorted
+    // across the change, and captures don't record it
+    if (sDeferredBatching || captureBatch)
+        submit(FLUSH_MASK);
+    else
+        flushBatch(FLUSH_MASK);
+
+    maskDepth = depth;
+    maskMode = mode;
+    sMaskStateValid = false;
+}
+
+bool QuadRenderer::beginMaskWrite()
+{
+    lmAssert(maskMode == MASKMODE_TEST, "Masks can't be nested while one is drawn");
+
+    if (maskDepth >= QUADRENDERER_MAX_MASK_DEPTH)
+    {
+        if (!sMaskDepthWarned)
+        {
+            lmLogWarn(gGFXQuadRendererLogGroup, "Masks nested deeper than %d are ignored", QUADRENDERER_MAX_MASK_DEPTH);
+            sMaskDepthWarned = true;
+        }
+        return false;
+    }
+
+    setMaskState(maskDepth + 1, MASKMODE_WRITE);
+    return true;
+}
+
+void QuadRenderer::endMaskWrite()
+{
+    lmAssert(maskMode == MASKMODE_WRITE, "No mask is being written");
+    setMaskState(maskDepth, MASKMODE_TEST);
+}
+
+void QuadRenderer::beginMaskErase()
+{
+    lmAssert(maskDepth > 0 && maskMode == MASKMODE_TEST, "No mask to erase");
+    setMaskState(maskDepth, MASKMODE_ERASE);
+}
+
+void QuadRenderer::endMaskErase()
+{
+    lmAssert(maskMode == MASKMODE_ERASE, "No mask is being erased");
+    setMaskState(maskDepth - 1, MASKMODE_TEST);
+}
+
+int QuadRenderer::getMaskDepth()
+{
+    return maskDepth;
+}
+
+bool QuadRenderer::isWritingMask()
+{
+    return maskMode != MASKMODE_TEST;
+}
+
+
 void QuadRenderer::beginFrame()
 {
     LOOM_PROFILE_SCOPE(quadBegin);
@@ -274,11 +1424,36 @@ void QuadRenderer::beginFrame()
     batchedVertexCount     = 0;
     currentTexture         = TEXTUREINVALID;
 
+    sBatchTextureCount = 0;
+    sBatchSlotRanges.clear(true);
+    sAtlasUVRanges.clear(true);
+    sAdditiveRanges.clear(true);
+
+    sDeferredBatches.clear(true);
+    sDeferredVertexCount = 0;
+
+    // Move on to the next buffer in the ring, unless the current one
+    // was only started this frame (e.g. by rendering to a texture)
+    uint32_t frame = Graphics::getCurrentFrame();
+    if (vertexBufferFrame[currentVertexBuffer] != frame)
+    {
+        currentVertexBuffer = (currentVertexBuffer + 1) % QUADRENDERER_RING_SIZE;
+        vertexBufferOffset = 0;
+        vertexBufferFrame[currentVertexBuffer] = frame;
+    }
+
     sTextureStateValid = false;
     sBlendStateValid = false;
     sShaderStateValid = false;
 
+    // The stencil buffer is cleared with the frame
+    maskDepth = 0;
+    maskMode = MASKMODE_TEST;
+    sMaskStateValid = false;
+
     numFrameSubmit = 0;
+    numFrameDraws = 0;
+    frameStats.clear();
 }
 
 
@@ -286,12 +1461,164 @@ void QuadRenderer::endFrame()
 {
     LOOM_PROFILE_SCOPE(quadEnd);
     submit();
+
+    lastFrameStats = frameStats;
+}
+
+
+bool QuadRenderer::reserveBatchedVertices(size_t vertexCount)
+{
+    size_t required = batchedVertexCount + vertexCount;
+
+    if (required <= batchedVertexCapacity)
+        return true;
+
+    size_t capacity = batchedVertexCapacity ? batchedVertexCapacity : QUADRENDERER_INITIAL_QUADS * 4;
+    while (capacity < required)
+        capacity *= 2;
+
+    VertexPosColorTex *newVertices = static_cast<VertexPosColorTex*>(lmRealloc(gQuadMemoryAllocator, batchedVertices, capacity * sizeof(VertexPosColorTex)));
+
+    if (!newVertices)
+    {
+        lmLogError(gGFXQuadRendererLogGroup, "Unable to grow quad vertex memory to %d vertices", (int)capacity);
+        return false;
+    }
+
+    lmLogDebug(gGFXQuadRendererLogGroup, "Quad vertex memory grown to %d vertices", (int)capacity);
+
+    batchedVertices = newVertices;
+    batchedVertexCapacity = capacity;
+    return true;
+}
+
+
+void QuadRenderer::reserveVertexBuffer(size_t size)
+{
+    size_t &capacity = vertexBufferCapacity[currentVertexBuffer];
+
+    if (vertexBufferOffset + size <= capacity)
+        return;
+
+    // Orphan the storage, draws already issued from this buffer keep
+    // the old storage alive in the driver
+    size_t newCapacity = capacity;
+    if (size > capacity)
+    {
+        while (newCapacity < size)
+            newCapacity *= 2;
+        lmLogDebug(gGFXQuadRendererLogGroup, "Vertex buffer %d grown to %d bytes", currentVertexBuffer, (int)newCapacity);
+    }
+
+    Graphics::context()->glBufferData(GL_ARRAY_BUFFER, newCapacity, NULL, GL_STREAM_DRAW);
+
+    capacity = newCapacity;
+    vertexBufferOffset = 0;
+}
+
+
+const VertexPosColorTexCompact *QuadRenderer::compactBatchedVertices()
+{
+    if (batchedVertexCount > sCompactVertexCapacity)
+    {
+        size_t capacity = sCompactVertexCapacity ? sCompactVertexCapacity : QUADRENDERER_INITIAL_QUADS * 4;
+        while (capacity < batchedVertexCount)
+            capacity *= 2;
+
+        VertexPosColorTexCompact *grown = static_cast<VertexPosColorTexCompact*>(lmRealloc(gQuadMemoryAllocator, sCompactVertices, capacity * sizeof(VertexPosColorTexCompact)));
+        if (grown == NULL)
+        {
+            lmLogError(gGFXQuadRendererLogGroup, "Unable to allocate %d compact vertices", (int)capacity);
+            return NULL;
+        }
+
+        sCompactVertices = grown;
+        sCompactVertexCapacity = capacity;
+    }
+
+    const VertexPosColorTex *src = batchedVertices;
+    VertexPosColorTexCompact *dst = sCompactVertices;
+
+    for (size_t i = 0; i < batchedVertexCount; i++, src++, dst++)
+    {
+        dst->x = src->x;
+        dst->y = src->y;
+        dst->abgr = src->abgr;
+
+        float u = src->u < 0.0f ? 0.0f : (src->u > 1.0f ? 1.0f : src->u);
+        float v = src->v < 0.0f ? 0.0f : (src->v > 1.0f ? 1.0f : src->v);
+        dst->u = (uint16_t)(u * 65535.0f + 0.5f);
+        dst->v = (uint16_t)(v * 65535.0f + 0.5f);
+    }
+
+    return sCompactVertices;
+}
+
+
+const QuadInstance *QuadRenderer::buildInstances()
+{
+    if (batchedVertexCount == 0 || batchedVertexCount % 4 != 0)
+        return NULL;
+
+    size_t instanceCount = batchedVertexCount / 4;
+    if (instanceCount > sInstanceCapacity)
+    {
+        size_t capacity = sInstanceCapacity ? sInstanceCapacity : QUADRENDERER_INITIAL_QUADS;
+        while (capacity < instanceCount)
+            capacity *= 2;
+
+        // Without the memory the batch is drawn without instancing
+        QuadInstance *grown = static_cast<QuadInstance*>(lmRealloc(gQuadMemoryAllocator, sInstances, capacity * sizeof(QuadInstance)));
+        if (grown == NULL)
+            return NULL;
+
+        sInstances = grown;
+        sInstanceCapacity = capacity;
+    }
+
+    const VertexPosColorTex *q = batchedVertices;
+    QuadInstance *dst = sInstances;
+
+    for (size_t i = 0; i < instanceCount; i++, q += 4, dst++)
+    {
+        // One color per instance
+        if (q[1].abgr != q[0].abgr || q[2].abgr != q[0].abgr || q[3].abgr != q[0].abgr)
+            return NULL;
+
+        dst->x = q[0].x;
+        dst->y = q[0].y;
+        dst->u = q[0].u;
+        dst->v = q[0].v;
+        dst->ax = q[1].x - q[0].x;
+        dst->ay = q[1].y - q[0].y;
+        dst->au = q[1].u - q[0].u;
+        dst->av = q[1].v - q[0].v;
+        dst->bx = q[2].x - q[0].x;
+        dst->by = q[2].y - q[0].y;
+        dst->bu = q[2].u - q[0].u;
+        dst->bv = q[2].v - q[0].v;
+        dst->abgr = q[0].abgr;
+
+        // Only parallelograms can be expanded from a corner and two edges
+        if (fabsf(q[3].x - (q[1].x + dst->bx)) > QUADRENDERER_INSTANCE_POS_EPSILON ||
+            fabsf(q[3].y - (q[1].y + dst->by)) > QUADRENDERER_INSTANCE_POS_EPSILON ||
+            fabsf(q[3].u - (q[1].u + dst->bu)) > QUADRENDERER_INSTANCE_UV_EPSILON ||
+            fabsf(q[3].v - (q[1].v + dst->bv)) > QUADRENDERER_INSTANCE_UV_EPSILON)
+        {
+            return NULL;
+        }
+    }
+
+    return sInstances;
 }
 
 
 void QuadRenderer::destroyGraphicsResources()
 {
     // Probably do something someday.
+
+    // Static batches must not touch their buffers past this point
+    resourceGeneration++;
 }
 
 void QuadRenderer::initializeGraphicsResources()
@@ -300,14 +1627,28 @@ void QuadRenderer::initializeGraphicsResources()
 
     lmLogDebug(gGFXQuadRendererLogGroup, "Initializing graphics resources");
 
+    // Static batches created before hold buffers of the lost context
+    resourceGeneration++;
+
     GL_Context* ctx = Graphics::context();
 
-    // create the single initial vertex buffer
-    ctx->glGenBuffers(1, &vertexBufferId);
-    ctx->glBindBuffer(GL_ARRAY_BUFFER, vertexBufferId);
-    ctx->glBufferData(GL_ARRAY_BUFFER, MAXBATCHQUADS * 4 * sizeof(VertexPosColorTex), 0, GL_STREAM_DRAW);
+    // create the ring of vertex buffers, starting at the initial
+    // capacity or whatever they have grown to before a context loss
+    ctx->glGenBuffers(QUADRENDERER_RING_SIZE, vertexBufferIds);
+    for (int i = 0; i < QUADRENDERER_RING_SIZE; i++)
+    {
+        if (vertexBufferCapacity[i] < QUADRENDERER_INITIAL_QUADS * 4 * sizeof(VertexPosColorTex))
+            vertexBufferCapacity[i] = QUADRENDERER_INITIAL_QUADS * 4 * sizeof(VertexPosColorTex);
+
+        ctx->glBindBuffer(GL_ARRAY_BUFFER, vertexBufferIds[i]);
+        ctx->glBufferData(GL_ARRAY_BUFFER, vertexBufferCapacity[i], 0, GL_STREAM_DRAW);
+        vertexBufferFrame[i] = 0;
+    }
     ctx->glBindBuffer(GL_ARRAY_BUFFER, 0);
 
+    currentVertexBuffer = 0;
+    vertexBufferOffset = 0;
+
     // create the single, reused index buffer
     ctx->glGenBuffers(1, &indexBufferId);
     ctx->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferId);
@@ -330,8 +1671,27 @@ void QuadRenderer::initializeGraphicsResources()
 
     lmFree(gQuadMemoryAllocator, pStart);
 
-    // Create the system memory buffer for quads.
-    batchedVertices = static_cast<VertexPosColorTex*>(lmAlloc(gQuadMemoryAllocator, MAXBATCHQUADS * 4 * sizeof(VertexPosColorTex)));
+    // create the unit corners the instanced path expands quads from,
+    // in the same order as the vertices of a quad
+    if (Graphics::supportsInstancing())
+    {
+        static const float corners[] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+        ctx->glGenBuffers(1, &cornerBufferId);
+        ctx->glBindBuffer(GL_ARRAY_BUFFER, cornerBufferId);
+        ctx->glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        ctx->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Buffers were bound above without going through the state cache
+    Graphics_ResetGLStateCache();
+
+    // Create the system memory buffer for quads, it grows as needed.
+    if (!batchedVertices)
+    {
+        batchedVertexCount = 0;
+        batchedVertexCapacity = 0;
+        reserveBatchedVertices(QUADRENDERER_INITIAL_QUADS * 4);
+    }
 }
 
 
@@ -346,6 +1706,8 @@ void QuadRenderer::reset()
 
 void QuadRenderer::initialize()
 {
+    gQuadMemoryAllocator = loom_allocator_getTaggedAllocator("gfx.quads");
+
     initializeGraphicsResources();
 }
 }
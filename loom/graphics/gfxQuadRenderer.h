@@ -20,17 +20,97 @@
 
 #pragma once
 
+#include <string.h>
+
 #include "loom/graphics/gfxTexture.h"
 #include "loom/graphics/gfxShader.h"
 
 namespace GFX
 {
 
-// Define the maximum number of Quads on a single frame
-// this defaults to 128k
-// TODO: LOOM-1833 allocate this dynamically
+// Define the maximum number of Quads in a single draw call, this is bound
+// by the 16-bit index buffer. Frames may contain any number of quads,
+// larger batches are split into multiple draw calls.
 #define MAXBATCHQUADS       8192
 
+// Number of vertex buffers cycled between frames, so that a buffer
+// is not written to while the GPU might still be reading from it
+#define QUADRENDERER_RING_SIZE          3
+
+// Initial capacity in quads of each vertex buffer in the ring, buffers
+// grow by doubling when a frame needs more
+#define QUADRENDERER_INITIAL_QUADS      MAXBATCHQUADS
+
+// Stencil masks use one bit each, starting above the low bits NanoVG
+// counts fill windings in (see GLNVG_STENCIL_BITS), so an 8-bit stencil
+// buffer fits four nested masks
+#define QUADRENDERER_MASK_FIRST_BIT     4
+#define QUADRENDERER_MAX_MASK_DEPTH     4
+
+// What the quads drawn do with the stencil masks
+enum MaskMode
+{
+    // Drawn where all of the current masks are set
+    MASKMODE_TEST = 0,
+    // Set the innermost mask where all of the ones outside it are set
+    MASKMODE_WRITE,
+    // Clear the innermost mask
+    MASKMODE_ERASE
+};
+
+// Why the quads batched so far were drawn before more could be added
+enum FlushReason
+{
+    // The next quads use a texture that can't share the batch
+    FLUSH_TEXTURE = 0,
+    // A different shader, or new uniforms for the one batched
+    FLUSH_SHADER,
+    FLUSH_BLEND,
+    // The stencil mask state changed
+    FLUSH_MASK,
+    // A container set or restored its clip rect
+    FLUSH_CLIP,
+    // Vector graphics were drawn in between
+    FLUSH_VECTOR,
+    // A batch was split into another draw call by the 16-bit index buffer
+    FLUSH_BUFFERFULL,
+    // Render targets, end of frame and anything else that submits
+    FLUSH_OTHER,
+    FLUSH_REASON_COUNT
+};
+
+// Counters of what a frame took to draw
+struct RenderStats
+{
+    // Quad draw calls
+    int drawCalls;
+    // Quad and vector vertices
+    int vertices;
+    int textureBinds;
+    int shaderSwitches;
+    // Fills and strokes drawn by the vector renderer, each takes a few
+    // draw calls of its own
+    int vectorCalls;
+    // Quad batches drawn, by the reason they ended, FLUSH_BUFFERFULL
+    // counts the extra draw calls of split batches
+    int flushes[FLUSH_REASON_COUNT];
+
+    RenderStats()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        memset(this, 0, sizeof(RenderStats));
+    }
+
+    int getFlushes(int reason) const
+    {
+        return reason >= 0 && reason < FLUSH_REASON_COUNT ? flushes[reason] : 0;
+    }
+};
+
 struct VertexPosColorTex
 {
     float    x, y, z;
@@ -38,22 +118,126 @@ struct VertexPosColorTex
     float    u, v;
 };
 
+// Upload layout for VERTEXFORMAT_COMPACT, texture coordinates
+// are normalized to [0, 65535]
+struct VertexPosColorTexCompact
+{
+    float    x, y;
+    uint32_t abgr;
+    uint16_t u, v;
+};
+
+// Upload layout of the instanced path, one record per quad. The quad
+// corners are origin, origin + edgeA, origin + edgeB and
+// origin + edgeA + edgeB, in both position and texture space.
+struct QuadInstance
+{
+    float    x, y, u, v;
+    float    ax, ay, au, av;
+    float    bx, by, bu, bv;
+    uint32_t abgr;
+};
+
+// Quads kept in a vertex buffer of their own, for content that does not
+// change between frames. Filled by capturing what is drawn between
+// QuadRenderer::beginCapture and endCapture, drawn with
+// QuadRenderer::drawStatic under any transform.
+class QuadStaticBatch
+{
+    friend class QuadRenderer;
+
+    // Consecutive vertices drawn with the same state
+    struct Range
+    {
+        uint32_t       firstVertex;
+        uint32_t       vertexCount;
+        TextureID      texture;
+        bool           blendEnabled;
+        uint32_t       srcBlend;
+        uint32_t       dstBlend;
+        ShaderProgram *shader;
+    };
+
+    utArray<Range> ranges;
+    uint32_t       vertexCount;
+
+    GLuint   bufferId;
+    // Resource generation of the QuadRenderer the buffer was created in,
+    // buffers of an earlier one were lost along with the context
+    uint32_t generation;
+
+public:
+
+    QuadStaticBatch();
+    ~QuadStaticBatch();
+
+    // True if the batch holds a capture made in the current context
+    bool isValid() const;
+
+    // Frees the vertex buffer and forgets the capture
+    void clear();
+
+    inline uint32_t getVertexCount() const
+    {
+        return vertexCount;
+    }
+};
+
 class QuadRenderer
 {
     friend class Graphics;
+    friend class QuadStaticBatch;
+    friend class FrameReplay;
 
 private:
 
-    static GLuint vertexBufferId;
+    // Ring of vertex buffers, one is used per frame
+    static GLuint vertexBufferIds[QUADRENDERER_RING_SIZE];
+    // Capacity in bytes of each buffer in the ring
+    static size_t vertexBufferCapacity[QUADRENDERER_RING_SIZE];
+    // The frame each buffer in the ring was last written in
+    static uint32_t vertexBufferFrame[QUADRENDERER_RING_SIZE];
+    // Index of the buffer in the ring used by the current frame
+    static int currentVertexBuffer;
+    // Write offset in bytes into the current buffer
+    static size_t vertexBufferOffset;
+
     static GLuint indexBufferId;
 
+    // Unit square corners the instanced path expands quads from
+    static GLuint cornerBufferId;
+
+    // System memory staging for the batch currently being built
     static VertexPosColorTex *batchedVertices;
     static size_t batchedVertexCount;
+    static size_t batchedVertexCapacity;
 
     static TextureID currentTexture;
 
     static int numFrameSubmit;
 
+    // Draw calls issued this frame, batches split by the index buffer
+    // size take more than one
+    static int numFrameDraws;
+
+    // Incremented whenever the graphics resources are created again
+    static uint32_t resourceGeneration;
+
+    // Batch the quads drawn are captured into instead, if any
+    static QuadStaticBatch *captureBatch;
+    static bool captureFailed;
+    static utArray<VertexPosColorTex> captureVertices;
+
+    // return memory for captured vertices
+    static VertexPosColorTex *recordCapture(uint32_t vertexCount, TextureID texture, bool blendEnabled, uint32_t srcBlend, uint32_t dstBlend, ShaderProgram *shader);
+
+    // Nesting of the stencil masks and what the quads drawn do with them
+    static int maskDepth;
+    static MaskMode maskMode;
+
+    // draw what was batched with the previous mask state and switch
+    static void setMaskState(int depth, MaskMode mode);
+
     // initial initialization
     static void initialize();
 
@@ -63,16 +247,121 @@ private:
     // reset the quad renderer, on loss of context etc
     static void reset();
 
+    // make sure the staging memory can hold vertexCount more vertices
+    static bool reserveBatchedVertices(size_t vertexCount);
+
+    // make sure the current ring buffer has room for size more bytes,
+    // orphaning and growing the buffer if it does not
+    static void reserveVertexBuffer(size_t size);
+
+    // converts the batched vertices to the compact format, returns
+    // the converted vertices
+    static const VertexPosColorTexCompact *compactBatchedVertices();
+
+    // converts the batched vertices to instance records, returns NULL
+    // if any of the quads can't be represented as one
+    static const QuadInstance *buildInstances();
+
+    // draw the currently batched vertices
+    static void flushBatch(FlushReason reason);
+
+    // record a batch in the deferred queue and return memory for its vertices
+    static VertexPosColorTex *recordDeferred(uint32_t vertexCount, TextureID texture, bool blendEnabled, uint32_t srcBlend, uint32_t dstBlend, ShaderProgram *shader);
+
+    // sort the deferred queue by state while keeping overlapping batches
+    // in submission order, then draw it
+    static void flushDeferred();
+
+    // getQuadVertexMemory without recording the quads into a frame capture
+    static VertexPosColorTex *allocQuadVertexMemory(uint32_t vertexCount, TextureID texture, bool blendEnabled, uint32_t srcBlend, uint32_t dstBlend, ShaderProgram *shader);
+
+    // returns the texture slot of the current batch the texture can be
+    // drawn from, the next free one if it isn't in the batch yet, or -1
+    // if it can't be batched. New slots are claimed by the caller once
+    // the vertices are reserved
+    static int getBatchTextureSlot(TextureID texture);
+
 public:
 
-    static void submit();
+    // Draws every pending batch, including the deferred queue. Callers use
+    // this as a barrier before changing state the batches do not track,
+    // like scissoring or render targets. The reason is counted in the
+    // render stats if anything was drawn.
+    static void submit(FlushReason reason = FLUSH_OTHER);
+
+    // Draws the pending batches if any of them uses the shader, done
+    // before its uniforms change so they're drawn with the old values
+    static void submitShader(ShaderProgram *shader);
+
+    // In deferred mode batches are not drawn when the state changes, they
+    // are queued until the next submit() or endFrame() and drawn sorted by
+    // layer, shader, texture and blend state. Batches that overlap on screen
+    // keep their relative order.
+    static void setDeferredBatching(bool enabled);
+    static bool getDeferredBatching();
+
+    // In multi-texture mode quads drawn with the default shaders and
+    // different textures are batched into a single draw call, with up to
+    // GFX_MAX_BATCH_TEXTURES textures bound at once. The texture slot is
+    // stored in the z coordinate of the vertices.
+    static void setMultiTextureBatching(bool enabled);
+    static bool getMultiTextureBatching();
+
+    // In instanced mode, available if Graphics::supportsInstancing(), batches
+    // drawn with the default shaders upload one QuadInstance per quad and
+    // the GPU expands the corners. Batches with quads that are not
+    // parallelograms or have per-vertex colors use the regular path.
+    static void setInstancedRendering(bool enabled);
+    static bool getInstancedRendering();
+
+    // Between beginCapture and endCapture quads are not drawn, they are
+    // recorded into the batch. Anything that has to submit, like vector
+    // graphics, clipping or render targets, and textures packed into an
+    // atlas make the capture fail. Returns false if it failed; the batch
+    // is left empty then.
+    static void beginCapture(QuadStaticBatch *batch);
+    static bool endCapture();
+    static void failCapture();
+    static bool isCapturing();
+
+    // Draws the batch with its vertices transformed by the matrix, in
+    // order with whatever was drawn before
+    static void drawStatic(QuadStaticBatch *batch, const Loom2D::Matrix &transform);
+
+    // Stencil masks limit the quads drawn to the area covered by the quads
+    // of the masks. Quads drawn between beginMaskWrite and endMaskWrite add
+    // a nested mask instead of color, everything drawn after is limited to
+    // it until the same quads are drawn again between beginMaskErase and
+    // endMaskErase. Switching only ends the current batch, it doesn't need
+    // a submit outside of deferred mode, whose batches must not be sorted
+    // across the switch. beginMaskWrite returns false, and nothing should
+    // be drawn as a mask, past QUADRENDERER_MAX_MASK_DEPTH. Vector graphics
+    // are not limited by the masks and can't be drawn into them.
+    static bool beginMaskWrite();
+    static void endMaskWrite();
+    static void beginMaskErase();
+    static void endMaskErase();
+
+    static int getMaskDepth();
+    static bool isWritingMask();
 
     static void beginFrame();
 
     static void endFrame();
 
-    static VertexPosColorTex *getQuadVertexMemory(uint16_t numVertices, TextureID texture, bool blendEnabled, uint32_t srcBlend, uint32_t dstBlend, ShaderProgram *shader);
+    // Counters of the frame being drawn, the vector renderer adds its own
+    static RenderStats frameStats;
+
+    // Counters of the last complete frame
+    static RenderStats lastFrameStats;
+
+    static RenderStats *getRenderStats()
+    {
+        return &lastFrameStats;
+    }
+
+    static VertexPosColorTex *getQuadVertexMemory(uint32_t numVertices, TextureID texture, bool blendEnabled, uint32_t srcBlend, uint32_t dstBlend, ShaderProgram *shader);
 
-    static void batch(VertexPosColorTex *vertices, uint16_t vertexCount, TextureID texture, bool blendEnabled, uint32_t srcBlend, uint32_t dstBlend, ShaderProgram *shader);
+    static void batch(VertexPosColorTex *vertices, uint32_t vertexCount, TextureID texture, bool blendEnabled, uint32_t srcBlend, uint32_t dstBlend, ShaderProgram *shader);
 };
 }
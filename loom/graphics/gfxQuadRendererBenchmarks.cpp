@@ -0,0 +1,250 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/common/core/benchmark.h"
+#include "loom/graphics/gfxGraphics.h"
+#include "loom/graphics/gfxQuadRenderer.h"
+#include "loom/graphics/gfxTexture.h"
+#include "loom/graphics/gfxShader.h"
+#include "loom/engine/loom2d/l2dMatrix.h"
+
+using namespace GFX;
+
+// A frame's worth of sprites, about what a busy 2D scene submits
+#define QUADBENCH_QUADS      2000
+#define QUADBENCH_TEXSIZE    64
+
+static TextureID gQuadBenchTextures[2] = { -1, -1 };
+
+static void quadBench_createTextures()
+{
+    static uint32_t pixels[QUADBENCH_TEXSIZE * QUADBENCH_TEXSIZE];
+
+    for (int t = 0; t < 2; t++)
+    {
+        for (int i = 0; i < QUADBENCH_TEXSIZE * QUADBENCH_TEXSIZE; i++)
+        {
+            pixels[i] = t == 0 ? 0xFF8040FF : 0x80FF8040;
+        }
+
+        TextureInfo *tinfo = Texture::load((uint8_t *)pixels, QUADBENCH_TEXSIZE, QUADBENCH_TEXSIZE);
+        gQuadBenchTextures[t] = tinfo ? tinfo->id : -1;
+    }
+}
+
+static void quadBench_disposeTextures()
+{
+    for (int t = 0; t < 2; t++)
+    {
+        if (gQuadBenchTextures[t] != -1)
+        {
+            Texture::dispose(gQuadBenchTextures[t]);
+        }
+
+        gQuadBenchTextures[t] = -1;
+    }
+}
+
+static bool quadBench_ready()
+{
+    if (!Graphics::isInitialized() || gQuadBenchTextures[0] == -1 || gQuadBenchTextures[1] == -1)
+    {
+        loom_benchmark_skip("no GL context");
+        return false;
+    }
+
+    return true;
+}
+
+// Submits the quads laid out in a grid, textureMask picks the texture of
+// each so 0 keeps one texture and 1 alternates between the two
+static void quadBench_submit(int textureMask)
+{
+    ShaderProgram *shader = ShaderProgram::getDefaultShader();
+
+    for (int q = 0; q < QUADBENCH_QUADS; q++)
+    {
+        VertexPosColorTex *v = QuadRenderer::getQuadVertexMemory(4, gQuadBenchTextures[q & textureMask], true, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, shader);
+
+        if (!v)
+        {
+            continue;
+        }
+
+        float x = (float)((q % 50) * 16);
+        float y = (float)((q / 50) * 16);
+
+        v[0].x = x;      v[0].y = y;      v[0].u = 0.0f; v[0].v = 0.0f;
+        v[1].x = x + 32; v[1].y = y;      v[1].u = 1.0f; v[1].v = 0.0f;
+        v[2].x = x;      v[2].y = y + 32; v[2].u = 0.0f; v[2].v = 1.0f;
+        v[3].x = x + 32; v[3].y = y + 32; v[3].u = 1.0f; v[3].v = 1.0f;
+
+        for (int i = 0; i < 4; i++)
+        {
+            v[i].z    = 0.0f;
+            v[i].abgr = 0xFFFFFFFF;
+        }
+    }
+}
+
+// Every iteration is a frame, finished so the GPU work is part of the time
+// rather than queued up behind the next sample
+static void quadBench_frames(int iterations, int textureMask)
+{
+    for (int i = 0; i < iterations; i++)
+    {
+        Graphics::beginFrame();
+        quadBench_submit(textureMask);
+        Graphics::endFrame();
+        Graphics::context()->glFinish();
+    }
+}
+
+BENCHMARK_FIXTURE(quadRenderer)
+{
+    if (Graphics::isInitialized())
+    {
+        quadBench_createTextures();
+    }
+
+    BENCHMARK_FIXTURE_ENTRY(quadRenderer_sameTexture);
+    BENCHMARK_FIXTURE_ENTRY(quadRenderer_alternatingTextures);
+    BENCHMARK_FIXTURE_ENTRY(quadRenderer_alternatingTexturesMulti);
+    BENCHMARK_FIXTURE_ENTRY(quadRenderer_immediate);
+    BENCHMARK_FIXTURE_ENTRY(quadRenderer_instanced);
+    BENCHMARK_FIXTURE_ENTRY(quadRenderer_static);
+
+    quadBench_disposeTextures();
+}
+
+// One texture, the quads go out in a single batch
+BENCHMARK(quadRenderer_sameTexture)
+{
+    if (!quadBench_ready())
+    {
+        return;
+    }
+
+    quadBench_frames(iterations, 0);
+}
+
+// The worst case for batching, every quad changes the texture
+BENCHMARK(quadRenderer_alternatingTextures)
+{
+    if (!quadBench_ready())
+    {
+        return;
+    }
+
+    bool multi = QuadRenderer::getMultiTextureBatching();
+    QuadRenderer::setMultiTextureBatching(false);
+
+    quadBench_frames(iterations, 1);
+
+    QuadRenderer::setMultiTextureBatching(multi);
+}
+
+// As above with both textures bound to slots of one batch
+BENCHMARK(quadRenderer_alternatingTexturesMulti)
+{
+    if (!quadBench_ready())
+    {
+        return;
+    }
+
+    bool multi = QuadRenderer::getMultiTextureBatching();
+    QuadRenderer::setMultiTextureBatching(true);
+
+    quadBench_frames(iterations, 1);
+
+    QuadRenderer::setMultiTextureBatching(multi);
+}
+
+// Without deferred batching, quads are submitted in draw order
+BENCHMARK(quadRenderer_immediate)
+{
+    if (!quadBench_ready())
+    {
+        return;
+    }
+
+    bool deferred = QuadRenderer::getDeferredBatching();
+    QuadRenderer::setDeferredBatching(false);
+
+    quadBench_frames(iterations, 0);
+
+    QuadRenderer::setDeferredBatching(deferred);
+}
+
+BENCHMARK(quadRenderer_instanced)
+{
+    if (!quadBench_ready())
+    {
+        return;
+    }
+
+    bool instanced = QuadRenderer::getInstancedRendering();
+    QuadRenderer::setInstancedRendering(true);
+
+    if (!QuadRenderer::getInstancedRendering())
+    {
+        QuadRenderer::setInstancedRendering(instanced);
+        loom_benchmark_skip("instancing not supported");
+        return;
+    }
+
+    quadBench_frames(iterations, 0);
+
+    QuadRenderer::setInstancedRendering(instanced);
+}
+
+// The same quads captured once and drawn from their buffer every frame
+BENCHMARK(quadRenderer_static)
+{
+    if (!quadBench_ready())
+    {
+        return;
+    }
+
+    QuadStaticBatch batch;
+    Loom2D::Matrix identity;
+
+    loom_benchmark_pauseTiming();
+    Graphics::beginFrame();
+    QuadRenderer::beginCapture(&batch);
+    quadBench_submit(0);
+    bool captured = QuadRenderer::endCapture();
+    Graphics::endFrame();
+    loom_benchmark_resumeTiming();
+
+    if (!captured)
+    {
+        loom_benchmark_skip("capture failed");
+        return;
+    }
+
+    for (int i = 0; i < iterations; i++)
+    {
+        Graphics::beginFrame();
+        QuadRenderer::drawStatic(&batch, identity);
+        Graphics::endFrame();
+        Graphics::context()->glFinish();
+    }
+}
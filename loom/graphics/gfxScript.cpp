@@ -27,13 +27,18 @@
 #include "loom/graphics/gfxGraphics.h"
 #include "loom/graphics/gfxTexture.h"
 #include "loom/graphics/gfxShader.h"
+#include "loom/graphics/gfxVideoTexture.h"
+#include "loom/graphics/gfxQuadRenderer.h"
+#include "loom/graphics/gfxFrameCapture.h"
 #include "loom/graphics/gfxBitmapData.h"
 
 // Includes for the resize operation.
+#include "loom/common/platform/platformIO.h"
+#include "loom/common/platform/platformJobs.h"
 #include "loom/common/platform/platformThread.h"
 #include "loom/common/platform/platformTime.h"
+#include "loom/graphics/gfxImageResize.h"
 #include "loom/vendor/geldreich/jpge.h"
-#include "loom/vendor/geldreich/resampler.h"
 #include "loom/vendor/stb/stb_image.h"
 
 #include "loom/common/core/allocator.h"
@@ -57,6 +62,9 @@ struct RescaleEventStatus
 {
     utString path, assetPath;
     float progress;
+
+    // the size written, 0 x 0 if it failed, once progress is 1
+    int width, height;
 };
 
 struct RescaleNote
@@ -72,6 +80,7 @@ struct RescaleNote
 static MutexHandle                gEventQueueMutex = NULL;
 static utList<RescaleEventStatus> gEventQueue;
 static LS::NativeDelegate         gImageScaleProgressDelegate;
+static LS::NativeDelegate         gImageScaleCompleteDelegate;
 
 static void pollScaling()
 {
@@ -95,6 +104,11 @@ static void pollScaling()
         if (curItem.progress == 1.0f)
         {
             loom_asset_flush(curItem.assetPath.c_str());
+
+            gImageScaleCompleteDelegate.pushArgument(curItem.path.c_str());
+            gImageScaleCompleteDelegate.pushArgument(curItem.width);
+            gImageScaleCompleteDelegate.pushArgument(curItem.height);
+            gImageScaleCompleteDelegate.invoke();
         }
 
         gEventQueue.pop_front();
@@ -103,7 +117,7 @@ static void pollScaling()
     loom_mutex_unlock(gEventQueueMutex);
 }
 
-static void postResampleEvent(const char *path, float progress, const char *assetPath)
+static void postResampleEvent(const char *path, float progress, const char *assetPath, int width = 0, int height = 0)
 {
     if (gEventQueueMutex == NULL)
     {
@@ -116,41 +130,16 @@ static void postResampleEvent(const char *path, float progress, const char *asse
     res.path = path;
     res.assetPath = assetPath;
     res.progress = progress;
+    res.width = width;
+    res.height = height;
     gEventQueue.push_back(res);
 
     loom_mutex_unlock(gEventQueueMutex);
 }
 
-static int __stdcall scaleImageOnDisk_body(void *param)
+// Resize to fit within the specified size preserving aspect ratio, if flag is set.
+static void fitScaledSize(int imageX, int imageY, bool preserveAspect, int &outWidth, int &outHeight)
 {
-    // Grab our arguments.
-    RescaleNote *rn            = (RescaleNote *)param;
-    const char  *outPath       = rn->outPath.c_str();
-    const char  *inPath        = rn->inPath.c_str();
-    int         outWidth       = rn->outWidth;
-    int         outHeight      = rn->outHeight;
-    bool        preserveAspect = rn->preserveAspect;
-
-    // Load the image. We always work in 4 components (rgba).
-    int t0 = platform_getMilliseconds();
-
-    loom_asset_image *lai = NULL;
-
-    // Load async since we're in a background thread.
-    loom_asset_preload(inPath);
-    loom_thread_yield();
-    while((lai = (loom_asset_image *)loom_asset_lock(inPath, LATImage, 0)) == NULL)
-        loom_thread_yield();
-
-    int     imageX     = lai->width;
-    int     imageY     = lai->height;
-    stbi_uc *imageBits = (stbi_uc *)lai->bits;
-
-    lmLogDebug(gGFXTextureLogGroup, "Image setup took %dms", t0 - platform_getMilliseconds());
-
-    int t1 = platform_getMilliseconds();
-
-    // Resize to fit within the specified size preserving aspect ratio, if flag is set.
     if (preserveAspect)
     {
         float scaleX = float(outWidth) / float(imageX);
@@ -163,98 +152,101 @@ static int __stdcall scaleImageOnDisk_body(void *param)
         lmLogDebug(gGFXTextureLogGroup, "Scale to %d %d due to scale %f %f actual=%f", outWidth, outHeight, scaleX, scaleY, actualScale);
     }
 
-    // Build a buffer for byte->float conversions...
-    Resampler::Sample *buffRed   = (Resampler::Sample *)lmAlloc(gRescalerAllocator, sizeof(Resampler::Sample) * imageX);
-    Resampler::Sample *buffGreen = (Resampler::Sample *)lmAlloc(gRescalerAllocator, sizeof(Resampler::Sample) * imageX);
-    Resampler::Sample *buffBlue  = (Resampler::Sample *)lmAlloc(gRescalerAllocator, sizeof(Resampler::Sample) * imageX);
-
-    // And the downsampled image. Give a slight margin because the scaling routine above can give
-    // up to outWidth inclusive as an output value.
-    stbi_uc *outBuffer = (stbi_uc*)lmAlloc(gRescalerAllocator, sizeof(stbi_uc) * 3 * (outWidth+1) * (outHeight+1));
-
-    // Set up the resamplers, reusing filter constants.
-    const char *pFilter = "blackman";
-    float filter_scale = 1.0;
-    Resampler resizeR(imageX, imageY, outWidth, outHeight, Resampler::BOUNDARY_CLAMP, 0.0f, 1.0f, pFilter, NULL, NULL, filter_scale, filter_scale);
-    Resampler resizeG(imageX, imageY, outWidth, outHeight, Resampler::BOUNDARY_CLAMP, 0.0f, 1.0f, pFilter,
-                      resizeR.get_clist_x(), resizeR.get_clist_y(), filter_scale, filter_scale);
-    Resampler resizeB(imageX, imageY, outWidth, outHeight, Resampler::BOUNDARY_CLAMP, 0.0f, 1.0f, pFilter,
-                      resizeR.get_clist_x(), resizeR.get_clist_y(), filter_scale, filter_scale);
-
-    int resultY = 0;
+    if (outWidth < 1) outWidth = 1;
+    if (outHeight < 1) outHeight = 1;
+}
 
-    lmLogDebug(gGFXTextureLogGroup, "Resample setup took %dms", t1 - platform_getMilliseconds());
+static void scaleImageOnDisk_job(void *param)
+{
+    // Grab our arguments.
+    RescaleNote *rn            = (RescaleNote *)param;
+    const char  *outPath       = rn->outPath.c_str();
+    const char  *inPath        = rn->inPath.c_str();
+    int         outWidth       = rn->outWidth;
+    int         outHeight      = rn->outHeight;
+    bool        preserveAspect = rn->preserveAspect;
 
-    int t2 = platform_getMilliseconds();
+    int t0 = platform_getMilliseconds();
 
-    // Process each row of the image.
-    for (int y = 0; y < imageY; y++)
+    loom_asset_image *lai = NULL;
+    LoomAssetCleanupCallback laiCleanup = NULL;
+    bool locked = false;
+    bool fitted = false;
+
+    // Files are decoded right here, JPEGs only at the size needed. Others
+    // come from the asset system at full size.
+    void *fileBits = NULL;
+    long fileSize = 0;
+    if (platform_mapFile(inPath, &fileBits, &fileSize))
     {
-        // Deinterleave each row.
-        for (int x = 0; x < imageX; x++)
+        int scaleShift = 0;
+        int imageX, imageY, imageComp;
+        if (stbi_info_from_memory((const stbi_uc *)fileBits, (int)fileSize, &imageX, &imageY, &imageComp))
         {
-            buffRed[x]   = Resampler::Sample(imageBits[(y * imageX * 4) + (x * 4) + 0]) / Resampler::Sample(255.f);
-            buffGreen[x] = Resampler::Sample(imageBits[(y * imageX * 4) + (x * 4) + 1]) / Resampler::Sample(255.f);
-            buffBlue[x]  = Resampler::Sample(imageBits[(y * imageX * 4) + (x * 4) + 2]) / Resampler::Sample(255.f);
+            fitScaledSize(imageX, imageY, preserveAspect, outWidth, outHeight);
+            fitted = true;
+
+            // Halve while the decoded image still covers the output
+            while (scaleShift < 3 && (imageX >> (scaleShift + 1)) >= outWidth && (imageY >> (scaleShift + 1)) >= outHeight)
+                scaleShift++;
         }
 
-        // Submit to resampler.
-        lmAssert(resizeR.put_line(buffRed), "bad red");
-        lmAssert(resizeG.put_line(buffGreen), "bad green");
-        lmAssert(resizeB.put_line(buffBlue), "bad blue");
+        lai = (loom_asset_image *)loom_asset_imageDeserializeScaled(fileBits, fileSize, scaleShift, &laiCleanup);
+        platform_unmapFile(fileBits);
+    }
+    else
+    {
+        // Load async since we're in a background thread.
+        loom_asset_preload(inPath);
+        loom_thread_yield();
+        while((lai = (loom_asset_image *)loom_asset_lock(inPath, LATImage, 0)) == NULL)
+            loom_thread_yield();
+        locked = true;
+    }
 
-        // If there are results, reinterleave and consume them.
-        while (resizeR.check_line() && resizeG.check_line() && resizeB.check_line() && resultY < outHeight)
+    if (lai == NULL || lai->compressedFormat != IMAGE_COMPRESSED_NONE)
+    {
+        lmLogError(gGFXTextureLogGroup, "Unable to scale %s, it can't be decoded", inPath);
+        if (lai != NULL)
         {
-            const Resampler::Sample *outRowR = resizeR.get_line();
-            const Resampler::Sample *outRowG = resizeG.get_line();
-            const Resampler::Sample *outRowB = resizeB.get_line();
-
-            if (outRowR || outRowG || outRowB)
-            {
-                lmAssert(outRowR && outRowG && outRowB, "Somehow got one line without others!");
-            }
+            if (locked)
+                loom_asset_unlock(inPath);
             else
-            {
-                break;
-            }
-
-            // Find the row for output.
-            stbi_uc *imageOutBits = outBuffer + (resultY * outWidth * 3);
-            resultY++;
-
-            for (int i = 0; i < outWidth; i++)
-            {
-                imageOutBits[i * 3 + 0] = int(outRowR[i] * Resampler::Sample(255.f));
-                imageOutBits[i * 3 + 1] = int(outRowG[i] * Resampler::Sample(255.f));
-                imageOutBits[i * 3 + 2] = int(outRowB[i] * Resampler::Sample(255.f));
-            }
-
-            // Every hundred lines post an update.
-            if(resultY % 100 == 0)
-            {
-                // calculate the progress, but keep from reporting 1.0 as this is used to
-                // mark completion
-                float value = (float)resultY / (float)outHeight;
-                if (value == 1.0f)
-                    value = .99f;
-                postResampleEvent(outPath, value , inPath);
-            }
+                laiCleanup(lai);
         }
+        postResampleEvent(outPath, 1.0, inPath);
+        Texture::enableAssetNotifications(true);
+        delete rn;
+        return;
     }
 
-    lmLogDebug(gGFXTextureLogGroup, "Resample took %dms", t2 - platform_getMilliseconds());
+    lmLogDebug(gGFXTextureLogGroup, "Image decode took %dms at %dx%d", platform_getMilliseconds() - t0, lai->width, lai->height);
+
+    if (!fitted)
+        fitScaledSize(lai->width, lai->height, preserveAspect, outWidth, outHeight);
+
+    postResampleEvent(outPath, 0.5f, inPath);
+
+    int t1 = platform_getMilliseconds();
+    uint8_t *outBuffer = (uint8_t *)lmAlloc(gRescalerAllocator, (size_t)outWidth * outHeight * 4);
+    resizeImage((const uint8_t *)lai->bits, lai->width, lai->height, outBuffer, outWidth, outHeight, IMAGE_RESIZE_LANCZOS3);
+    lmLogDebug(gGFXTextureLogGroup, "Resample took %dms", platform_getMilliseconds() - t1);
+
+    int orientation = lai->orientation;
 
     // Release the image, we are done with it!
-    loom_asset_unlock(inPath);
+    if (locked)
+        loom_asset_unlock(inPath);
+    else
+        laiCleanup(lai);
 
     // Write it back out.
-    int t3 = platform_getMilliseconds();
-    jpge::compress_image_to_jpeg_file(outPath, outWidth, outHeight, 3, outBuffer);
-    lmLogDebug(gGFXTextureLogGroup, "JPEG output took %dms", t3 - platform_getMilliseconds());
+    int t2 = platform_getMilliseconds();
+    jpge::compress_image_to_jpeg_file(outPath, outWidth, outHeight, 4, outBuffer);
+    lmLogDebug(gGFXTextureLogGroup, "JPEG output took %dms", platform_getMilliseconds() - t2);
 
     // preserve orientation (but only if we need to)
-    if (lai->orientation > IMAGE_ORIENTATION_UPPER_LEFT)
+    if (orientation > IMAGE_ORIENTATION_UPPER_LEFT)
     {
         ResetJpgfile();
 
@@ -262,7 +254,7 @@ static int __stdcall scaleImageOnDisk_body(void *param)
         if (ReadJpegFile(outPath, READ_ALL))
         {
             // create the exif segment and attach it to jpeg image
-            create_EXIF(lai->orientation);
+            create_EXIF(orientation);
 
             // write it out with exif data
             WriteJpegFile(outPath);
@@ -272,14 +264,10 @@ static int __stdcall scaleImageOnDisk_body(void *param)
         }
     }
 
-    // Free everything!
-    lmFree(gRescalerAllocator, buffRed);
-    lmFree(gRescalerAllocator, buffGreen);
-    lmFree(gRescalerAllocator, buffBlue);
     lmFree(gRescalerAllocator, outBuffer);
 
     // Post completion event.
-    postResampleEvent(outPath, 1.0, inPath);
+    postResampleEvent(outPath, 1.0, inPath, outWidth, outHeight);
 
     Texture::enableAssetNotifications(true);
 
@@ -287,8 +275,6 @@ static int __stdcall scaleImageOnDisk_body(void *param)
         loom_asset_preload(outPath);
 
     delete rn;
-
-    return 0;
 }
 
 
@@ -305,7 +291,9 @@ static void scaleImageOnDisk(const char *outPath, const char *inPath, int outWid
 
     Texture::enableAssetNotifications(false);
 
-    loom_thread_start(scaleImageOnDisk_body, rn);
+    // A background job, the workers are shared with texture decoding and
+    // anything else running in the background
+    loom_job_submit(scaleImageOnDisk_job, rn, NULL, NULL, LOOM_JOB_BACKGROUND);
 }
 
 
@@ -315,6 +303,12 @@ static const NativeDelegate *getImageScaleProgressDelegate()
 }
 
 
+static const NativeDelegate *getImageScaleCompleteDelegate()
+{
+    return &gImageScaleCompleteDelegate;
+}
+
+
 static int registerLoomGraphics(lua_State *L)
 {
     beginPackage(L, "loom.graphics")
@@ -333,6 +327,18 @@ static int registerLoomGraphics(lua_State *L)
        .addStaticMethod("scaleImageOnDisk", &scaleImageOnDisk)
        .addStaticMethod("pollScaling", &pollScaling)
        .addStaticProperty("imageScaleProgress", &getImageScaleProgressDelegate)
+       .addStaticProperty("imageScaleComplete", &getImageScaleCompleteDelegate)
+       .addStaticProperty("atlasEnabled", &Texture::getAtlasEnabled, &Texture::setAtlasEnabled)
+       .addStaticProperty("uploadBudget", &Texture::getUploadBudget, &Texture::setUploadBudget)
+       .addStaticProperty("memoryBudget", &Texture::getMemoryBudget, &Texture::setMemoryBudget)
+       .addStaticProperty("memoryUsage", &Texture::getMemoryUsage)
+       .addStaticProperty("keepSourceBytes", &Texture::getKeepSourceBytes, &Texture::setKeepSourceBytes)
+       .addStaticMethod("setFormatRule", &Texture::setFormatRule)
+       .addStaticMethod("clearFormatRules", &Texture::clearFormatRules)
+       .addStaticMethod("initFromVideo", &VideoTexture::open)
+       .addStaticMethod("pauseVideo", &VideoTexture::pause)
+       .addStaticMethod("resumeVideo", &VideoTexture::resume)
+       .addStaticProperty("videoSupported", &VideoTexture::isSupported)
        .endClass()
 
        .beginClass<Graphics>("Graphics")
@@ -340,9 +346,28 @@ static int registerLoomGraphics(lua_State *L)
        .addStaticMethod("handleContextLoss", &Graphics::handleContextLoss)
        .addStaticMethod("screenshot", &Graphics::screenshot)
        .addStaticMethod("screenshotData", &Graphics::screenshotData)
+       .addStaticMethod("framebufferData", &Graphics::framebufferData)
        .addStaticMethod("setDebug", &Graphics::setDebug)
        .addStaticMethod("setFillColor", &Graphics::setFillColor)
        .addStaticProperty("onScreenshotData", &Graphics::getonScreenshotDataDelegate)
+       .addStaticProperty("onFramebufferData", &Graphics::getonFramebufferDataDelegate)
+       .addStaticProperty("deferredBatching", &QuadRenderer::getDeferredBatching, &QuadRenderer::setDeferredBatching)
+       .addStaticProperty("multiTextureBatching", &QuadRenderer::getMultiTextureBatching, &QuadRenderer::setMultiTextureBatching)
+       .addStaticProperty("instancedRendering", &QuadRenderer::getInstancedRendering, &QuadRenderer::setInstancedRendering)
+       .addStaticProperty("threadedPresent", &Graphics::getThreadedPresent, &Graphics::setThreadedPresent)
+       .addStaticProperty("statsOverlay", &Graphics::getStatsOverlay, &Graphics::setStatsOverlay)
+       .addStaticProperty("premultipliedAlpha", &Graphics::getPremultipliedAlpha, &Graphics::setPremultipliedAlpha)
+       .addStaticProperty("renderStats", &QuadRenderer::getRenderStats)
+       .addStaticMethod("captureFrame", &FrameCapture::request)
+       .endClass()
+
+       .beginClass<RenderStats>("RenderStats")
+       .addVar("drawCalls", &RenderStats::drawCalls)
+       .addVar("vertices", &RenderStats::vertices)
+       .addVar("textureBinds", &RenderStats::textureBinds)
+       .addVar("shaderSwitches", &RenderStats::shaderSwitches)
+       .addVar("vectorCalls", &RenderStats::vectorCalls)
+       .addMethod("getFlushes", &RenderStats::getFlushes)
        .endClass()
 
        .beginClass<TextureInfo> ("TextureInfo")
@@ -364,6 +389,7 @@ static int registerLoomGraphics(lua_State *L)
        .addVarAccessor("onBind", &ShaderProgram::getonBindDelegate)
        .addVarAccessor("MVP", &ShaderProgram::getMVP)
        .addVarAccessor("textureId", &ShaderProgram::getTextureId)
+       .addProperty("vertexFormat", &ShaderProgram::getVertexFormat, &ShaderProgram::setVertexFormat)
        .addMethod("load", &ShaderProgram::load)
        .addMethod("loadFromAssets", &ShaderProgram::loadFromAssets)
        .addMethod("getUniformLocation", &ShaderProgram::getUniformLocation)
@@ -395,6 +421,7 @@ static int registerLoomGraphics(lua_State *L)
        .addStaticMethod("fromFramebuffer", &BitmapData::fromFramebuffer)
        .addStaticMethod("fromAsset", &BitmapData::fromAsset)
        .addStaticMethod("compare", &BitmapData::compare)
+       .addStaticMethod("difference", &BitmapData::difference)
        .addStaticMethod("diff", &BitmapData::diff)
        .endClass()
 
@@ -406,9 +433,12 @@ static int registerLoomGraphics(lua_State *L)
 
 void installLoomGraphics()
 {
+    gRescalerAllocator = loom_allocator_getTaggedAllocator("gfx.rescaler");
+
     LOOM_DECLARE_NATIVETYPE(GFX::Graphics, GFX::registerLoomGraphics);
     LOOM_DECLARE_NATIVETYPE(GFX::Texture, GFX::registerLoomGraphics);
     LOOM_DECLARE_NATIVETYPE(GFX::TextureInfo, GFX::registerLoomGraphics);
+    LOOM_DECLARE_NATIVETYPE(GFX::RenderStats, GFX::registerLoomGraphics);
     LOOM_DECLARE_MANAGEDNATIVETYPE(GFX::ShaderProgram, GFX::registerLoomGraphics);
     LOOM_DECLARE_NATIVETYPE(GFX::BitmapData, GFX::registerLoomGraphics);
 }
@@ -20,13 +20,98 @@
 
 #include "loom/graphics/gfxShader.h"
 #include "loom/graphics/gfxQuadRenderer.h"
+#include "loom/graphics/gfxStateManager.h"
 #include "loom/common/assets/assets.h"
+#include "loom/common/config/applicationConfig.h"
+#include "loom/common/platform/platformFile.h"
+#include "loom/common/platform/platformIO.h"
+#include "loom/common/utils/utSHA2.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 lmDefineLogGroup(gGFXShaderLogGroup, "gfx.shader", 1, LoomLogInfo);
 
-static const GFX::ShaderProgram *lastBoundShader = NULL;
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_PROGRAM_BINARY_FORMATS
+#define GL_PROGRAM_BINARY_FORMATS 0x87FF
+#endif
+
+// Program binaries are stored as this header followed by the binary,
+// one file per pair of shader sources
+#define PROGRAM_BINARY_MAGIC 0x42534d4c // "LMSB"
+
+struct ProgramBinaryHeader
+{
+    uint32_t magic;
+    uint32_t format;
+    uint32_t length;
+
+    // SHA-256 of the driver strings, binaries are only valid for the
+    // driver that produced them
+    char driver[64];
+};
+
+static const utString& getProgramBinaryDir()
+{
+    static utString dir;
+    if (dir.size() == 0)
+    {
+        dir = platform_getSettingsPath(LoomApplicationConfig::applicationId().c_str());
+        dir += "shadercache";
+        dir += platform_getFolderDelimiter();
+    }
+    return dir;
+}
+
+static const utString& getProgramBinaryDriver()
+{
+    static utString driver;
+    if (driver.size() == 0)
+    {
+        GFX::GL_Context* ctx = GFX::Graphics::context();
+
+        utString strings;
+        const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        for (int i = 0; i < 3; i++)
+        {
+            const char *value = (const char *)ctx->glGetString(names[i]);
+            strings += value ? value : "";
+            strings += "\n";
+        }
+
+        utSHA2::generateSHA256(strings.c_str(), strings.size(), driver);
+        lmAssert(driver.size() == sizeof(((ProgramBinaryHeader*)NULL)->driver), "Unexpected driver hash length");
+    }
+    return driver;
+}
+
+static bool isProgramBinaryFormatSupported(GLenum format)
+{
+    GFX::GL_Context* ctx = GFX::Graphics::context();
+
+    GLint count = 0;
+    ctx->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+    if (count <= 0)
+        return false;
+
+    utArray<GLint> formats;
+    formats.resize(count);
+    ctx->glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.ptr());
+
+    for (int i = 0; i < count; i++)
+    {
+        if ((GLenum)formats[i] == format)
+            return true;
+    }
+
+    return false;
+}
 
 // A hash table of live shaders that are currently compiled on the GPU
 // Contains reference counting since we are devoid of smart pointers
@@ -86,6 +171,7 @@ GFX::Shader::Shader(const utString& _name, GLenum _type)
 : id(0)
 , type(_type)
 , name(_name)
+, revision(0)
 {
     lmLogDebug(gGFXShaderLogGroup, "Creating shader %s", name.c_str());
 
@@ -139,27 +225,71 @@ const utString& GFX::Shader::getAssetName() const
     return name;
 }
 
+const utString& GFX::Shader::getSourceHash() const
+{
+    return sourceHash;
+}
+
+int GFX::Shader::getRevision() const
+{
+    return revision;
+}
 
-bool GFX::Shader::load(const char* source)
+bool GFX::Shader::load(const char* _source)
 {
     lmAssert(id == 0, "Shader already loaded, clean up first");
 
-    GFX::GL_Context* ctx = Graphics::context();
+    revision++;
 
-    id = ctx->glCreateShader(type);
-
+    if (_source == NULL)
+    {
+        source = "";
+        sourceHash = "";
+        return false;
+    }
+
+    source = "";
 #if LOOM_RENDERER_OPENGLES2
-    utString processed;
     if (type == GL_FRAGMENT_SHADER)
     {
-        processed = "precision mediump float;\n";
-        processed += source;
-        source = processed.c_str();
+        // Extension directives have to come before the precision statement
+        const char *body = _source;
+        for (;;)
+        {
+            const char *line = body + strspn(body, " \t\r\n");
+            if (strncmp(line, "#extension", 10) != 0)
+                break;
+
+            const char *end = strchr(line, '\n');
+            body = end ? end + 1 : line + strlen(line);
+        }
+
+        source.append(_source, (utString::size_type)(body - _source));
+        source += "precision mediump float;\n";
+        _source = body;
     }
 #endif
+    source += _source;
+
+    utSHA2::generateSHA256(source.c_str(), source.size(), sourceHash);
+
+    return true;
+}
 
-    const GLchar *glsource = static_cast<const GLchar*>(source);
-    const GLint length = strlen(source);
+bool GFX::Shader::compile()
+{
+    if (id != 0)
+        return true;
+
+    if (source.size() == 0)
+        return false;
+
+    GFX::GL_Context* ctx = Graphics::context();
+
+    id = ctx->glCreateShader(type);
+
+    const GLchar *glsource = static_cast<const GLchar*>(source.c_str());
+    const GLint length = source.size();
 
     ctx->glShaderSource(id, 1, &glsource, &length);
     Graphics::context()->glCompileShader(id);
@@ -239,9 +369,12 @@ char* GFX::Shader::getSourceFromAsset()
 
 void GFX::Shader::reload()
 {
-    GFX::GL_Context* ctx = Graphics::context();
-    ctx->glDeleteShader(id);
-    id = 0;
+    if (id != 0)
+    {
+        GFX::GL_Context* ctx = Graphics::context();
+        ctx->glDeleteShader(id);
+        id = 0;
+    }
 
     char* source = getSourceFromAsset();
     load(source);
@@ -274,8 +407,74 @@ GFX::ShaderProgram* GFX::ShaderProgram::getTintlessDefaultShader()
     return tintlessDefaultShader.get();
 }
 
+GFX::ShaderProgram* GFX::ShaderProgram::getMultiTextureShader()
+{
+    if (multiTextureShader.get() == NULL)
+    {
+        multiTextureShader.reset(lmNew(NULL) GFX::MultiTextureShader(true));
+    }
+
+    return multiTextureShader.get();
+}
+
+GFX::ShaderProgram* GFX::ShaderProgram::getTintlessMultiTextureShader()
+{
+    if (tintlessMultiTextureShader.get() == NULL)
+    {
+        tintlessMultiTextureShader.reset(lmNew(NULL) GFX::MultiTextureShader(false));
+    }
+
+    return tintlessMultiTextureShader.get();
+}
+
+GFX::ShaderProgram* GFX::ShaderProgram::getInstancedShader()
+{
+    if (instancedShader.get() == NULL)
+    {
+        instancedShader.reset(lmNew(NULL) GFX::InstancedQuadShader(true));
+    }
+
+    return instancedShader.get();
+}
+
+GFX::ShaderProgram* GFX::ShaderProgram::getTintlessInstancedShader()
+{
+    if (tintlessInstancedShader.get() == NULL)
+    {
+        tintlessInstancedShader.reset(lmNew(NULL) GFX::InstancedQuadShader(false));
+    }
+
+    return tintlessInstancedShader.get();
+}
+
+GFX::ShaderProgram* GFX::ShaderProgram::getExternalShader()
+{
+    if (externalShader.get() == NULL)
+    {
+        externalShader.reset(lmNew(NULL) GFX::ExternalTextureShader(true));
+    }
+
+    return externalShader.get();
+}
+
+GFX::ShaderProgram* GFX::ShaderProgram::getTintlessExternalShader()
+{
+    if (tintlessExternalShader.get() == NULL)
+    {
+        tintlessExternalShader.reset(lmNew(NULL) GFX::ExternalTextureShader(false));
+    }
+
+    return tintlessExternalShader.get();
+}
+
 GFX::ShaderProgram::ShaderProgram()
 : programId(0)
+, fragmentShaderId(0)
+, vertexShaderId(0)
+, fragmentShaderRevision(0)
+, vertexShaderRevision(0)
+, vertexFormat(VERTEXFORMAT_POSCOLORTEX)
+, uniformsDirty(false)
 {
 
 }
@@ -287,13 +486,16 @@ GFX::ShaderProgram::~ShaderProgram()
 
     GFX::GL_Context* ctx = Graphics::context();
 
-    ctx->glDetachShader(programId, vertexShader->getId());
-    ctx->glDetachShader(programId, fragmentShader->getId());
+    if (vertexShaderId != 0)
+        ctx->glDetachShader(programId, vertexShaderId);
+    if (fragmentShaderId != 0)
+        ctx->glDetachShader(programId, fragmentShaderId);
 
     Shader::removeShaderRef(vertexShader->getAssetName());
     Shader::removeShaderRef(fragmentShader->getAssetName());
 
     ctx->glDeleteProgram(programId);
+    Graphics_ResetGLStateCache();
 }
 
 bool GFX::ShaderProgram::operator==(const GFX::ShaderProgram& other) const
@@ -347,22 +549,52 @@ void GFX::ShaderProgram::link()
 
     lmAssert(programId == 0, "Shader program already linked, clean up first!");
 
-    programId = ctx->glCreateProgram();
-
-    // Link the program
-    ctx->glAttachShader(programId, fragmentShader->getId());
-    ctx->glAttachShader(programId, vertexShader->getId());
-    ctx->glLinkProgram(programId);
-
-    if (!validate())
+    fragmentShaderRevision = fragmentShader->getRevision();
+    vertexShaderRevision = vertexShader->getRevision();
+    fragmentShaderId = 0;
+    vertexShaderId = 0;
+
+    // A new program starts with all uniforms zeroed and may lay them out
+    // differently, the stored values are uploaded again on the next bind
+    uniformLocations.clear();
+    for (UTsize i = 0; i < uniformValues.size(); i++)
+        uniformValues[i].dirty = true;
+    uniformsDirty = uniformValues.size() > 0;
+
+    // Restoring a cached binary skips both compiling and linking
+    utString key;
+    if (Graphics::supportsProgramBinary())
     {
-        ctx->glDeleteProgram(programId);
-        programId = 0;
-        return;
+        utString sources = vertexShader->getSourceHash();
+        sources += fragmentShader->getSourceHash();
+        utSHA2::generateSHA256(sources.c_str(), sources.size(), key);
     }
 
-    fragmentShaderId = fragmentShader->getId();
-    vertexShaderId = vertexShader->getId();
+    if (key.size() == 0 || !loadBinary(key))
+    {
+        vertexShader->compile();
+        fragmentShader->compile();
+
+        programId = ctx->glCreateProgram();
+
+        // Link the program
+        ctx->glAttachShader(programId, fragmentShader->getId());
+        ctx->glAttachShader(programId, vertexShader->getId());
+        ctx->glLinkProgram(programId);
+
+        if (!validate())
+        {
+            ctx->glDeleteProgram(programId);
+            programId = 0;
+            return;
+        }
+
+        fragmentShaderId = fragmentShader->getId();
+        vertexShaderId = vertexShader->getId();
+
+        if (key.size() > 0)
+            saveBinary(key);
+    }
 
     // Lookup vertex attribute array locations
     posAttribLoc = Graphics::context()->glGetAttribLocation(programId, "a_position");
@@ -370,6 +602,93 @@ void GFX::ShaderProgram::link()
     posTexCoordLoc = Graphics::context()->glGetAttribLocation(programId, "a_texcoord0");
 }
 
+bool GFX::ShaderProgram::loadBinary(const utString& key)
+{
+    utString path = getProgramBinaryDir() + key;
+
+    void *data;
+    long size;
+    if (platform_mapFile(path.c_str(), &data, &size) != 1)
+        return false;
+
+    GFX::GL_Context* ctx = Graphics::context();
+
+    const ProgramBinaryHeader *header = static_cast<const ProgramBinaryHeader*>(data);
+    bool restored = false;
+
+    if (size >= (long)sizeof(ProgramBinaryHeader) &&
+        header->magic == PROGRAM_BINARY_MAGIC &&
+        size == (long)(sizeof(ProgramBinaryHeader) + header->length) &&
+        memcmp(header->driver, getProgramBinaryDriver().c_str(), sizeof(header->driver)) == 0 &&
+        isProgramBinaryFormatSupported(header->format))
+    {
+        programId = ctx->glCreateProgram();
+        ctx->glProgramBinary(programId, header->format, header + 1, header->length);
+
+        GLint status = GL_FALSE;
+        ctx->glGetProgramiv(programId, GL_LINK_STATUS, &status);
+        restored = status == GL_TRUE;
+
+        if (!restored)
+        {
+            ctx->glDeleteProgram(programId);
+            programId = 0;
+        }
+    }
+
+    platform_unmapFile(data);
+
+    if (restored)
+    {
+        lmLogDebug(gGFXShaderLogGroup, "OpenGL program %s restored from binary", key.c_str());
+    }
+    else
+    {
+        // Stale or from another driver, it's replaced once linked from source
+        lmLogDebug(gGFXShaderLogGroup, "OpenGL program %s binary rejected, linking from source", key.c_str());
+        platform_removeFile(path.c_str());
+    }
+
+    return restored;
+}
+
+void GFX::ShaderProgram::saveBinary(const utString& key)
+{
+    GFX::GL_Context* ctx = Graphics::context();
+
+    GLint length = 0;
+    ctx->glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    utArray<unsigned char> buffer;
+    buffer.resize(sizeof(ProgramBinaryHeader) + length);
+
+    GLsizei written = 0;
+    GLenum format = 0;
+    ctx->glGetProgramBinary(programId, length, &written, &format, buffer.ptr() + sizeof(ProgramBinaryHeader));
+    if (written <= 0)
+        return;
+
+    ProgramBinaryHeader *header = reinterpret_cast<ProgramBinaryHeader*>(buffer.ptr());
+    header->magic = PROGRAM_BINARY_MAGIC;
+    header->format = format;
+    header->length = written;
+    memcpy(header->driver, getProgramBinaryDriver().c_str(), sizeof(header->driver));
+
+    static bool madeDir = false;
+    if (!madeDir)
+    {
+        platform_makeDir(getProgramBinaryDir().c_str());
+        madeDir = true;
+    }
+
+    utString path = getProgramBinaryDir() + key;
+    if (platform_writeFile(path.c_str(), buffer.ptr(), sizeof(ProgramBinaryHeader) + written) != 0)
+    {
+        lmLogWarn(gGFXShaderLogGroup, "Unable to write program binary to %s", path.c_str());
+    }
+}
 
 bool GFX::ShaderProgram::validate()
 {
@@ -420,301 +739,291 @@ bool GFX::ShaderProgram::validate()
 
 GLint GFX::ShaderProgram::getUniformLocation(const char* name)
 {
+    utHashedString key(name);
+    GLint *cached = uniformLocations.get(key);
+    if (cached != NULL)
+        return *cached;
+
     GFX::GL_Context* ctx = Graphics::context();
-    return ctx->glGetUniformLocation(programId, name);
+    GLint location = ctx->glGetUniformLocation(programId, name);
+    uniformLocations.insert(key, location);
+    return location;
 }
 
-void GFX::ShaderProgram::setUniform1f(GLint location, GLfloat v0)
+static int getUniformComponents(GFX::UniformType type)
 {
-    lmAssert(this == lastBoundShader, "You are setting a uniform for a shader that is not currently bound!");
-
-    Graphics::context()->glUniform1f(location, v0);
+    switch (type)
+    {
+        case GFX::UNIFORM_1F: case GFX::UNIFORM_1I: return 1;
+        case GFX::UNIFORM_2F: case GFX::UNIFORM_2I: return 2;
+        case GFX::UNIFORM_3F: case GFX::UNIFORM_3I: return 3;
+        case GFX::UNIFORM_MATRIX3F: return 9;
+        case GFX::UNIFORM_MATRIX4F: return 16;
+    }
+    return 0;
 }
 
-int GFX::ShaderProgram::setUniform1fv(lua_State *L)
+void GFX::ShaderProgram::setUniformValue(GLint location, UniformType type, int count, bool transpose, const void *data)
 {
-    GLint location = (GLint)lua_tonumber(L, 2);
-    int length = lsr_vector_get_length(L, 3);
+    if (location == -1 || count <= 0)
+        return;
 
-    utArray<float> values;
+    // Floats and ints are both 4 bytes
+    UTsize size = (UTsize)(getUniformComponents(type) * count * 4);
 
-    lua_rawgeti(L, 3, LSINDEXVECTOR);
-    int vidx = lua_gettop(L);
+    UniformValue *value = NULL;
+    for (UTsize i = 0; i < uniformValues.size(); i++)
+    {
+        if (uniformValues[i].location == location)
+        {
+            value = &uniformValues[i];
+            break;
+        }
+    }
 
-    for (int i = 0; i < length; i++)
+    if (value != NULL && value->type == type && value->count == count && value->transpose == transpose &&
+        value->data.size() == size && memcmp(value->data.ptr(), data, size) == 0)
     {
-        lua_rawgeti(L, vidx, i);
-        float value = (float)lua_tonumber(L, -1);
-        values.push_back(value);
+        return;
     }
 
-    Graphics::context()->glUniform1fv(location, values.size(), values.ptr());
-    return 0;
+    // Quads batched so far were drawn with the previous value
+    QuadRenderer::submitShader(this);
+
+    if (value == NULL)
+    {
+        uniformValues.push_back(UniformValue());
+        value = &uniformValues.back();
+        value->location = location;
+    }
+
+    value->type = type;
+    value->count = count;
+    value->transpose = transpose;
+    value->dirty = true;
+    value->data.resize(size);
+    memcpy(value->data.ptr(), data, size);
+
+    uniformsDirty = true;
 }
 
-void GFX::ShaderProgram::setUniform2f(GLint location, GLfloat v0, GLfloat v1)
+void GFX::ShaderProgram::applyUniforms()
 {
-    lmAssert(this == lastBoundShader, "You are setting a uniform for a shader that is not currently bound!");
+    if (!uniformsDirty || programId == 0)
+        return;
 
-    Graphics::context()->glUniform2f(location, v0, v1);
+    GFX::GL_Context* ctx = Graphics::context();
+
+    if (Graphics_CacheUseProgram(programId))
+        ctx->glUseProgram(programId);
+
+    for (UTsize i = 0; i < uniformValues.size(); i++)
+    {
+        UniformValue &value = uniformValues[i];
+        if (!value.dirty)
+            continue;
+
+        const GLfloat *f = reinterpret_cast<const GLfloat*>(value.data.ptr());
+        const GLint *v = reinterpret_cast<const GLint*>(value.data.ptr());
+
+        switch (value.type)
+        {
+            case UNIFORM_1F: ctx->glUniform1fv(value.location, value.count, f); break;
+            case UNIFORM_2F: ctx->glUniform2fv(value.location, value.count, f); break;
+            case UNIFORM_3F: ctx->glUniform3fv(value.location, value.count, f); break;
+            case UNIFORM_1I: ctx->glUniform1iv(value.location, value.count, v); break;
+            case UNIFORM_2I: ctx->glUniform2iv(value.location, value.count, v); break;
+            case UNIFORM_3I: ctx->glUniform3iv(value.location, value.count, v); break;
+            case UNIFORM_MATRIX3F: ctx->glUniformMatrix3fv(value.location, value.count, value.transpose, f); break;
+            case UNIFORM_MATRIX4F: ctx->glUniformMatrix4fv(value.location, value.count, value.transpose, f); break;
+        }
+
+        value.dirty = false;
+    }
+
+    uniformsDirty = false;
 }
 
-int GFX::ShaderProgram::setUniform2fv(lua_State *L)
+// Reads the Vector.<Number> at index into values, converted to T
+template<typename T>
+static int readUniformVector(lua_State *L, int index, utArray<T>& values)
 {
-    lmAssert(this == lastBoundShader, "You are setting a uniform for a shader that is not currently bound!");
+    int length = lsr_vector_get_length(L, index);
 
-    GLint location = (GLint)lua_tonumber(L, 2);
-    int length = lsr_vector_get_length(L, 3);
+    lua_rawgeti(L, index, LSINDEXVECTOR);
+    int vidx = lua_gettop(L);
 
-    lmAssert(length % 2 == 0, "values size must be a multiple of 2");
+    values.resize(length);
+    for (int i = 0; i < length; i++)
+    {
+        lua_rawgeti(L, vidx, i);
+        values[i] = (T)lua_tonumber(L, -1);
+        lua_pop(L, 1);
+    }
+
+    lua_pop(L, 1);
+    return length;
+}
 
-    utArray<float> values;
+// Reads the Vector.<Matrix> at index into values, each as a 3x3 or 4x4 matrix
+static int readUniformMatrixVector(lua_State *L, int index, int size, utArray<float>& values)
+{
+    int length = lsr_vector_get_length(L, index);
 
-    lua_rawgeti(L, 3, LSINDEXVECTOR);
+    lua_rawgeti(L, index, LSINDEXVECTOR);
     int vidx = lua_gettop(L);
 
+    values.resize(size * length);
     for (int i = 0; i < length; i++)
     {
         lua_rawgeti(L, vidx, i);
-        float value = (float)lua_tonumber(L, -1);
-        values.push_back(value);
+        Loom2D::Matrix* mat = (Loom2D::Matrix *)lualoom_getnativepointer(L, -1);
+        if (size == 9)
+            mat->copyToMatrix3f(values.ptr() + i * 9);
+        else
+            mat->copyToMatrix4f(values.ptr() + i * 16);
+        lua_pop(L, 1);
     }
 
-    // Pop the vector
-    lua_pop(L, 3);
-    // Pop location
-    lua_pop(L, 2);
-
-    lmAssert(length % 2 == 0, "values size must be a multiple of 2");
+    lua_pop(L, 1);
+    return length;
+}
 
-    Graphics::context()->glUniform2fv(location, values.size(), values.ptr());
-    return 0;
+void GFX::ShaderProgram::setUniform1f(GLint location, GLfloat v0)
+{
+    setUniformValue(location, UNIFORM_1F, 1, false, &v0);
 }
 
-void GFX::ShaderProgram::setUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+int GFX::ShaderProgram::setUniform1fv(lua_State *L)
 {
-    lmAssert(this == lastBoundShader, "You are setting a uniform for a shader that is not currently bound!");
+    static utArray<float> values;
+    GLint location = (GLint)lua_tonumber(L, 2);
+    int length = readUniformVector(L, 3, values);
 
-    Graphics::context()->glUniform3f(location, v0, v1, v2);
+    setUniformValue(location, UNIFORM_1F, length, false, values.ptr());
+    return 0;
 }
 
-int GFX::ShaderProgram::setUniform3fv(lua_State *L)
+void GFX::ShaderProgram::setUniform2f(GLint location, GLfloat v0, GLfloat v1)
 {
-    lmAssert(this == lastBoundShader, "You are setting a uniform for a shader that is not currently bound!");
+    GLfloat v[2] = { v0, v1 };
+    setUniformValue(location, UNIFORM_2F, 1, false, v);
+}
 
+int GFX::ShaderProgram::setUniform2fv(lua_State *L)
+{
+    static utArray<float> values;
     GLint location = (GLint)lua_tonumber(L, 2);
-    int length = lsr_vector_get_length(L, 3);
+    int length = readUniformVector(L, 3, values);
 
-    lmAssert(length % 3 == 0, "values size must be a multiple of 3");
+    lmAssert(length % 2 == 0, "values size must be a multiple of 2");
 
-    utArray<float> values;
+    setUniformValue(location, UNIFORM_2F, length / 2, false, values.ptr());
+    return 0;
+}
 
-    lua_rawgeti(L, 3, LSINDEXVECTOR);
-    int vidx = lua_gettop(L);
+void GFX::ShaderProgram::setUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+{
+    GLfloat v[3] = { v0, v1, v2 };
+    setUniformValue(location, UNIFORM_3F, 1, false, v);
+}
 
-    for (int i = 0; i < length; i++)
-    {
-        lua_rawgeti(L, vidx, i);
-        float value = (float)lua_tonumber(L, -1);
-        values.push_back(value);
-    }
+int GFX::ShaderProgram::setUniform3fv(lua_State *L)
+{
+    static utArray<float> values;
+    GLint location = (GLint)lua_tonumber(L, 2);
+    int length = readUniformVector(L, 3, values);
 
-    // Pop the vector
-    lua_pop(L, 3);
-    // Pop location
-    lua_pop(L, 2);
+    lmAssert(length % 3 == 0, "values size must be a multiple of 3");
 
-    Graphics::context()->glUniform3fv(location, values.size(), values.ptr());
+    setUniformValue(location, UNIFORM_3F, length / 3, false, values.ptr());
     return 0;
 }
 
 void GFX::ShaderProgram::setUniform1i(GLint location, GLint v0)
 {
-    lmAssert(this == lastBoundShader, "You are setting a uniform for a shader that is not currently bound!");
-
-    Graphics::context()->glUniform1i(location, v0);
+    setUniformValue(location, UNIFORM_1I, 1, false, &v0);
 }
 
 int GFX::ShaderProgram::setUniform1iv(lua_State *L)
 {
+    static utArray<GLint> values;
     GLint location = (GLint)lua_tonumber(L, 2);
-    int length = lsr_vector_get_length(L, 3);
-
-    utArray<int> values;
+    int length = readUniformVector(L, 3, values);
 
-    lua_rawgeti(L, 3, LSINDEXVECTOR);
-    int vidx = lua_gettop(L);
-
-    for (int i = 0; i < length; i++)
-    {
-        lua_rawgeti(L, vidx, i);
-        int value = (int)lua_tonumber(L, -1);
-        values.push_back(value);
-    }
-
-    // Pop the vector
-    lua_pop(L, 3);
-    // Pop location
-    lua_pop(L, 2);
-
-    Graphics::context()->glUniform1iv(location, values.size(), values.ptr());
+    setUniformValue(location, UNIFORM_1I, length, false, values.ptr());
     return 0;
 }
 
 void GFX::ShaderProgram::setUniform2i(GLint location, GLint v0, GLint v1)
 {
-    lmAssert(this == lastBoundShader, "You are setting a uniform for a shader that is not currently bound!");
-
-    Graphics::context()->glUniform2i(location, v0, v1);
+    GLint v[2] = { v0, v1 };
+    setUniformValue(location, UNIFORM_2I, 1, false, v);
 }
 
 int GFX::ShaderProgram::setUniform2iv(lua_State *L)
 {
-    lmAssert(this == lastBoundShader, "You are setting a uniform for a shader that is not currently bound!");
-
+    static utArray<GLint> values;
     GLint location = (GLint)lua_tonumber(L, 2);
-    int length = lsr_vector_get_length(L, 3);
-    lmAssert(length % 2 == 0, "values size must be a multiple of 2");
-
-    utArray<int> values;
-
-    lua_rawgeti(L, 3, LSINDEXVECTOR);
-    int vidx = lua_gettop(L);
+    int length = readUniformVector(L, 3, values);
 
-    for (int i = 0; i < length; i++)
-    {
-        lua_rawgeti(L, vidx, i);
-        int value = (int)lua_tonumber(L, -1);
-        values.push_back(value);
-    }
-
-    // Pop the vector
-    lua_pop(L, 3);
-    // Pop location
-    lua_pop(L, 2);
+    lmAssert(length % 2 == 0, "values size must be a multiple of 2");
 
-    Graphics::context()->glUniform2iv(location, values.size(), values.ptr());
+    setUniformValue(location, UNIFORM_2I, length / 2, false, values.ptr());
     return 0;
 }
 
 void GFX::ShaderProgram::setUniform3i(GLint location, GLint v0, GLint v1, GLint v2)
 {
-    lmAssert(this == lastBoundShader, "You are setting a uniform for a shader that is not currently bound!");
-
-    Graphics::context()->glUniform3i(location, v0, v1, v2);
+    GLint v[3] = { v0, v1, v2 };
+    setUniformValue(location, UNIFORM_3I, 1, false, v);
 }
 
 int GFX::ShaderProgram::setUniform3iv(lua_State *L)
 {
-    lmAssert(this == lastBoundShader, "You are setting a uniform for a shader that is not currently bound!");
-
+    static utArray<GLint> values;
     GLint location = (GLint)lua_tonumber(L, 2);
-    int length = lsr_vector_get_length(L, 3);
-    lmAssert(length % 3 == 0, "values size must be a multiple of 3");
-
-
-    utArray<int> values;
-
-    lua_rawgeti(L, 3, LSINDEXVECTOR);
-    int vidx = lua_gettop(L);
-
-    for (int i = 0; i < length; i++)
-    {
-        lua_rawgeti(L, vidx, i);
-        int value = (int)lua_tonumber(L, -1);
-        values.push_back(value);
-    }
+    int length = readUniformVector(L, 3, values);
 
-    // Pop the vector
-    lua_pop(L, 3);
-    // Pop location
-    lua_pop(L, 2);
+    lmAssert(length % 3 == 0, "values size must be a multiple of 3");
 
-    Graphics::context()->glUniform3iv(location, values.size(), values.ptr());
+    setUniformValue(location, UNIFORM_3I, length / 3, false, values.ptr());
     return 0;
 }
 
 void GFX::ShaderProgram::setUniformMatrix3f(GLint location, bool transpose, const Loom2D::Matrix* value)
 {
-    lmAssert(this == lastBoundShader, "You are setting a uniform for a shader that is not currently bound!");
-
-    static float v[9] = {0, 0, 0, 0, 0, 0, 0, 0 ,0};
+    float v[9];
     value->copyToMatrix3f(v);
-    Graphics::context()->glUniformMatrix3fv(location, 1, transpose, v);
+    setUniformValue(location, UNIFORM_MATRIX3F, 1, transpose, v);
 }
 
 int GFX::ShaderProgram::setUniformMatrix3fv(lua_State *L)
 {
-    lmAssert(this == lastBoundShader, "You are setting a uniform for a shader that is not currently bound!");
-
+    static utArray<float> values;
     GLint location = (GLint)lua_tonumber(L, 2);
     bool transpose = lua_toboolean(L, 3) != 0;
-    int length = lsr_vector_get_length(L, 4);
-
-    lua_rawgeti(L, 4, LSINDEXVECTOR);
-    int vidx = lua_gettop(L);
-
-    utArray<float> values;
-
-    values.resize(9 * length);
-    for (int i = 0; i < length; i++)
-    {
-        lua_rawgeti(L, vidx, i);
-        Loom2D::Matrix* mat = (Loom2D::Matrix *)lualoom_getnativepointer(L, -1);
-        mat->copyToMatrix3f(values.ptr() + i * 9);
-    }
-
-    Graphics::context()->glUniformMatrix3fv(location, length, transpose, values.ptr());
-
-    // Pop the vector
-    lua_pop(L, 4);
-    // Pop transpose
-    lua_pop(L, 3);
-    // Pop location
-    lua_pop(L, 2);
+    int length = readUniformMatrixVector(L, 4, 9, values);
 
+    setUniformValue(location, UNIFORM_MATRIX3F, length, transpose, values.ptr());
     return 0;
 }
 
 void GFX::ShaderProgram::setUniformMatrix4f(GLint location, bool transpose, const Loom2D::Matrix* value)
 {
-    lmAssert(this == lastBoundShader, "You are setting a uniform for a shader that is not currently bound!");
-
-    static float v[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    float v[16];
     value->copyToMatrix4f(v);
-    Graphics::context()->glUniformMatrix4fv(location, 1, transpose, v);
+    setUniformValue(location, UNIFORM_MATRIX4F, 1, transpose, v);
 }
 
 int GFX::ShaderProgram::setUniformMatrix4fv(lua_State *L)
 {
-    lmAssert(this == lastBoundShader, "You are setting a uniform for a shader that is not currently bound!");
-
+    static utArray<float> values;
     GLint location = (GLint)lua_tonumber(L, 2);
     bool transpose = lua_toboolean(L, 3) != 0;
-    int length = lsr_vector_get_length(L, 4);
-
-    lua_rawgeti(L, 4, LSINDEXVECTOR);
-    int vidx = lua_gettop(L);
-
-    utArray<float> values;
-
-    values.resize(16 * length);
-    for (int i = 0; i < length; i++)
-    {
-        lua_rawgeti(L, vidx, i);
-        Loom2D::Matrix* mat = (Loom2D::Matrix *)lualoom_getnativepointer(L, -1);
-        mat->copyToMatrix4f(values.ptr() + i * 16);
-    }
-
-    Graphics::context()->glUniformMatrix4fv(location, length, transpose, values.ptr());
-
-    // Pop the vector
-    lua_pop(L, 4);
-    // Pop transpose
-    lua_pop(L, 3);
-    // Pop location
-    lua_pop(L, 2);
+    int length = readUniformMatrixVector(L, 4, 16, values);
 
+    setUniformValue(location, UNIFORM_MATRIX4F, length, transpose, values.ptr());
     return 0;
 }
 
@@ -749,29 +1058,89 @@ void GFX::ShaderProgram::bind()
         // the wrong shader
     }
 
-    lastBoundShader = this;
-
     GFX::GL_Context* ctx = Graphics::context();
 
-    if (fragmentShaderId != fragmentShader->getId() ||
-        vertexShaderId != vertexShader->getId())
+    if (fragmentShaderRevision != fragmentShader->getRevision() ||
+        vertexShaderRevision != vertexShader->getRevision())
     {
-        ctx->glDetachShader(programId, fragmentShaderId);
-        ctx->glDetachShader(programId, vertexShaderId);
+        if (fragmentShaderId != 0)
+            ctx->glDetachShader(programId, fragmentShaderId);
+        if (vertexShaderId != 0)
+            ctx->glDetachShader(programId, vertexShaderId);
         ctx->glDeleteProgram(programId);
+        Graphics_ResetGLStateCache();
         programId = 0;
 
         link();
     }
 
-    ctx->glUseProgram(programId);
+    if (Graphics_CacheUseProgram(programId))
+        ctx->glUseProgram(programId);
+
+    bindAttributes(0, vertexFormat);
+
+    _onBindDelegate.invoke();
+
+    applyUniforms();
+}
+
+int GFX::ShaderProgram::getVertexFormat() const
+{
+    return vertexFormat;
+}
+
+void GFX::ShaderProgram::setVertexFormat(int format)
+{
+    if (format != VERTEXFORMAT_POSCOLORTEX && format != VERTEXFORMAT_COMPACT)
+    {
+        lmLogError(gGFXShaderLogGroup, "Unsupported vertex format %d, keeping %d", format, (int)vertexFormat);
+        return;
+    }
+
+    vertexFormat = (VertexFormat)format;
+}
+
+void GFX::ShaderProgram::bindAttributes(size_t byteOffset, VertexFormat format)
+{
+    GFX::GL_Context* ctx = Graphics::context();
+
+    size_t base = byteOffset;
+
+    if (format == VERTEXFORMAT_COMPACT)
+    {
+        if (posAttribLoc != -1)
+        {
+            ctx->glEnableVertexAttribArray(posAttribLoc);
+            ctx->glVertexAttribPointer(posAttribLoc, 2, GL_FLOAT, false,
+                                       sizeof(VertexPosColorTexCompact),
+                                       (void*)(base + offsetof(VertexPosColorTexCompact, x)));
+        }
+
+        if (posColorLoc != -1)
+        {
+            ctx->glEnableVertexAttribArray(posColorLoc);
+            ctx->glVertexAttribPointer(posColorLoc, 4, GL_UNSIGNED_BYTE, true,
+                                       sizeof(VertexPosColorTexCompact),
+                                       (void*)(base + offsetof(VertexPosColorTexCompact, abgr)));
+        }
+
+        if (posTexCoordLoc != -1)
+        {
+            ctx->glEnableVertexAttribArray(posTexCoordLoc);
+            ctx->glVertexAttribPointer(posTexCoordLoc,
+                                       2, GL_UNSIGNED_SHORT, true, sizeof(VertexPosColorTexCompact),
+                                       (void*)(base + offsetof(VertexPosColorTexCompact, u)));
+        }
+
+        return;
+    }
 
     if (posAttribLoc != -1)
     {
         ctx->glEnableVertexAttribArray(posAttribLoc);
         ctx->glVertexAttribPointer(posAttribLoc, 3, GL_FLOAT, false,
                                    sizeof(VertexPosColorTex),
-                                   (void*)offsetof(VertexPosColorTex, x));
+                                   (void*)(base + offsetof(VertexPosColorTex, x)));
     }
 
     if (posColorLoc != -1)
@@ -779,7 +1148,7 @@ void GFX::ShaderProgram::bind()
         ctx->glEnableVertexAttribArray(posColorLoc);
         ctx->glVertexAttribPointer(posColorLoc, 4, GL_UNSIGNED_BYTE, true,
                                    sizeof(VertexPosColorTex),
-                                   (void*)offsetof(VertexPosColorTex, abgr));
+                                   (void*)(base + offsetof(VertexPosColorTex, abgr)));
     }
 
     if (posTexCoordLoc != -1)
@@ -787,10 +1156,8 @@ void GFX::ShaderProgram::bind()
         ctx->glEnableVertexAttribArray(posTexCoordLoc);
         ctx->glVertexAttribPointer(posTexCoordLoc,
                                    2, GL_FLOAT, false, sizeof(VertexPosColorTex),
-                                   (void*)offsetof(VertexPosColorTex, u));
+                                   (void*)(base + offsetof(VertexPosColorTex, u)));
     }
-
-    _onBindDelegate.invoke();
 }
 
 const char * defaultVertexShader =
@@ -837,8 +1204,10 @@ void GFX::DefaultShader::bind()
 {
     GFX::ShaderProgram::bind();
 
-    Graphics::context()->glUniformMatrix4fv(uMVP, 1, GL_FALSE, Graphics::getMVP());
-    Graphics::context()->glUniform1i(uTexture, textureId);
+    GLint unit = textureId;
+    setUniformValue(uMVP, UNIFORM_MATRIX4F, 1, false, Graphics::getMVP());
+    setUniformValue(uTexture, UNIFORM_1I, 1, false, &unit);
+    applyUniforms();
 }
 
 const char * tintlessFragmentShader =
@@ -869,6 +1238,236 @@ void GFX::TintlessDefaultShader::bind()
 {
     GFX::ShaderProgram::bind();
 
-    Graphics::context()->glUniformMatrix4fv(uMVP, 1, GL_FALSE, Graphics::getMVP());
-    Graphics::context()->glUniform1i(uTexture, textureId);
+    GLint unit = textureId;
+    setUniformValue(uMVP, UNIFORM_MATRIX4F, 1, false, Graphics::getMVP());
+    setUniformValue(uTexture, UNIFORM_1I, 1, false, &unit);
+    applyUniforms();
+}
+
+const char * multiTextureVertexShader =
+"                                                                    \n"
+"attribute vec4 a_position;                                          \n"
+"attribute vec4 a_color0;                                            \n"
+"attribute vec2 a_texcoord0;                                         \n"
+"varying vec2 v_texcoord0;                                           \n"
+"varying vec4 v_color0;                                              \n"
+"varying float v_slot;                                               \n"
+"uniform mat4 u_mvp;                                                 \n"
+"void main()                                                         \n"
+"{                                                                   \n"
+"    gl_Position = u_mvp * vec4(a_position.xy, 0.0, 1.0);            \n"
+"    v_color0 = a_color0;                                            \n"
+"    v_texcoord0 = a_texcoord0;                                      \n"
+"    v_slot = a_position.z;                                          \n"
+"}                                                                   \n";
+
+lmAutoPtr<GFX::ShaderProgram> GFX::ShaderProgram::multiTextureShader;
+lmAutoPtr<GFX::ShaderProgram> GFX::ShaderProgram::tintlessMultiTextureShader;
+
+GFX::MultiTextureShader::MultiTextureShader(bool tinted)
+{
+    GFX::GL_Context* ctx = Graphics::context();
+
+    GLint maxUnits = 0;
+    ctx->glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &maxUnits);
+    textureUnits = maxUnits < GFX_MAX_BATCH_TEXTURES ? maxUnits : GFX_MAX_BATCH_TEXTURES;
+    if (textureUnits < 1)
+        textureUnits = 1;
+
+    // Samplers can only be indexed by constants in GLSL ES 1.0,
+    // so pick the texture with a chain of branches
+    char line[128];
+    utString fragment;
+    snprintf(line, sizeof(line), "uniform sampler2D u_textures[%d];\n", textureUnits);
+    fragment += line;
+    fragment += "varying vec2 v_texcoord0;\n";
+    fragment += "varying vec4 v_color0;\n";
+    fragment += "varying float v_slot;\n";
+    fragment += "void main()\n";
+    fragment += "{\n";
+    fragment += "    vec4 color;\n";
+    for (int i = 0; i < textureUnits - 1; i++)
+    {
+        snprintf(line, sizeof(line), "    %sif (v_slot < %d.5) color = texture2D(u_textures[%d], v_texcoord0);\n", i > 0 ? "else " : "", i, i);
+        fragment += line;
+    }
+    snprintf(line, sizeof(line), "    %scolor = texture2D(u_textures[%d], v_texcoord0);\n", textureUnits > 1 ? "else " : "", textureUnits - 1);
+    fragment += line;
+    fragment += tinted ? "    gl_FragColor = v_color0 * color;\n" : "    gl_FragColor = color;\n";
+    fragment += "}\n";
+
+    load(multiTextureVertexShader, fragment.c_str());
+
+    uTextures = ctx->glGetUniformLocation(programId, "u_textures");
+    uMVP = ctx->glGetUniformLocation(programId, "u_mvp");
+}
+
+int GFX::MultiTextureShader::getTextureUnits() const
+{
+    return textureUnits;
+}
+
+void GFX::MultiTextureShader::bind()
+{
+    GFX::ShaderProgram::bind();
+
+    GLint units[GFX_MAX_BATCH_TEXTURES];
+    for (int i = 0; i < textureUnits; i++)
+        units[i] = i;
+
+    setUniformValue(uMVP, UNIFORM_MATRIX4F, 1, false, Graphics::getMVP());
+    setUniformValue(uTextures, UNIFORM_1I, textureUnits, false, units);
+    applyUniforms();
+}
+
+const char * instancedVertexShader =
+"                                                                    \n"
+"attribute vec2 a_corner;                                            \n"
+"attribute vec4 a_origin;                                            \n"
+"attribute vec4 a_edgeA;                                             \n"
+"attribute vec4 a_edgeB;                                             \n"
+"attribute vec4 a_instanceColor;                                     \n"
+"varying vec2 v_texcoord0;                                           \n"
+"varying vec4 v_color0;                                              \n"
+"uniform mat4 u_mvp;                                                 \n"
+"void main()                                                         \n"
+"{                                                                   \n"
+"    vec4 p = a_origin + a_corner.x * a_edgeA + a_corner.y * a_edgeB;\n"
+"    gl_Position = u_mvp * vec4(p.xy, 0.0, 1.0);                     \n"
+"    v_color0 = a_instanceColor;                                     \n"
+"    v_texcoord0 = p.zw;                                             \n"
+"}                                                                   \n";
+
+lmAutoPtr<GFX::ShaderProgram> GFX::ShaderProgram::instancedShader;
+lmAutoPtr<GFX::ShaderProgram> GFX::ShaderProgram::tintlessInstancedShader;
+
+GFX::InstancedQuadShader::InstancedQuadShader(bool tinted)
+{
+    load(instancedVertexShader, tinted ? defaultFragmentShader : tintlessFragmentShader);
+
+    GFX::GL_Context* ctx = Graphics::context();
+
+    uTexture = ctx->glGetUniformLocation(programId, "u_texture");
+    uMVP = ctx->glGetUniformLocation(programId, "u_mvp");
+
+    cornerLoc = ctx->glGetAttribLocation(programId, "a_corner");
+    originLoc = ctx->glGetAttribLocation(programId, "a_origin");
+    edgeALoc = ctx->glGetAttribLocation(programId, "a_edgeA");
+    edgeBLoc = ctx->glGetAttribLocation(programId, "a_edgeB");
+    instanceColorLoc = ctx->glGetAttribLocation(programId, "a_instanceColor");
+}
+
+void GFX::InstancedQuadShader::bind()
+{
+    GFX::ShaderProgram::bind();
+
+    GLint unit = textureId;
+    setUniformValue(uMVP, UNIFORM_MATRIX4F, 1, false, Graphics::getMVP());
+    setUniformValue(uTexture, UNIFORM_1I, 1, false, &unit);
+    applyUniforms();
+}
+
+void GFX::InstancedQuadShader::bindInstances(GLuint cornerBuffer, GLuint instanceBuffer, size_t byteOffset)
+{
+    GFX::GL_Context* ctx = Graphics::context();
+
+    if (cornerLoc != -1)
+    {
+        if (Graphics_CacheBindBuffer(GL_ARRAY_BUFFER, cornerBuffer))
+            ctx->glBindBuffer(GL_ARRAY_BUFFER, cornerBuffer);
+        ctx->glEnableVertexAttribArray(cornerLoc);
+        ctx->glVertexAttribPointer(cornerLoc, 2, GL_FLOAT, false, 2 * sizeof(float), NULL);
+    }
+
+    if (Graphics_CacheBindBuffer(GL_ARRAY_BUFFER, instanceBuffer))
+        ctx->glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+
+    const GLint locs[] = { originLoc, edgeALoc, edgeBLoc };
+    const size_t offsets[] = { offsetof(QuadInstance, x), offsetof(QuadInstance, ax), offsetof(QuadInstance, bx) };
+
+    for (int i = 0; i < 3; i++)
+    {
+        if (locs[i] == -1)
+            continue;
+
+        ctx->glEnableVertexAttribArray(locs[i]);
+        ctx->glVertexAttribPointer(locs[i], 4, GL_FLOAT, false, sizeof(QuadInstance),
+                                   (void*)(byteOffset + offsets[i]));
+        ctx->glVertexAttribDivisor(locs[i], 1);
+    }
+
+    if (instanceColorLoc != -1)
+    {
+        ctx->glEnableVertexAttribArray(instanceColorLoc);
+        ctx->glVertexAttribPointer(instanceColorLoc, 4, GL_UNSIGNED_BYTE, true, sizeof(QuadInstance),
+                                   (void*)(byteOffset + offsetof(QuadInstance, abgr)));
+        ctx->glVertexAttribDivisor(instanceColorLoc, 1);
+    }
+}
+
+void GFX::InstancedQuadShader::unbindInstances()
+{
+    GFX::GL_Context* ctx = Graphics::context();
+
+    const GLint locs[] = { originLoc, edgeALoc, edgeBLoc, instanceColorLoc };
+    for (int i = 0; i < 4; i++)
+    {
+        if (locs[i] != -1)
+        {
+            ctx->glVertexAttribDivisor(locs[i], 0);
+            ctx->glDisableVertexAttribArray(locs[i]);
+        }
+    }
+
+    // The corner buffer only holds a single quad
+    if (cornerLoc != -1)
+        ctx->glDisableVertexAttribArray(cornerLoc);
+}
+
+const char * externalFragmentShader =
+"#extension GL_OES_EGL_image_external : require                      \n"
+#if LOOM_RENDERER_OPENGLES2
+"precision mediump float;                                            \n"
+#endif
+"uniform samplerExternalOES u_texture;                               \n"
+"varying vec2 v_texcoord0;                                           \n"
+"varying vec4 v_color0;                                              \n"
+"void main()                                                         \n"
+"{                                                                   \n"
+"    gl_FragColor = v_color0 * texture2D(u_texture, v_texcoord0);    \n"
+"}                                                                   \n";
+
+const char * tintlessExternalFragmentShader =
+"#extension GL_OES_EGL_image_external : require                      \n"
+#if LOOM_RENDERER_OPENGLES2
+"precision mediump float;                                            \n"
+#endif
+"uniform samplerExternalOES u_texture;                               \n"
+"varying vec2 v_texcoord0;                                           \n"
+"void main()                                                         \n"
+"{                                                                   \n"
+"    gl_FragColor = texture2D(u_texture, v_texcoord0);               \n"
+"}                                                                   \n";
+
+lmAutoPtr<GFX::ShaderProgram> GFX::ShaderProgram::externalShader;
+lmAutoPtr<GFX::ShaderProgram> GFX::ShaderProgram::tintlessExternalShader;
+
+GFX::ExternalTextureShader::ExternalTextureShader(bool tinted)
+{
+    load(defaultVertexShader, tinted ? externalFragmentShader : tintlessExternalFragmentShader);
+
+    GFX::GL_Context* ctx = Graphics::context();
+
+    uTexture = ctx->glGetUniformLocation(programId, "u_texture");
+    uMVP = ctx->glGetUniformLocation(programId, "u_mvp");
+}
+
+void GFX::ExternalTextureShader::bind()
+{
+    GFX::ShaderProgram::bind();
+
+    GLint unit = textureId;
+    setUniformValue(uMVP, UNIFORM_MATRIX4F, 1, false, Graphics::getMVP());
+    setUniformValue(uTexture, UNIFORM_1I, 1, false, &unit);
+    applyUniforms();
 }
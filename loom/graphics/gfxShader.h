@@ -31,6 +31,42 @@ namespace GFX {
 // Forward declaration
 class Shader;
 
+// Vertex layouts QuadRenderer can upload to the GPU
+enum VertexFormat
+{
+    // VertexPosColorTex, 24 bytes
+    VERTEXFORMAT_POSCOLORTEX = 0,
+    // VertexPosColorTexCompact, 16 bytes: no z and 16-bit normalized texture
+    // coordinates. Batches using textures that wrap fall back to the full
+    // format since their coordinates may be outside of [0, 1].
+    VERTEXFORMAT_COMPACT     = 1,
+};
+
+// The glUniform* call a stored uniform value is uploaded with
+enum UniformType
+{
+    UNIFORM_1F,
+    UNIFORM_2F,
+    UNIFORM_3F,
+    UNIFORM_1I,
+    UNIFORM_2I,
+    UNIFORM_3I,
+    UNIFORM_MATRIX3F,
+    UNIFORM_MATRIX4F,
+};
+
+// A uniform value as last set on a ShaderProgram
+struct UniformValue
+{
+    GLint location;
+    UniformType type;
+    int count;
+    bool transpose;
+    // Set until the value is uploaded to the program
+    bool dirty;
+    utArray<unsigned char> data;
+};
+
 // An entry struct for our "cache". Keeps a reference count along with the Shader object.
 struct ShaderEntry
 {
@@ -64,6 +100,12 @@ private:
     GLenum type;
     utString name;
 
+    // Source is kept until compiled, programs restored from a
+    // program binary never need it compiled at all
+    utString source;
+    utString sourceHash;
+    int revision;
+
     char* getSourceFromAsset();
 
 public:
@@ -77,7 +119,16 @@ public:
     utString getName() const;
     const utString& getAssetName() const;
 
+    // SHA-256 of the source as it's handed to the driver
+    const utString& getSourceHash() const;
+
+    // Incremented every time new source is loaded
+    int getRevision() const;
+
+    // Sets the source, compilation is deferred until compile() is
+    // called, returns false if there is no source
     bool load(const char* source);
+    bool compile();
     void reload();
 
     bool validate();
@@ -86,8 +137,13 @@ public:
 
 /*
  * A class to handle custom GLSL shaders. Once constructed, they must be loaded
- * from strings or assets. After binding uniforms should be set using 'setUniform' set
- * of methods - this can be achieved using a delegate 'onBind'.
+ * from strings or assets. Uniforms are set using the 'setUniform' set of methods,
+ * either in the 'onBind' delegate or at any time between draws.
+ *
+ * Uniform values are stored per program and only uploaded when they change,
+ * as GL keeps them with the program between binds. Changing a value set for
+ * quads that are still batched submits the batch first, so every quad is
+ * drawn with the values in effect when it was drawn.
  *
  * 'mvp' and 'textureId' are automatically set by the renderer before binding.
  *
@@ -102,13 +158,33 @@ public:
     static ShaderProgram* getDefaultShader();
     static lmAutoPtr<ShaderProgram> tintlessDefaultShader;
     static ShaderProgram* getTintlessDefaultShader();
+    static lmAutoPtr<ShaderProgram> multiTextureShader;
+    static ShaderProgram* getMultiTextureShader();
+    static lmAutoPtr<ShaderProgram> tintlessMultiTextureShader;
+    static ShaderProgram* getTintlessMultiTextureShader();
+    static lmAutoPtr<ShaderProgram> instancedShader;
+    static ShaderProgram* getInstancedShader();
+    static lmAutoPtr<ShaderProgram> tintlessInstancedShader;
+    static ShaderProgram* getTintlessInstancedShader();
+    static lmAutoPtr<ShaderProgram> externalShader;
+    static ShaderProgram* getExternalShader();
+    static lmAutoPtr<ShaderProgram> tintlessExternalShader;
+    static ShaderProgram* getTintlessExternalShader();
 
 protected:
 
     GLuint programId;
+
+    // The shaders attached to the program, 0 if it was restored from
+    // a program binary and has none attached
     GLuint fragmentShaderId;
     GLuint vertexShaderId;
 
+    // Shader revisions the program was linked from, it's relinked
+    // when either shader is reloaded
+    int fragmentShaderRevision;
+    int vertexShaderRevision;
+
     Shader* fragmentShader;
     Shader* vertexShader;
 
@@ -119,9 +195,21 @@ protected:
     Loom2D::Matrix mvp;
     GLuint textureId;
 
+    VertexFormat vertexFormat;
+
+    // Uniform locations looked up by name, cleared when relinked
+    utHashTable<utHashedString, GLint> uniformLocations;
+
+    // Values are kept in the order first set, programs use a handful
+    utArray<UniformValue> uniformValues;
+    bool uniformsDirty;
+
     // Disable copy constructor
     ShaderProgram(const ShaderProgram& copy);
 
+    // Stores the value and marks it for upload if it differs from the stored one
+    void setUniformValue(GLint location, UniformType type, int count, bool transpose, const void *data);
+
 public:
 
     ShaderProgram();
@@ -137,6 +225,11 @@ public:
     void link();
     bool validate();
 
+    // Restores the program from the program binary cache, returns
+    // false if it isn't cached or the driver rejected the binary
+    bool loadBinary(const utString& key);
+    void saveBinary(const utString& key);
+
     GLint getUniformLocation(const char* name);
     void setUniform1f(GLint location, GLfloat v0);
     int setUniform1fv(lua_State *L);
@@ -161,8 +254,21 @@ public:
     GLuint getTextureId() const;
     void setTextureId(GLuint _id);
 
+    // The layout QuadRenderer uploads vertices in for this shader
+    int getVertexFormat() const;
+    void setVertexFormat(int format);
+
     virtual void bind();
 
+    // Uploads the uniform values changed since they were last uploaded,
+    // binds the program if it isn't current
+    void applyUniforms();
+
+    // Points the vertex attributes at the currently bound array buffer,
+    // starting at the given byte offset, bind() calls this with 0 and
+    // the shader's own vertex format
+    void bindAttributes(size_t byteOffset, VertexFormat format);
+
     LOOM_DELEGATE(onBind);
 };
 
@@ -194,4 +300,76 @@ public:
     virtual void bind();
 };
 
+// The maximum number of textures MultiTextureShader samples from
+#define GFX_MAX_BATCH_TEXTURES 8
+
+// Like DefaultShader (or TintlessDefaultShader), but samples from one of
+// several textures bound to consecutive texture units. The texture slot is
+// read from the z coordinate of the vertex position, QuadRenderer fills it
+// in when batching quads with different textures into one draw call.
+class MultiTextureShader : public ShaderProgram
+{
+protected:
+
+    GLint uTextures;
+    GLint uMVP;
+    int textureUnits;
+
+public:
+    MultiTextureShader(bool tinted);
+
+    // Number of texture units sampled, limited by GL_MAX_TEXTURE_IMAGE_UNITS
+    int getTextureUnits() const;
+
+    virtual void bind();
+};
+
+// Like DefaultShader (or TintlessDefaultShader), but draws one quad per
+// instance. Each instance is a QuadInstance record holding the first
+// corner and the two edges of the quad in position and texture space,
+// the corners are expanded from a static per-vertex corner buffer.
+class InstancedQuadShader : public ShaderProgram
+{
+protected:
+
+    GLint uTexture;
+    GLint uMVP;
+
+    GLint cornerLoc;
+    GLint originLoc;
+    GLint edgeALoc;
+    GLint edgeBLoc;
+    GLint instanceColorLoc;
+
+public:
+    InstancedQuadShader(bool tinted);
+
+    virtual void bind();
+
+    // Points the corner attribute at cornerBuffer and the instance
+    // attributes at instanceBuffer, starting at the given byte offset.
+    // Leaves instanceBuffer bound to GL_ARRAY_BUFFER.
+    void bindInstances(GLuint cornerBuffer, GLuint instanceBuffer, size_t byteOffset);
+
+    // Resets the attribute divisors and disables the arrays, as they
+    // apply to the attribute indices of every other program too
+    void unbindInstances();
+};
+
+// Like DefaultShader (or TintlessDefaultShader), but samples an external
+// OES texture, which Android decodes video frames into. Only builds on
+// OpenGL ES with GL_OES_EGL_image_external, so it's created on first use.
+class ExternalTextureShader : public ShaderProgram
+{
+protected:
+
+    GLint uTexture;
+    GLint uMVP;
+
+public:
+    ExternalTextureShader(bool tinted);
+
+    virtual void bind();
+};
+
 }
@@ -30,6 +30,9 @@ bool Graphics_IsGLStateValid(enum Graphics_GLState state)
 void Graphics_InvalidateGLState(enum Graphics_GLState state)
 {
     gGLStates[(int)state] = false;
+
+    // Whatever invalidated the state may have bypassed the cache
+    Graphics_ResetGLStateCache();
 }
 
 void Graphics_SetCurrentGLState(enum Graphics_GLState state)
@@ -41,4 +44,258 @@ void Graphics_SetCurrentGLState(enum Graphics_GLState state)
     }
 
     gGLStates[(int)state] = true;
+}
+
+/*
+ * GL enums used by the state cache, defined here so the cache
+ * doesn't have to pull in the platform GL headers.
+ */
+#define GFX_GL_ARRAY_BUFFER         0x8892
+#define GFX_GL_ELEMENT_ARRAY_BUFFER 0x8893
+#define GFX_GL_TEXTURE0             0x84C0
+#define GFX_GL_BLEND                0x0BE2
+#define GFX_GL_CULL_FACE            0x0B44
+#define GFX_GL_DEPTH_TEST           0x0B71
+#define GFX_GL_SCISSOR_TEST         0x0C11
+#define GFX_GL_STENCIL_TEST         0x0B90
+
+#define GFX_STATE_UNKNOWN           0xFFFFFFFFu
+#define GFX_STATE_TEXTURE_UNITS     32
+
+enum Graphics_CachedCap {
+    GFX_CAP_BLEND = 0,
+    GFX_CAP_CULL_FACE,
+    GFX_CAP_DEPTH_TEST,
+    GFX_CAP_SCISSOR_TEST,
+    GFX_CAP_STENCIL_TEST,
+    GFX_CAP_MAX
+};
+
+typedef struct Graphics_StateCache {
+    unsigned int arrayBuffer;
+    unsigned int elementBuffer;
+    unsigned int program;
+    unsigned int activeTexture;
+    unsigned int textures[GFX_STATE_TEXTURE_UNITS];
+    int caps[GFX_CAP_MAX];
+    unsigned int blendFunc[4];
+    unsigned int blendEquation[2];
+    int scissor[4];
+    int viewport[4];
+    unsigned int stencilFunc[3];
+    unsigned int stencilMask;
+    bool stencilMaskValid;
+    bool scissorValid;
+    bool viewportValid;
+} Graphics_StateCache;
+
+static Graphics_StateCache gStateCache;
+static bool gStateCacheInitialized = false;
+static unsigned int gStateCacheIssued = 0;
+static unsigned int gStateCacheFiltered = 0;
+
+void Graphics_ResetGLStateCache(void)
+{
+    int i;
+
+    gStateCache.arrayBuffer = GFX_STATE_UNKNOWN;
+    gStateCache.elementBuffer = GFX_STATE_UNKNOWN;
+    gStateCache.program = GFX_STATE_UNKNOWN;
+    gStateCache.activeTexture = GFX_STATE_UNKNOWN;
+    for (i = 0; i < GFX_STATE_TEXTURE_UNITS; i++)
+    {
+        gStateCache.textures[i] = GFX_STATE_UNKNOWN;
+    }
+    for (i = 0; i < (int)GFX_CAP_MAX; i++)
+    {
+        gStateCache.caps[i] = -1;
+    }
+    for (i = 0; i < 4; i++)
+    {
+        gStateCache.blendFunc[i] = GFX_STATE_UNKNOWN;
+    }
+    gStateCache.blendEquation[0] = gStateCache.blendEquation[1] = GFX_STATE_UNKNOWN;
+    gStateCache.stencilFunc[0] = GFX_STATE_UNKNOWN;
+    gStateCache.stencilMaskValid = false;
+    gStateCache.scissorValid = false;
+    gStateCache.viewportValid = false;
+
+    gStateCacheInitialized = true;
+}
+
+// Counts the call and returns whether it has to be issued
+static bool Graphics_CacheResult(bool changed)
+{
+    if (changed)
+        gStateCacheIssued++;
+    else
+        gStateCacheFiltered++;
+    return changed;
+}
+
+static bool Graphics_CacheUpdate(unsigned int *cached, unsigned int value)
+{
+    if (!gStateCacheInitialized)
+        Graphics_ResetGLStateCache();
+
+    if (*cached == value)
+        return Graphics_CacheResult(false);
+
+    *cached = value;
+    return Graphics_CacheResult(true);
+}
+
+static bool Graphics_CacheUpdateRect(int *cached, bool *valid, int x, int y, int width, int height)
+{
+    if (!gStateCacheInitialized)
+        Graphics_ResetGLStateCache();
+
+    if (*valid && cached[0] == x && cached[1] == y && cached[2] == width && cached[3] == height)
+        return Graphics_CacheResult(false);
+
+    cached[0] = x;
+    cached[1] = y;
+    cached[2] = width;
+    cached[3] = height;
+    *valid = true;
+    return Graphics_CacheResult(true);
+}
+
+bool Graphics_CacheBindBuffer(unsigned int target, unsigned int buffer)
+{
+    switch (target)
+    {
+        case GFX_GL_ARRAY_BUFFER: return Graphics_CacheUpdate(&gStateCache.arrayBuffer, buffer);
+        case GFX_GL_ELEMENT_ARRAY_BUFFER: return Graphics_CacheUpdate(&gStateCache.elementBuffer, buffer);
+    }
+    return Graphics_CacheResult(true);
+}
+
+bool Graphics_CacheUseProgram(unsigned int program)
+{
+    return Graphics_CacheUpdate(&gStateCache.program, program);
+}
+
+bool Graphics_CacheActiveTexture(unsigned int texture)
+{
+    return Graphics_CacheUpdate(&gStateCache.activeTexture, texture);
+}
+
+bool Graphics_CacheBindTexture(unsigned int texture)
+{
+    unsigned int unit;
+
+    if (!gStateCacheInitialized)
+        Graphics_ResetGLStateCache();
+
+    // Without a known active unit the binding can't be tracked
+    unit = gStateCache.activeTexture - GFX_GL_TEXTURE0;
+    if (gStateCache.activeTexture == GFX_STATE_UNKNOWN || unit >= GFX_STATE_TEXTURE_UNITS)
+        return Graphics_CacheResult(true);
+
+    return Graphics_CacheUpdate(&gStateCache.textures[unit], texture);
+}
+
+bool Graphics_CacheEnable(unsigned int cap, bool enabled)
+{
+    int index;
+
+    switch (cap)
+    {
+        case GFX_GL_BLEND: index = GFX_CAP_BLEND; break;
+        case GFX_GL_CULL_FACE: index = GFX_CAP_CULL_FACE; break;
+        case GFX_GL_DEPTH_TEST: index = GFX_CAP_DEPTH_TEST; break;
+        case GFX_GL_SCISSOR_TEST: index = GFX_CAP_SCISSOR_TEST; break;
+        case GFX_GL_STENCIL_TEST: index = GFX_CAP_STENCIL_TEST; break;
+        default: return Graphics_CacheResult(true);
+    }
+
+    if (!gStateCacheInitialized)
+        Graphics_ResetGLStateCache();
+
+    if (gStateCache.caps[index] == (enabled ? 1 : 0))
+        return Graphics_CacheResult(false);
+
+    gStateCache.caps[index] = enabled ? 1 : 0;
+    return Graphics_CacheResult(true);
+}
+
+bool Graphics_CacheBlendFunc(unsigned int srcRGB, unsigned int dstRGB, unsigned int srcAlpha, unsigned int dstAlpha)
+{
+    unsigned int *cached = gStateCache.blendFunc;
+
+    if (!gStateCacheInitialized)
+        Graphics_ResetGLStateCache();
+
+    if (cached[0] == srcRGB && cached[1] == dstRGB && cached[2] == srcAlpha && cached[3] == dstAlpha)
+        return Graphics_CacheResult(false);
+
+    cached[0] = srcRGB;
+    cached[1] = dstRGB;
+    cached[2] = srcAlpha;
+    cached[3] = dstAlpha;
+    return Graphics_CacheResult(true);
+}
+
+bool Graphics_CacheBlendEquation(unsigned int modeRGB, unsigned int modeAlpha)
+{
+    unsigned int *cached = gStateCache.blendEquation;
+
+    if (!gStateCacheInitialized)
+        Graphics_ResetGLStateCache();
+
+    if (cached[0] == modeRGB && cached[1] == modeAlpha)
+        return Graphics_CacheResult(false);
+
+    cached[0] = modeRGB;
+    cached[1] = modeAlpha;
+    return Graphics_CacheResult(true);
+}
+
+bool Graphics_CacheScissor(int x, int y, int width, int height)
+{
+    return Graphics_CacheUpdateRect(gStateCache.scissor, &gStateCache.scissorValid, x, y, width, height);
+}
+
+bool Graphics_CacheViewport(int x, int y, int width, int height)
+{
+    return Graphics_CacheUpdateRect(gStateCache.viewport, &gStateCache.viewportValid, x, y, width, height);
+}
+
+bool Graphics_CacheStencilFunc(unsigned int func, int ref, unsigned int mask)
+{
+    unsigned int *cached = gStateCache.stencilFunc;
+
+    if (!gStateCacheInitialized)
+        Graphics_ResetGLStateCache();
+
+    if (cached[0] == func && cached[1] == (unsigned int)ref && cached[2] == mask)
+        return Graphics_CacheResult(false);
+
+    cached[0] = func;
+    cached[1] = (unsigned int)ref;
+    cached[2] = mask;
+    return Graphics_CacheResult(true);
+}
+
+bool Graphics_CacheStencilMask(unsigned int mask)
+{
+    if (!gStateCacheInitialized)
+        Graphics_ResetGLStateCache();
+
+    // All bits set is a valid mask, so it can't be the unknown marker
+    if (gStateCache.stencilMaskValid && gStateCache.stencilMask == mask)
+        return Graphics_CacheResult(false);
+
+    gStateCache.stencilMask = mask;
+    gStateCache.stencilMaskValid = true;
+    return Graphics_CacheResult(true);
+}
+
+void Graphics_TakeGLStateCacheCounters(unsigned int *issued, unsigned int *filtered)
+{
+    *issued = gStateCacheIssued;
+    *filtered = gStateCacheFiltered;
+    gStateCacheIssued = 0;
+    gStateCacheFiltered = 0;
 }
\ No newline at end of file
@@ -57,6 +57,42 @@ void Graphics_InvalidateGLState(enum Graphics_GLState state);
  */
 void Graphics_SetCurrentGLState(enum Graphics_GLState state);
 
+/*
+ * Shadow copy of the GL state touched by the renderers, used to filter
+ * out redundant calls before they reach the driver. Each of the
+ * Graphics_Cache* functions records the requested value and returns
+ * true only if it differs from the known one, in which case the caller
+ * has to issue the matching GL call, e.g.
+ *
+ *     if (Graphics_CacheUseProgram(program))
+ *         ctx->glUseProgram(program);
+ *
+ * Code that changes GL state without going through the cache (nanovg,
+ * object deletion, context loss) must call Graphics_ResetGLStateCache.
+ */
+bool Graphics_CacheBindBuffer(unsigned int target, unsigned int buffer);
+bool Graphics_CacheUseProgram(unsigned int program);
+bool Graphics_CacheActiveTexture(unsigned int texture);
+bool Graphics_CacheBindTexture(unsigned int texture);
+bool Graphics_CacheEnable(unsigned int cap, bool enabled);
+bool Graphics_CacheBlendFunc(unsigned int srcRGB, unsigned int dstRGB, unsigned int srcAlpha, unsigned int dstAlpha);
+bool Graphics_CacheBlendEquation(unsigned int modeRGB, unsigned int modeAlpha);
+bool Graphics_CacheScissor(int x, int y, int width, int height);
+bool Graphics_CacheViewport(int x, int y, int width, int height);
+bool Graphics_CacheStencilFunc(unsigned int func, int ref, unsigned int mask);
+bool Graphics_CacheStencilMask(unsigned int mask);
+
+/*
+ * Forgets all of the cached state, the next call of every kind is issued.
+ */
+void Graphics_ResetGLStateCache(void);
+
+/*
+ * Returns the number of calls issued and filtered out by the cache
+ * since the last call and restarts counting.
+ */
+void Graphics_TakeGLStateCacheCounters(unsigned int *issued, unsigned int *filtered);
+
 #ifdef __cplusplus
 };
 #endif
\ No newline at end of file
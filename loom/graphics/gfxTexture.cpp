@@ -26,26 +26,51 @@
 #include "loom/common/core/assert.h"
 #include "loom/common/core/allocator.h"
 #include "loom/common/core/log.h"
+#include "loom/common/core/string.h"
 #include "loom/common/utils/utTypes.h"
 
 #include "loom/graphics/gfxGraphics.h"
+#include "loom/graphics/gfxFrameCapture.h"
+#include "loom/graphics/gfxImageResize.h"
 #include "loom/graphics/gfxQuadRenderer.h"
 #include "loom/graphics/gfxStateManager.h"
+#include "loom/graphics/gfxVideoTexture.h"
 
 #include "loom/script/runtime/lsProfiler.h"
 
 
+#include "loom/common/platform/platformIO.h"
+#include "loom/common/platform/platformJobs.h"
 #include "loom/common/platform/platformTime.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GFX_TEXTURE_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define GFX_TEXTURE_NEON 1
+#include <arm_neon.h>
+#endif
+
 lmDefineLogGroup(gGFXTextureLogGroup, "gfx.tex", 1, LoomLogInfo);
 loom_allocator_t *gGFXTextureAllocator = NULL;
 
+// Mipmaps built by the async jobs for the image being created, used by
+// upload while it's of the same size
+static uint32_t *sPrebuiltMipChain = NULL;
+static int sPrebuiltMipWidth = 0;
+static int sPrebuiltMipHeight = 0;
+
 
 namespace GFX
 {
 
-TextureInfo Texture::sTextureInfos[MAXTEXTURES];
-utHashTable<utFastStringHash, TextureID> Texture::sTexturePathLookup;
+static uint32_t *buildMipChain(uint32_t *image, int width, int height);
+static void uploadMipChain(uint32_t *chain, int width, int height, int xoffset, int yoffset, int format, bool dither);
+
+Texture::TexturePage *volatile Texture::sTexturePages[TEXTURE_MAX_PAGES];
+int Texture::sTextureSlotCount = 0;
+utArray<int> Texture::sFreeTextureSlots;
+utFlatHashTable<utFastStringHash, TextureID> Texture::sTexturePathLookup;
 bool Texture::sTextureAssetNofificationsEnabled = true;
 bool Texture::supportsFullNPOT;
 TextureID Texture::currentRenderTexture = -1;
@@ -56,18 +81,42 @@ utList<AsyncLoadNote> Texture::sAsyncLoadQueue;
 //queue of loaded texture data to be created back in the main thread
 utList<AsyncLoadNote> Texture::sAsyncCreateQueue;
 
-//flag indicating if the async loading thread is currently running
-ThreadHandle Texture::sAsyncThread = NULL;
+//background jobs decoding async loaded textures
+int Texture::sAsyncJobCount = 0;
+
+//flag indicating if the async loading jobs should keep running
 bool Texture::sAsyncThreadRunning = false;
 
 //mutex used for locking sAsyncLoadQueue and sAsyncCreateQueue between threads
 MutexHandle Texture::sAsyncQueueMutex = NULL;
 
-//mutex used for locking sTextureInfos and sTexturePathLookup between threads
+//mutex used for locking TextureInfo allocation and sTexturePathLookup between threads
 MutexHandle Texture::sTexInfoLock = NULL;
 
 static utArray<GLuint> gGLTextureHandlePool;
 
+bool Texture::sAtlasEnabled = false;
+utArray<Texture::AtlasPage*> Texture::sAtlasPages;
+
+utArray<int> Texture::sCompressedFormats;
+
+Texture::StreamingUpload Texture::sStreamingUpload;
+bool Texture::sStreaming = false;
+int Texture::sUploadBudget = TEXTURE_UPLOAD_BUDGET;
+bool Texture::sKeepSourceBytes = false;
+utArray<Texture::FormatRule> Texture::sFormatRules;
+GLuint Texture::sUploadPixelBuffer = 0;
+
+size_t Texture::sTextureMemory = 0;
+size_t Texture::sTextureMemoryBudget = 0;
+
+utArray<Texture::PooledRenderTarget> Texture::sRenderTargetPool;
+int Texture::sRenderTargetPoolHits = 0;
+int Texture::sRenderTargetPoolMisses = 0;
+
+// Not in the GLES2 headers
+#define GFX_GL_PIXEL_UNPACK_BUFFER 0x88EC
+
 static GLuint popGLTextureHandle()
 {
     if (gGLTextureHandlePool.size() == 0)
@@ -83,6 +132,70 @@ static GLuint popGLTextureHandle()
     return last;
 }
 
+// Estimated GPU memory of a texture, a full mipmap chain adds a third
+static size_t textureMemoryBytes(int width, int height, bool mipmaps, int format = PIXEL_FORMAT_RGBA8888)
+{
+    size_t bytes = (size_t)width * height * pixelFormatBytes(format);
+    return mipmaps ? bytes * 4 / 3 : bytes;
+}
+
+// The GL format and type pixels of a PixelFormat are uploaded as. The
+// unsized formats are what ES2 has, desktop drivers may still keep them
+// at 8 bits per channel.
+static void pixelFormatGL(int format, GLenum &glFormat, GLenum &glType)
+{
+    switch (format)
+    {
+    case PIXEL_FORMAT_RGB565:
+        glFormat = GL_RGB;
+        glType = GL_UNSIGNED_SHORT_5_6_5;
+        break;
+    case PIXEL_FORMAT_RGBA4444:
+        glFormat = GL_RGBA;
+        glType = GL_UNSIGNED_SHORT_4_4_4_4;
+        break;
+    default:
+        glFormat = GL_RGBA;
+        glType = GL_UNSIGNED_BYTE;
+        break;
+    }
+}
+
+// Uploads width x height RGBA pixels into level of the bound texture,
+// converted to format, or the region at xoffset, yoffset of it when
+// they're not negative
+static void uploadPixels(int level, const uint8_t *data, int width, int height, int xoffset, int yoffset, int format, bool dither)
+{
+    GLenum glFormat, glType;
+    pixelFormatGL(format, glFormat, glType);
+
+    const void *pixels = data;
+    uint16_t *converted = NULL;
+    if (format != PIXEL_FORMAT_RGBA8888)
+    {
+        if (data != NULL)
+        {
+            converted = static_cast<uint16_t*>(lmAlloc(NULL, (size_t)width * height * 2));
+            convertPixels(data, width, height, converted, format, dither);
+            pixels = converted;
+        }
+
+        // Rows of an odd number of 16 bit pixels aren't 4 byte aligned
+        Graphics::context()->glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    }
+
+    if (xoffset < 0 || yoffset < 0)
+        Graphics::context()->glTexImage2D(GL_TEXTURE_2D, level, glFormat, width, height, 0, glFormat, glType, pixels);
+    else
+        Graphics::context()->glTexSubImage2D(GL_TEXTURE_2D, level, xoffset, yoffset, width, height, glFormat, glType, pixels);
+
+    if (format != PIXEL_FORMAT_RGBA8888)
+    {
+        Graphics::context()->glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        lmSafeFree(NULL, converted);
+    }
+}
+
 static void storeGLTextureHandle(GLuint id)
 {
     // Push front - it's a little slower but saves us from recycling IDs inappropriately.
@@ -91,13 +204,8 @@ static void storeGLTextureHandle(GLuint id)
 
 void Texture::initialize()
 {
-    for (int i = 0; i < MAXTEXTURES; i++)
-    {
-        sTextureInfos[i].id         = i;
-        sTextureInfos[i].reload     = false;
-        sTextureInfos[i].asyncDispose = false;
-        sTextureInfos[i].handle     = -1;
-    }
+    gGFXTextureAllocator = loom_allocator_getTaggedAllocator("gfx.texture");
+
     Texture::sTexInfoLock = loom_mutex_create();
     Texture::sAsyncQueueMutex = loom_mutex_create();
 
@@ -107,22 +215,30 @@ void Texture::initialize()
     Texture::supportsFullNPOT = true;
 #endif
 
+    detectCompressedFormats();
 }
 
 void Texture::shutdown()
 {
     lmLogDebug(gGFXTextureLogGroup, "Texture shutdown");
     stopAsyncThread();
+    cancelStreamingUpload(false);
+    if (sUploadPixelBuffer != 0)
+    {
+        Graphics::context()->glDeleteBuffers(1, &sUploadPixelBuffer);
+        sUploadPixelBuffer = 0;
+    }
     loom_mutex_lock(Texture::sTexInfoLock);
-    for (int i = 0; i < MAXTEXTURES; i++)
+    for (int i = 0; i < sTextureSlotCount; i++)
     {
-        TextureInfo *tinfo = &sTextureInfos[i];
+        TextureInfo *tinfo = getTextureSlot(i);
 
         if (tinfo->handle != -1)
         {
             Texture::dispose(tinfo->id);
         }
     }
+    trimRenderTargetPool(Graphics::getCurrentFrame() + 1);
     loom_mutex_unlock(Texture::sTexInfoLock);
 }
 
@@ -130,13 +246,29 @@ void Texture::tick()
 {
     LOOM_PROFILE_SCOPE(textureTick);
 
-    int startTime;
+    //process the textures queued up for creation inside of the async load thread within
+    //the upload budget so we don't bog the main thread down, but at least one per frame
+    int startTime = platform_getMilliseconds();
+    int budget = sUploadBudget;
+    bool first = true;
 
-    //process any textures queued up for creation inside of the async load thread
-    //only process a single texture per frame so we don't bog the main thread down
-    loom_mutex_lock(Texture::sAsyncQueueMutex);
-    if(!Texture::sAsyncCreateQueue.empty())
+    while (first || (budget > 0 && platform_getMilliseconds() - startTime < TEXTURE_UPLOAD_BUDGET_MS))
     {
+        first = false;
+
+        if (sStreaming)
+        {
+            budget -= continueStreamingUpload(budget);
+            continue;
+        }
+
+        loom_mutex_lock(Texture::sAsyncQueueMutex);
+        if(Texture::sAsyncCreateQueue.empty())
+        {
+            loom_mutex_unlock(Texture::sAsyncQueueMutex);
+            break;
+        }
+
         //get the note containing the information for this texture
         AsyncLoadNote threadNote = Texture::sAsyncCreateQueue.front();
         Texture::sAsyncCreateQueue.pop_front();
@@ -147,56 +279,316 @@ void Texture::tick()
         // Last resort for texture info getting invalidated while loading (perhaps during live reload)
         // TODO: Can we eliminate this from ever happening and turn it into an assert?
         if (threadNote.tinfo->handle == -1) {
+            threadNote.tinfo->asyncPending = false;
             loom_mutex_unlock(Texture::sTexInfoLock);
-            threadNote.iaCleanup(threadNote.imageAsset);
-            return;
+            if (threadNote.imageAsset != NULL)
+                threadNote.iaCleanup(threadNote.imageAsset);
+            lmSafeFree(NULL, threadNote.mipChain);
+            continue;
         }
         loom_mutex_unlock(Texture::sTexInfoLock);
 
-        //handleAssetNotification does the actual creation of the texture data immediately below when '1' is specified
-        startTime = platform_getMilliseconds();
-        if(!threadNote.path.empty())
-        {
-            //Texture is an Asset, so Create via handleAssetNotification
-            loom_asset_subscribe(threadNote.path.c_str(), Texture::handleAssetNotification, (void *)(size_t)threadNote.id, 1);
-            lmLogDebug(gGFXTextureLogGroup, "Async loaded texture '%s' took %i ms to create", threadNote.path.c_str(), platform_getMilliseconds() - startTime);
-        }
-        else
+        if (!beginStreamingUpload(threadNote))
+            budget -= createAsyncTexture(threadNote);
+    }
+
+    VideoTexture::tick();
+
+    enforceMemoryBudget();
+
+    uint32_t frame = Graphics::getCurrentFrame();
+    if (frame > TEXTURE_RENDER_TARGET_POOL_FRAMES)
+        trimRenderTargetPool(frame - TEXTURE_RENDER_TARGET_POOL_FRAMES);
+}
+
+int Texture::createAsyncTexture(AsyncLoadNote &threadNote)
+{
+    int bytes = 0;
+
+    if (threadNote.mipChain != NULL)
+    {
+        sPrebuiltMipChain = threadNote.mipChain;
+        sPrebuiltMipWidth = threadNote.imageAsset->width;
+        sPrebuiltMipHeight = threadNote.imageAsset->height;
+    }
+
+    //handleAssetNotification does the actual creation of the texture data immediately below when '1' is specified
+    int startTime = platform_getMilliseconds();
+    if(!threadNote.path.empty() && threadNote.imageAsset != NULL)
+    {
+        //Texture is an Asset decoded by the async thread, create it now and only subscribe for later changes
+        bytes = threadNote.imageAsset->width * threadNote.imageAsset->height * 4;
+        loadImageAsset(threadNote.imageAsset, threadNote.id);
+        threadNote.iaCleanup(threadNote.imageAsset);
+        loom_asset_subscribe(threadNote.path.c_str(), Texture::handleAssetNotification, (void *)(size_t)threadNote.id, 0);
+        lmLogDebug(gGFXTextureLogGroup, "Async decoded texture '%s' took %i ms to create", threadNote.path.c_str(), platform_getMilliseconds() - startTime);
+    }
+    else if(!threadNote.path.empty())
+    {
+        //Texture is an Asset, so Create via handleAssetNotification
+        loom_asset_subscribe(threadNote.path.c_str(), Texture::handleAssetNotification, (void *)(size_t)threadNote.id, 1);
+        lmLogDebug(gGFXTextureLogGroup, "Async loaded texture '%s' took %i ms to create", threadNote.path.c_str(), platform_getMilliseconds() - startTime);
+        bytes = threadNote.tinfo->width * threadNote.tinfo->height * 4;
+    }
+    else
+    {
+        //Texture is just a byte stream, so load the deserialized image data now
+        if(threadNote.imageAsset != NULL)
         {
-            //Texture is just a byte stream, so load the deserialized image data now
-            if(threadNote.imageAsset != NULL)
-            {
-                if (threadNote.update) {
-                    updateImageAsset(threadNote.imageAsset, threadNote.tinfo);
-                    threadNote.iaCleanup(threadNote.imageAsset);
-                    lmLogDebug(gGFXTextureLogGroup, "Async loaded byte texture took %i ms to update", platform_getMilliseconds() - startTime);
-                } else {
-                    loadImageAsset(threadNote.imageAsset, threadNote.id);
-                    threadNote.iaCleanup(threadNote.imageAsset);
-                    lmLogDebug(gGFXTextureLogGroup, "Async loaded byte texture took %i ms to create", platform_getMilliseconds() - startTime);
-                }
+            bytes = threadNote.imageAsset->width * threadNote.imageAsset->height * 4;
+            if (threadNote.update) {
+                updateImageAsset(threadNote.imageAsset, threadNote.tinfo);
+                threadNote.iaCleanup(threadNote.imageAsset);
+                lmLogDebug(gGFXTextureLogGroup, "Async loaded byte texture took %i ms to update", platform_getMilliseconds() - startTime);
+            } else {
+                loadImageAsset(threadNote.imageAsset, threadNote.id);
+                threadNote.iaCleanup(threadNote.imageAsset);
+                lmLogDebug(gGFXTextureLogGroup, "Async loaded byte texture took %i ms to create", platform_getMilliseconds() - startTime);
             }
         }
+    }
 
-        //were we disposed while we were busy loading?
-        loom_mutex_lock(Texture::sTexInfoLock);
-        int disposeID = (!threadNote.tinfo->asyncDispose) ? -1 : threadNote.id;
-        loom_mutex_unlock(Texture::sTexInfoLock);
-        if(disposeID != -1)
-        {
-            //dispose!
-            Texture::dispose(disposeID);
-        }
+    sPrebuiltMipChain = NULL;
+    lmSafeFree(NULL, threadNote.mipChain);
+
+    completeAsyncTexture(threadNote);
+
+    return bytes;
+}
+
+void Texture::completeAsyncTexture(AsyncLoadNote &threadNote)
+{
+    threadNote.tinfo->asyncPending = false;
+
+    //were we disposed while we were busy loading?
+    loom_mutex_lock(Texture::sTexInfoLock);
+    int disposeID = (!threadNote.tinfo->asyncDispose) ? -1 : threadNote.id;
+    loom_mutex_unlock(Texture::sTexInfoLock);
+    if(disposeID != -1)
+    {
+        //dispose!
+        Texture::dispose(disposeID);
+    }
+    else if (!threadNote.restore)
+    {
+        //Fire the async load complete delegate... not if we were destroyed while loading though
+        threadNote.tinfo->asyncLoadCompleteDelegate.invoke();
+    }
+}
+
+bool Texture::beginStreamingUpload(AsyncLoadNote &threadNote)
+{
+    if (sUploadBudget <= 0 || threadNote.update || !sTextureAssetNofificationsEnabled)
+        return false;
+
+    // Images not decoded by the async threads are held by the asset manager
+    loom_asset_image_t *image = threadNote.imageAsset;
+    bool locked = image == NULL && !threadNote.path.empty();
+    if (locked)
+        image = static_cast<loom_asset_image_t*>(loom_asset_lock(threadNote.path.c_str(), LATImage, 0));
+
+    if (image == NULL)
+        return false;
+
+    // Only new, uncompressed textures that don't need downsampling and
+    // don't fit the atlas are streamed
+    const int maxSize = 2048;
+    bool atlasable = sAtlasEnabled && image->width <= TEXTURE_ATLAS_MAX_SIZE && image->height <= TEXTURE_ATLAS_MAX_SIZE;
+    const FormatRule *rule = findFormatRule(threadNote.tinfo->texturePath);
+    bool streamable = image->compressedFormat == IMAGE_COMPRESSED_NONE &&
+                      (rule == NULL || rule->format == PIXEL_FORMAT_RGBA8888) &&
+                      image->width * image->height * 4 > sUploadBudget &&
+                      image->width <= maxSize && image->height <= maxSize &&
+                      !threadNote.tinfo->reload && !atlasable;
+
+    if (!streamable)
+    {
+        if (locked)
+            loom_asset_unlock(threadNote.path.c_str());
+        return false;
+    }
+
+    LOOM_PROFILE_SCOPE(textureStreamBegin);
+
+    sStreamingUpload.note = threadNote;
+    sStreamingUpload.image = image;
+    sStreamingUpload.handle = popGLTextureHandle();
+    sStreamingUpload.nextRow = 0;
+    sStreaming = true;
+
+    // Allocate the storage, the rows follow in the next steps
+    if (Graphics_CacheBindTexture(sStreamingUpload.handle))
+        Graphics::context()->glBindTexture(GL_TEXTURE_2D, sStreamingUpload.handle);
+    Graphics::context()->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image->width, image->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+    lmLogDebug(gGFXTextureLogGroup, "Streaming #%d.%d from %s - %i x %i", Texture::getIndex(threadNote.id), Texture::getVersion(threadNote.id), threadNote.path.empty() ? "bytes" : threadNote.path.c_str(), image->width, image->height);
+
+    return true;
+}
+
+int Texture::continueStreamingUpload(int budget)
+{
+    LOOM_PROFILE_SCOPE(textureStreamUpload);
+
+    StreamingUpload &stream = sStreamingUpload;
+
+    // Disposed textures don't need the rest of their rows
+    loom_mutex_lock(Texture::sTexInfoLock);
+    bool disposed = stream.note.tinfo->asyncDispose;
+    loom_mutex_unlock(Texture::sTexInfoLock);
+    if (disposed)
+    {
+        finishStreamingUpload();
+        return 0;
+    }
+
+    int width = stream.image->width;
+    int height = stream.image->height;
+    int rowBytes = width * 4;
+
+    int rows = budget / rowBytes;
+    if (rows < 1)
+        rows = 1;
+    if (rows > height - stream.nextRow)
+        rows = height - stream.nextRow;
+
+    const uint8_t *rowData = static_cast<const uint8_t*>(stream.image->bits) + stream.nextRow * rowBytes;
+    GL_Context *ctx = Graphics::context();
+
+    if (Graphics_CacheBindTexture(stream.handle))
+        ctx->glBindTexture(GL_TEXTURE_2D, stream.handle);
+
+    if (Graphics::supportsPixelBuffers())
+    {
+        // Orphan the pixel buffer each band so the copy into it doesn't
+        // wait on the transfer of the previous band
+        if (sUploadPixelBuffer == 0)
+            ctx->glGenBuffers(1, &sUploadPixelBuffer);
+        ctx->glBindBuffer(GFX_GL_PIXEL_UNPACK_BUFFER, sUploadPixelBuffer);
+        ctx->glBufferData(GFX_GL_PIXEL_UNPACK_BUFFER, rows * rowBytes, NULL, GL_STREAM_DRAW);
+        ctx->glBufferSubData(GFX_GL_PIXEL_UNPACK_BUFFER, 0, rows * rowBytes, rowData);
+        ctx->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, stream.nextRow, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        ctx->glBindBuffer(GFX_GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    else
+    {
+        ctx->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, stream.nextRow, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, rowData);
+    }
+
+    stream.nextRow += rows;
+    if (stream.nextRow >= height)
+        finishStreamingUpload();
+
+    return rows * rowBytes;
+}
+
+void Texture::finishStreamingUpload()
+{
+    LOOM_PROFILE_SCOPE(textureStreamFinish);
+
+    StreamingUpload &stream = sStreamingUpload;
+    AsyncLoadNote threadNote = stream.note;
+    TextureInfo &tinfo = *threadNote.tinfo;
+
+    loom_mutex_lock(Texture::sTexInfoLock);
+
+    tinfo.handle = stream.handle;
+    tinfo.width = stream.image->width;
+    tinfo.height = stream.image->height;
+
+    // Mipmaps are generated on the GPU or come built by the async jobs,
+    // building them from the full image here would bring back the hitch
+    // streaming avoids
+    bool mipmappable = supportsFullNPOT || tinfo.isPowerOfTwo();
+    if (mipmappable && (Graphics::supportsGenerateMipmap() || threadNote.mipChain != NULL))
+    {
+        if (Graphics_CacheBindTexture(tinfo.handle))
+            Graphics::context()->glBindTexture(GL_TEXTURE_2D, tinfo.handle);
+        if (Graphics::supportsGenerateMipmap())
+            Graphics::context()->glGenerateMipmap(GL_TEXTURE_2D);
         else
-        {
-            //Fire the async load complete delegate... not if we were destroyed while loading though
-            threadNote.tinfo->asyncLoadCompleteDelegate.invoke();
-        }
+            uploadMipChain(threadNote.mipChain, tinfo.width, tinfo.height, -1, -1, tinfo.format, tinfo.dither);
+        tinfo.clampOnly = false;
+        tinfo.mipmaps = true;
+    }
+    else
+    {
+        tinfo.clampOnly = !mipmappable;
+        tinfo.mipmaps = false;
     }
+
+    setTextureMemory(tinfo, textureMemoryBytes(tinfo.width, tinfo.height, tinfo.mipmaps));
+    tinfo.lastUsedFrame = Graphics::getCurrentFrame();
+
+    // mark that next time we will be reloading
+    tinfo.reload = true;
+    tinfo.contentVersion++;
+
+    loom_mutex_unlock(Texture::sTexInfoLock);
+
+    validate(threadNote.id);
+
+    sStreaming = false;
+    stream.note = AsyncLoadNote();
+    stream.image = NULL;
+
+    if (threadNote.imageAsset != NULL)
+        threadNote.iaCleanup(threadNote.imageAsset);
     else
+        loom_asset_unlock(threadNote.path.c_str());
+    lmSafeFree(NULL, threadNote.mipChain);
+
+    if (!threadNote.path.empty())
+    {
+        // Subscribe for later changes, the asset isn't needed until then
+        loom_asset_subscribe(threadNote.path.c_str(), Texture::handleAssetNotification, (void *)(size_t)threadNote.id, 0);
+        loom_asset_flush(threadNote.path.c_str());
+    }
+
+    lmLogDebug(gGFXTextureLogGroup, "Streamed #%d.%d", Texture::getIndex(threadNote.id), Texture::getVersion(threadNote.id));
+
+    completeAsyncTexture(threadNote);
+}
+
+void Texture::cancelStreamingUpload(bool requeue)
+{
+    if (!sStreaming)
+        return;
+
+    StreamingUpload &stream = sStreamingUpload;
+
+    if (stream.note.imageAsset == NULL)
+        loom_asset_unlock(stream.note.path.c_str());
+
+    // The handle is lost along with the context when requeueing
+    if (requeue)
     {
+        loom_mutex_lock(Texture::sAsyncQueueMutex);
+        sAsyncCreateQueue.push_front(stream.note);
         loom_mutex_unlock(Texture::sAsyncQueueMutex);
     }
+    else
+    {
+        Graphics::context()->glDeleteTextures(1, &stream.handle);
+        Graphics_ResetGLStateCache();
+        if (stream.note.imageAsset != NULL)
+            stream.note.iaCleanup(stream.note.imageAsset);
+        lmSafeFree(NULL, stream.note.mipChain);
+    }
+
+    sStreaming = false;
+    stream.note = AsyncLoadNote();
+    stream.image = NULL;
+}
+
+void Texture::setUploadBudget(int bytes)
+{
+    sUploadBudget = bytes < 0 ? 0 : bytes;
+}
+
+int Texture::getUploadBudget()
+{
+    return sUploadBudget;
 }
 
 void downsampleNearest(uint32_t *src, uint32_t *dst, int srcWidth, int srcHeight)
@@ -219,6 +611,86 @@ void downsampleNearest(uint32_t *src, uint32_t *dst, int srcWidth, int srcHeight
     }
 }
 
+// Rounded per channel averages of packed RGBA pixels, two channels at a
+// time in the spare bits between them
+static inline uint32_t averagePixels4(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+    uint32_t even = (a & 0x00ff00ff) + (b & 0x00ff00ff) + (c & 0x00ff00ff) + (d & 0x00ff00ff) + 0x00020002;
+    uint32_t odd = ((a >> 8) & 0x00ff00ff) + ((b >> 8) & 0x00ff00ff) + ((c >> 8) & 0x00ff00ff) + ((d >> 8) & 0x00ff00ff) + 0x00020002;
+    return ((even >> 2) & 0x00ff00ff) | (((odd >> 2) & 0x00ff00ff) << 8);
+}
+
+static inline uint32_t averagePixels2(uint32_t a, uint32_t b)
+{
+    uint32_t even = (a & 0x00ff00ff) + (b & 0x00ff00ff) + 0x00010001;
+    uint32_t odd = ((a >> 8) & 0x00ff00ff) + ((b >> 8) & 0x00ff00ff) + 0x00010001;
+    return ((even >> 1) & 0x00ff00ff) | (((odd >> 1) & 0x00ff00ff) << 8);
+}
+
+// Averages 2x2 blocks of the rows at src and src + stride into count
+// pixels at dst, exactly as averagePixels4 would
+static void downsampleRows(const uint32_t *src, uint32_t *dst, int stride, int count)
+{
+    int x = 0;
+
+#if GFX_TEXTURE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    for (; x + 4 <= count; x += 4)
+    {
+        __m128 a0 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+        __m128 a1 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4)));
+        __m128 b0 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + stride)));
+        __m128 b1 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + stride + 4)));
+
+        // Even and odd pixels of both rows, summed in 16 bit lanes
+        __m128i top = _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i topOdd = _mm_castps_si128(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)));
+        __m128i bottom = _mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i bottomOdd = _mm_castps_si128(_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1)));
+
+        __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(topOdd, zero)),
+                                   _mm_add_epi16(_mm_unpacklo_epi8(bottom, zero), _mm_unpacklo_epi8(bottomOdd, zero)));
+        __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(topOdd, zero)),
+                                   _mm_add_epi16(_mm_unpackhi_epi8(bottom, zero), _mm_unpackhi_epi8(bottomOdd, zero)));
+
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, two), 2);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, two), 2);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(lo, hi));
+
+        src += 8;
+        dst += 4;
+    }
+#elif GFX_TEXTURE_NEON
+    for (; x + 4 <= count; x += 4)
+    {
+        // Loading pairs deinterleaves even and odd pixels
+        uint32x4x2_t top = vld2q_u32(src);
+        uint32x4x2_t bottom = vld2q_u32(src + stride);
+
+        uint8x16_t t0 = vreinterpretq_u8_u32(top.val[0]);
+        uint8x16_t t1 = vreinterpretq_u8_u32(top.val[1]);
+        uint8x16_t b0 = vreinterpretq_u8_u32(bottom.val[0]);
+        uint8x16_t b1 = vreinterpretq_u8_u32(bottom.val[1]);
+
+        uint16x8_t lo = vaddq_u16(vaddl_u8(vget_low_u8(t0), vget_low_u8(t1)), vaddl_u8(vget_low_u8(b0), vget_low_u8(b1)));
+        uint16x8_t hi = vaddq_u16(vaddl_u8(vget_high_u8(t0), vget_high_u8(t1)), vaddl_u8(vget_high_u8(b0), vget_high_u8(b1)));
+
+        vst1q_u8(reinterpret_cast<uint8_t*>(dst), vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+
+        src += 8;
+        dst += 4;
+    }
+#endif
+
+    for (; x < count; x++)
+    {
+        *dst = averagePixels4(src[0], src[1], src[stride], src[1+stride]);
+        dst += 1;
+        src += 2;
+    }
+}
+
 void downsampleAverage(uint32_t *src, uint32_t *dst, int srcWidth, int srcHeight)
 {
     LOOM_PROFILE_SCOPE(textureDownsampleAverage);
@@ -231,23 +703,12 @@ void downsampleAverage(uint32_t *src, uint32_t *dst, int srcWidth, int srcHeight
     for (int y = 0; y < height-1; y++)
     {
         // Process all pixels up to the last column
-        for (int x = 0; x < width-1; x++)
-        {
-            *dst =
-                // Divide by 4 and mask invading bits
-                ((src[0] >> 2) & 0x3f3f3f3f) +
-                ((src[1] >> 2) & 0x3f3f3f3f) +
-                ((src[stride] >> 2) & 0x3f3f3f3f) +
-                ((src[1+stride] >> 2) & 0x3f3f3f3f);
+        downsampleRows(src, dst, stride, width-1);
+        dst += width-1;
+        src += 2*(width-1);
 
-            dst += 1;
-            src += 2;
-        }
         // Process the column by just averaging vertically
-        *dst =
-            // Divide by 2 and mask invading bits
-            ((src[0] >> 1) & 0x7f7f7f7f) +
-            ((src[stride] >> 1) & 0x7f7f7f7f);
+        *dst = averagePixels2(src[0], src[stride]);
         dst += 1;
         src += 2;
 
@@ -256,10 +717,7 @@ void downsampleAverage(uint32_t *src, uint32_t *dst, int srcWidth, int srcHeight
     // Process the last line by just averaging horizontally
     for (int x = 0; x < width-1; x++)
     {
-        *dst =
-            // Divide by 2 and mask invading bits
-            ((src[0] >> 1) & 0x7f7f7f7f) +
-            ((src[1] >> 1) & 0x7f7f7f7f);
+        *dst = averagePixels2(src[0], src[1]);
         dst += 1;
         src += 2;
     }
@@ -267,86 +725,138 @@ void downsampleAverage(uint32_t *src, uint32_t *dst, int srcWidth, int srcHeight
     *dst = *src;
 }
 
-// Courtesy of Torque via MIT license.
-void bitmapExtrudeRGBA_c(const void *srcMip, void *mip, int srcHeight, int srcWidth)
+// Downsamples all the mipmap levels below a width x height image into
+// one allocation, each level following its parent, free with lmFree
+static uint32_t *buildMipChain(uint32_t *image, int width, int height)
 {
-    const unsigned char *src = (const unsigned char *)srcMip;
-    unsigned char       *dst = (unsigned char *)mip;
-    int                 stride = srcHeight != 1 ? (srcWidth)* 4 : 0;
-
-    //For the case when a texture's width is not divisible by 2
-    int widthMod = srcWidth % 2;
+    LOOM_PROFILE_SCOPE(textureBuildMipChain);
 
-    int width = srcWidth >> 1;
-    int height = srcHeight >> 1;
-
-    if (width == 0)
+    size_t pixels = 0;
+    for (int w = width, h = height; w > 1 || h > 1;)
     {
-        width = 1;
+        w = w > 1 ? w >> 1 : 1;
+        h = h > 1 ? h >> 1 : 1;
+        pixels += w*h;
     }
-    if (height == 0)
+
+    uint32_t *chain = static_cast<uint32_t*>(lmAlloc(NULL, pixels * 4));
+    uint32_t *parent = image;
+    uint32_t *level = chain;
+    while (width > 1 || height > 1)
     {
-        height = 1;
+        downsampleAverage(parent, level, width, height);
+        width = width > 1 ? width >> 1 : 1;
+        height = height > 1 ? height >> 1 : 1;
+        parent = level;
+        level += width*height;
     }
 
-    if (srcWidth != 1)
+    return chain;
+}
+
+// Uploads a chain from buildMipChain as the levels below a width x height
+// image, or a region of it at xoffset, yoffset when they're not negative
+static void uploadMipChain(uint32_t *chain, int width, int height, int xoffset, int yoffset, int format, bool dither)
+{
+    bool newImage = xoffset < 0 || yoffset < 0;
+    int mipLevel = 1;
+    while (width > 1 || height > 1)
     {
-        for (int y = 0; y < height; y++)
-        {
-            for (int x = 0; x < width; x++)
-            {
-                *dst++ = (int(*src) + int(src[4]) + int(src[stride]) + int(src[stride + 4]) + 2) >> 2;
-                src++;
-                *dst++ = (int(*src) + int(src[4]) + int(src[stride]) + int(src[stride + 4]) + 2) >> 2;
-                src++;
-                *dst++ = (int(*src) + int(src[4]) + int(src[stride]) + int(src[stride + 4]) + 2) >> 2;
-                src++;
-                *dst++ = (int(*src) + int(src[4]) + int(src[stride]) + int(src[stride + 4]) + 2) >> 2;
-                src += 5;
-            }
-            src += stride + (widthMod * 4);    // skip
+        // Compute next size (half of previous/parent size dimensions, minimum of 1x1)
+        width >>= 1; width = width < 1 ? 1 : width;
+        height >>= 1; height = height < 1 ? 1 : height;
+
+        if (newImage) {
+            LOOM_PROFILE_START(textureLoadMipmapUploadNew);
+            uploadPixels(mipLevel, (const uint8_t*)chain, width, height, -1, -1, format, dither);
+            LOOM_PROFILE_END(textureLoadMipmapUploadNew);
+        }
+        else {
+            LOOM_PROFILE_START(textureLoadMipmapUploadUpdate);
+            uploadPixels(mipLevel, (const uint8_t*)chain, width, height, xoffset >> mipLevel, yoffset >> mipLevel, format, dither);
+            LOOM_PROFILE_END(textureLoadMipmapUploadUpdate);
         }
+
+        chain += width*height;
+        mipLevel++;
     }
-    else
+}
+
+TextureInfo *Texture::allocTextureInfo()
+{
+    if (sFreeTextureSlots.size() == 0)
     {
-        for (int y = 0; y < height; y++)
+        int page = sTextureSlotCount >> TEXTURE_PAGE_BITS;
+        if (page == TEXTURE_MAX_PAGES)
+        {
+            return NULL;
+        }
+
+        TexturePage *infos = lmNew(gGFXTextureAllocator) TexturePage();
+        for (int i = 0; i < TEXTURE_PAGE_SIZE; i++)
+        {
+            infos->infos[i].id = sTextureSlotCount + i;
+        }
+
+        // Readers index the page table without the lock, the page has to
+        // be complete before they can see it
+        atomic_storePointer((void *volatile *)&sTexturePages[page], infos, LOOM_ORDER_RELEASE);
+
+        // Lowest index on top
+        for (int i = TEXTURE_PAGE_SIZE - 1; i >= 0; i--)
         {
-            *dst++ = (int(*src) + int(src[stride]) + 1) >> 1;
-            src++;
-            *dst++ = (int(*src) + int(src[stride]) + 1) >> 1;
-            src++;
-            *dst++ = (int(*src) + int(src[stride]) + 1) >> 1;
-            src++;
-            *dst++ = (int(*src) + int(src[stride]) + 1) >> 1;
-            src += 5;
-
-            src += stride + (widthMod * 4);    // skip
+            sFreeTextureSlots.push_back(sTextureSlotCount + i);
         }
+
+        sTextureSlotCount += TEXTURE_PAGE_SIZE;
     }
+
+    TextureInfo *tinfo = getTextureSlot(sFreeTextureSlots.back());
+    sFreeTextureSlots.pop_back();
+
+    tinfo->handle = MARKEDTEXTURE;    // mark in use, but not yet loaded
+    return tinfo;
+}
+
+void Texture::freeTextureInfo(TextureInfo *tinfo)
+{
+    if (tinfo->sourceBytes != NULL)
+        lmDelete(NULL, tinfo->sourceBytes);
+    tinfo->reset();
+    sFreeTextureSlots.push_back(getIndex(tinfo->id));
 }
 
 TextureInfo *Texture::getTextureInfo(TextureID id)
 {
     LOOM_PROFILE_SCOPE(textureGetInfo);
 
-    TextureID index = id & TEXTURE_ID_MASK;
-    lmAssert(index >= 0 && index < MAXTEXTURES, "Texture index is out of range: %d", index);
+    if (id < 0)
+    {
+        return NULL;
+    }
+
+    TextureID index = getIndex(id);
+
+    TexturePage *page = (TexturePage *)atomic_loadPointer((void *volatile *)&sTexturePages[index >> TEXTURE_PAGE_BITS], LOOM_ORDER_ACQUIRE);
+    if (page == NULL)
+    {
+        return NULL;
+    }
 
-    loom_mutex_lock(sTexInfoLock);
-    TextureInfo *tinfo = &sTextureInfos[index];
+    TextureInfo *tinfo = &page->infos[index & (TEXTURE_PAGE_SIZE - 1)];
 
-    // Check if it has a handle and if it's not outdated
+    // Check if it has a handle and if it's not outdated, a TextureInfo
+    // freed since is caught by its bumped version
     if (tinfo->handle == -1 || tinfo->id != id)
     {
         tinfo = NULL;
     }
-    loom_mutex_unlock(sTexInfoLock);
 
     return tinfo;
 }
 
 
-TextureInfo *Texture::load(uint8_t *data, uint16_t width, uint16_t height, TextureID id)
+TextureInfo *Texture::load(uint8_t *data, uint16_t width, uint16_t height, TextureID id, const loom_asset_image_t *compressed)
 {
     LOOM_PROFILE_SCOPE(textureLoad);
 
@@ -377,27 +887,72 @@ TextureInfo *Texture::load(uint8_t *data, uint16_t width, uint16_t height, Textu
     }
 
 
-    if (tinfo.reload)
+    bool reloading = tinfo.reload;
+    bool atlased = false;
+
+    // New textures take the format of the rule for their path, changing
+    // it means starting over outside of the atlas
+    if (newTexture && !tinfo.renderTarget)
+    {
+        const FormatRule *rule = compressed ? NULL : findFormatRule(tinfo.texturePath);
+        int format = rule ? rule->format : PIXEL_FORMAT_RGBA8888;
+        tinfo.dither = rule ? rule->dither : false;
+        if (format != tinfo.format && tinfo.atlasPage != TEXTUREINVALID)
+        {
+            removeFromAtlas(tinfo);
+            tinfo.reload = false;
+        }
+        tinfo.format = format;
+    }
+
+    // Packed textures are updated in place, unless they changed size,
+    // then they move out of the atlas
+    if (tinfo.atlasPage != TEXTUREINVALID)
+    {
+        if (!newTexture && !compressed)
+        {
+            upload(tinfo, data, width, height);
+            atlased = true;
+        }
+        else
+        {
+            removeFromAtlas(tinfo);
+            tinfo.reload = false;
+        }
+    }
+    else if (!tinfo.reload && tinfo.format == PIXEL_FORMAT_RGBA8888)
+    {
+        atlased = addToAtlas(tinfo, data, width, height);
+    }
+
+    if (!atlased && tinfo.reload)
     {
         LOOM_PROFILE_START(textureLoadDelete);
         storeGLTextureHandle(tinfo.handle);
         LOOM_PROFILE_END(textureLoadDelete);
     }
 
-    if (newTexture) {
+    // Render targets of a size used before reuse the objects of a disposed one
+    bool pooled = !atlased && newTexture && !reloading && tinfo.renderTarget && acquireRenderTarget(tinfo, width, height);
+
+    if (!atlased && !pooled && newTexture) {
         LOOM_PROFILE_START(textureLoadGenerate);
         tinfo.handle = popGLTextureHandle();
         if (tinfo.renderTarget) {
             Graphics::context()->glGenFramebuffers(1, &tinfo.framebuffer);
+            sRenderTargetPoolMisses++;
         }
         LOOM_PROFILE_END(textureLoadGenerate);
     }
 
 
-    upload(tinfo, data, width, height);
+    if (compressed)
+        uploadCompressed(tinfo, compressed);
+    else if (!atlased && !pooled)
+        upload(tinfo, data, width, height);
 
     // Setup the framebuffer if it's a render texture
-    if (newTexture && tinfo.renderTarget)
+    if (!atlased && !pooled && newTexture && tinfo.renderTarget)
     {
         LOOM_PROFILE_START(textureLoadFramebuffer);
         Graphics::context()->glBindFramebuffer(GL_FRAMEBUFFER, tinfo.framebuffer);
@@ -411,7 +966,7 @@ TextureInfo *Texture::load(uint8_t *data, uint16_t width, uint16_t height, Textu
 
     validate(id);
 
-    if (tinfo.reload)
+    if (reloading)
     {
         LOOM_PROFILE_START(textureLoadDelegate);
 
@@ -425,6 +980,7 @@ TextureInfo *Texture::load(uint8_t *data, uint16_t width, uint16_t height, Textu
 
     // mark that next time we will be reloading
     tinfo.reload = true;
+    tinfo.contentVersion++;
 
     loom_mutex_unlock(Texture::sTexInfoLock);
 
@@ -433,9 +989,20 @@ TextureInfo *Texture::load(uint8_t *data, uint16_t width, uint16_t height, Textu
 
 void Texture::upload(TextureInfo &tinfo, uint8_t *data, uint16_t width, uint16_t height, int xoffset, int yoffset)
 {
+    if (FrameCapture::isCapturing())
+        FrameCapture::recordUpload(tinfo, data, width, height, xoffset, yoffset);
+
+    if (tinfo.atlasPage != TEXTUREINVALID)
+    {
+        uploadToAtlas(tinfo, data, width, height, xoffset < 0 ? 0 : xoffset, yoffset < 0 ? 0 : yoffset);
+        return;
+    }
+
     bool newImage = xoffset < 0 || yoffset < 0;
+    tinfo.contentVersion++;
 
-    Graphics::context()->glBindTexture(GL_TEXTURE_2D, tinfo.handle);
+    if (Graphics_CacheBindTexture(tinfo.handle))
+        Graphics::context()->glBindTexture(GL_TEXTURE_2D, tinfo.handle);
     //Graphics::context()->glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     //Graphics::context()->glPixelStorei(GL_PACK_ALIGNMENT, 1);
 
@@ -444,82 +1011,57 @@ void Texture::upload(TextureInfo &tinfo, uint8_t *data, uint16_t width, uint16_t
         tinfo.width = width;
         tinfo.height = height;
         LOOM_PROFILE_START(textureLoadUploadNew);
-        Graphics::context()->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        uploadPixels(0, data, width, height, -1, -1, tinfo.format, tinfo.dither);
         LOOM_PROFILE_END(textureLoadUploadNew);
     }
     else
     {
         LOOM_PROFILE_START(textureLoadUploadUpdate);
         lmAssert(xoffset + width <= tinfo.width && yoffset + height <= tinfo.height, "Texture %d (%dx%d) update parameters invalid: x=%d, y=%d, width=%d, height=%d", tinfo.id, tinfo.width, tinfo.height, xoffset, yoffset, width, height);
-        Graphics::context()->glTexSubImage2D(GL_TEXTURE_2D, 0, xoffset, yoffset, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        uploadPixels(0, data, width, height, xoffset, yoffset, tinfo.format, tinfo.dither);
         LOOM_PROFILE_END(textureLoadUploadUpdate);
     }
 
-    // Generate mipmaps if appropriate
-    if (!tinfo.renderTarget && (supportsFullNPOT || tinfo.isPowerOfTwo()))
+    // Generate mipmaps if appropriate, atlas pages have none as
+    // the packed textures would bleed into each other
+    if (!tinfo.renderTarget && !tinfo.isAtlasPage && (supportsFullNPOT || tinfo.isPowerOfTwo()))
     {
         LOOM_PROFILE_START(textureLoadMipmap);
         tinfo.clampOnly = false;
         tinfo.mipmaps = true;
-        uint32_t *mipParent = (uint32_t*)data;
-        uint32_t *mipCurrent = NULL;
-        uint32_t *mipData = NULL;
-        int mipWidth = width;
-        int mipHeight = height;
-        int mipLevel = 1;
         int time = platform_getMilliseconds();
-        while (mipWidth > 1 || mipHeight > 1)
-        {
-            // Compute next size (half of previous/parent size dimensions, minimum of 1x1)
-            int prevWidth = mipWidth, prevHeight = mipHeight;
-            mipWidth >>= 1; mipWidth = mipWidth < 1 ? 1 : mipWidth;
-            mipHeight >>= 1; mipHeight = mipHeight < 1 ? 1 : mipHeight;
-
-            // Number of pixels in the current mipmap
-            int mipSize = mipWidth*mipHeight;
-
-            // Allocate buffer if it doesn't exist yet, reuse for smaller mipmaps
-            if (mipData == NULL) {
-                // Allocate enough for the biggest/current mipmap and a quarter of the size of
-                // additional space used for downsizing
-                mipData = static_cast<uint32_t*>(lmAlloc(NULL, mipSize * (4 + 1)));
-                // The current mipmap bytes are the entire buffer minus the additional space
-                // at first, with the parent bytes being the full image size
-                mipCurrent = mipData;
-            }
-            // Downsample the parent mipmap into the current one
-            downsampleAverage(mipParent, mipCurrent, prevWidth, prevHeight);
-
-            if (newImage) {
-                LOOM_PROFILE_START(textureLoadMipmapUploadNew);
-                Graphics::context()->glTexImage2D(GL_TEXTURE_2D, mipLevel, GL_RGBA, mipWidth, mipHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, mipCurrent);
-                LOOM_PROFILE_END(textureLoadMipmapUploadNew);
-            }
-            else {
-                LOOM_PROFILE_START(textureLoadMipmapUploadUpdate);
-                Graphics::context()->glTexSubImage2D(GL_TEXTURE_2D, mipLevel, xoffset, yoffset, mipWidth, mipHeight, GL_RGBA, GL_UNSIGNED_BYTE, mipCurrent);
-                LOOM_PROFILE_END(textureLoadMipmapUploadUpdate);
-            }
-
-            // Set parent to the current map
-            mipParent = mipCurrent;
-            // Alternate between writing to the beginning of the buffer
-            // and the space next to the buffer already written
-            mipCurrent = mipParent == mipData ? mipData + mipSize : mipData;
 
-            mipLevel++;
+        if (Graphics::supportsGenerateMipmap())
+        {
+            // Rebuilds the whole chain, updated regions included
+            Graphics::context()->glGenerateMipmap(GL_TEXTURE_2D);
         }
+        else
+        {
+            // Use the chain the async jobs built for this image if there is one
+            bool prebuilt = sPrebuiltMipChain != NULL && xoffset <= 0 && yoffset <= 0 &&
+                            sPrebuiltMipWidth == width && sPrebuiltMipHeight == height;
+            uint32_t *mipData = prebuilt ? sPrebuiltMipChain : buildMipChain((uint32_t*)data, width, height);
+            uploadMipChain(mipData, width, height, xoffset, yoffset, tinfo.format, tinfo.dither);
+            if (!prebuilt) lmFree(NULL, mipData);
+        }
+
         lmLogDebug(gGFXTextureLogGroup, "Generated mipmaps in %d ms", platform_getMilliseconds() - time);
-        if (mipData != (uint32_t*)data) lmSafeFree(NULL, mipData);
         LOOM_PROFILE_END(textureLoadMipmap);
     }
     else
     {
         tinfo.clampOnly = true;
         tinfo.mipmaps = false;
-        if (!supportsFullNPOT)
+        if (!supportsFullNPOT && !tinfo.isAtlasPage)
             lmLogWarn(gGFXTextureLogGroup, "Non-power-of-two textures not fully supported by device, consider using a power-of-two texture size.")
     }
+
+    if (newImage)
+    {
+        setTextureMemory(tinfo, textureMemoryBytes(width, height, tinfo.mipmaps, tinfo.format));
+        tinfo.lastUsedFrame = Graphics::getCurrentFrame();
+    }
 }
 
 TextureInfo *Texture::initEmptyTexture(int width, int height)
@@ -548,6 +1090,9 @@ TextureInfo *Texture::initFromAssetManager(const char *path)
     }
     LOOM_PROFILE_SCOPE(textureNewAssetManager);
 
+    utString resolvedPath = resolveCompressedPath(path);
+    path = resolvedPath.c_str();
+
     //check if this texture already has a TextureInfo reserved for it
     TextureID *texID;
     TextureInfo *tinfo = getTextureInfoFromPath(path, &texID);
@@ -566,6 +1111,8 @@ TextureInfo *Texture::initFromAssetManager(const char *path)
     tinfo = getAvailableTextureInfo(path);
     if(tinfo != NULL)
     {
+        tinfo->evictable = true;
+
         // allocate the texture handle/id
         lmLogDebug(gGFXTextureLogGroup, "Loading %s", path);
 
@@ -620,11 +1167,13 @@ TextureInfo *Texture::initFromBytes(utByteArray *bytes, const char *name)
 
     dtor(lat);
 
+    setSourceBytes(tinfo, bytes);
+
     return tinfo;
 }
 
 
-int __stdcall Texture::loadTextureAsync_body(void *param)
+void Texture::loadTextureAsync_job(void *param)
 {
     const char *path = NULL;
 
@@ -634,7 +1183,8 @@ int __stdcall Texture::loadTextureAsync_body(void *param)
         //get the front of the async texture queue to process
         loom_mutex_lock(Texture::sAsyncQueueMutex);
 
-        if (!Texture::sAsyncThreadRunning) {
+        if (!Texture::sAsyncThreadRunning || Texture::sAsyncLoadQueue.empty()) {
+            Texture::sAsyncJobCount--;
             loom_mutex_unlock(Texture::sAsyncQueueMutex);
             break;
         }
@@ -654,7 +1204,7 @@ int __stdcall Texture::loadTextureAsync_body(void *param)
             {
                 sTexturePathLookup.erase(threadNote.tinfo->texturePath);
             }
-            threadNote.tinfo->reset();
+            freeTextureInfo(threadNote.tinfo);
             loom_mutex_unlock(Texture::sTexInfoLock);
 
             //prep for below
@@ -665,7 +1215,17 @@ int __stdcall Texture::loadTextureAsync_body(void *param)
             loom_mutex_unlock(Texture::sTexInfoLock);
 
             //handle Asset vs ByteArray texture load
-            if(path)
+            void *fileBits = NULL;
+            long fileSize = 0;
+            if(path && platform_mapFile(path, &fileBits, &fileSize))
+            {
+                // Decode local files right here, the asset manager would
+                // deserialize them on the main thread
+                lmLogDebug(gGFXTextureLogGroup, "Decoding %s async...", path);
+                threadNote.imageAsset = static_cast<loom_asset_image_t*>(loom_asset_imageDeserializer(fileBits, fileSize, &threadNote.iaCleanup));
+                platform_unmapFile(fileBits);
+            }
+            else if(path)
             {
                 // Load async since we're in a background thread.
                 lmLogDebug(gGFXTextureLogGroup, "Loading %s async...", path);
@@ -690,6 +1250,18 @@ int __stdcall Texture::loadTextureAsync_body(void *param)
                 }
             }
 
+            // Without glGenerateMipmap the mipmaps are built here instead of
+            // on the main thread, unless the image goes into the atlas
+            loom_asset_image_t *image = threadNote.imageAsset;
+            if (image != NULL && !Graphics::supportsGenerateMipmap() &&
+                image->compressedFormat == IMAGE_COMPRESSED_NONE &&
+                image->width <= 2048 && image->height <= 2048 &&
+                (supportsFullNPOT || ((image->width & (image->width - 1)) == 0 && (image->height & (image->height - 1)) == 0)) &&
+                !(sAtlasEnabled && image->width <= TEXTURE_ATLAS_MAX_SIZE && image->height <= TEXTURE_ATLAS_MAX_SIZE))
+            {
+                threadNote.mipChain = buildMipChain(static_cast<uint32_t*>(image->bits), image->width, image->height);
+            }
+
             //add to the CreateQueue that happens in the main thread because bgfx cannot create textures from side threads
             loom_mutex_lock(Texture::sAsyncQueueMutex);
             lmLogDebug(gGFXTextureLogGroup, "Adding async loaded texture to CreateQueue: %s", ((path) ? path : "Byte Texture"));
@@ -705,40 +1277,35 @@ int __stdcall Texture::loadTextureAsync_body(void *param)
             }
         }
 
-        //do we have any more items to process?
-        if(Texture::sAsyncLoadQueue.empty())
-        {
-            loom_mutex_unlock(Texture::sAsyncQueueMutex);
-            //flag that the async texture thread is no longer running
-            stopAsyncThread();
-            break;
-        }
         loom_mutex_unlock(Texture::sAsyncQueueMutex);
 
         //yield to the main thread, baby!
         loom_thread_yield();
     }
-
-    return 0;
 }
 
 void Texture::ensureAsyncThread()
 {
     loom_mutex_lock(Texture::sAsyncQueueMutex);
-    //only kick the async thread if it isn't already running
-    if (!sAsyncThreadRunning) {
-        if (sAsyncThread != NULL) {
-            sAsyncThreadRunning = true;
-            stopAsyncThread();
-            loom_mutex_unlock(Texture::sAsyncQueueMutex);
-            loom_thread_join(sAsyncThread);
-            sAsyncThread = NULL;
-            loom_mutex_lock(Texture::sAsyncQueueMutex);
-        }
-        sAsyncThreadRunning = true;
-        lmAssert(sAsyncThread == NULL, "Thread actually still running?");
-        sAsyncThread = loom_thread_start(Texture::loadTextureAsync_body, NULL);
+
+    sAsyncThreadRunning = true;
+
+    // Decoding shares the job workers with the rest of the engine, as
+    // background jobs they don't hold up anyone waiting on a job
+    int maxJobs = loom_jobs_getWorkerCount();
+    if (maxJobs > TEXTURE_MAX_ASYNC_JOBS)
+        maxJobs = TEXTURE_MAX_ASYNC_JOBS;
+    if (maxJobs < 1)
+        maxJobs = 1;
+
+    //submit as many jobs as there are queued notes, the ones already running pick them up as well
+    int wanted = (int)sAsyncLoadQueue.size();
+    while (sAsyncJobCount < maxJobs && sAsyncJobCount < wanted)
+    {
+        sAsyncJobCount++;
+        loom_job_submit(Texture::loadTextureAsync_job, NULL, NULL, NULL, LOOM_JOB_BACKGROUND);
     }
+
     loom_mutex_unlock(Texture::sAsyncQueueMutex);
 }
 
@@ -761,6 +1328,9 @@ TextureInfo * Texture::initFromAssetManagerAsync(const char *path, bool highPrio
 
     LOOM_PROFILE_SCOPE(textureNewAssetManagerAsync);
 
+    utString resolvedPath = resolveCompressedPath(path);
+    path = resolvedPath.c_str();
+
     //check if this texture already has a TextureInfo reserved for it
     //NOTE: shouldn't really happen... there is a check for this in LS that returns early there!
     TextureID   *texID;
@@ -774,12 +1344,15 @@ TextureInfo * Texture::initFromAssetManagerAsync(const char *path, bool highPrio
     tinfo = getAvailableTextureInfo(path);
     if(tinfo != NULL)
     {
+        tinfo->evictable = true;
+
          //build up temp struct to pass over to the aysnc load thread
         AsyncLoadNote threadNote;
         memset(&threadNote, 0, sizeof(AsyncLoadNote));
         threadNote.id = tinfo->id;
         threadNote.path = path;
         threadNote.tinfo = tinfo;
+        tinfo->asyncPending = true;
         threadNote.priority = highPriority;
         threadNote.update = false;
 
@@ -816,6 +1389,9 @@ void Texture::updateFromBytes(TextureID id, utByteArray *bytes)
     if (tinfo && tinfo->handle != -1)
     {
         lmAssert(tinfo->handle != MARKEDTEXTURE, "Texture id %d cannot be updated as it's currently in the loading queue", id);
+
+        // The asset no longer has the contents of the texture
+        tinfo->evictable = false;
         //lmAssert(!tinfo->updating, "Texture id %d should not be updating already", id);
 
 
@@ -834,6 +1410,8 @@ void Texture::updateFromBytes(TextureID id, utByteArray *bytes)
         updateImageAsset(lat, tinfo);
 
         dtor(lat);
+
+        setSourceBytes(tinfo, bytes);
     }
 
     loom_mutex_unlock(Texture::sTexInfoLock);
@@ -850,15 +1428,19 @@ void Texture::updateFromBytesAsync(TextureID id, utByteArray *bytes, bool highPr
 
     if (tinfo && tinfo->handle != -1)
     {
+        tinfo->evictable = false;
+
         //build up temp struct to pass over to the aysnc load thread
         AsyncLoadNote threadNote;
         memset(&threadNote, 0, sizeof(AsyncLoadNote));
         threadNote.id = tinfo->id;
         threadNote.path = "";
         threadNote.tinfo = tinfo;
+        tinfo->asyncPending = true;
         threadNote.bytes.allocateAndCopy(bytes->getDataPtr(), bytes->getSize());
         threadNote.priority = highPriority;
         threadNote.update = true;
+        setSourceBytes(tinfo, bytes);
 
         //add this texture to async queue
         loom_mutex_lock(Texture::sAsyncQueueMutex);
@@ -881,8 +1463,33 @@ void Texture::updateFromBytesAsync(TextureID id, utByteArray *bytes, bool highPr
     }
 }
 
+// Images decoded before premultiplied alpha was enabled, or scaled on
+// load, come straight and are premultiplied before they're uploaded
+static void premultiplyImageAsset(loom_asset_image_t *lat)
+{
+    if (!Graphics::getPremultipliedAlpha() || lat->premultiplied)
+        return;
+
+    loom_asset_imagePremultiply(lat->bits, (size_t)lat->width * lat->height);
+    lat->premultiplied = 1;
+}
+
 void Texture::updateImageAsset(loom_asset_image_t *lat, TextureInfo *tinfo)
 {
+    if (lat->compressedFormat != IMAGE_COMPRESSED_NONE)
+    {
+        if (lat->width != tinfo->width || lat->height != tinfo->height || tinfo->atlasPage != TEXTUREINVALID || !supportsCompressedFormat(lat->compressedFormat))
+        {
+            lmLogError(gGFXTextureLogGroup, "Compressed image update of texture #%d needs a supported format of the same size", Texture::getIndex(tinfo->id));
+            return;
+        }
+
+        uploadCompressed(*tinfo, lat);
+        return;
+    }
+
+    premultiplyImageAsset(lat);
+
     // See if it's over 2048 - if so, downsize to fit.
     const int maxSize = 2048;
     uint32_t* localBits = (uint32_t*)lat->bits;
@@ -900,8 +1507,8 @@ void Texture::updateImageAsset(loom_asset_image_t *lat, TextureInfo *tinfo)
 
     if (downsampling) {
         lmLogWarn(gGFXTextureLogGroup, "Texture too big at %dx%d, downsampling to %dx%d", lat->width, lat->height, localWidth, localHeight);
-        localBits = static_cast<uint32_t*>(lmAlloc(NULL, localWidth * localWidth * 4));
-        downsampleAverage((uint32_t*)lat->bits, localBits, lat->width, lat->height);
+        localBits = static_cast<uint32_t*>(lmAlloc(NULL, localWidth * localHeight * 4));
+        resizeImage(static_cast<uint8_t*>(lat->bits), lat->width, lat->height, (uint8_t*)localBits, localWidth, localHeight, IMAGE_RESIZE_BILINEAR);
     }
 
     upload(*tinfo, (uint8_t*) localBits, localWidth, localHeight, 0, 0);
@@ -950,9 +1557,11 @@ TextureInfo *Texture::initFromBytesAsync(utByteArray *bytes, const char *name, b
         threadNote.id = tinfo->id;
         threadNote.path = "";
         threadNote.tinfo = tinfo;
+        tinfo->asyncPending = true;
         threadNote.bytes.allocateAndCopy(bytes->getDataPtr(), bytes->getSize());
         threadNote.priority = highPriority;
         threadNote.update = false;
+        setSourceBytes(tinfo, bytes);
 
         //add this texture to async queue
         loom_mutex_lock(Texture::sAsyncQueueMutex);
@@ -1043,44 +1652,53 @@ void Texture::handleAssetNotification(void *payload, const char *name)
 
 void Texture::loadImageAsset(loom_asset_image_t *lat, TextureID id)
 {
+    if (lat->compressedFormat != IMAGE_COMPRESSED_NONE)
+    {
+        if (!supportsCompressedFormat(lat->compressedFormat))
+        {
+            lmLogError(gGFXTextureLogGroup, "Compressed format 0x%x of texture #%d isn't supported by this GPU, using debug checkerboard.", lat->compressedFormat, Texture::getIndex(id));
+            loadCheckerBoard(id);
+            return;
+        }
+
+        load(NULL, (uint16_t)lat->width, (uint16_t)lat->height, id, lat);
+        return;
+    }
+
+    premultiplyImageAsset(lat);
+
     // See if it's over 2048 - if so, downsize to fit.
     const int          maxSize     = 2048;
-    void               *localBits  = lat->bits;
-    void               *localMem   = NULL;
+    uint8_t            *localBits  = (uint8_t *)lat->bits;
     int                localWidth  = lat->width;
     int                localHeight = lat->height;
-    int                resizeCounter = 0;
     while (localWidth > maxSize || localHeight > maxSize)
     {
-        // Allocate new bits.
-        int oldWidth = localWidth, oldHeight = localHeight;
         localWidth = localWidth >> 1;
         localHeight = localHeight >> 1;
-        void *oldBits = localBits;
+    }
 
+    if (localBits != NULL && (localWidth != lat->width || localHeight != lat->height))
+    {
         lmLog(gGFXTextureLogGroup, "Texture too big at %dx%d, downsampling to %dx%d", lat->width, lat->height, localWidth, localHeight);
 
-        if (resizeCounter > 0)
-        {
-            //These are freed by an Image Asset
-            localBits = lmAlloc(NULL, localWidth * localHeight * 4);
-        }
-
-        bitmapExtrudeRGBA_c(oldBits, localBits, oldHeight, oldWidth);
-        resizeCounter++;
+        localBits = (uint8_t *)lmAlloc(NULL, localWidth * localHeight * 4);
+        resizeImage((const uint8_t *)lat->bits, lat->width, lat->height, localBits, localWidth, localHeight, IMAGE_RESIZE_BILINEAR);
     }
 
-    // Perform the actual load.
-    load((uint8_t *)localBits, (uint16_t)localWidth, (uint16_t)localHeight, id);
+    load(localBits, (uint16_t)localWidth, (uint16_t)localHeight, id);
+
+    if (localBits != lat->bits)
+        lmFree(NULL, localBits);
 }
 
 void Texture::validate()
 {
     LOOM_PROFILE_SCOPE(textureValidateAll);
-    for (int i = 0; i < MAXTEXTURES; i++)
+    for (int i = 0; i < sTextureSlotCount; i++)
     {
         loom_mutex_lock(Texture::sTexInfoLock);
-        TextureInfo *tinfo = &sTextureInfos[i];
+        TextureInfo *tinfo = getTextureSlot(i);
 
         // Ignore invalid entries
         if (tinfo->handle != -1 && tinfo->renderTarget)
@@ -1092,38 +1710,225 @@ void Texture::validate()
     }
 }
 
+static int compareRestoreOrder(const void *a, const void *b)
+{
+    uint32_t frameA = (*(TextureInfo * const *)a)->lastUsedFrame;
+    uint32_t frameB = (*(TextureInfo * const *)b)->lastUsedFrame;
+
+    // Most recently drawn first
+    if (frameA != frameB)
+        return frameA > frameB ? -1 : 1;
+    return 0;
+}
+
 void Texture::reset()
 {
     LOOM_PROFILE_SCOPE(textureReset);
     stopAsyncThread();
-    for (int i = 0; i < MAXTEXTURES; i++)
+
+    // A streamed texture starts over in the new context
+    cancelStreamingUpload(true);
+    sUploadPixelBuffer = 0;
+
+    // Textures reloaded right away aren't packed again as the pages they're on
+    // stay alive until every texture on them has been disposed
+    bool atlasEnabled = sAtlasEnabled;
+    sAtlasEnabled = false;
+
+    // Textures that can be decoded off the main thread, queued for the
+    // async jobs once every texture is disposed
+    utArray<TextureInfo*> restores;
+
+    for (int i = 0; i < sTextureSlotCount; i++)
     {
         loom_mutex_lock(Texture::sTexInfoLock);
-        TextureInfo *tinfo = &sTextureInfos[i];
+        TextureInfo *tinfo = getTextureSlot(i);
 
-        // Ignore invalid entries.
-        if (tinfo->handle != -1)
+        // Ignore invalid entries, atlas pages go away with their textures.
+        // Textures still loading are created in the new context anyway,
+        // videos are reopened below.
+        if (tinfo->handle != (GLuint)-1 && tinfo->handle != MARKEDTEXTURE && !tinfo->isAtlasPage && !tinfo->video)
         {
-            const char *path = tinfo->texturePath.c_str();
-            lmLogDebug(gGFXTextureLogGroup, "Resetting texture '%s'", path);
+            utString path = tinfo->texturePath;
+            lmLogDebug(gGFXTextureLogGroup, "Resetting texture '%s'", path.c_str());
+
+            bool evictable = tinfo->evictable;
+            uint32_t lastUsedFrame = tinfo->lastUsedFrame;
+
+            // Dispose would free the source bytes along with the TextureInfo
+            utByteArray *sourceBytes = tinfo->sourceBytes;
+            tinfo->sourceBytes = NULL;
 
             Texture::dispose(tinfo->id);
-            tinfo->reload     = false;
+
+            // Take the TextureInfo back off the free list for the reload,
+            // dispose put it on top
+            lmAssert(sFreeTextureSlots.back() == i, "Disposed texture #%d is not on top of the free list", i);
+            sFreeTextureSlots.pop_back();
+            tinfo->handle = MARKEDTEXTURE;
+
+            tinfo->reload        = false;
+            tinfo->evictable     = evictable;
+            tinfo->lastUsedFrame = lastUsedFrame;
+            tinfo->sourceBytes   = sourceBytes;
+
+            bool async = sourceBytes != NULL || (evictable && !path.empty());
+            if (async)
+            {
+                tinfo->texturePath = path;
+                if (!path.empty())
+                    sTexturePathLookup.insert(path, tinfo->id);
+                restores.push_back(tinfo);
+            }
 
             loom_mutex_unlock(Texture::sTexInfoLock);
 
-            // Force it to be loaded from disk
-            loom_asset_lock(path, LATImage, 1);
-            loom_asset_unlock(path);
+            if (!async)
+            {
+                // Force it to be loaded from disk
+                loom_asset_lock(path.c_str(), LATImage, 1);
+                loom_asset_unlock(path.c_str());
 
-            // Do actual texture creation/update
-            handleAssetNotification((void *)(size_t)tinfo->id, path);
+                // Do actual texture creation/update
+                handleAssetNotification((void *)(size_t)tinfo->id, path.c_str());
+            }
         }
         else
         {
             loom_mutex_unlock(Texture::sTexInfoLock);
         }
     }
+
+    sAtlasEnabled = atlasEnabled;
+
+    VideoTexture::reset();
+
+    // The textures drawn in the last frames go ahead of anything already
+    // waiting, the most recently drawn first, so what's on screen comes
+    // back before the rest is decoded and uploaded within the budget
+    if (restores.size() > 1)
+        qsort(restores.ptr(), restores.size(), sizeof(TextureInfo*), compareRestoreOrder);
+
+    uint32_t frame = Graphics::getCurrentFrame();
+    for (int i = (int)restores.size() - 1; i >= 0; i--)
+    {
+        if (frame - restores[i]->lastUsedFrame <= 1)
+            queueRestore(restores[i], true);
+    }
+    for (UTsize i = 0; i < restores.size(); i++)
+    {
+        if (frame - restores[i]->lastUsedFrame > 1)
+            queueRestore(restores[i], false);
+    }
+
+    lmLogDebug(gGFXTextureLogGroup, "Queued %d textures for reloading", (int)restores.size());
+
+    // Also restarts the loads stopped above
+    ensureAsyncThread();
+
+    // The pooled objects went away with the old context
+    sRenderTargetPool.clear();
+}
+
+void Texture::queueRestore(TextureInfo *tinfo, bool priority)
+{
+    AsyncLoadNote threadNote;
+    memset(&threadNote, 0, sizeof(AsyncLoadNote));
+    threadNote.id = tinfo->id;
+    threadNote.tinfo = tinfo;
+    threadNote.priority = priority;
+    threadNote.update = false;
+    threadNote.restore = true;
+
+    if (tinfo->sourceBytes != NULL)
+    {
+        threadNote.path = "";
+        threadNote.bytes.allocateAndCopy(tinfo->sourceBytes->getDataPtr(), tinfo->sourceBytes->getSize());
+    }
+    else
+    {
+        threadNote.path = tinfo->texturePath;
+    }
+    tinfo->asyncPending = true;
+
+    loom_mutex_lock(Texture::sAsyncQueueMutex);
+    if (priority)
+    {
+        sAsyncLoadQueue.push_front(threadNote);
+    }
+    else
+    {
+        sAsyncLoadQueue.push_back(threadNote);
+    }
+    loom_mutex_unlock(Texture::sAsyncQueueMutex);
+}
+
+void Texture::setSourceBytes(TextureInfo *tinfo, utByteArray *bytes)
+{
+    if (tinfo->sourceBytes != NULL)
+    {
+        lmDelete(NULL, tinfo->sourceBytes);
+        tinfo->sourceBytes = NULL;
+    }
+
+    if (!sKeepSourceBytes || bytes == NULL)
+        return;
+
+    tinfo->sourceBytes = lmNew(NULL) utByteArray();
+    tinfo->sourceBytes->allocateAndCopy(bytes->getDataPtr(), bytes->getSize());
+}
+
+void Texture::setFormatRule(const char *prefix, int format, bool dither)
+{
+    if (format < 0 || format >= PIXEL_FORMAT_COUNT)
+    {
+        lmLogError(gGFXTextureLogGroup, "Unknown texture format %d for '%s'", format, prefix ? prefix : "");
+        return;
+    }
+
+    FormatRule rule;
+    rule.prefix = prefix ? prefix : "";
+    rule.format = format;
+    rule.dither = dither;
+
+    for (UTsize i = 0; i < sFormatRules.size(); i++)
+    {
+        if (sFormatRules[i].prefix == rule.prefix)
+        {
+            sFormatRules[i] = rule;
+            return;
+        }
+    }
+    sFormatRules.push_back(rule);
+}
+
+void Texture::clearFormatRules()
+{
+    sFormatRules.clear();
+}
+
+const Texture::FormatRule *Texture::findFormatRule(const utString &path)
+{
+    const FormatRule *match = NULL;
+    for (UTsize i = 0; i < sFormatRules.size(); i++)
+    {
+        const FormatRule &rule = sFormatRules[i];
+        if (strncmp(path.c_str(), rule.prefix.c_str(), rule.prefix.size()) != 0)
+            continue;
+        if (match == NULL || rule.prefix.size() > match->prefix.size())
+            match = &rule;
+    }
+    return match;
+}
+
+void Texture::setKeepSourceBytes(bool keep)
+{
+    sKeepSourceBytes = keep;
+}
+
+bool Texture::getKeepSourceBytes()
+{
+    return sKeepSourceBytes;
 }
 
 void Texture::clear(TextureID id, int color, float alpha)
@@ -1134,6 +1939,7 @@ void Texture::clear(TextureID id, int color, float alpha)
     TextureID prevRenderTexture = currentRenderTexture;
 
     setRenderTarget(id);
+    getTextureInfo(id)->contentVersion++;
 
     Graphics::context()->glClearColor(
         float((color >> 16) & 0xFF) / 255.0f,
@@ -1202,6 +2008,7 @@ void Texture::setRenderTarget(TextureID id)
 
         lmAssert(tinfo->handle != -1, "Texture handle invalid");
         lmAssert(tinfo->renderTarget, "Error rendering to texture, texture is not a render buffer: %d", id);
+        tinfo->contentVersion++;
 
         // Save frame state
         Graphics::pushRenderTarget();
@@ -1262,17 +2069,579 @@ void Texture::dispose(TextureID id)
             sTexturePathLookup.erase(tinfo->texturePath);
         }
 
-        if (tinfo->renderTarget) {
-            Graphics::context()->glDeleteFramebuffers(1, &tinfo->framebuffer);
-            if (tinfo->renderbuffer != -1) Graphics::context()->glDeleteRenderbuffers(1, &tinfo->renderbuffer);
+        // And erase backing state. We'll generate more IDs if we need to.
+        // Packed textures share the handle of their page, render targets
+        // are kept for reuse.
+        if (tinfo->renderTarget)
+        {
+            releaseRenderTarget(*tinfo);
+        }
+        else if (tinfo->atlasPage != TEXTUREINVALID)
+        {
+            removeFromAtlas(*tinfo);
+        }
+        else if (tinfo->video)
+        {
+            VideoTexture::close(*tinfo);
+            Graphics_ResetGLStateCache();
+        }
+        else
+        {
+            Graphics::context()->glDeleteTextures(1, &tinfo->handle);
+            Graphics_ResetGLStateCache();
         }
+        setTextureMemory(*tinfo, 0);
+        freeTextureInfo(tinfo);
+    }
 
-        // And erase backing state. We'll generate more IDs if we need to.
-        Graphics::context()->glDeleteTextures(1, &tinfo->handle);
-        tinfo->reset();
+    loom_mutex_unlock(Texture::sTexInfoLock);
+}
+
+}
+
+namespace GFX
+{
+
+void Texture::setAtlasEnabled(bool enabled)
+{
+    sAtlasEnabled = enabled;
+}
+
+bool Texture::getAtlasEnabled()
+{
+    return sAtlasEnabled;
+}
+
+bool Texture::getAtlasRegion(TextureID id, TextureID &page, float *region)
+{
+    TextureInfo *tinfo = getTextureInfo(id);
+    if (!tinfo)
+        return false;
+
+    if (tinfo->video)
+    {
+        page = id;
+        memcpy(region, tinfo->videoRegion, sizeof(tinfo->videoRegion));
+        return true;
+    }
+
+    if (tinfo->atlasPage == TEXTUREINVALID)
+        return false;
+
+    page = tinfo->atlasPage;
+    region[0] = (float)tinfo->atlasX / TEXTURE_ATLAS_PAGE_SIZE;
+    region[1] = (float)tinfo->atlasY / TEXTURE_ATLAS_PAGE_SIZE;
+    region[2] = (float)tinfo->width / TEXTURE_ATLAS_PAGE_SIZE;
+    region[3] = (float)tinfo->height / TEXTURE_ATLAS_PAGE_SIZE;
+    return true;
+}
+
+bool Texture::addToAtlas(TextureInfo &tinfo, uint8_t *data, int width, int height)
+{
+    if (!sAtlasEnabled || data == NULL || tinfo.renderTarget || tinfo.isAtlasPage ||
+        width > TEXTURE_ATLAS_MAX_SIZE || height > TEXTURE_ATLAS_MAX_SIZE)
+    {
+        return false;
     }
 
+    LOOM_PROFILE_SCOPE(textureAtlasAdd);
+
+    int paddedWidth = width + 2 * TEXTURE_ATLAS_PADDING;
+    int paddedHeight = height + 2 * TEXTURE_ATLAS_PADDING;
+
+    AtlasPage *page = NULL;
+    int x = 0, y = 0;
+
+    for (UTsize i = 0; i < sAtlasPages.size(); i++)
+    {
+        if (sAtlasPages[i]->packer.insert(paddedWidth, paddedHeight, x, y))
+        {
+            page = sAtlasPages[i];
+            break;
+        }
+    }
+
+    if (page == NULL)
+    {
+        TextureInfo *pageInfo = getAvailableTextureInfo(NULL);
+        if (pageInfo == NULL)
+        {
+            lmLogError(gGFXTextureLogGroup, "No available texture id for atlas page");
+            return false;
+        }
+
+        pageInfo->isAtlasPage = true;
+        load(NULL, TEXTURE_ATLAS_PAGE_SIZE, TEXTURE_ATLAS_PAGE_SIZE, pageInfo->id);
+
+        page = lmNew(NULL) AtlasPage();
+        page->id = pageInfo->id;
+        page->textureCount = 0;
+        page->packer.reset(TEXTURE_ATLAS_PAGE_SIZE, TEXTURE_ATLAS_PAGE_SIZE);
+        sAtlasPages.push_back(page);
+
+        lmLogDebug(gGFXTextureLogGroup, "Created atlas page #%d", Texture::getIndex(page->id));
+
+        if (!page->packer.insert(paddedWidth, paddedHeight, x, y))
+            return false;
+    }
+
+    TextureInfo *pageInfo = getTextureInfo(page->id);
+
+    tinfo.handle = pageInfo->handle;
+    tinfo.width = width;
+    tinfo.height = height;
+    tinfo.atlasPage = page->id;
+    tinfo.atlasX = x + TEXTURE_ATLAS_PADDING;
+    tinfo.atlasY = y + TEXTURE_ATLAS_PADDING;
+    tinfo.clampOnly = true;
+    tinfo.mipmaps = false;
+    page->textureCount++;
+
+    uploadToAtlas(tinfo, data, width, height, 0, 0);
+
+    lmLogDebug(gGFXTextureLogGroup, "Packed %s (%dx%d) into atlas page #%d at %d, %d", tinfo.texturePath.c_str(), width, height, Texture::getIndex(page->id), tinfo.atlasX, tinfo.atlasY);
+
+    return true;
+}
+
+void Texture::removeFromAtlas(TextureInfo &tinfo)
+{
+    for (UTsize i = 0; i < sAtlasPages.size(); i++)
+    {
+        AtlasPage *page = sAtlasPages[i];
+        if (page->id != tinfo.atlasPage)
+            continue;
+
+        // Regions aren't reused individually, the whole page is
+        // released once nothing is drawn from it anymore
+        if (--page->textureCount == 0)
+        {
+            lmLogDebug(gGFXTextureLogGroup, "Releasing atlas page #%d", Texture::getIndex(page->id));
+            dispose(page->id);
+            sAtlasPages.erase(i, true);
+            lmDelete(NULL, page);
+        }
+        break;
+    }
+
+    tinfo.atlasPage = TEXTUREINVALID;
+    tinfo.handle = MARKEDTEXTURE;
+}
+
+void Texture::uploadToAtlas(TextureInfo &tinfo, uint8_t *data, int width, int height, int xoffset, int yoffset)
+{
+    TextureInfo *pageInfo = getTextureInfo(tinfo.atlasPage);
+    if (!pageInfo)
+    {
+        lmLogError(gGFXTextureLogGroup, "Atlas page of texture #%d is gone", Texture::getIndex(tinfo.id));
+        return;
+    }
+
+    lmAssert(xoffset + width <= tinfo.width && yoffset + height <= tinfo.height, "Texture %d (%dx%d) update parameters invalid: x=%d, y=%d, width=%d, height=%d", tinfo.id, tinfo.width, tinfo.height, xoffset, yoffset, width, height);
+
+    // Partial updates leave the padding as it was
+    if (xoffset != 0 || yoffset != 0 || width != tinfo.width || height != tinfo.height)
+    {
+        upload(*pageInfo, data, (uint16_t)width, (uint16_t)height, tinfo.atlasX + xoffset, tinfo.atlasY + yoffset);
+        return;
+    }
+
+    // Extrude the edge pixels into the padding around the region
+    int paddedWidth = width + 2 * TEXTURE_ATLAS_PADDING;
+    int paddedHeight = height + 2 * TEXTURE_ATLAS_PADDING;
+    uint32_t *padded = static_cast<uint32_t*>(lmAlloc(gGFXTextureAllocator, paddedWidth * paddedHeight * 4));
+    const uint32_t *src = reinterpret_cast<const uint32_t*>(data);
+
+    for (int py = 0; py < paddedHeight; py++)
+    {
+        int sy = py - TEXTURE_ATLAS_PADDING;
+        sy = sy < 0 ? 0 : (sy >= height ? height - 1 : sy);
+
+        for (int px = 0; px < paddedWidth; px++)
+        {
+            int sx = px - TEXTURE_ATLAS_PADDING;
+            sx = sx < 0 ? 0 : (sx >= width ? width - 1 : sx);
+
+            padded[py * paddedWidth + px] = src[sy * width + sx];
+        }
+    }
+
+    upload(*pageInfo, (uint8_t*)padded, (uint16_t)paddedWidth, (uint16_t)paddedHeight,
+           tinfo.atlasX - TEXTURE_ATLAS_PADDING, tinfo.atlasY - TEXTURE_ATLAS_PADDING);
+
+    lmFree(gGFXTextureAllocator, padded);
+}
+
+}
+
+namespace GFX
+{
+
+void Texture::detectCompressedFormats()
+{
+    sCompressedFormats.clear();
+
+    GLint count = 0;
+    Graphics::context()->glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+    if (count > 0)
+    {
+        utArray<GLint> formats;
+        formats.resize(count);
+        Graphics::context()->glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.ptr());
+        for (int i = 0; i < count; i++)
+            sCompressedFormats.push_back(formats[i]);
+    }
+
+    // Not every driver lists all the formats it supports
+    if (Graphics::queryExtension("GL_EXT_texture_compression_s3tc"))
+    {
+        sCompressedFormats.push_back(IMAGE_COMPRESSED_DXT1);
+        sCompressedFormats.push_back(IMAGE_COMPRESSED_DXT3);
+        sCompressedFormats.push_back(IMAGE_COMPRESSED_DXT5);
+    }
+
+    if (Graphics::queryExtension("GL_IMG_texture_compression_pvrtc"))
+    {
+        for (int format = IMAGE_COMPRESSED_PVRTC_RGB_4BPP; format <= IMAGE_COMPRESSED_PVRTC_RGBA_2BPP; format++)
+            sCompressedFormats.push_back(format);
+    }
+
+    if (Graphics::queryExtension("GL_OES_compressed_ETC1_RGB8_texture"))
+        sCompressedFormats.push_back(IMAGE_COMPRESSED_ETC1);
+
+    if (Graphics::queryExtension("GL_KHR_texture_compression_astc_ldr"))
+    {
+        for (int format = IMAGE_COMPRESSED_ASTC_4x4; format <= IMAGE_COMPRESSED_ASTC_12x12; format++)
+            sCompressedFormats.push_back(format);
+    }
+
+    lmLogDebug(gGFXTextureLogGroup, "%d compressed texture formats supported", (int)sCompressedFormats.size());
+}
+
+bool Texture::supportsCompressedFormat(int format)
+{
+    // ETC2 decoders read ETC1 data as well
+    if (format == IMAGE_COMPRESSED_ETC1 && sCompressedFormats.find(IMAGE_COMPRESSED_ETC1) == UT_NPOS)
+        format = IMAGE_COMPRESSED_ETC2_RGB;
+
+    return sCompressedFormats.find(format) != UT_NPOS;
+}
+
+utString Texture::resolveCompressedPath(const char *path)
+{
+    // Variants by preference, the first one the GPU supports and that
+    // exists next to the image is loaded instead of it
+    static const struct
+    {
+        const char *suffix;
+        int format;
+    } variants[] = {
+        { "astc.ktx", IMAGE_COMPRESSED_ASTC_4x4 },
+        { "etc2.ktx", IMAGE_COMPRESSED_ETC2_RGBA },
+        { "pvrtc.pvr", IMAGE_COMPRESSED_PVRTC_RGBA_4BPP },
+        { "dxt.dds", IMAGE_COMPRESSED_DXT5 },
+        { "etc1.ktx", IMAGE_COMPRESSED_ETC1 },
+    };
+
+    utString image = path;
+    if (sCompressedFormats.size() == 0)
+        return image;
+
+    const char *extension = strrchr(path, '.');
+    if (extension == NULL || !stricmp(extension, ".ktx") || !stricmp(extension, ".pvr") || !stricmp(extension, ".dds"))
+        return image;
+
+    utString base = image.substr(0, (UTsize)(extension - path) + 1);
+    for (size_t i = 0; i < sizeof(variants) / sizeof(variants[0]); i++)
+    {
+        if (!supportsCompressedFormat(variants[i].format))
+            continue;
+
+        utString variant = base + variants[i].suffix;
+        if (platform_mapFileExists(variant.c_str()))
+        {
+            lmLogDebug(gGFXTextureLogGroup, "Using %s for %s", variant.c_str(), path);
+            return variant;
+        }
+    }
+
+    return image;
+}
+
+void Texture::uploadCompressed(TextureInfo &tinfo, const loom_asset_image_t *lat)
+{
+    LOOM_PROFILE_SCOPE(textureLoadUploadCompressed);
+
+    int format = lat->compressedFormat;
+    if (format == IMAGE_COMPRESSED_ETC1 && sCompressedFormats.find(IMAGE_COMPRESSED_ETC1) == UT_NPOS)
+        format = IMAGE_COMPRESSED_ETC2_RGB;
+
+    if (Graphics_CacheBindTexture(tinfo.handle))
+        Graphics::context()->glBindTexture(GL_TEXTURE_2D, tinfo.handle);
+
+    tinfo.width = lat->width;
+    tinfo.height = lat->height;
+
+    const uint8_t *levelData = static_cast<const uint8_t*>(lat->bits);
+    int width = lat->width;
+    int height = lat->height;
+    int fullChain = 1;
+    for (int level = 0; level < lat->levelCount; level++)
+    {
+        Graphics::context()->glCompressedTexImage2D(GL_TEXTURE_2D, level, format, width, height, 0, (GLsizei)lat->levelSize[level], levelData);
+        levelData += lat->levelSize[level];
+
+        if (width > 1 || height > 1)
+            fullChain++;
+        width = width > 1 ? width >> 1 : 1;
+        height = height > 1 ? height >> 1 : 1;
+    }
+
+    // Mipmapped sampling needs every level down to 1x1
+    tinfo.mipmaps = lat->levelCount >= fullChain;
+    tinfo.clampOnly = !supportsFullNPOT && !tinfo.isPowerOfTwo();
+
+    size_t bytes = 0;
+    for (int level = 0; level < lat->levelCount; level++)
+        bytes += lat->levelSize[level];
+    setTextureMemory(tinfo, bytes);
+    tinfo.lastUsedFrame = Graphics::getCurrentFrame();
+}
+
+}
+
+namespace GFX
+{
+
+void Texture::setTextureMemory(TextureInfo &tinfo, size_t bytes)
+{
+    sTextureMemory += bytes - tinfo.memoryBytes;
+    tinfo.memoryBytes = bytes;
+}
+
+void Texture::setMemoryBudget(int bytes)
+{
+    sTextureMemoryBudget = bytes < 0 ? 0 : (size_t)bytes;
+}
+
+int Texture::getMemoryBudget()
+{
+    return (int)sTextureMemoryBudget;
+}
+
+int Texture::getMemoryUsage()
+{
+    return (int)sTextureMemory;
+}
+
+bool Texture::markUsed(TextureID id)
+{
+    TextureInfo *tinfo = getTextureInfo(id);
+    if (!tinfo)
+        return false;
+
+    tinfo->lastUsedFrame = Graphics::getCurrentFrame();
+    if (!tinfo->evicted)
+        return false;
+
+    restore(*tinfo);
+    return true;
+}
+
+void Texture::enforceMemoryBudget()
+{
+    if (sTextureMemoryBudget == 0 || sTextureMemory <= sTextureMemoryBudget)
+        return;
+
+    LOOM_PROFILE_SCOPE(textureEvict);
+
+    uint32_t frame = Graphics::getCurrentFrame();
+
+    loom_mutex_lock(Texture::sTexInfoLock);
+    while (sTextureMemory > sTextureMemoryBudget)
+    {
+        TextureInfo *oldest = NULL;
+        for (int i = 0; i < sTextureSlotCount; i++)
+        {
+            TextureInfo *tinfo = getTextureSlot(i);
+            if (tinfo->handle == (GLuint)-1 || tinfo->handle == MARKEDTEXTURE || !tinfo->evictable || tinfo->evicted ||
+                tinfo->atlasPage != TEXTUREINVALID || tinfo->renderTarget || tinfo->memoryBytes == 0)
+            {
+                continue;
+            }
+
+            // Textures drawn in the last frame would only be reloaded right away
+            if (frame - tinfo->lastUsedFrame <= 1)
+                continue;
+
+            if (oldest == NULL || tinfo->lastUsedFrame < oldest->lastUsedFrame)
+                oldest = tinfo;
+        }
+
+        if (oldest == NULL)
+            break;
+
+        evict(*oldest);
+    }
     loom_mutex_unlock(Texture::sTexInfoLock);
 }
 
+void Texture::evict(TextureInfo &tinfo)
+{
+    lmLogDebug(gGFXTextureLogGroup, "Evicting #%d.%d %s, %d KB, last drawn %d frames ago", Texture::getIndex(tinfo.id), Texture::getVersion(tinfo.id), tinfo.texturePath.c_str(),
+               (int)(tinfo.memoryBytes / 1024), (int)(Graphics::getCurrentFrame() - tinfo.lastUsedFrame));
+
+    // The handle stays the same so anything holding on to it remains
+    // valid, only the storage of every level is released
+    if (Graphics_CacheBindTexture(tinfo.handle))
+        Graphics::context()->glBindTexture(GL_TEXTURE_2D, tinfo.handle);
+
+    int levels = 1;
+    if (tinfo.mipmaps)
+    {
+        for (int size = tinfo.width > tinfo.height ? tinfo.width : tinfo.height; size > 1; size >>= 1)
+            levels++;
+    }
+
+    for (int level = 0; level < levels; level++)
+        Graphics::context()->glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+    setTextureMemory(tinfo, 0);
+    tinfo.evicted = true;
+}
+
+void Texture::restore(TextureInfo &tinfo)
+{
+    LOOM_PROFILE_SCOPE(textureRestore);
+
+    const char *path = tinfo.texturePath.c_str();
+    lmLogDebug(gGFXTextureLogGroup, "Restoring evicted #%d.%d %s", Texture::getIndex(tinfo.id), Texture::getVersion(tinfo.id), path);
+
+    tinfo.evicted = false;
+
+    loom_asset_image_t *lat = static_cast<loom_asset_image_t*>(loom_asset_lock(path, LATImage, 1));
+    if (lat == NULL)
+    {
+        lmLogError(gGFXTextureLogGroup, "Unable to restore evicted texture %s", path);
+        return;
+    }
+
+    if (lat->compressedFormat != IMAGE_COMPRESSED_NONE)
+        uploadCompressed(tinfo, lat);
+    else if (lat->width == tinfo.width && lat->height == tinfo.height)
+        upload(tinfo, static_cast<uint8_t*>(lat->bits), (uint16_t)lat->width, (uint16_t)lat->height);
+    else
+        loadImageAsset(lat, tinfo.id);   // downsampled when loaded
+
+    loom_asset_unlock(path);
+    loom_asset_flush(path);
+}
+
+}
+
+namespace GFX
+{
+
+bool Texture::acquireRenderTarget(TextureInfo &tinfo, int width, int height)
+{
+    // Prefer a target that already has the depth/stencil attachment if it's needed
+    bool stencil = Graphics::getStencilRequired();
+    UTsize match = UT_NPOS;
+    for (UTsize i = 0; i < sRenderTargetPool.size(); i++)
+    {
+        PooledRenderTarget &target = sRenderTargetPool[i];
+        if (target.width != width || target.height != height)
+            continue;
+
+        match = i;
+        if ((target.renderbuffer != (GLuint)-1) == stencil)
+            break;
+    }
+
+    if (match == UT_NPOS)
+        return false;
+
+    PooledRenderTarget target = sRenderTargetPool[match];
+    sRenderTargetPool.erase(match, true);
+    sRenderTargetPoolHits++;
+
+    tinfo.handle = target.handle;
+    tinfo.framebuffer = target.framebuffer;
+    tinfo.renderbuffer = target.renderbuffer;
+    tinfo.width = width;
+    tinfo.height = height;
+    tinfo.clampOnly = true;
+    tinfo.mipmaps = false;
+    setTextureMemory(tinfo, textureMemoryBytes(width, height, false));
+    tinfo.lastUsedFrame = Graphics::getCurrentFrame();
+
+    // A new render target starts out transparent, not with what was
+    // last rendered into the pooled one
+    GLint prevFramebuffer;
+    Graphics::context()->glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFramebuffer);
+    Graphics::context()->glBindFramebuffer(GL_FRAMEBUFFER, tinfo.framebuffer);
+    Graphics::context()->glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    Graphics::context()->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    Graphics::context()->glBindFramebuffer(GL_FRAMEBUFFER, prevFramebuffer);
+
+    lmLogDebug(gGFXTextureLogGroup, "Reusing pooled %dx%d render target for #%d.%d", width, height, Texture::getIndex(tinfo.id), Texture::getVersion(tinfo.id));
+    return true;
+}
+
+void Texture::releaseRenderTarget(TextureInfo &tinfo)
+{
+    if (sRenderTargetPool.size() >= TEXTURE_RENDER_TARGET_POOL_SIZE)
+    {
+        // Entries are in release order, so the first one is the oldest
+        PooledRenderTarget &oldest = sRenderTargetPool[0];
+        Graphics::context()->glDeleteFramebuffers(1, &oldest.framebuffer);
+        if (oldest.renderbuffer != (GLuint)-1) Graphics::context()->glDeleteRenderbuffers(1, &oldest.renderbuffer);
+        Graphics::context()->glDeleteTextures(1, &oldest.handle);
+        Graphics_ResetGLStateCache();
+        sRenderTargetPool.erase(0, true);
+    }
+
+    PooledRenderTarget target;
+    target.width = tinfo.width;
+    target.height = tinfo.height;
+    target.handle = tinfo.handle;
+    target.framebuffer = tinfo.framebuffer;
+    target.renderbuffer = tinfo.renderbuffer;
+    target.releasedFrame = Graphics::getCurrentFrame();
+    sRenderTargetPool.push_back(target);
+}
+
+void Texture::trimRenderTargetPool(uint32_t frame)
+{
+    UTsize i = 0;
+    while (i < sRenderTargetPool.size())
+    {
+        PooledRenderTarget &target = sRenderTargetPool[i];
+        if (target.releasedFrame >= frame)
+        {
+            i++;
+            continue;
+        }
+
+        Graphics::context()->glDeleteFramebuffers(1, &target.framebuffer);
+        if (target.renderbuffer != (GLuint)-1) Graphics::context()->glDeleteRenderbuffers(1, &target.renderbuffer);
+        Graphics::context()->glDeleteTextures(1, &target.handle);
+        Graphics_ResetGLStateCache();
+        sRenderTargetPool.erase(i, true);
+    }
+}
+
+void Texture::takeRenderTargetPoolCounters(int *hits, int *misses)
+{
+    *hits = sRenderTargetPoolHits;
+    *misses = sRenderTargetPoolMisses;
+    sRenderTargetPoolHits = 0;
+    sRenderTargetPoolMisses = 0;
+}
+
+int Texture::getRenderTargetPoolSize()
+{
+    return (int)sRenderTargetPool.size();
+}
+
 }
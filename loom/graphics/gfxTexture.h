@@ -27,15 +27,26 @@
 #include "loom/common/utils/utByteArray.h"
 #include "loom/script/native/lsNativeDelegate.h"
 #include "loom/common/platform/platformThread.h"
+#include "loom/common/platform/platformAtomic.h"
+#include "loom/graphics/gfxAtlasPacker.h"
+#include "loom/graphics/gfxPixelFormat.h"
 
 namespace GFX
 {
 typedef int   TextureID;
 
 #define TEXTUREINVALID    -1
-#define TEXTURE_ID_BITS   12
-#define TEXTURE_ID_MASK   (1 << TEXTURE_ID_BITS) - 1
-#define MAXTEXTURES       1 << TEXTURE_ID_BITS
+#define TEXTURE_ID_BITS   20
+#define TEXTURE_ID_MASK   ((1 << TEXTURE_ID_BITS) - 1)
+
+// versions wrap before reaching the sign bit, negative ids are invalid
+#define TEXTURE_VERSION_MASK  ((1 << (31 - TEXTURE_ID_BITS)) - 1)
+
+// TextureInfos are allocated in pages as more are needed, pages never
+// move so pointers to TextureInfos stay valid as the table grows
+#define TEXTURE_PAGE_BITS 8
+#define TEXTURE_PAGE_SIZE (1 << TEXTURE_PAGE_BITS)
+#define TEXTURE_MAX_PAGES (1 << (TEXTURE_ID_BITS - TEXTURE_PAGE_BITS))
 
 #define TEXTURE_GEN_BATCH 16
 
@@ -51,10 +62,33 @@ typedef int   TextureID;
 #define TEXTUREINFO_WRAP_MIRROR     1
 #define TEXTUREINFO_WRAP_CLAMP      2
 
+// size of the shared pages small textures are packed into when
+// atlasing is enabled, and the largest texture that gets packed
+#define TEXTURE_ATLAS_PAGE_SIZE     1024
+#define TEXTURE_ATLAS_MAX_SIZE      256
+
+// pixels of edge extrusion around each packed texture, keeps
+// bilinear filtering from bleeding in neighbouring textures
+#define TEXTURE_ATLAS_PADDING       1
+
+// default bytes of async loaded texture data uploaded per frame, and
+// the time after which no more uploads are started in a frame
+#define TEXTURE_UPLOAD_BUDGET       (1024 * 1024)
+#define TEXTURE_UPLOAD_BUDGET_MS    4
+
+// upper bound of the background jobs decoding async loaded textures at
+// once, short of the job workers there are
+#define TEXTURE_MAX_ASYNC_JOBS      8
+
+// disposed render targets kept around for reuse by a new one of the
+// same size, and the frames after which an unused one is released
+#define TEXTURE_RENDER_TARGET_POOL_SIZE     8
+#define TEXTURE_RENDER_TARGET_POOL_FRAMES   300
+
 struct TextureInfo
 {
     // This number uniquely identifies the texture.
-    // The last TEXTURE_ID_BITS represent the index into the `sTextureInfos` array.
+    // The last TEXTURE_ID_BITS represent the index into the `sTexturePages` table.
     // The remaining bits represent the version or check bits used to determine
     // if some part of the program is trying to operate on a texture that has
     // been recycled, since the version increments every time the texture is recycled.
@@ -73,17 +107,62 @@ struct TextureInfo
     bool                     clampOnly;
     bool                     mipmaps;
 
+    // PixelFormat of the texture on the GPU, chosen by the format rules
+    // when it's created, and whether it's dithered down to it
+    int                      format;
+    bool                     dither;
+
     bool                     reload;
 
     //this flag will be set if a TextureInfo was requested to be disposed but it is still
     //busy in the async loading thread as it can only be disposed from the main thread once \
     //its async processing is complete
     bool                     asyncDispose;
+
+    // Set while an async load or update of the texture is queued or being
+    // decoded, cleared once it completed, successfully or not
+    bool                     asyncPending;
     GLuint                   handle;
     bool                     renderTarget;
     GLuint                   framebuffer;
     GLuint                   renderbuffer;
 
+    // Set if the texture is packed into a shared atlas page. It then
+    // shares the handle of the page and is drawn from its region at
+    // atlasX, atlasY.
+    TextureID                atlasPage;
+    int                      atlasX;
+    int                      atlasY;
+
+    // Set on the textures backing atlas pages
+    bool                     isAtlasPage;
+
+    // Target the handle is bound to, GL_TEXTURE_EXTERNAL_OES for videos
+    // decoded on Android. Only GL_TEXTURE_2D textures are batched with
+    // others or drawn by custom shaders.
+    GLenum                   target;
+
+    // Set if a VideoTexture plays into the texture. The decoded frame is
+    // drawn from videoRegion (u, v, width, height), see getAtlasRegion.
+    bool                     video;
+    float                    videoRegion[4];
+
+    // Estimated bytes of GPU memory taken up and the frame the texture
+    // was last drawn in. Textures loaded from assets are evictable, they
+    // are released when over the memory budget and reloaded on demand.
+    size_t                   memoryBytes;
+    uint32_t                 lastUsedFrame;
+    bool                     evictable;
+    bool                     evicted;
+
+    // Incremented whenever the contents of the texture change, so the
+    // stage can tell if what's drawn with it needs to be redrawn
+    uint32_t                 contentVersion;
+
+    // Copy of the encoded image a texture was created from out of bytes,
+    // kept to reload it after a context loss, see Texture::setKeepSourceBytes
+    utByteArray              *sourceBytes;
+
     utString                 texturePath;
 
     LS::NativeDelegate       updateDelegate;
@@ -122,6 +201,8 @@ struct TextureInfo
 
     TextureInfo()
     {
+        id             = 0;
+        contentVersion = 0;
         reset();
     }
     void reset()
@@ -130,16 +211,31 @@ struct TextureInfo
         smoothing    = TEXTUREINFO_SMOOTHING_NONE;
         wrapU        = TEXTUREINFO_WRAP_CLAMP;
         wrapV        = TEXTUREINFO_WRAP_CLAMP;
+        format       = PIXEL_FORMAT_RGBA8888;
+        dither       = false;
         reload       = false;
         asyncDispose = false;
+        asyncPending = false;
         handle       = -1;
         // This increments the check bits / version by 1
-        id          += MAXTEXTURES;
+        id           = ((((id >> TEXTURE_ID_BITS) + 1) & TEXTURE_VERSION_MASK) << TEXTURE_ID_BITS) | (id & TEXTURE_ID_MASK);
         texturePath  = "";
         renderTarget = false;
         framebuffer  = -1;
         renderbuffer = -1;
         visible      = true;
+        atlasPage    = TEXTUREINVALID;
+        atlasX       = atlasY = 0;
+        isAtlasPage  = false;
+        target       = GL_TEXTURE_2D;
+        video        = false;
+        videoRegion[0] = videoRegion[1] = 0.0f;
+        videoRegion[2] = videoRegion[3] = 1.0f;
+        memoryBytes  = 0;
+        lastUsedFrame = 0;
+        evictable    = false;
+        evicted      = false;
+        sourceBytes  = NULL;
     }
 };
 
@@ -158,6 +254,14 @@ struct AsyncLoadNote
     utByteArray                 bytes;
     loom_asset_image_t          *imageAsset;
     LoomAssetCleanupCallback    iaCleanup;
+
+    // mipmaps of imageAsset built by the async jobs when the GPU can't
+    // generate them, NULL otherwise
+    uint32_t                    *mipChain;
+
+    // Set when the texture is reloaded after a context loss, its owner
+    // isn't told about the load completing again
+    bool                        restore;
 };
 
 
@@ -166,16 +270,28 @@ class Texture
     friend class Graphics;
     friend class QuadRenderer;
     friend class BitmapData;
+    friend class VideoTexture;
 
 private:
 
-    static utHashTable<utFastStringHash, TextureID> sTexturePathLookup;
+    static utFlatHashTable<utFastStringHash, TextureID> sTexturePathLookup;
     static bool sTextureAssetNofificationsEnabled;
     static bool supportsFullNPOT;
     static TextureID currentRenderTexture;
 
-    // simple linear TextureID -> TextureHandle
-    static TextureInfo sTextureInfos[MAXTEXTURES];
+    // TextureID -> TextureInfo, a page table indexed by the id's index
+    // bits. Pages are only ever added, and published after they're
+    // initialized, so lookups don't need sTexInfoLock.
+    struct TexturePage
+    {
+        TextureInfo infos[TEXTURE_PAGE_SIZE];
+    };
+
+    static TexturePage *volatile sTexturePages[TEXTURE_MAX_PAGES];
+    static int sTextureSlotCount;
+
+    // Indices of the free TextureInfos, the most recently freed on top
+    static utArray<int> sFreeTextureSlots;
 
     //queue of textures to load in the async loading thread
     static utList<AsyncLoadNote> sAsyncLoadQueue;
@@ -183,41 +299,44 @@ private:
     //queue of loaded texture data to be created back in the main thread
     static utList<AsyncLoadNote> sAsyncCreateQueue;
 
-    // handle for the running (or soon to be terminated) thread
-    static ThreadHandle sAsyncThread;
+    // background jobs decoding async loaded textures, each until the
+    // queue is empty
+    static int sAsyncJobCount;
 
-    //flag indicating if the async loading thread is currently running
+    //flag indicating if the async loading jobs should keep running
     static bool sAsyncThreadRunning;
 
     //mutex used for locking sAsyncLoadQueue and sAsyncCreateQueue between threads
     static MutexHandle sAsyncQueueMutex;
 
-    //mutex used for locking sTextureInfos and sTexturePathLookup between threads
+    //mutex used for locking TextureInfo allocation and sTexturePathLookup between threads
     static MutexHandle sTexInfoLock;
 
     static void ensureAsyncThread();
     static void stopAsyncThread();
 
-    static TextureID getAvailableTextureID()
+    // The TextureInfo at the index, in use or not, the index must be
+    // below sTextureSlotCount
+    inline static TextureInfo *getTextureSlot(int index)
     {
-        TextureID id;
+        return &sTexturePages[index >> TEXTURE_PAGE_BITS]->infos[index & (TEXTURE_PAGE_SIZE - 1)];
+    }
 
+    // Takes a free TextureInfo off the free list, adding a page if there
+    // are none, and marks it in use. Call with sTexInfoLock held.
+    static TextureInfo *allocTextureInfo();
+
+    // Returns a disposed TextureInfo to the free list, its version is
+    // bumped so stale ids of it no longer resolve. Call with sTexInfoLock held.
+    static void freeTextureInfo(TextureInfo *tinfo);
+
+    static TextureID getAvailableTextureID()
+    {
         loom_mutex_lock(sTexInfoLock);
-        for (id = 0; id < MAXTEXTURES; id++)
-        {
-            if (sTextureInfos[id].handle == -1)
-            {
-                break;
-            }
-        }
+        TextureInfo *tinfo = allocTextureInfo();
         loom_mutex_unlock(sTexInfoLock);
 
-        if (id == MAXTEXTURES)
-        {
-            return TEXTUREINVALID;
-        }
-
-        return id;
+        return tinfo ? tinfo->id : TEXTUREINVALID;
     }
 
     static TextureInfo *getTextureInfoFromPath(const char *path,
@@ -245,24 +364,12 @@ private:
 
     static TextureInfo *getAvailableTextureInfo(const char *path)
     {
-        TextureID id;
-        TextureInfo *tinfo = NULL;
-
         loom_mutex_lock(sTexInfoLock);
-        for (id = 0; id < MAXTEXTURES; id++)
+        TextureInfo *tinfo = allocTextureInfo();
+        if (tinfo != NULL && path != NULL)
         {
-            if (sTextureInfos[id].handle == -1)
-            {
-                // Initialize it.
-                tinfo = &sTextureInfos[id];
-                tinfo->handle = MARKEDTEXTURE;    // mark in use, but not yet loaded
-                if(path != NULL)
-                {
-                    tinfo->texturePath = path;
-                    sTexturePathLookup.insert(path, id);
-                }
-                break;
-            }
+            tinfo->texturePath = path;
+            sTexturePathLookup.insert(path, tinfo->id);
         }
         loom_mutex_unlock(sTexInfoLock);
         return tinfo;
@@ -280,6 +387,124 @@ private:
     static void loadImageAsset(loom_asset_image_t *lat, TextureID id);
     static void updateImageAsset(loom_asset_image_t *lat, TextureInfo *info);
 
+    // Compressed formats (IMAGE_COMPRESSED_*) the GPU can sample from
+    static utArray<int> sCompressedFormats;
+    static void detectCompressedFormats();
+
+    // Returns the compressed variant of an image the GPU supports best,
+    // e.g. foo.astc.ktx for foo.png, or the path itself if there's none
+    static utString resolveCompressedPath(const char *path);
+
+    static void uploadCompressed(TextureInfo &tinfo, const loom_asset_image_t *lat);
+
+    // A large async loaded texture uploaded in row bands over several
+    // frames, it's only handed to its TextureInfo once complete
+    struct StreamingUpload
+    {
+        AsyncLoadNote       note;
+        loom_asset_image_t  *image;
+        GLuint              handle;
+        int                 nextRow;
+    };
+
+    static StreamingUpload sStreamingUpload;
+    static bool sStreaming;
+    static int sUploadBudget;
+    static GLuint sUploadPixelBuffer;
+
+    // Creates a texture from the async create queue, returns the bytes uploaded
+    static int createAsyncTexture(AsyncLoadNote &threadNote);
+    static void completeAsyncTexture(AsyncLoadNote &threadNote);
+
+    static bool beginStreamingUpload(AsyncLoadNote &threadNote);
+    static int continueStreamingUpload(int budget);
+    static void finishStreamingUpload();
+    static void cancelStreamingUpload(bool requeue);
+
+    // Estimated GPU memory of all textures, and the budget for it
+    static size_t sTextureMemory;
+    static size_t sTextureMemoryBudget;
+
+    static void setTextureMemory(TextureInfo &tinfo, size_t bytes);
+
+    // Evicts the least recently drawn textures until the memory budget is met
+    static void enforceMemoryBudget();
+    static void evict(TextureInfo &tinfo);
+    static void restore(TextureInfo &tinfo);
+
+    static bool sKeepSourceBytes;
+
+    // Texture paths starting with prefix are created in format
+    struct FormatRule
+    {
+        utString prefix;
+        int      format;
+        bool     dither;
+    };
+
+    static utArray<FormatRule> sFormatRules;
+
+    // The rule with the longest prefix of path, NULL if none matches
+    static const FormatRule *findFormatRule(const utString &path);
+
+    // Replaces the encoded image kept for tinfo with a copy of bytes if
+    // source bytes are kept, otherwise drops it
+    static void setSourceBytes(TextureInfo *tinfo, utByteArray *bytes);
+
+    // Queues the reload of a texture disposed by reset for the async jobs,
+    // from its source bytes if it has them, otherwise from its asset
+    static void queueRestore(TextureInfo *tinfo, bool priority);
+
+    // The GL objects of a disposed render target, waiting to be reused
+    // by a new render target of the same size
+    struct PooledRenderTarget
+    {
+        int         width;
+        int         height;
+        GLuint      handle;
+        GLuint      framebuffer;
+        GLuint      renderbuffer;
+        uint32_t    releasedFrame;
+    };
+
+    static utArray<PooledRenderTarget> sRenderTargetPool;
+    static int sRenderTargetPoolHits;
+    static int sRenderTargetPoolMisses;
+
+    // Hands the objects of a pooled render target matching the size to
+    // the texture, returns false if there's none
+    static bool acquireRenderTarget(TextureInfo &tinfo, int width, int height);
+
+    // Moves the objects of a render target into the pool, the oldest
+    // pooled one is deleted if the pool is full
+    static void releaseRenderTarget(TextureInfo &tinfo);
+
+    // Deletes pooled render targets released before the given frame
+    static void trimRenderTargetPool(uint32_t frame);
+
+    // A shared page small textures are packed into
+    struct AtlasPage
+    {
+        TextureID id;
+        AtlasPacker packer;
+        int textureCount;
+    };
+
+    static bool sAtlasEnabled;
+    static utArray<AtlasPage*> sAtlasPages;
+
+    // Packs the image into an atlas page, creating one if none has room,
+    // returns false if the texture should get its own GL texture instead
+    static bool addToAtlas(TextureInfo &tinfo, uint8_t *data, int width, int height);
+
+    // Releases the region of the texture, disposing the page once all
+    // of its textures are gone
+    static void removeFromAtlas(TextureInfo &tinfo);
+
+    // Uploads into the region of a packed texture, extruding the edges
+    // into the padding when the whole image is replaced
+    static void uploadToAtlas(TextureInfo &tinfo, uint8_t *data, int width, int height, int xoffset, int yoffset);
+
 public:
 
     inline static TextureInfo *getTextureInfo(const char *path)
@@ -328,15 +553,54 @@ public:
 
     static void upload(TextureInfo &tinfo, uint8_t *data, uint16_t width, uint16_t height, int xoffset = -1, int yoffset = -1);
 
-    // This method accepts rgba data.
-    static TextureInfo *load(uint8_t *data, uint16_t width, uint16_t height, TextureID id = -1);
+    // This method accepts rgba data, or the levels of a compressed image.
+    static TextureInfo *load(uint8_t *data, uint16_t width, uint16_t height, TextureID id = -1, const loom_asset_image_t *compressed = NULL);
+
+    static bool supportsCompressedFormat(int format);
+
+    // Bytes of async loaded texture data uploaded per frame, textures
+    // bigger than this are streamed in over several frames. 0 creates
+    // one texture per frame regardless of its size.
+    static void setUploadBudget(int bytes);
+    static int getUploadBudget();
+
+    // Keeps a copy of the encoded image of textures created from bytes,
+    // so they are decoded again by the async jobs after a context loss
+    // instead of coming back as checkerboards. Textures loaded from assets
+    // are always reloaded from them.
+    static void setKeepSourceBytes(bool keep);
+    static bool getKeepSourceBytes();
+
+    // Creates the uncompressed textures loaded from then on whose path or
+    // name starts with prefix in a PixelFormat, optionally dithered. The
+    // longest matching prefix wins, an empty one matches every texture.
+    // Textures in a reduced format aren't packed into the atlas or
+    // streamed. Setting a rule for a prefix again replaces it.
+    static void setFormatRule(const char *prefix, int format, bool dither);
+    static void clearFormatRules();
+
+    // Marks a texture as drawn this frame, an evicted texture is restored
+    // first, in which case true is returned
+    static bool markUsed(TextureID id);
+
+    // Bytes of GPU memory textures may take up before the least recently
+    // drawn ones loaded from assets are evicted, 0 for no limit. Evicted
+    // textures keep their id and are reloaded when drawn again.
+    static void setMemoryBudget(int bytes);
+    static int getMemoryBudget();
+    static int getMemoryUsage();
+
+    // Returns and resets the number of render targets created from the
+    // pool and the number that needed new GL objects since the last call
+    static void takeRenderTargetPoolCounters(int *hits, int *misses);
+    static int getRenderTargetPoolSize();
 
     static TextureInfo *initFromAssetManager(const char *path);
     static TextureInfo *initFromBytes(utByteArray *bytes, const char *name);
     static TextureInfo *initFromBytesAsync(utByteArray *bytes, const char *name, bool highPriorty);
     static TextureInfo *initFromAssetManagerAsync(const char *path, bool highPriorty);
     static TextureInfo *initEmptyTexture(int width, int height);
-    static int __stdcall loadTextureAsync_body(void *param);
+    static void loadTextureAsync_job(void *param);
 
     static void updateFromBytes(TextureID id, utByteArray *bytes);
     static void updateFromBytesAsync(TextureID id, utByteArray *bytes, bool highPriority);
@@ -349,6 +613,18 @@ public:
 
     static void dispose(TextureID id);
 
+    // When enabled, images up to TEXTURE_ATLAS_MAX_SIZE loaded afterwards
+    // are packed into shared pages so they can be drawn in a single batch.
+    // Packed textures always clamp, the page takes the smoothing of the
+    // texture being drawn from it.
+    static void setAtlasEnabled(bool enabled);
+    static bool getAtlasEnabled();
+
+    // Returns the page and the region (u, v, width, height in page texture
+    // coordinates) a packed texture is drawn from, false if it isn't packed.
+    // Video textures are their own page, drawn from the region of the frame.
+    static bool getAtlasRegion(TextureID id, TextureID &page, float *region);
+
     static void scaleImageOnDisk(const char *outPath, const char *inPath, int maxWidth, int maxHeight, bool preserveAspect);
 };
 }
\ No newline at end of file
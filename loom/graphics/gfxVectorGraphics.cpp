@@ -28,6 +28,8 @@
 namespace GFX
 {
 
+utArray<VectorGraphics*> VectorGraphics::renderedShapes;
+
 
 
 
@@ -83,7 +85,16 @@ void VectorPath::arcTo(float controlX, float controlY, float anchorX, float anch
     lastY = anchorY;
 }
 
+void VectorGraphics::changed() {
+    version++;
+    if (!changeReported && parent != NULL) {
+        changeReported = true;
+        parent->invalidateContent();
+    }
+}
+
 void VectorGraphics::clear() {
+    changed();
     utArray<VectorData*>::Iterator it = queue.iterator();
     while (it.hasMoreElements()) {
         VectorData* d = it.getNext();
@@ -97,6 +108,11 @@ void VectorGraphics::clear() {
     bounds.height = 0;
     */
     clearBounds();
+    strokeExtent = 0;
+    strokeUnscaled = false;
+    hasSVG = false;
+    mainThreadOnly = false;
+    deleteRecording();
     lastPath = NULL;
     lastLineStyle = NULL;
 
@@ -188,27 +204,43 @@ void VectorGraphics::lineStyle(float thickness, unsigned int color, float alpha,
         !strcmp(t, "miter") ? VectorLineJoints::MITER :
         VectorLineJoints::ROUND;
 
+    if (!isnan(thickness))
+    {
+        lmscalar extent = thickness / 2;
+        if (jointsEnum == VectorLineJoints::MITER) extent *= lmMax((lmscalar)1, (lmscalar)miterLimit);
+        if (capsEnum == VectorLineCaps::SQUARE) extent *= (lmscalar)1.4143;
+        strokeExtent = lmMax(strokeExtent, extent);
+        if (scaleModeEnum == VectorLineScaleMode::NONE) strokeUnscaled = true;
+    }
+
+    changed();
     lastLineStyle = lmNew(NULL) VectorLineStyle(thickness, color, alpha, scaleModeEnum, capsEnum, jointsEnum, miterLimit);
     queue.push_back(lastLineStyle);
     restartPath();
 }
 
 void VectorGraphics::textFormat(VectorTextFormat format) {
+    changed();
+    mainThreadOnly = true;
     queue.push_back(lmNew(NULL) VectorTextFormatData(lmNew(NULL) VectorTextFormat(format)));
     currentTextFormat.merge(&format);
 }
 
 void VectorGraphics::beginFill(unsigned int color, float alpha) {
+    changed();
     queue.push_back(lmNew(NULL) VectorFill(color, alpha));
     restartPath();
 }
 
 void VectorGraphics::beginTextureFill(TextureID id, Loom2D::Matrix *matrix, bool repeat, bool smooth) {
+    changed();
+    mainThreadOnly = true;
     queue.push_back(lmNew(NULL) VectorFill(id, matrix, repeat, smooth));
     restartPath();
 }
 
 void VectorGraphics::endFill() {
+    changed();
     queue.push_back(lmNew(NULL) VectorFill());
     restartPath();
 }
@@ -285,11 +317,15 @@ void VectorGraphics::drawArc(float x, float y, float radius, float angleFrom, fl
 }
 
 void VectorGraphics::drawTextLine(float x, float y, utString text) {
+    changed();
+    mainThreadOnly = true;
     queue.push_back(lmNew(NULL) VectorText(x, y, -1, lmNew(NULL) utString(text)));
     inflateBounds(VectorRenderer::textLineBounds(&currentTextFormat, x, y, &text));
 }
 
 void VectorGraphics::drawTextBox(float x, float y, float width, utString text) {
+    changed();
+    mainThreadOnly = true;
     queue.push_back(lmNew(NULL) VectorText(x, y, width < 0 ? 0 : width, lmNew(NULL) utString(text)));
     inflateBounds(VectorRenderer::textBoxBounds(&currentTextFormat, x, y, width, &text));
 }
@@ -307,6 +343,9 @@ Loom2D::Rectangle* VectorGraphics::textBoxBounds(VectorTextFormat format, float
 }
 
 void VectorGraphics::drawSVG(VectorSVG* svg, float x, float y, float scale, float lineThickness) {
+    changed();
+    hasSVG = true;
+    mainThreadOnly = true;
     queue.push_back(lmNew(NULL) VectorSVGData(svg, x, y, scale, lineThickness));
     restartPath();
     inflateBounds(Loom2D::Rectangle(x, y, svg->getWidth() * scale, svg->getHeight() * scale));
@@ -322,17 +361,33 @@ void VectorGraphics::drawSVG(VectorSVG* svg, float x, float y, float scale, floa
 
 void VectorGraphics::render(Loom2D::RenderState* renderStatePointer, Loom2D::Matrix* transform) {
     LOOM_PROFILE_SCOPE(vectorRender);
-
-    QuadRenderer::submit();
+    VectorRenderer::PassTime passTime;
 
     Loom2D::RenderState &renderState = *renderStatePointer;
 
-    VectorRenderer::beginFrame();
-    VectorRenderer::preDraw(transform->a, transform->b, transform->c, transform->d, transform->tx, transform->ty);
-
     alpha = renderState.alpha;
     scale = sqrt(transform->a*transform->a + transform->b*transform->b + transform->c*transform->c + transform->d*transform->d);
 
+    lmscalar scaleX = sqrt(transform->a*transform->a + transform->b*transform->b);
+    lmscalar scaleY = sqrt(transform->c*transform->c + transform->d*transform->d);
+
+    if (VectorRenderer::parallelTessellation && !mainThreadOnly) {
+        tessellationTransform.copyFrom(transform);
+        tessellationAlpha = alpha;
+        if (!tessellationListed) {
+            renderedShapes.push_back(this);
+            tessellationListed = true;
+        }
+    }
+
+    if (recording != NULL && (recordingVersion != version ||
+                              recordingContextVersion != VectorRenderer::contextVersion ||
+                              recordingScaleX != scaleX || recordingScaleY != scaleY ||
+                              recordingTessellation != VectorRenderer::getGeometryQuality() ||
+                              !VectorRenderer::recordingValid(recording))) {
+        deleteRecording();
+    }
+
     if (clipWidth != -1 && clipHeight != -1)
     {
         Loom2D::Matrix    res;
@@ -349,6 +404,25 @@ void VectorGraphics::render(Loom2D::RenderState* renderStatePointer, Loom2D::Mat
         }
     }
 
+    // Simple fills drawn unchanged join the quad batch, skipping the
+    // submit and nanovg frame below, clipping still goes through nanovg
+    if (VectorRenderer::batchFills && recording != NULL && !renderState.isClipping() &&
+        VectorRenderer::drawRecordingBatched(recording, *transform, (float)(alpha / recordingAlpha))) {
+        renderedVersion = version;
+        return;
+    }
+
+    // Rasterized SVGs are plain quads as well
+    if (hasSVG && renderRasters(renderState, *transform, scaleX > scaleY ? scaleX : scaleY)) {
+        renderedVersion = version;
+        return;
+    }
+
+    QuadRenderer::submit(FLUSH_VECTOR);
+
+    VectorRenderer::beginFrame();
+    VectorRenderer::preDraw(transform->a, transform->b, transform->c, transform->d, transform->tx, transform->ty);
+
     if (renderState.isClipping())
     {
         GFX::Graphics::clearClipRect();
@@ -360,12 +434,40 @@ void VectorGraphics::render(Loom2D::RenderState* renderStatePointer, Loom2D::Mat
     flushPath();
 
     LOOM_PROFILE_START(vectorRenderData);
-    utArray<VectorData*>::Iterator it = queue.iterator();
-    while (it.hasMoreElements()) {
-        VectorData* d = it.getNext();
-        d->render(this);
+    if (recording != NULL) {
+        VectorRenderer::drawRecording(recording, (float)(alpha / recordingAlpha));
+
+        // Text formats carry over to later shapes, keep applying them
+        utArray<VectorData*>::Iterator it = queue.iterator();
+        while (it.hasMoreElements()) {
+            VectorTextFormatData* d = dynamic_cast<VectorTextFormatData*>(it.getNext());
+            if (d != NULL) d->render(this);
+        }
+    } else {
+        // Only record commands drawn unchanged before, so shapes redrawn
+        // every frame don't pay for copying their geometry
+        bool record = !hasSVG && alpha > 0 && version == renderedVersion && version != unrecordableVersion;
+        if (record) VectorRenderer::beginRecording();
+
+        utArray<VectorData*>::Iterator it = queue.iterator();
+        while (it.hasMoreElements()) {
+            VectorData* d = it.getNext();
+            d->render(this);
+        }
+        flushPath();
+
+        if (record) {
+            recording = VectorRenderer::endRecording();
+            if (recording == NULL) unrecordableVersion = version;
+            recordingVersion = version;
+            recordingContextVersion = VectorRenderer::contextVersion;
+            recordingScaleX = scaleX;
+            recordingScaleY = scaleY;
+            recordingAlpha = alpha;
+            recordingTessellation = VectorRenderer::getGeometryQuality();
+        }
     }
-    flushPath();
+    renderedVersion = version;
     LOOM_PROFILE_END(vectorRenderData);
 
     if (renderState.isClipping()) {
@@ -376,6 +478,69 @@ void VectorGraphics::render(Loom2D::RenderState* renderStatePointer, Loom2D::Mat
     VectorRenderer::endFrame();
 }
 
+void VectorGraphics::tessellateChanged() {
+    if (!VectorRenderer::parallelTessellation) {
+        for (UTsize i = 0; i < renderedShapes.size(); i++) renderedShapes[i]->tessellationListed = false;
+        renderedShapes.clear();
+        return;
+    }
+
+    LOOM_PROFILE_SCOPE(vectorTessellate);
+    VectorRenderer::PassTime passTime;
+
+    static utArray<void*> jobs;
+    jobs.clear();
+
+    for (UTsize i = 0; i < renderedShapes.size(); i++) {
+        VectorGraphics* g = renderedShapes[i];
+        g->tessellationListed = false;
+
+        if (g->mainThreadOnly || g->queue.size() == 0 || g->tessellationAlpha <= 0 || g->version == g->unrecordableVersion) continue;
+
+        if (g->recording != NULL && g->recordingVersion == g->version &&
+            g->recordingContextVersion == VectorRenderer::contextVersion &&
+            g->recordingTessellation == VectorRenderer::getGeometryQuality()) continue;
+
+        g->deleteRecording();
+        jobs.push_back(g);
+    }
+    renderedShapes.clear();
+
+    VectorRenderer::tessellate(tessellateJob, jobs.ptr(), (int)jobs.size());
+}
+
+void VectorGraphics::tessellateJob(void* payload) {
+    VectorGraphics* g = static_cast<VectorGraphics*>(payload);
+    const Loom2D::Matrix& m = g->tessellationTransform;
+
+    // Same as render, the recording is only used at the same scale
+    g->alpha = g->tessellationAlpha;
+    g->scale = sqrt(m.a*m.a + m.b*m.b + m.c*m.c + m.d*m.d);
+
+    VectorRenderer::tessellationTransform(m.a, m.b, m.c, m.d, m.tx, m.ty);
+
+    g->resetStyle();
+    g->flushPath();
+
+    VectorRenderer::beginRecording();
+
+    utArray<VectorData*>::Iterator it = g->queue.iterator();
+    while (it.hasMoreElements()) {
+        VectorData* d = it.getNext();
+        d->render(g);
+    }
+    g->flushPath();
+
+    g->recording = VectorRenderer::endRecording();
+    if (g->recording == NULL) g->unrecordableVersion = g->version;
+    g->recordingVersion = g->version;
+    g->recordingContextVersion = VectorRenderer::contextVersion;
+    g->recordingScaleX = sqrt(m.a*m.a + m.b*m.b);
+    g->recordingScaleY = sqrt(m.c*m.c + m.d*m.d);
+    g->recordingAlpha = g->alpha;
+    g->recordingTessellation = VectorRenderer::getGeometryQuality();
+}
+
 void VectorPath::render(VectorGraphics* g) {
     int ci = 0;
     int commandNum = commands.size();
@@ -516,6 +681,7 @@ void VectorLineStyle::copyTo(VectorLineStyle* s) {
 
 
 VectorPath* VectorGraphics::getPath() {
+    changed();
     VectorPath* path = lastPath;
     if (path == NULL) {
         path = queue.empty() ? NULL : dynamic_cast<VectorPath*>(queue.back());
@@ -529,6 +695,7 @@ VectorPath* VectorGraphics::getPath() {
 }
 
 void VectorGraphics::addShape(VectorShape *shape) {
+    changed();
     queue.push_back(shape);
     restartPath();
 }
@@ -567,6 +734,72 @@ void VectorGraphics::flushPath() {
     VectorRenderer::clearPath();
 }
 
+bool VectorGraphics::renderRasters(Loom2D::RenderState& renderState, const Loom2D::Matrix& transform, lmscalar transformScale) {
+    if (queue.size() == 0) return false;
+
+    // Find every raster before drawing any, so a queue that can't be
+    // rasterized is drawn only once, as vectors
+    utArray<VectorSVG::Raster> rasters;
+    rasters.reserve(queue.size());
+    for (UTsize i = 0; i < queue.size(); i++) {
+        VectorSVGData* d = dynamic_cast<VectorSVGData*>(queue[i]);
+        // Line thickness is applied when drawing vectors only
+        if (d == NULL || d->image == NULL || !d->image->rasterize || d->lineThickness != 1.0f) return false;
+
+        const VectorSVG::Raster* raster = d->image->getRaster((float)(transformScale*d->scale));
+        if (raster == NULL) return false;
+        rasters.push_back(*raster);
+    }
+
+    if (alpha <= 0) return true;
+
+    LOOM_PROFILE_SCOPE(vectorRenderRasters);
+
+    if (renderState.isClipping()) GFX::Graphics::setClipRect((int)renderState.clipRect.x, (int)renderState.clipRect.y, (int)renderState.clipRect.width, (int)renderState.clipRect.height);
+
+    // The rasters are premultiplied, so is the vertex color
+    uint32_t a = (uint32_t)(alpha*255.0f + 0.5f);
+    uint32_t abgr = (a << 24) | (a << 16) | (a << 8) | a;
+
+    const float ma = (float)transform.a, mb = (float)transform.b, mc = (float)transform.c, md = (float)transform.d;
+    const float mtx = (float)transform.tx, mty = (float)transform.ty;
+
+    for (UTsize i = 0; i < queue.size(); i++) {
+        VectorSVGData* d = static_cast<VectorSVGData*>(queue[i]);
+        const VectorSVG::Raster& raster = rasters[i];
+
+        VertexPosColorTex* v = QuadRenderer::getQuadVertexMemory(4, raster.texture, true, GL_ONE, GL_ONE_MINUS_SRC_ALPHA, ShaderProgram::getDefaultShader());
+        if (v == NULL) continue;
+
+        // The raster covers whole pixels, slightly past the image size
+        float x0 = d->x;
+        float y0 = d->y;
+        float x1 = x0 + raster.width / raster.scale * d->scale;
+        float y1 = y0 + raster.height / raster.scale * d->scale;
+
+        const float corners[8] = { x0, y0, x1, y0, x0, y1, x1, y1 };
+        for (int j = 0; j < 4; j++) {
+            float x = corners[j*2];
+            float y = corners[j*2 + 1];
+            v[j].x = ma*x + mc*y + mtx;
+            v[j].y = mb*x + md*y + mty;
+            v[j].z = 0;
+            v[j].abgr = abgr;
+            v[j].u = (float)(j & 1);
+            v[j].v = (float)(j >> 1);
+        }
+    }
+
+    return true;
+}
+
+void VectorGraphics::deleteRecording() {
+    if (recording != NULL) {
+        VectorRenderer::deleteRecording(recording);
+        recording = NULL;
+    }
+}
+
 void VectorGraphics::restartPath() {
     if (lastPath) {
         int dataNum = lastPath->data.size();
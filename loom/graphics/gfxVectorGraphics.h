@@ -210,7 +210,14 @@ protected:
     lmscalar calculatedScaleY;
     bool isScaleCalculated;
     
-    const Loom2D::Shape* parent;
+    Loom2D::Shape* parent;
+
+    // Set once a change was reported to the shape until it renders again,
+    // so only the first of many drawing commands walks the hierarchy
+    bool changeReported;
+
+    // Bumps the version and tells the shape its contents changed
+    void changed();
 
 public:
     utArray<VectorData*> queue;
@@ -229,12 +236,68 @@ public:
     lmscalar scale;
     int clipX, clipY, clipWidth, clipHeight;
 
-    VectorGraphics(const Loom2D::Shape* shape)
+    // Incremented whenever the drawing commands change, see changed
+    uint32_t version;
+
+    // Called by the shape when it renders, later changes are reported again
+    inline void resetChangeReported() { changeReported = false; }
+
+    // How far strokes can reach past the shape bounds, which only cover
+    // the stroke of lines. Unscaled strokes depend on the render scale.
+    lmscalar strokeExtent;
+    bool strokeUnscaled;
+
+    // Tessellated output of the commands, replayed instead of the
+    // commands while they and the render scale stay the same
+    NVGrecording* recording;
+    uint32_t recordingVersion;
+    uint32_t recordingContextVersion;
+    lmscalar recordingScaleX;
+    lmscalar recordingScaleY;
+    lmscalar recordingAlpha;
+    int recordingTessellation;
+
+    // Version drawn by the last render, commands are only recorded once
+    // they were drawn unchanged before
+    uint32_t renderedVersion;
+
+    // Version that couldn't be recorded, e.g. because of texture fills
+    uint32_t unrecordableVersion;
+
+    // SVGs can reload without the commands changing
+    bool hasSVG;
+
+    // Text, SVGs and texture fills draw with resources of the main nanovg
+    // context, so the commands can't be tessellated on other threads
+    bool mainThreadOnly;
+
+    // Transform and alpha of the last render, shapes changed since are
+    // tessellated under them ahead of the next one, see tessellateChanged
+    Loom2D::Matrix tessellationTransform;
+    lmscalar tessellationAlpha;
+    bool tessellationListed;
+
+    // Shapes rendered since the last tessellateChanged
+    static utArray<VectorGraphics*> renderedShapes;
+
+    // Records the shapes rendered in the last frame whose commands changed
+    // since on the VectorRenderer tessellation threads, so rendering them
+    // only submits the recording. Only runs with parallelTessellation set.
+    static void tessellateChanged();
+
+    VectorGraphics(Loom2D::Shape* shape)
     : parent(shape)
+    , changeReported(false)
     , clipX(0)
     , clipY(0)
     , clipWidth(-1)
-    , clipHeight(-1) {
+    , clipHeight(-1)
+    , version(0)
+    , recording(NULL)
+    , renderedVersion(0)
+    , unrecordableVersion(0)
+    , tessellationAlpha(0)
+    , tessellationListed(false) {
         clear();
     }
 
@@ -244,6 +307,9 @@ public:
     }
 
     ~VectorGraphics() {
+        if (tessellationListed) renderedShapes.erase(this);
+        // The hierarchy above may already be gone
+        changeReported = true;
         clear();
         lualoom_managedpointerreleased(this);
     }
@@ -251,6 +317,15 @@ public:
     bool isStyleVisible();
     void flushPath();
 
+    void deleteRecording();
+
+    // TessellationJob recording the commands under the last render
+    static void tessellateJob(void* payload);
+
+    // Draws the queue as textured quads if it only holds SVGs set to
+    // rasterize, returns false if it has to be drawn as vectors
+    bool renderRasters(Loom2D::RenderState& renderState, const Loom2D::Matrix& transform, lmscalar transformScale);
+
     void setClipRect(int x, int y, int w, int h);
     void render(Loom2D::RenderState* renderState, Loom2D::Matrix* transform);
 
@@ -24,14 +24,20 @@
 #include "loom/common/core/log.h"
 #include "loom/common/core/allocator.h"
 #include "loom/common/core/assert.h"
+#include "loom/common/core/telemetry.h"
 #include "loom/common/assets/assets.h"
 
 #include "loom/common/platform/platformIO.h"
 #include "loom/common/platform/platformFont.h"
+#include "loom/common/platform/platformJobs.h"
+#include "loom/common/platform/platformThread.h"
+#include "loom/common/platform/platformTime.h"
 
 #include "loom/graphics/gfxMath.h"
 #include "loom/graphics/gfxGraphics.h"
+#include "loom/graphics/gfxQuadRenderer.h"
 #include "loom/graphics/gfxVectorRenderer.h"
+#include "loom/graphics/gfxGPUTimer.h"
 
 #include "loom/script/runtime/lsProfiler.h"
 
@@ -49,6 +55,9 @@
 #define NANOSVG_IMPLEMENTATION
 #include "nanosvg.h"
 
+#define NANOSVGRAST_IMPLEMENTATION
+#include "nanosvgrast.h"
+
 
 static void* customAlloc(size_t size) { return lmAlloc(NULL, size); }
 static void* customRealloc(void* mem, size_t size) { return lmRealloc(NULL, mem, size); }
@@ -74,7 +83,139 @@ int VectorRenderer::frameWidth = 0;
 int VectorRenderer::frameHeight = 0;
 uint8_t VectorRenderer::quality = VectorRenderer::QUALITY_ANTIALIAS | VectorRenderer::QUALITY_STENCIL_STROKES;
 uint8_t VectorRenderer::tessellationQuality = 6;
+bool VectorRenderer::adaptiveQuality = false;
+float VectorRenderer::qualityBudget = 4.0f;
+int VectorRenderer::qualityLevel = 0;
 utHashTable<utIntHashKey, int> VectorRenderer::imageLookup;
+uint32_t VectorRenderer::contextVersion = 0;
+bool VectorRenderer::batchFills = false;
+bool VectorRenderer::parallelTessellation = false;
+TextureID VectorRenderer::solidTexture = TEXTUREINVALID;
+
+// Most jobs helping the main thread in tessellate, each records with a
+// nanovg context of the job thread running it
+#define TESSELLATION_MAX_HELPERS 7
+
+// Indexed by loom_jobs_getThreadIndex, 0 is the main thread. Each is
+// created by its thread when first needed and only used by it.
+static NVGcontext* tessellationContexts[LOOM_JOBS_MAX_WORKERS + 1];
+
+// Set while tessellate runs, the drawing functions then go to the
+// context of the calling thread instead of the main one
+static bool tessellationRunning = false;
+
+// Job of the running tessellate, payloads are claimed by incrementing next
+static VectorRenderer::TessellationJob tessellationJob = NULL;
+static void** tessellationPayloads = NULL;
+static int tessellationPayloadCount = 0;
+static volatile atomic_int_t tessellationNext = 0;
+
+static NVGcontext* context()
+{
+    if (!tessellationRunning) return nvg;
+
+    NVGcontext* ctx = tessellationContexts[loom_jobs_getThreadIndex()];
+    lmAssert(ctx != NULL, "Vector drawing from a thread not tessellating");
+    return ctx;
+}
+
+// Milliseconds of vector drawing in the current frame
+static loom_precision_timer_t passTimer = loom_startTimer();
+static double passTime = 0;
+
+// Frames in a row over the budget, or under the raise headroom of it
+static int overBudgetFrames = 0;
+static int underBudgetFrames = 0;
+
+// Lowers the quality after this many frames over the budget
+#define QUALITY_LOWER_FRAMES 3
+
+// Raises it after this many frames under the headroom fraction of the
+// budget, waiting longer so it doesn't flip back and forth
+#define QUALITY_RAISE_FRAMES 60
+#define QUALITY_RAISE_HEADROOM 0.5
+
+// Scratch space for the batched fills, reused across shapes
+static utArray<float> batchPositions;
+static utArray<unsigned int> batchColors;
+
+// Shared by all SVG rasters, keeps its scratch memory between them
+static NSVGrasterizer* svgRasterizer = NULL;
+
+// Laid out text kept across frames, so labels drawn every frame are only
+// broken into lines and glyph quads again when they change
+struct TextLayoutEntry
+{
+    NVGtextLayout *layout;
+    int lastFrame;
+};
+
+static utHashTable<utHashedString, TextLayoutEntry> textLayouts;
+static int textLayoutFrame = 0;
+
+// Layouts not drawn for this many frames are deleted
+#define TEXTLAYOUT_MAX_UNUSED_FRAMES 120
+
+static void deleteTextLayouts(bool unusedOnly)
+{
+    utArray<utHashedString> expired;
+
+    utHashTableIterator< utHashTable<utHashedString, TextLayoutEntry> > it = textLayouts.iterator();
+    while (it.hasMoreElements())
+    {
+        utHashedString key = it.peekNextKey();
+        TextLayoutEntry entry = it.peekNextValue();
+        it.next();
+
+        if (unusedOnly && textLayoutFrame - entry.lastFrame < TEXTLAYOUT_MAX_UNUSED_FRAMES) continue;
+
+        nvgDeleteTextLayout(entry.layout);
+        expired.push_back(key);
+    }
+
+    for (UTsize i = 0; i < expired.size(); i++)
+    {
+        textLayouts.remove(expired[i]);
+    }
+}
+
+// Draws the text from its cached layout, laying it out first if there is
+// none for the current text format. Width is negative for single lines.
+static void drawTextLayout(float x, float y, float width, utString *string)
+{
+    utHashedString key(utStringFormat("%d|%g|%d|%g|%g|%g|", currentTextFormat.fontId, currentTextFormat.size, currentTextFormat.distanceField, x, y, width) + *string);
+
+    TextLayoutEntry *entry = textLayouts.get(key);
+    if (entry && !nvgTextLayoutValid(nvg, entry->layout))
+    {
+        nvgDeleteTextLayout(entry->layout);
+        textLayouts.remove(key);
+        entry = NULL;
+    }
+
+    if (!entry)
+    {
+        TextLayoutEntry created;
+        created.layout = nvgCreateTextLayout(nvg, x, y, width, string->c_str(), NULL);
+        created.lastFrame = textLayoutFrame;
+
+        if (!created.layout)
+        {
+            // Doesn't fit the font atlas in one go, draw it the slow way
+            if (width < 0)
+                nvgText(nvg, x, y, string->c_str(), NULL);
+            else
+                nvgTextBox(nvg, x, y, width, string->c_str(), NULL);
+            return;
+        }
+
+        textLayouts.insert(key, created);
+        entry = textLayouts.get(key);
+    }
+
+    entry->lastFrame = textLayoutFrame;
+    nvgDrawTextLayout(nvg, entry->layout);
+}
 
 void VectorRenderer::setSize(int width, int height) {
     frameWidth = width;
@@ -85,7 +226,14 @@ void VectorRenderer::beginFrame()
 {
     LOOM_PROFILE_SCOPE(vectorBegin);
 
-    nvgTessLevelMax(nvg, tessellationQuality);
+    // Only the parts of quality the context was created with can be
+    // turned off, nanovg checks both flags for every fill and stroke
+    nvgTessLevelMax(nvg, getTessellationLevel());
+    nvgInternalParams(nvg)->edgeAntiAlias = getAntialias() ? 1 : 0;
+    GLNVGcontext* gl = (GLNVGcontext*)nvgInternalParams(nvg)->userPtr;
+    if (getStencilStrokes()) gl->flags |= NVG_STENCIL_STROKES;
+    else gl->flags &= ~NVG_STENCIL_STROKES;
+
     nvgBeginFrame(nvg, frameWidth, frameHeight, 1);
 
     deleteImages();
@@ -100,6 +248,79 @@ void VectorRenderer::beginFrame()
     //*/
 }
 
+int VectorRenderer::getTessellationLevel()
+{
+    int drop = qualityLevel >= 3 ? 2 : qualityLevel >= 1 ? 1 : 0;
+    int level = tessellationQuality - drop;
+    return level < 1 ? 1 : level;
+}
+
+bool VectorRenderer::getAntialias()
+{
+    return (quality & QUALITY_ANTIALIAS) && qualityLevel < 4;
+}
+
+bool VectorRenderer::getStencilStrokes()
+{
+    return (quality & QUALITY_STENCIL_STROKES) && qualityLevel < 2;
+}
+
+int VectorRenderer::getGeometryQuality()
+{
+    return getTessellationLevel() | (getAntialias() ? 0x100 : 0);
+}
+
+void VectorRenderer::beginPass()
+{
+    passTime = 0;
+}
+
+void VectorRenderer::endPass()
+{
+    if (!adaptiveQuality)
+    {
+        qualityLevel = 0;
+        overBudgetFrames = underBudgetFrames = 0;
+    }
+    else if (passTime > qualityBudget)
+    {
+        underBudgetFrames = 0;
+        if (++overBudgetFrames >= QUALITY_LOWER_FRAMES && qualityLevel < QUALITY_LEVEL_MAX)
+        {
+            qualityLevel++;
+            overBudgetFrames = 0;
+            lmLogDebug(gGFXVectorRendererLogGroup, "Vector drawing took %.2fms, lowered quality to level %d", passTime, qualityLevel);
+        }
+    }
+    else if (passTime < qualityBudget*QUALITY_RAISE_HEADROOM)
+    {
+        overBudgetFrames = 0;
+        if (++underBudgetFrames >= QUALITY_RAISE_FRAMES && qualityLevel > 0)
+        {
+            qualityLevel--;
+            underBudgetFrames = 0;
+            lmLogDebug(gGFXVectorRendererLogGroup, "Vector drawing took %.2fms, raised quality to level %d", passTime, qualityLevel);
+        }
+    }
+    else
+    {
+        overBudgetFrames = underBudgetFrames = 0;
+    }
+
+    Telemetry::setTickValue("gfx.vector.time", passTime);
+    Telemetry::setTickValue("gfx.vector.quality", qualityLevel);
+}
+
+VectorRenderer::PassTime::PassTime()
+{
+    start = loom_readTimerNano(passTimer);
+}
+
+VectorRenderer::PassTime::~PassTime()
+{
+    passTime += (loom_readTimerNano(passTimer) - start) / 1e6;
+}
+
 void VectorRenderer::preDraw(lmscalar a, lmscalar b, lmscalar c, lmscalar d, lmscalar e, lmscalar f) {
     LOOM_PROFILE_SCOPE(vectorPreDraw);
 
@@ -124,7 +345,16 @@ void VectorRenderer::endFrame()
 {
     LOOM_PROFILE_SCOPE(vectorEnd);
 
+    GLNVGcontext* gl = (GLNVGcontext*)nvgInternalParams(nvg)->userPtr;
+    QuadRenderer::frameStats.vectorCalls += gl->ncalls;
+    QuadRenderer::frameStats.vertices += gl->nverts;
+
+    GPUTimer::begin(GPUTimer::SECTION_VECTOR);
     nvgEndFrame(nvg);
+    GPUTimer::end(GPUTimer::SECTION_VECTOR);
+
+    textLayoutFrame++;
+    if (textLayoutFrame % TEXTLAYOUT_MAX_UNUSED_FRAMES == 0) deleteTextLayouts(true);
 }
 
 void VectorRenderer::setClipRect(int x, int y, int w, int h) {
@@ -147,11 +377,11 @@ void VectorRenderer::renderFill() {
 
 
 void VectorRenderer::strokeWidth(float size) {
-    nvgStrokeWidth(nvg, size);
+    nvgStrokeWidth(context(), size);
 }
 
 void VectorRenderer::strokeColor(float r, float g, float b, float a) {
-    nvgStrokeColor(nvg, nvgRGBAf(r, g, b, a));
+    nvgStrokeColor(context(), nvgRGBAf(r, g, b, a));
 }
 
 void VectorRenderer::strokeColor(unsigned int rgb, float a) {
@@ -167,20 +397,20 @@ void VectorRenderer::strokeColor32(unsigned int argb, float a) {
 }
 
 void VectorRenderer::lineCaps(VectorLineCaps::Enum caps) {
-    nvgLineCap(nvg, caps);
+    nvgLineCap(context(), caps);
 }
 
 void VectorRenderer::lineJoints(VectorLineJoints::Enum joints) {
-    nvgLineJoin(nvg, joints);
+    nvgLineJoin(context(), joints);
 }
 
 void VectorRenderer::lineMiterLimit(float limit) {
-    nvgMiterLimit(nvg, limit);
+    nvgMiterLimit(context(), limit);
 }
 
 void VectorRenderer::fillColor(float r, float g, float b, float a) {
-    nvgFillColor(nvg, nvgRGBAf(r, g, b, a));
-    currentTextFormatApplied = false;
+    nvgFillColor(context(), nvgRGBAf(r, g, b, a));
+    if (!tessellationRunning) currentTextFormatApplied = false;
 }
 
 void VectorRenderer::fillColor(unsigned int rgb, float a) {
@@ -197,6 +427,7 @@ void VectorRenderer::fillColor32(unsigned int argb, float a) {
 
 void VectorRenderer::fillTexture(TextureID id, Loom2D::Matrix transform, bool repeat, bool smooth, float alpha) {
 
+    Texture::markUsed(id);
     TextureInfo *tinfo = Texture::getTextureInfo(id);
 
     // Setup flags
@@ -207,6 +438,7 @@ void VectorRenderer::fillTexture(TextureID id, Loom2D::Matrix transform, bool re
         flags |= NVG_IMAGE_REPEATY;
     }
     if (smooth) flags |= NVG_IMAGE_BILINEAR;
+    if (Graphics::getPremultipliedAlpha()) flags |= NVG_IMAGE_PREMULTIPLIED;
 
     // Key based on id and flags
     utIntHashKey key = utIntHashKey(utIntHashKey(id).hash() ^ utIntHashKey(flags).hash());
@@ -241,49 +473,49 @@ void VectorRenderer::textFormat(VectorTextFormat* format, lmscalar a) {
 }
 
 void VectorRenderer::moveTo(float x, float y) {
-    nvgMoveTo(nvg, x, y);
+    nvgMoveTo(context(), x, y);
 }
 
 void VectorRenderer::lineTo(float x, float y) {
-    nvgLineTo(nvg, x, y);
+    nvgLineTo(context(), x, y);
 }
 
 void VectorRenderer::curveTo(float cx, float cy, float x, float y) {
-    nvgQuadTo(nvg, cx, cy, x, y);
+    nvgQuadTo(context(), cx, cy, x, y);
 }
 
 void VectorRenderer::cubicCurveTo(float c1x, float c1y, float c2x, float c2y, float x, float y) {
-    nvgBezierTo(nvg, c1x, c1y, c2x, c2y, x, y);
+    nvgBezierTo(context(), c1x, c1y, c2x, c2y, x, y);
 }
 
 void VectorRenderer::arcTo(float cx, float cy, float x, float y, float radius) {
-    nvgArcTo(nvg, cx, cy, x, y, radius);
+    nvgArcTo(context(), cx, cy, x, y, radius);
 }
 
 
 
 void VectorRenderer::circle(float x, float y, float radius) {
-    nvgCircle(nvg, x, y, radius);
+    nvgCircle(context(), x, y, radius);
 }
 
 void VectorRenderer::ellipse(float x, float y, float width, float height) {
-    nvgEllipse(nvg, x, y, width, height);
+    nvgEllipse(context(), x, y, width, height);
 }
 
 void VectorRenderer::rect(float x, float y, float width, float height) {
-    nvgRect(nvg, x, y, width, height);
+    nvgRect(context(), x, y, width, height);
 }
 
 void VectorRenderer::roundRect(float x, float y, float width, float height, float ellipseWidth, float ellipseHeight) {
-    nvgRoundedRectEllipse(nvg, x, y, width, height, ellipseWidth, ellipseHeight);
+    nvgRoundedRectEllipse(context(), x, y, width, height, ellipseWidth, ellipseHeight);
 }
 
 void VectorRenderer::roundRectComplex(float x, float y, float width, float height, float topLeftRadius, float topRightRadius, float bottomLeftRadius, float bottomRightRadius) {
-    nvgRoundedRectComplex(nvg, x, y, width, height, topLeftRadius, topRightRadius, bottomLeftRadius, bottomRightRadius);
+    nvgRoundedRectComplex(context(), x, y, width, height, topLeftRadius, topRightRadius, bottomLeftRadius, bottomRightRadius);
 }
 
 void VectorRenderer::arc(float x, float y, float radius, float angleFrom, float angleTo, VectorWinding::Enum direction) {
-    nvgArc(nvg, x, y, radius, angleFrom, angleTo, direction);
+    nvgArc(context(), x, y, radius, angleFrom, angleTo, direction);
 }
 
 static bool readFontFile(const char *path, void** mem, size_t* size)
@@ -420,6 +652,7 @@ static void applyTextFormat(VectorTextFormat *format, lmscalar alpha) {
     if (format->align != -1) nvgTextAlign(nvg, format->align);
     if (!isnan(format->letterSpacing)) nvgTextLetterSpacing(nvg, format->letterSpacing);
     if (!isnan(format->lineHeight)) nvgTextLineHeight(nvg, format->lineHeight);
+    if (format->distanceField != -1) nvgFontSDF(nvg, format->distanceField);
 
     currentTextFormatApplied = false;
 }
@@ -432,12 +665,12 @@ void VectorRenderer::ensureTextFormat() {
 
 void VectorRenderer::textLine(float x, float y, utString* string) {
     ensureTextFormat();
-    nvgText(nvg, x, y, string->c_str(), NULL);
+    drawTextLayout(x, y, -1, string);
 }
 
 void VectorRenderer::textBox(float x, float y, float width, utString* string) {
     ensureTextFormat();
-    nvgTextBox(nvg, x, y, width, string->c_str(), NULL);
+    drawTextLayout(x, y, width, string);
 }
 
 Loom2D::Rectangle VectorRenderer::textLineBounds(VectorTextFormat* format, float x, float y, utString* string) {
@@ -481,6 +714,194 @@ void VectorRenderer::svg(VectorSVG* image, float x, float y, float scale, float
     image->render(x, y, scale, lineThickness, alpha);
 }
 
+void VectorRenderer::beginRecording() {
+    nvgBeginRecording(context());
+}
+
+NVGrecording* VectorRenderer::endRecording() {
+    return nvgEndRecording(context());
+}
+
+// The tessellation contexts only record, nothing is ever drawn with
+// them. The font atlas they create is never used, as text isn't
+// tessellated on them, but has to be a valid image.
+static int tessellationRenderCreate(void* uptr) { return 1; }
+static int tessellationRenderCreateTexture(void* uptr, int type, int w, int h, int imageFlags, const unsigned char* data) { return 1; }
+static int tessellationRenderDeleteTexture(void* uptr, int image) { return 1; }
+static int tessellationRenderUpdateTexture(void* uptr, int image, int x, int y, int w, int h, const unsigned char* data) { return 1; }
+static int tessellationRenderGetTextureSize(void* uptr, int image, int* w, int* h) { *w = *h = 0; return 1; }
+static void tessellationRenderViewport(void* uptr, int width, int height) {}
+static void tessellationRenderCancel(void* uptr) {}
+static void tessellationRenderFlush(void* uptr) {}
+static void tessellationRenderFill(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, const float* bounds, const NVGpath* paths, int npaths) {}
+static void tessellationRenderStroke(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe, float strokeWidth, const NVGpath* paths, int npaths) {}
+static void tessellationRenderTriangles(void* uptr, NVGpaint* paint, NVGscissor* scissor, const NVGvertex* verts, int nverts, float sdf) {}
+static void tessellationRenderDelete(void* uptr) {}
+
+static NVGcontext* createTessellationContext()
+{
+    NVGparams params;
+    memset(&params, 0, sizeof(params));
+    params.edgeAntiAlias = (VectorRenderer::quality & VectorRenderer::QUALITY_ANTIALIAS) ? 1 : 0;
+    params.renderCreate = tessellationRenderCreate;
+    params.renderCreateTexture = tessellationRenderCreateTexture;
+    params.renderDeleteTexture = tessellationRenderDeleteTexture;
+    params.renderUpdateTexture = tessellationRenderUpdateTexture;
+    params.renderGetTextureSize = tessellationRenderGetTextureSize;
+    params.renderViewport = tessellationRenderViewport;
+    params.renderCancel = tessellationRenderCancel;
+    params.renderFlush = tessellationRenderFlush;
+    params.renderFill = tessellationRenderFill;
+    params.renderStroke = tessellationRenderStroke;
+    params.renderTriangles = tessellationRenderTriangles;
+    params.renderDelete = tessellationRenderDelete;
+    return nvgCreateInternal(&params);
+}
+
+// Runs the job for payloads until there are none left, each with the
+// state of a fresh frame, the same one the main context starts with
+static void tessellatePayloads(NVGcontext* ctx)
+{
+    while (true)
+    {
+        int index = atomic_increment(&tessellationNext) - 1;
+        if (index >= tessellationPayloadCount) break;
+
+        nvgTessLevelMax(ctx, VectorRenderer::getTessellationLevel());
+        nvgInternalParams(ctx)->edgeAntiAlias = VectorRenderer::getAntialias() ? 1 : 0;
+        nvgBeginFrame(ctx, VectorRenderer::frameWidth, VectorRenderer::frameHeight, 1);
+        nvgLineCap(ctx, NVG_BUTT);
+        nvgLineJoin(ctx, NVG_ROUND);
+
+        tessellationJob(tessellationPayloads[index]);
+
+        nvgCancelFrame(ctx);
+    }
+}
+
+// Tessellates on the context of the calling job thread, creating it
+// the first time
+static void tessellateOnThread()
+{
+    NVGcontext*& ctx = tessellationContexts[loom_jobs_getThreadIndex()];
+    if (ctx == NULL) ctx = createTessellationContext();
+    lmAssert(ctx != NULL, "Unable to create a tessellation context");
+
+    tessellatePayloads(ctx);
+}
+
+static void tessellationHelperJob(void *param)
+{
+    tessellateOnThread();
+}
+
+static void destroyTessellationContexts()
+{
+    for (int i = 0; i <= LOOM_JOBS_MAX_WORKERS; i++)
+    {
+        if (tessellationContexts[i] == NULL) continue;
+
+        nvgDeleteInternal(tessellationContexts[i]);
+        tessellationContexts[i] = NULL;
+    }
+}
+
+void VectorRenderer::tessellate(TessellationJob job, void** payloads, int count)
+{
+    if (count <= 0) return;
+
+    tessellationJob = job;
+    tessellationPayloads = payloads;
+    tessellationPayloadCount = count;
+    atomic_store32(&tessellationNext, 0);
+
+    // Only ask for as many helpers as there are payloads for. Helpers
+    // that start after the payloads ran out return right away, and ones
+    // that haven't started by then are run by the wait below.
+    int helpers = count - 1;
+    if (helpers > loom_jobs_getWorkerCount()) helpers = loom_jobs_getWorkerCount();
+    if (helpers > TESSELLATION_MAX_HELPERS) helpers = TESSELLATION_MAX_HELPERS;
+
+    tessellationRunning = true;
+
+    JobCounter helpersDone;
+    memset(&helpersDone, 0, sizeof(helpersDone));
+    for (int i = 0; i < helpers; i++) loom_job_run(tessellationHelperJob, NULL, &helpersDone);
+
+    tessellateOnThread();
+
+    loom_jobs_wait(&helpersDone);
+
+    tessellationRunning = false;
+    tessellationJob = NULL;
+    tessellationPayloads = NULL;
+    tessellationPayloadCount = 0;
+}
+
+void VectorRenderer::tessellationTransform(lmscalar a, lmscalar b, lmscalar c, lmscalar d, lmscalar e, lmscalar f) {
+    nvgTransform(context(), (float) a, (float) b, (float) c, (float) d, (float) e, (float) f);
+}
+
+bool VectorRenderer::recordingValid(NVGrecording* recording) {
+    return nvgRecordingValid(nvg, recording) != 0;
+}
+
+void VectorRenderer::drawRecording(NVGrecording* recording, float alpha) {
+    nvgDrawRecording(nvg, recording, alpha);
+}
+
+void VectorRenderer::deleteRecording(NVGrecording* recording) {
+    nvgDeleteRecording(recording);
+}
+
+TextureID VectorRenderer::getSolidTexture() {
+    if (solidTexture != TEXTUREINVALID && Texture::getTextureInfo(solidTexture) != NULL) return solidTexture;
+
+    // Big enough that filtering at the center never reaches neighbors in an atlas page
+    const int size = 4;
+    uint32_t pixels[size*size];
+    for (int i = 0; i < size*size; i++) pixels[i] = 0xFFFFFFFF;
+
+    TextureInfo *tinfo = Texture::load((uint8_t*)pixels, size, size);
+    solidTexture = tinfo != NULL ? tinfo->id : TEXTUREINVALID;
+    return solidTexture;
+}
+
+bool VectorRenderer::drawRecordingBatched(NVGrecording* recording, const Loom2D::Matrix& transform, float alpha) {
+    LOOM_PROFILE_SCOPE(vectorDrawBatched);
+
+    int count = nvgRecordingQuadVertexCount(recording);
+    if (count == 0) return false;
+
+    TextureID texture = getSolidTexture();
+    if (texture == TEXTUREINVALID) return false;
+
+    if ((int)batchColors.size() < count) {
+        batchPositions.resize(count*2);
+        batchColors.resize(count);
+    }
+
+    float xform[6] = { (float)transform.a, (float)transform.b, (float)transform.c, (float)transform.d, (float)transform.tx, (float)transform.ty };
+    nvgRecordingQuads(recording, xform, alpha, batchPositions.ptr(), batchColors.ptr());
+
+    // The colors are premultiplied like nanovg draws them
+    VertexPosColorTex *v = QuadRenderer::getQuadVertexMemory(count, texture, true, GL_ONE, GL_ONE_MINUS_SRC_ALPHA, ShaderProgram::getDefaultShader());
+    if (v == NULL) return false;
+
+    const float *pos = batchPositions.ptr();
+    const unsigned int *col = batchColors.ptr();
+    for (int i = 0; i < count; i++) {
+        v[i].x = pos[i*2];
+        v[i].y = pos[i*2 + 1];
+        v[i].z = 0;
+        v[i].abgr = col[i];
+        v[i].u = 0.5f;
+        v[i].v = 0.5f;
+    }
+
+    return true;
+}
+
 void VectorRenderer::deleteImages()
 {
     if (nvg != NULL)
@@ -495,6 +916,23 @@ void VectorRenderer::deleteImages()
 void VectorRenderer::destroyGraphicsResources()
 {
     deleteImages();
+
+    // Recreated with the quality of the next context
+    destroyTessellationContexts();
+
+    if (solidTexture != TEXTUREINVALID) {
+        Texture::dispose(solidTexture);
+        solidTexture = TEXTUREINVALID;
+    }
+
+    if (svgRasterizer != NULL) {
+        nsvgDeleteRasterizer(svgRasterizer);
+        svgRasterizer = NULL;
+    }
+
+    // Layouts refer to the font atlas of the context going away
+    deleteTextLayouts(false);
+
     if (nvg != NULL) {
 
 #ifdef LOOM_RENDERER_OPENGLES2
@@ -532,6 +970,8 @@ void VectorRenderer::initializeGraphicsResources()
 #endif
 
     lmAssert(nvg != NULL, "Unable to init nanovg");
+
+    contextVersion++;
     
     VectorTextFormat::restoreLoaded();
     
@@ -584,10 +1024,21 @@ void VectorTextFormat::merge(VectorTextFormat* source) {
     if (source->align != -1) align = source->align;
     if (!isnan(source->letterSpacing)) letterSpacing = source->letterSpacing;
     if (!isnan(source->lineHeight)) lineHeight = source->lineHeight;
+    if (source->distanceField != -1) distanceField = source->distanceField;
 }
 
+// Rasters are kept between these scales and sizes, anything larger is
+// drawn as vectors
+#define SVGRASTER_MIN_EXPONENT -4
+#define SVGRASTER_MAX_EXPONENT 4
+#define SVGRASTER_MAX_SIZE 1024
+
+// Rasters of other scales are dropped after going unused for this many frames
+#define SVGRASTER_MAX_UNUSED_FRAMES 120
+
 VectorSVG::VectorSVG() {
     image = NULL;
+    rasterize = false;
 }
 
 VectorSVG::~VectorSVG() {
@@ -607,12 +1058,94 @@ void VectorSVG::resetInfo() {
 }
 
 void VectorSVG::resetImage() {
+    deleteRasters();
     if (image != NULL) {
         nsvgDelete(image);
         image = NULL;
     }
 }
 
+void VectorSVG::deleteRasters() {
+    utHashTableIterator< utHashTable<utIntHashKey, Raster> > it = rasters.iterator();
+    while (it.hasMoreElements()) {
+        const Raster& raster = it.peekNextValue();
+        // Textures of an old context are gone already
+        if (raster.contextVersion == VectorRenderer::contextVersion) Texture::dispose(raster.texture);
+        it.next();
+    }
+    rasters.clear();
+}
+
+const VectorSVG::Raster* VectorSVG::getRaster(float scale) {
+    LOOM_PROFILE_SCOPE(vectorSVGRaster);
+
+    if (image == NULL || !(scale > 0)) return NULL;
+
+    int exponent = (int)ceilf(log2f(scale));
+    if (exponent < SVGRASTER_MIN_EXPONENT) exponent = SVGRASTER_MIN_EXPONENT;
+    if (exponent > SVGRASTER_MAX_EXPONENT) return NULL;
+
+    uint32_t frame = Graphics::getCurrentFrame();
+
+    // Drop rasters of scales no longer drawn at
+    utArray<int> expired;
+    utHashTableIterator< utHashTable<utIntHashKey, Raster> > it = rasters.iterator();
+    while (it.hasMoreElements()) {
+        int key = it.peekNextKey().key();
+        const Raster& raster = it.peekNextValue();
+        if (key != exponent && (raster.contextVersion != VectorRenderer::contextVersion || frame - raster.lastUsedFrame > SVGRASTER_MAX_UNUSED_FRAMES)) {
+            if (raster.contextVersion == VectorRenderer::contextVersion) Texture::dispose(raster.texture);
+            expired.push_back(key);
+        }
+        it.next();
+    }
+    for (UTsize i = 0; i < expired.size(); i++) rasters.remove(expired[i]);
+
+    Raster* raster = rasters.get(exponent);
+    if (raster != NULL && (raster->contextVersion != VectorRenderer::contextVersion || Texture::getTextureInfo(raster->texture) == NULL)) {
+        rasters.remove(exponent);
+        raster = NULL;
+    }
+
+    if (raster == NULL) {
+        float rasterScale = exponent >= 0 ? (float)(1 << exponent) : 1.0f / (float)(1 << -exponent);
+        int width = (int)ceilf(image->width*rasterScale);
+        int height = (int)ceilf(image->height*rasterScale);
+        if (width <= 0 || height <= 0 || width > SVGRASTER_MAX_SIZE || height > SVGRASTER_MAX_SIZE) return NULL;
+
+        if (svgRasterizer == NULL) svgRasterizer = nsvgCreateRasterizer();
+        if (svgRasterizer == NULL) return NULL;
+
+        uint8_t* pixels = (uint8_t*)lmAlloc(NULL, width*height*4);
+        nsvgRasterize(svgRasterizer, image, 0, 0, rasterScale, pixels, width, height, width*4);
+
+        // Drawn premultiplied like nanovg output
+        for (int i = 0; i < width*height*4; i += 4) {
+            unsigned int a = pixels[i + 3];
+            pixels[i + 0] = (uint8_t)((pixels[i + 0]*a + 127) / 255);
+            pixels[i + 1] = (uint8_t)((pixels[i + 1]*a + 127) / 255);
+            pixels[i + 2] = (uint8_t)((pixels[i + 2]*a + 127) / 255);
+        }
+
+        // Small rasters get packed into the texture atlas
+        TextureInfo* tinfo = Texture::load(pixels, (uint16_t)width, (uint16_t)height);
+        lmFree(NULL, pixels);
+        if (tinfo == NULL) return NULL;
+
+        Raster created;
+        created.texture = tinfo->id;
+        created.width = width;
+        created.height = height;
+        created.scale = rasterScale;
+        created.contextVersion = VectorRenderer::contextVersion;
+        rasters.insert(exponent, created);
+        raster = rasters.get(exponent);
+    }
+
+    raster->lastUsedFrame = frame;
+    return raster;
+}
+
 void VectorSVG::loadFile(utString path, utString units, float dpi) {
     lmLogDebug(gGFXVectorRendererLogGroup, "Loading '%s'", path.c_str());
     reset();
@@ -26,6 +26,7 @@
 #include "loom/engine/loom2d/l2dMatrix.h"
 #include "loom/common/utils/utTypes.h"
 struct NSVGimage;
+struct NVGrecording;
 
 namespace GFX
 {
@@ -112,7 +113,8 @@ public:
         size(size),
         align(VectorTextFormat::ALIGN_TOP | VectorTextFormat::ALIGN_LEFT),
         letterSpacing(NAN),
-        lineHeight(NAN)
+        lineHeight(NAN),
+        distanceField(-1)
     {};
 
     void merge(VectorTextFormat* source);
@@ -143,9 +145,26 @@ public:
     inline float getLineHeight() const { return lineHeight; }
     void setLineHeight(float t) { lineHeight = t; }
 
+    // Draws distance field glyphs that scale without being rendered
+    // again, -1 leaves it unspecified
+    int distanceField;
+    inline bool getDistanceField() const { return distanceField == 1; }
+    void setDistanceField(bool t) { distanceField = t ? 1 : 0; }
+
 };
 
 class VectorSVG {
+public:
+    // Texture the image was rasterized into, at a power of two scale
+    struct Raster {
+        TextureID texture;
+        int width;
+        int height;
+        float scale;
+        uint32_t contextVersion;
+        uint32_t lastUsedFrame;
+    };
+
 protected:
     utString path;
     utString units;
@@ -153,14 +172,30 @@ protected:
 
     NSVGimage* image;
 
+    // Rasters by the exponent of their scale
+    utHashTable<utIntHashKey, Raster> rasters;
+
     void reset();
     void resetInfo();
     void resetImage();
+    void deleteRasters();
     void parse(const char* input, const char* units, float dpi);
 public:
+    // When set, Graphics draws the image from a texture instead of
+    // tessellating it every frame, only in shapes holding nothing but SVGs
+    bool rasterize;
+
     float getWidth() const;
     float getHeight() const;
 
+    bool getRasterize() const { return rasterize; }
+    void setRasterize(bool value) { rasterize = value; }
+
+    // Returns the raster to draw the image with at the scale, rasterizing
+    // it at the next power of two scale up if there isn't one. Returns
+    // NULL if there is no image or the raster would be too large.
+    const Raster* getRaster(float scale);
+
     VectorSVG();
     ~VectorSVG();
     static void onReload(void *payload, const char *name);
@@ -180,6 +215,10 @@ private:
     static void initialize();
 
     static void deleteImages();
+
+    // Plain white texture the batched fills are drawn with
+    static TextureID solidTexture;
+    static TextureID getSolidTexture();
     static void ensureTextFormat();
 
     static void initializeGraphicsResources();
@@ -191,6 +230,38 @@ public:
     static uint8_t quality;
     static uint8_t tessellationQuality;
 
+    // When set, the quality is lowered while the vector drawing of frames
+    // takes longer than qualityBudget and raised back once there is
+    // headroom again. Each level lowers it further, first reducing the
+    // tessellation level, then turning off stencil strokes and finally
+    // antialiasing, never above what quality and tessellationQuality allow.
+    static bool adaptiveQuality;
+    static float qualityBudget;
+    static int qualityLevel;
+    static const int QUALITY_LEVEL_MAX = 4;
+
+    // What is drawn with at the current quality level
+    static int getTessellationLevel();
+    static bool getAntialias();
+    static bool getStencilStrokes();
+
+    // Changes with anything affecting the tessellated geometry, recordings
+    // made under another one are stale
+    static int getGeometryQuality();
+
+    // Bracket the vector drawing of a frame, endPass adjusts the quality
+    // level for the next one and reports it to Telemetry
+    static void beginPass();
+    static void endPass();
+
+    // Adds the time it's in scope for to the vector drawing of the frame
+    struct PassTime
+    {
+        double start;
+        PassTime();
+        ~PassTime();
+    };
+
     static void reset();
 
     static int frameWidth;
@@ -251,6 +322,44 @@ public:
 
     static void svg(VectorSVG* image, float x, float y, float scale, float lineThickness, float alpha);
 
+    // Recordings keep the tessellated output of what is drawn between
+    // beginRecording and endRecording so it can be drawn again under a
+    // new transform. endRecording returns NULL if it can't be replayed.
+    static void beginRecording();
+    static NVGrecording* endRecording();
+    static bool recordingValid(NVGrecording* recording);
+    static void drawRecording(NVGrecording* recording, float alpha);
+    static void deleteRecording(NVGrecording* recording);
+
+    // When set, recordings holding only convex solid color fills are
+    // drawn as colored quads in the QuadRenderer batch instead of in a
+    // nanovg frame of their own, see drawRecordingBatched
+    static bool batchFills;
+
+    // Submits the recording to the QuadRenderer under the transform with
+    // the alpha multiplied in, returns false if it has to be drawn by
+    // nanovg instead
+    static bool drawRecordingBatched(NVGrecording* recording, const Loom2D::Matrix& transform, float alpha);
+
+    // When set, shapes whose commands changed are tessellated ahead of
+    // the render on a pool of threads, see VectorGraphics::tessellateChanged
+    static bool parallelTessellation;
+
+    // Runs the job once for every payload, spread over the calling thread
+    // and the tessellation threads, and returns when all are done. Each
+    // thread records with a nanovg context of its own that draws nothing,
+    // the path, style and recording functions above go to it while the
+    // job runs. Text, SVGs and texture fills must not be drawn by jobs.
+    typedef void (*TessellationJob)(void* payload);
+    static void tessellate(TessellationJob job, void** payloads, int count);
+
+    // Multiplies the transform of the tessellation context of the calling job
+    static void tessellationTransform(lmscalar a, lmscalar b, lmscalar c, lmscalar d, lmscalar e, lmscalar f);
+
+    // Changes whenever the nanovg context is recreated, which makes all
+    // recordings stale
+    static uint32_t contextVersion;
+
     static float* getBounds();
 
 };
@@ -0,0 +1,218 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#include "loom/graphics/gfxVideoTexture.h"
+
+#include "loom/common/core/log.h"
+#include "loom/common/platform/platform.h"
+#include "loom/common/platform/platformVideo.h"
+#include "loom/graphics/gfxGraphics.h"
+#include "loom/graphics/gfxStateManager.h"
+
+#include "loom/script/runtime/lsProfiler.h"
+
+namespace GFX
+{
+
+lmDefineLogGroup(gGFXVideoTextureLogGroup, "gfx.video", 1, LoomLogInfo);
+
+utArray<VideoTexture::Video> VideoTexture::sVideos;
+
+bool VideoTexture::isSupported()
+{
+    return platform_videoTextureSupported() != 0;
+}
+
+VideoTexture::Video *VideoTexture::find(TextureID id)
+{
+    for (UTsize i = 0; i < sVideos.size(); i++)
+    {
+        if (sVideos[i].id == id)
+            return &sVideos[i];
+    }
+    return NULL;
+}
+
+bool VideoTexture::start(Video &video, TextureInfo &tinfo)
+{
+    Graphics::context()->glGenTextures(1, &video.name);
+
+    // Android decodes into the name as an external texture, iOS hands out
+    // names of its own once frames arrive and this one stays black until then
+    tinfo.handle = video.name;
+#if LOOM_PLATFORM == LOOM_PLATFORM_ANDROID
+    tinfo.target = GL_TEXTURE_EXTERNAL_OES;
+#else
+    tinfo.target = GL_TEXTURE_2D;
+#endif
+
+    video.handle = platform_videoTextureOpen(video.path.c_str(), video.name, video.loop ? 1 : 0);
+    if (video.handle == -1)
+        return false;
+
+    if (video.paused)
+        platform_videoTexturePause(video.handle);
+
+    return true;
+}
+
+TextureInfo *VideoTexture::open(const char *path, bool loop)
+{
+    if (!isSupported())
+    {
+        lmLogError(gGFXVideoTextureLogGroup, "Unable to play '%s', video textures aren't supported on this platform", path);
+        return NULL;
+    }
+
+    TextureInfo *tinfo = Texture::getAvailableTextureInfo(NULL);
+    if (tinfo == NULL)
+    {
+        lmLogError(gGFXVideoTextureLogGroup, "No available texture id for video '%s'", path);
+        return NULL;
+    }
+
+    tinfo->video     = true;
+    tinfo->clampOnly = true;
+    tinfo->mipmaps   = false;
+    tinfo->smoothing = TEXTUREINFO_SMOOTHING_BILINEAR;
+
+    Video video;
+    video.id     = tinfo->id;
+    video.path   = path;
+    video.loop   = loop;
+    video.paused = false;
+
+    if (!start(video, *tinfo))
+    {
+        lmLogError(gGFXVideoTextureLogGroup, "Unable to play '%s' into a texture", path);
+        Graphics::context()->glDeleteTextures(1, &video.name);
+
+        loom_mutex_lock(Texture::sTexInfoLock);
+        Texture::freeTextureInfo(tinfo);
+        loom_mutex_unlock(Texture::sTexInfoLock);
+        return NULL;
+    }
+
+    sVideos.push_back(video);
+    return tinfo;
+}
+
+void VideoTexture::pause(TextureID id)
+{
+    Video *video = find(id);
+    if (video == NULL || video->paused)
+        return;
+
+    video->paused = true;
+    if (video->handle != -1)
+        platform_videoTexturePause(video->handle);
+}
+
+void VideoTexture::resume(TextureID id)
+{
+    Video *video = find(id);
+    if (video == NULL || !video->paused)
+        return;
+
+    video->paused = false;
+    if (video->handle != -1)
+        platform_videoTextureResume(video->handle);
+}
+
+void VideoTexture::tick()
+{
+    if (sVideos.empty())
+        return;
+
+    LOOM_PROFILE_SCOPE(videoTextureTick);
+
+    LoomVideoFrame frame;
+    for (UTsize i = 0; i < sVideos.size(); i++)
+    {
+        Video &video = sVideos[i];
+        if (video.handle == -1 || !platform_videoTextureUpdate(video.handle, &frame))
+            continue;
+
+        TextureInfo *tinfo = Texture::getTextureInfo(video.id);
+        if (tinfo == NULL)
+            continue;
+
+        // The name changes with every frame on iOS, drop the cached
+        // binding so QuadRenderer binds the new one
+        GLuint handle = frame.handle != 0 ? frame.handle : video.name;
+        if (handle != tinfo->handle || frame.target != tinfo->target)
+        {
+            tinfo->handle = handle;
+            tinfo->target = frame.target;
+            Graphics_ResetGLStateCache();
+        }
+
+        memcpy(tinfo->videoRegion, frame.region, sizeof(tinfo->videoRegion));
+        tinfo->contentVersion++;
+
+        if (frame.width != tinfo->width || frame.height != tinfo->height)
+        {
+            tinfo->width  = frame.width;
+            tinfo->height = frame.height;
+
+            tinfo->updateDelegate.pushArgument(frame.width);
+            tinfo->updateDelegate.pushArgument(frame.height);
+            tinfo->updateDelegate.invoke();
+        }
+    }
+}
+
+void VideoTexture::close(TextureInfo &tinfo)
+{
+    for (UTsize i = 0; i < sVideos.size(); i++)
+    {
+        Video &video = sVideos[i];
+        if (video.id != tinfo.id)
+            continue;
+
+        if (video.handle != -1)
+            platform_videoTextureClose(video.handle);
+        Graphics::context()->glDeleteTextures(1, &video.name);
+
+        sVideos.erase(i);
+        return;
+    }
+}
+
+void VideoTexture::reset()
+{
+    // The texture names went away with the old context
+    for (UTsize i = 0; i < sVideos.size(); i++)
+    {
+        Video &video = sVideos[i];
+        TextureInfo *tinfo = Texture::getTextureInfo(video.id);
+        if (tinfo == NULL)
+            continue;
+
+        if (video.handle != -1)
+            platform_videoTextureClose(video.handle);
+
+        lmLogDebug(gGFXVideoTextureLogGroup, "Reopening video '%s'", video.path.c_str());
+        if (!start(video, *tinfo))
+            lmLogError(gGFXVideoTextureLogGroup, "Unable to reopen video '%s' after a context loss", video.path.c_str());
+    }
+}
+}
@@ -0,0 +1,88 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#pragma once
+
+#include "loom/common/utils/utString.h"
+#include "loom/graphics/gfxTexture.h"
+
+#ifndef GL_TEXTURE_EXTERNAL_OES
+#define GL_TEXTURE_EXTERNAL_OES 0x8D65
+#endif
+
+namespace GFX
+{
+
+/*
+ * Plays videos into textures, so they are drawn by QuadRenderer like any
+ * other texture instead of in a native view on top of the stage.
+ *
+ * The decoded frames are never copied: Android decodes into an external
+ * OES texture through a SurfaceTexture, iOS maps each frame to a texture
+ * through the CoreVideo texture cache. The latest frame is latched every
+ * tick. Frames can be cropped or flipped within their texture, which is
+ * drawn from a region like a packed texture, see Texture::getAtlasRegion.
+ *
+ * Video textures aren't batched with other textures and draw with the
+ * default shaders only, a custom shader is swapped for the default one
+ * on Android as it can't sample external textures.
+ */
+class VideoTexture
+{
+public:
+
+    static bool isSupported();
+
+    // Starts playing the video at path into a new texture, which is
+    // black and 0 by 0 until the first frame was decoded. Returns NULL
+    // if the platform can't play it. Dispose the texture to stop it.
+    static TextureInfo *open(const char *path, bool loop);
+
+    static void pause(TextureID id);
+    static void resume(TextureID id);
+
+    // Called by Texture
+    static void tick();
+    static void close(TextureInfo &tinfo);
+
+    // Reopens the videos from their start in the new context
+    static void reset();
+
+private:
+
+    struct Video
+    {
+        TextureID id;
+        utString  path;
+        bool      loop;
+        bool      paused;
+
+        // Handle of the platform player and the texture name made for it
+        int       handle;
+        GLuint    name;
+    };
+
+    static utArray<Video> sVideos;
+
+    static Video *find(TextureID id);
+    static bool start(Video &video, TextureInfo &tinfo);
+};
+}
@@ -73,6 +73,11 @@ void LSMapFile(const char *path, void **outPointer, long *outSize)
         return;
     }
 
+    if (!gScriptFileAllocator)
+    {
+        gScriptFileAllocator = loom_allocator_getTaggedAllocator("script.file");
+    }
+
     // TODO: external memory API, woot
     char* buffer = (char *) lmAlloc(gScriptFileAllocator, sz);
     fs.read(buffer, sz);
@@ -33,6 +33,7 @@ extern "C" {
 #include "jansson.h"
 
 #include "loom/common/utils/utTypes.h"
+#include "loom/script/compiler/lsASTArena.h"
 #include "loom/common/utils/utString.h"
 
 #include "loom/script/compiler/lsToken.h"
@@ -253,7 +254,7 @@ public:
     }
 };
 
-class ASTNode {
+class ASTNode : public ASTArenaObject {
 public:
 
     ASTType astType;
@@ -1735,6 +1736,9 @@ public:
 
     BuildInfo *buildInfo;
 
+    // holds the nodes created by the parser, the unit itself is on the heap
+    ASTArena *arena;
+
     utString filename;
 
     utArray<Statement *>       *statements;
@@ -1760,6 +1764,7 @@ public:
     CompilationUnit()
     {
         astType        = AST_COMPILEUNIT;
+        arena          = NULL;
         statements     = NULL;
         proto          = NULL;
         classDecl      = NULL;
@@ -0,0 +1,136 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _lsastarena_h
+#define _lsastarena_h
+
+#include <stddef.h>
+
+#include "loom/common/core/allocator.h"
+
+namespace LS {
+// matches the alignment of the loom heap
+#define LS_ASTARENA_ALIGNMENT    16
+
+/*
+ * Bump allocator for the AST nodes and tokens of one compilation unit.
+ * Nodes are carved out of large blocks taken from an arena proxy
+ * allocator, so parsing costs one heap allocation per block rather than
+ * per node and destroying the arena releases every block at once.
+ *
+ * Destructors are not run for arena objects, the arena is only destroyed
+ * once the unit is no longer needed.
+ */
+class ASTArena {
+    static const size_t blockSize = 64 * 1024;
+
+    // allocations bigger than this get a block of their own
+    static const size_t maxBumpSize = blockSize / 4;
+
+    loom_allocator_t *allocator;
+
+    char   *current;
+    size_t available;
+
+public:
+
+    ASTArena() : current(NULL), available(0)
+    {
+        allocator = loom_allocator_initializeArenaProxyAllocator(NULL);
+    }
+
+    ~ASTArena()
+    {
+        loom_allocator_destroy(allocator);
+    }
+
+    void *allocate(size_t size)
+    {
+        size = (size + LS_ASTARENA_ALIGNMENT - 1) & ~(size_t)(LS_ASTARENA_ALIGNMENT - 1);
+
+        if (size > maxBumpSize)
+        {
+            return lmAlloc(allocator, size);
+        }
+
+        if (size > available)
+        {
+            current   = (char *)lmAlloc(allocator, blockSize);
+            available = blockSize;
+        }
+
+        void *ptr = current;
+
+        current   += size;
+        available -= size;
+
+        return ptr;
+    }
+};
+
+/*
+ * Base for objects which may be placed in an ASTArena with
+ * new (arena) T(...). A plain new, or a NULL arena, allocates from the heap
+ * as before. Each allocation is prefixed with the arena it came from, so
+ * delete can tell heap objects, which it frees, from arena objects, which
+ * are left to the arena.
+ */
+class ASTArenaObject {
+    static const size_t headerSize = LS_ASTARENA_ALIGNMENT;
+
+public:
+
+    static void *operator new(size_t size, ASTArena *arena)
+    {
+        ASTArena **header = (ASTArena **)(arena ? arena->allocate(size + headerSize) : lmAlloc(NULL, size + headerSize));
+
+        *header = arena;
+
+        return (char *)header + headerSize;
+    }
+
+    static void *operator new(size_t size)
+    {
+        return operator new(size, (ASTArena *)NULL);
+    }
+
+    static void operator delete(void *ptr)
+    {
+        if (!ptr)
+        {
+            return;
+        }
+
+        ASTArena **header = (ASTArena **)((char *)ptr - headerSize);
+
+        if (!*header)
+        {
+            lmFree(NULL, header);
+        }
+    }
+
+    // called when a constructor throws during new (arena) T(...)
+    static void operator delete(void *ptr, ASTArena *)
+    {
+        operator delete(ptr);
+    }
+};
+}
+#endif
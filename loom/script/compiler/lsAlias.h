@@ -54,6 +54,21 @@ public:
 
         return *alias;
     }
+
+    // looks up the alias of a name by its utHashedString hash
+    static const utString& getAlias(UThash sourceHash)
+    {
+        static utString none("");
+
+        utString *alias = aliases.getByHash(sourceHash);
+
+        if (!alias)
+        {
+            return none;
+        }
+
+        return *alias;
+    }
 };
 }
 #endif
@@ -20,13 +20,16 @@
 
 #include <stdio.h>
 
+#include "loom/common/core/performance.h"
 #include "loom/common/utils/utTypes.h"
 #include "loom/common/platform/platformFile.h"
+#include "loom/common/platform/platformThread.h"
 
 #include "loom/script/common/lsError.h"
 #include "loom/script/common/lsSimpleGlob.h"
 #include "loom/script/common/lsLog.h"
 
+#include "loom/script/compiler/lsAlias.h"
 #include "loom/script/compiler/lsCompiler.h"
 #include "loom/script/compiler/lsCompilerLog.h"
 
@@ -35,45 +38,152 @@
 #include "loom/script/serialize/lsAssemblyReader.h"
 
 namespace LS {
-void ModuleBuildInfo::parseSourceFile(const utString& filename,
-                                      utString&       code)
+// sources are parsed by a few threads at once, each taking the next file
+// which has not been started yet
+struct ParseSourceJob
 {
-    LSCompiler::logVerbose("Parsing %s", filename.c_str());
+    BuildInfo *buildInfo;
 
-    Parser parser(code, filename);
+    utArray<utString>          filenames;
+    utArray<utString *>        sources;
+    utArray<CompilationUnit *> cunits;
 
-    int numErrors = LSCompilerLog::getNumErrors();
+    MutexHandle mutex;
+    int         next;
+};
 
-    CompilationUnit *cunit = parser.parseCompilationUnit(buildInfo);
+static int __stdcall parseSourceFilesThread(void *param)
+{
+    ParseSourceJob *job = (ParseSourceJob *)param;
+
+    while (true)
+    {
+        loom_mutex_lock(job->mutex);
+        int i = job->next++;
+        loom_mutex_unlock(job->mutex);
+
+        if (i >= (int)job->filenames.size())
+        {
+            break;
+        }
+
+        // the parser pulls tokens from the lexer as it goes, so this span
+        // covers both
+        LOOM_TRACE_SCOPE(lexAndParse, job->filenames[i].c_str());
+
+        Parser parser(*job->sources[i], job->filenames[i]);
+
+        job->cunits[i] = parser.parseCompilationUnit(job->buildInfo);
+    }
+
+    return 0;
+}
+
+
+void ModuleBuildInfo::parseSourceFiles()
+{
+    ParseSourceJob job;
+
+    job.buildInfo = buildInfo;
+    job.mutex     = loom_mutex_create();
+    job.next      = 0;
+
+    for (UTsize i = 0; i < sourceFiles.size(); i++)
+    {
+        LSCompiler::logVerbose("Parsing %s", sourceFiles[i].c_str());
+
+        job.filenames.push_back(sourceFiles[i]);
+        job.sources.push_back(sourceCode.get(sourceFiles[i]));
+        job.cunits.push_back(NULL);
+    }
+
+    // shared parser state is set up here, before any worker runs
+    Aliases::initialize();
+    LSCompilerLog::enableThreading();
+
+    UTsize numErrors   = LSCompilerLog::getNumErrors();
+    UTsize numWarnings = LSCompilerLog::getNumWarnings();
+
+    int numThreads = platform_getLogicalThreadCount();
+
+    if (numThreads > (int)sourceFiles.size())
+    {
+        numThreads = (int)sourceFiles.size();
+    }
+
+    // the calling thread parses as well
+    utArray<ThreadHandle> threads;
+
+    for (int i = 1; i < numThreads; i++)
+    {
+        threads.push_back(loom_thread_start(parseSourceFilesThread, &job));
+    }
+
+    parseSourceFilesThread(&job);
+
+    for (UTsize i = 0; i < threads.size(); i++)
+    {
+        loom_thread_join(threads[i]);
+    }
+
+    loom_mutex_destroy(job.mutex);
+
+    LSCompilerLog::sortByFile(numErrors, numWarnings, sourceFiles);
 
-    // if we have parse errors return
-    if (numErrors < LSCompilerLog::getNumErrors())
+    LOOM_TRACE_SCOPE(declarationVisitor, moduleName.c_str());
+
+    // declarations are visited in source order, keeping the build reproducible
+    for (UTsize i = 0; i < sourceFiles.size(); i++)
     {
-        buildInfo->parseErrors = true;
-        return;
+        const utString& filename = sourceFiles[i];
+        CompilationUnit *cunit   = job.cunits[i];
+
+        // if we have parse errors skip the unit
+        if (LSCompilerLog::hasErrors(filename, numErrors))
+        {
+            buildInfo->parseErrors = true;
+            continue;
+        }
+
+        DeclarationVisitor dv;
+        dv.visit(cunit);
+
+        for (UTsize j = 0; j < cunit->classDecls.size(); j++)
+        {
+            ClassDeclaration *cls     = cunit->classDecls.at(j);
+            utString         fullpath = cls->pkgDecl->spath + ".";
+            fullpath += cls->name->string;
+            classes.insert(utHashedString(fullpath), cls);
+        }
+
+        astCode.insert(utHashedString(filename), cunit);
     }
+}
 
-    // and visit declarations
-    DeclarationVisitor dv;
-    dv.visit(cunit);
 
-    for (UTsize i = 0; i < cunit->classDecls.size(); i++)
+void ModuleBuildInfo::freeCompilationUnits()
+{
+    for (UTsize i = 0; i < astCode.size(); i++)
     {
-        ClassDeclaration *cls     = cunit->classDecls.at(i);
-        utString         fullpath = cls->pkgDecl->spath + ".";
-        fullpath += cls->name->string;
-        classes.insert(utHashedString(fullpath), cls);
+        CompilationUnit *cunit = astCode.at(i);
+        ASTArena        *arena = cunit->arena;
+
+        delete cunit;
+        delete arena;
     }
 
-    astCode.insert(utHashedString(filename), cunit);
+    astCode.clear();
+    classes.clear();
 }
 
 
 void ModuleBuildInfo::loadSourceFile(const utString& filename, utString& code)
 {
-    utFileStream fs;
+    LOOM_TRACE_SCOPE(loadSourceFile, filename.c_str());
+
+    utMappedFileStream fs;
 
-    fs.open(filename.c_str(), utStream::SM_READ);
+    fs.open(filename.c_str());
 
     if (!fs.isOpen())
     {
@@ -84,14 +194,7 @@ void ModuleBuildInfo::loadSourceFile(const utString& filename, utString& code)
 
     if (sz)
     {
-        char *buffer = new char[sz + 1];
-
-        fs.read(buffer, sz);
-        buffer[sz] = 0;
-
-        code = buffer;
-
-        delete[] buffer;
+        code.assign((const char *)fs.ptr(), sz);
 
         fs.close();
     }
@@ -181,11 +284,11 @@ void ModuleBuildInfo::parse(json_t *json)
 
         loadSourceFile(sourceFile, code);
         sourceCode.insert(utHashedString(sourceFile), code);
-
-        // and parse
-        parseSourceFile(sourceFile, code);
     }
 
+    // and parse
+    parseSourceFiles();
+
     // if we have any compiler errors, dump them and exit
     if (LSCompilerLog::getNumErrors())
     {
@@ -285,11 +388,11 @@ BuildInfo *BuildInfo::createDefaultBuildFile()
 
         mi->loadSourceFile(sourceFile, code);
         mi->sourceCode.insert(utHashedString(sourceFile), code);
-
-        // and parse
-        mi->parseSourceFile(sourceFile, code);
     }
 
+    // and parse
+    mi->parseSourceFiles();
+
     binfo->modules.insert(utHashedString("Main"), mi);
 
     return binfo;
@@ -305,9 +408,9 @@ void BuildInfo::_parseBuildFile(const char *buildFile)
 
     buildFileDirectory = "src" + utString(platform_getFolderDelimiter());
 
-    utFileStream fs;
+    utMappedFileStream fs;
 
-    fs.open(_buildFile.c_str(), utStream::SM_READ);
+    fs.open(_buildFile.c_str());
 
     int sz = fs.size();
 
@@ -316,12 +419,8 @@ void BuildInfo::_parseBuildFile(const char *buildFile)
         LSError("Build file %s has 0 size", buildFile);
     }
 
-
-    char *buffer = new char[sz + 1];
-    fs.read(buffer, sz);
-
     json_error_t error;
-    json_t       *obuild = json_loadb(buffer, sz, 0, &error);
+    json_t       *obuild = json_loadb((const char *)fs.ptr(), sz, 0, &error);
 
     if (!obuild)
     {
@@ -372,6 +471,8 @@ void BuildInfo::_parseBuildFile(const char *buildFile)
 
 BuildInfo *BuildInfo::parseBuildFile(const char *buildFile)
 {
+    LOOM_TRACE_SCOPE(loadBuildFile, buildFile);
+
     BuildInfo *binfo = new BuildInfo();
 
     binfo->_parseBuildFile(buildFile);
@@ -380,6 +481,15 @@ BuildInfo *BuildInfo::parseBuildFile(const char *buildFile)
 }
 
 
+void BuildInfo::freeCompilationUnits()
+{
+    for (UTsize i = 0; i < modules.size(); i++)
+    {
+        modules.at(i)->freeCompilationUnits();
+    }
+}
+
+
 ClassDeclaration *BuildInfo::getClassDeclaration(const utString& className)
 {
     for (UTsize i = 0; i < modules.size(); i++)
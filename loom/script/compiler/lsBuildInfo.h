@@ -46,7 +46,10 @@ class ModuleBuildInfo {
 
     BuildInfo *buildInfo;
 
-    void parseSourceFile(const utString& filename, utString& code);
+    // parses all sourceFiles, in parallel when there are several
+    void parseSourceFiles();
+
+    void freeCompilationUnits();
     void loadSourceFile(const utString& filename, utString& code);
 
     void parse(json_t *json);
@@ -203,6 +206,10 @@ public:
     // get class declaration from fully qualified name
     ClassDeclaration *getClassDeclaration(const utString& className);
 
+    // releases the ASTs of all modules along with their arenas, once the
+    // assembly has been written
+    void freeCompilationUnits();
+
     void setDebugBuild(bool isDebug)
     {
         debugBuild = isDebug;
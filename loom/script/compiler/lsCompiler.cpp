@@ -20,14 +20,18 @@
 
 #include "loom/common/core/assert.h"
 #include "loom/common/core/log.h"
+#include "loom/common/core/performance.h"
 #include "loom/common/platform/platformFile.h"
 #include "loom/common/platform/platformIO.h"
 #include "loom/common/utils/utBase64.h"
 #include "loom/script/compiler/builders/lsAssemblyBuilder.h"
 #include "loom/script/compiler/lsCompiler.h"
+#include "loom/script/compiler/lsCompilerCache.h"
 #include "loom/script/compiler/lsTypeQualifyVisitor.h"
 #include "loom/script/compiler/lsMemberVisitor.h"
 #include "loom/script/compiler/lsTypeVisitor.h"
+#include "loom/script/compiler/lsConstantFoldVisitor.h"
+#include "loom/script/compiler/lsInlineVisitor.h"
 #include "loom/script/compiler/lsTypeCompiler.h"
 #include "loom/script/compiler/lsJitTypeCompiler.h"
 #include "loom/script/compiler/lsCompilerLog.h"
@@ -35,6 +39,7 @@
 #include "loom/script/serialize/lsBinWriter.h"
 #include "loom/script/serialize/lsBinReader.h"
 #include "loom/script/compiler/lsTypeValidator.h"
+#include "loom/script/compiler/lsTypeStripper.h"
 
 
 namespace LS {
@@ -53,6 +58,12 @@ utArray<Assembly *> LSCompiler::importedAssemblies;
 
 bool LSCompiler::dumpSymbols = false;
 
+bool LSCompiler::incremental = true;
+
+int LSCompiler::executableCompression = LOOM_BINARY_COMPRESSION_DEFAULT;
+
+bool LSCompiler::stripTypes = false;
+
 // the root build file, for linker and generating dependencies
 utString  LSCompiler::rootBuildFile;
 BuildInfo *LSCompiler::rootBuildInfo = NULL;
@@ -91,6 +102,8 @@ void LSCompiler::closeCompilerVM()
 
 void LSCompiler::compileTypes(CompilationUnit *cunit)
 {
+    LOOM_TRACE_SCOPE(byteCodeGen, cunit->filename.c_str());
+
     for (UTsize i = 0; i < cunit->classDecls.size(); i++)
     {
         ClassDeclaration *cls = cunit->classDecls.at(i);
@@ -105,7 +118,7 @@ void LSCompiler::compileTypes(CompilationUnit *cunit)
 }
 
 
-void LSCompiler::processTypes(ModuleBuildInfo *mbi)
+void LSCompiler::processTypes(ModuleBuildInfo *mbi, utArray<CompilationUnit *>& cunits)
 {
     // process the fully qualified type information
     for (UTsize j = 0; j < mbi->getNumSourceFiles(); j++)
@@ -116,6 +129,8 @@ void LSCompiler::processTypes(ModuleBuildInfo *mbi)
 
         logVerbose("Type Qualifying Visitor %s", cunit->filename.c_str());
 
+        LOOM_TRACE_SCOPE(typeQualifyVisitor, cunit->filename.c_str());
+
         TypeQualifyVisitor tqv(vm);
         tqv.visit(cunit);
     }
@@ -129,18 +144,36 @@ void LSCompiler::processTypes(ModuleBuildInfo *mbi)
 
         logVerbose("Type Member Visitor %s", cunit->filename.c_str());
 
+        LOOM_TRACE_SCOPE(memberTypeVisitor, cunit->filename.c_str());
+
         MemberTypeVisitor mtv(vm, cunit);
         mtv.processMemberTypes();
     }
 
-    // generate type info for method code
+    // sources unchanged since the last build get their bytecode from the
+    // cache and skip the remaining passes
     for (UTsize j = 0; j < mbi->getNumSourceFiles(); j++)
     {
-        utString        filename = mbi->getSourceFilename(j);
-        CompilationUnit *cunit   = mbi->getCompilationUnit(filename);
+        CompilationUnit *cunit = mbi->getCompilationUnit(mbi->getSourceFilename(j));
+
+        if (cache && cache->restore(cunit))
+        {
+            logVerbose("Restored %s from the compiler cache", cunit->filename.c_str());
+            continue;
+        }
+
+        cunits.push_back(cunit);
+    }
+
+    // generate type info for method code
+    for (UTsize j = 0; j < cunits.size(); j++)
+    {
+        CompilationUnit *cunit = cunits[j];
 
         logVerbose("Type Visitor %s", cunit->filename.c_str());
 
+        LOOM_TRACE_SCOPE(typeVisitor, cunit->filename.c_str());
+
         TypeVisitor tv(vm);
         tv.visit(cunit);
     }
@@ -153,14 +186,14 @@ void LSCompiler::processTypes(ModuleBuildInfo *mbi)
     }
 
     // validate types
-    for (UTsize j = 0; j < mbi->getNumSourceFiles(); j++)
+    for (UTsize j = 0; j < cunits.size(); j++)
     {
-        utString filename = mbi->getSourceFilename(j);
-
-        CompilationUnit *cunit = mbi->getCompilationUnit(filename);
+        CompilationUnit *cunit = cunits[j];
 
         logVerbose("Type Validating %s", cunit->filename.c_str());
 
+        LOOM_TRACE_SCOPE(typeValidator, cunit->filename.c_str());
+
         for (UTsize k = 0; k < cunit->classDecls.size(); k++)
         {
             TypeValidator tv(vm, cunit, cunit->classDecls.at(k));
@@ -174,6 +207,45 @@ void LSCompiler::processTypes(ModuleBuildInfo *mbi)
         LSCompilerLog::dump();
         exit(EXIT_FAILURE);
     }
+
+    // fold constants and drop dead branches on the validated AST, restored
+    // units were not type checked so their constants are left alone
+    ConstantFoldVisitor cfv;
+
+    for (UTsize j = 0; j < cunits.size(); j++)
+    {
+        cfv.addConstants(cunits[j]);
+    }
+
+    for (UTsize j = 0; j < cunits.size(); j++)
+    {
+        CompilationUnit *cunit = cunits[j];
+
+        logVerbose("Constant Folding %s", cunit->filename.c_str());
+
+        LOOM_TRACE_SCOPE(constantFoldVisitor, cunit->filename.c_str());
+
+        cfv.visit(cunit);
+    }
+
+    // inline small methods which can not be overridden
+    InlineVisitor iv;
+
+    for (UTsize j = 0; j < cunits.size(); j++)
+    {
+        iv.addMethods(cunits[j]);
+    }
+
+    for (UTsize j = 0; j < cunits.size(); j++)
+    {
+        CompilationUnit *cunit = cunits[j];
+
+        logVerbose("Inlining %s", cunit->filename.c_str());
+
+        LOOM_TRACE_SCOPE(inlineVisitor, cunit->filename.c_str());
+
+        iv.visit(cunit);
+    }
 }
 
 
@@ -183,13 +255,26 @@ void LSCompiler::compileModules()
     {
         ModuleBuildInfo *mbi = buildInfo->getModule(i);
 
-        processTypes(mbi);
+        LOOM_TRACE_SCOPE(compileModule, mbi->getModuleName().c_str());
+
+        utArray<CompilationUnit *> cunits;
+
+        processTypes(mbi, cunits);
+
+        for (UTsize j = 0; j < cunits.size(); j++)
+        {
+            compileTypes(cunits[j]);
+
+            if (cache)
+            {
+                cache->store(cunits[j]);
+            }
+        }
 
-        for (UTsize j = 0; j < mbi->getNumSourceFiles(); j++)
+        if (cache && (cunits.size() < mbi->getNumSourceFiles()))
         {
-            utString        filename = mbi->getSourceFilename(j);
-            CompilationUnit *cunit   = mbi->getCompilationUnit(filename);
-            compileTypes(cunit);
+            logVerbose("%s: restored %i of %i sources from the compiler cache", mbi->getModuleName().c_str(),
+                       (int)(mbi->getNumSourceFiles() - cunits.size()), (int)mbi->getNumSourceFiles());
         }
     }
 }
@@ -329,6 +414,8 @@ void LSCompiler::compileAssembly(BuildInfo *buildInfo)
 
     log("Compiling: %s", buildInfo->getAssemblyName().c_str());
 
+    LOOM_TRACE_SCOPE(compileAssembly, buildInfo->getAssemblyName().c_str());
+
     LSCompiler *compiler = new LSCompiler();
 
     // open a new (isolated) compiler VM
@@ -353,6 +440,12 @@ void LSCompiler::compileAssembly(BuildInfo *buildInfo)
     //load the type signature assembly into our VM (also loads any references)
     Assembly *assembly = compiler->vm->loadTypeAssembly(typesAssembly);
 
+    if (incremental)
+    {
+        compiler->cache = new LSCompilerCache(compiler->buildInfo, assembly);
+        compiler->cache->load();
+    }
+
     // compile all modules (types)
     compiler->compileModules();
 
@@ -428,12 +521,23 @@ void LSCompiler::compileAssembly(BuildInfo *buildInfo)
     }
 
 
+    // failed builds exit before this point and leave the previous cache intact
+    if (compiler->cache)
+    {
+        compiler->cache->save();
+        delete compiler->cache;
+        compiler->cache = NULL;
+    }
+
     compiler->vm->setCompiling(false);
 
     // shut 'er down!
     compiler->closeCompilerVM();
 
     delete compiler;
+
+    // the bytecode is written out, the AST is not needed anymore
+    buildInfo->freeCompilationUnits();
 }
 
 
@@ -665,12 +769,21 @@ void LSCompiler::linkRootAssembly(const utString& sjson)
         }
     }
 
+    if (stripTypes)
+    {
+        LOOM_TRACE_SCOPE(typeStripper, "strip");
+        TypeStripper::strip(json);
+    }
+
     json_object_set(json, "executable", json_true());
 
     utString execSource = rootBuildInfo->getOutputDir() + utString(platform_getFolderDelimiter()) + rootBuildInfo->getAssemblyName() + ".loom";
 
     // generate binary assembly for executable
-    BinWriter::writeExecutable(execSource.c_str(), json);
+    {
+        LOOM_TRACE_SCOPE(binWriter, execSource.c_str());
+        BinWriter::writeExecutable(execSource.c_str(), json, executableCompression);
+    }
 
     log("Compile successful: %s", execSource.c_str());
 }
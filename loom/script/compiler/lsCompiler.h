@@ -34,6 +34,7 @@
 
 namespace LS {
 class AssemblyBuilder;
+class LSCompilerCache;
 
 enum LSLogType
 {
@@ -53,14 +54,27 @@ private:
 
     BuildInfo *buildInfo;
 
+    // bytecode of unchanged sources from previous builds, NULL when disabled
+    LSCompilerCache *cache;
+
     static bool debugBuild;
 
+    // whether to reuse the bytecode of unchanged sources
+    static bool incremental;
+
+    // zlib level of the executable, LOOM_BINARY_COMPRESSION_STORED for mapping
+    static int executableCompression;
+
+    // whether to strip the types the executable can't reach, see TypeStripper
+    static bool stripTypes;
+
     void openCompilerVM();
     void closeCompilerVM();
 
     void compileTypes(CompilationUnit *cunit);
 
-    void processTypes(ModuleBuildInfo *mbi);
+    // runs the type passes, cunits receives the units which still need to be compiled
+    void processTypes(ModuleBuildInfo *mbi, utArray<CompilationUnit *>& cunits);
 
     void compileModules();
 
@@ -119,7 +133,7 @@ public:
 
     static loom_logGroup_t compilerLogGroup;
 
-    LSCompiler() : vm(NULL), buildInfo(NULL)
+    LSCompiler() : vm(NULL), buildInfo(NULL), cache(NULL)
     {
     }
 
@@ -146,6 +160,21 @@ public:
         dumpSymbols = dump;
     }
 
+    static void setIncremental(bool _incremental)
+    {
+        incremental = _incremental;
+    }
+
+    static void setExecutableCompression(int level)
+    {
+        executableCompression = level;
+    }
+
+    static void setStripTypes(bool strip)
+    {
+        stripTypes = strip;
+    }
+
     static void setRootBuildFile(const utString& buildFile)
     {
         rootBuildFile = buildFile;
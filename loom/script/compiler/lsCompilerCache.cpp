@@ -0,0 +1,730 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <string.h>
+
+#include "loom/common/platform/platformFile.h"
+#include "loom/common/platform/platformIO.h"
+#include "loom/common/utils/md5.h"
+#include "loom/common/utils/utFastHash.h"
+
+#include "loom/script/compiler/lsCompilerCache.h"
+#include "loom/script/compiler/lsCompiler.h"
+#include "loom/script/compiler/lsBuildInfo.h"
+#include "loom/script/compiler/lsAST.h"
+#include "loom/script/reflection/lsAssembly.h"
+#include "loom/script/reflection/lsType.h"
+#include "loom/script/reflection/lsMethodInfo.h"
+#include "loom/script/reflection/lsPropertyInfo.h"
+
+namespace LS {
+// "LSCC"
+static const int LSCOMPILERCACHE_MAGIC = 0x4343534C;
+
+// bump when the cache layout or the generated bytecode changes
+static const int LSCOMPILERCACHE_VERSION = 2;
+
+// utByteArray asserts when reading past its end, a truncated or foreign
+// cache file must just be ignored
+static bool readInt(utByteArray& bytes, int& value)
+{
+    if (bytes.bytesAvailable() < sizeof(int))
+    {
+        return false;
+    }
+
+    value = bytes.readInt();
+    return true;
+}
+
+
+static bool readString(utByteArray& bytes, utString& value)
+{
+    int length;
+
+    if (!readInt(bytes, length) || (length < 0) || ((int)bytes.bytesAvailable() < length))
+    {
+        return false;
+    }
+
+    value.assign(bytes.readUTFBytesView(length), length);
+    return true;
+}
+
+
+static bool readBoolean(utByteArray& bytes, bool& value)
+{
+    if (bytes.bytesAvailable() < sizeof(bool))
+    {
+        return false;
+    }
+
+    value = bytes.readBoolean();
+    return true;
+}
+
+
+static void writeByteCode(utByteArray& bytes, ByteCode *byteCode)
+{
+    bytes.writeBoolean(byteCode != NULL);
+
+    if (byteCode)
+    {
+        byteCode->serialize(&bytes);
+    }
+}
+
+
+static bool readByteCode(utByteArray& bytes, ByteCode *& byteCode)
+{
+    bool hasByteCode;
+
+    byteCode = NULL;
+
+    if (!readBoolean(bytes, hasByteCode))
+    {
+        return false;
+    }
+
+    if (!hasByteCode)
+    {
+        return true;
+    }
+
+    if (bytes.bytesAvailable() < sizeof(int))
+    {
+        return false;
+    }
+
+    byteCode = lmNew(NULL) ByteCode();
+    byteCode->deserialize(&bytes);
+
+    return bytes.getPosition() <= bytes.getSize();
+}
+
+
+static void updateLayout(MDFive& layout, const char *value)
+{
+    layout.update(value, (MDFive::size_type)strlen(value));
+    layout.update("|", 1);
+}
+
+
+static void updateLayout(MDFive& layout, Type *type)
+{
+    updateLayout(layout, type ? type->getFullName().c_str() : "");
+}
+
+
+LSCompilerCache::LSCompilerCache(BuildInfo *buildInfo, Assembly *assembly) :
+    buildInfo(buildInfo), assembly(assembly), dirty(false)
+{
+    const utString& outputDir = buildInfo->getOutputDir();
+
+    if (outputDir.length())
+    {
+        path = outputDir + platform_getFolderDelimiter() + buildInfo->getAssemblyName() + ".lscache";
+    }
+    else
+    {
+        path = buildInfo->getAssemblyName() + ".lscache";
+    }
+
+    for (UTsize i = 0; i < buildInfo->getNumModules(); i++)
+    {
+        ModuleBuildInfo *mbi = buildInfo->getModule(i);
+
+        for (UTsize j = 0; j < mbi->getNumSourceFiles(); j++)
+        {
+            const utString& filename = mbi->getSourceFilename(j);
+
+            sourceHashes.insert(filename, hashSource(mbi->getSourceCode(filename)));
+
+            CompilationUnit *cunit = mbi->getCompilationUnit(filename);
+
+            if (!cunit)
+            {
+                continue;
+            }
+
+            for (UTsize k = 0; k < cunit->classDecls.size(); k++)
+            {
+                ClassDeclaration *cls = cunit->classDecls[k];
+
+                typeSources.insert(cls->fullPath, filename);
+
+                Type *type = assembly->getType(cls->fullPath);
+
+                if (!type)
+                {
+                    continue;
+                }
+
+                utArray<utString> **sources = packageSources.get(type->getPackageName());
+
+                if (!sources)
+                {
+                    packageSources.insert(type->getPackageName(), new utArray<utString>());
+                    sources = packageSources.get(type->getPackageName());
+                }
+
+                if ((*sources)->find(filename) == UT_NPOS)
+                {
+                    (*sources)->push_back(filename);
+                }
+            }
+        }
+    }
+
+    MDFive layout;
+
+    updateLayout(layout, buildInfo->isDebugBuild() ? "debug" : "release");
+#ifdef LOOM_ENABLE_JIT
+    updateLayout(layout, "jit");
+#endif
+
+    utArray<Assembly *> visited;
+    appendAssemblyLayout(layout, assembly, visited);
+
+    layout.finalize();
+    layoutHash = layout.hexdigest().c_str();
+}
+
+
+LSCompilerCache::~LSCompilerCache()
+{
+    for (UTsize i = 0; i < packageSources.size(); i++)
+    {
+        delete packageSources.at(i);
+    }
+
+    for (UTsize i = 0; i < entries.size(); i++)
+    {
+        delete entries.at(i);
+    }
+}
+
+
+utString LSCompilerCache::hashSource(const utString& data)
+{
+    // Only has to notice edits, so the faster non cryptographic hash does.
+    return utFastHash::hash64String(data.c_str(), data.length());
+}
+
+
+void LSCompilerCache::appendLayout(MDFive& layout, Type *type)
+{
+    updateLayout(layout, type);
+    updateLayout(layout, type->getBaseType());
+
+    for (UTsize i = 0; i < type->getNumInterfaces(); i++)
+    {
+        updateLayout(layout, type->getInterface(i));
+    }
+
+    MemberTypes types;
+    types.constructor = true;
+    types.field       = true;
+    types.method      = true;
+    types.property    = true;
+
+    utArray<MemberInfo *> members;
+    type->findMembers(types, members, false, true);
+
+    char ordinal[64];
+
+    for (UTsize i = 0; i < members.size(); i++)
+    {
+        MemberInfo *mi = members[i];
+
+        snprintf(ordinal, sizeof(ordinal), "%d%s", mi->getOrdinal(), mi->isStatic() ? "s" : "");
+
+        updateLayout(layout, mi->getName());
+        updateLayout(layout, ordinal);
+        updateLayout(layout, mi->getType());
+
+        if (mi->isMethod() || mi->isConstructor())
+        {
+            MethodBase *method = (MethodBase *)mi;
+
+            for (int j = 0; j < method->getNumParameters(); j++)
+            {
+                updateLayout(layout, method->getParameter(j)->getParameterType());
+            }
+
+            if (mi->isMethod())
+            {
+                updateLayout(layout, ((MethodInfo *)mi)->getReturnType());
+            }
+        }
+    }
+}
+
+
+void LSCompilerCache::appendAssemblyLayout(MDFive& layout, Assembly *assembly, utArray<Assembly *>& visited)
+{
+    if (visited.find(assembly) != UT_NPOS)
+    {
+        return;
+    }
+
+    visited.push_back(assembly);
+
+    updateLayout(layout, assembly->getName().c_str());
+
+    utArray<Type *> types;
+    assembly->getTypes(types);
+
+    for (UTsize i = 0; i < types.size(); i++)
+    {
+        appendLayout(layout, types[i]);
+    }
+
+    for (int i = 0; i < assembly->getReferenceCount(); i++)
+    {
+        appendAssemblyLayout(layout, assembly->getReference(i), visited);
+    }
+}
+
+
+void LSCompilerCache::addDependency(utArray<utString>& sources, Type *type)
+{
+    if (!type)
+    {
+        return;
+    }
+
+    utString *source = typeSources.get(type->getFullName());
+
+    if (source && (sources.find(*source) == UT_NPOS))
+    {
+        sources.push_back(*source);
+    }
+}
+
+
+const utString& LSCompilerCache::getDependencyHash(CompilationUnit *cunit)
+{
+    utString *hash = dependencyHashes.get(cunit->filename);
+
+    if (hash)
+    {
+        return *hash;
+    }
+
+    utArray<utString> sources;
+    sources.push_back(cunit->filename);
+
+    for (UTsize i = 0; i < cunit->classDecls.size(); i++)
+    {
+        Type *type = cunit->classDecls[i]->type;
+
+        if (!type)
+        {
+            continue;
+        }
+
+        for (Type *base = type->getBaseType(); base; base = base->getBaseType())
+        {
+            addDependency(sources, base);
+        }
+
+        utArray<Type *> imports;
+        type->getImports(imports);
+
+        for (UTsize j = 0; j < imports.size(); j++)
+        {
+            addDependency(sources, imports[j]);
+        }
+
+        utArray<utString> **package = packageSources.get(type->getPackageName());
+
+        if (package)
+        {
+            for (UTsize j = 0; j < (*package)->size(); j++)
+            {
+                if (sources.find((*package)->at(j)) == UT_NPOS)
+                {
+                    sources.push_back((*package)->at(j));
+                }
+            }
+        }
+    }
+
+    MDFive dependencies;
+
+    updateLayout(dependencies, layoutHash.c_str());
+
+    for (UTsize i = 0; i < sources.size(); i++)
+    {
+        utString *sourceHash = sourceHashes.get(sources[i]);
+
+        updateLayout(dependencies, sources[i].c_str());
+        updateLayout(dependencies, sourceHash ? sourceHash->c_str() : "");
+    }
+
+    dependencies.finalize();
+    dependencyHashes.insert(cunit->filename, dependencies.hexdigest().c_str());
+
+    return *dependencyHashes.get(cunit->filename);
+}
+
+
+bool LSCompilerCache::isCacheable(CompilationUnit *cunit)
+{
+    for (UTsize i = 0; i < cunit->classDecls.size(); i++)
+    {
+        ClassDeclaration *cls = cunit->classDecls[i];
+
+        if (!cls->type)
+        {
+            return false;
+        }
+
+        // the type of implicitly typed fields is only inferred when the
+        // initializer is type checked, which a restored unit skips
+        for (UTsize j = 0; j < cls->varDecls.size(); j++)
+        {
+            if (cls->varDecls[j]->assignType)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+void LSCompilerCache::getFunctions(ClassDeclaration *cls, utArray<FunctionLiteral *>& functions)
+{
+    if (cls->constructor && cls->constructor->methodBase)
+    {
+        functions.push_back(cls->constructor);
+    }
+
+    for (UTsize i = 0; i < cls->functionDecls.size(); i++)
+    {
+        if (cls->functionDecls[i]->methodBase)
+        {
+            functions.push_back(cls->functionDecls[i]);
+        }
+    }
+
+    for (UTsize i = 0; i < cls->properties.size(); i++)
+    {
+        PropertyLiteral *property = cls->properties.at(i);
+
+        if (property->getter && property->getter->methodBase)
+        {
+            functions.push_back(property->getter);
+        }
+
+        if (property->setter && property->setter->methodBase)
+        {
+            functions.push_back(property->setter);
+        }
+    }
+}
+
+
+bool LSCompilerCache::restoreByteCode(CompilationUnit *cunit, utByteArray& bytes)
+{
+    bytes.setPosition(0);
+
+    // everything is read before touching the types, so a mismatch leaves
+    // the unit untouched for a regular compile
+    utArray<ByteCode *> byteCodes;
+    utArray<bool>       superCalls;
+
+    int  count;
+    bool valid = readInt(bytes, count) && (count == (int)cunit->classDecls.size());
+
+    for (UTsize i = 0; valid && i < cunit->classDecls.size(); i++)
+    {
+        ClassDeclaration *cls = cunit->classDecls[i];
+        utString         name;
+        ByteCode         *staticInitializer   = NULL;
+        ByteCode         *instanceInitializer = NULL;
+
+        valid = readString(bytes, name) && (name == cls->type->getFullName());
+
+        valid = valid && readByteCode(bytes, staticInitializer);
+        byteCodes.push_back(staticInitializer);
+
+        valid = valid && readByteCode(bytes, instanceInitializer);
+        byteCodes.push_back(instanceInitializer);
+
+        utArray<FunctionLiteral *> clsFunctions;
+        getFunctions(cls, clsFunctions);
+
+        valid = valid && readInt(bytes, count) && (count == (int)clsFunctions.size());
+
+        for (UTsize j = 0; valid && j < clsFunctions.size(); j++)
+        {
+            FunctionLiteral *function = clsFunctions[j];
+            ByteCode        *byteCode = NULL;
+            bool            hasSuperCall;
+
+            valid = readString(bytes, name) && (name == function->methodBase->getName());
+            valid = valid && readBoolean(bytes, hasSuperCall);
+            valid = valid && readByteCode(bytes, byteCode);
+
+            superCalls.push_back(valid && hasSuperCall);
+            byteCodes.push_back(byteCode);
+        }
+    }
+
+    if (!valid)
+    {
+        for (UTsize i = 0; i < byteCodes.size(); i++)
+        {
+            if (byteCodes[i])
+            {
+                lmDelete(NULL, byteCodes[i]);
+            }
+        }
+
+        return false;
+    }
+
+    UTsize current  = 0;
+    UTsize function = 0;
+
+    for (UTsize i = 0; i < cunit->classDecls.size(); i++)
+    {
+        ClassDeclaration *cls = cunit->classDecls[i];
+
+        ByteCode *staticInitializer   = byteCodes[current++];
+        ByteCode *instanceInitializer = byteCodes[current++];
+
+        if (staticInitializer)
+        {
+            cls->type->setBCStaticInitializer(staticInitializer);
+        }
+
+        if (instanceInitializer)
+        {
+            cls->type->setBCInstanceInitializer(instanceInitializer);
+        }
+
+        utArray<FunctionLiteral *> clsFunctions;
+        getFunctions(cls, clsFunctions);
+
+        for (UTsize j = 0; j < clsFunctions.size(); j++, current++, function++)
+        {
+            clsFunctions[j]->hasSuperCall = superCalls[function];
+
+            if (byteCodes[current])
+            {
+                clsFunctions[j]->methodBase->setByteCode(byteCodes[current]);
+            }
+        }
+    }
+
+    return true;
+}
+
+
+void LSCompilerCache::load()
+{
+    utByteArray bytes;
+
+    if (!utByteArray::tryReadToArray(path, bytes, false))
+    {
+        return;
+    }
+
+    int magic, version, count;
+
+    if (!readInt(bytes, magic) || (magic != LSCOMPILERCACHE_MAGIC) ||
+        !readInt(bytes, version) || (version != LSCOMPILERCACHE_VERSION) ||
+        !readInt(bytes, count))
+    {
+        LSCompiler::logVerbose("Ignoring incompatible compiler cache %s", path.c_str());
+        return;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        utString filename;
+        Entry    *entry = new Entry();
+        int      length;
+
+        if (!readString(bytes, filename) || !readString(bytes, entry->sourceHash) ||
+            !readString(bytes, entry->dependencyHash) || !readInt(bytes, length) ||
+            (length < 0) || ((int)bytes.bytesAvailable() < length))
+        {
+            LSCompiler::logVerbose("Ignoring truncated compiler cache %s", path.c_str());
+            delete entry;
+            return;
+        }
+
+        if (length)
+        {
+            entry->byteCode.allocateAndCopy((unsigned char *)bytes.getDataPtr() + bytes.getPosition(), length);
+            bytes.setPosition(bytes.getPosition() + length);
+        }
+
+        Entry **existing = entries.get(filename);
+
+        if (existing)
+        {
+            delete *existing;
+            *existing = entry;
+        }
+        else
+        {
+            entries.insert(filename, entry);
+        }
+    }
+}
+
+
+void LSCompilerCache::save()
+{
+    if (!dirty)
+    {
+        return;
+    }
+
+    int count = 0;
+
+    for (UTsize i = 0; i < entries.size(); i++)
+    {
+        if (sourceHashes.get(entries.keyAt(i)))
+        {
+            count++;
+        }
+    }
+
+    utByteArray bytes;
+
+    bytes.writeInt(LSCOMPILERCACHE_MAGIC);
+    bytes.writeInt(LSCOMPILERCACHE_VERSION);
+    bytes.writeInt(count);
+
+    for (UTsize i = 0; i < entries.size(); i++)
+    {
+        // drop entries of sources which are no longer part of the build
+        if (!sourceHashes.get(entries.keyAt(i)))
+        {
+            continue;
+        }
+
+        Entry *entry = entries.at(i);
+
+        bytes.writeString(entries.keyAt(i).str().c_str());
+        bytes.writeString(entry->sourceHash.c_str());
+        bytes.writeString(entry->dependencyHash.c_str());
+        bytes.writeInt((int)entry->byteCode.getSize());
+
+        if (entry->byteCode.getSize())
+        {
+            bytes.writeBytes(&entry->byteCode);
+        }
+    }
+
+    if (platform_writeFile(path.c_str(), bytes.getDataPtr(), (int)bytes.getSize()) != 0)
+    {
+        LSCompiler::log("Unable to write compiler cache %s", path.c_str());
+        return;
+    }
+
+    dirty = false;
+}
+
+
+bool LSCompilerCache::restore(CompilationUnit *cunit)
+{
+    Entry **entry = entries.get(cunit->filename);
+
+    if (!entry || !isCacheable(cunit))
+    {
+        return false;
+    }
+
+    utString *sourceHash = sourceHashes.get(cunit->filename);
+
+    if (!sourceHash || ((*entry)->sourceHash != *sourceHash))
+    {
+        return false;
+    }
+
+    if ((*entry)->dependencyHash != getDependencyHash(cunit))
+    {
+        return false;
+    }
+
+    return restoreByteCode(cunit, (*entry)->byteCode);
+}
+
+
+void LSCompilerCache::store(CompilationUnit *cunit)
+{
+    utString *sourceHash = sourceHashes.get(cunit->filename);
+
+    if (!sourceHash || !isCacheable(cunit))
+    {
+        return;
+    }
+
+    utByteArray bytes;
+
+    bytes.writeInt((int)cunit->classDecls.size());
+
+    for (UTsize i = 0; i < cunit->classDecls.size(); i++)
+    {
+        ClassDeclaration *cls = cunit->classDecls[i];
+
+        bytes.writeString(cls->type->getFullName().c_str());
+        writeByteCode(bytes, cls->type->getBCStaticInitializer());
+        writeByteCode(bytes, cls->type->getBCInstanceInitializer());
+
+        utArray<FunctionLiteral *> functions;
+        getFunctions(cls, functions);
+
+        bytes.writeInt((int)functions.size());
+
+        for (UTsize j = 0; j < functions.size(); j++)
+        {
+            FunctionLiteral *function = functions[j];
+
+            bytes.writeString(function->methodBase->getName());
+            bytes.writeBoolean(function->hasSuperCall);
+            writeByteCode(bytes, function->methodBase->getByteCode());
+        }
+    }
+
+    Entry **existing = entries.get(cunit->filename);
+    Entry *entry     = existing ? *existing : new Entry();
+
+    if (!existing)
+    {
+        entries.insert(cunit->filename, entry);
+    }
+
+    entry->sourceHash     = *sourceHash;
+    entry->dependencyHash = getDependencyHash(cunit);
+    entry->byteCode.allocateAndCopy(bytes.getDataPtr(), (int)bytes.getSize());
+
+    dirty = true;
+}
+}
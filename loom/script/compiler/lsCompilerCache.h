@@ -0,0 +1,119 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _lscompilercache_h
+#define _lscompilercache_h
+
+#include "loom/common/utils/utByteArray.h"
+#include "loom/common/utils/utTypes.h"
+#include "loom/common/utils/utString.h"
+
+class MDFive;
+
+namespace LS {
+class Assembly;
+class BuildInfo;
+class ClassDeclaration;
+class CompilationUnit;
+class FunctionLiteral;
+class Type;
+
+/*
+ * On disk cache of the bytecode compiled for each source file of an
+ * assembly, stored next to the assembly as <name>.lscache. Unchanged files
+ * are restored from it instead of being type checked and compiled again.
+ *
+ * An entry is reused when the MD5 of its source matches and so does the
+ * hash of its dependencies: the compiler settings, the member layout of all
+ * types visible to the assembly (which ordinals and signatures are compiled
+ * against) and the sources of the types it extends, imports or shares a
+ * package with, whose constants and small methods may be inlined into it.
+ *
+ * Sources are still parsed, the type signatures of the assembly are built
+ * from the AST.
+ */
+class LSCompilerCache {
+    struct Entry
+    {
+        utString    sourceHash;
+        utString    dependencyHash;
+        utByteArray byteCode;
+    };
+
+    BuildInfo *buildInfo;
+    Assembly  *assembly;
+
+    utString path;
+
+    // settings and type layout every entry depends on
+    utString layoutHash;
+
+    // source filename -> MD5 of the source
+    utHashTable<utHashedString, utString> sourceHashes;
+
+    // type full name -> source filename, for the types of the build
+    utHashTable<utHashedString, utString> typeSources;
+
+    // package name -> source filenames declaring types in it
+    utHashTable<utHashedString, utArray<utString> *> packageSources;
+
+    // source filename -> dependency hash of the current build
+    utHashTable<utHashedString, utString> dependencyHashes;
+
+    // source filename -> cached entry
+    utHashTable<utHashedString, Entry *> entries;
+
+    bool dirty;
+
+    static utString hashSource(const utString& data);
+
+    static void appendLayout(MDFive& layout, Type *type);
+    void appendAssemblyLayout(MDFive& layout, Assembly *assembly, utArray<Assembly *>& visited);
+
+    void addDependency(utArray<utString>& sources, Type *type);
+
+    const utString& getDependencyHash(CompilationUnit *cunit);
+
+    static bool isCacheable(CompilationUnit *cunit);
+
+    static void getFunctions(ClassDeclaration *cls, utArray<FunctionLiteral *>& functions);
+
+    bool restoreByteCode(CompilationUnit *cunit, utByteArray& bytes);
+
+public:
+
+    LSCompilerCache(BuildInfo *buildInfo, Assembly *assembly);
+    ~LSCompilerCache();
+
+    // reads the cache of the assembly, if any
+    void load();
+
+    // writes out the entries of the sources in the build
+    void save();
+
+    // restores the bytecode of cunit when its entry is up to date, in which
+    // case it needs no further processing
+    bool restore(CompilationUnit *cunit);
+
+    // records the bytecode compiled for cunit
+    void store(CompilationUnit *cunit);
+};
+}
+#endif
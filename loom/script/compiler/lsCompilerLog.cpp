@@ -25,6 +25,7 @@
 namespace LS {
 utArray<LSCompilerLog::Message> LSCompilerLog::errors;
 utArray<LSCompilerLog::Message> LSCompilerLog::warnings;
+MutexHandle LSCompilerLog::mutex = NULL;
 
 void LSCompilerLog::logWarning(utString filename, int line, utString message,
                                utString subType)
@@ -35,10 +36,21 @@ void LSCompilerLog::logWarning(utString filename, int line, utString message,
     msg.line     = line;
     msg.message  = message;
     msg.subType  = subType;
+
+    if (mutex)
+    {
+        loom_mutex_lock(mutex);
+    }
+
     if (warnings.find(msg) == UT_NPOS)
     {
         warnings.push_back(msg);
     }
+
+    if (mutex)
+    {
+        loom_mutex_unlock(mutex);
+    }
 }
 
 
@@ -51,10 +63,21 @@ void LSCompilerLog::logError(utString filename, int line, utString message,
     msg.line     = line;
     msg.message  = message;
     msg.subType  = subType;
+
+    if (mutex)
+    {
+        loom_mutex_lock(mutex);
+    }
+
     if (errors.find(msg) == UT_NPOS)
     {
         errors.push_back(msg);
     }
+
+    if (mutex)
+    {
+        loom_mutex_unlock(mutex);
+    }
 }
 
 
@@ -80,4 +103,72 @@ void LSCompilerLog::dump(bool errorsOnly)
         dump(errors[i]);
     }
 }
+
+
+void LSCompilerLog::enableThreading()
+{
+    if (!mutex)
+    {
+        mutex = loom_mutex_create();
+    }
+}
+
+
+void LSCompilerLog::sortByFile(utArray<Message>& messages, UTsize first, const utArray<utString>& filenames)
+{
+    utArray<Message> sorted;
+    utArray<bool>    moved;
+
+    for (UTsize j = first; j < messages.size(); j++)
+    {
+        moved.push_back(false);
+    }
+
+    for (UTsize i = 0; i < filenames.size(); i++)
+    {
+        for (UTsize j = first; j < messages.size(); j++)
+        {
+            if (messages[j].filename == filenames[i])
+            {
+                sorted.push_back(messages[j]);
+                moved[j - first] = true;
+            }
+        }
+    }
+
+    // messages not attributed to any of the files keep their place at the end
+    for (UTsize j = first; j < messages.size(); j++)
+    {
+        if (!moved[j - first])
+        {
+            sorted.push_back(messages[j]);
+        }
+    }
+
+    for (UTsize j = 0; j < sorted.size(); j++)
+    {
+        messages[first + j] = sorted[j];
+    }
+}
+
+
+void LSCompilerLog::sortByFile(UTsize firstError, UTsize firstWarning, const utArray<utString>& filenames)
+{
+    sortByFile(errors, firstError, filenames);
+    sortByFile(warnings, firstWarning, filenames);
+}
+
+
+bool LSCompilerLog::hasErrors(const utString& filename, UTsize firstError)
+{
+    for (UTsize i = firstError; i < errors.size(); i++)
+    {
+        if (errors[i].filename == filename)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
 }
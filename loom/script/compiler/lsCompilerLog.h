@@ -23,6 +23,7 @@
 
 #include "loom/common/utils/utTypes.h"
 #include "loom/common/utils/utString.h"
+#include "loom/common/platform/platformThread.h"
 
 namespace LS {
 class LSCompilerLog {
@@ -48,8 +49,13 @@ private:
     static utArray<Message> errors;
     static utArray<Message> warnings;
 
+    // guards the message lists once sources are parsed on worker threads
+    static MutexHandle mutex;
+
     static void dump(const Message& msg, bool warning = false);
 
+    static void sortByFile(utArray<Message>& messages, UTsize first, const utArray<utString>& filenames);
+
 public:
 
     static void logWarning(utString filename, int line, utString message, utString subType = "");
@@ -58,6 +64,17 @@ public:
 
     static void dump(bool errorsOnly = false);
 
+    // must be called on the main thread before logging from other threads
+    static void enableThreading();
+
+    // orders the messages logged from first on by the position of their file
+    // in filenames, keeping the order within a file, so the log does not
+    // depend on which thread got to a file first
+    static void sortByFile(UTsize firstError, UTsize firstWarning, const utArray<utString>& filenames);
+
+    // whether an error was logged for filename from firstError on
+    static bool hasErrors(const utString& filename, UTsize firstError);
+
     static void clear()
     {
         errors.clear();
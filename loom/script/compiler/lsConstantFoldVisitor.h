@@ -0,0 +1,539 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _lsconstantfoldvisitor_h
+#define _lsconstantfoldvisitor_h
+
+#include "loom/common/utils/utTypes.h"
+#include "loom/common/utils/utString.h"
+
+#include "loom/script/compiler/lsToken.h"
+#include "loom/script/compiler/lsTraversalVisitor.h"
+
+#include "loom/script/reflection/lsFieldInfo.h"
+
+namespace LS {
+
+/*
+ * Finds the local variable declarations and function literals of a
+ * statement or expression, dead code declaring either must be kept as the
+ * compilers allocate locals and closures by declaration
+ */
+class DeclarationFinder : public TraversalVisitor {
+public:
+
+    bool found;
+
+    DeclarationFinder() : TraversalVisitor(), found(false)
+    {
+        visitor = this;
+    }
+
+    static bool declares(Statement *statement)
+    {
+        DeclarationFinder finder;
+
+        finder.visitStatement(statement);
+
+        return finder.found;
+    }
+
+    static bool declares(Expression *expression)
+    {
+        DeclarationFinder finder;
+
+        finder.visitExpression(expression);
+
+        return finder.found;
+    }
+
+    Expression *visit(VariableDeclaration *variableDeclaration)
+    {
+        found = true;
+        return variableDeclaration;
+    }
+
+    Expression *visit(FunctionLiteral *functionLiteral)
+    {
+        found = true;
+        return functionLiteral;
+    }
+};
+
+/*
+ * Runs on the typed and validated AST before bytecode generation. Inlines
+ * references to static const fields of the module with a literal
+ * initializer, folds operators on number, boolean and string literals and
+ * removes if/while statements and conditional expressions whose condition
+ * folded to a boolean literal.
+ */
+class ConstantFoldVisitor : public TraversalVisitor {
+private:
+
+    Tokens *tok;
+
+    // FieldInfo -> declaration of the static consts in the module
+    utHashTable<utPointerHashKey, VariableDeclaration *> constants;
+
+    // const initializers being folded, guards against cyclic consts
+    utArray<VariableDeclaration *> folding;
+
+    static bool isLiteral(Expression *expression)
+    {
+        if (!expression)
+        {
+            return false;
+        }
+
+        // string literals with member info are member names
+        return expression->astType == AST_NUMBERLITERAL ||
+               expression->astType == AST_BOOLEANLITERAL ||
+               (expression->astType == AST_STRINGLITERAL && !expression->memberInfo);
+    }
+
+    // a new literal with the value of literal in place of site
+    static Expression *cloneLiteral(Expression *literal, Expression *site)
+    {
+        Expression *clone = NULL;
+
+        if (literal->astType == AST_NUMBERLITERAL)
+        {
+            NumberLiteral *number = new NumberLiteral(((NumberLiteral *)literal)->value);
+            number->svalue = ((NumberLiteral *)literal)->svalue;
+            clone          = number;
+        }
+        else if (literal->astType == AST_BOOLEANLITERAL)
+        {
+            clone = new BooleanLiteral(((BooleanLiteral *)literal)->value);
+        }
+        else
+        {
+            clone = new StringLiteral(((StringLiteral *)literal)->string);
+        }
+
+        clone->type              = site->type ? site->type : literal->type;
+        clone->lineNumber        = site->lineNumber;
+        clone->primaryExpression = site->primaryExpression;
+
+        return clone;
+    }
+
+    static Expression *numberLiteral(double value, Expression *site)
+    {
+        char svalue[64];
+
+        snprintf(svalue, sizeof(svalue), "%.17g", value);
+
+        NumberLiteral *literal = new NumberLiteral(value);
+        literal->svalue            = svalue;
+        literal->type              = site->type;
+        literal->lineNumber        = site->lineNumber;
+        literal->primaryExpression = site->primaryExpression;
+
+        return literal;
+    }
+
+    static Expression *booleanLiteral(bool value, Expression *site)
+    {
+        BooleanLiteral *literal = new BooleanLiteral(value);
+
+        literal->type              = site->type;
+        literal->lineNumber        = site->lineNumber;
+        literal->primaryExpression = site->primaryExpression;
+
+        return literal;
+    }
+
+    static Statement *emptyStatement(Statement *site)
+    {
+        EmptyStatement *empty = new EmptyStatement();
+
+        empty->lineNumber = site->lineNumber;
+
+        return empty;
+    }
+
+    // the literal initializer of a static const field, or NULL
+    Expression *getConstant(MemberInfo *memberInfo)
+    {
+        if (!memberInfo || !memberInfo->isField())
+        {
+            return NULL;
+        }
+
+        FieldInfo *field = (FieldInfo *)memberInfo;
+
+        if (!field->isStatic() || !field->isConst())
+        {
+            return NULL;
+        }
+
+        VariableDeclaration **ovd = constants.get(field);
+
+        if (!ovd)
+        {
+            return NULL;
+        }
+
+        VariableDeclaration *vd = *ovd;
+
+        // the initializer may itself reference other consts
+        if (!isLiteral(vd->initializer) && (folding.find(vd) == UT_NPOS))
+        {
+            folding.push_back(vd);
+            vd->initializer = visitExpression(vd->initializer);
+            folding.pop_back();
+        }
+
+        return isLiteral(vd->initializer) ? vd->initializer : NULL;
+    }
+
+    Expression *foldNumbers(BinaryOperatorExpression *expression, double left, double right)
+    {
+        const Token *op = expression->op;
+
+        if (op == &tok->OPERATOR_PLUS)
+        {
+            return numberLiteral(left + right, expression);
+        }
+
+        if (op == &tok->OPERATOR_MINUS)
+        {
+            return numberLiteral(left - right, expression);
+        }
+
+        if (op == &tok->OPERATOR_MULTIPLY)
+        {
+            return numberLiteral(left * right, expression);
+        }
+
+        if (op == &tok->OPERATOR_DIVIDE)
+        {
+            return numberLiteral(left / right, expression);
+        }
+
+        if (op == &tok->OPERATOR_EQUALEQUAL)
+        {
+            return booleanLiteral(left == right, expression);
+        }
+
+        if (op == &tok->OPERATOR_NOTEQUAL)
+        {
+            return booleanLiteral(left != right, expression);
+        }
+
+        if (op == &tok->OPERATOR_LESSTHAN)
+        {
+            return booleanLiteral(left < right, expression);
+        }
+
+        if (op == &tok->OPERATOR_LESSTHANOREQUAL)
+        {
+            return booleanLiteral(left <= right, expression);
+        }
+
+        if (op == &tok->OPERATOR_GREATERTHAN)
+        {
+            return booleanLiteral(left > right, expression);
+        }
+
+        if (op == &tok->OPERATOR_GREATERTHANOREQUAL)
+        {
+            return booleanLiteral(left >= right, expression);
+        }
+
+        return expression;
+    }
+
+    // folds a && b and a || b where a is a boolean literal and the
+    // result does not depend on b, or both are boolean literals
+    Expression *foldLogical(BinaryOperatorExpression *expression, bool isAnd)
+    {
+        Expression *left  = expression->leftExpression;
+        Expression *right = expression->rightExpression;
+
+        if (left->astType != AST_BOOLEANLITERAL)
+        {
+            return expression;
+        }
+
+        bool value = ((BooleanLiteral *)left)->value;
+
+        // false && b, true || b
+        if ((value != isAnd) && !DeclarationFinder::declares(right))
+        {
+            return booleanLiteral(value, expression);
+        }
+
+        if (right->astType == AST_BOOLEANLITERAL)
+        {
+            return booleanLiteral(((BooleanLiteral *)right)->value, expression);
+        }
+
+        return expression;
+    }
+
+public:
+
+    ConstantFoldVisitor() : TraversalVisitor()
+    {
+        visitor = this;
+        tok     = Tokens::getSingletonPtr();
+    }
+
+    // registers the static consts declared in cunit, call for every
+    // compilation unit of the module before visiting any of them
+    void addConstants(CompilationUnit *cunit)
+    {
+        for (UTsize i = 0; i < cunit->classDecls.size(); i++)
+        {
+            ClassDeclaration *cls = cunit->classDecls.at(i);
+
+            if (!cls->type)
+            {
+                continue;
+            }
+
+            for (UTsize j = 0; j < cls->varDecls.size(); j++)
+            {
+                VariableDeclaration *vd = cls->varDecls.at(j);
+
+                if (!vd->isStatic || !vd->isConst || vd->isNative || !vd->initializer)
+                {
+                    continue;
+                }
+
+                FieldInfo *field = cls->type->findFieldInfoByName(vd->identifier->string.c_str());
+
+                if (field)
+                {
+                    constants.insert(field, vd);
+                }
+            }
+        }
+    }
+
+    CompilationUnit *visit(CompilationUnit *cunit)
+    {
+        this->cunit = cunit;
+        return TraversalVisitor::visit(cunit);
+    }
+
+    //
+    // statements
+    //
+
+    Statement *visit(IfStatement *ifStatement)
+    {
+        ifStatement = (IfStatement *)TraversalVisitor::visit(ifStatement);
+
+        if (ifStatement->expression->astType != AST_BOOLEANLITERAL)
+        {
+            return ifStatement;
+        }
+
+        bool      value = ((BooleanLiteral *)ifStatement->expression)->value;
+        Statement *live = value ? ifStatement->trueStatement : ifStatement->falseStatement;
+        Statement *dead = value ? ifStatement->falseStatement : ifStatement->trueStatement;
+
+        if (dead && DeclarationFinder::declares(dead))
+        {
+            return ifStatement;
+        }
+
+        return live ? live : emptyStatement(ifStatement);
+    }
+
+    Statement *visit(WhileStatement *whileStatement)
+    {
+        whileStatement = (WhileStatement *)TraversalVisitor::visit(whileStatement);
+
+        Expression *condition = whileStatement->expression;
+
+        if ((condition->astType != AST_BOOLEANLITERAL) || ((BooleanLiteral *)condition)->value)
+        {
+            return whileStatement;
+        }
+
+        if (DeclarationFinder::declares(whileStatement->statement))
+        {
+            return whileStatement;
+        }
+
+        return emptyStatement(whileStatement);
+    }
+
+    //
+    // expressions
+    //
+
+    Expression *visit(VariableDeclaration *variableDeclaration)
+    {
+        // the declared identifier carries the member info of fields, it is
+        // not a reference to inline
+        variableDeclaration->initializer = visitExpression(variableDeclaration->initializer);
+
+        lastVisited = variableDeclaration;
+
+        return variableDeclaration;
+    }
+
+    Expression *visit(Identifier *identifier)
+    {
+        lastVisited = identifier;
+
+        if (identifier->assignment || identifier->typeExpression || identifier->superAccess)
+        {
+            return identifier;
+        }
+
+        Expression *constant = getConstant(identifier->memberInfo);
+
+        return constant ? cloneLiteral(constant, identifier) : identifier;
+    }
+
+    Expression *visit(PropertyExpression *expression)
+    {
+        lastVisited = expression;
+
+        expression->leftExpression = visitExpression(expression->leftExpression);
+
+        // the right hand side of foo.bar names the member
+        if (expression->arrayAccess)
+        {
+            expression->rightExpression = visitExpression(expression->rightExpression);
+            return expression;
+        }
+
+        if (!expression->staticAccess || expression->assignment)
+        {
+            return expression;
+        }
+
+        Expression *constant = getConstant(expression->memberInfo);
+
+        return constant ? cloneLiteral(constant, expression) : expression;
+    }
+
+    Expression *visit(BinaryOperatorExpression *expression)
+    {
+        lastVisited = expression;
+        visitBinaryExpression(expression);
+
+        Expression *left  = expression->leftExpression;
+        Expression *right = expression->rightExpression;
+
+        if ((left->astType == AST_NUMBERLITERAL) && (right->astType == AST_NUMBERLITERAL))
+        {
+            return foldNumbers(expression, ((NumberLiteral *)left)->value, ((NumberLiteral *)right)->value);
+        }
+
+        if ((left->astType == AST_BOOLEANLITERAL) && (right->astType == AST_BOOLEANLITERAL))
+        {
+            bool lvalue = ((BooleanLiteral *)left)->value;
+            bool rvalue = ((BooleanLiteral *)right)->value;
+
+            if (expression->op == &tok->OPERATOR_EQUALEQUAL)
+            {
+                return booleanLiteral(lvalue == rvalue, expression);
+            }
+
+            if (expression->op == &tok->OPERATOR_NOTEQUAL)
+            {
+                return booleanLiteral(lvalue != rvalue, expression);
+            }
+        }
+
+        if ((expression->op == &tok->OPERATOR_PLUS) && isLiteral(left) && isLiteral(right) &&
+            (left->astType == AST_STRINGLITERAL) && (right->astType == AST_STRINGLITERAL))
+        {
+            StringLiteral *literal = new StringLiteral(((StringLiteral *)left)->string + ((StringLiteral *)right)->string);
+            literal->type              = expression->type;
+            literal->lineNumber        = expression->lineNumber;
+            literal->primaryExpression = expression->primaryExpression;
+            return literal;
+        }
+
+        return expression;
+    }
+
+    Expression *visit(LogicalAndExpression *expression)
+    {
+        lastVisited = expression;
+        visitBinaryExpression(expression);
+
+        return foldLogical(expression, true);
+    }
+
+    Expression *visit(LogicalOrExpression *expression)
+    {
+        lastVisited = expression;
+        visitBinaryExpression(expression);
+
+        return foldLogical(expression, false);
+    }
+
+    Expression *visit(UnaryOperatorExpression *expression)
+    {
+        lastVisited = expression;
+        visitUnaryExpression(expression);
+
+        Expression *sub = expression->subExpression;
+        int        c    = expression->op->value.str()[0];
+
+        if ((c == '!') && (sub->astType == AST_BOOLEANLITERAL))
+        {
+            return booleanLiteral(!((BooleanLiteral *)sub)->value, expression);
+        }
+
+        if ((c == '-') && (sub->astType == AST_NUMBERLITERAL))
+        {
+            return numberLiteral(-((NumberLiteral *)sub)->value, expression);
+        }
+
+        return expression;
+    }
+
+    Expression *visit(ConditionalExpression *expression)
+    {
+        expression = (ConditionalExpression *)TraversalVisitor::visit(expression);
+
+        if (expression->expression->astType != AST_BOOLEANLITERAL)
+        {
+            return expression;
+        }
+
+        bool       value = ((BooleanLiteral *)expression->expression)->value;
+        Expression *live = value ? expression->trueExpression : expression->falseExpression;
+        Expression *dead = value ? expression->falseExpression : expression->trueExpression;
+
+        // keep the conditional where the branch alone would change the type
+        if ((live->type != expression->type) || DeclarationFinder::declares(dead))
+        {
+            return expression;
+        }
+
+        live->primaryExpression = expression->primaryExpression;
+
+        return live;
+    }
+};
+}
+#endif
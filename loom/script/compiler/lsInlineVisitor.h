@@ -0,0 +1,923 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _lsinlinevisitor_h
+#define _lsinlinevisitor_h
+
+#include "loom/common/utils/utTypes.h"
+#include "loom/common/utils/utString.h"
+
+#include "loom/script/compiler/lsToken.h"
+#include "loom/script/compiler/lsTraversalVisitor.h"
+
+#include "loom/script/reflection/lsAssembly.h"
+#include "loom/script/reflection/lsMethodInfo.h"
+#include "loom/script/reflection/lsPropertyInfo.h"
+
+namespace LS {
+
+/*
+ * Runs on the typed and validated AST before bytecode generation and
+ * replaces calls to small script methods which cannot be overridden, static
+ * methods and the methods and property accessors of final classes, by a copy
+ * of their body.
+ *
+ * A method qualifies when its body is a single return statement, or a single
+ * expression statement which is only inlined where the call is itself a
+ * statement, of at most maxInlineNodes nodes. Arguments and the receiver must
+ * be literals, locals or this so substituting them for the parameters keeps
+ * the evaluation order. Copied nodes take the line number of the call site,
+ * so the debug info keeps mapping to the caller's source.
+ *
+ * Private instance methods of classes which are not final are left alone, as
+ * member ordinals are shared by name a subclass method of the same name
+ * overrides them at runtime.
+ */
+class InlineVisitor : public TraversalVisitor {
+private:
+
+    enum { maxInlineNodes = 16 };
+
+    struct InlineSite
+    {
+        FunctionLiteral       *callee;
+        utArray<Expression *> *arguments;
+
+        // a local holding the receiver, NULL for static methods and this
+        Expression *receiver;
+
+        int lineNumber;
+        int numNodes;
+        int receiverUses;
+    };
+
+    Tokens *tok;
+
+    ClassDeclaration *curClass;
+    FunctionLiteral  *curFunction;
+
+    // MethodBase -> literal of the inline candidates in the module
+    utHashTable<utPointerHashKey, FunctionLiteral *> methods;
+
+    static bool isSystemType(Type *type)
+    {
+        const Module *module   = type->getModule();
+        Assembly     *assembly = module ? module->getAssembly() : NULL;
+
+        return assembly && assembly->getName() == "System";
+    }
+
+    // the single expression of a candidate body, statement is set when the
+    // body is an expression statement rather than a return
+    static Expression *getBody(FunctionLiteral *function, bool& statement)
+    {
+        Statement *s = function->statements->at(0);
+
+        statement = s->astType == AST_EXPRESSIONSTATEMENT;
+
+        if (statement)
+        {
+            return ((ExpressionStatement *)s)->expression;
+        }
+
+        return ((ReturnStatement *)s)->result->at(0);
+    }
+
+    static bool isCandidate(ClassDeclaration *cls, FunctionLiteral *function)
+    {
+        if (!function || !function->methodBase || function->isNative ||
+            function->isConstructor || function->isCoroutine || function->isOperator)
+        {
+            return false;
+        }
+
+        // only methods which can not be overridden
+        if (!function->isStatic && !cls->isFinal)
+        {
+            return false;
+        }
+
+        if ((function->functions && function->functions->size()) ||
+            function->childFunctions.size() || function->numVarArgCalls ||
+            (function->getFirstDefaultArg() != UT_NPOS))
+        {
+            return false;
+        }
+
+        if (function->methodBase->getVarArgIndex() != -1)
+        {
+            return false;
+        }
+
+        if (!function->statements || (function->statements->size() != 1))
+        {
+            return false;
+        }
+
+        Statement *s = function->statements->at(0);
+
+        if (s->astType == AST_RETURNSTATEMENT)
+        {
+            utArray<Expression *> *result = ((ReturnStatement *)s)->result;
+            return result && (result->size() == 1) && result->at(0);
+        }
+
+        return s->astType == AST_EXPRESSIONSTATEMENT && ((ExpressionStatement *)s)->expression;
+    }
+
+    // whether name is declared by the function being visited or the
+    // functions enclosing it
+    bool isLocalName(const char *name)
+    {
+        for (FunctionLiteral *f = curFunction; f; f = f->parentFunction)
+        {
+            for (UTsize i = 0; i < f->localVariables.size(); i++)
+            {
+                if (f->localVariables.at(i)->identifier->string == name)
+                {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    // whether the class environment of the caller resolves type, short
+    // names may be shadowed by an import or a local of the same name
+    bool isVisible(Type *type, bool shortName)
+    {
+        Type *caller = curClass->type;
+
+        if (type == caller)
+        {
+            return !shortName || !isLocalName(type->getName());
+        }
+
+        utArray<Type *> imports;
+        caller->getImports(imports);
+
+        bool visible = (type->getPackageName() == caller->getPackageName()) ||
+                       (imports.find(type) != UT_NPOS) ||
+                       (isSystemType(type) && !isSystemType(caller));
+
+        if (!visible || !shortName)
+        {
+            return visible;
+        }
+
+        for (UTsize i = 0; i < imports.size(); i++)
+        {
+            if ((imports.at(i) != type) && !strcmp(imports.at(i)->getName(), type->getName()))
+            {
+                return false;
+            }
+        }
+
+        return !isLocalName(type->getName());
+    }
+
+    // literals, locals and this can be evaluated where the parameter is used
+    static bool isSimple(Expression *expression)
+    {
+        switch (expression->astType)
+        {
+        case AST_NUMBERLITERAL:
+        case AST_BOOLEANLITERAL:
+        case AST_THISLITERAL:
+            return true;
+
+        case AST_STRINGLITERAL:
+            return !expression->memberInfo;
+
+        case AST_IDENTIFIER:
+            return ((Identifier *)expression)->localVarDecl && !expression->memberInfo &&
+                   !((Identifier *)expression)->typeExpression;
+
+        default:
+            return false;
+        }
+    }
+
+    // the receiver of an instance member access, which must be this or a
+    // local, receiver is set to NULL for this
+    static bool getReceiver(Expression *left, Expression *& receiver)
+    {
+        receiver = NULL;
+
+        if (left->astType == AST_THISLITERAL)
+        {
+            return true;
+        }
+
+        if ((left->astType == AST_IDENTIFIER) && isSimple(left))
+        {
+            receiver = left;
+            return true;
+        }
+
+        return false;
+    }
+
+    Expression *cloneIdentifier(Identifier *identifier, InlineSite& site)
+    {
+        if (identifier->typeExpression || identifier->superAccess)
+        {
+            return NULL;
+        }
+
+        if (identifier->localVarDecl)
+        {
+            // the only locals of a candidate are its parameters
+            utArray<VariableDeclaration *> *parameters = site.callee->parameters;
+
+            UTsize idx = parameters ? parameters->find(identifier->localVarDecl) : UT_NPOS;
+
+            if ((idx == UT_NPOS) || identifier->assignment)
+            {
+                return NULL;
+            }
+
+            Expression *argument = site.arguments->at(idx);
+
+            // a this argument is the caller's, not the receiver
+            if (argument->astType == AST_THISLITERAL)
+            {
+                return new ThisLiteral(*(ThisLiteral *)argument);
+            }
+
+            if (argument->astType == AST_IDENTIFIER)
+            {
+                return new Identifier(*(Identifier *)argument);
+            }
+
+            if (argument->astType == AST_NUMBERLITERAL)
+            {
+                return new NumberLiteral(*(NumberLiteral *)argument);
+            }
+
+            if (argument->astType == AST_BOOLEANLITERAL)
+            {
+                return new BooleanLiteral(*(BooleanLiteral *)argument);
+            }
+
+            return new StringLiteral(*(StringLiteral *)argument);
+        }
+
+        MemberInfo *memberInfo = identifier->memberInfo;
+
+        if (!memberInfo)
+        {
+            // a type referenced by name, anything else is a global
+            Type *type = identifier->type;
+
+            if (!type || (strcmp(type->getName(), identifier->string.c_str()) &&
+                          (type->getFullName() != identifier->string)))
+            {
+                return NULL;
+            }
+
+            if (!isVisible(type, strcmp(type->getName(), identifier->string.c_str()) == 0))
+            {
+                return NULL;
+            }
+
+            return new Identifier(*identifier);
+        }
+
+        // static members are indexed from their declaring type by full name
+        if (memberInfo->isStatic())
+        {
+            if (!isVisible(memberInfo->getDeclaringType(), false))
+            {
+                return NULL;
+            }
+
+            return new Identifier(*identifier);
+        }
+
+        if (!site.receiver)
+        {
+            return new Identifier(*identifier);
+        }
+
+        // an implicit member of this becomes receiver.member
+        site.receiverUses++;
+
+        StringLiteral *member = new StringLiteral(memberInfo->getName());
+        member->memberInfo = memberInfo;
+        member->lineNumber = site.lineNumber;
+
+        Identifier *receiver = new Identifier(*(Identifier *)site.receiver);
+        receiver->lineNumber = site.lineNumber;
+
+        PropertyExpression *p = new PropertyExpression(receiver, member);
+        p->memberInfo   = memberInfo;
+        p->type         = identifier->type;
+        p->templateInfo = identifier->templateInfo;
+        p->assignment   = identifier->assignment;
+
+        return p;
+    }
+
+    Expression *cloneThis(ThisLiteral *literal, InlineSite& site)
+    {
+        if (!site.receiver)
+        {
+            return new ThisLiteral(*literal);
+        }
+
+        site.receiverUses++;
+
+        return new Identifier(*(Identifier *)site.receiver);
+    }
+
+    // whether expression is a parameter being assigned to
+    static bool isLocalTarget(Expression *expression)
+    {
+        return (expression->astType == AST_IDENTIFIER) && ((Identifier *)expression)->localVarDecl;
+    }
+
+    // a copy of expression for site, or NULL if it can not be inlined there
+    Expression *clone(Expression *expression, InlineSite& site)
+    {
+        if (!expression || (++site.numNodes > maxInlineNodes))
+        {
+            return NULL;
+        }
+
+        Expression *clone = NULL;
+
+        switch (expression->astType)
+        {
+        case AST_NUMBERLITERAL:
+            clone = new NumberLiteral(*(NumberLiteral *)expression);
+            break;
+
+        case AST_BOOLEANLITERAL:
+            clone = new BooleanLiteral(*(BooleanLiteral *)expression);
+            break;
+
+        case AST_NULLLITERAL:
+            clone = new NullLiteral(*(NullLiteral *)expression);
+            break;
+
+        case AST_STRINGLITERAL:
+            if (!expression->memberInfo)
+            {
+                clone = new StringLiteral(*(StringLiteral *)expression);
+            }
+            break;
+
+        case AST_THISLITERAL:
+            clone = cloneThis((ThisLiteral *)expression, site);
+            break;
+
+        case AST_IDENTIFIER:
+            clone = cloneIdentifier((Identifier *)expression, site);
+            break;
+
+        case AST_PROPERTYEXPRESSION:
+           {
+               MemberInfo *memberInfo = expression->memberInfo;
+
+               // members of primitives are called on the type by short name
+               if (memberInfo && memberInfo->getDeclaringType()->isPrimitive() &&
+                   !isVisible(memberInfo->getDeclaringType(), true))
+               {
+                   return NULL;
+               }
+
+               PropertyExpression *p = new PropertyExpression(*(PropertyExpression *)expression);
+
+               p->leftExpression = this->clone(p->leftExpression, site);
+
+               if (p->arrayAccess)
+               {
+                   p->rightExpression = this->clone(p->rightExpression, site);
+               }
+               else
+               {
+                   p->rightExpression = new StringLiteral(*(StringLiteral *)p->rightExpression);
+                   p->rightExpression->lineNumber = site.lineNumber;
+               }
+
+               if (p->leftExpression && p->rightExpression)
+               {
+                   clone = p;
+               }
+           }
+           break;
+
+        case AST_BINARYOPERATOREXPRESSION:
+        case AST_LOGICALANDEXPRESSION:
+        case AST_LOGICALOREXPRESSION:
+           {
+               BinaryOperatorExpression *b = (BinaryOperatorExpression *)expression;
+
+               // operator overloads are looked up by the short type name
+               const char *opmethod = tok->getOperatorMethodName(b->op);
+
+               if (opmethod && b->leftExpression->type && b->leftExpression->type->findMember(opmethod) &&
+                   !isVisible(b->leftExpression->type, true))
+               {
+                   return NULL;
+               }
+
+               if (expression->astType == AST_LOGICALANDEXPRESSION)
+               {
+                   b = new LogicalAndExpression(*(LogicalAndExpression *)expression);
+               }
+               else if (expression->astType == AST_LOGICALOREXPRESSION)
+               {
+                   b = new LogicalOrExpression(*(LogicalOrExpression *)expression);
+               }
+               else
+               {
+                   b = new BinaryOperatorExpression(*b);
+               }
+
+               b->leftExpression  = this->clone(b->leftExpression, site);
+               b->rightExpression = this->clone(b->rightExpression, site);
+
+               if (b->leftExpression && b->rightExpression)
+               {
+                   clone = b;
+               }
+           }
+           break;
+
+        case AST_ASSIGNMENTEXPRESSION:
+        case AST_ASSIGNMENTOPERATOREXPRESSION:
+           {
+               BinaryExpression *b = (BinaryExpression *)expression;
+
+               if (isLocalTarget(b->leftExpression))
+               {
+                   return NULL;
+               }
+
+               if (expression->astType == AST_ASSIGNMENTEXPRESSION)
+               {
+                   b = new AssignmentExpression(*(AssignmentExpression *)expression);
+               }
+               else
+               {
+                   b = new AssignmentOperatorExpression(*(AssignmentOperatorExpression *)expression);
+               }
+
+               b->leftExpression  = this->clone(b->leftExpression, site);
+               b->rightExpression = this->clone(b->rightExpression, site);
+
+               if (b->leftExpression && b->rightExpression)
+               {
+                   clone = b;
+               }
+           }
+           break;
+
+        case AST_UNARYOPERATOREXPRESSION:
+        case AST_INCREMENTEXPRESSION:
+           {
+               UnaryExpression *u = (UnaryExpression *)expression;
+
+               if (expression->astType == AST_INCREMENTEXPRESSION)
+               {
+                   if (isLocalTarget(u->subExpression))
+                   {
+                       return NULL;
+                   }
+
+                   u = new IncrementExpression(*(IncrementExpression *)expression);
+               }
+               else
+               {
+                   u = new UnaryOperatorExpression(*(UnaryOperatorExpression *)expression);
+               }
+
+               u->subExpression = this->clone(u->subExpression, site);
+
+               if (u->subExpression)
+               {
+                   clone = u;
+               }
+           }
+           break;
+
+        case AST_CONDITIONALEXPRESSION:
+           {
+               ConditionalExpression *c = new ConditionalExpression(*(ConditionalExpression *)expression);
+
+               c->expression      = this->clone(c->expression, site);
+               c->trueExpression  = this->clone(c->trueExpression, site);
+               c->falseExpression = this->clone(c->falseExpression, site);
+
+               if (c->expression && c->trueExpression && c->falseExpression)
+               {
+                   clone = c;
+               }
+           }
+           break;
+
+        case AST_CALLEXPRESSION:
+           {
+               CallExpression *call = (CallExpression *)expression;
+
+               // varargs calls need locals allocated in the callee
+               if (!call->methodBase || (call->methodBase->getVarArgIndex() != -1))
+               {
+                   return NULL;
+               }
+
+               call           = new CallExpression(*call);
+               call->function = this->clone(call->function, site);
+
+               if (!call->function)
+               {
+                   return NULL;
+               }
+
+               if (call->arguments)
+               {
+                   utArray<Expression *> *arguments = new utArray<Expression *>();
+
+                   for (UTsize i = 0; i < call->arguments->size(); i++)
+                   {
+                       Expression *argument = this->clone(call->arguments->at(i), site);
+
+                       if (!argument)
+                       {
+                           return NULL;
+                       }
+
+                       arguments->push_back(argument);
+                   }
+
+                   call->arguments = arguments;
+               }
+
+               clone = call;
+           }
+           break;
+
+        default:
+            break;
+        }
+
+        if (clone)
+        {
+            clone->lineNumber = site.lineNumber;
+        }
+
+        return clone;
+    }
+
+    // the inlined body of method for a call at site, or NULL when the call
+    // is kept, statement is true where the call is an expression statement
+    Expression *inlineCall(MethodBase *method, Expression *receiver,
+                           utArray<Expression *> *arguments, Expression *site, bool statement)
+    {
+        if (!method || !curClass || !curClass->type)
+        {
+            return NULL;
+        }
+
+        FunctionLiteral **ofunction = methods.get(method);
+
+        if (!ofunction)
+        {
+            return NULL;
+        }
+
+        // keep inlined bodies within the types the caller depends on, which
+        // the compiler cache tracks for invalidation
+        if (!isVisible(method->getDeclaringType(), false))
+        {
+            return NULL;
+        }
+
+        FunctionLiteral *function = *ofunction;
+
+        bool       statementBody;
+        Expression *body = getBody(function, statementBody);
+
+        if (statementBody != statement)
+        {
+            return NULL;
+        }
+
+        // the call site is typed by the return type
+        if (!statementBody &&
+            (!method->isMethod() || (body->type != ((MethodInfo *)method)->getReturnType())))
+        {
+            return NULL;
+        }
+
+        int numParameters = function->parameters ? (int)function->parameters->size() : 0;
+        int numArguments  = arguments ? (int)arguments->size() : 0;
+
+        if ((numArguments != numParameters) || (numParameters != method->getNumParameters()))
+        {
+            return NULL;
+        }
+
+        // the argument replaces the parameter, and with it its type
+        for (int i = 0; i < numArguments; i++)
+        {
+            Expression *argument = arguments->at(i);
+
+            if (!isSimple(argument) || (argument->type != method->getParameter(i)->getParameterType()))
+            {
+                return NULL;
+            }
+        }
+
+        InlineSite inlineSite;
+
+        inlineSite.callee       = function;
+        inlineSite.arguments    = arguments;
+        inlineSite.receiver     = receiver;
+        inlineSite.lineNumber   = site->lineNumber;
+        inlineSite.numNodes     = 0;
+        inlineSite.receiverUses = 0;
+
+        Expression *inlined = clone(body, inlineSite);
+
+        // keep the call where dropping it would hide a null receiver
+        if (!inlined || (receiver && !inlineSite.receiverUses))
+        {
+            return NULL;
+        }
+
+        inlined->primaryExpression = site->primaryExpression;
+
+        return inlined;
+    }
+
+    void addMethod(ClassDeclaration *cls, FunctionLiteral *function)
+    {
+        if (isCandidate(cls, function))
+        {
+            methods.insert(function->methodBase, function);
+        }
+    }
+
+    // the getter of a property read, or NULL
+    static MethodBase *getGetter(Expression *expression)
+    {
+        if (expression->assignment || !expression->memberInfo || !expression->memberInfo->isProperty())
+        {
+            return NULL;
+        }
+
+        return ((PropertyInfo *)expression->memberInfo)->getGetMethod();
+    }
+
+public:
+
+    InlineVisitor() : TraversalVisitor(), curClass(NULL), curFunction(NULL)
+    {
+        visitor = this;
+        tok     = Tokens::getSingletonPtr();
+    }
+
+    // registers the methods declared in cunit, call for every compilation
+    // unit of the module before visiting any of them
+    void addMethods(CompilationUnit *cunit)
+    {
+        for (UTsize i = 0; i < cunit->classDecls.size(); i++)
+        {
+            ClassDeclaration *cls = cunit->classDecls.at(i);
+
+            if (!cls->type)
+            {
+                continue;
+            }
+
+            for (UTsize j = 0; j < cls->functionDecls.size(); j++)
+            {
+                addMethod(cls, cls->functionDecls.at(j));
+            }
+
+            for (UTsize j = 0; j < cls->properties.size(); j++)
+            {
+                PropertyLiteral *property = cls->properties.at(j);
+
+                addMethod(cls, property->getter);
+                addMethod(cls, property->setter);
+            }
+        }
+    }
+
+    CompilationUnit *visit(CompilationUnit *cunit)
+    {
+        this->cunit = cunit;
+        return TraversalVisitor::visit(cunit);
+    }
+
+    //
+    // declarations, the names they declare are not visited
+    //
+
+    Statement *visit(ClassDeclaration *cls)
+    {
+        ClassDeclaration *oldClass = curClass;
+
+        curClass        = cls;
+        cls->statements = visitStatementArray(cls->statements);
+        curClass        = oldClass;
+
+        lastVisited = cls;
+
+        return cls;
+    }
+
+    Expression *visit(FunctionLiteral *function)
+    {
+        FunctionLiteral *oldFunction = curFunction;
+
+        curFunction = function;
+
+        if (function->parameters)
+        {
+            for (UTsize i = 0; i < function->parameters->size(); i++)
+            {
+                visit(function->parameters->at(i));
+            }
+        }
+
+        function->functions  = visitStatementArray(function->functions);
+        function->statements = visitStatementArray(function->statements);
+
+        curFunction = oldFunction;
+
+        return function;
+    }
+
+    Expression *visit(VariableDeclaration *variableDeclaration)
+    {
+        variableDeclaration->initializer = visitExpression(variableDeclaration->initializer);
+
+        lastVisited = variableDeclaration;
+
+        return variableDeclaration;
+    }
+
+    //
+    // statements, void methods and setters are inlined where called as a
+    // statement
+    //
+
+    Statement *visit(ExpressionStatement *statement)
+    {
+        lastVisited = statement;
+
+        Expression *expression = statement->expression;
+        Expression *inlined    = NULL;
+
+        if (expression->astType == AST_CALLEXPRESSION)
+        {
+            CallExpression *call = (CallExpression *)TraversalVisitor::visit((CallExpression *)expression);
+
+            Expression *receiver = NULL;
+
+            if ((call->function->astType == AST_IDENTIFIER) ||
+                ((call->function->astType == AST_PROPERTYEXPRESSION) &&
+                 (((PropertyExpression *)call->function)->staticAccess ||
+                  getReceiver(((PropertyExpression *)call->function)->leftExpression, receiver))))
+            {
+                inlined = inlineCall(call->methodBase, receiver, call->arguments, call, true);
+            }
+        }
+        else if (expression->astType == AST_ASSIGNMENTEXPRESSION)
+        {
+            AssignmentExpression *assignment = (AssignmentExpression *)visitBinaryExpression((AssignmentExpression *)expression);
+
+            Expression *left     = assignment->leftExpression;
+            Expression *receiver = NULL;
+
+            if (left->memberInfo && left->memberInfo->isProperty() &&
+                (((left->astType == AST_IDENTIFIER) && !((Identifier *)left)->superAccess) ||
+                 ((left->astType == AST_PROPERTYEXPRESSION) && !((PropertyExpression *)left)->arrayAccess &&
+                  (((PropertyExpression *)left)->staticAccess ||
+                   getReceiver(((PropertyExpression *)left)->leftExpression, receiver)))))
+            {
+                utArray<Expression *> arguments;
+                arguments.push_back(assignment->rightExpression);
+
+                inlined = inlineCall(((PropertyInfo *)left->memberInfo)->getSetMethod(), receiver, &arguments, assignment, true);
+            }
+        }
+        else
+        {
+            statement->expression = visitExpression(expression);
+        }
+
+        if (inlined)
+        {
+            statement->expression = inlined;
+        }
+
+        return statement;
+    }
+
+    //
+    // expressions
+    //
+
+    Expression *visit(CallExpression *call)
+    {
+        TraversalVisitor::visit(call);
+
+        Expression *receiver = NULL;
+
+        if (call->function->astType == AST_PROPERTYEXPRESSION)
+        {
+            PropertyExpression *p = (PropertyExpression *)call->function;
+
+            if (!p->staticAccess && !getReceiver(p->leftExpression, receiver))
+            {
+                return call;
+            }
+        }
+        else if (call->function->astType != AST_IDENTIFIER)
+        {
+            return call;
+        }
+
+        Expression *inlined = inlineCall(call->methodBase, receiver, call->arguments, call, false);
+
+        return inlined ? inlined : call;
+    }
+
+    Expression *visit(Identifier *identifier)
+    {
+        lastVisited = identifier;
+
+        if (identifier->superAccess || identifier->typeExpression)
+        {
+            return identifier;
+        }
+
+        Expression *inlined = inlineCall(getGetter(identifier), NULL, NULL, identifier, false);
+
+        return inlined ? inlined : identifier;
+    }
+
+    Expression *visit(PropertyExpression *expression)
+    {
+        lastVisited = expression;
+        visitBinaryExpression(expression);
+
+        Expression *receiver = NULL;
+
+        if (expression->arrayAccess ||
+            (!expression->staticAccess && !getReceiver(expression->leftExpression, receiver)))
+        {
+            return expression;
+        }
+
+        Expression *inlined = inlineCall(getGetter(expression), receiver, NULL, expression, false);
+
+        return inlined ? inlined : expression;
+    }
+
+    Expression *visit(IncrementExpression *expression)
+    {
+        lastVisited = expression;
+
+        // the operand is read and written through the accessors, only
+        // the object it is accessed on may be inlined
+        Expression *sub = expression->subExpression;
+
+        if (sub->astType == AST_PROPERTYEXPRESSION)
+        {
+            visitBinaryExpression((PropertyExpression *)sub);
+        }
+        else if (sub->astType != AST_IDENTIFIER)
+        {
+            expression->subExpression = visitExpression(sub);
+        }
+
+        return expression;
+    }
+};
+}
+#endif
@@ -436,19 +436,10 @@ void JitTypeCompiler::generateConstructor(FunctionLiteral *function,
         }
         else if (v->initializer)
         {
-            ExpDesc vname;
-
-            BC::initExpDesc(&vname, VKNUM, 0);
-
-            setnumV(&vname.u.nval, v->memberInfo->getOrdinal());
-
             ExpDesc ethis;
             BC::singleVar(cs, &ethis, "this");
 
-            BC::expToNextReg(&funcState, &ethis);
-            BC::expToNextReg(&funcState, &vname);
-            BC::expToVal(&funcState, &vname);
-            BC::indexed(&funcState, &ethis, &vname);
+            indexOrdinal(&ethis, v->memberInfo->getOrdinal());
 
             v->initializer->visitExpression(this);
             BC::storeVar(&funcState, &ethis, &v->initializer->e);
@@ -773,7 +764,6 @@ Statement *JitTypeCompiler::visit(ForStatement *statement)
 Statement *JitTypeCompiler::visit(ForInStatement *statement)
 {
     FuncState *fs = cs->fs;
-    int nvars = 0;
 
     char forIteratorName[256];
 
@@ -817,82 +807,200 @@ Statement *JitTypeCompiler::visit(ForInStatement *statement)
         lmAssert(0, "Unknown variable statement in for..in initializer");
     }
 
+    if (statement->expression->type->getFullName() == "system.Vector")
+    {
+        vectorLoop(statement, vname, forIteratorName);
+    }
+    else
+    {
+        dictionaryLoop(statement, vname, forIteratorName);
+    }
+
+    if (forIteratorName[0])
+    {
+        // we need to store to this block's var
+        BC::singleVar(cs, &v, vname);
+        BC::singleVar(cs, &fv, forIteratorName);
+        BC::storeVar(fs, &v, &fv);
+    }
+
+    currentForInIteratorName = prevForInIteratorName;
+
+
+    return statement;
+}
+
+
+// Vectors are iterated with an index register instead of a generator
+// call per element, which also keeps the loop in a trace. The element
+// table and length are read again every iteration as the body may push
+// to, clear or sort the vector.
+void JitTypeCompiler::vectorLoop(ForInStatement *statement, const char *vname,
+                                 const char *forIteratorName)
+{
+    FuncState *fs = cs->fs;
+
+    ExpDesc v;
+    ExpDesc fv;
+
     FuncScope forbl;
     enterBlock(fs, &forbl, 1); /* scope for loop and control variables */
 
-    BCReg base = fs->freereg + 3;
+    BCReg base = fs->freereg;
 
     /* create control variables */
-    BC::newLocalVar(cs, "(for generator)", nvars++);
-    BC::newLocalVar(cs, "(for state)", nvars++);
-    BC::newLocalVar(cs, "(for control)", nvars++);
+    BC::newLocalVar(cs, "(for vector)", 0);
+    BC::newLocalVar(cs, "(for index)", 1);
+    BC::newLocalVar(cs, "(for table)", 2);
 
-    //TODO: It would be nice to have a way to iterate pairs
-    if (statement->foreach)
-    {
-        BC::newLocalVar(cs, "__ls_key", nvars++);
-    }
+    statement->expression->visitExpression(this);
+    ExpDesc vector = statement->expression->e;
+    BC::expToNextReg(fs, &vector);
 
-    /* create declared variables */
-    BC::newLocalVar(cs, vname, nvars++);
+    ExpDesc index;
+    BC::initExpDesc(&index, VKNUM, 0);
+    setnumV(&index.u.nval, 0);
+    BC::expToNextReg(fs, &index);
 
-    BCLine line = lineNumber;
+    BC::emitNil(fs, fs->freereg, 1);
+    BC::regReserve(fs, 1);
 
-    bool isVector = false;
+    BC::adjustLocalVars(cs, 3); /* control variables */
+
+    int start = BC::getLabel(fs);
+
+    // (for table) = (for vector)[LSINDEXVECTOR]
+    ExpDesc table;
+    ExpDesc key;
+    BC::initExpDesc(&table, VNONRELOC, base);
+    BC::initExpDesc(&key, VKNUM, 0);
+    setnumV(&key.u.nval, LSINDEXVECTOR);
+    BC::expToNextReg(fs, &key);
+    BC::expToVal(fs, &key);
+    BC::indexed(fs, &table, &key);
+    BC::expToReg(fs, &table, base + 2);
+
+    // exit once (for index) >= (for table)[LSINDEXVECTORLENGTH]
+    ExpDesc length;
+    BC::initExpDesc(&length, VNONRELOC, base + 2);
+    BC::initExpDesc(&key, VKNUM, 0);
+    setnumV(&key.u.nval, LSINDEXVECTORLENGTH);
+    BC::expToNextReg(fs, &key);
+    BC::expToVal(fs, &key);
+    BC::indexed(fs, &length, &key);
+    BC::expToNextReg(fs, &length);
+
+    bcemit_AD(fs, BC_ISGE, base + 1, length.u.s.info);
+    BCPos loopexit = BC::emitJmp(fs);
+    BC::expFree(fs, &length);
+
+    BCPos loop = bcemit_AD(fs, BC_LOOP, fs->nactvar, 0);
 
-    if (statement->expression->type->getFullName() == "system.Vector")
-    {
-        isVector = true;
-    }
+    FuncScope bl;
+    enterBlock(fs, &bl, 0); /* scope for declared variables */
 
-    ExpDesc pairs;
+    BC::newLocalVar(cs, vname, 0);
 
-    if (isVector)
+    ExpDesc value;
+    BC::initExpDesc(&value, VNONRELOC, base + 1);
+
+    if (statement->foreach)
     {
-        BC::singleVar(cs, &pairs, "__lua_ipairs");
+        // the element, otherwise the index itself
+        ExpDesc element;
+        BC::initExpDesc(&element, VNONRELOC, base + 2);
+        BC::indexed(fs, &element, &value);
+        value = element;
     }
-    else
+
+    BC::expToNextReg(fs, &value);
+    BC::adjustLocalVars(cs, 1);
+
+    statement->statement->visitStatement(this);
+
+    if (forIteratorName[0])
     {
-        BC::singleVar(cs, &pairs, "__lua_pairs");
+        // we need to store
+        BC::singleVar(cs, &v, vname);
+        BC::singleVar(cs, &fv, forIteratorName);
+        BC::storeVar(fs, &fv, &v);
     }
 
-    BC::expToNextReg(fs, &pairs);
+    leaveBlock(fs); /* end of scope for declared variables */
 
-    if (twoSlotFrameInfo) BC::regReserve(fs, 1);
+    BC::jmpToHere(fs, forbl.continuelist);
 
-    ExpDesc arg;
+    // (for index) = (for index) + 1
+    ExpDesc one;
+    BC::initExpDesc(&index, VNONRELOC, base + 1);
+    BC::initExpDesc(&one, VKNUM, 0);
+    setnumV(&one.u.nval, 1);
+    BC::emitBinOpLeft(fs, OPR_ADD, &index);
+    BC::emitBinOp(fs, OPR_ADD, &index, &one);
 
-    statement->expression->visitExpression(this);
-    arg = statement->expression->e;
-    ExpDesc right;
+    ExpDesc counter;
+    BC::initExpDesc(&counter, VLOCAL, base + 1);
+    BC::storeVar(fs, &counter, &index);
+
+    BC::jmpPatch(fs, BC::emitJmp(fs), start);
+
+    leaveBlock(fs);
+
+    BC::jmpToHere(fs, loopexit);
+    BC::jmpPatchIns(fs, loop, fs->pc);
+}
+
+
+// Dictionaries are iterated by next on the pairs table, the generator,
+// state and control variables are set up directly without calling pairs,
+// so ISNEXT can specialize the loop to ITERN.
+void JitTypeCompiler::dictionaryLoop(ForInStatement *statement, const char *vname,
+                                     const char *forIteratorName)
+{
+    FuncState *fs   = cs->fs;
+    int       nvars = 0;
+
+    ExpDesc v;
+    ExpDesc fv;
+
+    FuncScope forbl;
+    enterBlock(fs, &forbl, 1); /* scope for loop and control variables */
 
-    if (isVector)
+    BCReg base = fs->freereg + 3;
+
+    /* create control variables */
+    BC::newLocalVar(cs, "(for generator)", nvars++);
+    BC::newLocalVar(cs, "(for state)", nvars++);
+    BC::newLocalVar(cs, "(for control)", nvars++);
+
+    if (statement->foreach)
     {
-        // we pass the instance itself
+        BC::newLocalVar(cs, "__ls_key", nvars++);
     }
-    else
-    {
-        BC::initExpDesc(&right, VKNUM, 0);
-        setnumV(&right.u.nval, LSINDEXDICTPAIRS);
 
-        BC::expToNextReg(fs, &arg);
-        BC::expToNextReg(fs, &right);
-        BC::expToVal(fs, &right);
-        BC::indexed(fs, &arg, &right);
-    }
+    /* create declared variables */
+    BC::newLocalVar(cs, vname, nvars++);
 
+    BCLine line = lineNumber;
 
-    BCIns ins;
-    BCReg cbase = pairs.u.s.info; /* Base register for call. */
-    BC::expToNextReg(fs, &arg);
-    ins = BCINS_ABC(BC_CALL, cbase, 2, fs->freereg - base - twoSlotFrameInfo);
+    ExpDesc next;
+    BC::singleVar(cs, &next, "__lua_next");
+    BC::expToNextReg(fs, &next);
 
-    BC::initExpDesc(&pairs, VCALL, BC::emitINS(fs, ins));
-    pairs.u.s.aux = cbase;
-    fs->bcbase[fs->pc - 1].line = line;
-    fs->freereg = cbase + 1; /* Leave one result by default. */
+    statement->expression->visitExpression(this);
+    ExpDesc pairs = statement->expression->e;
 
-    BC::adjustAssign(cs, 3, 1, &pairs);
+    ExpDesc right;
+    BC::initExpDesc(&right, VKNUM, 0);
+    setnumV(&right.u.nval, LSINDEXDICTPAIRS);
+
+    BC::expToNextReg(fs, &pairs);
+    BC::expToNextReg(fs, &right);
+    BC::expToVal(fs, &right);
+    BC::indexed(fs, &pairs, &right);
+
+    /* next, dictionary[LSINDEXDICTPAIRS], nil */
+    BC::adjustAssign(cs, 3, 2, &pairs);
 
     BC::regBump(fs, 3 + twoSlotFrameInfo);         /* The iterator needs another 3 slots (func + 2 args). */
 
@@ -900,7 +1008,7 @@ Statement *JitTypeCompiler::visit(ForInStatement *statement)
 
     FuncScope bl;
 
-    BCPos loop = bcemit_AJ(fs, false ? BC_ISNEXT : BC_JMP, base, NO_JMP);
+    BCPos loop = bcemit_AJ(fs, BC_ISNEXT, base, NO_JMP);
     enterBlock(fs, &bl, 0);
     BC::adjustLocalVars(cs, nvars - 3); /* Hidden control variables. */
     BC::regReserve(fs, nvars - 3);
@@ -920,7 +1028,7 @@ Statement *JitTypeCompiler::visit(ForInStatement *statement)
     leaveBlock(fs);
     /* Perform loop inversion. Loop control instructions are at the end. */
     BC::jmpPatchIns(fs, loop, fs->pc);
-    bcemit_ABC(fs, false ? BC_ITERN : BC_ITERC, base, nvars - 3 + 1, 2 + 1);
+    bcemit_ABC(fs, BC_ITERN, base, nvars - 3 + 1, 2 + 1);
     BCPos loopend = bcemit_AJ(fs, BC_ITERL, base, NO_JMP);
 
     fs->bcbase[loopend - 1].line = line; /* Fix line for control ins. */
@@ -928,20 +1036,6 @@ Statement *JitTypeCompiler::visit(ForInStatement *statement)
     BC::jmpPatchIns(fs, loopend, loop + 1);
 
     leaveBlock(fs);
-
-
-    if (forIteratorName[0])
-    {
-        // we need to store to this block's var
-        BC::singleVar(cs, &v, vname);
-        BC::singleVar(cs, &fv, forIteratorName);
-        BC::storeVar(fs, &v, &fv);
-    }
-
-    currentForInIteratorName = prevForInIteratorName;
-
-
-    return statement;
 }
 
 
@@ -1106,11 +1200,160 @@ Statement *JitTypeCompiler::visit(CaseStatement *statement)
 }
 
 
+// Jumps to the clause the lookup left in reg, a binary search over the
+// sorted clauses it can be
+void JitTypeCompiler::switchDispatch(BCReg reg, utArray<int>& clauses, int lo, int hi,
+                                     utArray<BCPos>& jumps)
+{
+    FuncState *fs = cs->fs;
+
+    if (lo == hi)
+    {
+        BC::jmpAppend(fs, &jumps[clauses[lo]], BC::emitJmp(fs));
+        return;
+    }
+
+    int mid = (lo + hi + 1) / 2;
+
+    ExpDesc clause;
+    BC::initExpDesc(&clause, VKNUM, 0);
+    setnumV(&clause.u.nval, clauses[mid]);
+    BC::expToNextReg(fs, &clause);
+
+    bcemit_AD(fs, BC_ISLT, reg, clause.u.s.info);
+    BCPos below = BC::emitJmp(fs);
+    BC::expFree(fs, &clause);
+
+    switchDispatch(reg, clauses, mid, hi, jumps);
+
+    BC::jmpToHere(fs, below);
+
+    switchDispatch(reg, clauses, lo, mid - 1, jumps);
+}
+
+
+void JitTypeCompiler::switchLookup(SwitchStatement *statement, utArray<int>& targets,
+                                   int noMatch)
+{
+    FuncState *fs = cs->fs;
+    FuncScope bl;
+
+    enterBlock(fs, &bl, 1);
+
+    statement->expression->visitExpression(this);
+    ExpDesc swv = statement->expression->e;
+    BC::expToNextReg(fs, &swv);
+
+    BCReg reg = swv.u.s.info;
+
+    // the table is built on the first run and kept in the environment
+    utString name = nextSwitchLookupName();
+
+    ExpDesc lookup;
+    BC::singleVar(cs, &lookup, name.c_str());
+    BC::expToNextReg(fs, &lookup);
+
+    bcemit_AD(fs, BC_IST, 0, reg + 1);
+    BCPos built = BC::emitJmp(fs);
+
+    bcemit_AD(fs, BC_TNEW, reg + 1, 0);
+
+    for (UTsize i = 0; i < targets.size(); i++)
+    {
+        if (targets[i] == -1)
+        {
+            continue;
+        }
+
+        Expression *literal = statement->clauses->at(i)->expression;
+        literal->visitExpression(this);
+
+        ExpDesc entry;
+        BC::initExpDesc(&entry, VNONRELOC, reg + 1);
+        BC::expToVal(fs, &literal->e);
+        BC::indexed(fs, &entry, &literal->e);
+
+        ExpDesc clause;
+        BC::initExpDesc(&clause, VKNUM, 0);
+        setnumV(&clause.u.nval, targets[i]);
+
+        BC::storeVar(fs, &entry, &clause);
+        fs->freereg = reg + 2;
+    }
+
+    BC::singleVar(cs, &lookup, name.c_str());
+    BC::initExpDesc(&swv, VNONRELOC, reg + 1);
+    BC::storeVar(fs, &lookup, &swv);
+    fs->freereg = reg + 2;
+
+    BC::jmpToHere(fs, built);
+
+    // the clause to enter, nil when nothing matches
+    bcemit_ABC(fs, BC_TGETV, reg + 1, reg + 1, reg);
+
+    bcemit_AD(fs, BC_ISF, 0, reg + 1);
+    BCPos unmatched = BC::emitJmp(fs);
+
+    // targets never go below an earlier one, so the clauses come sorted
+    utArray<int>   clauses;
+    utArray<BCPos> jumps;
+
+    for (UTsize i = 0; i < targets.size(); i++)
+    {
+        jumps.push_back(NO_JMP);
+
+        if ((targets[i] != -1) && (clauses.find(targets[i]) == UT_NPOS))
+        {
+            clauses.push_back(targets[i]);
+        }
+    }
+
+    switchDispatch(reg + 1, clauses, 0, (int)clauses.size() - 1, jumps);
+
+    fs->freereg = fs->nactvar; /* free registers */
+
+    // the clauses follow each other so they fall through
+    for (UTsize i = 0; i < statement->clauses->size(); i++)
+    {
+        BC::jmpToHere(fs, jumps[i]);
+
+        if ((int)i == noMatch)
+        {
+            BC::jmpToHere(fs, unmatched);
+        }
+
+        FuncScope cbl;
+        enterBlock(fs, &cbl, 0);
+
+        chunk(statement->clauses->at(i)->statements);
+
+        lua_assert(cbl.breaklist == NO_JMP);
+        leaveBlock(fs);
+    }
+
+    leaveBlock(fs);
+
+    if (noMatch == (int)statement->clauses->size())
+    {
+        BC::jmpToHere(fs, unmatched);
+    }
+}
+
+
 Statement *JitTypeCompiler::visit(SwitchStatement *statement)
 {
     FuncState *fs = cs->fs;
     FuncScope bl;
 
+    utArray<int> targets;
+    int          noMatch;
+
+    if (planSwitchLookup(statement, targets, noMatch))
+    {
+        switchLookup(statement, targets, noMatch);
+        return statement;
+    }
+
     enterBlock(fs, &bl, 1);
 
     ExpDesc swv;
@@ -1542,19 +1785,33 @@ Expression *JitTypeCompiler::visit(BinaryOperatorExpression *expression)
     // it can't concat (which has strict rules, for instance cannot concat nil)
     if ((op == OPR_CONCAT) && ((eleft->type->getFullName() == "system.String") || (eright->type->getFullName() == "system.String")))
     {
-        // coerce left to string, must be done even for string types as they may be null
-        coerceToString(eleft);
+        // flatten chains like a + b + c so every operand is coerced once into
+        // consecutive registers and a single concat builds the result,
+        // instead of interning a string per step
+        utArray<Expression *> operands;
+        collectConcatOperands(eleft, operands);
+        collectConcatOperands(eright, operands);
 
-        BC::emitBinOpLeft(cs->fs, op, &eleft->e);
+        for (UTsize i = 0; i < operands.size(); i++)
+        {
+            // coerce to string, must be done even for string types as they may be null
+            coerceToString(operands[i]);
 
-        // coerce right to string, must be done even for string types as they may be null
-        coerceToString(eright);
+            if (i < operands.size() - 1)
+            {
+                BC::emitBinOpLeft(cs->fs, op, &operands[i]->e);
+            }
+        }
 
-        // and the binary op
-        BC::emitBinOp(cs->fs, op, &eleft->e, &eright->e);
+        // fold from the right, each concat is merged into the one before
+        // it as the operands are in consecutive registers
+        for (int i = (int)operands.size() - 2; i >= 0; i--)
+        {
+            BC::emitBinOp(cs->fs, op, &operands[i]->e, &operands[i + 1]->e);
+        }
 
         // save off expression and return
-        expression->e = eleft->e;
+        expression->e = operands[0]->e;
 
         return expression;
     }
@@ -66,6 +66,18 @@ class JitTypeCompiler : public TypeCompilerBase {
                                      ConstructorInfo *method);
     virtual void generateMethod(FunctionLiteral *function, MethodInfo *method);
 
+    // for..in and for each over a Vector or a Dictionary
+    void vectorLoop(ForInStatement *statement, const char *vname,
+                    const char *forIteratorName);
+    void dictionaryLoop(ForInStatement *statement, const char *vname,
+                        const char *forIteratorName);
+
+    // switch dispatching through a lookup table, see planSwitchLookup
+    void switchLookup(SwitchStatement *statement, utArray<int>& targets,
+                      int noMatch);
+    void switchDispatch(BCReg reg, utArray<int>& clauses, int lo, int hi,
+                        utArray<BCPos>& jumps);
+
     /*
      * The LuaJIT VM considers 0 and "" to be true.  As we do not want to modify the LuaJIT VM
      * we must implicitly convert cast boolean tests of Numbers, String, and Object so that
@@ -22,6 +22,7 @@
 #include "stdlib.h"
 #include "stdio.h"
 
+#include "loom/common/core/allocator.h"
 #include "loom/script/compiler/lsLexer.h"
 #include "loom/script/compiler/lsAlias.h"
  #include "loom/script/compiler/lsCompilerLog.h"
@@ -29,10 +30,67 @@
 
 namespace LS {
 #define LEXER_MAX_TOKEN    65536
-static char ctoken[LEXER_MAX_TOKEN];
+
+// character classes, looked up by table rather than chains of compares
+enum CharClass
+{
+    CHAR_WHITESPACE       = 1 << 0,
+    CHAR_DECIMAL_DIGIT    = 1 << 1,
+    CHAR_HEXADECIMAL      = 1 << 2,
+    CHAR_IDENTIFIER_START = 1 << 3,
+    CHAR_IDENTIFIER_PART  = 1 << 4
+};
+
+static struct CharClassTable
+{
+    unsigned char flags[256];
+
+    CharClassTable()
+    {
+        memset(flags, 0, sizeof(flags));
+
+        flags[0x09] = flags[0x0B] = flags[0x0C] = flags[0x20] = flags[0xA0] = CHAR_WHITESPACE;
+
+        for (int i = 0; i < 256; i++)
+        {
+            bool alpha = (i >= 'a' && i <= 'z') || (i >= 'A' && i <= 'Z') || i == '$' || i == '_';
+            bool digit = i >= '0' && i <= '9';
+
+            if (digit)
+            {
+                flags[i] |= CHAR_DECIMAL_DIGIT | CHAR_HEXADECIMAL;
+            }
+
+            if ((i >= 'a' && i <= 'f') || (i >= 'A' && i <= 'F'))
+            {
+                flags[i] |= CHAR_HEXADECIMAL;
+            }
+
+            if (alpha)
+            {
+                flags[i] |= CHAR_IDENTIFIER_START;
+            }
+
+            if (alpha || digit)
+            {
+                flags[i] |= CHAR_IDENTIFIER_PART;
+            }
+        }
+    }
+} sCharClasses;
+
+// c is a (possibly signed) char of the input or -1 at EOF
+static inline bool isCharClass(int c, int charClass)
+{
+    return c >= 0 && c < 256 && (sCharClasses.flags[c] & charClass);
+}
+
 
 Lexer::Lexer()
 {
+    // per lexer so sources can be lexed on several threads at once
+    ctoken = (char *)lmAlloc(NULL, LEXER_MAX_TOKEN);
+
     lineNumber  = 1;
     maxPosition = 0;
     oldPosition = 0;
@@ -40,6 +98,7 @@ Lexer::Lexer()
 
     c      = -1;
     tokens = Tokens::getSingletonPtr();
+    arena  = NULL;
 }
 
 
@@ -61,6 +120,7 @@ void Lexer::setInput(const utString& input, const utString& filename)
 
 Lexer::~Lexer()
 {
+    lmFree(NULL, ctoken);
 }
 
 
@@ -163,10 +223,14 @@ Token *Lexer::tokenizeLineTerminator()
  */
 Token *Lexer::tokenizeWhitespace()
 {
+    const char *data = input.c_str();
+
     do
     {
-        readChar();
-    } while (isWhitespace());
+        curPosition++;
+    } while (curPosition < maxPosition && isCharClass(data[curPosition], CHAR_WHITESPACE));
+
+    c = curPosition < maxPosition ? data[curPosition] : -1;
 
     return &tokens->WHITESPACE;
 }
@@ -184,7 +248,7 @@ bool Lexer::isWhitespace()
      * Returns true if the current character is a whitespace character.
      */
     /* todo, unicode*/
-    return c == 0x09 || c == 0x0B || c == 0x0C || c == 0x20 || c == 0xA0;
+    return isCharClass(c, CHAR_WHITESPACE);
 }
 
 
@@ -193,10 +257,30 @@ bool Lexer::isWhitespace()
  */
 Token *Lexer::tokenizeSingleLineComment()
 {
-    do
+    const char *data = input.c_str();
+
+    // let the C library find the end of the line, strcspn is vectorized on
+    // most platforms, stepping over any NUL characters in the source
+    curPosition++;
+
+    while (curPosition < maxPosition)
     {
-        readChar();
-    } while (!isEOF() && !isLineTerminator());
+        curPosition += (int)strcspn(data + curPosition, "\r\n");
+
+        if ((curPosition >= maxPosition) || data[curPosition])
+        {
+            break;
+        }
+
+        curPosition++;
+    }
+
+    if (curPosition > maxPosition)
+    {
+        curPosition = maxPosition;
+    }
+
+    c = curPosition < maxPosition ? data[curPosition] : -1;
 
     return &tokens->SINGLELINECOMMENT;
 }
@@ -318,7 +402,7 @@ Token *Lexer::tokenizeMultilineComment()
         ctoken[count - 1] = 0;
     }
 
-    return new Token(TMULTILINECOMMENT, ctoken);
+    return new (arena) Token(TMULTILINECOMMENT, ctoken);
 }
 
 
@@ -364,8 +448,7 @@ bool Lexer::isOctalDigit()
  */
 bool Lexer::isDecimalDigit()
 {
-    return c == '0' || c == '1' || c == '2' || c == '3' || c == '4' || c == '5' ||
-           c == '6' || c == '7' || c == '8' || c == '9';
+    return isCharClass(c, CHAR_DECIMAL_DIGIT);
 }
 
 
@@ -374,11 +457,7 @@ bool Lexer::isDecimalDigit()
  */
 bool Lexer::isHexadecimalDigit()
 {
-    return c == '0' || c == '1' || c == '2' || c == '3' || c == '4' || c == '5' ||
-           c == '6' || c == '7' || c == '8' || c == '9' || c == 'a' ||
-           c == 'b' || c == 'c' || c == 'd' || c == 'e' || c == 'f' ||
-           c == 'A' || c == 'B' || c == 'C' || c == 'D' || c == 'E' ||
-           c == 'F';
+    return isCharClass(c, CHAR_HEXADECIMAL);
 }
 
 
@@ -388,8 +467,7 @@ bool Lexer::isHexadecimalDigit()
  */
 bool Lexer::isIdentifierStart()
 {
-    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '$' ||
-           c == '_';
+    return isCharClass(c, CHAR_IDENTIFIER_START);
 }
 
 
@@ -398,8 +476,7 @@ bool Lexer::isIdentifierStart()
  */
 bool Lexer::isIdentifierPart()
 {
-    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
-           (c >= '0' && c <= '9') || c == '$' || c == '_';
+    return isCharClass(c, CHAR_IDENTIFIER_PART);
 }
 
 
@@ -634,19 +711,19 @@ Token *Lexer::tokenizeNumeric()
 
         /* floating literal */
         case NUMERIC_RETURN_FLOAT:
-            return new Token(TFLOAT, input, oldPosition, curPosition);
+            return new (arena) Token(TFLOAT, input, oldPosition, curPosition);
 
         /* decimal literal */
         case NUMERIC_RETURN_DECIMAL:
-            return new Token(TDECIMAL, input, oldPosition, curPosition);
+            return new (arena) Token(TDECIMAL, input, oldPosition, curPosition);
 
         /* octal literal */
         case NUMERIC_RETURN_OCTAL:
-            return new Token(TOCTAL, input, oldPosition, curPosition);
+            return new (arena) Token(TOCTAL, input, oldPosition, curPosition);
 
         /* hexadecimal literal */
         case NUMERIC_RETURN_HEXADECIMAL:
-            return new Token(THEXADECIMAL, input, oldPosition, curPosition);
+            return new (arena) Token(THEXADECIMAL, input, oldPosition, curPosition);
 
         /* '.' operator */
         case NUMERIC_RETURN_OPERATOR_DOT:
@@ -885,7 +962,7 @@ Token *Lexer::tokenizeMultilineString()
 
     ctoken[count] = 0;
 
-    return new Token(TSTRING, ctoken);
+    return new (arena) Token(TSTRING, ctoken);
 }
 
 
@@ -941,7 +1018,25 @@ Token *Lexer::tokenizeIdentifier()
     {
         if (isIdentifierPart())
         {
-            ctoken[count++] = c;
+            // copy the whole run of plain identifier characters at once
+            const char *data   = input.c_str();
+            int        length = 1;
+
+            while (curPosition + length < maxPosition &&
+                   isCharClass(data[curPosition + length], CHAR_IDENTIFIER_PART))
+            {
+                length++;
+            }
+
+            if (count + length >= LEXER_MAX_TOKEN)
+            {
+                error("Overflowed ctoken");
+                length = LEXER_MAX_TOKEN - 1 - count;
+            }
+
+            memcpy(ctoken + count, data + curPosition, length);
+            count       += length;
+            curPosition += length - 1;
         }
         else if (c == '\\')
         {
@@ -973,16 +1068,19 @@ Token *Lexer::tokenizeIdentifier()
     /* If this identifier matches a keyword we need to return that keyword
      * token. */
 
-    utString alias = Aliases::getAlias(ctoken);
-    utString preAlias;
+    UThash hash = utHashedString::hash(ctoken);
+
+    const utString& alias = Aliases::getAlias(hash);
+    utString        preAlias;
 
     if (alias.length())
     {
         preAlias = ctoken;
         strcpy(ctoken, alias.c_str());
+        hash = utHashedString::hash(ctoken);
     }
 
-    Token *token = Token::getKeyword(ctoken);
+    Token *token = Token::getKeyword(ctoken, hash);
 
     if (token != NULL)
     {
@@ -990,7 +1088,7 @@ Token *Lexer::tokenizeIdentifier()
     }
     else
     {
-        return new Token(TIDENTIFIER, ctoken, preAlias.c_str());
+        return new (arena) Token(TIDENTIFIER, ctoken, preAlias.c_str());
     }
 }
 
@@ -1002,7 +1100,7 @@ Token *Lexer::tokenizeUnknown()
 {
     readChar();
 
-    return new Token(TUNKNOWN, input, oldPosition, curPosition);
+    return new (arena) Token(TUNKNOWN, input, oldPosition, curPosition);
 }
 
 
@@ -67,6 +67,9 @@ class Lexer {
 
     Tokens *tokens;
 
+    // scratch buffer for string and comment tokens
+    char *ctoken;
+
     bool isEOF();
     bool isLineTerminator();
     bool isWhitespace();
@@ -127,6 +130,9 @@ public:
 
     int lineNumber;
     utString filename;
+
+    // where tokens are allocated, NULL for the heap
+    ASTArena *arena;
 };
 }
 #endif
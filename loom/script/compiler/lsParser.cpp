@@ -34,6 +34,10 @@ Parser::Parser(const utString& input, const utString& filename)
 
     tokens = Tokens::getSingletonPtr();
 
+    // nodes and tokens go to the arena handed to the compilation unit
+    arena       = new ASTArena();
+    lexer.arena = arena;
+
     lexer.setInput(input, filename);
 
     this->filename = filename;
@@ -58,16 +62,16 @@ Identifier *Parser::parseIdentifier()
 
     if (nextToken->type == TIDENTIFIER)
     {
-        identifier = new Identifier(nextToken->value.str());
+        identifier = new (arena) Identifier(nextToken->value.str());
         identifier->preAliasString = nextToken->preAliasValue;
     }
     else if (nextToken == LSTOKEN(KEYWORD_GET))
     {
-        identifier = new Identifier("get");
+        identifier = new (arena) Identifier("get");
     }
     else if (nextToken == LSTOKEN(KEYWORD_SET))
     {
-        identifier = new Identifier("set");
+        identifier = new (arena) Identifier("set");
     }
     else
     {
@@ -96,17 +100,17 @@ Expression *Parser::parseDefaultArgument()
     else if (nextToken == LSTOKEN(KEYWORD_NULL))
     {
         readToken(LSTOKEN(KEYWORD_NULL));
-        da = new NullLiteral();
+        da = new (arena) NullLiteral();
     }
     else if (nextToken == LSTOKEN(KEYWORD_TRUE))
     {
         readToken(LSTOKEN(KEYWORD_TRUE));
-        da = new BooleanLiteral(true);
+        da = new (arena) BooleanLiteral(true);
     }
     else if (nextToken == LSTOKEN(KEYWORD_FALSE))
     {
         readToken(LSTOKEN(KEYWORD_FALSE));
-        da = new BooleanLiteral(false);
+        da = new (arena) BooleanLiteral(false);
     }
 
     if (!da)
@@ -126,7 +130,7 @@ VariableDeclaration *Parser::parseVarArgDeclaration(bool inFlag)
 
     Identifier *identifier = parseIdentifier();
 
-    VariableDeclaration *vd = new VariableDeclaration(identifier, NULL, false,
+    VariableDeclaration *vd = new (arena) VariableDeclaration(identifier, NULL, false,
                                                       false, false, false);
 
 
@@ -171,7 +175,7 @@ VariableDeclaration *Parser::parseVarArgDeclaration(bool inFlag)
 
 FunctionLiteral *Parser::parseFunctionLiteral(bool nameFlag)
 {
-    FunctionLiteral *lit = new FunctionLiteral();
+    FunctionLiteral *lit = new (arena) FunctionLiteral();
 
     lit->lineNumber = lexer.lineNumber;
 
@@ -223,7 +227,7 @@ FunctionLiteral *Parser::parseFunctionLiteral(bool nameFlag)
 
             readToken();
 
-            lit->name = new Identifier(opname);
+            lit->name = new (arena) Identifier(opname);
         }
 
         else
@@ -338,7 +342,7 @@ FunctionLiteral *Parser::parseFunctionLiteral(bool nameFlag)
         // parse type
         if (nextToken == LSTOKEN(KEYWORD_VOID))
         {
-            lit->retType = new Identifier("Void");
+            lit->retType = new (arena) Identifier("Void");
             readToken();
         }
         else
@@ -349,11 +353,11 @@ FunctionLiteral *Parser::parseFunctionLiteral(bool nameFlag)
 
                 if (nextToken->value == "Vector")
                 {
-                    iname = new Identifier("Vector");
+                    iname = new (arena) Identifier("Vector");
                 }
                 else
                 {
-                    iname = new Identifier("Dictionary");
+                    iname = new (arena) Identifier("Dictionary");
                 }
 
                 readToken();
@@ -374,7 +378,7 @@ FunctionLiteral *Parser::parseFunctionLiteral(bool nameFlag)
     else
     {
         // if no return type is specified, use Void
-        lit->retType = new Identifier("Void");
+        lit->retType = new (arena) Identifier("Void");
     }
 
 
@@ -455,13 +459,13 @@ Statement *Parser::parsePropertyDeclaration()
 
     if (newProperty)
     {
-        PropertyDeclaration *decl = new PropertyDeclaration(plit);
+        PropertyDeclaration *decl = new (arena) PropertyDeclaration(plit);
         decl->lineNumber = lineNumber;
         return decl;
     }
 
     // already added in getter/setter
-    return new EmptyStatement();
+    return new (arena) EmptyStatement();
 }
 
 
@@ -474,7 +478,7 @@ Statement *Parser::parseFunctionDeclaration()
         error("Function declaration outside of class");
     }
 
-    FunctionDeclaration *decl = new FunctionDeclaration(
+    FunctionDeclaration *decl = new (arena) FunctionDeclaration(
         parseFunctionLiteral(true));
 
     decl->lineNumber = lineNumber;
@@ -484,7 +488,7 @@ Statement *Parser::parseFunctionDeclaration()
 
 Statement *Parser::parseBlockStatement()
 {
-    BlockStatement *block = new BlockStatement();
+    BlockStatement *block = new (arena) BlockStatement();
 
     readToken(LSTOKEN(OPERATOR_OPENBRACE));
 
@@ -515,7 +519,7 @@ Statement *Parser::parseBreakStatement()
         identifier = parseIdentifier();
     }
 
-    return new BreakStatement(identifier);
+    return new (arena) BreakStatement(identifier);
 }
 
 
@@ -530,7 +534,7 @@ Statement *Parser::parseContinueStatement()
         identifier = parseIdentifier();
     }
 
-    return new ContinueStatement(identifier);
+    return new (arena) ContinueStatement(identifier);
 }
 
 
@@ -555,7 +559,7 @@ void Parser::parseArgumentList(utArray<Expression *> *args)
 
 ArrayLiteral *Parser::parseArrayLiteral()
 {
-    ArrayLiteral *array = new ArrayLiteral();
+    ArrayLiteral *array = new (arena) ArrayLiteral();
 
     readToken(LSTOKEN(OPERATOR_OPENSQUARE));
 
@@ -601,7 +605,7 @@ StringLiteral *Parser::parseStringLiteral()
 
     readToken();
 
-    return new StringLiteral(string);
+    return new (arena) StringLiteral(string);
 }
 
 
@@ -632,7 +636,7 @@ NumberLiteral *Parser::parseNumericLiteral()
         break;
     }
 
-    NumberLiteral *n = new NumberLiteral(value);
+    NumberLiteral *n = new (arena) NumberLiteral(value);
     n->svalue = nextToken->value.str();
 
     readToken();
@@ -643,7 +647,7 @@ NumberLiteral *Parser::parseNumericLiteral()
 
 DictionaryLiteralPair *Parser::parseDictionaryLiteralPair()
 {
-    DictionaryLiteralPair *pair = new DictionaryLiteralPair();
+    DictionaryLiteralPair *pair = new (arena) DictionaryLiteralPair();
 
     Expression *propertyKey   = NULL;
     Expression *propertyValue = NULL;
@@ -662,7 +666,7 @@ DictionaryLiteralPair *Parser::parseDictionaryLiteralPair()
         {
             // If so it means we got a simple key pair.
             isKeyLiteral = true;
-            propertyKey  = new StringLiteral(id->string);
+            propertyKey  = new (arena) StringLiteral(id->string);
         }
         else
         {
@@ -693,7 +697,7 @@ DictionaryLiteralPair *Parser::parseDictionaryLiteralPair()
 
 Expression *Parser::parseDictionaryLiteral(const utString& typeKey, const utString& typeValue, bool wrapInNew)
 {
-    DictionaryLiteral *v = new DictionaryLiteral();
+    DictionaryLiteral *v = new (arena) DictionaryLiteral();
 
     v->typeKeyString   = typeKey;
     v->typeValueString = typeValue;
@@ -722,7 +726,7 @@ Expression *Parser::parseDictionaryLiteral(const utString& typeKey, const utStri
 
     if (wrapInNew)
     {
-        NewExpression *n = new NewExpression();
+        NewExpression *n = new (arena) NewExpression();
         n->function        = v;
         n->astTemplateInfo = v->astTemplateInfo;
         return n;
@@ -734,7 +738,7 @@ Expression *Parser::parseDictionaryLiteral(const utString& typeKey, const utStri
 
 Expression *Parser::parseVectorLiteral(const utString& type, bool wrapInNew)
 {
-    VectorLiteral *v = new VectorLiteral();
+    VectorLiteral *v = new (arena) VectorLiteral();
 
     v->typeString = type;
 
@@ -762,7 +766,7 @@ Expression *Parser::parseVectorLiteral(const utString& type, bool wrapInNew)
 
     if (wrapInNew)
     {
-        NewExpression *n = new NewExpression();
+        NewExpression *n = new (arena) NewExpression();
         n->function        = v;
         n->astTemplateInfo = v->astTemplateInfo;
         return n;
@@ -774,7 +778,7 @@ Expression *Parser::parseVectorLiteral(const utString& type, bool wrapInNew)
 
 ObjectLiteral *Parser::parseObjectLiteral()
 {
-    ObjectLiteral *o = new ObjectLiteral();
+    ObjectLiteral *o = new (arena) ObjectLiteral();
 
     readToken(LSTOKEN(OPERATOR_OPENBRACE));
 
@@ -802,7 +806,7 @@ ObjectLiteral *Parser::parseObjectLiteral()
 
 ObjectLiteralProperty *Parser::parseObjectLiteralProperty()
 {
-    ObjectLiteralProperty *op = new ObjectLiteralProperty();
+    ObjectLiteralProperty *op = new (arena) ObjectLiteralProperty();
 
     Expression *propertyName  = NULL;
     Expression *propertyValue = NULL;
@@ -810,7 +814,7 @@ ObjectLiteralProperty *Parser::parseObjectLiteralProperty()
     if (nextToken->isIdentifier())
     {
         Identifier *ident = parseIdentifier();
-        propertyName = new StringLiteral(ident->string);
+        propertyName = new (arena) StringLiteral(ident->string);
         delete ident;
     }
     else if (nextToken->isStringLiteral())
@@ -861,7 +865,7 @@ Expression *Parser::parseSuperExpression()
     if (nextToken == LSTOKEN(OPERATOR_OPENPAREN))
     {
         // call to super method/constructor
-        SuperExpression *super = new SuperExpression;
+        SuperExpression *super = new (arena) SuperExpression;
         expression    = super;
         super->method = identifier;
         parseArgumentList(&super->arguments);
@@ -881,22 +885,22 @@ Expression *Parser::parsePrimaryExpression()
     if (nextToken == LSTOKEN(KEYWORD_THIS))
     {
         readToken(LSTOKEN(KEYWORD_THIS));
-        return new ThisLiteral();
+        return new (arena) ThisLiteral();
     }
     else if (nextToken == LSTOKEN(KEYWORD_NULL))
     {
         readToken(LSTOKEN(KEYWORD_NULL));
-        return new NullLiteral();
+        return new (arena) NullLiteral();
     }
     else if (nextToken == LSTOKEN(KEYWORD_TRUE))
     {
         readToken(LSTOKEN(KEYWORD_TRUE));
-        return new BooleanLiteral(true);
+        return new (arena) BooleanLiteral(true);
     }
     else if (nextToken == LSTOKEN(KEYWORD_FALSE))
     {
         readToken(LSTOKEN(KEYWORD_FALSE));
-        return new BooleanLiteral(false);
+        return new (arena) BooleanLiteral(false);
     }
     else if (nextToken == LSTOKEN(OPERATOR_OPENPAREN))
     {
@@ -938,8 +942,8 @@ Expression *Parser::parsePrimaryExpression()
 
 Expression *Parser::generatePropertyCall(const utString& object, const utString& member, Expression *argument)
 {
-    PropertyExpression *p    = new PropertyExpression(new Identifier(object), new StringLiteral(member));
-    CallExpression     *call = new CallExpression();
+    PropertyExpression *p    = new (arena) PropertyExpression(new (arena) Identifier(object), new (arena) StringLiteral(member));
+    CallExpression     *call = new (arena) CallExpression();
 
     call->function  = p;
     call->arguments = new utArray<Expression *>();
@@ -981,12 +985,12 @@ Expression *Parser::parseMemberExpression(bool newFlag)
             if (nextToken->value == "Vector")
             {
                 isVector = true;
-                iname    = new Identifier("Vector");
+                iname    = new (arena) Identifier("Vector");
             }
             else
             {
                 isDictionary = true;
-                iname        = new Identifier("Dictionary");
+                iname        = new (arena) Identifier("Dictionary");
             }
 
             readToken();
@@ -1016,7 +1020,7 @@ Expression *Parser::parseMemberExpression(bool newFlag)
         else if (nextToken == LSTOKEN(OPERATOR_LESSTHAN))
         {
             // new <String> - shortcut for new Vector.<String>
-            iname    = new Identifier("Vector");
+            iname    = new (arena) Identifier("Vector");
             isVector = true;
             iname->astTemplateInfo = parseTemplateType(iname->string, NULL, true);
         }
@@ -1043,7 +1047,7 @@ Expression *Parser::parseMemberExpression(bool newFlag)
             name = parseMemberExpression(true);
         }
 
-        NewExpression *n = new NewExpression();
+        NewExpression *n = new (arena) NewExpression();
 
         // make sure that we mark the identifier as not being a primary expression
         if (name->astType == AST_IDENTIFIER)
@@ -1074,7 +1078,7 @@ Expression *Parser::parseMemberExpression(bool newFlag)
     else if (nextToken == LSTOKEN(KEYWORD_YIELD))
     {
         readToken(LSTOKEN(KEYWORD_YIELD));
-        YieldExpression *yield = new YieldExpression();
+        YieldExpression *yield = new (arena) YieldExpression();
         yield->arguments = new utArray<Expression *>();
         parseArgumentList(yield->arguments);
 
@@ -1122,7 +1126,7 @@ Expression *Parser::parseMemberExpression(bool newFlag)
             }
             else
             {
-                CallExpression *call = new CallExpression();
+                CallExpression *call = new (arena) CallExpression();
 
                 call->function = expression;
 
@@ -1140,7 +1144,7 @@ Expression *Parser::parseMemberExpression(bool newFlag)
 
             readToken(LSTOKEN(OPERATOR_CLOSESQUARE));
 
-            expression = new PropertyExpression(expression, property, true);
+            expression = new (arena) PropertyExpression(expression, property, true);
         }
         else if ((nextToken == LSTOKEN(OPERATOR_DOT)) ||
                  (nextToken == LSTOKEN(OPERATOR_COLON)))
@@ -1220,8 +1224,8 @@ Expression *Parser::parseMemberExpression(bool newFlag)
             }
 
 
-            PropertyExpression *p = new PropertyExpression(expression,
-                                                           new StringLiteral(identifier->string));
+            PropertyExpression *p = new (arena) PropertyExpression(expression,
+                                                           new (arena) StringLiteral(identifier->string));
 
             expression = p;
         }
@@ -1243,12 +1247,12 @@ Expression *Parser::parsePostfixExpression()
     if (nextToken == LSTOKEN(OPERATOR_PLUSPLUS))
     {
         readToken(LSTOKEN(OPERATOR_PLUSPLUS));
-        return new IncrementExpression(expression, 1, true);
+        return new (arena) IncrementExpression(expression, 1, true);
     }
     else if (nextToken == LSTOKEN(OPERATOR_MINUSMINUS))
     {
         readToken(LSTOKEN(OPERATOR_MINUSMINUS));
-        return new IncrementExpression(expression, -1, true);
+        return new (arena) IncrementExpression(expression, -1, true);
     }
     else
     {
@@ -1266,12 +1270,12 @@ Expression *Parser::parseUnaryExpression()
     if (nextToken == LSTOKEN(OPERATOR_PLUSPLUS))
     {
         readToken(LSTOKEN(OPERATOR_PLUSPLUS));
-        return new IncrementExpression(parseUnaryExpression(), 1, false);
+        return new (arena) IncrementExpression(parseUnaryExpression(), 1, false);
     }
     else if (nextToken == LSTOKEN(OPERATOR_MINUSMINUS))
     {
         readToken(LSTOKEN(OPERATOR_MINUSMINUS));
-        return new IncrementExpression(parseUnaryExpression(), -1, false);
+        return new (arena) IncrementExpression(parseUnaryExpression(), -1, false);
     }
     else if ((nextToken == LSTOKEN(OPERATOR_PLUS)) ||
              (nextToken == LSTOKEN(OPERATOR_MINUS)) ||
@@ -1282,14 +1286,14 @@ Expression *Parser::parseUnaryExpression()
     {
         Token *token = nextToken;
         readToken();
-        UnaryOperatorExpression *result = new UnaryOperatorExpression(
+        UnaryOperatorExpression *result = new (arena) UnaryOperatorExpression(
             parseUnaryExpression(), token);
         return result;
     }
     else if (nextToken == LSTOKEN(KEYWORD_DELETE))
     {
         readToken(LSTOKEN(KEYWORD_DELETE));
-        return new DeleteExpression(parseUnaryExpression());
+        return new (arena) DeleteExpression(parseUnaryExpression());
     }
     else
     {
@@ -1310,21 +1314,21 @@ Expression *Parser::parseMultiplyExpression()
         {
             readToken(LSTOKEN(OPERATOR_MULTIPLY));
             right = parseUnaryExpression();
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_MULTIPLY));
         }
         else if (nextToken == LSTOKEN(OPERATOR_DIVIDE))
         {
             readToken(LSTOKEN(OPERATOR_DIVIDE));
             right = parseUnaryExpression();
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_DIVIDE));
         }
         else if (nextToken == LSTOKEN(OPERATOR_MODULO))
         {
             readToken(LSTOKEN(OPERATOR_MODULO));
             right = parseUnaryExpression();
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_MODULO));
         }
         else
@@ -1347,7 +1351,7 @@ Expression *Parser::parseConcatExpression()
         {
             readToken(LSTOKEN(OPERATOR_CONCAT));
             right = parseMultiplyExpression();
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_CONCAT));
         }
         else
@@ -1372,14 +1376,14 @@ Expression *Parser::parseAdditionExpression()
         {
             readToken(LSTOKEN(OPERATOR_PLUS));
             right = parseConcatExpression();
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_PLUS));
         }
         else if (nextToken == LSTOKEN(OPERATOR_MINUS))
         {
             readToken(LSTOKEN(OPERATOR_MINUS));
             right = parseConcatExpression();
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_MINUS));
         }
         else
@@ -1402,21 +1406,21 @@ Expression *Parser::parseShiftExpression()
         {
             readToken(LSTOKEN(OPERATOR_SHIFTLEFT));
             right = parseAdditionExpression();
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_SHIFTLEFT));
         }
         else if (nextToken == LSTOKEN(OPERATOR_SHIFTRIGHT))
         {
             readToken(LSTOKEN(OPERATOR_SHIFTRIGHT));
             right = parseAdditionExpression();
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_SHIFTRIGHT));
         }
         else if (nextToken == LSTOKEN(OPERATOR_SHIFTRIGHTUNSIGNED))
         {
             readToken(LSTOKEN(OPERATOR_SHIFTRIGHTUNSIGNED));
             right = parseAdditionExpression();
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_SHIFTRIGHTUNSIGNED));
         }
         else
@@ -1439,28 +1443,28 @@ Expression *Parser::parseRelationalExpression(bool inFlag)
         {
             readToken(LSTOKEN(OPERATOR_LESSTHAN));
             right = parseShiftExpression();
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_LESSTHAN));
         }
         else if (nextToken == LSTOKEN(OPERATOR_GREATERTHAN))
         {
             readToken(LSTOKEN(OPERATOR_GREATERTHAN));
             right = parseShiftExpression();
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_GREATERTHAN));
         }
         else if (nextToken == LSTOKEN(OPERATOR_LESSTHANOREQUAL))
         {
             readToken(LSTOKEN(OPERATOR_LESSTHANOREQUAL));
             right = parseShiftExpression();
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_LESSTHANOREQUAL));
         }
         else if (nextToken == LSTOKEN(OPERATOR_GREATERTHANOREQUAL))
         {
             readToken(LSTOKEN(OPERATOR_GREATERTHANOREQUAL));
             right = parseShiftExpression();
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_GREATERTHANOREQUAL));
         }
         else if (nextToken == LSTOKEN(KEYWORD_INSTANCEOF))
@@ -1471,7 +1475,7 @@ Expression *Parser::parseRelationalExpression(bool inFlag)
             // the expression treated as a primary expression as these
             // get transformed to a system.reflection.Type by the compiler
             right->primaryExpression = false;
-            left = new BinaryOperatorExpression(left, right,
+            left = new (arena) BinaryOperatorExpression(left, right,
                                                 LSTOKEN(KEYWORD_INSTANCEOF));
         }
         else if (nextToken == LSTOKEN(KEYWORD_IS))
@@ -1480,7 +1484,7 @@ Expression *Parser::parseRelationalExpression(bool inFlag)
             right = parseShiftExpression();
             // see note on KEYWORD_INSTANCEOF above
             right->primaryExpression = false;
-            left = new BinaryOperatorExpression(left, right,
+            left = new (arena) BinaryOperatorExpression(left, right,
                                                 LSTOKEN(KEYWORD_IS));
         }
         else if (nextToken == LSTOKEN(KEYWORD_AS))
@@ -1489,14 +1493,14 @@ Expression *Parser::parseRelationalExpression(bool inFlag)
             right = parseShiftExpression();
             // see note on KEYWORD_INSTANCEOF above
             right->primaryExpression = false;
-            left = new BinaryOperatorExpression(left, right,
+            left = new (arena) BinaryOperatorExpression(left, right,
                                                 LSTOKEN(KEYWORD_AS));
         }
         else if (inFlag && (nextToken == LSTOKEN(KEYWORD_IN)))
         {
             readToken(LSTOKEN(KEYWORD_IN));
             right = parseShiftExpression();
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(KEYWORD_IN));
         }
         else
@@ -1519,28 +1523,28 @@ Expression *Parser::parseEqualityExpression(bool inFlag)
         {
             readToken(LSTOKEN(OPERATOR_EQUALEQUAL));
             right = parseRelationalExpression(inFlag);
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_EQUALEQUAL));
         }
         else if (nextToken == LSTOKEN(OPERATOR_NOTEQUAL))
         {
             readToken(LSTOKEN(OPERATOR_NOTEQUAL));
             right = parseRelationalExpression(inFlag);
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_NOTEQUAL));
         }
         else if (nextToken == LSTOKEN(OPERATOR_EQUALEQUALEQUAL))
         {
             readToken(LSTOKEN(OPERATOR_EQUALEQUALEQUAL));
             right = parseRelationalExpression(inFlag);
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_EQUALEQUALEQUAL));
         }
         else if (nextToken == LSTOKEN(OPERATOR_NOTEQUALEQUAL))
         {
             readToken(LSTOKEN(OPERATOR_NOTEQUALEQUAL));
             right = parseRelationalExpression(inFlag);
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_NOTEQUALEQUAL));
         }
         else
@@ -1563,7 +1567,7 @@ Expression *Parser::parseBitwiseAndExpression(bool inFlag)
         {
             readToken(LSTOKEN(OPERATOR_BITWISEAND));
             right = parseEqualityExpression(inFlag);
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_BITWISEAND));
         }
         else
@@ -1586,7 +1590,7 @@ Expression *Parser::parseBitwiseXorExpression(bool inFlag)
         {
             readToken(LSTOKEN(OPERATOR_BITWISEXOR));
             right = parseBitwiseAndExpression(inFlag);
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_BITWISEXOR));
         }
         else
@@ -1609,7 +1613,7 @@ Expression *Parser::parseBitwiseOrExpression(bool inFlag)
         {
             readToken(LSTOKEN(OPERATOR_BITWISEOR));
             right = parseBitwiseXorExpression(inFlag);
-            left  = new BinaryOperatorExpression(left, right,
+            left  = new (arena) BinaryOperatorExpression(left, right,
                                                  LSTOKEN(OPERATOR_BITWISEOR));
         }
         else
@@ -1632,7 +1636,7 @@ Expression *Parser::parseLogicalAndExpression(bool inFlag)
         {
             readToken(LSTOKEN(OPERATOR_LOGICALAND));
             right = parseBitwiseOrExpression(inFlag);
-            left  = new LogicalAndExpression(left, right,
+            left  = new (arena) LogicalAndExpression(left, right,
                                              LSTOKEN(OPERATOR_LOGICALAND));
         }
         else
@@ -1655,7 +1659,7 @@ Expression *Parser::parseLogicalOrExpression(bool inFlag)
         {
             readToken(LSTOKEN(OPERATOR_LOGICALOR));
             right = parseLogicalAndExpression(inFlag);
-            left  = new LogicalOrExpression(left, right,
+            left  = new (arena) LogicalOrExpression(left, right,
                                             LSTOKEN(OPERATOR_LOGICALOR));
         }
         else
@@ -1678,7 +1682,7 @@ Expression *Parser::parseConditionalExpression(bool inFlag)
         readToken(LSTOKEN(OPERATOR_COLON));
         Expression *falseExpression = parseAssignmentExpression(inFlag);
 
-        return new ConditionalExpression(expression, trueExpression,
+        return new (arena) ConditionalExpression(expression, trueExpression,
                                          falseExpression);
     }
     else
@@ -1696,7 +1700,7 @@ Expression *Parser::parseAssignmentExpression(bool inFlag, bool parseComma)
     if (nextToken == LSTOKEN(OPERATOR_ASSIGNMENT))
     {
         readToken();
-        return new AssignmentExpression(left, parseAssignmentExpression(inFlag));
+        return new (arena) AssignmentExpression(left, parseAssignmentExpression(inFlag));
     }
     else if ((nextToken == LSTOKEN(OPERATOR_MULTIPLYASSIGNMENT)) ||
              (nextToken == LSTOKEN(OPERATOR_DIVIDEASSIGNMENT)) ||
@@ -1712,13 +1716,13 @@ Expression *Parser::parseAssignmentExpression(bool inFlag, bool parseComma)
     {
         Token *op = nextToken;
         readToken();
-        return new AssignmentOperatorExpression(left,
+        return new (arena) AssignmentOperatorExpression(left,
                                                 parseAssignmentExpression(inFlag), op);
     }
     else if (parseComma && (nextToken == LSTOKEN(OPERATOR_COMMA)))
     {
         // multiple assignment
-        MultipleAssignmentExpression *ma = new MultipleAssignmentExpression();
+        MultipleAssignmentExpression *ma = new (arena) MultipleAssignmentExpression();
         ma->left.push_back(left);
 
         while (nextToken == LSTOKEN(OPERATOR_COMMA))
@@ -1771,7 +1775,7 @@ Expression *Parser::parseExpression(bool inFlag)
         {
             readToken(LSTOKEN(OPERATOR_COMMA));
             Expression *right = parseAssignmentExpression(inFlag);
-            left = new BinaryOperatorExpression(left, right,
+            left = new (arena) BinaryOperatorExpression(left, right,
                                                 LSTOKEN(OPERATOR_COMMA));
         }
         else
@@ -1794,7 +1798,7 @@ Statement *Parser::parseDoStatement()
     expression = parseExpression(true);
     readToken(LSTOKEN(OPERATOR_CLOSEPAREN));
 
-    return new DoStatement(statement, expression);
+    return new (arena) DoStatement(statement, expression);
 }
 
 
@@ -1893,26 +1897,26 @@ VariableDeclaration *Parser::parseVariableDeclaration(bool inFlag,
             // default initializers
             if ((typeString == "system.Number") || (typeString == "Number"))
             {
-                initializer = new NumberLiteral(0.0);
+                initializer = new (arena) NumberLiteral(0.0);
             }
             else if ((typeString == "system.Boolean") || (typeString == "Boolean"))
             {
-                initializer = new BooleanLiteral(false);
+                initializer = new (arena) BooleanLiteral(false);
             }
             else if ((typeString == "system.String") || (typeString == "String"))
             {
-                initializer = new NullLiteral();
+                initializer = new (arena) NullLiteral();
             }
             else
             {
-                initializer = new NullLiteral();
+                initializer = new (arena) NullLiteral();
             }
 
             defaultInitializer = true;
         }
     }
 
-    VariableDeclaration *vd = new VariableDeclaration(identifier, initializer,
+    VariableDeclaration *vd = new (arena) VariableDeclaration(identifier, initializer,
                                                       sawPublic, sawProtected, sawStatic, findMetaTag(curTags, "Native") != NULL);
 
     vd->defaultInitializer = defaultInitializer;
@@ -2025,13 +2029,13 @@ Statement *Parser::parseForStatement()
             readToken(LSTOKEN(OPERATOR_CLOSEPAREN));
 
             // 'for' '(' ... 'in' ... ')' Statement
-            statement = new ForInStatement(variable, expression,
+            statement = new (arena) ForInStatement(variable, expression,
                                            parseStatement(), foreach);
             break;
 
         case 4:
             // 'for' '(' 'var' VariableDeclarationList
-            ve = new VariableExpression();
+            ve = new (arena) VariableExpression();
 
             if (!ve->declarations)
             {
@@ -2071,7 +2075,7 @@ Statement *Parser::parseForStatement()
             readToken(LSTOKEN(OPERATOR_CLOSEPAREN));
 
             // 'for' '(' ... ';' ... ';' ... ')' Statement
-            statement = new ForStatement(initial, condition, increment,
+            statement = new (arena) ForStatement(initial, condition, increment,
                                          parseStatement());
             break;
         }
@@ -2100,7 +2104,7 @@ Statement *Parser::parseIfStatement()
         falseStatement = parseStatement();
     }
 
-    return new IfStatement(expression, trueStatement, falseStatement);
+    return new (arena) IfStatement(expression, trueStatement, falseStatement);
 }
 
 
@@ -2131,13 +2135,13 @@ Statement *Parser::parseReturnStatement()
         }
     }
 
-    return new ReturnStatement(result);
+    return new (arena) ReturnStatement(result);
 }
 
 
 Statement *Parser::parseSwitchStatement()
 {
-    SwitchStatement *ss         = new SwitchStatement();
+    SwitchStatement *ss         = new (arena) SwitchStatement();
     bool            defaultSeen = false;
 
     readToken(LSTOKEN(KEYWORD_SWITCH));
@@ -2182,7 +2186,7 @@ Statement *Parser::parseSwitchStatement()
             caseStatements.push_back(parseStatement());
         }
 
-        CaseStatement *cs = new CaseStatement();
+        CaseStatement *cs = new (arena) CaseStatement();
 
         cs->expression = caseExpression;
 
@@ -2234,7 +2238,7 @@ Statement *Parser::parseThrowStatement()
 
     warn("throw is currently not supported in LoomScript. For now, throw is rewritten to be Debug.assert!");
 
-    return new ThrowStatement(parseExpression(true));
+    return new (arena) ThrowStatement(parseExpression(true));
 }
 
 
@@ -2271,7 +2275,7 @@ Statement *Parser::parseTryStatement()
         finallyBlock = parseBlockStatement();
     }
 
-    return new TryStatement(tryBlock, catchVar, catchBlock, finallyBlock);
+    return new (arena) TryStatement(tryBlock, catchVar, catchBlock, finallyBlock);
 }
 
 
@@ -2299,7 +2303,7 @@ Statement *Parser::parseVariableStatement()
         decls->back()->isConst = isConst;
     }
 
-    return new VariableStatement(decls);
+    return new (arena) VariableStatement(decls);
 }
 
 
@@ -2314,7 +2318,7 @@ Statement *Parser::parseWhileStatement()
     readToken(LSTOKEN(OPERATOR_CLOSEPAREN));
     statement = parseStatement();
 
-    return new WhileStatement(expression, statement);
+    return new (arena) WhileStatement(expression, statement);
 }
 
 
@@ -2329,7 +2333,7 @@ Statement *Parser::parseWithStatement()
     readToken(LSTOKEN(OPERATOR_CLOSEPAREN));
     statement = parseStatement();
 
-    return new WithStatement(expression, statement);
+    return new (arena) WithStatement(expression, statement);
 }
 
 
@@ -2357,12 +2361,12 @@ Statement *Parser::parseExpressionStatement()
         (nextToken == LSTOKEN(OPERATOR_COLON)))
     {
         readToken(LSTOKEN(OPERATOR_COLON));
-        return new LabelledStatement((Identifier *)expression,
+        return new (arena) LabelledStatement((Identifier *)expression,
                                      parseStatement());
     }
     else
     {
-        return new ExpressionStatement(expression);
+        return new (arena) ExpressionStatement(expression);
     }
 }
 
@@ -2416,7 +2420,7 @@ void Parser::parsePath(utArray<utString>& path)
 
 Statement *Parser::parseImportStatement()
 {
-    ImportStatement *import = new ImportStatement();
+    ImportStatement *import = new (arena) ImportStatement();
 
     readToken(LSTOKEN(KEYWORD_IMPORT));
 
@@ -2456,7 +2460,7 @@ Statement *Parser::parseImportStatement()
 
 Statement *Parser::parsePackageDeclaration()
 {
-    PackageDeclaration *pkg = new PackageDeclaration();
+    PackageDeclaration *pkg = new (arena) PackageDeclaration();
 
     readToken(LSTOKEN(KEYWORD_PACKAGE));
 
@@ -2567,7 +2571,7 @@ void Parser::parseMetaTag()
 
 Statement *Parser::parseEnumStatement()
 {
-    ClassDeclaration *cls = new ClassDeclaration();
+    ClassDeclaration *cls = new (arena) ClassDeclaration();
 
     cls->metaTags = curTags;
     curTags.clear();
@@ -2581,7 +2585,7 @@ Statement *Parser::parseEnumStatement()
 
     cls->isPublic = sawPublic;
     cls->isEnum   = true;
-    cls->extends  = new Identifier("system.Object");
+    cls->extends  = new (arena) Identifier("system.Object");
 
     readToken(LSTOKEN(OPERATOR_OPENBRACE));
 
@@ -2600,12 +2604,12 @@ Statement *Parser::parseEnumStatement()
         }
         else
         {
-            nliteral = new NumberLiteral(cvalue);
+            nliteral = new (arena) NumberLiteral(cvalue);
         }
 
         cvalue = (int)(nliteral->value + 1);
 
-        VariableDeclaration *vd = new VariableDeclaration(ident, nliteral,
+        VariableDeclaration *vd = new (arena) VariableDeclaration(ident, nliteral,
                                                           true, false, true, false);
 
         vd->defaultInitializer = false;
@@ -2616,7 +2620,7 @@ Statement *Parser::parseEnumStatement()
 
         utArray<VariableDeclaration *> *decls = new utArray<VariableDeclaration *>();
         decls->push_back(vd);
-        VariableStatement *statement = new VariableStatement(decls);
+        VariableStatement *statement = new (arena) VariableStatement(decls);
         cls->statements->push_back(statement);
 
         if (nextToken == LSTOKEN(OPERATOR_COMMA))
@@ -2633,7 +2637,7 @@ Statement *Parser::parseEnumStatement()
 
 Statement *Parser::parseClassDeclaration()
 {
-    ClassDeclaration *cls = new ClassDeclaration();
+    ClassDeclaration *cls = new (arena) ClassDeclaration();
 
     cls->metaTags = curTags;
     curTags.clear();
@@ -2703,7 +2707,7 @@ Statement *Parser::parseClassDeclaration()
 
             if (nextToken == LSTOKEN(KEYWORD_VOID))
             {
-                cls->delegateReturnType = new Identifier("Void");
+                cls->delegateReturnType = new (arena) Identifier("Void");
                 readToken();
             }
             else
@@ -2713,10 +2717,10 @@ Statement *Parser::parseClassDeclaration()
         }
         else
         {
-            cls->delegateReturnType = new Identifier("Void");
+            cls->delegateReturnType = new (arena) Identifier("Void");
         }
 
-        cls->extends = new Identifier("BaseDelegate");
+        cls->extends = new (arena) Identifier("BaseDelegate");
 
         return cls;
     }
@@ -2733,7 +2737,7 @@ Statement *Parser::parseClassDeclaration()
         {
             if (cls->name->string != "Object")
             {
-                cls->extends = new Identifier("Object");
+                cls->extends = new (arena) Identifier("Object");
             }
         }
     }
@@ -3001,7 +3005,7 @@ Statement *Parser::parseStatement()
     if (nextToken == LSTOKEN(OPERATOR_SEMICOLON))
     {
         readToken(LSTOKEN(OPERATOR_SEMICOLON));
-        statement     = new EmptyStatement();
+        statement     = new (arena) EmptyStatement();
         skipSemiColon = true;
     }
     else if (nextToken == LSTOKEN(OPERATOR_OPENBRACE))
@@ -3158,6 +3162,8 @@ CompilationUnit *Parser::parseCompilationUnit(BuildInfo *buildInfo)
 {
     CompilationUnit *cunit = new CompilationUnit();
 
+    cunit->arena = arena;
+
     this->buildInfo  = buildInfo;
     cunit->buildInfo = buildInfo;
 
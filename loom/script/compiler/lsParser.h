@@ -62,6 +62,9 @@ private:
 
     ClassDeclaration *curClass;
 
+    // owned by the compilation unit once parsed
+    ASTArena *arena;
+
     void error(const char *message, int lineNumber = -1);
     void warn(const char *message);
 
@@ -18,6 +18,7 @@
  * ===========================================================================
  */
 
+#include <string.h>
 #include "loom/script/compiler/lsToken.h"
 
 UT_IMPLEMENT_SINGLETON(LS::Tokens);
@@ -78,11 +79,17 @@ void Token::initKeyword(const char *value)
 
 Token *Token::getKeyword(const char *t)
 {
-    utHashedString svalue(t);
+    return getKeyword(t, utHashedString::hash(t));
+}
+
 
-    Token **tt = sKeywords.get(svalue.hash());
+Token *Token::getKeyword(const char *t, UThash hash)
+{
+    Token **tt = sKeywords.get(hash);
 
-    if (tt)
+    // the hash only selects the candidate, so an identifier which happens
+    // to collide with a keyword is still an identifier
+    if (tt && !strcmp((*tt)->value.str().c_str(), t))
     {
         return *tt;
     }
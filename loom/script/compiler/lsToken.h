@@ -24,6 +24,7 @@
 #include "loom/common/utils/utTypes.h"
 #include "loom/common/utils/utSingleton.h"
 #include "loom/common/utils/utString.h"
+#include "loom/script/compiler/lsASTArena.h"
 
 namespace LS {
 enum TokenType
@@ -39,7 +40,7 @@ enum TokenType
 
 #define LSTOKEN(x)    & tokens->x
 
-class Token {
+class Token : public ASTArenaObject {
 private:
 
     static utHashTable<utIntHashKey, Token *>        sKeywords;
@@ -64,6 +65,9 @@ public:
 
     static Token *getKeyword(const char *t);
 
+    // as above with the utHashedString hash of t already computed
+    static Token *getKeyword(const char *t, UThash hash);
+
     /**
      * Return true is this token represents whitespace.
      */
@@ -412,19 +412,10 @@ void TypeCompiler::generateConstructor(FunctionLiteral *function,
         }
         else if (v->initializer)
         {
-            ExpDesc vname;
-
-            BC::initExpDesc(&vname, VKNUM, 0);
-
-            setnumV(&vname.u.nval, v->memberInfo->getOrdinal());
-
             ExpDesc ethis;
             BC::singleVar(cs, &ethis, "this");
 
-            BC::expToNextReg(&funcState, &ethis);
-            BC::expToNextReg(&funcState, &vname);
-            BC::expToVal(&funcState, &vname);
-            BC::indexed(&funcState, &ethis, &vname);
+            indexOrdinal(&ethis, v->memberInfo->getOrdinal());
 
             v->initializer->visitExpression(this);
             BC::storeVar(&funcState, &ethis, &v->initializer->e);
@@ -728,9 +719,7 @@ Statement *TypeCompiler::visit(ForStatement *statement)
 
 Statement *TypeCompiler::visit(ForInStatement *statement)
 {
-    FuncState *fs   = cs->fs;
-    int       nvars = 0;
-    int       line;
+    FuncState *fs = cs->fs;
 
     char forIteratorName[256];
 
@@ -774,94 +763,191 @@ Statement *TypeCompiler::visit(ForInStatement *statement)
         lmAssert(0, "Unknown variable statement in for..in initializer");
     }
 
+    if (statement->expression->type->getFullName() == "system.Vector")
+    {
+        vectorLoop(statement, vname, forIteratorName);
+    }
+    else
+    {
+        dictionaryLoop(statement, vname, forIteratorName);
+    }
+
+    if (forIteratorName[0])
+    {
+        // we need to store to this block's var
+        BC::singleVar(cs, &v, vname);
+        BC::singleVar(cs, &fv, forIteratorName);
+        BC::storeVar(fs, &v, &fv);
+    }
+
+    currentForInIteratorName = prevForInIteratorName;
+
+    return statement;
+}
+
+
+// Vectors are iterated with an index register instead of a generator
+// call per element. The element table and length are read again every
+// iteration as the body may push to, clear or sort the vector.
+void TypeCompiler::vectorLoop(ForInStatement *statement, const char *vname,
+                              const char *forIteratorName)
+{
+    FuncState *fs = cs->fs;
+
+    ExpDesc v;
+    ExpDesc fv;
+
     BlockCnt forbl;
     enterBlock(fs, &forbl, 1); /* scope for loop and control variables */
 
     int base = fs->freereg;
 
     /* create control variables */
-    BC::newLocalVar(cs, "(for generator)", nvars++);
-    BC::newLocalVar(cs, "(for state)", nvars++);
-    BC::newLocalVar(cs, "(for control)", nvars++);
+    BC::newLocalVar(cs, "(for vector)", 0);
+    BC::newLocalVar(cs, "(for index)", 1);
+    BC::newLocalVar(cs, "(for table)", 2);
 
-    //TODO: It would be nice to have a way to iterate pairs
-    if (statement->foreach)
-    {
-        BC::newLocalVar(cs, "__ls_key", nvars++);
-    }
+    statement->expression->visitExpression(this);
+    ExpDesc vector = statement->expression->e;
+    BC::expToNextReg(fs, &vector);
 
-    /* create declared variables */
-    BC::newLocalVar(cs, vname, nvars++);
+    ExpDesc index;
+    BC::initExpDesc(&index, VKNUM, 0);
+    index.u.nval = 0;
+    BC::expToNextReg(fs, &index);
 
-    line = lineNumber;
+    BC::nil(fs, fs->freereg, 1);
+    BC::reserveRegs(fs, 1);
 
-    bool isVector = false;
+    BC::adjustLocalVars(cs, 3); /* control variables */
 
-    if (statement->expression->type->getFullName() == "system.Vector")
-    {
-        isVector = true;
-    }
+    int loop = BC::getLabel(fs);
+
+    // (for table) = (for vector)[LSINDEXVECTOR]
+    ExpDesc table;
+    ExpDesc key;
+    BC::initExpDesc(&table, VLOCAL, base);
+    BC::initExpDesc(&key, VKNUM, 0);
+    key.u.nval = LSINDEXVECTOR;
+    BC::indexed(fs, &table, &key);
+    BC::expToReg(fs, &table, base + 2);
 
-    ExpDesc pairs;
+    // exit once (for index) >= (for table)[LSINDEXVECTORLENGTH]
+    ExpDesc length;
+    BC::initExpDesc(&length, VLOCAL, base + 2);
+    BC::initExpDesc(&key, VKNUM, 0);
+    key.u.nval = LSINDEXVECTORLENGTH;
+    BC::indexed(fs, &length, &key);
+    BC::expToNextReg(fs, &length);
 
-    if (isVector)
+    int loopexit = BC::condJump(fs, OP_LT, 0, base + 1, length.u.s.info);
+    BC::freeExp(fs, &length);
+
+    /* forbody -> DO block */
+    BlockCnt bl;
+    enterBlock(fs, &bl, 0); /* scope for declared variables */
+
+    BC::newLocalVar(cs, vname, 0);
+
+    ExpDesc value;
+    BC::initExpDesc(&value, VLOCAL, base + 1);
+
+    if (statement->foreach)
     {
-        BC::singleVar(cs, &pairs, "__lua_ipairs");
+        // the element, otherwise the index itself
+        ExpDesc element;
+        BC::initExpDesc(&element, VLOCAL, base + 2);
+        BC::indexed(fs, &element, &value);
+        value = element;
     }
-    else
+
+    BC::expToNextReg(fs, &value);
+    BC::adjustLocalVars(cs, 1);
+
+    block(cs, statement->statement);
+
+    if (forIteratorName[0])
     {
-        BC::singleVar(cs, &pairs, "__lua_pairs");
+        // we need to store
+        BC::singleVar(cs, &v, vname);
+        BC::singleVar(cs, &fv, forIteratorName);
+        BC::storeVar(fs, &fv, &v);
     }
 
-    BC::expToNextReg(fs, &pairs);
+    leaveBlock(fs); /* end of scope for declared variables */
 
-    ExpDesc arg;
+    BC::patchToHere(fs, forbl.continuelist);
 
-    int cbase = pairs.u.s.info; /* base register for call */
+    // (for index) = (for index) + 1
+    ExpDesc one;
+    BC::initExpDesc(&index, VLOCAL, base + 1);
+    BC::initExpDesc(&one, VKNUM, 0);
+    one.u.nval = 1;
+    BC::infix(fs, OPR_ADD, &index);
+    BC::posFix(fs, OPR_ADD, &index, &one);
 
-    statement->expression->visitExpression(this);
-    arg = statement->expression->e;
-    ExpDesc right;
+    ExpDesc counter;
+    BC::initExpDesc(&counter, VLOCAL, base + 1);
+    BC::storeVar(fs, &counter, &index);
 
-    if (isVector)
-    {
-        // we pass the instance itself
-    }
-    else
-    {
-        BC::initExpDesc(&right, VKNUM, 0);
-        setnumV(&right.u.nval, LSINDEXDICTPAIRS);
+    BC::patchList(fs, BC::jump(fs), loop);
 
-        BC::expToNextReg(fs, &arg);
-        BC::expToNextReg(fs, &right);
-        BC::expToVal(fs, &right);
-        BC::indexed(fs, &arg, &right);
-    }
+    leaveBlock(fs);
 
-    BC::setMultRet(fs, &arg);
+    BC::patchToHere(fs, loopexit);
+}
 
-    int nparams = 0;
 
-    if (hasmultret(arg.k))
-    {
-        nparams = LUA_MULTRET; /* open call */
-    }
-    else
+// Dictionaries are iterated by next on the pairs table, the generator,
+// state and control variables are set up directly without calling pairs.
+void TypeCompiler::dictionaryLoop(ForInStatement *statement, const char *vname,
+                                  const char *forIteratorName)
+{
+    FuncState *fs   = cs->fs;
+    int       nvars = 0;
+    int       line;
+
+    ExpDesc v;
+    ExpDesc fv;
+
+    BlockCnt forbl;
+    enterBlock(fs, &forbl, 1); /* scope for loop and control variables */
+
+    int base = fs->freereg;
+
+    /* create control variables */
+    BC::newLocalVar(cs, "(for generator)", nvars++);
+    BC::newLocalVar(cs, "(for state)", nvars++);
+    BC::newLocalVar(cs, "(for control)", nvars++);
+
+    if (statement->foreach)
     {
-        if (arg.k != VVOID)
-        {
-            BC::expToNextReg(fs, &arg); /* close last argument */
-        }
-        nparams = fs->freereg - (cbase + 1);
+        BC::newLocalVar(cs, "__ls_key", nvars++);
     }
 
-    BC::initExpDesc(&pairs, VCALL,
-                    BC::codeABC(fs, OP_CALL, cbase, nparams + 1,
-                                2 /* returns 1 values */));
+    /* create declared variables */
+    BC::newLocalVar(cs, vname, nvars++);
+
+    line = lineNumber;
+
+    ExpDesc next;
+    BC::singleVar(cs, &next, "__lua_next");
+    BC::expToNextReg(fs, &next);
 
-    fs->freereg = cbase + 1; /* call remove function and arguments and leaves*/
+    statement->expression->visitExpression(this);
+    ExpDesc pairs = statement->expression->e;
+
+    ExpDesc right;
+    BC::initExpDesc(&right, VKNUM, 0);
+    setnumV(&right.u.nval, LSINDEXDICTPAIRS);
 
-    BC::adjustAssign(cs, 3, 1, &pairs);
+    BC::expToNextReg(fs, &pairs);
+    BC::expToNextReg(fs, &right);
+    BC::expToVal(fs, &right);
+    BC::indexed(fs, &pairs, &right);
+
+    /* next, dictionary[LSINDEXDICTPAIRS], nil */
+    BC::adjustAssign(cs, 3, 2, &pairs);
 
     BC::checkStack(fs, 3); /* extra space to call generator */
 
@@ -897,18 +983,6 @@ Statement *TypeCompiler::visit(ForInStatement *statement)
     BC::patchList(fs, BC::jump(fs), prep + 1);
 
     leaveBlock(fs);
-
-    if (forIteratorName[0])
-    {
-        // we need to store to this block's var
-        BC::singleVar(cs, &v, vname);
-        BC::singleVar(cs, &fv, forIteratorName);
-        BC::storeVar(fs, &v, &fv);
-    }
-
-    currentForInIteratorName = prevForInIteratorName;
-
-    return statement;
 }
 
 
@@ -1084,11 +1158,155 @@ Statement *TypeCompiler::visit(CaseStatement *statement)
 }
 
 
+// Jumps to the clause the lookup left in reg, a binary search over the
+// sorted clauses it can be
+void TypeCompiler::switchDispatch(int reg, utArray<int>& clauses, int lo, int hi,
+                                  utArray<int>& jumps)
+{
+    FuncState *fs = cs->fs;
+
+    if (lo == hi)
+    {
+        BC::concat(fs, &jumps[clauses[lo]], BC::jump(fs));
+        return;
+    }
+
+    int mid = (lo + hi + 1) / 2;
+
+    ExpDesc clause;
+    BC::initExpDesc(&clause, VKNUM, 0);
+    clause.u.nval = clauses[mid];
+
+    int below = BC::condJump(fs, OP_LT, 1, reg, BC::expToRK(fs, &clause));
+    BC::freeExp(fs, &clause);
+
+    switchDispatch(reg, clauses, mid, hi, jumps);
+
+    BC::patchToHere(fs, below);
+
+    switchDispatch(reg, clauses, lo, mid - 1, jumps);
+}
+
+
+void TypeCompiler::switchLookup(SwitchStatement *statement, utArray<int>& targets,
+                                int noMatch)
+{
+    FuncState *fs = cs->fs;
+    BlockCnt  bl;
+
+    enterBlock(fs, &bl, 1);
+
+    statement->expression->visitExpression(this);
+    ExpDesc swv = statement->expression->e;
+    BC::expToNextReg(fs, &swv);
+
+    int reg = swv.u.s.info;
+
+    // the table is built on the first run and kept in the environment
+    utString name = nextSwitchLookupName();
+
+    ExpDesc lookup;
+    BC::singleVar(cs, &lookup, name.c_str());
+    BC::expToNextReg(fs, &lookup);
+
+    int built = BC::condJump(fs, OP_TEST, reg + 1, 0, 1);
+
+    BC::codeABC(fs, OP_NEWTABLE, reg + 1, 0, 0);
+
+    for (UTsize i = 0; i < targets.size(); i++)
+    {
+        if (targets[i] == -1)
+        {
+            continue;
+        }
+
+        Expression *literal = statement->clauses->at(i)->expression;
+        literal->visitExpression(this);
+
+        ExpDesc entry;
+        BC::initExpDesc(&entry, VNONRELOC, reg + 1);
+        BC::indexed(fs, &entry, &literal->e);
+
+        ExpDesc clause;
+        BC::initExpDesc(&clause, VKNUM, 0);
+        clause.u.nval = targets[i];
+
+        BC::storeVar(fs, &entry, &clause);
+        fs->freereg = reg + 2;
+    }
+
+    BC::singleVar(cs, &lookup, name.c_str());
+    BC::initExpDesc(&swv, VNONRELOC, reg + 1);
+    BC::storeVar(fs, &lookup, &swv);
+    fs->freereg = reg + 2;
+
+    BC::patchToHere(fs, built);
+
+    // the clause to enter, nil when nothing matches
+    BC::codeABC(fs, OP_GETTABLE, reg + 1, reg + 1, reg);
+
+    int unmatched = BC::condJump(fs, OP_TEST, reg + 1, 0, 0);
+
+    // targets never go below an earlier one, so the clauses come sorted
+    utArray<int> clauses;
+    utArray<int> jumps;
+
+    for (UTsize i = 0; i < targets.size(); i++)
+    {
+        jumps.push_back(NO_JUMP);
+
+        if ((targets[i] != -1) && (clauses.find(targets[i]) == UT_NPOS))
+        {
+            clauses.push_back(targets[i]);
+        }
+    }
+
+    switchDispatch(reg + 1, clauses, 0, (int)clauses.size() - 1, jumps);
+
+    fs->freereg = fs->nactvar; /* free registers */
+
+    // the clauses follow each other so they fall through
+    for (UTsize i = 0; i < statement->clauses->size(); i++)
+    {
+        BC::patchToHere(fs, jumps[i]);
+
+        if ((int)i == noMatch)
+        {
+            BC::patchToHere(fs, unmatched);
+        }
+
+        BlockCnt cbl;
+        enterBlock(fs, &cbl, 0);
+
+        chunk(statement->clauses->at(i)->statements);
+
+        lua_assert(cbl.breaklist == NO_JUMP);
+        leaveBlock(fs);
+    }
+
+    leaveBlock(fs);
+
+    if (noMatch == (int)statement->clauses->size())
+    {
+        BC::patchToHere(fs, unmatched);
+    }
+}
+
+
 Statement *TypeCompiler::visit(SwitchStatement *statement)
 {
     FuncState *fs = cs->fs;
     BlockCnt  bl;
 
+    utArray<int> targets;
+    int          noMatch;
+
+    if (planSwitchLookup(statement, targets, noMatch))
+    {
+        switchLookup(statement, targets, noMatch);
+        return statement;
+    }
+
     enterBlock(fs, &bl, 1);
 
     ExpDesc swv;
@@ -1407,18 +1625,33 @@ Expression *TypeCompiler::visit(BinaryOperatorExpression *expression)
     // it can't concat (which has strict rules, for instance cannot concat nil)
     if ((op == OPR_CONCAT) && ((eleft->type->getFullName() == "system.String") || (eright->type->getFullName() == "system.String")))
     {
-        // coerce left to string, must be done even for string types as they may be null
-        coerceToString(eleft);
+        // flatten chains like a + b + c so every operand is coerced once into
+        // consecutive registers and a single concat builds the result,
+        // instead of interning a string per step
+        utArray<Expression *> operands;
+        collectConcatOperands(eleft, operands);
+        collectConcatOperands(eright, operands);
 
-        BC::infix(cs->fs, op, &eleft->e);
+        for (UTsize i = 0; i < operands.size(); i++)
+        {
+            // coerce to string, must be done even for string types as they may be null
+            coerceToString(operands[i]);
 
-        // coerce right to string, must be done even for string types as they may be null
-        coerceToString(eright);
+            if (i < operands.size() - 1)
+            {
+                BC::infix(cs->fs, op, &operands[i]->e);
+            }
+        }
+
+        // fold from the right, each concat is merged into the one before
+        // it as the operands are in consecutive registers
+        for (int i = (int)operands.size() - 2; i >= 0; i--)
+        {
+            BC::posFix(cs->fs, op, &operands[i]->e, &operands[i + 1]->e);
+        }
 
-        // and the binary op
-        BC::posFix(cs->fs, op, &eleft->e, &eright->e);
         // save off expression and return
-        expression->e = eleft->e;
+        expression->e = operands[0]->e;
 
         return expression;
     }
@@ -63,6 +63,18 @@ class TypeCompiler : public TypeCompilerBase  {
                              ConstructorInfo *method);
     void generateMethod(FunctionLiteral *function, MethodInfo *method);
 
+    // for..in and for each over a Vector or a Dictionary
+    void vectorLoop(ForInStatement *statement, const char *vname,
+                    const char *forIteratorName);
+    void dictionaryLoop(ForInStatement *statement, const char *vname,
+                        const char *forIteratorName);
+
+    // switch dispatching through a lookup table, see planSwitchLookup
+    void switchLookup(SwitchStatement *statement, utArray<int>& targets,
+                      int noMatch);
+    void switchDispatch(int reg, utArray<int>& clauses, int lo, int hi,
+                        utArray<int>& jumps);
+
     TypeCompiler()
     {
     }
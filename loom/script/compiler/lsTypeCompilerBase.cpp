@@ -904,6 +904,39 @@ Expression *TypeCompilerBase::visit(PropertyExpression *expression)
 
             bool isInterface = prop->getDeclaringType()->isInterface();
 
+            // Vector.length is read straight from the element table, which
+            // saves the getter call in loops like i < v.length
+            if (!expression->assignment && !strcmp(prop->getName(), "length") &&
+                (prop->getDeclaringType()->getFullName() == "system.Vector"))
+            {
+                int     keys[2] = { LSINDEXVECTOR, LSINDEXVECTORLENGTH };
+                ExpDesc key;
+
+                for (int i = 0; i < 2; i++)
+                {
+                    BC::initExpDesc(&key, VKNUM, 0);
+#ifdef LOOM_ENABLE_JIT
+                    setnumV(&key.u.nval, keys[i]);
+#else
+                    key.u.nval = keys[i];
+#endif
+                    BC::expToNextReg(cs->fs, &key);
+                    BC::expToVal(cs->fs, &key);
+                    BC::indexed(cs->fs, &left, &key);
+
+                    if (!i)
+                    {
+                        BC::expToNextReg(cs->fs, &left);
+                    }
+                }
+
+                expression->e = left;
+                eleft->e      = left;
+                eright->e     = key;
+
+                return expression;
+            }
+
             if (isInterface)
             {
                 utString pstring;
@@ -1055,8 +1088,16 @@ Expression *TypeCompilerBase::visit(PropertyExpression *expression)
         eright->visitExpression(this);
         right = eright->e;
 
-        // do the index
-        BC::expToNextReg(cs->fs, &right);
+        // do the index, field ordinals stay constant keys like in
+        // indexOrdinal
+        bool constantKey = !expression->arrayAccess && eright->memberInfo &&
+                           eright->memberInfo->isField() && right.k == VKNUM;
+
+        if (!constantKey)
+        {
+            BC::expToNextReg(cs->fs, &right);
+        }
+
         BC::expToVal(cs->fs, &right);
         BC::indexed(cs->fs, &left, &right);
 
@@ -1283,27 +1324,37 @@ Expression *TypeCompilerBase::visit(IncrementExpression *expression)
 }
 
 
-void TypeCompilerBase::setupVarDecl(ExpDesc             *out,
-                                    VariableDeclaration *declaration)
+void TypeCompilerBase::indexOrdinal(ExpDesc *object, int ordinal)
 {
     FuncState *fs = cs->fs;
 
-    if (declaration->classDecl)
-    {
-        // if we're either a static or instance member variable we
-        // need to store to the class or "this" table
-
-        ExpDesc vname;
+    // Loading the ordinal into a register first would force a table
+    // access with a register key, as a constant it becomes a byte key
+    // (TGETB/TSETB) for the first 256 ordinals, or an RK operand on the
+    // interpreted VM
+    ExpDesc key;
 
-        BC::initExpDesc(&vname, VKNUM, 0);
+    BC::initExpDesc(&key, VKNUM, 0);
 
 #ifdef LOOM_ENABLE_JIT
-        setnumV(&vname.u.nval, declaration->memberInfo->getOrdinal());
-
+    setnumV(&key.u.nval, ordinal);
 #else
-        vname.u.nval = declaration->memberInfo->getOrdinal();
+    key.u.nval = ordinal;
 #endif
 
+    BC::expToNextReg(fs, object);
+    BC::expToVal(fs, &key);
+    BC::indexed(fs, object, &key);
+}
+
+
+void TypeCompilerBase::setupVarDecl(ExpDesc             *out,
+                                    VariableDeclaration *declaration)
+{
+    if (declaration->classDecl)
+    {
+        // if we're either a static or instance member variable we
+        // need to store to the class or "this" table
         if (declaration->isStatic)
         {
             BC::singleVar(cs, out,
@@ -1314,10 +1365,7 @@ void TypeCompilerBase::setupVarDecl(ExpDesc             *out,
             BC::singleVar(cs, out, "this");
         }
 
-        BC::expToNextReg(fs, out);
-        BC::expToNextReg(fs, &vname);
-        BC::expToVal(fs, &vname);
-        BC::indexed(fs, out, &vname);
+        indexOrdinal(out, declaration->memberInfo->getOrdinal());
     }
     else
     {
@@ -1697,21 +1745,31 @@ Expression *TypeCompilerBase::visit(Identifier *identifier)
             BC::singleVar(cs, &ethis, "this");
         }
 
-        ExpDesc vname;
-
         lmAssert(ordinal, "Out of range ordinal");
 
-        BC::initExpDesc(&vname, VKNUM, 0);
+        // Fields keep their slot in every subclass, reads and writes
+        // index the instance directly
+        if (memberInfo->isField())
+        {
+            indexOrdinal(&ethis, ordinal);
+        }
+        else
+        {
+            ExpDesc vname;
+
+            BC::initExpDesc(&vname, VKNUM, 0);
 
 #ifdef LOOM_ENABLE_JIT
-        setnumV(&vname.u.nval, ordinal);
+            setnumV(&vname.u.nval, ordinal);
 #else
-        vname.u.nval = ordinal;
+            vname.u.nval = ordinal;
 #endif
-        BC::expToNextReg(fs, &ethis);
-        BC::expToNextReg(fs, &vname);
-        BC::expToVal(fs, &vname);
-        BC::indexed(fs, &ethis, &vname);
+            BC::expToNextReg(fs, &ethis);
+            BC::expToNextReg(fs, &vname);
+            BC::expToVal(fs, &vname);
+            BC::indexed(fs, &ethis, &vname);
+        }
+
         identifier->e = ethis;
 
         if (propertyGetCall)
@@ -1974,21 +2032,8 @@ void TypeCompilerBase::generateInstanceInitializer()
         {
             doesNothing = false;
 
-            ExpDesc vname;
-
-            BC::initExpDesc(&vname, VKNUM, 0);
-#if LOOM_ENABLE_JIT
-            setnumV(&vname.u.nval, v->memberInfo->getOrdinal());
-#else
-            vname.u.nval = v->memberInfo->getOrdinal();
-#endif
-
             BC::singleVar(cs, &ethis, "this");
-
-            BC::expToNextReg(fs, &ethis);
-            BC::expToNextReg(fs, &vname);
-            BC::expToVal(fs, &vname);
-            BC::indexed(fs, &ethis, &vname);
+            indexOrdinal(&ethis, v->memberInfo->getOrdinal());
 
             v->initializer->visitExpression(this);
             BC::storeVar(fs, &ethis, &v->initializer->e);
@@ -2184,24 +2229,11 @@ void TypeCompilerBase::storeLocalToMember(MemberInfo *memberInfo, const char *lo
         BC::singleVar(cs, &ethis, "this");
     }
 
-    ExpDesc vname;
-
     int ordinal = memberInfo->getOrdinal();
 
     lmAssert(ordinal, "Out of range ordinal");
 
-    BC::initExpDesc(&vname, VKNUM, 0);
-
-#ifdef LOOM_ENABLE_JIT
-    setnumV(&vname.u.nval, ordinal);
-#else
-    vname.u.nval = ordinal;
-#endif
-
-    BC::expToNextReg(fs, &ethis);
-    BC::expToNextReg(fs, &vname);
-    BC::expToVal(fs, &vname);
-    BC::indexed(fs, &ethis, &vname);
+    indexOrdinal(&ethis, ordinal);
 
     ExpDesc value;
     BC::singleVar(cs, &value, localVar);
@@ -2210,6 +2242,183 @@ void TypeCompilerBase::storeLocalToMember(MemberInfo *memberInfo, const char *lo
 }
 
 
+// Most operands a chain of string concatenations is flattened to, each
+// takes a register until the single concat
+#define LSCONCAT_MAXOPERANDS    32
+
+bool TypeCompilerBase::isStringConcat(Expression *expression)
+{
+    if (expression->astType != AST_BINARYOPERATOREXPRESSION)
+    {
+        return false;
+    }
+
+    BinaryOperatorExpression *binary = (BinaryOperatorExpression *)expression;
+
+    Tokens *tok = Tokens::getSingletonPtr();
+
+    if ((binary->op != &tok->OPERATOR_PLUS) && (binary->op != &tok->OPERATOR_CONCAT))
+    {
+        return false;
+    }
+
+    Type *tleft  = binary->leftExpression->type;
+    Type *tright = binary->rightExpression->type;
+
+    if (!tleft || !tright)
+    {
+        return false;
+    }
+
+    // operator overloads on the left operand are called instead
+    const char *opmethod = tok->getOperatorMethodName(binary->op);
+    if (opmethod && tleft->findMember(opmethod))
+    {
+        return false;
+    }
+
+    return (tleft->getFullName() == "system.String") || (tright->getFullName() == "system.String");
+}
+
+
+void TypeCompilerBase::collectConcatOperands(Expression *expression, utArray<Expression *>& operands)
+{
+    // concatenation is associative, so nested concatenations on either side
+    // are flattened in order, leaving a leaf in place once the register
+    // budget runs out
+    if ((operands.size() + 2 <= LSCONCAT_MAXOPERANDS) && isStringConcat(expression))
+    {
+        BinaryOperatorExpression *binary = (BinaryOperatorExpression *)expression;
+        collectConcatOperands(binary->leftExpression, operands);
+        collectConcatOperands(binary->rightExpression, operands);
+        return;
+    }
+
+    operands.push_back(expression);
+}
+
+
+// Fewest cases a switch dispatches through a lookup table with, below it
+// comparing case by case is as quick
+#define LSSWITCH_LOOKUPMINCASES    6
+
+static bool sameCaseLiteral(Expression *a, Expression *b)
+{
+    if (a->astType != b->astType)
+    {
+        return false;
+    }
+
+    if (a->astType == AST_NUMBERLITERAL)
+    {
+        return ((NumberLiteral *)a)->value == ((NumberLiteral *)b)->value;
+    }
+
+    return ((StringLiteral *)a)->string == ((StringLiteral *)b)->string;
+}
+
+
+bool TypeCompilerBase::planSwitchLookup(SwitchStatement *statement, utArray<int>& targets, int& noMatch)
+{
+    utArray<CaseStatement *> *clauses = statement->clauses;
+
+    if (!clauses)
+    {
+        return false;
+    }
+
+    int defaultClause = -1;
+    int cases         = 0;
+
+    for (UTsize i = 0; i < clauses->size(); i++)
+    {
+        Expression *e = clauses->at(i)->expression;
+
+        if (!e)
+        {
+            if (defaultClause == -1)
+            {
+                defaultClause = (int)i;
+            }
+
+            continue;
+        }
+
+        if ((e->astType != AST_NUMBERLITERAL) && (e->astType != AST_STRINGLITERAL))
+        {
+            return false;
+        }
+
+        if ((e->astType == AST_STRINGLITERAL) && e->memberInfo)
+        {
+            return false;
+        }
+
+        cases++;
+    }
+
+    if (cases < LSSWITCH_LOOKUPMINCASES)
+    {
+        return false;
+    }
+
+    targets.clear();
+
+    for (UTsize i = 0; i < clauses->size(); i++)
+    {
+        Expression *e = clauses->at(i)->expression;
+
+        int target = (int)i;
+
+        if (!e)
+        {
+            target = -1;
+        }
+        else if ((defaultClause != -1) && (defaultClause < (int)i))
+        {
+            // clauses are tried in order, so a default ahead of the
+            // case is entered first
+            target = defaultClause;
+        }
+
+        // only the first of repeated literals can match
+        for (UTsize j = 0; e && j < i; j++)
+        {
+            Expression *earlier = clauses->at(j)->expression;
+
+            if (earlier && sameCaseLiteral(earlier, e))
+            {
+                target = -1;
+                break;
+            }
+        }
+
+        targets.push_back(target);
+    }
+
+    noMatch = (defaultClause != -1) ? defaultClause : (int)clauses->size();
+
+    return true;
+}
+
+
+utString TypeCompilerBase::nextSwitchLookupName()
+{
+    // method environments fall back to the class tables, so the name is
+    // unique across classes
+    char name[32];
+
+    snprintf(name, sizeof(name), "%i", switchLookups++);
+
+    utString lookupName = "__ls_switch_";
+    lookupName += cls->type->getFullName();
+    lookupName += "_";
+    lookupName += name;
+
+    return lookupName;
+}
+
+
 void TypeCompilerBase::coerceToString(Expression *expression)
 {
     ExpDesc _object;
@@ -80,9 +80,12 @@ protected:
     // (LJ_GC64), this is defined by LJ_FR2 in LuaJIT.
     int twoSlotFrameInfo;
 
+    // switch lookup tables named so far
+    int switchLookups;
+
     TypeCompilerBase() : cls(NULL), vm(NULL), L(NULL), cs(NULL), currentMethod(NULL),
                          currentMethodCoroutine(false), inLocalFunction(0), currentFunctionLiteral(NULL),
-                         currentForInIteratorName(NULL), twoSlotFrameInfo(0)
+                         currentForInIteratorName(NULL), twoSlotFrameInfo(0), switchLookups(0)
     {
     }
 
@@ -171,6 +174,10 @@ protected:
 
     // struct
     void setupVarDecl(ExpDesc *out, VariableDeclaration *declaration);
+
+    // Indexes the object with a member ordinal, leaving the ordinal a
+    // constant key so the access is encoded in one instruction
+    void indexOrdinal(ExpDesc *object, int ordinal);
     void generateVarDeclStruct(VariableDeclaration *declaration);
     void generateAssignmentOperatorCall(MethodInfo *method, Expression *eleft, Expression *eright);
 
@@ -187,6 +194,25 @@ protected:
     // coerce an expression to a string, storing in its expression (e) field
     void coerceToString(Expression *expression);
 
+    // true if the expression is a binary + or .. which concatenates strings
+    bool isStringConcat(Expression *expression);
+
+    // gathers the operands of nested string concatenations left to right,
+    // so a + b + c can be emitted as a single concat of three operands
+    void collectConcatOperands(Expression *expression, utArray<Expression *>& operands);
+
+    // Switches with enough cases, all number or string literals, dispatch
+    // through a table mapping each literal to the clause it enters instead
+    // of comparing case by case. For those fills targets with that clause
+    // for each clause, -1 for the default and literals repeating an earlier
+    // case, and noMatch with the clause entered when nothing matches, the
+    // clause count if there's no default.
+    bool planSwitchLookup(SwitchStatement *statement, utArray<int>& targets, int& noMatch);
+
+    // Name of the lookup table for the next switch, it's kept in the method
+    // environment so it's only built on the first run
+    utString nextSwitchLookupName();
+
     // convenience method to set an instance/static member info from an existing localVar
     void storeLocalToMember(MemberInfo *memberInfo, const char *localVar);
 
@@ -0,0 +1,275 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "loom/common/core/assert.h"
+#include "loom/common/utils/utBase64.h"
+#include "loom/script/compiler/lsCompiler.h"
+#include "loom/script/compiler/lsTypeStripper.h"
+
+namespace LS {
+static utString getTypeFullName(json_t *jtype)
+{
+    utString fullName = json_string_value(json_object_get(jtype, "package"));
+
+    fullName += ".";
+    fullName += json_string_value(json_object_get(jtype, "name"));
+
+    return fullName;
+}
+
+
+TypeStripper::~TypeStripper()
+{
+    for (UTsize i = 0; i < packages.size(); i++)
+    {
+        lmDelete(NULL, packages.at(i));
+    }
+}
+
+
+void TypeStripper::addAssembly(json_t *assembly)
+{
+    json_t *modules = json_object_get(assembly, "modules");
+
+    for (size_t i = 0; i < json_array_size(modules); i++)
+    {
+        json_t *jtypes = json_object_get(json_array_get(modules, i), "types");
+
+        for (size_t j = 0; j < json_array_size(jtypes); j++)
+        {
+            json_t   *jtype   = json_array_get(jtypes, j);
+            utString fullName = getTypeFullName(jtype);
+
+            TypeEntry entry;
+            entry.json      = jtype;
+            entry.reachable = false;
+            types.insert(fullName, entry);
+
+            const char *package = json_string_value(json_object_get(jtype, "package"));
+
+            utArray<utString> **peers = packages.get(package);
+
+            if (!peers)
+            {
+                packages.insert(package, lmNew(NULL) utArray<utString>());
+                peers = packages.get(package);
+            }
+
+            (*peers)->push_back(fullName);
+        }
+    }
+}
+
+
+void TypeStripper::markReachable(const char *fullName)
+{
+    TypeEntry *entry = types.get(fullName);
+
+    if (!entry || entry->reachable)
+    {
+        return;
+    }
+
+    entry->reachable = true;
+    pending.push_back(fullName);
+}
+
+
+void TypeStripper::markReferences(json_t *json)
+{
+    if (json_is_string(json))
+    {
+        markReachable(json_string_value(json));
+    }
+    else if (json_is_array(json))
+    {
+        for (size_t i = 0; i < json_array_size(json); i++)
+        {
+            markReferences(json_array_get(json, i));
+        }
+    }
+    else if (json_is_object(json))
+    {
+        for (void *itr = json_object_iter(json); itr; itr = json_object_iter_next(json, itr))
+        {
+            const char *key = json_object_iter_key(itr);
+
+            // no type names in these, and the bytecode is large
+            if (!strncmp(key, "bytecode", 8) || !strcmp(key, "docString") || !strcmp(key, "source"))
+            {
+                continue;
+            }
+
+            markReferences(json_object_iter_value(itr));
+        }
+    }
+}
+
+
+void TypeStripper::markType(TypeEntry *entry)
+{
+    markReferences(entry->json);
+
+    utArray<utString> **peers = packages.get(json_string_value(json_object_get(entry->json, "package")));
+
+    if (peers)
+    {
+        for (UTsize i = 0; i < (*peers)->size(); i++)
+        {
+            markReachable((*peers)->at(i).c_str());
+        }
+    }
+}
+
+
+int TypeStripper::stripAssembly(json_t *assembly)
+{
+    int stripped = 0;
+
+    json_t *modules = json_object_get(assembly, "modules");
+
+    for (size_t i = 0; i < json_array_size(modules); i++)
+    {
+        json_t *jtypes = json_object_get(json_array_get(modules, i), "types");
+
+        for (size_t j = json_array_size(jtypes); j > 0; j--)
+        {
+            TypeEntry *entry = types.get(getTypeFullName(json_array_get(jtypes, j - 1)));
+
+            if (entry && !entry->reachable)
+            {
+                json_array_remove(jtypes, j - 1);
+                stripped++;
+            }
+        }
+    }
+
+    return stripped;
+}
+
+
+void TypeStripper::strip(json_t *executable)
+{
+    TypeStripper stripper;
+
+    stripper.addAssembly(executable);
+
+    // the types of the executable are all roots
+    for (UTsize i = 0; i < stripper.types.size(); i++)
+    {
+        stripper.markReachable(stripper.types.keyAt(i).str().c_str());
+    }
+
+    json_t *refArray = json_object_get(executable, "references");
+
+    utArray<json_t *> references;
+
+    for (size_t i = 0; i < json_array_size(refArray); i++)
+    {
+        json_t *jref    = json_array_get(refArray, i);
+        json_t *jbinary = json_object_get(jref, "binary");
+
+        if (!jbinary)
+        {
+            references.push_back(NULL);
+            continue;
+        }
+
+        utBase64 base64 = utBase64::decode64(json_string_value(jbinary));
+
+        json_error_t jerror;
+        json_t       *assembly = json_loadb((const char *)base64.getData().ptr(), base64.getData().size(), JSON_DISABLE_EOF_CHECK, &jerror);
+        lmAssert(assembly, "Error stripping linked assembly %s: %s", json_string_value(json_object_get(jref, "name")), jerror.text);
+
+        references.push_back(assembly);
+
+        UTsize firstType = stripper.types.size();
+        stripper.addAssembly(assembly);
+
+        if (!strcmp(json_string_value(json_object_get(jref, "name")), "System"))
+        {
+            for (UTsize j = firstType; j < stripper.types.size(); j++)
+            {
+                stripper.markReachable(stripper.types.keyAt(j).str().c_str());
+            }
+        }
+    }
+
+    // types kept for reflection
+    for (UTsize i = 0; i < stripper.types.size(); i++)
+    {
+        json_t *metaInfo = json_object_get(stripper.types.at(i).json, "metainfo");
+
+        if (metaInfo && json_object_get(metaInfo, "Keep"))
+        {
+            stripper.markReachable(stripper.types.keyAt(i).str().c_str());
+        }
+    }
+
+    while (stripper.pending.size())
+    {
+        utString fullName = stripper.pending[stripper.pending.size() - 1];
+        stripper.pending.pop_back();
+
+        stripper.markType(stripper.types.get(fullName));
+    }
+
+    int total    = (int)stripper.types.size();
+    int stripped = 0;
+
+    for (size_t i = 0; i < json_array_size(refArray); i++)
+    {
+        json_t *assembly = references[(UTsize)i];
+
+        if (!assembly)
+        {
+            continue;
+        }
+
+        int count = stripper.stripAssembly(assembly);
+
+        if (count)
+        {
+            json_t *jref = json_array_get(refArray, i);
+
+            LSCompiler::logVerbose("Stripped %d types from %s", count, json_string_value(json_object_get(jref, "name")));
+
+            char *out = json_dumps(assembly, JSON_INDENT(3) | JSON_SORT_KEYS | JSON_PRESERVE_ORDER | JSON_COMPACT);
+
+            // the linked binary is read back as a C string
+            utArray<unsigned char> bytes;
+            bytes.resize((UTsize)strlen(out) + 1);
+            memcpy(bytes.ptr(), out, bytes.size());
+            free(out);
+
+            json_object_set_new(jref, "binary", json_string(utBase64::encode64(bytes).getBase64().c_str()));
+
+            stripped += count;
+        }
+
+        json_decref(assembly);
+    }
+
+    LSCompiler::log("Stripped %d of %d types", stripped, total);
+}
+}
@@ -0,0 +1,82 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _lstypestripper_h
+#define _lstypestripper_h
+
+#include "jansson.h"
+
+#include "loom/common/utils/utTypes.h"
+#include "loom/common/utils/utString.h"
+
+namespace LS {
+/*
+ * Strips the types an executable can't reach from the assemblies linked
+ * into it, `lsc --strip`. Runs on the executable JSON before BinWriter
+ * serializes it.
+ *
+ * The roots are the types of the executable itself, every type of the
+ * System assembly, which the runtime and the compiler's implicit imports
+ * depend on, and types marked [Keep] for reflection. A reachable type keeps
+ * its base type, interfaces, imports, the types named in its member
+ * signatures and, as a type may use the types of its own package without
+ * importing them, every type sharing its package.
+ *
+ * Types are stripped whole, their type ids are left as they were as
+ * compiled bytecode refers to types by id. Members aren't stripped, the
+ * runtime indexes class tables by member ordinal.
+ */
+class TypeStripper {
+    struct TypeEntry
+    {
+        json_t *json;
+        bool   reachable;
+    };
+
+    // full type name -> entry
+    utHashTable<utHashedString, TypeEntry> types;
+
+    // package -> full names of the types in it
+    utHashTable<utHashedString, utArray<utString> *> packages;
+
+    utArray<utString> pending;
+
+    void addAssembly(json_t *assembly);
+
+    void markReachable(const char *fullName);
+
+    // marks every string in the JSON naming a type, covers type
+    // references in members, template types and imports
+    void markReferences(json_t *json);
+
+    void markType(TypeEntry *entry);
+
+    // removes the unreachable types, returns the number removed
+    int stripAssembly(json_t *assembly);
+
+public:
+
+    ~TypeStripper();
+
+    // Strips the executable JSON and the linked references in place
+    static void strip(json_t *executable);
+};
+}
+#endif
@@ -18,6 +18,7 @@
  * ===========================================================================
  */
 
+#include "loom/common/core/allocator.h"
 #include "loom/common/platform/platformMemory.h"
 #include "loom/script/native/lsLuaBridge.h"
 #include "loom/script/runtime/lsLuaState.h"
@@ -41,6 +42,35 @@ public:
          return (int) platform_getProcessMemory();
     }
 
+    static int getAllocatorTagCount()
+    {
+        return loom_allocator_getTagCount();
+    }
+
+    static const char *getAllocatorTagName(int index)
+    {
+        loom_allocatorTagStats_t stats;
+        return loom_allocator_getTagStats(index, &stats) ? stats.tag : NULL;
+    }
+
+    static double getAllocatorTagLiveBytes(int index)
+    {
+        loom_allocatorTagStats_t stats;
+        return loom_allocator_getTagStats(index, &stats) ? (double)stats.liveBytes : 0;
+    }
+
+    static double getAllocatorTagPeakBytes(int index)
+    {
+        loom_allocatorTagStats_t stats;
+        return loom_allocator_getTagStats(index, &stats) ? (double)stats.peakBytes : 0;
+    }
+
+    static double getAllocatorTagAllocCount(int index)
+    {
+        loom_allocatorTagStats_t stats;
+        return loom_allocator_getTagStats(index, &stats) ? (double)stats.totalCount : 0;
+    }
+
 };
 
 static int registerSystemMetrics(lua_State *L)
@@ -51,6 +81,11 @@ static int registerSystemMetrics(lua_State *L)
 
        .addStaticMethod("getManagedObjectCount", &Metrics::getManagedObjectCount)
        .addStaticMethod("getProcessMemoryUsage", &Metrics::getProcessMemoryUsage)
+       .addStaticMethod("getAllocatorTagCount", &Metrics::getAllocatorTagCount)
+       .addStaticMethod("getAllocatorTagName", &Metrics::getAllocatorTagName)
+       .addStaticMethod("getAllocatorTagLiveBytes", &Metrics::getAllocatorTagLiveBytes)
+       .addStaticMethod("getAllocatorTagPeakBytes", &Metrics::getAllocatorTagPeakBytes)
+       .addStaticMethod("getAllocatorTagAllocCount", &Metrics::getAllocatorTagAllocCount)
 
        .endClass()
 
@@ -22,8 +22,11 @@
 #include "loom/common/core/assert.h"
 #include "loom/common/platform/platformIO.h"
 #include "loom/common/platform/platformFile.h"
+#include "loom/common/platform/platformFileAsync.h"
+#include "loom/common/core/log.h"
 
 #include "loom/script/loomscript.h"
+#include "loom/script/native/lsNativeDelegate.h"
 
 #include <string.h>
 
@@ -163,6 +166,7 @@ public:
 
         utByteArray *ba = lmNew(NULL) utByteArray();
 
+        ba->setReportsExternalMemory(true);
         ba->allocateAndCopy(ptr, size);
 
         platform_unmapFile(ptr);
@@ -173,6 +177,170 @@ public:
     }
 };
 
+lmDefineLogGroup(gFileOperationLogGroup, "file.async", 1, LoomLogInfo);
+
+class FileOperation {
+private:
+
+    int id;
+
+public:
+
+    utString path;
+    bool success;
+    double size;
+    double modified;
+
+    LOOM_DELEGATE(OnRead);
+    LOOM_DELEGATE(OnComplete);
+
+    FileOperation(const char *pathString) : id(0), success(false), size(0), modified(0)
+    {
+        setPath(pathString);
+    }
+
+    ~FileOperation()
+    {
+        if (id > 0)
+        {
+            lmLogWarn(gFileOperationLogGroup, "FileOperation on \"%s\" garbage collected before completing. Keep a reference to it until onComplete.", path.c_str());
+            platform_fileAsyncCancel(id);
+        }
+    }
+
+    const char *getPath() const
+    {
+        return path.c_str();
+    }
+
+    void setPath(const char *value)
+    {
+        char normalized[4096];
+
+        strncpy(normalized, value ? value : "", sizeof(normalized) - 1);
+        normalized[sizeof(normalized) - 1] = 0;
+        platform_normalizePath(normalized);
+        path = normalized;
+    }
+
+    bool isPending()
+    {
+        return id != 0;
+    }
+
+    bool read()
+    {
+        if (!canStart()) return false;
+        beginStart();
+        endStart(platform_fileReadAsync(path.c_str(), &FileOperation::complete, this));
+        return true;
+    }
+
+    bool write(utByteArray *bytes)
+    {
+        return writeData(bytes, false);
+    }
+
+    bool writeText(const char *text)
+    {
+        return writeString(text, false);
+    }
+
+    bool append(utByteArray *bytes)
+    {
+        return writeData(bytes, true);
+    }
+
+    bool appendText(const char *text)
+    {
+        return writeString(text, true);
+    }
+
+    bool stat()
+    {
+        if (!canStart()) return false;
+        beginStart();
+        endStart(platform_fileStatAsync(path.c_str(), &FileOperation::complete, this));
+        return true;
+    }
+
+    bool remove()
+    {
+        if (!canStart()) return false;
+        beginStart();
+        endStart(platform_fileRemoveAsync(path.c_str(), &FileOperation::complete, this));
+        return true;
+    }
+
+    /**
+     * Calls the native delegates, this should be used internally only
+     */
+    static void complete(void *payload, loom_fileAsyncResult *result)
+    {
+        FileOperation *op = (FileOperation *)payload;
+
+        op->id       = 0;
+        op->success  = result->success;
+        op->size     = (double)result->size;
+        op->modified = (double)result->modified;
+
+        if (result->success && (result->data != NULL))
+        {
+            op->_OnReadDelegate.pushArgument(result->data);
+            op->_OnReadDelegate.invoke();
+        }
+
+        op->_OnCompleteDelegate.pushArgument(result->success);
+        op->_OnCompleteDelegate.invoke();
+    }
+
+private:
+
+    bool canStart()
+    {
+        if (id != 0)
+        {
+            lmLogError(gFileOperationLogGroup, "FileOperation on \"%s\" is still pending", path.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    // Without workers complete() is called before the id is known, so
+    // pending is marked first and only kept if it didn't complete yet
+    void beginStart()
+    {
+        success = false;
+        id      = -1;
+    }
+
+    void endStart(int operationId)
+    {
+        if (id == -1) id = operationId;
+    }
+
+    bool writeData(utByteArray *bytes, bool append)
+    {
+        if (!canStart()) return false;
+        if (bytes == NULL) return false;
+
+        beginStart();
+        endStart(platform_fileWriteAsync(path.c_str(), bytes->getDataPtr(), (int)bytes->getSize(), append, &FileOperation::complete, this));
+        return true;
+    }
+
+    bool writeString(const char *text, bool append)
+    {
+        if (!canStart()) return false;
+        if (text == NULL) return false;
+
+        beginStart();
+        endStart(platform_fileWriteAsync(path.c_str(), text, (int)strlen(text), append, &FileOperation::complete, this));
+        return true;
+    }
+};
+
 class Path {
 public:
 
@@ -293,6 +461,24 @@ static int _registerSystemPlatform(lua_State *L)
        .addStaticLuaFunction("_moveFile", &File::moveFile)
        .endClass()
 
+       .beginClass<FileOperation>("FileOperation")
+       .addConstructor<void (*)(const char *)>()
+       .addVarAccessor("onRead", &FileOperation::getOnReadDelegate)
+       .addVarAccessor("onComplete", &FileOperation::getOnCompleteDelegate)
+       .addProperty("path", &FileOperation::getPath, &FileOperation::setPath)
+       .addVar("success", &FileOperation::success)
+       .addVar("size", &FileOperation::size)
+       .addVar("modified", &FileOperation::modified)
+       .addMethod("isPending", &FileOperation::isPending)
+       .addMethod("read", &FileOperation::read)
+       .addMethod("write", &FileOperation::write)
+       .addMethod("writeText", &FileOperation::writeText)
+       .addMethod("append", &FileOperation::append)
+       .addMethod("appendText", &FileOperation::appendText)
+       .addMethod("stat", &FileOperation::stat)
+       .addMethod("remove", &FileOperation::remove)
+       .endClass()
+
        .beginClass<Path>("Path")
        .addStaticLuaFunction("getWritablePath", &Path::getWritablePath)
        .addStaticLuaFunction("getFolderDelimiter", &Path::getFolderDelimiter)
@@ -312,5 +498,6 @@ static int _registerSystemPlatform(lua_State *L)
 void installSystemPlatformFile()
 {
     LOOM_DECLARE_NATIVETYPE(File, _registerSystemPlatform);
+    LOOM_DECLARE_NATIVETYPE(FileOperation, _registerSystemPlatform);
     LOOM_DECLARE_NATIVETYPE(Path, _registerSystemPlatform);
 }
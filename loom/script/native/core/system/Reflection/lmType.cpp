@@ -62,6 +62,8 @@ static int registerSystemReflectionType(lua_State *L)
        .deriveClass<PropertyInfo, MemberInfo>("PropertyInfo")
        .addMethod("getSetMethod", &PropertyInfo::getSetMethod)
        .addMethod("getGetMethod", &PropertyInfo::getGetMethod)
+       .addLuaFunction("getValue", &PropertyInfo::_getValue)
+       .addLuaFunction("setValue", &PropertyInfo::_setValue)
        .endClass()
 
        .deriveClass<FieldInfo, MemberInfo>("FieldInfo")
@@ -89,6 +91,7 @@ static int registerSystemReflectionType(lua_State *L)
        .deriveClass<MethodInfo, MethodBase>("MethodInfo")
        .addLuaFunction("invoke", &MethodInfo::_invoke)
        .addLuaFunction("invokeSingle", &MethodInfo::_invokeSingle)
+       .addLuaFunction("invokeWithArgs", &MethodInfo::_invoke)
        .endClass()
 
        .deriveClass<ConstructorInfo, MethodBase>("ConstructorInfo")
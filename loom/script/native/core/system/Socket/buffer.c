@@ -4,6 +4,8 @@
 *
 * RCS ID: $Id: buffer.c,v 1.28 2007/06/11 23:44:54 diego Exp $
 \*=========================================================================*/
+#include <string.h>
+
 #include "lua.h"
 #include "lauxlib.h"
 
@@ -153,6 +155,34 @@ int buffer_isempty(p_buffer buf) {
     return buf->first >= buf->last;
 }
 
+/*-------------------------------------------------------------------------*\
+* Reads up to wanted bytes straight into data, buffered ones first. Waits
+* as long as the timeout allows when there are none
+\*-------------------------------------------------------------------------*/
+int buffer_recvinto(p_buffer buf, char *data, size_t wanted, size_t *got) {
+    int err;
+    *got = 0;
+    if (wanted == 0) return IO_DONE;
+    if (!buffer_isempty(buf)) {
+        size_t count = MIN(buf->last - buf->first, wanted);
+        memcpy(data, buf->data + buf->first, count);
+        buffer_skip(buf, count);
+        *got = count;
+        return IO_DONE;
+    }
+    err = buf->io->recv(buf->io->ctx, data, wanted, got, timeout_markstart(buf->tm));
+    buf->received += *got;
+    return err;
+}
+
+/*-------------------------------------------------------------------------*\
+* Sends count bytes from data, as many as the timeout allows
+\*-------------------------------------------------------------------------*/
+int buffer_sendfrom(p_buffer buf, const char *data, size_t count, size_t *sent) {
+    timeout_markstart(buf->tm);
+    return sendraw(buf, data, count, sent);
+}
+
 /*=========================================================================*\
 * Internal functions
 \*=========================================================================*/
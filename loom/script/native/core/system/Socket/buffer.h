@@ -43,5 +43,7 @@ int buffer_meth_receive(lua_State *L, p_buffer buf);
 int buffer_meth_getstats(lua_State *L, p_buffer buf);
 int buffer_meth_setstats(lua_State *L, p_buffer buf);
 int buffer_isempty(p_buffer buf);
+int buffer_recvinto(p_buffer buf, char *data, size_t wanted, size_t *got);
+int buffer_sendfrom(p_buffer buf, const char *data, size_t count, size_t *sent);
 
 #endif /* BUF_H */
@@ -20,10 +20,369 @@
 
 #include "loom/script/loomscript.h"
 #include "loom/script/runtime/lsRuntime.h"
+#include "loom/script/native/lsNativeDelegate.h"
+#include "loom/common/platform/platformNetwork.h"
+#include "loom/common/utils/utByteArray.h"
+
+extern "C" {
+#include "tcp.h"
+#include "auxiliar.h"
+}
+
+// Largest framed message accepted, larger lengths mean a broken stream.
+#define SOCKET_MAX_MESSAGE_SIZE     (16 * 1024 * 1024)
+
+// Bytes receiveBytes makes room for when not told.
+#define SOCKET_RECEIVE_SIZE         65536
+
+// Framed messages this small go out with their length in one send.
+#define SOCKET_COALESCE_SIZE        1024
 
 class LoomSocket {
 public:
 
+    LOOM_DELEGATE(OnReadable);
+    LOOM_DELEGATE(OnWritable);
+    LOOM_DELEGATE(OnClosed);
+
+    // The descriptor watched for the delegates, if any.
+    loom_socketId_t watchedSocket;
+
+    // A framed message being received, kept between calls while it
+    // arrives in parts. The payload goes straight into frameTarget.
+    unsigned char frameHeader[4];
+    int           frameHeaderRead;
+    int           frameRead;
+    utByteArray   *frameTarget;
+
+    LoomSocket() : watchedSocket(NULL), frameHeaderRead(0), frameRead(0), frameTarget(NULL)
+    {
+    }
+
+    ~LoomSocket()
+    {
+        unwatchSocket();
+    }
+
+    void unwatchSocket()
+    {
+        if (watchedSocket != NULL)
+        {
+            loom_net_unwatchSocket(watchedSocket);
+            watchedSocket = NULL;
+        }
+    }
+
+    // Called from loom_net_pollSockets on the main thread. Each delegate
+    // may close the socket, which ends the watch.
+    static void onSocketReady(loom_socketId_t s, int events, void *payload)
+    {
+        LoomSocket *socket = (LoomSocket *)payload;
+
+        if (events & LOOM_NET_READABLE)
+        {
+            socket->_OnReadableDelegate.invoke();
+        }
+
+        if ((events & LOOM_NET_WRITABLE) && (socket->watchedSocket == s))
+        {
+            socket->_OnWritableDelegate.invoke();
+        }
+
+        if ((events & LOOM_NET_HANGUP) && (socket->watchedSocket == s))
+        {
+            socket->unwatchSocket();
+            socket->_OnClosedDelegate.invoke();
+        }
+    }
+
+    /*
+     * Calls the delegates as the socket becomes readable, writable if asked
+     * for, or closed, instead of polling it with timeouts.
+     */
+    static int watch(lua_State *L)
+    {
+        LoomSocket *socket = (LoomSocket *)lualoom_getnativepointer(L, 1, false, "system.socket.Socket");
+        int        events  = LOOM_NET_READABLE;
+
+        if (lua_isboolean(L, 2) && lua_toboolean(L, 2))
+        {
+            events |= LOOM_NET_WRITABLE;
+        }
+
+        //local fd = sock:getfd()
+        lua_getfield(L, 1, "__socket");
+        lua_getfield(L, -1, "getfd");
+        lua_pushvalue(L, -2);
+        lua_call(L, 1, 1);
+
+        int fd = (int)lua_tonumber(L, -1);
+        lua_pop(L, 2);
+
+        if (fd < 0)
+        {
+            lua_pushstring(L, "closed");
+            lua_setfield(L, 1, "__socket_error");
+            lua_pushboolean(L, 0);
+            return 1;
+        }
+
+        if ((socket->watchedSocket != NULL) && (socket->watchedSocket != (loom_socketId_t)(size_t)fd))
+        {
+            socket->unwatchSocket();
+        }
+
+        socket->watchedSocket = (loom_socketId_t)(size_t)fd;
+        if (!loom_net_watchSocket(socket->watchedSocket, events, onSocketReady, socket))
+        {
+            socket->watchedSocket = NULL;
+            lua_pushstring(L, "watch failed");
+            lua_setfield(L, 1, "__socket_error");
+            lua_pushboolean(L, 0);
+            return 1;
+        }
+
+        lua_pushboolean(L, 1);
+        return 1;
+    }
+
+    // The LuaSocket connection of the instance at 1, erroring if it isn't
+    // a connected TCP socket.
+    static p_tcp getConnection(lua_State *L)
+    {
+        lua_getfield(L, 1, "__socket");
+        p_tcp tcp = (p_tcp)auxiliar_checkclass(L, "tcp{client}", lua_gettop(L));
+        lua_pop(L, 1);
+        return tcp;
+    }
+
+    static void setIOError(lua_State *L, p_tcp tcp, int err)
+    {
+        lua_pushstring(L, tcp->io.error(tcp->io.ctx, err));
+        lua_setfield(L, 1, "__socket_error");
+    }
+
+    /*
+     * Receives what arrived, up to maxBytes, into bytes at its position and
+     * advances it. Returns the bytes received, 0 on timeout, -1 once closed.
+     */
+    static int receiveBytes(lua_State *L)
+    {
+        p_tcp       tcp      = getConnection(L);
+        utByteArray *bytes   = (utByteArray *)lualoom_getnativepointer(L, 2, false, "system.ByteArray");
+        int         maxBytes = lua_isnumber(L, 3) ? (int)lua_tonumber(L, 3) : 0;
+
+        if (maxBytes <= 0)
+        {
+            maxBytes = SOCKET_RECEIVE_SIZE;
+        }
+
+        UTsize position = bytes->getPosition();
+        UTsize needed   = position + maxBytes;
+        UTsize size     = bytes->getSize();
+
+        // Grow by doubling, so repeated receives don't reallocate each time.
+        utArray<unsigned char> *data = bytes->getInternalArray();
+        if (data->capacity() < needed)
+        {
+            data->reserve(needed > data->capacity() * 2 ? needed : data->capacity() * 2);
+        }
+
+        bytes->resize(needed > size ? needed : size);
+
+        size_t got = 0;
+        int    err = buffer_recvinto(&tcp->buf, (char *)bytes->getDataPtr() + position, maxBytes, &got);
+
+        // Drop the room that wasn't used.
+        bytes->resize(position + got > size ? (UTsize)(position + got) : size);
+
+        bytes->setPosition((unsigned int)(position + got));
+
+        if ((err != IO_DONE) && (err != IO_TIMEOUT))
+        {
+            setIOError(L, tcp, err);
+            lua_pushnumber(L, got > 0 ? (lua_Number)got : -1);
+            return 1;
+        }
+
+        lua_pushnumber(L, (lua_Number)got);
+        return 1;
+    }
+
+    /*
+     * Sends length bytes of bytes from offset, all remaining by default.
+     * Returns the bytes sent, fewer if it timed out or failed.
+     */
+    static int sendBytes(lua_State *L)
+    {
+        p_tcp       tcp    = getConnection(L);
+        utByteArray *bytes = (utByteArray *)lualoom_getnativepointer(L, 2, false, "system.ByteArray");
+        int         offset = lua_isnumber(L, 3) ? (int)lua_tonumber(L, 3) : 0;
+        int         length = lua_isnumber(L, 4) ? (int)lua_tonumber(L, 4) : -1;
+        int         size   = (int)bytes->getSize();
+
+        if ((offset < 0) || (offset > size))
+        {
+            offset = size;
+        }
+
+        if ((length < 0) || (length > size - offset))
+        {
+            length = size - offset;
+        }
+
+        size_t sent = 0;
+        int    err  = buffer_sendfrom(&tcp->buf, (const char *)bytes->getDataPtr() + offset, length, &sent);
+
+        if (err != IO_DONE)
+        {
+            setIOError(L, tcp, err);
+        }
+
+        lua_pushnumber(L, (lua_Number)sent);
+        return 1;
+    }
+
+    /*
+     * Sends bytes from offset as a message, prefixed with its length as a
+     * little endian unsigned int like ByteArray.writeUnsignedInt writes.
+     */
+    static int sendMessage(lua_State *L)
+    {
+        p_tcp       tcp    = getConnection(L);
+        utByteArray *bytes = (utByteArray *)lualoom_getnativepointer(L, 2, false, "system.ByteArray");
+        int         offset = lua_isnumber(L, 3) ? (int)lua_tonumber(L, 3) : 0;
+        int         length = lua_isnumber(L, 4) ? (int)lua_tonumber(L, 4) : -1;
+        int         size   = (int)bytes->getSize();
+
+        if ((offset < 0) || (offset > size))
+        {
+            offset = size;
+        }
+
+        if ((length < 0) || (length > size - offset))
+        {
+            length = size - offset;
+        }
+
+        unsigned char header[4 + SOCKET_COALESCE_SIZE];
+        header[0] = (unsigned char)(length);
+        header[1] = (unsigned char)(length >> 8);
+        header[2] = (unsigned char)(length >> 16);
+        header[3] = (unsigned char)(length >> 24);
+
+        const char *payload = (const char *)bytes->getDataPtr() + offset;
+        size_t     sent     = 0;
+        int        err;
+
+        if (length <= SOCKET_COALESCE_SIZE)
+        {
+            memcpy(header + 4, payload, length);
+            err = buffer_sendfrom(&tcp->buf, (const char *)header, 4 + length, &sent);
+        }
+        else
+        {
+            err = buffer_sendfrom(&tcp->buf, (const char *)header, 4, &sent);
+            if (err == IO_DONE)
+            {
+                err = buffer_sendfrom(&tcp->buf, payload, length, &sent);
+            }
+        }
+
+        if (err != IO_DONE)
+        {
+            setIOError(L, tcp, err);
+        }
+
+        lua_pushboolean(L, err == IO_DONE);
+        return 1;
+    }
+
+    /*
+     * Receives a message sent by sendMessage into bytes, replacing what it
+     * held. Returns false until all of it arrived, pass the same ByteArray
+     * until then. Once true bytes holds the message from position 0.
+     */
+    static int receiveMessage(lua_State *L)
+    {
+        LoomSocket  *socket = (LoomSocket *)lualoom_getnativepointer(L, 1, false, "system.socket.Socket");
+        p_tcp       tcp     = getConnection(L);
+        utByteArray *bytes  = (utByteArray *)lualoom_getnativepointer(L, 2, false, "system.ByteArray");
+        int         err     = IO_DONE;
+        size_t      got;
+
+        if ((socket->frameTarget != NULL) && (socket->frameTarget != bytes))
+        {
+            lua_pushstring(L, "message already being received into another ByteArray");
+            lua_setfield(L, 1, "__socket_error");
+            lua_pushboolean(L, 0);
+            return 1;
+        }
+
+        while (socket->frameHeaderRead < 4)
+        {
+            err = buffer_recvinto(&tcp->buf, (char *)socket->frameHeader + socket->frameHeaderRead, 4 - socket->frameHeaderRead, &got);
+            socket->frameHeaderRead += (int)got;
+
+            if (err != IO_DONE)
+            {
+                break;
+            }
+        }
+
+        if ((socket->frameHeaderRead == 4) && (socket->frameTarget == NULL))
+        {
+            unsigned int length = socket->frameHeader[0] | (socket->frameHeader[1] << 8) |
+                                  (socket->frameHeader[2] << 16) | ((unsigned int)socket->frameHeader[3] << 24);
+
+            if (length > SOCKET_MAX_MESSAGE_SIZE)
+            {
+                socket->frameHeaderRead = 0;
+                lua_pushstring(L, "message too large");
+                lua_setfield(L, 1, "__socket_error");
+                lua_pushboolean(L, 0);
+                return 1;
+            }
+
+            bytes->resize(length);
+            socket->frameTarget = bytes;
+            socket->frameRead   = 0;
+        }
+
+        while ((socket->frameTarget != NULL) && (err == IO_DONE) && (socket->frameRead < (int)bytes->getSize()))
+        {
+            err = buffer_recvinto(&tcp->buf, (char *)bytes->getDataPtr() + socket->frameRead, bytes->getSize() - socket->frameRead, &got);
+            socket->frameRead += (int)got;
+        }
+
+        if ((err != IO_DONE) && (err != IO_TIMEOUT))
+        {
+            setIOError(L, tcp, err);
+        }
+
+        if ((socket->frameTarget != NULL) && (socket->frameRead == (int)bytes->getSize()))
+        {
+            socket->frameHeaderRead = 0;
+            socket->frameRead       = 0;
+            socket->frameTarget     = NULL;
+
+            bytes->setPosition(0);
+            lua_pushboolean(L, 1);
+            return 1;
+        }
+
+        lua_pushboolean(L, 0);
+        return 1;
+    }
+
+    static int unwatch(lua_State *L)
+    {
+        LoomSocket *socket = (LoomSocket *)lualoom_getnativepointer(L, 1, false, "system.socket.Socket");
+
+        socket->unwatchSocket();
+        return 0;
+    }
+
     static int send(lua_State *L)
     {
         // get our socket object
@@ -60,6 +419,10 @@ public:
      */
     static int close(lua_State *L)
     {
+        // The descriptor may be reused once closed.
+        LoomSocket *socket = (LoomSocket *)lualoom_getnativepointer(L, 1, false, "system.socket.Socket");
+        socket->unwatchSocket();
+
         // get our socket object
         lua_getfield(L, 1, "__socket");
         lua_getfield(L, -1, "close");
@@ -315,6 +678,15 @@ static int registerSystemSocket(lua_State *L)
        .addStaticLuaFunction("getError", &LoomSocket::getError)
        .addStaticLuaFunction("clearError", &LoomSocket::clearError)
        .addStaticLuaFunction("close", &LoomSocket::close)
+       .addStaticLuaFunction("receiveBytes", &LoomSocket::receiveBytes)
+       .addStaticLuaFunction("sendBytes", &LoomSocket::sendBytes)
+       .addStaticLuaFunction("receiveMessage", &LoomSocket::receiveMessage)
+       .addStaticLuaFunction("sendMessage", &LoomSocket::sendMessage)
+       .addStaticLuaFunction("watch", &LoomSocket::watch)
+       .addStaticLuaFunction("unwatch", &LoomSocket::unwatch)
+       .addVarAccessor("onReadable", &LoomSocket::getOnReadableDelegate)
+       .addVarAccessor("onWritable", &LoomSocket::getOnWritableDelegate)
+       .addVarAccessor("onClosed", &LoomSocket::getOnClosedDelegate)
        .endClass()
 
        .endPackage();
@@ -13,6 +13,11 @@
 
 #include "socket.h"
 
+/* poll() takes any descriptor, select() only ones below FD_SETSIZE */
+#ifndef SOCKET_SELECT
+#define SOCKET_POLL
+#endif
+
 /*-------------------------------------------------------------------------*\
 * Wait for readable/writable/connected socket with timeout
 \*-------------------------------------------------------------------------*/
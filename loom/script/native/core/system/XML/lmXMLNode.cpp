@@ -1,4 +1,6 @@
 #include "loom/common/xml/tinyxml2.h"
+#include "loom/common/xml/xmlReader.h"
+#include "loom/common/platform/platformIO.h"
 
 #include <cstdio>
 #include <cstdlib>
@@ -11,6 +13,167 @@
 using namespace LS;
 using namespace tinyxml2;
 
+/*
+ * Script side of XMLReader, owning the XML it reads: a copy of a string,
+ * or a file mapped and read in place.
+ */
+class XMLScriptReader
+{
+public:
+
+    XMLScriptReader() : reader(NULL), mapped(NULL)
+    {
+    }
+
+    ~XMLScriptReader()
+    {
+        close();
+    }
+
+    void parse(const char *xml)
+    {
+        close();
+
+        UTsize length = xml ? (UTsize)strlen(xml) : 0;
+        copy.resize(length);
+        if (length)
+        {
+            memcpy(copy.ptr(), xml, length);
+        }
+
+        reader = lmNew(NULL) XMLReader(copy.ptr(), length);
+    }
+
+    bool open(const char *path)
+    {
+        close();
+
+        long size = 0;
+        if (!path || !platform_mapFile(path, &mapped, &size))
+        {
+            mapped = NULL;
+            return false;
+        }
+
+        reader = lmNew(NULL) XMLReader((const char *)mapped, (UTsize)size);
+        return true;
+    }
+
+    void close()
+    {
+        lmSafeDelete(NULL, reader);
+
+        if (mapped)
+        {
+            platform_unmapFile(mapped);
+            mapped = NULL;
+        }
+
+        copy.clear();
+    }
+
+    int next()
+    {
+        return reader ? reader->next() : XML_READER_END;
+    }
+
+    bool skip()
+    {
+        return reader ? reader->skip() : false;
+    }
+
+    int getDepth()
+    {
+        return reader ? reader->getDepth() : 0;
+    }
+
+    int getAttributeCount()
+    {
+        return reader ? (int)reader->getAttributeCount() : 0;
+    }
+
+    const char *getError()
+    {
+        return reader ? reader->getError() : NULL;
+    }
+
+    int _getName(lua_State *L)
+    {
+        UTsize     length = 0;
+        const char *name  = reader ? reader->getName(length) : NULL;
+
+        return pushSpan(L, name, length);
+    }
+
+    int _getText(lua_State *L)
+    {
+        UTsize     length = 0;
+        const char *text  = reader ? reader->getText(length) : NULL;
+
+        return pushSpan(L, text, length);
+    }
+
+    int _getAttributeName(lua_State *L)
+    {
+        UTsize     length = 0;
+        const char *name  = reader ? reader->getAttributeName((UTsize)luaL_checkinteger(L, 2), length) : NULL;
+
+        return pushSpan(L, name, length);
+    }
+
+    int _getAttributeValue(lua_State *L)
+    {
+        UTsize     length = 0;
+        const char *value = reader ? reader->getAttributeValue((UTsize)luaL_checkinteger(L, 2), length) : NULL;
+
+        return pushSpan(L, value, length);
+    }
+
+    int _getAttribute(lua_State *L)
+    {
+        UTsize     length = 0;
+        const char *value = reader ? reader->findAttribute(luaL_checkstring(L, 2), length) : NULL;
+
+        if (!value)
+        {
+            lua_settop(L, 3);
+            return 1;
+        }
+
+        return pushSpan(L, value, length);
+    }
+
+    int _getNumberAttribute(lua_State *L)
+    {
+        UTsize     length = 0;
+        const char *value = reader ? reader->findAttribute(luaL_checkstring(L, 2), length) : NULL;
+
+        // values end at their quote or are decoded and terminated
+        lua_pushnumber(L, value ? strtod(value, NULL) : 0);
+        return 1;
+    }
+
+private:
+
+    static int pushSpan(lua_State *L, const char *chars, UTsize length)
+    {
+        if (chars)
+        {
+            lua_pushlstring(L, chars, length);
+        }
+        else
+        {
+            lua_pushnil(L);
+        }
+
+        return 1;
+    }
+
+    XMLReader     *reader;
+    utArray<char> copy;
+    void          *mapped;
+};
+
 
 static int registerSystemXML(lua_State *L)
 {
@@ -127,6 +290,24 @@ static int registerSystemXML(lua_State *L)
 
        .endClass()
 
+       .beginClass<XMLScriptReader>("XMLReader")
+       .addConstructor<void (*)(void)>()
+       .addMethod("parse", &XMLScriptReader::parse)
+       .addMethod("open", &XMLScriptReader::open)
+       .addMethod("close", &XMLScriptReader::close)
+       .addMethod("next", &XMLScriptReader::next)
+       .addMethod("skip", &XMLScriptReader::skip)
+       .addMethod("__pget_depth", &XMLScriptReader::getDepth)
+       .addMethod("__pget_attributeCount", &XMLScriptReader::getAttributeCount)
+       .addMethod("__pget_error", &XMLScriptReader::getError)
+       .addLuaFunction("__pget_name", &XMLScriptReader::_getName)
+       .addLuaFunction("__pget_text", &XMLScriptReader::_getText)
+       .addLuaFunction("getAttributeName", &XMLScriptReader::_getAttributeName)
+       .addLuaFunction("getAttributeValue", &XMLScriptReader::_getAttributeValue)
+       .addLuaFunction("getAttribute", &XMLScriptReader::_getAttribute)
+       .addLuaFunction("getNumberAttribute", &XMLScriptReader::_getNumberAttribute)
+       .endClass()
+
        .beginClass<XMLPrinter>("XMLPrinter")
        .addConstructor<void (*)(void)>()
        .addMethod("getString", &XMLPrinter::CStr)
@@ -145,6 +326,7 @@ void installSystemXML()
     NativeInterface::registerNativeType<XMLComment>(registerSystemXML);
     NativeInterface::registerNativeType<XMLDocument>(registerSystemXML);
     NativeInterface::registerNativeType<XMLPrinter>(registerSystemXML);
+    NativeInterface::registerNativeType<XMLScriptReader>(registerSystemXML);
     NativeInterface::registerNativeType<XMLAttribute>(registerSystemXML);
     NativeInterface::registerNativeType<XMLText>(registerSystemXML);
     NativeInterface::registerNativeType<XMLElement>(registerSystemXML);
@@ -19,7 +19,254 @@
  */
 
 #include "loom/script/loomscript.h"
+#include "loom/script/native/lsNativeDelegate.h"
+#include "loom/common/core/log.h"
+#include "loom/common/platform/platformJobs.h"
 #include "loom/common/utils/utByteArray.h"
+#include "loom/common/utils/utCompressionStream.h"
+
+namespace LS {
+// Script's ByteArrays are collected, let the GC see their bytes
+template<>
+struct ScriptConstructed<utByteArray>
+{
+    static void call(utByteArray *bytes)
+    {
+        bytes->setReportsExternalMemory(true);
+    }
+};
+}
+
+lmDefineLogGroup(gCompressionLogGroup, "bytearray.compress", 1, LoomLogInfo);
+
+// Hands a ByteArray made natively to script, which owns it from then on
+static void pushOwnedByteArray(lua_State *L, utByteArray *bytes)
+{
+    NativeTypeBase *nativeType = NativeInterface::getNativeType<utByteArray>();
+
+    lualoom_newnativeuserdata(L, nativeType, bytes, true);
+    lualoom_pushnative_userdata(L, NativeInterface::getScriptType(L, nativeType), -1);
+    lua_remove(L, -2);
+}
+
+/*
+ * Script side of utCompressionStream, working on ByteArrays.
+ */
+class CompressionStream
+{
+public:
+
+    bool beginDeflate(int level)
+    {
+        return stream.beginDeflate(level);
+    }
+
+    bool beginInflate()
+    {
+        return stream.beginInflate();
+    }
+
+    bool write(utByteArray *input, utByteArray *output)
+    {
+        if (!input || !output)
+        {
+            return false;
+        }
+
+        UTsize position = input->getPosition();
+        UTsize size     = input->getSize() - position;
+        bool   success  = stream.write((unsigned char *)input->getDataPtr() + position, size, *output);
+
+        input->setPosition(input->getSize());
+
+        return success;
+    }
+
+    bool finish(utByteArray *output)
+    {
+        return output ? stream.finish(*output) : false;
+    }
+
+    void end()
+    {
+        stream.end();
+    }
+
+    bool isActive() const
+    {
+        return stream.isActive();
+    }
+
+    bool isFinished() const
+    {
+        return stream.isFinished();
+    }
+
+    double getTotalIn() const
+    {
+        return stream.getTotalIn();
+    }
+
+    double getTotalOut() const
+    {
+        return stream.getTotalOut();
+    }
+
+private:
+
+    utCompressionStream stream;
+};
+
+/*
+ * Compresses or uncompresses a copy of a ByteArray on the job workers and
+ * hands the result to onComplete on the main thread, synchronously when
+ * there are no workers.
+ */
+class CompressionOperation
+{
+public:
+
+    LOOM_DELEGATE(OnComplete);
+
+    CompressionOperation() : task(NULL)
+    {
+    }
+
+    ~CompressionOperation()
+    {
+        // the task still completes, without anyone to tell
+        if (task)
+        {
+            task->operation = NULL;
+        }
+    }
+
+    bool isPending()
+    {
+        return task != NULL;
+    }
+
+    bool compress(utByteArray *bytes, int level)
+    {
+        return start(bytes, true, level, 0);
+    }
+
+    bool uncompress(utByteArray *bytes, int uncompressedSize)
+    {
+        return start(bytes, false, 0, uncompressedSize);
+    }
+
+private:
+
+    struct Task
+    {
+        CompressionOperation *operation;
+        utByteArray          input;
+        utByteArray          *output;
+        bool                 compressing;
+        int                  level;
+        int                  size;
+        bool                 success;
+    };
+
+    Task *task;
+
+    bool start(utByteArray *bytes, bool compressing, int level, int size)
+    {
+        if (task)
+        {
+            lmLogError(gCompressionLogGroup, "CompressionOperation is still pending");
+            return false;
+        }
+
+        if (!bytes)
+        {
+            return false;
+        }
+
+        Task *started = lmNew(NULL) Task();
+        started->operation   = this;
+        started->output      = lmNew(NULL) utByteArray();
+        started->compressing = compressing;
+        started->level       = level;
+        started->size        = size;
+        started->success     = false;
+
+        // copied, script may go on using the ByteArray meanwhile
+        started->input.allocateAndCopy(bytes->getDataPtr(), bytes->getSize());
+
+        task = started;
+
+        if (loom_jobs_getWorkerCount() == 0)
+        {
+            perform(started);
+            complete(started);
+        }
+        else
+        {
+            loom_job_submit(run, started, NULL, NULL, LOOM_JOB_BACKGROUND);
+        }
+
+        return true;
+    }
+
+    static void perform(Task *task)
+    {
+        utCompressionStream stream;
+
+        if (task->compressing)
+        {
+            stream.beginDeflate(task->level);
+        }
+        else
+        {
+            stream.beginInflate();
+
+            // exact size output when the size is known
+            if (task->size > 0)
+            {
+                task->output->reserve(task->size);
+            }
+        }
+
+        task->success = stream.write(task->input.getDataPtr(), task->input.getSize(), *task->output) &&
+                        stream.finish(*task->output);
+
+        task->input.clear();
+    }
+
+    static void run(void *param)
+    {
+        perform((Task *)param);
+        loom_job_runOnMainThread(complete, param, NULL);
+    }
+
+    static void complete(void *param)
+    {
+        Task                 *task      = (Task *)param;
+        CompressionOperation *operation = task->operation;
+        utByteArray          *output    = task->output;
+
+        if (operation)
+        {
+            operation->task = NULL;
+
+            lua_State *L = operation->_OnCompleteDelegate.getVM();
+            if (L && operation->_OnCompleteDelegate.getCount())
+            {
+                operation->_OnCompleteDelegate.pushArgument(task->success);
+                pushOwnedByteArray(L, output);
+                operation->_OnCompleteDelegate.incArgCount();
+                output = NULL;
+
+                operation->_OnCompleteDelegate.invoke();
+            }
+        }
+
+        lmDelete(NULL, output);
+        lmDelete(NULL, task);
+    }
+};
 
 static int registerSystemByteArray(lua_State *L)
 {
@@ -66,6 +313,27 @@ static int registerSystemByteArray(lua_State *L)
 
        .endClass()
 
+       .beginClass<CompressionStream> ("CompressionStream")
+       .addConstructor<void (*)(void)>()
+       .addMethod("beginDeflate", &CompressionStream::beginDeflate)
+       .addMethod("beginInflate", &CompressionStream::beginInflate)
+       .addMethod("write", &CompressionStream::write)
+       .addMethod("finish", &CompressionStream::finish)
+       .addMethod("end", &CompressionStream::end)
+       .addProperty("active", &CompressionStream::isActive)
+       .addProperty("finished", &CompressionStream::isFinished)
+       .addProperty("totalIn", &CompressionStream::getTotalIn)
+       .addProperty("totalOut", &CompressionStream::getTotalOut)
+       .endClass()
+
+       .beginClass<CompressionOperation> ("CompressionOperation")
+       .addConstructor<void (*)(void)>()
+       .addVarAccessor("onComplete", &CompressionOperation::getOnCompleteDelegate)
+       .addMethod("isPending", &CompressionOperation::isPending)
+       .addMethod("compress", &CompressionOperation::compress)
+       .addMethod("uncompress", &CompressionOperation::uncompress)
+       .endClass()
+
        .endPackage();
 
     return 0;
@@ -75,4 +343,6 @@ static int registerSystemByteArray(lua_State *L)
 void installSystemByteArray()
 {
     NativeInterface::registerNativeType<utByteArray>(registerSystemByteArray);
+    NativeInterface::registerNativeType<CompressionStream>(registerSystemByteArray);
+    NativeInterface::registerNativeType<CompressionOperation>(registerSystemByteArray);
 }
@@ -19,24 +19,80 @@
  */
 
 #include "loom/script/loomscript.h"
+#include "loom/common/core/log.h"
+#include "loom/common/platform/platformTime.h"
 
 using namespace LS;
 
+lmDefineLogGroup(gCoroutineLogGroup, "coroutine", 1, LoomLogInfo);
+
+// Finished threads kept for new coroutines, each is pre-grown to
+// COROUTINE_STACK_SIZE slots so typical coroutines never resize their stack
+#define COROUTINE_POOL_MAX      256
+#define COROUTINE_STACK_SIZE    64
+
+// A coroutine started with Coroutine.start, resumed by the scheduler once
+// its wait is over
+struct ScheduledCoroutine
+{
+    // NULL once the coroutine finished or was cancelled
+    lua_State *thread;
+
+    // registry references keeping the thread and Coroutine instance alive
+    int threadRef;
+    int instanceRef;
+
+    // platform_getMilliseconds() from which on the coroutine is resumed
+    int wakeTime;
+
+    // NativeDelegate waited for and the listener added to it, LUA_NOREF
+    // unless waiting for a delegate
+    int delegateRef;
+    int listenerRef;
+    bool signaled;
+};
+
+// Lives in a userdata of the VM, so it goes away with it
+struct CoroutineScheduler
+{
+    utArray<ScheduledCoroutine *> scheduled;
+    utHashTable<utPointerHashKey, ScheduledCoroutine *> byThread;
+
+    ~CoroutineScheduler()
+    {
+        for (UTsize i = 0; i < scheduled.size(); i++)
+        {
+            lmDelete(NULL, scheduled[i]);
+        }
+    }
+
+    ScheduledCoroutine *find(lua_State *thread)
+    {
+        ScheduledCoroutine **entry = byThread.get(thread);
+        return entry ? *entry : NULL;
+    }
+};
+
 class Coroutine {
 public:
 
     static int resume(lua_State *L)
     {
-        // get the coroutine resume function
-        lua_getglobal(L, "coroutine");
-        lua_getfield(L, -1, "resume");
+        lua_State *co = lua_tothread(L, 1);
 
-        // push the thread on the stack
-        lua_pushvalue(L, 1);
+        if (!co)
+        {
+            LSError("Coroutine resumed without a thread");
+        }
 
-        // unwind our var args
+        // unwind our var args onto the thread
         int length = lsr_vector_get_length(L, 2);
 
+        if (!lua_checkstack(co, length))
+        {
+            LSError("Too many arguments to Coroutine.resume");
+        }
+
         lua_rawgeti(L, 2, LSINDEXVECTOR);
         int vidx = lua_gettop(L);
 
@@ -45,29 +101,19 @@ public:
             lua_rawgeti(L, vidx, i);
         }
 
-        // get rid of the vector table
-        lua_remove(L, vidx);
+        lua_xmove(L, co, length);
 
-        // call resume on the thread
-        lua_call(L, length + 1, LUA_MULTRET);
+        // get rid of the vector table
+        lua_pop(L, 1);
 
-        int top = lua_gettop(L);
+        int status = resumeThread(L, co, length);
 
-        // get the coroutine status
-        // and flag coroutine instance as dead
-        // if necessary
-        lua_getglobal(L, "coroutine");
-        lua_getfield(L, -1, "status");
-        lua_pushvalue(L, 1);
-        lua_call(L, 1, 1);
-        if (!strcmp(lua_tostring(L, -1), "dead"))
+        // flag coroutine instance as dead if necessary
+        if (status != LUA_YIELD)
         {
-            lua_pushboolean(L, 0);
-            lualoom_setmember(L, 3, "alive");
+            finish(L, 3, 1, status == 0);
         }
 
-        lua_settop(L, top);
-
         // return the value of the yield(x) if any
         return 1;
     }
@@ -103,22 +149,15 @@ public:
 
             int methodIdx = method->isStatic() ? 2 : 3;
 
-            lua_getglobal(L, "coroutine");
-            lua_getfield(L, -1, "create");
             lua_getupvalue(L, 1, methodIdx);
-            lua_call(L, 1, LUA_MULTRET);
+            createThread(L, lua_gettop(L));
 
             return 1;
         }
 
         if (lua_isfunction(L, 1))
         {
-            lua_getglobal(L, "coroutine");
-            lua_getfield(L, -1, "create");
-            lua_pushvalue(L, 1);
-            lua_call(L, 1, LUA_MULTRET);
-
-            lmAssert(lua_isthread(L, -1), "non thread");
+            createThread(L, 1);
 
             return 1;
         }
@@ -126,8 +165,382 @@ public:
         lua_pushnil(L);
         return 1;
     }
+
+    // Hands the coroutine at index 2 with the thread at index 1 to the
+    // scheduler, which resumes it on the next update
+    static int schedule(lua_State *L)
+    {
+        lua_State *co = lua_tothread(L, 1);
+
+        CoroutineScheduler *scheduler = getScheduler(L, true);
+
+        if (!co || scheduler->find(co))
+        {
+            return 0;
+        }
+
+        ScheduledCoroutine *entry = lmNew(NULL) ScheduledCoroutine;
+        entry->thread = co;
+        lua_pushvalue(L, 1);
+        entry->threadRef = luaL_ref(L, LUA_REGISTRYINDEX);
+        lua_pushvalue(L, 2);
+        entry->instanceRef = luaL_ref(L, LUA_REGISTRYINDEX);
+        entry->wakeTime    = platform_getMilliseconds();
+        entry->delegateRef = LUA_NOREF;
+        entry->listenerRef = LUA_NOREF;
+        entry->signaled    = false;
+
+        scheduler->scheduled.push_back(entry);
+        scheduler->byThread.insert(co, entry);
+
+        return 0;
+    }
+
+    static int cancel(lua_State *L)
+    {
+        lua_State *co = lua_tothread(L, 1);
+
+        if (co)
+        {
+            unschedule(L, co);
+        }
+
+        return 0;
+    }
+
+    // Suspends the calling started coroutine, the scheduler resumes it
+    // once the given seconds have passed
+    static int waitSeconds(lua_State *L)
+    {
+        ScheduledCoroutine *entry = getRunningEntry(L, "waitSeconds");
+
+        entry->wakeTime = platform_getMilliseconds() + (int)(lua_tonumber(L, 1) * 1000.0);
+
+        return lua_yield(L, 0);
+    }
+
+    // Suspends the calling started coroutine, the scheduler resumes it
+    // on the update after the NativeDelegate at index 1 is invoked
+    static int waitFor(lua_State *L)
+    {
+        ScheduledCoroutine *entry = getRunningEntry(L, "waitFor");
+
+        // the listener knows the coroutine by its thread, it is only ever
+        // matched against the scheduled coroutines
+        lua_pushcfunction(L, NativeDelegate::__op_plusassignment);
+        lua_pushvalue(L, 1);
+        lua_pushthread(L);
+        lua_pushcclosure(L, signal, 1);
+
+        lua_pushvalue(L, -1);
+        entry->listenerRef = luaL_ref(L, LUA_REGISTRYINDEX);
+        lua_pushvalue(L, 1);
+        entry->delegateRef = luaL_ref(L, LUA_REGISTRYINDEX);
+        entry->signaled    = false;
+
+        lua_call(L, 2, 0);
+
+        return lua_yield(L, 0);
+    }
+
+    static int update(lua_State *L)
+    {
+        lualoom_updatecoroutines(L);
+        return 0;
+    }
+
+    static void updateScheduled(lua_State *L)
+    {
+        CoroutineScheduler *scheduler = getScheduler(L, false);
+
+        if (!scheduler)
+        {
+            return;
+        }
+
+        int now = platform_getMilliseconds();
+        int top = lua_gettop(L);
+
+        // coroutines started while updating are first resumed next update
+        UTsize count = scheduler->scheduled.size();
+
+        for (UTsize i = 0; i < count; i++)
+        {
+            ScheduledCoroutine *entry = scheduler->scheduled[i];
+
+            if (!entry->thread)
+            {
+                continue;
+            }
+
+            if (entry->delegateRef != LUA_NOREF)
+            {
+                if (!entry->signaled)
+                {
+                    continue;
+                }
+
+                clearWait(L, entry);
+            }
+            else if (now - entry->wakeTime < 0)
+            {
+                continue;
+            }
+
+            // a plain yield() resumes next update
+            entry->wakeTime = now;
+
+            lua_State *co = entry->thread;
+
+            lua_rawgeti(L, LUA_REGISTRYINDEX, entry->threadRef);
+            lua_rawgeti(L, LUA_REGISTRYINDEX, entry->instanceRef);
+
+            int status = resumeThread(L, co, 0);
+
+            if (status != LUA_YIELD)
+            {
+                if (status != 0)
+                {
+                    lmLogError(gCoroutineLogGroup, "Error in started coroutine: %s", lua_tostring(L, -1));
+                }
+
+                finish(L, top + 2, top + 1, status == 0);
+
+                // the script resume() does this for coroutines it resumes
+                lua_pushnil(L);
+                lualoom_setmember(L, top + 2, "_this");
+                lua_pushnil(L);
+                lualoom_setmember(L, top + 2, "thread");
+            }
+
+            lua_settop(L, top);
+        }
+
+        // drop the finished and cancelled coroutines
+        UTsize live = 0;
+
+        for (UTsize i = 0; i < scheduler->scheduled.size(); i++)
+        {
+            ScheduledCoroutine *entry = scheduler->scheduled[i];
+
+            if (entry->thread)
+            {
+                scheduler->scheduled[live++] = entry;
+            }
+            else
+            {
+                lmDelete(NULL, entry);
+            }
+        }
+
+        scheduler->scheduled.resize(live);
+    }
+
+private:
+
+    static int gcScheduler(lua_State *L)
+    {
+        CoroutineScheduler *scheduler = (CoroutineScheduler *)lua_touserdata(L, 1);
+
+        scheduler->~CoroutineScheduler();
+        return 0;
+    }
+
+    static CoroutineScheduler *getScheduler(lua_State *L, bool create)
+    {
+        lua_rawgeti(L, LUA_GLOBALSINDEX, LSINDEXCOROUTINESCHEDULER);
+        CoroutineScheduler *scheduler = (CoroutineScheduler *)lua_touserdata(L, -1);
+        lua_pop(L, 1);
+
+        if (scheduler || !create)
+        {
+            return scheduler;
+        }
+
+        scheduler = new (lua_newuserdata(L, sizeof(CoroutineScheduler))) CoroutineScheduler();
+
+        lua_newtable(L);
+        lua_pushcfunction(L, gcScheduler);
+        lua_setfield(L, -2, "__gc");
+        lua_setmetatable(L, -2);
+
+        lua_rawseti(L, LUA_GLOBALSINDEX, LSINDEXCOROUTINESCHEDULER);
+
+        return scheduler;
+    }
+
+    static ScheduledCoroutine *getRunningEntry(lua_State *L, const char *function)
+    {
+        CoroutineScheduler *scheduler = getScheduler(L, false);
+        ScheduledCoroutine *entry     = scheduler ? scheduler->find(L) : NULL;
+
+        if (!entry)
+        {
+            LSError("Coroutine.%s called outside of a coroutine started with Coroutine.start", function);
+        }
+
+        return entry;
+    }
+
+    // listener added by waitFor, upvalue 1 is the waiting thread
+    static int signal(lua_State *L)
+    {
+        CoroutineScheduler *scheduler = getScheduler(L, false);
+        ScheduledCoroutine *entry     = scheduler ? scheduler->find(lua_tothread(L, lua_upvalueindex(1))) : NULL;
+
+        if (entry)
+        {
+            entry->signaled = true;
+        }
+
+        return 0;
+    }
+
+    // Removes the waitFor listener of the entry from its delegate
+    static void clearWait(lua_State *L, ScheduledCoroutine *entry)
+    {
+        if (entry->delegateRef == LUA_NOREF)
+        {
+            return;
+        }
+
+        // protected, the native side of the delegate may be gone by now
+        lua_pushcfunction(L, NativeDelegate::__op_minusassignment);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, entry->delegateRef);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, entry->listenerRef);
+
+        if (lua_pcall(L, 2, 0, 0))
+        {
+            lua_pop(L, 1);
+        }
+
+        luaL_unref(L, LUA_REGISTRYINDEX, entry->delegateRef);
+        luaL_unref(L, LUA_REGISTRYINDEX, entry->listenerRef);
+        entry->delegateRef = LUA_NOREF;
+        entry->listenerRef = LUA_NOREF;
+    }
+
+    // Stops scheduling the thread if it was started, the entry itself is
+    // freed by the next update
+    static void unschedule(lua_State *L, lua_State *co)
+    {
+        CoroutineScheduler *scheduler = getScheduler(L, false);
+        ScheduledCoroutine *entry     = scheduler ? scheduler->find(co) : NULL;
+
+        if (!entry)
+        {
+            return;
+        }
+
+        clearWait(L, entry);
+
+        luaL_unref(L, LUA_REGISTRYINDEX, entry->threadRef);
+        luaL_unref(L, LUA_REGISTRYINDEX, entry->instanceRef);
+        entry->thread = NULL;
+
+        scheduler->byThread.erase(co);
+    }
+
+    // Pushes a new thread running the function at funcIdx, reusing a
+    // pooled one if possible
+    static void createThread(lua_State *L, int funcIdx)
+    {
+        lua_State *co = NULL;
+
+        lua_rawgeti(L, LUA_GLOBALSINDEX, LSINDEXCOROUTINEPOOL);
+
+        int n = lua_istable(L, -1) ? (int)lua_objlen(L, -1) : 0;
+
+        if (n > 0)
+        {
+            lua_rawgeti(L, -1, n);
+            lua_pushnil(L);
+            lua_rawseti(L, -3, n);
+            lua_remove(L, -2);
+            co = lua_tothread(L, -1);
+        }
+        else
+        {
+            lua_pop(L, 1);
+            co = lua_newthread(L);
+            lua_checkstack(co, COROUTINE_STACK_SIZE);
+        }
+
+        lua_pushvalue(L, funcIdx);
+        lua_xmove(L, co, 1);
+    }
+
+    // Resumes the thread with the nargs values on its stack and pushes what
+    // Coroutine.resume returns: the last value yielded or returned, true if
+    // there is none, or the error message. Returns the lua_resume status.
+    static int resumeThread(lua_State *L, lua_State *co, int nargs)
+    {
+        int status = lua_resume(co, nargs);
+
+        if ((status == 0) || (status == LUA_YIELD))
+        {
+            if (lua_gettop(co) > 0)
+            {
+                lua_xmove(co, L, 1);
+                lua_settop(co, 0);
+            }
+            else
+            {
+                lua_pushboolean(L, 1);
+            }
+        }
+        else
+        {
+            lua_xmove(co, L, 1);
+        }
+
+        return status;
+    }
+
+    // Flags the Coroutine instance at instanceIdx as dead and stops
+    // scheduling its thread at threadIdx, a thread which ran to completion
+    // goes back to the pool
+    static void finish(lua_State *L, int instanceIdx, int threadIdx, bool completed)
+    {
+        lua_pushboolean(L, 0);
+        lualoom_setmember(L, instanceIdx, "alive");
+
+        lua_State *co = lua_tothread(L, threadIdx);
+
+        unschedule(L, co);
+
+        if (!completed || lua_status(co) || lua_gettop(co))
+        {
+            return;
+        }
+
+        lua_rawgeti(L, LUA_GLOBALSINDEX, LSINDEXCOROUTINEPOOL);
+
+        if (!lua_istable(L, -1))
+        {
+            lua_pop(L, 1);
+            lua_newtable(L);
+            lua_pushvalue(L, -1);
+            lua_rawseti(L, LUA_GLOBALSINDEX, LSINDEXCOROUTINEPOOL);
+        }
+
+        int n = (int)lua_objlen(L, -1);
+
+        if (n < COROUTINE_POOL_MAX)
+        {
+            lua_pushvalue(L, threadIdx);
+            lua_rawseti(L, -2, n + 1);
+        }
+
+        lua_pop(L, 1);
+    }
 };
 
+void lualoom_updatecoroutines(lua_State *L)
+{
+    Coroutine::updateScheduled(L);
+}
+
 static int registerSystemCoroutine(lua_State *L)
 {
     beginPackage(L, "system")
@@ -136,7 +549,11 @@ static int registerSystemCoroutine(lua_State *L)
 
        .addStaticLuaFunction("_resume", &Coroutine::resume)
        .addStaticLuaFunction("_create", &Coroutine::create)
-
+       .addStaticLuaFunction("_schedule", &Coroutine::schedule)
+       .addStaticLuaFunction("_cancel", &Coroutine::cancel)
+       .addStaticLuaFunction("waitSeconds", &Coroutine::waitSeconds)
+       .addStaticLuaFunction("waitFor", &Coroutine::waitFor)
+       .addStaticLuaFunction("update", &Coroutine::update)
 
        .endClass()
 
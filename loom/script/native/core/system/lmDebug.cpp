@@ -76,6 +76,15 @@ public:
     // if true, we are running under the debugger
     static bool debuggerRunning;
 
+    // if true, line events are only hooked inside functions with breakpoints
+    // and call/return events only while there are breakpoints or we're stepping,
+    // so the game runs at close to full speed with the debugger attached
+    static bool breakpointHooks;
+
+    // whether each MethodBase has a breakpoint between its first and last line,
+    // cleared whenever the breakpoints change
+    static utHashTable<utPointerHashKey, bool> methodBreakpoints;
+
     // if true, an assertion event has happened
     // this is a fatal error that we can inspect the state
     // however, execution is frozen at this point
@@ -368,8 +377,115 @@ public:
         return 1;
     }
 
+    // In breakpoint hook mode, the debugger state is polled this often (in VM instructions)
+    // to pick up breakpoints and steps requested while no other events are hooked
+#define BREAKPOINT_HOOK_POLL    1000
+
+    // tests whether the function of the given stack frame has a breakpoint in its lines
+    static bool frameHasBreakpoint(lua_State *L, lua_Debug *ar)
+    {
+        if (!lua_getinfo(L, "Sf", ar))
+        {
+            return false;
+        }
+
+        if (lua_iscfunction(L, -1))
+        {
+            lua_pop(L, 1);
+            return false;
+        }
+
+        // methods are looked up once, local functions have no MethodBase
+        // and are checked every time
+        lua_rawgeti(L, LUA_GLOBALSINDEX, LSINDEXMETHODLOOKUP);
+        lua_pushvalue(L, -2);
+        lua_rawget(L, -2);
+
+        MethodBase *methodBase = (MethodBase *)lua_topointer(L, -1);
+        lua_pop(L, 3);
+
+        if (methodBase)
+        {
+            bool *cached = methodBreakpoints.get(methodBase);
+
+            if (cached)
+            {
+                return *cached;
+            }
+        }
+
+        bool found = false;
+
+        utArray<Breakpoint *> *bps = getSourceBreakpoints(ar->source);
+
+        for (UTsize i = 0; bps && i < bps->size(); i++)
+        {
+            int line = bps->at(i)->line;
+
+            if ((line >= ar->linedefined) && (line <= ar->lastlinedefined))
+            {
+                found = true;
+                break;
+            }
+        }
+
+        if (methodBase)
+        {
+            methodBreakpoints.insert(methodBase, found);
+        }
+
+        return found;
+    }
+
+    // In breakpoint hook mode, sets the hooks needed by the function running
+    // once the current event is handled
+    static void updateHookMask(lua_State *L, int event)
+    {
+        int mask;
+
+        if (stepping || debugBreak || finishMethod || assertion)
+        {
+            // stepping and finishing need every event
+            mask = LUA_MASKRET | LUA_MASKLINE | LUA_MASKCALL;
+        }
+        else if (!breakpoints.size())
+        {
+            mask = LUA_MASKCOUNT;
+        }
+        else
+        {
+            mask = LUA_MASKRET | LUA_MASKCALL | LUA_MASKCOUNT;
+
+            // on a return, the caller is the one that continues
+            int       level = ((event == LUA_HOOKRET) || (event == LUA_HOOKTAILRET)) ? 1 : 0;
+            lua_Debug frame;
+
+            if (lua_getstack(L, level, &frame) && frameHasBreakpoint(L, &frame))
+            {
+                mask |= LUA_MASKLINE;
+            }
+        }
+
+        if (mask != lua_gethookmask(L))
+        {
+            lua_sethook(L, debugHook, mask, BREAKPOINT_HOOK_POLL);
+        }
+    }
+
     // Main lua VM debug hook
     static void debugHook(lua_State *L, lua_Debug *ar)
+    {
+        int event = ar->event;
+
+        handleHookEvent(L, ar);
+
+        if (breakpointHooks)
+        {
+            updateHookMask(L, event);
+        }
+    }
+
+    static void handleHookEvent(lua_State *L, lua_Debug *ar)
     {
         int top = lua_gettop(L);
 
@@ -462,11 +578,33 @@ public:
     // we are now running under the debugger
     static int setDebugHook(lua_State *L)
     {
-        lua_sethook(L, debugHook, LUA_MASKRET | LUA_MASKLINE | LUA_MASKCALL, 1);
+        breakpointHooks = lua_toboolean(L, 1) != 0;
+
         debuggerRunning    = true;
         lastSourceEvent[0] = 0;
         lastLineEvent      = -1;
 
+        if (breakpointHooks)
+        {
+            updateHookMask(L, LUA_HOOKCOUNT);
+        }
+        else
+        {
+            lua_sethook(L, debugHook, LUA_MASKRET | LUA_MASKLINE | LUA_MASKCALL, 1);
+        }
+
+        return 0;
+    }
+
+    // picks up a change of the debugger state right away in breakpoint hook mode,
+    // rather than at the next poll
+    static int updateDebugHook(lua_State *L)
+    {
+        if (debuggerRunning && breakpointHooks)
+        {
+            updateHookMask(L, LUA_HOOKCOUNT);
+        }
+
         return 0;
     }
 
@@ -815,12 +953,23 @@ public:
         return 1;
     }
 
-    // tests whether the given breakpoint exists
-    static bool hasBreakpoint(const char *source, int line)
+    // the breakpoints of the given source file, NULL if there are none
+    static utArray<Breakpoint *> *getSourceBreakpoints(const char *source)
     {
+        if (!sourceBreakpoints.size())
+        {
+            return NULL;
+        }
+
         utString path(source);
         path.replace('\\', '/');
-        utArray<Breakpoint *> *bps = sourceBreakpoints.get(utFastStringHash(path));
+        return sourceBreakpoints.get(utFastStringHash(path));
+    }
+
+    // tests whether the given breakpoint exists
+    static bool hasBreakpoint(const char *source, int line)
+    {
+        utArray<Breakpoint *> *bps = getSourceBreakpoints(source);
 
         if (!bps)
         {
@@ -841,6 +990,7 @@ public:
     static void regenerateSourceBreakpoints()
     {
         sourceBreakpoints.clear();
+        methodBreakpoints.clear();
 
         for (UTsize i = 0; i < breakpoints.size(); i++)
         {
@@ -1018,6 +1168,9 @@ bool Debug::debugBreak = false;
 MethodBase *Debug::finishMethod = NULL;
 
 bool Debug::debuggerRunning = false;
+bool Debug::breakpointHooks = false;
+
+utHashTable<utPointerHashKey, bool> Debug::methodBreakpoints;
 
 int registerSystemDebug(lua_State *L)
 {
@@ -1035,6 +1188,7 @@ int registerSystemDebug(lua_State *L)
        .addStaticLuaFunction("assert", &Debug::loomAssert)
        .addStaticLuaFunction("dump", &Debug::loomDump)
        .addStaticLuaFunction("setDebugHook", &Debug::setDebugHook)
+       .addStaticLuaFunction("updateDebugHook", &Debug::updateDebugHook)
        .addStaticLuaFunction("getLocals", &Debug::getLocals)
        .addStaticLuaFunction("getCallStack", &Debug::getCallStackInfo)
 
@@ -60,6 +60,11 @@ public:
 
         int tidx = lua_gettop(L);
 
+#ifndef LOOM_ENABLE_JIT
+        // counted by the VM and kept until the pairs are next written, so
+        // loops checking the length each iteration stay linear
+        lua_pushnumber(L, lua_loomtablecount(L, tidx));
+#else
         int count = 0;
         lua_pushnil(L);         /* first key */
         while (lua_next(L, tidx) != 0)
@@ -70,6 +75,7 @@ public:
         }
 
         lua_pushnumber(L, count);
+#endif
         return 1;
     }
 
@@ -28,34 +28,7 @@ public:
 
     static int _length(lua_State *L)
     {
-        lmAssert(lua_isfunction(L, 1) || lua_iscfunction(L, 1), "Non-function in Function._length");
-
-        // first look in the global method lookup to see if we have a method base to go off
-        lua_rawgeti(L, LUA_GLOBALSINDEX, LSINDEXMETHODLOOKUP);
-        lua_pushvalue(L, 1);
-        lua_rawget(L, -2);
-
-        if (!lua_isnil(L, -1))
-        {
-            MethodBase *methodBase = (MethodBase *)lua_topointer(L, -1);
-            lua_pushnumber(L, methodBase->getNumParameters());
-            return 1;
-        }
-
-        // we don't, so we better be a local function with an upvalue at index 1 describing the number of parameters
-        const char *upvalue = lua_getupvalue(L, 1, 1);
-
-        lmAssert(upvalue, "Internal Error: funcinfo not at upvalue 1");
-
-#ifdef LOOM_DEBUG
-        lmAssert(!strncmp(upvalue, "__ls_funcinfo_arginfo", 21), "Internal Error: funcinfo not __ls_funcinfo_arginfo");
-#endif
-
-        lmAssert(lua_isnumber(L, -1), "Internal Error: __ls_funcinfo_arginfo not a number");
-
-        // number of args stored in upper 16 bits, so shift and return
-        lua_pushnumber(L, ((unsigned int) lua_tonumber(L, -1)) >> 16);
-
+        lua_pushnumber(L, lualoom_getfunctionparametercount(L, 1));
         return 1;
     }
 
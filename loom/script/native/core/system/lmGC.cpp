@@ -19,11 +19,13 @@
  */
 
 #include "loom/common/core/log.h"
+#include "loom/common/core/allocator.h"
 #include "loom/script/native/lsLuaBridge.h"
 #include "loom/script/runtime/lsLuaState.h"
 #include "loom/common/platform/platformTime.h"
 #include "loom/graphics/gfxMath.h"
 #include "loom/common/core/telemetry.h"
+#include "loom/script/runtime/lsProfiler.h"
 
 namespace LS {
 
@@ -55,6 +57,10 @@ class GC
     static int cycleWarningExtraRunDivider;
     static double bprValidityThreshold;
     static double cyclePrevGarbage;
+    static double frameBudgetNano;
+    static double nanosPerRun;
+    static long long externalLimit;
+    static long long externalAtCollect;
 
 public:
 
@@ -71,6 +77,20 @@ public:
         return 1;
     }    
 
+    static int getExternalMemory(lua_State *L)
+    {
+        lua_pushnumber(L, (double)loom_allocator_getExternalBytes() / 1024 / 1024);
+        return 1;
+    }
+
+    static int setExternalMemoryLimit(lua_State *L)
+    {
+        double mb = lua_tonumber(L, 1);
+        externalLimit = mb > 0 ? (long long)(mb * 1024 * 1024) : 0;
+        externalAtCollect = loom_allocator_getExternalBytes();
+        return 0;
+    }
+
     static int update(lua_State *L)
     {
         int startTime = platform_getMilliseconds();    
@@ -86,16 +106,31 @@ public:
 
         }
 
-        int memoryBeforeKB = lua_gc(L, LUA_GCCOUNT, 0);
-        int memoryBeforeB = lua_gc(L, LUA_GCCOUNTB, 0);
+        // Native memory held by script objects counts as heap, so growing
+        // it speeds up collection and freeing it counts as collected
+        long long externalBefore = loom_allocator_getExternalBytes();
+        int memoryBeforeKB = lua_gc(L, LUA_GCCOUNT, 0) + (int)(externalBefore / 1024);
+        int memoryBeforeB = lua_gc(L, LUA_GCCOUNTB, 0) + (int)(externalBefore % 1024);
 
         int runLimit = updateRunLimit;
         int runs = 0;
         int cyclesFinished = 0;
+        bool budgetLimited = false;
 
         loom_resetTimer(timer);
 
-        int stepTime;
+        // With a limit, finalize the garbage holding native memory promptly
+        // with a full collection once the limit has been allocated since the
+        // last one, instead of waiting for the incremental cycle
+        if (externalLimit > 0 && externalBefore - externalAtCollect > externalLimit)
+        {
+            lua_gc(L, LUA_GCCOLLECT, 0);
+            cyclesFinished++;
+            externalAtCollect = loom_allocator_getExternalBytes();
+            lmLogDebug(gGCGroup, "External memory limit reached, collected %lld KiB of it", (externalBefore - externalAtCollect) / 1024);
+        }
+
+        unsigned long long stepTime;
         
         // Uncomment this to test a full GC collection cycle per frame
         //lua_gc(L, LUA_GCCOLLECT, 0); cyclesFinished++; cycleRuns++;
@@ -103,18 +138,32 @@ public:
         // This loop is more or less equivalent to
         // int cycle = lua_gc(L, LUA_GCSTEP, runLimit);
         // except with an additional time limit and other features
-        while (runs < runLimit && loom_readTimerNano(timer) < updateNanoLimit)
+        while (runs < runLimit)
         {
-            if (spikeCheck) stepTime = platform_getMilliseconds();
+            double elapsed = loom_readTimerNano(timer);
+
+            if (elapsed >= updateNanoLimit) break;
+
+            // With a frame budget, stop before the run that is expected to
+            // overrun it instead of after, judging by the measured time
+            // per run, but always make the minimum progress
+            if (frameBudgetNano > 0 && runs >= runLimitMin && elapsed + nanosPerRun > frameBudgetNano)
+            {
+                budgetLimited = true;
+                break;
+            }
+
+            if (spikeCheck) stepTime = platform_getNanoseconds();
             
             // Returns 1 when the entire Lua GC cycle finishes
             // calling LUA_GCSTEP with 0 as the argument only
             // makes a single internal GC step
             int cycle = lua_gc(L, LUA_GCSTEP, 0);
             
-            if (spikeCheck && platform_getMilliseconds() - stepTime > spikeThreshold)
+            if (spikeCheck)
             {
-                lmLogWarn(gGCGroup, "GC spike: %dms", platform_getMilliseconds() - stepTime);
+                double stepMs = (platform_getNanoseconds() - stepTime) / 1e6;
+                if (stepMs > spikeThreshold) lmLogWarn(gGCGroup, "GC spike: %.2fms", stepMs);
             }
             
             if (cycle == 1) {
@@ -130,12 +179,23 @@ public:
         double timeDelta = loom_readTimerNano(timer);
         cycleUpdateTime += timeDelta;
         if (timeDelta > cycleMaxTime) cycleMaxTime = timeDelta;
+
+        // Smoothed time per run for the frame budget
+        if (runs > 0)
+        {
+            double sample = timeDelta / runs;
+            nanosPerRun = nanosPerRun > 0 ? nanosPerRun * 0.9 + sample * 0.1 : sample;
+        }
         
         // Prevent the garbage collector from running on its own
         lua_gc(L, LUA_GCSTOP, 0);
 
-        int memoryAfterKB = lua_gc(L, LUA_GCCOUNT, 0);
-        int memoryAfterB = lua_gc(L, LUA_GCCOUNTB, 0);
+        long long externalAfter = loom_allocator_getExternalBytes();
+        int memoryAfterKB = lua_gc(L, LUA_GCCOUNT, 0) + (int)(externalAfter / 1024);
+        int memoryAfterB = lua_gc(L, LUA_GCCOUNTB, 0) + (int)(externalAfter % 1024);
+
+        // Freed by finalizers, it won't have to be collected again
+        if (externalAfter < externalAtCollect) externalAtCollect = externalAfter;
         int memoryDelta = (memoryAfterKB - memoryBeforeKB) * 1024 + memoryAfterB - memoryBeforeB;
 
         cycleUpdates++;
@@ -243,6 +303,21 @@ public:
         Telemetry::setTickValue("gc.cycle.lastValidBPR", lastValidBPR);
         Telemetry::setTickValue("gc.cycle.hibernating", hibernating ? 1 : 0);
         Telemetry::setTickValue("gc.memory", (double) memoryAfterKB * 1024 + memoryAfterB);
+        Telemetry::setTickValue("gc.memory.external", (double) externalAfter);
+        Telemetry::setTickValue("gc.update.time", timeDelta);
+        Telemetry::setTickValue("gc.update.runs", runs);
+
+        LSProfiler::reportAllocationSamples();
+        Telemetry::setTickValue("gc.update.collected", -memoryDelta);
+        Telemetry::setTickValue("gc.update.nanosPerRun", nanosPerRun);
+        Telemetry::setTickValue("gc.update.budget", frameBudgetNano);
+        Telemetry::setTickValue("gc.update.budgetLimited", budgetLimited ? 1 : 0);
+
+        size_t allocBytes, allocCount, allocReserved;
+        LSLuaState::getLuaState(L)->getAllocatorStats(&allocBytes, &allocCount, &allocReserved);
+        Telemetry::setTickValue("gc.alloc.bytes", (double)allocBytes);
+        Telemetry::setTickValue("gc.alloc.count", (double)allocCount);
+        Telemetry::setTickValue("gc.alloc.slabs", (double)allocReserved);
 
 
         return 0;
@@ -254,6 +329,19 @@ public:
         memoryWarningLevel = (int) lua_tonumber(L, 1);
         return 0;
     }
+
+    static int setFrameBudget(lua_State *L)
+    {
+        double ms = lua_tonumber(L, 1);
+        frameBudgetNano = ms > 0 ? ms * 1e6 : 0;
+        return 0;
+    }
+
+    static int getFrameBudget(lua_State *L)
+    {
+        lua_pushnumber(L, frameBudgetNano * 1e-6);
+        return 1;
+    }
 };
 
 loom_precision_timer_t GC::timer = loom_startTimer();
@@ -349,6 +437,21 @@ double GC::cyclePrevGarbage = 0;
 // See above for details.
 bool GC::hibernating = false;
 
+// The time in nanoseconds each update may spend collecting, 0 if
+// only updateNanoLimit applies. Unlike updateNanoLimit, the budget
+// stops an update before a run that is expected to exceed it.
+double GC::frameBudgetNano = 0;
+
+// Smoothed time a single run takes in nanoseconds, measured each update
+double GC::nanosPerRun = 0;
+
+// The external memory in bytes that may be allocated between full
+// collections, 0 to leave it to the incremental collection
+long long GC::externalLimit = 0;
+
+// The external memory in bytes after the last full collection
+long long GC::externalAtCollect = 0;
+
 
 void lualoom_gc_update(lua_State *L)
 {
@@ -374,8 +477,12 @@ int registerSystemGC(lua_State *L)
 
        .addStaticLuaFunction("collect", &GC::collect)
        .addStaticLuaFunction("getAllocatedMemory", &GC::getAllocatedMemory)
+       .addStaticLuaFunction("getExternalMemory", &GC::getExternalMemory)
+       .addStaticLuaFunction("setExternalMemoryLimit", &GC::setExternalMemoryLimit)
        .addStaticLuaFunction("update", &GC::update)
        .addStaticLuaFunction("setMemoryWarningLevel", &GC::setMemoryWarningLevel)
+       .addStaticLuaFunction("setFrameBudget", &GC::setFrameBudget)
+       .addStaticLuaFunction("getFrameBudget", &GC::getFrameBudget)
 
        .endClass()
 
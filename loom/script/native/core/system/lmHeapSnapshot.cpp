@@ -0,0 +1,59 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/script/loomscript.h"
+#include "loom/script/runtime/lsHeapSnapshot.h"
+
+using namespace LS;
+
+static int registerSystemHeapSnapshot(lua_State *L)
+{
+    beginPackage(L, "system")
+
+       .beginClass<HeapSnapshot> ("HeapSnapshot")
+
+       .addConstructor<void (*)(void)>()
+       .addLuaFunction("take", &HeapSnapshot::take)
+       .addMethod("diff", &HeapSnapshot::diff)
+       .addMethod("send", &HeapSnapshot::send)
+       .addLuaFunction("toJSON", &HeapSnapshot::toJSON)
+       .addProperty("classCount", &HeapSnapshot::getClassCount)
+       .addProperty("objectCount", &HeapSnapshot::getObjectCount)
+       .addProperty("totalSize", &HeapSnapshot::getTotalSize)
+       .addProperty("walkTime", &HeapSnapshot::getWalkTime)
+       .addMethod("findClass", &HeapSnapshot::findClass)
+       .addMethod("getClassName", &HeapSnapshot::getClassName)
+       .addMethod("getCount", &HeapSnapshot::getCount)
+       .addMethod("getSize", &HeapSnapshot::getSize)
+       .addMethod("getRetainedSize", &HeapSnapshot::getRetainedSize)
+       .addMethod("getRetainerPath", &HeapSnapshot::getRetainerPath)
+
+       .endClass()
+
+       .endPackage();
+
+    return 0;
+}
+
+
+void installSystemHeapSnapshot()
+{
+    NativeInterface::registerNativeType<HeapSnapshot>(registerSystemHeapSnapshot);
+}
@@ -18,8 +18,439 @@
  * ===========================================================================
  */
 
+#include <string.h>
+
+#include "loom/common/core/log.h"
 #include "loom/common/utils/json.h"
+#include "loom/common/utils/jsonReader.h"
+#include "loom/common/utils/utByteArray.h"
 #include "loom/script/loomscript.h"
+#include "loom/script/runtime/lsRuntime.h"
+
+lmDefineLogGroup(gJSONLogGroup, "json", 1, LoomLogInfo);
+
+/*
+ * JSON.decode and JSON.decodeBytes pull tokens from a JSONReader and build
+ * the Dictionary and Vector instances as they go, so a large payload never
+ * exists as a jansson tree as well as script objects.
+ */
+class JSONDecoder
+{
+public:
+
+    // Leaves the decoded value on the stack, or null and returns false on
+    // error, with the message in error.
+    static bool decode(lua_State *L, const char *json, UTsize length, char *error, size_t errorSize)
+    {
+        LSLuaState *ls = LSLuaState::getLuaState(L);
+
+        JSONReader reader(json, length);
+
+        int top = lua_gettop(L);
+
+        if (!decodeValue(L, ls, reader, reader.next()) || (reader.next() != JSON_READER_END))
+        {
+            snprintf(error, errorSize, "JSON Error: %s at position %d", reader.getError() ? reader.getError() : "unexpected token", (int)reader.getErrorOffset());
+            lua_settop(L, top);
+            lua_pushnil(L);
+            return false;
+        }
+
+        return true;
+    }
+
+    static int decode(lua_State *L)
+    {
+        size_t     length = 0;
+        const char *json  = lua_tolstring(L, 1, &length);
+        char       error[256];
+
+        if (!json)
+        {
+            lua_pushnil(L);
+            return 1;
+        }
+
+        if (!decode(L, json, (UTsize)length, error, sizeof(error)))
+        {
+            lmLogError(gJSONLogGroup, "%s", error);
+        }
+
+        return 1;
+    }
+
+    static int decodeBytes(lua_State *L)
+    {
+        utByteArray *bytes = (utByteArray *)lualoom_getnativepointer(L, 1, true, "system.ByteArray");
+        char        error[256];
+
+        if (!bytes)
+        {
+            lua_pushnil(L);
+            return 1;
+        }
+
+        if (!decode(L, (const char *)bytes->getDataPtr() + bytes->getPosition(), bytes->bytesAvailable(), error, sizeof(error)))
+        {
+            lmLogError(gJSONLogGroup, "%s", error);
+        }
+
+        return 1;
+    }
+
+    static int parseToObject(lua_State *L)
+    {
+        size_t     length = 0;
+        const char *json  = luaL_checklstring(L, 1, &length);
+        char       error[256];
+
+        if (!decode(L, json, (UTsize)length, error, sizeof(error)))
+        {
+            return luaL_error(L, "%s", error);
+        }
+
+        return 1;
+    }
+
+private:
+
+    // Pushes the value starting with token, false on error.
+    static bool decodeValue(lua_State *L, LSLuaState *ls, JSONReader& reader, JSONReaderToken token)
+    {
+        // The reader bounds the depth, each level needs a few slots.
+        luaL_checkstack(L, 4, "JSON nested too deeply");
+
+        UTsize     length;
+        const char *string;
+
+        switch (token)
+        {
+        case JSON_READER_OBJECT_BEGIN:
+        {
+            // Dictionary entries live in its pairs table, not the instance.
+            lsr_createinstance(L, ls->getType("system.Dictionary"));
+            lua_rawgeti(L, -1, LSINDEXDICTPAIRS);
+            int dictIdx = lua_gettop(L);
+
+            while ((token = reader.next()) == JSON_READER_KEY)
+            {
+                string = reader.getString(length);
+                lua_pushlstring(L, string, length);
+
+                if (!decodeValue(L, ls, reader, reader.next()))
+                {
+                    return false;
+                }
+
+                // null members are left out, as a Dictionary can't hold them
+                lua_rawset(L, dictIdx);
+            }
+
+            lua_pop(L, 1);
+            return token == JSON_READER_OBJECT_END;
+        }
+
+        case JSON_READER_ARRAY_BEGIN:
+        {
+            lsr_createinstance(L, ls->getType("system.Vector"));
+            int vectorIdx = lua_gettop(L);
+            lua_rawgeti(L, vectorIdx, LSINDEXVECTOR);
+            int tableIdx = vectorIdx + 1;
+
+            int count = 0;
+            while ((token = reader.next()) != JSON_READER_ARRAY_END)
+            {
+                if (!decodeValue(L, ls, reader, token))
+                {
+                    return false;
+                }
+
+                lua_rawseti(L, tableIdx, count++);
+            }
+
+            lua_pop(L, 1);
+            lsr_vector_set_length(L, vectorIdx, count);
+            return true;
+        }
+
+        case JSON_READER_STRING:
+            string = reader.getString(length);
+            lua_pushlstring(L, string, length);
+            return true;
+
+        case JSON_READER_NUMBER:
+            lua_pushnumber(L, reader.getNumber());
+            return true;
+
+        case JSON_READER_TRUE:
+        case JSON_READER_FALSE:
+            lua_pushboolean(L, token == JSON_READER_TRUE);
+            return true;
+
+        case JSON_READER_NULL:
+            lua_pushnil(L);
+            return true;
+
+        default:
+            return false;
+        }
+    }
+};
+
+/*
+ * JSON.encode writes Dictionary, Vector and primitive values out as JSON
+ * text in a single buffer, without building jansson nodes or the
+ * intermediate Strings JSON.stringify concatenates. Instances of other
+ * classes are handed to JSON.stringify.
+ */
+class JSONEncoder
+{
+public:
+
+    static int encode(lua_State *L)
+    {
+        JSONEncoder encoder(L);
+
+        lua_settop(L, 1);
+
+        if (!encoder.encodeValue(1, 0))
+        {
+            lmLogError(gJSONLogGroup, "JSON.encode: %s", encoder.error);
+            lua_pushnil(L);
+            return 1;
+        }
+
+        lua_pushlstring(L, encoder.buffer.ptr(), encoder.buffer.size());
+        return 1;
+    }
+
+private:
+
+    lua_State     *L;
+    LSLuaState    *ls;
+    Type          *vectorType;
+    Type          *dictionaryType;
+    utArray<char> buffer;
+    const char    *error;
+
+    JSONEncoder(lua_State *_L) : L(_L), error(NULL)
+    {
+        ls             = LSLuaState::getLuaState(L);
+        vectorType     = ls->getType("system.Vector");
+        dictionaryType = ls->getType("system.Dictionary");
+    }
+
+    void append(const char *s, size_t length)
+    {
+        if (!length)
+        {
+            return;
+        }
+
+        UTsize size = buffer.size();
+
+        buffer.resize(size + (UTsize)length);
+        memcpy(buffer.ptr() + size, s, length);
+    }
+
+    void appendString(const char *s, size_t length)
+    {
+        static const char hex[] = "0123456789abcdef";
+
+        buffer.push_back('"');
+
+        // Copy runs that need no escaping in one go.
+        size_t run = 0;
+        for (size_t i = 0; i < length; i++)
+        {
+            unsigned char c = (unsigned char)s[i];
+
+            if ((c >= 0x20) && (c != '"') && (c != '\\'))
+            {
+                continue;
+            }
+
+            append(s + run, i - run);
+            run = i + 1;
+
+            switch (c)
+            {
+            case '"': append("\\\"", 2); break;
+            case '\\': append("\\\\", 2); break;
+            case '\b': append("\\b", 2); break;
+            case '\f': append("\\f", 2); break;
+            case '\n': append("\\n", 2); break;
+            case '\r': append("\\r", 2); break;
+            case '\t': append("\\t", 2); break;
+            default:
+            {
+                char escaped[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+                append(escaped, 6);
+                break;
+            }
+            }
+        }
+
+        append(s + run, length - run);
+        buffer.push_back('"');
+    }
+
+    bool encodeValue(int idx, int depth)
+    {
+        size_t     length;
+        const char *string;
+
+        switch (lua_type(L, idx))
+        {
+        case LUA_TNIL:
+            append("null", 4);
+            return true;
+
+        case LUA_TBOOLEAN:
+            if (lua_toboolean(L, idx))
+            {
+                append("true", 4);
+            }
+            else
+            {
+                append("false", 5);
+            }
+            return true;
+
+        case LUA_TNUMBER:
+        {
+            double number = lua_tonumber(L, idx);
+
+            // JSON has no NaN or infinities.
+            if ((number != number) || (number - number != 0))
+            {
+                append("null", 4);
+                return true;
+            }
+
+            // Formatted as script Number to String conversions are.
+            lua_pushvalue(L, idx);
+            string = lua_tolstring(L, -1, &length);
+            append(string, length);
+            lua_pop(L, 1);
+            return true;
+        }
+
+        case LUA_TSTRING:
+            string = lua_tolstring(L, idx, &length);
+            appendString(string, length);
+            return true;
+
+        case LUA_TTABLE:
+            break;
+
+        default:
+            error = "unsupported value type";
+            return false;
+        }
+
+        if (depth >= JSONReader::MAX_DEPTH)
+        {
+            error = "nested too deeply, or a recursive reference";
+            return false;
+        }
+
+        luaL_checkstack(L, 4, "JSON nested too deeply");
+
+        Type *type = lsr_gettype(L, idx);
+
+        if (type == vectorType)
+        {
+            int count = lsr_vector_get_length(L, idx);
+
+            lua_rawgeti(L, idx, LSINDEXVECTOR);
+            int tableIdx = lua_gettop(L);
+
+            buffer.push_back('[');
+
+            for (int i = 0; i < count; i++)
+            {
+                if (i)
+                {
+                    buffer.push_back(',');
+                }
+
+                lua_rawgeti(L, tableIdx, i);
+                if (!encodeValue(tableIdx + 1, depth + 1))
+                {
+                    return false;
+                }
+                lua_pop(L, 1);
+            }
+
+            buffer.push_back(']');
+            lua_pop(L, 1);
+            return true;
+        }
+
+        if (type == dictionaryType)
+        {
+            lua_rawgeti(L, idx, LSINDEXDICTPAIRS);
+            int pairsIdx = lua_gettop(L);
+
+            buffer.push_back('{');
+
+            bool first = true;
+            lua_pushnil(L);
+            while (lua_next(L, pairsIdx))
+            {
+                // Only keys with a String form are written, without
+                // converting the key in place, which would upset lua_next.
+                int keyType = lua_type(L, -2);
+                if ((keyType == LUA_TSTRING) || (keyType == LUA_TNUMBER))
+                {
+                    if (!first)
+                    {
+                        buffer.push_back(',');
+                    }
+                    first = false;
+
+                    lua_pushvalue(L, -2);
+                    string = lua_tolstring(L, -1, &length);
+                    appendString(string, length);
+                    lua_pop(L, 1);
+
+                    buffer.push_back(':');
+
+                    if (!encodeValue(lua_gettop(L), depth + 1))
+                    {
+                        return false;
+                    }
+                }
+
+                lua_pop(L, 1);
+            }
+
+            buffer.push_back('}');
+            lua_pop(L, 1);
+            return true;
+        }
+
+        // Other instances are serialized from their fields by script.
+        lsr_getclasstable(L, ls->getType("system.JSON"));
+        lua_getfield(L, -1, "stringify");
+        lua_pushvalue(L, idx);
+        lua_call(L, 1, 1);
+
+        string = lua_tolstring(L, -1, &length);
+        if (string)
+        {
+            append(string, length);
+        }
+        else
+        {
+            append("null", 4);
+        }
+
+        lua_pop(L, 2);
+        return true;
+    }
+};
 
 static int registerSystemJSON(lua_State *L)
 {
@@ -30,6 +461,7 @@ static int registerSystemJSON(lua_State *L)
        .addMethod("initObject", &JSON::initObject)
        .addMethod("initArray", &JSON::initArray)
        .addMethod("loadString", &JSON::loadString)
+       .addMethod("loadBytes", &JSON::loadBytes)
        .addMethod("serialize", &JSON::serialize)
 
        .addMethod("getError", &JSON::getError)
@@ -81,6 +513,10 @@ static int registerSystemJSON(lua_State *L)
        .addMethod("getArrayArray", &JSON::getArrayArray)
        .addMethod("setArrayArray", &JSON::setArrayArray)
 
+       .addStaticLuaFunction("decode", &JSONDecoder::decode)
+       .addStaticLuaFunction("decodeBytes", &JSONDecoder::decodeBytes)
+       .addStaticLuaFunction("parseToObject", &JSONDecoder::parseToObject)
+       .addStaticLuaFunction("encode", &JSONEncoder::encode)
 
        .endClass()
        .endPackage();
@@ -32,10 +32,9 @@ extern "C" {
 class Math {
 public:
 
-    static int _abs(lua_State *L)
+    static double _abs(double value)
     {
-        lua_pushnumber(L, fabs((float)lua_tonumber(L, 1)));
-        return 1;
+        return fabs((float)value);
     }
 
     static int __pget_RAND_MAX(lua_State *L)
@@ -44,112 +43,91 @@ public:
         return 1;
     }
 
-    static int _random(lua_State *L)
+    static double _random()
     {
-        lua_pushnumber(L, ((double)rand()) / ((double)RAND_MAX));
-        return 1;
+        return ((double)rand()) / ((double)RAND_MAX);
     }
 
-    static int _randomRange(lua_State *L)
+    static double _randomRange(double min, double max)
     {
-        double min = lua_tonumber(L, 1);
-        double max = lua_tonumber(L, 2);
-        lua_pushnumber(L, min + (((double)rand() / (double)RAND_MAX) * (max - min)));
-        return 1;
+        return min + (((double)rand() / (double)RAND_MAX) * (max - min));
     }
 
-    static int _randomRangeInt(lua_State *L)
+    static int _randomRangeInt(int min, int max)
     {
-        int min = (int)lua_tonumber(L, 1);
-        int max = (int)lua_tonumber(L, 2);
-        lua_pushnumber(L, (rand() % (max - min + 1)) + min);
-        return 1;
-    }    
+        return (rand() % (max - min + 1)) + min;
+    }
 
-    static int _pow(lua_State *L)
+    static double _pow(double base, double exponent)
     {
-        lua_pushnumber(L, pow(lua_tonumber(L, 1), lua_tonumber(L, 2)));
-        return 1;
+        return pow(base, exponent);
     }
 
-    static int _sin(lua_State *L)
+    static double _sin(double value)
     {
-        lua_pushnumber(L, sin(lua_tonumber(L, 1)));
-        return 1;
+        return sin(value);
     }
 
-    static int _cos(lua_State *L)
+    static double _cos(double value)
     {
-        lua_pushnumber(L, cos(lua_tonumber(L, 1)));
-        return 1;
+        return cos(value);
     }
 
-    static int _tan(lua_State *L)
+    static double _tan(double value)
     {
-        lua_pushnumber(L, tan(lua_tonumber(L, 1)));
-        return 1;
+        return tan(value);
     }
 
-    static int _sqrt(lua_State *L)
+    static double _sqrt(double value)
     {
-        lua_pushnumber(L, sqrt(lua_tonumber(L, 1)));
-        return 1;
+        return sqrt(value);
     }
 
-    static int _floor(lua_State *L)
+    static double _floor(double value)
     {
-        lua_pushnumber(L, floor(lua_tonumber(L, 1)));
-        return 1;
+        return floor(value);
     }
 
-    static int _ceil(lua_State *L)
+    static double _ceil(double value)
     {
-        lua_pushnumber(L, ceil(lua_tonumber(L, 1)));
-        return 1;
+        return ceil(value);
     }
 
-    static int _round(lua_State *L)
+    static double _round(double value)
     {
         // round not present in VS2010, so per http://www.gamedev.net/topic/436496-mathh-round-and-windows-vs2005-pro/
         // doing workaround with floor and addition.
-        lua_pushnumber(L, floor(lua_tonumber(L, 1) + 0.5));
-        return 1;
+        return floor(value + 0.5);
     }
 
-    static int _atan2(lua_State *L)
+    static double _atan2(double y, double x)
     {
-        lua_pushnumber(L, atan2(lua_tonumber(L, 1), lua_tonumber(L, 2)));
-        return 1;
+        return atan2(y, x);
     }
 
-    static int _acos(lua_State *L)
+    static double _acos(double value)
     {
-        lua_pushnumber(L, acos(lua_tonumber(L, 1)));
-        return 1;
+        return acos(value);
     }
 
-    static int _asin(lua_State *L)
+    static double _asin(double value)
     {
-        lua_pushnumber(L, asin(lua_tonumber(L, 1)));
-        return 1;
+        return asin(value);
     }
 
-    static int _atan(lua_State *L)
+    static double _atan(double value)
     {
-        lua_pushnumber(L, atan(lua_tonumber(L, 1)));
-        return 1;
+        return atan(value);
     }
 
-    static int _exp(lua_State *L)
+    static double _exp(double value)
     {
-        lua_pushnumber(L, exp(lua_tonumber(L, 1)));
-        return 1;
+        return exp(value);
     }
 
-    static int _log(lua_State *L)
+    static double _log(double value)
     {
-        lua_pushnumber(L, log(lua_tonumber(L, 1)));
-        return 1;
+        return log(value);
     }
 
     static int _min(lua_State *L)
@@ -242,27 +220,27 @@ static int registerSystemMath(lua_State *L)
        .beginClass<Math> ("Math")
 
        .addStaticLuaFunction("__pget_RAND_MAX", &Math::__pget_RAND_MAX)
-       .addStaticLuaFunction("random", &Math::_random)
-       .addStaticLuaFunction("randomRange", &Math::_randomRange)
-       .addStaticLuaFunction("randomRangeInt", &Math::_randomRangeInt)
-       .addStaticLuaFunction("abs", &Math::_abs)
-       .addStaticLuaFunction("sin", &Math::_sin)
-       .addStaticLuaFunction("cos", &Math::_cos)
-       .addStaticLuaFunction("tan", &Math::_tan)
-       .addStaticLuaFunction("atan2", &Math::_atan2)
-       .addStaticLuaFunction("sqrt", &Math::_sqrt)
-
-       .addStaticLuaFunction("floor", &Math::_floor)
-       .addStaticLuaFunction("ceil", &Math::_ceil)
-       .addStaticLuaFunction("round", &Math::_round)
-
-       .addStaticLuaFunction("pow", &Math::_pow)
-
-       .addStaticLuaFunction("acos", &Math::_acos)
-       .addStaticLuaFunction("asin", &Math::_asin)
-       .addStaticLuaFunction("atan", &Math::_atan)
-       .addStaticLuaFunction("exp", &Math::_exp)
-       .addStaticLuaFunction("log", &Math::_log)
+       .addStaticMethodFFI("random", &Math::_random)
+       .addStaticMethodFFI("randomRange", &Math::_randomRange)
+       .addStaticMethodFFI("randomRangeInt", &Math::_randomRangeInt)
+       .addStaticMethodFFI("abs", &Math::_abs)
+       .addStaticMethodFFI("sin", &Math::_sin)
+       .addStaticMethodFFI("cos", &Math::_cos)
+       .addStaticMethodFFI("tan", &Math::_tan)
+       .addStaticMethodFFI("atan2", &Math::_atan2)
+       .addStaticMethodFFI("sqrt", &Math::_sqrt)
+
+       .addStaticMethodFFI("floor", &Math::_floor)
+       .addStaticMethodFFI("ceil", &Math::_ceil)
+       .addStaticMethodFFI("round", &Math::_round)
+
+       .addStaticMethodFFI("pow", &Math::_pow)
+
+       .addStaticMethodFFI("acos", &Math::_acos)
+       .addStaticMethodFFI("asin", &Math::_asin)
+       .addStaticMethodFFI("atan", &Math::_atan)
+       .addStaticMethodFFI("exp", &Math::_exp)
+       .addStaticMethodFFI("log", &Math::_log)
        .addStaticLuaFunction("max", &Math::_max)
        .addStaticLuaFunction("min", &Math::_min)
 
@@ -0,0 +1,475 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/common/core/log.h"
+#include "loom/common/utils/utByteArray.h"
+#include "loom/common/utils/utMessagePack.h"
+#include "loom/script/loomscript.h"
+#include "loom/script/reflection/lsFieldInfo.h"
+#include "loom/script/runtime/lsRuntime.h"
+
+using namespace LS;
+
+lmDefineLogGroup(gMessagePackLogGroup, "msgpack", 1, LoomLogInfo);
+
+/*
+ * Serializes script values to MessagePack natively, walking class instances
+ * by their reflected fields so classes need no per field code. Instances
+ * are written as maps of field name to value, Vectors as arrays,
+ * Dictionaries as maps and ByteArrays as binary.
+ *
+ * Reading builds Dictionaries and Vectors, or, when given a Type, an
+ * instance of it with its fields set from the map. The declared types of
+ * fields, template types of Vector and Dictionary fields included, type the
+ * nested values in turn. Keys without a matching field are skipped.
+ */
+class MessagePack
+{
+    // Deeper values are rejected, which also catches recursive references.
+    static const int MAX_DEPTH = 256;
+
+    lua_State   *L;
+    LSLuaState  *ls;
+    Type        *dictionaryType;
+    Type        *byteArrayType;
+    const char  *error;
+
+    MessagePack(lua_State *_L) : L(_L), error(NULL)
+    {
+        ls             = LSLuaState::getLuaState(L);
+        dictionaryType = ls->getType("system.Dictionary");
+        byteArrayType  = ls->getType("system.ByteArray");
+    }
+
+    static bool isEncodableKey(lua_State *L, int idx)
+    {
+        int type = lua_type(L, idx);
+
+        return (type == LUA_TSTRING) || (type == LUA_TNUMBER) || (type == LUA_TBOOLEAN);
+    }
+
+    // Fields written for instances of type.
+    static bool isSerializedField(FieldInfo *field)
+    {
+        return !field->isStatic() && !field->isConst();
+    }
+
+    bool encodeValue(utMessagePackWriter& writer, int idx, int depth)
+    {
+        size_t length;
+
+        switch (lua_type(L, idx))
+        {
+        case LUA_TBOOLEAN:
+            writer.writeBoolean(lua_toboolean(L, idx) != 0);
+            return true;
+
+        case LUA_TNUMBER:
+            writer.writeNumber(lua_tonumber(L, idx));
+            return true;
+
+        case LUA_TSTRING:
+        {
+            const char *string = lua_tolstring(L, idx, &length);
+            writer.writeString(string, (UTsize)length);
+            return true;
+        }
+
+        case LUA_TTABLE:
+            break;
+
+        default:
+            // null, and functions which have no serialized form
+            writer.writeNil();
+            return true;
+        }
+
+        if (depth >= MAX_DEPTH)
+        {
+            error = "nested too deeply, or a recursive reference";
+            return false;
+        }
+
+        luaL_checkstack(L, 4, "MessagePack nested too deeply");
+
+        idx = lua_absindex(L, idx);
+
+        Type *type = lsr_gettype(L, idx);
+
+        if (type == ls->vectorType)
+        {
+            int count = lsr_vector_get_length(L, idx);
+
+            writer.writeArrayHeader((UTsize)count);
+
+            lua_rawgeti(L, idx, LSINDEXVECTOR);
+            for (int i = 0; i < count; i++)
+            {
+                lua_rawgeti(L, -1, i);
+                if (!encodeValue(writer, -1, depth + 1))
+                {
+                    return false;
+                }
+                lua_pop(L, 1);
+            }
+            lua_pop(L, 1);
+
+            return true;
+        }
+
+        if (type == dictionaryType)
+        {
+            lua_rawgeti(L, idx, LSINDEXDICTPAIRS);
+            int pairsIdx = lua_gettop(L);
+
+            // Count first, the header precedes the pairs.
+            UTsize count = 0;
+            lua_pushnil(L);
+            while (lua_next(L, pairsIdx))
+            {
+                lua_pop(L, 1);
+                count += isEncodableKey(L, -1) ? 1 : 0;
+            }
+
+            writer.writeMapHeader(count);
+
+            lua_pushnil(L);
+            while (lua_next(L, pairsIdx))
+            {
+                if (isEncodableKey(L, -2))
+                {
+                    if (!encodeValue(writer, -2, depth + 1) || !encodeValue(writer, -1, depth + 1))
+                    {
+                        return false;
+                    }
+                }
+                lua_pop(L, 1);
+            }
+
+            lua_pop(L, 1);
+            return true;
+        }
+
+        if (type == byteArrayType)
+        {
+            utByteArray *bytes = (utByteArray *)lualoom_getnativepointer(L, idx, false, "system.ByteArray");
+
+            writer.writeBinary(bytes->getDataPtr(), bytes->getSize());
+            return true;
+        }
+
+        if (!type)
+        {
+            writer.writeNil();
+            return true;
+        }
+
+        int fieldCount = type->getFieldInfoCount();
+
+        UTsize count = 0;
+        for (int i = 0; i < fieldCount; i++)
+        {
+            count += isSerializedField(type->getFieldInfo(i)) ? 1 : 0;
+        }
+
+        writer.writeMapHeader(count);
+
+        for (int i = 0; i < fieldCount; i++)
+        {
+            FieldInfo *field = type->getFieldInfo(i);
+
+            if (!isSerializedField(field))
+            {
+                continue;
+            }
+
+            writer.writeString(field->getName(), (UTsize)strlen(field->getName()));
+
+            lua_pushnumber(L, field->getOrdinal());
+            lua_gettable(L, idx);
+            if (!encodeValue(writer, -1, depth + 1))
+            {
+                return false;
+            }
+            lua_pop(L, 1);
+        }
+
+        return true;
+    }
+
+    // Pushes the value whose header token was just read, typed by type and
+    // templateInfo when known.
+    bool decodeValue(utMessagePackReader& reader, utMessagePackType token, Type *type, TemplateInfo *templateInfo, int depth)
+    {
+        UTsize     length;
+        const char *data;
+
+        switch (token)
+        {
+        case MP_NIL:
+            lua_pushnil(L);
+            return true;
+
+        case MP_BOOLEAN:
+            lua_pushboolean(L, reader.getBoolean());
+            return true;
+
+        case MP_INTEGER:
+        case MP_FLOAT:
+            lua_pushnumber(L, reader.getNumber());
+            return true;
+
+        case MP_STRING:
+            data = reader.getData(length);
+            lua_pushlstring(L, data, length);
+            return true;
+
+        case MP_BINARY:
+        {
+            data = reader.getData(length);
+
+            lsr_createinstance(L, byteArrayType);
+            utByteArray *bytes = (utByteArray *)lualoom_getnativepointer(L, -1, false, "system.ByteArray");
+
+            bytes->allocateAndCopy((void *)data, (int)length);
+            return true;
+        }
+
+        case MP_EXTENSION:
+            // Left to other implementations to interpret.
+            lua_pushnil(L);
+            return true;
+
+        case MP_ARRAY:
+        case MP_MAP:
+            break;
+
+        default:
+            error = "truncated or invalid data";
+            return false;
+        }
+
+        if (depth >= MAX_DEPTH)
+        {
+            error = "nested too deeply";
+            return false;
+        }
+
+        luaL_checkstack(L, 6, "MessagePack nested too deeply");
+
+        // Element types for Vectors and Dictionaries.
+        TemplateInfo *elementInfo = (templateInfo && templateInfo->isTemplate()) ? templateInfo->getIndexedTemplateInfo() : NULL;
+        Type         *elementType = elementInfo ? elementInfo->type : NULL;
+
+        UTsize count = reader.getCount();
+
+        if (token == MP_ARRAY)
+        {
+            lsr_createinstance(L, ls->vectorType);
+            int vectorIdx = lua_gettop(L);
+            lua_rawgeti(L, vectorIdx, LSINDEXVECTOR);
+
+            for (UTsize i = 0; i < count; i++)
+            {
+                if (!decodeValue(reader, reader.next(), elementType, elementInfo, depth + 1))
+                {
+                    return false;
+                }
+                lua_rawseti(L, vectorIdx + 1, (int)i);
+            }
+
+            lua_pop(L, 1);
+            lsr_vector_set_length(L, vectorIdx, (int)count);
+            return true;
+        }
+
+        bool isInstance = type && (type != dictionaryType) && (type != ls->objectType) && (type != ls->vectorType) &&
+                          (type != byteArrayType) && !type->isPrimitive() && !type->isInterface();
+
+        if (!isInstance)
+        {
+            lsr_createinstance(L, dictionaryType);
+            lua_rawgeti(L, -1, LSINDEXDICTPAIRS);
+            int pairsIdx = lua_gettop(L);
+
+            for (UTsize i = 0; i < count; i++)
+            {
+                if (!decodeValue(reader, reader.next(), NULL, NULL, depth + 1) ||
+                    !decodeValue(reader, reader.next(), elementType, elementInfo, depth + 1))
+                {
+                    return false;
+                }
+
+                // Lua tables can't be keyed by null.
+                if (lua_isnil(L, -2))
+                {
+                    lua_pop(L, 2);
+                    continue;
+                }
+
+                lua_rawset(L, pairsIdx);
+            }
+
+            lua_pop(L, 1);
+            return true;
+        }
+
+        lsr_createinstance(L, type);
+        int instanceIdx = lua_gettop(L);
+
+        for (UTsize i = 0; i < count; i++)
+        {
+            utMessagePackType key = reader.next();
+
+            FieldInfo *field = NULL;
+            if (key == MP_STRING)
+            {
+                data = reader.getData(length);
+
+                utString name;
+                name.fromBytes(data, (int)length);
+                MemberInfo *member = type->findMember(name.c_str());
+
+                if (member && member->isField() && isSerializedField((FieldInfo *)member))
+                {
+                    field = (FieldInfo *)member;
+                }
+            }
+            else if (!reader.skip(key))
+            {
+                error = "truncated or invalid data";
+                return false;
+            }
+
+            utMessagePackType value = reader.next();
+
+            if (!field)
+            {
+                if (!reader.skip(value))
+                {
+                    error = "truncated or invalid data";
+                    return false;
+                }
+                continue;
+            }
+
+            lua_pushnumber(L, field->getOrdinal());
+            if (!decodeValue(reader, value, field->getType(), field->getTemplateInfo(), depth + 1))
+            {
+                return false;
+            }
+            lua_settable(L, instanceIdx);
+        }
+
+        return true;
+    }
+
+public:
+
+    static int write(lua_State *L)
+    {
+        if (lua_isnil(L, 2))
+        {
+            lua_pushboolean(L, 0);
+            return 1;
+        }
+
+        utByteArray *bytes = (utByteArray *)lualoom_getnativepointer(L, 2, true, "system.ByteArray");
+
+        MessagePack         encoder(L);
+        utMessagePackWriter writer(*bytes);
+        UTsize              position = bytes->getPosition();
+        UTsize              size     = bytes->getSize();
+
+        if (!encoder.encodeValue(writer, 1, 0))
+        {
+            lmLogError(gMessagePackLogGroup, "MessagePack.write: %s", encoder.error);
+
+            // Drop what was appended, data overwritten in place is lost.
+            if (bytes->getSize() > size)
+            {
+                bytes->resize(size);
+            }
+            bytes->setPosition(position);
+            lua_pushboolean(L, 0);
+            return 1;
+        }
+
+        lua_pushboolean(L, 1);
+        return 1;
+    }
+
+    static int read(lua_State *L)
+    {
+        if (lua_isnil(L, 1))
+        {
+            lua_pushnil(L);
+            return 1;
+        }
+
+        utByteArray *bytes = (utByteArray *)lualoom_getnativepointer(L, 1, true, "system.ByteArray");
+        Type        *type  = lua_isnil(L, 2) ? NULL : (Type *)lualoom_getnativepointer(L, 2, true, "system.reflection.Type");
+
+        MessagePack         decoder(L);
+        utMessagePackReader reader((const char *)bytes->getDataPtr() + bytes->getPosition(), bytes->bytesAvailable());
+
+        int top = lua_gettop(L);
+
+        utMessagePackType token = reader.next();
+
+        if (token == MP_END)
+        {
+            decoder.error = "no data available";
+        }
+
+        if (decoder.error || !decoder.decodeValue(reader, token, type, NULL, 0))
+        {
+            lmLogError(gMessagePackLogGroup, "MessagePack.read: %s", decoder.error);
+            lua_settop(L, top);
+            lua_pushnil(L);
+            return 1;
+        }
+
+        bytes->setPosition(bytes->getPosition() + reader.getOffset());
+        return 1;
+    }
+};
+
+static int registerSystemMessagePack(lua_State *L)
+{
+    beginPackage(L, "system")
+
+       .beginClass<MessagePack> ("MessagePack")
+
+       .addStaticLuaFunction("write", &MessagePack::write)
+       .addStaticLuaFunction("read", &MessagePack::read)
+
+       .endClass()
+
+       .endPackage();
+
+    return 0;
+}
+
+
+void installSystemMessagePack()
+{
+    NativeInterface::registerNativeType<MessagePack>(registerSystemMessagePack);
+}
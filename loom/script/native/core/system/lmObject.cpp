@@ -85,6 +85,13 @@ public:
         return 0;
     }
 
+    static int release(lua_State *L)
+    {
+        luaL_checktype(L, 1, LUA_TTABLE);
+        lualoom_poolrelease(L, 1);
+        return 0;
+    }
+
     static int _as(lua_State *L)
     {
         // as of null returns null
@@ -379,6 +386,7 @@ static int registerSystemObject(lua_State *L)
        .beginClass<LSObject> ("Object")
 
        .addStaticLuaFunction("deleteNative", &LSObject::deleteNative)
+       .addStaticLuaFunction("release", &LSObject::release)
        .addStaticLuaFunction("getNativeDebugString", &LSObject::getNativeDebugString)
        .addStaticLuaFunction("toString", &LSObject::toString)
        .addStaticLuaFunction("_toString", &LSObject::_toString)
@@ -32,11 +32,13 @@ void installSystemCoroutine();
 void installSystemDictionary();
 void installSystemFunction();
 void installSystemGC();
+void installSystemHeapSnapshot();
 void installSystemMath();
 void installSystemDate();
 void installSystemRandom();
 void installSystemObject();
 void installSystemString();
+void installSystemStringBuilder();
 void installSystemNumber();
 void installSystemVector();
 void installSystemVM();
@@ -48,6 +50,7 @@ void installSystemProcess();
 void installSystemByteArray();
 void installSystemSocket();
 void installSystemIO();
+void installSystemWorker();
 
 // Sytem.Reflection
 void installSystemReflectionAssembly();
@@ -56,6 +59,7 @@ void installSystemReflectionType();
 // system.xml
 void installSystemXML();
 void installSystemJSON();
+void installSystemMessagePack();
 
 // system.metrics
 void installSystemMetrics();
@@ -73,6 +77,7 @@ void installPackageSystem()
 {
     installSystemObject();
     installSystemString();
+    installSystemStringBuilder();
     installSystemNumber();
 
     // Sytem.Reflection
@@ -88,6 +93,7 @@ void installPackageSystem()
     installSystemDictionary();
     installSystemFunction();
     installSystemGC();
+    installSystemHeapSnapshot();
     installSystemMath();
     installSystemDate();
     installSystemRandom();
@@ -100,6 +106,7 @@ void installPackageSystem()
     installSystemProcess();
     installSystemSocket();
     installSystemIO();
+    installSystemWorker();
 
     // system.utils
     installSystemUtils();
@@ -109,6 +116,7 @@ void installPackageSystem()
 
     // system.JSON
     installSystemJSON();
+    installSystemMessagePack();
 
     // system.metrics
     installSystemMetrics();
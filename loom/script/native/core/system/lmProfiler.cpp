@@ -35,6 +35,20 @@ int registerSystemProfiler(lua_State *L)
        .addStaticMethod("reset", &LSProfiler::reset)
        .addStaticMethod("isEnabled", &LSProfiler::isEnabled)
        .addStaticMethod("dump", &LSProfiler::dump)
+       .addStaticMethod("startSampling", &LSProfiler::startSampling)
+       .addStaticMethod("stopSampling", &LSProfiler::stopSampling)
+       .addStaticMethod("isSampling", &LSProfiler::isSampling)
+       .addStaticMethod("dumpSamples", &LSProfiler::dumpSamples)
+       .addStaticMethod("startAllocationSampling", &LSProfiler::startAllocationSampling)
+       .addStaticMethod("stopAllocationSampling", &LSProfiler::stopAllocationSampling)
+       .addStaticMethod("isAllocationSampling", &LSProfiler::isAllocationSampling)
+       .addStaticMethod("dumpAllocationSamples", &LSProfiler::dumpAllocationSamples)
+       .addStaticMethod("startTimeline", &LSProfiler::startTimeline)
+       .addStaticMethod("stopTimeline", &LSProfiler::stopTimeline)
+       .addStaticMethod("isRecordingTimeline", &LSProfiler::isRecordingTimeline)
+       .addStaticMethod("writeTimeline", &LSProfiler::writeTimeline)
+       .addStaticMethod("startTraceStats", &LSProfiler::startTraceStats)
+       .addStaticMethod("stopTraceStats", &LSProfiler::stopTraceStats)
 
        .endClass()
 
@@ -30,6 +30,37 @@
 class LSString {
 public:
 
+    // Finds needle in the first length bytes of haystack, scanning for
+    // candidates with memchr, which libc vectorizes, rather than comparing
+    // at every offset like strstr on NUL terminated input
+    static const char *findSubstring(const char *haystack, size_t length, const char *needle, size_t needleLength)
+    {
+        if (needleLength > length)
+        {
+            return NULL;
+        }
+
+        const char *last = haystack + (length - needleLength);
+
+        while (haystack <= last)
+        {
+            const char *candidate = (const char *)memchr(haystack, needle[0], (last - haystack) + 1);
+
+            if (!candidate)
+            {
+                return NULL;
+            }
+
+            if (!memcmp(candidate + 1, needle + 1, needleLength - 1))
+            {
+                return candidate;
+            }
+
+            haystack = candidate + 1;
+        }
+
+        return NULL;
+    }
 
     static int format(lua_State *L)
     {
@@ -182,25 +213,30 @@ public:
 
     static int _indexOf(lua_State *L)
     {
-        const char *svalue    = lua_tostring(L, 1);
-        const char *search    = lua_tostring(L, 2);
+        size_t     slen       = 0;
+        size_t     searchLen  = 0;
+        const char *svalue    = lua_tolstring(L, 1, &slen);
+        const char *search    = lua_tolstring(L, 2, &searchLen);
         int        startIndex = (int)lua_tonumber(L, 3);
 
-        if (!svalue || !svalue[0] || !search || !search[0])
+        if (!svalue || !slen || !search || !searchLen)
         {
             lua_pushnumber(L, -1);
             return 1;
         }
 
-        const char *start = &svalue[startIndex];
+        if (startIndex < 0)
+        {
+            startIndex = 0;
+        }
 
-        if (start - svalue >= (int)strlen(svalue))
+        if ((size_t)startIndex >= slen)
         {
             lua_pushnumber(L, -1);
             return 1;
         }
 
-        const char *found = strstr(start, search);
+        const char *found = findSubstring(&svalue[startIndex], slen - startIndex, search, searchLen);
 
         if (!found)
         {
@@ -558,91 +594,90 @@ public:
         return 1;
     }
 
-    static int _split(lua_State *L)
+    // Splits str by delim into the internal table of the Vector at
+    // vectorIdx and returns the number of pieces, each is pushed straight
+    // from the source string without a temporary copy
+    static int splitInto(lua_State *L, const char *str, size_t slen, const char *delim, size_t dlen, int vectorIdx)
     {
-        char       *str   = (char *)lua_tostring(L, 1);
-        const char *delim = lua_tostring(L, 2);
+        lua_rawgeti(L, vectorIdx, LSINDEXVECTOR);
+        int tableIdx = lua_gettop(L);
 
-        if (!str || !str[0])
+        int count = 0;
+
+        if (!slen)
         {
-            str = const_cast<char*>("");
+            // "" splits into nothing
         }
-
-        if (!delim || !delim[0])
+        else if (!dlen)
         {
-            delim = "";
+            // an empty delimiter splits into single characters
+            for (size_t i = 0; i < slen; i++)
+            {
+                lua_pushlstring(L, &str[i], 1);
+                lua_rawseti(L, tableIdx, count++);
+            }
         }
+        else
+        {
+            const char *start = str;
+            const char *end   = str + slen;
+            const char *found;
 
+            // leading, trailing and consecutive delimiters produce ""
+            while ((found = findSubstring(start, end - start, delim, dlen)) != NULL)
+            {
+                lua_pushlstring(L, start, found - start);
+                lua_rawseti(L, tableIdx, count++);
+                start = found + dlen;
+            }
 
-        Type *vectorType = LSLuaState::getLuaState(L)->getType("system.Vector");
-        lsr_createinstance(L, vectorType);
-        int newVectorIdx = lua_gettop(L);
+            lua_pushlstring(L, start, end - start);
+            lua_rawseti(L, tableIdx, count++);
+        }
 
-        lua_rawgeti(L, newVectorIdx, LSINDEXVECTOR);
+        lua_pop(L, 1);
 
-        int count = 0;
-        int dlen  = (int)strlen(delim);
-        int slen  = (int)strlen(str);
+        lsr_vector_set_length(L, vectorIdx, count);
 
-        // handle the case of "", delim, ...
-        if (!strncmp(str, delim, dlen))
-        {
-            lua_pushnumber(L, count++);
-            lua_pushstring(L, "");
-            lua_rawset(L, -3);
-        }
+        return count;
+    }
 
-        char *start = str;
-        char *found;
-        char *temp = (char*) lmAlloc(NULL, slen + 1);
-        do {
-            found = strstr(start, delim);
+    static int _split(lua_State *L)
+    {
+        size_t     slen   = 0;
+        size_t     dlen   = 0;
+        const char *str   = lua_tolstring(L, 1, &slen);
+        const char *delim = lua_tolstring(L, 2, &dlen);
 
-            if (found)
-            {
-                if (found - start > 0)
-                {
-                    memcpy(temp, start, found - start);
-                    temp[found - start] = 0;
-                    lua_pushnumber(L, count++);
-                    lua_pushstring(L, temp);
-                    lua_rawset(L, -3);
-                }
-                else if (found != str && found - start == 0) {
-                    lua_pushnumber(L, count++);
-                    lua_pushstring(L, "");
-                    lua_rawset(L, -3);
-                }
+        Type *vectorType = LSLuaState::getLuaState(L)->getType("system.Vector");
+        lsr_createinstance(L, vectorType);
+        int newVectorIdx = lua_gettop(L);
 
-                start = found + dlen;
-            }
-            
-        } while (found);        
+        splitInto(L, str, str ? slen : 0, delim, delim ? dlen : 0, newVectorIdx);
 
-        if (start - str < slen)
-        {
-            strncpy(temp, start, slen + 1);
-            lua_pushnumber(L, count++);
-            lua_pushstring(L, temp);
-            lua_rawset(L, -3);            
-        }
+        lua_settop(L, newVectorIdx);
+        return 1;
+    }
 
-        lmFree(NULL, temp);
+    // Like _split, but fills and returns the count of the Vector passed
+    // in, so parsing loops can reuse one Vector instead of allocating one
+    // per call
+    static int _splitInto(lua_State *L)
+    {
+        size_t     slen   = 0;
+        size_t     dlen   = 0;
+        const char *str   = lua_tolstring(L, 1, &slen);
+        const char *delim = lua_tolstring(L, 2, &dlen);
 
-        // handle the case of ..., delta, ""
-        if (slen >= dlen)
+        if (!lua_istable(L, 3))
         {
-            if (!strncmp(&str[slen - dlen], delim, dlen))
-            {
-                lua_pushnumber(L, count++);
-                lua_pushstring(L, "");
-                lua_rawset(L, -3);
-            }
+            lua_pushnumber(L, 0);
+            return 1;
         }
 
-        lsr_vector_set_length(L, newVectorIdx, count);
+        int count = splitInto(L, str, str ? slen : 0, delim, delim ? dlen : 0, 3);
 
-        lua_settop(L, newVectorIdx);
+        lua_pushnumber(L, count);
         return 1;
     }
 };
@@ -676,6 +711,7 @@ static int registerSystemString(lua_State *L)
        .addStaticLuaFunction("_toSHA2", &LSString::_toSHA2)
        .addStaticLuaFunction("_find", &LSString::_find)
        .addStaticLuaFunction("_split", &LSString::_split)
+       .addStaticLuaFunction("_splitInto", &LSString::_splitInto)
        .addStaticLuaFunction("format", &LSString::format)
 
        .endClass()
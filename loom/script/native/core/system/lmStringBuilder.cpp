@@ -0,0 +1,132 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <string.h>
+
+#include "loom/script/loomscript.h"
+#include "loom/script/runtime/lsRuntime.h"
+
+using namespace LS;
+
+/**
+ *  Growable character buffer behind system.StringBuilder, appending copies
+ *  into the buffer so no intermediate Lua strings are interned until
+ *  toString is called.
+ */
+class LSStringBuilder
+{
+    utArray<char> buffer;
+
+public:
+
+    int append(lua_State *L)
+    {
+        size_t     length = 0;
+        const char *value;
+
+        if (lua_type(L, 2) == LUA_TSTRING)
+        {
+            value = lua_tolstring(L, 2, &length);
+        }
+        else
+        {
+            value = lsr_objecttostring(L, 2);
+
+            if (!value)
+            {
+                value = "null";
+            }
+
+            length = strlen(value);
+        }
+
+        appendBytes(value, length);
+
+        return 0;
+    }
+
+    void appendBytes(const char *value, size_t length)
+    {
+        if (!length)
+        {
+            return;
+        }
+
+        UTsize size = buffer.size();
+
+        // grow geometrically, utArray only reserves what is asked for
+        if (size + length > buffer.capacity())
+        {
+            UTsize capacity = buffer.capacity() ? buffer.capacity() * 2 : 64;
+
+            while (capacity < size + length)
+            {
+                capacity *= 2;
+            }
+
+            buffer.reserve(capacity);
+        }
+
+        buffer.resize(size + (UTsize)length);
+        memcpy(buffer.ptr() + size, value, length);
+    }
+
+    void clear()
+    {
+        // keep the storage around for reuse
+        buffer.resize(0);
+    }
+
+    int getLength() const
+    {
+        return (int)buffer.size();
+    }
+
+    int toString(lua_State *L)
+    {
+        lua_pushlstring(L, buffer.size() ? buffer.ptr() : "", buffer.size());
+        return 1;
+    }
+};
+
+static int registerSystemStringBuilder(lua_State *L)
+{
+    beginPackage(L, "system")
+
+       .beginClass<LSStringBuilder> ("StringBuilder")
+
+       .addConstructor<void (*)(void)>()
+       .addLuaFunction("append", &LSStringBuilder::append)
+       .addMethod("clear", &LSStringBuilder::clear)
+       .addProperty("length", &LSStringBuilder::getLength)
+       .addLuaFunction("toString", &LSStringBuilder::toString)
+
+       .endClass()
+
+       .endPackage();
+
+    return 0;
+}
+
+
+void installSystemStringBuilder()
+{
+    NativeInterface::registerNativeType<LSStringBuilder>(registerSystemStringBuilder);
+}
@@ -190,10 +190,11 @@ public:
 
         lsr_vector_set_length(L, 1, length + 1);
 
+        // raw set, the length was just grown so the bounds check of the
+        // internal table's __newindex would always pass
         lua_rawgeti(L, 1, LSINDEXVECTOR);
-        lua_pushnumber(L, length);
         lua_pushvalue(L, 2);
-        lua_settable(L, -3);
+        lua_rawseti(L, -2, length);
 
         lua_pushvalue(L, 1);
 
@@ -218,35 +219,20 @@ public:
 
         int idx = lua_gettop(L);
 
-        lua_pushnumber(L, 0);
-        lua_gettable(L, -2);
-
-        lsr_create_internal_vector(L);
-
-        int nidx = lua_gettop(L);
+        // store for return
+        lua_rawgeti(L, idx, 0);
 
+        // move the rest down in place, the last slot is cleared
+        // by the length update
         for (int i = 1; i < length; i++)
         {
-            lua_pushnumber(L, i);
-            lua_gettable(L, idx);
-
-            lua_pushnumber(L, i - 1);
-            lua_pushvalue(L, -2);
-            lua_settable(L, nidx);
-
-            // pop value
-            lua_pop(L, 1);
+            lua_rawgeti(L, idx, i);
+            lua_rawseti(L, idx, i - 1);
         }
 
-        lua_pushvalue(L, nidx);
-        lua_rawseti(L, fidx, LSINDEXVECTOR);
-
         // update length
         lsr_vector_set_length(L, fidx, length - 1);
 
-
-        lua_pushvalue(L, idx + 1);
-
         return 1;
     }
 
@@ -276,8 +262,7 @@ public:
 
         for (int i = 0; i < length; i++)
         {
-            lua_pushnumber(L, i);
-            lua_gettable(L, vidx);
+            lua_rawgeti(L, vidx, i);
 
             if (lua_equal(L, 2, -1))
             {
@@ -303,21 +288,18 @@ public:
 
         for (int i = 0; i < length; i++)
         {
-            lua_pushnumber(L, i);
-            lua_rawget(L, vidx);
+            lua_rawgeti(L, vidx, i);
 
             if (lua_equal(L, 2, -1))
             {
                 // pop current value
                 lua_pop(L, 1);
 
-                // shift
-                for (int j = i; j < length; j++)
+                // shift, the last slot is cleared by the length update
+                for (int j = i + 1; j < length; j++)
                 {
-                    lua_pushnumber(L, j);
-                    lua_pushnumber(L, j + 1);
-                    lua_rawget(L, vidx);
-                    lua_rawset(L, vidx);
+                    lua_rawgeti(L, vidx, j);
+                    lua_rawseti(L, vidx, j - 1);
                 }
 
                 lsr_vector_set_length(L, 1, length - 1);
@@ -350,8 +332,7 @@ public:
         int idx = lua_gettop(L);
 
         // store for return
-        lua_pushnumber(L, length - 1);
-        lua_gettable(L, idx);
+        lua_rawgeti(L, idx, length - 1);
 
         lsr_vector_set_length(L, fidx, length - 1);
 
@@ -408,10 +389,8 @@ public:
 
         for (int i = 0; i < fromLength; i++)
         {
-            lua_pushnumber(L, i + toLength);
-            lua_pushnumber(L, i);
-            lua_rawget(L, fromTableIdx);
-            lua_rawset(L, toTableIdx);
+            lua_rawgeti(L, fromTableIdx, i);
+            lua_rawseti(L, toTableIdx, i + toLength);
         }
 
         lsr_vector_set_length(L, toIdx, toLength + fromLength);
@@ -528,43 +507,26 @@ public:
             lua_rawgeti(L, 4, LSINDEXVECTOR);
             int argTableIdx = lua_gettop(L);
 
-            // create a new table for src vector which will hold insertion
-            lsr_create_internal_vector(L);
-            int newTableIdx = lua_gettop(L);
-
-            // first bring in everything before insertion
-            int count = 0;
-            for (int i = 0; i < startIndex; i++)
+            // move everything after the insertion up in place, from the
+            // end so nothing is overwritten before it's moved
+            for (int i = srcVectorLength - 1; i >= startIndex; i--)
             {
                 lua_rawgeti(L, srcTableIdx, i);
-                lua_rawseti(L, newTableIdx, i);
-
-                count++;
+                lua_rawseti(L, srcTableIdx, i + numVarArgs);
             }
 
             // do the insertion
             for (int i = 0; i < numVarArgs; i++)
             {
                 lua_rawgeti(L, argTableIdx, i);
-                lua_rawseti(L, newTableIdx, count++);
-            }
-
-            // ... and the rest
-            for (int i = startIndex; i < srcVectorLength; i++)
-            {
-                lua_rawgeti(L, srcTableIdx, i);
-                lua_rawseti(L, newTableIdx, count++);
+                lua_rawseti(L, srcTableIdx, startIndex + i);
             }
 
-            // swap out for the new table
-            lua_pushvalue(L, newTableIdx);
-            lua_rawseti(L, 1, LSINDEXVECTOR);
-
             // and update the length
-            lsr_vector_set_length(L, 1, count);
+            lsr_vector_set_length(L, 1, srcVectorLength + numVarArgs);
 
             // pop our table store
-            lua_pop(L, 3);
+            lua_pop(L, 2);
         }
 
         // make sure only  the new vector is on the stack
@@ -695,12 +657,8 @@ public:
         int count = 0;
         for (int i = startIndex; i < endIndex; i++)
         {
-            lua_pushnumber(L, i);
-            lua_rawget(L, srcTableIdx);
-
-            lua_pushnumber(L, count++);
-            lua_insert(L, -2);
-            lua_rawset(L, newTableIdx);
+            lua_rawgeti(L, srcTableIdx, i);
+            lua_rawseti(L, newTableIdx, count++);
         }
 
         // store length
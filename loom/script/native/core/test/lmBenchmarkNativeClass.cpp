@@ -1,4 +1,5 @@
 #include "loom/script/loomscript.h"
+#include "loom/script/native/lsNativeDelegate.h"
 
 using namespace LS;
 
@@ -43,9 +44,26 @@ public:
         return _rotation;
     }
 
+    const NativeDelegate *getTicked() const
+    {
+        return &ticked;
+    }
+
+    // Invokes ticked count times, to time native to script dispatch
+    void fire(int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            ticked.pushArgument(i);
+            ticked.invoke();
+        }
+    }
+
     float _x;
     float _y;
     float _rotation;
+
+    NativeDelegate ticked;
 };
 
 static int registerBenchmarkNativeClass(lua_State *L)
@@ -62,6 +80,9 @@ static int registerBenchmarkNativeClass(lua_State *L)
        .addProperty("y", &BenchmarkNativeClass::getPositionY, &BenchmarkNativeClass::setPositionY)
        .addProperty("rotation", &BenchmarkNativeClass::getRotation, &BenchmarkNativeClass::setRotation)
 
+       .addVarAccessor("ticked", &BenchmarkNativeClass::getTicked)
+       .addMethod("fire", &BenchmarkNativeClass::fire)
+
        .endClass()
 
        .endPackage();
@@ -3,5 +3,5 @@
 #include "loom/script/runtime/lsLuaState.h"
 
 namespace LS {
-const char *Namespace::currentPackageName = 0;
+LOOM_THREAD_LOCAL const char *Namespace::currentPackageName = 0;
 }
@@ -56,6 +56,7 @@
 #include "loom/script/runtime/lsRuntime.h"
 #include "loom/script/native/lsNativeInterface.h"
 #include "loom/common/core/allocator.h"
+#include "loom/common/platform/platformThread.h"
 
 #include <new>
 
@@ -1114,6 +1115,19 @@ struct TypeListValues<TypeList<Head const&, Tail> >
  * function pointer containers, these are only defined up to 8 parameters.
  */
 
+/**
+ * Called with every native instance script constructs with new, once it's
+ * constructed. Specialize it for a type that needs to know it's held by
+ * script, e.g. to report the memory it holds as external memory.
+ */
+template<class T>
+struct ScriptConstructed
+{
+    static void call(T *)
+    {
+    }
+};
+
 /** Constructor generators.
  *
  *  These templates call operator new with the contents of a type/value
@@ -1879,6 +1893,8 @@ public:
      */
     static void *place(lua_State *const L)
     {
+        NativeInterface::ensureNativeTypeRegistered(L, NativeInterface::getNativeType<T>());
+
         UserdataValue<T> *const ud = new (
             lua_newuserdata(L, sizeof(UserdataValue<T> )))UserdataValue<T> ();
         lua_rawgetp(L, LUA_REGISTRYINDEX, ClassInfo<T>::getClassKey());
@@ -2635,6 +2651,96 @@ struct SigList<TypeList<Head, Tail>, Start>
     }
 };
 
+/*
+ * LuaJIT FFI C type names of the POD types a native function can be called
+ * with directly from compiled traces, other types have no name and fail to
+ * compile when bound with addStaticMethodFFI
+ */
+template<typename T>
+struct FFIType;
+
+template<>
+struct FFIType<void>
+{
+    static const char *name() { return "void"; }
+};
+
+template<>
+struct FFIType<double>
+{
+    static const char *name() { return "double"; }
+};
+
+template<>
+struct FFIType<float>
+{
+    static const char *name() { return "float"; }
+};
+
+template<>
+struct FFIType<int>
+{
+    static const char *name() { return "int"; }
+};
+
+template<>
+struct FFIType<unsigned int>
+{
+    static const char *name() { return "unsigned int"; }
+};
+
+template<>
+struct FFIType<bool>
+{
+    static const char *name() { return "bool"; }
+};
+
+template<typename List>
+struct FFIParams
+{
+    static void append(utString& decl, bool first)
+    {
+        if (first)
+        {
+            decl += "void";
+        }
+    }
+};
+
+template<typename Head, typename Tail>
+struct FFIParams<TypeList<Head, Tail> >
+{
+    static void append(utString& decl, bool first)
+    {
+        if (!first)
+        {
+            decl += ", ";
+        }
+
+        decl += FFIType<Head>::name();
+        FFIParams<Tail>::append(decl, false);
+    }
+};
+
+/*
+ * FFI function pointer declaration of a free or static function,
+ * ie. "double (*)(double, double)"
+ */
+template<class Func>
+struct FFIDeclaration
+{
+    static utString get()
+    {
+        utString decl = FFIType<typename FuncTraits<Func>::ReturnType>::name();
+
+        decl += " (*)(";
+        FFIParams<typename FuncTraits<Func>::Params>::append(decl, true);
+        decl += ")";
+
+        return decl;
+    }
+};
+
 /*
  * Fast path templated code/call generators
  * are specialized C calls which directly
@@ -2843,6 +2949,75 @@ public:
     }
 };
 
+/*
+ * Fast getters for POD data members, these read the value straight from
+ * its offset in the native instance without calling through a member
+ * function pointer
+ */
+template<class CT, class U>
+class CallFastGetVar : public CallFastMemberBase
+{
+public:
+    typedef const U CT::*mp_t;
+
+    mp_t mp;
+
+    static void _call(lua_State *L, CT *_this, void *fast)
+    {
+        CallFastGetVar<CT, U> *_fast = (CallFastGetVar<CT, U> *)fast;
+        lua_pushnumber(L, (lua_Number)(_this->*(_fast->mp)));
+    }
+};
+
+template<class CT>
+class CallFastGetVar<CT, bool> : public CallFastMemberBase
+{
+public:
+    typedef const bool CT::*mp_t;
+
+    mp_t mp;
+
+    static void _call(lua_State *L, CT *_this, void *fast)
+    {
+        CallFastGetVar<CT, bool> *_fast = (CallFastGetVar<CT, bool> *)fast;
+        lua_pushboolean(L, (_this->*(_fast->mp)) ? 1 : 0);
+    }
+};
+
+/*
+ * Fast setters for POD data members, only for members that need nothing
+ * else to happen when they change
+ */
+template<class CT, class U>
+class CallFastSetVar : public CallFastMemberBase
+{
+public:
+    typedef U CT::*mp_t;
+
+    mp_t mp;
+
+    static void _call(lua_State *L, CT *_this, void *fast)
+    {
+        CallFastSetVar<CT, U> *_fast = (CallFastSetVar<CT, U> *)fast;
+        _this->*(_fast->mp) = (U)lua_tonumber(L, 1);
+    }
+};
+
+template<class CT>
+class CallFastSetVar<CT, bool> : public CallFastMemberBase
+{
+public:
+    typedef bool CT::*mp_t;
+
+    mp_t mp;
+
+    static void _call(lua_State *L, CT *_this, void *fast)
+    {
+        CallFastSetVar<CT, bool> *_fast = (CallFastSetVar<CT, bool> *)fast;
+        _this->*(_fast->mp) = lua_toboolean(L, 1) ? true : false;
+    }
+};
+
 //=============================================================================
 
 /**
@@ -3682,7 +3857,7 @@ protected:
             if (!nativeType->isManaged())
             {
                 // lifetime of native storage handled by UserdataValue
-                Constructor<T, Params>::call(Detail::UserdataValue<T>::place(L), args);
+                ScriptConstructed<T>::call(Constructor<T, Params>::call(Detail::UserdataValue<T>::place(L), args));
                 return 1;
             }
 
@@ -3692,6 +3867,7 @@ protected:
 
             // call the constructor with args
             Constructor<T, Params>::call(placement, args);
+            ScriptConstructed<T>::call(placement);
 
             // push the user data on the stack
             Detail::UserdataPtr::push<T> (L, placement, true);
@@ -4010,6 +4186,31 @@ public:
             return *this;
         }
 
+        /**
+         * Add or replace a static member function taking and returning only
+         * numbers and bools. The closure is bound like addStaticMethod and
+         * additionally carries the function pointer and its FFI declaration,
+         * under JIT the class initialization calls it through the FFI so
+         * compiled traces call it directly, on plain Lua the closure is kept.
+         */
+        template<class FP>
+        Class<T>& addStaticMethodFFI(char const *name, FP const fp)
+        {
+            new (lua_newuserdata(L, sizeof(fp)))FP(fp);
+
+            new (lua_newuserdata(L, sizeof(utArray<utString> )))utArray<utString> ();
+            utArray<utString> *array = (utArray<utString> *)lua_touserdata(L, -1);
+            CallFunction<FP>::getStringSignature(*array);
+
+            lua_pushlightuserdata(L, (void *)fp);
+            lua_pushstring(L, FFIDeclaration<FP>::get().c_str());
+
+            lua_pushcclosure(L, &CallFunction<FP>::call, 4);
+            rawsetfield(L, -2, name);
+
+            return *this;
+        }
+
         /** Define a static constructor for this native type which
          *  may include default arguments
          *
@@ -4230,6 +4431,65 @@ public:
             return *this;
         }
 
+        /*
+         * Adds a data property __pget_ method reading a number or bool data
+         * member directly, for getters that would only return the member
+         */
+        template<class U>
+        Class<T>& addProperty(char const *name, const U T::*mp)
+        {
+            {
+                utString getter = "__pget_";
+                getter += name;
+
+                new (lua_newuserdata(L, sizeof(CallFastGetVar<T, U> )))CallFastGetVar<T, U> ();
+                CallFastGetVar<T, U> *b = (CallFastGetVar<T, U> *)lua_topointer(L, -1);
+                b->mp   = mp;
+                b->call = (FastCall)CallFastGetVar<T, U>::_call;
+                rawsetfield(L, -3, getter.c_str());  // class table
+            }
+
+            return *this;
+        }
+
+        /*
+         * Adds a data property __pget_ method reading a number or bool data
+         * member directly and a __pset_ method which *must* have a
+         * specialized CallFastSetMember template available
+         */
+        template<class U, class TS>
+        Class<T>& addProperty(char const *name, const U T::*mp, void (T::*set)(TS))
+        {
+            addProperty(name, mp);
+            addProperty(name, set);
+
+            return *this;
+        }
+
+        /*
+         * Adds a data property __pget_ and __pset_ method reading and writing
+         * a number or bool data member directly, for members that need no
+         * side effects when set
+         */
+        template<class U>
+        Class<T>& addPropertyVar(char const *name, U T::*mp)
+        {
+            addProperty(name, (const U T::*)mp);
+
+            {
+                utString setter = "__pset_";
+                setter += name;
+
+                new (lua_newuserdata(L, sizeof(CallFastSetVar<T, U> )))CallFastSetVar<T, U> ();
+                CallFastSetVar<T, U> *b = (CallFastSetVar<T, U> *)lua_topointer(L, -1);
+                b->mp   = mp;
+                b->call = (FastCall)CallFastSetVar<T, U>::_call;
+                rawsetfield(L, -3, setter.c_str());  // class table
+            }
+
+            return *this;
+        }
+
         //--------------------------------------------------------------------------
 
         /**
@@ -4520,7 +4780,8 @@ private:
 
 public:
 
-    static const char *currentPackageName;
+    // per thread, Workers may register bindings in their VMs
+    static LOOM_THREAD_LOCAL const char *currentPackageName;
 
     //----------------------------------------------------------------------------
 
@@ -4614,6 +4875,9 @@ public:
     template<class T, class U>
     Class<T> deriveClass(char const *name)
     {
+        // the parent may be bound by bindings that aren't registered yet
+        NativeInterface::ensureNativeTypeRegistered(L, NativeInterface::getNativeType<U>());
+
         NativeInterface::deriveNativeTypePackage<T, U>(NativeType<T>::getStaticKey(),
                                                        Detail::ClassInfo<T>::getStaticKey(),
                                                        Detail::ClassInfo<T>::getClassKey(),
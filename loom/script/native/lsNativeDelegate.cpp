@@ -57,11 +57,15 @@ struct NativeDelegateCallNote
     // Current offset in data for read or write.
     unsigned int offset;
 
+    // Link in the pending call note queue.
+    NativeDelegateCallNote *next;
+
     NativeDelegateCallNote(const NativeDelegate *target)
     {
         // Note our target delegate.
         delegate = target;
         delegateKey = target->_key;
+        next = NULL;
 
         // Start with enough buffer space we won't need to realloc in most cases.
         ndata = 512; 
@@ -242,76 +246,66 @@ enum
     MSG_Invoke,
 };
 
-// Thread-safe queue of NativeDelegateCallNotes for execution on main thread.
-static MutexHandle gCallNoteMutex = NULL;
-static utArray<NativeDelegateCallNote*> gNDCallNoteQueue;
+// Lock-free queue of NativeDelegateCallNotes for execution on main thread.
+// Any thread pushes onto the head of the list, the main thread takes the
+// whole list at once and runs it oldest first.
+static NativeDelegateCallNote *volatile gNDCallNoteHead = NULL;
 
-static void ensureQueueInit()
-{
-    if(gCallNoteMutex)
-        return;
-
-    gCallNoteMutex = loom_mutex_create();
-}
+// Registered delegates by key, so notes resolve without a search. Only
+// touched on the main thread.
+static utHashTable<utIntHashKey, NativeDelegate *> gDelegatesByKey;
 
 void NativeDelegate::postNativeDelegateCallNote(NativeDelegateCallNote *ndcn)
 {
-    ensureQueueInit();
-    loom_mutex_lock(gCallNoteMutex);
-
     // Prep for reading.
     ndcn->rewind();
 
     // Store for later access.
-    gNDCallNoteQueue.push_back(ndcn);
-
-    loom_mutex_unlock(gCallNoteMutex);
+    NativeDelegateCallNote *head;
+    do
+    {
+        head       = gNDCallNoteHead;
+        ndcn->next = head;
+    } while (atomic_compareAndExchangePointer((void *volatile *)&gNDCallNoteHead, head, ndcn) != head);
 }
 
 void NativeDelegate::executeDeferredCalls(lua_State *L)
 {
-    ensureQueueInit();
-    loom_mutex_lock(gCallNoteMutex);
-
-    // Try to resolve the delegate pointer.
-    utArray<NativeDelegate *> *delegates = NULL;
-    if (sActiveNativeDelegates.find(L) != UT_NPOS)
+    // Take everything posted so far, notes posted while these run wait
+    // for the next call.
+    NativeDelegateCallNote *head;
+    do
     {
-        delegates = *(sActiveNativeDelegates.get(L));
-    }
-    else
+        head = gNDCallNoteHead;
+        if (!head)
+            return;
+    } while (atomic_compareAndExchangePointer((void *volatile *)&gNDCallNoteHead, head, NULL) != head);
+
+    // Pushed newest first, reverse to run them in order.
+    NativeDelegateCallNote *ordered = NULL;
+    while (head)
     {
-        // No delegate list, can't do it.
-        loom_mutex_unlock(gCallNoteMutex);
-        return;
+        NativeDelegateCallNote *next = head->next;
+        head->next = ordered;
+        ordered    = head;
+        head       = next;
     }
 
-    for(unsigned int i=0; i<gNDCallNoteQueue.size(); i++)
+    while (ordered)
     {
-        NativeDelegateCallNote *ndcn = gNDCallNoteQueue[i];
-
-        bool found = false;
-        for(unsigned int i=0; i<delegates->size(); i++)
-        {
-            // Look for our delegate.
-            if((*delegates)[i] != ndcn->delegate)
-                continue;
+        NativeDelegateCallNote *ndcn = ordered;
+        ordered = ndcn->next;
 
-            // If key mismatches, warn and bail.
-            if((*delegates)[i]->_key != ndcn->delegateKey)
-            {
-                lmLogError(gNativeDelegateGroup, "Found delegate call note with key mismatch (delegate=%x actualKey=%x expectedKey=%x), ignoring...", (*delegates)[i], (*delegates)[i]->_key, ndcn->delegateKey);
-                break;
-            }
+        // Resolve the delegate by key, which also catches delegates that
+        // were deleted and maybe reallocated at the same address.
+        NativeDelegate **found = gDelegatesByKey.get(ndcn->delegateKey);
 
-            // Match!
-            found = true;
-            break;
-        }
-
-        // Bail if no match.
-        if(!found)
+        // Bail if no match, or the delegate lives in another VM.
+        if (!found || (*found != ndcn->delegate) || ((*found)->L != L))
+        {
+            lmDelete(NULL, ndcn);
             continue;
+        }
 
         // Otherwise, let's call it.
         const NativeDelegate *theDelegate = ndcn->delegate;
@@ -366,22 +360,19 @@ void NativeDelegate::executeDeferredCalls(lua_State *L)
                 break;
         }
 
+        lmDelete(NULL, ndcn);
     }
-
-    // Purge queue.
-    gNDCallNoteQueue.clear();
-
-    loom_mutex_unlock(gCallNoteMutex);
 }
 
 // To disambiguate NativeDelegates at the address of old NDs, we have a key.
 // in order to collide you have to allocate and free 4 billion NDs and get the same address
 // on the 4 billionth ND as you did on the first. If you get a crash due to this coincidence,
 // I'll buy you something nice.
-static int gNativeDelegateKeyGenerator = 1000;
+// Atomic, as native objects may be created by the VMs of Workers.
+static volatile atomic_int_t gNativeDelegateKeyGenerator = 1000;
 
 NativeDelegate::NativeDelegate()
-    : L(NULL), _callbackCount(0), _allowAsync(true), _argumentCount(0), _activeNote(NULL), _key(gNativeDelegateKeyGenerator++)
+    : L(NULL), _callbackCount(0), _allowAsync(true), _argumentCount(0), _activeNote(NULL), _key(atomic_increment(&gNativeDelegateKeyGenerator))
 {
 }
 
@@ -434,6 +425,8 @@ void NativeDelegate::registerDelegate(lua_State *L, NativeDelegate *delegate)
     }
 
     delegates->push_back(delegate);
+
+    gDelegatesByKey.insert(delegate->_key, delegate);
 }
 
 
@@ -506,7 +499,7 @@ void NativeDelegate::pushArgument(const char *value) const
         return;
     }
 
-    if (!L)
+    if (!L || !_callbackCount)
         return;
 
     lua_pushstring(L, value);
@@ -522,7 +515,7 @@ void NativeDelegate::pushArgument(utByteArray *value) const
         return;
     }
 
-    if (!L)
+    if (!L || !_callbackCount)
         return;
 
     lualoom_pushnative<utByteArray>(L, value);
@@ -539,7 +532,7 @@ void NativeDelegate::pushArgument(int value) const
         return;
     }
 
-    if (!L)
+    if (!L || !_callbackCount)
         return;
 
     lua_pushinteger(L, value);
@@ -556,7 +549,7 @@ void NativeDelegate::pushArgument(float value) const
         return;
     }
 
-    if (!L)
+    if (!L || !_callbackCount)
         return;
 
     lua_pushnumber(L, value);
@@ -573,7 +566,7 @@ void NativeDelegate::pushArgument(double value) const
         return;
     }
 
-    if (!L)
+    if (!L || !_callbackCount)
         return;
 
     lua_pushnumber(L, value);
@@ -590,7 +583,7 @@ void NativeDelegate::pushArgument(bool value) const
         return;
     }
 
-    if (!L)
+    if (!L || !_callbackCount)
         return;
 
     lua_pushboolean(L, value);
@@ -629,52 +622,82 @@ void NativeDelegate::invoke () const
         return;
     }
 
-    int top = lua_gettop(L);
-
     int numArgs = _argumentCount;
 
     // Reset argument count, so recursion is properly handled
     _argumentCount = 0;
 
-    getCallbacks(L);
+    // Nobody listening, pushArgument already skipped the arguments, only
+    // ones pushed by hand with incArgCount are left to clean up.
+    if (!_callbackCount)
+    {
+        lua_pop(L, numArgs);
+        return;
+    }
 
-    int tidx = lua_gettop(L);
+    int argIdx = lua_gettop(L) - numArgs + 1;
 
-    if (!lua_istable(L, tidx))
+    // Call all listeners from one protected call of the dispatcher, with
+    // the arguments pushed by the caller passed through as they are.
+    lua_rawgeti(L, LUA_GLOBALSINDEX, LSINDEXNATIVEDELEGATEDISPATCH);
+    if (lua_isnil(L, -1))
     {
-        LSError("Error getting native delegate callback table");
+        lua_pop(L, 1);
+        lua_pushcfunction(L, dispatch);
+        lua_pushvalue(L, -1);
+        lua_rawseti(L, LUA_GLOBALSINDEX, LSINDEXNATIVEDELEGATEDISPATCH);
     }
+    lua_insert(L, argIdx);
 
-    for (int i = 0; i < _callbackCount; i++)
-    {
-        lua_pushnumber(L, (double)i);
-        lua_gettable(L, tidx);
+    lua_pushlightuserdata(L, (void *)this);
+    lua_insert(L, argIdx + 1);
 
-        int t = lua_gettop(L);
+    getCallbacks(L);
 
-        for (int i = top - numArgs; i < top; i++)
-        {
-            lua_pushvalue(L, i + 1);
-        }
+    if (!lua_istable(L, -1))
+    {
+        LSError("Error getting native delegate callback table");
+    }
 
-        int error = lua_pcall(L, numArgs, 1, 0);
-        lmAssert(error == 0, "Lua error calling native delegate callback: %s: %s", (
-            error == LUA_ERRRUN ? "runtime error" :
-            error == LUA_ERRMEM ? "memory allocation error" :
-            error == LUA_ERRERR ? "error handler error" :
-            "unknown error"
-            ), lua_tostring(L, -1));
+    lua_insert(L, argIdx + 2);
 
-        lua_settop(L, t);
+    int error = lua_pcall(L, numArgs + 2, 0, 0);
+    lmAssert(error == 0, "Lua error calling native delegate callback: %s: %s", (
+        error == LUA_ERRRUN ? "runtime error" :
+        error == LUA_ERRMEM ? "memory allocation error" :
+        error == LUA_ERRERR ? "error handler error" :
+        "unknown error"
+        ), lua_tostring(L, -1));
 
-        /* removes last lua_function called */
+    if (error)
+    {
+        // pop the error message
         lua_pop(L, 1);
     }
+}
 
-    lua_settop(L, top);
 
-    // clean up arguments off stack
-    lua_pop(L, numArgs);
+int NativeDelegate::dispatch(lua_State *L)
+{
+    const NativeDelegate *delegate = (const NativeDelegate *)lua_topointer(L, 1);
+
+    int numArgs = lua_gettop(L) - 2;
+
+    // The count is read every time around as listeners may remove
+    // themselves or others while being called.
+    for (int i = 0; i < delegate->_callbackCount; i++)
+    {
+        lua_rawgeti(L, 2, i);
+
+        for (int a = 0; a < numArgs; a++)
+        {
+            lua_pushvalue(L, 3 + a);
+        }
+
+        lua_call(L, numArgs, 0);
+    }
+
+    return 0;
 }
 
 
@@ -915,6 +938,7 @@ void NativeDelegate::invalidateLuaStateDelegates(lua_State *L)
         for (UTsize i = 0; i < delegates->size(); i++)
         {
             NativeDelegate *delegate = delegates->at(i);
+            gDelegatesByKey.remove(delegate->_key);
             delegate->invalidate();
         }
 
@@ -940,6 +964,8 @@ NativeDelegate::~NativeDelegate()
             delegates->erase(idx);
     }
 
+    gDelegatesByKey.remove(_key);
+
     // And clean up our Lua VM state.
     invalidate();
 }
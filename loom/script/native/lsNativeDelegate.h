@@ -70,6 +70,10 @@ class NativeDelegate
     // Returns a note in cases where we should be doing an async delegate.
     NativeDelegateCallNote *prepCallbackNote() const;
 
+    // Calls every listener, arguments are the delegate, its callbacks table
+    // and the arguments to pass on.
+    static int dispatch(lua_State *L);
+
 public:
 
     // The thread ID on which script callbacks execute. Used for debugging
@@ -110,7 +114,7 @@ public:
 
     // To call the delegate, just pushArgument the parameters, then call invoke.
     // No conditional checks are required, NativeDelegate deals with all that for
-    // you.
+    // you. Without listeners the arguments aren't even pushed.
     void pushArgument(const char *value) const;
     void pushArgument(utByteArray *value) const;
     void pushArgument(int value) const;
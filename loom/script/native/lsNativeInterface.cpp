@@ -31,20 +31,26 @@ lmDefineLogGroup(nativeInterfaceLogGroup, "interface", 1, LoomLogInfo);
 namespace LS {
 utHashTable<utPointerHashKey, NativeTypeBase *> NativeInterface::nativeTypes;
 
-utHashTable<utPointerHashKey, Type *>         NativeInterface::scriptTypes;
 utHashTable<utHashedString, NativeTypeBase *> NativeInterface::cTypes;
 
 utHashTable<utPointerHashKey, NativeTypeBase *> NativeInterface::scriptToNative;
 
+RWLock NativeInterface::typeLock;
+
 utHashTable<utPointerHashKey, lua_State *> NativeInterface::handleEntryToLuaState;
 
+LightMutex NativeInterface::handleLock;
+
 // Checks that the native managed type being deleted isn't still in use
 // by script. See `lualoom_managedpointerreleased` for more info.
 //
 // Note that this check only happens if the debug allocator is enabled.
 static void onFree(loom_allocator_t *thiz, void *inner, size_t size, const char *file, int line)
 {
+    loom_lightMutex_lock(&NativeInterface::handleLock);
     lua_State **statePtr = NativeInterface::handleEntryToLuaState.get(inner);
+    loom_lightMutex_unlock(&NativeInterface::handleLock);
+
     lmAssert(!statePtr, "Native managed type at address 0x%X freed without calling `lualoom_managedpointerreleased` first.\n    Deallocation was at %s@%d", inner, file, line);
 }
 
@@ -167,6 +173,8 @@ void NativeTypeBase::validate(Type *type)
 
 void NativeInterface::shutdownLuaState(lua_State *L)
 {
+    loom_lightMutex_lock(&handleLock);
+
     utArray<utPointerHashKey> entries;
     for (UTsize i = 0; i < handleEntryToLuaState.size(); i++)
     {
@@ -181,29 +189,145 @@ void NativeInterface::shutdownLuaState(lua_State *L)
         handleEntryToLuaState.remove(entries.at(i));
     }
 
-    //TODO: LOOM-708, improve vm shutdown
-    scriptTypes.clear();
-    scriptToNative.clear();
+    loom_lightMutex_unlock(&handleLock);
+
+    LSLuaState *ls = LSLuaState::getLuaState(L);
+
+    // forget the types of this VM only, others may be running on Workers
+    loom_rwlock_lockWrite(&typeLock);
+
+    for (UTsize i = 0; i < ls->nativeScriptTypes.size(); i++)
+    {
+        scriptToNative.remove(ls->nativeScriptTypes.at(i));
+    }
+
+    loom_rwlock_unlockWrite(&typeLock);
+
+    ls->nativeScriptTypes.clear();
+    ls->registeredFunctions.clear();
 }
 
 
-// note this method may be called multiple times per type, per VM
-void NativeInterface::resolveScriptType(Type *type)
+void NativeInterface::registerNativeTypes(lua_State *L)
+{
+    LSLuaState::getLuaState(L)->registeredFunctions.clear();
+}
+
+
+bool NativeInterface::isRegistered(lua_State *L, FunctionLuaRegisterType registerFunction)
+{
+    if (!registerFunction)
+    {
+        return true;
+    }
+
+    return LSLuaState::getLuaState(L)->registeredFunctions.find(registerFunction) != UT_NPOS;
+}
+
+
+void NativeInterface::callRegisterFunction(lua_State *L, FunctionLuaRegisterType registerFunction)
+{
+    utArray<FunctionLuaRegisterType>& registered = LSLuaState::getLuaState(L)->registeredFunctions;
+
+    // marked first as the register function may derive from a class it
+    // registers itself, it may also be shared by multiple types
+    registered.push_back(registerFunction);
+
+    // a derived class may register its parent's bindings in the middle of
+    // another package
+    const char *packageName = Namespace::currentPackageName;
+
+    int top = lua_gettop(L);
+    registerFunction(L);
+    lua_settop(L, top);
+
+    Namespace::currentPackageName = packageName;
+
+    lmLogDebug(nativeInterfaceLogGroup, "Registered bindings on first use, %d registered so far",
+               (int)registered.size());
+}
+
+
+NativeTypeBase *NativeInterface::findRegisteredNativeType(lua_State *L, Type *type)
 {
     for (UTsize i = 0; i < nativeTypes.size(); i++)
     {
         NativeTypeBase *ntype = nativeTypes.at(i);
 
+        if (!isRegistered(L, ntype->registerFunction))
+        {
+            continue;
+        }
+
         if (type->getPackageName() == ntype->getScriptPackage())
         {
             if (!strcmp(ntype->getScriptName().c_str(), type->getName()))
             {
-                scriptTypes.insert(ntype, type);
-                scriptToNative.insert(type, ntype);
+                return ntype;
+            }
+        }
+    }
+
+    return NULL;
+}
+
 
-                return;
+// The name of a C++ type without its namespaces
+static const char *getUnqualifiedTypeName(const char *cTypeName)
+{
+    const char *name = strrchr(cTypeName, ':');
+
+    return name ? name + 1 : cTypeName;
+}
+
+
+// note this method may be called multiple times per type, per VM
+void NativeInterface::resolveScriptType(Type *type)
+{
+    lua_State *L = type->getAssembly()->getLuaState()->VM();
+
+    NativeTypeBase *ntype = findRegisteredNativeType(L, type);
+
+    // the script package of a native type isn't known before its bindings
+    // are registered, script classes are usually bound under the name of
+    // their C++ class so try the bindings of those first
+    if (!ntype)
+    {
+        for (UTsize i = 0; i < nativeTypes.size(); i++)
+        {
+            NativeTypeBase *candidate = nativeTypes.at(i);
+
+            if (!isRegistered(L, candidate->registerFunction) &&
+                !strcmp(getUnqualifiedTypeName(candidate->getCTypeName().c_str()), type->getName()))
+            {
+                callRegisterFunction(L, candidate->registerFunction);
             }
         }
+
+        ntype = findRegisteredNativeType(L, type);
+    }
+
+    // otherwise register the remaining bindings until one binds the type
+    for (UTsize i = 0; !ntype && i < nativeTypes.size(); i++)
+    {
+        NativeTypeBase *candidate = nativeTypes.at(i);
+
+        if (!isRegistered(L, candidate->registerFunction))
+        {
+            callRegisterFunction(L, candidate->registerFunction);
+            ntype = findRegisteredNativeType(L, type);
+        }
+    }
+
+    if (ntype)
+    {
+        type->getAssembly()->getLuaState()->nativeScriptTypes.insert(ntype, type);
+
+        loom_rwlock_lockWrite(&typeLock);
+        scriptToNative.insert(type, ntype);
+        loom_rwlock_unlockWrite(&typeLock);
+
+        return;
     }
 
     type->setMissing("resolveScriptType");
@@ -211,6 +335,49 @@ void NativeInterface::resolveScriptType(Type *type)
 }
 
 
+Type *NativeInterface::getScriptType(lua_State *L, NativeTypeBase *nativeType)
+{
+    Type **type = LSLuaState::getLuaState(L)->nativeScriptTypes.get(nativeType);
+
+    if (type)
+    {
+        return *type;
+    }
+    return NULL;
+}
+
+
+NativeTypeBase *NativeInterface::getNativeType(const utString& ctypename)
+{
+    loom_rwlock_lockRead(&typeLock);
+    NativeTypeBase **n      = cTypes.get(ctypename.c_str());
+    NativeTypeBase *cached  = n ? *n : NULL;
+    loom_rwlock_unlockRead(&typeLock);
+
+    if (cached)
+    {
+        return cached;
+    }
+
+    // linear search, over all native types as the ones resolved are per VM
+    for (UTsize i = 0; i < nativeTypes.size(); i++)
+    {
+        NativeTypeBase *ntb = nativeTypes.at(i);
+
+        if (ntb->getCTypeName() == ctypename)
+        {
+            // cache
+            loom_rwlock_lockWrite(&typeLock);
+            cTypes.insert(ctypename, ntb);
+            loom_rwlock_unlockWrite(&typeLock);
+            return ntb;
+        }
+    }
+
+    return NULL;
+}
+
+
 int NativeInterface::getManagedObectCount(const char *classPath,
     LSLuaState *ls)
 {
@@ -296,11 +463,13 @@ void NativeInterface::dumpManagedNatives(lua_State *L)
 
 void NativeInterface::managedPointerReleased(void* entry, int version)
 {
+    loom_lightMutex_lock(&handleLock);
     lua_State **statePtr = handleEntryToLuaState.get(entry);
-    if (!statePtr)
-        return;
+    lua_State *L         = statePtr ? *statePtr : NULL;
+    loom_lightMutex_unlock(&handleLock);
 
-    lua_State *L = *statePtr;
+    if (!L)
+        return;
 
     lua_rawgeti(L, LUA_GLOBALSINDEX, LSINDEXMANAGEDVERSION);
 
@@ -315,7 +484,9 @@ void NativeInterface::managedPointerReleased(void* entry, int version)
     lua_gettable(L, -3); // get from userdata
     if (!lua_isnil(L, -1))
     {
+        loom_lightMutex_lock(&handleLock);
         handleEntryToLuaState.remove(entry);
+        loom_lightMutex_unlock(&handleLock);
 
         lua_pushvalue(L, -1);
         lua_gettable(L, -3);
@@ -558,6 +729,8 @@ Type *lualoom_gettype(lua_State *L, const utString& fullPath)
 
 void lualoom_newnativeuserdata(lua_State *L, NativeTypeBase *nativeType, void *p, bool owner)
 {
+    NativeInterface::ensureNativeTypeRegistered(L, nativeType);
+
     // In-place new the user data pointer and get a reference to it.
     new (lua_newuserdata(L, sizeof(Detail::UserdataPtr))) Detail::UserdataPtr(p);
     Detail::Userdata *ud = (Detail::Userdata *)lua_topointer(L, -1);
@@ -592,7 +765,7 @@ bool lualoom_pushnative(lua_State *L, NativeTypeBase *nativeType, void *p)
         // create the new userdata with given native type
         lualoom_newnativeuserdata(L, nativeType, p);
         // wrap the instance with the corresponding LoomScript class table
-        lualoom_pushnative_userdata(L, NativeInterface::getScriptType(nativeType), -1);
+        lualoom_pushnative_userdata(L, NativeInterface::getScriptType(L, nativeType), -1);
         lua_remove(L, -2); // remove the user data
     }
     else
@@ -625,7 +798,9 @@ void lualoom_pushnative_userdata(lua_State *L, Type *type, int nativeIdx)
 
     nativeIdx = lua_absindex(L, nativeIdx);
 
-    lua_newtable(L);
+    // unmanaged natives are rewrapped on every push, size the table for
+    // the class, type and native slots up front
+    lua_createtable(L, 0, 3);
     int instanceIdx = lua_gettop(L);
 
     lsr_getclasstable(L, type);
@@ -684,4 +859,44 @@ Type *lualoom_checkinstancetype(lua_State *L, int index, const char *fullTypePat
 
     return NULL;
 }
+
+
+int lualoom_getfunctionparametercount(lua_State *L, int index)
+{
+    index = lua_absindex(L, index);
+
+    lmAssert(lua_isfunction(L, index) || lua_iscfunction(L, index), "Non-function in lualoom_getfunctionparametercount");
+
+    // first look in the global method lookup to see if we have a method base to go off
+    lua_rawgeti(L, LUA_GLOBALSINDEX, LSINDEXMETHODLOOKUP);
+    lua_pushvalue(L, index);
+    lua_rawget(L, -2);
+
+    if (!lua_isnil(L, -1))
+    {
+        MethodBase *methodBase = (MethodBase *)lua_topointer(L, -1);
+        lua_pop(L, 2);
+        return methodBase->getNumParameters();
+    }
+
+    lua_pop(L, 2);
+
+    // we don't, so we better be a local function with an upvalue at index 1 describing the number of parameters
+    const char *upvalue = lua_getupvalue(L, index, 1);
+
+    lmAssert(upvalue, "Internal Error: funcinfo not at upvalue 1");
+
+#ifdef LOOM_DEBUG
+    lmAssert(!strncmp(upvalue, "__ls_funcinfo_arginfo", 21), "Internal Error: funcinfo not __ls_funcinfo_arginfo");
+#endif
+
+    lmAssert(lua_isnumber(L, -1), "Internal Error: __ls_funcinfo_arginfo not a number");
+
+    // number of args stored in upper 16 bits
+    int count = (int)(((unsigned int)lua_tonumber(L, -1)) >> 16);
+
+    lua_pop(L, 1);
+
+    return count;
+}
 }
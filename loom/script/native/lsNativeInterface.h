@@ -26,6 +26,7 @@
 
 #include "loom/common/utils/utTypes.h"
 #include "loom/common/utils/utString.h"
+#include "loom/common/platform/platformThread.h"
 
 #include "loom/script/runtime/lsRuntime.h"
 
@@ -90,6 +91,17 @@ void *lualoom_getnativepointer(lua_State *L, int index, bool replaceIndex = fals
  */
 void lualoom_newscriptinstance_internal(lua_State *L, Type *type);
 
+/*
+ * Releases the instance of a [Pooled] type at index back to its class' pool, clearing its state, new
+ * instances of the type reuse it. Any access to it until then is an error, as is releasing it twice.
+ */
+void lualoom_poolrelease(lua_State *L, int index);
+
+/*
+ * Resumes every coroutine started with Coroutine.start whose wait is over, called once per frame.
+ */
+void lualoom_updatecoroutines(lua_State *L);
+
 /*
  * Internal function to can class initializers (not constructors) for a hierarchy chain stopping at the given
  * parent type (in the case of the parents initilaizers already having been run)
@@ -118,6 +130,12 @@ void lualoom_managedpointerreleased(void *p);
  */
 Type *lualoom_checkinstancetype(lua_State *L, int index, const char *fullTypePath);
 
+/*
+ * Returns the number of formal parameters of the function at index, not
+ * counting a ...rest parameter, as Function.length does.
+ */
+int lualoom_getfunctionparametercount(lua_State *L, int index);
+
 
 class NativeEntry;
 
@@ -289,10 +307,10 @@ public:
     // templated static key -> NativeTypeBase
     static utHashTable<utPointerHashKey, NativeTypeBase *> nativeTypes;
 
-    // These are stored statically here as Types are per VM
-
-    // NativeTypeBase* -> Type*
-    static utHashTable<utPointerHashKey, Type *> scriptTypes;
+    // These are stored statically here as Types are per VM, the VMs of
+    // Workers run on other threads so they are guarded by typeLock. The
+    // script Type a native type resolved to and the register functions
+    // called are kept per VM, in LSLuaState
 
     // C/C++ type string -> NativeTypeBase*
     static utHashTable<utHashedString, NativeTypeBase *> cTypes;
@@ -300,9 +318,20 @@ public:
     // Type* -> NativeTypeBase*
     static utHashTable<utPointerHashKey, NativeTypeBase *> scriptToNative;
 
-    // void* -> LSLuaState
+    static RWLock typeLock;
+
+    // void* -> LSLuaState, guarded by handleLock
     static utHashTable<utPointerHashKey, lua_State *> handleEntryToLuaState;
 
+    static LightMutex handleLock;
+
+    static bool isRegistered(lua_State *L, FunctionLuaRegisterType registerFunction);
+
+    static void callRegisterFunction(lua_State *L, FunctionLuaRegisterType registerFunction);
+
+    // The registered native type bound to the script type, if any
+    static NativeTypeBase *findRegisteredNativeType(lua_State *L, Type *type);
+
     /*
      * Store the managed native user data on the top of the stack
      * to the entry->version and entry->userdata global lookup table
@@ -316,7 +345,9 @@ public:
 
         int uIdx = lua_gettop(L);
 
+        loom_lightMutex_lock(&handleLock);
         handleEntryToLuaState.insert(ptr, L);
+        loom_lightMutex_unlock(&handleLock);
 
         // store (void*) entry to version number
         lua_rawgeti(L, LUA_GLOBALSINDEX, LSINDEXMANAGEDVERSION);
@@ -345,7 +376,7 @@ public:
 
         registerManagedNativeUserData(L, nativeType, ptr);
 
-        Type *type = getScriptType(nativeType);
+        Type *type = getScriptType(L, nativeType);
 
         lualoom_newscriptinstance_internal(L, type);
 
@@ -376,68 +407,31 @@ public:
 
     static void shutdownLuaState(lua_State *L);
 
-    inline static Type *getScriptType(NativeTypeBase *nativeType)
-    {
-        Type **type = scriptTypes.get(nativeType);
-
-        if (type)
-        {
-            return *type;
-        }
-        return NULL;
-    }
+    // The script Type the native type resolved to in the VM of L
+    static Type *getScriptType(lua_State *L, NativeTypeBase *nativeType);
 
     /*
      * Retrieve the native type given the ctype name (which is possibly qualified by C++ namespace)
      */
-    static NativeTypeBase *getNativeType(const utString& ctypename)
-    {
-        NativeTypeBase **n = cTypes.get(ctypename.c_str());
+    static NativeTypeBase *getNativeType(const utString& ctypename);
 
-        if (n)
-        {
-            lmAssert(*n, "Unexpected NULL result on getNativeType: %s", ctypename.c_str());
-            return *n;
-        }
-
-        // linear search
-        utHashTableIterator<utHashTable<utPointerHashKey, Type *> > itr(scriptTypes);
-        while (itr.hasMoreElements())
-        {
-            NativeTypeBase *ntb = (NativeTypeBase *)itr.peekNextKey().key();
-
-            if (ntb->getCTypeName() == ctypename)
-            {
-                // cache
-                cTypes.insert(ctypename, ntb);
-                return ntb;
-            }
-
-            itr.next();
-        }
-
-        return NULL;
-    }
+    /*
+     * Prepares the lua_State for native types. The bindings aren't
+     * registered here, the register function of a type is called the first
+     * time a script type resolves to it or an instance of it is pushed, so
+     * bindings a game never uses don't build their class tables.
+     */
+    static void registerNativeTypes(lua_State *L);
 
-    static void registerNativeTypes(lua_State *L)
+    /*
+     * Calls the register function of the native type, and so of all types
+     * it shares it with, if it hasn't been for the lua_State yet
+     */
+    static void ensureNativeTypeRegistered(lua_State *L, NativeTypeBase *nativeType)
     {
-        // it is possible that the registration function is shared
-        // by multiple types, so avoid duplicate registrations
-        utArray<FunctionLuaRegisterType> called;
-
-        for (UTsize i = 0; i < nativeTypes.size(); i++)
+        if (nativeType && !isRegistered(L, nativeType->registerFunction))
         {
-            NativeTypeBase *ntype = nativeTypes.at(i);
-            assert(ntype->registerFunction);
-
-            if (called.find(ntype->registerFunction) != UT_NPOS)
-            {
-                continue;
-            }
-
-            ntype->registerFunction(L);
-
-            called.push_back(ntype->registerFunction);
+            callRegisterFunction(L, nativeType->registerFunction);
         }
     }
 
@@ -554,14 +548,14 @@ public:
 
     static NativeTypeBase *getNativeType(Type *scriptType)
     {
-        NativeTypeBase **ntb = scriptToNative.get(scriptType);
+        loom_rwlock_lockRead(&typeLock);
 
-        if (ntb)
-        {
-            return *ntb;
-        }
+        NativeTypeBase **ntb   = scriptToNative.get(scriptType);
+        NativeTypeBase *result = ntb ? *ntb : NULL;
+
+        loom_rwlock_unlockRead(&typeLock);
 
-        return NULL;
+        return result;
     }
 
     static void dumpManagedNatives(lua_State *L);
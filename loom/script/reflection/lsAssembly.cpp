@@ -32,6 +32,9 @@ namespace LS {
 // loaded assemblies by lua_State (utPointerHashKey)
 utHashTable<utPointerHashKey, utHashTable<utHashedString, Assembly *> *> Assembly::assemblies;
 
+// guards assemblies, the VMs of Workers look theirs up on their threads
+static LightMutex gAssembliesLock;
+
 // cached type -> assembly lookup
 utHashTable<utPointerHashKey, Assembly *> Assembly::typeAssemblyLookup;
 
@@ -84,6 +87,8 @@ Assembly *Assembly::create(LSLuaState *vm, const utString& name, const utString&
 
     utHashTable<utHashedString, Assembly *> *lookup = NULL;
 
+    loom_lightMutex_lock(&gAssembliesLock);
+
     UTsize idx = assemblies.find(vm);
 
     if (idx != UT_NPOS)
@@ -99,6 +104,8 @@ Assembly *Assembly::create(LSLuaState *vm, const utString& name, const utString&
     utHashedString key = a->name;
     lookup->insert(key, a);
 
+    loom_lightMutex_unlock(&gAssembliesLock);
+
     vm->assemblies.insert(utHashedString(a->uid), a);
 
     return a;
@@ -367,23 +374,21 @@ void Assembly::connectToDebugger(const char *host, int port)
 
 void Assembly::getLoadedAssemblies(LSLuaState *vm, utList<Assembly *>& oassemblies)
 {
-    utHashTable<utHashedString, Assembly *> *lookup = NULL;
+    loom_lightMutex_lock(&gAssembliesLock);
 
     UTsize idx = assemblies.find(vm);
 
     if (idx != UT_NPOS)
     {
-        lookup = assemblies.at(idx);
-    }
-    else
-    {
-        return;
-    }
+        utHashTable<utHashedString, Assembly *> *lookup = assemblies.at(idx);
 
-    for (UTsize i = 0; i < lookup->size(); i++)
-    {
-        oassemblies.push_back(lookup->at(i));
+        for (UTsize i = 0; i < lookup->size(); i++)
+        {
+            oassemblies.push_back(lookup->at(i));
+        }
     }
+
+    loom_lightMutex_unlock(&gAssembliesLock);
 }
 
 
@@ -409,6 +414,8 @@ Assembly::~Assembly()
     utHashTable<utHashedString, Assembly *> *lookup;
     UTsize idx;
 
+    loom_lightMutex_lock(&gAssembliesLock);
+
     idx = assemblies.find(vm);
     if (idx != UT_NPOS)
     {
@@ -426,6 +433,8 @@ Assembly::~Assembly()
         }
     }
 
+    loom_lightMutex_unlock(&gAssembliesLock);
+
     lmDelete(NULL, ordinalTypes);
 
 }
@@ -187,7 +187,7 @@ void ByteCode::serialize(utByteArray *bytes)
     if (data.size() > 0) bytes->writeBytes(&wrapper);
 }
 
-void ByteCode::deserialize(utByteArray *bytes)
+void ByteCode::deserialize(utByteArray *bytes, bool vmOnly)
 {
     unsigned char magic = bytes->readUnsignedByte();
     lmAssert(magic == LOOM_CLASSIC_BYTECODE_MAGIC, "Loom JIT ByteCode magic mismatch: %x", magic);
@@ -199,11 +199,13 @@ void ByteCode::deserialize(utByteArray *bytes)
     base64.clear();
     if (size == 0) return;
 
-    utByteArray data;
+    lmAssert(size <= bytes->bytesAvailable(), "Loom ByteCode truncated");
 
-    bytes->readBytes(&data, 0, size);
-
-    base64 = utBase64::encode64(*data.getInternalArray());
+    // the chunk is already dumped bytecode ready for the VM, copy it out
+    // without the base64 encoding, which only the compiler needs
+    unsigned int position = bytes->getPosition();
+    base64.setData((const unsigned char *)bytes->getDataPtr() + position, size);
+    bytes->setPosition(position + size);
 }
 
 
@@ -65,7 +65,8 @@ public:
     static ByteCode *encode64(const utArray<unsigned char>& bc);
 
     void serialize(utByteArray *bytes);
-    void deserialize(utByteArray *bytes);
+    // there is a single variant, vmOnly is accepted for parity with the JIT
+    void deserialize(utByteArray *bytes, bool vmOnly = false);
 };
 }
 #endif
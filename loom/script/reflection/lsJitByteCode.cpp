@@ -243,6 +243,13 @@ void ByteCodeVariant::deserialize(utByteArray *stream) {
     base64.clear(); flags |= BASE64_DIRTY;
 }
 
+void ByteCodeVariant::skip(utByteArray *stream) {
+    UTsize size = static_cast<UTsize>(stream->readUnsignedInt());
+    lmAssert(size <= stream->bytesAvailable(), "Loom JIT ByteCode truncated");
+    stream->setPosition(stream->getPosition() + size);
+    clear();
+}
+
 
 
 
@@ -333,15 +340,29 @@ void ByteCode::serialize(utByteArray *bytes)
     fr2.serialize(bytes);
 }
 
-void ByteCode::deserialize(utByteArray *bytes)
+void ByteCode::deserialize(utByteArray *bytes, bool vmOnly)
 {
     unsigned char magic = bytes->readUnsignedByte();
     lmAssert(magic == LOOM_JIT_BYTECODE_MAGIC, "Loom JIT ByteCode magic mismatch: %x", magic);
     unsigned char ver = bytes->readUnsignedByte();
     lmAssert(ver == LOOM_JIT_BYTECODE_VERSION, "Loom JIT ByteCode version mismatch: %d", ver);
 
-    std.deserialize(bytes);
+    if (!vmOnly)
+    {
+        std.deserialize(bytes);
+        fr2.deserialize(bytes);
+        return;
+    }
+
+    // only the variant matching the VM is ever loaded, the other one is
+    // skipped rather than copied
+#if LJ_FR2
+    std.skip(bytes);
     fr2.deserialize(bytes);
+#else
+    std.deserialize(bytes);
+    fr2.skip(bytes);
+#endif
 }
 
 bool ByteCode::load(LSLuaState *ls, bool execute)
@@ -63,6 +63,9 @@ public:
 
     void serialize(utByteArray *stream);
     void deserialize(utByteArray *stream);
+
+    // moves past a serialized variant without reading it
+    void skip(utByteArray *stream);
 };
 
 class ByteCode {
@@ -92,7 +95,10 @@ public:
     void clear();
 
     void serialize(utByteArray *bytes);
-    void deserialize(utByteArray *bytes);
+
+    // vmOnly reads just the variant the running VM loads, for bytecode that
+    // is never serialized again
+    void deserialize(utByteArray *bytes, bool vmOnly = false);
 
 };
 }
@@ -98,22 +98,13 @@ void MethodBase::push()
 
 void lsr_getclasstable(lua_State *L, Type *type);
 
-int MethodInfo::_invoke(lua_State *L)
+void MethodInfo::pushCallable(lua_State *L, int thisIdx)
 {
-    // index 1 = MethodInfo
-    // index 2 = this (for non-static) or null for static
-    // index 3 = var arg table
-
-    int nargs = lsr_vector_get_length(L, 3);
-
-    lua_rawgeti(L, 3, LSINDEXVECTOR);
-    lua_replace(L, 3);
-
     if (!isStatic())
     {
         // get method from instance
         lua_pushnumber(L, ordinal);
-        lua_gettable(L, 2);
+        lua_gettable(L, thisIdx);
     }
     else
     {
@@ -123,14 +114,28 @@ int MethodInfo::_invoke(lua_State *L)
         lua_gettable(L, -2);
         lua_remove(L, -2);
     }
+}
+
+
+int MethodInfo::_invoke(lua_State *L)
+{
+    // index 1 = MethodInfo
+    // index 2 = this (for non-static) or null for static
+    // index 3 = var arg table, or the arguments Vector for invokeWithArgs
+
+    int nargs = lsr_vector_get_length(L, 3);
+
+    lua_rawgeti(L, 3, LSINDEXVECTOR);
+    lua_replace(L, 3);
+
+    pushCallable(L, 2);
 
     // replace MethodInfo with function
     lua_replace(L, 1);
 
     for (int i = 0; i < nargs; i++)
     {
-        lua_pushnumber(L, i);
-        lua_gettable(L, 3);
+        lua_rawgeti(L, 3, i);
     }
 
     // varargs
@@ -152,20 +157,7 @@ int MethodInfo::_invokeSingle(lua_State *L)
     // index 2 = this (for non-static) or null for static
     // index 3 = arg
 
-    if (!isStatic())
-    {
-        // get method from instance
-        lua_pushnumber(L, ordinal);
-        lua_gettable(L, 2);
-    }
-    else
-    {
-        // get method from class table
-        lsr_getclasstable(L, getDeclaringType());
-        lua_pushnumber(L, ordinal);
-        lua_gettable(L, -2);
-        lua_remove(L, -2);
-    }
+    pushCallable(L, 2);
 
     // replace MethodInfo with function
     lua_replace(L, 1);
@@ -402,6 +402,10 @@ public:
         this->returnType = returnType;
     }
 
+    // Pushes the method to call, bound to the object at thisIdx, which
+    // is cached to the instance, or from the class table when static
+    void pushCallable(lua_State *L, int thisIdx);
+
     int _invoke(lua_State *L);
     int _invokeSingle(lua_State *L);
 
@@ -18,6 +18,7 @@
  * ===========================================================================
  */
 
+#include "loom/script/runtime/lsLuaState.h"
 #include "loom/script/reflection/lsPropertyInfo.h"
 #include "loom/script/reflection/lsMethodInfo.h"
 
@@ -130,4 +131,44 @@ MethodInfo *PropertyInfo::getSetMethod()
 
     return setter;
 }
+
+
+int PropertyInfo::_getValue(lua_State *L)
+{
+    // index 1 = PropertyInfo
+    // index 2 = this (for non-static) or null for static
+
+    MethodInfo *method = getGetMethod();
+
+    if (!method)
+    {
+        return luaL_error(L, "Property %s has no getter", getFullMemberName());
+    }
+
+    method->pushCallable(L, 2);
+    lua_call(L, 0, 1);
+
+    return 1;
+}
+
+
+int PropertyInfo::_setValue(lua_State *L)
+{
+    // index 1 = PropertyInfo
+    // index 2 = this (for non-static) or null for static
+    // index 3 = value
+
+    MethodInfo *method = getSetMethod();
+
+    if (!method)
+    {
+        return luaL_error(L, "Property %s has no setter", getFullMemberName());
+    }
+
+    method->pushCallable(L, 2);
+    lua_pushvalue(L, 3);
+    lua_call(L, 1, 0);
+
+    return 0;
+}
 }
@@ -21,6 +21,7 @@
 #ifndef _lspropertyinfo_h
 #define _lspropertyinfo_h
 
+#include "lua.h"
 #include "loom/script/reflection/lsMemberInfo.h"
 
 namespace LS {
@@ -98,9 +99,10 @@ public:
     MethodInfo *getter;
     MethodInfo *setter;
 
-    // invoke
-    Object *getValue();
-    void setValue(Object *othis, Object *value);
+    // Calls the getter or setter on an object, straight through the
+    // method it resolves to rather than invoke with its argument Vector
+    int _getValue(lua_State *L);
+    int _setValue(lua_State *L);
 
     bool isDefined(Type *attributeType, bool inherit)
     {
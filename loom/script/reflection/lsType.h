@@ -142,6 +142,9 @@ private:
 
     bool _isNativeMemberPure, _isNativeMemberPure_cached;
 
+    bool _isPooled, _isPooled_cached;
+    int  poolMax;
+
     ConstructorInfo *cachedConstructor;
 
 public:
@@ -179,6 +182,7 @@ public:
         _isVector(false), _isDictionary(false), _isVector_Cached(false), _isDictionary_Cached(false),
         nativeBaseType(NULL), nativeBaseType_cached(false),
         _isNativeMemberPure(false), _isNativeMemberPure_cached(false),
+        _isPooled(false), _isPooled_cached(false), poolMax(0),
         cachedConstructor(NULL)
     {
     }
@@ -219,6 +223,35 @@ public:
         return nativeBaseType;
     }
 
+    // Whether released instances of this type are recycled on creation,
+    // set by [Pooled] metadata on script classes, optionally with a max
+    // count of instances kept in the pool, ie. [Pooled(max=256)]
+    bool isPooled()
+    {
+        if (!_isPooled_cached)
+        {
+            MetaInfo *meta = getMetaInfo("Pooled");
+
+            // native backed instances own C++ state that can't be recycled
+            if (meta && !getNativeBaseType() && !isVector() && !isDictionary())
+            {
+                const char *max = meta->getAttribute("max");
+                poolMax   = max ? atoi(max) : 1024;
+                _isPooled = poolMax > 0;
+            }
+
+            _isPooled_cached = true;
+        }
+
+        return _isPooled;
+    }
+
+    // Max number of released instances kept for reuse, valid if pooled
+    inline int getPoolMax()
+    {
+        return isPooled() ? poolMax : 0;
+    }
+
     void freeByteCode();
 
     void findMembers(const MemberTypes& memberTypes, utArray<MemberInfo *>& membersOut,
@@ -201,7 +201,11 @@ void lualoom_newscriptinstance_internal(lua_State *L, Type *type)
     //
     // i.e. Member table allocation, properties included!
     //          * methods sold separately
-    lua_createtable(L, 0, type->getPropertyInfoCount());
+    //
+    // The class, type and native slots set on creation are reserved too,
+    // so short lived instances like native Rectangle/Matrix temporaries
+    // don't rehash their table while they're being set up.
+    lua_createtable(L, 0, type->getPropertyInfoCount() + (type->getNativeBaseType() ? 3 : 2));
 
     int instanceIdx = lua_gettop(L);
     lsr_getclasstable(L, type);
@@ -226,6 +230,243 @@ void lualoom_newscriptinstance_internal(lua_State *L, Type *type)
     lua_setmetatable(L, instanceIdx);
 }
 
+// Pops a released instance of a [Pooled] type off its class' pool and
+// pushes it ready to be initialized, returns false if the pool is empty
+static bool lsr_poolacquire(lua_State *L, Type *type)
+{
+    lsr_getclasstable(L, type);
+    lua_rawgeti(L, -1, LSINDEXPOOL);
+
+    int count = lua_istable(L, -1) ? (int)lua_objlen(L, -1) : 0;
+
+    if (!count)
+    {
+        lua_pop(L, 2);
+        return false;
+    }
+
+    lua_rawgeti(L, -1, count);
+    lua_pushnil(L);
+    lua_rawseti(L, -3, count);
+
+    luaL_getmetatable(L, LSINSTANCE);
+    lua_setmetatable(L, -2);
+
+    // leave only the instance
+    lua_replace(L, -3);
+    lua_pop(L, 1);
+
+    return true;
+}
+
+
+void lualoom_poolrelease(lua_State *L, int index)
+{
+    index = lua_absindex(L, index);
+
+    lua_getmetatable(L, index);
+    luaL_getmetatable(L, LSRELEASEDPOOLED);
+    bool released = lua_rawequal(L, -1, -2) != 0;
+    lua_pop(L, 2);
+
+    lmAssert(!released, "Instance released twice");
+
+    lua_rawgeti(L, index, LSINDEXTYPE);
+    Type *type = (Type *)lua_topointer(L, -1);
+    lua_pop(L, 1);
+
+    lmAssert(type && type->isPooled(), "release() called on instance of '%s' which is not [Pooled]",
+             type ? type->getFullName().c_str() : "(unknown)");
+
+    // Drop all state but the class and type so the instance initializer and
+    // constructor see the instance as new when it is reused, field values
+    // and cached methods included.
+    lua_pushnil(L);
+    while (lua_next(L, index))
+    {
+        lua_pop(L, 1);
+
+        if (lua_type(L, -1) == LUA_TNUMBER)
+        {
+            int key = (int)lua_tonumber(L, -1);
+            if ((key == LSINDEXCLASS) || (key == LSINDEXTYPE))
+            {
+                continue;
+            }
+        }
+
+        lua_pushvalue(L, -1);
+        lua_pushnil(L);
+        lua_rawset(L, index);
+    }
+
+    // any (non-raw) access until reused is an error
+    luaL_getmetatable(L, LSRELEASEDPOOLED);
+    lua_setmetatable(L, index);
+
+    lua_rawgeti(L, index, LSINDEXCLASS);
+    lua_rawgeti(L, -1, LSINDEXPOOL);
+
+    if (lua_isnil(L, -1))
+    {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_rawseti(L, -3, LSINDEXPOOL);
+    }
+
+    // past the max the instance is left to the GC, still marked released
+    int count = (int)lua_objlen(L, -1);
+    if (count < type->getPoolMax())
+    {
+        lua_pushvalue(L, index);
+        lua_rawseti(L, -2, count + 1);
+    }
+
+    lua_pop(L, 2);
+}
+
+
+// Upvalues of a class' __call closure, what constructing an instance of
+// the type needs is looked up once and kept here rather than per instance
+enum
+{
+    LSCREATE_TYPE = 1,    // Type*
+    LSCREATE_CLASS,       // class table
+    LSCREATE_METATABLE,   // instance metatable
+    LSCREATE_NATIVECLASS, // bridge class of the native base, nil until first used
+    LSCREATE_TEMPLATE     // field defaults, nil until built, false if there are none
+};
+
+static int lsr_templateguard(lua_State *L)
+{
+    return luaL_error(L, "instance initializer is not constant");
+}
+
+
+// Instance initializers that only store constants into fields always give
+// the same defaults, so they are taken once per type and copied into new
+// instances before the constructor runs. The initializers of the type's
+// chain are run on a scratch table, in an environment where any global
+// access raises an error, as does reading a field the chain didn't set
+// itself. An initializer that calls, creates or reads anything so fails
+// before it can have a side effect and the type gets no template.
+//
+// Pushes the defaults as a flat { ordinal, value, ... } array, false if
+// the type has none, or nil if its initializers aren't loaded yet.
+static void lsr_buildinstancetemplate(lua_State *L, Type *type)
+{
+    int top = lua_gettop(L);
+
+    lua_newtable(L);
+    int scratchIdx = lua_gettop(L);
+
+    lua_newtable(L);
+    lua_pushcfunction(L, lsr_templateguard);
+    lua_setfield(L, -2, "__index");
+    lua_setmetatable(L, scratchIdx);
+
+    lua_newtable(L);
+    int envIdx = lua_gettop(L);
+
+    lua_newtable(L);
+    lua_pushcfunction(L, lsr_templateguard);
+    lua_setfield(L, -2, "__index");
+    lua_pushcfunction(L, lsr_templateguard);
+    lua_setfield(L, -2, "__newindex");
+    lua_setmetatable(L, envIdx);
+
+    utStack<Type *> types;
+
+    for (Type *t = type; t; t = t->getBaseType())
+    {
+        if (t->hasInstanceInitializer())
+        {
+            types.push(t);
+        }
+    }
+
+    bool constant = true;
+
+    while (constant && types.size())
+    {
+        Type *t = types.pop();
+
+        lsr_getclasstable(L, t);
+        lua_pushstring(L, "__ls_instanceinitializer");
+        lua_rawget(L, -2);
+
+        if (!lua_isfunction(L, -1))
+        {
+            // still being loaded, try again on the next instance
+            lua_settop(L, top);
+            lua_pushnil(L);
+            return;
+        }
+
+        int initIdx = lua_gettop(L);
+
+        lua_pushvalue(L, envIdx);
+        lua_setfenv(L, initIdx);
+
+        lua_pushvalue(L, initIdx);
+        lua_pushvalue(L, scratchIdx);
+        constant = lua_pcall(L, 1, 0, 0) == 0;
+
+        // initializers run in their class table
+        lua_pushvalue(L, initIdx - 1);
+        lua_setfenv(L, initIdx);
+
+        lua_settop(L, envIdx);
+    }
+
+    // only plain script fields, native ones live on the native instance
+    // and objects would end up shared by all instances
+    int count = 0;
+
+    if (constant)
+    {
+        lua_newtable(L);
+
+        lua_pushnil(L);
+        while (lua_next(L, scratchIdx))
+        {
+            int vtype = lua_type(L, -1);
+
+            if (!lua_isnumber(L, -2) || ((vtype != LUA_TNUMBER) && (vtype != LUA_TSTRING) && (vtype != LUA_TBOOLEAN)))
+            {
+                constant = false;
+                lua_pop(L, 2);
+                break;
+            }
+
+            MemberInfo *mi = type->getMemberInfoByOrdinal((int)lua_tonumber(L, -2));
+
+            if (!mi || !mi->isField() || mi->isNative())
+            {
+                constant = false;
+                lua_pop(L, 2);
+                break;
+            }
+
+            lua_pushvalue(L, -2);
+            lua_rawseti(L, envIdx + 1, ++count);
+            lua_rawseti(L, envIdx + 1, ++count);
+        }
+    }
+
+    if (!constant || !count)
+    {
+        lua_settop(L, top);
+        lua_pushboolean(L, 0);
+        return;
+    }
+
+    lua_replace(L, top + 1);
+    lua_settop(L, top + 1);
+}
+
+
 // class instance creator
 static int lsr_classcreateinstance(lua_State *L)
 {
@@ -237,7 +478,7 @@ static int lsr_classcreateinstance(lua_State *L)
     int nargs = lua_gettop(L) - 1;
 
     // index 1 on stack is class table
-    Type *type = (Type *)lua_topointer(L, lua_upvalueindex(1));
+    Type *type = (Type *)lua_topointer(L, lua_upvalueindex(LSCREATE_TYPE));
 
     CTOR_LOG("Creating instance: %s", type->getFullName().c_str());
 
@@ -251,10 +492,49 @@ static int lsr_classcreateinstance(lua_State *L)
         memoryBeforeB = lua_gc(L, LUA_GCCOUNTB, 0);
     }
 
-    // Allocate the Lua-side instance.
-    lualoom_newscriptinstance_internal(L, type);
+    // Allocate the Lua-side instance, or reuse a released one if pooled,
+    // as lualoom_newscriptinstance_internal does with the cached upvalues.
+    if (!type->isPooled() || !lsr_poolacquire(L, type))
+    {
+        lua_createtable(L, 0, type->getPropertyInfoCount() + (type->getNativeBaseType() ? 3 : 2));
+
+        lua_pushvalue(L, lua_upvalueindex(LSCREATE_CLASS));
+        lua_rawseti(L, -2, LSINDEXCLASS);
+
+        lua_pushlightuserdata(L, type);
+        lua_rawseti(L, -2, LSINDEXTYPE);
+
+        lua_pushvalue(L, lua_upvalueindex(LSCREATE_METATABLE));
+        lua_setmetatable(L, -2);
+    }
     const int instanceIdx = lua_gettop(L);
 
+    // Fill in the constant field defaults, the constructor still assigns
+    // them but now finds the keys present and skips __newindex.
+    if (lua_isnil(L, lua_upvalueindex(LSCREATE_TEMPLATE)))
+    {
+        lsr_buildinstancetemplate(L, type);
+        if (!lua_isnil(L, -1))
+        {
+            lua_pushvalue(L, -1);
+            lua_replace(L, lua_upvalueindex(LSCREATE_TEMPLATE));
+        }
+        lua_pop(L, 1);
+    }
+
+    if (lua_istable(L, lua_upvalueindex(LSCREATE_TEMPLATE)))
+    {
+        const int templateIdx = lua_upvalueindex(LSCREATE_TEMPLATE);
+        const int count       = (int)lua_objlen(L, templateIdx);
+
+        for (int i = 1; i < count; i += 2)
+        {
+            lua_rawgeti(L, templateIdx, i);
+            lua_rawgeti(L, templateIdx, i + 1);
+            lua_rawset(L, instanceIdx);
+        }
+    }
+
     if (profiling)
     {
         MethodBase *methodBase = LSProfiler::registerAllocation(type);
@@ -276,9 +556,39 @@ static int lsr_classcreateinstance(lua_State *L)
         CTOR_LOG("   o creating native: %s", nt->getFullName().c_str());
 
         int ntop = lua_gettop(L);
-        lua_getglobal(L, "__ls_nativeclasses");
-        lua_getfield(L, -1, nt->getPackageName().c_str());
-        lua_getfield(L, -1, nt->getName());
+
+        // the bridge class is kept in an upvalue once found, before that
+        // it is looked up by Type* as cached in lsr_classinitializenative
+        // or failing that by name
+        lua_pushvalue(L, lua_upvalueindex(LSCREATE_NATIVECLASS));
+
+        if (lua_isnil(L, -1))
+        {
+            lua_getglobal(L, "__ls_nativeclasses");
+            lua_pushlightuserdata(L, nt);
+            lua_rawget(L, -2);
+
+            if (lua_isnil(L, -1))
+            {
+                lua_pop(L, 1);
+                lua_getfield(L, -1, nt->getPackageName().c_str());
+                if (!lua_isnil(L, -1))
+                {
+                    lua_getfield(L, -1, nt->getName());
+                    lua_replace(L, -2);
+                }
+            }
+
+            if (!lua_isnil(L, -1))
+            {
+                lua_pushvalue(L, -1);
+                lua_replace(L, lua_upvalueindex(LSCREATE_NATIVECLASS));
+            }
+
+            lua_replace(L, ntop + 1);
+            lua_settop(L, ntop + 1);
+        }
+
         int _nargs = nargs;
 
         // Prep args for calling the native constructor.
@@ -631,10 +941,37 @@ void lsr_declareclass(lua_State *L, Type *type)
     lua_pushlightuserdata(L, ls);
     lua_settable(L, clsIdx);
 
-    // store call
+    // store call, with the upvalues listed at lsr_classcreateinstance
     lua_pushstring(L, "__call");
     lua_pushlightuserdata(L, type);
-    lua_pushcclosure(L, lsr_classcreateinstance, 1);
+    lua_pushvalue(L, clsIdx);
+
+    if (type->isDictionary())
+    {
+        luaL_getmetatable(L, LSDICTIONARY);
+    }
+    else if (type->isVector())
+    {
+        luaL_getmetatable(L, LSVECTOR);
+    }
+    else
+    {
+        luaL_getmetatable(L, LSINSTANCE);
+    }
+
+    lua_pushnil(L);
+
+    // dictionaries and vectors set up their own contents
+    if (type->isDictionary() || type->isVector())
+    {
+        lua_pushboolean(L, 0);
+    }
+    else
+    {
+        lua_pushnil(L);
+    }
+
+    lua_pushcclosure(L, lsr_classcreateinstance, LSCREATE_TEMPLATE);
     lua_rawset(L, mtidx);
 
     lua_pushstring(L, "__index");
@@ -706,6 +1043,10 @@ static void lsr_classimportluasymbols(lua_State *L, int index)
     lua_getglobal(L, "pairs");
     lua_rawset(L, index);
 
+    lua_pushstring(L, "__lua_next");
+    lua_getglobal(L, "next");
+    lua_rawset(L, index);
+
     lua_pushstring(L, "__lua_ipairs");
     lua_pushcfunction(L, loomscript_ipairsaux);
     lua_pushcclosure(L, loomscript_ipairs, 1);
@@ -804,6 +1145,48 @@ static void lsr_classimportsymbols(lua_State *L, Type *type, int index)
 }
 
 
+#ifdef LOOM_ENABLE_JIT
+// Replaces the native closure on top of the stack by an FFI function pointer
+// when it was bound with addStaticMethodFFI, so compiled traces can call it
+// directly. The closure stays when the FFI is unavailable.
+static void lsr_pushffimethod(lua_State *L)
+{
+    int top = lua_gettop(L);
+
+    if (!lua_iscfunction(L, top) || !lua_getupvalue(L, top, 3))
+    {
+        return;
+    }
+
+    if (!lua_islightuserdata(L, -1) || !lua_getupvalue(L, top, 4) || !lua_isstring(L, -1))
+    {
+        lua_settop(L, top);
+        return;
+    }
+
+    int fpIdx   = top + 1;
+    int declIdx = top + 2;
+
+    lua_getfield(L, LUA_REGISTRYINDEX, "_LOADED");
+    lua_getfield(L, -1, "ffi");
+
+    if (lua_istable(L, -1))
+    {
+        lua_getfield(L, -1, "cast");
+        lua_pushvalue(L, declIdx);
+        lua_pushvalue(L, fpIdx);
+
+        if (!lua_pcall(L, 2, 1, 0))
+        {
+            lua_replace(L, top);
+        }
+    }
+
+    lua_settop(L, top);
+}
+#endif
+
+
 static void lsr_classinitializemethod(lua_State *L, MethodBase *methodBase, int index)
 {
     int top = lua_gettop(L);
@@ -838,6 +1221,13 @@ static void lsr_classinitializemethod(lua_State *L, MethodBase *methodBase, int
             {
                 LSError("Native Method resolution error: %s", methodBase->getStringSignature().c_str());
             }
+
+#ifdef LOOM_ENABLE_JIT
+            if (methodBase->isStatic())
+            {
+                lsr_pushffimethod(L);
+            }
+#endif
         }
     }
     else
@@ -0,0 +1,909 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "loom/common/assets/assets.h"
+#include "loom/common/core/allocator.h"
+#include "loom/common/core/log.h"
+#include "loom/common/platform/platformTime.h"
+#include "loom/common/utils/fourcc.h"
+#include "loom/common/utils/json.h"
+#include "loom/common/utils/utByteArray.h"
+#include "loom/script/loomscript.h"
+#include "loom/script/runtime/lsRuntime.h"
+#include "loom/script/runtime/lsHeapSnapshot.h"
+
+namespace LS {
+static loom_logGroup_t gHeapSnapshotLogGroup = { "heap", 1 };
+
+// Classes of objects that aren't script instances or bridged userdata
+enum HeapBasicClass
+{
+    HeapClassString,
+    HeapClassTable,
+    HeapClassFunction,
+    HeapClassUserdata,
+    HeapClassThread,
+    HeapBasicClassCount
+};
+
+static const char *heapBasicClassNames[HeapBasicClassCount] =
+{
+    "<string>", "<table>", "<function>", "<userdata>", "<thread>"
+};
+
+// How an object was first reached from its parent
+enum HeapEdgeKind
+{
+    HeapEdgeRoot,
+    HeapEdgeField,
+    HeapEdgeIndex,
+    HeapEdgeKey,
+    HeapEdgeValue,
+    HeapEdgeMetatable,
+    HeapEdgeUpvalue,
+    HeapEdgeLocal,
+    HeapEdgeEnvironment
+};
+
+// Paths deeper than this are cut short
+static const int heapMaxPathDepth = 64;
+
+struct HeapNode
+{
+    int           parent;
+    int           classIndex;
+    unsigned int  size;
+    unsigned char type;
+    unsigned char edgeKind;
+
+    // The field or upvalue name interned by Lua, or the index
+    union
+    {
+        const char *name;
+        double     index;
+    }
+    edge;
+};
+
+/*
+ * Breadth first walk over the object graph. The objects waiting for their
+ * references to be walked are kept in a Lua table at their node index so
+ * they stay on hand, visited is keyed by the object address and gives the
+ * node index, which is also the order in which objects were reached.
+ */
+struct HeapWalker
+{
+    lua_State                              *L;
+    HeapSnapshot                           *snapshot;
+    int                                    queue;
+
+    utFlatHashTable<utPointerHashKey, int> visited;
+    utFlatHashTable<utPointerHashKey, int> classLookup;
+    utArray<HeapNode>                      nodes;
+
+    HeapWalker(lua_State *_L, HeapSnapshot *_snapshot) : L(_L), snapshot(_snapshot), queue(0) {}
+
+    int classFor(const void *key, const char *name)
+    {
+        int *index = classLookup.get(utPointerHashKey((void *)key));
+
+        if (index)
+        {
+            return *index;
+        }
+
+        HeapSnapshot::ClassStats stats;
+        stats.name         = name;
+        stats.count        = 0;
+        stats.size         = 0;
+        stats.retainedSize = 0;
+
+        int classIndex = (int)snapshot->classes.size();
+        snapshot->classes.push_back(stats);
+        classLookup.insert(utPointerHashKey((void *)key), classIndex);
+
+        return classIndex;
+    }
+
+    int classify(int index, int type)
+    {
+        int classIndex = -1;
+
+        if (type == LUA_TTABLE)
+        {
+            // Script instances point to their class table, the class table
+            // itself carries the Type too but is left a plain table
+            lua_rawgeti(L, index, LSINDEXTYPE);
+            lua_rawgeti(L, index, LSINDEXCLASS);
+
+            if (lua_islightuserdata(L, -2) && lua_istable(L, -1))
+            {
+                Type *t = (Type *)lua_topointer(L, -2);
+                classIndex = classFor(t, t->getFullName().c_str());
+            }
+
+            lua_pop(L, 2);
+        }
+        else if (type == LUA_TUSERDATA && lua_getmetatable(L, index))
+        {
+            lua_rawgeti(L, -1, LSINDEXBRIDGE_TYPE);
+
+            if (lua_type(L, -1) == LUA_TSTRING)
+            {
+                // The name is interned, its address identifies the class
+                const char *name = lua_tostring(L, -1);
+                classIndex = classFor(name, name);
+            }
+
+            lua_pop(L, 2);
+        }
+
+        if (classIndex != -1)
+        {
+            return classIndex;
+        }
+
+        switch (type)
+        {
+        case LUA_TSTRING:
+            return HeapClassString;
+
+        case LUA_TTABLE:
+            return HeapClassTable;
+
+        case LUA_TFUNCTION:
+            return HeapClassFunction;
+
+        case LUA_TUSERDATA:
+            return HeapClassUserdata;
+
+        default:
+            return HeapClassThread;
+        }
+    }
+
+    // The bytes the object itself takes, not counting what it references
+    unsigned int sizeOf(int index, int type)
+    {
+        switch (type)
+        {
+#ifdef LOOM_ENABLE_JIT
+        case LUA_TSTRING:
+            return (unsigned int)(sizeof(GCstr) + lua_objlen(L, index) + 1);
+
+        case LUA_TTABLE:
+        {
+            const GCtab *t = (const GCtab *)lua_topointer(L, index);
+            return (unsigned int)(sizeof(GCtab) + t->asize * sizeof(TValue) + (t->hmask ? (t->hmask + 1) * sizeof(Node) : 0));
+        }
+
+        case LUA_TFUNCTION:
+            return (unsigned int)sizeof(GCfunc);
+
+        case LUA_TUSERDATA:
+            return (unsigned int)(sizeof(GCudata) + lua_objlen(L, index));
+#else
+        case LUA_TSTRING:
+            return (unsigned int)(sizeof(TString) + lua_objlen(L, index) + 1);
+
+        case LUA_TTABLE:
+        {
+            const Table *t = (const Table *)lua_topointer(L, index);
+            return (unsigned int)(sizeof(Table) + t->sizearray * sizeof(TValue) + sizenode(t) * sizeof(Node));
+        }
+
+        case LUA_TFUNCTION:
+            return (unsigned int)sizeof(Closure);
+
+        case LUA_TUSERDATA:
+            return (unsigned int)(sizeof(Udata) + lua_objlen(L, index));
+#endif
+        default:
+            return (unsigned int)sizeof(lua_State);
+        }
+    }
+
+    // Records the value at index reached through an edge of parent,
+    // queueing it for a walk of its references the first time it's seen
+    void visit(int index, int parent, int edgeKind, const char *name, double number)
+    {
+        int        type = lua_type(L, index);
+        const void *address;
+
+        switch (type)
+        {
+        case LUA_TSTRING:
+            // Strings are interned, so the characters identify them
+            address = lua_tostring(L, index);
+            break;
+
+        case LUA_TTABLE:
+        case LUA_TFUNCTION:
+        case LUA_TUSERDATA:
+        case LUA_TTHREAD:
+            address = lua_topointer(L, index);
+            break;
+
+        default:
+            return;
+        }
+
+        int nodeIndex = (int)nodes.size();
+
+        if (!visited.insert(utPointerHashKey((void *)address), nodeIndex))
+        {
+            return;
+        }
+
+        HeapNode node;
+        node.parent     = parent;
+        node.classIndex = classify(index, type);
+        node.size       = sizeOf(index, type);
+        node.type       = (unsigned char)type;
+        node.edgeKind   = (unsigned char)edgeKind;
+
+        if (edgeKind == HeapEdgeIndex)
+        {
+            node.edge.index = number;
+        }
+        else
+        {
+            node.edge.name = name;
+        }
+
+        nodes.push_back(node);
+
+        if (type != LUA_TSTRING)
+        {
+            lua_pushvalue(L, index);
+            lua_rawseti(L, queue, nodeIndex + 1);
+        }
+    }
+
+    // Names the runtime slots of script instances
+    static const char *slotName(double key)
+    {
+        switch ((int)key)
+        {
+        case LSINDEXNATIVE:
+            return "<native>";
+
+        case LSINDEXVECTOR:
+            return "<vector>";
+
+        case LSINDEXDICTPAIRS:
+            return "<pairs>";
+
+        case LSINDEXCLASS:
+            return "<class>";
+
+        case LSINDEXGCTRACKER:
+            return "<gctracker>";
+        }
+
+        return NULL;
+    }
+
+    void walkTable(int object, int nodeIndex)
+    {
+        bool weakKeys   = false;
+        bool weakValues = false;
+
+        if (lua_getmetatable(L, object))
+        {
+            int metatable = lua_gettop(L);
+
+            lua_pushstring(L, "__mode");
+            lua_rawget(L, metatable);
+
+            if (lua_type(L, -1) == LUA_TSTRING)
+            {
+                const char *mode = lua_tostring(L, -1);
+                weakKeys   = strchr(mode, 'k') != NULL;
+                weakValues = strchr(mode, 'v') != NULL;
+            }
+
+            lua_pop(L, 1);
+
+            visit(metatable, nodeIndex, HeapEdgeMetatable, NULL, 0);
+            lua_pop(L, 1);
+        }
+
+        // Script instances keep their fields at member ordinals
+        Type *type = NULL;
+
+        if (nodes[nodeIndex].classIndex >= HeapBasicClassCount)
+        {
+            lua_rawgeti(L, object, LSINDEXTYPE);
+            type = (Type *)lua_topointer(L, -1);
+            lua_pop(L, 1);
+        }
+
+        lua_pushnil(L);
+
+        while (lua_next(L, object))
+        {
+            int key   = lua_gettop(L) - 1;
+            int value = key + 1;
+
+            if (!weakKeys)
+            {
+                visit(key, nodeIndex, HeapEdgeKey, NULL, 0);
+            }
+
+            if (!weakValues)
+            {
+                switch (lua_type(L, key))
+                {
+                case LUA_TSTRING:
+                    visit(value, nodeIndex, HeapEdgeField, lua_tostring(L, key), 0);
+                    break;
+
+                case LUA_TNUMBER:
+                {
+                    double     number = lua_tonumber(L, key);
+                    const char *name  = slotName(number);
+
+                    if (!name && type && number > 0)
+                    {
+                        MemberInfo *mi = type->getMemberInfoByOrdinal((int)number);
+                        name = mi ? mi->getName() : NULL;
+                    }
+
+                    if (name)
+                    {
+                        visit(value, nodeIndex, HeapEdgeField, name, 0);
+                    }
+                    else
+                    {
+                        visit(value, nodeIndex, HeapEdgeIndex, NULL, number);
+                    }
+                    break;
+                }
+
+                default:
+                    visit(value, nodeIndex, HeapEdgeValue, NULL, 0);
+                }
+            }
+
+            lua_pop(L, 1);
+        }
+    }
+
+    void walkFunction(int object, int nodeIndex)
+    {
+        for (int n = 1; ; n++)
+        {
+            const char *name = lua_getupvalue(L, object, n);
+
+            if (!name)
+            {
+                break;
+            }
+
+            // C function upvalues have no names
+            visit(lua_gettop(L), nodeIndex, HeapEdgeUpvalue, *name ? name : NULL, 0);
+            lua_pop(L, 1);
+        }
+
+        lua_getfenv(L, object);
+        visit(lua_gettop(L), nodeIndex, HeapEdgeEnvironment, NULL, 0);
+        lua_pop(L, 1);
+    }
+
+    void walkUserdata(int object, int nodeIndex)
+    {
+        if (lua_getmetatable(L, object))
+        {
+            visit(lua_gettop(L), nodeIndex, HeapEdgeMetatable, NULL, 0);
+            lua_pop(L, 1);
+        }
+
+        lua_getfenv(L, object);
+        visit(lua_gettop(L), nodeIndex, HeapEdgeEnvironment, NULL, 0);
+        lua_pop(L, 1);
+    }
+
+    void walkThread(int object, int nodeIndex)
+    {
+        lua_State *thread = lua_tothread(L, object);
+        lua_Debug ar;
+
+        for (int level = 0; lua_getstack(thread, level, &ar); level++)
+        {
+            // C frames have no named locals, only temporaries, and one of
+            // them is the walk itself
+            lua_getinfo(thread, "S", &ar);
+
+            if (!strcmp(ar.what, "C"))
+            {
+                continue;
+            }
+
+            for (int n = 1; ; n++)
+            {
+                const char *name = lua_getlocal(thread, &ar, n);
+
+                if (!name)
+                {
+                    break;
+                }
+
+                if (thread != L)
+                {
+                    lua_xmove(thread, L, 1);
+                }
+
+                visit(lua_gettop(L), nodeIndex, HeapEdgeLocal, name, 0);
+                lua_pop(L, 1);
+            }
+        }
+
+        lua_getfenv(L, object);
+        visit(lua_gettop(L), nodeIndex, HeapEdgeEnvironment, NULL, 0);
+        lua_pop(L, 1);
+    }
+
+    void walk()
+    {
+        for (UTsize i = 0; i < nodes.size(); i++)
+        {
+            int type = nodes[i].type;
+
+            if (type == LUA_TSTRING)
+            {
+                continue;
+            }
+
+            lua_rawgeti(L, queue, (int)i + 1);
+            int object = lua_gettop(L);
+
+            switch (type)
+            {
+            case LUA_TTABLE:
+                walkTable(object, (int)i);
+                break;
+
+            case LUA_TFUNCTION:
+                walkFunction(object, (int)i);
+                break;
+
+            case LUA_TUSERDATA:
+                walkUserdata(object, (int)i);
+                break;
+
+            case LUA_TTHREAD:
+                walkThread(object, (int)i);
+                break;
+            }
+
+            lua_settop(L, object - 1);
+        }
+    }
+
+    void appendEdge(utString& path, const HeapNode& node)
+    {
+        char buffer[64];
+
+        switch (node.edgeKind)
+        {
+        case HeapEdgeRoot:
+        case HeapEdgeField:
+            if (path.size() > 0)
+            {
+                path += ".";
+            }
+            path += node.edge.name;
+            break;
+
+        case HeapEdgeIndex:
+            snprintf(buffer, sizeof(buffer), "[%.14g]", node.edge.index);
+            path += buffer;
+            break;
+
+        case HeapEdgeKey:
+            path += ".<key>";
+            break;
+
+        case HeapEdgeValue:
+            path += "[<object>]";
+            break;
+
+        case HeapEdgeMetatable:
+            path += ".<metatable>";
+            break;
+
+        case HeapEdgeUpvalue:
+            path += ".<upvalue ";
+            path += node.edge.name ? node.edge.name : "?";
+            path += ">";
+            break;
+
+        case HeapEdgeLocal:
+            path += ".<local ";
+            path += node.edge.name;
+            path += ">";
+            break;
+
+        case HeapEdgeEnvironment:
+            path += ".<env>";
+            break;
+        }
+    }
+
+    // The chain of edges from a root down to the node, the edge names are
+    // still alive as the collector hasn't run since the walk
+    utString pathTo(int nodeIndex)
+    {
+        int chain[heapMaxPathDepth];
+        int depth = 0;
+
+        while (nodeIndex != -1 && depth < heapMaxPathDepth)
+        {
+            chain[depth++] = nodeIndex;
+            nodeIndex      = nodes[nodeIndex].parent;
+        }
+
+        utString path = nodeIndex != -1 ? "..." : "";
+
+        for (int i = depth - 1; i >= 0; i--)
+        {
+            appendEdge(path, nodes[chain[i]]);
+        }
+
+        return path;
+    }
+
+    void summarize()
+    {
+        utArray<HeapSnapshot::ClassStats>& classes = snapshot->classes;
+
+        utArray<int> firstNode;
+        firstNode.resize(classes.size());
+
+        for (UTsize c = 0; c < classes.size(); c++)
+        {
+            firstNode[c] = -1;
+        }
+
+        int nodeCount = (int)nodes.size();
+
+        // Children always come after their parent in the walk, so going
+        // backwards each subtree is complete before it's added to its parent
+        utArray<double> retained;
+        utArray<int>    descendants;
+        retained.resize(nodeCount);
+        descendants.resize(nodeCount);
+
+        for (int i = 0; i < nodeCount; i++)
+        {
+            retained[i]    = nodes[i].size;
+            descendants[i] = 0;
+        }
+
+        for (int i = nodeCount - 1; i >= 0; i--)
+        {
+            const HeapNode& node = nodes[i];
+
+            HeapSnapshot::ClassStats& stats = classes[node.classIndex];
+            stats.count++;
+            stats.size += node.size;
+            snapshot->totalSize += node.size;
+
+            if (node.parent != -1)
+            {
+                retained[node.parent]    += retained[i];
+                descendants[node.parent] += descendants[i] + 1;
+            }
+
+            firstNode[node.classIndex] = i;
+        }
+
+        // Lay the tree out depth first, a subtree then spans the positions
+        // after its root, and going forward each position is given to the
+        // next child of its parent
+        utArray<int> position;
+        utArray<int> nextPosition;
+        utArray<int> order;
+        position.resize(nodeCount);
+        nextPosition.resize(nodeCount);
+        order.resize(nodeCount);
+
+        int rootPosition = 0;
+
+        for (int i = 0; i < nodeCount; i++)
+        {
+            int parent = nodes[i].parent;
+
+            if (parent == -1)
+            {
+                position[i]   = rootPosition;
+                rootPosition += descendants[i] + 1;
+            }
+            else
+            {
+                position[i]           = nextPosition[parent];
+                nextPosition[parent] += descendants[i] + 1;
+            }
+
+            nextPosition[i]    = position[i] + 1;
+            order[position[i]] = i;
+        }
+
+        // A class retains the subtrees of its objects that aren't inside
+        // the subtree of another object of the class, those are already
+        // counted, in depth first order the enclosing one is the last
+        // counted one of the class
+        utArray<int> countedEnd;
+        countedEnd.resize(classes.size());
+
+        for (UTsize c = 0; c < classes.size(); c++)
+        {
+            countedEnd[c] = 0;
+        }
+
+        for (int p = 0; p < nodeCount; p++)
+        {
+            int i          = order[p];
+            int classIndex = nodes[i].classIndex;
+
+            if (p >= countedEnd[classIndex])
+            {
+                classes[classIndex].retainedSize += retained[i];
+                countedEnd[classIndex]            = p + descendants[i] + 1;
+            }
+        }
+
+        for (UTsize c = 0; c < classes.size(); c++)
+        {
+            if (firstNode[c] != -1)
+            {
+                classes[c].retainerPath = pathTo(firstNode[c]);
+            }
+        }
+
+        // Drop the basic classes nothing was found of
+        for (int c = (int)classes.size() - 1; c >= 0; c--)
+        {
+            if (classes[c].count == 0)
+            {
+                classes.erase((UTsize)c, true);
+            }
+        }
+
+        snapshot->objectCount = (int)nodes.size();
+    }
+};
+
+void HeapSnapshot::capture(lua_State *L)
+{
+    classes.clear();
+    objectCount = 0;
+    totalSize   = 0;
+
+    loom_precision_timer_t timer = loom_startTimer();
+
+    // The collector is driven by GC.update and kept stopped otherwise,
+    // make sure it is so nothing is freed while the walk holds names
+    lua_gc(L, LUA_GCSTOP, 0);
+
+    int top = lua_gettop(L);
+
+    HeapWalker walker(L, this);
+
+    for (int i = 0; i < HeapBasicClassCount; i++)
+    {
+        walker.classFor(heapBasicClassNames[i], heapBasicClassNames[i]);
+    }
+
+    lua_newtable(L);
+    walker.queue = lua_gettop(L);
+
+    // Globals first so paths go through them rather than _LOADED
+    lua_pushvalue(L, LUA_GLOBALSINDEX);
+    walker.visit(lua_gettop(L), -1, HeapEdgeRoot, "_G", 0);
+    lua_pushvalue(L, LUA_REGISTRYINDEX);
+    walker.visit(lua_gettop(L), -1, HeapEdgeRoot, "registry", 0);
+    lua_pushthread(L);
+    walker.visit(lua_gettop(L), -1, HeapEdgeRoot, "stack", 0);
+    lua_settop(L, walker.queue);
+
+    walker.walk();
+    walker.summarize();
+
+    lua_settop(L, top);
+
+    walkTime = loom_readTimerNano(timer) / 1e6;
+    loom_destroyTimer(timer);
+
+    lmLogDebug(gHeapSnapshotLogGroup, "Heap snapshot of %d objects in %d classes took %.2fms", objectCount, getClassCount(), walkTime);
+}
+
+void HeapSnapshot::diff(HeapSnapshot *older, HeapSnapshot *newer)
+{
+    classes.clear();
+    objectCount = newer->objectCount - older->objectCount;
+    totalSize   = newer->totalSize - older->totalSize;
+    walkTime    = 0;
+
+    utHashTable<utHashedString, int> olderClasses;
+
+    for (UTsize i = 0; i < older->classes.size(); i++)
+    {
+        olderClasses.insert(older->classes[i].name, (int)i);
+    }
+
+    utArray<bool> matched;
+    matched.resize(older->classes.size());
+
+    for (UTsize i = 0; i < matched.size(); i++)
+    {
+        matched[i] = false;
+    }
+
+    for (UTsize i = 0; i < newer->classes.size(); i++)
+    {
+        ClassStats stats = newer->classes[i];
+        int        *index = olderClasses.get(stats.name);
+
+        if (index)
+        {
+            const ClassStats& before = older->classes[*index];
+            matched[*index] = true;
+
+            stats.count        -= before.count;
+            stats.size         -= before.size;
+            stats.retainedSize -= before.retainedSize;
+        }
+
+        if (stats.count != 0 || stats.size != 0)
+        {
+            classes.push_back(stats);
+        }
+    }
+
+    // Classes that are gone altogether
+    for (UTsize i = 0; i < older->classes.size(); i++)
+    {
+        if (matched[i])
+        {
+            continue;
+        }
+
+        ClassStats stats = older->classes[i];
+        stats.count        = -stats.count;
+        stats.size         = -stats.size;
+        stats.retainedSize = -stats.retainedSize;
+        classes.push_back(stats);
+    }
+}
+
+int HeapSnapshot::findClass(const char *name) const
+{
+    for (UTsize i = 0; i < classes.size(); i++)
+    {
+        if (classes[i].name == name)
+        {
+            return (int)i;
+        }
+    }
+
+    return -1;
+}
+
+const char *HeapSnapshot::getClassName(int index) const
+{
+    return validClass(index) ? classes[index].name.c_str() : NULL;
+}
+
+int HeapSnapshot::getCount(int index) const
+{
+    return validClass(index) ? classes[index].count : 0;
+}
+
+double HeapSnapshot::getSize(int index) const
+{
+    return validClass(index) ? classes[index].size : 0;
+}
+
+double HeapSnapshot::getRetainedSize(int index) const
+{
+    return validClass(index) ? classes[index].retainedSize : 0;
+}
+
+const char *HeapSnapshot::getRetainerPath(int index) const
+{
+    return validClass(index) ? classes[index].retainerPath.c_str() : NULL;
+}
+
+const char *HeapSnapshot::serialize()
+{
+    JSON root;
+    root.initObject();
+    root.setInteger("objects", objectCount);
+    root.setNumber("size", totalSize);
+    root.setNumber("time", walkTime);
+
+    JSON list;
+    list.initArray();
+
+    for (UTsize i = 0; i < classes.size(); i++)
+    {
+        const ClassStats& stats = classes[i];
+
+        JSON entry;
+        entry.initObject();
+        entry.setString("name", stats.name.c_str());
+        entry.setInteger("count", stats.count);
+        entry.setNumber("size", stats.size);
+        entry.setNumber("retained", stats.retainedSize);
+        entry.setString("path", stats.retainerPath.c_str());
+
+        list.setArrayObject((int)i, &entry);
+    }
+
+    root.setArray("classes", &list);
+
+    return root.serialize();
+}
+
+int HeapSnapshot::toJSON(lua_State *L)
+{
+    const char *json = serialize();
+
+    lua_pushstring(L, json ? json : "");
+
+    if (json)
+    {
+        lmFree(NULL, (void *)json);
+    }
+
+    return 1;
+}
+
+void HeapSnapshot::send()
+{
+    const char *json = serialize();
+
+    if (!json)
+    {
+        return;
+    }
+
+    // Customized asset protocol message (3 ints + null terminated JSON)
+    utByteArray buffer;
+    buffer.writeInt(0);
+    buffer.writeInt(0xDEADBEEF);
+    buffer.writeInt(LOOM_FOURCC('H', 'E', 'A', 'P'));
+    buffer.writeUTFBytes(json);
+    buffer.writeByte(0);
+
+    lmFree(NULL, (void *)json);
+
+    int sendSize = (int)buffer.getPosition();
+    buffer.setPosition(0);
+    buffer.writeInt(sendSize);
+
+    loom_asset_custom(buffer.getDataPtr(), sendSize);
+}
+}
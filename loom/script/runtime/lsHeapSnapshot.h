@@ -0,0 +1,132 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _ls_heapsnapshot_h
+#define _ls_heapsnapshot_h
+
+#include "loom/common/utils/utString.h"
+#include "loom/common/utils/utTypes.h"
+#include "loom/script/runtime/lsLua.h"
+
+namespace LS {
+/*
+ * A census of the objects reachable from the globals, the registry and the
+ * stacks of a Lua state, grouped by class: the LoomScript Type of script
+ * instances, the bridged class of native userdata and the Lua type of
+ * anything else.
+ *
+ * Each class records how many objects it has, their own size, the size
+ * they keep alive and the path through which the first (closest to a
+ * root) of them was reached, which is where to start looking when a
+ * class leaks. Two snapshots can be diffed to see what a stretch of the
+ * game left behind.
+ *
+ * The retained size is taken over the breadth first tree of the walk,
+ * an object shared by several classes is only retained by the one it
+ * was reached through first.
+ */
+class HeapSnapshot
+{
+public:
+
+    struct ClassStats
+    {
+        utString name;
+        int      count;
+        double   size;
+        double   retainedSize;
+        utString retainerPath;
+    };
+
+    HeapSnapshot() : objectCount(0), totalSize(0), walkTime(0) {}
+
+    // Walks the heap of L, replacing the contents of this snapshot
+    void capture(lua_State *L);
+
+    // Fills this snapshot with the per class changes from older to newer,
+    // classes that didn't change are left out
+    void diff(HeapSnapshot *older, HeapSnapshot *newer);
+
+    // Serializes the snapshot to JSON, free the result with lmFree
+    const char *serialize();
+
+    // Sends the snapshot to the telemetry web UI over the asset protocol
+    void send();
+
+    int take(lua_State *L)
+    {
+        capture(L);
+        return 0;
+    }
+
+    int toJSON(lua_State *L);
+
+    int getClassCount() const
+    {
+        return (int)classes.size();
+    }
+
+    const ClassStats& getClass(int index) const
+    {
+        return classes[index];
+    }
+
+    // Index of the named class, -1 if there are none of it
+    int findClass(const char *name) const;
+
+    const char *getClassName(int index) const;
+    int getCount(int index) const;
+    double getSize(int index) const;
+    double getRetainedSize(int index) const;
+    const char *getRetainerPath(int index) const;
+
+    int getObjectCount() const
+    {
+        return objectCount;
+    }
+
+    double getTotalSize() const
+    {
+        return totalSize;
+    }
+
+    // Milliseconds the capture took
+    double getWalkTime() const
+    {
+        return walkTime;
+    }
+
+private:
+
+    utArray<ClassStats> classes;
+
+    int    objectCount;
+    double totalSize;
+    double walkTime;
+
+    bool validClass(int index) const
+    {
+        return index >= 0 && index < (int)classes.size();
+    }
+
+    friend struct HeapWalker;
+};
+}
+#endif
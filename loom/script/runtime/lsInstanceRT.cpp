@@ -201,6 +201,70 @@ static int lsr_instancenewindex(lua_State *L)
 }
 
 
+// Instances look members up by name only for interface and dynamic
+// accesses, and then cache them in the instance table. Every new
+// instance pays the lookup again, so the resolved member is also kept in
+// a direct mapped cache keyed by the type and the interned key string.
+// Lua strings can be collected and their memory reused, a hit is only
+// taken if the key also still matches the copy kept in the entry. Each
+// thread has its own cache, so VMs of Workers don't share it.
+#define LSINSTANCEINDEXCACHE_SIZE       256
+#define LSINSTANCEINDEXCACHE_MAXKEY     64
+
+struct InstanceIndexCacheEntry
+{
+    Type       *type;
+    const char *key;
+    MemberInfo *member;
+    char       keyCopy[LSINSTANCEINDEXCACHE_MAXKEY];
+};
+
+static LOOM_THREAD_LOCAL InstanceIndexCacheEntry sInstanceIndexCache[LSINSTANCEINDEXCACHE_SIZE];
+
+static inline InstanceIndexCacheEntry *lsr_instanceindexcacheentry(Type *type, const char *key)
+{
+    size_t slot = ((size_t)type >> 4) ^ ((size_t)key >> 3);
+    return &sInstanceIndexCache[slot & (LSINSTANCEINDEXCACHE_SIZE - 1)];
+}
+
+void lsr_instanceindexcacheclear()
+{
+    memset(sInstanceIndexCache, 0, sizeof(sInstanceIndexCache));
+}
+
+static MemberInfo *lsr_instancefindmember(Type *type, const char *name)
+{
+    const char *pname = name;
+    MemberInfo *mi    = NULL;
+
+    if (!strncmp(name, "__pget_", 7))
+    {
+        pname = &name[7];
+        mi    = type->findMember(pname, true);
+        lmAssert(mi && mi->isProperty(), "Could not find property getter for '%s' on type '%s'", pname, type->getFullName().c_str());
+        mi = ((PropertyInfo *)mi)->getGetMethod();
+        lmAssert(mi, "Found NULL property getter for '%s' on type '%s'", pname, type->getFullName().c_str());
+    }
+    else if (!strncmp(name, "__pset_", 7))
+    {
+        pname = &name[7];
+        mi    = type->findMember(pname, true);
+        lmAssert(mi && mi->isProperty(), "Could not find property setter for '%s' on type '%s'", pname, type->getFullName().c_str());
+        mi = ((PropertyInfo *)mi)->getSetMethod();
+        lmAssert(mi, "Found NULL property setter for '%s' on type '%s'", pname, type->getFullName().c_str());
+    }
+    else
+    {
+        mi = type->findMember(name, true);
+        lmAssert(mi, "Unable to find member '%s' via string on instance of type %s", name, type->getFullName().c_str());
+        assert(mi);
+        assert(mi->isMethod());
+        assert(mi->getOrdinal());
+    }
+
+    return mi;
+}
+
 static int lsr_instanceindex(lua_State *L)
 {
     // we hit the instance index metamethod when we can't find a value
@@ -390,33 +454,28 @@ static int lsr_instanceindex(lua_State *L)
     // if we hit here, this should be an interface access where we have to
     // look up by string (and cache as these are only ever instance methods)
 
-    const char *name  = lua_tostring(L, 2);
-    const char *pname = name;
-    MemberInfo *mi    = NULL;
+    const char *name = lua_tostring(L, 2);
+    MemberInfo *mi   = NULL;
 
-    if (!strncmp(name, "__pget_", 7))
-    {
-        pname = &name[7];
-        mi    = type->findMember(pname, true);
-        lmAssert(mi && mi->isProperty(), "Could not find property getter for '%s' on type '%s'", pname, type->getFullName().c_str());
-        mi = ((PropertyInfo *)mi)->getGetMethod();
-        lmAssert(mi, "Found NULL property getter for '%s' on type '%s'", pname, type->getFullName().c_str());
-    }
-    else if (!strncmp(name, "__pset_", 7))
+    InstanceIndexCacheEntry *entry = lsr_instanceindexcacheentry(type, name);
+
+    if ((entry->type == type) && (entry->key == name) && !strcmp(entry->keyCopy, name))
     {
-        pname = &name[7];
-        mi    = type->findMember(pname, true);
-        lmAssert(mi && mi->isProperty(), "Could not find property setter for '%s' on type '%s'", pname, type->getFullName().c_str());
-        mi = ((PropertyInfo *)mi)->getSetMethod();
-        lmAssert(mi, "Found NULL property setter for '%s' on type '%s'", pname, type->getFullName().c_str());
+        mi = entry->member;
+        LSProfiler::indexCacheHits++;
     }
     else
     {
-        mi = type->findMember(name, true);
-        lmAssert(mi, "Unable to find member '%s' via string on instance of type %s", name, type->getFullName().c_str());
-        assert(mi);
-        assert(mi->isMethod());
-        assert(mi->getOrdinal());
+        mi = lsr_instancefindmember(type, name);
+        LSProfiler::indexCacheMisses++;
+
+        if (strlen(name) < LSINSTANCEINDEXCACHE_MAXKEY)
+        {
+            entry->type   = type;
+            entry->key    = name;
+            entry->member = mi;
+            strcpy(entry->keyCopy, name);
+        }
     }
 
     lua_pushnumber(L, mi->getOrdinal());
@@ -548,6 +607,39 @@ static int lsr_deletedinstanceequality(lua_State *L)
 }
 
 
+static void lsr_releasedpoolederror(lua_State *L)
+{
+    lua_Debug ar;
+
+    lua_getstack(L, 1, &ar);
+    lua_getinfo(L, "nSl", &ar);
+    LSLog(LSLogError, "Access released pooled instance at: %s %i", ar.source, ar.currentline);
+    lua_pushstring(L, "Fatal Error");
+    lua_error(L);
+}
+
+
+static int lsr_releasedinstanceindex(lua_State *L)
+{
+    lsr_releasedpoolederror(L);
+    return 0;
+}
+
+
+static int lsr_releasedinstancenewindex(lua_State *L)
+{
+    lsr_releasedpoolederror(L);
+    return 0;
+}
+
+
+static int lsr_releasedinstanceequality(lua_State *L)
+{
+    lsr_releasedpoolederror(L);
+    return 0;
+}
+
+
 static int lsr_gctracker(lua_State *L)
 {
     if (LSProfiler::isEnabled())
@@ -624,6 +716,22 @@ void lsr_instanceregister(lua_State *L)
     // pop deleted managed metatable
     lua_pop(L, 1);
 
+    // Metatable for released instances of [Pooled] types, any access until
+    // they are handed out again is a use after release
+    luaL_newmetatable(L, LSRELEASEDPOOLED);
+
+    lua_pushcfunction(L, lsr_releasedinstanceindex);
+    lua_setfield(L, -2, "__index");
+
+    lua_pushcfunction(L, lsr_releasedinstancenewindex);
+    lua_setfield(L, -2, "__newindex");
+
+    lua_pushcfunction(L, lsr_releasedinstanceequality);
+    lua_setfield(L, -2, "__eq");
+
+    // pop released pooled metatable
+    lua_pop(L, 1);
+
     // Standard metatable for gctracker
     luaL_newmetatable(L, LSGCTRACKER);
 
@@ -47,13 +47,14 @@ extern "C" {
 namespace LS {
 void lsr_classinitializestatic(lua_State *L, Type *type);
 
-utHashTable<utPointerHashKey, LSLuaState *> LSLuaState::toLuaState;
+utFlatHashTable<utPointerHashKey, LSLuaState *> LSLuaState::toLuaState;
+RWLock LSLuaState::toLuaStateLock;
 
 utArray<utString> LSLuaState::commandLine;
 
 double            LSLuaState::uniqueKey      = 1;
-lua_State         *LSLuaState::lastState     = NULL;
-LSLuaState        *LSLuaState::lastLSState   = NULL;
+LOOM_THREAD_LOCAL lua_State  *LSLuaState::lastState   = NULL;
+LOOM_THREAD_LOCAL LSLuaState *LSLuaState::lastLSState = NULL;
 double            LSLuaState::constructorKey = 0;
 utArray<utString> LSLuaState::buildCache;
 
@@ -71,26 +72,26 @@ static utStack<stackinfo> _tracestack;
 static char               _tracemessage[2048];
 
 size_t LSLuaState::allocatedBytes = 0;
+LOOM_THREAD_LOCAL bool LSLuaState::profileAllocations = true;
 
+// Tables, closures, strings and upvalues are mostly small and short lived,
+// they come out of the state's size class slabs instead of the heap
 static void *lsLuaAlloc(void *ud, void *ptr, size_t osize, size_t nsize)
 {
-    (void)ud;  /* not used */
+    loom_sizeClassAllocator_t *allocator = (loom_sizeClassAllocator_t *)ud;
 
     LSLuaState::allocatedBytes += nsize - osize;
 
-    void *ret;
-    if (nsize == 0)
-    {
-        lmFree(NULL, ptr);
-        return NULL;
-    }
-    else if (ptr == NULL)
+    if (nsize > osize && LSLuaState::profileAllocations)
     {
-        ret = lmAlloc(NULL, nsize);
+        LSProfiler::countAllocation(nsize - osize);
     }
-    else
+
+    void *ret = loom_allocator_sizeClassRealloc(allocator, ptr, osize, nsize);
+
+    if (nsize == 0)
     {
-        ret = lmRealloc(NULL, ptr, nsize);
+        return NULL;
     }
 
     // Garbage collection here would be nice,
@@ -100,17 +101,45 @@ static void *lsLuaAlloc(void *ud, void *ptr, size_t osize, size_t nsize)
     return ret;
 }
 
+LSLuaState *LSLuaState::lookupLuaState(lua_State *L)
+{
+    // always look up by main thread, this handles coroutine states nicely
+    loom_rwlock_lockRead(&toLuaStateLock);
+
+#ifdef LOOM_ENABLE_JIT
+    LSLuaState **found = toLuaState.get(mainthread(G(L)));
+#else
+    LSLuaState **found = toLuaState.get(L->l_G->mainthread);
+#endif
+
+    LSLuaState *ls = found ? *found : NULL;
+
+    loom_rwlock_unlockRead(&toLuaStateLock);
+
+    lmAssert(ls, "Fatal Error: Unable to get LuaState");
+
+    lastState   = L;
+    lastLSState = ls;
+
+    return ls;
+}
+
+
 void LSLuaState::open()
 {
     assert(!L);
 
-    #if LOOM_PLATFORM_64BIT
+    // LuaJIT on 64 bit platforms only runs with its own allocator
+    #if LOOM_PLATFORM_64BIT && defined(LOOM_ENABLE_JIT)
     L = luaL_newstate();
     #else
-    L = lua_newstate(lsLuaAlloc, this);
+    allocator = loom_allocator_createSizeClassAllocator(loom_allocator_getTaggedAllocator("script.lua"));
+    L = lua_newstate(lsLuaAlloc, allocator);
     #endif
 
+    loom_rwlock_lockWrite(&toLuaStateLock);
     toLuaState.insert(L, this);
+    loom_rwlock_unlockWrite(&toLuaStateLock);
 
 #ifdef LUAJIT_MODE_MASK
     // TODO: turn this back on when it doesn't fail on the testWhile unit test
@@ -190,6 +219,9 @@ void LSLuaState::close()
 
     // ensure profiler is down
     LSProfiler::disable(L);
+    LSProfiler::stopSampling(L);
+    LSProfiler::stopAllocationSampling(L);
+    LSProfiler::stopTraceStats(L);
 
     for (UTsize i = 0; i < assemblies.size(); i++)
     {
@@ -200,12 +232,45 @@ void LSLuaState::close()
 
     lua_close(L);
 
+    if (allocator)
+    {
+        loom_allocator_destroySizeClassAllocator(allocator);
+        allocator = NULL;
+    }
+
+    lsr_instanceindexcacheclear();
+
+    loom_rwlock_lockWrite(&toLuaStateLock);
     toLuaState.remove(L);
+    loom_rwlock_unlockWrite(&toLuaStateLock);
 
     L = NULL;
 }
 
 
+void LSLuaState::getAllocatorStats(size_t *allocatedBytes, size_t *allocatedCount, size_t *reservedBytes)
+{
+    if (allocator)
+    {
+        loom_allocator_getSizeClassStats(allocator, allocatedBytes, allocatedCount, reservedBytes);
+        return;
+    }
+
+    if (allocatedBytes)
+    {
+        *allocatedBytes = 0;
+    }
+    if (allocatedCount)
+    {
+        *allocatedCount = 0;
+    }
+    if (reservedBytes)
+    {
+        *reservedBytes = 0;
+    }
+}
+
+
 Assembly *LSLuaState::loadTypeAssembly(const utString& assemblyString)
 {
     beginAssemblyLoad();
@@ -306,8 +371,19 @@ void LSLuaState::cacheAssemblyTypes(Assembly *assembly, utArray<Type *>& types)
 
     lmAssert(assembly->ordinalTypes == NULL, "Assembly types cache error, ordinalTypes already exists");
 
+    // type ids may have gaps where `lsc --strip` removed types
+    LSTYPEID maxTypeID = 0;
+    for (UTsize j = 0; j < types.size(); j++)
+    {
+        if (types.at(j)->getTypeID() > maxTypeID)
+        {
+            maxTypeID = types.at(j)->getTypeID();
+        }
+    }
+
     assembly->ordinalTypes = lmNew(NULL) utArray<Type*>();
-    assembly->ordinalTypes->resize(types.size() + 1);
+    assembly->ordinalTypes->resize(maxTypeID + 1);
+    memset(assembly->ordinalTypes->ptr(), 0, (maxTypeID + 1) * sizeof(Type *));
 
     for (UTsize j = 0; j < types.size(); j++)
     {
@@ -315,7 +391,7 @@ void LSLuaState::cacheAssemblyTypes(Assembly *assembly, utArray<Type *>& types)
 
         assembly->types.insert(type->getName(), type);
 
-        lmAssert(type->getTypeID() > 0 && type->getTypeID() <= (LSTYPEID)types.size(), "LSLuaState::cacheAssemblyTypes TypeID out of range");
+        lmAssert(type->getTypeID() > 0, "LSLuaState::cacheAssemblyTypes TypeID out of range");
 
         assembly->ordinalTypes->ptr()[type->getTypeID()] = type;
 
@@ -592,8 +668,9 @@ utByteArray *LSLuaState::openExecutableAssembly(const utString& filePath)
 
 void LSLuaState::closeExecutableAssembly(const utString& filePath, utByteArray *bytes)
 {
-    LSUnmapFile(filePath.c_str());
+    // release the bytes first, stored executables reference the mapping
     closeExecutableAssemblyBinary(bytes);
+    LSUnmapFile(filePath.c_str());
 }
 
 Assembly *LSLuaState::loadExecutableAssemblyBinary(const char *buffer, long bufferSize) {
@@ -612,10 +689,21 @@ utByteArray *LSLuaState::openExecutableAssemblyBinary(const char *buffer, long b
     // we need to decompress
     lmCheck(headerBytes.readUnsignedInt() == LOOM_BINARY_ID, "binary id mismatch");
     lmCheck(headerBytes.readUnsignedInt() == LOOM_BINARY_VERSION_MAJOR, "major version mismatch");
-    lmCheck(headerBytes.readUnsignedInt() == LOOM_BINARY_VERSION_MINOR, "minor version mismatch");
+    unsigned int minor = headerBytes.readUnsignedInt();
+    lmCheck(minor == LOOM_BINARY_VERSION_MINOR || minor == LOOM_BINARY_VERSION_MINOR_STORED, "minor version mismatch");
     unsigned int sz = headerBytes.readUnsignedInt();
 
     utByteArray *bytes = lmNew(NULL) utByteArray();
+
+    if (minor == LOOM_BINARY_VERSION_MINOR_STORED)
+    {
+        // stored executables are read in place, the buffer (usually the
+        // mapped file) outlives the bytes until closeExecutableAssembly
+        lmCheck(bufferSize >= (long)(sizeof(unsigned int) * 4 + sz), "truncated executable assembly");
+        bytes->attach((void *)(buffer + sizeof(unsigned int) * 4), sz);
+        return bytes;
+    }
+
     bytes->resize(sz);
 
     uLongf readSZ = sz;
@@ -21,18 +21,23 @@
 #ifndef _lsluastate_h
 #define _lsluastate_h
 
+#include "loom/common/core/allocator.h"
 #include "loom/common/core/assert.h"
+#include "loom/common/platform/platformThread.h"
 #include "loom/script/reflection/lsAssembly.h"
 #include "loom/script/native/lsNativeDelegate.h"
+#include "loom/script/native/lsNativeInterface.h"
 #include "loom/script/runtime/lsRuntime.h"
 
 namespace LS {
 class LSLuaState {
     friend class Assembly;
     friend class BinReader;
+    friend class NativeInterface;
 
-    static lua_State  *lastState;
-    static LSLuaState *lastLSState;
+    // per thread, as Workers run VMs on their own threads
+    static LOOM_THREAD_LOCAL lua_State  *lastState;
+    static LOOM_THREAD_LOCAL LSLuaState *lastLSState;
 
     // unique id across VM's
     static double uniqueKey;
@@ -54,9 +59,12 @@ class LSLuaState {
 
     lua_State *L;
 
+    // backs the VM's allocations, NULL if the VM allocates on its own
+    loom_sizeClassAllocator_t *allocator;
+
     // loaded assemblies
-    utHashTable<utHashedString, Assembly *> assemblies;
-    utHashTable<utHashedString, Type *>     typeCache;
+    utHashTable<utHashedString, Assembly *>     assemblies;
+    utFlatHashTable<utHashedString, Type *> typeCache;
 
     utStack<utString> stackInfo;
 
@@ -64,8 +72,18 @@ class LSLuaState {
 
     static utArray<utString> buildCache;
 
-    // lua_State* -> LSLuaState
-    static utHashTable<utPointerHashKey, LSLuaState *> toLuaState;
+    // lua_State* -> LSLuaState, written under toLuaStateLock
+    static utFlatHashTable<utPointerHashKey, LSLuaState *> toLuaState;
+    static RWLock toLuaStateLock;
+
+    // NativeTypeBase* -> the script Type it resolved to in this VM
+    utHashTable<utPointerHashKey, Type *> nativeScriptTypes;
+
+    // the register functions already called for this VM, bindings are
+    // registered lazily, see NativeInterface::ensureNativeTypeRegistered
+    utArray<FunctionLuaRegisterType> registeredFunctions;
+
+    static LSLuaState *lookupLuaState(lua_State *L);
 
     void declareLuaTypes(const utArray<Type *>& types);
     void initializeLuaTypes(const utArray<Type *>& types);
@@ -105,8 +123,12 @@ public:
 
     static size_t allocatedBytes;
 
+    // Whether allocations on this thread count towards the profiler's
+    // allocation samples, Workers turn it off for their threads
+    static LOOM_THREAD_LOCAL bool profileAllocations;
+
     LSLuaState() :
-        compiling(false), loadingAssembly(0), L(NULL)
+        compiling(false), loadingAssembly(0), L(NULL), allocator(NULL)
     {
 
 #ifdef LOOM_DEBUG
@@ -139,25 +161,16 @@ public:
             return lastLSState;
         }
 
-        // always look up by main thread, this handles coroutine states nicely
-
-#ifdef LOOM_ENABLE_JIT
-        LSLuaState **ls = toLuaState.get(mainthread(G(L)));
-#else
-        LSLuaState **ls = toLuaState.get(L->l_G->mainthread);
-#endif
-
-        lmAssert(ls, "Fatal Error: Unable to get LuaState");
-
-        lastState   = L;
-        lastLSState = *ls;
-
-        return *ls;
+        return lookupLuaState(L);
     }
 
     void open();
     void close();
 
+    // Stats of the VM allocator: live bytes and blocks, and the bytes held
+    // in its small object slabs, all 0 if the VM allocates on its own
+    void getAllocatorStats(size_t *allocatedBytes, size_t *allocatedCount, size_t *reservedBytes);
+
     void setCompiling(bool value)
     {
         compiling = value;
@@ -233,7 +246,13 @@ public:
     // for speed, use getTypeByID
     inline Type *getType(const char *typeName)
     {
-        Type **v = typeCache.get(typeName);
+        return getType(typeName, utHashedString::hash(typeName));
+    }
+
+    // as above, with the utHashedString hash of typeName already computed
+    inline Type *getType(const char *typeName, UThash typeHash)
+    {
+        Type **v = typeCache.getByHash(typeHash);
 
         if (v)
         {
@@ -21,19 +21,152 @@
 // we can use this here as we have no link dependencies
 #include "loom/common/platform/platform.h"
 #include "loom/common/core/log.h"
+#include "loom/common/core/telemetry.h"
+#include "loom/common/platform/platformFile.h"
+#include "loom/common/platform/platformThread.h"
 #include "loom/script/loomscript.h"
 #include "loom/script/runtime/lsProfiler.h"
 #include <string.h>
 #include "SDL.h"
 
+#ifdef LOOM_ENABLE_JIT
+extern "C" {
+#include "luajit.h"
+}
+#endif
+
 namespace LS
 {
+#ifdef LOOM_ENABLE_JIT
+// Trace compiler error messages by LuaJIT error code
+static const char *const traceErrorMessages[] =
+{
+#define TREDEF(name, msg)    msg,
+#include "lj_traceerr.h"
+#undef TREDEF
+};
+#endif
+
+// LuaJIT trace events attributed to the script method a trace started in
+struct LSProfilerTraceStats
+{
+    int started;
+    int completed;
+    int aborted;
+
+    // "line: reason" -> number of aborts
+    utHashTable<utHashedString, int> abortReasons;
+};
+
+static utHashTable<utPointerHashKey, LSProfilerTraceStats *> traceStats;
+static int traceCallbackRef = LUA_NOREF;
+
 static utHashTable<utFastStringHash, LoomProfilerRoot *> dynamicProfilerRoots;
 
 bool LSProfiler::enabled = false;
 utStack<MethodBase *> LSProfiler::methodStack;
 utHashTable<utPointerHashKey, LSProfilerTypeAllocation *> LSProfiler::allocations;
 utHashTable<utPointerHashKey, MethodAllocation> *LSProfiler::sortMethods = NULL;
+int LSProfiler::indexCacheHits   = 0;
+int LSProfiler::indexCacheMisses = 0;
+bool LSProfiler::sampling = false;
+lua_State *LSProfiler::samplingState = NULL;
+volatile int LSProfiler::pendingTimeSample = 0;
+lua_State *LSProfiler::allocationState = NULL;
+int LSProfiler::allocationStride = 0;
+int LSProfiler::allocationCountdown = 0;
+double LSProfiler::pendingAllocationBytes = 0;
+
+// Frames kept per sample, deeper stacks are cut off at the outer end
+#define LSPROFILER_SAMPLE_DEPTH    32
+
+struct LSProfilerSample
+{
+    UThash     hash;
+    int        count;
+    int        depth;
+
+    // innermost frame first
+    MethodBase *frames[LSPROFILER_SAMPLE_DEPTH];
+};
+
+// Distinct stacks recorded with the summed weights of their samples, found
+// by stack hash, collisions are placed at the following free hash
+class LSProfilerSampleSet
+{
+    utArray<LSProfilerSample *> samples;
+    utHashTable<utIntHashKey, int> byHash;
+
+public:
+
+    ~LSProfilerSampleSet()
+    {
+        clear();
+    }
+
+    UTsize size() const
+    {
+        return samples.size();
+    }
+
+    LSProfilerSample *at(UTsize i)
+    {
+        return samples[i];
+    }
+
+    void add(const LSProfilerSample& sample, int weight)
+    {
+        UThash hash = sample.hash;
+
+        while (true)
+        {
+            int *index = byHash.get((int)hash);
+
+            if (!index)
+            {
+                LSProfilerSample *n = lmNew(NULL) LSProfilerSample(sample);
+                n->count = weight;
+                byHash.insert((int)hash, (int)samples.size());
+                samples.push_back(n);
+                return;
+            }
+
+            LSProfilerSample *existing = samples[*index];
+
+            if ((existing->depth == sample.depth) &&
+                !memcmp(existing->frames, sample.frames, sample.depth * sizeof(MethodBase *)))
+            {
+                existing->count += weight;
+                return;
+            }
+
+            hash++;
+        }
+    }
+
+    void clear()
+    {
+        for (UTsize i = 0; i < samples.size(); i++)
+        {
+            lmDelete(NULL, samples[i]);
+        }
+
+        samples.clear();
+        byHash.clear();
+    }
+};
+
+static LSProfilerSampleSet timeSamples;
+static LSProfilerSampleSet allocationSamples;
+
+// Sampled bytes by allocating method, and the sampled bytes since the
+// last telemetry report
+static utHashTable<utPointerHashKey, double> allocationsByMethod;
+static double allocationBytesSinceReport = 0;
+
+static ThreadHandle samplingThread = NULL;
+static volatile atomic_int_t samplingRunning = 0;
+static int samplingInterval = 1;
 
 lmDefineLogGroup(gProfilerLogGroup, "profiler", 1, LoomLogInfo);
 
@@ -222,6 +355,12 @@ void LSProfiler::enable(lua_State *L)
         return;
     }
 
+    if (sampling || allocationState)
+    {
+        lmLogError(gProfilerLogGroup, "Unable to enable the profiler while sampling, stop sampling first");
+        return;
+    }
+
     enabled = true;
 
     updateState(L);
@@ -362,6 +501,13 @@ void LSProfiler::dump(lua_State *L)
 
     gLoomProfiler->dumpToConsole();
 
+    int lookups = indexCacheHits + indexCacheMisses;
+    lmLog(gProfilerLogGroup, "");
+    lmLog(gProfilerLogGroup, "Instance member lookups by name: %i, cache hits: %i (%.1f%%), misses: %i",
+          lookups, indexCacheHits, lookups ? 100.0 * indexCacheHits / lookups : 0.0, indexCacheMisses);
+
+    dumpTraceStats(L);
+
 #ifdef LOOM_ENABLE_JIT
     lmLog(gProfilerLogGroup, "");
     lmLog(gProfilerLogGroup, "Please note: Profiling under JIT does not include native function calls.");
@@ -378,9 +524,21 @@ void LSProfiler::reset(lua_State *L)
     }
 
     disable(L);
+    stopSampling(L);
 
     methodStack.clear();
     clearAllocations();
+
+    stopAllocationSampling(L);
+    stopTraceStats(L);
+    clearTraceStats();
+
+    timeSamples.clear();
+    allocationSamples.clear();
+    allocationsByMethod.clear();
+
+    indexCacheHits   = 0;
+    indexCacheMisses = 0;
 }
 
 void LSProfiler::dumpAllocations(lua_State *L)
@@ -531,4 +689,682 @@ int LSProfiler::sortAllocsByTotal(const void *a, const void *b)
     return va > vb ? -1 : va < vb ? 1 : 0;
 }
 
+
+static int __stdcall samplingThreadMain(void *param)
+{
+    loom_thread_setDebugName("LSProfiler sampling");
+
+    while (atomic_load32(&samplingRunning))
+    {
+        loom_thread_sleep(samplingInterval);
+
+        LSProfiler::requestSample();
+    }
+
+    return 0;
+}
+
+
+#ifdef LOOM_ENABLE_JIT
+// called by LuaJIT's own profiler at a safe point of the running thread,
+// which also interrupts compiled traces
+static void jitProfileCallback(void *data, lua_State *L, int samples, int vmstate)
+{
+    LSProfiler::recordSample(L);
+}
+#endif
+
+
+void LSProfiler::requestSample()
+{
+    // lua_sethook is safe to call asynchronously, the hook runs on the
+    // main thread before its next instruction
+    lua_State *L = samplingState;
+
+    if (L)
+    {
+        pendingTimeSample = 1;
+        lua_sethook(L, sampleHook, LUA_MASKCOUNT, 1);
+    }
+}
+
+
+void LSProfiler::requestAllocationSample()
+{
+    // every stride bytes crossed is one sample, a large allocation may
+    // cross several
+    int samplesCrossed = 1 + (-allocationCountdown) / allocationStride;
+
+    allocationCountdown += samplesCrossed * allocationStride;
+
+    if (!allocationState)
+    {
+        return;
+    }
+
+    // the stack can't be walked from inside the allocator, the hook
+    // records it before the next instruction
+    pendingAllocationBytes += (double)samplesCrossed * allocationStride;
+    lua_sethook(allocationState, sampleHook, LUA_MASKCOUNT, 1);
+}
+
+
+void LSProfiler::sampleHook(lua_State *L, lua_Debug *ar)
+{
+    // one sample per request
+    lua_sethook(L, NULL, 0, 0);
+
+    if (pendingTimeSample)
+    {
+        pendingTimeSample = 0;
+        recordSample(L);
+    }
+
+    if (pendingAllocationBytes > 0)
+    {
+        recordAllocation(L, pendingAllocationBytes);
+        pendingAllocationBytes = 0;
+    }
+}
+
+
+// Fills sample with the current script stack of L, returns false if
+// there's no script method on it
+static bool captureStack(lua_State *L, LSProfilerSample& sample)
+{
+    sample.depth = 0;
+    sample.hash  = 2166136261u;
+
+    int       top = lua_gettop(L);
+    lua_Debug ar;
+
+    for (int level = 0; sample.depth < LSPROFILER_SAMPLE_DEPTH && lua_getstack(L, level, &ar); level++)
+    {
+        if (!lua_getinfo(L, "f", &ar))
+        {
+            break;
+        }
+
+        lua_rawgeti(L, LUA_GLOBALSINDEX, LSINDEXMETHODLOOKUP);
+        lua_pushvalue(L, -2);
+        lua_rawget(L, -2);
+
+        MethodBase *methodBase = (MethodBase *)lua_topointer(L, -1);
+
+        lua_settop(L, top);
+
+        // skip frames outside of script methods and the pcall wrapper of
+        // the method below them
+        if (!methodBase || (sample.depth && (sample.frames[sample.depth - 1] == methodBase)))
+        {
+            continue;
+        }
+
+        sample.frames[sample.depth++] = methodBase;
+        sample.hash = (sample.hash ^ (UThash)(UTuintPtr)methodBase) * 16777619u;
+    }
+
+    return sample.depth > 0;
+}
+
+
+void LSProfiler::recordSample(lua_State *L)
+{
+    LSProfilerSample sample;
+
+    if (captureStack(L, sample))
+    {
+        timeSamples.add(sample, 1);
+    }
+}
+
+
+void LSProfiler::recordAllocation(lua_State *L, double bytes)
+{
+    allocationBytesSinceReport += bytes;
+
+    LSProfilerSample sample;
+
+    if (!captureStack(L, sample))
+    {
+        return;
+    }
+
+    allocationSamples.add(sample, (int)bytes);
+
+    double *methodBytes = allocationsByMethod.get(sample.frames[0]);
+
+    if (methodBytes)
+    {
+        *methodBytes += bytes;
+    }
+    else
+    {
+        allocationsByMethod.insert(sample.frames[0], bytes);
+    }
+}
+
+
+void LSProfiler::startTimeline(int capacity)
+{
+    // scripts run on the thread starting the timeline
+    LoomTrace::setThreadName("Main");
+    LoomTrace::clear();
+    LoomTrace::enable(true, capacity > 0 ? capacity : 0);
+}
+
+
+void LSProfiler::stopTimeline()
+{
+    LoomTrace::enable(false);
+}
+
+
+bool LSProfiler::writeTimeline(const char *path)
+{
+    if (!LoomTrace::write(path))
+    {
+        lmLogError(gProfilerLogGroup, "Unable to write the timeline to %s", path);
+        return false;
+    }
+
+    lmLog(gProfilerLogGroup, "Timeline written to %s", path);
+    return true;
+}
+
+
+void LSProfiler::startSampling(lua_State *L, int intervalMs)
+{
+    if (sampling)
+    {
+        return;
+    }
+
+    if (enabled)
+    {
+        lmLogError(gProfilerLogGroup, "Unable to start sampling while the profiler is enabled, disable it first");
+        return;
+    }
+
+    sampling         = true;
+    samplingInterval = intervalMs > 0 ? intervalMs : 1;
+    samplingState    = L;
+
+#ifdef LOOM_ENABLE_JIT
+    luaJIT_profile_start(L, utStringFormat("i%d", samplingInterval).c_str(), jitProfileCallback, NULL);
+#else
+    atomic_store32(&samplingRunning, 1);
+    samplingThread = loom_thread_start(samplingThreadMain, NULL);
+#endif
+}
+
+
+void LSProfiler::stopSampling(lua_State *L)
+{
+    if (!sampling)
+    {
+        return;
+    }
+
+#ifdef LOOM_ENABLE_JIT
+    luaJIT_profile_stop(L);
+#else
+    atomic_store32(&samplingRunning, 0);
+    loom_thread_join(samplingThread);
+    samplingThread = NULL;
+#endif
+
+    samplingState     = NULL;
+    sampling          = false;
+    pendingTimeSample = 0;
+
+    if (!allocationState)
+    {
+        lua_sethook(L, NULL, 0, 0);
+    }
+}
+
+
+void LSProfiler::startAllocationSampling(lua_State *L, int strideBytes)
+{
+    if (allocationState)
+    {
+        return;
+    }
+
+    if (enabled)
+    {
+        lmLogError(gProfilerLogGroup, "Unable to start allocation sampling while the profiler is enabled, disable it first");
+        return;
+    }
+
+#if LOOM_PLATFORM_64BIT && defined(LOOM_ENABLE_JIT)
+    lmLogWarn(gProfilerLogGroup, "Allocation sampling is not available with the LuaJIT allocator on 64 bit platforms");
+#endif
+
+    allocationStride    = strideBytes > 0 ? strideBytes : 64 * 1024;
+    allocationCountdown = allocationStride;
+    allocationState     = L;
+}
+
+
+void LSProfiler::stopAllocationSampling(lua_State *L)
+{
+    if (!allocationState)
+    {
+        return;
+    }
+
+    allocationState        = NULL;
+    allocationStride       = 0;
+    pendingAllocationBytes = 0;
+
+    if (!sampling)
+    {
+        lua_sethook(L, NULL, 0, 0);
+    }
+}
+
+
+void LSProfiler::reportAllocationSamples()
+{
+    if (!allocationState)
+    {
+        return;
+    }
+
+    Telemetry::setTickValue("alloc.sampled.bytes", allocationBytesSinceReport);
+    allocationBytesSinceReport = 0;
+
+    // the methods allocating the most so far, by name
+    const int top = 8;
+    MethodBase *best[top];
+    double bestBytes[top];
+    int numBest = 0;
+
+    for (UTsize i = 0; i < allocationsByMethod.size(); i++)
+    {
+        double bytes = allocationsByMethod.at(i);
+        int j = numBest < top ? numBest++ : top;
+
+        while (j > 0 && bestBytes[j - 1] < bytes)
+        {
+            if (j < top)
+            {
+                best[j]      = best[j - 1];
+                bestBytes[j] = bestBytes[j - 1];
+            }
+            j--;
+        }
+
+        if (j < top)
+        {
+            best[j]      = (MethodBase *)allocationsByMethod.keyAt(i).key();
+            bestBytes[j] = bytes;
+        }
+    }
+
+    for (int i = 0; i < numBest; i++)
+    {
+        Telemetry::setTickValue(utStringFormat("alloc.sampled.method.%s", best[i]->getFullMemberName()).c_str(), bestBytes[i]);
+    }
+}
+
+
+// Writes the sample set as folded stacks to path, or the console if empty
+static void dumpSampleSet(LSProfilerSampleSet& set, const char *path, const char *unit)
+{
+    bool toFile = path && path[0];
+
+    utString folded;
+    int total = 0;
+
+    for (UTsize i = 0; i < set.size(); i++)
+    {
+        LSProfilerSample *sample = set.at(i);
+        utString line;
+
+        for (int j = sample->depth - 1; j >= 0; j--)
+        {
+            line += sample->frames[j]->getFullMemberName();
+            if (j) line += ";";
+        }
+
+        line  += utStringFormat(" %d", sample->count);
+        total += sample->count;
+
+        if (toFile)
+        {
+            folded += line;
+            folded += "\n";
+        }
+        else
+        {
+            lmLog(gProfilerLogGroup, "%s", line.c_str());
+        }
+    }
+
+    if (toFile)
+    {
+        if (platform_writeFile(path, (void *)folded.c_str(), (int)folded.size()))
+        {
+            lmLogError(gProfilerLogGroup, "Unable to write profiler samples to %s", path);
+        }
+        else
+        {
+            lmLog(gProfilerLogGroup, "Wrote %d %s of %d stacks to %s", total, unit, (int)set.size(), path);
+        }
+    }
+
+    set.clear();
+}
+
+
+void LSProfiler::dumpSamples(lua_State *L, const char *path)
+{
+    dumpSampleSet(timeSamples, path, "samples");
+}
+
+
+void LSProfiler::dumpAllocationSamples(lua_State *L, const char *path)
+{
+    // by allocating method first, with the type declaring it
+    utArray<int> order;
+    order.resize(allocationsByMethod.size());
+    for (UTsize i = 0; i < order.size(); i++) order[i] = i;
+
+    // few entries, a plain insertion sort by bytes
+    for (UTsize i = 1; i < order.size(); i++)
+    {
+        int v = order[i];
+        UTsize j = i;
+
+        while (j > 0 && allocationsByMethod.at(order[j - 1]) < allocationsByMethod.at(v))
+        {
+            order[j] = order[j - 1];
+            j--;
+        }
+
+        order[j] = v;
+    }
+
+    lmLog(gProfilerLogGroup, "");
+    lmLog(gProfilerLogGroup, "Sampled Allocations by Method");
+    lmLog(gProfilerLogGroup, "-----------------------------");
+
+    for (UTsize i = 0; i < order.size(); i++)
+    {
+        MethodBase *methodBase = (MethodBase *)allocationsByMethod.keyAt(order[i]).key();
+
+        lmLog(gProfilerLogGroup, "%i KiB, Method: %s, Type: %s", (int)(allocationsByMethod.at(order[i]) / 1024),
+              methodBase->getFullMemberName(), methodBase->getDeclaringType()->getFullName().c_str());
+    }
+
+    allocationsByMethod.clear();
+
+    dumpSampleSet(allocationSamples, path, "bytes");
+}
+
+#ifdef LOOM_ENABLE_JIT
+// Script method of the function at index, or NULL
+static MethodBase *lookupMethod(lua_State *L, int index)
+{
+    index = lua_absindex(L, index);
+
+    lua_rawgeti(L, LUA_GLOBALSINDEX, LSINDEXMETHODLOOKUP);
+    lua_pushvalue(L, index);
+    lua_rawget(L, -2);
+
+    MethodBase *methodBase = (MethodBase *)lua_topointer(L, -1);
+
+    lua_pop(L, 2);
+
+    return methodBase;
+}
+
+
+// Source line of bytecode position pc in the function at index, via
+// jit.util.funcinfo
+static int getTraceLine(lua_State *L, int index, int pc)
+{
+    index = lua_absindex(L, index);
+
+    int top  = lua_gettop(L);
+    int line = 0;
+
+    lua_getfield(L, LUA_REGISTRYINDEX, "_LOADED");
+    lua_getfield(L, -1, "jit.util");
+
+    if (lua_istable(L, -1))
+    {
+        lua_getfield(L, -1, "funcinfo");
+        lua_pushvalue(L, index);
+        lua_pushinteger(L, pc);
+
+        if (!lua_pcall(L, 2, 1, 0) && lua_istable(L, -1))
+        {
+            lua_getfield(L, -1, "currentline");
+            line = (int)lua_tointeger(L, -1);
+        }
+    }
+
+    lua_settop(L, top);
+
+    return line;
+}
+
+
+// Formats the reason of an abort from the error object at errIndex and
+// the error info at infoIndex
+static utString getTraceAbortReason(lua_State *L, int errIndex, int infoIndex)
+{
+    if (!lua_isnumber(L, errIndex))
+    {
+        const char *message = lua_tostring(L, errIndex);
+        return message ? message : "unknown error";
+    }
+
+    int code = (int)lua_tointeger(L, errIndex);
+
+    if ((code < 0) || (code >= (int)(sizeof(traceErrorMessages) / sizeof(traceErrorMessages[0]))))
+    {
+        return utStringFormat("trace error %d", code);
+    }
+
+    const char *message = traceErrorMessages[code];
+
+    if (strstr(message, "%d"))
+    {
+        return utStringFormat(message, (int)lua_tointeger(L, infoIndex));
+    }
+
+    if (strstr(message, "%s"))
+    {
+        // name C functions by their script method, most are bridged natives
+        const char *info = NULL;
+
+        if (lua_isfunction(L, infoIndex))
+        {
+            MethodBase *methodBase = lookupMethod(L, infoIndex);
+            info = methodBase ? methodBase->getFullMemberName() : "?";
+        }
+        else
+        {
+            info = lua_tostring(L, infoIndex);
+        }
+
+        return utStringFormat(message, info ? info : "?");
+    }
+
+    return message;
+}
+
+
+// jit.attach "trace" callback: what, traceno, func, pc, error, info
+static int traceEventCallback(lua_State *L)
+{
+    const char *what = lua_tostring(L, 1);
+
+    if (!what || !lua_isfunction(L, 3))
+    {
+        return 0;
+    }
+
+    MethodBase *methodBase = lookupMethod(L, 3);
+
+    if (!methodBase)
+    {
+        return 0;
+    }
+
+    LSProfilerTraceStats **ostats = traceStats.get(methodBase);
+    LSProfilerTraceStats *stats   = ostats ? *ostats : NULL;
+
+    if (!stats)
+    {
+        stats            = lmNew(NULL) LSProfilerTraceStats;
+        stats->started   = 0;
+        stats->completed = 0;
+        stats->aborted   = 0;
+        traceStats.insert(methodBase, stats);
+    }
+
+    if (!strcmp(what, "start"))
+    {
+        stats->started++;
+    }
+    else if (!strcmp(what, "stop"))
+    {
+        stats->completed++;
+    }
+    else if (!strcmp(what, "abort"))
+    {
+        stats->aborted++;
+
+        utString reason = utStringFormat("line %d: %s", getTraceLine(L, 3, (int)lua_tointeger(L, 4)),
+                                         getTraceAbortReason(L, 5, 6).c_str());
+
+        int *count = stats->abortReasons.get(reason);
+
+        if (count)
+        {
+            (*count)++;
+        }
+        else
+        {
+            stats->abortReasons.insert(reason, 1);
+        }
+    }
+
+    return 0;
+}
+#endif
+
+
+// Calls jit.attach with the trace callback, attaching to the trace
+// event or detaching if event is NULL
+static void attachTraceCallback(lua_State *L, const char *event)
+{
+    int top = lua_gettop(L);
+
+    lua_getglobal(L, "jit");
+
+    if (lua_istable(L, -1))
+    {
+        lua_getfield(L, -1, "attach");
+        lua_rawgeti(L, LUA_REGISTRYINDEX, traceCallbackRef);
+
+        if (event)
+        {
+            lua_pushstring(L, event);
+        }
+
+        if (lua_pcall(L, event ? 2 : 1, 0, 0))
+        {
+            lmLogError(gProfilerLogGroup, "Unable to attach to JIT trace events: %s", lua_tostring(L, -1));
+        }
+    }
+
+    lua_settop(L, top);
+}
+
+
+void LSProfiler::startTraceStats(lua_State *L)
+{
+#ifdef LOOM_ENABLE_JIT
+    if (traceCallbackRef != LUA_NOREF)
+    {
+        return;
+    }
+
+    lua_pushcfunction(L, traceEventCallback);
+    traceCallbackRef = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    attachTraceCallback(L, "trace");
+#else
+    lmLogWarn(gProfilerLogGroup, "Trace statistics are only available when running under JIT");
+#endif
+}
+
+
+void LSProfiler::stopTraceStats(lua_State *L)
+{
+    if (traceCallbackRef == LUA_NOREF)
+    {
+        return;
+    }
+
+    attachTraceCallback(L, NULL);
+
+    luaL_unref(L, LUA_REGISTRYINDEX, traceCallbackRef);
+    traceCallbackRef = LUA_NOREF;
+}
+
+
+void LSProfiler::dumpTraceStats(lua_State *L)
+{
+    if (!traceStats.size())
+    {
+        return;
+    }
+
+    lmLog(gProfilerLogGroup, "");
+    lmLog(gProfilerLogGroup, "JIT Trace Statistics");
+    lmLog(gProfilerLogGroup, "--------------------");
+
+    // methods with aborted traces first, the likeliest to be blacklisted
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (UTsize i = 0; i < traceStats.size(); i++)
+        {
+            LSProfilerTraceStats *stats = traceStats.at(i);
+            MethodBase *methodBase      = (MethodBase *)traceStats.keyAt(i).key();
+
+            if ((stats->aborted > 0) != (pass == 0))
+            {
+                continue;
+            }
+
+            lmLog(gProfilerLogGroup, "Started: %i, Compiled: %i, Aborted: %i, Method: %s",
+                  stats->started, stats->completed, stats->aborted, methodBase->getFullMemberName());
+
+            for (UTsize j = 0; j < stats->abortReasons.size(); j++)
+            {
+                lmLog(gProfilerLogGroup, "     %i x %s", stats->abortReasons.at(j),
+                      stats->abortReasons.keyAt(j).str().c_str());
+            }
+        }
+    }
+}
+
+
+void LSProfiler::clearTraceStats()
+{
+    for (UTsize i = 0; i < traceStats.size(); i++)
+    {
+        lmDelete(NULL, traceStats.at(i));
+    }
+
+    traceStats.clear();
+}
 }
@@ -67,8 +67,32 @@ private:
     static void getCurrentStack(lua_State *L, utStack<MethodBase *>& stack);
     static MethodBase *getTopMethod(lua_State *L);
 
+    // Sampling mode, the stack of the main thread is recorded every
+    // interval instead of hooking every call and return
+    static bool sampling;
+    static lua_State *samplingState;
+    static volatile int pendingTimeSample;
+
+    // Allocation sampling, every allocationStride bytes allocated by the
+    // VM the stack is recorded, weighted by the stride
+    static lua_State *allocationState;
+    static int allocationStride;
+    static int allocationCountdown;
+    static double pendingAllocationBytes;
+
+    static void requestAllocationSample();
+    static void recordAllocation(lua_State *L, double bytes);
+
+    // Shared hook of both sampling modes, records the requested samples
+    static void sampleHook(lua_State *L, lua_Debug *ar);
+
 public:
 
+    // Lookups of instance members by name served from, or missing, the
+    // instance index cache, counted whether or not profiling is enabled
+    static int indexCacheHits;
+    static int indexCacheMisses;
+
     inline static bool isEnabled()
     {
         if (!gLoomProfiler)
@@ -216,6 +240,86 @@ public:
     static void dump(lua_State *L);
 
     static void reset(lua_State *L);
+
+    // Starts recording the script stack every intervalMs milliseconds,
+    // cheap enough to leave on in release builds. Can't be combined with
+    // the call hook profiling of enable().
+    static void startSampling(lua_State *L, int intervalMs);
+    static void stopSampling(lua_State *L);
+
+    inline static bool isSampling()
+    {
+        return sampling;
+    }
+
+    // Records a timeline of the profiler blocks and trace scopes of every
+    // thread, plus the script calls while enabled, keeping the most recent
+    // capacity events, see LoomTrace
+    static void startTimeline(int capacity);
+    static void stopTimeline();
+
+    inline static bool isRecordingTimeline()
+    {
+        return LoomTrace::isEnabled();
+    }
+
+    // Writes the recorded timeline as Chrome trace JSON, or as a Perfetto
+    // trace if path ends in .pftrace, false if it can't be written
+    static bool writeTimeline(const char *path);
+
+    // Writes the recorded samples in the folded stack format flame graph
+    // tools read, one "outer;...;inner count" line per distinct stack, to
+    // path or to the console if path is empty, and clears them
+    static void dumpSamples(lua_State *L, const char *path);
+
+    // Called by the sampling thread, requests a sample on the next
+    // instruction the main thread runs
+    static void requestSample();
+
+    // Adds the current stack of L to the samples
+    static void recordSample(lua_State *L);
+
+    // Starts attributing one sample per strideBytes allocated by the VM to
+    // the script stack allocating it, aggregated by method and reported to
+    // telemetry every tick. Can't be combined with enable() either.
+    static void startAllocationSampling(lua_State *L, int strideBytes);
+    static void stopAllocationSampling(lua_State *L);
+
+    inline static bool isAllocationSampling()
+    {
+        return allocationState != NULL;
+    }
+
+    // Called by the VM allocator for every allocation growing a block
+    inline static void countAllocation(size_t bytes)
+    {
+        if (!allocationStride)
+        {
+            return;
+        }
+
+        allocationCountdown -= (int)bytes;
+
+        if (allocationCountdown <= 0)
+        {
+            requestAllocationSample();
+        }
+    }
+
+    // Sets the sampled allocation telemetry values of this tick
+    static void reportAllocationSamples();
+
+    // Logs the sampled bytes by allocating method and writes the sampled
+    // stacks weighted by bytes like dumpSamples, then clears them
+    static void dumpAllocationSamples(lua_State *L, const char *path);
+
+    // Under JIT, attributes LuaJIT trace starts, completions and aborts
+    // with their reasons to the script method the trace started in, dump
+    // lists the methods that failed to compile
+    static void startTraceStats(lua_State *L);
+    static void stopTraceStats(lua_State *L);
+    static void dumpTraceStats(lua_State *L);
+    static void clearTraceStats();
 };
 }
 #endif
@@ -55,7 +55,14 @@ const char *lsr_objecttostring(lua_State *L, int index)
         return lua_toboolean(L, index) ? "true" : "false";
     }
 
-    if (lua_isfunction(L, index) || lua_iscfunction(L, index))
+    bool isFunction = lua_isfunction(L, index) || lua_iscfunction(L, index);
+
+#ifdef LOOM_ENABLE_JIT
+    // static native methods bound through the FFI are function pointer cdata
+    isFunction = isFunction || (lua_type(L, index) == LUA_TCDATA);
+#endif
+
+    if (isFunction)
     {
         lua_rawgeti(L, LUA_GLOBALSINDEX, LSINDEXMETHODLOOKUP);
         lua_pushvalue(L, 1);
@@ -123,6 +130,9 @@ Type *lsr_gettype(lua_State *L, int index)
         break;
 
     case LUA_TFUNCTION:
+#ifdef LOOM_ENABLE_JIT
+    case LUA_TCDATA:
+#endif
         return lstate->functionType;
 
         break;
@@ -36,6 +36,7 @@ namespace LS {
 // metatables
 #define LSINSTANCE          "LSINSTANCE"
 #define LSDELETEDMANAGED    "LSDELETEDMANAGED"
+#define LSRELEASEDPOOLED    "LSRELEASEDPOOLED"
 #define LSDICTIONARY        "LSDICTIONARY"
 #define LSVECTOR            "LSVECTOR"
 
@@ -118,7 +119,24 @@ namespace LS {
 // index for fast checking on whether a managed native instance has been deleted (from C/C++ or LoomScript)
 #define LSINDEXDELETEDMANAGED             -1000025
 
-#define LSINDEXMAX                        -1000025
+// index on the class table of a [Pooled] type, holds the released instances
+// waiting to be reused
+#define LSINDEXPOOL                       -1000026
+
+// cached C function calling all listeners of a NativeDelegate on invoke
+#define LSINDEXNATIVEDELEGATEDISPATCH     -1000027
+
+// finished coroutine threads kept for reuse by new coroutines
+#define LSINDEXCOROUTINEPOOL              -1000028
+
+// userdata holding the coroutines started with Coroutine.start
+#define LSINDEXCOROUTINESCHEDULER         -1000029
+
+// EventDispatcher instances hold their listener functions in a table at this index,
+// keyed by the slots stored natively per event type
+#define LSINDEXEVENTLISTENERS             -1000030
+
+#define LSINDEXMAX                        -1000030
 
 void lsr_getclasstable(lua_State *L, Type *type);
 void lsr_classinitialize(lua_State *L, Type *type);
@@ -129,6 +147,10 @@ void lsr_createinstance(lua_State *L, Type *type);
 
 void lsr_instanceregister(lua_State *L);
 
+// forgets the members cached for instance lookups by name, as the
+// types go away with the state
+void lsr_instanceindexcacheclear();
+
 // Get the type of object on the stack at the given index
 Type *lsr_gettype(lua_State *L, int index);
 
@@ -187,7 +187,7 @@ class TypeValidatorRT {
             return false;
         }
 
-        Type *ntype = NativeInterface::getScriptType(ntb);
+        Type *ntype = NativeInterface::getScriptType(stype->getAssembly()->getLuaState()->VM(), ntb);
         if (!ntype)
         {
             return false;
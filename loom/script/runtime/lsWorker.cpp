@@ -0,0 +1,356 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/common/core/allocator.h"
+#include "loom/common/core/log.h"
+#include "loom/script/loomscript.h"
+#include "loom/script/common/lsFile.h"
+#include "loom/script/runtime/lsRuntime.h"
+#include "loom/script/runtime/lsWorker.h"
+
+namespace LS {
+lmDefineLogGroup(gWorkerLogGroup, "worker", 1, LoomLogInfo);
+
+utArray<Worker *> Worker::workers;
+LOOM_THREAD_LOCAL Worker *Worker::current = NULL;
+
+Worker::Worker(const char *assemblyPath, const char *className) :
+    vm(NULL), onMessage(NULL), thread(NULL), wake(NULL), stopping(0)
+{
+    this->assemblyPath = assemblyPath ? assemblyPath : "";
+    this->className    = className ? className : "";
+
+    lock.state = 0;
+}
+
+
+Worker::~Worker()
+{
+    terminate();
+}
+
+
+bool Worker::start()
+{
+    if (vm)
+    {
+        lmLogError(gWorkerLogGroup, "Worker %s already started", className.c_str());
+        return false;
+    }
+
+    const char *buffer = NULL;
+    long       bufferSize = 0;
+    LSMapFile(assemblyPath.c_str(), (void **)&buffer, &bufferSize);
+
+    if (!buffer || !bufferSize)
+    {
+        lmLogError(gWorkerLogGroup, "Unable to load worker assembly %s", assemblyPath.c_str());
+        return false;
+    }
+
+    vm = lmNew(NULL) LSLuaState();
+    vm->open();
+
+    // loaded here, bindings are registered and types resolved on the
+    // main thread
+    utByteArray *bytes = vm->openExecutableAssemblyBinary(buffer, bufferSize);
+    vm->readExecutableAssemblyBinaryHeader(bytes);
+    vm->readExecutableAssemblyBinaryBody();
+    vm->closeExecutableAssemblyBinary(bytes);
+    LSUnmapFile(assemblyPath.c_str());
+
+    Type       *type   = vm->getType(className.c_str());
+    MemberInfo *member = type ? type->findMember("onMessage") : NULL;
+
+    if (!member || !member->isMethod() || !((MethodInfo *)member)->isStatic())
+    {
+        lmLogError(gWorkerLogGroup, "Worker class %s in %s has no static onMessage(message:ByteArray)", className.c_str(), assemblyPath.c_str());
+        terminate();
+        return false;
+    }
+
+    onMessage = (MethodInfo *)member;
+
+    // the main VM is stepped by the GC binding, a worker collects on its own
+    lua_gc(vm->VM(), LUA_GCRESTART, 0);
+
+    wake = loom_semaphore_create();
+    atomic_store32(&stopping, 0);
+
+    thread = loom_thread_startWithHint(run, this, LOOM_THREAD_BACKGROUND);
+
+    workers.push_back(this);
+
+    return true;
+}
+
+
+void Worker::postMessage(utByteArray *message, bool transfer)
+{
+    if (!message)
+    {
+        return;
+    }
+
+    if (!thread)
+    {
+        lmLogWarn(gWorkerLogGroup, "Message posted to worker %s which isn't running", className.c_str());
+        return;
+    }
+
+    utByteArray *posted = lmNew(NULL) utByteArray();
+
+    if (transfer)
+    {
+        posted->transferFrom(*message);
+    }
+    else
+    {
+        posted->allocateAndCopy(message->getDataPtr(), message->getSize());
+    }
+
+    loom_lightMutex_lock(&lock);
+    inbox.push_back(posted);
+    loom_lightMutex_unlock(&lock);
+
+    loom_semaphore_post(wake);
+}
+
+
+void Worker::terminate()
+{
+    if (thread)
+    {
+        atomic_store32(&stopping, 1);
+        loom_semaphore_post(wake);
+        loom_thread_join(thread);
+        thread = NULL;
+    }
+
+    if (wake)
+    {
+        loom_semaphore_destroy(wake);
+        wake = NULL;
+    }
+
+    UTsize index = workers.find(this);
+    if (index != UT_NPOS)
+    {
+        workers.erase(index);
+    }
+
+    for (UTsize i = 0; i < inbox.size(); i++)
+    {
+        lmDelete(NULL, inbox[i]);
+    }
+    inbox.clear();
+
+    for (UTsize i = 0; i < outbox.size(); i++)
+    {
+        lmDelete(NULL, outbox[i]);
+    }
+    outbox.clear();
+    errors.clear();
+
+    if (vm)
+    {
+        vm->close();
+        lmDelete(NULL, vm);
+        vm = NULL;
+    }
+
+    onMessage = NULL;
+}
+
+
+int __stdcall Worker::run(void *param)
+{
+    Worker *worker = (Worker *)param;
+
+    loom_thread_setDebugName("Worker");
+
+    current = worker;
+    LSLuaState::profileAllocations = false;
+
+    utArray<utByteArray *> messages;
+
+    for ( ; ; )
+    {
+        loom_semaphore_wait(worker->wake);
+
+        if (atomic_load32(&worker->stopping))
+        {
+            break;
+        }
+
+        loom_lightMutex_lock(&worker->lock);
+        messages = worker->inbox;
+        worker->inbox.clear(true);
+        loom_lightMutex_unlock(&worker->lock);
+
+        for (UTsize i = 0; i < messages.size(); i++)
+        {
+            if (atomic_load32(&worker->stopping))
+            {
+                lmDelete(NULL, messages[i]);
+                continue;
+            }
+
+            worker->handleMessage(messages[i]);
+        }
+
+        messages.clear(true);
+    }
+
+    current = NULL;
+
+    return 0;
+}
+
+
+void Worker::handleMessage(utByteArray *message)
+{
+    lua_State *L = vm->VM();
+
+    int top = lua_gettop(L);
+
+    lsr_getclasstable(L, onMessage->getDeclaringType());
+    lua_pushnumber(L, onMessage->getOrdinal());
+    lua_gettable(L, -2);
+    lua_remove(L, -2);
+
+    // the VM owns the message from here on
+    NativeTypeBase *nativeType = NativeInterface::getNativeType<utByteArray>();
+    lualoom_newnativeuserdata(L, nativeType, message, true);
+    lualoom_pushnative_userdata(L, NativeInterface::getScriptType(L, nativeType), -1);
+    lua_remove(L, -2);
+
+    if (lua_pcall(L, 1, 0, 0))
+    {
+        const char *error = lua_tostring(L, -1);
+        postError(error ? error : "Unknown error");
+    }
+
+    lua_settop(L, top);
+}
+
+
+void Worker::postError(const char *error)
+{
+    lmLogError(gWorkerLogGroup, "Worker %s: %s", className.c_str(), error);
+
+    loom_lightMutex_lock(&lock);
+    errors.push_back(error);
+    loom_lightMutex_unlock(&lock);
+}
+
+
+void Worker::postToMain(utByteArray *message, bool transfer)
+{
+    Worker *worker = current;
+
+    if (!worker)
+    {
+        lmLogError(gWorkerLogGroup, "Worker.postToMain called outside of a worker");
+        return;
+    }
+
+    if (!message)
+    {
+        return;
+    }
+
+    utByteArray *posted = lmNew(NULL) utByteArray();
+
+    if (transfer)
+    {
+        posted->transferFrom(*message);
+    }
+    else
+    {
+        posted->allocateAndCopy(message->getDataPtr(), message->getSize());
+    }
+
+    loom_lightMutex_lock(&worker->lock);
+    worker->outbox.push_back(posted);
+    loom_lightMutex_unlock(&worker->lock);
+}
+
+
+void Worker::dispatch()
+{
+    loom_lightMutex_lock(&lock);
+    utArray<utByteArray *> messages = outbox;
+    utArray<utString>      failures = errors;
+    outbox.clear(true);
+    errors.clear(true);
+    loom_lightMutex_unlock(&lock);
+
+    for (UTsize i = 0; i < messages.size(); i++)
+    {
+        lua_State *L = _OnMessageDelegate.getVM();
+
+        if (!L || !_OnMessageDelegate.getCount())
+        {
+            lmDelete(NULL, messages[i]);
+            continue;
+        }
+
+        // handed to script like a new ByteArray, listeners may keep it
+        NativeTypeBase *nativeType = NativeInterface::getNativeType<utByteArray>();
+        lualoom_newnativeuserdata(L, nativeType, messages[i], true);
+        lualoom_pushnative_userdata(L, NativeInterface::getScriptType(L, nativeType), -1);
+        lua_remove(L, -2);
+        _OnMessageDelegate.incArgCount();
+        _OnMessageDelegate.invoke();
+
+        // a listener may have terminated this worker
+        if (!vm)
+        {
+            for (UTsize j = i + 1; j < messages.size(); j++)
+            {
+                lmDelete(NULL, messages[j]);
+            }
+            return;
+        }
+    }
+
+    for (UTsize i = 0; i < failures.size(); i++)
+    {
+        _OnErrorDelegate.pushArgument(failures[i].c_str());
+        _OnErrorDelegate.invoke();
+    }
+}
+
+
+void Worker::dispatchMessages()
+{
+    // listeners may start and terminate workers
+    utArray<Worker *> running = workers;
+
+    for (UTsize i = 0; i < running.size(); i++)
+    {
+        if (workers.find(running[i]) != UT_NPOS)
+        {
+            running[i]->dispatch();
+        }
+    }
+}
+}
@@ -0,0 +1,126 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _ls_worker_h
+#define _ls_worker_h
+
+#include "loom/common/platform/platformThread.h"
+#include "loom/common/utils/utByteArray.h"
+#include "loom/common/utils/utString.h"
+#include "loom/common/utils/utTypes.h"
+#include "loom/script/native/lsNativeDelegate.h"
+
+namespace LS {
+class LSLuaState;
+class MethodInfo;
+
+/*
+ * Runs a script assembly in a VM of its own on a background thread, so
+ * work like pathfinding or save serialization doesn't hold up the frame.
+ *
+ * The assembly is loaded on the calling thread by start, after which
+ * every message posted is handed to the static onMessage(ByteArray)
+ * method of the worker class on the worker thread, in order. The worker
+ * posts its results back with the static postToMain, they are delivered
+ * through the onMessage delegate on the main thread once per frame by
+ * dispatchMessages. Script errors of the worker go to onError.
+ *
+ * Messages are ByteArrays, copied when posted or transferred, which
+ * leaves the posted array empty instead. Nothing else is shared between
+ * the VMs, and as the worker VM is not ticked natives that need the main
+ * thread (graphics, sound, assets, native delegates) can't be used in
+ * it. A small assembly with just the worker classes loads fastest.
+ */
+class Worker
+{
+public:
+
+    LOOM_DELEGATE(OnMessage);
+    LOOM_DELEGATE(OnError);
+
+    Worker(const char *assemblyPath, const char *className);
+    ~Worker();
+
+    // Loads the assembly and starts the thread, false if the assembly or
+    // the class with its onMessage method weren't found
+    bool start();
+
+    // Queues a message for the worker, transfer empties message instead
+    // of copying it
+    void postMessage(utByteArray *message, bool transfer);
+
+    // Stops the thread once the message being handled is done and closes
+    // the VM, messages not handled yet are dropped
+    void terminate();
+
+    bool isRunning() const
+    {
+        return thread != NULL;
+    }
+
+    // Called in the VM of a worker, queues a message for its onMessage
+    // delegate on the main thread
+    static void postToMain(utByteArray *message, bool transfer);
+
+    // True on the thread of a worker
+    static bool isWorker()
+    {
+        return current != NULL;
+    }
+
+    // Delivers what the workers posted to their onMessage and onError
+    // delegates, called on the main thread every frame
+    static void dispatchMessages();
+
+private:
+
+    utString assemblyPath;
+    utString className;
+
+    LSLuaState   *vm;
+    MethodInfo   *onMessage;
+    ThreadHandle thread;
+
+    // posted for every message and to stop
+    SemaphoreHandle      wake;
+    volatile atomic_int_t stopping;
+
+    // guards the queues below
+    LightMutex lock;
+
+    utArray<utByteArray *> inbox;
+    utArray<utByteArray *> outbox;
+    utArray<utString>      errors;
+
+    // Workers running, only touched on the main thread
+    static utArray<Worker *> workers;
+
+    // The worker of the calling thread, if any
+    static LOOM_THREAD_LOCAL Worker *current;
+
+    static int __stdcall run(void *param);
+
+    void handleMessage(utByteArray *message);
+    void postError(const char *error);
+
+    void dispatch();
+};
+}
+#endif
@@ -26,6 +26,7 @@
 namespace LS {
 utByteArray           *BinReader::sBytes = NULL;
 utArray<const char *> BinReader::stringPool;
+utArray<UThash>       BinReader::stringPoolHashes;
 const char            *BinReader::stringBuffer = NULL;
 LSLuaState            *BinReader::vm           = NULL;
 
@@ -40,6 +41,7 @@ void BinReader::readStringPool()
     int stringPoolSize = sBytes->readInt();
 
     stringPool.resize(stringPoolSize);
+    stringPoolHashes.resize(stringPoolSize);
 
     // the complete size of the string buffer
     int stringBufferSize = sBytes->readInt();
@@ -62,7 +64,8 @@ void BinReader::readStringPool()
 
         *p = 0;
         p++;
-        stringPool[i] = pstring;
+        stringPool[i]       = pstring;
+        stringPoolHashes[i] = utHashedString::hash(pstring);
     }
 }
 
@@ -203,7 +206,7 @@ void BinReader::readMethodBase(MethodBase *mbase)
         Type *ptype = NULL;
         if (bytes->readBoolean())
         {
-            ptype = getType(readPoolString());
+            ptype = readPoolType();
         }
 
         bool hasDefault = bytes->readBoolean();
@@ -212,7 +215,7 @@ void BinReader::readMethodBase(MethodBase *mbase)
         int numTemplateTypes = bytes->readInt();
         for (int j = 0; j < numTemplateTypes; j++)
         {
-            Type *ttype = getType(readPoolString());
+            Type *ttype = readPoolType();
             param->addTemplateType(ttype);
         }
 
@@ -240,7 +243,7 @@ void BinReader::readMethodBase(MethodBase *mbase)
     {
         // empty bytecode
         ByteCode byteCode;
-        byteCode.deserialize(bytes);
+        byteCode.deserialize(bytes, true);
 
         lua_CFunction function = NULL;
         lua_State     *L       = vm->VM();
@@ -297,7 +300,7 @@ void BinReader::readMethodBase(MethodBase *mbase)
     else
     {
         ByteCode *byteCode = lmNew(NULL) ByteCode();
-        byteCode->deserialize(bytes);
+        byteCode->deserialize(bytes, true);
         mbase->setByteCode(byteCode);
     }
 }
@@ -317,7 +320,7 @@ MethodInfo *BinReader::readMethodInfo(Type *type)
     Type *retType = NULL;
     if (bytes->readBoolean())
     {
-        retType = getType(readPoolString());
+        retType = readPoolType();
     }
 
     methodInfo->memberType.method = true;
@@ -370,7 +373,7 @@ PropertyInfo *BinReader::readProperty(Type *type)
     Type *ptype = NULL;
     if (bytes->readBoolean())
     {
-        ptype = getType(readPoolString());
+        ptype = readPoolType();
     }
 
     prop->type = ptype;
@@ -443,7 +446,7 @@ FieldInfo *BinReader::readField(Type *type)
 
     if (bytes->readBoolean())
     {
-        fieldType = getType(readPoolString());
+        fieldType = readPoolType();
     }
 
     field->type = fieldType;
@@ -512,7 +515,7 @@ void BinReader::readClass(Type *type)
     }
 
     // base type
-    Type *baseType = getType(readPoolString());
+    Type *baseType = readPoolType();
     if (baseType)
     {
         type->setBaseType(baseType);
@@ -523,7 +526,7 @@ void BinReader::readClass(Type *type)
 
     for (int i = 0; i < numInterfaces; i++)
     {
-        Type *interface = getType(readPoolString());
+        Type *interface = readPoolType();
         type->addInterface(interface);
     }
 
@@ -532,12 +535,12 @@ void BinReader::readClass(Type *type)
 
     for (int i = 0; i < numDelegateTypes; i++)
     {
-        Type *delegateType = getType(readPoolString());
+        Type *delegateType = readPoolType();
         type->addDelegateType(delegateType);
     }
 
     // delegateReturnType
-    Type *delegateReturnType = getType(readPoolString());
+    Type *delegateReturnType = readPoolType();
     if (delegateReturnType)
     {
         type->setDelegateReturnType(delegateReturnType);
@@ -550,7 +553,7 @@ void BinReader::readClass(Type *type)
     {
         // If the type doesn't exist in here, ignore it.
         // It's been removed because it's already loaded.
-        Type *import = getType(readPoolString());
+        Type *import = readPoolType();
         if (import != NULL)
         {
             type->addImport(import);
@@ -597,11 +600,11 @@ void BinReader::readClass(Type *type)
     ByteCode *byteCode;
 
     byteCode = lmNew(NULL) ByteCode();
-    byteCode->deserialize(bytes);
+    byteCode->deserialize(bytes, true);
     type->setBCStaticInitializer(byteCode);
 
     byteCode = lmNew(NULL) ByteCode();
-    byteCode->deserialize(bytes);
+    byteCode->deserialize(bytes, true);
     type->setBCInstanceInitializer(byteCode);
 }
 
@@ -926,6 +929,7 @@ Assembly *BinReader::loadExecutableBody()
 	}
     
 	stringPool.clear();
+    stringPoolHashes.clear();
     references.clear();
     types.clear();
     
@@ -81,6 +81,9 @@ class BinReader {
     static const char *stringBuffer;
     // The buffer is sliced into an array for quick lookups
     static utArray<const char *> stringPool;
+    // The utHashedString hash of each pool string, computed once at load so
+    // type lookups by name don't rehash (or copy) it
+    static utArray<UThash> stringPoolHashes;
     // The byte array of the entire binary
     static utByteArray *sBytes;
     // initialized the string pool from the binary file
@@ -100,26 +103,51 @@ class BinReader {
         return stringPool[i];
     }
 
+    /*
+     * Reads a type name from the string pool and returns the associated Type
+     */
+    static Type *readPoolType()
+    {
+        int i = sBytes->readInt();
+
+        if (i == -1)
+        {
+            return NULL;
+        }
+
+        return getType(stringPool[i], stringPoolHashes[i]);
+    }
+
     /*
      * Given a fully qualified type name, return the associated Type
      */
     static Type *getType(const char *fullname)
     {
-        if (fullname && strlen(fullname))
+        if (fullname && fullname[0])
         {
-            if (types.find(fullname) == UT_NPOS)
-            {
-                return vm->getType(fullname);
-            }
-
-            TypeIndex **tindex = types.get(fullname);
-            assert(tindex);
-            return (*tindex)->type;
+            return getType(fullname, utHashedString::hash(fullname));
         }
 
         return NULL;
     }
 
+    static Type *getType(const char *fullname, UThash hash)
+    {
+        if (!fullname[0])
+        {
+            return NULL;
+        }
+
+        TypeIndex **tindex = types.getByHash(hash);
+
+        if (!tindex)
+        {
+            return vm->getType(fullname, hash);
+        }
+
+        return (*tindex)->type;
+    }
+
     /*
      * Given a fully qualified type name, seek to the type in the binary data
      */
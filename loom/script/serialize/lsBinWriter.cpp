@@ -678,18 +678,18 @@ void BinWriter::writeAssembly(json_t *json)
 }
 
 
-void BinWriter::writeExecutable(const char *path, const char *sjson, int jsonSize)
+void BinWriter::writeExecutable(const char *path, const char *sjson, int jsonSize, int compressionLevel)
 {
     json_error_t jerror;
     json_t       *json = json_loadb(sjson, jsonSize, 0, &jerror);
 
     lmAssert(json, "Error loading Assembly json: %s\n %s %i\n", jerror.source, jerror.text, jerror.line);
 
-    writeExecutable(path, json);
+    writeExecutable(path, json, compressionLevel);
 }
 
 
-void BinWriter::writeExecutable(const char *path, json_t *sjson)
+void BinWriter::writeExecutable(const char *path, json_t *sjson, int compressionLevel)
 {
     stringPool.clear();
     binWriters.clear();
@@ -780,26 +780,43 @@ void BinWriter::writeExecutable(const char *path, json_t *sjson)
 
     int dataLength = bytes.getPosition();
 
-    Bytef *compressed = (Bytef *) lmAlloc(gBinWriterAllocator, dataLength);
-    uLongf length = (uLongf) dataLength;
-    int ok = compress(compressed, &length, (Bytef *) bytes.getDataPtr(), (uLong) dataLength);
-    lmAssert(ok == Z_OK, "problem compressing executable assemby");
-
-    bytes.clear();
-    bytes.writeUnsignedInt(LOOM_BINARY_ID);
-    bytes.writeUnsignedInt(LOOM_BINARY_VERSION_MAJOR);
-    bytes.writeUnsignedInt(LOOM_BINARY_VERSION_MINOR);
-    bytes.writeUnsignedInt((unsigned int)dataLength);
+    utByteArray header;
+    header.writeUnsignedInt(LOOM_BINARY_ID);
+    header.writeUnsignedInt(LOOM_BINARY_VERSION_MAJOR);
+    header.writeUnsignedInt(compressionLevel == LOOM_BINARY_COMPRESSION_STORED ? LOOM_BINARY_VERSION_MINOR_STORED : LOOM_BINARY_VERSION_MINOR);
+    header.writeUnsignedInt((unsigned int)dataLength);
 
     utFileStream binStream;
     binStream.open(path, utStream::SM_WRITE);
     // write header
-    binStream.write(bytes.getDataPtr(), sizeof(unsigned int) * 4);
+    binStream.write(header.getDataPtr(), sizeof(unsigned int) * 4);
+
+    if (compressionLevel == LOOM_BINARY_COMPRESSION_STORED)
+    {
+        // write stored data, the header keeps it 16 byte aligned in the file
+        binStream.write(bytes.getDataPtr(), dataLength);
+        binStream.close();
+        return;
+    }
+
+    // inflate time barely depends on the level, lower levels mostly make
+    // the build faster at the cost of a larger executable
+    uLongf length = compressBound((uLong) dataLength);
+
+    if (!gBinWriterAllocator)
+    {
+        gBinWriterAllocator = loom_allocator_getTaggedAllocator("script.binwriter");
+    }
+
+    Bytef *compressedData = (Bytef *) lmAlloc(gBinWriterAllocator, length);
+    int ok = compress2(compressedData, &length, (Bytef *) bytes.getDataPtr(), (uLong) dataLength, compressionLevel);
+    lmAssert(ok == Z_OK, "problem compressing executable assemby");
+
     // write compressed data
-    binStream.write(compressed, length);
+    binStream.write(compressedData, length);
 
     binStream.close();
 
-    lmFree(gBinWriterAllocator, compressed);
+    lmFree(gBinWriterAllocator, compressedData);
 }
 }
@@ -41,9 +41,20 @@ namespace LS {
 #define LOOM_BINARY_VERSION_MAJOR    1
 #define LOOM_BINARY_VERSION_MINOR    1
 
+// minor version of executables stored without compression, which can be
+// read in place from a mapped file
+#define LOOM_BINARY_VERSION_MINOR_STORED    2
+
+// compression levels for writeExecutable, these follow zlib with the
+// exception of level 0 which writes the stored format
+#define LOOM_BINARY_COMPRESSION_STORED     0
+#define LOOM_BINARY_COMPRESSION_FAST       1
+#define LOOM_BINARY_COMPRESSION_DEFAULT    -1
+
 /*
  * BinWriter recursively writes an executable binary assembly given a JSON source assembly
- * The binary assembly will include all dependencies linked in and uses zlib compression
+ * The binary assembly will include all dependencies linked in and uses zlib compression,
+ * unless written stored
  */
 class BinWriter {
     /*
@@ -179,14 +190,15 @@ public:
      * generates an executable assembly with all dependencies linked
      * in
      */
-    static void writeExecutable(const char *path, const char *sjson, int jsonSize);
+    static void writeExecutable(const char *path, const char *sjson, int jsonSize, int compressionLevel = LOOM_BINARY_COMPRESSION_DEFAULT);
 
     /*
      * Given a path, source JSON, and the size of the JSON
      * generates an executable assembly with all dependencies linked
-     * in
+     * in, with LOOM_BINARY_COMPRESSION_STORED the data is stored as is so
+     * the runtime can use the mapped file directly instead of inflating it
      */
-    static void writeExecutable(const char *path, json_t *sjson);
+    static void writeExecutable(const char *path, json_t *sjson, int compressionLevel = LOOM_BINARY_COMPRESSION_DEFAULT);
 };
 }
 #endif
@@ -0,0 +1,97 @@
+#ifndef _ASSETS_TELEMETRYHISTORY_H_
+#define _ASSETS_TELEMETRYHISTORY_H_
+
+#include "jansson.h"
+#include "loom/common/core/telemetry.h"
+#include "loom/common/utils/utString.h"
+
+// Number of tick metrics summarized, see historyMetrics in telemetryHistory.cpp
+#define TELEMETRY_HISTORY_METRICS 4
+
+// Collects the tick metrics of one client into sessions kept apart by the
+// application, device and build version the ticks come from. Every so many
+// ticks the session is summarized into percentiles and stored as
+//
+//   <root>/<app>/<device>/<build>/<session>.json
+//
+// then compared against the baseline of the device stored in
+//
+//   <root>/<app>/<device>/baseline.json
+//
+// Percentiles that grew over the threshold are logged as regressions and
+// sent to the stream clients. The first summary of a device becomes its
+// baseline, after that it only moves when promoted, e.g. after a release.
+// Not thread safe, the telemetry server only uses it under its lock.
+class TelemetryHistory
+{
+public:
+    TelemetryHistory();
+    ~TelemetryHistory();
+
+    // Set where the ticks come from, starts a new session if it changed
+    // Ticks are ignored until this is known
+    void setIdentity(const char *app, const char *build, const char *device);
+
+    // Add the values of a tick to the current session, returns true
+    // if the session was summarized and the report updated
+    bool addTick(TableValues<TickMetricValue>& values);
+
+    // Directory the histories are stored in
+    static void setRoot(const char *root);
+
+    // Device name used instead of the one reported by the clients,
+    // e.g. for a fixed test device, empty to use the reported ones
+    static void setDeviceName(const char *name);
+
+    // Relative growth of a percentile over the baseline reported as a regression
+    static void setThreshold(double threshold);
+
+    // Make the latest summary of every client the baseline of its device
+    static void promoteAll();
+
+    // The latest comparison of every client serialized as JSON
+    static utString reportJSONString;
+
+private:
+    utString app;
+    utString build;
+    utString device;
+
+    // Name of the current session, unique within the build directory
+    utString session;
+
+    // Ticks added to the current session
+    int ticks;
+
+    // Samples of the current session per metric in historyMetrics order
+    utArray<double> samples[TELEMETRY_HISTORY_METRICS];
+
+    // Latest summary of the session, NULL before the first one
+    json_t *summary;
+
+    // Baseline of the device, NULL if there is none yet
+    json_t *baseline;
+
+    // True while the baseline is the current session, it follows the session till it ends
+    bool baselineSession;
+
+    // Latest summary compared against the baseline
+    json_t *report;
+
+    // Bit per metric and percentile already logged as a regression this session
+    unsigned int reported;
+
+    utString getDeviceDir();
+
+    void beginSession();
+    void loadBaseline();
+    bool saveBaseline();
+
+    // Summarize and store the session and compare it against the baseline
+    void summarize();
+    void compare();
+
+    static void updateReportJSON();
+};
+
+#endif
@@ -4,6 +4,8 @@
 #include "civetweb.h"
 #include "loom/common/utils/json.h"
 #include "loom/common/assets/assetProtocol.h"
+#include "loom/common/core/telemetry.h"
+#include "telemetryHistory.h"
 
 // Asset protocol listener for telemetry messages
 class TelemetryListener : public AssetProtocolMessageListener
@@ -12,10 +14,25 @@ public:
     // Handle the asset protocol telemetry messages
     virtual bool handleMessage(int fourcc, AssetProtocolHandler *handler, NetworkBuffer& buffer);
 
+    // Decoder of the streamed ticks of this connection
+    TelemetryStreamReader streamReader;
+
+    // True if a stream restart was requested and hasn't arrived yet
+    bool awaitingReset;
+
+    TelemetryListener() : awaitingReset(false) {}
+
     JSON tickValuesJSON;
     JSON tickRangesJSON;
     JSON tickMetricsJSON;
 
+    // Summaries of the ticks of this connection compared against the baseline
+    // Declared after the JSON members, as it relies on the allocators they set up
+    TelemetryHistory history;
+
+    // Make the latest summaries of all the connections the baselines of their devices
+    static void promoteBaselines();
+
     // The main JSON string already serialized and ready for transmission
     static utString tickMetricsJSONString;
 
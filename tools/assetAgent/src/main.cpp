@@ -36,6 +36,8 @@
 
 #include "loom/common/assets/assetProtocol.h"
 
+#include "zlib.h"
+
 #include "loom/common/core/allocator.h"
 
 // For realpath
@@ -110,6 +112,21 @@ struct FileModificationNote
 static MutexHandle gActiveSocketsMutex = NULL;
 static utArray<AssetProtocolHandler *> gActiveHandlers;
 
+// Files being sent to clients which announced delta transfers, kept until
+// the client has replied with the hashes of the copy it has. Guarded by
+// gActiveSocketsMutex, like the handlers.
+struct OutgoingTransfer
+{
+    int                    clientId;
+    int                    id;
+    utString               path;
+    utArray<unsigned char> bits;
+};
+
+static utArray<OutgoingTransfer *> gOutgoingTransfers;
+static utArray<int>                gDeltaClients;
+static int                         gNextTransferId = 1;
+
 // Threads for talking to socket and watching files.
 static ThreadHandle gFileWatcherThread    = NULL;
 static ThreadHandle gSocketListenerThread = NULL;
@@ -472,6 +489,118 @@ static utArray<FileEntryDelta> *compareFileEntries(utArray<FileEntry> *oldList,
 // Take a difference report from compareFileEntries and issue appropriate
 // file modification notes, and check whether they have settled. If so,
 // transmit updates to clients.
+// Works out which chunks of a delta transfer changed from the hashes of the
+// client's copy, and sends just those.
+class DeltaTransferListener : public AssetProtocolMessageListener
+{
+public:
+
+    virtual bool handleMessage(int fourcc, AssetProtocolHandler *handler, NetworkBuffer& buffer)
+    {
+        switch (fourcc)
+        {
+        case LOOM_FOURCC('X', 'F', 'R', '2'):
+            lmLogDebug(gAssetAgentLogGroup, "Client %d takes delta transfers", handler->getId());
+            gDeltaClients.push_back(handler->getId());
+            return true;
+
+        case LOOM_FOURCC('F', 'H', 'A', 'S'):
+            handleHashes(handler, buffer);
+            return true;
+        }
+
+        return false;
+    }
+
+    void handleHashes(AssetProtocolHandler *handler, NetworkBuffer& buffer)
+    {
+        int id         = buffer.readInt();
+        int chunkCount = buffer.readInt();
+
+        utArray<unsigned int> crcs;
+        crcs.resize(chunkCount);
+        for (int i = 0; i < chunkCount; i++)
+        {
+            crcs[i] = (unsigned int)buffer.readInt();
+        }
+
+        buffer.readCheckpoint(0xDEADBEE5);
+
+        OutgoingTransfer *transfer = NULL;
+        for (UTsize i = 0; i < gOutgoingTransfers.size(); i++)
+        {
+            if ((gOutgoingTransfers[i]->clientId == handler->getId()) && (gOutgoingTransfers[i]->id == id))
+            {
+                transfer = gOutgoingTransfers[i];
+                gOutgoingTransfers.erase(i, true);
+                break;
+            }
+        }
+
+        if (!transfer)
+        {
+            lmLogError(gAssetAgentLogGroup, "Client %d sent hashes for unknown transfer %d", handler->getId(), id);
+            return;
+        }
+
+        // Send the chunks the client doesn't have.
+        const int           chunkSize  = ASSET_PROTOCOL_CHUNK_SIZE;
+        const unsigned char *bits      = transfer->bits.ptr();
+        const int           length     = (int)transfer->bits.size();
+        int                 chunksSent = 0;
+        int                 chunkIndex = 0;
+
+        for (int offset = 0; offset < length; offset += chunkSize, chunkIndex++)
+        {
+            int chunkLength = length - offset < chunkSize ? length - offset : chunkSize;
+
+            if ((chunkIndex < chunkCount) && ((unsigned int)crc32(0, bits + offset, chunkLength) == crcs[chunkIndex]))
+            {
+                continue;
+            }
+
+            handler->sendFileChunk(id, chunkIndex, bits + offset, chunkLength);
+            chunksSent++;
+        }
+
+        handler->sendFileEnd(id, chunksSent);
+
+        lmLogDebug(gAssetAgentLogGroup, "Sent %d of %d chunks of '%s' to client %d", chunksSent, chunkIndex, transfer->path.c_str(), handler->getId());
+
+        lmDelete(NULL, transfer);
+    }
+};
+
+
+static bool isDeltaClient(int clientId)
+{
+    return gDeltaClients.find(clientId) != UT_NPOS;
+}
+
+
+// Starts sending a file to a client which takes delta transfers. Only the
+// manifest goes out now, so files are pipelined; the chunks follow once the
+// client has replied. Called with gActiveSocketsMutex held.
+static void startDeltaTransfer(AssetProtocolHandler *handler, const char *path, void *bits, long length, int pendingFiles)
+{
+    OutgoingTransfer *transfer = lmNew(NULL) OutgoingTransfer();
+
+    transfer->clientId = handler->getId();
+    transfer->id       = gNextTransferId++;
+    transfer->path     = path;
+    transfer->bits.resize(length);
+    if (length)
+    {
+        memcpy(transfer->bits.ptr(), bits, length);
+    }
+
+    gOutgoingTransfers.push_back(transfer);
+
+    unsigned int crc = (unsigned int)crc32(0, (const Bytef *)bits, (uInt)length);
+    handler->sendFileManifest(transfer->id, path, (int)length, crc, pendingFiles);
+}
+
+
 static void processFileEntryDeltas(utArray<FileEntryDelta> *deltas)
 {
     int curTime = platform_getMilliseconds();
@@ -600,7 +729,14 @@ static void processFileEntryDeltas(utArray<FileEntryDelta> *deltas)
                 continue;
             }
 
-            gActiveHandlers[j]->sendFile(canonicalFile, fileBits, fileBitsLength, totalPendingTransfers);
+            if (isDeltaClient(gActiveHandlers[j]->getId()))
+            {
+                startDeltaTransfer(gActiveHandlers[j], canonicalFile, fileBits, fileBitsLength, totalPendingTransfers);
+            }
+            else
+            {
+                gActiveHandlers[j]->sendFile(canonicalFile, fileBits, fileBitsLength, totalPendingTransfers);
+            }
 
             // If it has been more than a second, note that we are still working.
             const int remainingTransferCount = (totalPendingTransfers * gActiveHandlers.size()) - j;
@@ -674,8 +810,8 @@ static int fileWatcherThread(void *payload)
  *
  * Useful for fully synching client with the current asset state.
  *
- * TODO: Optimize to use hashes to only transmit modified data, based on
- * client's starting assets.
+ * Clients which take delta transfers are only sent the chunks that differ
+ * from the copy they have.
  */
 static void postAllFiles(int clientId = -1)
 {
@@ -773,6 +909,7 @@ static int socketListeningThread(void *payload)
 
         AssetProtocolHandler *handler = gActiveHandlers.back();
         handler->registerListener(new TelemetryListener());
+        handler->registerListener(new DeltaTransferListener());
         if (TelemetryServer::isRunning()) handler->sendCommand("telemetryEnable");
 
         // Send it all of our files.
@@ -871,6 +1008,12 @@ void DLLEXPORT assetAgent_run(IdleCallback idleCb, LogCallback logCb, FileChange
 
     if (optionEquals("telemetry", "true")) TelemetryServer::start();
 
+    // Tick summaries are kept per build and device and compared against a baseline
+    utString *historyPath = optionGet("telemetryHistory");
+    if (historyPath != NULL) TelemetryHistory::setRoot(historyPath->c_str());
+    if (optionGet("telemetryDevice") != NULL) TelemetryHistory::setDeviceName(optionGet("telemetryDevice")->c_str());
+    if (optionGet("telemetryThreshold") != NULL) TelemetryHistory::setThreshold(atof(optionGet("telemetryThreshold")->c_str()) / 100);
+
 
 
     // Set up the log callback.
@@ -939,6 +1082,10 @@ void DLLEXPORT assetAgent_command(const char *cmd)
     {
         listClients();
     }
+    else if (strstr(cmd, ".baseline") != 0)
+    {
+        TelemetryListener::promoteBaselines();
+    }
     else if (strstr(cmd, ".telemetry") != 0)
     {
         TelemetryServer::isRunning() ? TelemetryServer::stop() : TelemetryServer::start();
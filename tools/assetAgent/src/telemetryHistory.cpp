@@ -0,0 +1,415 @@
+#include "telemetryHistory.h"
+
+#include "loom/common/core/allocator.h"
+#include "loom/common/core/log.h"
+#include "loom/common/platform/platformFile.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LTH_DEFAULT_ROOT "./telemetry-history"
+#define LTH_DEFAULT_THRESHOLD 0.1
+
+// Ticks between summaries of a session
+#define LTH_SUMMARY_TICKS 600
+
+// Ticks after which a session is closed and a new one begins, bounding
+// the samples kept and giving long runs several comparable summaries
+#define LTH_SESSION_TICKS 36000
+
+// Percentiles of metrics with fewer samples are neither compared nor
+// made a baseline, as they mostly hold startup
+#define LTH_MIN_SAMPLES 300
+
+lmDefineLogGroup(gTelemetryHistoryLogGroup, "lth", true, LoomLogInfo)
+
+// Metrics summarized per session
+static const struct HistoryMetric
+{
+    // Name in the summaries
+    const char *name;
+
+    // Tick value the samples are taken from
+    const char *value;
+
+    // Scale of the tick value to the summary unit
+    double scale;
+
+    // Growth below this is noise whatever the threshold says
+    double minChange;
+} historyMetrics[TELEMETRY_HISTORY_METRICS] = {
+    { "frameMs",  "tick.time",        1e-6, 0.5  },
+    { "gcMs",     "gc.update.time",   1e-6, 0.25 },
+    { "batches",  "gfx.quad.batches", 1,    1    },
+    { "draws",    "gfx.quad.draws",   1,    1    },
+};
+
+static const struct HistoryPercentile
+{
+    const char *name;
+    double p;
+} historyPercentiles[] = {
+    { "p50", 0.50 },
+    { "p95", 0.95 },
+    { "p99", 0.99 },
+};
+
+#define LTH_PERCENTILES ((int)(sizeof(historyPercentiles) / sizeof(historyPercentiles[0])))
+
+utString TelemetryHistory::reportJSONString;
+
+static utString historyRoot = LTH_DEFAULT_ROOT;
+static utString historyDeviceName;
+static double historyThreshold = LTH_DEFAULT_THRESHOLD;
+
+// Every live history, for promoteAll and the combined report
+static utArray<TelemetryHistory*> histories;
+
+// Used to tell apart sessions beginning within the same second
+static int sessionCounter = 0;
+
+
+static int compareSamples(const void *a, const void *b)
+{
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+
+    return da < db ? -1 : (da > db ? 1 : 0);
+}
+
+// Nearest rank percentile of sorted samples
+static double percentile(const utArray<double>& sorted, double p)
+{
+    int rank = (int)ceil(p * sorted.size());
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// Names become directories, keep them to a safe set of characters
+static utString pathComponent(const char *name)
+{
+    if (name == NULL || name[0] == 0 || !strcmp(name, ".") || !strcmp(name, "..")) return "unknown";
+
+    utString component = name;
+
+    for (char *c = const_cast<char*>(component.c_str()); *c; c++)
+    {
+        bool safe = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') || *c == '.' || *c == '-' || *c == '_';
+        if (!safe) *c = '_';
+    }
+
+    return component;
+}
+
+static double getMetricPercentile(json_t *summary, const char *metric, const char *name, int *samples)
+{
+    json_t *entry = json_object_get(json_object_get(summary, "metrics"), metric);
+
+    *samples = (int)json_integer_value(json_object_get(entry, "samples"));
+
+    return json_number_value(json_object_get(entry, name));
+}
+
+
+TelemetryHistory::TelemetryHistory() : ticks(0), summary(NULL), baseline(NULL), baselineSession(false), report(NULL), reported(0)
+{
+    histories.push_back(this);
+}
+
+TelemetryHistory::~TelemetryHistory()
+{
+    histories.erase(histories.find(this));
+
+    if (summary) json_decref(summary);
+    if (baseline) json_decref(baseline);
+    if (report) json_decref(report);
+
+    updateReportJSON();
+}
+
+void TelemetryHistory::setRoot(const char *root)
+{
+    if (root == NULL) return;
+    historyRoot = root;
+}
+
+void TelemetryHistory::setDeviceName(const char *name)
+{
+    historyDeviceName = name ? name : "";
+}
+
+void TelemetryHistory::setThreshold(double threshold)
+{
+    historyThreshold = threshold;
+}
+
+void TelemetryHistory::setIdentity(const char *newApp, const char *newBuild, const char *newDevice)
+{
+    utString nextApp = pathComponent(newApp);
+    utString nextBuild = pathComponent(newBuild);
+    utString nextDevice = pathComponent(historyDeviceName.length() > 0 ? historyDeviceName.c_str() : newDevice);
+
+    // Reconnects of the same build continue the session
+    if (nextApp == app && nextBuild == build && nextDevice == device) return;
+
+    // Keep what was collected for the previous identity
+    if (session.length() > 0 && ticks >= LTH_SUMMARY_TICKS) summarize();
+
+    app = nextApp;
+    build = nextBuild;
+    device = nextDevice;
+
+    lmLog(gTelemetryHistoryLogGroup, "Recording %s build %s on %s", app.c_str(), build.c_str(), device.c_str());
+
+    loadBaseline();
+    beginSession();
+}
+
+bool TelemetryHistory::addTick(TableValues<TickMetricValue>& values)
+{
+    if (session.length() == 0) return false;
+
+    for (int i = 0; i < TELEMETRY_HISTORY_METRICS; i++)
+    {
+        TickMetricValue *value = values.table.get(utHashedString(historyMetrics[i].value));
+        if (value != NULL) samples[i].push_back(value->value * historyMetrics[i].scale);
+    }
+
+    ticks++;
+
+    if (ticks % LTH_SUMMARY_TICKS != 0) return false;
+
+    summarize();
+    if (ticks >= LTH_SESSION_TICKS) beginSession();
+
+    return true;
+}
+
+void TelemetryHistory::promoteAll()
+{
+    for (UTsize i = 0; i < histories.size(); i++)
+    {
+        TelemetryHistory *history = histories[i];
+
+        if (history->summary == NULL)
+        {
+            continue;
+        }
+
+        if (history->saveBaseline())
+        {
+            lmLog(gTelemetryHistoryLogGroup, "Baseline of %s on %s is now build %s", history->app.c_str(), history->device.c_str(), history->build.c_str());
+            history->reported = 0;
+            history->baselineSession = false;
+            history->compare();
+        }
+    }
+
+    updateReportJSON();
+}
+
+utString TelemetryHistory::getDeviceDir()
+{
+    return historyRoot + "/" + app + "/" + device;
+}
+
+void TelemetryHistory::beginSession()
+{
+    char stamp[32];
+    time_t now = time(NULL);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&now));
+
+    session = utStringFormat("%s-%d", stamp, sessionCounter++);
+    ticks = 0;
+    reported = 0;
+    baselineSession = false;
+
+    for (int i = 0; i < TELEMETRY_HISTORY_METRICS; i++)
+    {
+        samples[i].clear();
+    }
+}
+
+void TelemetryHistory::loadBaseline()
+{
+    if (baseline) json_decref(baseline);
+
+    utString path = getDeviceDir() + "/baseline.json";
+
+    json_error_t error;
+    baseline = json_load_file(path.c_str(), 0, &error);
+
+    if (baseline && !json_is_object(baseline))
+    {
+        lmLogWarn(gTelemetryHistoryLogGroup, "Ignoring the malformed baseline %s", path.c_str());
+        json_decref(baseline);
+        baseline = NULL;
+    }
+
+    if (baseline)
+    {
+        const char *baselineBuild = json_string_value(json_object_get(baseline, "build"));
+        lmLog(gTelemetryHistoryLogGroup, "Comparing against the baseline build %s", baselineBuild ? baselineBuild : "?");
+    }
+}
+
+bool TelemetryHistory::saveBaseline()
+{
+    utString dir = getDeviceDir();
+    utString path = dir + "/baseline.json";
+
+    platform_makeDir(dir.c_str());
+
+    if (json_dump_file(summary, path.c_str(), JSON_INDENT(2)) != 0)
+    {
+        lmLogError(gTelemetryHistoryLogGroup, "Unable to write the baseline to %s", path.c_str());
+        return false;
+    }
+
+    if (baseline) json_decref(baseline);
+    baseline = json_deep_copy(summary);
+
+    return true;
+}
+
+void TelemetryHistory::summarize()
+{
+    json_t *metrics = json_object();
+
+    utArray<double> sorted;
+
+    for (int i = 0; i < TELEMETRY_HISTORY_METRICS; i++)
+    {
+        if (samples[i].size() == 0) continue;
+
+        sorted = samples[i];
+        qsort(sorted.ptr(), sorted.size(), sizeof(double), compareSamples);
+
+        json_t *entry = json_object();
+        json_object_set_new(entry, "samples", json_integer(sorted.size()));
+
+        for (int j = 0; j < LTH_PERCENTILES; j++)
+        {
+            json_object_set_new(entry, historyPercentiles[j].name, json_real(percentile(sorted, historyPercentiles[j].p)));
+        }
+
+        json_object_set_new(metrics, historyMetrics[i].name, entry);
+    }
+
+    if (summary) json_decref(summary);
+
+    summary = json_object();
+    json_object_set_new(summary, "app", json_string(app.c_str()));
+    json_object_set_new(summary, "build", json_string(build.c_str()));
+    json_object_set_new(summary, "device", json_string(device.c_str()));
+    json_object_set_new(summary, "session", json_string(session.c_str()));
+    json_object_set_new(summary, "ticks", json_integer(ticks));
+    json_object_set_new(summary, "metrics", metrics);
+
+    utString dir = getDeviceDir() + "/" + build;
+    utString path = dir + "/" + session + ".json";
+
+    platform_makeDir(dir.c_str());
+
+    if (json_dump_file(summary, path.c_str(), JSON_INDENT(2)) != 0)
+    {
+        lmLogError(gTelemetryHistoryLogGroup, "Unable to write the session summary to %s", path.c_str());
+    }
+
+    // The first session of a device with enough frames is what later builds
+    // are held to, other metrics may be missing in ticks they weren't updated
+    if (baseline == NULL && samples[0].size() >= LTH_MIN_SAMPLES && saveBaseline())
+    {
+        lmLog(gTelemetryHistoryLogGroup, "No baseline for %s on %s yet, using build %s", app.c_str(), device.c_str(), build.c_str());
+        baselineSession = true;
+    }
+    else if (baselineSession)
+    {
+        saveBaseline();
+    }
+
+    compare();
+    updateReportJSON();
+}
+
+void TelemetryHistory::compare()
+{
+    if (report) json_decref(report);
+
+    report = json_deep_copy(summary);
+
+    json_t *regressions = json_array();
+    json_object_set_new(report, "regressions", regressions);
+
+    if (baseline == NULL) return;
+
+    json_t *against = json_object();
+    json_object_set(against, "build", json_object_get(baseline, "build"));
+    json_object_set(against, "session", json_object_get(baseline, "session"));
+    json_object_set(against, "metrics", json_object_get(baseline, "metrics"));
+    json_object_set_new(report, "baseline", against);
+
+    const char *baselineBuild = json_string_value(json_object_get(baseline, "build"));
+
+    for (int i = 0; i < TELEMETRY_HISTORY_METRICS; i++)
+    {
+        const HistoryMetric &metric = historyMetrics[i];
+
+        for (int j = 0; j < LTH_PERCENTILES; j++)
+        {
+            const char *name = historyPercentiles[j].name;
+
+            int baseSamples, curSamples;
+            double base = getMetricPercentile(baseline, metric.name, name, &baseSamples);
+            double cur = getMetricPercentile(summary, metric.name, name, &curSamples);
+
+            if (baseSamples < LTH_MIN_SAMPLES || curSamples < LTH_MIN_SAMPLES) continue;
+
+            if (cur - base <= metric.minChange) continue;
+
+            double change = base > 0 ? cur / base - 1 : 1;
+            if (change <= historyThreshold) continue;
+
+            json_t *regression = json_object();
+            json_object_set_new(regression, "metric", json_string(metric.name));
+            json_object_set_new(regression, "percentile", json_string(name));
+            json_object_set_new(regression, "baseline", json_real(base));
+            json_object_set_new(regression, "current", json_real(cur));
+            json_object_set_new(regression, "change", json_real(change));
+            json_array_append_new(regressions, regression);
+
+            // Summaries repeat during a session, warn about each regression once
+            unsigned int bit = 1u << (i * LTH_PERCENTILES + j);
+            if (reported & bit) continue;
+            reported |= bit;
+
+            lmLogWarn(gTelemetryHistoryLogGroup, "Regression in %s build %s on %s against build %s: %s %s %.2f -> %.2f (%+.0f%%)",
+                      app.c_str(), build.c_str(), device.c_str(), baselineBuild ? baselineBuild : "?",
+                      metric.name, name, base, cur, change * 100);
+        }
+    }
+}
+
+// Collect the reports of all the clients into one JSON string
+void TelemetryHistory::updateReportJSON()
+{
+    json_t *data = json_array();
+
+    for (UTsize i = 0; i < histories.size(); i++)
+    {
+        if (histories[i]->report) json_array_append(data, histories[i]->report);
+    }
+
+    json_t *root = json_object();
+    json_object_set_new(root, "status", json_string("baseline"));
+    json_object_set_new(root, "data", data);
+
+    // Allocated with the functions JSON sets up, which the listeners already used
+    char *serialized = json_dumps(root, JSON_COMPACT);
+    reportJSONString = serialized ? serialized : "";
+    lmFree(NULL, serialized);
+
+    json_decref(root);
+}
@@ -10,6 +10,7 @@
 #define LTS_MAX_CLIENTS 5
 #define LTS_TICK_URI "/tick"
 #define LTS_STREAM_URI "/stream"
+#define LTS_BASELINE_URI "/baseline"
 #define LTS_SDK_SUBDIR "/telemetry/www/"
 
 lmDefineLogGroup(gTelemetryServerLogGroup, "lts", true, LoomLogInfo)
@@ -79,6 +80,14 @@ void StreamReadyHandler(struct mg_connection * conn, void *cbdata)
     lmAssert(client->state == 1, "Websocket invalid state");
 
     client->state = 2;
+
+    // Bring the new client up to date with the baseline comparisons so far
+    loom_mutex_lock(jsonMutex);
+    if (!TelemetryHistory::reportJSONString.empty())
+    {
+        mg_websocket_write(conn, WEBSOCKET_OPCODE_TEXT, TelemetryHistory::reportJSONString.c_str(), TelemetryHistory::reportJSONString.length());
+    }
+    loom_mutex_unlock(jsonMutex);
 }
 
 // Called on new incoming data (this can be much nicer)
@@ -188,6 +197,9 @@ void TelemetryServer::start()
     // Set /tick as a handler that returns the main JSON string
     mg_set_request_handler(server, LTS_TICK_URI, JSONStringHandler, &TelemetryListener::tickMetricsJSONString);
 
+    // Set /baseline as a handler that returns the latest comparisons against the baselines
+    mg_set_request_handler(server, LTS_BASELINE_URI, JSONStringHandler, &TelemetryHistory::reportJSONString);
+
     // Set /stream as the websocket connection that streams all the ticks
     mg_set_websocket_handler(server, LTS_STREAM_URI, StreamConnectHandler, StreamReadyHandler, StreamDataHandler, StreamCloseHandler, NULL);
 
@@ -233,6 +245,98 @@ bool TelemetryListener::handleMessage(int fourcc, AssetProtocolHandler *handler,
 {
     switch (fourcc)
     {
+    case LOOM_FOURCC('T', 'E', 'L', 'B'):
+    {
+        utByteArray buffer;
+        int curPos = netBuffer.getCurrentPosition();
+
+        buffer.attach((char*)netBuffer.buffer + curPos, netBuffer.length - curPos);
+
+        TableValues<TickMetricValue> tickValues;
+        TableValues<TickMetricRange> tickRanges;
+
+        loom_mutex_lock(jsonMutex);
+
+        if (streamReader.read(&buffer, tickValues, tickRanges))
+        {
+            awaitingReset = false;
+
+            tickValues.writeJSONObject(&tickValuesJSON);
+            tickRanges.writeJSONArray(&tickRangesJSON);
+
+            updateMetricsJSON();
+
+            if (history.addTick(tickValues))
+            {
+                TelemetryServer::sendAll(TelemetryHistory::reportJSONString.c_str());
+            }
+        }
+        else if (!awaitingReset)
+        {
+            // Joined a stream midway or lost track of it,
+            // re-enabling makes the client restart the stream
+            lmLogWarn(gTelemetryServerLogGroup, "Telemetry stream out of sync, requesting a restart");
+            handler->sendCommand("telemetryEnable");
+            awaitingReset = true;
+        }
+
+        loom_mutex_unlock(jsonMutex);
+
+        return true;
+    }
+
+    // Where the ticks come from, sent when telemetry gets enabled
+    case LOOM_FOURCC('T', 'E', 'L', 'I'):
+    {
+        int curPos = netBuffer.getCurrentPosition();
+        const char *json = (const char*)netBuffer.buffer + curPos;
+
+        JSON identity;
+
+        // Sent null terminated
+        if (netBuffer.length <= curPos || json[netBuffer.length - curPos - 1] != 0 || !identity.loadString(json))
+        {
+            lmLogWarn(gTelemetryServerLogGroup, "Malformed telemetry identity message");
+            return true;
+        }
+
+        // Without a device name from the client its address tells devices apart
+        int host[4] = { 0, 0, 0, 0 }, port;
+        sscanf(handler->description().c_str(), "[ip=%d.%d.%d.%d:%d]", &host[0], &host[1], &host[2], &host[3], &port);
+
+        const char *platform = identity.getString("platform");
+        utString device = utStringFormat("%s%d-%d.%d.%d.%d", platform ? platform : "unknown", identity.getInteger("bits"), host[0], host[1], host[2], host[3]);
+
+        loom_mutex_lock(jsonMutex);
+        history.setIdentity(identity.getString("app"), identity.getString("build"), device.c_str());
+        loom_mutex_unlock(jsonMutex);
+
+        return true;
+    }
+
+    // Heap snapshots are JSON already, pass them on to the clients
+    case LOOM_FOURCC('H', 'E', 'A', 'P'):
+    {
+        int curPos = netBuffer.getCurrentPosition();
+        const char *json = (const char*)netBuffer.buffer + curPos;
+
+        // Sent null terminated
+        if (netBuffer.length <= curPos || json[netBuffer.length - curPos - 1] != 0)
+        {
+            lmLogWarn(gTelemetryServerLogGroup, "Malformed heap snapshot message");
+            return true;
+        }
+
+        utString message = "{\"status\":\"heap\",\"data\":";
+        message += json;
+        message += "}";
+
+        TelemetryServer::sendAll(message.c_str());
+
+        return true;
+    }
+
+    // Tables as sent by older clients
     case LOOM_FOURCC('T', 'E', 'L', 'E'):
 
         utByteArray buffer;
@@ -276,6 +380,14 @@ bool TelemetryListener::handleMessage(int fourcc, AssetProtocolHandler *handler,
     return false;
 }
 
+void TelemetryListener::promoteBaselines()
+{
+    loom_mutex_lock(jsonMutex);
+    TelemetryHistory::promoteAll();
+    TelemetryServer::sendAll(TelemetryHistory::reportJSONString.c_str());
+    loom_mutex_unlock(jsonMutex);
+}
+
 // Update the main JSON object from the individual parts and serialize it
 // as a cached string ready for transmission
 void TelemetryListener::updateMetricsJSON()
@@ -0,0 +1,295 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "zlib.h"
+
+#include "loom/common/platform/platformIO.h"
+#include "loom/common/platform/platformFile.h"
+#include "loom/common/utils/utTypes.h"
+#include "loom/common/utils/utString.h"
+#include "loom/common/utils/utStreams.h"
+#include "loom/common/assets/assetArchive.h"
+
+/*
+ * Packs asset files into an archive the asset manager can mount, see
+ * assetArchive.h for the format.
+ *
+ *   assetPack [--store] [--level <0-9>] <output.lpak> <folder or file>...
+ *
+ * Entries are named by the path they were found at, so pack from the
+ * folder the app loads its assets relative to, typically the project root:
+ *
+ *   assetPack assets.lpak assets
+ */
+
+struct PackEntry
+{
+    utString               name;
+    unsigned int           hash;
+    unsigned int           flags;
+    unsigned int           originalSize;
+    utArray<unsigned char> data;
+};
+
+static utArray<PackEntry *> entries;
+
+static bool store = false;
+static int  level = Z_BEST_COMPRESSION;
+
+static bool failed = false;
+
+
+static void AddFile(const char *path, void *payload)
+{
+    // Name entries with '/' and without a leading "./", as looked up.
+    char buffer[4096];
+    strncpy(buffer, path, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = 0;
+
+    for (char *c = buffer; *c; c++)
+    {
+        if (*c == '\\')
+        {
+            *c = '/';
+        }
+    }
+
+    const char *name = buffer;
+
+    while (name[0] == '.' && name[1] == '/')
+    {
+        name += 2;
+    }
+
+    PackEntry *entry = new PackEntry();
+
+    if (!utFileStream::tryReadToArray(path, entry->data, false))
+    {
+        printf("assetPack: unable to read %s\n", path);
+        failed = true;
+        delete entry;
+        return;
+    }
+
+    entry->name         = name;
+    entry->hash         = loom_assetArchive_hashName(name);
+    entry->flags        = LOOM_ASSET_ARCHIVE_TERMINATED;
+    entry->originalSize = entry->data.size();
+
+    // Keep the compressed data when it saves at least an eighth, already
+    // compressed formats such as png or ogg are better served in place.
+    if (!store && entry->data.size())
+    {
+        uLongf                 compressedSize = compressBound(entry->data.size());
+        utArray<unsigned char> compressed;
+        compressed.resize(compressedSize);
+
+        if ((compress2(compressed.ptr(), &compressedSize, entry->data.ptr(), entry->data.size(), level) == Z_OK) &&
+            (compressedSize < entry->data.size() - entry->data.size() / 8))
+        {
+            compressed.resize(compressedSize);
+            entry->data   = compressed;
+            entry->flags |= LOOM_ASSET_ARCHIVE_COMPRESSED;
+        }
+    }
+
+    entries.push_back(entry);
+}
+
+
+static int CompareEntries(const void *a, const void *b)
+{
+    const PackEntry *ea = *(const PackEntry **)a;
+    const PackEntry *eb = *(const PackEntry **)b;
+
+    if (ea->hash != eb->hash)
+    {
+        return ea->hash < eb->hash ? -1 : 1;
+    }
+
+    return strcmp(ea->name.c_str(), eb->name.c_str());
+}
+
+
+static void Pad(FILE *file, unsigned int& offset)
+{
+    while (offset % LOOM_ASSET_ARCHIVE_ALIGNMENT)
+    {
+        fputc(0, file);
+        offset++;
+    }
+}
+
+
+static bool WriteArchive(const char *path)
+{
+    FILE *file = fopen(path, "wb");
+
+    if (!file)
+    {
+        printf("assetPack: unable to open %s for writing\n", path);
+        return false;
+    }
+
+    qsort(entries.ptr(), entries.size(), sizeof(PackEntry *), CompareEntries);
+
+    utArray<loom_assetArchiveEntry_t> index;
+    index.resize(entries.size());
+
+    // Header, patched once the offsets are known.
+    loom_assetArchiveHeader_t header;
+    memset(&header, 0, sizeof(header));
+    fwrite(&header, sizeof(header), 1, file);
+
+    unsigned int offset     = sizeof(header);
+    unsigned int nameOffset = 0;
+    unsigned int stored     = 0;
+
+    // Data.
+    for (UTsize i = 0; i < entries.size(); i++)
+    {
+        PackEntry *entry = entries[i];
+
+        Pad(file, offset);
+
+        index[i].nameHash     = entry->hash;
+        index[i].nameOffset   = nameOffset;
+        index[i].offset       = offset;
+        index[i].size         = entry->data.size();
+        index[i].originalSize = entry->originalSize;
+        index[i].flags        = entry->flags;
+
+        if (entry->data.size())
+        {
+            fwrite(entry->data.ptr(), entry->data.size(), 1, file);
+        }
+
+        offset += entry->data.size();
+
+        // Terminate it, so text can be used in place.
+        fputc(0, file);
+        offset++;
+
+        nameOffset += entry->name.size() + 1;
+        stored     += entry->originalSize;
+    }
+
+    // Index.
+    Pad(file, offset);
+    header.indexOffset = offset;
+    if (index.size())
+    {
+        fwrite(index.ptr(), sizeof(loom_assetArchiveEntry_t), index.size(), file);
+    }
+    offset += sizeof(loom_assetArchiveEntry_t) * index.size();
+
+    // Names.
+    header.namesOffset = offset;
+    for (UTsize i = 0; i < entries.size(); i++)
+    {
+        fwrite(entries[i]->name.c_str(), entries[i]->name.size() + 1, 1, file);
+    }
+    offset += nameOffset;
+
+    header.magic      = LOOM_ASSET_ARCHIVE_MAGIC;
+    header.version    = LOOM_ASSET_ARCHIVE_VERSION;
+    header.entryCount = entries.size();
+
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+
+    if (ferror(file))
+    {
+        printf("assetPack: error writing %s\n", path);
+        fclose(file);
+        return false;
+    }
+
+    fclose(file);
+
+    printf("Packed %d files, %u bytes into %s, %u bytes\n", (int)entries.size(), stored, path, offset);
+
+    return true;
+}
+
+
+int main(int argc, const char **argv)
+{
+    const char *output = NULL;
+
+    utArray<const char *> inputs;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--store"))
+        {
+            store = true;
+        }
+        else if (!strcmp(argv[i], "--level") && (i + 1 < argc))
+        {
+            level = atoi(argv[++i]);
+
+            if ((level < 0) || (level > 9))
+            {
+                printf("assetPack: --level expects 0-9\n");
+                return EXIT_FAILURE;
+            }
+        }
+        else if (!output)
+        {
+            output = argv[i];
+        }
+        else
+        {
+            inputs.push_back(argv[i]);
+        }
+    }
+
+    if (!output || !inputs.size())
+    {
+        printf("usage: assetPack [--store] [--level <0-9>] <output.lpak> <folder or file>...\n");
+        printf("--store : don't compress any entries\n");
+        printf("--level <0-9> : zlib level for compressed entries (default 9)\n");
+        return EXIT_FAILURE;
+    }
+
+    for (UTsize i = 0; i < inputs.size(); i++)
+    {
+        if (platform_dirExists(inputs[i]) == 0)
+        {
+            platform_walkFiles(inputs[i], AddFile, NULL);
+        }
+        else
+        {
+            AddFile(inputs[i], NULL);
+        }
+    }
+
+    if (failed || !WriteArchive(output))
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
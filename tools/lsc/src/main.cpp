@@ -21,15 +21,24 @@
 // LoomScript Compiler
 #include "loom/common/core/log.h"
 #include "loom/common/core/assert.h"
+#include "loom/common/core/performance.h"
 #include "loom/common/platform/platform.h"
 #include "loom/common/platform/platformTime.h"
 #include "loom/common/platform/platformFile.h"
+#include "loom/common/platform/platformIO.h"
+#include "loom/common/utils/utStreams.h"
 #include "loom/script/compiler/lsCompiler.h"
+#include "loom/script/compiler/lsAlias.h"
+#include "loom/script/compiler/lsLexer.h"
+#include "loom/script/serialize/lsBinWriter.h"
 #include "loom/script/runtime/lsLuaState.h"
 #include "loom/script/native/lsNativeDelegate.h"
 
 #define LSC_VERSION "1.0.1"
 
+// default loopback port of the compiler server
+#define LSC_SERVER_PORT    12350
+
 using namespace LS;
 
 void installPackageSystem();
@@ -173,6 +182,234 @@ void RunBenchmarks()
     benchVM->close();
 }
 
+static const char *tracePath = NULL;
+
+// registered with atexit, so failed builds are traced as well
+static void WriteTrace()
+{
+    if (!LoomTrace::write(tracePath))
+    {
+        printf("lsc: unable to write trace to %s\n", tracePath);
+    }
+}
+
+
+static void CollectLexerBenchmarkSource(const char *path, void *payload)
+{
+    size_t length = strlen(path);
+
+    if ((length < 3) || strcmp(path + length - 3, ".ls"))
+    {
+        return;
+    }
+
+    utArray<unsigned char> data;
+
+    if (utFileStream::tryReadToArray(path, data))
+    {
+        ((utArray<utString> *)payload)->push_back(utString((const char *)data.ptr()));
+    }
+}
+
+
+/*
+ * Times the lexer alone over every .ls file below folder, run from sdk/src
+ * to measure it on the SDK sources.
+ */
+void RunLexerBenchmark(const char *folder)
+{
+    static const int passes = 10;
+
+    utArray<utString> sources;
+
+    platform_walkFiles(folder, CollectLexerBenchmarkSource, &sources);
+
+    Aliases::initialize();
+
+    Tokens *tokens     = Tokens::getSingletonPtr();
+    int    tokenCount  = 0;
+    int    start       = platform_getMilliseconds();
+
+    for (int pass = 0; pass < passes; pass++)
+    {
+        for (UTsize i = 0; i < sources.size(); i++)
+        {
+            ASTArena *arena = new ASTArena();
+
+            Lexer lexer;
+            lexer.arena = arena;
+            lexer.setInput(sources[i], "benchmark");
+
+            while (lexer.nextToken() != &tokens->TOKEN_EOF)
+            {
+                tokenCount++;
+            }
+
+            delete arena;
+        }
+    }
+
+    printf("Lexed %i files %i times, %i tokens in %i ms\n", (int)sources.size(), passes, tokenCount, platform_getMilliseconds() - start);
+}
+
+#if LOOM_PLATFORM != LOOM_PLATFORM_WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/*
+ * Keeps lsc resident for file watchers which rebuild on every save. Clients
+ * connect to the loopback port and send one line: the .build file to compile
+ * (relative to the server's working directory, empty for the default build)
+ * or "quit". The compiler output is streamed back, followed by a line
+ * "lsc: exit <status>", then the connection is closed.
+ *
+ * Each build runs in a child forked from the already initialized server,
+ * the compiler keeps global state and exits on errors, so a build can not
+ * be run twice in one process. Unchanged sources come out of the .lscache
+ * written by the previous build.
+ */
+void RunCompilerServer(int port)
+{
+    int listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (listenSocket == -1)
+    {
+        LSError("Unable to create compiler server socket");
+    }
+
+    int reuse = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port        = htons((unsigned short)port);
+
+    if ((bind(listenSocket, (struct sockaddr *)&address, sizeof(address)) == -1) ||
+        (listen(listenSocket, 5) == -1))
+    {
+        LSError("Unable to listen on port %i for compile requests", port);
+    }
+
+    // a client hanging up mid build must not take the server down
+    signal(SIGPIPE, SIG_IGN);
+
+    LSCompiler::log("Compiler server listening on port %i", port);
+
+    while (true)
+    {
+        int client = accept(listenSocket, NULL, NULL);
+
+        if (client == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            LSError("Compiler server failed to accept a connection");
+        }
+
+        // accepted sockets may inherit non blocking mode on BSD
+        fcntl(client, F_SETFL, fcntl(client, F_GETFL) & ~O_NONBLOCK);
+
+        char request[4096];
+        int  length = 0;
+        char c;
+
+        while ((length < (int)sizeof(request) - 1) && (read(client, &c, 1) == 1) && (c != '\n'))
+        {
+            if (c != '\r')
+            {
+                request[length++] = c;
+            }
+        }
+
+        request[length] = 0;
+
+        if (!strcmp(request, "quit"))
+        {
+            close(client);
+            break;
+        }
+
+        LSCompiler::log("Compile request: %s", length ? request : "(default build)");
+
+        // keep buffered output from being written by both processes
+        fflush(stdout);
+        fflush(stderr);
+
+        pid_t pid = fork();
+
+        if (pid == 0)
+        {
+            close(listenSocket);
+
+            dup2(client, STDOUT_FILENO);
+            dup2(client, STDERR_FILENO);
+            close(client);
+
+            if (length)
+            {
+                LSCompiler::setRootBuildFile(request);
+            }
+            else
+            {
+                LSCompiler::defaultRootBuildFile();
+            }
+
+            LSCompiler::initialize();
+
+            exit(EXIT_SUCCESS);
+        }
+
+        int status = EXIT_FAILURE;
+
+        if (pid == -1)
+        {
+            LSCompiler::log("Unable to fork a compile, %s", strerror(errno));
+        }
+        else
+        {
+            while ((waitpid(pid, &status, 0) == -1) && (errno == EINTR))
+            {
+            }
+
+            status = WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+        }
+
+        char result[64];
+        snprintf(result, sizeof(result), "lsc: exit %i\n", status);
+
+        if (write(client, result, strlen(result)) < 0)
+        {
+            LSCompiler::log("Compile client disconnected early");
+        }
+
+        close(client);
+
+        LSCompiler::log("Compile finished with status %i", status);
+    }
+
+    close(listenSocket);
+}
+
+
+#else
+
+void RunCompilerServer(int port)
+{
+    LSError("The compiler server is not supported on Windows");
+}
+#endif
+
 void printHeader()
 {
     const char *buildTarget;
@@ -210,7 +447,9 @@ int main(int argc, const char **argv)
 
     bool runtests      = false;
     bool runbenchmarks = false;
+    const char *lexBenchmarkFolder = NULL;
     bool symbols       = false;
+    int  serverPort    = 0;
 
     const char *rootBuildFile = NULL;
     const char *sdkRoot = NULL;
@@ -270,11 +509,71 @@ int main(int argc, const char **argv)
         else if (!strcmp(argv[i], "--benchmark"))
         {
             runbenchmarks = true;
+
+            // optional results file, read by the benchmarks themselves
+            if ((i + 1 < argc) && strncmp(argv[i + 1], "--", 2) && !strstr(argv[i + 1], ".build"))
+            {
+                i++;
+            }
+        }
+        else if (!strcmp(argv[i], "--trace"))
+        {
+            tracePath = "lsc.trace.json";
+
+            // optional output file
+            if ((i + 1 < argc) && strncmp(argv[i + 1], "--", 2))
+            {
+                tracePath = argv[++i];
+            }
+
+            LoomTrace::enable(true);
+            atexit(WriteTrace);
+        }
+        else if (!strcmp(argv[i], "--lexbench"))
+        {
+            lexBenchmarkFolder = ".";
+
+            // optional folder
+            if ((i + 1 < argc) && strncmp(argv[i + 1], "--", 2))
+            {
+                lexBenchmarkFolder = argv[++i];
+            }
         }
         else if (!strcmp(argv[i], "--symbols"))
         {
             symbols = true;
         }
+        else if (!strcmp(argv[i], "--no-cache"))
+        {
+            LSCompiler::setIncremental(false);
+        }
+        else if (!strcmp(argv[i], "--strip"))
+        {
+            LSCompiler::setStripTypes(true);
+        }
+        else if (!strcmp(argv[i], "--stored"))
+        {
+            LSCompiler::setExecutableCompression(LOOM_BINARY_COMPRESSION_STORED);
+        }
+        else if (!strcmp(argv[i], "--compression"))
+        {
+            if ((i + 1 >= argc) || (argv[i + 1][0] < '0') || (argv[i + 1][0] > '9') || argv[i + 1][1])
+            {
+                LSError("--compression option requires a level from 0 (stored) to 9 to be specified next");
+            }
+
+            LSCompiler::setExecutableCompression(atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "--server"))
+        {
+            serverPort = LSC_SERVER_PORT;
+
+            // optional port
+            if ((i + 1 < argc) && (atoi(argv[i + 1]) > 0))
+            {
+                serverPort = atoi(argv[++i]);
+            }
+        }
         else if (!strcmp(argv[i], "--xmlfile"))
         {
             i++;      // skip the filename
@@ -328,9 +627,17 @@ int main(int argc, const char **argv)
             printf("--release : build in release mode\n");
             printf("--verbose : enable verbose compilation\n");
             printf("--unittest [--xmlfile filename.xml]: run unit tests with optional xml file output\n");
+            printf("--benchmark [file] : run the script benchmarks, writing the results as JSON to file (default benchmark.json)\n");
             printf("--root: set the SDK root\n");
             printf("--project: set the project folder\n");
             printf("--symbols : dump symbols for binary executable\n");
+            printf("--trace [file] : write a Chrome trace (chrome://tracing) of the compiler phases to file, a Perfetto trace if it ends in .pftrace (default lsc.trace.json)\n");
+            printf("--lexbench [folder] : time the lexer over the .ls files below folder (default current)\n");
+            printf("--no-cache : recompile all sources, ignoring the .lscache of previous builds\n");
+            printf("--strip : leave out the linked types the executable can't reach, mark types only created through reflection with [Keep]\n");
+            printf("--stored : write the executable uncompressed, so the runtime maps it instead of inflating it\n");
+            printf("--compression level : zlib level of the executable, 1 is fastest to build and 0 is the same as --stored\n");
+            printf("--server [port] : stay resident and compile the .build file sent by each client on the loopback port (default %i)\n", LSC_SERVER_PORT);
             printf("--config : set a custom configuration override\n");
             printf("--help: display this help\n");
         }
@@ -372,6 +679,12 @@ int main(int argc, const char **argv)
         return EXIT_SUCCESS;
     }
 
+    if (lexBenchmarkFolder)
+    {
+        RunLexerBenchmark(lexBenchmarkFolder);
+        return EXIT_SUCCESS;
+    }
+
     LSCompiler::setDumpSymbols(symbols);
 
     // todo, better sdk detection
@@ -403,6 +716,12 @@ int main(int argc, const char **argv)
         }
     }
 
+    if (serverPort)
+    {
+        RunCompilerServer(serverPort);
+        return EXIT_SUCCESS;
+    }
+
     if (!rootBuildFile)
     {
         LSCompiler::defaultRootBuildFile();
@@ -0,0 +1,239 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/common/platform/platform.h"
+#include "loom/common/platform/platformTime.h"
+#include "loom/common/core/benchmark.h"
+#include "loom/common/core/performance.h"
+#include "loom/common/core/stringTable.h"
+#include "loom/graphics/gfxGraphics.h"
+#include "loom/graphics/gfxFrameCapture.h"
+
+#include <SDL.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if LOOM_PLATFORM == LOOM_PLATFORM_WIN32
+#include <windows.h>
+#endif
+
+#define NATIVEBENCHMARK_WIDTH     1024
+#define NATIVEBENCHMARK_HEIGHT    768
+
+static SDL_Window    *gWindow  = NULL;
+static SDL_GLContext gContext = NULL;
+
+static void usage()
+{
+    printf("Usage: nativebenchmark [options]\n");
+    printf("  --filter <text>       only run benchmarks with text in their name\n");
+    printf("  --samples <count>     timed samples per benchmark\n");
+    printf("  --out <file>          write the results as JSON\n");
+    printf("  --baseline <file>     compare against results written earlier\n");
+    printf("  --tolerance <ratio>   change of a median counted as a regression, 0.1 by default\n");
+    printf("  --no-gl               skip the benchmarks that need a GL context\n");
+    printf("  --replay <file>       only benchmark drawing a frame captured with Graphics.captureFrame\n");
+}
+
+// A hidden window is the most portable way to get a context, the
+// benchmarks render to its default framebuffer
+static bool createContext()
+{
+    if (SDL_Init(SDL_INIT_VIDEO) != 0)
+    {
+        printf("No video, the graphics benchmarks are skipped: %s\n", SDL_GetError());
+        return false;
+    }
+
+#if LOOM_RENDERER_OPENGLES2
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
+#endif
+    SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 1);
+
+    gWindow = SDL_CreateWindow("nativebenchmark", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                               NATIVEBENCHMARK_WIDTH, NATIVEBENCHMARK_HEIGHT, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if (!gWindow)
+    {
+        printf("No window, the graphics benchmarks are skipped: %s\n", SDL_GetError());
+        SDL_Quit();
+        return false;
+    }
+
+    gContext = SDL_GL_CreateContext(gWindow);
+    if (!gContext)
+    {
+        printf("No GL context, the graphics benchmarks are skipped: %s\n", SDL_GetError());
+        SDL_DestroyWindow(gWindow);
+        gWindow = NULL;
+        SDL_Quit();
+        return false;
+    }
+
+    // Frames must not wait on the display
+    SDL_GL_SetSwapInterval(0);
+
+    GFX::Graphics::initialize();
+    GFX::Graphics::reset(NATIVEBENCHMARK_WIDTH, NATIVEBENCHMARK_HEIGHT);
+
+    return true;
+}
+
+static GFX::FrameReplay gReplay;
+
+// Every iteration draws the captured frame, finished like the quad
+// renderer benchmarks so the GPU work is part of the time
+static void benchmark_frameReplay(int iterations)
+{
+    if (!GFX::Graphics::isInitialized())
+    {
+        loom_benchmark_skip("no GL context");
+        return;
+    }
+
+    for (int i = 0; i < iterations; i++)
+    {
+        gReplay.play();
+        GFX::Graphics::context()->glFinish();
+    }
+}
+
+static void destroyContext()
+{
+    if (!gContext)
+    {
+        return;
+    }
+
+    GFX::Graphics::shutdown();
+
+    SDL_GL_DeleteContext(gContext);
+    SDL_DestroyWindow(gWindow);
+    SDL_Quit();
+
+    gContext = NULL;
+    gWindow  = NULL;
+}
+
+int main(int argc, char **argv)
+{
+    #if LOOM_PLATFORM == LOOM_PLATFORM_WIN32
+    DWORD dwMode = SetErrorMode(SEM_NOGPFAULTERRORBOX);
+    SetErrorMode(dwMode | SEM_NOGPFAULTERRORBOX);
+    #endif
+
+    loom_benchmarkOptions options;
+    loom_benchmark_defaultOptions(&options);
+
+    bool useGL = true;
+    const char *replayPath = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg   = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (!strcmp(arg, "--no-gl"))
+        {
+            useGL = false;
+            continue;
+        }
+
+        if (!strcmp(arg, "--help") || !value)
+        {
+            usage();
+            return !strcmp(arg, "--help") ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        if (!strcmp(arg, "--filter"))
+        {
+            options.filter = value;
+        }
+        else if (!strcmp(arg, "--samples"))
+        {
+            options.samples = atoi(value);
+        }
+        else if (!strcmp(arg, "--out"))
+        {
+            options.outputPath = value;
+        }
+        else if (!strcmp(arg, "--baseline"))
+        {
+            options.baselinePath = value;
+        }
+        else if (!strcmp(arg, "--tolerance"))
+        {
+            options.tolerance = atof(value);
+        }
+        else if (!strcmp(arg, "--replay"))
+        {
+            replayPath = value;
+        }
+        else
+        {
+            usage();
+            return EXIT_FAILURE;
+        }
+
+        i++;
+    }
+
+    platform_timeInitialize();
+    performance_initialize();
+    stringtable_initialize();
+
+    if (useGL)
+    {
+        createContext();
+    }
+
+    if (replayPath && gContext)
+    {
+        if (!gReplay.load(replayPath))
+        {
+            destroyContext();
+            return EXIT_FAILURE;
+        }
+
+        GFX::Graphics::reset(gReplay.getWidth(), gReplay.getHeight());
+    }
+
+    extern void benchmark_suite_allBenchmarks();
+
+    loom_benchmark_begin(&options);
+    if (replayPath)
+        loom_benchmark_run("frameReplay", benchmark_frameReplay);
+    else
+        benchmark_suite_allBenchmarks();
+    int regressions = loom_benchmark_end();
+
+    gReplay.dispose();
+    destroyContext();
+
+    if (regressions > 0)
+    {
+        printf("*** %d BENCHMARKS REGRESSED ***\n", regressions);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
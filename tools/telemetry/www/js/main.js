@@ -157,6 +157,78 @@ var Telemetry = {
         return (nano * 1e-6).toFixed(2)+Telemetry.timeUnitLabels.milliseconds;
     },
     
+    getSizeFromBytes: function(bytes) {
+        var size = Math.abs(bytes);
+        if (size < 1024) return bytes.toFixed(0)+"B";
+        if (size < 1024*1024) return (bytes / 1024).toFixed(1)+"KiB";
+        return (bytes / (1024*1024)).toFixed(1)+"MiB";
+    },
+    
+    // Lists the classes of a heap snapshot (or diff) sent from the client,
+    // the ones retaining the most first, the retainer path is in the row title
+    heapClassLimit: 30,
+    showHeapSnapshot: function(snapshot) {
+        var classes = snapshot.classes.slice().sort(function(a, b) {
+            return Math.abs(b.retained) - Math.abs(a.retained);
+        });
+        
+        var template = d3.select("#tmplHeapClass").html();
+        var rows = classes.slice(0, Telemetry.heapClassLimit).map(function(c) {
+            return Mustache.render(template, {
+                name: c.name,
+                count: c.count,
+                retained: Telemetry.getSizeFromBytes(c.retained),
+                path: c.path
+            });
+        });
+        
+        var panel = $("#heapSnapshot");
+        panel.find(".sub.header").text(
+            snapshot.objects + " objects, " + Telemetry.getSizeFromBytes(snapshot.size) +
+            (snapshot.time > 0 ? ", taken in " + snapshot.time.toFixed(0) + "ms" : "")
+        );
+        panel.find("tbody").html(rows.join(""));
+        panel.removeClass("hidden");
+    },
+    
+    // Lists the percentiles of every client against the baseline of its
+    // device as summarized by the server, regressions are highlighted
+    showBaselineReports: function(reports) {
+        var template = d3.select("#tmplBaselineRow").html();
+        var rows = [];
+        var regressed = 0;
+        
+        reports.forEach(function(report) {
+            var base = report.baseline ? report.baseline.metrics : {};
+            var flagged = {};
+            report.regressions.forEach(function(r) {
+                flagged[r.metric + "." + r.percentile] = r;
+            });
+            regressed += report.regressions.length;
+            
+            Object.keys(report.metrics).forEach(function(metric) {
+                ["p50", "p95", "p99"].forEach(function(p) {
+                    var current = report.metrics[metric][p];
+                    var baseline = base[metric] ? base[metric][p] : undefined;
+                    var change = baseline > 0 ? current / baseline - 1 : undefined;
+                    rows.push(Mustache.render(template, {
+                        classes: flagged[metric + "." + p] ? "negative" : "",
+                        client: report.app + " " + report.build + " on " + report.device,
+                        metric: metric + " " + p,
+                        baseline: baseline !== undefined ? baseline.toFixed(2) + " (" + report.baseline.build + ")" : "-",
+                        current: current.toFixed(2),
+                        change: change !== undefined ? (change >= 0 ? "+" : "") + (change * 100).toFixed(0) + "%" : "-"
+                    }));
+                });
+            });
+        });
+        
+        var panel = $("#baselineReport");
+        panel.find(".sub.header").text(reports.length + " clients, " + regressed + " regressions");
+        panel.find("tbody").html(rows.join(""));
+        panel.toggleClass("hidden", reports.length == 0);
+    },
+    
 };
 
 // Common functions and values of the main chart
@@ -635,6 +707,12 @@ function TelemetryProcessor(initCommon) {
             case "pong":
                 Telemetry.stream.pong();
                 break;
+            case "heap":
+                Telemetry.showHeapSnapshot(m.data);
+                break;
+            case "baseline":
+                Telemetry.showBaselineReports(m.data);
+                break;
             default:
                 console.log("Result "+m.status+": "+m);
         }